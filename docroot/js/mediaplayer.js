@@ -30,6 +30,9 @@ LMS.mediaplayer = function () {
 	let _pendingTrackParameters = null;
 	let _gainNode = null;
 	let _audioCtx = null;
+	let _nextTranscodingSrc = null;
+	let _nextTrackPrepared = false;
+	const _nextTrackPrepareDelay = 10; // seconds before the end of the current track
 
 	let _unlock = function() {
 		document.removeEventListener("touchstart", _unlock);
@@ -263,6 +266,7 @@ LMS.mediaplayer = function () {
 		_elems.audio.addEventListener("timeupdate", function() {
 			_elems.progress.style.width = "" + ((_offset + _elems.audio.currentTime) / _duration) * 100 + "%";
 			_elems.curtime.innerHTML = _durationToString(_offset + _elems.audio.currentTime);
+			_prepareNextTrackIfNeeded();
 		});
 
 		_elems.audio.addEventListener("ended", function() {
@@ -345,6 +349,30 @@ LMS.mediaplayer = function () {
 			return undefined;
 	}
 
+	let _prepareNextTrackIfNeeded = function() {
+		if (_nextTrackPrepared || _nextTranscodingSrc == null)
+			return;
+
+		if (_getAudioMode() != Mode.Transcoding)
+			return;
+
+		if (_duration - (_offset + _elems.audio.currentTime) > _nextTrackPrepareDelay)
+			return;
+
+		// Ask the server to start transcoding the next track, so that it is ready when the current one ends
+		_nextTrackPrepared = true;
+		fetch(_nextTranscodingSrc + "&prepare=1")
+			.catch(error => { console.log("Cannot prepare next track: " + error); });
+	}
+
+	let setNextTrack = function(params) {
+		_nextTrackPrepared = false;
+		if (params == null)
+			_nextTranscodingSrc = null;
+		else
+			_nextTranscodingSrc = params.transcodingResource + "&bitrate=" + _settings.transcoding.bitrate + "&format=" + _settings.transcoding.format;
+	}
+
 	let loadTrack = function(params, autoplay) {
 		_stopTimer();
 		_resetTimer();
@@ -412,6 +440,7 @@ LMS.mediaplayer = function () {
 		init: init,
 		loadTrack: loadTrack,
 		stop: stop,
+		setNextTrack: setNextTrack,
 		setSettings: setSettings,
 	};
 }();
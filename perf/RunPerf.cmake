@@ -0,0 +1,177 @@
+# Runs the benchmarks and compares their median real times with the baseline
+# Inputs: DB_GENERATOR, DB_BENCH, SOM_BENCH (optional), WORK_DIR, BASELINE, MAX_REGRESSION, UPDATE_BASELINE (optional)
+cmake_minimum_required(VERSION 3.19)
+
+# Datasets generated by lms-db-generator, as "name|generator arguments"
+set(DATASETS
+	"small|--release-count 500 --artist-count 200 --user-count 2 --generate-features"
+	"medium|--release-count 5000 --artist-count 2000 --user-count 5 --generate-features"
+	)
+set(SEED 42)
+set(BENCHMARK_ARGS --benchmark_repetitions=5 --benchmark_report_aggregates_only=true --benchmark_format=json)
+
+# Converts a Google Benchmark time (decimal, possibly in scientific notation) to integer nanoseconds
+function(to_nanoseconds value unit outVar)
+	if (NOT value MATCHES "^([0-9]+)\\.?([0-9]*)([eE]([+-]?[0-9]+))?$")
+		message(FATAL_ERROR "Cannot parse time '${value}'")
+	endif ()
+	set(digits "${CMAKE_MATCH_1}${CMAKE_MATCH_2}")
+	set(exponent 0)
+	if (CMAKE_MATCH_4)
+		set(exponent ${CMAKE_MATCH_4})
+	endif ()
+	string(LENGTH "${CMAKE_MATCH_2}" fractionLength)
+	math(EXPR exponent "${exponent} - ${fractionLength}")
+
+	if (unit STREQUAL "us")
+		math(EXPR exponent "${exponent} + 3")
+	elseif (unit STREQUAL "ms")
+		math(EXPR exponent "${exponent} + 6")
+	elseif (unit STREQUAL "s")
+		math(EXPR exponent "${exponent} + 9")
+	endif ()
+
+	# keep 12 significant digits so that the computations fit in 64 bits
+	string(LENGTH "${digits}" digitCount)
+	if (digitCount GREATER 12)
+		math(EXPR exponent "${exponent} + ${digitCount} - 12")
+		string(SUBSTRING "${digits}" 0 12 digits)
+	endif ()
+
+	if (exponent GREATER_EQUAL 0)
+		string(REPEAT "0" ${exponent} zeros)
+		set(digits "${digits}${zeros}")
+	else ()
+		string(LENGTH "${digits}" digitCount)
+		math(EXPR digitCount "${digitCount} + ${exponent}")
+		if (digitCount LESS_EQUAL 0)
+			set(digits 0)
+		else ()
+			string(SUBSTRING "${digits}" 0 ${digitCount} digits)
+		endif ()
+	endif ()
+
+	math(EXPR result "${digits}")
+	set(${outVar} ${result} PARENT_SCOPE)
+endfunction()
+
+# Appends the median real times of a Google Benchmark JSON report to the RESULT_NAMES / RESULT_<name> variables
+function(read_results file)
+	file(READ "${file}" json)
+	string(JSON benchmarkCount LENGTH "${json}" benchmarks)
+	math(EXPR lastIndex "${benchmarkCount} - 1")
+
+	set(names ${RESULT_NAMES})
+	foreach (index RANGE ${lastIndex})
+		string(JSON aggregateName ERROR_VARIABLE error GET "${json}" benchmarks ${index} aggregate_name)
+		if (error OR NOT aggregateName STREQUAL "median")
+			continue()
+		endif ()
+
+		string(JSON name GET "${json}" benchmarks ${index} run_name)
+		string(JSON realTime GET "${json}" benchmarks ${index} real_time)
+		string(JSON timeUnit GET "${json}" benchmarks ${index} time_unit)
+		to_nanoseconds("${realTime}" "${timeUnit}" nanoseconds)
+
+		list(APPEND names "${name}")
+		set(RESULT_${name} ${nanoseconds} PARENT_SCOPE)
+	endforeach ()
+	set(RESULT_NAMES ${names} PARENT_SCOPE)
+endfunction()
+
+function(run_benchmark name)
+	set(output "${WORK_DIR}/${name}.json")
+	message(STATUS "Running ${name}...")
+	execute_process(COMMAND ${ARGN} ${BENCHMARK_ARGS} --benchmark_out=${output} --benchmark_out_format=json
+		OUTPUT_QUIET
+		RESULT_VARIABLE result)
+	if (NOT result EQUAL 0)
+		message(FATAL_ERROR "${name} failed: ${result}")
+	endif ()
+	read_results("${output}")
+	set(RESULT_NAMES ${RESULT_NAMES} PARENT_SCOPE)
+	foreach (resultName ${RESULT_NAMES})
+		set(RESULT_${resultName} ${RESULT_${resultName}} PARENT_SCOPE)
+	endforeach ()
+endfunction()
+
+# Generate the databases, only once per set of generator arguments
+file(WRITE "${WORK_DIR}/track.mp3" "") # only the path of the track is used
+set(DB_FILES)
+foreach (dataset ${DATASETS})
+	string(REPLACE "|" ";" dataset "${dataset}")
+	list(GET dataset 0 datasetName)
+	list(GET dataset 1 datasetArgs)
+	separate_arguments(dataset UNIX_COMMAND "${datasetArgs} --seed ${SEED} --track-path ${WORK_DIR}/track.mp3")
+
+	set(datasetDir "${WORK_DIR}/datasets/${datasetName}")
+	set(dbFile "${datasetDir}/lms.db")
+	set(stampFile "${datasetDir}/generator-args.txt")
+	string(REPLACE ";" " " datasetArgs "${dataset}")
+
+	set(previousArgs "")
+	if (EXISTS "${stampFile}")
+		file(READ "${stampFile}" previousArgs)
+	endif ()
+
+	if (NOT EXISTS "${dbFile}" OR NOT previousArgs STREQUAL datasetArgs)
+		message(STATUS "Generating dataset '${datasetName}'...")
+		file(REMOVE_RECURSE "${datasetDir}")
+		file(MAKE_DIRECTORY "${datasetDir}")
+		file(WRITE "${datasetDir}/lms.conf" "working-dir = \"${datasetDir}\";\n")
+		execute_process(COMMAND "${DB_GENERATOR}" --conf "${datasetDir}/lms.conf" ${dataset}
+			OUTPUT_QUIET
+			RESULT_VARIABLE result)
+		if (NOT result EQUAL 0)
+			message(FATAL_ERROR "Cannot generate dataset '${datasetName}': ${result}")
+		endif ()
+		file(WRITE "${stampFile}" "${datasetArgs}")
+	endif ()
+
+	# the benchmark names are suffixed by the database file name
+	file(CREATE_LINK "${dbFile}" "${WORK_DIR}/${datasetName}.db" SYMBOLIC COPY_ON_ERROR)
+	list(APPEND DB_FILES "${WORK_DIR}/${datasetName}.db")
+endforeach ()
+
+set(RESULT_NAMES)
+run_benchmark(db-bench "${DB_BENCH}" ${DB_FILES})
+if (SOM_BENCH)
+	run_benchmark(som-bench "${SOM_BENCH}")
+endif ()
+
+if (UPDATE_BASELINE)
+	set(json "{}")
+	foreach (name ${RESULT_NAMES})
+		string(JSON json SET "${json}" "${name}" "${RESULT_${name}}")
+	endforeach ()
+	file(WRITE "${BASELINE}" "${json}\n")
+	message(STATUS "Baseline '${BASELINE}' updated")
+	return()
+endif ()
+
+# Compare with the baseline
+file(READ "${BASELINE}" baseline)
+set(regressions)
+foreach (name ${RESULT_NAMES})
+	string(JSON baselineTime ERROR_VARIABLE error GET "${baseline}" "${name}")
+	if (error)
+		message(STATUS "NEW        ${name}: ${RESULT_${name}}ns")
+		continue()
+	endif ()
+
+	set(currentTime ${RESULT_${name}})
+	math(EXPR ratio "${currentTime} * 100 / (${baselineTime} + 1)")
+	math(EXPR maxTime "${baselineTime} * (100 + ${MAX_REGRESSION}) / 100")
+	if (currentTime GREATER maxTime)
+		message(STATUS "REGRESSION ${name}: ${baselineTime}ns -> ${currentTime}ns (${ratio}%)")
+		list(APPEND regressions "${name}")
+	else ()
+		message(STATUS "OK         ${name}: ${baselineTime}ns -> ${currentTime}ns (${ratio}%)")
+	endif ()
+endforeach ()
+
+list(LENGTH regressions regressionCount)
+if (regressionCount GREATER 0)
+	message(FATAL_ERROR "${regressionCount} benchmark(s) are more than ${MAX_REGRESSION}% slower than the baseline")
+endif ()
+message(STATUS "No performance regression")
@@ -284,10 +284,25 @@ namespace Av
         res->codec = avcodecToDecodingCodec(avstream->codecpar->codec_id);
         res->codecName = ::avcodec_get_name(avstream->codecpar->codec_id);
         assert(!res->codecName.empty()); // doc says it is never NULL
+        res->sampleRate = static_cast<std::size_t>(avstream->codecpar->sample_rate);
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57, 24, 100)
+        res->channelCount = static_cast<std::size_t>(avstream->codecpar->ch_layout.nb_channels);
+#else
+        res->channelCount = static_cast<std::size_t>(avstream->codecpar->channels);
+#endif
 
         return res;
     }
 
+    DecodingCodec getDecodingCodec(std::string_view codecName)
+    {
+        const AVCodecDescriptor* descriptor{ ::avcodec_descriptor_get_by_name(std::string{ codecName }.c_str()) };
+        if (!descriptor)
+            return DecodingCodec::UNKNOWN;
+
+        return avcodecToDecodingCodec(descriptor->id);
+    }
+
     std::string_view getMimeType(const std::filesystem::path& fileExtension)
     {
         // List should be sync with the demuxers shipped in the lms's docker version
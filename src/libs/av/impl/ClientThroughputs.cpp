@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ClientThroughputs.hpp"
+
+#include <algorithm>
+
+#include "utils/IConfig.hpp"
+#include "utils/Service.hpp"
+
+namespace Av::Transcoding
+{
+    std::optional<ClientThroughput> getClientThroughput(std::string_view throughputKey)
+    {
+        return ClientThroughputs::getInstance().get(throughputKey);
+    }
+
+    ClientThroughputs& ClientThroughputs::getInstance()
+    {
+        // networks change (mobile clients...): old measures are not relevant anymore
+        static ClientThroughputs clientThroughputs{ 1024, std::chrono::seconds{ Service<IConfig>::get()->getULong("transcoding-throughput-max-age", 1800) } };
+        return clientThroughputs;
+    }
+
+    ClientThroughputs::ClientThroughputs(std::size_t maxClientCount, std::chrono::seconds maxAge)
+        : _maxClientCount{ maxClientCount }
+        , _maxAge{ maxAge }
+    {
+    }
+
+    void ClientThroughputs::record(std::string_view throughputKey, std::size_t throughput, std::size_t streamBitrate)
+    {
+        const auto now{ std::chrono::steady_clock::now() };
+
+        const std::scoped_lock lock{ _mutex };
+
+        if (_entries.size() >= _maxClientCount && _entries.find(std::string{ throughputKey }) == std::cend(_entries))
+        {
+            // drop the oldest measure
+            const auto itOldest{ std::min_element(std::cbegin(_entries), std::cend(_entries), [](const auto& lhs, const auto& rhs) { return lhs.second.lastUpdate < rhs.second.lastUpdate; }) };
+            _entries.erase(itOldest);
+        }
+
+        Entry& entry{ _entries[std::string{ throughputKey }] };
+        entry.throughput.throughput = throughput;
+        entry.throughput.keptUp = throughput >= streamBitrate;
+        entry.lastUpdate = now;
+    }
+
+    std::optional<ClientThroughput> ClientThroughputs::get(std::string_view throughputKey) const
+    {
+        const std::scoped_lock lock{ _mutex };
+
+        const auto it{ _entries.find(std::string{ throughputKey }) };
+        if (it == std::cend(_entries) || std::chrono::steady_clock::now() - it->second.lastUpdate > _maxAge)
+            return std::nullopt;
+
+        return it->second.throughput;
+    }
+} // namespace Av::Transcoding
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "av/TranscodingResourceHandlerCreator.hpp"
+
+namespace Av::Transcoding
+{
+    // Throughput measured on the last transcoded stream of each client
+    class ClientThroughputs
+    {
+    public:
+        static ClientThroughputs& getInstance();
+
+        ClientThroughputs(std::size_t maxClientCount, std::chrono::seconds maxAge);
+
+        ClientThroughputs(const ClientThroughputs&) = delete;
+        ClientThroughputs& operator=(const ClientThroughputs&) = delete;
+
+        void record(std::string_view throughputKey, std::size_t throughput, std::size_t streamBitrate);
+        std::optional<ClientThroughput> get(std::string_view throughputKey) const; // null if unknown or outdated
+
+    private:
+        struct Entry
+        {
+            ClientThroughput throughput;
+            std::chrono::steady_clock::time_point lastUpdate;
+        };
+
+        const std::size_t _maxClientCount;
+        const std::chrono::seconds _maxAge;
+
+        mutable std::mutex _mutex;
+        std::unordered_map<std::string, Entry> _entries;
+    };
+} // namespace Av::Transcoding
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "av/TranscodingParameters.hpp"
+
+namespace Av::Transcoding
+{
+    class ITranscoder
+    {
+    public:
+        virtual ~ITranscoder() = default;
+
+        // non blocking calls
+        using ReadCallback = std::function<void(std::size_t nbReadBytes)>;
+        virtual void            asyncRead(std::byte* buffer, std::size_t bufferSize, ReadCallback) = 0;
+        virtual std::size_t     readSome(std::byte* buffer, std::size_t bufferSize) = 0;
+
+        virtual const std::string& getOutputMimeType() const = 0;
+        virtual const OutputParameters& getOutputParameters() const = 0;
+
+        virtual bool            finished() const = 0;
+
+        // thread safe: releases the transcoding resources, the pending and next reads then end the output
+        virtual void            stop() = 0;
+        virtual std::size_t     getDebugId() const = 0;
+    };
+
+    // The source audio stream can be copied as is in the output container: same codec and no higher bitrate than requested
+    bool isStreamCopyPossible(const InputParameters& inputParameters, const OutputParameters& outputParameters);
+    // Nominal bitrate of the output, taking stream copies into account
+    std::size_t getOutputBitrate(const InputParameters& inputParameters, const OutputParameters& outputParameters);
+
+    // Engine selected using the "transcoding-engine" config option
+    std::unique_ptr<ITranscoder> createTranscoder(const InputParameters& inputParameters, const OutputParameters& outputParameters);
+} // namespace Av::Transcoding
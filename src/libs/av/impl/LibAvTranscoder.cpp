@@ -0,0 +1,780 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "LibAvTranscoder.hpp"
+
+extern "C"
+{
+#define __STDC_CONSTANT_MACROS
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/audio_fifo.h>
+#include <libavutil/error.h>
+#include <libavutil/opt.h>
+#include <libswresample/swresample.h>
+}
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+
+#include "av/SeekTable.hpp"
+#include "utils/IOContextRunner.hpp"
+#include "utils/Logger.hpp"
+
+// AVChannelLayout API, the former channel_layout/channels fields have been removed in FFmpeg 7
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57, 24, 100)
+#define LMS_AV_HAS_CH_LAYOUT 1
+#endif
+
+namespace Av::Transcoding
+{
+
+#define LOG(sev)	LMS_LOG(TRANSCODING, sev) << "[libav " << _debugId << "] - "
+
+    namespace
+    {
+        std::atomic<std::size_t> globalId{};
+
+        std::string averror_to_string(int error)
+        {
+            std::array<char, 128> buf = { 0 };
+
+            if (::av_strerror(error, buf.data(), buf.size()) == 0)
+                return &buf[0];
+            else
+                return "Unknown error";
+        }
+
+        class LibAvException : public Exception
+        {
+        public:
+            LibAvException(const std::string& what, int avError)
+                : Exception{ what + ": " + averror_to_string(avError) }
+            {}
+        };
+
+        boost::asio::io_context& getIOContext()
+        {
+            static boost::asio::io_context ioContext;
+            static IOContextRunner ioContextRunner{ ioContext, std::max<std::size_t>(1, std::thread::hardware_concurrency()) };
+
+            return ioContext;
+        }
+
+        struct OutputFormatInfo
+        {
+            const char* formatName;
+            const char* encoderName;
+        };
+
+        // keep in sync with the options given to ffmpeg by the Transcoder
+        OutputFormatInfo getOutputFormatInfo(OutputFormat format)
+        {
+            switch (format)
+            {
+            case OutputFormat::MP3:             return { "mp3", "libmp3lame" };
+            case OutputFormat::OGG_OPUS:        return { "ogg", "libopus" };
+            case OutputFormat::MATROSKA_OPUS:   return { "matroska", "libopus" };
+            case OutputFormat::OGG_VORBIS:      return { "ogg", "libvorbis" };
+            case OutputFormat::WEBM_VORBIS:     return { "webm", "libvorbis" };
+            }
+
+            throw Exception{ "Unhandled format (" + std::to_string(static_cast<int>(format)) + ")" };
+        }
+
+        // prefer the input sample rate, or the closest higher one supported by the encoder
+        int selectSampleRate(const AVCodec* encoder, int inputSampleRate)
+        {
+            if (!encoder->supported_samplerates)
+                return inputSampleRate;
+
+            int bestSampleRate{};
+            for (const int* sampleRate{ encoder->supported_samplerates }; *sampleRate != 0; ++sampleRate)
+            {
+                if (*sampleRate == inputSampleRate)
+                    return inputSampleRate;
+
+                if (bestSampleRate < inputSampleRate ? *sampleRate > bestSampleRate : (*sampleRate >= inputSampleRate && *sampleRate < bestSampleRate))
+                    bestSampleRate = *sampleRate;
+            }
+
+            return bestSampleRate;
+        }
+
+        void setFrameParameters(AVFrame* frame, const AVCodecContext* encoder)
+        {
+            frame->format = encoder->sample_fmt;
+            frame->sample_rate = encoder->sample_rate;
+#if LMS_AV_HAS_CH_LAYOUT
+            av_channel_layout_copy(&frame->ch_layout, &encoder->ch_layout);
+#else
+            frame->channel_layout = encoder->channel_layout;
+            frame->channels = encoder->channels;
+#endif
+        }
+    }
+
+    class LibAvTranscoder::Context
+    {
+    public:
+        Context(std::size_t debugId, const InputParameters& inputParameters, const OutputParameters& outputParameters);
+        ~Context();
+
+        Context(const Context&) = delete;
+        Context& operator=(const Context&) = delete;
+        Context(Context&&) = delete;
+        Context& operator=(Context&&) = delete;
+
+        std::size_t readSome(std::byte* buffer, std::size_t bufferSize);
+        void readAsync(std::byte* buffer, std::size_t bufferSize, const ReadCallback& readCallback);
+        void abort();
+        void stop();
+        bool finished() const { return _finished; }
+
+    private:
+        void openInput(const InputParameters& inputParameters, const OutputParameters& outputParameters);
+        void openDecoder(const AVStream* inputStream);
+        void openOutput(const OutputParameters& outputParameters);
+        void openEncoder(const OutputParameters& outputParameters, const OutputFormatInfo& formatInfo, AVStream* outputStream);
+        void release();
+
+        std::size_t read(std::byte* buffer, std::size_t bufferSize);
+
+        void processNextPacket();
+        void remux(AVPacket* packet);
+        void decode(const AVPacket* packet);
+        void resample(const AVFrame* frame);
+        void encodeBufferedSamples(bool flush);
+        void encode(const AVFrame* frame);
+        void finish();
+
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+        static int writeOutput(void* opaque, const std::uint8_t* buffer, int bufferSize);
+#else
+        static int writeOutput(void* opaque, std::uint8_t* buffer, int bufferSize);
+#endif
+
+        const std::size_t   _debugId;
+        const bool          _streamCopy; // no decoding/encoding, the packets are directly written in the output container
+
+        AVFormatContext*    _inputContext{};
+        std::int64_t        _copyStartDts{ AV_NOPTS_VALUE }; // stream copy, in input time base
+        std::optional<std::int64_t> _copyMaxDuration; // stream copy, in input time base
+        AVCodecContext*     _decoder{};
+        int                 _streamIndex{ -1 };
+        std::int64_t        _skipUntilPts{ AV_NOPTS_VALUE }; // exact seek
+        AVPacket*           _inputPacket{};
+        AVFrame*            _decodedFrame{};
+
+        SwrContext*         _resampler{};
+        AVFrame*            _resampledFrame{};
+        AVAudioFifo*        _fifo{};
+
+        AVCodecContext*     _encoder{};
+        int                 _encoderFrameSize{};
+        std::int64_t        _nextPts{};
+        std::optional<std::int64_t> _maxSampleCount; // output duration limit
+        AVFrame*            _encoderFrame{};
+        AVPacket*           _outputPacket{};
+        AVFormatContext*    _outputContext{};
+        AVIOContext*        _outputIOContext{};
+
+        std::vector<std::byte> _output;
+        std::size_t         _outputReadOffset{};
+        bool                _inputFinished{};
+        std::atomic<bool>   _finished{};
+
+        std::mutex          _mutex;
+        bool                _aborted{};
+    };
+
+    LibAvTranscoder::Context::Context(std::size_t debugId, const InputParameters& inputParameters, const OutputParameters& outputParameters)
+        : _debugId{ debugId }
+        , _streamCopy{ isStreamCopyPossible(inputParameters, outputParameters) }
+    {
+        try
+        {
+            openInput(inputParameters, outputParameters);
+            openOutput(outputParameters);
+        }
+        catch (...)
+        {
+            release();
+            throw;
+        }
+    }
+
+    LibAvTranscoder::Context::~Context()
+    {
+        release();
+    }
+
+    void LibAvTranscoder::Context::openInput(const InputParameters& inputParameters, const OutputParameters& outputParameters)
+    {
+        // start reading from the nearest known position, so that the demuxer does not have to look for it
+        std::chrono::milliseconds offset{ outputParameters.offset };
+#if LIBAVFORMAT_VERSION_MAJOR >= 59
+        const AVInputFormat* inputFormat{};
+#else
+        AVInputFormat* inputFormat{};
+#endif
+        AVDictionary* inputOptions{};
+        if (offset.count() > 0)
+        {
+            const std::optional<SeekTable> seekTable{ loadSeekTable(inputParameters.trackPath) };
+            if (const std::optional<SeekPoint> seekPoint{ seekTable ? findSeekPoint(*seekTable, offset) : std::nullopt })
+            {
+                inputFormat = av_find_input_format(seekTable->formatName.c_str());
+                if (inputFormat)
+                {
+                    LOG(DEBUG) << "Using seek point at " << seekPoint->timestamp.count() << " ms, offset " << seekPoint->byteOffset;
+
+                    av_dict_set_int(&inputOptions, "skip_initial_bytes", static_cast<std::int64_t>(seekPoint->byteOffset), 0);
+                    offset -= seekPoint->timestamp;
+                }
+            }
+        }
+
+        int error{ avformat_open_input(&_inputContext, inputParameters.trackPath.c_str(), inputFormat, &inputOptions) };
+        av_dict_free(&inputOptions);
+        if (error < 0)
+            throw LibAvException{ "Cannot open '" + inputParameters.trackPath.string() + "'", error };
+
+        error = avformat_find_stream_info(_inputContext, nullptr);
+        if (error < 0)
+            throw LibAvException{ "Cannot find stream info", error };
+
+        if (outputParameters.stream)
+            _streamIndex = static_cast<int>(*outputParameters.stream);
+        else
+            _streamIndex = av_find_best_stream(_inputContext, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+
+        if (_streamIndex < 0 || static_cast<unsigned>(_streamIndex) >= _inputContext->nb_streams
+            || _inputContext->streams[_streamIndex]->codecpar->codec_type != AVMEDIA_TYPE_AUDIO)
+        {
+            throw Exception{ "Cannot find audio stream to transcode" };
+        }
+
+        // do not demux streams we are not interested in (including covers)
+        for (unsigned i{}; i < _inputContext->nb_streams; ++i)
+        {
+            if (static_cast<int>(i) != _streamIndex)
+                _inputContext->streams[i]->discard = AVDISCARD_ALL;
+        }
+
+        const AVStream* inputStream{ _inputContext->streams[_streamIndex] };
+        if (_streamCopy)
+        {
+            LOG(DEBUG) << "Source codec is compatible, copying the audio stream";
+
+            if (outputParameters.duration)
+                _copyMaxDuration = av_rescale_q(outputParameters.duration->count(), AVRational{ 1, 1000 }, inputStream->time_base);
+        }
+        else
+        {
+            openDecoder(inputStream);
+        }
+
+        if (offset.count() > 0)
+        {
+            const std::int64_t timestamp{ av_rescale(offset.count(), AV_TIME_BASE, 1000) };
+            error = avformat_seek_file(_inputContext, -1, std::numeric_limits<std::int64_t>::min(), timestamp, timestamp, 0);
+            if (error < 0)
+                LOG(WARNING) << "Cannot seek to offset " << offset.count() << " ms: " << averror_to_string(error);
+            else if (!_streamCopy) // stream copies start on the packet boundary
+                _skipUntilPts = av_rescale_q(timestamp, AVRational{ 1, AV_TIME_BASE }, inputStream->time_base);
+        }
+
+        _inputPacket = av_packet_alloc();
+        if (!_inputPacket)
+            throw Exception{ "Cannot allocate demuxing buffers" };
+    }
+
+    void LibAvTranscoder::Context::openDecoder(const AVStream* inputStream)
+    {
+        const AVCodec* decoder{ avcodec_find_decoder(inputStream->codecpar->codec_id) };
+        if (!decoder)
+            throw Exception{ std::string{ "Cannot find decoder for codec " } + avcodec_get_name(inputStream->codecpar->codec_id) };
+
+        _decoder = avcodec_alloc_context3(decoder);
+        if (!_decoder)
+            throw Exception{ "Cannot allocate decoder" };
+
+        int error{ avcodec_parameters_to_context(_decoder, inputStream->codecpar) };
+        if (error < 0)
+            throw LibAvException{ "Cannot set decoder parameters", error };
+        _decoder->pkt_timebase = inputStream->time_base;
+
+        error = avcodec_open2(_decoder, decoder, nullptr);
+        if (error < 0)
+            throw LibAvException{ "Cannot open decoder", error };
+
+        _decodedFrame = av_frame_alloc();
+        if (!_decodedFrame)
+            throw Exception{ "Cannot allocate decoding buffers" };
+    }
+
+    void LibAvTranscoder::Context::openOutput(const OutputParameters& outputParameters)
+    {
+        const OutputFormatInfo formatInfo{ getOutputFormatInfo(outputParameters.format) };
+
+        int error{ avformat_alloc_output_context2(&_outputContext, nullptr, formatInfo.formatName, nullptr) };
+        if (error < 0)
+            throw LibAvException{ std::string{ "Cannot allocate output format '" } + formatInfo.formatName + "'", error };
+
+        AVStream* outputStream{ avformat_new_stream(_outputContext, nullptr) };
+        if (!outputStream)
+            throw Exception{ "Cannot allocate output stream" };
+
+        if (_streamCopy)
+        {
+            const AVStream* inputStream{ _inputContext->streams[_streamIndex] };
+
+            error = avcodec_parameters_copy(outputStream->codecpar, inputStream->codecpar);
+            if (error < 0)
+                throw LibAvException{ "Cannot copy stream parameters", error };
+            outputStream->codecpar->codec_tag = 0; // let the output container pick its own
+            outputStream->time_base = inputStream->time_base;
+        }
+        else
+        {
+            openEncoder(outputParameters, formatInfo, outputStream);
+        }
+
+        if (!outputParameters.stripMetadata)
+        {
+            av_dict_copy(&_outputContext->metadata, _inputContext->metadata, 0);
+            av_dict_copy(&outputStream->metadata, _inputContext->streams[_streamIndex]->metadata, 0);
+        }
+
+        constexpr int outputBufferSize{ 65'536 };
+        unsigned char* outputBuffer{ static_cast<unsigned char*>(av_malloc(outputBufferSize)) };
+        if (!outputBuffer)
+            throw Exception{ "Cannot allocate output buffer" };
+
+        _outputIOContext = avio_alloc_context(outputBuffer, outputBufferSize, 1 /* write */, this, nullptr, &Context::writeOutput, nullptr);
+        if (!_outputIOContext)
+        {
+            av_free(outputBuffer);
+            throw Exception{ "Cannot allocate output context" };
+        }
+        _outputContext->pb = _outputIOContext;
+        _outputContext->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+        error = avformat_write_header(_outputContext, nullptr);
+        if (error < 0)
+            throw LibAvException{ "Cannot write header", error };
+    }
+
+    void LibAvTranscoder::Context::openEncoder(const OutputParameters& outputParameters, const OutputFormatInfo& formatInfo, AVStream* outputStream)
+    {
+        const AVCodec* encoder{ avcodec_find_encoder_by_name(formatInfo.encoderName) };
+        if (!encoder)
+            throw Exception{ std::string{ "Cannot find encoder '" } + formatInfo.encoderName + "'" };
+
+        _encoder = avcodec_alloc_context3(encoder);
+        if (!_encoder)
+            throw Exception{ "Cannot allocate encoder" };
+
+        _encoder->bit_rate = outputParameters.bitrate;
+        _encoder->sample_rate = selectSampleRate(encoder, _decoder->sample_rate);
+        _encoder->sample_fmt = encoder->sample_fmts ? encoder->sample_fmts[0] : AV_SAMPLE_FMT_FLTP;
+        _encoder->time_base = AVRational{ 1, _encoder->sample_rate };
+        // downmix to stereo at most, supported by all the encoders
+#if LMS_AV_HAS_CH_LAYOUT
+        av_channel_layout_default(&_encoder->ch_layout, std::clamp(_decoder->ch_layout.nb_channels, 1, 2));
+#else
+        _encoder->channels = std::clamp(_decoder->channels, 1, 2);
+        _encoder->channel_layout = av_get_default_channel_layout(_encoder->channels);
+#endif
+        if (_outputContext->oformat->flags & AVFMT_GLOBALHEADER)
+            _encoder->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+        int error{ avcodec_open2(_encoder, encoder, nullptr) };
+        if (error < 0)
+            throw LibAvException{ "Cannot open encoder", error };
+
+        if (outputParameters.duration)
+            _maxSampleCount = av_rescale(outputParameters.duration->count(), _encoder->sample_rate, 1000);
+
+        _encoderFrameSize = (encoder->capabilities & AV_CODEC_CAP_VARIABLE_FRAME_SIZE) || _encoder->frame_size <= 0 ? 4096 : _encoder->frame_size;
+
+        error = avcodec_parameters_from_context(outputStream->codecpar, _encoder);
+        if (error < 0)
+            throw LibAvException{ "Cannot set output stream parameters", error };
+        outputStream->time_base = _encoder->time_base;
+
+        _resampler = swr_alloc(); // configured using the first decoded frame
+        _resampledFrame = av_frame_alloc();
+        _encoderFrame = av_frame_alloc();
+        _outputPacket = av_packet_alloc();
+#if LMS_AV_HAS_CH_LAYOUT
+        _fifo = av_audio_fifo_alloc(_encoder->sample_fmt, _encoder->ch_layout.nb_channels, _encoderFrameSize * 2);
+#else
+        _fifo = av_audio_fifo_alloc(_encoder->sample_fmt, _encoder->channels, _encoderFrameSize * 2);
+#endif
+        if (!_resampler || !_resampledFrame || !_encoderFrame || !_outputPacket || !_fifo)
+            throw Exception{ "Cannot allocate encoding buffers" };
+    }
+
+    void LibAvTranscoder::Context::release()
+    {
+        av_packet_free(&_inputPacket);
+        av_packet_free(&_outputPacket);
+        av_frame_free(&_decodedFrame);
+        av_frame_free(&_resampledFrame);
+        av_frame_free(&_encoderFrame);
+        if (_fifo)
+        {
+            av_audio_fifo_free(_fifo);
+            _fifo = nullptr;
+        }
+        swr_free(&_resampler);
+        avcodec_free_context(&_encoder);
+        avcodec_free_context(&_decoder);
+        if (_outputContext)
+        {
+            avformat_free_context(_outputContext);
+            _outputContext = nullptr;
+        }
+        if (_outputIOContext)
+        {
+            av_freep(&_outputIOContext->buffer);
+            avio_context_free(&_outputIOContext);
+        }
+        avformat_close_input(&_inputContext);
+    }
+
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+    int LibAvTranscoder::Context::writeOutput(void* opaque, const std::uint8_t* buffer, int bufferSize)
+#else
+    int LibAvTranscoder::Context::writeOutput(void* opaque, std::uint8_t* buffer, int bufferSize)
+#endif
+    {
+        Context& context{ *static_cast<Context*>(opaque) };
+
+        const std::byte* data{ reinterpret_cast<const std::byte*>(buffer) };
+        context._output.insert(std::end(context._output), data, data + bufferSize);
+
+        return bufferSize;
+    }
+
+    std::size_t LibAvTranscoder::Context::read(std::byte* buffer, std::size_t bufferSize)
+    {
+        try
+        {
+            while (!_inputFinished && _output.size() - _outputReadOffset < bufferSize)
+                processNextPacket();
+        }
+        catch (const Exception& e)
+        {
+            LOG(ERROR) << "Transcoding failed: " << e.what();
+            _inputFinished = true;
+        }
+
+        const std::size_t readSize{ std::min(bufferSize, _output.size() - _outputReadOffset) };
+        std::memcpy(buffer, _output.data() + _outputReadOffset, readSize);
+        _outputReadOffset += readSize;
+
+        // reuse the output buffer once everything has been consumed
+        if (_outputReadOffset == _output.size())
+        {
+            _output.clear();
+            _outputReadOffset = 0;
+            if (_inputFinished)
+                _finished = true;
+        }
+
+        return readSize;
+    }
+
+    std::size_t LibAvTranscoder::Context::readSome(std::byte* buffer, std::size_t bufferSize)
+    {
+        const std::scoped_lock lock{ _mutex };
+        return read(buffer, bufferSize);
+    }
+
+    void LibAvTranscoder::Context::readAsync(std::byte* buffer, std::size_t bufferSize, const ReadCallback& readCallback)
+    {
+        const std::scoped_lock lock{ _mutex };
+
+        // the buffer belongs to the transcoder owner, that may already be gone
+        if (_aborted)
+            return;
+
+        const std::size_t readSize{ read(buffer, bufferSize) };
+        readCallback(readSize);
+    }
+
+    void LibAvTranscoder::Context::abort()
+    {
+        const std::scoped_lock lock{ _mutex };
+        _aborted = true;
+    }
+
+    void LibAvTranscoder::Context::stop()
+    {
+        const std::scoped_lock lock{ _mutex };
+
+        LOG(DEBUG) << "Stopping transcoder";
+
+        // what has not been read yet is dropped
+        release();
+        _output.clear();
+        _outputReadOffset = 0;
+        _inputFinished = true;
+        _finished = true;
+    }
+
+    void LibAvTranscoder::Context::processNextPacket()
+    {
+        if (_maxSampleCount && _nextPts >= *_maxSampleCount)
+        {
+            finish();
+            return;
+        }
+
+        const int error{ av_read_frame(_inputContext, _inputPacket) };
+        if (error == AVERROR_EOF)
+        {
+            finish();
+            return;
+        }
+        if (error < 0)
+            throw LibAvException{ "Cannot read input", error };
+
+        if (_inputPacket->stream_index == _streamIndex)
+        {
+            if (_streamCopy)
+                remux(_inputPacket);
+            else
+                decode(_inputPacket);
+        }
+
+        av_packet_unref(_inputPacket);
+    }
+
+    void LibAvTranscoder::Context::remux(AVPacket* packet)
+    {
+        if (packet->dts == AV_NOPTS_VALUE)
+            packet->dts = packet->pts;
+
+        // output timestamps start at zero, as ffmpeg does
+        if (_copyStartDts == AV_NOPTS_VALUE)
+            _copyStartDts = packet->dts != AV_NOPTS_VALUE ? packet->dts : 0;
+
+        if (packet->dts != AV_NOPTS_VALUE)
+            packet->dts -= _copyStartDts;
+        if (packet->pts != AV_NOPTS_VALUE)
+            packet->pts -= _copyStartDts;
+
+        if (_copyMaxDuration && packet->dts != AV_NOPTS_VALUE && packet->dts >= *_copyMaxDuration)
+        {
+            finish();
+            return;
+        }
+
+        av_packet_rescale_ts(packet, _inputContext->streams[_streamIndex]->time_base, _outputContext->streams[0]->time_base);
+        packet->stream_index = 0;
+        packet->pos = -1;
+
+        // takes ownership of the packet data
+        const int error{ av_interleaved_write_frame(_outputContext, packet) };
+        if (error < 0)
+            throw LibAvException{ "Cannot write packet", error };
+    }
+
+    void LibAvTranscoder::Context::decode(const AVPacket* packet)
+    {
+        int error{ avcodec_send_packet(_decoder, packet) };
+        if (error < 0 && packet)
+        {
+            // just skip corrupted packets
+            LOG(DEBUG) << "Cannot decode packet: " << averror_to_string(error);
+            return;
+        }
+
+        while ((error = avcodec_receive_frame(_decoder, _decodedFrame)) >= 0)
+        {
+            const bool skipFrame{ _skipUntilPts != AV_NOPTS_VALUE && _decodedFrame->best_effort_timestamp != AV_NOPTS_VALUE && _decodedFrame->best_effort_timestamp < _skipUntilPts };
+            if (!skipFrame)
+            {
+#if !LMS_AV_HAS_CH_LAYOUT
+                if (!_decodedFrame->channel_layout)
+                    _decodedFrame->channel_layout = av_get_default_channel_layout(_decodedFrame->channels);
+#endif
+                resample(_decodedFrame);
+            }
+
+            av_frame_unref(_decodedFrame);
+        }
+
+        if (error != AVERROR(EAGAIN) && error != AVERROR_EOF)
+            throw LibAvException{ "Cannot decode frame", error };
+    }
+
+    void LibAvTranscoder::Context::resample(const AVFrame* frame)
+    {
+        // nothing to flush
+        if (!frame && !swr_is_initialized(_resampler))
+            return;
+
+        av_frame_unref(_resampledFrame);
+        setFrameParameters(_resampledFrame, _encoder);
+
+        const int error{ swr_convert_frame(_resampler, _resampledFrame, frame) };
+        if (error < 0)
+            throw LibAvException{ "Cannot resample frame", error };
+
+        if (_resampledFrame->nb_samples > 0)
+        {
+            if (av_audio_fifo_write(_fifo, reinterpret_cast<void**>(_resampledFrame->extended_data), _resampledFrame->nb_samples) < _resampledFrame->nb_samples)
+                throw Exception{ "Cannot buffer resampled frame" };
+        }
+
+        encodeBufferedSamples(false);
+    }
+
+    void LibAvTranscoder::Context::encodeBufferedSamples(bool flush)
+    {
+        while (av_audio_fifo_size(_fifo) >= _encoderFrameSize || (flush && av_audio_fifo_size(_fifo) > 0))
+        {
+            int sampleCount{ std::min(av_audio_fifo_size(_fifo), _encoderFrameSize) };
+            if (_maxSampleCount)
+            {
+                if (_nextPts >= *_maxSampleCount)
+                {
+                    av_audio_fifo_reset(_fifo);
+                    return;
+                }
+                sampleCount = static_cast<int>(std::min<std::int64_t>(sampleCount, *_maxSampleCount - _nextPts));
+            }
+
+            av_frame_unref(_encoderFrame);
+            setFrameParameters(_encoderFrame, _encoder);
+            _encoderFrame->nb_samples = sampleCount;
+
+            int error{ av_frame_get_buffer(_encoderFrame, 0) };
+            if (error < 0)
+                throw LibAvException{ "Cannot allocate frame", error };
+
+            if (av_audio_fifo_read(_fifo, reinterpret_cast<void**>(_encoderFrame->extended_data), sampleCount) < sampleCount)
+                throw Exception{ "Cannot read buffered samples" };
+
+            _encoderFrame->pts = _nextPts;
+            _nextPts += sampleCount;
+
+            encode(_encoderFrame);
+        }
+    }
+
+    void LibAvTranscoder::Context::encode(const AVFrame* frame)
+    {
+        int error{ avcodec_send_frame(_encoder, frame) };
+        if (error < 0)
+            throw LibAvException{ "Cannot encode frame", error };
+
+        while ((error = avcodec_receive_packet(_encoder, _outputPacket)) >= 0)
+        {
+            av_packet_rescale_ts(_outputPacket, _encoder->time_base, _outputContext->streams[0]->time_base);
+            _outputPacket->stream_index = 0;
+
+            // takes ownership of the packet data
+            error = av_interleaved_write_frame(_outputContext, _outputPacket);
+            if (error < 0)
+                throw LibAvException{ "Cannot write packet", error };
+        }
+
+        if (error != AVERROR(EAGAIN) && error != AVERROR_EOF)
+            throw LibAvException{ "Cannot receive encoded packet", error };
+    }
+
+    void LibAvTranscoder::Context::finish()
+    {
+        _inputFinished = true;
+
+        // flush all the stages
+        if (!_streamCopy)
+        {
+            decode(nullptr);
+            resample(nullptr);
+            encodeBufferedSamples(true);
+            encode(nullptr);
+        }
+
+        const int error{ av_write_trailer(_outputContext) };
+        if (error < 0)
+            throw LibAvException{ "Cannot write trailer", error };
+
+        avio_flush(_outputIOContext);
+    }
+
+    LibAvTranscoder::LibAvTranscoder(const InputParameters& inputParameters, const OutputParameters& outputParameters)
+        : _debugId{ globalId++ }
+        , _inputParameters{ inputParameters }
+        , _outputParameters{ outputParameters }
+        , _outputMimeType{ toMimetype(outputParameters.format) }
+    {
+        LOG(INFO) << "Transcoding file '" << _inputParameters.trackPath.string() << "'";
+
+        _context = std::make_shared<Context>(_debugId, _inputParameters, _outputParameters);
+    }
+
+    LibAvTranscoder::~LibAvTranscoder()
+    {
+        // pending reads may still reference the context, but must not touch the caller's buffer anymore
+        _context->abort();
+    }
+
+    void LibAvTranscoder::asyncRead(std::byte* buffer, std::size_t bufferSize, ReadCallback readCallback)
+    {
+        // may have been stopped meanwhile by another thread, the read then completes with no data
+        boost::asio::post(getIOContext(), [context = _context, buffer, bufferSize, readCallback = std::move(readCallback)]
+            {
+                context->readAsync(buffer, bufferSize, readCallback);
+            });
+    }
+
+    std::size_t LibAvTranscoder::readSome(std::byte* buffer, std::size_t bufferSize)
+    {
+        return _context->readSome(buffer, bufferSize);
+    }
+
+    bool LibAvTranscoder::finished() const
+    {
+        return _context->finished();
+    }
+
+    void LibAvTranscoder::stop()
+    {
+        _context->stop();
+    }
+
+} // namespace Av::Transcoding
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "av/TranscodingParameters.hpp"
+#include "av/Types.hpp"
+#include "ITranscoder.hpp"
+
+namespace Av::Transcoding
+{
+    // Transcodes in-process using libavformat/libavcodec, the work being done in a dedicated thread pool
+    class LibAvTranscoder final : public ITranscoder
+    {
+    public:
+        LibAvTranscoder(const InputParameters& inputParameters, const OutputParameters& outputParameters);
+        ~LibAvTranscoder() override;
+
+        LibAvTranscoder(const LibAvTranscoder&) = delete;
+        LibAvTranscoder& operator=(const LibAvTranscoder&) = delete;
+        LibAvTranscoder(LibAvTranscoder&&) = delete;
+        LibAvTranscoder& operator=(LibAvTranscoder&&) = delete;
+
+        void            asyncRead(std::byte* buffer, std::size_t bufferSize, ReadCallback) override;
+        std::size_t     readSome(std::byte* buffer, std::size_t bufferSize) override;
+
+        const std::string& getOutputMimeType() const override { return _outputMimeType; }
+        const OutputParameters& getOutputParameters() const override { return _outputParameters; }
+
+        bool            finished() const override;
+
+        void            stop() override;
+        std::size_t     getDebugId() const override { return _debugId; }
+
+    private:
+        class Context;
+
+        const std::size_t           _debugId{};
+        const InputParameters       _inputParameters;
+        const OutputParameters      _outputParameters;
+        std::string                 _outputMimeType;
+
+        // shared with the pending reads
+        std::shared_ptr<Context>    _context;
+    };
+
+} // namespace Av::Transcoding
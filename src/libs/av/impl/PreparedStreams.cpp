@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "PreparedStreams.hpp"
+
+#include <algorithm>
+
+#include "utils/IConfig.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Service.hpp"
+#include "TranscodingAdmission.hpp"
+#include "TranscodingResourceHandler.hpp"
+
+namespace Av::Transcoding
+{
+    PreparedStreams& PreparedStreams::getInstance()
+    {
+        // prepared streams hold admission slots, make sure the admission outlives them
+        TranscodingAdmission::getInstance();
+
+        static PreparedStreams preparedStreams{ std::chrono::seconds{ Service<IConfig>::get()->getULong("transcoding-prepared-stream-timeout", 30) } };
+        return preparedStreams;
+    }
+
+    PreparedStreams::PreparedStreams(std::chrono::seconds timeout)
+        : _timeout{ timeout }
+        , _ioContextRunner{ _ioContext, 1 }
+    {
+    }
+
+    PreparedStreams::~PreparedStreams() = default;
+
+    bool PreparedStreams::Key::operator==(const Key& other) const
+    {
+        return owner == other.owner
+            && trackPath == other.trackPath
+            && format == other.format
+            && bitrate == other.bitrate
+            && stream == other.stream
+            && offset == other.offset
+            && duration == other.duration
+            && stripMetadata == other.stripMetadata
+            && estimateContentLength == other.estimateContentLength;
+    }
+
+    PreparedStreams::Key PreparedStreams::createKey(const InputParameters& inputParameters, const OutputParameters& outputParameters, bool estimateContentLength, std::string_view owner)
+    {
+        Key key{};
+        key.owner = owner;
+        key.trackPath = inputParameters.trackPath;
+        key.format = outputParameters.format;
+        key.bitrate = outputParameters.bitrate;
+        key.stream = outputParameters.stream;
+        key.offset = outputParameters.offset;
+        key.duration = outputParameters.duration;
+        key.stripMetadata = outputParameters.stripMetadata;
+        key.estimateContentLength = estimateContentLength;
+
+        return key;
+    }
+
+    void PreparedStreams::add(const Key& key, std::unique_ptr<TranscodingResourceHandler> resourceHandler)
+    {
+        std::unique_ptr<TranscodingResourceHandler> replacedResourceHandler;
+        {
+            const std::scoped_lock lock{ _mutex };
+
+            auto itEntry{ std::find_if(std::begin(_entries), std::end(_entries), [&](const Entry& entry) { return entry.key.owner == key.owner; }) };
+            if (itEntry != std::end(_entries))
+            {
+                LMS_LOG(TRANSCODING, DEBUG) << "Replacing prepared stream for '" << key.owner << "'";
+                replacedResourceHandler = std::move(itEntry->resourceHandler);
+                _entries.erase(itEntry);
+            }
+
+            Entry& entry{ _entries.emplace_back(Entry{ _nextId++, key, std::move(resourceHandler), boost::asio::steady_timer{ _ioContext } }) };
+            entry.timer.expires_after(_timeout);
+            entry.timer.async_wait([this, id = entry.id](const boost::system::error_code& ec)
+                {
+                    if (ec)
+                        return;
+
+                    onTimeout(id);
+                });
+        }
+
+        LMS_LOG(TRANSCODING, DEBUG) << "Prepared stream for '" << key.owner << "', file '" << key.trackPath.string() << "'";
+    }
+
+    std::unique_ptr<TranscodingResourceHandler> PreparedStreams::take(const Key& key)
+    {
+        const std::scoped_lock lock{ _mutex };
+
+        auto itEntry{ std::find_if(std::begin(_entries), std::end(_entries), [&](const Entry& entry) { return entry.key == key; }) };
+        if (itEntry == std::end(_entries))
+            return {};
+
+        LMS_LOG(TRANSCODING, DEBUG) << "Using prepared stream for '" << key.owner << "', file '" << key.trackPath.string() << "'";
+
+        std::unique_ptr<TranscodingResourceHandler> resourceHandler{ std::move(itEntry->resourceHandler) };
+        _entries.erase(itEntry); // cancels the timer
+        return resourceHandler;
+    }
+
+    std::size_t PreparedStreams::getCount() const
+    {
+        const std::scoped_lock lock{ _mutex };
+        return _entries.size();
+    }
+
+    void PreparedStreams::onTimeout(std::size_t id)
+    {
+        std::unique_ptr<TranscodingResourceHandler> expiredResourceHandler;
+        {
+            const std::scoped_lock lock{ _mutex };
+
+            auto itEntry{ std::find_if(std::begin(_entries), std::end(_entries), [=](const Entry& entry) { return entry.id == id; }) };
+            if (itEntry == std::end(_entries))
+                return;
+
+            LMS_LOG(TRANSCODING, DEBUG) << "Cancelling unused prepared stream for '" << itEntry->key.owner << "', file '" << itEntry->key.trackPath.string() << "'";
+            expiredResourceHandler = std::move(itEntry->resourceHandler);
+            _entries.erase(itEntry);
+        }
+    }
+} // namespace Av::Transcoding
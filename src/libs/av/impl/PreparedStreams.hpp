@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include "av/TranscodingParameters.hpp"
+#include "utils/IOContextRunner.hpp"
+
+namespace Av::Transcoding
+{
+    class TranscodingResourceHandler;
+
+    // Streams started ahead of time (next track of a play queue, etc.), waiting for the actual request
+    // At most one per owner, cancelled if not requested in time
+    class PreparedStreams
+    {
+    public:
+        static PreparedStreams& getInstance();
+
+        PreparedStreams(std::chrono::seconds timeout);
+        ~PreparedStreams();
+
+        PreparedStreams(const PreparedStreams&) = delete;
+        PreparedStreams& operator=(const PreparedStreams&) = delete;
+
+        struct Key
+        {
+            std::string owner;
+            std::filesystem::path trackPath;
+            OutputFormat format;
+            std::size_t bitrate{};
+            std::optional<std::size_t> stream;
+            std::chrono::milliseconds offset{};
+            std::optional<std::chrono::milliseconds> duration;
+            bool stripMetadata{};
+            bool estimateContentLength{};
+
+            bool operator==(const Key& other) const;
+        };
+        static Key createKey(const InputParameters& inputParameters, const OutputParameters& outputParameters, bool estimateContentLength, std::string_view owner);
+
+        // replaces the stream previously prepared for the same owner
+        void add(const Key& key, std::unique_ptr<TranscodingResourceHandler> resourceHandler);
+        std::unique_ptr<TranscodingResourceHandler> take(const Key& key);
+
+        std::size_t getCount() const;
+
+    private:
+        struct Entry
+        {
+            std::size_t id{};
+            Key key;
+            std::unique_ptr<TranscodingResourceHandler> resourceHandler;
+            boost::asio::steady_timer timer;
+        };
+
+        void onTimeout(std::size_t id);
+
+        const std::chrono::seconds _timeout;
+
+        boost::asio::io_context _ioContext;
+
+        mutable std::mutex _mutex;
+        std::list<Entry> _entries;
+        std::size_t _nextId{};
+
+        // last, so that no timer callback is running while the entries are destroyed
+        IOContextRunner _ioContextRunner;
+    };
+} // namespace Av::Transcoding
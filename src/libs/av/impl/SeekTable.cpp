@@ -0,0 +1,254 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "av/SeekTable.hpp"
+
+extern "C"
+{
+#define __STDC_CONSTANT_MACROS
+#include <libavformat/avformat.h>
+#include <libavutil/error.h>
+}
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+
+#include "utils/IConfig.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Service.hpp"
+
+namespace Av
+{
+    namespace
+    {
+        std::string averror_to_string(int error)
+        {
+            std::array<char, 128> buf = { 0 };
+
+            if (::av_strerror(error, buf.data(), buf.size()) == 0)
+                return &buf[0];
+            else
+                return "Unknown error";
+        }
+
+        // demuxers that resync on the next frame when reading from any byte offset
+        bool isFormatSupported(std::string_view formatName)
+        {
+            return formatName == "mp3" || formatName == "aac";
+        }
+
+        const std::filesystem::path& getSeekTableDirectory()
+        {
+            static const std::filesystem::path directory{ Service<IConfig>::get()->getPath("working-dir") / "cache" / "seek-tables" };
+            return directory;
+        }
+
+        std::filesystem::path getSeekTablePath(const std::filesystem::path& trackPath)
+        {
+            const std::size_t hash{ std::hash<std::string>{}(trackPath.string()) };
+
+            std::ostringstream subDirectoryName;
+            subDirectoryName << std::hex << std::setw(2) << std::setfill('0') << (hash & 0xFF);
+
+            std::ostringstream fileName;
+            fileName << std::hex << std::setw(16) << std::setfill('0') << hash << ".txt";
+
+            return getSeekTableDirectory() / subDirectoryName.str() / fileName.str();
+        }
+
+        std::optional<long long> getLastWriteTime(const std::filesystem::path& trackPath)
+        {
+            std::error_code ec;
+            const std::filesystem::file_time_type lastWriteTime{ std::filesystem::last_write_time(trackPath, ec) };
+            if (ec)
+                return std::nullopt;
+
+            return static_cast<long long>(lastWriteTime.time_since_epoch().count());
+        }
+
+        // the first line is "<track last write time> <format name or '-'>", then one "<timestamp in ms> <byte offset>" line per seek point
+        std::optional<SeekTable> readSeekTable(const std::filesystem::path& trackPath, bool readPoints)
+        {
+            const std::optional<long long> lastWriteTime{ getLastWriteTime(trackPath) };
+            if (!lastWriteTime)
+                return std::nullopt;
+
+            std::ifstream ifs{ getSeekTablePath(trackPath) };
+            if (!ifs)
+                return std::nullopt;
+
+            long long storedLastWriteTime{};
+            std::string formatName;
+            if (!(ifs >> storedLastWriteTime >> formatName) || storedLastWriteTime != *lastWriteTime)
+                return std::nullopt;
+
+            SeekTable seekTable;
+            if (formatName != "-")
+                seekTable.formatName = formatName;
+
+            if (readPoints)
+            {
+                long long timestamp{};
+                std::uint64_t byteOffset{};
+                while (ifs >> timestamp >> byteOffset)
+                    seekTable.points.push_back(SeekPoint{ std::chrono::milliseconds{ timestamp }, byteOffset });
+            }
+
+            return seekTable;
+        }
+    }
+
+    bool isSeekTableSupported(std::string_view codecName)
+    {
+        return codecName == "mp3" || codecName == "aac";
+    }
+
+    SeekTable computeSeekTable(const std::filesystem::path& trackPath, std::chrono::milliseconds interval)
+    {
+        AVFormatContext* context{};
+        int error{ avformat_open_input(&context, trackPath.c_str(), nullptr, nullptr) };
+        if (error < 0)
+            throw Exception{ "Cannot open '" + trackPath.string() + "': " + averror_to_string(error) };
+
+        SeekTable seekTable;
+        try
+        {
+            if (!isFormatSupported(context->iformat->name))
+            {
+                avformat_close_input(&context);
+                return seekTable;
+            }
+
+            error = avformat_find_stream_info(context, nullptr);
+            if (error < 0)
+                throw Exception{ "Cannot find stream info: " + averror_to_string(error) };
+
+            const int streamIndex{ av_find_best_stream(context, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0) };
+            if (streamIndex < 0)
+                throw Exception{ "Cannot find audio stream" };
+
+            for (unsigned i{}; i < context->nb_streams; ++i)
+            {
+                if (static_cast<int>(i) != streamIndex)
+                    context->streams[i]->discard = AVDISCARD_ALL;
+            }
+
+            const AVRational timeBase{ context->streams[streamIndex]->time_base };
+
+            AVPacket* packet{ av_packet_alloc() };
+            if (!packet)
+                throw Exception{ "Cannot allocate packet" };
+
+            std::chrono::milliseconds nextTimestamp{ interval };
+            while ((error = av_read_frame(context, packet)) >= 0)
+            {
+                const std::int64_t pts{ packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts };
+                if (packet->stream_index == streamIndex && pts != AV_NOPTS_VALUE && packet->pos >= 0)
+                {
+                    const std::chrono::milliseconds timestamp{ av_rescale_q(pts, timeBase, AVRational{ 1, 1000 }) };
+                    if (timestamp >= nextTimestamp)
+                    {
+                        seekTable.points.push_back(SeekPoint{ timestamp, static_cast<std::uint64_t>(packet->pos) });
+                        nextTimestamp = timestamp + interval;
+                    }
+                }
+
+                av_packet_unref(packet);
+            }
+            av_packet_free(&packet);
+
+            if (error != AVERROR_EOF)
+                throw Exception{ "Cannot read input: " + averror_to_string(error) };
+
+            seekTable.formatName = context->iformat->name;
+        }
+        catch (...)
+        {
+            avformat_close_input(&context);
+            throw;
+        }
+
+        avformat_close_input(&context);
+
+        return seekTable;
+    }
+
+    void storeSeekTable(const std::filesystem::path& trackPath, const SeekTable& seekTable)
+    {
+        const std::optional<long long> lastWriteTime{ getLastWriteTime(trackPath) };
+        if (!lastWriteTime)
+            return;
+
+        const std::filesystem::path seekTablePath{ getSeekTablePath(trackPath) };
+
+        std::error_code ec;
+        std::filesystem::create_directories(seekTablePath.parent_path(), ec);
+        if (ec)
+        {
+            LMS_LOG(AV, ERROR) << "Cannot create seek table directory '" << seekTablePath.parent_path().string() << "': " << ec.message();
+            return;
+        }
+
+        // written aside first: transcoders may be reading the previous version
+        std::filesystem::path tmpPath{ seekTablePath };
+        tmpPath += ".tmp";
+        {
+            std::ofstream ofs{ tmpPath, std::ios::trunc };
+            ofs << *lastWriteTime << ' ' << (seekTable.formatName.empty() ? "-" : seekTable.formatName) << '\n';
+            for (const SeekPoint& point : seekTable.points)
+                ofs << point.timestamp.count() << ' ' << point.byteOffset << '\n';
+
+            if (!ofs)
+            {
+                LMS_LOG(AV, ERROR) << "Cannot write seek table '" << tmpPath.string() << "'";
+                return;
+            }
+        }
+
+        std::filesystem::rename(tmpPath, seekTablePath, ec);
+        if (ec)
+            LMS_LOG(AV, ERROR) << "Cannot write seek table '" << seekTablePath.string() << "': " << ec.message();
+    }
+
+    bool hasSeekTable(const std::filesystem::path& trackPath)
+    {
+        return readSeekTable(trackPath, false).has_value();
+    }
+
+    std::optional<SeekTable> loadSeekTable(const std::filesystem::path& trackPath)
+    {
+        return readSeekTable(trackPath, true);
+    }
+
+    std::optional<SeekPoint> findSeekPoint(const SeekTable& seekTable, std::chrono::milliseconds offset)
+    {
+        if (seekTable.formatName.empty())
+            return std::nullopt;
+
+        auto it{ std::upper_bound(std::cbegin(seekTable.points), std::cend(seekTable.points), offset, [](std::chrono::milliseconds offset, const SeekPoint& point) { return offset < point.timestamp; }) };
+        if (it == std::cbegin(seekTable.points))
+            return std::nullopt;
+
+        return *std::prev(it);
+    }
+}
@@ -0,0 +1,306 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "TranscodeCache.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#include "utils/IConfig.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Service.hpp"
+#include "ITranscoder.hpp"
+
+namespace Av::Transcoding
+{
+    namespace
+    {
+        // temporary files are named "<entry><tmpExtensionPrefix><counter>"
+        constexpr std::string_view tmpExtensionPrefix{ ".tmp" };
+    }
+
+    TranscodeCache* TranscodeCache::getInstance()
+    {
+        static const std::unique_ptr<TranscodeCache> instance{ []() -> std::unique_ptr<TranscodeCache>
+            {
+                const std::size_t maxSize{ Service<IConfig>::get()->getULong("transcode-cache-max-size", 0) * 1024 * 1024 };
+                if (maxSize == 0)
+                    return {};
+
+                return std::make_unique<TranscodeCache>(Service<IConfig>::get()->getPath("working-dir") / "cache" / "transcode", maxSize);
+            }() };
+
+        return instance.get();
+    }
+
+    TranscodeCache::TranscodeCache(const std::filesystem::path& directory, std::size_t maxSize)
+        : _directory{ directory }
+        , _maxSize{ maxSize }
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(_directory, ec);
+        if (ec)
+            LMS_LOG(TRANSCODING, ERROR) << "Cannot create transcode cache directory '" << _directory.string() << "': " << ec.message();
+
+        LMS_LOG(TRANSCODING, INFO) << "Transcode cache directory = '" << _directory.string() << "', max size = " << _maxSize;
+
+        // compute the current size (and enforce the limit if it has been lowered)
+        // no transcode can be in progress yet: temporary files are leftovers of a previous run
+        evictEntries(true);
+    }
+
+    std::optional<std::filesystem::path> TranscodeCache::getEntry(const InputParameters& inputParameters, const OutputParameters& outputParameters)
+    {
+        if (!isCacheable(outputParameters))
+            return std::nullopt;
+
+        const std::optional<std::filesystem::path> entryPath{ getEntryPath(inputParameters, outputParameters) };
+        if (!entryPath)
+            return std::nullopt;
+
+        std::error_code ec;
+        if (!std::filesystem::is_regular_file(*entryPath, ec))
+            return std::nullopt;
+
+        // the modification time is used to find the least recently used entries
+        std::filesystem::last_write_time(*entryPath, std::filesystem::file_time_type::clock::now(), ec);
+
+        LMS_LOG(TRANSCODING, DEBUG) << "Serving '" << inputParameters.trackPath.string() << "' from transcode cache entry '" << entryPath->string() << "'";
+        return entryPath;
+    }
+
+    std::unique_ptr<TranscodeCache::EntryWriter> TranscodeCache::createEntryWriter(const InputParameters& inputParameters, const OutputParameters& outputParameters)
+    {
+        if (!isCacheable(outputParameters))
+            return {};
+
+        const std::optional<std::filesystem::path> entryPath{ getEntryPath(inputParameters, outputParameters) };
+        if (!entryPath)
+            return {};
+
+        std::error_code ec;
+        std::filesystem::create_directories(entryPath->parent_path(), ec);
+        if (ec)
+        {
+            LMS_LOG(TRANSCODING, ERROR) << "Cannot create transcode cache directory '" << entryPath->parent_path().string() << "': " << ec.message();
+            return {};
+        }
+
+        // reject truncated outputs (ffmpeg killed or failing midway): expect at least half of the nominal size
+        std::chrono::milliseconds expectedDuration{ std::max(std::chrono::duration_cast<std::chrono::milliseconds>(inputParameters.duration) - outputParameters.offset, std::chrono::milliseconds{ 0 }) };
+        if (outputParameters.duration)
+            expectedDuration = std::min(expectedDuration, *outputParameters.duration);
+        const std::size_t minExpectedSize{ getOutputBitrate(inputParameters, outputParameters) / 8 * static_cast<std::size_t>(expectedDuration.count()) / 1000 / 2 };
+
+        return std::make_unique<EntryWriter>(*this, *entryPath, minExpectedSize);
+    }
+
+    std::optional<std::filesystem::path> TranscodeCache::getEntryPath(const InputParameters& inputParameters, const OutputParameters& outputParameters) const
+    {
+        std::error_code ec;
+        const std::filesystem::file_time_type lastWriteTime{ std::filesystem::last_write_time(inputParameters.trackPath, ec) };
+        if (ec)
+            return std::nullopt;
+
+        // the track modification time is part of the key so that stale entries are never served (they will be evicted over time)
+        std::ostringstream key;
+        key << inputParameters.trackPath.string()
+            << '|' << lastWriteTime.time_since_epoch().count()
+            << '|' << static_cast<int>(outputParameters.format)
+            << '|' << outputParameters.bitrate
+            << '|' << (outputParameters.stream ? static_cast<long long>(*outputParameters.stream) : -1)
+            << '|' << outputParameters.stripMetadata
+            << '|' << outputParameters.offset.count()
+            << '|' << (outputParameters.duration ? outputParameters.duration->count() : -1);
+
+        const std::size_t hash{ std::hash<std::string>{}(key.str()) };
+
+        std::ostringstream subDirectoryName;
+        subDirectoryName << std::hex << std::setw(2) << std::setfill('0') << (hash & 0xFF);
+
+        std::ostringstream fileName;
+        fileName << std::hex << std::setw(16) << std::setfill('0') << hash << ".bin";
+
+        return _directory / subDirectoryName.str() / fileName.str();
+    }
+
+    void TranscodeCache::onEntryAdded(std::size_t size)
+    {
+        const std::scoped_lock lock{ _mutex };
+
+        _currentSize += size;
+        if (_currentSize > _maxSize)
+            evictEntries(false);
+    }
+
+    void TranscodeCache::evictEntries(bool removeTmpFiles)
+    {
+        struct EntryInfo
+        {
+            std::filesystem::file_time_type lastWriteTime;
+            std::size_t size;
+            std::filesystem::path path;
+        };
+
+        std::vector<EntryInfo> entries;
+        std::size_t totalSize{};
+
+        std::error_code ec;
+        std::filesystem::recursive_directory_iterator itPath{ _directory, ec };
+        const std::filesystem::recursive_directory_iterator itEnd;
+        while (!ec && itPath != itEnd)
+        {
+            const std::filesystem::path path{ *itPath };
+
+            std::error_code fileEc;
+            if (std::filesystem::is_regular_file(path, fileEc))
+            {
+                if (path.extension().string().compare(0, tmpExtensionPrefix.size(), tmpExtensionPrefix) == 0)
+                {
+                    if (removeTmpFiles)
+                        std::filesystem::remove(path, fileEc);
+                }
+                else
+                {
+                    const std::size_t size{ static_cast<std::size_t>(std::filesystem::file_size(path, fileEc)) };
+                    const std::filesystem::file_time_type lastWriteTime{ std::filesystem::last_write_time(path, fileEc) };
+                    if (!fileEc)
+                    {
+                        entries.push_back(EntryInfo{ lastWriteTime, size, path });
+                        totalSize += size;
+                    }
+                }
+            }
+
+            itPath.increment(ec);
+        }
+
+        if (totalSize > _maxSize)
+        {
+            // evict a bit more than needed to avoid scanning the whole cache on each write
+            const std::size_t targetSize{ _maxSize / 10 * 9 };
+
+            std::sort(std::begin(entries), std::end(entries), [](const EntryInfo& lhs, const EntryInfo& rhs) { return lhs.lastWriteTime < rhs.lastWriteTime; });
+
+            std::size_t evictedCount{};
+            for (const EntryInfo& entry : entries)
+            {
+                if (totalSize <= targetSize)
+                    break;
+
+                std::error_code fileEc;
+                if (std::filesystem::remove(entry.path, fileEc))
+                {
+                    totalSize -= entry.size;
+                    evictedCount++;
+                }
+            }
+
+            LMS_LOG(TRANSCODING, DEBUG) << "Evicted " << evictedCount << " transcode cache entries";
+        }
+
+        _currentSize = totalSize;
+        LMS_LOG(TRANSCODING, DEBUG) << "Transcode cache size = " << _currentSize;
+    }
+
+    TranscodeCache::EntryWriter::EntryWriter(TranscodeCache& cache, const std::filesystem::path& entryPath, std::size_t minExpectedSize)
+        : _cache{ cache }
+        , _entryPath{ entryPath }
+        , _tmpPath{ [&]
+            {
+                // several clients may be transcoding the same entry at the same time
+                const std::scoped_lock lock{ cache._mutex };
+                std::filesystem::path tmpPath{ entryPath };
+                tmpPath += std::string{ tmpExtensionPrefix } + std::to_string(cache._tmpFileCounter++);
+                return tmpPath;
+            }() }
+        , _minExpectedSize{ minExpectedSize }
+        , _ofs{ _tmpPath, std::ios::binary | std::ios::trunc }
+    {
+        if (!_ofs)
+            LMS_LOG(TRANSCODING, ERROR) << "Cannot create transcode cache entry '" << _tmpPath.string() << "'";
+    }
+
+    TranscodeCache::EntryWriter::~EntryWriter()
+    {
+        if (_ofs.is_open())
+            discard();
+    }
+
+    void TranscodeCache::EntryWriter::write(const std::byte* data, std::size_t size)
+    {
+        if (!_ofs.is_open())
+            return;
+
+        _ofs.write(reinterpret_cast<const char*>(data), size);
+        if (!_ofs)
+        {
+            LMS_LOG(TRANSCODING, ERROR) << "Cannot write transcode cache entry '" << _tmpPath.string() << "'";
+            discard();
+            return;
+        }
+
+        _writtenSize += size;
+    }
+
+    void TranscodeCache::EntryWriter::commit()
+    {
+        if (!_ofs.is_open())
+            return;
+
+        if (_writtenSize == 0 || _writtenSize < _minExpectedSize)
+        {
+            LMS_LOG(TRANSCODING, DEBUG) << "Not caching transcode: got " << _writtenSize << " bytes, expected at least " << _minExpectedSize;
+            discard();
+            return;
+        }
+
+        _ofs.close();
+        if (_ofs.fail())
+        {
+            LMS_LOG(TRANSCODING, ERROR) << "Cannot close transcode cache entry '" << _tmpPath.string() << "'";
+            std::error_code ec;
+            std::filesystem::remove(_tmpPath, ec);
+            return;
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(_tmpPath, _entryPath, ec);
+        if (ec)
+        {
+            LMS_LOG(TRANSCODING, ERROR) << "Cannot rename transcode cache entry '" << _tmpPath.string() << "': " << ec.message();
+            std::filesystem::remove(_tmpPath, ec);
+            return;
+        }
+
+        LMS_LOG(TRANSCODING, DEBUG) << "Added transcode cache entry '" << _entryPath.string() << "', size = " << _writtenSize;
+        _cache.onEntryAdded(_writtenSize);
+    }
+
+    void TranscodeCache::EntryWriter::discard()
+    {
+        _ofs.close();
+
+        std::error_code ec;
+        std::filesystem::remove(_tmpPath, ec);
+    }
+} // namespace Av::Transcoding
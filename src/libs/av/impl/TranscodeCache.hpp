@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+#include "av/TranscodingParameters.hpp"
+
+namespace Av::Transcoding
+{
+    // Stores complete transcodes on disk, so that subsequent requests with the same parameters are served as plain files
+    // Entries are invalidated when the track file is modified, and evicted in LRU order once the total size exceeds the limit
+    class TranscodeCache
+    {
+    public:
+        // nullptr if disabled
+        static TranscodeCache* getInstance();
+
+        TranscodeCache(const std::filesystem::path& directory, std::size_t maxSize);
+
+        TranscodeCache(const TranscodeCache&) = delete;
+        TranscodeCache& operator=(const TranscodeCache&) = delete;
+        TranscodeCache(TranscodeCache&&) = delete;
+        TranscodeCache& operator=(TranscodeCache&&) = delete;
+
+        // whole tracks, or bounded parts of tracks (segments)
+        static bool isCacheable(const OutputParameters& outputParameters) { return outputParameters.offset.count() == 0 || outputParameters.duration; }
+
+        std::optional<std::filesystem::path> getEntry(const InputParameters& inputParameters, const OutputParameters& outputParameters);
+
+        class EntryWriter
+        {
+        public:
+            EntryWriter(TranscodeCache& cache, const std::filesystem::path& entryPath, std::size_t minExpectedSize);
+            ~EntryWriter(); // discards the entry if not committed
+
+            EntryWriter(const EntryWriter&) = delete;
+            EntryWriter& operator=(const EntryWriter&) = delete;
+            EntryWriter(EntryWriter&&) = delete;
+            EntryWriter& operator=(EntryWriter&&) = delete;
+
+            void write(const std::byte* data, std::size_t size);
+            void commit(); // to be called once the whole transcode has been written
+
+        private:
+            void discard();
+
+            TranscodeCache&         _cache;
+            const std::filesystem::path _entryPath;
+            const std::filesystem::path _tmpPath;
+            const std::size_t       _minExpectedSize;
+            std::ofstream           _ofs;
+            std::size_t             _writtenSize{};
+        };
+
+        // nullptr if the entry cannot be created
+        std::unique_ptr<EntryWriter> createEntryWriter(const InputParameters& inputParameters, const OutputParameters& outputParameters);
+
+    private:
+        std::optional<std::filesystem::path> getEntryPath(const InputParameters& inputParameters, const OutputParameters& outputParameters) const;
+        void onEntryAdded(std::size_t size);
+        void evictEntries(bool removeTmpFiles);
+
+        const std::filesystem::path _directory;
+        const std::size_t           _maxSize;
+
+        std::mutex                  _mutex;
+        std::size_t                 _currentSize{};
+        std::size_t                 _tmpFileCounter{};
+    };
+} // namespace Av::Transcoding
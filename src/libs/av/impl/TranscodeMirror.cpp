@@ -0,0 +1,386 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TranscodeMirror.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <initializer_list>
+#include <memory>
+#include <sstream>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "utils/IConfig.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Service.hpp"
+#include "utils/String.hpp"
+#include "ITranscoder.hpp"
+
+namespace Av::Transcoding
+{
+    namespace
+    {
+        constexpr std::string_view tmpExtension{ ".tmp" };
+        constexpr std::size_t readBufferSize{ 64 * 1024 };
+
+        std::optional<OutputFormat> parseOutputFormat(std::string_view str)
+        {
+            for (const auto& [name, format] : std::initializer_list<std::pair<std::string_view, OutputFormat>>{
+                {"mp3", OutputFormat::MP3},
+                {"ogg_opus", OutputFormat::OGG_OPUS},
+                {"matroska_opus", OutputFormat::MATROSKA_OPUS},
+                {"ogg_vorbis", OutputFormat::OGG_VORBIS},
+                {"webm_vorbis", OutputFormat::WEBM_VORBIS},
+                })
+            {
+                if (StringUtils::stringCaseInsensitiveEqual(name, str))
+                    return format;
+            }
+            return std::nullopt;
+        }
+
+        // "<format>:<bitrate in kbps>"
+        std::vector<OutputParameters> readOutputParameters()
+        {
+            std::vector<OutputParameters> res;
+
+            Service<IConfig>::get()->visitStrings("transcode-mirror-formats", [&](std::string_view str)
+                {
+                    const std::vector<std::string_view> values{ StringUtils::splitString(str, ":") };
+                    const std::optional<OutputFormat> format{ values.size() == 2 ? parseOutputFormat(values[0]) : std::nullopt };
+                    const std::optional<std::size_t> bitrate{ values.size() == 2 ? StringUtils::readAs<std::size_t>(values[1]) : std::nullopt };
+                    if (!format || !bitrate || *bitrate == 0)
+                    {
+                        LMS_LOG(TRANSCODING, ERROR) << "Skipping bad transcode mirror format '" << str << "'";
+                        return;
+                    }
+
+                    OutputParameters& outputParameters{ res.emplace_back() };
+                    outputParameters.format = *format;
+                    outputParameters.bitrate = *bitrate * 1000;
+                    outputParameters.stripMetadata = false;
+                }, {});
+
+            return res;
+        }
+
+        std::size_t estimateEntrySize(const InputParameters& inputParameters, const OutputParameters& outputParameters)
+        {
+            return getOutputBitrate(inputParameters, outputParameters) / 8 * static_cast<std::size_t>(inputParameters.duration.count()) / 1000;
+        }
+    }
+
+    TranscodeMirror* TranscodeMirror::getInstance()
+    {
+        static const std::unique_ptr<TranscodeMirror> instance{ []() -> std::unique_ptr<TranscodeMirror>
+            {
+                const std::size_t maxSize{ Service<IConfig>::get()->getULong("transcode-mirror-max-size", 0) * 1024 * 1024 };
+                if (maxSize == 0)
+                    return {};
+
+                std::vector<OutputParameters> outputParameters{ readOutputParameters() };
+                if (outputParameters.empty())
+                    return {};
+
+                return std::make_unique<TranscodeMirror>(Service<IConfig>::get()->getPath("working-dir") / "mirror", maxSize, std::move(outputParameters));
+            }() };
+
+        return instance.get();
+    }
+
+    TranscodeMirror::TranscodeMirror(const std::filesystem::path& directory, std::size_t maxSize, std::vector<OutputParameters> outputParameters)
+        : _directory{ directory }
+        , _maxSize{ maxSize }
+        , _outputParameters{ std::move(outputParameters) }
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(_directory, ec);
+        if (ec)
+            LMS_LOG(TRANSCODING, ERROR) << "Cannot create transcode mirror directory '" << _directory.string() << "': " << ec.message();
+
+        LMS_LOG(TRANSCODING, INFO) << "Transcode mirror directory = '" << _directory.string() << "', max size = " << _maxSize << ", format count = " << _outputParameters.size();
+    }
+
+    std::optional<std::filesystem::path> TranscodeMirror::getEntry(const InputParameters& inputParameters, const OutputParameters& outputParameters) const
+    {
+        // whole tracks only
+        if (outputParameters.stream || outputParameters.offset.count() != 0 || outputParameters.duration)
+            return std::nullopt;
+
+        for (const OutputParameters& mirrorOutputParameters : _outputParameters)
+        {
+            if (mirrorOutputParameters.format != outputParameters.format || mirrorOutputParameters.bitrate != outputParameters.bitrate)
+                continue;
+
+            const std::optional<std::filesystem::path> entryPath{ getEntryPath(inputParameters, mirrorOutputParameters) };
+            if (!entryPath)
+                return std::nullopt;
+
+            std::error_code ec;
+            if (!std::filesystem::is_regular_file(*entryPath, ec))
+                return std::nullopt;
+
+            LMS_LOG(TRANSCODING, DEBUG) << "Serving '" << inputParameters.trackPath.string() << "' from transcode mirror entry '" << entryPath->string() << "'";
+            return entryPath;
+        }
+
+        return std::nullopt;
+    }
+
+    Mirror::SyncStats TranscodeMirror::sync(const std::vector<InputParameters>& tracks, const std::atomic<bool>& abort, const Mirror::ProgressCallback& progressCallback)
+    {
+        const std::scoped_lock lock{ _syncMutex };
+
+        Mirror::SyncStats stats;
+
+        // only sync writes in the mirror: temporary files are leftovers of an interrupted sync
+        std::unordered_map<std::string, std::size_t> existingEntries; // path => size
+        {
+            std::error_code ec;
+            std::filesystem::recursive_directory_iterator itPath{ _directory, ec };
+            const std::filesystem::recursive_directory_iterator itEnd;
+            while (!ec && itPath != itEnd)
+            {
+                const std::filesystem::path path{ *itPath };
+
+                std::error_code fileEc;
+                if (std::filesystem::is_regular_file(path, fileEc))
+                {
+                    if (path.extension() == tmpExtension)
+                        std::filesystem::remove(path, fileEc);
+                    else if (const std::size_t size{ static_cast<std::size_t>(std::filesystem::file_size(path, fileEc)) }; !fileEc)
+                        existingEntries.emplace(path.string(), size);
+                }
+
+                itPath.increment(ec);
+            }
+        }
+
+        struct WantedEntry
+        {
+            std::size_t trackIndex;
+            const OutputParameters* outputParameters;
+            std::filesystem::path path;
+            bool present;
+        };
+
+        // keep the entries of the first tracks, up to the quota
+        // the size of the missing entries is estimated using their nominal bitrate
+        std::vector<WantedEntry> wantedEntries;
+        std::size_t entryCount{};
+        std::size_t plannedSize{};
+        bool quotaReached{};
+        for (std::size_t trackIndex{}; trackIndex < tracks.size(); ++trackIndex)
+        {
+            for (const OutputParameters& outputParameters : _outputParameters)
+            {
+                std::optional<std::filesystem::path> entryPath{ getEntryPath(tracks[trackIndex], outputParameters) };
+                if (!entryPath)
+                    continue;
+
+                entryCount++;
+                if (quotaReached)
+                    continue;
+
+                const auto itEntry{ existingEntries.find(entryPath->string()) };
+                const bool present{ itEntry != std::cend(existingEntries) };
+                const std::size_t size{ present ? itEntry->second : estimateEntrySize(tracks[trackIndex], outputParameters) };
+                if (plannedSize + size > _maxSize)
+                {
+                    quotaReached = true;
+                    continue;
+                }
+
+                plannedSize += size;
+                wantedEntries.push_back(WantedEntry{ trackIndex, &outputParameters, std::move(*entryPath), present });
+            }
+        }
+
+        std::size_t currentSize{};
+        {
+            std::unordered_set<std::string> keptEntries;
+            for (const WantedEntry& wantedEntry : wantedEntries)
+            {
+                if (wantedEntry.present)
+                {
+                    keptEntries.insert(wantedEntry.path.string());
+                    currentSize += existingEntries[wantedEntry.path.string()];
+                    stats.mirroredCount++;
+                }
+            }
+
+            for (const auto& [path, size] : existingEntries)
+            {
+                if (keptEntries.find(path) != std::cend(keptEntries))
+                    continue;
+
+                std::error_code ec;
+                if (std::filesystem::remove(path, ec))
+                    stats.removedCount++;
+            }
+        }
+
+        for (std::size_t i{}; i < wantedEntries.size(); ++i)
+        {
+            const WantedEntry& wantedEntry{ wantedEntries[i] };
+
+            if (!wantedEntry.present)
+            {
+                if (abort)
+                    break;
+
+                // the estimations of the previous entries may have been too low
+                if (currentSize + estimateEntrySize(tracks[wantedEntry.trackIndex], *wantedEntry.outputParameters) > _maxSize)
+                    break;
+
+                if (const std::optional<std::size_t> size{ createEntry(tracks[wantedEntry.trackIndex], *wantedEntry.outputParameters, wantedEntry.path, abort) })
+                {
+                    currentSize += *size;
+                    stats.addedCount++;
+                    stats.mirroredCount++;
+                }
+                else if (!abort)
+                {
+                    stats.failedCount++;
+                }
+            }
+
+            if (i + 1 == wantedEntries.size() || wantedEntries[i + 1].trackIndex != wantedEntry.trackIndex)
+                progressCallback(wantedEntry.trackIndex + 1);
+        }
+
+        stats.skippedCount = entryCount - stats.mirroredCount - stats.failedCount;
+
+        LMS_LOG(TRANSCODING, INFO) << "Transcode mirror synced: " << stats.mirroredCount << " entries (" << stats.addedCount << " added, " << stats.removedCount << " removed, "
+            << stats.skippedCount << " skipped, " << stats.failedCount << " failed), size = " << currentSize;
+
+        return stats;
+    }
+
+    std::optional<std::filesystem::path> TranscodeMirror::getEntryPath(const InputParameters& inputParameters, const OutputParameters& outputParameters) const
+    {
+        std::error_code ec;
+        const std::filesystem::file_time_type lastWriteTime{ std::filesystem::last_write_time(inputParameters.trackPath, ec) };
+        if (ec)
+            return std::nullopt;
+
+        // same as the transcode cache: the entries of modified tracks are no longer wanted, and removed by the next sync
+        std::ostringstream key;
+        key << inputParameters.trackPath.string()
+            << '|' << lastWriteTime.time_since_epoch().count()
+            << '|' << static_cast<int>(outputParameters.format)
+            << '|' << outputParameters.bitrate;
+
+        const std::size_t hash{ std::hash<std::string>{}(key.str()) };
+
+        std::ostringstream subDirectoryName;
+        subDirectoryName << std::hex << std::setw(2) << std::setfill('0') << (hash & 0xFF);
+
+        std::ostringstream fileName;
+        fileName << std::hex << std::setw(16) << std::setfill('0') << hash << ".bin";
+
+        return _directory / subDirectoryName.str() / fileName.str();
+    }
+
+    std::optional<std::size_t> TranscodeMirror::createEntry(const InputParameters& inputParameters, const OutputParameters& outputParameters, const std::filesystem::path& entryPath, const std::atomic<bool>& abort)
+    {
+        std::filesystem::path tmpPath{ entryPath };
+        tmpPath += tmpExtension;
+
+        std::error_code ec;
+        std::filesystem::create_directories(entryPath.parent_path(), ec);
+
+        std::size_t writtenSize{};
+        {
+            std::ofstream ofs{ tmpPath, std::ios::binary | std::ios::trunc };
+            if (!ofs)
+            {
+                LMS_LOG(TRANSCODING, ERROR) << "Cannot create transcode mirror entry '" << tmpPath.string() << "'";
+                return std::nullopt;
+            }
+
+            try
+            {
+                const std::unique_ptr<ITranscoder> transcoder{ createTranscoder(inputParameters, outputParameters) };
+
+                std::vector<std::byte> buffer(readBufferSize);
+                while (!abort && ofs)
+                {
+                    const std::size_t readSize{ transcoder->readSome(buffer.data(), buffer.size()) };
+                    if (readSize == 0)
+                        break;
+
+                    ofs.write(reinterpret_cast<const char*>(buffer.data()), readSize);
+                    writtenSize += readSize;
+                }
+
+                if (abort)
+                    transcoder->stop();
+            }
+            catch (const std::exception& e)
+            {
+                LMS_LOG(TRANSCODING, ERROR) << "Cannot transcode '" << inputParameters.trackPath.string() << "' into the mirror: " << e.what();
+                ofs.setstate(std::ios::failbit);
+            }
+
+            ofs.close();
+
+            // reject truncated outputs (ffmpeg killed or failing midway): expect at least half of the nominal size
+            if (abort || ofs.fail() || writtenSize == 0 || writtenSize < estimateEntrySize(inputParameters, outputParameters) / 2)
+            {
+                if (!abort)
+                    LMS_LOG(TRANSCODING, ERROR) << "Cannot create transcode mirror entry for '" << inputParameters.trackPath.string() << "': got " << writtenSize << " bytes";
+
+                std::filesystem::remove(tmpPath, ec);
+                return std::nullopt;
+            }
+        }
+
+        std::filesystem::rename(tmpPath, entryPath, ec);
+        if (ec)
+        {
+            LMS_LOG(TRANSCODING, ERROR) << "Cannot rename transcode mirror entry '" << tmpPath.string() << "': " << ec.message();
+            std::filesystem::remove(tmpPath, ec);
+            return std::nullopt;
+        }
+
+        LMS_LOG(TRANSCODING, DEBUG) << "Added transcode mirror entry '" << entryPath.string() << "' for '" << inputParameters.trackPath.string() << "', size = " << writtenSize;
+        return writtenSize;
+    }
+
+    namespace Mirror
+    {
+        bool isEnabled()
+        {
+            return TranscodeMirror::getInstance() != nullptr;
+        }
+
+        SyncStats sync(const std::vector<InputParameters>& tracks, const std::atomic<bool>& abort, const ProgressCallback& progressCallback)
+        {
+            TranscodeMirror* mirror{ TranscodeMirror::getInstance() };
+            if (!mirror)
+                return {};
+
+            return mirror->sync(tracks, abort, progressCallback);
+        }
+    }
+} // namespace Av::Transcoding
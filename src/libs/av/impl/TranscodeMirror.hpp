@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "av/TranscodeMirror.hpp"
+#include "av/TranscodingParameters.hpp"
+
+namespace Av::Transcoding
+{
+    // Whole tracks transcoded ahead of time using the configured output parameters, within a disk quota
+    // Unlike the transcode cache, entries are only added and removed by sync: serving never writes nor evicts anything
+    class TranscodeMirror
+    {
+    public:
+        // nullptr if disabled
+        static TranscodeMirror* getInstance();
+
+        TranscodeMirror(const std::filesystem::path& directory, std::size_t maxSize, std::vector<OutputParameters> outputParameters);
+
+        TranscodeMirror(const TranscodeMirror&) = delete;
+        TranscodeMirror& operator=(const TranscodeMirror&) = delete;
+        TranscodeMirror(TranscodeMirror&&) = delete;
+        TranscodeMirror& operator=(TranscodeMirror&&) = delete;
+
+        // metadata are always kept in the entries, whatever the requested stripMetadata
+        std::optional<std::filesystem::path> getEntry(const InputParameters& inputParameters, const OutputParameters& outputParameters) const;
+
+        Mirror::SyncStats sync(const std::vector<InputParameters>& tracks, const std::atomic<bool>& abort, const Mirror::ProgressCallback& progressCallback);
+
+    private:
+        std::optional<std::filesystem::path> getEntryPath(const InputParameters& inputParameters, const OutputParameters& outputParameters) const;
+        std::optional<std::size_t> createEntry(const InputParameters& inputParameters, const OutputParameters& outputParameters, const std::filesystem::path& entryPath, const std::atomic<bool>& abort);
+
+        const std::filesystem::path         _directory;
+        const std::size_t                   _maxSize;
+        const std::vector<OutputParameters> _outputParameters;
+
+        std::mutex                          _syncMutex;
+    };
+} // namespace Av::Transcoding
@@ -22,6 +22,7 @@
 #include <atomic>
 #include <iomanip>
 
+#include "av/SeekTable.hpp"
 #include "utils/IChildProcessManager.hpp"
 #include "utils/IConfig.hpp"
 #include "utils/Path.hpp"
@@ -36,7 +37,16 @@ namespace Av::Transcoding
     static std::atomic<size_t>		globalId{};
     static std::filesystem::path	ffmpegPath;
 
-    std::string_view formatToMimetype(OutputFormat format)
+    static void addEncoderArgs(std::vector<std::string>& args, bool streamCopy, const char* encoderName)
+    {
+        if (streamCopy)
+            return;
+
+        args.emplace_back("-acodec");
+        args.emplace_back(encoderName);
+    }
+
+    std::string_view toMimetype(OutputFormat format)
     {
         switch (format)
         {
@@ -98,12 +108,29 @@ namespace Av::Transcoding
         args.emplace_back("quiet");
         args.emplace_back("-nostdin");
 
+        // start reading from the nearest known position, so that the demuxer does not have to look for it
+        std::chrono::milliseconds offset{ _outputParameters.offset };
+        if (offset.count() > 0)
+        {
+            const std::optional<SeekTable> seekTable{ loadSeekTable(_inputParameters.trackPath) };
+            if (const std::optional<SeekPoint> seekPoint{ seekTable ? findSeekPoint(*seekTable, offset) : std::nullopt })
+            {
+                LOG(DEBUG) << "Using seek point at " << seekPoint->timestamp.count() << " ms, offset " << seekPoint->byteOffset;
+
+                args.emplace_back("-f");
+                args.emplace_back(seekTable->formatName);
+                args.emplace_back("-skip_initial_bytes");
+                args.emplace_back(std::to_string(seekPoint->byteOffset));
+                offset -= seekPoint->timestamp;
+            }
+        }
+
         // input Offset
         {
             args.emplace_back("-ss");
 
             std::ostringstream oss;
-            oss << std::fixed << std::showpoint << std::setprecision(3) << (_outputParameters.offset.count() / float{ 1000 });
+            oss << std::fixed << std::showpoint << std::setprecision(3) << (offset.count() / float{ 1000 });
             args.emplace_back(oss.str());
         }
 
@@ -111,6 +138,16 @@ namespace Av::Transcoding
         args.emplace_back("-i");
         args.emplace_back(_inputParameters.trackPath.string());
 
+        // Output duration, if set
+        if (_outputParameters.duration)
+        {
+            args.emplace_back("-t");
+
+            std::ostringstream oss;
+            oss << std::fixed << std::showpoint << std::setprecision(3) << (_outputParameters.duration->count() / float{ 1000 });
+            args.emplace_back(oss.str());
+        }
+
         // Stream mapping, if set
         if (_outputParameters.stream)
         {
@@ -128,9 +165,20 @@ namespace Av::Transcoding
         // Skip video flows (including covers)
         args.emplace_back("-vn");
 
-        // Output bitrates
-        args.emplace_back("-b:a");
-        args.emplace_back(std::to_string(_outputParameters.bitrate));
+        // Already encoded as requested: only remux the audio stream
+        const bool streamCopy{ isStreamCopyPossible(_inputParameters, _outputParameters) };
+        if (streamCopy)
+        {
+            LOG(DEBUG) << "Source codec is compatible, copying the audio stream";
+            args.emplace_back("-c:a");
+            args.emplace_back("copy");
+        }
+        else
+        {
+            // Output bitrates
+            args.emplace_back("-b:a");
+            args.emplace_back(std::to_string(_outputParameters.bitrate));
+        }
 
         // Codecs and formats
         switch (_outputParameters.format)
@@ -141,29 +189,25 @@ namespace Av::Transcoding
             break;
 
         case OutputFormat::OGG_OPUS:
-            args.emplace_back("-acodec");
-            args.emplace_back("libopus");
+            addEncoderArgs(args, streamCopy, "libopus");
             args.emplace_back("-f");
             args.emplace_back("ogg");
             break;
 
         case OutputFormat::MATROSKA_OPUS:
-            args.emplace_back("-acodec");
-            args.emplace_back("libopus");
+            addEncoderArgs(args, streamCopy, "libopus");
             args.emplace_back("-f");
             args.emplace_back("matroska");
             break;
 
         case OutputFormat::OGG_VORBIS:
-            args.emplace_back("-acodec");
-            args.emplace_back("libvorbis");
+            addEncoderArgs(args, streamCopy, "libvorbis");
             args.emplace_back("-f");
             args.emplace_back("ogg");
             break;
 
         case OutputFormat::WEBM_VORBIS:
-            args.emplace_back("-acodec");
-            args.emplace_back("libvorbis");
+            addEncoderArgs(args, streamCopy, "libvorbis");
             args.emplace_back("-f");
             args.emplace_back("webm");
             break;
@@ -172,7 +216,7 @@ namespace Av::Transcoding
             throw Exception{ "Unhandled format (" + std::to_string(static_cast<int>(_outputParameters.format)) + ")" };
         }
 
-        _outputMimeType = formatToMimetype(_outputParameters.format);
+        _outputMimeType = toMimetype(_outputParameters.format);
 
         args.emplace_back("pipe:1");
 
@@ -215,4 +259,13 @@ namespace Av::Transcoding
         return _childProcess->finished();
     }
 
+    void Transcoder::stop()
+    {
+        assert(_childProcess);
+
+        // the pending read then completes with the end of file
+        LOG(DEBUG) << "Stopping transcoder";
+        _childProcess->kill();
+    }
+
 } // namespace Av::Transcoding
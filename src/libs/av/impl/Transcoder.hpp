@@ -24,31 +24,34 @@
 
 #include "av/TranscodingParameters.hpp"
 #include "av/Types.hpp"
+#include "ITranscoder.hpp"
 
 class IChildProcess;
 
 namespace Av::Transcoding
 {
-    class Transcoder
+    // Spawns a ffmpeg process and reads its output
+    class Transcoder final : public ITranscoder
     {
     public:
         Transcoder(const InputParameters& inputParameters, const OutputParameters& outputParameters);
-        ~Transcoder();
+        ~Transcoder() override;
 
         Transcoder(const Transcoder&) = delete;
         Transcoder& operator=(const Transcoder&) = delete;
         Transcoder(Transcoder&&) = delete;
         Transcoder& operator=(Transcoder&&) = delete;
 
-        // non blocking calls
-        using ReadCallback = std::function<void(std::size_t nbReadBytes)>;
-        void            asyncRead(std::byte* buffer, std::size_t bufferSize, ReadCallback);
-        std::size_t     readSome(std::byte* buffer, std::size_t bufferSize);
+        void            asyncRead(std::byte* buffer, std::size_t bufferSize, ReadCallback) override;
+        std::size_t     readSome(std::byte* buffer, std::size_t bufferSize) override;
 
-        const std::string& getOutputMimeType() const { return _outputMimeType; }
-        const OutputParameters& getOutputParameters() const { return _outputParameters; }
+        const std::string& getOutputMimeType() const override { return _outputMimeType; }
+        const OutputParameters& getOutputParameters() const override { return _outputParameters; }
 
-        bool            finished() const;
+        bool            finished() const override;
+
+        void            stop() override;
+        std::size_t     getDebugId() const override { return _debugId; }
 
     private:
         static void init();
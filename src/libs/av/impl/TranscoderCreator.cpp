@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "ITranscoder.hpp"
+
+#include "utils/IConfig.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Service.hpp"
+#include "utils/Tracing.hpp"
+
+#include "LibAvTranscoder.hpp"
+#include "Transcoder.hpp"
+
+namespace Av::Transcoding
+{
+    namespace
+    {
+        enum class TranscodingEngine
+        {
+            Ffmpeg,
+            LibAv,
+        };
+
+        TranscodingEngine getTranscodingEngine()
+        {
+            static const TranscodingEngine engine{ []
+                {
+                    const std::string engineName{ Service<IConfig>::get()->getString("transcoding-engine", "ffmpeg") };
+                    if (engineName == "libav")
+                        return TranscodingEngine::LibAv;
+
+                    if (engineName != "ffmpeg")
+                        LMS_LOG(TRANSCODING, ERROR) << "Unhandled transcoding engine '" << engineName << "', using 'ffmpeg'";
+
+                    return TranscodingEngine::Ffmpeg;
+                }() };
+
+            return engine;
+        }
+    }
+
+    bool isStreamCopyPossible(const InputParameters& inputParameters, const OutputParameters& outputParameters)
+    {
+        // the codec is only known for the best stream
+        if (outputParameters.stream || inputParameters.bitrate == 0 || inputParameters.bitrate > outputParameters.bitrate)
+            return false;
+
+        switch (outputParameters.format)
+        {
+        case OutputFormat::MP3:
+            return inputParameters.codec == DecodingCodec::MP3;
+        case OutputFormat::OGG_OPUS:
+        case OutputFormat::MATROSKA_OPUS:
+            return inputParameters.codec == DecodingCodec::OPUS;
+        case OutputFormat::OGG_VORBIS:
+        case OutputFormat::WEBM_VORBIS:
+            return inputParameters.codec == DecodingCodec::VORBIS;
+        }
+
+        return false;
+    }
+
+    std::size_t getOutputBitrate(const InputParameters& inputParameters, const OutputParameters& outputParameters)
+    {
+        return isStreamCopyPossible(inputParameters, outputParameters) ? inputParameters.bitrate : outputParameters.bitrate;
+    }
+
+    std::unique_ptr<ITranscoder> createTranscoder(const InputParameters& inputParameters, const OutputParameters& outputParameters)
+    {
+        Tracing::ScopedSpan span{ "transcoder.start" };
+        switch (getTranscodingEngine())
+        {
+        case TranscodingEngine::Ffmpeg:
+            return std::make_unique<Transcoder>(inputParameters, outputParameters);
+        case TranscodingEngine::LibAv:
+            return std::make_unique<LibAvTranscoder>(inputParameters, outputParameters);
+        }
+
+        throw Exception{ "Unhandled transcoding engine" };
+    }
+} // namespace Av::Transcoding
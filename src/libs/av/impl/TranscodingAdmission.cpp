@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "TranscodingAdmission.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+
+#include "av/Types.hpp"
+#include "utils/IConfig.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Service.hpp"
+#include "ITranscoder.hpp"
+
+namespace Av::Transcoding
+{
+    TranscodingAdmission& TranscodingAdmission::getInstance()
+    {
+        static TranscodingAdmission admission{ Service<IConfig>::get()->getULong("transcoding-max-stream-count", 32), Service<IConfig>::get()->getULong("transcoding-max-stream-count-per-user", 4) };
+        return admission;
+    }
+
+    TranscodingAdmission::Slot::Slot(TranscodingAdmission& admission, std::string_view owner)
+        : _admission{ admission }
+        , _owner{ owner }
+    {
+    }
+
+    TranscodingAdmission::Slot::~Slot()
+    {
+        _admission.release(*this);
+    }
+
+    void TranscodingAdmission::Slot::bind(ITranscoder& transcoder)
+    {
+        const std::scoped_lock lock{ _admission._mutex };
+
+        // preempted before the transcoder could even be created
+        if (_preempted)
+            transcoder.stop();
+        else
+            _transcoder = &transcoder;
+    }
+
+    bool TranscodingAdmission::Slot::isPreempted() const
+    {
+        const std::scoped_lock lock{ _admission._mutex };
+        return _preempted;
+    }
+
+    TranscodingAdmission::TranscodingAdmission(std::size_t maxStreamCount, std::size_t maxStreamCountPerOwner)
+        : _maxStreamCount{ maxStreamCount }
+        , _maxStreamCountPerOwner{ maxStreamCountPerOwner }
+    {
+        LMS_LOG(TRANSCODING, INFO) << "Max concurrent transcodings = " << _maxStreamCount << ", per user = " << _maxStreamCountPerOwner;
+    }
+
+    std::unique_ptr<TranscodingAdmission::Slot> TranscodingAdmission::acquireSlot(std::string_view owner)
+    {
+        const std::scoped_lock lock{ _mutex };
+
+        if (_maxStreamCountPerOwner > 0 && !owner.empty())
+        {
+            for (std::size_t slotCount{ getSlotCount(owner) }; slotCount >= _maxStreamCountPerOwner; --slotCount)
+                preempt(*getOldestSlot(owner));
+        }
+
+        if (_maxStreamCount > 0 && _activeSlots.size() >= _maxStreamCount)
+        {
+            // take the slot back from the same owner first, then from the owner holding the most streams
+            Slot* slotToPreempt{ !owner.empty() ? getOldestSlot(owner) : nullptr };
+            if (!slotToPreempt)
+            {
+                std::unordered_map<std::string_view, std::size_t> slotCountByOwner;
+                std::size_t maxSlotCount{};
+                for (Slot* slot : _activeSlots)
+                {
+                    if (slot->_owner.empty())
+                        continue;
+
+                    const std::size_t slotCount{ ++slotCountByOwner[slot->_owner] };
+                    if (slotCount > maxSlotCount)
+                        maxSlotCount = slotCount;
+                }
+
+                // an owner cannot lose its last stream for another one
+                if (maxSlotCount > 1)
+                {
+                    auto itSlot{ std::find_if(std::cbegin(_activeSlots), std::cend(_activeSlots), [&](const Slot* slot) { return !slot->_owner.empty() && slotCountByOwner[slot->_owner] == maxSlotCount; }) };
+                    assert(itSlot != std::cend(_activeSlots));
+                    slotToPreempt = *itSlot;
+                }
+            }
+
+            if (!slotToPreempt)
+            {
+                _rejectedStreamCount++;
+                LMS_LOG(TRANSCODING, INFO) << "Rejecting transcoding for '" << owner << "': " << _activeSlots.size() << " streams in progress";
+                throw TooManyTranscodingsException{ "Too many transcodings in progress" };
+            }
+
+            preempt(*slotToPreempt);
+        }
+
+        std::unique_ptr<Slot> slot{ new Slot{ *this, owner } };
+        _activeSlots.push_back(slot.get());
+
+        return slot;
+    }
+
+    std::size_t TranscodingAdmission::getPreemptedStreamCount() const
+    {
+        const std::scoped_lock lock{ _mutex };
+        return _preemptedStreamCount;
+    }
+
+    std::size_t TranscodingAdmission::getRejectedStreamCount() const
+    {
+        const std::scoped_lock lock{ _mutex };
+        return _rejectedStreamCount;
+    }
+
+    std::size_t TranscodingAdmission::getSlotCount(std::string_view owner) const
+    {
+        return std::count_if(std::cbegin(_activeSlots), std::cend(_activeSlots), [=](const Slot* slot) { return slot->_owner == owner; });
+    }
+
+    TranscodingAdmission::Slot* TranscodingAdmission::getOldestSlot(std::string_view owner) const
+    {
+        auto itSlot{ std::find_if(std::cbegin(_activeSlots), std::cend(_activeSlots), [=](const Slot* slot) { return slot->_owner == owner; }) };
+        return itSlot != std::cend(_activeSlots) ? *itSlot : nullptr;
+    }
+
+    void TranscodingAdmission::preempt(Slot& slot)
+    {
+        _activeSlots.remove(&slot);
+        slot._preempted = true;
+        _preemptedStreamCount++;
+
+        // stopping is quick (kills the process or releases the libav contexts), the slot owner cannot release it meanwhile
+        if (slot._transcoder)
+        {
+            LMS_LOG(TRANSCODING, INFO) << "[" << slot._transcoder->getDebugId() << "] - Preempting transcoding for '" << slot._owner << "'";
+            slot._transcoder->stop();
+        }
+        else
+        {
+            LMS_LOG(TRANSCODING, INFO) << "Preempting starting transcoding for '" << slot._owner << "'";
+        }
+    }
+
+    void TranscodingAdmission::release(Slot& slot)
+    {
+        const std::scoped_lock lock{ _mutex };
+
+        // preempted slots are already released
+        _activeSlots.remove(&slot);
+    }
+} // namespace Av::Transcoding
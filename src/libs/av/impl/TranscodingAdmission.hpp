@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace Av::Transcoding
+{
+    class ITranscoder;
+
+    // Bounds the number of concurrent transcodings, globally and per owner (usually a user)
+    // When a limit is reached, a new stream preempts the oldest stream of the same owner,
+    // that is most likely abandoned (track skipped, client restarted, etc.)
+    class TranscodingAdmission
+    {
+    public:
+        class Slot
+        {
+        public:
+            ~Slot();
+
+            Slot(const Slot&) = delete;
+            Slot& operator=(const Slot&) = delete;
+
+            // the transcoder is stopped if the slot gets preempted, must outlive the slot
+            void bind(ITranscoder& transcoder);
+            bool isPreempted() const;
+
+        private:
+            friend class TranscodingAdmission;
+            Slot(TranscodingAdmission& admission, std::string_view owner);
+
+            TranscodingAdmission& _admission;
+            const std::string _owner;
+
+            // protected by the admission mutex
+            ITranscoder* _transcoder{};
+            bool _preempted{};
+        };
+
+        static TranscodingAdmission& getInstance();
+
+        // 0 means unlimited
+        TranscodingAdmission(std::size_t maxStreamCount, std::size_t maxStreamCountPerOwner);
+
+        TranscodingAdmission(const TranscodingAdmission&) = delete;
+        TranscodingAdmission& operator=(const TranscodingAdmission&) = delete;
+
+        // Throws TooManyTranscodingsException if no slot can be freed for this owner
+        std::unique_ptr<Slot> acquireSlot(std::string_view owner);
+
+        std::size_t getPreemptedStreamCount() const;
+        std::size_t getRejectedStreamCount() const;
+
+    private:
+        // _mutex must be held
+        std::size_t getSlotCount(std::string_view owner) const;
+        Slot* getOldestSlot(std::string_view owner) const;
+        void preempt(Slot& slot);
+
+        void release(Slot& slot);
+
+        const std::size_t _maxStreamCount;
+        const std::size_t _maxStreamCountPerOwner;
+
+        mutable std::mutex _mutex;
+        std::list<Slot*> _activeSlots; // oldest first
+        std::size_t _preemptedStreamCount{};
+        std::size_t _rejectedStreamCount{};
+    };
+} // namespace Av::Transcoding
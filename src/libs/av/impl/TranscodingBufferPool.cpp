@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "TranscodingBufferPool.hpp"
+
+namespace Av::Transcoding
+{
+    TranscodingBufferPool& TranscodingBufferPool::getInstance()
+    {
+        // extra buffers are freed, not to keep the memory used by a peak of streams
+        static TranscodingBufferPool pool{ 64 };
+        return pool;
+    }
+
+    TranscodingBufferPool::TranscodingBufferPool(std::size_t maxPooledBufferCount)
+        : _maxPooledBufferCount{ maxPooledBufferCount }
+    {
+    }
+
+    std::unique_ptr<TranscodingBufferPool::Buffer> TranscodingBufferPool::acquire()
+    {
+        {
+            const std::scoped_lock lock{ _mutex };
+            if (!_buffers.empty())
+            {
+                std::unique_ptr<Buffer> buffer{ std::move(_buffers.back()) };
+                _buffers.pop_back();
+                return buffer;
+            }
+        }
+
+        return std::make_unique<Buffer>();
+    }
+
+    void TranscodingBufferPool::release(std::unique_ptr<Buffer> buffer)
+    {
+        if (!buffer)
+            return;
+
+        const std::scoped_lock lock{ _mutex };
+        if (_buffers.size() < _maxPooledBufferCount)
+            _buffers.push_back(std::move(buffer));
+    }
+
+    std::size_t TranscodingBufferPool::getPooledBufferCount() const
+    {
+        const std::scoped_lock lock{ _mutex };
+        return _buffers.size();
+    }
+} // namespace Av::Transcoding
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Av::Transcoding
+{
+    // Read buffers shared by all the transcoding streams
+    class TranscodingBufferPool
+    {
+    public:
+        static constexpr std::size_t bufferSize{ 262'144 };
+        using Buffer = std::array<std::byte, bufferSize>;
+
+        static TranscodingBufferPool& getInstance();
+
+        TranscodingBufferPool(std::size_t maxPooledBufferCount);
+
+        TranscodingBufferPool(const TranscodingBufferPool&) = delete;
+        TranscodingBufferPool& operator=(const TranscodingBufferPool&) = delete;
+
+        std::unique_ptr<Buffer> acquire();
+        void release(std::unique_ptr<Buffer> buffer);
+
+        std::size_t getPooledBufferCount() const;
+
+    private:
+        const std::size_t _maxPooledBufferCount;
+
+        mutable std::mutex _mutex;
+        std::vector<std::unique_ptr<Buffer>> _buffers;
+    };
+} // namespace Av::Transcoding
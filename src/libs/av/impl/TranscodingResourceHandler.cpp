@@ -18,86 +18,354 @@
  */
 
 #include "TranscodingResourceHandler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <utility>
+
+#include "av/TranscodingResourceHandlerCreator.hpp"
+#include "utils/FileResourceHandlerCreator.hpp"
+#include "utils/IConfig.hpp"
 #include "utils/Logger.hpp"
+#include "utils/Service.hpp"
+#include "ClientThroughputs.hpp"
+#include "PreparedStreams.hpp"
+#include "TranscodeMirror.hpp"
 
 namespace Av::Transcoding
 {
     namespace
     {
+        struct ContainerOverhead
+        {
+            std::size_t percent;       // relative to the audio payload
+            std::size_t fixedSize;     // headers, in bytes
+        };
+
+        ContainerOverhead getContainerOverhead(OutputFormat format)
+        {
+            switch (format)
+            {
+            case OutputFormat::MP3:             return { 0, 1024 };        // Xing/Info frame
+            case OutputFormat::OGG_OPUS:        return { 1, 1024 };        // pages, see RFC 7845
+            case OutputFormat::MATROSKA_OPUS:   return { 1, 1024 };        // clusters and blocks
+            case OutputFormat::OGG_VORBIS:      return { 1, 8 * 1024 };    // pages and codebooks in the setup header
+            case OutputFormat::WEBM_VORBIS:     return { 1, 8 * 1024 };
+            }
+
+            return { 0, 0 };
+        }
+
         std::size_t doEstimateContentLength(const InputParameters& inputParameters, const OutputParameters& outputParameters)
         {
-            const std::size_t estimatedContentLength{ outputParameters.bitrate / 8 * static_cast<std::size_t>(std::chrono::duration_cast<std::chrono::milliseconds>(inputParameters.duration).count()) / 1000 };
+            std::chrono::milliseconds duration{ std::max(std::chrono::duration_cast<std::chrono::milliseconds>(inputParameters.duration) - outputParameters.offset, std::chrono::milliseconds{ 0 }) };
+            if (outputParameters.duration)
+                duration = std::min(duration, *outputParameters.duration);
+            const std::size_t payloadSize{ getOutputBitrate(inputParameters, outputParameters) / 8 * static_cast<std::size_t>(duration.count()) / 1000 };
+            const ContainerOverhead overhead{ getContainerOverhead(outputParameters.format) };
+
+            std::size_t estimatedContentLength{ payloadSize + payloadSize * overhead.percent / 100 + overhead.fixedSize };
+            if (!outputParameters.stripMetadata)
+                estimatedContentLength += 4096;  // tags (covers are never sent)
+
             return estimatedContentLength;
         }
+
+        constexpr std::array<char, 65'536> paddingChunk{};
+
+        std::atomic<std::size_t> streamCount{};
+        std::atomic<std::size_t> bufferedByteCount{};
+
+        std::size_t getReadAheadSize()
+        {
+            static const std::size_t readAheadSize{ Service<IConfig>::get()->getULong("transcoding-read-ahead-size", 1024) * 1024 };
+            return readAheadSize;
+        }
     }
 
-    std::unique_ptr<IResourceHandler> createResourceHandler(const InputParameters& inputParameters, const OutputParameters& outputParameters, bool estimateContentLength)
+    std::unique_ptr<IResourceHandler> createResourceHandler(const InputParameters& inputParameters, const OutputParameters& outputParameters, bool estimateContentLength, std::string_view owner, std::string_view throughputKey)
     {
-        return std::make_unique<TranscodingResourceHandler>(inputParameters, outputParameters, estimateContentLength);
+        if (std::unique_ptr<TranscodingResourceHandler> resourceHandler{ PreparedStreams::getInstance().take(PreparedStreams::createKey(inputParameters, outputParameters, estimateContentLength, owner)) })
+        {
+            resourceHandler->setThroughputKey(throughputKey);
+            return resourceHandler;
+        }
+
+        // served with the actual content length and range support
+        if (const TranscodeMirror* transcodeMirror{ TranscodeMirror::getInstance() })
+        {
+            if (const std::optional<std::filesystem::path> entryPath{ transcodeMirror->getEntry(inputParameters, outputParameters) })
+                return createFileResourceHandler(*entryPath, toMimetype(outputParameters.format));
+        }
+
+        std::unique_ptr<TranscodeCache::EntryWriter> cacheEntryWriter;
+        if (TranscodeCache* transcodeCache{ TranscodeCache::getInstance() })
+        {
+            if (const std::optional<std::filesystem::path> entryPath{ transcodeCache->getEntry(inputParameters, outputParameters) })
+                return createFileResourceHandler(*entryPath, toMimetype(outputParameters.format));
+
+            cacheEntryWriter = transcodeCache->createEntryWriter(inputParameters, outputParameters);
+        }
+
+        auto resourceHandler{ std::make_unique<TranscodingResourceHandler>(inputParameters, outputParameters, estimateContentLength, owner, std::move(cacheEntryWriter)) };
+        resourceHandler->setThroughputKey(throughputKey);
+        return resourceHandler;
+    }
+
+    void prepareResourceHandler(const InputParameters& inputParameters, const OutputParameters& outputParameters, bool estimateContentLength, std::string_view owner)
+    {
+        // nothing to prepare, served from the mirror
+        if (const TranscodeMirror* transcodeMirror{ TranscodeMirror::getInstance() })
+        {
+            if (transcodeMirror->getEntry(inputParameters, outputParameters))
+                return;
+        }
+
+        std::unique_ptr<TranscodeCache::EntryWriter> cacheEntryWriter;
+        if (TranscodeCache* transcodeCache{ TranscodeCache::getInstance() })
+        {
+            // nothing to prepare, served from the cache
+            if (transcodeCache->getEntry(inputParameters, outputParameters))
+                return;
+
+            cacheEntryWriter = transcodeCache->createEntryWriter(inputParameters, outputParameters);
+        }
+
+        auto resourceHandler{ std::make_unique<TranscodingResourceHandler>(inputParameters, outputParameters, estimateContentLength, owner, std::move(cacheEntryWriter)) };
+        resourceHandler->startReadAhead();
+        PreparedStreams::getInstance().add(PreparedStreams::createKey(inputParameters, outputParameters, estimateContentLength, owner), std::move(resourceHandler));
     }
 
     // TODO set some nice HTTP return code
 
-    TranscodingResourceHandler::TranscodingResourceHandler(const InputParameters& inputParameters, const OutputParameters& outputParameters, bool estimateContentLength)
+    TranscodingResourceHandler::TranscodingResourceHandler(const InputParameters& inputParameters, const OutputParameters& outputParameters, bool estimateContentLength, std::string_view owner, std::unique_ptr<TranscodeCache::EntryWriter> cacheEntryWriter)
         : _estimatedContentLength{ estimateContentLength ? std::make_optional(doEstimateContentLength(inputParameters, outputParameters)) : std::nullopt }
-        , _transcoder{ inputParameters, outputParameters }
+        , _outputBitrate{ getOutputBitrate(inputParameters, outputParameters) }
+        , _cacheEntryWriter{ std::move(cacheEntryWriter) }
+        , _admissionSlot{ TranscodingAdmission::getInstance().acquireSlot(owner) }
+        , _transcoder{ createTranscoder(inputParameters, outputParameters) }
     {
+        _admissionSlot->bind(*_transcoder);
+        streamCount++;
+
         if (_estimatedContentLength)
             LMS_LOG(TRANSCODING, DEBUG) << "Estimated content length = " << *_estimatedContentLength;
         else
             LMS_LOG(TRANSCODING, DEBUG) << "Not using estimated content length";
     }
 
+    TranscodingResourceHandler::~TranscodingResourceHandler()
+    {
+        recordThroughput();
+
+        // cannot be preempted anymore, and no more read callback after this
+        _admissionSlot.reset();
+        _transcoder.reset();
+
+        bufferedByteCount -= _readyByteCount;
+        for (Chunk& chunk : _readyChunks)
+            TranscodingBufferPool::getInstance().release(std::move(chunk.buffer));
+        TranscodingBufferPool::getInstance().release(std::move(_readBuffer));
+
+        streamCount--;
+    }
+
+    void TranscodingResourceHandler::startReadAhead()
+    {
+        const std::scoped_lock lock{ _mutex };
+        startReadIfNeeded();
+    }
+
     Wt::Http::ResponseContinuation* TranscodingResourceHandler::processRequest(const Wt::Http::Request& /*request*/, Wt::Http::Response& response)
     {
         if (_estimatedContentLength)
             response.setContentLength(*_estimatedContentLength);
-        response.setMimeType(_transcoder.getOutputMimeType());
-        LMS_LOG(TRANSCODING, DEBUG) << "Transcoder finished = " << _transcoder.finished() << ", total served bytes = " << _totalServedByteCount << ", mime type = " << _transcoder.getOutputMimeType();
+        response.setMimeType(_transcoder->getOutputMimeType());
 
-        if (_bytesReadyCount > 0)
+        std::unique_lock lock{ _mutex };
+
+        measureDelivery();
+        const std::size_t previousServedByteCount{ _totalServedByteCount };
+
+        LMS_LOG(TRANSCODING, DEBUG) << "Transcoder finished = " << _transcoder->finished() << ", total served bytes = " << _totalServedByteCount << ", ready bytes = " << _readyByteCount << ", mime type = " << _transcoder->getOutputMimeType();
+
+        // send everything that has been read ahead
+        while (!_readyChunks.empty())
         {
-            LMS_LOG(TRANSCODING, DEBUG) << "Writing " << _bytesReadyCount << " bytes back to client";
+            Chunk chunk{ std::move(_readyChunks.front()) };
+            _readyChunks.pop_front();
+            _readyByteCount -= chunk.size;
+            bufferedByteCount -= chunk.size;
 
-            response.out().write(reinterpret_cast<const char*>(&_buffer[0]), _bytesReadyCount);
-            _totalServedByteCount += _bytesReadyCount;
-            _bytesReadyCount = 0;
+            writeChunk(response, chunk.buffer->data(), chunk.size);
+            TranscodingBufferPool::getInstance().release(std::move(chunk.buffer));
         }
 
-        if (!_transcoder.finished())
+        startReadIfNeeded();
+        if (_readPending)
         {
+            // resumed by the read callback, chunks read ahead meanwhile are sent at once
             Wt::Http::ResponseContinuation* continuation{ response.createContinuation() };
             continuation->waitForMoreData();
-            _transcoder.asyncRead(_buffer.data(), _buffer.size(), [=](std::size_t nbBytesRead)
-                {
-                    LMS_LOG(TRANSCODING, DEBUG) << "Have " << nbBytesRead << " more bytes to send back";
-
-                    assert(_bytesReadyCount == 0);
-                    _bytesReadyCount = nbBytesRead;
-                    continuation->haveMoreData();
-                });
+            _waitingContinuation = continuation;
+            _lastWriteTime = std::chrono::steady_clock::now();
+            _lastWriteByteCount = _totalServedByteCount - previousServedByteCount;
 
             return continuation;
         }
-        else
+
+        // transcoding finished, or output not needed anymore
+        lock.unlock();
+
+        // padding is not part of the cached entry, and the output of a preempted transcoder is truncated
+        if (_cacheEntryWriter)
+        {
+            if (!_admissionSlot->isPreempted())
+                _cacheEntryWriter->commit();
+            _cacheEntryWriter.reset();
+        }
+
+        // pad with 0 if necessary as duration may not be accurate
+        // one chunk per continuation, so that the padding is not buffered all at once
+        if (_estimatedContentLength && *_estimatedContentLength > _totalServedByteCount)
         {
-            // pad with 0 if necessary as duration may not be accurate
-            if (_estimatedContentLength && *_estimatedContentLength > _totalServedByteCount)
+            const std::size_t padSize{ std::min(*_estimatedContentLength - _totalServedByteCount, paddingChunk.size()) };
+
+            LMS_LOG(TRANSCODING, DEBUG) << "Adding " << padSize << " padding bytes";
+
+            response.out().write(paddingChunk.data(), padSize);
+            _totalServedByteCount += padSize;
+
+            if (_totalServedByteCount < *_estimatedContentLength)
             {
-                const std::size_t padSize{ *_estimatedContentLength - _totalServedByteCount };
+                _lastWriteTime = std::chrono::steady_clock::now();
+                _lastWriteByteCount = _totalServedByteCount - previousServedByteCount;
+                return response.createContinuation();
+            }
+        }
 
-                LMS_LOG(TRANSCODING, DEBUG) << "Adding " << padSize << " padding bytes";
+        LMS_LOG(TRANSCODING, DEBUG) << "Transcoding finished. Total served byte count = " << _totalServedByteCount;
 
-                for (std::size_t i{}; i < padSize; ++i)
-                    response.out().put(0);
+        return {};
+    }
 
-                _totalServedByteCount += padSize;
+    bool TranscodingResourceHandler::isOutputNeeded() const
+    {
+        if (_transcoder->finished())
+            return false;
+
+        // keep transcoding only if the output is still needed
+        const bool contentLengthReached{ _estimatedContentLength && _totalServedByteCount + _readyByteCount >= *_estimatedContentLength };
+        return !contentLengthReached || _cacheEntryWriter;
+    }
+
+    void TranscodingResourceHandler::startReadIfNeeded()
+    {
+        if (_readPending || !isOutputNeeded())
+            return;
+
+        // read ahead, but always keep one read in flight if nothing is buffered
+        if (_readyByteCount > 0 && _readyByteCount + TranscodingBufferPool::bufferSize > getReadAheadSize())
+            return;
+
+        _readBuffer = TranscodingBufferPool::getInstance().acquire();
+        _readPending = true;
+        _transcoder->asyncRead(_readBuffer->data(), _readBuffer->size(), [this](std::size_t nbBytesRead)
+            {
+                onReadComplete(nbBytesRead);
+            });
+    }
+
+    void TranscodingResourceHandler::onReadComplete(std::size_t nbBytesRead)
+    {
+        LMS_LOG(TRANSCODING, DEBUG) << "Have " << nbBytesRead << " more bytes to send back";
+
+        Wt::Http::ResponseContinuation* continuation{};
+        {
+            const std::scoped_lock lock{ _mutex };
+
+            assert(_readPending);
+            _readPending = false;
+
+            if (nbBytesRead > 0)
+            {
+                _readyChunks.push_back(Chunk{ std::move(_readBuffer), nbBytesRead });
+                _readyByteCount += nbBytesRead;
+                bufferedByteCount += nbBytesRead;
+            }
+            else
+            {
+                TranscodingBufferPool::getInstance().release(std::move(_readBuffer));
             }
 
-            LMS_LOG(TRANSCODING, DEBUG) << "Transcoding finished. Total served byte count = " << _totalServedByteCount;
+            _dataReadyTime = std::chrono::steady_clock::now();
+            startReadIfNeeded();
+            continuation = std::exchange(_waitingContinuation, nullptr);
         }
 
-        return {};
+        if (continuation)
+            continuation->haveMoreData();
     }
-}
 
+    void TranscodingResourceHandler::measureDelivery()
+    {
+        if (_throughputKey.empty() || _lastWriteByteCount == 0)
+            return;
+
+        // Called once the client has received the previous write and more data is ready
+        // If that data was ready well before, the client was the bottleneck during this interval
+        const auto now{ std::chrono::steady_clock::now() };
+        const auto interval{ now - _lastWriteTime };
+        const auto readyTime{ std::max(_dataReadyTime, _lastWriteTime) };
+        if (now - readyTime >= interval / 4)
+        {
+            _measuredByteCount += _lastWriteByteCount;
+            _measuredDuration += interval;
+        }
+
+        _lastWriteByteCount = 0;
+    }
+
+    void TranscodingResourceHandler::recordThroughput()
+    {
+        // too short to be relevant
+        if (_throughputKey.empty() || _measuredDuration < std::chrono::seconds{ 2 })
+            return;
+
+        const std::size_t throughput{ static_cast<std::size_t>(_measuredByteCount * 8 / std::chrono::duration<double>{ _measuredDuration }.count()) };
+        LMS_LOG(TRANSCODING, DEBUG) << "Delivered throughput = " << throughput << " bps, stream bitrate = " << _outputBitrate;
+
+        ClientThroughputs::getInstance().record(_throughputKey, throughput, _outputBitrate);
+    }
+
+    void TranscodingResourceHandler::writeChunk(Wt::Http::Response& response, const std::byte* data, std::size_t size)
+    {
+        // never send more than the announced content length
+        std::size_t writeCount{ size };
+        if (_estimatedContentLength)
+            writeCount = std::min(writeCount, *_estimatedContentLength - _totalServedByteCount);
+
+        LMS_LOG(TRANSCODING, DEBUG) << "Writing " << writeCount << " bytes back to client";
+        if (writeCount < size)
+            LMS_LOG(TRANSCODING, DEBUG) << "Estimated content length reached, dropping " << size - writeCount << " bytes";
+
+        response.out().write(reinterpret_cast<const char*>(data), writeCount);
+        if (_cacheEntryWriter)
+            _cacheEntryWriter->write(data, size);
+        _totalServedByteCount += writeCount;
+    }
+
+    TranscodingStats getTranscodingStats()
+    {
+        TranscodingStats stats;
+        stats.streamCount = streamCount;
+        stats.bufferedBytes = bufferedByteCount;
+        stats.pooledBufferCount = TranscodingBufferPool::getInstance().getPooledBufferCount();
+        stats.preemptedStreamCount = TranscodingAdmission::getInstance().getPreemptedStreamCount();
+        stats.rejectedStreamCount = TranscodingAdmission::getInstance().getRejectedStreamCount();
+
+        return stats;
+    }
+}
@@ -19,31 +19,81 @@
 
 #pragma once
 
-#include <array>
+#include <chrono>
+#include <deque>
 #include <filesystem>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <string>
+#include <string_view>
 
 #include "av/TranscodingParameters.hpp"
 #include "utils/IResourceHandler.hpp"
-#include "Transcoder.hpp"
+#include "utils/UserActivity.hpp"
+#include "TranscodeCache.hpp"
+#include "TranscodingAdmission.hpp"
+#include "TranscodingBufferPool.hpp"
+#include "ITranscoder.hpp"
 
 namespace Av::Transcoding
 {
     class TranscodingResourceHandler final : public IResourceHandler
     {
     public:
-        TranscodingResourceHandler(const InputParameters& inputParameters, const OutputParameters& outputParameters, bool estimateContentLength);
+        TranscodingResourceHandler(const InputParameters& inputParameters, const OutputParameters& outputParameters, bool estimateContentLength, std::string_view owner, std::unique_ptr<TranscodeCache::EntryWriter> cacheEntryWriter);
+        ~TranscodingResourceHandler() override;
+
+        // starts reading the transcoder output before the first request is processed
+        void startReadAhead();
+
+        // the delivered throughput is recorded for this client once the stream is done
+        void setThroughputKey(std::string_view throughputKey) { _throughputKey = throughputKey; }
 
     private:
         Wt::Http::ResponseContinuation* processRequest(const Wt::Http::Request& request, Wt::Http::Response& reponse) override;
         void abort() override {};
 
-        static constexpr std::size_t _chunkSize{ 262'144 };
-        std::optional<std::size_t> _estimatedContentLength;
-        std::array<std::byte, _chunkSize> _buffer;
-        std::size_t _bytesReadyCount{};
+        // _mutex must be held
+        bool isOutputNeeded() const;
+        void startReadIfNeeded();
+        void writeChunk(Wt::Http::Response& response, const std::byte* data, std::size_t size);
+
+        void onReadComplete(std::size_t nbBytesRead);
+        void measureDelivery();
+        void recordThroughput();
+
+        struct Chunk
+        {
+            std::unique_ptr<TranscodingBufferPool::Buffer> buffer;
+            std::size_t size{};
+        };
+
+        const std::optional<std::size_t> _estimatedContentLength;
+        const std::size_t _outputBitrate;
         std::size_t _totalServedByteCount{};
-        Transcoder _transcoder;
+        std::unique_ptr<TranscodeCache::EntryWriter> _cacheEntryWriter; // tee of the output, if cacheable
+
+        // the transcoder output is read ahead while the client drains the response
+        std::mutex _mutex;
+        std::deque<Chunk> _readyChunks;
+        std::size_t _readyByteCount{};
+        std::unique_ptr<TranscodingBufferPool::Buffer> _readBuffer;
+        bool _readPending{};
+        Wt::Http::ResponseContinuation* _waitingContinuation{};
+        std::chrono::steady_clock::time_point _dataReadyTime; // last time a read completed
+
+        // only the intervals during which the client was slower than the transcoder are measured
+        std::string _throughputKey;
+        std::chrono::steady_clock::time_point _lastWriteTime;
+        std::size_t _lastWriteByteCount{};
+        std::size_t _measuredByteCount{};
+        std::chrono::steady_clock::duration _measuredDuration{};
+
+        // acquired before the transcoder is created, released before it is destroyed
+        std::unique_ptr<TranscodingAdmission::Slot> _admissionSlot;
+        std::unique_ptr<ITranscoder> _transcoder;
+
+        const UserActivity::StreamScope _streamScope;
     };
 }
-
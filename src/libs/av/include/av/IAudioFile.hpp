@@ -77,8 +77,13 @@ namespace Av
         std::size_t     bitrate{};
         DecodingCodec   codec;
         std::string 	codecName;
+        std::size_t     sampleRate{};
+        std::size_t     channelCount{};
     };
 
+    // From the ffmpeg codec name, as reported in StreamInfo::codecName
+    DecodingCodec getDecodingCodec(std::string_view codecName);
+
     class IAudioFile
     {
     public:
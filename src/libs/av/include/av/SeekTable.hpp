@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Types.hpp"
+
+namespace Av
+{
+    // Coarse mapping of track timestamps to byte offsets, used to start transcodes at an offset
+    // without having the demuxer look for the position (VBR files without index, long tracks, etc.)
+    struct SeekPoint
+    {
+        std::chrono::milliseconds   timestamp;
+        std::uint64_t               byteOffset;
+    };
+
+    struct SeekTable
+    {
+        std::string                 formatName; // demuxer to use when reading from a byte offset, empty if no seek point can be used
+        std::vector<SeekPoint>      points; // sorted by timestamp
+    };
+
+    // Only containers made of self-contained frames can be read from an arbitrary byte offset
+    bool isSeekTableSupported(std::string_view codecName); // ffmpeg codec name, as recorded during the scan
+
+    // Demuxes the whole file (no decoding), throws Exception on failure
+    SeekTable computeSeekTable(const std::filesystem::path& trackPath, std::chrono::milliseconds interval);
+
+    // Seek tables are stored in working-dir/cache/seek-tables, and ignored once the track file is modified
+    void storeSeekTable(const std::filesystem::path& trackPath, const SeekTable& seekTable);
+    bool hasSeekTable(const std::filesystem::path& trackPath);
+    std::optional<SeekTable> loadSeekTable(const std::filesystem::path& trackPath);
+
+    // Last seek point at or before offset, none if it is the start of the file
+    std::optional<SeekPoint> findSeekPoint(const SeekTable& seekTable, std::chrono::milliseconds offset);
+}
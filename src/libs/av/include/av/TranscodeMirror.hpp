@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "av/TranscodingParameters.hpp"
+
+namespace Av::Transcoding::Mirror
+{
+	// Optional pre-transcoded copy of the library (or of its most played part), stored in "working-dir/mirror"
+	// Whole tracks requested using one of the "transcode-mirror-formats" are then served as plain files
+	bool isEnabled();
+
+	// in entries: one per mirrored track and format
+	struct SyncStats
+	{
+		std::size_t mirroredCount{};  // up to date entries, including the added ones
+		std::size_t addedCount{};
+		std::size_t removedCount{};   // tracks removed, modified or no longer wanted
+		std::size_t skippedCount{};   // "transcode-mirror-max-size" reached, or sync aborted
+		std::size_t failedCount{};
+	};
+
+	// tracks: in priority order, the last ones are not mirrored once the quota is reached
+	// The entries of the other tracks are removed
+	// Blocking: the tracks are transcoded one at a time on the calling thread (and on ffmpeg processes spawned from it)
+	using ProgressCallback = std::function<void(std::size_t processedTrackCount)>;
+	SyncStats sync(const std::vector<InputParameters>& tracks, const std::atomic<bool>& abort, const ProgressCallback& progressCallback);
+}
@@ -23,6 +23,7 @@
 #include <filesystem>
 #include <optional>
 
+#include "IAudioFile.hpp"
 #include "Types.hpp"
 
 namespace Av::Transcoding
@@ -31,6 +32,8 @@ namespace Av::Transcoding
     {
         std::filesystem::path trackPath;
         std::chrono::milliseconds duration; // used to estimate content length
+        DecodingCodec codec{ DecodingCodec::UNKNOWN }; // codec of the best audio stream, as recorded during the scan
+        std::size_t bitrate{}; // 0 if unknown
     };
 
     enum class OutputFormat
@@ -50,6 +53,7 @@ namespace Av::Transcoding
         std::size_t                 bitrate{ 128000 };
         std::optional<std::size_t>  stream; // Id of the stream to be transcoded (auto detect by default)
         std::chrono::milliseconds   offset{ 0 };
+        std::optional<std::chrono::milliseconds> duration; // max duration of the output (whole track by default)
         bool                        stripMetadata{ true };
     };
 } // namespace Av::Transcoding
@@ -19,7 +19,10 @@
 
 #pragma once
 
+#include <cstddef>
 #include <memory>
+#include <optional>
+#include <string_view>
 
 #include "utils/IResourceHandler.hpp"
 
@@ -28,5 +31,31 @@ namespace Av::Transcoding
 	struct InputParameters;
 	struct OutputParameters;
 
-	std::unique_ptr<IResourceHandler> createResourceHandler(const InputParameters& inputParameters, const OutputParameters& outputParameters, bool estimateContentLength);
+	// owner: identifies the requester (usually the user), to limit its concurrent transcodings (empty if anonymous)
+	// Throws TooManyTranscodingsException if no transcoding slot is available
+	// throughputKey: identifies the client (usually the user and the client name), to measure the throughput the stream is delivered at (empty to disable)
+	std::unique_ptr<IResourceHandler> createResourceHandler(const InputParameters& inputParameters, const OutputParameters& outputParameters, bool estimateContentLength, std::string_view owner, std::string_view throughputKey = {});
+
+	// Starts transcoding ahead of time (next track to be played, etc.): the next call to createResourceHandler
+	// using the same parameters and owner gets the already buffered stream
+	// At most one prepared stream per owner, cancelled if not used within "transcoding-prepared-stream-timeout" seconds
+	void prepareResourceHandler(const InputParameters& inputParameters, const OutputParameters& outputParameters, bool estimateContentLength, std::string_view owner);
+
+	// Measured on the last transcoded stream of a client, only when the client was slower than the transcoder
+	struct ClientThroughput
+	{
+		std::size_t throughput{};	// in bits per second
+		bool keptUp{};				// the client received the stream at least at its bitrate: the actual throughput may be higher
+	};
+	std::optional<ClientThroughput> getClientThroughput(std::string_view throughputKey); // null if unknown or outdated
+
+	struct TranscodingStats
+	{
+		std::size_t streamCount{};          // in progress
+		std::size_t bufferedBytes{};        // read ahead, not sent yet
+		std::size_t pooledBufferCount{};    // available for reuse
+		std::size_t preemptedStreamCount{}; // since startup
+		std::size_t rejectedStreamCount{};  // since startup
+	};
+	TranscodingStats getTranscodingStats();
 }
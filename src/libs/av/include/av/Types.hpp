@@ -28,4 +28,11 @@ namespace Av
     public:
         using LmsException::LmsException;
     };
+
+    // All the transcoding slots are taken, see "transcoding-max-stream-count"
+    class TooManyTranscodingsException : public Exception
+    {
+    public:
+        using Exception::Exception;
+    };
 }
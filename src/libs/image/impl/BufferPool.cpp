@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "BufferPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include "image/IRawImage.hpp"
+
+namespace Image
+{
+	namespace
+	{
+		// Images are usually decoded, resized and encoded on the same thread,
+		// a few slabs per thread are enough to absorb most of the allocations
+		constexpr std::size_t maxSlabCountPerThread {4};
+		constexpr std::size_t maxPooledBytesPerThread {64 * 1024 * 1024};
+
+		std::atomic<std::size_t> pooledBytes {};
+		std::atomic<std::size_t> inUseBytes {};
+		std::atomic<std::size_t> highWaterMark {};
+
+		void
+		updateHighWaterMark()
+		{
+			const std::size_t current {pooledBytes + inUseBytes};
+			std::size_t previous {highWaterMark.load()};
+			while (previous < current && !highWaterMark.compare_exchange_weak(previous, current))
+				;
+		}
+
+		class ThreadSlabs
+		{
+			public:
+				ThreadSlabs() = default;
+				~ThreadSlabs()
+				{
+					while (!_slabs.empty())
+						evictOldest();
+				}
+				ThreadSlabs(const ThreadSlabs&) = delete;
+				ThreadSlabs& operator=(const ThreadSlabs&) = delete;
+
+				// best fit, but do not waste a large slab on a much smaller request
+				unsigned char*
+				take(std::size_t size, std::size_t& capacity)
+				{
+					auto itBest {std::end(_slabs)};
+					for (auto it {std::begin(_slabs)}; it != std::end(_slabs); ++it)
+					{
+						if (it->capacity < size || it->capacity > size * 2)
+							continue;
+
+						if (itBest == std::end(_slabs) || it->capacity < itBest->capacity)
+							itBest = it;
+					}
+
+					if (itBest == std::end(_slabs))
+						return nullptr;
+
+					unsigned char* data {itBest->data};
+					capacity = itBest->capacity;
+					_pooledBytes -= capacity;
+					pooledBytes -= capacity;
+					_slabs.erase(itBest);
+
+					return data;
+				}
+
+				bool
+				give(unsigned char* data, std::size_t capacity)
+				{
+					if (capacity > maxPooledBytesPerThread)
+						return false;
+
+					while (!_slabs.empty() && (_slabs.size() >= maxSlabCountPerThread || _pooledBytes + capacity > maxPooledBytesPerThread))
+						evictOldest();
+
+					_slabs.push_back(Slab {data, capacity});
+					_pooledBytes += capacity;
+					pooledBytes += capacity;
+
+					return true;
+				}
+
+			private:
+				void
+				evictOldest()
+				{
+					const Slab& slab {_slabs.front()};
+					_pooledBytes -= slab.capacity;
+					pooledBytes -= slab.capacity;
+					std::free(slab.data);
+					_slabs.erase(std::begin(_slabs));
+				}
+
+				struct Slab
+				{
+					unsigned char* data;
+					std::size_t capacity;
+				};
+				std::vector<Slab> _slabs;
+				std::size_t _pooledBytes {};
+		};
+
+		thread_local ThreadSlabs threadSlabs;
+	}
+
+	PooledBuffer::PooledBuffer(unsigned char* data, std::size_t capacity)
+		: _data {data}
+		, _capacity {data ? capacity : 0}
+	{
+		inUseBytes += _capacity;
+		updateHighWaterMark();
+	}
+
+	PooledBuffer::~PooledBuffer()
+	{
+		release();
+	}
+
+	PooledBuffer::PooledBuffer(PooledBuffer&& other) noexcept
+		: _data {std::exchange(other._data, nullptr)}
+		, _capacity {std::exchange(other._capacity, 0)}
+	{
+	}
+
+	PooledBuffer&
+	PooledBuffer::operator=(PooledBuffer&& other) noexcept
+	{
+		if (this != &other)
+		{
+			release();
+			_data = std::exchange(other._data, nullptr);
+			_capacity = std::exchange(other._capacity, 0);
+		}
+
+		return *this;
+	}
+
+	void
+	PooledBuffer::release()
+	{
+		if (!_data)
+			return;
+
+		inUseBytes -= _capacity;
+		if (!threadSlabs.give(_data, _capacity))
+			std::free(_data);
+
+		_data = nullptr;
+		_capacity = 0;
+	}
+
+	PooledBuffer
+	allocateBuffer(std::size_t size)
+	{
+		std::size_t capacity {};
+		unsigned char* data {threadSlabs.take(size, capacity)};
+		if (!data)
+		{
+			data = static_cast<unsigned char*>(std::malloc(size));
+			capacity = size;
+		}
+
+		return PooledBuffer {data, capacity};
+	}
+
+	BufferPoolStats
+	getBufferPoolStats()
+	{
+		BufferPoolStats stats;
+		stats.pooledBytes = pooledBytes;
+		stats.inUseBytes = inUseBytes;
+		stats.highWaterMark = highWaterMark;
+
+		return stats;
+	}
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+
+namespace Image
+{
+	// Raw pixel buffer, given back to a per-thread pool on destruction
+	// so that subsequent decode/resize operations can reuse it
+	class PooledBuffer
+	{
+		public:
+			PooledBuffer() = default;
+			PooledBuffer(unsigned char* data, std::size_t capacity); // takes ownership of malloc'ed memory
+			~PooledBuffer();
+			PooledBuffer(const PooledBuffer&) = delete;
+			PooledBuffer& operator=(const PooledBuffer&) = delete;
+			PooledBuffer(PooledBuffer&& other) noexcept;
+			PooledBuffer& operator=(PooledBuffer&& other) noexcept;
+
+			unsigned char* get() const { return _data; }
+			explicit operator bool() const { return _data; }
+
+		private:
+			void release();
+
+			unsigned char* _data {};
+			std::size_t _capacity {};
+	};
+
+	// Returns an empty buffer if allocation fails
+	PooledBuffer allocateBuffer(std::size_t size);
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "image/JPEG.hpp"
+
+namespace Image
+{
+	std::optional<ImageDimensions>
+	readJPEGDimensions(const std::byte* data, std::size_t dataSize)
+	{
+		auto readByte {[&](std::size_t offset) { return std::to_integer<unsigned>(data[offset]); }};
+		auto readUInt16 {[&](std::size_t offset) { return (readByte(offset) << 8) | readByte(offset + 1); }};
+
+		// SOI
+		if (dataSize < 4 || readByte(0) != 0xFF || readByte(1) != 0xD8)
+			return std::nullopt;
+
+		std::size_t offset {2};
+		while (offset + 4 <= dataSize)
+		{
+			if (readByte(offset) != 0xFF)
+				return std::nullopt;
+
+			const unsigned marker {readByte(offset + 1)};
+			if (marker == 0xFF)
+			{
+				// fill byte
+				offset += 1;
+				continue;
+			}
+
+			// standalone markers
+			if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7))
+			{
+				offset += 2;
+				continue;
+			}
+
+			// EOI or SOS: no frame header found before the image data
+			if (marker == 0xD9 || marker == 0xDA)
+				return std::nullopt;
+
+			const std::size_t segmentSize {readUInt16(offset + 2)};
+			if (segmentSize < 2)
+				return std::nullopt;
+
+			// SOFn markers, except DHT (C4), JPG (C8) and DAC (CC)
+			if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+			{
+				// length (2), precision (1), height (2), width (2)
+				if (offset + 9 > dataSize)
+					return std::nullopt;
+
+				const ImageSize height {readUInt16(offset + 5)};
+				const ImageSize width {readUInt16(offset + 7)};
+				if (width == 0 || height == 0)
+					return std::nullopt;
+
+				return ImageDimensions {width, height};
+			}
+
+			offset += 2 + segmentSize;
+		}
+
+		return std::nullopt;
+	}
+}
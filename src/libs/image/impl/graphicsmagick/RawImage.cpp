@@ -22,19 +22,20 @@
 #include <magick/resource.h>
 
 #include "JPEGImage.hpp"
+#include "WebPImage.hpp"
 #include "image/Exception.hpp"
 #include "utils/Logger.hpp"
 
 namespace Image
 {
-	std::unique_ptr<IRawImage> decodeImage(const std::byte* encodedData, std::size_t encodedDataSize)
+	std::unique_ptr<IRawImage> decodeImage(const std::byte* encodedData, std::size_t encodedDataSize, std::optional<ImageSize> targetWidth)
 	{
-		return std::make_unique<GraphicsMagick::RawImage>(encodedData, encodedDataSize);
+		return std::make_unique<GraphicsMagick::RawImage>(encodedData, encodedDataSize, targetWidth);
 	}
 
-	std::unique_ptr<IRawImage> decodeImage(const std::filesystem::path& path)
+	std::unique_ptr<IRawImage> decodeImage(const std::filesystem::path& path, std::optional<ImageSize> targetWidth)
 	{
-		return std::make_unique<GraphicsMagick::RawImage>(path);
+		return std::make_unique<GraphicsMagick::RawImage>(path, targetWidth);
 	}
 
 	void
@@ -54,15 +55,47 @@ namespace Image
 		LMS_LOG(COVER, INFO) << "Magick threads resource limit = " << GetMagickResourceLimit(MagickLib::ThreadsResource);
 		LMS_LOG(COVER, INFO) << "Magick Disk resource limit = " << GetMagickResourceLimit(MagickLib::DiskResource);
 	}
+
+	bool
+	isEncodingFormatSupported(EncodingFormat format)
+	{
+		switch (format)
+		{
+			case EncodingFormat::JPEG:
+				return true;
+
+			case EncodingFormat::WebP:
+			{
+				// depends on the delegates GraphicsMagick has been built with
+				static const bool isWebPSupported {[]
+				{
+					try
+					{
+						return Magick::CoderInfo {"WEBP"}.isWritable();
+					}
+					catch (Magick::Exception&)
+					{
+						return false;
+					}
+				}()};
+
+				return isWebPSupported;
+			}
+		}
+
+		return false;
+	}
 }
 
 namespace Image::GraphicsMagick
 {
 
-RawImage::RawImage(const std::byte* encodedData, std::size_t encodedDataSize)
+RawImage::RawImage(const std::byte* encodedData, std::size_t encodedDataSize, std::optional<ImageSize> targetWidth)
 {
 	try
 	{
+		setSizeHint(targetWidth);
+
 		Magick::Blob blob {encodedData, encodedDataSize};
 		_image.read(blob);
 	}
@@ -82,10 +115,12 @@ RawImage::RawImage(const std::byte* encodedData, std::size_t encodedDataSize)
 	}
 }
 
-RawImage::RawImage(const std::filesystem::path& p)
+RawImage::RawImage(const std::filesystem::path& p, std::optional<ImageSize> targetWidth)
 {
 	try
 	{
+		setSizeHint(targetWidth);
+
 		_image.read(p.string().c_str());
 	}
 	catch (Magick::WarningCoder& e)
@@ -104,6 +139,14 @@ RawImage::RawImage(const std::filesystem::path& p)
 	}
 }
 
+void
+RawImage::setSizeHint(std::optional<ImageSize> targetWidth)
+{
+	// used by the JPEG coder to decode using DCT scaling
+	if (targetWidth)
+		_image.size(Magick::Geometry {static_cast<unsigned int>(*targetWidth), static_cast<unsigned int>(*targetWidth)});
+}
+
 void
 RawImage::resize(ImageSize width)
 {
@@ -119,9 +162,17 @@ RawImage::resize(ImageSize width)
 }
 
 std::unique_ptr<IEncodedImage>
-RawImage::encodeToJPEG(unsigned quality) const
+RawImage::encode(EncodingFormat format, unsigned quality) const
 {
-	return std::make_unique<JPEGImage>(*this, quality);
+	switch (format)
+	{
+		case EncodingFormat::JPEG:
+			return std::make_unique<JPEGImage>(*this, quality);
+		case EncodingFormat::WebP:
+			return std::make_unique<WebPImage>(*this, quality);
+	}
+
+	throw ImageException {"Unsupported encoding format!"};
 }
 
 Magick::Image
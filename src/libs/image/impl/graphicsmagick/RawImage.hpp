@@ -27,6 +27,7 @@
 
 #include <cstddef>
 #include <filesystem>
+#include <optional>
 
 #include "image/IEncodedImage.hpp"
 #include "image/IRawImage.hpp"
@@ -36,14 +37,16 @@ namespace Image::GraphicsMagick
 	class RawImage : public IRawImage
 	{
 		public:
-			RawImage(const std::byte* encodedData, std::size_t encodedDataSize);
-			RawImage(const std::filesystem::path& path);
+			RawImage(const std::byte* encodedData, std::size_t encodedDataSize, std::optional<ImageSize> targetWidth);
+			RawImage(const std::filesystem::path& path, std::optional<ImageSize> targetWidth);
 
 			void resize(ImageSize width) override;
-			std::unique_ptr<IEncodedImage> encodeToJPEG(unsigned quality) const override;
+			std::unique_ptr<IEncodedImage> encode(EncodingFormat format, unsigned quality) const override;
 
 		private:
 			friend class JPEGImage;
+			friend class WebPImage;
+			void setSizeHint(std::optional<ImageSize> targetWidth);
 			Magick::Image getMagickImage() const;
 
 			Magick::Image _image;
@@ -28,44 +28,172 @@
 #include <stb_image.h>
 #include <stb_image_resize.h>
 
+#if LMS_SUPPORT_IMAGE_TURBOJPEG
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <turbojpeg.h>
+#endif
+
 #include "JPEGImage.hpp"
+#if LMS_SUPPORT_IMAGE_WEBP
+#include "WebPImage.hpp"
+#endif
 
 #include "image/Exception.hpp"
+#include "utils/Logger.hpp"
 
 namespace Image
 {
-	std::unique_ptr<IRawImage> decodeImage(const std::byte* encodedData, std::size_t encodedDataSize)
+	std::unique_ptr<IRawImage> decodeImage(const std::byte* encodedData, std::size_t encodedDataSize, std::optional<ImageSize> targetWidth)
 	{
-		return std::make_unique<STB::RawImage>(encodedData, encodedDataSize);
+		return std::make_unique<STB::RawImage>(encodedData, encodedDataSize, targetWidth);
 	}
 
-	std::unique_ptr<IRawImage> decodeImage(const std::filesystem::path& path)
+	std::unique_ptr<IRawImage> decodeImage(const std::filesystem::path& path, std::optional<ImageSize> targetWidth)
 	{
-		return std::make_unique<STB::RawImage>(path);
+		return std::make_unique<STB::RawImage>(path, targetWidth);
 	}
 
 	void
 	init(const std::filesystem::path&)
 	{
 	}
+
+	bool
+	isEncodingFormatSupported(EncodingFormat format)
+	{
+		switch (format)
+		{
+			case EncodingFormat::JPEG:
+				return true;
+			case EncodingFormat::WebP:
+#if LMS_SUPPORT_IMAGE_WEBP
+				return true;
+#else
+				return false;
+#endif
+		}
+
+		return false;
+	}
 }
 
 namespace Image::STB
 {
-	RawImage::RawImage(const std::byte* encodedData, std::size_t encodedDataSize)
+#if LMS_SUPPORT_IMAGE_TURBOJPEG
+	namespace
 	{
+		bool isJPEG(const std::byte* encodedData, std::size_t encodedDataSize)
+		{
+			return encodedDataSize >= 3
+				&& encodedData[0] == std::byte {0xFF}
+				&& encodedData[1] == std::byte {0xD8}
+				&& encodedData[2] == std::byte {0xFF};
+		}
+
+		struct TurboJPEGDecompressor
+		{
+			TurboJPEGDecompressor() : handle {tjInitDecompress()} {}
+			~TurboJPEGDecompressor() { if (handle) tjDestroy(handle); }
+			TurboJPEGDecompressor(const TurboJPEGDecompressor&) = delete;
+			TurboJPEGDecompressor& operator=(const TurboJPEGDecompressor&) = delete;
+
+			tjhandle handle;
+		};
+	}
+
+	bool
+	RawImage::decodeScaledJPEG(const std::byte* encodedData, std::size_t encodedDataSize, ImageSize targetWidth)
+	{
+		TurboJPEGDecompressor decompressor;
+		if (!decompressor.handle)
+			return false;
+
+		const unsigned char* jpegData {reinterpret_cast<const unsigned char*>(encodedData)};
+		int width, height, subsamp, colorspace;
+		if (tjDecompressHeader3(decompressor.handle, jpegData, encodedDataSize, &width, &height, &subsamp, &colorspace) != 0)
+			return false;
+
+		// pick the smallest DCT scaling factor that keeps the largest side at least targetWidth
+		int scalingFactorCount;
+		const tjscalingfactor* scalingFactors {tjGetScalingFactors(&scalingFactorCount)};
+		if (!scalingFactors)
+			return false;
+
+		int scaledWidth {width};
+		int scaledHeight {height};
+		for (int i {}; i < scalingFactorCount; ++i)
+		{
+			const int candidateWidth {TJSCALED(width, scalingFactors[i])};
+			const int candidateHeight {TJSCALED(height, scalingFactors[i])};
+			if (static_cast<ImageSize>(std::max(candidateWidth, candidateHeight)) < targetWidth)
+				continue;
+
+			if (candidateWidth < scaledWidth)
+			{
+				scaledWidth = candidateWidth;
+				scaledHeight = candidateHeight;
+			}
+		}
+
+		PooledBuffer data {allocateBuffer(static_cast<std::size_t>(scaledWidth) * scaledHeight * 3)};
+		if (!data)
+			return false;
+
+		if (tjDecompress2(decompressor.handle, jpegData, encodedDataSize, data.get(), scaledWidth, 0, scaledHeight, TJPF_RGB, 0) != 0)
+		{
+			LMS_LOG(COVER, DEBUG) << "Cannot decode JPEG using libjpeg-turbo: " << tjGetErrorStr2(decompressor.handle);
+			return false;
+		}
+
+		_data = std::move(data);
+		_width = scaledWidth;
+		_height = scaledHeight;
+
+		return true;
+	}
+#endif
+
+	RawImage::RawImage(const std::byte* encodedData, std::size_t encodedDataSize, std::optional<ImageSize> targetWidth)
+	{
+#if LMS_SUPPORT_IMAGE_TURBOJPEG
+		if (targetWidth && isJPEG(encodedData, encodedDataSize) && decodeScaledJPEG(encodedData, encodedDataSize, *targetWidth))
+			return;
+#else
+		(void)targetWidth;
+#endif
+
 		int n;
-		_data = UniquePtrFree {stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(encodedData), encodedDataSize, &_width, &_height, &n, 3), std::free};
-		if (!_data)
+		unsigned char* data {stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(encodedData), encodedDataSize, &_width, &_height, &n, 3)};
+		if (!data)
 			throw ImageException {"Cannot load image from memory"};
+
+		_data = PooledBuffer {data, static_cast<std::size_t>(_width) * _height * 3};
 	}
 
-	RawImage::RawImage(const std::filesystem::path& p)
+	RawImage::RawImage(const std::filesystem::path& p, std::optional<ImageSize> targetWidth)
 	{
+#if LMS_SUPPORT_IMAGE_TURBOJPEG
+		if (targetWidth)
+		{
+			std::ifstream ifs {p, std::ios::binary};
+			const std::vector<char> encodedData {std::istreambuf_iterator<char> {ifs}, std::istreambuf_iterator<char> {}};
+			const std::byte* data {reinterpret_cast<const std::byte*>(encodedData.data())};
+			if (ifs && isJPEG(data, encodedData.size()) && decodeScaledJPEG(data, encodedData.size(), *targetWidth))
+				return;
+		}
+#else
+		(void)targetWidth;
+#endif
+
 		int n;
-		_data = UniquePtrFree {stbi_load(p.string().c_str(), &_width, &_height, &n, 3), std::free};
-		if (!_data)
+		unsigned char* data {stbi_load(p.string().c_str(), &_width, &_height, &n, 3)};
+		if (!data)
 			throw ImageException {"Cannot load image from memory"};
+
+		_data = PooledBuffer {data, static_cast<std::size_t>(_width) * _height * 3};
 	}
 
 	void
@@ -86,12 +214,12 @@ namespace Image::STB
 			width = (size_t)((float)height/_height*_width);
 		}
 
-		UniquePtrFree resizedData {reinterpret_cast<unsigned char*>(malloc(width*height*3)), std::free};
+		PooledBuffer resizedData {allocateBuffer(width*height*3)};
 		if (!resizedData)
 			throw ImageException {"Cannot allocate memory for resized image!"};
 
-		if (stbir_resize_uint8_srgb(reinterpret_cast<const unsigned char*>(_data.get()), _width, _height, 0,
-					reinterpret_cast<unsigned char*>(resizedData.get()), width, height, 0,
+		if (stbir_resize_uint8_srgb(_data.get(), _width, _height, 0,
+					resizedData.get(), width, height, 0,
 					3, STBIR_ALPHA_CHANNEL_NONE, 0) == 0)
 		{
 			throw ImageException {"Failed to resize image!"};
@@ -103,9 +231,21 @@ namespace Image::STB
 	}
 
 	std::unique_ptr<IEncodedImage>
-	RawImage::encodeToJPEG(unsigned quality) const
+	RawImage::encode(EncodingFormat format, unsigned quality) const
 	{
-		return std::make_unique<JPEGImage>(*this, quality);
+		switch (format)
+		{
+			case EncodingFormat::JPEG:
+				return std::make_unique<JPEGImage>(*this, quality);
+			case EncodingFormat::WebP:
+#if LMS_SUPPORT_IMAGE_WEBP
+				return std::make_unique<WebPImage>(*this, quality);
+#else
+				break;
+#endif
+		}
+
+		throw ImageException {"Unsupported encoding format!"};
 	}
 
 	ImageSize
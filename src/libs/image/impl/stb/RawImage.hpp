@@ -25,30 +25,35 @@
 
 #include <cstddef>
 #include <filesystem>
+#include <optional>
 
 #include "image/IEncodedImage.hpp"
 #include "image/IRawImage.hpp"
+#include "BufferPool.hpp"
 
 namespace Image::STB
 {
 	class RawImage : public IRawImage
 	{
 		public:
-			RawImage(const std::byte* encodedData, std::size_t encodedDataSize);
-			RawImage(const std::filesystem::path& path);
+			RawImage(const std::byte* encodedData, std::size_t encodedDataSize, std::optional<ImageSize> targetWidth);
+			RawImage(const std::filesystem::path& path, std::optional<ImageSize> targetWidth);
 
 			void resize(ImageSize width) override;
-			std::unique_ptr<IEncodedImage> encodeToJPEG(unsigned quality) const override;
+			std::unique_ptr<IEncodedImage> encode(EncodingFormat format, unsigned quality) const override;
 
 			ImageSize getWidth() const;
 			ImageSize getHeight() const;
 			const std::byte* getData() const;
 
 		private:
+#if LMS_SUPPORT_IMAGE_TURBOJPEG
+			bool decodeScaledJPEG(const std::byte* encodedData, std::size_t encodedDataSize, ImageSize targetWidth);
+#endif
+
 			int _width;
 			int _height;
-			using UniquePtrFree = std::unique_ptr<unsigned char, decltype(&std::free)>;
-			UniquePtrFree _data {nullptr, std::free};
+			PooledBuffer _data;
 	};
 }
 
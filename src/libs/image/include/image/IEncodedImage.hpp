@@ -26,6 +26,12 @@ namespace Image
 {
 	using ImageSize = std::size_t;
 
+	enum class EncodingFormat
+	{
+		JPEG,
+		WebP,
+	};
+
 	class IEncodedImage
 	{
 		public:
@@ -19,8 +19,10 @@
 
 #pragma once
 
+#include <cstddef>
 #include <filesystem>
 #include <memory>
+#include <optional>
 
 #include "image/IEncodedImage.hpp"
 
@@ -31,11 +33,24 @@ namespace Image
 		public:
 			virtual ~IRawImage() = default;
 			virtual void resize(ImageSize width) = 0;
-			virtual std::unique_ptr<IEncodedImage> encodeToJPEG(unsigned quality) const = 0;
+			virtual std::unique_ptr<IEncodedImage> encode(EncodingFormat format, unsigned quality) const = 0; // quality from 1 to 100
 	};
 
 	void init(const std::filesystem::path& path);
-	std::unique_ptr<IRawImage> decodeImage(const std::byte* encodedData, std::size_t encodedDataSize);
-	std::unique_ptr<IRawImage> decodeImage(const std::filesystem::path& path);
+	bool isEncodingFormatSupported(EncodingFormat format);
+
+	// Raw pixel buffers are pooled per thread (not used by all backends)
+	struct BufferPoolStats
+	{
+		std::size_t pooledBytes {};		// kept for reuse
+		std::size_t inUseBytes {};		// held by raw images
+		std::size_t highWaterMark {};	// max of pooledBytes + inUseBytes
+	};
+	BufferPoolStats getBufferPoolStats();
+
+	// If set, targetWidth lets the decoder work at a reduced resolution (at least targetWidth on the largest side, when possible)
+	// The image still has to be resized afterwards
+	std::unique_ptr<IRawImage> decodeImage(const std::byte* encodedData, std::size_t encodedDataSize, std::optional<ImageSize> targetWidth = std::nullopt);
+	std::unique_ptr<IRawImage> decodeImage(const std::filesystem::path& path, std::optional<ImageSize> targetWidth = std::nullopt);
 }
 
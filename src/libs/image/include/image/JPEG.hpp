@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <optional>
+
+#include "image/IEncodedImage.hpp"
+
+namespace Image
+{
+	struct ImageDimensions
+	{
+		ImageSize width;
+		ImageSize height;
+	};
+
+	// Reads the dimensions from the JPEG frame header, without decoding the image
+	// Returns nothing if data is not a valid JPEG stream
+	std::optional<ImageDimensions> readJPEGDimensions(const std::byte* data, std::size_t dataSize);
+}
@@ -190,6 +190,12 @@ AvFormatParser::parse(const std::filesystem::path& p, bool debug)
 		track.duration = info.duration;
 		track.bitrate = info.bitrate;
 		track.hasCover = mediaFile->hasAttachedPictures();
+		if (const std::optional<Av::StreamInfo> streamInfo {mediaFile->getBestStreamInfo()})
+		{
+			track.audioCodec = streamInfo->codecName;
+			track.sampleRate = streamInfo->sampleRate;
+			track.channelCount = streamInfo->channelCount;
+		}
 
 		MetaData::Tags tags;
 
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CompositeParser.hpp"
+
+#include "utils/Logger.hpp"
+#include "utils/String.hpp"
+
+namespace MetaData
+{
+    namespace
+    {
+        std::string getExtension(const std::filesystem::path& p)
+        {
+            std::string extension{ p.extension().string() };
+            if (!extension.empty())
+                extension.erase(0, 1); // dot
+
+            StringUtils::stringToLower(extension);
+            return extension;
+        }
+    }
+
+    CompositeParser::CompositeParser(std::unique_ptr<IParser> primaryParser, std::set<std::string> primaryExtensions, std::unique_ptr<IParser> fallbackParser)
+        : _primaryParser{ std::move(primaryParser) }
+        , _primaryExtensions{ std::move(primaryExtensions) }
+        , _fallbackParser{ std::move(fallbackParser) }
+    {
+    }
+
+    std::optional<Track> CompositeParser::parse(const std::filesystem::path& p, bool debug)
+    {
+        return dispatch(p, [&](IParser& parser, Backend)
+            {
+                return parser.parse(p, debug);
+            });
+    }
+
+    std::optional<Track> CompositeParser::parseAndCache(const std::filesystem::path& p, std::vector<unsigned char>& cacheData)
+    {
+        return dispatch(p, [&](IParser& parser, Backend backend)
+            {
+                if (backend == Backend::Primary)
+                    return parser.parseAndCache(p, cacheData);
+
+                // cache data must come from the parser that will decode it
+                cacheData.clear();
+                return parser.parse(p);
+            });
+    }
+
+    std::optional<Track> CompositeParser::parseFromCache(const std::vector<unsigned char>& cacheData)
+    {
+        return _primaryParser->parseFromCache(cacheData);
+    }
+
+    void CompositeParser::setClusterTypeNames(const std::set<std::string>& clusterTypeNames)
+    {
+        IParser::setClusterTypeNames(clusterTypeNames);
+        _primaryParser->setClusterTypeNames(clusterTypeNames);
+        _fallbackParser->setClusterTypeNames(clusterTypeNames);
+    }
+
+    CompositeParser::ExtensionStats CompositeParser::getExtensionStats(std::string_view extension) const
+    {
+        std::scoped_lock lock{ _mutex };
+
+        const auto it{ _extensionStates.find(std::string{ extension }) };
+        return it != std::cend(_extensionStates) ? it->second.stats : ExtensionStats{};
+    }
+
+    template <typename ParseFunc>
+    std::optional<Track> CompositeParser::dispatch(const std::filesystem::path& p, ParseFunc parseFunc)
+    {
+        const std::string extension{ getExtension(p) };
+
+        const Backend backend{ selectBackend(extension) };
+        if (backend == Backend::Primary)
+        {
+            std::optional<Track> track{ parseFunc(*_primaryParser, Backend::Primary) };
+            onParsed(extension, Backend::Primary, track.has_value());
+            if (track)
+                return track;
+
+            LMS_LOG(METADATA, DEBUG) << "File '" << p.string() << "': trying fallback parser";
+        }
+
+        std::optional<Track> track{ parseFunc(*_fallbackParser, Backend::Fallback) };
+        onParsed(extension, Backend::Fallback, track.has_value());
+
+        return track;
+    }
+
+    CompositeParser::Backend CompositeParser::selectBackend(const std::string& extension) const
+    {
+        if (_primaryExtensions.find(extension) == std::cend(_primaryExtensions))
+            return Backend::Fallback;
+
+        std::scoped_lock lock{ _mutex };
+
+        const auto it{ _extensionStates.find(extension) };
+        if (it != std::cend(_extensionStates) && it->second.skipPrimary)
+            return Backend::Fallback;
+
+        return Backend::Primary;
+    }
+
+    void CompositeParser::onParsed(const std::string& extension, Backend backend, bool success)
+    {
+        std::scoped_lock lock{ _mutex };
+
+        ExtensionState& state{ _extensionStates[extension] };
+        switch (backend)
+        {
+        case Backend::Primary:
+            if (success)
+                state.stats.primarySuccessCount++;
+            else
+                state.stats.primaryFailureCount++;
+            break;
+
+        case Backend::Fallback:
+            if (success)
+            {
+                state.stats.fallbackSuccessCount++;
+
+                // the fallback parser is only used on these extensions once the primary parser has failed
+                if (_primaryExtensions.find(extension) != std::cend(_primaryExtensions)
+                    && !state.skipPrimary
+                    && state.stats.primarySuccessCount == 0
+                    && state.stats.fallbackSuccessCount >= primarySkipThreshold)
+                {
+                    state.skipPrimary = true;
+                    LMS_LOG(METADATA, INFO) << "Extension '" << extension << "': primary parser keeps failing, using the fallback parser directly";
+                }
+            }
+            else
+            {
+                state.stats.fallbackFailureCount++;
+            }
+            break;
+        }
+    }
+} // namespace MetaData
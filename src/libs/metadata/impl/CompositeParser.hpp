@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "metadata/IParser.hpp"
+
+namespace MetaData
+{
+	// Sends each file to the cheapest capable parser, according to its extension:
+	// the primary parser is tried first on the extensions it handles, the fallback parser is used otherwise or if it fails
+	// Extensions on which the primary parser keeps failing while the fallback one succeeds are then sent directly to the fallback parser,
+	// so that such files are not opened twice
+	class CompositeParser : public IParser
+	{
+		public:
+			// extensions are lower cased, without the dot
+			CompositeParser(std::unique_ptr<IParser> primaryParser, std::set<std::string> primaryExtensions, std::unique_ptr<IParser> fallbackParser);
+
+			std::optional<Track> parse(const std::filesystem::path& p, bool debug = false) override;
+			std::optional<Track> parseAndCache(const std::filesystem::path& p, std::vector<unsigned char>& cacheData) override;
+			std::optional<Track> parseFromCache(const std::vector<unsigned char>& cacheData) override; // only the primary parser may output cache data
+
+			void setClusterTypeNames(const std::set<std::string>& clusterTypeNames) override;
+
+			// which parser succeeded, for each extension
+			struct ExtensionStats
+			{
+				std::size_t primarySuccessCount {};
+				std::size_t primaryFailureCount {};
+				std::size_t fallbackSuccessCount {};
+				std::size_t fallbackFailureCount {};
+			};
+			ExtensionStats getExtensionStats(std::string_view extension) const;
+
+			// primary failures rescued by the fallback parser before the primary parser is skipped for an extension it never handled
+			static constexpr std::size_t primarySkipThreshold {8};
+
+		private:
+			enum class Backend
+			{
+				Primary,
+				Fallback,
+			};
+
+			template <typename ParseFunc>
+			std::optional<Track> dispatch(const std::filesystem::path& p, ParseFunc parseFunc);
+
+			Backend	selectBackend(const std::string& extension) const;
+			void	onParsed(const std::string& extension, Backend backend, bool success);
+
+			const std::unique_ptr<IParser>	_primaryParser;
+			const std::set<std::string>		_primaryExtensions;
+			const std::unique_ptr<IParser>	_fallbackParser;
+
+			struct ExtensionState
+			{
+				ExtensionStats	stats;
+				bool			skipPrimary {};
+			};
+			mutable std::mutex								_mutex;
+			std::unordered_map<std::string, ExtensionState>	_extensionStates;
+	};
+} // namespace MetaData
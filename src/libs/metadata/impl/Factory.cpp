@@ -19,15 +19,32 @@
 
 #include "metadata/IParser.hpp"
 
+#include <taglib/fileref.h>
+
 #include "utils/Exception.hpp"
 #include "utils/Logger.hpp"
+#include "utils/String.hpp"
 
 #include "AvFormatParser.hpp"
+#include "CompositeParser.hpp"
 #include "TagLibParser.hpp"
 #include "Utils.hpp"
 
 namespace MetaData
 {
+	namespace
+	{
+		std::set<std::string>
+		getTagLibExtensions()
+		{
+			std::set<std::string> extensions;
+			for (const TagLib::String& extension : TagLib::FileRef::defaultFileExtensions())
+				extensions.insert(StringUtils::stringToLower(extension.to8Bit(true)));
+
+			return extensions;
+		}
+	}
+
 	std::unique_ptr<IParser>
 	createParser(ParserType parserType, ParserReadStyle parserReadStyle)
 	{
@@ -39,6 +56,9 @@ namespace MetaData
 			case ParserType::AvFormat:
 				LMS_LOG(METADATA, INFO) << "Creating AvFormat parser";
 				return std::make_unique<AvFormatParser>();
+			case ParserType::TagLibWithAvFormatFallback:
+				LMS_LOG(METADATA, INFO) << "Creating TagLib parser with read style = " << Utils::readStyleToString(parserReadStyle) << ", with AvFormat fallback";
+				return std::make_unique<CompositeParser>(std::make_unique<TagLibParser>(parserReadStyle), getTagLibExtensions(), std::make_unique<AvFormatParser>());
 		}
 
 		throw LmsException {"Unhandled parser type"};
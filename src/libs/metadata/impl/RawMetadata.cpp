@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RawMetadata.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace MetaData::RawMetadataEncoding
+{
+    namespace
+    {
+        // Layout, in host byte order:
+        // version (u8), duration in ms (u32), bitrate (u32), sample rate (u32), channel count (u16), audio codec (string), has cover (u8)
+        // tag count (u32), then for each tag: name (string), value count (u32), values (strings)
+        // strings are stored as size (u32) and bytes
+        // must be bumped if what is extracted from the files changes, so that the cached data is not used anymore
+        constexpr std::uint8_t formatVersion{ 1 };
+
+        template <typename T>
+        void write(std::vector<unsigned char>& data, T value)
+        {
+            const std::size_t offset{ data.size() };
+            data.resize(offset + sizeof(T));
+            std::memcpy(data.data() + offset, &value, sizeof(T));
+        }
+
+        void writeString(std::vector<unsigned char>& data, const std::string& str)
+        {
+            write(data, static_cast<std::uint32_t>(str.size()));
+            data.insert(std::end(data), std::cbegin(str), std::cend(str));
+        }
+
+        template <typename T>
+        bool read(const std::vector<unsigned char>& data, std::size_t& offset, T& value)
+        {
+            if (data.size() - offset < sizeof(T))
+                return false;
+
+            std::memcpy(&value, data.data() + offset, sizeof(T));
+            offset += sizeof(T);
+            return true;
+        }
+
+        bool readString(const std::vector<unsigned char>& data, std::size_t& offset, std::string& str)
+        {
+            std::uint32_t size{};
+            if (!read(data, offset, size) || data.size() - offset < size)
+                return false;
+
+            str.assign(reinterpret_cast<const char*>(data.data() + offset), size);
+            offset += size;
+            return true;
+        }
+
+        template <typename T>
+        T clampTo(std::size_t value)
+        {
+            return static_cast<T>(std::min<std::size_t>(value, std::numeric_limits<T>::max()));
+        }
+    }
+
+    std::vector<unsigned char> encode(const RawMetadata& metadata)
+    {
+        std::vector<unsigned char> data;
+        write(data, formatVersion);
+
+        write(data, clampTo<std::uint32_t>(static_cast<std::size_t>(std::max<std::chrono::milliseconds::rep>(metadata.duration.count(), 0))));
+        write(data, clampTo<std::uint32_t>(metadata.bitrate));
+        write(data, clampTo<std::uint32_t>(metadata.sampleRate));
+        write(data, clampTo<std::uint16_t>(metadata.channelCount));
+        writeString(data, metadata.audioCodec);
+        write(data, static_cast<std::uint8_t>(metadata.hasCover));
+
+        write(data, static_cast<std::uint32_t>(metadata.tags.size()));
+        for (const auto& [name, values] : metadata.tags)
+        {
+            writeString(data, name);
+            write(data, static_cast<std::uint32_t>(values.size()));
+            for (const std::string& value : values)
+                writeString(data, value);
+        }
+
+        return data;
+    }
+
+    std::optional<RawMetadata> decode(const std::vector<unsigned char>& data)
+    {
+        RawMetadata metadata;
+
+        std::size_t offset{};
+        std::uint8_t version{};
+        if (!read(data, offset, version) || version != formatVersion)
+            return std::nullopt;
+
+        std::uint32_t duration{};
+        std::uint32_t bitrate{};
+        std::uint32_t sampleRate{};
+        std::uint16_t channelCount{};
+        std::uint8_t hasCover{};
+        if (!read(data, offset, duration)
+            || !read(data, offset, bitrate)
+            || !read(data, offset, sampleRate)
+            || !read(data, offset, channelCount)
+            || !readString(data, offset, metadata.audioCodec)
+            || !read(data, offset, hasCover))
+        {
+            return std::nullopt;
+        }
+        metadata.duration = std::chrono::milliseconds{ duration };
+        metadata.bitrate = bitrate;
+        metadata.sampleRate = sampleRate;
+        metadata.channelCount = channelCount;
+        metadata.hasCover = hasCover != 0;
+
+        std::uint32_t tagCount{};
+        if (!read(data, offset, tagCount))
+            return std::nullopt;
+
+        for (std::uint32_t i{}; i < tagCount; ++i)
+        {
+            std::string name;
+            std::uint32_t valueCount{};
+            if (!readString(data, offset, name) || !read(data, offset, valueCount))
+                return std::nullopt;
+
+            // each value takes at least its size
+            if ((data.size() - offset) / sizeof(std::uint32_t) < valueCount)
+                return std::nullopt;
+
+            std::vector<std::string>& values{ metadata.tags[std::move(name)] };
+            values.resize(valueCount);
+            for (std::string& value : values)
+            {
+                if (!readString(data, offset, value))
+                    return std::nullopt;
+            }
+        }
+
+        if (offset != data.size())
+            return std::nullopt;
+
+        return metadata;
+    }
+} // namespace MetaData::RawMetadataEncoding
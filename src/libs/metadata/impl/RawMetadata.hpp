@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace MetaData
+{
+	// Upper cased tag names, along with their trimmed values
+	// TODO use string_views here for values
+	using TagMap = std::map<std::string, std::vector<std::string>, std::less<>>;
+
+	// What the parser extracts from a file, before it is mapped to a Track
+	struct RawMetadata
+	{
+		TagMap						tags;
+		std::chrono::milliseconds	duration {};
+		std::size_t					bitrate {};
+		std::size_t					sampleRate {};
+		std::size_t					channelCount {};
+		std::string					audioCodec;
+		bool						hasCover {};
+	};
+
+	// Compact binary storage of the raw metadata
+	namespace RawMetadataEncoding
+	{
+		std::vector<unsigned char>	encode(const RawMetadata& metadata);
+
+		// Returns std::nullopt if the data is malformed or uses another format version
+		std::optional<RawMetadata>	decode(const std::vector<unsigned char>& data);
+	}
+} // namespace MetaData
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TagLibIOStream.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils/Logger.hpp"
+
+namespace MetaData
+{
+    ReadAheadIOStream::ReadAheadIOStream(const std::filesystem::path& path)
+        : _path{ path.string() }
+    {
+        _fd = ::open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (_fd < 0)
+        {
+            LMS_LOG(METADATA, ERROR) << "Cannot open file '" << _path << "': " << std::strerror(errno);
+            return;
+        }
+
+        struct stat fileStat;
+        if (::fstat(_fd, &fileStat) != 0)
+        {
+            LMS_LOG(METADATA, ERROR) << "Cannot stat file '" << _path << "': " << std::strerror(errno);
+            ::close(_fd);
+            _fd = -1;
+            return;
+        }
+        _fileSize = static_cast<std::size_t>(fileStat.st_size);
+
+        // Tags are located at the head and at the tail of the file
+        ::posix_fadvise(_fd, 0, windowSize, POSIX_FADV_WILLNEED);
+        if (_fileSize > windowSize)
+            ::posix_fadvise(_fd, _fileSize - windowSize, windowSize, POSIX_FADV_WILLNEED);
+    }
+
+    ReadAheadIOStream::~ReadAheadIOStream()
+    {
+        if (_fd >= 0)
+            ::close(_fd);
+    }
+
+    TagLib::FileName ReadAheadIOStream::name() const
+    {
+        return _path.c_str();
+    }
+
+    TagLib::ByteVector ReadAheadIOStream::readBlock(TagLibSize length)
+    {
+        if (!isOpen() || _position >= _fileSize)
+            return {};
+
+        const std::size_t size{ std::min(static_cast<std::size_t>(length), _fileSize - _position) };
+        TagLib::ByteVector res(static_cast<unsigned int>(size), 0);
+
+        std::size_t copied{};
+        while (copied < size)
+        {
+            const std::size_t offset{ _position + copied };
+            const std::size_t remaining{ size - copied };
+
+            // Large blocks (covers, audio frames) are read at once, bypassing the windows
+            const Window* window{ findWindow(offset) };
+            if (!window && remaining >= windowSize)
+            {
+                copied += readAt(offset, res.data() + copied, remaining);
+                break;
+            }
+
+            if (!window)
+                window = &fillWindow(offset);
+
+            if (offset >= window->offset + window->data.size())
+                break; // short read, file truncated?
+
+            const std::size_t available{ std::min(remaining, window->offset + window->data.size() - offset) };
+            std::memcpy(res.data() + copied, window->data.data() + (offset - window->offset), available);
+            copied += available;
+        }
+
+        if (copied < size)
+            res.resize(static_cast<unsigned int>(copied));
+
+        _position += copied;
+        return res;
+    }
+
+    void ReadAheadIOStream::writeBlock(const TagLib::ByteVector&)
+    {
+    }
+
+    void ReadAheadIOStream::insert(const TagLib::ByteVector&, TagLibOffset, TagLibSize)
+    {
+    }
+
+    void ReadAheadIOStream::removeBlock(TagLibOffset, TagLibSize)
+    {
+    }
+
+    bool ReadAheadIOStream::readOnly() const
+    {
+        return true;
+    }
+
+    bool ReadAheadIOStream::isOpen() const
+    {
+        return _fd >= 0;
+    }
+
+    void ReadAheadIOStream::seek(TagLibOffset offset, Position p)
+    {
+        TagLibOffset position{};
+        switch (p)
+        {
+        case Beginning: position = offset; break;
+        case Current: position = static_cast<TagLibOffset>(_position) + offset; break;
+        case End: position = static_cast<TagLibOffset>(_fileSize) + offset; break;
+        }
+
+        // seeking past the end is allowed, further reads just return nothing
+        _position = static_cast<std::size_t>(std::max<TagLibOffset>(position, 0));
+    }
+
+    TagLibOffset ReadAheadIOStream::tell() const
+    {
+        return static_cast<TagLibOffset>(_position);
+    }
+
+    TagLibOffset ReadAheadIOStream::length()
+    {
+        return static_cast<TagLibOffset>(_fileSize);
+    }
+
+    void ReadAheadIOStream::truncate(TagLibOffset)
+    {
+    }
+
+    const ReadAheadIOStream::Window* ReadAheadIOStream::findWindow(std::size_t offset)
+    {
+        for (Window& window : _windows)
+        {
+            if (offset >= window.offset && offset < window.offset + window.data.size())
+            {
+                window.lastUse = ++_useCount;
+                return &window;
+            }
+        }
+
+        return nullptr;
+    }
+
+    const ReadAheadIOStream::Window& ReadAheadIOStream::fillWindow(std::size_t offset)
+    {
+        Window& window{ *std::min_element(std::begin(_windows), std::end(_windows), [](const Window& a, const Window& b) { return a.lastUse < b.lastUse; }) };
+
+        // Near the end, keep the whole tail in the window since TagLib reads backwards from there
+        window.offset = (offset + windowSize > _fileSize) ? (_fileSize > windowSize ? _fileSize - windowSize : 0) : offset;
+        window.data.resize(std::min(windowSize, _fileSize - window.offset));
+        window.data.resize(readAt(window.offset, window.data.data(), window.data.size()));
+        window.lastUse = ++_useCount;
+
+        return window;
+    }
+
+    std::size_t ReadAheadIOStream::readAt(std::size_t offset, char* buffer, std::size_t size)
+    {
+        std::size_t readSize{};
+        while (readSize < size)
+        {
+            _readCount++;
+            const ssize_t res{ ::pread(_fd, buffer + readSize, size - readSize, static_cast<off_t>(offset + readSize)) };
+            if (res < 0 && errno == EINTR)
+                continue;
+
+            if (res < 0)
+            {
+                LMS_LOG(METADATA, ERROR) << "Cannot read file '" << _path << "': " << std::strerror(errno);
+                break;
+            }
+            if (res == 0)
+                break;
+
+            readSize += static_cast<std::size_t>(res);
+        }
+
+        return readSize;
+    }
+} // namespace MetaData
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <taglib/taglib.h>
+#include <taglib/tiostream.h>
+
+namespace MetaData
+{
+
+#if TAGLIB_MAJOR_VERSION >= 2
+using TagLibOffset = TagLib::offset_t;
+using TagLibSize = std::size_t;
+#else
+using TagLibOffset = long;
+using TagLibSize = unsigned long;
+#endif
+
+// Read only stream that fetches the file using a few large read-ahead windows
+// TagLib does many small reads and seeks, mostly around the head and the tail of the file: they are served from the windows
+class ReadAheadIOStream : public TagLib::IOStream
+{
+	public:
+		static constexpr std::size_t windowSize {256 * 1024};
+
+		ReadAheadIOStream(const std::filesystem::path& path);
+		~ReadAheadIOStream() override;
+
+		ReadAheadIOStream(const ReadAheadIOStream&) = delete;
+		ReadAheadIOStream(ReadAheadIOStream&&) = delete;
+		ReadAheadIOStream& operator=(const ReadAheadIOStream&) = delete;
+		ReadAheadIOStream& operator=(ReadAheadIOStream&&) = delete;
+
+		TagLib::FileName name() const override;
+		TagLib::ByteVector readBlock(TagLibSize length) override;
+		void writeBlock(const TagLib::ByteVector& data) override;
+		void insert(const TagLib::ByteVector& data, TagLibOffset start = 0, TagLibSize replace = 0) override;
+		void removeBlock(TagLibOffset start = 0, TagLibSize length = 0) override;
+		bool readOnly() const override;
+		bool isOpen() const override;
+		void seek(TagLibOffset offset, Position p = Beginning) override;
+		TagLibOffset tell() const override;
+		TagLibOffset length() override;
+		void truncate(TagLibOffset length) override;
+
+		std::size_t getReadCount() const { return _readCount; } // actual reads from the file
+
+	private:
+		struct Window
+		{
+			std::size_t			offset {};
+			std::vector<char>	data;
+			std::size_t			lastUse {};
+		};
+
+		const Window*	findWindow(std::size_t offset);
+		const Window&	fillWindow(std::size_t offset);
+		std::size_t		readAt(std::size_t offset, char* buffer, std::size_t size);
+
+		const std::string		_path;
+		int						_fd {-1};
+		std::size_t				_fileSize {};
+		std::size_t				_position {};
+		std::array<Window, 2>	_windows; // usually one for the head and one for the tail
+		std::size_t				_useCount {};
+		std::size_t				_readCount {};
+};
+
+} // namespace MetaData
@@ -19,6 +19,8 @@
 
 #include "TagLibParser.hpp"
 
+#include <algorithm>
+#include <array>
 #include <map>
 
 #include <taglib/apetag.h>
@@ -40,14 +42,167 @@
 #include "utils/Logger.hpp"
 #include "utils/Service.hpp"
 #include "utils/String.hpp"
+#include "RawMetadata.hpp"
+#include "TagLibIOStream.hpp"
 #include "Utils.hpp"
 
 namespace MetaData
 {
     namespace
     {
-        // TODO use string_views here for values
-        using TagMap = std::map<std::string, std::vector<std::string>>;
+        // ffmpeg codec names, so that they can be compared to what libavformat reports
+        std::string getAudioCodec(TagLib::File& file)
+        {
+            if (const auto* mp3File{ dynamic_cast<TagLib::MPEG::File*>(&file) })
+            {
+                switch (mp3File->audioProperties()->layer())
+                {
+                case 1: return "mp1";
+                case 2: return "mp2";
+                case 3: return "mp3";
+                }
+            }
+            else if (dynamic_cast<TagLib::FLAC::File*>(&file))
+                return "flac";
+            else if (dynamic_cast<TagLib::Ogg::Vorbis::File*>(&file))
+                return "vorbis";
+            else if (dynamic_cast<TagLib::Ogg::Opus::File*>(&file))
+                return "opus";
+            else if (dynamic_cast<TagLib::WavPack::File*>(&file))
+                return "wavpack";
+            else if (const auto* mp4File{ dynamic_cast<TagLib::MP4::File*>(&file) })
+            {
+                switch (mp4File->audioProperties()->codec())
+                {
+                case TagLib::MP4::Properties::AAC: return "aac";
+                case TagLib::MP4::Properties::ALAC: return "alac";
+                case TagLib::MP4::Properties::Unknown: break;
+                }
+            }
+            else if (const auto* asfFile{ dynamic_cast<TagLib::ASF::File*>(&file) })
+            {
+                switch (asfFile->audioProperties()->codec())
+                {
+                case TagLib::ASF::Properties::WMA1: return "wmav1";
+                case TagLib::ASF::Properties::WMA2: return "wmav2";
+                case TagLib::ASF::Properties::WMA9Pro: return "wmapro";
+                case TagLib::ASF::Properties::WMA9Lossless: return "wmalossless";
+                case TagLib::ASF::Properties::Unknown: break;
+                }
+            }
+            else if (const auto* mpcFile{ dynamic_cast<TagLib::MPC::File*>(&file) })
+            {
+                switch (mpcFile->audioProperties()->mpcVersion())
+                {
+                case 7: return "musepack7";
+                case 8: return "musepack8";
+                }
+            }
+
+            return {};
+        }
+
+        // Tags read by the parser, other tags are only kept if they are requested as cluster types
+        constexpr std::array<std::string_view, 71> knownTags
+        {
+            "ACOUSTID_ID",
+            "ALBUM",
+            "ALBUMARTIST",
+            "ALBUMARTISTS",
+            "ALBUMARTISTSORT",
+            "ALBUMARTISTSSORT",
+            "ARTIST",
+            "ARTISTS",
+            "ARTISTSORT",
+            "COMPOSER",
+            "COMPOSERS",
+            "COMPOSERSORT",
+            "COMPOSERSSORT",
+            "CONDUCTOR",
+            "CONDUCTORS",
+            "CONDUCTORSORT",
+            "CONDUCTORSSORT",
+            "COPYRIGHT",
+            "COPYRIGHTURL",
+            "DATE",
+            "DISCNUMBER",
+            "DISCSUBTITLE",
+            "DISCTOTAL",
+            "LYRICIST",
+            "LYRICISTS",
+            "LYRICISTSORT",
+            "LYRICISTSSORT",
+            "MEDIA",
+            "METADATA_BLOCK_PICTURE",
+            "MIXER",
+            "MIXERS",
+            "MIXERSORT",
+            "MIXERSSORT",
+            "MUSICBRAINZ ALBUM ARTIST ID",
+            "MUSICBRAINZ ALBUM ID",
+            "MUSICBRAINZ ALBUM TYPE",
+            "MUSICBRAINZ ARTIST ID",
+            "MUSICBRAINZ RELEASE TRACK ID",
+            "MUSICBRAINZ TRACK ID",
+            "MUSICBRAINZ/ALBUM ARTIST ID",
+            "MUSICBRAINZ/ALBUM ID",
+            "MUSICBRAINZ/ALBUM TYPE",
+            "MUSICBRAINZ/ARTIST ID",
+            "MUSICBRAINZ/RELEASE TRACK ID",
+            "MUSICBRAINZ/TRACK ID",
+            "MUSICBRAINZ_ALBUMARTISTID",
+            "MUSICBRAINZ_ALBUMID",
+            "MUSICBRAINZ_ALBUMTYPE",
+            "MUSICBRAINZ_ARTISTID",
+            "MUSICBRAINZ_RELEASETRACKID",
+            "MUSICBRAINZ_TRACKID",
+            "ORIGINALDATE",
+            "ORIGINALYEAR",
+            "PERFORMER",
+            "PERFORMERS",
+            "PRODUCER",
+            "PRODUCERS",
+            "PRODUCERSORT",
+            "PRODUCERSSORT",
+            "RELEASETYPE",
+            "REMIXER",
+            "REMIXERS",
+            "REMIXERSORT",
+            "REMIXERSSORT",
+            "REPLAYGAIN_ALBUM_GAIN",
+            "REPLAYGAIN_TRACK_GAIN",
+            "SETSUBTITLE",
+            "TITLE",
+            "TRACKNUMBER",
+            "TRACKTOTAL",
+            "YEAR",
+        };
+
+        constexpr bool isSorted(const std::array<std::string_view, knownTags.size()>& tags)
+        {
+            for (std::size_t i{ 1 }; i < tags.size(); ++i)
+            {
+                if (!(tags[i - 1] < tags[i]))
+                    return false;
+            }
+            return true;
+        }
+        static_assert(isSorted(knownTags), "knownTags must be sorted");
+
+        bool isKnownTag(std::string_view tag)
+        {
+            return std::binary_search(std::cbegin(knownTags), std::cend(knownTags), tag);
+        }
+
+        void toUpper(std::string& str)
+        {
+            // same as TagLib::String::upper, ASCII only
+            for (char& c : str)
+            {
+                if (c >= 'a' && c <= 'z')
+                    c = static_cast<char>(c - 'a' + 'A');
+            }
+        }
 
         template<typename T>
         std::vector<T> getPropertyValuesFirstMatchAs(const TagMap& tags, std::initializer_list<std::string_view> keys)
@@ -56,7 +211,7 @@ namespace MetaData
 
             for (std::string_view key : keys)
             {
-                const auto itValues{ tags.find(std::string {key}) };
+                const auto itValues{ tags.find(key) };
                 if (itValues == std::cend(tags))
                     continue;
 
@@ -106,9 +261,9 @@ namespace MetaData
 
         std::vector<std::string_view> splitAndTrimString(std::string_view str, std::string_view delimiters)
         {
-            std::vector<std::string_view> strings{ StringUtils::splitString(str, delimiters) };
-            for (std::string_view& s : strings)
-                s = StringUtils::stringTrim(s);
+            std::vector<std::string_view> strings;
+            for (std::string_view token : StringUtils::tokenizeString(str, delimiters))
+                strings.push_back(StringUtils::stringTrim(token));
 
             return strings;
         }
@@ -273,18 +428,35 @@ namespace MetaData
             throw LmsException{ "Cannot convert read style" };
         }
 
-        TagMap constructTagMap(const TagLib::PropertyMap& properties)
+        template <typename TagFilter>
+        TagMap constructTagMap(const TagLib::PropertyMap& properties, TagFilter isTagUsed)
         {
             TagMap tagMap;
 
             for (const auto& [propertyName, propertyValues] : properties)
             {
-                std::vector<std::string>& values{ tagMap[propertyName.upper().to8Bit(true)] };
+                std::string name{ propertyName.to8Bit(true) };
+                toUpper(name);
+                if (!isTagUsed(name))
+                    continue;
+
+                std::vector<std::string>& values{ tagMap[std::move(name)] };
+                values.reserve(propertyValues.size());
                 for (const TagLib::String& propertyValue : propertyValues)
                 {
-                    std::string trimedValue{ StringUtils::stringTrim(propertyValue.to8Bit(true)) };
-                    if (!trimedValue.empty())
-                        values.emplace_back(std::move(trimedValue));
+                    std::string value{ propertyValue.to8Bit(true) };
+
+                    // trim in place
+                    const std::string_view trimedValue{ StringUtils::stringTrim(value) };
+                    if (trimedValue.empty())
+                        continue;
+
+                    if (trimedValue.size() != value.size())
+                    {
+                        value.erase(static_cast<std::size_t>(trimedValue.data() + trimedValue.size() - value.data()));
+                        value.erase(0, static_cast<std::size_t>(trimedValue.data() - value.data()));
+                    }
+                    values.emplace_back(std::move(value));
                 }
             }
 
@@ -385,7 +557,39 @@ namespace MetaData
 
     std::optional<Track> TagLibParser::parse(const std::filesystem::path& p, bool debug)
     {
-        TagLib::FileRef f{ p.string().c_str(),
+        const std::optional<RawMetadata> metadata{ extract(p, debug, debug) };
+        if (!metadata)
+            return std::nullopt;
+
+        return mapTrack(*metadata, debug);
+    }
+
+    std::optional<Track> TagLibParser::parseAndCache(const std::filesystem::path& p, std::vector<unsigned char>& cacheData)
+    {
+        cacheData.clear();
+
+        // keep all the tags, the cluster types may change before the cache is used
+        const std::optional<RawMetadata> metadata{ extract(p, true, false) };
+        if (!metadata)
+            return std::nullopt;
+
+        cacheData = RawMetadataEncoding::encode(*metadata);
+        return mapTrack(*metadata, false);
+    }
+
+    std::optional<Track> TagLibParser::parseFromCache(const std::vector<unsigned char>& cacheData)
+    {
+        const std::optional<RawMetadata> metadata{ RawMetadataEncoding::decode(cacheData) };
+        if (!metadata)
+            return std::nullopt;
+
+        return mapTrack(*metadata, false);
+    }
+
+    std::optional<RawMetadata> TagLibParser::extract(const std::filesystem::path& p, bool keepAllTags, bool debug)
+    {
+        ReadAheadIOStream stream{ p };
+        TagLib::FileRef f{ &stream,
             true, // read audio properties
             _readStyle };
 
@@ -395,12 +599,15 @@ namespace MetaData
             return std::nullopt;
         }
 
-        Track track;
+        RawMetadata metadata;
 
         if (const TagLib::AudioProperties* properties{ f.audioProperties() })
         {
-            track.duration = std::chrono::milliseconds{ properties->lengthInMilliseconds() };
-            track.bitrate = static_cast<std::size_t>(properties->bitrate() * 1000);
+            metadata.duration = std::chrono::milliseconds{ properties->lengthInMilliseconds() };
+            metadata.bitrate = static_cast<std::size_t>(properties->bitrate() * 1000);
+            metadata.sampleRate = static_cast<std::size_t>(properties->sampleRate());
+            metadata.channelCount = static_cast<std::size_t>(properties->channels());
+            metadata.audioCodec = getAudioCodec(*f.file());
         }
         else
         {
@@ -408,14 +615,24 @@ namespace MetaData
             return std::nullopt;
         }
 
-        TagMap tags{ constructTagMap(f.file()->properties()) };
+        // Do not materialize the tags nobody is going to read
+        auto isTagUsed = [&](std::string_view tag)
+            {
+                return keepAllTags
+                    || isKnownTag(tag)
+                    || tag.rfind("PERFORMER:", 0) == 0
+                    || _clusterTypeNames.find(tag) != std::cend(_clusterTypeNames);
+            };
+
+        TagMap& tags{ metadata.tags };
+        tags = constructTagMap(f.file()->properties(), isTagUsed);
 
         auto getAPETags = [&](const TagLib::APE::Tag* apeTag)
             {
                 if (!apeTag)
                     return;
 
-                mergeTagMaps(tags, constructTagMap(apeTag->properties()));
+                mergeTagMaps(tags, constructTagMap(apeTag->properties(), isTagUsed));
             };
 
         // Not that good embedded pictures handling
@@ -427,12 +644,12 @@ namespace MetaData
             if (tag)
             {
                 if (tag->attributeListMap().contains("WM/Picture"))
-                    track.hasCover = true;
+                    metadata.hasCover = true;
 
                 for (const auto& [name, attributeList] : tag->attributeListMap())
                 {
                     std::string strName{ StringUtils::stringToUpper(name.to8Bit(true)) };
-                    if (strName.find("WM/") == 0 || tags.find(strName) != std::cend(tags))
+                    if (strName.find("WM/") == 0 || !isTagUsed(strName) || tags.find(strName) != std::cend(tags))
                         continue;
 
                     std::vector<std::string> attributes;
@@ -460,7 +677,7 @@ namespace MetaData
                 const auto& frameListMap{ mp3File->ID3v2Tag()->frameListMap() };
 
                 if (!frameListMap["APIC"].isEmpty())
-                    track.hasCover = true;
+                    metadata.hasCover = true;
                 if (!frameListMap["TSST"].isEmpty())
                     tags["DISCSUBTITLE"] = { frameListMap["TSST"].front()->toString().to8Bit(true) };
             }
@@ -473,7 +690,7 @@ namespace MetaData
             TagLib::MP4::Item coverItem{ mp4File->tag()->item("covr") };
             TagLib::MP4::CoverArtList coverArtList{ coverItem.toCoverArtList() };
             if (!coverArtList.isEmpty())
-                track.hasCover = true;
+                metadata.hasCover = true;
         }
         // MPC
         else if (TagLib::MPC::File * mpcFile{ dynamic_cast<TagLib::MPC::File*>(f.file()) })
@@ -489,19 +706,34 @@ namespace MetaData
         else if (TagLib::FLAC::File * flacFile{ dynamic_cast<TagLib::FLAC::File*>(f.file()) })
         {
             if (!flacFile->pictureList().isEmpty())
-                track.hasCover = true;
+                metadata.hasCover = true;
         }
         else if (TagLib::Ogg::Vorbis::File * vorbisFile{ dynamic_cast<TagLib::Ogg::Vorbis::File*>(f.file()) })
         {
             if (!vorbisFile->tag()->pictureList().isEmpty())
-                track.hasCover = true;
+                metadata.hasCover = true;
         }
         else if (TagLib::Ogg::Opus::File * opusFile{ dynamic_cast<TagLib::Ogg::Opus::File*>(f.file()) })
         {
             if (!opusFile->tag()->pictureList().isEmpty())
-                track.hasCover = true;
+                metadata.hasCover = true;
         }
 
+        return metadata;
+    }
+
+    Track TagLibParser::mapTrack(const RawMetadata& metadata, bool debug)
+    {
+        const TagMap& tags{ metadata.tags };
+
+        Track track;
+        track.duration = metadata.duration;
+        track.bitrate = metadata.bitrate;
+        track.sampleRate = metadata.sampleRate;
+        track.channelCount = metadata.channelCount;
+        track.audioCodec = metadata.audioCodec;
+        track.hasCover = metadata.hasCover;
+
         track.medium = getMedium(tags);
         track.artists = getArtists(tags, { "ARTISTS", "ARTIST" }, { "ARTISTSORT" }, { "MUSICBRAINZ_ARTISTID", "MUSICBRAINZ ARTIST ID", "MUSICBRAINZ/ARTIST ID" });
         track.conductorArtists = getArtists(tags, { "CONDUCTORS", "CONDUCTOR" }, { "CONDUCTORSSORT", "CONDUCTORSORT" }, {});
@@ -21,6 +21,7 @@
 
 #include <taglib/audioproperties.h>
 #include "metadata/IParser.hpp"
+#include "RawMetadata.hpp"
 
 namespace TagLib
 {
@@ -38,6 +39,11 @@ class TagLibParser : public IParser
 
 	private:
 		std::optional<Track> parse(const std::filesystem::path& p, bool debug = false) override;
+		std::optional<Track> parseAndCache(const std::filesystem::path& p, std::vector<unsigned char>& cacheData) override;
+		std::optional<Track> parseFromCache(const std::vector<unsigned char>& cacheData) override;
+
+		std::optional<RawMetadata> extract(const std::filesystem::path& p, bool keepAllTags, bool debug);
+		Track mapTrack(const RawMetadata& metadata, bool debug);
 		void processTag(Track& track, const std::string& tag, const std::vector<std::string>& values, bool debug);
 
 		const TagLib::AudioProperties::ReadStyle _readStyle;
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "metadata/PictureReader.hpp"
+
+#include <string>
+
+#include <taglib/asffile.h>
+#include <taglib/attachedpictureframe.h>
+#include <taglib/fileref.h>
+#include <taglib/flacfile.h>
+#include <taglib/id3v2tag.h>
+#include <taglib/mp4file.h>
+#include <taglib/mpegfile.h>
+#include <taglib/opusfile.h>
+#include <taglib/vorbisfile.h>
+
+#include "TagLibIOStream.hpp"
+
+namespace MetaData
+{
+    namespace
+    {
+        // Keeps the first picture, unless a front cover shows up later
+        class PictureSelector
+        {
+        public:
+            void add(const TagLib::ByteVector& data, std::string_view mimeType, bool isFrontCover)
+            {
+                if (data.isEmpty() || (!_picture.isEmpty() && (_isFrontCover || !isFrontCover)))
+                    return;
+
+                _picture = data; // implicitly shared, no copy of the picture data
+                _mimeType = mimeType;
+                _isFrontCover = isFrontCover;
+            }
+
+            bool visit(std::function<void(const EmbeddedPicture&)>& visitor) const
+            {
+                if (_picture.isEmpty())
+                    return false;
+
+                visitor(EmbeddedPicture{ reinterpret_cast<const std::byte*>(_picture.data()), _picture.size(), _mimeType });
+                return true;
+            }
+
+        private:
+            TagLib::ByteVector _picture;
+            std::string _mimeType;
+            bool _isFrontCover{};
+        };
+
+        template<typename PictureList>
+        void addXiphPictures(PictureSelector& selector, const PictureList& pictures)
+        {
+            for (const TagLib::FLAC::Picture* picture : pictures)
+                selector.add(picture->data(), picture->mimeType().to8Bit(), picture->type() == TagLib::FLAC::Picture::FrontCover);
+        }
+
+        std::string_view getMP4CoverMimeType(TagLib::MP4::CoverArt::Format format)
+        {
+            switch (format)
+            {
+            case TagLib::MP4::CoverArt::JPEG: return "image/jpeg";
+            case TagLib::MP4::CoverArt::PNG: return "image/png";
+            case TagLib::MP4::CoverArt::BMP: return "image/bmp";
+            case TagLib::MP4::CoverArt::GIF: return "image/gif";
+            default: return "";
+            }
+        }
+    }
+
+    bool visitEmbeddedPicture(const std::filesystem::path& p, std::function<void(const EmbeddedPicture&)> visitor)
+    {
+        ReadAheadIOStream stream{ p };
+        TagLib::FileRef f{ &stream, false /* no audio properties */, TagLib::AudioProperties::Fast };
+        if (f.isNull())
+            return false;
+
+        PictureSelector selector;
+
+        if (TagLib::MPEG::File * mp3File{ dynamic_cast<TagLib::MPEG::File*>(f.file()) })
+        {
+            if (mp3File->ID3v2Tag())
+            {
+                for (const TagLib::ID3v2::Frame* frame : mp3File->ID3v2Tag()->frameListMap()["APIC"])
+                {
+                    if (const auto* pictureFrame{ dynamic_cast<const TagLib::ID3v2::AttachedPictureFrame*>(frame) })
+                        selector.add(pictureFrame->picture(), pictureFrame->mimeType().to8Bit(), pictureFrame->type() == TagLib::ID3v2::AttachedPictureFrame::FrontCover);
+                }
+            }
+        }
+        else if (TagLib::MP4::File * mp4File{ dynamic_cast<TagLib::MP4::File*>(f.file()) })
+        {
+            for (const TagLib::MP4::CoverArt& coverArt : mp4File->tag()->item("covr").toCoverArtList())
+                selector.add(coverArt.data(), getMP4CoverMimeType(coverArt.format()), false);
+        }
+        else if (TagLib::FLAC::File * flacFile{ dynamic_cast<TagLib::FLAC::File*>(f.file()) })
+        {
+            addXiphPictures(selector, flacFile->pictureList());
+        }
+        else if (TagLib::Ogg::Vorbis::File * vorbisFile{ dynamic_cast<TagLib::Ogg::Vorbis::File*>(f.file()) })
+        {
+            addXiphPictures(selector, vorbisFile->tag()->pictureList());
+        }
+        else if (TagLib::Ogg::Opus::File * opusFile{ dynamic_cast<TagLib::Ogg::Opus::File*>(f.file()) })
+        {
+            addXiphPictures(selector, opusFile->tag()->pictureList());
+        }
+        else if (TagLib::ASF::File * asfFile{ dynamic_cast<TagLib::ASF::File*>(f.file()) })
+        {
+            if (const TagLib::ASF::Tag * tag{ asfFile->tag() }; tag && tag->attributeListMap().contains("WM/Picture"))
+            {
+                for (const TagLib::ASF::Attribute& attribute : tag->attributeListMap()["WM/Picture"])
+                {
+                    const TagLib::ASF::Picture picture{ attribute.toPicture() };
+                    if (picture.isValid())
+                        selector.add(picture.picture(), picture.mimeType().to8Bit(), picture.type() == TagLib::ASF::Picture::FrontCover);
+                }
+            }
+        }
+
+        return selector.visit(visitor);
+    }
+}
@@ -106,6 +106,9 @@ namespace MetaData
         Tags						tags;
         std::chrono::milliseconds 	duration{};
         std::size_t                 bitrate{};
+        std::string                 audioCodec; // ffmpeg codec name, empty if unknown
+        std::size_t                 sampleRate{};
+        std::size_t                 channelCount{};
         Wt::WDate					date;
         Wt::WDate					originalDate;
         bool						hasCover{};
@@ -131,16 +134,25 @@ namespace MetaData
 
         virtual std::optional<Track> parse(const std::filesystem::path& p, bool debug = false) = 0;
 
-        void setClusterTypeNames(const std::set<std::string>& clusterTypeNames) { _clusterTypeNames = clusterTypeNames; }
+        // Same as parse, also outputs everything extracted from the file (including all the tags) in an opaque format
+        // cacheData is left empty if the parser does not support caching
+        virtual std::optional<Track> parseAndCache(const std::filesystem::path& p, std::vector<unsigned char>& cacheData) { cacheData.clear(); return parse(p); }
+
+        // Maps data previously output by parseAndCache, using the current cluster type names, without reading the file
+        // std::nullopt if the data cannot be used (malformed, older format...)
+        virtual std::optional<Track> parseFromCache(const std::vector<unsigned char>& /* cacheData */) { return std::nullopt; }
+
+        virtual void setClusterTypeNames(const std::set<std::string>& clusterTypeNames) { _clusterTypeNames = { std::cbegin(clusterTypeNames), std::cend(clusterTypeNames) }; }
 
     protected:
-        std::set<std::string> _clusterTypeNames;
+        std::set<std::string, std::less<>> _clusterTypeNames;
     };
 
     enum class ParserType
     {
         TagLib,
         AvFormat,
+        TagLibWithAvFormatFallback, // AvFormat is used on the formats TagLib cannot handle, or if TagLib fails
     };
 
     enum class ParserReadStyle
@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <string_view>
+
+namespace MetaData
+{
+    struct EmbeddedPicture
+    {
+        const std::byte* data;
+        std::size_t dataSize;
+        std::string_view mimeType; // may be empty if unknown
+    };
+
+    // Reads the embedded picture of an audio file using its tags only (audio stream is not parsed)
+    // The front cover is preferred. The picture is only valid during the visitor call
+    // Returns false if no picture can be found this way
+    bool visitEmbeddedPicture(const std::filesystem::path& p, std::function<void(const EmbeddedPicture&)> visitor);
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include "CompositeParser.hpp"
+
+using namespace MetaData;
+
+namespace
+{
+	class FakeParser : public IParser
+	{
+		public:
+			FakeParser(bool success, std::size_t& parseCount) : _success {success}, _parseCount {parseCount} {}
+
+			std::optional<Track> parse(const std::filesystem::path&, bool) override
+			{
+				_parseCount++;
+				if (!_success)
+					return std::nullopt;
+
+				Track track;
+				track.title = getClusterTypeNames();
+				return track;
+			}
+
+			std::optional<Track> parseAndCache(const std::filesystem::path& p, std::vector<unsigned char>& cacheData) override
+			{
+				cacheData = {1, 2, 3};
+				return parse(p, false);
+			}
+
+		private:
+			std::string getClusterTypeNames() const
+			{
+				std::string res;
+				for (const std::string& name : _clusterTypeNames)
+					res += name;
+				return res;
+			}
+
+			const bool		_success;
+			std::size_t&	_parseCount;
+	};
+}
+
+TEST(CompositeParser, dispatchByExtension)
+{
+	std::size_t primaryCount {};
+	std::size_t fallbackCount {};
+	CompositeParser parser {std::make_unique<FakeParser>(true, primaryCount), {"mp3"}, std::make_unique<FakeParser>(true, fallbackCount)};
+
+	EXPECT_TRUE(parser.parse("/tmp/file.mp3"));
+	EXPECT_TRUE(parser.parse("/tmp/file.MP3"));
+	EXPECT_EQ(primaryCount, 2);
+	EXPECT_EQ(fallbackCount, 0);
+
+	// unknown extensions are never sent to the primary parser
+	EXPECT_TRUE(parser.parse("/tmp/file.xyz"));
+	EXPECT_EQ(primaryCount, 2);
+	EXPECT_EQ(fallbackCount, 1);
+
+	EXPECT_EQ(parser.getExtensionStats("mp3").primarySuccessCount, 2);
+	EXPECT_EQ(parser.getExtensionStats("xyz").fallbackSuccessCount, 1);
+	EXPECT_EQ(parser.getExtensionStats("ogg").primarySuccessCount, 0);
+}
+
+TEST(CompositeParser, fallbackOnFailure)
+{
+	std::size_t primaryCount {};
+	std::size_t fallbackCount {};
+	CompositeParser parser {std::make_unique<FakeParser>(false, primaryCount), {"mp3"}, std::make_unique<FakeParser>(true, fallbackCount)};
+
+	EXPECT_TRUE(parser.parse("/tmp/file.mp3"));
+	EXPECT_EQ(primaryCount, 1);
+	EXPECT_EQ(fallbackCount, 1);
+
+	// cache data only comes from the primary parser
+	std::vector<unsigned char> cacheData {4, 5};
+	EXPECT_TRUE(parser.parseAndCache("/tmp/file.mp3", cacheData));
+	EXPECT_TRUE(cacheData.empty());
+}
+
+TEST(CompositeParser, skipFailingPrimary)
+{
+	std::size_t primaryCount {};
+	std::size_t fallbackCount {};
+	CompositeParser parser {std::make_unique<FakeParser>(false, primaryCount), {"mp3"}, std::make_unique<FakeParser>(true, fallbackCount)};
+
+	for (std::size_t i {}; i < CompositeParser::primarySkipThreshold; ++i)
+		EXPECT_TRUE(parser.parse("/tmp/file.mp3"));
+	EXPECT_EQ(primaryCount, CompositeParser::primarySkipThreshold);
+
+	// the file is no longer opened twice
+	EXPECT_TRUE(parser.parse("/tmp/file.mp3"));
+	EXPECT_EQ(primaryCount, CompositeParser::primarySkipThreshold);
+	EXPECT_EQ(fallbackCount, CompositeParser::primarySkipThreshold + 1);
+
+	const CompositeParser::ExtensionStats stats {parser.getExtensionStats("mp3")};
+	EXPECT_EQ(stats.primaryFailureCount, CompositeParser::primarySkipThreshold);
+	EXPECT_EQ(stats.fallbackSuccessCount, CompositeParser::primarySkipThreshold + 1);
+}
+
+TEST(CompositeParser, clusterTypeNames)
+{
+	std::size_t primaryCount {};
+	std::size_t fallbackCount {};
+	CompositeParser parser {std::make_unique<FakeParser>(true, primaryCount), {"mp3"}, std::make_unique<FakeParser>(true, fallbackCount)};
+	parser.setClusterTypeNames({"GENRE"});
+
+	const std::optional<Track> primaryTrack {parser.parse("/tmp/file.mp3")};
+	ASSERT_TRUE(primaryTrack);
+	EXPECT_EQ(primaryTrack->title, "GENRE");
+
+	const std::optional<Track> fallbackTrack {parser.parse("/tmp/file.flac")};
+	ASSERT_TRUE(fallbackTrack);
+	EXPECT_EQ(fallbackTrack->title, "GENRE");
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include "RawMetadata.hpp"
+
+using namespace MetaData;
+
+TEST(RawMetadata, encodeDecode)
+{
+	RawMetadata metadata;
+	metadata.duration = std::chrono::milliseconds {183'512};
+	metadata.bitrate = 320'000;
+	metadata.sampleRate = 44'100;
+	metadata.channelCount = 2;
+	metadata.audioCodec = "mp3";
+	metadata.hasCover = true;
+	metadata.tags["ARTIST"] = {"MyArtist1", "MyArtist2"};
+	metadata.tags["TITLE"] = {"MyTitle"};
+	metadata.tags["EMPTY"] = {};
+	metadata.tags["UTF8"] = {"\xc3\xa9t\xc3\xa9", ""};
+
+	const std::vector<unsigned char> data {RawMetadataEncoding::encode(metadata)};
+	const std::optional<RawMetadata> decoded {RawMetadataEncoding::decode(data)};
+	ASSERT_TRUE(decoded);
+
+	EXPECT_EQ(decoded->duration, metadata.duration);
+	EXPECT_EQ(decoded->bitrate, metadata.bitrate);
+	EXPECT_EQ(decoded->sampleRate, metadata.sampleRate);
+	EXPECT_EQ(decoded->channelCount, metadata.channelCount);
+	EXPECT_EQ(decoded->audioCodec, metadata.audioCodec);
+	EXPECT_EQ(decoded->hasCover, metadata.hasCover);
+	EXPECT_EQ(decoded->tags, metadata.tags);
+}
+
+TEST(RawMetadata, malformed)
+{
+	EXPECT_FALSE(RawMetadataEncoding::decode({}));
+
+	RawMetadata metadata;
+	metadata.audioCodec = "flac";
+	metadata.tags["TITLE"] = {"MyTitle"};
+	std::vector<unsigned char> data {RawMetadataEncoding::encode(metadata)};
+	ASSERT_TRUE(RawMetadataEncoding::decode(data));
+
+	// truncated
+	for (std::size_t size {}; size < data.size(); ++size)
+		EXPECT_FALSE(RawMetadataEncoding::decode(std::vector<unsigned char>(data.begin(), data.begin() + size))) << "size = " << size;
+
+	// trailing bytes
+	data.push_back(0);
+	EXPECT_FALSE(RawMetadataEncoding::decode(data));
+
+	// other format version
+	data.pop_back();
+	data[0] = 0;
+	EXPECT_FALSE(RawMetadataEncoding::decode(data));
+}
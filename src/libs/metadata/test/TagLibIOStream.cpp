@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "TagLibIOStream.hpp"
+
+namespace
+{
+	class TemporaryFile
+	{
+		public:
+			TemporaryFile(std::string_view content)
+				: _path {std::filesystem::temp_directory_path() / ("lms-test-iostream-" + std::to_string(reinterpret_cast<std::uintptr_t>(this)))}
+			{
+				std::ofstream ofs {_path, std::ios_base::binary};
+				ofs << content;
+			}
+
+			~TemporaryFile()
+			{
+				std::error_code ec;
+				std::filesystem::remove(_path, ec);
+			}
+
+			const std::filesystem::path& getPath() const { return _path; }
+
+		private:
+			std::filesystem::path _path;
+	};
+
+	std::string makeContent(std::size_t size)
+	{
+		std::string content(size, 0);
+		for (std::size_t i {}; i < size; ++i)
+			content[i] = static_cast<char>((i * 7) % 251);
+
+		return content;
+	}
+
+	std::string toString(const TagLib::ByteVector& data)
+	{
+		return std::string(data.data(), data.size());
+	}
+}
+
+using namespace MetaData;
+
+TEST(ReadAheadIOStream, smallReads)
+{
+	const std::string content {makeContent(1'000'000)};
+	const TemporaryFile file {content};
+
+	ReadAheadIOStream stream {file.getPath()};
+	ASSERT_TRUE(stream.isOpen());
+	EXPECT_TRUE(stream.readOnly());
+	EXPECT_EQ(stream.length(), 1'000'000);
+
+	// head
+	EXPECT_EQ(toString(stream.readBlock(10)), content.substr(0, 10));
+	EXPECT_EQ(stream.tell(), 10);
+	EXPECT_EQ(toString(stream.readBlock(1000)), content.substr(10, 1000));
+
+	// tail, read backwards
+	stream.seek(-128, TagLib::IOStream::End);
+	EXPECT_EQ(toString(stream.readBlock(128)), content.substr(content.size() - 128));
+	stream.seek(-10'000, TagLib::IOStream::End);
+	EXPECT_EQ(toString(stream.readBlock(100)), content.substr(content.size() - 10'000, 100));
+
+	// back to the head
+	stream.seek(5000);
+	EXPECT_EQ(toString(stream.readBlock(100)), content.substr(5000, 100));
+	stream.seek(-50, TagLib::IOStream::Current);
+	EXPECT_EQ(toString(stream.readBlock(10)), content.substr(5050, 10));
+
+	// one window for the head, one for the tail
+	EXPECT_EQ(stream.getReadCount(), 2);
+}
+
+TEST(ReadAheadIOStream, overlappingReads)
+{
+	const std::string content {makeContent(1'000'000)};
+	const TemporaryFile file {content};
+
+	ReadAheadIOStream stream {file.getPath()};
+
+	const std::size_t offset {ReadAheadIOStream::windowSize - 10};
+	stream.seek(offset);
+	EXPECT_EQ(toString(stream.readBlock(100)), content.substr(offset, 100));
+	EXPECT_EQ(toString(stream.readBlock(100)), content.substr(offset + 100, 100));
+
+	// large blocks are read at once
+	stream.seek(1000);
+	EXPECT_EQ(toString(stream.readBlock(ReadAheadIOStream::windowSize + 1)), content.substr(1000, ReadAheadIOStream::windowSize + 1));
+}
+
+TEST(ReadAheadIOStream, endOfFile)
+{
+	const std::string content {makeContent(1000)};
+	const TemporaryFile file {content};
+
+	ReadAheadIOStream stream {file.getPath()};
+
+	stream.seek(990);
+	EXPECT_EQ(toString(stream.readBlock(100)), content.substr(990));
+	EXPECT_EQ(stream.tell(), 1000);
+	EXPECT_TRUE(stream.readBlock(10).isEmpty());
+
+	stream.seek(2000);
+	EXPECT_TRUE(stream.readBlock(10).isEmpty());
+
+	stream.seek(0);
+	EXPECT_EQ(toString(stream.readBlock(2000)), content);
+	EXPECT_EQ(stream.getReadCount(), 1);
+}
+
+TEST(ReadAheadIOStream, missingFile)
+{
+	ReadAheadIOStream stream {"/non/existing/file"};
+	EXPECT_FALSE(stream.isOpen());
+	EXPECT_TRUE(stream.readBlock(10).isEmpty());
+}
@@ -36,6 +36,15 @@ namespace Auth
 	AuthServiceBase::getOrCreateUser(std::string_view loginName)
 	{
 		Session& session {getDbSession()};
+
+		// Most of the time the user already exists
+		{
+			auto transaction {session.createSharedTransaction()};
+
+			if (const User::pointer user {User::find(session, loginName)})
+				return user->getId();
+		}
+
 		auto transaction {session.createUniqueTransaction()};
 
 		User::pointer user {User::find(session, loginName)};
@@ -55,12 +64,27 @@ namespace Auth
 	void
 	AuthServiceBase::onUserAuthenticated(UserId userId)
 	{
+		const Wt::WDateTime now {Wt::WDateTime::currentDateTime()};
 		Session& session {getDbSession()};
+
+		// Clients may authenticate on each request: only record the last login once in a while
+		{
+			auto transaction {session.createSharedTransaction()};
+
+			const User::pointer user {User::find(session, userId)};
+			if (!user)
+				return;
+
+			const Wt::WDateTime& lastLogin {user->getLastLogin()};
+			if (lastLogin.isValid() && lastLogin <= now && lastLogin.secsTo(now) < _lastLoginUpdatePeriod.count())
+				return;
+		}
+
 		auto transaction {session.createUniqueTransaction()};
 
 		User::pointer user {User::find(session, userId)};
 		if (user)
-			user.modify()->setLastLogin(Wt::WDateTime::currentDateTime());
+			user.modify()->setLastLogin(now);
 	}
 
 	Session&
@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <string_view>
 #include "services/database/UserId.hpp"
 
@@ -41,6 +42,8 @@ namespace Auth
 			Database::Session&		getDbSession();
 
 		private:
+			static constexpr std::chrono::seconds	_lastLoginUpdatePeriod {60};
+
 			Database::Db&		_db;
 	};
 }
@@ -74,17 +74,36 @@ namespace Auth
 	AuthTokenService::processAuthToken(std::string_view secret)
 	{
 		const std::string secretHash {sha1Function.compute(std::string {secret}, {})};
+		if (isDeniedTokenHash(secretHash))
+			return std::nullopt;
 
 		Database::Session& session {getDbSession()};
+
+		// Most of the bad tokens are rejected without taking the write lock
+		{
+			auto transaction {session.createSharedTransaction()};
+
+			if (!Database::AuthToken::find(session, secretHash))
+			{
+				addDeniedTokenHash(secretHash);
+				return std::nullopt;
+			}
+		}
+
 		auto transaction {session.createUniqueTransaction()};
 
 		Database::AuthToken::pointer authToken {Database::AuthToken::find(session, secretHash)};
 		if (!authToken)
+		{
+			// consumed by a concurrent request
+			addDeniedTokenHash(secretHash);
 			return std::nullopt;
+		}
 
 		if (authToken->getExpiry() < Wt::WDateTime::currentDateTime())
 		{
 			authToken.remove();
+			addDeniedTokenHash(secretHash);
 			return std::nullopt;
 		}
 
@@ -100,30 +119,57 @@ namespace Auth
 	AuthTokenService::processAuthToken(const boost::asio::ip::address& clientAddress, std::string_view tokenValue)
 	{
 		// Do not waste too much resource on brute force attacks (optim)
-		{
-			std::shared_lock lock {_mutex};
-
-			if (_loginThrottler.isClientThrottled(clientAddress))
-				return AuthTokenProcessResult {AuthTokenProcessResult::State::Throttled};
-		}
+		if (_loginThrottler.isClientThrottled(clientAddress))
+			return AuthTokenProcessResult {AuthTokenProcessResult::State::Throttled};
 
 		auto res {processAuthToken(tokenValue)};
+
+		// may have been throttled by concurrent attempts
+		if (_loginThrottler.isClientThrottled(clientAddress))
+			return AuthTokenProcessResult {AuthTokenProcessResult::State::Throttled};
+
+		if (!res)
 		{
-			std::unique_lock lock {_mutex};
+			_loginThrottler.onBadClientAttempt(clientAddress);
+			return AuthTokenProcessResult {AuthTokenProcessResult::State::Denied};
+		}
+
+		_loginThrottler.onGoodClientAttempt(clientAddress);
+		onUserAuthenticated(res->userId);
+		return AuthTokenProcessResult {AuthTokenProcessResult::State::Granted, std::move(*res)};
+	}
 
-			if (_loginThrottler.isClientThrottled(clientAddress))
-				return AuthTokenProcessResult {AuthTokenProcessResult::State::Throttled};
+	bool
+	AuthTokenService::isDeniedTokenHash(const std::string& secretHash) const
+	{
+		std::shared_lock lock {_deniedTokenHashesMutex};
+
+		auto it {_deniedTokenHashes.find(secretHash)};
+		return it != std::cend(_deniedTokenHashes) && it->second > std::chrono::steady_clock::now();
+	}
 
-			if (!res)
+	void
+	AuthTokenService::addDeniedTokenHash(const std::string& secretHash)
+	{
+		const std::chrono::steady_clock::time_point now {std::chrono::steady_clock::now()};
+
+		std::unique_lock lock {_deniedTokenHashesMutex};
+
+		if (_deniedTokenHashes.size() >= _maxDeniedTokenHashCount)
+		{
+			for (auto it {std::begin(_deniedTokenHashes)}; it != std::end(_deniedTokenHashes); )
 			{
-				_loginThrottler.onBadClientAttempt(clientAddress);
-				return AuthTokenProcessResult {AuthTokenProcessResult::State::Denied};
+				if (it->second <= now)
+					it = _deniedTokenHashes.erase(it);
+				else
+					++it;
 			}
 
-			_loginThrottler.onGoodClientAttempt(clientAddress);
-			onUserAuthenticated(res->userId);
-			return AuthTokenProcessResult {AuthTokenProcessResult::State::Granted, std::move(*res)};
+			if (_deniedTokenHashes.size() >= _maxDeniedTokenHashCount)
+				_deniedTokenHashes.clear();
 		}
+
+		_deniedTokenHashes[secretHash] = now + _deniedTokenHashTTL;
 	}
 
 	void
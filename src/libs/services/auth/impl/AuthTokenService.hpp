@@ -19,7 +19,10 @@
 
 #pragma once
 
+#include <chrono>
 #include <shared_mutex>
+#include <string>
+#include <unordered_map>
 
 #include "services/auth/IAuthTokenService.hpp"
 #include "AuthServiceBase.hpp"
@@ -49,7 +52,17 @@ namespace Auth
 
 			std::optional<AuthTokenService::AuthTokenProcessResult::AuthTokenInfo> processAuthToken(std::string_view secret);
 
-			std::shared_mutex	_mutex;
+			// Tokens are random and only accepted once: a rejected token cannot become valid later
+			// Remember them for a while, for browsers that keep on sending outdated cookies
+			bool	isDeniedTokenHash(const std::string& secretHash) const;
+			void	addDeniedTokenHash(const std::string& secretHash);
+
+			static constexpr std::size_t			_maxDeniedTokenHashCount {1000};
+			static constexpr std::chrono::seconds	_deniedTokenHashTTL {300};
+
 			LoginThrottler		_loginThrottler;
+
+			mutable std::shared_mutex	_deniedTokenHashesMutex;
+			std::unordered_map<std::string, std::chrono::steady_clock::time_point>	_deniedTokenHashes;
 	};
 }
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CredentialCache.hpp"
+
+#include <Wt/Auth/HashFunction.h>
+#include <Wt/WRandom.h>
+
+#include "utils/Random.hpp"
+
+namespace Auth
+{
+	static const Wt::Auth::SHA1HashFunction sha1Function;
+
+	CredentialCache::CredentialCache(std::size_t maxEntries, std::chrono::seconds entryTTL)
+		: _maxEntries {maxEntries}
+		, _entryTTL {entryTTL}
+		, _salt {Wt::WRandom::generateId(32)}
+	{
+	}
+
+	std::optional<Database::UserId>
+	CredentialCache::find(const boost::asio::ip::address& clientAddress, std::string_view loginName, std::string_view password) const
+	{
+		auto it {_entries.find(computeKey(clientAddress, loginName, password))};
+		if (it == std::cend(_entries) || it->second.expiry <= Clock::now())
+		{
+			_missCount++;
+			return std::nullopt;
+		}
+
+		_hitCount++;
+		return it->second.userId;
+	}
+
+	void
+	CredentialCache::insert(const boost::asio::ip::address& clientAddress, std::string_view loginName, std::string_view password, Database::UserId userId)
+	{
+		if (_maxEntries == 0)
+			return;
+
+		if (_entries.size() >= _maxEntries)
+			removeOutdatedEntries();
+		if (_entries.size() >= _maxEntries)
+			_entries.erase(Random::pickRandom(_entries));
+
+		_entries[computeKey(clientAddress, loginName, password)] = Entry {userId, Clock::now() + _entryTTL};
+	}
+
+	void
+	CredentialCache::invalidate(Database::UserId userId)
+	{
+		for (auto it {std::begin(_entries)}; it != std::end(_entries); )
+		{
+			if (it->second.userId == userId)
+				it = _entries.erase(it);
+			else
+				++it;
+		}
+	}
+
+	std::string
+	CredentialCache::computeKey(const boost::asio::ip::address& clientAddress, std::string_view loginName, std::string_view password) const
+	{
+		std::string message {clientAddress.to_string()};
+		message += '\0';
+		message += loginName;
+		message += '\0';
+		message += password;
+
+		return sha1Function.compute(message, _salt);
+	}
+
+	void
+	CredentialCache::removeOutdatedEntries()
+	{
+		const Clock::time_point now {Clock::now()};
+
+		for (auto it {std::begin(_entries)}; it != std::end(_entries); )
+		{
+			if (it->second.expiry <= now)
+				it = _entries.erase(it);
+			else
+				++it;
+		}
+	}
+} // Auth
+
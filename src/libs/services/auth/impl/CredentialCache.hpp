@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <optional>
+#include <unordered_map>
+
+#include <boost/asio/ip/address.hpp>
+
+#include "services/database/UserId.hpp"
+
+namespace Auth
+{
+	// Remembers successful password checks for a short time, in order to
+	// avoid running expensive hash functions on each request
+	// Only a salted digest of the credentials is kept
+	class CredentialCache
+	{
+		public:
+			CredentialCache(std::size_t maxEntries, std::chrono::seconds entryTTL);
+
+			// user must lock these calls to avoid races
+			std::optional<Database::UserId>	find(const boost::asio::ip::address& clientAddress, std::string_view loginName, std::string_view password) const;
+			void							insert(const boost::asio::ip::address& clientAddress, std::string_view loginName, std::string_view password, Database::UserId userId);
+			void							invalidate(Database::UserId userId);
+
+			std::size_t	getHitCount() const { return _hitCount; }
+			std::size_t	getMissCount() const { return _missCount; }
+
+		private:
+			using Clock = std::chrono::steady_clock;
+
+			std::string	computeKey(const boost::asio::ip::address& clientAddress, std::string_view loginName, std::string_view password) const;
+			void		removeOutdatedEntries();
+
+			const std::size_t			_maxEntries;
+			const std::chrono::seconds	_entryTTL;
+			const std::string			_salt;
+
+			struct Entry
+			{
+				Database::UserId	userId;
+				Clock::time_point	expiry;
+			};
+			std::unordered_map<std::string, Entry>	_entries;
+
+			mutable std::atomic<std::size_t>	_hitCount {};
+			mutable std::atomic<std::size_t>	_missCount {};
+	};
+} // Auth
+
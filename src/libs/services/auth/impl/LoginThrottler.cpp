@@ -17,12 +17,12 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-/* This file contains some classes in order to get info from file using the libavconv */
-
 #include "LoginThrottler.hpp"
 
+#include <algorithm>
+#include <functional>
+
 #include "utils/Logger.hpp"
-#include "utils/Random.hpp"
 
 namespace Auth {
 
@@ -32,7 +32,7 @@ getAddressWithMask(const boost::asio::ip::address_v6& address, std::size_t prefi
 {
 	assert(prefix % 8 == 0);
 
-	std::array<uint8_t, 16> truncatedBytes;
+	std::array<uint8_t, 16> truncatedBytes {};
 
 	auto bytes {address.to_bytes()};
 	std::copy(std::cbegin(bytes), std::next(std::cbegin(bytes), prefix / 8), truncatedBytes.begin());
@@ -44,20 +44,71 @@ static
 boost::asio::ip::address
 getAddressToThrottle(const boost::asio::ip::address& address)
 {
-	return address.is_v6() ? getAddressWithMask(address.to_v6(), 64) : address;
+	if (!address.is_v6())
+		return address;
+
+	const boost::asio::ip::address_v6 addressV6 {address.to_v6()};
+	if (addressV6.is_v4_mapped())
+		return boost::asio::ip::make_address_v4(boost::asio::ip::v4_mapped, addressV6);
+
+	return getAddressWithMask(addressV6, 64);
+}
+
+static
+std::chrono::steady_clock::time_point
+getExpiryBucket(std::chrono::steady_clock::time_point expiry)
+{
+	return std::chrono::ceil<std::chrono::seconds>(expiry);
+}
+
+LoginThrottler::LoginThrottler(std::size_t maxEntries)
+: _maxEntriesPerShard {std::max<std::size_t>((maxEntries + _shardCount - 1) / _shardCount, 1)}
+{
+}
+
+LoginThrottler::Shard&
+LoginThrottler::getShard(const boost::asio::ip::address& clientAddress)
+{
+	return _shards[std::hash<boost::asio::ip::address>{}(clientAddress) % _shardCount];
+}
+
+const LoginThrottler::Shard&
+LoginThrottler::getShard(const boost::asio::ip::address& clientAddress) const
+{
+	return _shards[std::hash<boost::asio::ip::address>{}(clientAddress) % _shardCount];
 }
 
 void
-LoginThrottler::removeOutdatedEntries()
+LoginThrottler::Shard::removeExpiredEntries(Clock::time_point now)
 {
-	const Wt::WDateTime now {Wt::WDateTime::currentDateTime()};
+	while (!expiryBuckets.empty() && expiryBuckets.begin()->first <= now)
+	{
+		for (const boost::asio::ip::address& clientAddress : expiryBuckets.begin()->second)
+		{
+			auto it {attemptsInfo.find(clientAddress)};
+			if (it != std::end(attemptsInfo) && it->second.expiry <= now)
+				attemptsInfo.erase(it);
+		}
+
+		expiryBuckets.erase(expiryBuckets.begin());
+	}
+}
 
-	for (auto it {std::begin(_attemptsInfo)}; it != std::end(_attemptsInfo); )
+void
+LoginThrottler::Shard::removeFirstExpiringEntries(std::size_t maxEntries)
+{
+	while (attemptsInfo.size() >= maxEntries && !expiryBuckets.empty())
 	{
-		if (it->second.nextAttempt <= now)
-			it = _attemptsInfo.erase(it);
-		else
-			++it;
+		const auto itBucket {expiryBuckets.begin()};
+		for (const boost::asio::ip::address& clientAddress : itBucket->second)
+		{
+			// only remove the entries that are still expected in this bucket
+			auto it {attemptsInfo.find(clientAddress)};
+			if (it != std::end(attemptsInfo) && getExpiryBucket(it->second.expiry) == itBucket->first)
+				attemptsInfo.erase(it);
+		}
+
+		expiryBuckets.erase(itBucket);
 	}
 }
 
@@ -65,55 +116,73 @@ void
 LoginThrottler::onBadClientAttempt(const boost::asio::ip::address& address)
 {
 	const boost::asio::ip::address clientAddress {getAddressToThrottle(address)};
-	const Wt::WDateTime now {Wt::WDateTime::currentDateTime()};
+	Shard& shard {getShard(clientAddress)};
+	const Clock::time_point now {Clock::now()};
+
+	std::unique_lock lock {shard.mutex};
 
-	if (_attemptsInfo.size() >= _maxEntries)
-		removeOutdatedEntries();
-	if (_attemptsInfo.size() >= _maxEntries)
-		_attemptsInfo.erase(Random::pickRandom(_attemptsInfo));
+	shard.removeExpiredEntries(now);
 
-	AttemptInfo& attemptInfo {_attemptsInfo[address]};
-	if (attemptInfo.nextAttempt.isValid())
+	auto it {shard.attemptsInfo.find(clientAddress)};
+	if (it == std::end(shard.attemptsInfo))
 	{
-		assert(attemptInfo.nextAttempt <= now); // should not be called if throttled
-		attemptInfo = {};
+		shard.removeFirstExpiringEntries(_maxEntriesPerShard);
+		it = shard.attemptsInfo.emplace(clientAddress, AttemptInfo {}).first;
 	}
 
+	AttemptInfo& attemptInfo {it->second};
+	if (attemptInfo.nextAttempt > now)
+		return; // concurrent attempts, the client has already been throttled
+
+	if (attemptInfo.nextAttempt != Clock::time_point {})
+		attemptInfo = {};
+
 	attemptInfo.badConsecutiveAttemptCount += 1;
 
 	LMS_LOG(AUTH, DEBUG) << "Registering bad attempt for '" << clientAddress.to_string() << "', consecutive bad attempts count = " << attemptInfo.badConsecutiveAttemptCount;
 	if (attemptInfo.badConsecutiveAttemptCount >= _maxBadConsecutiveAttemptCount)
 	{
 		LMS_LOG(AUTH, DEBUG) << "Throttling '" << clientAddress.to_string() << "'";
-		attemptInfo.nextAttempt = now.addMSecs(std::chrono::duration_cast<std::chrono::milliseconds>(_throttlingDuration).count());
-	}
-	else
-	{
-		attemptInfo.nextAttempt = {};
+		attemptInfo.nextAttempt = now + _throttlingDuration;
 	}
+
+	const Clock::time_point previousExpiry {attemptInfo.expiry};
+	attemptInfo.expiry = now + _badAttemptRetentionDuration;
+	if (previousExpiry == Clock::time_point {} || getExpiryBucket(previousExpiry) != getExpiryBucket(attemptInfo.expiry))
+		shard.expiryBuckets[getExpiryBucket(attemptInfo.expiry)].push_back(clientAddress);
 }
 
 void
 LoginThrottler::onGoodClientAttempt(const boost::asio::ip::address& address)
 {
 	const boost::asio::ip::address clientAddress {getAddressToThrottle(address)};
+	Shard& shard {getShard(clientAddress)};
+
+	{
+		std::shared_lock lock {shard.mutex};
+
+		if (shard.attemptsInfo.find(clientAddress) == std::cend(shard.attemptsInfo))
+			return;
+	}
 
-	_attemptsInfo.erase(clientAddress);
+	// the expiry buckets may still reference this client: they will be skipped
+	std::unique_lock lock {shard.mutex};
+	shard.attemptsInfo.erase(clientAddress);
 }
 
 bool
 LoginThrottler::isClientThrottled(const boost::asio::ip::address& address) const
 {
 	const boost::asio::ip::address clientAddress {getAddressToThrottle(address)};
+	const Shard& shard {getShard(clientAddress)};
 
-	auto it {_attemptsInfo.find(clientAddress)};
-	if (it == _attemptsInfo.end())
-		return false;
+	std::shared_lock lock {shard.mutex};
 
-	if (!it->second.nextAttempt.isValid())
+	auto it {shard.attemptsInfo.find(clientAddress)};
+	if (it == shard.attemptsInfo.end())
 		return false;
 
-	return it->second.nextAttempt > Wt::WDateTime::currentDateTime();
+	return it->second.nextAttempt > Clock::now();
 }
 
 } // Auth
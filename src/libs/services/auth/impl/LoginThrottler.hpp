@@ -19,39 +19,63 @@
 
 #pragma once
 
+#include <array>
 #include <chrono>
+#include <map>
+#include <shared_mutex>
 #include <unordered_map>
-
-#include <Wt/WDateTime.h>
+#include <vector>
 
 #include "utils/NetAddress.hpp"
-#include "utils/Exception.hpp"
 
 namespace Auth
 {
+	// Thread safe: clients are spread over shards, each one having its own lock
+	// IPv6 clients are grouped by /64 subnet
 	class LoginThrottler
 	{
 		public:
-			LoginThrottler(std::size_t maxEntries) : _maxEntries {maxEntries} {}
+			LoginThrottler(std::size_t maxEntries);
+
+			LoginThrottler(const LoginThrottler&) = delete;
+			LoginThrottler& operator=(const LoginThrottler&) = delete;
 
-			// user must lock these calls to avoid races
 			bool isClientThrottled(const boost::asio::ip::address& address) const;
 			void onBadClientAttempt(const boost::asio::ip::address& address);
 			void onGoodClientAttempt(const boost::asio::ip::address& address);
 
 		private:
-			void removeOutdatedEntries();
+			using Clock = std::chrono::steady_clock;
 
-			const std::size_t _maxEntries;
+			static constexpr std::size_t _shardCount {16};
 			static constexpr std::size_t _maxBadConsecutiveAttemptCount {5};
 			static constexpr std::chrono::seconds _throttlingDuration {3};
+			static constexpr std::chrono::seconds _badAttemptRetentionDuration {600}; // clients are forgotten after this duration without bad attempts
 
 			struct AttemptInfo
 			{
-				Wt::WDateTime nextAttempt;
+				Clock::time_point nextAttempt; // throttled until then
+				Clock::time_point expiry;
 				std::size_t badConsecutiveAttemptCount{};
 			};
-			std::unordered_map<boost::asio::ip::address, AttemptInfo>	_attemptsInfo;
+
+			struct Shard
+			{
+				mutable std::shared_mutex mutex;
+				std::unordered_map<boost::asio::ip::address, AttemptInfo> attemptsInfo;
+				// clients that may expire in each one-second bucket, so that expiry does not need to scan all the entries
+				// a client may be referenced by several buckets if its expiry has been pushed back
+				std::map<Clock::time_point, std::vector<boost::asio::ip::address>> expiryBuckets;
+
+				void removeExpiredEntries(Clock::time_point now);
+				void removeFirstExpiringEntries(std::size_t maxEntries);
+			};
+
+			Shard& getShard(const boost::asio::ip::address& clientAddress);
+			const Shard& getShard(const boost::asio::ip::address& clientAddress) const;
+
+			const std::size_t _maxEntriesPerShard;
+			std::array<Shard, _shardCount> _shards;
 	};
 } // Auth
 
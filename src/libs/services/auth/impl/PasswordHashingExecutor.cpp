@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PasswordHashingExecutor.hpp"
+
+#include <algorithm>
+#include <future>
+#include <memory>
+
+#include <boost/asio/post.hpp>
+
+#include "utils/Logger.hpp"
+
+namespace Auth
+{
+	PasswordHashingExecutor::PasswordHashingExecutor(std::size_t threadCount, std::size_t maxPendingCount)
+	: _maxPendingCount {std::max<std::size_t>(maxPendingCount, 1)}
+	, _threadPool {std::max<std::size_t>(threadCount, 1)}
+	{
+		LMS_LOG(AUTH, INFO) << "Using " << std::max<std::size_t>(threadCount, 1) << " thread(s) to check passwords, max pending checks = " << _maxPendingCount;
+	}
+
+	PasswordHashingExecutor::~PasswordHashingExecutor()
+	{
+		_threadPool.join();
+	}
+
+	std::optional<bool>
+	PasswordHashingExecutor::run(std::function<bool()> check)
+	{
+		if (_pendingCount.fetch_add(1) >= _maxPendingCount)
+		{
+			_pendingCount--;
+			LMS_LOG(AUTH, DEBUG) << "Too many pending password checks";
+			return std::nullopt;
+		}
+
+		// shared: the task may still be referenced by the thread pool once the result is available
+		auto task {std::make_shared<std::packaged_task<bool()>>(std::move(check))};
+		std::future<bool> result {task->get_future()};
+		boost::asio::post(_threadPool, [task] { (*task)(); });
+
+		try
+		{
+			const bool res {result.get()};
+			_pendingCount--;
+			return res;
+		}
+		catch (...)
+		{
+			_pendingCount--;
+			throw;
+		}
+	}
+} // Auth
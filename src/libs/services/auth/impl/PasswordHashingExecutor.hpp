@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <optional>
+
+#include <boost/asio/thread_pool.hpp>
+
+namespace Auth
+{
+	// Runs the expensive password checks on a few dedicated threads
+	// Callers still wait for the result, but fail fast when too many checks are pending
+	class PasswordHashingExecutor
+	{
+		public:
+			PasswordHashingExecutor(std::size_t threadCount, std::size_t maxPendingCount);
+			~PasswordHashingExecutor();
+
+			PasswordHashingExecutor(const PasswordHashingExecutor&) = delete;
+			PasswordHashingExecutor& operator=(const PasswordHashingExecutor&) = delete;
+
+			// Returns std::nullopt if the check could not be queued
+			std::optional<bool>	run(std::function<bool()> check);
+
+		private:
+			const std::size_t			_maxPendingCount;
+			std::atomic<std::size_t>	_pendingCount {};
+			boost::asio::thread_pool	_threadPool;
+	};
+} // Auth
@@ -31,7 +31,9 @@
 #include "services/database/Session.hpp"
 #include "services/database/User.hpp"
 #include "utils/Exception.hpp"
+#include "utils/IConfig.hpp"
 #include "utils/Logger.hpp"
+#include "utils/Service.hpp"
 
 namespace Auth
 {
@@ -54,6 +56,8 @@ namespace Auth
 	PasswordServiceBase::PasswordServiceBase(Database::Db& db, std::size_t maxThrottlerEntries, IAuthTokenService& authTokenService)
 		: AuthServiceBase {db}
 		, _loginThrottler {maxThrottlerEntries}
+		, _credentialCache {_maxCredentialCacheEntries, _credentialCacheEntryTTL}
+		, _hashingExecutor {Service<IConfig>::get()->getULong("login-hashing-thread-count", 2), Service<IConfig>::get()->getULong("login-hashing-max-pending-count", 16)}
 		, _authTokenService {authTokenService}
 	{
 	}
@@ -63,35 +67,79 @@ namespace Auth
 	{
 		LMS_LOG(AUTH, DEBUG) << "Checking password for user '" << loginName << "'";
 
+		std::optional<Database::UserId> cachedUserId;
+		std::size_t passwordChangeCount;
+
 		// Do not waste too much resource on brute force attacks (optim)
+		if (_loginThrottler.isClientThrottled(clientAddress))
+			return {CheckResult::State::Throttled};
+
 		{
 			std::shared_lock lock {_mutex};
 
-			if (_loginThrottler.isClientThrottled(clientAddress))
-				return {CheckResult::State::Throttled};
+			cachedUserId = _credentialCache.find(clientAddress, loginName, password);
+			passwordChangeCount = _passwordChangeCount;
 		}
 
-		const bool match {checkUserPassword(loginName, password)};
+		// Recently checked credentials: skip the expensive password check
+		if (cachedUserId && userExists(*cachedUserId))
 		{
-			std::unique_lock lock {_mutex};
+			LMS_LOG(AUTH, DEBUG) << "Credential cache hit for user '" << loginName << "' (hits = " << _credentialCache.getHitCount() << ", misses = " << _credentialCache.getMissCount() << ")";
 
 			if (_loginThrottler.isClientThrottled(clientAddress))
 				return {CheckResult::State::Throttled};
 
-			if (match)
-			{
-				_loginThrottler.onGoodClientAttempt(clientAddress);
-
-				const Database::UserId userId {getOrCreateUser(loginName)};
-				onUserAuthenticated(userId);
-				return {CheckResult::State::Granted, userId};
-			}
-			else
-			{
-				_loginThrottler.onBadClientAttempt(clientAddress);
-				return {CheckResult::State::Denied};
-			}
+			_loginThrottler.onGoodClientAttempt(clientAddress);
+			onUserAuthenticated(*cachedUserId);
+			return {CheckResult::State::Granted, *cachedUserId};
+		}
+
+		// Expensive: do not hold the HTTP threads for too long
+		const std::optional<bool> match {_hashingExecutor.run([&] { return checkUserPassword(loginName, password); })};
+		if (!match)
+			return {CheckResult::State::Throttled};
+
+		// may have been throttled by concurrent attempts
+		if (_loginThrottler.isClientThrottled(clientAddress))
+			return {CheckResult::State::Throttled};
+
+		if (!*match)
+		{
+			_loginThrottler.onBadClientAttempt(clientAddress);
+			return {CheckResult::State::Denied};
+		}
+
+		_loginThrottler.onGoodClientAttempt(clientAddress);
+
+		const Database::UserId userId {getOrCreateUser(loginName)};
+		onUserAuthenticated(userId);
+		{
+			std::unique_lock lock {_mutex};
+
+			// Do not cache a check that may have raced with a password change
+			if (passwordChangeCount == _passwordChangeCount)
+				_credentialCache.insert(clientAddress, loginName, password, userId);
 		}
+		return {CheckResult::State::Granted, userId};
+	}
+
+	void
+	PasswordServiceBase::onPasswordChanged(Database::UserId userId)
+	{
+		std::unique_lock lock {_mutex};
+
+		_credentialCache.invalidate(userId);
+		_passwordChangeCount++;
+	}
+
+	bool
+	PasswordServiceBase::userExists(Database::UserId userId)
+	{
+		Database::Session& session {getDbSession()};
+		auto transaction {session.createSharedTransaction()};
+
+		const Database::User::pointer user {Database::User::find(session, userId)};
+		return static_cast<bool>(user);
 	}
 } // namespace Auth
 
@@ -23,7 +23,9 @@
 
 #include "services/auth/IPasswordService.hpp"
 #include "AuthServiceBase.hpp"
+#include "CredentialCache.hpp"
 #include "LoginThrottler.hpp"
+#include "PasswordHashingExecutor.hpp"
 
 namespace Database
 {
@@ -46,6 +48,7 @@ namespace Auth
 
 		protected:
 			IAuthTokenService&	getAuthTokenService() { return _authTokenService; }
+			void				onPasswordChanged(Database::UserId userId);
 
 		private:
 			virtual bool	checkUserPassword(std::string_view loginName, std::string_view password) = 0;
@@ -54,8 +57,16 @@ namespace Auth
 												std::string_view loginName,
 												std::string_view password) override;
 
-			std::shared_mutex			_mutex;
+			bool			userExists(Database::UserId userId);
+
+			static constexpr std::size_t			_maxCredentialCacheEntries {1000};
+			static constexpr std::chrono::seconds	_credentialCacheEntryTTL {60};
+
+			std::shared_mutex			_mutex; // protects the credential cache
 			LoginThrottler				_loginThrottler;
+			CredentialCache				_credentialCache;
+			PasswordHashingExecutor		_hashingExecutor;
+			std::size_t					_passwordChangeCount {};
 			IAuthTokenService&			_authTokenService;
 	};
 
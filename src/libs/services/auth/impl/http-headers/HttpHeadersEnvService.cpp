@@ -38,28 +38,58 @@ namespace Auth
 	HttpHeadersEnvService::CheckResult
 	HttpHeadersEnvService::processEnv(const Wt::WEnvironment& env)
 	{
-		const std::string loginName {env.headerValue(_fieldName)};
-		if (loginName.empty())
-			return {CheckResult::State::Denied};
+		return processLoginName(env.headerValue(_fieldName));
+	}
 
-		LMS_LOG(AUTH, DEBUG) << "Extracted login name = '" << loginName <<  "' from HTTP header";
+	HttpHeadersEnvService::CheckResult
+	HttpHeadersEnvService::processRequest(const Wt::Http::Request& request)
+	{
+		return processLoginName(request.headerValue(_fieldName));
+	}
 
-		const Database::UserId userId {getOrCreateUser(loginName)};
-		onUserAuthenticated(userId);
-		return {CheckResult::State::Granted, userId};
+	void
+	HttpHeadersEnvService::onUserDeleted(Database::UserId userId)
+	{
+		std::unique_lock lock {_cachedUsersMutex};
+
+		for (auto it {std::begin(_cachedUsers)}; it != std::end(_cachedUsers); )
+		{
+			if (it->second.userId == userId)
+				it = _cachedUsers.erase(it);
+			else
+				++it;
+		}
 	}
 
 	HttpHeadersEnvService::CheckResult
-	HttpHeadersEnvService::processRequest(const Wt::Http::Request& request)
+	HttpHeadersEnvService::processLoginName(const std::string& loginName)
 	{
-		const std::string loginName {request.headerValue(_fieldName)};
 		if (loginName.empty())
 			return {CheckResult::State::Denied};
 
 		LMS_LOG(AUTH, DEBUG) << "Extracted login name = '" << loginName <<  "' from HTTP header";
 
+		const std::chrono::steady_clock::time_point now {std::chrono::steady_clock::now()};
+		{
+			std::shared_lock lock {_cachedUsersMutex};
+
+			auto it {_cachedUsers.find(loginName)};
+			if (it != std::cend(_cachedUsers) && it->second.expiry > now)
+				return {CheckResult::State::Granted, it->second.userId};
+		}
+
 		const Database::UserId userId {getOrCreateUser(loginName)};
 		onUserAuthenticated(userId);
+
+		{
+			std::unique_lock lock {_cachedUsersMutex};
+
+			if (_cachedUsers.size() >= _maxCachedUserCount)
+				_cachedUsers.clear();
+
+			_cachedUsers[loginName] = CachedUser {userId, now + _cachedUserTTL};
+		}
+
 		return {CheckResult::State::Granted, userId};
 	}
 
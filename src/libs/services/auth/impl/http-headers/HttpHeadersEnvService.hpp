@@ -19,6 +19,11 @@
 
 #pragma once
 
+#include <chrono>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
 #include "services/auth/IEnvService.hpp"
 #include "AuthServiceBase.hpp"
 
@@ -32,8 +37,23 @@ namespace Auth
 		private:
 			CheckResult	processEnv(const Wt::WEnvironment& env) override;
 			CheckResult	processRequest(const Wt::Http::Request& request) override;
+			void		onUserDeleted(Database::UserId userId) override;
+
+			CheckResult	processLoginName(const std::string& loginName);
+
+			// Login names are resolved to users once in a while only, as this is done on each request
+			static constexpr std::size_t			_maxCachedUserCount {1000};
+			static constexpr std::chrono::seconds	_cachedUserTTL {60};
 
 			std::string _fieldName;
+
+			struct CachedUser
+			{
+				Database::UserId						userId;
+				std::chrono::steady_clock::time_point	expiry;
+			};
+			std::shared_mutex								_cachedUsersMutex;
+			std::unordered_map<std::string, CachedUser>		_cachedUsers;
 	};
 
 } // namespace Auth
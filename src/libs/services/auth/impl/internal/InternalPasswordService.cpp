@@ -99,25 +99,30 @@ namespace Auth
 	{
 		const Database::User::PasswordHash passwordHash {hashPassword(newPassword)};
 
-		Database::Session& session {getDbSession()};
-		auto transaction {session.createUniqueTransaction()};
+		{
+			Database::Session& session {getDbSession()};
+			auto transaction {session.createUniqueTransaction()};
 
-		Database::User::pointer user {Database::User::find(session, userId)};
-		if (!user)
-			throw Exception {"User not found!"};
+			Database::User::pointer user {Database::User::find(session, userId)};
+			if (!user)
+				throw Exception {"User not found!"};
 
-		switch (checkPasswordAcceptability(newPassword, PasswordValidationContext {user->getLoginName(), user->getType()}))
-		{
-			case PasswordAcceptabilityResult::OK:
-				break;
-			case PasswordAcceptabilityResult::TooWeak:
-				throw PasswordTooWeakException {};
-			case PasswordAcceptabilityResult::MustMatchLoginName:
-				throw PasswordMustMatchLoginNameException {};
+			switch (checkPasswordAcceptability(newPassword, PasswordValidationContext {user->getLoginName(), user->getType()}))
+			{
+				case PasswordAcceptabilityResult::OK:
+					break;
+				case PasswordAcceptabilityResult::TooWeak:
+					throw PasswordTooWeakException {};
+				case PasswordAcceptabilityResult::MustMatchLoginName:
+					throw PasswordMustMatchLoginNameException {};
+			}
+
+			user.modify()->setPasswordHash(passwordHash);
+			getAuthTokenService().clearAuthTokens(userId);
 		}
 
-		user.modify()->setPasswordHash(passwordHash);
-		getAuthTokenService().clearAuthTokens(userId);
+		// must be done outside of the db transaction
+		onPasswordChanged(userId);
 	}
 
 	Database::User::PasswordHash
@@ -63,6 +63,9 @@ namespace Auth
 
 			virtual CheckResult			processEnv(const Wt::WEnvironment& env) = 0;
 			virtual CheckResult			processRequest(const Wt::Http::Request& request) = 0;
+
+			// Must be called when a user is removed, as results may be cached
+			virtual void				onUserDeleted(Database::UserId userId) = 0;
 	};
 
 	std::unique_ptr<IEnvService> createEnvService(std::string_view backendName, Database::Db& db);
@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "CoverCache.hpp"
+
+namespace Cover
+{
+    PictureHash PictureHash::compute(const std::byte* data, std::size_t dataSize)
+    {
+        // FNV-1a, the size is mixed in to make collisions between pictures even less likely
+        std::uint64_t hash{ 0xcbf29ce484222325 };
+        for (std::size_t i{}; i < dataSize; ++i)
+        {
+            hash ^= static_cast<std::uint64_t>(data[i]);
+            hash *= 0x100000001b3;
+        }
+        hash ^= static_cast<std::uint64_t>(dataSize) + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+
+        return PictureHash{ hash };
+    }
+
+    CoverCache::CoverCache(std::size_t maxSize)
+        : _maxShardSize{ maxSize / shardCount }
+        , _maxProtectedSegmentSize{ _maxShardSize * protectedSegmentRatio / 100 }
+    {
+    }
+
+    void CoverCache::setMaxSize(std::size_t maxSize)
+    {
+        _maxShardSize = maxSize / shardCount;
+        _maxProtectedSegmentSize = _maxShardSize * protectedSegmentRatio / 100;
+
+        for (Shard& shard : _shards)
+        {
+            std::scoped_lock lock{ shard.mutex };
+            evictEntries(shard);
+        }
+    }
+
+    std::shared_ptr<Image::IEncodedImage> CoverCache::get(const CacheEntryDesc& entryDesc)
+    {
+        Shard& shard{ getShard(entryDesc) };
+        std::scoped_lock lock{ shard.mutex };
+
+        auto it{ shard.entries.find(entryDesc) };
+        if (it == std::cend(shard.entries))
+        {
+            _misses++;
+            return nullptr;
+        }
+
+        _hits++;
+
+        Shard::EntryLocation& location{ it->second };
+        const std::size_t entrySize{ location.it->second->getDataSize() };
+        if (location.isProtected)
+        {
+            shard.protectedEntries.splice(std::begin(shard.protectedEntries), shard.protectedEntries, location.it);
+        }
+        else
+        {
+            // Second hit: promote to the protected segment
+            shard.protectedEntries.splice(std::begin(shard.protectedEntries), shard.probationEntries, location.it);
+            location.isProtected = true;
+            shard.probationSize -= entrySize;
+            shard.protectedSize += entrySize;
+
+            // Demote the least recently used protected entries, they get a last chance in the probation segment
+            while (shard.protectedSize > _maxProtectedSegmentSize && shard.protectedEntries.size() > 1)
+            {
+                auto itDemoted{ std::prev(std::end(shard.protectedEntries)) };
+                const std::size_t demotedSize{ itDemoted->second->getDataSize() };
+
+                shard.probationEntries.splice(std::begin(shard.probationEntries), shard.protectedEntries, itDemoted);
+                shard.entries[itDemoted->first].isProtected = false;
+                shard.protectedSize -= demotedSize;
+                shard.probationSize += demotedSize;
+            }
+        }
+
+        return location.it->second;
+    }
+
+    void CoverCache::put(const CacheEntryDesc& entryDesc, std::shared_ptr<Image::IEncodedImage> image)
+    {
+        const std::size_t entrySize{ image->getDataSize() };
+        if (entrySize > _maxShardSize)
+            return;
+
+        Shard& shard{ getShard(entryDesc) };
+        std::scoped_lock lock{ shard.mutex };
+
+        // Concurrent misses on the same entry: keep the first one
+        if (shard.entries.find(entryDesc) != std::cend(shard.entries))
+            return;
+
+        shard.probationEntries.emplace_front(entryDesc, std::move(image));
+        shard.entries.emplace(entryDesc, Shard::EntryLocation{ std::begin(shard.probationEntries), false });
+        shard.probationSize += entrySize;
+
+        evictEntries(shard);
+    }
+
+    void CoverCache::clear()
+    {
+        for (Shard& shard : _shards)
+        {
+            std::scoped_lock lock{ shard.mutex };
+
+            shard.entries.clear();
+            shard.probationEntries.clear();
+            shard.protectedEntries.clear();
+            shard.probationSize = 0;
+            shard.protectedSize = 0;
+        }
+    }
+
+    ICoverService::CacheStats CoverCache::getStats() const
+    {
+        ICoverService::CacheStats stats;
+        stats.hits = _hits;
+        stats.misses = _misses;
+        stats.evictions = _evictions;
+
+        for (const Shard& shard : _shards)
+        {
+            std::scoped_lock lock{ shard.mutex };
+
+            stats.entryCount += shard.entries.size();
+            stats.size += shard.probationSize + shard.protectedSize;
+        }
+
+        return stats;
+    }
+
+    std::vector<CacheEntryDesc> CoverCache::getHotEntries() const
+    {
+        // recency cannot be compared between shards: take the entries of each shard in turn
+        std::array<std::vector<CacheEntryDesc>, shardCount> protectedEntries;
+        std::array<std::vector<CacheEntryDesc>, shardCount> probationEntries;
+        for (std::size_t i{}; i < shardCount; ++i)
+        {
+            const Shard& shard{ _shards[i] };
+            std::scoped_lock lock{ shard.mutex };
+
+            for (const Shard::Entry& entry : shard.protectedEntries)
+                protectedEntries[i].push_back(entry.first);
+            for (const Shard::Entry& entry : shard.probationEntries)
+                probationEntries[i].push_back(entry.first);
+        }
+
+        std::vector<CacheEntryDesc> res;
+        for (const auto* segmentEntries : { &protectedEntries, &probationEntries })
+        {
+            for (std::size_t rank{};; ++rank)
+            {
+                bool found{};
+                for (const std::vector<CacheEntryDesc>& shardEntries : *segmentEntries)
+                {
+                    if (rank < shardEntries.size())
+                    {
+                        res.push_back(shardEntries[rank]);
+                        found = true;
+                    }
+                }
+
+                if (!found)
+                    break;
+            }
+        }
+
+        return res;
+    }
+
+    CoverCache::Shard& CoverCache::getShard(const CacheEntryDesc& entryDesc)
+    {
+        return _shards[std::hash<CacheEntryDesc>{}(entryDesc) % shardCount];
+    }
+
+    void CoverCache::evictEntries(Shard& shard)
+    {
+        while (shard.probationSize + shard.protectedSize > _maxShardSize)
+        {
+            // Probation entries go first, then the least recently used protected ones
+            Shard::EntryList& entries{ !shard.probationEntries.empty() ? shard.probationEntries : shard.protectedEntries };
+            std::size_t& segmentSize{ !shard.probationEntries.empty() ? shard.probationSize : shard.protectedSize };
+
+            auto itEvicted{ std::prev(std::end(entries)) };
+            segmentSize -= itEvicted->second->getDataSize();
+            shard.entries.erase(itEvicted->first);
+            entries.erase(itEvicted);
+
+            _evictions++;
+        }
+    }
+} // namespace Cover
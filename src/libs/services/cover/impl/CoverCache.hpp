@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "image/IEncodedImage.hpp"
+#include "services/cover/ICoverService.hpp"
+#include "services/database/ReleaseId.hpp"
+#include "services/database/TrackId.hpp"
+
+namespace Cover
+{
+    // Identifies the bytes of an embedded picture: tracks embedding the same picture share their cache entries
+    class PictureHash
+    {
+    public:
+        PictureHash() = default;
+        explicit PictureHash(std::uint64_t value) : _value{ value } {}
+
+        static PictureHash compute(const std::byte* data, std::size_t dataSize);
+
+        std::uint64_t getValue() const { return _value; }
+        bool operator==(const PictureHash& other) const { return _value == other._value; }
+
+    private:
+        std::uint64_t _value{};
+    };
+
+    struct CacheEntryDesc
+    {
+        std::variant<Database::TrackId, Database::ReleaseId, PictureHash> id;
+        std::size_t			size;
+        Image::EncodingFormat format;
+
+        bool operator==(const CacheEntryDesc& other) const
+        {
+            return id == other.id
+                && size == other.size
+                && format == other.format;
+        }
+    };
+} // ns Cover
+
+namespace std
+{
+    template<>
+    class hash<Cover::PictureHash>
+    {
+    public:
+        size_t operator()(const Cover::PictureHash& pictureHash) const
+        {
+            return std::hash<std::uint64_t>()(pictureHash.getValue());
+        }
+    };
+
+    template<>
+    class hash<Cover::CacheEntryDesc>
+    {
+    public:
+        size_t operator()(const Cover::CacheEntryDesc& e) const
+        {
+            size_t h{};
+            std::visit([&](auto id)
+                {
+                    using IdType = std::decay_t<decltype(id)>;
+                    h ^= std::hash<IdType>()(id);
+                }, e.id);
+            h ^= std::hash<std::size_t>()(e.size) << 1;
+            h ^= std::hash<int>()(static_cast<int>(e.format)) << 2;
+            return h;
+        }
+    };
+
+} // ns std
+
+namespace Cover
+{
+    // Size bounded cache of encoded covers
+    // Split into shards, each one having its own lock and a segmented LRU policy:
+    // new entries go to a probation segment and are promoted to a protected segment on their next hit,
+    // so that a burst of covers requested only once (grid views, ...) cannot evict the frequently used ones
+    class CoverCache
+    {
+    public:
+        CoverCache(std::size_t maxSize);
+
+        CoverCache(const CoverCache&) = delete;
+        CoverCache& operator=(const CoverCache&) = delete;
+
+        std::shared_ptr<Image::IEncodedImage> get(const CacheEntryDesc& entryDesc);
+        void put(const CacheEntryDesc& entryDesc, std::shared_ptr<Image::IEncodedImage> image);
+        void clear();
+        void setMaxSize(std::size_t maxSize); // evicts entries if needed
+
+        ICoverService::CacheStats getStats() const;
+
+        // protected entries first, most recently used first
+        std::vector<CacheEntryDesc> getHotEntries() const;
+
+    private:
+        static constexpr std::size_t shardCount{ 16 };
+        static constexpr std::size_t protectedSegmentRatio{ 80 }; // percentage of the shard size
+
+        struct Shard
+        {
+            using Entry = std::pair<CacheEntryDesc, std::shared_ptr<Image::IEncodedImage>>;
+            using EntryList = std::list<Entry>; // most recently used first
+
+            struct EntryLocation
+            {
+                EntryList::iterator it;
+                bool isProtected;
+            };
+
+            mutable std::mutex mutex;
+            EntryList probationEntries;
+            EntryList protectedEntries;
+            std::unordered_map<CacheEntryDesc, EntryLocation> entries;
+            std::size_t probationSize{};
+            std::size_t protectedSize{};
+        };
+
+        Shard& getShard(const CacheEntryDesc& entryDesc);
+        void evictEntries(Shard& shard);
+
+        std::atomic<std::size_t> _maxShardSize;
+        std::atomic<std::size_t> _maxProtectedSegmentSize;
+        std::array<Shard, shardCount> _shards;
+
+        std::atomic<std::size_t> _hits{};
+        std::atomic<std::size_t> _misses{};
+        std::atomic<std::size_t> _evictions{};
+    };
+} // namespace Cover
+
@@ -19,7 +19,14 @@
 
 #include "CoverService.hpp"
 
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <type_traits>
+
 #include "av/IAudioFile.hpp"
+#include "metadata/PictureReader.hpp"
 
 #include "services/database/Db.hpp"
 #include "services/database/Release.hpp"
@@ -27,12 +34,14 @@
 #include "services/database/Track.hpp"
 
 #include "image/Exception.hpp"
+#include "image/JPEG.hpp"
 #include "image/IRawImage.hpp"
 #include "utils/IConfig.hpp"
 #include "utils/Logger.hpp"
-#include "utils/Random.hpp"
 #include "utils/String.hpp"
+#include "utils/Tracing.hpp"
 #include "utils/Utils.hpp"
+#include "EncodedImage.hpp"
 
 namespace Cover
 {
@@ -44,6 +53,7 @@ namespace Cover
             bool hasCover{};
             bool isMultiDisc{};
             std::filesystem::path trackPath;
+            std::int64_t lastWritten{};
             std::optional<Database::ReleaseId> releaseId;
         };
 
@@ -61,6 +71,7 @@ namespace Cover
 
             res->hasCover = track->hasCover();
             res->trackPath = track->getPath();
+            res->lastWritten = track->getLastWritten().toTime_t();
 
             if (const Database::Release::pointer & release{ track->getRelease() })
             {
@@ -89,6 +100,74 @@ namespace Cover
         {
             return (std::find(std::cbegin(extensions), std::cend(extensions), file.extension()) != std::cend(extensions));
         }
+
+        void combineSourceVersion(std::int64_t& sourceVersion, std::int64_t value)
+        {
+            std::uint64_t res{ static_cast<std::uint64_t>(sourceVersion) };
+            res ^= static_cast<std::uint64_t>(value) + 0x9e3779b97f4a7c15 + (res << 6) + (res >> 2);
+            sourceVersion = static_cast<std::int64_t>(res);
+        }
+
+        std::int64_t toSourceVersion(std::filesystem::file_time_type fileTime)
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(fileTime.time_since_epoch()).count();
+        }
+
+        std::string toString(const CacheEntryDesc& entryDesc)
+        {
+            std::ostringstream oss;
+            std::visit([&](auto id)
+                {
+                    using IdType = std::decay_t<decltype(id)>;
+                    if constexpr (std::is_same_v<IdType, Database::TrackId>)
+                        oss << "t " << id.getValue();
+                    else if constexpr (std::is_same_v<IdType, Database::ReleaseId>)
+                        oss << "r " << id.getValue();
+                    else
+                        oss << "p " << std::hex << id.getValue() << std::dec;
+                }, entryDesc.id);
+            oss << " " << entryDesc.size << " " << static_cast<int>(entryDesc.format);
+
+            return oss.str();
+        }
+
+        std::optional<CacheEntryDesc> fromString(const std::string& str)
+        {
+            std::istringstream iss{ str };
+
+            char type{};
+            std::uint64_t id{};
+            std::size_t size{};
+            int format{};
+            iss >> type;
+            if (type == 'p')
+                iss >> std::hex >> id >> std::dec;
+            else
+                iss >> id;
+            iss >> size >> format;
+            if (!iss || (format != static_cast<int>(Image::EncodingFormat::JPEG) && format != static_cast<int>(Image::EncodingFormat::WebP)))
+                return std::nullopt;
+
+            CacheEntryDesc entryDesc{ {}, size, static_cast<Image::EncodingFormat>(format) };
+            switch (type)
+            {
+            case 't': entryDesc.id = Database::TrackId{ static_cast<Database::TrackId::ValueType>(id) }; break;
+            case 'r': entryDesc.id = Database::ReleaseId{ static_cast<Database::ReleaseId::ValueType>(id) }; break;
+            case 'p': entryDesc.id = PictureHash{ id }; break;
+            default: return std::nullopt;
+            }
+
+            return entryDesc;
+        }
+
+        std::unique_ptr<DiskCoverCache> createDiskCoverCache()
+        {
+            const std::size_t maxSize{ Service<IConfig>::get()->getULong("cover-disk-cache-max-size", 256) * 1000 * 1000 };
+            if (maxSize == 0)
+                return {};
+
+            return std::make_unique<DiskCoverCache>(Service<IConfig>::get()->getPath("working-dir") / "cache" / "covers", maxSize);
+        }
     }
 
     std::unique_ptr<ICoverService> createCoverService(Database::Db& db, const std::filesystem::path& execPath, const std::filesystem::path& defaultCoverPath)
@@ -104,11 +183,16 @@ namespace Cover
         : _db{ db }
         , _defaultCoverPath{ defaultCoverPath }
         , _maxCacheSize{ Service<IConfig>::get()->getULong("cover-max-cache-size", 30) * 1000 * 1000 }
+        , _cache{ _maxCacheSize }
+        , _configReloadCallbackId{ Service<IConfig>::get()->addReloadCallback([this] { onConfigReloaded(); }) }
         , _maxFileSize{ Service<IConfig>::get()->getULong("cover-max-file-size", 10) * 1000 * 1000 }
         , _preferredFileNames{ constructPreferredFileNames() }
-
+        , _webpQuality{ Utils::clamp<unsigned>(Service<IConfig>::get()->getULong("cover-webp-quality", 75), 1, 100) }
     {
         setJpegQuality(Service<IConfig>::get()->getULong("cover-jpeg-quality", 75));
+        _diskCache = createDiskCoverCache();
+        if (_diskCache)
+            _hotEntriesFile = Service<IConfig>::get()->getPath("working-dir") / "cache" / "cover-hot-entries";
 
         LMS_LOG(COVER, INFO) << "Default cover path = '" << _defaultCoverPath.string() << "'";
         LMS_LOG(COVER, INFO) << "Max cache size = " << _maxCacheSize;
@@ -123,47 +207,68 @@ namespace Cover
 
         try
         {
-            getDefault(512);
+            getDefault(512, EncodingFormat::JPEG);
         }
         catch (const Image::ImageException& e)
         {
+            Service<IConfig>::get()->removeReloadCallback(_configReloadCallbackId);
             throw LmsException("Cannot read default cover file '" + _defaultCoverPath.string() + "': " + e.what());
         }
     }
 
-    std::unique_ptr<IEncodedImage> CoverService::getFromAvMediaFile(const Av::IAudioFile& input, ImageSize width) const
+    CoverService::~CoverService()
+    {
+        Service<IConfig>::get()->removeReloadCallback(_configReloadCallbackId);
+
+        // keep the previous hot entries if they could not all be loaded back
+        if (!_warmupAborted)
+            saveHotEntries();
+    }
+
+    void CoverService::onConfigReloaded()
+    {
+        const std::size_t maxCacheSize{ Service<IConfig>::get()->getULong("cover-max-cache-size", 30) * 1000 * 1000 };
+        if (_maxCacheSize.exchange(maxCacheSize) == maxCacheSize)
+            return;
+
+        LMS_LOG(COVER, INFO) << "Max cache size = " << maxCacheSize;
+        _cache.setMaxSize(maxCacheSize);
+    }
+
+    std::unique_ptr<IEncodedImage> CoverService::getFromEncodedData(const std::byte* data, std::size_t dataSize, ImageSize width, EncodingFormat format) const
     {
         std::unique_ptr<IEncodedImage> image;
 
-        input.visitAttachedPictures([&](const Av::Picture& picture)
-            {
-                if (image)
-                    return;
+        // no need to decode and encode again a JPEG that is already small enough
+        if (format == EncodingFormat::JPEG)
+        {
+            if (const std::optional<ImageDimensions> dimensions{ readJPEGDimensions(data, dataSize) }; dimensions && std::max(dimensions->width, dimensions->height) <= width)
+                return std::make_unique<EncodedImage>(std::vector<std::byte>(data, data + dataSize), "image/jpeg");
+        }
 
-                try
-                {
-                    std::unique_ptr<IRawImage> rawImage{ decodeImage(picture.data, picture.dataSize) };
-                    rawImage->resize(width);
-                    image = rawImage->encodeToJPEG(_jpegQuality);
-                }
-                catch (const Image::ImageException& e)
-                {
-                    LMS_LOG(COVER, ERROR) << "Cannot read embedded cover: " << e.what();
-                }
-            });
+        try
+        {
+            std::unique_ptr<IRawImage> rawImage{ decodeImage(data, dataSize, width) };
+            rawImage->resize(width);
+            image = rawImage->encode(format, getQuality(format));
+        }
+        catch (const Image::ImageException& e)
+        {
+            LMS_LOG(COVER, ERROR) << "Cannot read embedded cover: " << e.what();
+        }
 
         return image;
     }
 
-    std::unique_ptr<IEncodedImage> CoverService::getFromCoverFile(const std::filesystem::path& p, ImageSize width) const
+    std::unique_ptr<IEncodedImage> CoverService::getFromCoverFile(const std::filesystem::path& p, ImageSize width, EncodingFormat format) const
     {
         std::unique_ptr<IEncodedImage> image;
 
         try
         {
-            std::unique_ptr<IRawImage> rawImage{ decodeImage(p) };
+            std::unique_ptr<IRawImage> rawImage{ decodeImage(p, width) };
             rawImage->resize(width);
-            image = rawImage->encodeToJPEG(_jpegQuality);
+            image = rawImage->encode(format, getQuality(format));
         }
         catch (const ImageException& e)
         {
@@ -173,32 +278,33 @@ namespace Cover
         return image;
     }
 
-    std::shared_ptr<IEncodedImage> CoverService::getDefault(ImageSize width)
+    std::shared_ptr<IEncodedImage> CoverService::getDefault(ImageSize width, EncodingFormat format)
     {
         {
-            std::shared_lock lock{ _cacheMutex };
+            std::shared_lock lock{ _defaultCoverCacheMutex };
 
-            if (auto it{ _defaultCoverCache.find(width) }; it != std::cend(_defaultCoverCache))
+            if (auto it{ _defaultCoverCache.find({ width, format }) }; it != std::cend(_defaultCoverCache))
                 return it->second;
         }
 
         {
-            std::unique_lock lock{ _cacheMutex };
+            std::unique_lock lock{ _defaultCoverCacheMutex };
 
-            if (auto it{ _defaultCoverCache.find(width) }; it != std::cend(_defaultCoverCache))
+            if (auto it{ _defaultCoverCache.find({ width, format }) }; it != std::cend(_defaultCoverCache))
                 return it->second;
 
-            std::shared_ptr<IEncodedImage> image{ getFromCoverFile(_defaultCoverPath, width) };
-            _defaultCoverCache[width] = image;
+            std::shared_ptr<IEncodedImage> image{ getFromCoverFile(_defaultCoverPath, width, format) };
+            _defaultCoverCache[{ width, format }] = image;
             LMS_LOG(COVER, DEBUG) << "Default cache entries = " << _defaultCoverCache.size();
 
             return image;
         }
     }
 
-    std::unique_ptr<IEncodedImage> CoverService::getFromDirectory(const std::filesystem::path& directory, ImageSize width) const
+    std::unique_ptr<IEncodedImage> CoverService::getFromDirectory(const std::filesystem::path& directory, ImageSize width, EncodingFormat format) const
     {
-        const std::multimap<std::string, std::filesystem::path> coverPaths{ getCoverPaths(directory) };
+        const std::shared_ptr<const DirectoryCoverPaths> directoryCoverPaths{ getDirectoryCoverPaths(directory) };
+        const std::multimap<std::string, std::filesystem::path>& coverPaths{ directoryCoverPaths->coverPaths };
 
         auto tryLoadImageFromFilename = [&](std::string_view fileName)
             {
@@ -207,7 +313,7 @@ namespace Cover
                 auto range{ coverPaths.equal_range(std::string {fileName}) };
                 for (auto it{ range.first }; it != range.second; ++it)
                 {
-                    image = getFromCoverFile(it->second, width);
+                    image = getFromCoverFile(it->second, width, format);
                     if (image)
                         break;
                 }
@@ -226,7 +332,7 @@ namespace Cover
         // Just pick one
         for (const auto& [filename, coverPath] : coverPaths)
         {
-            image = getFromCoverFile(coverPath, width);
+            image = getFromCoverFile(coverPath, width, format);
             if (image)
                 return image;
         }
@@ -234,21 +340,25 @@ namespace Cover
         return image;
     }
 
-    std::unique_ptr<IEncodedImage> CoverService::getFromSameNamedFile(const std::filesystem::path& filePath, ImageSize width) const
+    std::unique_ptr<IEncodedImage> CoverService::getFromSameNamedFile(const std::filesystem::path& filePath, ImageSize width, EncodingFormat format) const
     {
         std::unique_ptr<IEncodedImage> res;
 
-        std::filesystem::path coverPath{ filePath };
+        // candidates are already listed (and checked) in the directory's cover paths
+        const std::shared_ptr<const DirectoryCoverPaths> directoryCoverPaths{ getDirectoryCoverPaths(filePath.parent_path()) };
+        const auto range{ directoryCoverPaths->coverPaths.equal_range(filePath.stem().string()) };
+
         for (const std::filesystem::path& extension : _fileExtensions)
         {
-            coverPath.replace_extension(extension);
-
-            if (!checkCoverFile(coverPath))
-                continue;
+            for (auto it{ range.first }; it != range.second; ++it)
+            {
+                if (it->second.extension() != extension)
+                    continue;
 
-            res = getFromCoverFile(coverPath, width);
-            if (res)
-                break;
+                res = getFromCoverFile(it->second, width, format);
+                if (res)
+                    return res;
+            }
         }
 
         return res;
@@ -276,6 +386,72 @@ namespace Cover
         return true;
     }
 
+    std::int64_t CoverService::getDirectorySourceVersion(const std::filesystem::path& directory) const
+    {
+        // adding, removing or renaming a cover file updates the directory's modification time, but
+        // overwriting it does not: also take the candidate cover files into account
+        const std::shared_ptr<const DirectoryCoverPaths> directoryCoverPaths{ getDirectoryCoverPaths(directory) };
+        std::filesystem::file_time_type lastWriteTime{ directoryCoverPaths->lastWriteTime };
+
+        std::error_code ec;
+        for (const auto& [filename, coverPath] : directoryCoverPaths->coverPaths)
+        {
+            const std::filesystem::file_time_type coverLastWriteTime{ std::filesystem::last_write_time(coverPath, ec) };
+            if (!ec)
+                lastWriteTime = std::max(lastWriteTime, coverLastWriteTime);
+        }
+
+        return toSourceVersion(lastWriteTime);
+    }
+
+    std::shared_ptr<IEncodedImage> CoverService::getFromDiskCache(const CacheEntryDesc& cacheEntryDesc, std::int64_t sourceVersion)
+    {
+        if (!_diskCache)
+            return {};
+
+        std::shared_ptr<IEncodedImage> cover{ _diskCache->get(DiskCacheEntryDesc{ cacheEntryDesc, getQuality(cacheEntryDesc.format), sourceVersion }) };
+        if (cover)
+            _cache.put(cacheEntryDesc, cover);
+
+        return cover;
+    }
+
+    void CoverService::saveToDiskCache(const CacheEntryDesc& cacheEntryDesc, std::int64_t sourceVersion, std::shared_ptr<IEncodedImage> image)
+    {
+        if (_diskCache)
+            _diskCache->put(DiskCacheEntryDesc{ cacheEntryDesc, getQuality(cacheEntryDesc.format), sourceVersion }, std::move(image));
+    }
+
+    std::shared_ptr<const CoverService::DirectoryCoverPaths> CoverService::getDirectoryCoverPaths(const std::filesystem::path& directoryPath) const
+    {
+        std::error_code ec;
+        std::filesystem::file_time_type lastWriteTime{ std::filesystem::last_write_time(directoryPath, ec) };
+        if (ec)
+            lastWriteTime = {};
+
+        const std::string key{ directoryPath.string() };
+        {
+            std::shared_lock lock{ _directoryCoverPathsMutex };
+
+            // any file added, removed or renamed in the directory changes its modification time
+            if (auto it{ _directoryCoverPaths.find(key) }; it != std::cend(_directoryCoverPaths) && it->second->lastWriteTime == lastWriteTime)
+                return it->second;
+        }
+
+        auto directoryCoverPaths{ std::make_shared<const DirectoryCoverPaths>(DirectoryCoverPaths{ lastWriteTime, getCoverPaths(directoryPath) }) };
+
+        {
+            std::unique_lock lock{ _directoryCoverPathsMutex };
+
+            if (_directoryCoverPaths.size() >= _maxDirectoryCoverPathsCount)
+                _directoryCoverPaths.clear();
+
+            _directoryCoverPaths[key] = directoryCoverPaths;
+        }
+
+        return directoryCoverPaths;
+    }
+
     std::multimap<std::string, std::filesystem::path> CoverService::getCoverPaths(const std::filesystem::path& directoryPath) const
     {
         std::multimap<std::string, std::filesystem::path> res;
@@ -296,13 +472,36 @@ namespace Cover
         return res;
     }
 
-    std::unique_ptr<IEncodedImage> CoverService::getFromTrack(const std::filesystem::path& p, ImageSize width) const
+    std::shared_ptr<IEncodedImage> CoverService::getFromEmbeddedPicture(Database::TrackId trackId, const std::filesystem::path& p, ImageSize width, EncodingFormat format)
     {
-        std::unique_ptr<IEncodedImage> image;
+        std::shared_ptr<IEncodedImage> image;
+
+        auto processPicture{ [&](const std::byte* data, std::size_t dataSize)
+        {
+            const PictureHash pictureHash{ PictureHash::compute(data, dataSize) };
+
+            image = getFromEmbeddedPicture(pictureHash, data, dataSize, width, format);
+            if (image)
+                setEmbeddedPictureHash(trackId, pictureHash);
+        } };
+
+        // reading the tags is much cheaper than opening the file with libav
+        const bool hasTagPicture{ MetaData::visitEmbeddedPicture(p, [&](const MetaData::EmbeddedPicture& picture)
+            {
+                processPicture(picture.data, picture.dataSize);
+            }) };
+        if (hasTagPicture)
+            return image;
 
         try
         {
-            image = getFromAvMediaFile(*Av::parseAudioFile(p), width);
+            Av::parseAudioFile(p)->visitAttachedPictures([&](const Av::Picture& picture)
+                {
+                    if (image)
+                        return;
+
+                    processPicture(picture.data, picture.dataSize);
+                });
         }
         catch (Av::Exception& e)
         {
@@ -312,51 +511,139 @@ namespace Cover
         return image;
     }
 
-    std::shared_ptr<IEncodedImage> CoverService::getFromTrack(Database::TrackId trackId, ImageSize width)
+    std::shared_ptr<IEncodedImage> CoverService::getFromEmbeddedPicture(PictureHash pictureHash, const std::byte* data, std::size_t dataSize, ImageSize width, EncodingFormat format)
+    {
+        const CacheEntryDesc cacheEntryDesc{ pictureHash, width, format };
+
+        if (std::shared_ptr<IEncodedImage> cover{ _cache.get(cacheEntryDesc) })
+            return cover;
+
+        // the picture bytes are the source: their version never changes
+        return getOrComputeCover(cacheEntryDesc, [&]
+            {
+                std::shared_ptr<IEncodedImage> cover{ getFromDiskCache(cacheEntryDesc, 0) };
+                if (cover)
+                    return cover;
+
+                cover = getFromEncodedData(data, dataSize, width, format);
+                if (cover)
+                {
+                    _cache.put(cacheEntryDesc, cover);
+                    saveToDiskCache(cacheEntryDesc, 0, cover);
+                }
+
+                return cover;
+            });
+    }
+
+    std::optional<PictureHash> CoverService::getEmbeddedPictureHash(Database::TrackId trackId) const
     {
-        return getFromTrack(_db.getTLSSession(), trackId, width, true /* allow release fallback*/);
+        std::shared_lock lock{ _embeddedPictureHashesMutex };
+
+        if (auto it{ _embeddedPictureHashes.find(trackId) }; it != std::cend(_embeddedPictureHashes))
+            return it->second;
+
+        return std::nullopt;
+    }
+
+    void CoverService::setEmbeddedPictureHash(Database::TrackId trackId, PictureHash pictureHash)
+    {
+        std::unique_lock lock{ _embeddedPictureHashesMutex };
+
+        if (_embeddedPictureHashes.size() >= _maxEmbeddedPictureHashCount)
+            _embeddedPictureHashes.clear();
+
+        _embeddedPictureHashes[trackId] = pictureHash;
+    }
+
+    std::shared_ptr<IEncodedImage> CoverService::getTrackCoverFromCache(Database::TrackId trackId, ImageSize width, EncodingFormat format)
+    {
+        // tracks with a known embedded picture are only cached by picture
+        if (const std::optional<PictureHash> pictureHash{ getEmbeddedPictureHash(trackId) })
+            return _cache.get(CacheEntryDesc{ *pictureHash, width, format });
+
+        return _cache.get(CacheEntryDesc{ trackId, width, format });
+    }
+
+    std::shared_ptr<IEncodedImage> CoverService::getFromTrack(Database::TrackId trackId, ImageSize width, EncodingFormat format)
+    {
+        Tracing::ScopedSpan span{ "cover.getFromTrack" };
+        const CacheEntryDesc cacheEntryDesc{ trackId, width, format };
+
+        if (std::shared_ptr<IEncodedImage> cover{ getTrackCoverFromCache(trackId, width, format) })
+            return cover;
+
+        return getOrComputeCover(cacheEntryDesc, [&] { return getFromTrack(_db.getTLSSession(), trackId, width, format, true /* allow release fallback*/); });
     }
 
-    std::shared_ptr<IEncodedImage> CoverService::getFromTrack(Database::Session& dbSession, Database::TrackId trackId, ImageSize width, bool allowReleaseFallback)
+    std::shared_ptr<IEncodedImage> CoverService::getFromTrack(Database::Session& dbSession, Database::TrackId trackId, ImageSize width, EncodingFormat format, bool allowReleaseFallback)
     {
         using namespace Database;
 
-        const CacheEntryDesc cacheEntryDesc{ trackId, width };
+        const CacheEntryDesc cacheEntryDesc{ trackId, width, format };
 
-        std::shared_ptr<IEncodedImage> cover{ loadFromCache(cacheEntryDesc) };
+        std::shared_ptr<IEncodedImage> cover{ getTrackCoverFromCache(trackId, width, format) };
         if (cover)
             return cover;
 
         if (const std::optional<TrackInfo> trackInfo{ getTrackInfo(dbSession, trackId) })
         {
+            std::int64_t sourceVersion{ trackInfo->lastWritten };
+            combineSourceVersion(sourceVersion, getDirectorySourceVersion(trackInfo->trackPath.parent_path()));
+            if (trackInfo->isMultiDisc && trackInfo->trackPath.parent_path().has_parent_path())
+                combineSourceVersion(sourceVersion, getDirectorySourceVersion(trackInfo->trackPath.parent_path().parent_path()));
+
+            cover = getFromDiskCache(cacheEntryDesc, sourceVersion);
+            if (cover)
+                return cover;
+
             if (trackInfo->hasCover)
-                cover = getFromTrack(trackInfo->trackPath, width);
+            {
+                cover = getFromEmbeddedPicture(trackId, trackInfo->trackPath, width, format);
+                if (cover)
+                    return cover; // already cached by picture
+            }
 
-            if (!cover)
-                cover = getFromSameNamedFile(trackInfo->trackPath, width);
+            cover = getFromSameNamedFile(trackInfo->trackPath, width, format);
 
             if (!cover && trackInfo->releaseId && allowReleaseFallback)
-                cover = getFromRelease(*trackInfo->releaseId, width);
+                cover = getFromRelease(*trackInfo->releaseId, width, format);
 
             if (!cover && trackInfo->isMultiDisc)
             {
                 if (trackInfo->trackPath.parent_path().has_parent_path())
-                    cover = getFromDirectory(trackInfo->trackPath.parent_path().parent_path(), width);
+                    cover = getFromDirectory(trackInfo->trackPath.parent_path().parent_path(), width, format);
             }
-        }
 
-        if (cover)
-            saveToCache(cacheEntryDesc, cover);
+            if (cover)
+            {
+                _cache.put(cacheEntryDesc, cover);
+                saveToDiskCache(cacheEntryDesc, sourceVersion, cover);
+            }
+        }
 
         return cover;
     }
 
-    std::shared_ptr<IEncodedImage> CoverService::getFromRelease(Database::ReleaseId releaseId, ImageSize width)
+    std::shared_ptr<IEncodedImage> CoverService::getFromRelease(Database::ReleaseId releaseId, ImageSize width, EncodingFormat format)
+    {
+        Tracing::ScopedSpan span{ "cover.getFromRelease" };
+        const CacheEntryDesc cacheEntryDesc{ releaseId, width, format };
+
+        if (std::shared_ptr<IEncodedImage> cover{ _cache.get(cacheEntryDesc) })
+            return cover;
+
+        // Computing a release cover only waits for embedded picture computations, which never wait (track lookups done here are
+        // not coalesced), so track computations falling back on their release cannot deadlock
+        return getOrComputeCover(cacheEntryDesc, [&] { return getFromRelease(_db.getTLSSession(), releaseId, width, format); });
+    }
+
+    std::shared_ptr<IEncodedImage> CoverService::getFromRelease(Database::Session& session, Database::ReleaseId releaseId, ImageSize width, EncodingFormat format)
     {
         using namespace Database;
-        const CacheEntryDesc cacheEntryDesc{ releaseId, width };
+        const CacheEntryDesc cacheEntryDesc{ releaseId, width, format };
 
-        std::shared_ptr<IEncodedImage> cover{ loadFromCache(cacheEntryDesc) };
+        std::shared_ptr<IEncodedImage> cover{ _cache.get(cacheEntryDesc) };
         if (cover)
             return cover;
 
@@ -364,10 +651,9 @@ namespace Cover
         {
             TrackId firstTrackId;
             std::filesystem::path releaseDirectory;
+            std::int64_t lastWritten;
         };
 
-        Session& session{ _db.getTLSSession() };
-
         auto getReleaseInfo{ [&]
         {
             std::optional<ReleaseInfo> res;
@@ -382,6 +668,7 @@ namespace Cover
                 res = ReleaseInfo{};
                 res->firstTrackId = track->getId();
                 res->releaseDirectory = track->getPath().parent_path();
+                res->lastWritten = track->getLastWritten().toTime_t();
             }
 
             return res;
@@ -389,63 +676,212 @@ namespace Cover
 
         if (const std::optional<ReleaseInfo> releaseInfo{ getReleaseInfo() })
         {
-            cover = getFromDirectory(releaseInfo->releaseDirectory, width);
+            std::int64_t sourceVersion{ releaseInfo->lastWritten };
+            combineSourceVersion(sourceVersion, getDirectorySourceVersion(releaseInfo->releaseDirectory));
+
+            cover = getFromDiskCache(cacheEntryDesc, sourceVersion);
+            if (cover)
+                return cover;
+
+            cover = getFromDirectory(releaseInfo->releaseDirectory, width, format);
             if (!cover)
-                cover = getFromTrack(session, releaseInfo->firstTrackId, width, false /* no release fallback */);
+                cover = getFromTrack(session, releaseInfo->firstTrackId, width, format, false /* no release fallback */);
+
+            if (cover)
+            {
+                _cache.put(cacheEntryDesc, cover);
+                saveToDiskCache(cacheEntryDesc, sourceVersion, cover);
+            }
         }
 
-        if (cover)
-            saveToCache(cacheEntryDesc, cover);
+        return cover;
+    }
+
+    std::shared_ptr<IEncodedImage> CoverService::getOrComputeCover(const CacheEntryDesc& cacheEntryDesc, std::function<std::shared_ptr<IEncodedImage>()> computeFunc)
+    {
+        std::promise<std::shared_ptr<IEncodedImage>> promise;
+
+        {
+            std::unique_lock lock{ _pendingCoversMutex };
+
+            if (auto it{ _pendingCovers.find(cacheEntryDesc) }; it != std::cend(_pendingCovers))
+            {
+                std::shared_future<std::shared_ptr<IEncodedImage>> pendingCover{ it->second };
+                lock.unlock();
+
+                return pendingCover.get();
+            }
+
+            _pendingCovers.emplace(cacheEntryDesc, promise.get_future().share());
+        }
+
+        auto removePendingCover{ [&]
+        {
+            std::scoped_lock lock{ _pendingCoversMutex };
+            _pendingCovers.erase(cacheEntryDesc);
+        } };
+
+        std::shared_ptr<IEncodedImage> cover;
+        try
+        {
+            cover = computeFunc();
+        }
+        catch (...)
+        {
+            promise.set_exception(std::current_exception());
+            removePendingCover();
+            throw;
+        }
+
+        // computeFunc already put the cover in the cache: requests coming after the removal will find it there
+        promise.set_value(cover);
+        removePendingCover();
 
         return cover;
     }
 
     void CoverService::flushCache()
     {
-        std::unique_lock lock{ _cacheMutex };
+        const CacheStats stats{ _cache.getStats() };
+        LMS_LOG(COVER, DEBUG) << "Cache stats: hits = " << stats.hits << ", misses = " << stats.misses << ", evictions = " << stats.evictions << ", nb entries = " << stats.entryCount << ", size = " << stats.size;
 
-        LMS_LOG(COVER, DEBUG) << "Cache stats: hits = " << _cacheHits << ", misses = " << _cacheMisses << ", nb entries = " << _cache.size() << ", size = " << _cacheSize;
-        _cacheHits = 0;
-        _cacheMisses = 0;
-        _cacheSize = 0;
         _cache.clear();
+
+        {
+            std::unique_lock lock{ _embeddedPictureHashesMutex };
+            _embeddedPictureHashes.clear();
+        }
+
+        std::unique_lock lock{ _directoryCoverPathsMutex };
+        _directoryCoverPaths.clear();
     }
 
-    void CoverService::setJpegQuality(unsigned quality)
+    void CoverService::warmupCache(const std::atomic<bool>& abort)
     {
-        _jpegQuality = Utils::clamp<unsigned>(quality, 1, 100);
+        const std::vector<CacheEntryDesc> hotEntries{ loadHotEntries() };
+        if (hotEntries.empty())
+            return;
 
-        LMS_LOG(COVER, INFO) << "JPEG export quality = " << _jpegQuality;
+        const std::size_t maxThroughput{ Service<IConfig>::get()->getULong("cover-warmup-max-throughput", 4096) * 1024 };
+        const auto startTime{ std::chrono::steady_clock::now() };
+
+        LMS_LOG(COVER, INFO) << "Warming up cache using " << hotEntries.size() << " hot entries";
+
+        std::size_t loadedSize{};
+        std::size_t loadedCount{};
+        for (const CacheEntryDesc& entryDesc : hotEntries)
+        {
+            if (abort)
+            {
+                _warmupAborted = true;
+                LMS_LOG(COVER, INFO) << "Cache warmup aborted after " << loadedCount << " entries";
+                return;
+            }
+
+            // no need to go further, the next entries would evict the ones just loaded
+            if (loadedSize >= _maxCacheSize)
+                break;
+
+            std::shared_ptr<IEncodedImage> cover;
+            try
+            {
+                std::visit([&](auto id)
+                    {
+                        using IdType = std::decay_t<decltype(id)>;
+                        if constexpr (std::is_same_v<IdType, Database::TrackId>)
+                            cover = getFromTrack(id, entryDesc.size, entryDesc.format);
+                        else if constexpr (std::is_same_v<IdType, Database::ReleaseId>)
+                            cover = getFromRelease(id, entryDesc.size, entryDesc.format);
+                        else
+                            cover = getFromDiskCache(entryDesc, 0); // the picture bytes are not known here
+                    }, entryDesc.id);
+            }
+            catch (const std::exception& e)
+            {
+                LMS_LOG(COVER, DEBUG) << "Cannot warm up cover entry: " << e.what();
+            }
+
+            if (!cover)
+                continue;
+
+            loadedSize += cover->getDataSize();
+            loadedCount++;
+
+            if (maxThroughput > 0)
+                std::this_thread::sleep_until(startTime + std::chrono::microseconds{ loadedSize * 1'000'000 / maxThroughput });
+        }
+
+        LMS_LOG(COVER, INFO) << "Cache warmup complete: loaded " << loadedCount << " entries (" << loadedSize / 1024 << " KiB)";
     }
 
-    void CoverService::saveToCache(const CacheEntryDesc& entryDesc, std::shared_ptr<IEncodedImage> image)
+    void CoverService::saveHotEntries() const
     {
-        std::unique_lock lock{ _cacheMutex };
+        if (_hotEntriesFile.empty())
+            return;
+
+        const std::vector<CacheEntryDesc> hotEntries{ _cache.getHotEntries() };
+        if (hotEntries.empty())
+            return;
 
-        while (_cacheSize + image->getDataSize() > _maxCacheSize && !_cache.empty())
+        const std::filesystem::path tmpFile{ _hotEntriesFile.string() + ".tmp" };
         {
-            auto itRandom{ Random::pickRandom(_cache) };
-            _cacheSize -= itRandom->second->getDataSize();
-            _cache.erase(itRandom);
+            std::ofstream file{ tmpFile, std::ios::out | std::ios::trunc };
+            for (const CacheEntryDesc& entryDesc : hotEntries)
+                file << toString(entryDesc) << '\n';
+
+            if (!file)
+            {
+                LMS_LOG(COVER, ERROR) << "Cannot write hot cache entries in '" << tmpFile.string() << "'";
+                return;
+            }
         }
 
-        _cacheSize += image->getDataSize();
-        _cache[entryDesc] = image;
+        std::error_code ec;
+        std::filesystem::rename(tmpFile, _hotEntriesFile, ec);
+        if (ec)
+            LMS_LOG(COVER, ERROR) << "Cannot save hot cache entries in '" << _hotEntriesFile.string() << "': " << ec.message();
     }
 
-    std::shared_ptr<IEncodedImage> CoverService::loadFromCache(const CacheEntryDesc& entryDesc)
+    std::vector<CacheEntryDesc> CoverService::loadHotEntries() const
     {
-        std::shared_lock lock{ _cacheMutex };
+        std::vector<CacheEntryDesc> hotEntries;
+        if (_hotEntriesFile.empty())
+            return hotEntries;
+
+        std::ifstream file{ _hotEntriesFile };
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (const std::optional<CacheEntryDesc> entryDesc{ fromString(line) })
+                hotEntries.push_back(*entryDesc);
+        }
 
-        auto it{ _cache.find(entryDesc) };
-        if (it == std::cend(_cache))
+        return hotEntries;
+    }
+
+    CoverService::CacheStats CoverService::getCacheStats() const
+    {
+        return _cache.getStats();
+    }
+
+    void CoverService::setJpegQuality(unsigned quality)
+    {
+        _jpegQuality = Utils::clamp<unsigned>(quality, 1, 100);
+
+        LMS_LOG(COVER, INFO) << "JPEG export quality = " << _jpegQuality;
+    }
+
+    unsigned CoverService::getQuality(EncodingFormat format) const
+    {
+        switch (format)
         {
-            ++_cacheMisses;
-            return nullptr;
+        case EncodingFormat::JPEG:
+            return _jpegQuality;
+        case EncodingFormat::WebP:
+            return _webpQuality;
         }
 
-        ++_cacheHits;
-        return it->second;
+        return _jpegQuality;
     }
 
 } // namespace Cover
@@ -20,8 +20,13 @@
 #pragma once
 
 #include <atomic>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <future>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <shared_mutex>
 #include <string_view>
@@ -30,101 +35,97 @@
 #include <vector>
 
 #include "services/cover/ICoverService.hpp"
+#include "CoverCache.hpp"
+#include "DiskCoverCache.hpp"
 #include "image/IEncodedImage.hpp"
 #include "services/database/Types.hpp"
+#include "utils/IConfig.hpp"
 
 namespace Database
 {
     class Session;
 }
 
-namespace Av
-{
-    class IAudioFile;
-}
-
-namespace Cover
-{
-    struct CacheEntryDesc
-    {
-        std::variant<Database::TrackId, Database::ReleaseId> id;
-        std::size_t			size;
-
-        bool operator==(const CacheEntryDesc& other) const
-        {
-            return id == other.id
-                && size == other.size;
-        }
-    };
-} // ns Cover
-
-namespace std
-{
-    template<>
-    class hash<Cover::CacheEntryDesc>
-    {
-    public:
-        size_t operator()(const Cover::CacheEntryDesc& e) const
-        {
-            size_t h{};
-            std::visit([&](auto id)
-                {
-                    using IdType = std::decay_t<decltype(id)>;
-                    h ^= std::hash<IdType>()(id);
-                }, e.id);
-            h ^= std::hash<std::size_t>()(e.size) << 1;
-            return h;
-        }
-    };
-
-} // ns std
-
 namespace Cover
 {
     class CoverService : public ICoverService
     {
     public:
         CoverService(Database::Db& db, const std::filesystem::path& execPath, const std::filesystem::path& defaultCoverPath);
+        ~CoverService() override;
 
         CoverService(const CoverService&) = delete;
         CoverService& operator=(const CoverService&) = delete;
 
     private:
-        std::shared_ptr<Image::IEncodedImage>   getFromTrack(Database::TrackId trackId, Image::ImageSize width) override;
-        std::shared_ptr<Image::IEncodedImage>   getFromRelease(Database::ReleaseId releaseId, Image::ImageSize width) override;
-        std::shared_ptr<Image::IEncodedImage>   getDefault(Image::ImageSize width) override;
+        std::shared_ptr<Image::IEncodedImage>   getFromTrack(Database::TrackId trackId, Image::ImageSize width, Image::EncodingFormat format) override;
+        std::shared_ptr<Image::IEncodedImage>   getFromRelease(Database::ReleaseId releaseId, Image::ImageSize width, Image::EncodingFormat format) override;
+        std::shared_ptr<Image::IEncodedImage>   getDefault(Image::ImageSize width, Image::EncodingFormat format) override;
         void                                    flushCache() override;
+        CacheStats                              getCacheStats() const override;
         void                                    setJpegQuality(unsigned quality) override;
-
-        std::shared_ptr<Image::IEncodedImage>   getFromTrack(Database::Session& dbSession, Database::TrackId trackId, Image::ImageSize width, bool allowReleaseFallback);
-        std::unique_ptr<Image::IEncodedImage>   getFromAvMediaFile(const Av::IAudioFile& input, Image::ImageSize width) const;
-        std::unique_ptr<Image::IEncodedImage>   getFromCoverFile(const std::filesystem::path& p, Image::ImageSize width) const;
-
-        std::unique_ptr<Image::IEncodedImage>   getFromTrack(const std::filesystem::path& path, Image::ImageSize width) const;
+        void                                    warmupCache(const std::atomic<bool>& abort) override;
+        unsigned                                getQuality(Image::EncodingFormat format) const;
+
+        std::shared_ptr<Image::IEncodedImage>   getFromTrack(Database::Session& dbSession, Database::TrackId trackId, Image::ImageSize width, Image::EncodingFormat format, bool allowReleaseFallback);
+        std::shared_ptr<Image::IEncodedImage>   getFromRelease(Database::Session& dbSession, Database::ReleaseId releaseId, Image::ImageSize width, Image::EncodingFormat format);
+        // concurrent misses on the same entry wait for the first one to compute the cover
+        std::shared_ptr<Image::IEncodedImage>   getOrComputeCover(const CacheEntryDesc& cacheEntryDesc, std::function<std::shared_ptr<Image::IEncodedImage>()> computeFunc);
+        std::unique_ptr<Image::IEncodedImage>   getFromEncodedData(const std::byte* data, std::size_t dataSize, Image::ImageSize width, Image::EncodingFormat format) const;
+        std::unique_ptr<Image::IEncodedImage>   getFromCoverFile(const std::filesystem::path& p, Image::ImageSize width, Image::EncodingFormat format) const;
+
+        std::shared_ptr<Image::IEncodedImage>   getTrackCoverFromCache(Database::TrackId trackId, Image::ImageSize width, Image::EncodingFormat format);
+        // embedded covers are cached by picture, tracks embedding the same picture share the same entries
+        std::shared_ptr<Image::IEncodedImage>   getFromEmbeddedPicture(Database::TrackId trackId, const std::filesystem::path& path, Image::ImageSize width, Image::EncodingFormat format);
+        std::shared_ptr<Image::IEncodedImage>   getFromEmbeddedPicture(PictureHash pictureHash, const std::byte* data, std::size_t dataSize, Image::ImageSize width, Image::EncodingFormat format);
+        std::optional<PictureHash>              getEmbeddedPictureHash(Database::TrackId trackId) const;
+        void                                    setEmbeddedPictureHash(Database::TrackId trackId, PictureHash pictureHash);
         std::multimap<std::string, std::filesystem::path>   getCoverPaths(const std::filesystem::path& directoryPath) const;
-        std::unique_ptr<Image::IEncodedImage>   getFromDirectory(const std::filesystem::path& directory, Image::ImageSize width) const;
-        std::unique_ptr<Image::IEncodedImage>   getFromSameNamedFile(const std::filesystem::path& filePath, Image::ImageSize width) const;
+        struct DirectoryCoverPaths
+        {
+            std::filesystem::file_time_type lastWriteTime;
+            std::multimap<std::string, std::filesystem::path> coverPaths;
+        };
+        // memoized version of getCoverPaths, checked against the directory's modification time
+        std::shared_ptr<const DirectoryCoverPaths> getDirectoryCoverPaths(const std::filesystem::path& directoryPath) const;
+        std::unique_ptr<Image::IEncodedImage>   getFromDirectory(const std::filesystem::path& directory, Image::ImageSize width, Image::EncodingFormat format) const;
+        std::unique_ptr<Image::IEncodedImage>   getFromSameNamedFile(const std::filesystem::path& filePath, Image::ImageSize width, Image::EncodingFormat format) const;
 
         bool                                    checkCoverFile(const std::filesystem::path& directoryPath) const;
+        std::int64_t                            getDirectorySourceVersion(const std::filesystem::path& directory) const;
 
-        Database::Db& _db;
+        void                                    onConfigReloaded();
+        void                                    saveHotEntries() const;
+        std::vector<CacheEntryDesc>             loadHotEntries() const;
 
-        std::shared_mutex _cacheMutex;
-        std::unordered_map<CacheEntryDesc, std::shared_ptr<Image::IEncodedImage>> _cache;
-        std::unordered_map<Image::ImageSize, std::shared_ptr<Image::IEncodedImage>> _defaultCoverCache;
-        std::atomic<std::size_t>    _cacheMisses{};
-        std::atomic<std::size_t>    _cacheHits{};
-        std::size_t                 _cacheSize{};
+        std::shared_ptr<Image::IEncodedImage>   getFromDiskCache(const CacheEntryDesc& cacheEntryDesc, std::int64_t sourceVersion);
+        void                                    saveToDiskCache(const CacheEntryDesc& cacheEntryDesc, std::int64_t sourceVersion, std::shared_ptr<Image::IEncodedImage> image);
+
+        Database::Db& _db;
 
-        void saveToCache(const CacheEntryDesc& entryDesc, std::shared_ptr<Image::IEncodedImage> image);
-        std::shared_ptr<Image::IEncodedImage> loadFromCache(const CacheEntryDesc& entryDesc);
+        std::shared_mutex _defaultCoverCacheMutex;
+        std::map<std::pair<Image::ImageSize, Image::EncodingFormat>, std::shared_ptr<Image::IEncodedImage>> _defaultCoverCache;
 
         const std::filesystem::path _defaultCoverPath;
-        const std::size_t _maxCacheSize;
+        std::atomic<std::size_t> _maxCacheSize;
+        CoverCache _cache;
+        IConfig::ReloadCallbackId _configReloadCallbackId;
+        std::mutex _pendingCoversMutex;
+        std::unordered_map<CacheEntryDesc, std::shared_future<std::shared_ptr<Image::IEncodedImage>>> _pendingCovers;
+        static constexpr std::size_t _maxDirectoryCoverPathsCount{ 4096 };
+        mutable std::shared_mutex _directoryCoverPathsMutex;
+        mutable std::unordered_map<std::string, std::shared_ptr<const DirectoryCoverPaths>> _directoryCoverPaths; // indexed by directory path
+        static constexpr std::size_t _maxEmbeddedPictureHashCount{ 65536 };
+        mutable std::shared_mutex _embeddedPictureHashesMutex;
+        std::unordered_map<Database::TrackId, PictureHash> _embeddedPictureHashes; // filled when the tracks covers are loaded
         static inline const std::vector<std::filesystem::path> _fileExtensions{ ".jpg", ".jpeg", ".png", ".bmp" }; // TODO parametrize
         const std::size_t _maxFileSize;
         const std::vector<std::string> _preferredFileNames;
         unsigned _jpegQuality;
+        const unsigned _webpQuality;
+        std::unique_ptr<DiskCoverCache> _diskCache; // null if disabled
+        std::filesystem::path _hotEntriesFile; // empty if the disk cache is disabled
+        std::atomic<bool> _warmupAborted{};
     };
 
 } // namespace Cover
@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "DiskCoverCache.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <type_traits>
+#include <variant>
+#include <vector>
+#include <boost/asio/post.hpp>
+
+#include "utils/Logger.hpp"
+#include "EncodedImage.hpp"
+
+namespace Cover
+{
+    namespace
+    {
+        std::string_view getEntryExtension(Image::EncodingFormat format)
+        {
+            switch (format)
+            {
+            case Image::EncodingFormat::JPEG:
+                return ".jpg";
+            case Image::EncodingFormat::WebP:
+                return ".webp";
+            }
+
+            return ".bin";
+        }
+
+        std::string_view getMimeType(Image::EncodingFormat format)
+        {
+            switch (format)
+            {
+            case Image::EncodingFormat::JPEG:
+                return "image/jpeg";
+            case Image::EncodingFormat::WebP:
+                return "image/webp";
+            }
+
+            return "application/octet-stream";
+        }
+
+        // temporary files are named "<entry><tmpExtensionPrefix><counter>"
+        constexpr std::string_view tmpExtensionPrefix{ ".tmp" };
+    }
+
+    DiskCoverCache::DiskCoverCache(const std::filesystem::path& directory, std::size_t maxSize)
+        : _directory{ directory }
+        , _maxSize{ maxSize }
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(_directory, ec);
+        if (ec)
+            LMS_LOG(COVER, ERROR) << "Cannot create cover cache directory '" << _directory.string() << "': " << ec.message();
+
+        LMS_LOG(COVER, INFO) << "Disk cache directory = '" << _directory.string() << "', max size = " << _maxSize;
+
+        // compute the current size (and enforce the limit if it has been lowered) without delaying the startup
+        boost::asio::post(_ioContext, [this] { evictEntries(); });
+        _ioContextRunner = std::make_unique<IOContextRunner>(_ioContext, 1);
+    }
+
+    DiskCoverCache::~DiskCoverCache()
+    {
+        _ioContextRunner.reset();
+    }
+
+    std::shared_ptr<Image::IEncodedImage> DiskCoverCache::get(const DiskCacheEntryDesc& entryDesc)
+    {
+        const std::filesystem::path entryPath{ getEntryPath(entryDesc) };
+
+        std::ifstream ifs{ entryPath, std::ios::binary | std::ios::ate };
+        if (!ifs)
+            return {};
+
+        const std::streamsize size{ ifs.tellg() };
+        if (size <= 0)
+            return {};
+
+        std::vector<std::byte> data(static_cast<std::size_t>(size));
+        ifs.seekg(0);
+        if (!ifs.read(reinterpret_cast<char*>(data.data()), size))
+            return {};
+
+        // the modification time is used to find the least recently used entries
+        std::error_code ec;
+        std::filesystem::last_write_time(entryPath, std::filesystem::file_time_type::clock::now(), ec);
+
+        return std::make_shared<EncodedImage>(std::move(data), getMimeType(entryDesc.entryDesc.format));
+    }
+
+    void DiskCoverCache::put(const DiskCacheEntryDesc& entryDesc, std::shared_ptr<Image::IEncodedImage> image)
+    {
+        boost::asio::post(_ioContext, [this, entryPath = getEntryPath(entryDesc), image = std::move(image)]
+            {
+                std::error_code ec;
+                if (std::filesystem::exists(entryPath, ec))
+                    return;
+
+                writeEntry(entryPath, *image);
+            });
+    }
+
+    std::filesystem::path DiskCoverCache::getEntryPath(const DiskCacheEntryDesc& entryDesc) const
+    {
+        std::ostringstream fileName;
+        unsigned subDirectory{};
+
+        std::visit([&](auto id)
+            {
+                using IdType = std::decay_t<decltype(id)>;
+                if constexpr (std::is_same_v<IdType, PictureHash>)
+                    fileName << "p" << std::hex << id.getValue() << std::dec;
+                else
+                    fileName << (std::is_same_v<IdType, Database::TrackId> ? "t" : "r") << id.getValue();
+                subDirectory = static_cast<unsigned>(id.getValue() & 0xFF);
+            }, entryDesc.entryDesc.id);
+
+        fileName << "_" << entryDesc.entryDesc.size << "_" << entryDesc.quality << "_" << entryDesc.sourceVersion << getEntryExtension(entryDesc.entryDesc.format);
+
+        std::ostringstream subDirectoryName;
+        subDirectoryName << std::hex << std::setw(2) << std::setfill('0') << subDirectory;
+
+        return _directory / subDirectoryName.str() / fileName.str();
+    }
+
+    void DiskCoverCache::writeEntry(const std::filesystem::path& entryPath, const Image::IEncodedImage& image)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(entryPath.parent_path(), ec);
+        if (ec)
+        {
+            LMS_LOG(COVER, ERROR) << "Cannot create cover cache directory '" << entryPath.parent_path().string() << "': " << ec.message();
+            return;
+        }
+
+        // write in a temporary file first so that readers never see partial entries
+        std::filesystem::path tmpPath{ entryPath };
+        tmpPath += std::string{ tmpExtensionPrefix } + std::to_string(_tmpFileCounter++);
+
+        {
+            std::ofstream ofs{ tmpPath, std::ios::binary | std::ios::trunc };
+            ofs.write(reinterpret_cast<const char*>(image.getData()), image.getDataSize());
+            if (!ofs)
+            {
+                LMS_LOG(COVER, ERROR) << "Cannot write cover cache entry '" << tmpPath.string() << "'";
+                ofs.close();
+                std::filesystem::remove(tmpPath, ec);
+                return;
+            }
+        }
+
+        std::filesystem::rename(tmpPath, entryPath, ec);
+        if (ec)
+        {
+            LMS_LOG(COVER, ERROR) << "Cannot rename cover cache entry '" << tmpPath.string() << "': " << ec.message();
+            std::filesystem::remove(tmpPath, ec);
+            return;
+        }
+
+        _currentSize += image.getDataSize();
+        if (_currentSize > _maxSize)
+            evictEntries();
+    }
+
+    void DiskCoverCache::evictEntries()
+    {
+        struct EntryInfo
+        {
+            std::filesystem::file_time_type lastWriteTime;
+            std::size_t size;
+            std::filesystem::path path;
+        };
+
+        std::vector<EntryInfo> entries;
+        std::size_t totalSize{};
+
+        std::error_code ec;
+        std::filesystem::recursive_directory_iterator itPath{ _directory, ec };
+        const std::filesystem::recursive_directory_iterator itEnd;
+        while (!ec && itPath != itEnd)
+        {
+            const std::filesystem::path path{ *itPath };
+
+            std::error_code fileEc;
+            if (std::filesystem::is_regular_file(path, fileEc))
+            {
+                if (path.extension().string().compare(0, tmpExtensionPrefix.size(), tmpExtensionPrefix) == 0)
+                {
+                    // leftover of an interrupted write
+                    std::filesystem::remove(path, fileEc);
+                }
+                else
+                {
+                    const std::size_t size{ static_cast<std::size_t>(std::filesystem::file_size(path, fileEc)) };
+                    const std::filesystem::file_time_type lastWriteTime{ std::filesystem::last_write_time(path, fileEc) };
+                    if (!fileEc)
+                    {
+                        entries.push_back(EntryInfo{ lastWriteTime, size, path });
+                        totalSize += size;
+                    }
+                }
+            }
+
+            itPath.increment(ec);
+        }
+
+        if (totalSize > _maxSize)
+        {
+            // evict a bit more than needed to avoid scanning the whole cache on each write
+            const std::size_t targetSize{ _maxSize / 10 * 9 };
+
+            std::sort(std::begin(entries), std::end(entries), [](const EntryInfo& lhs, const EntryInfo& rhs) { return lhs.lastWriteTime < rhs.lastWriteTime; });
+
+            std::size_t evictedCount{};
+            for (const EntryInfo& entry : entries)
+            {
+                if (totalSize <= targetSize)
+                    break;
+
+                std::error_code fileEc;
+                if (std::filesystem::remove(entry.path, fileEc))
+                {
+                    totalSize -= entry.size;
+                    evictedCount++;
+                }
+            }
+
+            LMS_LOG(COVER, DEBUG) << "Evicted " << evictedCount << " disk cache entries";
+        }
+
+        _currentSize = totalSize;
+        LMS_LOG(COVER, DEBUG) << "Disk cache size = " << _currentSize;
+    }
+} // namespace Cover
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <boost/asio/io_context.hpp>
+
+#include "image/IEncodedImage.hpp"
+#include "utils/IOContextRunner.hpp"
+#include "CoverCache.hpp"
+
+namespace Cover
+{
+    struct DiskCacheEntryDesc
+    {
+        CacheEntryDesc entryDesc;
+        unsigned quality;
+        std::int64_t sourceVersion; // changes whenever the cover source is modified
+    };
+
+    // Persistent cache of resized covers, stored as JPEG files
+    // Entries of modified sources are never looked up again since the source version is part of their name:
+    // they just age out when the cache is full (least recently used files are removed first)
+    class DiskCoverCache
+    {
+    public:
+        DiskCoverCache(const std::filesystem::path& directory, std::size_t maxSize);
+        ~DiskCoverCache();
+
+        DiskCoverCache(const DiskCoverCache&) = delete;
+        DiskCoverCache& operator=(const DiskCoverCache&) = delete;
+
+        std::shared_ptr<Image::IEncodedImage> get(const DiskCacheEntryDesc& entryDesc);
+        void put(const DiskCacheEntryDesc& entryDesc, std::shared_ptr<Image::IEncodedImage> image); // written in background
+
+    private:
+        std::filesystem::path getEntryPath(const DiskCacheEntryDesc& entryDesc) const;
+        void writeEntry(const std::filesystem::path& entryPath, const Image::IEncodedImage& image);
+        void evictEntries();
+
+        const std::filesystem::path _directory;
+        const std::size_t _maxSize;
+        std::size_t _currentSize{}; // only accessed by the background thread
+        std::atomic<std::size_t> _tmpFileCounter{};
+
+        boost::asio::io_context _ioContext;
+        std::unique_ptr<IOContextRunner> _ioContextRunner;
+    };
+} // namespace Cover
+
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include "image/IEncodedImage.hpp"
+
+namespace Cover
+{
+    // Already encoded image data (read from the disk cache or extracted from a file)
+    class EncodedImage : public Image::IEncodedImage
+    {
+    public:
+        EncodedImage(std::vector<std::byte>&& data, std::string_view mimeType) : _data{ std::move(data) }, _mimeType{ mimeType } {}
+
+    private:
+        const std::byte* getData() const override { return _data.data(); }
+        std::size_t getDataSize() const override { return _data.size(); }
+        std::string_view getMimeType() const override { return _mimeType; }
+
+        const std::vector<std::byte> _data;
+        const std::string_view _mimeType; // must be a literal
+    };
+} // namespace Cover
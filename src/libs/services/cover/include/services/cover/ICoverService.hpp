@@ -19,6 +19,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstddef>
 #include <filesystem>
 #include <memory>
 
@@ -38,14 +40,29 @@ namespace Cover
     public:
         virtual ~ICoverService() = default;
 
-        virtual std::shared_ptr<Image::IEncodedImage> getFromTrack(Database::TrackId trackId, Image::ImageSize width) = 0;
-        virtual std::shared_ptr<Image::IEncodedImage> getFromRelease(Database::ReleaseId releaseId, Image::ImageSize width) = 0;
+        // format must be supported by the image library (see Image::isEncodingFormatSupported)
+        virtual std::shared_ptr<Image::IEncodedImage> getFromTrack(Database::TrackId trackId, Image::ImageSize width, Image::EncodingFormat format) = 0;
+        virtual std::shared_ptr<Image::IEncodedImage> getFromRelease(Database::ReleaseId releaseId, Image::ImageSize width, Image::EncodingFormat format) = 0;
 
-        virtual std::shared_ptr<Image::IEncodedImage> getDefault(Image::ImageSize width) = 0;
+        virtual std::shared_ptr<Image::IEncodedImage> getDefault(Image::ImageSize width, Image::EncodingFormat format) = 0;
 
         virtual void flushCache() = 0;
 
+        struct CacheStats
+        {
+            std::size_t hits{};
+            std::size_t misses{};
+            std::size_t evictions{};
+            std::size_t entryCount{};
+            std::size_t size{};     // in bytes
+        };
+        virtual CacheStats getCacheStats() const = 0; // counters are not reset on flush
+
         virtual void setJpegQuality(unsigned quality) = 0; // from 1 to 100
+
+        // Loads back the covers that were the most used before the last exit, up to the cache size
+        // Blocking, returns early if abort is set (the hot covers are then not saved on exit, to be warmed up again next time)
+        virtual void warmupCache(const std::atomic<bool>& abort) = 0;
     };
 
     std::unique_ptr<ICoverService> createCoverService(Database::Db& db, const std::filesystem::path& execPath, const std::filesystem::path& defaultCoverPath);
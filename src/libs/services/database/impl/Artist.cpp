@@ -21,11 +21,14 @@
 #include <Wt/Dbo/WtSqlTraits.h>
 
 #include "services/database/Cluster.hpp"
+#include "services/database/Db.hpp"
+#include "services/database/LibraryCatalog.hpp"
 #include "services/database/Release.hpp"
 #include "services/database/Session.hpp"
 #include "services/database/Track.hpp"
 #include "services/database/User.hpp"
 #include "utils/Logger.hpp"
+#include "utils/String.hpp"
 #include "SqlQuery.hpp"
 #include "Utils.hpp"
 #include "EnumSetTraits.hpp"
@@ -43,6 +46,7 @@ namespace Database
             auto query{ session.getDboSession().query<ResultType>("SELECT DISTINCT " + std::string{ itemToSelect } + " FROM artist a") };
             if (params.sortMethod == ArtistSortMethod::LastWritten
                 || params.writtenAfter.isValid()
+                || params.addedAfter.isValid()
                 || params.linkType
                 || params.track.isValid()
                 || params.release.isValid()
@@ -58,7 +62,20 @@ namespace Database
             if (params.writtenAfter.isValid())
                 query.where("t.file_last_write > ?").bind(params.writtenAfter);
 
-            if (!params.keywords.empty())
+            if (params.addedAfter.isValid())
+                query.where("t.file_added > ?").bind(params.addedAfter);
+
+            assert(!params.afterId.isValid() || params.sortMethod == ArtistSortMethod::Id);
+            if (params.afterId.isValid())
+                query.where("a.id > ?").bind(params.afterId);
+
+            const std::string ftsNameQuery{ (!params.keywords.empty() && session.getDb().isFullTextSearchEnabled()) ? Utils::buildFullTextSearchQuery(params.keywords, "name") : "" };
+            if (!ftsNameQuery.empty())
+            {
+                const std::string ftsSortNameQuery{ Utils::buildFullTextSearchQuery(params.keywords, "sort_name") };
+                query.where("a.id IN (SELECT rowid FROM artist_fts WHERE artist_fts MATCH ?)").bind("(" + ftsNameQuery + ") OR (" + ftsSortNameQuery + ")");
+            }
+            else if (!params.keywords.empty())
             {
                 std::vector<std::string> clauses;
                 std::vector<std::string> sortClauses;
@@ -78,6 +95,13 @@ namespace Database
                 query.where("(" + StringUtils::joinStrings(clauses, " AND ") + ") OR (" + StringUtils::joinStrings(sortClauses, " AND ") + ")");
             }
 
+            if (!params.ids.empty())
+            {
+                query.where("a.id IN (" + Utils::makePlaceholders(params.ids.size()) + ")");
+                for (const ArtistId id : params.ids)
+                    query.bind(id);
+            }
+
             if (params.starringUser.isValid())
             {
                 assert(params.feedbackBackend);
@@ -124,11 +148,14 @@ namespace Database
             {
             case ArtistSortMethod::None:
                 break;
+            case ArtistSortMethod::Id:
+                query.orderBy("a.id");
+                break;
             case ArtistSortMethod::ByName:
                 query.orderBy("a.name COLLATE NOCASE");
                 break;
             case ArtistSortMethod::BySortName:
-                query.orderBy("a.sort_name COLLATE NOCASE");
+                query.orderBy("a.sort_key, a.id");
                 break;
             case ArtistSortMethod::Random:
                 query.orderBy("RANDOM()");
@@ -159,11 +186,53 @@ namespace Database
 
             return createQuery<ResultType>(session, itemToSelect, params);
         }
+
+        // Returns std::nullopt if the random sampling cannot be used for these parameters
+        std::optional<RangeResults<ArtistId>> findRandomIds(Session& session, const Artist::FindParameters& params)
+        {
+            // no sampling for paginated random results
+            if (params.sortMethod != ArtistSortMethod::Random || !params.range || params.range->offset != 0)
+                return std::nullopt;
+
+            Artist::FindParameters filterParams{ params };
+            filterParams.setSortMethod(ArtistSortMethod::None);
+            filterParams.setRange(std::nullopt);
+
+            std::optional<std::vector<ArtistId>> ids{ Utils::sampleRandomIds<ArtistId>(session.getDboSession(), "artist", params.range->size, [&](const std::vector<ArtistId>& candidates)
+            {
+                auto query{ createQuery<ArtistId>(session, filterParams) };
+                query.where("a.id IN (" + Utils::makePlaceholders(candidates.size()) + ")");
+                for (const ArtistId candidate : candidates)
+                    query.bind(candidate);
+
+                auto results{ query.resultList() };
+                return std::vector<ArtistId>(std::cbegin(results), std::cend(results));
+            }) };
+
+            if (!ids)
+                return std::nullopt;
+
+            RangeResults<ArtistId> res;
+            res.range = Range{ 0, ids->size() };
+            res.results = std::move(*ids);
+            return res;
+        }
+
+        // Returns std::nullopt if the library catalog is not available or cannot handle these parameters
+        std::optional<RangeResults<ArtistId>> findCatalogIds(Session& session, const Artist::FindParameters& params)
+        {
+            const std::shared_ptr<const LibraryCatalog> catalog{ session.getDb().getLibraryCatalog() };
+            if (!catalog)
+                return std::nullopt;
+
+            return catalog->findArtistIds(params);
+        }
     }
 
     Artist::Artist(const std::string& name, const std::optional<UUID>& MBID)
         : _name{ std::string(name, 0 , _maxNameLength) },
         _sortName{ _name },
+        _sortKey{ StringUtils::computeSortKey(_sortName) },
         _MBID{ MBID ? MBID->getAsString() : "" }
     {
     }
@@ -203,6 +272,14 @@ namespace Database
         return session.getDboSession().find<Artist>().where("id = ?").bind(id).resultValue();
     }
 
+    std::vector<Artist::pointer> Artist::find(Session& session, const std::vector<ArtistId>& ids)
+    {
+        session.checkSharedLocked();
+
+        const auto objects{ Utils::findByIds<Artist>(session.getDboSession(), ids) };
+        return std::vector<Artist::pointer>(std::cbegin(objects), std::cend(objects));
+    }
+
     bool Artist::exists(Session& session, ArtistId id)
     {
         session.checkSharedLocked();
@@ -217,10 +294,29 @@ namespace Database
         return Utils::execQuery<ArtistId>(query, range);
     }
 
+    void Artist::remove(Session& session, const std::vector<ArtistId>& artistIds)
+    {
+        session.checkUniqueLocked();
+
+        if (artistIds.empty())
+            return;
+
+        auto call{ session.getDboSession().execute("DELETE FROM artist WHERE id IN (" + Utils::makePlaceholders(artistIds.size()) + ")") };
+        for (const ArtistId artistId : artistIds)
+            call.bind(artistId);
+        call.run();
+    }
+
     RangeResults<ArtistId> Artist::findIds(Session& session, const FindParameters& params)
     {
         session.checkSharedLocked();
 
+        if (std::optional<RangeResults<ArtistId>> catalogIds{ findCatalogIds(session, params) })
+            return *catalogIds;
+
+        if (std::optional<RangeResults<ArtistId>> randomIds{ findRandomIds(session, params) })
+            return *randomIds;
+
         auto query{ createQuery<ArtistId>(session, params) };
         return Utils::execQuery<ArtistId>(query, params.range);
     }
@@ -229,6 +325,21 @@ namespace Database
     {
         session.checkSharedLocked();
 
+        std::optional<RangeResults<ArtistId>> ids{ findCatalogIds(session, params) };
+        if (!ids)
+            ids = findRandomIds(session, params);
+
+        if (ids)
+        {
+            RangeResults<pointer> res;
+            res.range = ids->range;
+            res.moreResults = ids->moreResults;
+            res.results.reserve(ids->results.size());
+            for (const ArtistId id : ids->results)
+                res.results.push_back(find(session, id));
+            return res;
+        }
+
         auto query{ createQuery<Wt::Dbo::ptr<Artist>>(session, params) };
         return Utils::execQuery<Artist::pointer>(query, params.range);
     }
@@ -332,6 +443,7 @@ namespace Database
     void Artist::setSortName(const std::string& sortName)
     {
         _sortName = std::string(sortName, 0, _maxNameLength);
+        _sortKey = StringUtils::computeSortKey(_sortName);
     }
 
 } // namespace Database
@@ -0,0 +1,307 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "services/database/Backup.hpp"
+
+#include <algorithm>
+#include <ctime>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include "services/database/Db.hpp"
+#include "services/database/Session.hpp"
+#include "utils/Exception.hpp"
+#include "utils/Logger.hpp"
+#include "Migration.hpp"
+
+namespace Database
+{
+    namespace
+    {
+        // 1 MiB using the default 4 KiB pages
+        constexpr int pagesPerStep{ 256 };
+
+        constexpr std::string_view backupFilePrefix{ "lms-backup-" };
+        constexpr std::string_view backupFileExtension{ ".db" };
+
+        class SqliteConnection
+        {
+        public:
+            SqliteConnection(const std::filesystem::path& path, int flags)
+            {
+                if (sqlite3_open_v2(path.c_str(), &_db, flags, nullptr) != SQLITE_OK)
+                {
+                    const std::string error{ _db ? sqlite3_errmsg(_db) : "out of memory" };
+                    sqlite3_close(_db);
+                    throw LmsException{ "Cannot open '" + path.string() + "': " + error };
+                }
+            }
+            ~SqliteConnection()
+            {
+                sqlite3_close(_db);
+            }
+
+            SqliteConnection(const SqliteConnection&) = delete;
+            SqliteConnection& operator=(const SqliteConnection&) = delete;
+
+            sqlite3* get() const { return _db; }
+
+            void execute(const char* sql)
+            {
+                if (sqlite3_exec(_db, sql, nullptr, nullptr, nullptr) != SQLITE_OK)
+                    throw LmsException{ std::string{ "Cannot execute '" } + sql + "': " + sqlite3_errmsg(_db) };
+            }
+
+            std::optional<long long> queryValue(const char* sql)
+            {
+                sqlite3_stmt* stmt{};
+                if (sqlite3_prepare_v2(_db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+                    throw LmsException{ std::string{ "Cannot execute '" } + sql + "': " + sqlite3_errmsg(_db) };
+
+                std::optional<long long> value;
+                if (sqlite3_step(stmt) == SQLITE_ROW)
+                    value = sqlite3_column_int64(stmt, 0);
+                sqlite3_finalize(stmt);
+
+                return value;
+            }
+
+        private:
+            sqlite3* _db{};
+        };
+
+        std::string getBackupFileName(std::chrono::system_clock::time_point time)
+        {
+            const std::time_t t{ std::chrono::system_clock::to_time_t(time) };
+            std::tm tm{};
+            ::gmtime_r(&t, &tm);
+
+            std::ostringstream oss;
+            oss << backupFilePrefix << std::put_time(&tm, "%Y%m%d-%H%M%S") << backupFileExtension;
+            return oss.str();
+        }
+    }
+
+    BackupService::BackupService(Db& db, const Parameters& parameters)
+        : _db{ db }
+        , _parameters{ parameters }
+        , _thread{ [this] { threadLoop(); } }
+    {
+        if (_parameters.period.count() > 0)
+            LMS_LOG(DB, INFO) << "Database backups every " << _parameters.period.count() << " minutes in '" << _parameters.directory.string() << "'";
+    }
+
+    BackupService::~BackupService()
+    {
+        {
+            std::scoped_lock lock{ _mutex };
+            _stop = true;
+        }
+        _condVar.notify_all();
+        _thread.join();
+    }
+
+    void BackupService::requestBackup()
+    {
+        {
+            std::scoped_lock lock{ _mutex };
+            _backupRequested = true;
+        }
+        _condVar.notify_all();
+    }
+
+    BackupService::Status BackupService::getStatus() const
+    {
+        std::scoped_lock lock{ _mutex };
+        return _status;
+    }
+
+    void BackupService::threadLoop()
+    {
+        std::unique_lock lock{ _mutex };
+
+        auto nextBackupTime{ std::chrono::steady_clock::now() + _parameters.period };
+        while (true)
+        {
+            auto isWakeUpNeeded{ [this] { return _stop || _backupRequested; } };
+            if (_parameters.period.count() > 0)
+                _condVar.wait_until(lock, nextBackupTime, isWakeUpNeeded);
+            else
+                _condVar.wait(lock, isWakeUpNeeded);
+
+            if (_stop)
+                break;
+
+            _backupRequested = false;
+            lock.unlock();
+            runBackup();
+            lock.lock();
+
+            nextBackupTime = std::chrono::steady_clock::now() + _parameters.period;
+        }
+    }
+
+    void BackupService::runBackup()
+    {
+        const auto now{ std::chrono::system_clock::now() };
+        const std::filesystem::path destination{ _parameters.directory / getBackupFileName(now) };
+        // not a backup file until complete
+        const std::filesystem::path tmpDestination{ destination.string() + ".tmp" };
+
+        {
+            std::scoped_lock lock{ _mutex };
+            _status.inProgress = true;
+            _status.copiedPageCount = 0;
+            _status.totalPageCount = 0;
+        }
+
+        LMS_LOG(DB, INFO) << "Backing up database to '" << destination.string() << "'...";
+        const auto start{ std::chrono::steady_clock::now() };
+
+        std::string error;
+        try
+        {
+            std::filesystem::create_directories(_parameters.directory);
+            std::filesystem::remove(tmpDestination);
+
+            copyDatabase(tmpDestination);
+            std::filesystem::rename(tmpDestination, destination);
+
+            removeOldBackups();
+        }
+        catch (const std::exception& e)
+        {
+            error = e.what();
+            LMS_LOG(DB, ERROR) << "Database backup failed: " << error;
+
+            std::error_code ec;
+            std::filesystem::remove(tmpDestination, ec);
+        }
+
+        const auto duration{ std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start) };
+        if (error.empty())
+            LMS_LOG(DB, INFO) << "Database backup complete in " << duration.count() << " ms";
+
+        std::scoped_lock lock{ _mutex };
+        _status.inProgress = false;
+        _status.lastBackupTime = now;
+        _status.lastBackupDuration = duration;
+        _status.lastBackupPath = error.empty() ? destination : std::filesystem::path{};
+        _status.lastError = error;
+    }
+
+    void BackupService::copyDatabase(const std::filesystem::path& destination)
+    {
+        SqliteConnection source{ _db.getPath(), SQLITE_OPEN_READONLY };
+        sqlite3_busy_timeout(source.get(), 5000);
+        // the read transaction pins a snapshot: the writes made meanwhile do not make the backup restart
+        source.execute("BEGIN; SELECT COUNT(*) FROM sqlite_master");
+
+        SqliteConnection target{ destination, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE };
+
+        std::unique_ptr<sqlite3_backup, decltype(&sqlite3_backup_finish)> backup{ sqlite3_backup_init(target.get(), "main", source.get(), "main"), &sqlite3_backup_finish };
+        if (!backup)
+            throw LmsException{ std::string{ "Cannot start backup: " } + sqlite3_errmsg(target.get()) };
+
+        // throughput cap: each step is given a minimal duration
+        std::chrono::microseconds minStepDuration{};
+        if (_parameters.maxThroughput > 0)
+            minStepDuration = std::chrono::microseconds{ pagesPerStep * static_cast<std::size_t>(source.queryValue("PRAGMA page_size").value_or(4096)) * 1'000'000 / _parameters.maxThroughput };
+
+        while (true)
+        {
+            const auto stepStart{ std::chrono::steady_clock::now() };
+
+            const int res{ sqlite3_backup_step(backup.get(), pagesPerStep) };
+            if (res == SQLITE_DONE)
+                break;
+            if (res != SQLITE_OK && res != SQLITE_BUSY && res != SQLITE_LOCKED)
+                throw LmsException{ std::string{ "Backup step failed: " } + sqlite3_errstr(res) };
+
+            std::unique_lock lock{ _mutex };
+            _status.totalPageCount = static_cast<std::size_t>(sqlite3_backup_pagecount(backup.get()));
+            _status.copiedPageCount = _status.totalPageCount - static_cast<std::size_t>(sqlite3_backup_remaining(backup.get()));
+
+            if (_condVar.wait_until(lock, stepStart + minStepDuration, [this] { return _stop; }))
+                throw LmsException{ "Aborted" };
+        }
+
+        if (const int res{ sqlite3_backup_finish(backup.release()) }; res != SQLITE_OK)
+            throw LmsException{ std::string{ "Backup failed: " } + sqlite3_errstr(res) };
+    }
+
+    void BackupService::removeOldBackups()
+    {
+        const std::vector<std::filesystem::path> backups{ findBackups(_parameters.directory) };
+        if (_parameters.keepCount == 0 || backups.size() <= _parameters.keepCount)
+            return;
+
+        for (std::size_t i{}; i < backups.size() - _parameters.keepCount; ++i)
+        {
+            LMS_LOG(DB, INFO) << "Removing old database backup '" << backups[i].string() << "'";
+            std::filesystem::remove(backups[i]);
+        }
+    }
+
+    std::vector<std::filesystem::path> BackupService::findBackups(const std::filesystem::path& directory)
+    {
+        std::vector<std::filesystem::path> backups;
+
+        std::error_code ec;
+        for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator{ directory, ec })
+        {
+            const std::string fileName{ entry.path().filename().string() };
+            if (entry.is_regular_file() && fileName.rfind(backupFilePrefix, 0) == 0 && entry.path().extension() == backupFileExtension)
+                backups.push_back(entry.path());
+        }
+
+        // names are timestamps
+        std::sort(std::begin(backups), std::end(backups));
+        return backups;
+    }
+
+    void BackupService::restoreBackup(Session& session, const std::filesystem::path& backup)
+    {
+        // the other writers of this process must wait, the copy is made on its own connection
+        session.checkUniqueLocked();
+
+        SqliteConnection source{ backup, SQLITE_OPEN_READONLY };
+        const std::optional<long long> version{ source.queryValue("SELECT db_version FROM version_info") };
+        if (!version || static_cast<Version>(*version) != LMS_DATABASE_VERSION)
+            throw LmsException{ "Backup '" + backup.string() + "' has database version " + (version ? std::to_string(*version) : "?") + ", expected " + std::to_string(LMS_DATABASE_VERSION) };
+
+        SqliteConnection target{ session.getDb().getPath(), SQLITE_OPEN_READWRITE };
+        sqlite3_busy_timeout(target.get(), 10000);
+
+        std::unique_ptr<sqlite3_backup, decltype(&sqlite3_backup_finish)> copy{ sqlite3_backup_init(target.get(), "main", source.get(), "main"), &sqlite3_backup_finish };
+        if (!copy)
+            throw LmsException{ std::string{ "Cannot start restore: " } + sqlite3_errmsg(target.get()) };
+
+        // all pages in one step: a single write transaction
+        if (const int res{ sqlite3_backup_step(copy.get(), -1) }; res != SQLITE_DONE)
+            throw LmsException{ std::string{ "Restore failed: " } + sqlite3_errstr(res) };
+
+        if (const int res{ sqlite3_backup_finish(copy.release()) }; res != SQLITE_OK)
+            throw LmsException{ std::string{ "Restore failed: " } + sqlite3_errstr(res) };
+    }
+}
@@ -70,6 +70,18 @@ namespace Database
 
             return createQuery<ResultType>(session, itemToSelect, params);
         }
+
+        constexpr std::size_t idListBatchSize{ 10'000 };
+
+        // whereClause restricts the updated clusters, empty to update them all
+        void updateClusterCounts(Session& session, const std::string& whereClause)
+        {
+            session.getDboSession().execute(
+                "UPDATE cluster SET"
+                " track_count = (SELECT COUNT(t_c.track_id) FROM track_cluster t_c WHERE t_c.cluster_id = cluster.id),"
+                " release_count = (SELECT COUNT(DISTINCT t.release_id) FROM track t INNER JOIN track_cluster t_c ON t_c.track_id = t.id WHERE t_c.cluster_id = cluster.id)"
+                + whereClause);
+        }
     }
 
     Cluster::Cluster(ObjectPtr<ClusterType> type, std::string_view name)
@@ -114,6 +126,19 @@ namespace Database
         return Utils::execQuery<ClusterId>(query, range);
     }
 
+    void Cluster::remove(Session& session, const std::vector<ClusterId>& clusterIds)
+    {
+        session.checkUniqueLocked();
+
+        if (clusterIds.empty())
+            return;
+
+        auto call{ session.getDboSession().execute("DELETE FROM cluster WHERE id IN (" + Utils::makePlaceholders(clusterIds.size()) + ")") };
+        for (const ClusterId clusterId : clusterIds)
+            call.bind(clusterId);
+        call.run();
+    }
+
     Cluster::pointer Cluster::find(Session& session, ClusterId id)
     {
         session.checkSharedLocked();
@@ -137,6 +162,22 @@ namespace Database
             .where("t_c.cluster_id = ?").bind(id).resultValue();
     }
 
+    void Cluster::updateCounts(Session& session)
+    {
+        session.checkUniqueLocked();
+        updateClusterCounts(session, "");
+    }
+
+    void Cluster::updateCounts(Session& session, const std::vector<ClusterId>& clusterIds)
+    {
+        session.checkUniqueLocked();
+
+        Utils::visitIdListBatches(clusterIds, idListBatchSize, [&](const std::string& idList)
+            {
+                updateClusterCounts(session, " WHERE cluster.id IN (" + idList + ")");
+            });
+    }
+
     void Cluster::addTrack(ObjectPtr<Track> track)
     {
         _tracks.insert(getDboPtr(track));
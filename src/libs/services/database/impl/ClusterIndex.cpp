@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "services/database/ClusterIndex.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <tuple>
+
+#include "services/database/ReleaseId.hpp"
+#include "services/database/Session.hpp"
+#include "services/database/TrackId.hpp"
+#include "utils/Logger.hpp"
+#include "IdTypeTraits.hpp"
+
+namespace Database
+{
+    namespace
+    {
+        bool fitsInBitmap(IdType id)
+        {
+            return id.getValue() > 0 && id.getValue() <= std::numeric_limits<RoaringBitmap::value_type>::max();
+        }
+    }
+
+    std::shared_ptr<const ClusterIndex> ClusterIndex::build(Session& session)
+    {
+        session.checkSharedLocked();
+
+        auto index{ std::make_shared<ClusterIndex>() };
+
+        {
+            using ResultType = std::tuple<ClusterId, TrackId>;
+            auto query{ session.getDboSession().query<ResultType>("SELECT cluster_id, track_id FROM track_cluster").orderBy("cluster_id, track_id") };
+
+            ClusterId currentClusterId;
+            RoaringBitmap* currentTracks{};
+            for (const auto& [clusterId, trackId] : query.resultList())
+            {
+                if (!fitsInBitmap(trackId))
+                {
+                    LMS_LOG(DB, WARNING) << "Cannot index track id " << trackId.getValue() << ", cluster index disabled";
+                    return nullptr;
+                }
+
+                if (!currentTracks || clusterId != currentClusterId)
+                {
+                    currentClusterId = clusterId;
+                    currentTracks = &index->_tracksByCluster[clusterId];
+                }
+                currentTracks->add(static_cast<RoaringBitmap::value_type>(trackId.getValue()));
+            }
+        }
+
+        {
+            using ResultType = std::tuple<TrackId, ReleaseId>;
+            auto query{ session.getDboSession().query<ResultType>("SELECT id, release_id FROM track").where("release_id IS NOT NULL") };
+
+            for (const auto& [trackId, releaseId] : query.resultList())
+            {
+                if (!fitsInBitmap(trackId) || !fitsInBitmap(releaseId))
+                {
+                    LMS_LOG(DB, WARNING) << "Cannot index track id " << trackId.getValue() << ", cluster index disabled";
+                    return nullptr;
+                }
+
+                const std::size_t trackIndex{ static_cast<std::size_t>(trackId.getValue()) };
+                if (trackIndex >= index->_releaseByTrack.size())
+                    index->_releaseByTrack.resize(trackIndex + 1);
+                index->_releaseByTrack[trackIndex] = static_cast<std::uint32_t>(releaseId.getValue());
+            }
+        }
+
+        LMS_LOG(DB, DEBUG) << "Built cluster index: " << index->getClusterCount() << " clusters, " << index->getMemoryUsage() / 1024 << " KiB";
+
+        return index;
+    }
+
+    RoaringBitmap ClusterIndex::getTracks(const std::vector<ClusterId>& clusters) const
+    {
+        std::vector<const RoaringBitmap*> bitmaps;
+        for (const ClusterId clusterId : clusters)
+        {
+            auto it{ _tracksByCluster.find(clusterId) };
+            if (it == std::cend(_tracksByCluster))
+                return {};
+
+            bitmaps.push_back(&it->second);
+        }
+
+        if (bitmaps.empty())
+            return {};
+
+        // smallest first, to keep the intermediate results small
+        std::sort(std::begin(bitmaps), std::end(bitmaps), [](const RoaringBitmap* a, const RoaringBitmap* b) { return a->size() < b->size(); });
+
+        RoaringBitmap res{ *bitmaps.front() };
+        for (auto it{ std::next(std::cbegin(bitmaps)) }; it != std::cend(bitmaps) && !res.empty(); ++it)
+            res = RoaringBitmap::intersect(res, **it);
+
+        return res;
+    }
+
+    RoaringBitmap ClusterIndex::getReleases(const std::vector<ClusterId>& clusters) const
+    {
+        std::vector<RoaringBitmap::value_type> releaseIds;
+        getTracks(clusters).visit([&](RoaringBitmap::value_type trackId)
+            {
+                if (trackId < _releaseByTrack.size() && _releaseByTrack[trackId] != 0)
+                    releaseIds.push_back(_releaseByTrack[trackId]);
+            });
+
+        std::sort(std::begin(releaseIds), std::end(releaseIds));
+        releaseIds.erase(std::unique(std::begin(releaseIds), std::end(releaseIds)), std::end(releaseIds));
+
+        RoaringBitmap res;
+        for (const RoaringBitmap::value_type releaseId : releaseIds)
+            res.add(releaseId);
+
+        return res;
+    }
+
+    std::size_t ClusterIndex::getMemoryUsage() const
+    {
+        std::size_t res{ sizeof(*this) + _releaseByTrack.capacity() * sizeof(std::uint32_t) };
+        for (const auto& [clusterId, tracks] : _tracksByCluster)
+            res += sizeof(clusterId) + tracks.getMemoryUsage();
+
+        return res;
+    }
+} // namespace Database
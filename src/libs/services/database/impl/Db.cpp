@@ -19,12 +19,18 @@
 
 #include "services/database/Db.hpp"
 
+#include <cstdint>
+#include <string>
+
 #include <Wt/Dbo/FixedSqlConnectionPool.h>
+#include <Wt/Dbo/SqlStatement.h>
 #include <Wt/Dbo/backend/Sqlite3.h>
 
 #include "services/database/Session.hpp"
 #include "services/database/User.hpp"
 #include "utils/Logger.hpp"
+#include "utils/Metrics.hpp"
+#include "utils/Service.hpp"
 
 namespace Database
 {
@@ -33,9 +39,10 @@ namespace Database
         class Connection : public Wt::Dbo::backend::Sqlite3
         {
         public:
-            Connection(const std::filesystem::path& dbPath)
+            Connection(const std::filesystem::path& dbPath, std::size_t mmapSize)
                 : Wt::Dbo::backend::Sqlite3{ dbPath.string() }
                 , _dbPath{ dbPath }
+                , _mmapSize{ mmapSize }
             {
                 prepare();
             }
@@ -43,10 +50,33 @@ namespace Database
             Connection(const Connection& other)
                 : Wt::Dbo::backend::Sqlite3{ other }
                 , _dbPath{ other._dbPath }
+                , _mmapSize{ other._mmapSize }
             {
                 prepare();
             }
 
+            // Statements are cached by SQL text for the connection lifetime: queries built using a variable number of
+            // parameters would make the cache grow forever. Must be called while the connection is not in use
+            bool trimStatementCache(std::size_t maxStatementCount)
+            {
+                if (maxStatementCount == 0 || _preparedStatementCount <= maxStatementCount)
+                    return false;
+
+                clearStatementCache();
+                _preparedStatementCount = 0;
+                return true;
+            }
+
+            std::size_t getPreparedStatementCount() const { return _preparedStatementCount; }
+
+            // change of the prepared statement count since the last call
+            std::int64_t takePreparedStatementCountDelta()
+            {
+                const std::int64_t delta{ static_cast<std::int64_t>(_preparedStatementCount) - static_cast<std::int64_t>(_reportedStatementCount) };
+                _reportedStatementCount = _preparedStatementCount;
+                return delta;
+            }
+
             ~Connection()
             {
                 // make use of per-connection usage stats to optimize
@@ -61,12 +91,39 @@ namespace Database
                 return std::make_unique<Connection>(*this);
             }
 
+            // one shot statements (pragmas, transaction control) are not cached
+            void executeSql(const std::string& sql) override
+            {
+                _executingSql = true;
+                try
+                {
+                    Wt::Dbo::backend::Sqlite3::executeSql(sql);
+                }
+                catch (...)
+                {
+                    _executingSql = false;
+                    throw;
+                }
+                _executingSql = false;
+            }
+
+            std::unique_ptr<Wt::Dbo::SqlStatement> prepareStatement(const std::string& sql) override
+            {
+                if (!_executingSql)
+                    _preparedStatementCount++;
+
+                return Wt::Dbo::backend::Sqlite3::prepareStatement(sql);
+            }
+
             void prepare()
             {
                 LMS_LOG(DB, DEBUG) << "Setting per-connection settings...";
+                executeSql("pragma auto_vacuum=INCREMENTAL"); // only effective on database creation
                 executeSql("pragma journal_mode=WAL");
                 executeSql("pragma synchronous=normal");
                 executeSql("pragma analysis_limit=2000"); // to help make analyze command faster, 1000 does not seem to be enough to speed up all queries
+                if (_mmapSize > 0)
+                    executeSql("pragma mmap_size=" + std::to_string(_mmapSize)); // pages are read straight from the OS page cache
                 LMS_LOG(DB, DEBUG) << "Setting per-connection settings done!";
             }
 
@@ -78,21 +135,94 @@ namespace Database
             }
 
             std::filesystem::path _dbPath;
+            std::size_t _mmapSize{};
+            bool _executingSql{};
+            std::size_t _preparedStatementCount{}; // upper bound of the cached statement count
+            std::size_t _reportedStatementCount{};
         };
+
+        // Fixed size pool, exporting the time spent to get a connection
+        class ConnectionPool : public Wt::Dbo::SqlConnectionPool
+        {
+        public:
+            ConnectionPool(std::unique_ptr<Wt::Dbo::SqlConnection> connection, std::size_t connectionCount, std::string_view name, const std::atomic<std::size_t>& maxCachedStatementCount)
+                : _pool{ std::move(connection), static_cast<int>(connectionCount) }
+                , _maxCachedStatementCount{ maxCachedStatementCount }
+            {
+                _pool.setTimeout(std::chrono::seconds{ 10 });
+
+                if (Metrics::Registry* registry{ Service<Metrics::Registry>::get() })
+                {
+                    _waitDurations = &registry->getHistogram("lms_db_connection_wait_seconds", "Time spent waiting for a database connection", { 0.0001, 0.001, 0.01, 0.1, 1, 10 }, { {"pool", std::string{ name }} });
+                    _cachedStatements = &registry->getGauge("lms_db_cached_statements", "Prepared statements cached by the connections (upper bound)", { {"pool", std::string{ name }} });
+                    _statementCacheClears = &registry->getCounter("lms_db_statement_cache_clears_total", "Statement caches cleared because they exceeded db-max-cached-statements", { {"pool", std::string{ name }} });
+                }
+            }
+
+        private:
+            std::unique_ptr<Wt::Dbo::SqlConnection> getConnection() override
+            {
+                const auto start{ std::chrono::steady_clock::now() };
+                std::unique_ptr<Wt::Dbo::SqlConnection> connection{ _pool.getConnection() };
+                if (_waitDurations)
+                    _waitDurations->observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+                return connection;
+            }
+
+            void returnConnection(std::unique_ptr<Wt::Dbo::SqlConnection> connection) override
+            {
+                if (Connection* lmsConnection{ dynamic_cast<Connection*>(connection.get()) })
+                {
+                    const std::size_t statementCountBefore{ lmsConnection->getPreparedStatementCount() };
+                    const bool cleared{ lmsConnection->trimStatementCache(_maxCachedStatementCount.load(std::memory_order_relaxed)) };
+
+                    const std::int64_t statementCountDelta{ lmsConnection->takePreparedStatementCountDelta() };
+                    if (_cachedStatements)
+                        _cachedStatements->increment(statementCountDelta);
+
+                    if (cleared)
+                    {
+                        LMS_LOG(DB, DEBUG) << "Cleared statement cache of connection (" << statementCountBefore << " statements)";
+                        if (_statementCacheClears)
+                            _statementCacheClears->increment();
+                    }
+                }
+
+                _pool.returnConnection(std::move(connection));
+            }
+
+            void prepareForDropTables() const override
+            {
+                _pool.prepareForDropTables();
+            }
+
+            Wt::Dbo::FixedSqlConnectionPool _pool;
+            const std::atomic<std::size_t>& _maxCachedStatementCount;
+            Metrics::Histogram* _waitDurations{};
+            Metrics::Gauge* _cachedStatements{};
+            Metrics::Counter* _statementCacheClears{};
+        };
+
+        thread_local ConnectionPriority threadPriority{ ConnectionPriority::Interactive };
     }
 
     // Session living class handling the database and the login
-    Db::Db(const std::filesystem::path& dbPath, std::size_t connectionCount)
+    Db::Db(const std::filesystem::path& dbPath, std::size_t connectionCount, std::size_t backgroundConnectionCount, std::size_t mmapSize)
+        : _dbPath{ dbPath }
     {
-        LMS_LOG(DB, INFO) << "Creating connection pool on file " << dbPath.string();
+        LMS_LOG(DB, INFO) << "Creating connection pools on file " << dbPath.string() << " (" << connectionCount << " interactive, " << backgroundConnectionCount << " background connections, mmap size = " << mmapSize << ")";
 
-        auto connection{ std::make_unique<Connection>(dbPath.string()) };
+        auto connection{ std::make_unique<Connection>(dbPath.string(), mmapSize) };
         // connection->setProperty("show-queries", "true");
 
-        auto connectionPool{ std::make_unique<Wt::Dbo::FixedSqlConnectionPool>(std::move(connection), connectionCount) };
-        connectionPool->setTimeout(std::chrono::seconds{ 10 });
+        _backgroundConnectionPool = std::make_unique<ConnectionPool>(std::make_unique<Connection>(*connection), backgroundConnectionCount, "background", _maxCachedStatementCount);
+        _connectionPool = std::make_unique<ConnectionPool>(std::move(connection), connectionCount, "interactive", _maxCachedStatementCount);
+    }
 
-        _connectionPool = std::move(connectionPool);
+    void Db::setThreadPriority(ConnectionPriority priority)
+    {
+        threadPriority = priority;
     }
 
     void Db::executeSql(const std::string& sql)
@@ -107,7 +237,7 @@ namespace Database
 
         if (!tlsSession)
         {
-            auto newSession{ std::make_unique<Session>(*this) };
+            auto newSession{ std::make_unique<Session>(*this, threadPriority) };
             tlsSession = newSession.get();
 
             {
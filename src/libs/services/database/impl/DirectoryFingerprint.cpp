@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "services/database/DirectoryFingerprint.hpp"
+
+#include "services/database/Session.hpp"
+#include "IdTypeTraits.hpp"
+#include "Utils.hpp"
+
+namespace Database
+{
+    DirectoryFingerprint::DirectoryFingerprint(const std::filesystem::path& directory)
+        : _directory{ directory.string() }
+    {
+    }
+
+    DirectoryFingerprint::pointer DirectoryFingerprint::create(Session& session, const std::filesystem::path& directory)
+    {
+        return session.getDboSession().add(std::unique_ptr<DirectoryFingerprint> {new DirectoryFingerprint{ directory }});
+    }
+
+    std::size_t DirectoryFingerprint::getCount(Session& session)
+    {
+        session.checkSharedLocked();
+
+        return session.getDboSession().query<int>("SELECT COUNT(*) FROM directory_fingerprint");
+    }
+
+    DirectoryFingerprint::pointer DirectoryFingerprint::find(Session& session, DirectoryFingerprintId id)
+    {
+        session.checkSharedLocked();
+
+        return session.getDboSession().find<DirectoryFingerprint>().where("id = ?").bind(id).resultValue();
+    }
+
+    DirectoryFingerprint::pointer DirectoryFingerprint::find(Session& session, const std::filesystem::path& directory)
+    {
+        session.checkSharedLocked();
+
+        return session.getDboSession().find<DirectoryFingerprint>().where("directory = ?").bind(directory.string()).resultValue();
+    }
+
+    void DirectoryFingerprint::find(Session& session, std::function<void(const FindResult&)> func)
+    {
+        using QueryResultType = std::tuple<std::string, Wt::WDateTime, int, int>;
+        session.checkSharedLocked();
+
+        auto query{ session.getDboSession().query<QueryResultType>("SELECT directory, last_write, entry_count, scan_version FROM directory_fingerprint") };
+
+        Utils::execQuery<QueryResultType>(query, std::nullopt, [&](const QueryResultType& queryResult)
+            {
+                func(FindResult{ std::get<0>(queryResult), std::get<1>(queryResult), static_cast<std::size_t>(std::get<2>(queryResult)), static_cast<std::size_t>(std::get<3>(queryResult)) });
+            });
+    }
+} // namespace Database
@@ -0,0 +1,448 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "services/database/IndexAdvisor.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <optional>
+#include <regex>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <Wt/Dbo/Exception.h>
+
+#include "services/database/Db.hpp"
+#include "services/database/QueryProfiler.hpp"
+#include "services/database/Session.hpp"
+#include "utils/Exception.hpp"
+#include "utils/Logger.hpp"
+#include "SqliteStatement.hpp"
+
+namespace Database::IndexAdvisor
+{
+    namespace
+    {
+        constexpr std::string_view advisedIndexPrefix{ "advised_" };
+        constexpr std::size_t maxIndexColumnCount{ 6 }; // otherwise the selected columns are not added to make the index covering
+
+        std::string toLower(std::string_view str)
+        {
+            std::string res{ str };
+            std::transform(std::begin(res), std::end(res), std::begin(res), [](unsigned char c) { return std::tolower(c); });
+            return res;
+        }
+
+        void addUnique(std::vector<std::string>& values, const std::string& value)
+        {
+            if (std::find(std::cbegin(values), std::cend(values), value) == std::cend(values))
+                values.push_back(value);
+        }
+
+        std::string join(const std::vector<std::string>& values, std::string_view separator)
+        {
+            std::string res;
+            for (const std::string& value : values)
+            {
+                if (!res.empty())
+                    res += separator;
+                res += value;
+            }
+            return res;
+        }
+
+        struct TableInfo
+        {
+            std::unordered_set<std::string> columns;
+            std::vector<std::vector<std::string>> indexes; // indexed columns, in index order
+        };
+
+        class Schema
+        {
+        public:
+            Schema(sqlite3* db)
+                : _db{ db }
+            {
+                SqliteStatement statement{ _db, "SELECT name FROM sqlite_master WHERE type = 'table' AND name NOT LIKE 'sqlite_%'" };
+                while (statement.step())
+                    _tables.emplace(toLower(statement.getText(0)), std::nullopt);
+            }
+
+            bool hasTable(const std::string& table) const { return _tables.find(table) != std::cend(_tables); }
+
+            const TableInfo& getTableInfo(const std::string& table)
+            {
+                std::optional<TableInfo>& tableInfo{ _tables[table] };
+                if (tableInfo)
+                    return *tableInfo;
+
+                tableInfo.emplace();
+
+                SqliteStatement columns{ _db, "PRAGMA table_info(\"" + table + "\")" };
+                while (columns.step())
+                    tableInfo->columns.insert(toLower(columns.getText(1)));
+
+                std::vector<std::string> indexNames;
+                {
+                    SqliteStatement indexes{ _db, "PRAGMA index_list(\"" + table + "\")" };
+                    while (indexes.step())
+                        indexNames.push_back(indexes.getText(1));
+                }
+                for (const std::string& indexName : indexNames)
+                {
+                    std::vector<std::string>& indexColumns{ tableInfo->indexes.emplace_back() };
+
+                    SqliteStatement indexInfo{ _db, "PRAGMA index_info(\"" + indexName + "\")" };
+                    while (indexInfo.step())
+                        indexColumns.push_back(toLower(indexInfo.getText(2)));
+                }
+
+                return *tableInfo;
+            }
+
+        private:
+            sqlite3* _db;
+            std::unordered_map<std::string, std::optional<TableInfo>> _tables;
+        };
+
+        // column references of a table alias in the query
+        struct ColumnRefs
+        {
+            std::vector<std::string> equalities; // compared to parameters or constants
+            std::vector<std::string> joins; // compared to columns of other tables
+            std::vector<std::string> ranges;
+            std::vector<std::string> orderBy;
+            std::vector<std::string> selected;
+        };
+
+        // lower case query, as built in the Find functions: "alias.column" references
+        class QueryShape
+        {
+        public:
+            QueryShape(const std::string& query, const Schema& schema)
+                : _query{ toLower(query) }
+            {
+                static const std::unordered_set<std::string_view> keywords{ "on", "where", "inner", "left", "cross", "natural", "outer", "join", "group", "order", "limit", "using", "union", "indexed", "not" };
+
+                static const std::regex tableRegex{ R"re(\b(?:from|join)\s+"?(\w+)"?(?:\s+(?:as\s+)?(\w+))?)re" };
+                for (auto it{ std::sregex_iterator{ std::cbegin(_query), std::cend(_query), tableRegex } }; it != std::sregex_iterator{}; ++it)
+                {
+                    const std::string table{ (*it)[1] };
+                    if (!schema.hasTable(table))
+                        continue;
+
+                    const std::string alias{ (*it)[2].matched && keywords.find((*it)[2].str()) == std::cend(keywords) ? (*it)[2].str() : table };
+                    _aliases.emplace(alias, table);
+                }
+
+                static const std::regex conditionRegex{ R"re((\w+)\.(\w+)\s*(>=|<=|>|<|=|\bin\b|\bis\b|\bbetween\b)\s*(\w+\.\w+)?)re" };
+                for (auto it{ std::sregex_iterator{ std::cbegin(_query), std::cend(_query), conditionRegex } }; it != std::sregex_iterator{}; ++it)
+                {
+                    ColumnRefs& refs{ _refs[(*it)[1]] };
+                    const std::string op{ (*it)[3] };
+                    if (op != "=" && op != "in" && op != "is")
+                        addUnique(refs.ranges, (*it)[2]);
+                    else if ((*it)[4].matched)
+                        addUnique(refs.joins, (*it)[2]);
+                    else
+                        addUnique(refs.equalities, (*it)[2]);
+                }
+
+                static const std::regex columnRegex{ R"re(^\s*(\w+)\.(\w+))re" };
+                if (const std::size_t orderByPos{ _query.rfind(" order by ") }; orderByPos != std::string::npos)
+                {
+                    std::string orderBy{ _query.substr(orderByPos + std::string_view{ " order by " }.size()) };
+                    orderBy = orderBy.substr(0, orderBy.find(" limit "));
+
+                    std::size_t begin{};
+                    while (begin <= orderBy.size())
+                    {
+                        std::size_t end{ orderBy.find(',', begin) };
+                        if (end == std::string::npos)
+                            end = orderBy.size();
+
+                        std::smatch match;
+                        const std::string item{ orderBy.substr(begin, end - begin) };
+                        if (std::regex_search(item, match, columnRegex))
+                        {
+                            _orderByAliases.insert(match[1]);
+                            addUnique(_refs[match[1]].orderBy, match[2]);
+                        }
+                        else
+                            _orderByAliases.insert(""); // expression or column of the result: cannot be indexed
+
+                        begin = end + 1;
+                    }
+                }
+
+                static const std::regex refRegex{ R"re((\w+)\.(\w+))re" };
+                const std::string selected{ _query.substr(0, _query.find(" from ")) };
+                for (auto it{ std::sregex_iterator{ std::cbegin(selected), std::cend(selected), refRegex } }; it != std::sregex_iterator{}; ++it)
+                    addUnique(_refs[(*it)[1]].selected, (*it)[2]);
+            }
+
+            std::optional<std::string> getTable(const std::string& alias) const
+            {
+                const auto it{ _aliases.find(alias) };
+                if (it == std::cend(_aliases))
+                    return std::nullopt;
+                return it->second;
+            }
+
+            // the alias of the ORDER BY columns, if they all belong to the same table
+            std::optional<std::string> getOrderByAlias() const
+            {
+                if (_orderByAliases.size() != 1 || _orderByAliases.begin()->empty())
+                    return std::nullopt;
+                return *_orderByAliases.begin();
+            }
+
+            ColumnRefs getRefs(const std::string& alias) const
+            {
+                const auto it{ _refs.find(alias) };
+                return it != std::cend(_refs) ? it->second : ColumnRefs{};
+            }
+
+        private:
+            const std::string _query;
+            std::unordered_map<std::string, std::string> _aliases; // alias => table
+            std::unordered_map<std::string, ColumnRefs> _refs; // by alias
+            std::unordered_set<std::string> _orderByAliases;
+        };
+
+        // "SCAN t", or "SCAN TABLE track AS t" using older versions
+        // Index scans ("SCAN t USING COVERING INDEX ...") are not full scans
+        std::optional<std::string> getFullScanAlias(const std::string& detail)
+        {
+            std::string_view str{ detail };
+            if (str.rfind("scan ", 0) != 0 || str.find(" using ") != std::string_view::npos || str.find("virtual table") != std::string_view::npos)
+                return std::nullopt;
+
+            str.remove_prefix(std::string_view{ "scan " }.size());
+            if (str.rfind("table ", 0) == 0)
+                str.remove_prefix(std::string_view{ "table " }.size());
+            if (str.empty() || str.front() == '(' || str.rfind("subquery", 0) == 0 || str.rfind("constant", 0) == 0)
+                return std::nullopt;
+
+            const std::size_t nameEnd{ std::min(str.find(' '), str.size()) };
+            std::string alias{ str.substr(0, nameEnd) };
+
+            str.remove_prefix(nameEnd);
+            if (str.rfind(" as ", 0) == 0)
+            {
+                str.remove_prefix(std::string_view{ " as " }.size());
+                alias = str.substr(0, std::min(str.find(' '), str.size()));
+            }
+
+            return alias;
+        }
+
+        std::optional<std::string> proposeIndex(Schema& schema, const QueryShape& shape, const std::string& alias, bool forOrderBy)
+        {
+            const std::optional<std::string> table{ shape.getTable(alias) };
+            if (!table)
+                return std::nullopt;
+
+            const TableInfo& tableInfo{ schema.getTableInfo(*table) };
+            const ColumnRefs refs{ shape.getRefs(alias) };
+
+            // the id is the rowid: already part of all the indexes
+            auto isIndexable{ [&](const std::string& column) { return column != "id" && tableInfo.columns.find(column) != std::cend(tableInfo.columns); } };
+
+            // equalities first, then the sort order (or the range) can be read from the index
+            // join columns are only used for the tables that are not filtered: they are then likely looked up from the other tables
+            std::vector<std::string> columns;
+            for (const std::string& column : refs.equalities)
+            {
+                if (isIndexable(column))
+                    addUnique(columns, column);
+            }
+            if (columns.empty())
+            {
+                for (const std::string& column : refs.joins)
+                {
+                    if (isIndexable(column))
+                        addUnique(columns, column);
+                }
+            }
+
+            const bool canUseOrderBy{ shape.getOrderByAlias() == alias && std::all_of(std::cbegin(refs.orderBy), std::cend(refs.orderBy), isIndexable) };
+            if (canUseOrderBy && !refs.orderBy.empty())
+            {
+                for (const std::string& column : refs.orderBy)
+                    addUnique(columns, column);
+            }
+            else if (forOrderBy)
+            {
+                return std::nullopt;
+            }
+            else
+            {
+                const auto itRange{ std::find_if(std::cbegin(refs.ranges), std::cend(refs.ranges), isIndexable) };
+                if (itRange != std::cend(refs.ranges))
+                    addUnique(columns, *itRange);
+            }
+
+            if (columns.empty())
+                return std::nullopt;
+
+            // the planner did not use it: an index already starting with these columns would not help
+            for (const std::vector<std::string>& indexColumns : tableInfo.indexes)
+            {
+                if (indexColumns.size() >= columns.size() && std::equal(std::cbegin(columns), std::cend(columns), std::cbegin(indexColumns)))
+                    return std::nullopt;
+            }
+
+            // covering: the table itself does not have to be read at all
+            std::vector<std::string> coveringColumns{ columns };
+            for (const std::string& column : refs.selected)
+            {
+                if (isIndexable(column))
+                    addUnique(coveringColumns, column);
+            }
+            if (coveringColumns.size() <= maxIndexColumnCount)
+                columns = std::move(coveringColumns);
+
+            return "CREATE INDEX IF NOT EXISTS " + std::string{ advisedIndexPrefix } + *table + "_" + join(columns, "_") + "_idx ON " + *table + "(" + join(columns, ",") + ")";
+        }
+    }
+
+    Report analyze(const Db& db)
+    {
+        Report report;
+
+        SqliteConnection connection{ db.getPath() };
+        Schema schema{ connection.get() };
+
+        std::unordered_set<std::string> proposedIndexes;
+        for (const QueryProfiler::QueryStats& stats : QueryProfiler::getStats())
+        {
+            QueryReport queryReport{ stats.query, stats.callCount, stats.totalDuration };
+
+            try
+            {
+                // parameters are not bound: plans do not depend on their values
+                SqliteStatement statement{ connection.get(), "EXPLAIN QUERY PLAN " + stats.query };
+                while (statement.step())
+                    queryReport.plan.push_back(statement.getText(3));
+            }
+            catch (const LmsException& e)
+            {
+                LMS_LOG(DB, DEBUG) << "Cannot explain query: " << e.what();
+                continue;
+            }
+            report.analyzedQueryCount++;
+
+            const QueryShape shape{ stats.query, schema };
+            for (const std::string& detail : queryReport.plan)
+            {
+                const std::string lowerDetail{ toLower(detail) };
+                if (const std::optional<std::string> alias{ getFullScanAlias(lowerDetail) })
+                {
+                    addUnique(queryReport.fullScans, *alias);
+                    if (const std::optional<std::string> index{ proposeIndex(schema, shape, *alias, false) })
+                        addUnique(queryReport.proposedIndexes, *index);
+                }
+                else if (lowerDetail.find("use temp b-tree") != std::string::npos)
+                {
+                    queryReport.usesTempBTree = true;
+                    if (const std::optional<std::string> alias{ shape.getOrderByAlias() })
+                    {
+                        if (const std::optional<std::string> index{ proposeIndex(schema, shape, *alias, true) })
+                            addUnique(queryReport.proposedIndexes, *index);
+                    }
+                }
+            }
+
+            if (queryReport.fullScans.empty() && !queryReport.usesTempBTree)
+                continue;
+
+            for (const std::string& index : queryReport.proposedIndexes)
+            {
+                if (proposedIndexes.insert(index).second)
+                    report.proposedIndexes.push_back(index);
+            }
+            report.queries.push_back(std::move(queryReport));
+        }
+
+        LMS_LOG(DB, INFO) << "Index advisor: analyzed " << report.analyzedQueryCount << " query shapes, " << report.queries.size() << " with issues, " << report.proposedIndexes.size() << " proposed indexes";
+
+        return report;
+    }
+
+    void dump(const Report& report, std::ostream& os)
+    {
+        os << "Analyzed query shapes: " << report.analyzedQueryCount << ", with full scans or temp B-trees: " << report.queries.size() << "\n";
+
+        for (const QueryReport& query : report.queries)
+        {
+            os << "\n" << query.callCount << " calls, total " << std::chrono::duration_cast<std::chrono::milliseconds>(query.totalDuration).count() << "ms: " << query.query << "\n";
+            for (const std::string& detail : query.plan)
+                os << "\tplan: " << detail << "\n";
+            if (!query.fullScans.empty())
+                os << "\tfull scans: " << join(query.fullScans, ", ") << "\n";
+            if (query.usesTempBTree)
+                os << "\tuses a temp B-tree\n";
+            for (const std::string& index : query.proposedIndexes)
+                os << "\tproposed: " << index << "\n";
+        }
+
+        if (!report.proposedIndexes.empty())
+        {
+            os << "\nProposed indexes:\n";
+            for (const std::string& index : report.proposedIndexes)
+                os << index << ";\n";
+        }
+    }
+
+    std::size_t createIndexes(Session& session, const std::vector<std::string>& createIndexStatements)
+    {
+        std::size_t createdCount{};
+
+        for (const std::string& statement : createIndexStatements)
+        {
+            // only the statements built by analyze
+            if (statement.rfind("CREATE INDEX IF NOT EXISTS " + std::string{ advisedIndexPrefix }, 0) != 0)
+            {
+                LMS_LOG(DB, ERROR) << "Skipping unexpected index statement '" << statement << "'";
+                continue;
+            }
+
+            try
+            {
+                auto transaction{ session.createUniqueTransaction() };
+                session.getDboSession().execute(statement);
+                createdCount++;
+
+                LMS_LOG(DB, INFO) << "Created index: " << statement;
+            }
+            catch (const Wt::Dbo::Exception& e)
+            {
+                LMS_LOG(DB, ERROR) << "Cannot create index '" << statement << "': " << e.what();
+            }
+        }
+
+        // let the planner know about the new indexes
+        if (createdCount > 0)
+            session.analyze();
+
+        return createdCount;
+    }
+} // namespace Database::IndexAdvisor
@@ -0,0 +1,567 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "services/database/LibraryCatalog.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <random>
+#include <string>
+#include <tuple>
+
+#include <Wt/Dbo/WtSqlTraits.h>
+
+#include "services/database/ClusterIndex.hpp"
+#include "services/database/Session.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Random.hpp"
+#include "EnumSetTraits.hpp"
+#include "IdTypeTraits.hpp"
+
+namespace Database
+{
+    namespace
+    {
+        enum class RowOrder
+        {
+            Id, // or the candidate rows order, if any
+            Rank,
+            Random,
+        };
+
+        template <typename IdType>
+        std::optional<std::size_t> findRow(const std::vector<IdType>& rowIds, IdType id)
+        {
+            const auto it{ std::lower_bound(std::cbegin(rowIds), std::cend(rowIds), id) };
+            if (it == std::cend(rowIds) || *it != id)
+                return std::nullopt;
+
+            return std::distance(std::cbegin(rowIds), it);
+        }
+
+        template <typename IdType>
+        std::vector<IdType> readIds(Session& session, std::string_view table)
+        {
+            auto query{ session.getDboSession().query<IdType>("SELECT id FROM " + std::string{ table }).orderBy("id") };
+            auto results{ query.resultList() };
+            return std::vector<IdType>(std::cbegin(results), std::cend(results));
+        }
+
+        // Position of each row when the table is sorted by orderBy
+        template <typename IdType>
+        std::vector<std::uint32_t> readRanks(Session& session, std::string_view table, std::string_view orderBy, const std::vector<IdType>& rowIds)
+        {
+            std::vector<std::uint32_t> ranks(rowIds.size());
+
+            auto query{ session.getDboSession().query<IdType>("SELECT id FROM " + std::string{ table }).orderBy(std::string{ orderBy }) };
+
+            std::uint32_t rank{};
+            for (const IdType id : query.resultList())
+            {
+                if (const std::optional<std::size_t> row{ findRow(rowIds, id) })
+                    ranks[*row] = rank++;
+            }
+
+            return ranks;
+        }
+
+        template <typename IdType, typename RowFilter>
+        auto makeRowMatcher(const std::vector<IdType>& rowIds, std::vector<IdType> ids, IdType afterId, RowFilter rowFilter)
+        {
+            std::sort(std::begin(ids), std::end(ids));
+
+            return [&rowIds, ids = std::move(ids), afterId, rowFilter](std::size_t row)
+            {
+                const IdType id{ rowIds[row] };
+                if (afterId.isValid() && !(afterId < id))
+                    return false;
+                if (!ids.empty() && !std::binary_search(std::cbegin(ids), std::cend(ids), id))
+                    return false;
+
+                return rowFilter(row);
+            };
+        }
+
+        // Rows matching the filters, in id order
+        template <typename IdType, typename RowFilter>
+        std::vector<std::uint32_t> findRows(const std::vector<IdType>& rowIds, const std::optional<RoaringBitmap>& candidates, std::vector<IdType> ids, IdType afterId, RowFilter rowFilter)
+        {
+            const auto matches{ makeRowMatcher(rowIds, std::move(ids), afterId, rowFilter) };
+
+            std::vector<std::uint32_t> rows;
+            if (candidates)
+            {
+                candidates->visit([&](RoaringBitmap::value_type value)
+                    {
+                        const std::optional<std::size_t> row{ findRow(rowIds, IdType{ value }) };
+                        if (row && matches(*row))
+                            rows.push_back(static_cast<std::uint32_t>(*row));
+                    });
+            }
+            else
+            {
+                for (std::size_t row{}; row < rowIds.size(); ++row)
+                {
+                    if (matches(row))
+                        rows.push_back(static_cast<std::uint32_t>(row));
+                }
+            }
+
+            return rows;
+        }
+
+        // Rows among [candidateRowsBegin, candidateRowsEnd) matching the filters, in the same order
+        template <typename IdType, typename RowFilter>
+        std::vector<std::uint32_t> findRows(const std::vector<IdType>& rowIds, const std::uint32_t* candidateRowsBegin, const std::uint32_t* candidateRowsEnd, std::vector<IdType> ids, IdType afterId, RowFilter rowFilter)
+        {
+            const auto matches{ makeRowMatcher(rowIds, std::move(ids), afterId, rowFilter) };
+
+            std::vector<std::uint32_t> rows;
+            std::copy_if(candidateRowsBegin, candidateRowsEnd, std::back_inserter(rows), matches);
+
+            return rows;
+        }
+
+        // Only the rows in the requested range are sorted (or shuffled)
+        template <typename IdType, typename RowLess>
+        RangeResults<IdType> getRangeResults(const std::vector<IdType>& rowIds, std::vector<std::uint32_t> rows, RowOrder order, RowLess rowLess, std::optional<Range> range)
+        {
+            const std::size_t begin{ range ? std::min(range->offset, rows.size()) : 0 };
+            const std::size_t end{ range ? begin + std::min(range->size, rows.size() - begin) : rows.size() };
+
+            switch (order)
+            {
+            case RowOrder::Id:
+                break;
+            case RowOrder::Rank:
+                std::partial_sort(std::begin(rows), std::begin(rows) + end, std::end(rows), rowLess);
+                break;
+            case RowOrder::Random:
+                for (std::size_t i{}; i < end; ++i)
+                {
+                    std::uniform_int_distribution<std::size_t> dist{ i, rows.size() - 1 };
+                    std::swap(rows[i], rows[dist(Random::getRandGenerator())]);
+                }
+                break;
+            }
+
+            RangeResults<IdType> res;
+            res.results.reserve(end - begin);
+            for (std::size_t i{ begin }; i < end; ++i)
+                res.results.push_back(rowIds[rows[i]]);
+
+            res.range.offset = range ? range->offset : 0;
+            res.range.size = res.results.size();
+            res.moreResults = end < rows.size();
+
+            return res;
+        }
+    }
+
+    std::shared_ptr<const LibraryCatalog> LibraryCatalog::build(Session& session, std::shared_ptr<const ClusterIndex> clusterIndex)
+    {
+        session.checkSharedLocked();
+
+        auto catalog{ std::make_shared<LibraryCatalog>() };
+        catalog->_clusterIndex = std::move(clusterIndex);
+
+        {
+            ArtistColumns& artists{ catalog->_artists };
+            artists.ids = readIds<ArtistId>(session, "artist");
+            artists.nameRanks = readRanks(session, "artist", "name COLLATE NOCASE, id", artists.ids);
+            artists.sortNameRanks = readRanks(session, "artist", "sort_key, id", artists.ids);
+            artists.linkTypes.resize(artists.ids.size());
+
+            using ResultType = std::tuple<ArtistId, TrackArtistLinkType>;
+            auto query{ session.getDboSession().query<ResultType>("SELECT DISTINCT artist_id, type FROM track_artist_link") };
+            for (const auto& [artistId, linkType] : query.resultList())
+            {
+                if (const std::optional<std::size_t> row{ findRow(artists.ids, artistId) })
+                    artists.linkTypes[*row].insert(linkType);
+            }
+        }
+
+        {
+            ReleaseColumns& releases{ catalog->_releases };
+
+            using ResultType = std::tuple<ReleaseId, std::optional<ReleaseTypePrimary>>;
+            auto query{ session.getDboSession().query<ResultType>("SELECT id, primary_type FROM release").orderBy("id") };
+            for (const auto& [releaseId, primaryType] : query.resultList())
+            {
+                releases.ids.push_back(releaseId);
+                releases.primaryTypes.push_back(primaryType);
+            }
+            releases.nameRanks = readRanks(session, "release", "sort_key, id", releases.ids);
+        }
+
+        {
+            TrackColumns& tracks{ catalog->_tracks };
+
+            using ResultType = std::tuple<TrackId, Wt::WDateTime>;
+            auto query{ session.getDboSession().query<ResultType>("SELECT id, file_last_write FROM track").orderBy("id") };
+            for (const auto& [trackId, lastWritten] : query.resultList())
+            {
+                tracks.ids.push_back(trackId);
+                tracks.lastWrittens.push_back(lastWritten.isValid() ? lastWritten.toTime_t() : 0);
+            }
+            tracks.nameRanks = readRanks(session, "track", "name COLLATE NOCASE, id", tracks.ids);
+        }
+
+        {
+            using ResultType = std::tuple<ArtistId, ReleaseId, TrackArtistLinkType>;
+            auto query{ session.getDboSession().query<ResultType>("SELECT DISTINCT t_a_l.artist_id, t.release_id, t_a_l.type FROM track_artist_link t_a_l INNER JOIN track t ON t.id = t_a_l.track_id")
+                .where("t.release_id IS NOT NULL")
+                .orderBy("t_a_l.artist_id, t.release_id") };
+
+            std::optional<std::size_t> previousArtistRow;
+            std::optional<std::size_t> previousReleaseRow;
+            for (const auto& [artistId, releaseId, linkType] : query.resultList())
+            {
+                const std::optional<std::size_t> artistRow{ findRow(catalog->_artists.ids, artistId) };
+                const std::optional<std::size_t> releaseRow{ findRow(catalog->_releases.ids, releaseId) };
+                if (!artistRow || !releaseRow)
+                    continue;
+
+                // one result per link type
+                if (artistRow != previousArtistRow || releaseRow != previousReleaseRow)
+                {
+                    catalog->_artistReleases.add(*artistRow, static_cast<std::uint32_t>(*releaseRow));
+                    catalog->_artistReleaseLinkTypes.emplace_back();
+                    previousArtistRow = artistRow;
+                    previousReleaseRow = releaseRow;
+                }
+                catalog->_artistReleaseLinkTypes.back().insert(linkType);
+            }
+            catalog->_artistReleases.finalize(catalog->_artists.ids.size());
+        }
+
+        {
+            using ResultType = std::tuple<ReleaseId, TrackId>;
+            auto query{ session.getDboSession().query<ResultType>("SELECT release_id, id FROM track")
+                .where("release_id IS NOT NULL")
+                .orderBy("release_id, disc_number, track_number, id") };
+
+            for (const auto& [releaseId, trackId] : query.resultList())
+            {
+                const std::optional<std::size_t> releaseRow{ findRow(catalog->_releases.ids, releaseId) };
+                const std::optional<std::size_t> trackRow{ findRow(catalog->_tracks.ids, trackId) };
+                if (releaseRow && trackRow)
+                    catalog->_releaseTracks.add(*releaseRow, static_cast<std::uint32_t>(*trackRow));
+            }
+            catalog->_releaseTracks.finalize(catalog->_releases.ids.size());
+        }
+
+        LMS_LOG(DB, DEBUG) << "Built library catalog: " << catalog->getArtistCount() << " artists, " << catalog->getReleaseCount() << " releases, " << catalog->getTrackCount() << " tracks, " << catalog->getMemoryUsage() / 1024 << " KiB";
+
+        return catalog;
+    }
+
+    std::optional<RangeResults<ArtistId>> LibraryCatalog::findArtistIds(const Artist::FindParameters& params) const
+    {
+        if (!params.clusters.empty()
+            || !params.keywords.empty()
+            || params.writtenAfter.isValid()
+            || params.addedAfter.isValid()
+            || params.starringUser.isValid()
+            || params.track.isValid()
+            || params.release.isValid())
+        {
+            return std::nullopt;
+        }
+
+        RowOrder order;
+        const std::vector<std::uint32_t>* ranks{};
+        switch (params.sortMethod)
+        {
+        case ArtistSortMethod::None:
+        case ArtistSortMethod::Id:
+            order = RowOrder::Id;
+            break;
+        case ArtistSortMethod::ByName:
+            order = RowOrder::Rank;
+            ranks = &_artists.nameRanks;
+            break;
+        case ArtistSortMethod::BySortName:
+            order = RowOrder::Rank;
+            ranks = &_artists.sortNameRanks;
+            break;
+        case ArtistSortMethod::Random:
+            order = RowOrder::Random;
+            break;
+        default:
+            return std::nullopt;
+        }
+
+        std::vector<std::uint32_t> rows{ findRows(_artists.ids, std::nullopt, params.ids, params.afterId, [&](std::size_t row)
+            {
+                return !params.linkType || _artists.linkTypes[row].contains(*params.linkType);
+            }) };
+
+        return getRangeResults(_artists.ids, std::move(rows), order, [&](std::uint32_t a, std::uint32_t b) { return (*ranks)[a] < (*ranks)[b]; }, params.range);
+    }
+
+    std::optional<RangeResults<ReleaseId>> LibraryCatalog::findReleaseIds(const Release::FindParameters& params) const
+    {
+        if ((!params.clusters.empty() && !_clusterIndex)
+            || !params.keywords.empty()
+            || params.writtenAfter.isValid()
+            || params.addedAfter.isValid()
+            || params.dateRange
+            || params.starringUser.isValid()
+            || (params.artist.isValid() && !params.clusters.empty())
+            || !params.secondaryTypes.empty())
+        {
+            return std::nullopt;
+        }
+
+        RowOrder order;
+        switch (params.sortMethod)
+        {
+        case ReleaseSortMethod::None:
+        case ReleaseSortMethod::Id:
+            order = RowOrder::Id;
+            break;
+        case ReleaseSortMethod::Name:
+            order = RowOrder::Rank;
+            break;
+        case ReleaseSortMethod::Random:
+            order = RowOrder::Random;
+            break;
+        default:
+            return std::nullopt;
+        }
+
+        auto rowFilter{ [&](std::size_t row)
+            {
+                return !params.primaryType || _releases.primaryTypes[row] == params.primaryType;
+            } };
+
+        std::vector<std::uint32_t> rows;
+        if (params.artist.isValid())
+        {
+            const std::optional<std::size_t> artistRow{ findRow(_artists.ids, params.artist) };
+            if (!artistRow)
+                return RangeResults<ReleaseId>{};
+
+            const std::uint32_t begin{ _artistReleases.offsets[*artistRow] };
+            const std::uint32_t end{ _artistReleases.offsets[*artistRow + 1] };
+
+            // the link types are indexed as the release rows
+            std::vector<std::uint32_t> candidateRows;
+            for (std::uint32_t i{ begin }; i < end; ++i)
+            {
+                const EnumSet<TrackArtistLinkType>::ValueType linkTypes{ _artistReleaseLinkTypes[i].getBitfield() };
+                if (!params.trackArtistLinkTypes.empty() && !(linkTypes & params.trackArtistLinkTypes.getBitfield()))
+                    continue;
+                if (linkTypes & params.excludedTrackArtistLinkTypes.getBitfield())
+                    continue;
+
+                candidateRows.push_back(_artistReleases.rows[i]);
+            }
+
+            rows = findRows(_releases.ids, candidateRows.data(), candidateRows.data() + candidateRows.size(), params.ids, params.afterId, rowFilter);
+        }
+        else
+        {
+            std::optional<RoaringBitmap> candidates;
+            if (!params.clusters.empty())
+                candidates = _clusterIndex->getReleases(params.clusters);
+
+            rows = findRows(_releases.ids, candidates, params.ids, params.afterId, rowFilter);
+        }
+
+        return getRangeResults(_releases.ids, std::move(rows), order, [&](std::uint32_t a, std::uint32_t b) { return _releases.nameRanks[a] < _releases.nameRanks[b]; }, params.range);
+    }
+
+    std::optional<RangeResults<TrackId>> LibraryCatalog::findTrackIds(const Track::FindParameters& params) const
+    {
+        if ((!params.clusters.empty() && !_clusterIndex)
+            || !params.keywords.empty()
+            || !params.name.empty()
+            || params.writtenAfter.isValid()
+            || params.addedAfter.isValid()
+            || params.starringUser.isValid()
+            || params.artist.isValid()
+            || !params.artistName.empty()
+            || params.nonRelease
+            || (params.release.isValid() && !params.clusters.empty())
+            || !params.releaseName.empty()
+            || params.trackList.isValid()
+            || params.trackNumber)
+        {
+            return std::nullopt;
+        }
+
+        RowOrder order;
+        bool byLastWritten{};
+        switch (params.sortMethod)
+        {
+        case TrackSortMethod::None:
+        case TrackSortMethod::Id:
+            order = RowOrder::Id;
+            break;
+        case TrackSortMethod::Name:
+            order = RowOrder::Rank;
+            break;
+        case TrackSortMethod::LastWritten:
+            order = RowOrder::Rank;
+            byLastWritten = true;
+            break;
+        case TrackSortMethod::Random:
+            order = RowOrder::Random;
+            break;
+        case TrackSortMethod::Release:
+            if (!params.release.isValid())
+                return std::nullopt;
+            order = RowOrder::Id; // the release tracks are stored in this order
+            break;
+        default:
+            return std::nullopt;
+        }
+
+        if (order == RowOrder::Random && !params.release.isValid() && params.ids.empty() && !params.afterId.isValid() && params.range && params.range->offset == 0)
+            return findRandomTrackIds(params.clusters, params.range->size);
+
+        std::vector<std::uint32_t> rows;
+        if (params.release.isValid())
+        {
+            const std::optional<std::size_t> releaseRow{ findRow(_releases.ids, params.release) };
+            if (!releaseRow)
+                return RangeResults<TrackId>{};
+
+            const std::uint32_t* releaseTrackRows{ _releaseTracks.rows.data() };
+            rows = findRows(_tracks.ids, releaseTrackRows + _releaseTracks.offsets[*releaseRow], releaseTrackRows + _releaseTracks.offsets[*releaseRow + 1], params.ids, params.afterId, [](std::size_t) { return true; });
+            if (params.sortMethod == TrackSortMethod::Id)
+                std::sort(std::begin(rows), std::end(rows));
+        }
+        else
+        {
+            std::optional<RoaringBitmap> candidates;
+            if (!params.clusters.empty())
+                candidates = _clusterIndex->getTracks(params.clusters);
+
+            rows = findRows(_tracks.ids, candidates, params.ids, params.afterId, [](std::size_t) { return true; });
+        }
+
+        return getRangeResults(_tracks.ids, std::move(rows), order, [&](std::uint32_t a, std::uint32_t b)
+            {
+                if (byLastWritten)
+                {
+                    // most recent first, rows are in id order for equal dates
+                    if (_tracks.lastWrittens[a] != _tracks.lastWrittens[b])
+                        return _tracks.lastWrittens[a] > _tracks.lastWrittens[b];
+                    return a < b;
+                }
+
+                return _tracks.nameRanks[a] < _tracks.nameRanks[b];
+            }, params.range);
+    }
+
+    RangeResults<TrackId> LibraryCatalog::findRandomTrackIds(const std::vector<ClusterId>& clusters, std::size_t size) const
+    {
+        std::vector<ClusterId> filter{ clusters };
+        std::sort(std::begin(filter), std::end(filter));
+        filter.erase(std::unique(std::begin(filter), std::end(filter)), std::end(filter));
+
+        const std::scoped_lock lock{ _randomTrackPoolsMutex };
+
+        auto it{ _randomTrackPools.find(filter) };
+        if (it == std::end(_randomTrackPools))
+        {
+            // the filters are user provided
+            if (_randomTrackPools.size() >= maxRandomTrackPoolCount)
+                _randomTrackPools.clear();
+
+            std::optional<RoaringBitmap> candidates;
+            if (!filter.empty())
+                candidates = _clusterIndex->getTracks(filter);
+
+            RandomTrackPool pool;
+            pool.rows = findRows(_tracks.ids, candidates, std::vector<TrackId>{}, TrackId{}, [](std::size_t) { return true; });
+            Random::shuffleContainer(pool.rows);
+            it = _randomTrackPools.emplace(std::move(filter), std::move(pool)).first;
+        }
+
+        RandomTrackPool& pool{ it->second };
+        size = std::min(size, pool.rows.size());
+
+        // not enough rows left for a page without duplicates, amortized over the pages of a whole permutation
+        if (pool.cursor + size > pool.rows.size())
+        {
+            Random::shuffleContainer(pool.rows);
+            pool.cursor = 0;
+        }
+
+        RangeResults<TrackId> res;
+        res.results.reserve(size);
+        for (std::size_t i{ pool.cursor }; i < pool.cursor + size; ++i)
+            res.results.push_back(_tracks.ids[pool.rows[i]]);
+        pool.cursor += size;
+
+        res.range = Range{ 0, size };
+        res.moreResults = size < pool.rows.size();
+
+        return res;
+    }
+
+    void LibraryCatalog::ChildRows::add(std::size_t parentRow, std::uint32_t childRow)
+    {
+        assert(offsets.size() <= parentRow + 1);
+
+        while (offsets.size() < parentRow + 1)
+            offsets.push_back(static_cast<std::uint32_t>(rows.size()));
+        rows.push_back(childRow);
+    }
+
+    void LibraryCatalog::ChildRows::finalize(std::size_t parentCount)
+    {
+        while (offsets.size() < parentCount + 1)
+            offsets.push_back(static_cast<std::uint32_t>(rows.size()));
+    }
+
+    std::size_t LibraryCatalog::getMemoryUsage() const
+    {
+        std::size_t res{ sizeof(*this) };
+
+        res += _artists.ids.capacity() * sizeof(ArtistId);
+        res += (_artists.nameRanks.capacity() + _artists.sortNameRanks.capacity()) * sizeof(std::uint32_t);
+        res += _artists.linkTypes.capacity() * sizeof(EnumSet<TrackArtistLinkType>);
+
+        res += _releases.ids.capacity() * sizeof(ReleaseId);
+        res += _releases.nameRanks.capacity() * sizeof(std::uint32_t);
+        res += _releases.primaryTypes.capacity() * sizeof(std::optional<ReleaseTypePrimary>);
+
+        res += _tracks.ids.capacity() * sizeof(TrackId);
+        res += _tracks.nameRanks.capacity() * sizeof(std::uint32_t);
+        res += _tracks.lastWrittens.capacity() * sizeof(std::time_t);
+
+        res += (_artistReleases.offsets.capacity() + _artistReleases.rows.capacity()) * sizeof(std::uint32_t);
+        res += _artistReleaseLinkTypes.capacity() * sizeof(EnumSet<TrackArtistLinkType>);
+        res += (_releaseTracks.offsets.capacity() + _releaseTracks.rows.capacity()) * sizeof(std::uint32_t);
+
+        {
+            const std::scoped_lock lock{ _randomTrackPoolsMutex };
+            for (const auto& [filter, pool] : _randomTrackPools)
+                res += filter.capacity() * sizeof(ClusterId) + pool.rows.capacity() * sizeof(std::uint32_t);
+        }
+
+        return res;
+    }
+} // namespace Database
@@ -18,6 +18,10 @@
  */
 
 #include "services/database/Listen.hpp"
+
+#include <algorithm>
+#include <tuple>
+
 #include "services/database/Session.hpp"
 #include "services/database/Track.hpp"
 #include "services/database/User.hpp"
@@ -29,14 +33,15 @@ namespace
 {
     using namespace Database;
 
+    // These queries read the per track listen_count rollup (see Session) rather than the raw listens
     Wt::Dbo::Query<ArtistId> createArtistsQuery(Wt::Dbo::Session& session, UserId userId, ScrobblingBackend backend, const std::vector<ClusterId>& clusterIds, std::optional<TrackArtistLinkType> linkType)
     {
         auto query{ session.query<ArtistId>("SELECT a.id from artist a")
                         .join("track t ON t.id = t_a_l.track_id")
                         .join("track_artist_link t_a_l ON t_a_l.artist_id = a.id")
-                        .join("listen l ON l.track_id = t.id")
-                        .where("l.user_id = ?").bind(userId)
-                        .where("l.backend = ?").bind(backend) };
+                        .join("listen_count l_c ON l_c.track_id = t.id")
+                        .where("l_c.user_id = ?").bind(userId)
+                        .where("l_c.backend = ?").bind(backend) };
 
         if (linkType)
             query.where("t_a_l.type = ?").bind(*linkType);
@@ -70,9 +75,9 @@ namespace
     {
         auto query{ session.query<ReleaseId>("SELECT r.id from release r")
                         .join("track t ON t.release_id = r.id")
-                        .join("listen l ON l.track_id = t.id")
-                        .where("l.user_id = ?").bind(userId)
-                        .where("l.backend = ?").bind(backend) };
+                        .join("listen_count l_c ON l_c.track_id = t.id")
+                        .where("l_c.user_id = ?").bind(userId)
+                        .where("l_c.backend = ?").bind(backend) };
 
         if (!clusterIds.empty())
         {
@@ -101,9 +106,9 @@ namespace
     Wt::Dbo::Query<TrackId> createTracksQuery(Wt::Dbo::Session& session, UserId userId, ScrobblingBackend backend, const std::vector<ClusterId>& clusterIds)
     {
         auto query{ session.query<TrackId>("SELECT t.id from track t")
-                    .join("listen l ON l.track_id = t.id")
-                    .where("l.user_id = ?").bind(userId)
-                    .where("l.backend = ?").bind(backend) };
+                    .join("listen_count l_c ON l_c.track_id = t.id")
+                    .where("l_c.user_id = ?").bind(userId)
+                    .where("l_c.backend = ?").bind(backend) };
 
         if (!clusterIds.empty())
         {
@@ -187,13 +192,27 @@ namespace Database
             .resultValue();
     }
 
+    std::vector<Listen::pointer> Listen::find(Session& session, UserId userId, ScrobblingBackend backend, const Wt::WDateTime& from, const Wt::WDateTime& to)
+    {
+        session.checkSharedLocked();
+
+        Wt::Dbo::collection<Wt::Dbo::ptr<Listen>> res = session.getDboSession().find<Listen>()
+            .where("user_id = ?").bind(userId)
+            .where("backend = ?").bind(backend)
+            .where("date_time >= ?").bind(Wt::WDateTime::fromTime_t(from.toTime_t()))
+            .where("date_time <= ?").bind(Wt::WDateTime::fromTime_t(to.toTime_t()))
+            .orderBy("date_time");
+
+        return std::vector<Listen::pointer>(res.begin(), res.end());
+    }
+
     RangeResults<ArtistId> Listen::getTopArtists(Session& session, UserId userId, ScrobblingBackend backend, const std::vector<ClusterId>& clusterIds, std::optional<TrackArtistLinkType> linkType, std::optional<Range> range)
     {
         session.checkSharedLocked();
         auto query{ createArtistsQuery(session.getDboSession(), userId, backend, clusterIds, linkType) };
 
         auto collection{ query
-            .orderBy("COUNT(a.id) DESC")
+            .orderBy("SUM(l_c.count) DESC")
             .groupBy("a.id") };
 
         return Utils::execQuery<ArtistId>(query, range);
@@ -203,7 +222,7 @@ namespace Database
     {
         session.checkSharedLocked();
         auto query{ createReleasesQuery(session.getDboSession(), userId, backend, clusterIds)
-                        .orderBy("COUNT(r.id) DESC")
+                        .orderBy("SUM(l_c.count) DESC")
                         .groupBy("r.id") };
 
         return Utils::execQuery<ReleaseId>(query, range);
@@ -213,8 +232,18 @@ namespace Database
     {
         session.checkSharedLocked();
         auto query{ createTracksQuery(session.getDboSession(), userId, backend, clusterIds)
-                        .orderBy("COUNT(t.id) DESC")
-                        .groupBy("t.id") };
+                        .orderBy("l_c.count DESC") };
+
+        return Utils::execQuery<TrackId>(query, range);
+    }
+
+    RangeResults<TrackId> Listen::getTopTracks(Session& session, std::optional<Range> range)
+    {
+        session.checkSharedLocked();
+        auto query{ session.getDboSession().query<TrackId>("SELECT t.id from track t")
+                        .join("listen_count l_c ON l_c.track_id = t.id")
+                        .groupBy("t.id")
+                        .orderBy("SUM(l_c.count) DESC, t.id") };
 
         return Utils::execQuery<TrackId>(query, range);
     }
@@ -223,8 +252,8 @@ namespace Database
     {
         session.checkSharedLocked();
         auto query{ createArtistsQuery(session.getDboSession(), userId, backend, clusterIds, linkType)
-                        .groupBy("a.id").having("l.date_time = MAX(l.date_time)")
-                        .orderBy("l.date_time DESC") };
+                        .groupBy("a.id")
+                        .orderBy("MAX(l_c.last_date_time) DESC") };
 
         return Utils::execQuery<ArtistId>(query, range);
     }
@@ -233,8 +262,8 @@ namespace Database
     {
         session.checkSharedLocked();
         auto query{ createReleasesQuery(session.getDboSession(), userId, backend, clusterIds)
-                        .groupBy("r.id").having("l.date_time = MAX(l.date_time)")
-                        .orderBy("l.date_time DESC") };
+                        .groupBy("r.id")
+                        .orderBy("MAX(l_c.last_date_time) DESC") };
 
         return Utils::execQuery<ReleaseId>(query, range);
     }
@@ -243,8 +272,7 @@ namespace Database
     {
         session.checkSharedLocked();
         auto query{ createTracksQuery(session.getDboSession(), userId, backend, clusterIds)
-                        .groupBy("t.id").having("l.date_time = MAX(l.date_time)")
-                        .orderBy("l.date_time DESC") };
+                        .orderBy("l_c.last_date_time DESC") };
 
         return Utils::execQuery<TrackId>(query, range);
     }
@@ -253,24 +281,47 @@ namespace Database
     {
         session.checkSharedLocked();
 
-        return session.getDboSession().query<int>("SELECT COUNT(*) from listen l")
-            .where("l.track_id = ?").bind(trackId)
-            .where("l.user_id = ?").bind(userId)
-            .where("l.backend = ?").bind(backend)
+        return session.getDboSession().query<int>("SELECT IFNULL(SUM(l_c.count), 0) FROM listen_count l_c")
+            .where("l_c.track_id = ?").bind(trackId)
+            .where("l_c.user_id = ?").bind(userId)
+            .where("l_c.backend = ?").bind(backend)
             .resultValue();
     }
 
+    std::unordered_map<TrackId, std::size_t> Listen::getCounts(Session& session, UserId userId, ScrobblingBackend backend, const std::vector<TrackId>& trackIds)
+    {
+        session.checkSharedLocked();
+
+        std::unordered_map<TrackId, std::size_t> res;
+
+        // keep the bound parameter count well below the SQLite limits
+        constexpr std::size_t batchSize{ 500 };
+        for (std::size_t offset{}; offset < trackIds.size(); offset += batchSize)
+        {
+            const std::size_t count{ std::min(batchSize, trackIds.size() - offset) };
+
+            auto query{ session.getDboSession().query<std::tuple<TrackId, int>>("SELECT l_c.track_id, l_c.count FROM listen_count l_c")
+                .where("l_c.user_id = ?").bind(userId)
+                .where("l_c.backend = ?").bind(backend)
+                .where("l_c.track_id IN (" + Utils::makePlaceholders(count) + ")") };
+            for (std::size_t i{}; i < count; ++i)
+                query.bind(trackIds[offset + i]);
+
+            for (const auto& [trackId, listenCount] : query.resultList())
+                res.emplace(trackId, listenCount);
+        }
+
+        return res;
+    }
+
     std::size_t Listen::getCount(Session& session, UserId userId, ScrobblingBackend backend, ReleaseId releaseId)
     {
         session.checkSharedLocked();
 
-        return session.getDboSession().query<int>("SELECT IFNULL(MIN(count_result), 0)"
-            " FROM ("
-            " SELECT COUNT(l.track_id) AS count_result"
+        return session.getDboSession().query<int>("SELECT IFNULL(MIN(IFNULL(l_c.count, 0)), 0)"
             " FROM track t"
-            " LEFT JOIN listen l ON t.id = l.track_id AND l.backend = ? AND l.user_id = ?"
-            " WHERE t.release_id = ?"
-            " GROUP BY t.id)")
+            " LEFT JOIN listen_count l_c ON t.id = l_c.track_id AND l_c.backend = ? AND l_c.user_id = ?"
+            " WHERE t.release_id = ?")
             .bind(backend)
             .bind(userId)
             .bind(releaseId)
@@ -304,5 +355,47 @@ namespace Database
             .limit(1)
             .resultValue();
     }
-} // namespace Database
 
+    std::size_t Listen::archive(Session& session, ScrobblingBackend backend, const Wt::WDateTime& dateTime)
+    {
+        session.checkUniqueLocked();
+
+        const Wt::WDateTime before{ Wt::WDateTime::fromTime_t(dateTime.toTime_t()) };
+
+        const std::size_t count{ static_cast<std::size_t>(session.getDboSession().query<int>("SELECT COUNT(*) FROM listen")
+            .where("backend = ?").bind(backend)
+            .where("sync_state = ?").bind(SyncState::Synchronized)
+            .where("date_time < ?").bind(before)
+            .resultValue()) };
+        if (count == 0)
+            return 0;
+
+        // the listen count triggers are balanced: the archived listens are counted before the listens are removed
+        session.getDboSession().execute("INSERT INTO listen_archive (user_id, backend, track_id, month, count, last_date_time)"
+            " SELECT user_id, backend, track_id, strftime('%Y-%m', date_time), COUNT(*), MAX(date_time) FROM listen"
+            " WHERE backend = ? AND sync_state = ? AND date_time < ? AND user_id IS NOT NULL AND track_id IS NOT NULL"
+            " GROUP BY user_id, backend, track_id, strftime('%Y-%m', date_time)"
+            " ON CONFLICT (user_id, backend, track_id, month) DO UPDATE SET count = count + excluded.count, last_date_time = MAX(last_date_time, excluded.last_date_time)")
+            .bind(backend)
+            .bind(SyncState::Synchronized)
+            .bind(before);
+
+        session.getDboSession().execute("DELETE FROM listen WHERE backend = ? AND sync_state = ? AND date_time < ?")
+            .bind(backend)
+            .bind(SyncState::Synchronized)
+            .bind(before);
+
+        return count;
+    }
+
+    std::size_t Listen::getArchivedCount(Session& session)
+    {
+        session.checkSharedLocked();
+        return session.getDboSession().query<int>("SELECT IFNULL(SUM(count), 0) FROM listen_archive");
+    }
+
+    TrackId Listen::getTrackId() const
+    {
+        return _track.id();
+    }
+} // namespace Database
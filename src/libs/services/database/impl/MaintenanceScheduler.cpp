@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "services/database/MaintenanceScheduler.hpp"
+
+#include <functional>
+#include <string_view>
+
+#include "services/database/Db.hpp"
+#include "services/database/Session.hpp"
+#include "utils/Logger.hpp"
+
+namespace Database
+{
+    namespace
+    {
+        // bounds the duration of each incremental vacuum (4 KiB pages)
+        constexpr std::size_t incrementalVacuumMaxPageCount{ 2048 };
+    }
+
+    MaintenanceScheduler::MaintenanceScheduler(boost::asio::io_context& ioContext, Db& db, std::chrono::seconds checkPeriod, std::chrono::seconds timeBudget)
+        : _strand{ ioContext }
+        , _timer{ ioContext }
+        , _db{ db }
+        , _checkPeriod{ checkPeriod }
+        , _timeBudget{ timeBudget }
+        , _lastWriteTransactionCount{ db.getWriteTransactionCount() }
+    {
+        LMS_LOG(DB, INFO) << "Database maintenance checked every " << _checkPeriod.count() << " seconds";
+        scheduleCheck();
+    }
+
+    MaintenanceScheduler::~MaintenanceScheduler()
+    {
+        _timer.cancel();
+    }
+
+    void MaintenanceScheduler::scheduleCheck()
+    {
+        _timer.expires_after(_checkPeriod);
+        _timer.async_wait(boost::asio::bind_executor(_strand, [this](const boost::system::error_code& ec)
+            {
+                if (ec == boost::asio::error::operation_aborted)
+                    return;
+
+                check();
+                scheduleCheck();
+            }));
+    }
+
+    void MaintenanceScheduler::check()
+    {
+        const std::size_t writeTransactionCount{ _db.getWriteTransactionCount() };
+        if (writeTransactionCount != _lastWriteTransactionCount)
+        {
+            // not quiet, wait for the next period
+            _lastWriteTransactionCount = writeTransactionCount;
+            _maintenanceNeeded = true;
+            return;
+        }
+
+        if (!_maintenanceNeeded)
+            return;
+
+        runMaintenance();
+
+        // do not count our own transactions as activity
+        _lastWriteTransactionCount = _db.getWriteTransactionCount();
+        _maintenanceNeeded = false;
+    }
+
+    void MaintenanceScheduler::runMaintenance()
+    {
+        LMS_LOG(DB, INFO) << "Running database maintenance...";
+
+        Session& session{ _db.getTLSSession() };
+        const auto start{ std::chrono::steady_clock::now() };
+
+        auto runStep{ [&](std::string_view stepName, std::function<void()> step)
+        {
+            const auto stepStart{ std::chrono::steady_clock::now() };
+            if (stepStart - start > _timeBudget)
+            {
+                LMS_LOG(DB, INFO) << "Database maintenance: skipping " << stepName << ", time budget exceeded";
+                return;
+            }
+
+            try
+            {
+                step();
+                LMS_LOG(DB, INFO) << "Database maintenance: " << stepName << " took " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - stepStart).count() << " ms";
+            }
+            catch (const std::exception& e)
+            {
+                LMS_LOG(DB, ERROR) << "Database maintenance: " << stepName << " failed: " << e.what();
+            }
+        } };
+
+        // cheapest and most useful steps first
+        runStep("WAL checkpoint", [&] { session.checkpointWal(); });
+        runStep("optimize", [&] { session.optimize(); });
+        runStep("analyze", [&] { session.analyze(); });
+        runStep("incremental vacuum", [&] { session.incrementalVacuum(incrementalVacuumMaxPageCount); });
+
+        LMS_LOG(DB, INFO) << "Database maintenance complete in " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << " ms";
+    }
+}
@@ -19,14 +19,22 @@
 
 #include "Migration.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <tuple>
+#include <vector>
+
 #include <Wt/Dbo/WtSqlTraits.h>
 
 #include "services/database/Db.hpp"
+#include "services/database/Release.hpp"
 #include "services/database/ScanSettings.hpp"
 #include "services/database/Session.hpp"
 #include "services/database/User.hpp"
 #include "utils/Exception.hpp"
 #include "utils/Logger.hpp"
+#include "utils/String.hpp"
+#include "TrackFeaturesEncoding.hpp"
 
 namespace Database
 {
@@ -72,6 +80,90 @@ namespace Database::Migration
         Db& _db;
     };
 
+    // Large writes in a single transaction: keep the dirty pages in memory instead of spilling them to the WAL,
+    // and build the temporary indexes/tables in memory
+    // Must be created inside the transaction, the pragmas only apply to the session connection
+    class ScopedMigrationTuning
+    {
+    public:
+        ScopedMigrationTuning(Session& session) : _session{ session }
+        {
+            _session.getDboSession().execute("PRAGMA cache_size=-262144"); // 256 MiB
+            _session.getDboSession().execute("PRAGMA temp_store=MEMORY");
+            _session.getDboSession().execute("PRAGMA cache_spill=OFF");
+        }
+        ~ScopedMigrationTuning()
+        {
+            // back to the SQLite defaults
+            _session.getDboSession().execute("PRAGMA cache_spill=ON");
+            _session.getDboSession().execute("PRAGMA temp_store=DEFAULT");
+            _session.getDboSession().execute("PRAGMA cache_size=-2000");
+        }
+
+        ScopedMigrationTuning(const ScopedMigrationTuning&) = delete;
+        ScopedMigrationTuning(ScopedMigrationTuning&&) = delete;
+        ScopedMigrationTuning& operator=(const ScopedMigrationTuning&) = delete;
+        ScopedMigrationTuning& operator=(ScopedMigrationTuning&&) = delete;
+
+    private:
+        Session& _session;
+    };
+
+    // Steps that only compute derived data are not part of the blocking migration:
+    // they are queued here and run once the server is started (see runBackgroundTasks)
+    // Queued in the database so that they are resumed after a restart
+    static void queueBackgroundTask(Session& session, std::string_view name)
+    {
+        session.getDboSession().execute("INSERT OR IGNORE INTO migration_background_task (name) VALUES (?)").bind(std::string{ name });
+    }
+
+    static void computeSortKeys(Session& session, const std::string& table, const std::string& sourceColumn)
+    {
+        // keys are computed by LMS, not by SQLite: small batches so that the other writers are not held for long
+        constexpr int batchSize{ 1000 };
+        long long lastId{};
+        std::size_t updatedCount{};
+
+        while (true)
+        {
+            auto uniqueTransaction{ session.createUniqueTransaction() };
+
+            using Row = std::tuple<long long, std::string>;
+            const auto collection{ session.getDboSession().query<Row>("SELECT id, " + sourceColumn + " FROM " + table)
+                .where("id > ?").bind(lastId)
+                .orderBy("id")
+                .limit(batchSize)
+                .resultList() };
+            const std::vector<Row> rows(collection.begin(), collection.end());
+            if (rows.empty())
+                break;
+
+            for (const auto& [id, value] : rows)
+            {
+                lastId = id;
+                session.getDboSession().execute("UPDATE " + table + " SET sort_key = ? WHERE id = ?").bind(StringUtils::computeSortKey(value)).bind(id);
+            }
+
+            updatedCount += rows.size();
+            LMS_LOG(DB, DEBUG) << "Computed " << updatedCount << " " << table << " sort keys so far...";
+        }
+
+        LMS_LOG(DB, INFO) << "Computed " << updatedCount << " " << table << " sort keys";
+    }
+
+    static void backgroundComputeSortKeys(Session& session)
+    {
+        computeSortKeys(session, "artist", "sort_name");
+        computeSortKeys(session, "release", "name");
+    }
+
+    static void backgroundComputeReleaseAggregates(Session& session)
+    {
+        // single bulk statement, also run by the scanner after each scan
+        auto uniqueTransaction{ session.createUniqueTransaction() };
+        Release::updateAggregates(session);
+    }
+
     static void migrateFromV32(Session& session)
     {
         ScanSettings::get(session).modify()->addAudioFileExtension(".wv");
@@ -249,6 +341,163 @@ CREATE TABLE IF NOT EXISTS "track_backup" (
         session.getDboSession().execute("ALTER TABLE user ADD subsonic_enable_transcoding_by_default INTEGER NOT NULL DEFAULT(" + std::to_string(static_cast<int>(/*User::defaultSubsonicEnableTranscodingByDefault*/0)) + ")");
     }
 
+    void migrateFromV46(Session& session)
+    {
+        // add directory fingerprints, used by the scanner to skip unchanged directories
+        session.getDboSession().execute(R"(
+CREATE TABLE IF NOT EXISTS "directory_fingerprint" (
+  "id" integer primary key autoincrement,
+  "version" integer not null,
+  "directory" text not null,
+  "last_write" text,
+  "entry_count" integer not null,
+  "scan_version" integer not null
+);
+)");
+    }
+
+    void migrateFromV47(Session& session)
+    {
+        // track features: binary encoded values instead of the whole JSON document
+        // must be done now: the new code cannot read the old format
+        constexpr int batchSize{ 1000 };
+        long long lastId{};
+        std::size_t convertedCount{};
+        const std::size_t totalCount{ static_cast<std::size_t>(session.getDboSession().query<long long>("SELECT COUNT(*) FROM track_features").resultValue()) };
+
+        while (true)
+        {
+            using Row = std::tuple<long long, std::string>;
+            const auto collection{ session.getDboSession().query<Row>("SELECT id, data FROM track_features")
+                .where("id > ?").bind(lastId)
+                .orderBy("id")
+                .limit(batchSize)
+                .resultList() };
+            const std::vector<Row> rows(collection.begin(), collection.end());
+            if (rows.empty())
+                break;
+
+            for (const auto& [id, json] : rows)
+            {
+                lastId = id;
+
+                const std::optional<FeatureValuesMap> featureValuesMap{ TrackFeaturesEncoding::parseJson(json) };
+                if (!featureValuesMap)
+                    LMS_LOG(DB, WARNING) << "Cannot parse features " << id << ", discarding them";
+
+                session.getDboSession().execute("UPDATE track_features SET data = ? WHERE id = ?")
+                    .bind(TrackFeaturesEncoding::encode(featureValuesMap ? *featureValuesMap : FeatureValuesMap{}))
+                    .bind(id);
+                convertedCount++;
+            }
+
+            LMS_LOG(DB, INFO) << "Converted " << convertedCount << "/" << totalCount << " track features...";
+        }
+
+        LMS_LOG(DB, INFO) << "Converted " << convertedCount << " track features";
+    }
+
+    void migrateFromV48(Session& session)
+    {
+        // add file size in Track, so that the API does not have to stat files
+        session.getDboSession().execute("ALTER TABLE track ADD file_size BIGINT NOT NULL DEFAULT(0)");
+
+        // Just increment the scan version of the settings to make the next scheduled scan rescan everything
+        ScanSettings::get(session).modify()->incScanVersion();
+    }
+
+    void migrateFromV49(Session& session)
+    {
+        // add audio stream info in Track, so that streaming does not have to probe files
+        session.getDboSession().execute("ALTER TABLE track ADD audio_codec TEXT NOT NULL DEFAULT ''");
+        session.getDboSession().execute("ALTER TABLE track ADD sample_rate INTEGER NOT NULL DEFAULT(0)");
+        session.getDboSession().execute("ALTER TABLE track ADD channel_count INTEGER NOT NULL DEFAULT(0)");
+
+        // Just increment the scan version of the settings to make the next scheduled scan rescan everything
+        ScanSettings::get(session).modify()->incScanVersion();
+    }
+
+    void migrateFromV50(Session& session)
+    {
+        // add the listenbrainz listens import high-water mark, empty means everything has to be imported
+        session.getDboSession().execute("ALTER TABLE user ADD listenbrainz_listens_synced_until TEXT");
+    }
+
+    void migrateFromV51(Session& session)
+    {
+        // cache the track aggregates in Release, so that listing releases does not need per release queries
+        session.getDboSession().execute("ALTER TABLE release ADD duration INTEGER NOT NULL DEFAULT(0)");
+        session.getDboSession().execute("ALTER TABLE release ADD track_count INTEGER NOT NULL DEFAULT(0)");
+        session.getDboSession().execute("ALTER TABLE release ADD disc_count INTEGER NOT NULL DEFAULT(0)");
+        session.getDboSession().execute("ALTER TABLE release ADD min_year INTEGER");
+        session.getDboSession().execute("ALTER TABLE release ADD max_year INTEGER");
+        session.getDboSession().execute("ALTER TABLE release ADD has_embedded_cover BOOLEAN NOT NULL DEFAULT(0)");
+
+        // computed once the server is started rather than waiting for the next scan
+        queueBackgroundTask(session, "release_aggregates");
+    }
+
+    void migrateFromV52(Session& session)
+    {
+        // precomputed sort keys, so that sorted listings can be read in index order
+        session.getDboSession().execute("ALTER TABLE artist ADD sort_key TEXT NOT NULL DEFAULT('')");
+        session.getDboSession().execute("ALTER TABLE release ADD sort_key TEXT NOT NULL DEFAULT('')");
+        session.getDboSession().execute("ALTER TABLE release ADD artist_sort_key TEXT NOT NULL DEFAULT('')");
+
+        // artist_sort_key is computed along with the release aggregates, using the new sort keys
+        queueBackgroundTask(session, "sort_keys");
+        queueBackgroundTask(session, "release_aggregates");
+    }
+
+    void migrateFromV53(Session& session)
+    {
+        // sampled content hash, used to detect moved files without parsing them
+        session.getDboSession().execute("ALTER TABLE track ADD content_fingerprint BIGINT NOT NULL DEFAULT(0)");
+
+        // Just increment the scan version of the settings to make the next scheduled scan rescan everything
+        ScanSettings::get(session).modify()->incScanVersion();
+    }
+
+    void migrateFromV54(Session& session)
+    {
+        // parser results, so that rescans of unchanged files do not have to read them again
+        session.getDboSession().execute(R"(
+CREATE TABLE IF NOT EXISTS "track_metadata_cache" (
+  "id" integer primary key autoincrement,
+  "version" integer not null,
+  "file_last_write" text,
+  "file_size" bigint not null,
+  "data" blob not null,
+  "track_id" bigint,
+  constraint "fk_track_metadata_cache_track" foreign key ("track_id") references "track" ("id") on delete cascade deferrable initially deferred
+);
+)");
+    }
+
+    void migrateFromV55(Session& session)
+    {
+        // set on tracks whose duration and bitrate come from a fast parse, until they are refined
+        session.getDboSession().execute("ALTER TABLE track ADD audio_properties_pending BOOLEAN NOT NULL DEFAULT(0)");
+    }
+
+    void migrateFromV56(Session& session)
+    {
+        // play queues saved by the Subsonic clients
+        session.getDboSession().execute(R"(
+CREATE TABLE IF NOT EXISTS "play_queue" (
+  "id" integer primary key autoincrement,
+  "version" integer not null,
+  "track_ids" blob not null,
+  "current_index" bigint not null,
+  "current_position" bigint not null,
+  "last_modified_date_time" text,
+  "changed_by" text not null,
+  "user_id" bigint,
+  constraint "fk_play_queue_user" foreign key ("user_id") references "user" ("id") on delete cascade deferrable initially deferred
+);
+)");
+    }
+
     void doDbMigration(Session& session)
     {
         static const std::string outdatedMsg{ "Outdated database, please rebuild it (delete the .db file and restart)" };
@@ -273,6 +522,17 @@ CREATE TABLE IF NOT EXISTS "track_backup" (
             {43, migrateFromV43},
             {44, migrateFromV44},
             {45, migrateFromV45},
+            {46, migrateFromV46},
+            {47, migrateFromV47},
+            {48, migrateFromV48},
+            {49, migrateFromV49},
+            {50, migrateFromV50},
+            {51, migrateFromV51},
+            {52, migrateFromV52},
+            {53, migrateFromV53},
+            {54, migrateFromV54},
+            {55, migrateFromV55},
+            {56, migrateFromV56},
         };
 
         {
@@ -296,9 +556,19 @@ CREATE TABLE IF NOT EXISTS "track_backup" (
             if (version < migrationFunctions.begin()->first)
                 throw LmsException{ outdatedMsg };
 
+            session.getDboSession().execute("CREATE TABLE IF NOT EXISTS migration_background_task (name TEXT PRIMARY KEY)");
+
+            if (version == LMS_DATABASE_VERSION)
+                return;
+
+            ScopedMigrationTuning tuning{ session };
+
+            const Version initialVersion{ version };
+            const auto migrationStart{ std::chrono::steady_clock::now() };
             while (version < LMS_DATABASE_VERSION)
             {
-                LMS_LOG(DB, INFO) << "Migrating database from version " << version << " to " << version + 1 << "...";
+                LMS_LOG(DB, INFO) << "Migrating database from version " << version << " to " << version + 1 << " (step " << (version - initialVersion + 1) << "/" << (LMS_DATABASE_VERSION - initialVersion) << ")...";
+                const auto stepStart{ std::chrono::steady_clock::now() };
 
                 auto itMigrationFunc{ migrationFunctions.find(version) };
                 assert(itMigrationFunc != std::cend(migrationFunctions));
@@ -306,8 +576,54 @@ CREATE TABLE IF NOT EXISTS "track_backup" (
 
                 VersionInfo::get(session).modify()->setVersion(++version);
 
-                LMS_LOG(DB, INFO) << "Migration complete to version " << version;
+                const auto stepDuration{ std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - stepStart) };
+                LMS_LOG(DB, INFO) << "Migration complete to version " << version << " in " << stepDuration.count() << " ms";
+            }
+
+            const auto migrationDuration{ std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - migrationStart) };
+            LMS_LOG(DB, INFO) << "Database migration done in " << migrationDuration.count() << " ms";
+        }
+
+        // the whole migration went through the WAL, do not keep a file that large
+        session.getDb().executeSql("PRAGMA wal_checkpoint(TRUNCATE)");
+    }
+
+    void runBackgroundTasks(Session& session)
+    {
+        using BackgroundTask = std::function<void(Session&)>;
+
+        // run in this order, whatever the order they were queued
+        const std::vector<std::pair<std::string_view, BackgroundTask>> backgroundTasks
+        {
+            {"sort_keys", backgroundComputeSortKeys},
+            {"release_aggregates", backgroundComputeReleaseAggregates},
+        };
+
+        std::vector<std::string> pendingTasks;
+        {
+            auto transaction{ session.createSharedTransaction() };
+
+            const auto collection{ session.getDboSession().query<std::string>("SELECT name FROM migration_background_task").resultList() };
+            pendingTasks.assign(collection.begin(), collection.end());
+        }
+
+        for (const auto& [name, task] : backgroundTasks)
+        {
+            if (std::find(std::cbegin(pendingTasks), std::cend(pendingTasks), name) == std::cend(pendingTasks))
+                continue;
+
+            LMS_LOG(DB, INFO) << "Running background migration task '" << name << "'...";
+            const auto start{ std::chrono::steady_clock::now() };
+
+            task(session);
+
+            {
+                auto uniqueTransaction{ session.createUniqueTransaction() };
+                session.getDboSession().execute("DELETE FROM migration_background_task WHERE name = ?").bind(std::string{ name });
             }
+
+            const auto duration{ std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start) };
+            LMS_LOG(DB, INFO) << "Background migration task '" << name << "' done in " << duration.count() << " ms";
         }
     }
 }
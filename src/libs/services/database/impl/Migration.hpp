@@ -26,7 +26,7 @@ namespace Database
     class Session;
 
     using Version = std::size_t;
-    static constexpr Version LMS_DATABASE_VERSION{ 46 };
+    static constexpr Version LMS_DATABASE_VERSION{ 57 };
     class VersionInfo
     {
     public:
@@ -51,5 +51,6 @@ namespace Database
     namespace Migration
     {
         void doDbMigration(Session& session);
+        void runBackgroundTasks(Session& session); // derived data left to compute by the migration steps, may take a while
     }
 }
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "services/database/PlayQueue.hpp"
+
+#include <cstdint>
+
+#include "services/database/Session.hpp"
+#include "services/database/User.hpp"
+#include "IdTypeTraits.hpp"
+
+namespace Database
+{
+    namespace
+    {
+        void writeVarInt(std::vector<unsigned char>& data, std::uint64_t value)
+        {
+            while (value >= 0x80)
+            {
+                data.push_back(static_cast<unsigned char>(value | 0x80));
+                value >>= 7;
+            }
+            data.push_back(static_cast<unsigned char>(value));
+        }
+
+        bool readVarInt(const std::vector<unsigned char>& data, std::size_t& offset, std::uint64_t& value)
+        {
+            value = 0;
+            for (unsigned shift{}; shift < 64; shift += 7)
+            {
+                if (offset >= data.size())
+                    return false;
+
+                const unsigned char byte{ data[offset++] };
+                value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+                if (!(byte & 0x80))
+                    return true;
+            }
+
+            return false;
+        }
+
+        // small negative deltas must stay small too
+        std::uint64_t zigzagEncode(std::int64_t value)
+        {
+            return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+        }
+
+        std::int64_t zigzagDecode(std::uint64_t value)
+        {
+            return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+        }
+    }
+
+    PlayQueue::PlayQueue(ObjectPtr<User> user)
+        : _user{ getDboPtr(user) }
+    {
+    }
+
+    PlayQueue::pointer PlayQueue::create(Session& session, ObjectPtr<User> user)
+    {
+        return session.getDboSession().add(std::unique_ptr<PlayQueue> {new PlayQueue{ user }});
+    }
+
+    std::size_t PlayQueue::getCount(Session& session)
+    {
+        session.checkSharedLocked();
+
+        return session.getDboSession().query<int>("SELECT COUNT(*) FROM play_queue");
+    }
+
+    PlayQueue::pointer PlayQueue::find(Session& session, PlayQueueId id)
+    {
+        session.checkSharedLocked();
+
+        return session.getDboSession().find<PlayQueue>().where("id = ?").bind(id).resultValue();
+    }
+
+    PlayQueue::pointer PlayQueue::find(Session& session, UserId userId)
+    {
+        session.checkSharedLocked();
+
+        return session.getDboSession().find<PlayQueue>().where("user_id = ?").bind(userId).resultValue();
+    }
+
+    std::vector<TrackId> PlayQueue::getTrackIds() const
+    {
+        std::vector<TrackId> trackIds;
+
+        std::int64_t previousValue{};
+        std::size_t offset{};
+        while (offset < _trackIds.size())
+        {
+            std::uint64_t delta;
+            if (!readVarInt(_trackIds, offset, delta))
+                return {};
+
+            previousValue += zigzagDecode(delta);
+            if (previousValue < 0)
+                return {};
+
+            trackIds.push_back(TrackId{ previousValue });
+        }
+
+        return trackIds;
+    }
+
+    void PlayQueue::setTrackIds(const std::vector<TrackId>& trackIds)
+    {
+        _trackIds.clear();
+
+        std::int64_t previousValue{};
+        for (const TrackId trackId : trackIds)
+        {
+            const std::int64_t value{ trackId.getValue() };
+            writeVarInt(_trackIds, zigzagEncode(value - previousValue));
+            previousValue = value;
+        }
+    }
+} // namespace Database
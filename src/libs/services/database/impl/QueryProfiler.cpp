@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "services/database/QueryProfiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+namespace Database::QueryProfiler
+{
+    namespace
+    {
+        std::atomic<bool> enabled{ false };
+
+        std::mutex statsMutex;
+        std::unordered_map<std::string, QueryStats> statsByQuery;
+    }
+
+    void setEnabled(bool enable)
+    {
+        enabled = enable;
+    }
+
+    bool isEnabled()
+    {
+        return enabled;
+    }
+
+    void record(std::string_view query, std::chrono::steady_clock::duration duration, std::size_t rowCount)
+    {
+        const auto durationUs{ std::chrono::duration_cast<std::chrono::microseconds>(duration) };
+
+        std::scoped_lock lock{ statsMutex };
+
+        auto itStats{ statsByQuery.find(std::string{ query }) };
+        if (itStats == std::end(statsByQuery))
+        {
+            itStats = statsByQuery.emplace(query, QueryStats{}).first;
+            itStats->second.query = query;
+        }
+
+        QueryStats& stats{ itStats->second };
+        stats.callCount++;
+        stats.rowCount += rowCount;
+        stats.totalDuration += durationUs;
+        stats.maxDuration = std::max(stats.maxDuration, durationUs);
+    }
+
+    void reset()
+    {
+        std::scoped_lock lock{ statsMutex };
+        statsByQuery.clear();
+    }
+
+    std::vector<QueryStats> getStats()
+    {
+        std::vector<QueryStats> res;
+        {
+            std::scoped_lock lock{ statsMutex };
+
+            res.reserve(statsByQuery.size());
+            for (const auto& [query, stats] : statsByQuery)
+                res.push_back(stats);
+        }
+
+        std::sort(std::begin(res), std::end(res), [](const QueryStats& lhs, const QueryStats& rhs) { return lhs.totalDuration > rhs.totalDuration; });
+
+        return res;
+    }
+
+    void dump(std::ostream& os)
+    {
+        const std::vector<QueryStats> stats{ getStats() };
+
+        os << "Query stats (" << stats.size() << " queries):\n";
+        for (const QueryStats& queryStats : stats)
+        {
+            os << "calls = " << queryStats.callCount
+                << ", rows = " << queryStats.rowCount
+                << ", total = " << std::chrono::duration_cast<std::chrono::milliseconds>(queryStats.totalDuration).count() << " ms"
+                << ", mean = " << (queryStats.totalDuration.count() / static_cast<std::chrono::microseconds::rep>(queryStats.callCount)) << " us"
+                << ", max = " << queryStats.maxDuration.count() << " us"
+                << ": " << queryStats.query << "\n";
+        }
+    }
+} // namespace Database::QueryProfiler
@@ -23,10 +23,14 @@
 
 #include "services/database/Artist.hpp"
 #include "services/database/Cluster.hpp"
+#include "services/database/ClusterIndex.hpp"
+#include "services/database/Db.hpp"
+#include "services/database/LibraryCatalog.hpp"
 #include "services/database/Session.hpp"
 #include "services/database/Track.hpp"
 #include "services/database/User.hpp"
 #include "utils/Logger.hpp"
+#include "utils/String.hpp"
 #include "SqlQuery.hpp"
 #include "EnumSetTraits.hpp"
 #include "IdTypeTraits.hpp"
@@ -46,6 +50,7 @@ namespace Database
                 || params.sortMethod == ReleaseSortMethod::OriginalDate
                 || params.sortMethod == ReleaseSortMethod::OriginalDateDesc
                 || params.writtenAfter.isValid()
+                || params.addedAfter.isValid()
                 || params.dateRange
                 || params.artist.isValid()
                 || params.clusters.size() == 1)
@@ -56,14 +61,37 @@ namespace Database
             if (params.writtenAfter.isValid())
                 query.where("t.file_last_write > ?").bind(params.writtenAfter);
 
+            if (params.addedAfter.isValid())
+                query.where("t.file_added > ?").bind(params.addedAfter);
+
+            assert(!params.afterId.isValid() || params.sortMethod == ReleaseSortMethod::Id);
+            if (params.afterId.isValid())
+                query.where("r.id > ?").bind(params.afterId);
+
             if (params.dateRange)
             {
                 query.where("t.date >= ?").bind(params.dateRange->begin);
                 query.where("t.date <= ?").bind(params.dateRange->end);
             }
 
-            for (std::string_view keyword : params.keywords)
-                query.where("r.name LIKE ? ESCAPE '" ESCAPE_CHAR_STR "'").bind("%" + Utils::escapeLikeKeyword(keyword) + "%");
+            if (!params.keywords.empty())
+            {
+                const std::string ftsQuery{ session.getDb().isFullTextSearchEnabled() ? Utils::buildFullTextSearchQuery(params.keywords) : "" };
+                if (!ftsQuery.empty())
+                    query.where("r.id IN (SELECT rowid FROM release_fts WHERE release_fts MATCH ?)").bind(ftsQuery);
+                else
+                {
+                    for (std::string_view keyword : params.keywords)
+                        query.where("r.name LIKE ? ESCAPE '" ESCAPE_CHAR_STR "'").bind("%" + Utils::escapeLikeKeyword(keyword) + "%");
+                }
+            }
+
+            if (!params.ids.empty())
+            {
+                query.where("r.id IN (" + Utils::makePlaceholders(params.ids.size()) + ")");
+                for (const ReleaseId id : params.ids)
+                    query.bind(id);
+            }
 
             if (params.starringUser.isValid())
             {
@@ -130,22 +158,27 @@ namespace Database
             }
             else if (params.clusters.size() > 1)
             {
-                std::ostringstream oss;
-                oss << "r.id IN (SELECT DISTINCT r.id FROM release r"
-                    " INNER JOIN track t ON t.release_id = r.id"
-                    " INNER JOIN track_cluster t_c ON t_c.track_id = t.id";
-
-                WhereClause clusterClause;
-                for (const ClusterId clusterId : params.clusters)
+                if (const auto clusterIndex{ session.getDb().getClusterIndex() })
+                    query.where("r.id IN (" + Utils::makeIdList(clusterIndex->getReleases(params.clusters)) + ")");
+                else
                 {
-                    clusterClause.Or(WhereClause("t_c.cluster_id = ?"));
-                    query.bind(clusterId);
-                }
+                    std::ostringstream oss;
+                    oss << "r.id IN (SELECT DISTINCT r.id FROM release r"
+                        " INNER JOIN track t ON t.release_id = r.id"
+                        " INNER JOIN track_cluster t_c ON t_c.track_id = t.id";
+
+                    WhereClause clusterClause;
+                    for (const ClusterId clusterId : params.clusters)
+                    {
+                        clusterClause.Or(WhereClause("t_c.cluster_id = ?"));
+                        query.bind(clusterId);
+                    }
 
-                oss << " " << clusterClause.get();
-                oss << " GROUP BY t.id HAVING COUNT(*) = " << params.clusters.size() << ")";
+                    oss << " " << clusterClause.get();
+                    oss << " GROUP BY t.id HAVING COUNT(*) = " << params.clusters.size() << ")";
 
-                query.where(oss.str());
+                    query.where(oss.str());
+                }
             }
 
             if (params.primaryType)
@@ -157,8 +190,11 @@ namespace Database
             {
             case ReleaseSortMethod::None:
                 break;
+            case ReleaseSortMethod::Id:
+                query.orderBy("r.id");
+                break;
             case ReleaseSortMethod::Name:
-                query.orderBy("r.name COLLATE NOCASE");
+                query.orderBy("r.sort_key, r.id");
                 break;
             case ReleaseSortMethod::Random:
                 query.orderBy("RANDOM()");
@@ -167,13 +203,13 @@ namespace Database
                 query.orderBy("t.file_last_write DESC");
                 break;
             case ReleaseSortMethod::Date:
-                query.orderBy("t.date, r.name COLLATE NOCASE");
+                query.orderBy("t.date, r.sort_key");
                 break;
             case ReleaseSortMethod::OriginalDate:
-                query.orderBy("CASE WHEN t.original_date IS NULL THEN t.date ELSE t.original_date END, t.date, r.name COLLATE NOCASE");
+                query.orderBy("CASE WHEN t.original_date IS NULL THEN t.date ELSE t.original_date END, t.date, r.sort_key");
                 break;
             case ReleaseSortMethod::OriginalDateDesc:
-                query.orderBy("CASE WHEN t.original_date IS NULL THEN t.date ELSE t.original_date END DESC, t.date, r.name COLLATE NOCASE");
+                query.orderBy("CASE WHEN t.original_date IS NULL THEN t.date ELSE t.original_date END DESC, t.date, r.sort_key");
                 break;
             case ReleaseSortMethod::StarredDateDesc:
                 assert(params.starringUser.isValid());
@@ -198,14 +234,84 @@ namespace Database
 
             return createQuery<ResultType>(session, itemToSelect, params);
         }
+
+        // Returns std::nullopt if the random sampling cannot be used for these parameters
+        std::optional<RangeResults<ReleaseId>> findRandomIds(Session& session, const Release::FindParameters& params)
+        {
+            // no sampling for paginated random results
+            if (params.sortMethod != ReleaseSortMethod::Random || !params.range || params.range->offset != 0)
+                return std::nullopt;
+
+            Release::FindParameters filterParams{ params };
+            filterParams.setSortMethod(ReleaseSortMethod::None);
+            filterParams.setRange(std::nullopt);
+
+            std::optional<std::vector<ReleaseId>> ids{ Utils::sampleRandomIds<ReleaseId>(session.getDboSession(), "release", params.range->size, [&](const std::vector<ReleaseId>& candidates)
+            {
+                auto query{ createQuery<ReleaseId>(session, filterParams) };
+                query.where("r.id IN (" + Utils::makePlaceholders(candidates.size()) + ")");
+                for (const ReleaseId candidate : candidates)
+                    query.bind(candidate);
+
+                auto results{ query.resultList() };
+                return std::vector<ReleaseId>(std::cbegin(results), std::cend(results));
+            }) };
+
+            if (!ids)
+                return std::nullopt;
+
+            RangeResults<ReleaseId> res;
+            res.range = Range{ 0, ids->size() };
+            res.results = std::move(*ids);
+            return res;
+        }
+
+        // Returns std::nullopt if the library catalog is not available or cannot handle these parameters
+        std::optional<RangeResults<ReleaseId>> findCatalogIds(Session& session, const Release::FindParameters& params)
+        {
+            const std::shared_ptr<const LibraryCatalog> catalog{ session.getDb().getLibraryCatalog() };
+            if (!catalog)
+                return std::nullopt;
+
+            return catalog->findReleaseIds(params);
+        }
+
+        constexpr std::size_t idListBatchSize{ 10'000 };
+
+        // whereClause restricts the updated releases, empty to update them all
+        void updateReleaseAggregates(Session& session, const std::string& whereClause)
+        {
+            const std::string releaseArtistType{ std::to_string(static_cast<int>(TrackArtistLinkType::ReleaseArtist)) };
+
+            // dates are stored as ISO8601 text
+            session.getDboSession().execute(
+                "UPDATE release SET"
+                " duration = (SELECT COALESCE(SUM(t.duration), 0) FROM track t WHERE t.release_id = release.id),"
+                " track_count = (SELECT COUNT(t.id) FROM track t WHERE t.release_id = release.id),"
+                " disc_count = (SELECT COUNT(DISTINCT t.disc_number) FROM track t WHERE t.release_id = release.id),"
+                " min_year = (SELECT MIN(CAST(strftime('%Y', t.date) AS INTEGER)) FROM track t WHERE t.release_id = release.id),"
+                " max_year = (SELECT MAX(CAST(strftime('%Y', t.date) AS INTEGER)) FROM track t WHERE t.release_id = release.id),"
+                " has_embedded_cover = EXISTS (SELECT 1 FROM track t WHERE t.release_id = release.id AND t.has_cover),"
+                " artist_sort_key = COALESCE("
+                    "(SELECT MIN(a.sort_key) FROM artist a INNER JOIN track_artist_link t_a_l ON t_a_l.artist_id = a.id INNER JOIN track t ON t.id = t_a_l.track_id WHERE t.release_id = release.id AND t_a_l.type = " + releaseArtistType + "),"
+                    "(SELECT MIN(a.sort_key) FROM artist a INNER JOIN track_artist_link t_a_l ON t_a_l.artist_id = a.id INNER JOIN track t ON t.id = t_a_l.track_id WHERE t.release_id = release.id),"
+                    " '')" + whereClause);
+        }
     }
 
     Release::Release(const std::string& name, const std::optional<UUID>& MBID)
         : _name{ std::string(name, 0 , _maxNameLength) },
+        _sortKey{ StringUtils::computeSortKey(_name) },
         _MBID{ MBID ? MBID->getAsString() : "" }
     {
     }
 
+    void Release::setName(std::string_view name)
+    {
+        _name = name;
+        _sortKey = StringUtils::computeSortKey(_name);
+    }
+
     Release::pointer Release::create(Session& session, const std::string& name, const std::optional<UUID>& MBID)
     {
         return session.getDboSession().add(std::unique_ptr<Release> {new Release{ name, MBID }});
@@ -243,6 +349,14 @@ namespace Database
             .resultValue();
     }
 
+    std::vector<Release::pointer> Release::find(Session& session, const std::vector<ReleaseId>& ids)
+    {
+        session.checkSharedLocked();
+
+        const auto objects{ Utils::findByIds<Release>(session.getDboSession(), ids) };
+        return std::vector<Release::pointer>(std::cbegin(objects), std::cend(objects));
+    }
+
     bool Release::exists(Session& session, ReleaseId id)
     {
         session.checkSharedLocked();
@@ -261,12 +375,10 @@ namespace Database
         session.checkSharedLocked();
 
         // TODO merge with find
-        auto query{ session.getDboSession().query<ReleaseId>(
-                "SELECT DISTINCT r.id FROM release r"
-                " INNER JOIN track t ON r.id = t.release_id"
-                " INNER JOIN track_artist_link t_a_l ON t_a_l.track_id = t.id"
-                " INNER JOIN artist a ON t_a_l.artist_id = a.id")
-             .orderBy("a.name COLLATE NOCASE, r.name COLLATE NOCASE") };
+        // artist_sort_key is maintained by updateAggregates: ordered using the release_artist_sort_key_idx index
+        auto query{ session.getDboSession().query<ReleaseId>("SELECT r.id FROM release r")
+             .where("r.artist_sort_key <> ''")
+             .orderBy("r.artist_sort_key, r.sort_key, r.id") };
 
         return Utils::execQuery<ReleaseId>(query, range);
     }
@@ -279,10 +391,54 @@ namespace Database
         return Utils::execQuery<ReleaseId>(query, range);
     }
 
+    void Release::remove(Session& session, const std::vector<ReleaseId>& releaseIds)
+    {
+        session.checkUniqueLocked();
+
+        if (releaseIds.empty())
+            return;
+
+        auto call{ session.getDboSession().execute("DELETE FROM release WHERE id IN (" + Utils::makePlaceholders(releaseIds.size()) + ")") };
+        for (const ReleaseId releaseId : releaseIds)
+            call.bind(releaseId);
+        call.run();
+    }
+
+    void Release::updateAggregates(Session& session)
+    {
+        session.checkUniqueLocked();
+        updateReleaseAggregates(session, "");
+    }
+
+    void Release::updateAggregates(Session& session, const std::vector<ReleaseId>& releaseIds)
+    {
+        session.checkUniqueLocked();
+
+        Utils::visitIdListBatches(releaseIds, idListBatchSize, [&](const std::string& idList)
+            {
+                updateReleaseAggregates(session, " WHERE release.id IN (" + idList + ")");
+            });
+    }
+
     RangeResults<Release::pointer> Release::find(Session& session, const FindParameters& params)
     {
         session.checkSharedLocked();
 
+        std::optional<RangeResults<ReleaseId>> ids{ findCatalogIds(session, params) };
+        if (!ids)
+            ids = findRandomIds(session, params);
+
+        if (ids)
+        {
+            RangeResults<pointer> res;
+            res.range = ids->range;
+            res.moreResults = ids->moreResults;
+            res.results.reserve(ids->results.size());
+            for (const ReleaseId id : ids->results)
+                res.results.push_back(find(session, id));
+            return res;
+        }
+
         auto query{ createQuery<Wt::Dbo::ptr<Release>>(session, params) };
         return Utils::execQuery<pointer>(query, params.range);
     }
@@ -299,19 +455,14 @@ namespace Database
     {
         session.checkSharedLocked();
 
-        auto query{ createQuery<ReleaseId>(session, params) };
-        return Utils::execQuery<ReleaseId>(query, params.range);
-    }
+        if (std::optional<RangeResults<ReleaseId>> catalogIds{ findCatalogIds(session, params) })
+            return *catalogIds;
 
-    std::size_t Release::getDiscCount() const
-    {
-        assert(session());
-        int res{ session()->query<int>("SELECT COUNT(DISTINCT disc_number) FROM track t")
-            .join("release r ON r.id = t.release_id")
-            .where("r.id = ?")
-            .bind(getId()) };
+        if (std::optional<RangeResults<ReleaseId>> randomIds{ findRandomIds(session, params) })
+            return *randomIds;
 
-        return res;
+        auto query{ createQuery<ReleaseId>(session, params) };
+        return Utils::execQuery<ReleaseId>(query, params.range);
     }
 
     std::vector<DiscInfo> Release::getDiscs() const
@@ -460,23 +611,6 @@ namespace Database
         return getArtists().size() > 1;
     }
 
-    std::size_t Release::getTracksCount() const
-    {
-        return _tracks.size();
-    }
-
-    std::chrono::milliseconds Release::getDuration() const
-    {
-        assert(session());
-
-        using milli = std::chrono::duration<int, std::milli>;
-
-        Wt::Dbo::Query<milli> query{ session()->query<milli>("SELECT COALESCE(SUM(duration), 0) FROM track t INNER JOIN release r ON t.release_id = r.id")
-                .where("r.id = ?").bind(getId()) };
-
-        return query.resultValue();
-    }
-
     Wt::WDateTime Release::getLastWritten() const
     {
         assert(session());
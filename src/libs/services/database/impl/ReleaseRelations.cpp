@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "services/database/ReleaseRelations.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+#include "services/database/Session.hpp"
+
+#include "IdTypeTraits.hpp"
+#include "Utils.hpp"
+
+namespace Database
+{
+    ReleaseRelations::ReleaseRelations(Session& session, const std::vector<ReleaseId>& releaseIds)
+    {
+        session.checkSharedLocked();
+
+        for (const Release::pointer& release : Release::find(session, releaseIds))
+            _releases.emplace(release->getId(), release);
+
+        // keep the bound parameter count well below the SQLite limits
+        constexpr std::size_t batchSize{ 500 };
+        for (std::size_t offset{}; offset < releaseIds.size(); offset += batchSize)
+        {
+            const std::size_t count{ std::min(batchSize, releaseIds.size() - offset) };
+
+            using ResultType = std::tuple<ReleaseId, TrackArtistLinkType, Wt::Dbo::ptr<Artist>>;
+            auto query{ session.getDboSession().query<ResultType>("SELECT DISTINCT t.release_id, t_a_l.type, a FROM artist a"
+                    " INNER JOIN track_artist_link t_a_l ON t_a_l.artist_id = a.id"
+                    " INNER JOIN track t ON t.id = t_a_l.track_id")
+                .where("t.release_id IN (" + Utils::makePlaceholders(count) + ")") };
+            for (std::size_t i{}; i < count; ++i)
+                query.bind(releaseIds[offset + i]);
+
+            for (const auto& [releaseId, linkType, artist] : query.resultList())
+                _releaseArtists[releaseId].push_back(ReleaseArtist{ linkType, artist });
+        }
+    }
+
+    Release::pointer ReleaseRelations::getRelease(ReleaseId releaseId) const
+    {
+        const auto itRelease{ _releases.find(releaseId) };
+        return itRelease != std::cend(_releases) ? itRelease->second : Release::pointer{};
+    }
+
+    std::vector<Artist::pointer> ReleaseRelations::getArtists(ReleaseId releaseId, TrackArtistLinkType linkType) const
+    {
+        std::vector<Artist::pointer> res;
+
+        const auto itArtists{ _releaseArtists.find(releaseId) };
+        if (itArtists == std::cend(_releaseArtists))
+            return res;
+
+        for (const ReleaseArtist& releaseArtist : itArtists->second)
+        {
+            if (releaseArtist.linkType == linkType)
+                res.push_back(releaseArtist.artist);
+        }
+
+        return res;
+    }
+} // namespace Database
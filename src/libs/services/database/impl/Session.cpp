@@ -20,15 +20,22 @@
 #include "services/database/Session.hpp"
 
 #include <cassert>
+#include <ostream>
+#include <type_traits>
 
 #include "utils/Exception.hpp"
 #include "utils/Logger.hpp"
+#include "utils/Metrics.hpp"
+#include "utils/Service.hpp"
+#include "utils/String.hpp"
 
 #include "services/database/Artist.hpp"
 #include "services/database/AuthToken.hpp"
 #include "services/database/Cluster.hpp"
 #include "services/database/Db.hpp"
+#include "services/database/DirectoryFingerprint.hpp"
 #include "services/database/Listen.hpp"
+#include "services/database/PlayQueue.hpp"
 #include "services/database/Release.hpp"
 #include "services/database/ScanSettings.hpp"
 #include "services/database/StarredArtist.hpp"
@@ -39,68 +46,320 @@
 #include "services/database/TrackArtistLink.hpp"
 #include "services/database/TrackList.hpp"
 #include "services/database/TrackFeatures.hpp"
+#include "services/database/TrackMetadataCache.hpp"
 #include "services/database/User.hpp"
 #include "EnumSetTraits.hpp"
 #include "Migration.hpp"
 
 namespace Database
 {
+    namespace
+    {
+        struct FullTextSearchTable
+        {
+            std::string_view table;
+            std::vector<std::string> columns;
+        };
+
+        // External content tables: only the index is stored, triggers keep it in sync with the content table
+        const std::vector<FullTextSearchTable> fullTextSearchTables
+        {
+            { "artist", { "name", "sort_name" } },
+            { "release", { "name" } },
+            { "track", { "name" } },
+        };
+
+        void createFullTextSearchTable(Wt::Dbo::Session& session, const FullTextSearchTable& ftsTable)
+        {
+            const std::string table{ ftsTable.table };
+            const std::string ftsName{ table + "_fts" };
+            const std::string columns{ StringUtils::joinStrings(ftsTable.columns, ", ") };
+            std::string newColumns;
+            std::string oldColumns;
+            std::vector<std::string> changedColumns;
+            for (const std::string& column : ftsTable.columns)
+            {
+                newColumns += ", new." + column;
+                oldColumns += ", old." + column;
+                changedColumns.push_back("old." + column + " IS NOT new." + column);
+            }
+
+            // Missing trigger means either first creation or the content table has been recreated by a migration
+            const bool needRebuild{ session.query<int>("SELECT COUNT(*) FROM sqlite_master WHERE type = 'trigger' AND name = ?").bind(ftsName + "_ai").resultValue() == 0 };
+
+            session.execute("CREATE VIRTUAL TABLE IF NOT EXISTS " + ftsName + " USING fts5(" + columns + ", content='" + table + "', content_rowid='id', tokenize='unicode61 remove_diacritics 2')");
+            session.execute("CREATE TRIGGER IF NOT EXISTS " + ftsName + "_ai AFTER INSERT ON " + table
+                + " BEGIN INSERT INTO " + ftsName + "(rowid, " + columns + ") VALUES (new.id" + newColumns + "); END");
+            session.execute("CREATE TRIGGER IF NOT EXISTS " + ftsName + "_ad AFTER DELETE ON " + table
+                + " BEGIN INSERT INTO " + ftsName + "(" + ftsName + ", rowid, " + columns + ") VALUES ('delete', old.id" + oldColumns + "); END");
+            session.execute("CREATE TRIGGER IF NOT EXISTS " + ftsName + "_au AFTER UPDATE OF " + columns + " ON " + table
+                + " WHEN " + StringUtils::joinStrings(changedColumns, " OR ") // Dbo updates all the fields, do not reindex for nothing
+                + " BEGIN INSERT INTO " + ftsName + "(" + ftsName + ", rowid, " + columns + ") VALUES ('delete', old.id" + oldColumns + ");"
+                + " INSERT INTO " + ftsName + "(rowid, " + columns + ") VALUES (new.id" + newColumns + "); END");
+
+            if (needRebuild)
+            {
+                LMS_LOG(DB, INFO) << "Building full text search index for table '" << table << "'...";
+                session.execute("INSERT INTO " + ftsName + "(" + ftsName + ") VALUES ('rebuild')");
+            }
+        }
+
+        // Per user/backend/track/month count of the listens that have been archived, see Listen::archive
+        // Not a derived table: the archived listens no longer exist
+        void createListenArchiveTable(Wt::Dbo::Session& session)
+        {
+            session.execute("CREATE TABLE IF NOT EXISTS listen_archive (user_id INTEGER NOT NULL, backend INTEGER NOT NULL, track_id INTEGER NOT NULL, month TEXT NOT NULL, count INTEGER NOT NULL, last_date_time,"
+                " PRIMARY KEY (user_id, backend, track_id, month),"
+                " FOREIGN KEY (user_id) REFERENCES user (id) ON DELETE CASCADE,"
+                " FOREIGN KEY (track_id) REFERENCES track (id) ON DELETE CASCADE) WITHOUT ROWID");
+            session.execute("CREATE INDEX IF NOT EXISTS listen_archive_track_idx ON listen_archive(track_id)");
+        }
+
+        // Per user/backend/track listen count and last listen date, kept up to date by triggers (including cascaded deletes)
+        // Counts both the listens and the archived listens
+        void createListenCountTable(Wt::Dbo::Session& session)
+        {
+            bool needRebuild{ session.query<int>("SELECT COUNT(*) FROM sqlite_master WHERE type = 'trigger' AND name = 'listen_count_ai'").resultValue() == 0 };
+
+            // triggers created by older versions ignore the archived listens
+            if (!needRebuild && session.query<int>("SELECT COUNT(*) FROM sqlite_master WHERE type = 'trigger' AND name = 'listen_count_archive_ai'").resultValue() == 0)
+            {
+                session.execute("DROP TRIGGER IF EXISTS listen_count_ai");
+                session.execute("DROP TRIGGER IF EXISTS listen_count_ad");
+                session.execute("DROP TRIGGER IF EXISTS listen_count_au");
+                needRebuild = true;
+            }
+
+            // tables created by older versions lack the last listen date
+            if (session.query<int>("SELECT COUNT(*) FROM sqlite_master WHERE type = 'table' AND name = 'listen_count'").resultValue() == 1
+                && session.query<int>("SELECT COUNT(*) FROM pragma_table_info('listen_count') WHERE name = 'last_date_time'").resultValue() == 0)
+            {
+                session.execute("DROP TRIGGER IF EXISTS listen_count_ai");
+                session.execute("DROP TRIGGER IF EXISTS listen_count_ad");
+                session.execute("DROP TRIGGER IF EXISTS listen_count_au");
+                session.execute("DROP TABLE listen_count");
+                needRebuild = true;
+            }
+
+            // last_date_time has no declared type so that it is stored exactly like listen.date_time
+            session.execute("CREATE TABLE IF NOT EXISTS listen_count (user_id INTEGER NOT NULL, backend INTEGER NOT NULL, track_id INTEGER NOT NULL, count INTEGER NOT NULL, last_date_time,"
+                " PRIMARY KEY (user_id, backend, track_id)) WITHOUT ROWID");
+            session.execute("CREATE INDEX IF NOT EXISTS listen_count_user_backend_count_idx ON listen_count(user_id, backend, count)");
+            session.execute("CREATE INDEX IF NOT EXISTS listen_count_user_backend_last_date_time_idx ON listen_count(user_id, backend, last_date_time)");
+
+            const std::string lastDateTime{ "(SELECT MAX(date_time) FROM ("
+                "SELECT l.date_time AS date_time FROM listen l WHERE l.user_id = old.user_id AND l.track_id = old.track_id AND l.backend = old.backend"
+                " UNION ALL SELECT l_a.last_date_time FROM listen_archive l_a WHERE l_a.user_id = old.user_id AND l_a.track_id = old.track_id AND l_a.backend = old.backend))" };
+            const std::string decrementOld{ "UPDATE listen_count SET count = count - 1,"
+                " last_date_time = " + lastDateTime +
+                " WHERE user_id = old.user_id AND backend = old.backend AND track_id = old.track_id;"
+                " DELETE FROM listen_count WHERE user_id = old.user_id AND backend = old.backend AND track_id = old.track_id AND count <= 0;" };
+            const std::string incrementNew{ "INSERT INTO listen_count (user_id, backend, track_id, count, last_date_time)"
+                " SELECT new.user_id, new.backend, new.track_id, 1, new.date_time WHERE new.user_id IS NOT NULL AND new.track_id IS NOT NULL"
+                " ON CONFLICT (user_id, backend, track_id) DO UPDATE SET count = count + 1, last_date_time = MAX(last_date_time, excluded.last_date_time);" };
+
+            session.execute("CREATE TRIGGER IF NOT EXISTS listen_count_ai AFTER INSERT ON listen"
+                " BEGIN " + incrementNew + " END");
+            session.execute("CREATE TRIGGER IF NOT EXISTS listen_count_ad AFTER DELETE ON listen"
+                " BEGIN " + decrementOld + " END");
+            session.execute("CREATE TRIGGER IF NOT EXISTS listen_count_au AFTER UPDATE OF user_id, backend, track_id, date_time ON listen"
+                " WHEN old.user_id IS NOT new.user_id OR old.backend IS NOT new.backend OR old.track_id IS NOT new.track_id OR old.date_time IS NOT new.date_time"
+                " BEGIN " + decrementOld + " " + incrementNew + " END");
+
+            // archived listens are inserted, merged into existing months or removed by cascade, their keys never change
+            session.execute("CREATE TRIGGER IF NOT EXISTS listen_count_archive_ai AFTER INSERT ON listen_archive"
+                " BEGIN INSERT INTO listen_count (user_id, backend, track_id, count, last_date_time)"
+                " VALUES (new.user_id, new.backend, new.track_id, new.count, new.last_date_time)"
+                " ON CONFLICT (user_id, backend, track_id) DO UPDATE SET count = count + excluded.count, last_date_time = MAX(last_date_time, excluded.last_date_time); END");
+            session.execute("CREATE TRIGGER IF NOT EXISTS listen_count_archive_au AFTER UPDATE OF count, last_date_time ON listen_archive"
+                " BEGIN UPDATE listen_count SET count = count + new.count - old.count, last_date_time = MAX(last_date_time, new.last_date_time)"
+                " WHERE user_id = new.user_id AND backend = new.backend AND track_id = new.track_id; END");
+            session.execute("CREATE TRIGGER IF NOT EXISTS listen_count_archive_ad AFTER DELETE ON listen_archive"
+                " BEGIN UPDATE listen_count SET count = count - old.count,"
+                " last_date_time = " + lastDateTime +
+                " WHERE user_id = old.user_id AND backend = old.backend AND track_id = old.track_id;"
+                " DELETE FROM listen_count WHERE user_id = old.user_id AND backend = old.backend AND track_id = old.track_id AND count <= 0; END");
+
+            if (needRebuild)
+            {
+                LMS_LOG(DB, INFO) << "Computing listen counts...";
+                session.execute("DELETE FROM listen_count");
+                session.execute("INSERT INTO listen_count (user_id, backend, track_id, count, last_date_time)"
+                    " SELECT user_id, backend, track_id, SUM(count), MAX(date_time) FROM ("
+                    "SELECT user_id, backend, track_id, COUNT(*) AS count, MAX(date_time) AS date_time FROM listen WHERE user_id IS NOT NULL AND track_id IS NOT NULL GROUP BY user_id, backend, track_id"
+                    " UNION ALL SELECT user_id, backend, track_id, count, last_date_time FROM listen_archive)"
+                    " GROUP BY user_id, backend, track_id");
+            }
+        }
+
+        // Per tracklist entry count and total duration, kept up to date by triggers (including cascaded deletes and the bulk statements)
+        // Not stored in tracklist so that the triggers cannot be overwritten by stale in memory objects
+        void createTrackListStatsTable(Wt::Dbo::Session& session)
+        {
+            const bool needRebuild{ session.query<int>("SELECT COUNT(*) FROM sqlite_master WHERE type = 'trigger' AND name = 'tracklist_stats_ai'").resultValue() == 0 };
+
+            session.execute("CREATE TABLE IF NOT EXISTS tracklist_stats (tracklist_id INTEGER PRIMARY KEY, entry_count INTEGER NOT NULL, duration INTEGER NOT NULL)");
+
+            const std::string removeOld{ "UPDATE tracklist_stats SET entry_count = entry_count - 1, duration = duration - IFNULL((SELECT t.duration FROM track t WHERE t.id = old.track_id), 0)"
+                " WHERE tracklist_id = old.tracklist_id;" };
+            const std::string addNew{ "INSERT INTO tracklist_stats (tracklist_id, entry_count, duration)"
+                " SELECT new.tracklist_id, 1, IFNULL((SELECT t.duration FROM track t WHERE t.id = new.track_id), 0) WHERE new.tracklist_id IS NOT NULL"
+                " ON CONFLICT (tracklist_id) DO UPDATE SET entry_count = entry_count + 1, duration = duration + excluded.duration;" };
+            const auto shiftTrackDuration{ [](std::string_view newDuration)
+                {
+                    return "UPDATE tracklist_stats SET duration = duration + (" + std::string{ newDuration } + " - old.duration)"
+                        " * (SELECT COUNT(*) FROM tracklist_entry t_l_e WHERE t_l_e.track_id = old.id AND t_l_e.tracklist_id = tracklist_stats.tracklist_id)"
+                        " WHERE tracklist_id IN (SELECT t_l_e.tracklist_id FROM tracklist_entry t_l_e WHERE t_l_e.track_id = old.id);";
+                } };
+
+            session.execute("CREATE TRIGGER IF NOT EXISTS tracklist_stats_ai AFTER INSERT ON tracklist_entry"
+                " BEGIN " + addNew + " END");
+            session.execute("CREATE TRIGGER IF NOT EXISTS tracklist_stats_ad AFTER DELETE ON tracklist_entry"
+                " BEGIN " + removeOld + " END");
+            session.execute("CREATE TRIGGER IF NOT EXISTS tracklist_stats_au AFTER UPDATE OF track_id, tracklist_id ON tracklist_entry"
+                " WHEN old.track_id IS NOT new.track_id OR old.tracklist_id IS NOT new.tracklist_id"
+                " BEGIN " + removeOld + " " + addNew + " END");
+            session.execute("CREATE TRIGGER IF NOT EXISTS tracklist_stats_track_au AFTER UPDATE OF duration ON track"
+                " WHEN old.duration IS NOT new.duration"
+                " BEGIN " + shiftTrackDuration("new.duration") + " END");
+            // the tracks are already gone when their entries are removed by cascade
+            session.execute("CREATE TRIGGER IF NOT EXISTS tracklist_stats_track_bd BEFORE DELETE ON track"
+                " BEGIN " + shiftTrackDuration("0") + " END");
+            session.execute("CREATE TRIGGER IF NOT EXISTS tracklist_stats_tracklist_ad AFTER DELETE ON tracklist"
+                " BEGIN DELETE FROM tracklist_stats WHERE tracklist_id = old.id; END");
+
+            if (needRebuild)
+            {
+                LMS_LOG(DB, INFO) << "Computing tracklist stats...";
+                session.execute("DELETE FROM tracklist_stats");
+                session.execute("INSERT INTO tracklist_stats (tracklist_id, entry_count, duration)"
+                    " SELECT t_l_e.tracklist_id, COUNT(*), IFNULL(SUM(t.duration), 0) FROM tracklist_entry t_l_e LEFT JOIN track t ON t.id = t_l_e.track_id"
+                    " WHERE t_l_e.tracklist_id IS NOT NULL GROUP BY t_l_e.tracklist_id");
+            }
+        }
+    }
+
+    namespace
+    {
+        template <typename Func>
+        void forEachObjectClass(Func func)
+        {
+            func(static_cast<Artist*>(nullptr), "artist");
+            func(static_cast<AuthToken*>(nullptr), "auth_token");
+            func(static_cast<Cluster*>(nullptr), "cluster");
+            func(static_cast<ClusterType*>(nullptr), "cluster_type");
+            func(static_cast<DirectoryFingerprint*>(nullptr), "directory_fingerprint");
+            func(static_cast<Listen*>(nullptr), "listen");
+            func(static_cast<PlayQueue*>(nullptr), "play_queue");
+            func(static_cast<Release*>(nullptr), "release");
+            func(static_cast<ScanSettings*>(nullptr), "scan_settings");
+            func(static_cast<StarredArtist*>(nullptr), "starred_artist");
+            func(static_cast<StarredRelease*>(nullptr), "starred_release");
+            func(static_cast<StarredTrack*>(nullptr), "starred_track");
+            func(static_cast<Track*>(nullptr), "track");
+            func(static_cast<TrackBookmark*>(nullptr), "track_bookmark");
+            func(static_cast<TrackArtistLink*>(nullptr), "track_artist_link");
+            func(static_cast<TrackFeatures*>(nullptr), "track_features");
+            func(static_cast<TrackList*>(nullptr), "tracklist");
+            func(static_cast<TrackMetadataCache*>(nullptr), "track_metadata_cache");
+            func(static_cast<TrackListEntry*>(nullptr), "tracklist_entry");
+            func(static_cast<User*>(nullptr), "user");
+        }
+
+        // objects kept alive by pointers held across transactions would show up here
+        bool exportLoadedObjectCounts()
+        {
+            Metrics::Registry* registry{ Service<Metrics::Registry>::get() };
+            if (!registry)
+                return false;
+
+            registry->addCollector([](std::ostream& os)
+                {
+                    os << "# HELP lms_db_loaded_objects Database objects currently loaded in the sessions\n";
+                    os << "# TYPE lms_db_loaded_objects gauge\n";
+                    forEachObjectClass([&](auto* object, const char* tableName)
+                        {
+                            os << "lms_db_loaded_objects{class=\"" << tableName << "\"} " << getLoadedObjectCounter<std::remove_pointer_t<decltype(object)>>().load(std::memory_order_relaxed) << '\n';
+                        });
+                });
+
+            return true;
+        }
+    }
 
     Session::Session(Db& db)
+        : Session{ db, ConnectionPriority::Interactive }
+    {
+    }
+
+    Session::Session(Db& db, ConnectionPriority priority)
         : _db{ db }
     {
-        _session.setConnectionPool(_db.getConnectionPool());
+        _session.setConnectionPool(_db.getConnectionPool(priority));
 
         _session.mapClass<VersionInfo>("version_info");
-        _session.mapClass<Artist>("artist");
-        _session.mapClass<AuthToken>("auth_token");
-        _session.mapClass<Cluster>("cluster");
-        _session.mapClass<ClusterType>("cluster_type");
-        _session.mapClass<Listen>("listen");
-        _session.mapClass<Release>("release");
-        _session.mapClass<ScanSettings>("scan_settings");
-        _session.mapClass<StarredArtist>("starred_artist");
-        _session.mapClass<StarredRelease>("starred_release");
-        _session.mapClass<StarredTrack>("starred_track");
-        _session.mapClass<Track>("track");
-        _session.mapClass<TrackBookmark>("track_bookmark");
-        _session.mapClass<TrackArtistLink>("track_artist_link");
-        _session.mapClass<TrackFeatures>("track_features");
-        _session.mapClass<TrackList>("tracklist");
-        _session.mapClass<TrackListEntry>("tracklist_entry");
-        _session.mapClass<User>("user");
+        forEachObjectClass([this](auto* object, const char* tableName)
+            {
+                _session.mapClass<std::remove_pointer_t<decltype(object)>>(tableName);
+            });
+
+        static const bool loadedObjectsExported{ exportLoadedObjectCounts() };
+        (void)loadedObjectsExported;
+    }
+
+    UniqueTransaction::UniqueTransaction(std::recursive_mutex& mutex, Wt::Dbo::Session& session, std::size_t& transactionCount, const TransactionProfiler::CallSite& site)
+        : _span{ "db.uniqueTransaction" },
+        _profilerTimer{ TransactionProfiler::TransactionType::Unique, site, transactionCount == 0 },
+        _lock{ mutex },
+        _transaction{ session },
+        _transactionCount{ transactionCount }
+    {
+        ++_transactionCount;
+        _profilerTimer.onStarted();
     }
 
-    UniqueTransaction::UniqueTransaction(RecursiveSharedMutex& mutex, Wt::Dbo::Session& session)
-        : _lock{ mutex },
-        _transaction{ session }
+    UniqueTransaction::~UniqueTransaction()
     {
+        --_transactionCount;
     }
 
-    SharedTransaction::SharedTransaction(RecursiveSharedMutex& mutex, Wt::Dbo::Session& session)
-        : _lock{ mutex },
-        _transaction{ session }
+    SharedTransaction::SharedTransaction(Wt::Dbo::Session& session, std::size_t& transactionCount, const TransactionProfiler::CallSite& site)
+        : _span{ "db.sharedTransaction" },
+        _profilerTimer{ TransactionProfiler::TransactionType::Shared, site, transactionCount == 0 },
+        _transaction{ session },
+        _transactionCount{ transactionCount }
     {
+        ++_transactionCount;
+        _profilerTimer.onStarted();
     }
 
+    SharedTransaction::~SharedTransaction()
+    {
+        --_transactionCount;
+    }
+
+    // Sessions are not shared across threads: counting the transactions of this session is enough
     void Session::checkUniqueLocked()
     {
-        assert(_db.getMutex().isUniqueLocked());
+        assert(_uniqueTransactionCount > 0);
     }
 
     void Session::checkSharedLocked()
     {
-        assert(_db.getMutex().isSharedLocked());
+        assert(_uniqueTransactionCount > 0 || _sharedTransactionCount > 0);
     }
 
-    UniqueTransaction Session::createUniqueTransaction()
+    UniqueTransaction Session::createUniqueTransaction(const TransactionProfiler::CallSite& site)
     {
-        return UniqueTransaction{ _db.getMutex(), _session };
+        // Upgrading a read transaction would write on a possibly outdated snapshot
+        assert(_sharedTransactionCount == 0 || _uniqueTransactionCount > 0);
+        _db._writeTransactionCount++;
+        return UniqueTransaction{ _db.getWriteMutex(), _session, _uniqueTransactionCount, site };
     }
 
-    SharedTransaction Session::createSharedTransaction()
+    SharedTransaction Session::createSharedTransaction(const TransactionProfiler::CallSite& site)
     {
-        return SharedTransaction{ _db.getMutex(), _session };
+        return SharedTransaction{ _session, _sharedTransactionCount, site };
     }
 
     void Session::prepareTables()
@@ -131,15 +390,19 @@ namespace Database
             _session.execute("CREATE INDEX IF NOT EXISTS artist_name_idx ON artist(name)");
             _session.execute("CREATE INDEX IF NOT EXISTS artist_sort_name_nocase_idx ON artist(sort_name COLLATE NOCASE)");
             _session.execute("CREATE INDEX IF NOT EXISTS artist_mbid_idx ON artist(mbid)");
+            _session.execute("CREATE INDEX IF NOT EXISTS artist_sort_key_idx ON artist(sort_key)");
             _session.execute("CREATE INDEX IF NOT EXISTS auth_token_user_idx ON auth_token(user_id)");
             _session.execute("CREATE INDEX IF NOT EXISTS auth_token_expiry_idx ON auth_token(expiry)");
             _session.execute("CREATE INDEX IF NOT EXISTS auth_token_value_idx ON auth_token(value)");
             _session.execute("CREATE INDEX IF NOT EXISTS cluster_name_idx ON cluster(name)");
             _session.execute("CREATE INDEX IF NOT EXISTS cluster_cluster_type_idx ON cluster(cluster_type_id)");
             _session.execute("CREATE INDEX IF NOT EXISTS cluster_type_name_idx ON cluster_type(name)");
+            _session.execute("CREATE INDEX IF NOT EXISTS directory_fingerprint_directory_idx ON directory_fingerprint(directory)");
             _session.execute("CREATE INDEX IF NOT EXISTS release_name_idx ON release(name)");
             _session.execute("CREATE INDEX IF NOT EXISTS release_name_nocase_idx ON release(name COLLATE NOCASE)");
             _session.execute("CREATE INDEX IF NOT EXISTS release_mbid_idx ON release(mbid)");
+            _session.execute("CREATE INDEX IF NOT EXISTS release_sort_key_idx ON release(sort_key)");
+            _session.execute("CREATE INDEX IF NOT EXISTS release_artist_sort_key_idx ON release(artist_sort_key, sort_key)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_path_idx ON track(file_path)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_name_idx ON track(name)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_name_nocase_idx ON track(name COLLATE NOCASE)");
@@ -149,27 +412,61 @@ namespace Database
             _session.execute("CREATE INDEX IF NOT EXISTS track_file_last_write_idx ON track(file_last_write)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_date_idx ON track(date)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_original_date_idx ON track(original_date)");
+            _session.execute("CREATE INDEX IF NOT EXISTS track_audio_properties_pending_idx ON track(id) WHERE audio_properties_pending"); // only holds the tracks yet to be refined
             _session.execute("CREATE INDEX IF NOT EXISTS tracklist_name_idx ON tracklist(name)");
             _session.execute("CREATE INDEX IF NOT EXISTS tracklist_user_idx ON tracklist(user_id)");
+            _session.execute("CREATE INDEX IF NOT EXISTS tracklist_entry_tracklist_idx ON tracklist_entry(tracklist_id, id)"); // entries are ordered by id within a tracklist
+            _session.execute("CREATE INDEX IF NOT EXISTS tracklist_entry_track_idx ON tracklist_entry(track_id)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_features_track_idx ON track_features(track_id)");
+            _session.execute("CREATE INDEX IF NOT EXISTS track_metadata_cache_track_idx ON track_metadata_cache(track_id)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_artist_link_artist_idx ON track_artist_link(artist_id)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_artist_link_track_idx ON track_artist_link(track_id)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_artist_link_type_idx ON track_artist_link(type)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_artist_link_artist_type_idx ON track_artist_link(artist_id,type)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_bookmark_user_idx ON track_bookmark(user_id)");
             _session.execute("CREATE INDEX IF NOT EXISTS track_bookmark_user_track_idx ON track_bookmark(user_id,track_id)");
+            _session.execute("CREATE INDEX IF NOT EXISTS play_queue_user_idx ON play_queue(user_id)");
             _session.execute("CREATE INDEX IF NOT EXISTS listen_backend_idx ON listen(backend)");
             _session.execute("CREATE INDEX IF NOT EXISTS listen_user_backend_idx ON listen(user_id,backend)");
             _session.execute("CREATE INDEX IF NOT EXISTS listen_track_user_backend_idx ON listen(track_id,user_id,backend)");
             _session.execute("CREATE INDEX IF NOT EXISTS listen_user_track_backend_date_time_idx ON listen(user_id,track_id,backend,date_time)");
+            _session.execute("CREATE INDEX IF NOT EXISTS listen_user_backend_date_time_idx ON listen(user_id,backend,date_time)");
+            _session.execute("CREATE INDEX IF NOT EXISTS listen_backend_date_time_idx ON listen(backend,date_time)");
             _session.execute("CREATE INDEX IF NOT EXISTS starred_artist_user_backend_idx ON starred_artist(user_id,backend)");
+            _session.execute("CREATE INDEX IF NOT EXISTS starred_artist_user_backend_date_time_idx ON starred_artist(user_id,backend,date_time)");
             _session.execute("CREATE INDEX IF NOT EXISTS starred_artist_artist_user_backend_idx ON starred_artist(artist_id,user_id,backend)");
             _session.execute("CREATE INDEX IF NOT EXISTS starred_release_user_backend_idx ON starred_release(user_id,backend)");
+            _session.execute("CREATE INDEX IF NOT EXISTS starred_release_user_backend_date_time_idx ON starred_release(user_id,backend,date_time)");
             _session.execute("CREATE INDEX IF NOT EXISTS starred_release_release_user_backend_idx ON starred_release(release_id,user_id,backend)");
             _session.execute("CREATE INDEX IF NOT EXISTS starred_track_user_backend_idx ON starred_track(user_id,backend)");
+            _session.execute("CREATE INDEX IF NOT EXISTS starred_track_user_backend_date_time_idx ON starred_track(user_id,backend,date_time)");
             _session.execute("CREATE INDEX IF NOT EXISTS starred_track_track_user_backend_idx ON starred_track(track_id,user_id,backend)");
         }
 
+        // Derived tables
+        {
+            auto uniqueTransaction{ createUniqueTransaction() };
+            createListenArchiveTable(_session); // read by the listen count triggers
+            createListenCountTable(_session);
+            createTrackListStatsTable(_session);
+        }
+
+        // Full text search indexes, used by keyword searches
+        _db.setFullTextSearchEnabled(false);
+        try
+        {
+            auto uniqueTransaction{ createUniqueTransaction() };
+
+            for (const FullTextSearchTable& ftsTable : fullTextSearchTables)
+                createFullTextSearchTable(_session, ftsTable);
+
+            _db.setFullTextSearchEnabled(true);
+        }
+        catch (Wt::Dbo::Exception& e)
+        {
+            LMS_LOG(DB, WARNING) << "Full text search not available, falling back to slower keyword searches: " << e.what();
+        }
+
         // Initial settings tables
         {
             auto uniqueTransaction{ createUniqueTransaction() };
@@ -178,6 +475,11 @@ namespace Database
         }
     }
 
+    void Session::runBackgroundMigrationTasks()
+    {
+        Migration::runBackgroundTasks(*this);
+    }
+
     void Session::analyze()
     {
         LMS_LOG(DB, INFO) << "Analyzing database...";
@@ -198,4 +500,18 @@ namespace Database
         LMS_LOG(DB, INFO) << "Database optimizing complete";
     }
 
+    void Session::checkpointWal()
+    {
+        // passive: never waits for the readers nor the writer, cannot be run inside a transaction
+        _db.executeSql("PRAGMA wal_checkpoint(PASSIVE)");
+    }
+
+    void Session::incrementalVacuum(std::size_t maxPageCount)
+    {
+        // no-op unless the database was created with auto_vacuum=INCREMENTAL
+        // The transaction only serializes with the other writers, the statement is run on its own connection
+        auto uniqueTransaction{ createUniqueTransaction() };
+        _db.executeSql("PRAGMA incremental_vacuum(" + std::to_string(maxPageCount) + ")");
+    }
+
 } // namespace Database
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+#include <sqlite3.h>
+
+#include "utils/Exception.hpp"
+
+namespace Database
+{
+    // Raw connection, for the maintenance tasks that must not go through the Wt::Dbo connection pool
+    class SqliteConnection
+    {
+    public:
+        SqliteConnection(const std::filesystem::path& path, int flags = SQLITE_OPEN_READONLY)
+        {
+            if (sqlite3_open_v2(path.c_str(), &_db, flags, nullptr) != SQLITE_OK)
+            {
+                const std::string error{ _db ? sqlite3_errmsg(_db) : "out of memory" };
+                sqlite3_close(_db);
+                throw LmsException{ "Cannot open '" + path.string() + "': " + error };
+            }
+        }
+        ~SqliteConnection()
+        {
+            sqlite3_close(_db);
+        }
+
+        SqliteConnection(const SqliteConnection&) = delete;
+        SqliteConnection& operator=(const SqliteConnection&) = delete;
+
+        sqlite3* get() const { return _db; }
+
+    private:
+        sqlite3* _db{};
+    };
+
+    class SqliteStatement
+    {
+    public:
+        SqliteStatement(sqlite3* db, const std::string& sql)
+        {
+            if (sqlite3_prepare_v2(db, sql.c_str(), -1, &_stmt, nullptr) != SQLITE_OK)
+                throw LmsException{ "Cannot prepare '" + sql + "': " + sqlite3_errmsg(db) };
+        }
+        ~SqliteStatement()
+        {
+            sqlite3_finalize(_stmt);
+        }
+
+        SqliteStatement(const SqliteStatement&) = delete;
+        SqliteStatement& operator=(const SqliteStatement&) = delete;
+
+        bool step() { return sqlite3_step(_stmt) == SQLITE_ROW; }
+        std::string getText(int column) const
+        {
+            const unsigned char* text{ sqlite3_column_text(_stmt, column) };
+            return text ? reinterpret_cast<const char*>(text) : "";
+        }
+        long long getInt(int column) const { return sqlite3_column_int64(_stmt, column); }
+
+    private:
+        sqlite3_stmt* _stmt{};
+    };
+} // namespace Database
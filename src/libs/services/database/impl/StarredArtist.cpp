@@ -63,6 +63,12 @@ namespace Database
             .resultValue();
     }
 
+    std::unordered_map<ArtistId, Wt::WDateTime> StarredArtist::getStarredDateTimes(Session& session, UserId userId, FeedbackBackend backend, const std::vector<ArtistId>& artistIds)
+    {
+        session.checkSharedLocked();
+        return Utils::findStarredDateTimes(session.getDboSession(), "starred_artist", "artist_id", userId, backend, artistIds);
+    }
+
     void StarredArtist::setDateTime(const Wt::WDateTime& dateTime)
     {
         _dateTime = Utils::normalizeDateTime(dateTime);
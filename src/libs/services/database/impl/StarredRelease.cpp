@@ -63,6 +63,12 @@ namespace Database
             .resultValue();
     }
 
+    std::unordered_map<ReleaseId, Wt::WDateTime> StarredRelease::getStarredDateTimes(Session& session, UserId userId, FeedbackBackend backend, const std::vector<ReleaseId>& releaseIds)
+    {
+        session.checkSharedLocked();
+        return Utils::findStarredDateTimes(session.getDboSession(), "starred_release", "release_id", userId, backend, releaseIds);
+    }
+
     void StarredRelease::setDateTime(const Wt::WDateTime& dateTime)
     {
         _dateTime = Utils::normalizeDateTime(dateTime);
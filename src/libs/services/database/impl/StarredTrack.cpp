@@ -79,6 +79,38 @@ namespace Database
         return Utils::execQuery<StarredTrackId>(query, params.range);
     }
 
+    std::unordered_map<TrackId, Wt::WDateTime> StarredTrack::getStarredDateTimes(Session& session, UserId userId, FeedbackBackend backend, const std::vector<TrackId>& trackIds)
+    {
+        session.checkSharedLocked();
+        return Utils::findStarredDateTimes(session.getDboSession(), "starred_track", "track_id", userId, backend, trackIds);
+    }
+
+    std::unordered_set<TrackId> StarredTrack::findStarredTrackIds(Session& session, UserId userId, FeedbackBackend backend, const std::vector<TrackId>& trackIds)
+    {
+        session.checkSharedLocked();
+
+        std::unordered_set<TrackId> res;
+
+        // keep the bound parameter count well below the SQLite limits
+        constexpr std::size_t batchSize{ 500 };
+        for (std::size_t offset{}; offset < trackIds.size(); offset += batchSize)
+        {
+            const std::size_t count{ std::min(batchSize, trackIds.size() - offset) };
+
+            auto query{ session.getDboSession().query<TrackId>("SELECT track_id FROM starred_track")
+                .where("user_id = ?").bind(userId)
+                .where("backend = ?").bind(backend)
+                .where("track_id IN (" + Utils::makePlaceholders(count) + ")") };
+            for (std::size_t i{}; i < count; ++i)
+                query.bind(trackIds[offset + i]);
+
+            for (const TrackId trackId : query.resultList())
+                res.insert(trackId);
+        }
+
+        return res;
+    }
+
     void StarredTrack::setDateTime(const Wt::WDateTime& dateTime)
     {
         _dateTime = Utils::normalizeDateTime(dateTime);
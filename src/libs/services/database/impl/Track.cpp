@@ -23,6 +23,9 @@
 
 #include "services/database/Artist.hpp"
 #include "services/database/Cluster.hpp"
+#include "services/database/ClusterIndex.hpp"
+#include "services/database/Db.hpp"
+#include "services/database/LibraryCatalog.hpp"
 #include "services/database/Release.hpp"
 #include "services/database/TrackArtistLink.hpp"
 #include "services/database/TrackFeatures.hpp"
@@ -48,15 +51,38 @@ namespace Database
             auto query{ session.getDboSession().query<ResultType>(selectStatement + " " + std::string{ itemToSelect } + " FROM track t") };
 
             assert(params.keywords.empty() || params.name.empty());
-            for (std::string_view keyword : params.keywords)
-                query.where("t.name LIKE ? ESCAPE '" ESCAPE_CHAR_STR "'").bind("%" + Utils::escapeLikeKeyword(keyword) + "%");
+            if (!params.keywords.empty())
+            {
+                const std::string ftsQuery{ session.getDb().isFullTextSearchEnabled() ? Utils::buildFullTextSearchQuery(params.keywords) : "" };
+                if (!ftsQuery.empty())
+                    query.where("t.id IN (SELECT rowid FROM track_fts WHERE track_fts MATCH ?)").bind(ftsQuery);
+                else
+                {
+                    for (std::string_view keyword : params.keywords)
+                        query.where("t.name LIKE ? ESCAPE '" ESCAPE_CHAR_STR "'").bind("%" + Utils::escapeLikeKeyword(keyword) + "%");
+                }
+            }
+
+            if (!params.ids.empty())
+            {
+                query.where("t.id IN (" + Utils::makePlaceholders(params.ids.size()) + ")");
+                for (const TrackId id : params.ids)
+                    query.bind(id);
+            }
 
             if (!params.name.empty())
                 query.where("t.name = ?").bind(params.name);
 
+            assert(!params.afterId.isValid() || params.sortMethod == TrackSortMethod::Id);
+            if (params.afterId.isValid())
+                query.where("t.id > ?").bind(params.afterId);
+
             if (params.writtenAfter.isValid())
                 query.where("t.file_last_write > ?").bind(params.writtenAfter);
 
+            if (params.addedAfter.isValid())
+                query.where("t.file_added > ?").bind(params.addedAfter);
+
             if (params.starringUser.isValid())
             {
                 assert(params.feedbackBackend);
@@ -74,21 +100,26 @@ namespace Database
             }
             else if (params.clusters.size() > 1)
             {
-                std::ostringstream oss;
-                oss << "t.id IN (SELECT DISTINCT t.id FROM track t"
-                    " INNER JOIN track_cluster t_c ON t_c.track_id = t.id";
-
-                WhereClause clusterClause;
-                for (const ClusterId clusterId : params.clusters)
+                if (const auto clusterIndex{ session.getDb().getClusterIndex() })
+                    query.where("t.id IN (" + Utils::makeIdList(clusterIndex->getTracks(params.clusters)) + ")");
+                else
                 {
-                    clusterClause.Or(WhereClause("t_c.cluster_id = ?"));
-                    query.bind(clusterId);
-                }
+                    std::ostringstream oss;
+                    oss << "t.id IN (SELECT DISTINCT t.id FROM track t"
+                        " INNER JOIN track_cluster t_c ON t_c.track_id = t.id";
 
-                oss << " " << clusterClause.get();
-                oss << " GROUP BY t.id HAVING COUNT(*) = " << params.clusters.size() << ")";
+                    WhereClause clusterClause;
+                    for (const ClusterId clusterId : params.clusters)
+                    {
+                        clusterClause.Or(WhereClause("t_c.cluster_id = ?"));
+                        query.bind(clusterId);
+                    }
 
-                query.where(oss.str());
+                    oss << " " << clusterClause.get();
+                    oss << " GROUP BY t.id HAVING COUNT(*) = " << params.clusters.size() << ")";
+
+                    query.where(oss.str());
+                }
             }
 
             if (params.artist.isValid() || !params.artistName.empty())
@@ -144,6 +175,9 @@ namespace Database
             {
             case TrackSortMethod::None:
                 break;
+            case TrackSortMethod::Id:
+                query.orderBy("t.id");
+                break;
             case TrackSortMethod::LastWritten:
                 query.orderBy("t.file_last_write DESC");
                 break;
@@ -185,6 +219,74 @@ namespace Database
 
             return createQuery<ResultType>(session, itemToSelect, params);
         }
+
+        // Returns std::nullopt if the random sampling cannot be used for these parameters
+        std::optional<RangeResults<TrackId>> findRandomIds(Session& session, const Track::FindParameters& params)
+        {
+            // no sampling for paginated random results
+            if (params.sortMethod != TrackSortMethod::Random || !params.range || params.range->offset != 0)
+                return std::nullopt;
+
+            Track::FindParameters filterParams{ params };
+            filterParams.setSortMethod(TrackSortMethod::None);
+            filterParams.setRange(std::nullopt);
+
+            std::optional<std::vector<TrackId>> ids{ Utils::sampleRandomIds<TrackId>(session.getDboSession(), "track", params.range->size, [&](const std::vector<TrackId>& candidates)
+            {
+                auto query{ createQuery<TrackId>(session, filterParams) };
+                query.where("t.id IN (" + Utils::makePlaceholders(candidates.size()) + ")");
+                for (const TrackId candidate : candidates)
+                    query.bind(candidate);
+
+                auto results{ query.resultList() };
+                return std::vector<TrackId>(std::cbegin(results), std::cend(results));
+            }) };
+
+            if (!ids)
+                return std::nullopt;
+
+            RangeResults<TrackId> res;
+            res.range = Range{ 0, ids->size() };
+            res.results = std::move(*ids);
+            return res;
+        }
+
+        // Range condition rather than LIKE, so that the path index can be used
+        template <typename ResultType>
+        void addPathScope(Wt::Dbo::Query<ResultType>& query, const std::filesystem::path& scope)
+        {
+            const std::string file{ scope.string() };
+            const std::string directoryBegin{ file + "/" };
+            const std::string directoryEnd{ file + static_cast<char>('/' + 1) };
+
+            query.where("(t.file_path = ? OR (t.file_path >= ? AND t.file_path < ?))").bind(file).bind(directoryBegin).bind(directoryEnd);
+        }
+
+        RangeResults<Track::PathResult> toPathResults(RangeResults<std::tuple<TrackId, std::string>>&& queryResults)
+        {
+            RangeResults<Track::PathResult> res;
+            res.range = queryResults.range;
+            res.moreResults = queryResults.moreResults;
+            res.results.reserve(queryResults.results.size());
+
+            std::transform(std::begin(queryResults.results), std::end(queryResults.results), std::back_inserter(res.results),
+                [](std::tuple<TrackId, std::string>& queryResult)
+                {
+                    return Track::PathResult{ std::get<TrackId>(queryResult), std::move(std::get<std::string>(queryResult)) };
+                });
+
+            return res;
+        }
+
+        // Returns std::nullopt if the library catalog is not available or cannot handle these parameters
+        std::optional<RangeResults<TrackId>> findCatalogIds(Session& session, const Track::FindParameters& params)
+        {
+            const std::shared_ptr<const LibraryCatalog> catalog{ session.getDb().getLibraryCatalog() };
+            if (!catalog)
+                return std::nullopt;
+
+            return catalog->findTrackIds(params);
+        }
     }
 
     Track::Track(const std::filesystem::path& p)
@@ -221,6 +323,14 @@ namespace Database
             .resultValue();
     }
 
+    std::vector<Track::pointer> Track::find(Session& session, const std::vector<TrackId>& ids)
+    {
+        session.checkSharedLocked();
+
+        const auto objects{ Utils::findByIds<Track>(session.getDboSession(), ids) };
+        return std::vector<Track::pointer>(std::cbegin(objects), std::cend(objects));
+    }
+
     bool Track::exists(Session& session, TrackId id)
     {
         session.checkSharedLocked();
@@ -250,6 +360,30 @@ namespace Database
         return std::vector<Track::pointer>(res.begin(), res.end());
     }
 
+    std::unordered_map<std::string, std::vector<TrackId>> Track::findIdsByRecordingMBIDs(Session& session, const std::vector<UUID>& MBIDs)
+    {
+        session.checkSharedLocked();
+
+        std::unordered_map<std::string, std::vector<TrackId>> res;
+
+        // keep the bound parameter count well below the SQLite limits
+        constexpr std::size_t batchSize{ 500 };
+        for (std::size_t offset{}; offset < MBIDs.size(); offset += batchSize)
+        {
+            const std::size_t count{ std::min(batchSize, MBIDs.size() - offset) };
+
+            auto query{ session.getDboSession().query<std::tuple<std::string, TrackId>>("SELECT recording_mbid, id FROM track")
+                .where("recording_mbid IN (" + Utils::makePlaceholders(count) + ")") };
+            for (std::size_t i{}; i < count; ++i)
+                query.bind(std::string{ MBIDs[offset + i].getAsString() });
+
+            for (const auto& [MBID, trackId] : query.resultList())
+                res[MBID].push_back(trackId);
+        }
+
+        return res;
+    }
+
     RangeResults<Track::PathResult> Track::findPaths(Session& session, std::optional<Range> range)
     {
         using QueryResultType = std::tuple<TrackId, std::string>;
@@ -258,30 +392,94 @@ namespace Database
         // TODO Dbo traits on filesystem
         auto query{ session.getDboSession().query<QueryResultType>("SELECT id, file_path FROM track") };
 
-        RangeResults<QueryResultType> queryResults{ Utils::execQuery<QueryResultType>(query, range) };
+        return toPathResults(Utils::execQuery<QueryResultType>(query, range));
+    }
 
-        RangeResults<PathResult> res;
-        res.range = queryResults.range;
-        res.moreResults = queryResults.moreResults;
-        res.results.reserve(queryResults.results.size());
+    RangeResults<Track::PathResult> Track::findPaths(Session& session, const std::filesystem::path& scope, std::optional<Range> range)
+    {
+        using QueryResultType = std::tuple<TrackId, std::string>;
+        session.checkSharedLocked();
 
-        std::transform(std::cbegin(queryResults.results), std::cend(queryResults.results), std::back_inserter(res.results),
-            [](const QueryResultType& queryResult)
+        auto query{ session.getDboSession().query<QueryResultType>("SELECT t.id, t.file_path FROM track t") };
+        addPathScope(query, scope);
+        query.orderBy("t.file_path");
+
+        return toPathResults(Utils::execQuery<QueryResultType>(query, range));
+    }
+
+    RangeResults<ReleaseId> Track::findReleaseIds(Session& session, const std::filesystem::path& scope, std::optional<Range> range)
+    {
+        session.checkSharedLocked();
+
+        auto query{ session.getDboSession().query<ReleaseId>("SELECT DISTINCT t.release_id FROM track t")
+            .where("t.release_id IS NOT NULL") };
+        addPathScope(query, scope);
+
+        return Utils::execQuery<ReleaseId>(query, range);
+    }
+
+    RangeResults<ClusterId> Track::findClusterIds(Session& session, const std::filesystem::path& scope, std::optional<Range> range)
+    {
+        session.checkSharedLocked();
+
+        auto query{ session.getDboSession().query<ClusterId>("SELECT DISTINCT t_c.cluster_id FROM track_cluster t_c INNER JOIN track t ON t.id = t_c.track_id") };
+        addPathScope(query, scope);
+
+        return Utils::execQuery<ClusterId>(query, range);
+    }
+
+    void Track::findFileInfos(Session& session, std::function<void(const FileInfoResult&)> func)
+    {
+        using QueryResultType = std::tuple<TrackId, std::string, Wt::WDateTime, int, long long, long long, Wt::WDateTime>;
+        session.checkSharedLocked();
+
+        auto query{ session.getDboSession().query<QueryResultType>("SELECT id, file_path, file_last_write, scan_version, file_size, content_fingerprint, file_added FROM track") };
+
+        Utils::execQuery<QueryResultType>(query, std::nullopt, [&](const QueryResultType& queryResult)
             {
-                return PathResult{ std::get<TrackId>(queryResult), std::move(std::get<std::string>(queryResult)) };
+                func(FileInfoResult{
+                    std::get<0>(queryResult),
+                    std::get<1>(queryResult),
+                    std::get<2>(queryResult),
+                    static_cast<std::size_t>(std::get<3>(queryResult)),
+                    static_cast<std::size_t>(std::get<4>(queryResult)),
+                    static_cast<std::uint64_t>(std::get<5>(queryResult)),
+                    std::get<6>(queryResult) });
             });
+    }
 
-        return res;
+    void Track::remove(Session& session, const std::vector<TrackId>& trackIds)
+    {
+        session.checkUniqueLocked();
+
+        if (trackIds.empty())
+            return;
+
+        auto call{ session.getDboSession().execute("DELETE FROM track WHERE id IN (" + Utils::makePlaceholders(trackIds.size()) + ")") };
+        for (const TrackId trackId : trackIds)
+            call.bind(trackId);
+        call.run();
     }
 
-    RangeResults<TrackId> Track::findIdsTrackMBIDDuplicates(Session& session, std::optional<Range> range)
+    RangeResults<Track::TrackMBIDDuplicateResult> Track::findTrackMBIDDuplicates(Session& session, std::optional<Range> range)
     {
+        using QueryResultType = std::tuple<TrackId, std::string, std::string, std::string>;
         session.checkSharedLocked();
 
-        auto query{ session.getDboSession().query<TrackId>("SELECT track.id FROM track WHERE mbid in (SELECT mbid FROM track WHERE mbid <> '' GROUP BY mbid HAVING COUNT (*) > 1)")
+        auto query{ session.getDboSession().query<QueryResultType>("SELECT track.id, track.mbid, track.file_path, track.name FROM track WHERE mbid in (SELECT mbid FROM track WHERE mbid <> '' GROUP BY mbid HAVING COUNT (*) > 1)")
             .orderBy("track.release_id,track.disc_number,track.track_number,track.mbid") };
 
-        return Utils::execQuery<TrackId>(query, range);
+        RangeResults<QueryResultType> queryResults{ Utils::execQuery<QueryResultType>(query, range) };
+
+        RangeResults<TrackMBIDDuplicateResult> res;
+        res.range = queryResults.range;
+        res.moreResults = queryResults.moreResults;
+        res.results.reserve(queryResults.results.size());
+
+        for (QueryResultType& queryResult : queryResults.results)
+            res.results.push_back(TrackMBIDDuplicateResult{ std::get<0>(queryResult), std::move(std::get<1>(queryResult)), std::move(std::get<2>(queryResult)), std::move(std::get<3>(queryResult)) });
+
+        return res;
     }
 
     RangeResults<TrackId> Track::findIdsWithRecordingMBIDAndMissingFeatures(Session& session, std::optional<Range> range)
@@ -295,6 +493,39 @@ namespace Database
         return Utils::execQuery<TrackId>(query, range);
     }
 
+    RangeResults<TrackId> Track::findIdsWithMissingFeatures(Session& session, std::optional<Range> range)
+    {
+        session.checkSharedLocked();
+
+        auto query{ session.getDboSession().query<TrackId>("SELECT t.id FROM track t")
+            .where("NOT EXISTS (SELECT * FROM track_features t_f WHERE t_f.track_id = t.id)")
+            .orderBy("t.id") };
+
+        return Utils::execQuery<TrackId>(query, range);
+    }
+
+    RangeResults<TrackId> Track::findIdsWithPendingAudioProperties(Session& session, std::optional<Range> range)
+    {
+        session.checkSharedLocked();
+
+        auto query{ session.getDboSession().query<TrackId>("SELECT t.id FROM track t")
+            .where("t.audio_properties_pending")
+            .orderBy("t.id") };
+
+        return Utils::execQuery<TrackId>(query, range);
+    }
+
+    RangeResults<TrackId> Track::findIdsWithMinDuration(Session& session, std::chrono::milliseconds minDuration, std::optional<Range> range)
+    {
+        session.checkSharedLocked();
+
+        auto query{ session.getDboSession().query<TrackId>("SELECT t.id FROM track t")
+            .where("t.duration >= ?").bind(std::chrono::duration_cast<std::chrono::duration<int, std::milli>>(minDuration))
+            .orderBy("t.id") };
+
+        return Utils::execQuery<TrackId>(query, range);
+    }
+
     std::vector<Cluster::pointer> Track::getClusters() const
     {
         return std::vector<Cluster::pointer>(_clusters.begin(), _clusters.end());
@@ -316,6 +547,12 @@ namespace Database
     {
         session.checkSharedLocked();
 
+        if (std::optional<RangeResults<TrackId>> catalogIds{ findCatalogIds(session, parameters) })
+            return *catalogIds;
+
+        if (std::optional<RangeResults<TrackId>> randomIds{ findRandomIds(session, parameters) })
+            return *randomIds;
+
         auto query{ createQuery<TrackId>(session, parameters) };
         return Utils::execQuery<TrackId>(query, parameters.range);
     }
@@ -324,6 +561,21 @@ namespace Database
     {
         session.checkSharedLocked();
 
+        std::optional<RangeResults<TrackId>> ids{ findCatalogIds(session, parameters) };
+        if (!ids)
+            ids = findRandomIds(session, parameters);
+
+        if (ids)
+        {
+            RangeResults<pointer> res;
+            res.range = ids->range;
+            res.moreResults = ids->moreResults;
+            res.results.reserve(ids->results.size());
+            for (const TrackId id : ids->results)
+                res.results.push_back(find(session, id));
+            return res;
+        }
+
         auto query{ createQuery<Wt::Dbo::ptr<Track>>(session, parameters) };
         return Utils::execQuery<Track::pointer>(query, parameters.range);
     }
@@ -19,26 +19,24 @@
 
 #include "services/database/TrackFeatures.hpp"
 
-#include <boost/property_tree/ptree.hpp>
-#include <boost/property_tree/json_parser.hpp>
-
 #include "services/database/Session.hpp"
 #include "services/database/Track.hpp"
 #include "utils/Logger.hpp"
 #include "IdTypeTraits.hpp"
+#include "TrackFeaturesEncoding.hpp"
 #include "Utils.hpp"
 
 namespace Database {
 
-    TrackFeatures::TrackFeatures(ObjectPtr<Track> track, const std::string& jsonEncodedFeatures)
-        : _data{ jsonEncodedFeatures },
+    TrackFeatures::TrackFeatures(ObjectPtr<Track> track, const FeatureValuesMap& featureValuesMap)
+        : _data{ TrackFeaturesEncoding::encode(featureValuesMap) },
         _track{ getDboPtr(track) }
     {
     }
 
-    TrackFeatures::pointer TrackFeatures::create(Session& session, ObjectPtr<Track> track, const std::string& jsonEncodedFeatures)
+    TrackFeatures::pointer TrackFeatures::create(Session& session, ObjectPtr<Track> track, const FeatureValuesMap& featureValuesMap)
     {
-        return session.getDboSession().add(std::unique_ptr<TrackFeatures> {new TrackFeatures{ track, jsonEncodedFeatures }});
+        return session.getDboSession().add(std::unique_ptr<TrackFeatures> {new TrackFeatures{ track, featureValuesMap }});
     }
 
     std::size_t TrackFeatures::getCount(Session& session)
@@ -75,6 +73,20 @@ namespace Database {
         return Utils::execQuery<TrackFeaturesId>(query, range);
     }
 
+    RangeResults<TrackId> TrackFeatures::findTrackIds(Session& session, std::optional<Range> range)
+    {
+        session.checkSharedLocked();
+
+        auto query{ session.getDboSession().query<TrackId>("SELECT track_id from track_features") };
+
+        return Utils::execQuery<TrackId>(query, range);
+    }
+
+    std::optional<FeatureValuesMap> TrackFeatures::parseJson(std::string_view json)
+    {
+        return TrackFeaturesEncoding::parseJson(json);
+    }
+
     FeatureValues TrackFeatures::getFeatureValues(const FeatureName& featureNode) const
     {
         FeatureValuesMap featuresValuesMap{ getFeatureValuesMap({featureNode}) };
@@ -83,39 +95,14 @@ namespace Database {
 
     FeatureValuesMap TrackFeatures::getFeatureValuesMap(const std::unordered_set<FeatureName>& featureNames) const
     {
-        FeatureValuesMap res;
-
-        try
-        {
-            std::istringstream iss{ _data };
-            boost::property_tree::ptree root;
-
-            boost::property_tree::read_json(iss, root);
-
-            for (const FeatureName& featureName : featureNames)
-            {
-                FeatureValues& featureValues{ res[featureName] };
-
-                auto node{ root.get_child(featureName) };
-
-                bool hasChildren = false;
-                for (const auto& child : node.get_child(""))
-                {
-                    hasChildren = true;
-                    featureValues.push_back(child.second.get_value<double>());
-                }
-
-                if (!hasChildren)
-                    featureValues.push_back(node.get_value<double>());
-            }
-        }
-        catch (boost::property_tree::ptree_error& error)
+        std::optional<FeatureValuesMap> res{ TrackFeaturesEncoding::decode(_data, featureNames) };
+        if (!res)
         {
-            LMS_LOG(DB, ERROR) << "Track " << _track.id() << ": ptree exception: " << error.what();
-            res.clear();
+            LMS_LOG(DB, ERROR) << "Track " << _track.id() << ": missing or malformed features";
+            return {};
         }
 
-        return res;
+        return std::move(*res);
     }
 
 } // namespace Database
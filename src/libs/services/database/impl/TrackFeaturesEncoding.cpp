@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TrackFeaturesEncoding.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+namespace Database::TrackFeaturesEncoding
+{
+    namespace
+    {
+        // Layout: version, then for each feature: name size (u16), name, value count (u32), values (f32), in host byte order
+        constexpr std::uint8_t formatVersion{ 1 };
+
+        template <typename T>
+        void write(std::vector<unsigned char>& data, T value)
+        {
+            const std::size_t offset{ data.size() };
+            data.resize(offset + sizeof(T));
+            std::memcpy(data.data() + offset, &value, sizeof(T));
+        }
+
+        template <typename T>
+        bool read(const std::vector<unsigned char>& data, std::size_t& offset, T& value)
+        {
+            if (data.size() - offset < sizeof(T))
+                return false;
+
+            std::memcpy(&value, data.data() + offset, sizeof(T));
+            offset += sizeof(T);
+            return true;
+        }
+
+        void parseNode(const boost::property_tree::ptree& node, const std::string& name, FeatureValuesMap& res)
+        {
+            if (node.empty())
+            {
+                if (auto value{ node.get_value_optional<double>() })
+                    res[name] = { *value };
+                return;
+            }
+
+            // arrays are children with empty keys
+            const bool isArray{ std::all_of(std::cbegin(node), std::cend(node), [](const auto& child) { return child.first.empty() && child.second.empty(); }) };
+            if (isArray)
+            {
+                FeatureValues values;
+                values.reserve(node.size());
+                for (const auto& child : node)
+                {
+                    auto value{ child.second.get_value_optional<double>() };
+                    if (!value)
+                        return;
+                    values.push_back(*value);
+                }
+                res[name] = std::move(values);
+                return;
+            }
+
+            for (const auto& [childName, child] : node)
+            {
+                if (!childName.empty())
+                    parseNode(child, name.empty() ? childName : name + "." + childName, res);
+            }
+        }
+    }
+
+    std::vector<unsigned char> encode(const FeatureValuesMap& featureValuesMap)
+    {
+        std::vector<unsigned char> data;
+        write(data, formatVersion);
+
+        for (const auto& [name, values] : featureValuesMap)
+        {
+            if (name.size() > std::numeric_limits<std::uint16_t>::max() || values.size() > std::numeric_limits<std::uint32_t>::max())
+                continue;
+
+            write(data, static_cast<std::uint16_t>(name.size()));
+            data.insert(std::end(data), std::cbegin(name), std::cend(name));
+            write(data, static_cast<std::uint32_t>(values.size()));
+            for (const double value : values)
+                write(data, static_cast<float>(value));
+        }
+
+        return data;
+    }
+
+    std::optional<FeatureValuesMap> decode(const std::vector<unsigned char>& data, const std::unordered_set<FeatureName>& featureNames)
+    {
+        FeatureValuesMap res;
+
+        std::size_t offset{};
+        std::uint8_t version{};
+        if (!read(data, offset, version) || version != formatVersion)
+            return std::nullopt;
+
+        while (offset < data.size())
+        {
+            std::uint16_t nameSize{};
+            if (!read(data, offset, nameSize) || data.size() - offset < nameSize)
+                return std::nullopt;
+
+            FeatureName name(reinterpret_cast<const char*>(data.data() + offset), nameSize);
+            offset += nameSize;
+
+            std::uint32_t valueCount{};
+            if (!read(data, offset, valueCount) || (data.size() - offset) / sizeof(float) < valueCount)
+                return std::nullopt;
+
+            if (featureNames.find(name) == std::cend(featureNames))
+            {
+                offset += valueCount * sizeof(float);
+                continue;
+            }
+
+            FeatureValues& values{ res[std::move(name)] };
+            values.reserve(valueCount);
+            for (std::uint32_t i{}; i < valueCount; ++i)
+            {
+                float value;
+                read(data, offset, value);
+                values.push_back(value);
+            }
+        }
+
+        if (res.size() != featureNames.size())
+            return std::nullopt;
+
+        return res;
+    }
+
+    std::optional<FeatureValuesMap> parseJson(std::string_view json)
+    {
+        try
+        {
+            std::istringstream iss{ std::string{ json } };
+            boost::property_tree::ptree root;
+            boost::property_tree::read_json(iss, root);
+
+            root.erase("metadata");
+
+            FeatureValuesMap res;
+            parseNode(root, "", res);
+            return res;
+        }
+        catch (const boost::property_tree::ptree_error&)
+        {
+            return std::nullopt;
+        }
+    }
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <optional>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "services/database/TrackFeatures.hpp"
+
+// Binary storage of the track features: for each feature, its name and its values as floats
+namespace Database::TrackFeaturesEncoding
+{
+    std::vector<unsigned char> encode(const FeatureValuesMap& featureValuesMap);
+
+    // Returns std::nullopt if a requested feature is missing or if the data is malformed
+    std::optional<FeatureValuesMap> decode(const std::vector<unsigned char>& data, const std::unordered_set<FeatureName>& featureNames);
+
+    // Former JSON storage (AcousticBrainz low level document): only numeric values and numeric arrays are kept, metadata is dropped
+    std::optional<FeatureValuesMap> parseJson(std::string_view json);
+}
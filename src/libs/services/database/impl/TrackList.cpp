@@ -18,7 +18,9 @@
  */
 #include "services/database/TrackList.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <tuple>
 
 #include "utils/Logger.hpp"
 
@@ -35,6 +37,58 @@
 
 namespace Database
 {
+    namespace
+    {
+        template <typename ResultType>
+        Wt::Dbo::Query<ResultType> createQuery(Session& session, std::string_view itemToSelect, const TrackList::FindParameters& params)
+        {
+            auto query{ session.getDboSession().query<ResultType>("SELECT DISTINCT " + std::string{ itemToSelect } + " FROM tracklist t_l") };
+
+            if (params.user.isValid())
+                query.where("t_l.user_id = ?").bind(params.user);
+
+            if (params.type)
+                query.where("t_l.type = ?").bind(*params.type);
+
+            if (!params.clusters.empty())
+            {
+                query.join("tracklist_entry t_l_e ON t_l_e.tracklist_id = t_l.id");
+                query.join("track t ON t.id = t_l_e.track_id");
+
+                std::ostringstream oss;
+                oss << "t.id IN (SELECT DISTINCT t.id FROM track t"
+                    " INNER JOIN track_cluster t_c ON t_c.track_id = t.id"
+                    " INNER JOIN cluster c ON c.id = t_c.cluster_id";
+
+                WhereClause clusterClause;
+                for (const ClusterId clusterId : params.clusters)
+                {
+                    clusterClause.Or(WhereClause("c.id = ?"));
+                    query.bind(clusterId);
+                }
+
+                oss << " " << clusterClause.get();
+                oss << " GROUP BY t.id HAVING COUNT(*) = " << params.clusters.size() << ")";
+
+                query.where(oss.str());
+            }
+
+            switch (params.sortMethod)
+            {
+            case TrackListSortMethod::None:
+                break;
+            case TrackListSortMethod::Name:
+                query.orderBy("t_l.name COLLATE NOCASE");
+                break;
+            case TrackListSortMethod::LastModifiedDesc:
+                query.orderBy("t_l.last_modified_date_time DESC");
+                break;
+            }
+
+            return query;
+        }
+    }
+
     TrackList::TrackList(std::string_view name, TrackListType type, bool isPublic, ObjectPtr<User> user)
         : _name{ name }
         , _type{ type }
@@ -58,7 +112,6 @@ namespace Database
         return session.getDboSession().query<int>("SELECT COUNT(*) FROM tracklist");
     }
 
-
     TrackList::pointer TrackList::find(Session& session, std::string_view name, TrackListType type, UserId userId)
     {
         session.checkSharedLocked();
@@ -74,50 +127,22 @@ namespace Database
     {
         session.checkSharedLocked();
 
-        auto query{ session.getDboSession().query<TrackListId>("SELECT DISTINCT t_l.id FROM tracklist t_l") };
-
-        if (params.user.isValid())
-            query.where("t_l.user_id = ?").bind(params.user);
-
-        if (params.type)
-            query.where("t_l.type = ?").bind(*params.type);
+        auto query{ createQuery<TrackListId>(session, "t_l.id", params) };
+        return Utils::execQuery<TrackListId>(query, params.range);
+    }
 
-        if (!params.clusters.empty())
-        {
-            query.join("tracklist_entry t_l_e ON t_l_e.tracklist_id = t_l.id");
-            query.join("track t ON t.id = t_l_e.track_id");
+    void TrackList::find(Session& session, const FindParameters& params, std::function<void(const pointer&, const Stats&)> func)
+    {
+        session.checkSharedLocked();
 
-            std::ostringstream oss;
-            oss << "t.id IN (SELECT DISTINCT t.id FROM track t"
-                " INNER JOIN track_cluster t_c ON t_c.track_id = t.id"
-                " INNER JOIN cluster c ON c.id = t_c.cluster_id";
+        using QueryResultType = std::tuple<Wt::Dbo::ptr<TrackList>, int, long long>;
+        auto query{ createQuery<QueryResultType>(session, "t_l, IFNULL(t_l_s.entry_count, 0), IFNULL(t_l_s.duration, 0)", params) };
+        query.leftJoin("tracklist_stats t_l_s ON t_l_s.tracklist_id = t_l.id");
 
-            WhereClause clusterClause;
-            for (const ClusterId clusterId : params.clusters)
+        Utils::execQuery<QueryResultType>(query, params.range, [&](const QueryResultType& queryResult)
             {
-                clusterClause.Or(WhereClause("c.id = ?"));
-                query.bind(clusterId);
-            }
-
-            oss << " " << clusterClause.get();
-            oss << " GROUP BY t.id HAVING COUNT(*) = " << params.clusters.size() << ")";
-
-            query.where(oss.str());
-        }
-
-        switch (params.sortMethod)
-        {
-        case TrackListSortMethod::None:
-            break;
-        case TrackListSortMethod::Name:
-            query.orderBy("t_l.name COLLATE NOCASE");
-            break;
-        case TrackListSortMethod::LastModifiedDesc:
-            query.orderBy("t_l.last_modified_date_time DESC");
-            break;
-        }
-
-        return Utils::execQuery<TrackListId>(query, params.range);
+                func(std::get<0>(queryResult), Stats{ static_cast<std::size_t>(std::get<1>(queryResult)), std::chrono::milliseconds{ std::get<2>(queryResult) } });
+            });
     }
 
     TrackList::pointer TrackList::find(Session& session, TrackListId id)
@@ -129,12 +154,25 @@ namespace Database
 
     bool TrackList::isEmpty() const
     {
-        return _entries.empty();
+        return getCount() == 0;
     }
 
     std::size_t TrackList::getCount() const
     {
-        return _entries.size();
+        return getStats().entryCount;
+    }
+
+    TrackList::Stats TrackList::getStats() const
+    {
+        assert(session());
+
+        // primary key lookup, the aggregates make empty tracklists (without stats row) return zeros
+        using QueryResultType = std::tuple<int, long long>;
+        const QueryResultType stats{ session()->query<QueryResultType>("SELECT IFNULL(MAX(entry_count), 0), IFNULL(MAX(duration), 0) FROM tracklist_stats")
+                .where("tracklist_id = ?").bind(getId())
+                .resultValue() };
+
+        return Stats{ static_cast<std::size_t>(std::get<0>(stats)), std::chrono::milliseconds{ std::get<1>(stats) } };
     }
 
     TrackListEntry::pointer TrackList::getEntry(std::size_t pos) const
@@ -163,6 +201,124 @@ namespace Database
         return std::vector<TrackListEntry::pointer>(entries.begin(), entries.end());
     }
 
+    std::vector<std::pair<TrackListEntry::pointer, Track::pointer>> TrackList::getEntriesWithTracks(std::optional<Range> range) const
+    {
+        assert(session());
+
+        using ResultType = std::tuple<Wt::Dbo::ptr<TrackListEntry>, Wt::Dbo::ptr<Track>>;
+        auto query{ session()->query<ResultType>("SELECT t_l_e, t FROM tracklist_entry t_l_e INNER JOIN track t ON t.id = t_l_e.track_id")
+            .where("t_l_e.tracklist_id = ?").bind(getId())
+            .orderBy("t_l_e.id")
+            .limit(range ? static_cast<int>(range->size) : -1)
+            .offset(range ? static_cast<int>(range->offset) : -1) };
+
+        std::vector<std::pair<TrackListEntry::pointer, Track::pointer>> res;
+        for (const auto& [entry, track] : query.resultList())
+            res.emplace_back(entry, track);
+
+        return res;
+    }
+
+    void TrackList::visitEntriesWithTracks(std::size_t pageSize, const std::function<void(const EntriesWithTracksPage&)>& func) const
+    {
+        assert(session());
+        assert(pageSize > 0);
+
+        using ResultType = std::tuple<Wt::Dbo::ptr<TrackListEntry>, Wt::Dbo::ptr<Track>>;
+
+        TrackListEntryId lastEntryId;
+        while (true)
+        {
+            auto query{ session()->query<ResultType>("SELECT t_l_e, t FROM tracklist_entry t_l_e INNER JOIN track t ON t.id = t_l_e.track_id")
+                .where("t_l_e.tracklist_id = ?").bind(getId()) };
+            if (lastEntryId.isValid())
+                query.where("t_l_e.id > ?").bind(lastEntryId);
+            query.orderBy("t_l_e.id")
+                .limit(static_cast<int>(pageSize));
+
+            EntriesWithTracksPage page;
+            page.reserve(pageSize);
+            for (const auto& [entry, track] : query.resultList())
+                page.emplace_back(entry, track);
+
+            if (page.empty())
+                break;
+
+            lastEntryId = page.back().first->getId();
+            func(page);
+
+            if (page.size() < pageSize)
+                break;
+        }
+    }
+
+    void TrackList::addTracks(const std::vector<TrackId>& trackIds)
+    {
+        assert(session());
+
+        // done by the entries otherwise, must be flushed before the raw statements
+        setLastModifiedDateTime(Wt::WDateTime::currentDateTime());
+        session()->flush();
+
+        // keep the bound parameter count (two per track) well below the SQLite limits
+        constexpr std::size_t batchSize{ 400 };
+        for (std::size_t offset{}; offset < trackIds.size(); offset += batchSize)
+        {
+            const std::size_t count{ std::min(batchSize, trackIds.size() - offset) };
+
+            // the position makes the inserted entries (and so their ids) follow the order of the given tracks
+            std::string values;
+            values.reserve(count * 8);
+            for (std::size_t i{}; i < count; ++i)
+                values += (i == 0 ? "(?,?)" : ",(?,?)");
+
+            auto call{ session()->execute("INSERT INTO tracklist_entry (version, date_time, track_id, tracklist_id)"
+                " SELECT 0, NULL, t.id, ? FROM (VALUES " + values + ") v INNER JOIN track t ON t.id = v.column1"
+                " ORDER BY v.column2") };
+            call.bind(getId());
+            for (std::size_t i{}; i < count; ++i)
+            {
+                call.bind(trackIds[offset + i]);
+                call.bind(static_cast<long long>(i));
+            }
+            call.run();
+        }
+    }
+
+    void TrackList::removeEntries(const std::vector<std::size_t>& positions)
+    {
+        assert(session());
+
+        if (positions.empty())
+            return;
+
+        // done by the entries otherwise, must be flushed before the raw statements
+        setLastModifiedDateTime(Wt::WDateTime::currentDateTime());
+        session()->flush();
+
+        // positions are resolved on the tracklist_id index, all at once so that they are not shifted by the removals
+        std::vector<TrackListEntryId> entryIds;
+        constexpr std::size_t batchSize{ 500 };
+        for (std::size_t offset{}; offset < positions.size(); offset += batchSize)
+        {
+            const std::size_t count{ std::min(batchSize, positions.size() - offset) };
+
+            auto query{ session()->query<TrackListEntryId>("SELECT id FROM (SELECT t_l_e.id AS id, ROW_NUMBER() OVER (ORDER BY t_l_e.id) - 1 AS pos FROM tracklist_entry t_l_e WHERE t_l_e.tracklist_id = ?)"
+                " WHERE pos IN (" + Utils::makePlaceholders(count) + ")")
+                .bind(getId()) };
+            for (std::size_t i{}; i < count; ++i)
+                query.bind(static_cast<long long>(positions[offset + i]));
+
+            auto results{ query.resultList() };
+            entryIds.insert(std::end(entryIds), std::begin(results), std::end(results));
+        }
+
+        Utils::visitIdListBatches(entryIds, batchSize, [&](const std::string& idList)
+            {
+                session()->execute("DELETE FROM tracklist_entry WHERE id IN (" + idList + ")");
+            });
+    }
+
     TrackListEntry::pointer TrackList::getEntryByTrackAndDateTime(ObjectPtr<Track> track, const Wt::WDateTime& dateTime) const
     {
         assert(session());
@@ -282,14 +438,7 @@ namespace Database
 
     std::chrono::milliseconds TrackList::getDuration() const
     {
-        assert(session());
-
-        using milli = std::chrono::duration<int, std::milli>;
-
-        Wt::Dbo::Query<milli> query{ session()->query<milli>("SELECT COALESCE(SUM(duration), 0) FROM track t INNER JOIN tracklist_entry p_e ON t.id = p_e.track_id")
-                .where("p_e.tracklist_id = ?").bind(getId()) };
-
-        return query.resultValue();
+        return getStats().duration;
     }
 
     void TrackList::setLastModifiedDateTime(const Wt::WDateTime& dateTime)
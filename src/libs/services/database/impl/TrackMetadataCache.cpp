@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "services/database/TrackMetadataCache.hpp"
+
+#include "services/database/Session.hpp"
+#include "services/database/Track.hpp"
+#include "IdTypeTraits.hpp"
+
+namespace Database
+{
+    TrackMetadataCache::TrackMetadataCache(ObjectPtr<Track> track)
+        : _track{ getDboPtr(track) }
+    {
+    }
+
+    TrackMetadataCache::pointer TrackMetadataCache::create(Session& session, ObjectPtr<Track> track)
+    {
+        return session.getDboSession().add(std::unique_ptr<TrackMetadataCache> {new TrackMetadataCache{ track }});
+    }
+
+    std::size_t TrackMetadataCache::getCount(Session& session)
+    {
+        session.checkSharedLocked();
+
+        return session.getDboSession().query<int>("SELECT COUNT(*) FROM track_metadata_cache");
+    }
+
+    TrackMetadataCache::pointer TrackMetadataCache::find(Session& session, TrackMetadataCacheId id)
+    {
+        session.checkSharedLocked();
+
+        return session.getDboSession().find<TrackMetadataCache>().where("id = ?").bind(id).resultValue();
+    }
+
+    TrackMetadataCache::pointer TrackMetadataCache::find(Session& session, TrackId trackId)
+    {
+        session.checkSharedLocked();
+
+        return session.getDboSession().find<TrackMetadataCache>().where("track_id = ?").bind(trackId).resultValue();
+    }
+} // namespace Database
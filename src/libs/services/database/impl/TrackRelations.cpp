@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "services/database/TrackRelations.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <tuple>
+
+#include "services/database/Session.hpp"
+#include "services/database/Track.hpp"
+
+#include "IdTypeTraits.hpp"
+#include "Utils.hpp"
+
+namespace Database
+{
+    namespace
+    {
+        // keep the bound parameter count well below the SQLite limits
+        constexpr std::size_t batchSize{ 500 };
+
+        template <typename IdType, typename Func>
+        void foreachBatch(const std::vector<IdType>& ids, Func&& func)
+        {
+            for (std::size_t offset{}; offset < ids.size(); offset += batchSize)
+            {
+                const auto itBegin{ std::cbegin(ids) + offset };
+                const auto itEnd{ std::cbegin(ids) + std::min(ids.size(), offset + batchSize) };
+
+                func(std::vector<IdType>(itBegin, itEnd));
+            }
+        }
+
+        template <typename Query, typename IdType>
+        void bindIds(Query& query, const std::vector<IdType>& ids)
+        {
+            for (const IdType id : ids)
+                query.bind(id);
+        }
+    }
+
+    TrackRelations::TrackRelations(Session& session, const std::vector<TrackId>& trackIds)
+    {
+        session.checkSharedLocked();
+
+        _loadedTracks.insert(std::cbegin(trackIds), std::cend(trackIds));
+
+        std::vector<ReleaseId> releaseIds;
+
+        foreachBatch(trackIds, [&](const std::vector<TrackId>& batchTrackIds)
+        {
+            const std::string placeholders{ Utils::makePlaceholders(batchTrackIds.size()) };
+
+            {
+                using ResultType = std::tuple<TrackId, Wt::Dbo::ptr<Release>>;
+                auto query{ session.getDboSession().query<ResultType>("SELECT t.id, r FROM track t INNER JOIN release r ON r.id = t.release_id")
+                    .where("t.id IN (" + placeholders + ")") };
+                bindIds(query, batchTrackIds);
+
+                for (const auto& [trackId, release] : query.resultList())
+                {
+                    _releases.emplace(trackId, release);
+                    releaseIds.push_back(Release::pointer{ release }->getId());
+                }
+            }
+
+            {
+                using ResultType = std::tuple<TrackId, Wt::Dbo::ptr<TrackArtistLink>, Wt::Dbo::ptr<Artist>>;
+                auto query{ session.getDboSession().query<ResultType>("SELECT t_a_l.track_id, t_a_l, a FROM track_artist_link t_a_l INNER JOIN artist a ON a.id = t_a_l.artist_id")
+                    .where("t_a_l.track_id IN (" + placeholders + ")")
+                    .orderBy("t_a_l.id") };
+                bindIds(query, batchTrackIds);
+
+                for (const auto& [trackId, link, artist] : query.resultList())
+                    _artistLinks[trackId].push_back(ArtistLink{ link, artist });
+            }
+        });
+
+        std::sort(std::begin(releaseIds), std::end(releaseIds));
+        releaseIds.erase(std::unique(std::begin(releaseIds), std::end(releaseIds)), std::end(releaseIds));
+
+        foreachBatch(releaseIds, [&](const std::vector<ReleaseId>& batchReleaseIds)
+        {
+            using ResultType = std::tuple<ReleaseId, TrackArtistLinkType, Wt::Dbo::ptr<Artist>>;
+            auto query{ session.getDboSession().query<ResultType>("SELECT DISTINCT t.release_id, t_a_l.type, a FROM artist a"
+                    " INNER JOIN track_artist_link t_a_l ON t_a_l.artist_id = a.id"
+                    " INNER JOIN track t ON t.id = t_a_l.track_id")
+                .where("t.release_id IN (" + Utils::makePlaceholders(batchReleaseIds.size()) + ")") };
+            bindIds(query, batchReleaseIds);
+
+            for (const auto& [releaseId, linkType, artist] : query.resultList())
+                _releaseArtists[releaseId].push_back(ReleaseArtist{ linkType, artist });
+        });
+    }
+
+    TrackRelations::TrackRelations(Session& session, const std::vector<Track::pointer>& tracks)
+        : TrackRelations{ session, [&]
+        {
+            std::vector<TrackId> trackIds;
+            trackIds.reserve(tracks.size());
+            std::transform(std::cbegin(tracks), std::cend(tracks), std::back_inserter(trackIds), [](const Track::pointer& track) { return track->getId(); });
+            return trackIds;
+        }() }
+    {
+    }
+
+    Release::pointer TrackRelations::getRelease(TrackId trackId) const
+    {
+        assert(contains(trackId));
+
+        const auto itRelease{ _releases.find(trackId) };
+        return itRelease != std::cend(_releases) ? itRelease->second : Release::pointer{};
+    }
+
+    std::vector<TrackArtistLink::pointer> TrackRelations::getArtistLinks(TrackId trackId, std::optional<TrackArtistLinkType> linkType) const
+    {
+        assert(contains(trackId));
+
+        std::vector<TrackArtistLink::pointer> res;
+
+        const auto itLinks{ _artistLinks.find(trackId) };
+        if (itLinks == std::cend(_artistLinks))
+            return res;
+
+        for (const ArtistLink& artistLink : itLinks->second)
+        {
+            if (!linkType || artistLink.link->getType() == *linkType)
+                res.push_back(artistLink.link);
+        }
+
+        return res;
+    }
+
+    std::vector<Artist::pointer> TrackRelations::getArtists(TrackId trackId, EnumSet<TrackArtistLinkType> linkTypes) const
+    {
+        assert(contains(trackId));
+
+        std::vector<Artist::pointer> res;
+
+        const auto itLinks{ _artistLinks.find(trackId) };
+        if (itLinks == std::cend(_artistLinks))
+            return res;
+
+        for (const ArtistLink& artistLink : itLinks->second)
+        {
+            if (linkTypes.empty() || linkTypes.contains(artistLink.link->getType()))
+                res.push_back(artistLink.artist);
+        }
+
+        return res;
+    }
+
+    std::vector<Artist::pointer> TrackRelations::getReleaseArtists(ReleaseId releaseId, TrackArtistLinkType linkType) const
+    {
+        std::vector<Artist::pointer> res;
+
+        const auto itArtists{ _releaseArtists.find(releaseId) };
+        if (itArtists == std::cend(_releaseArtists))
+            return res;
+
+        for (const ReleaseArtist& releaseArtist : itArtists->second)
+        {
+            if (releaseArtist.linkType == linkType)
+                res.push_back(releaseArtist.artist);
+        }
+
+        return res;
+    }
+} // namespace Database
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "services/database/TransactionProfiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string_view>
+#include <tuple>
+
+#include "utils/Logger.hpp"
+#include "utils/Metrics.hpp"
+#include "utils/Service.hpp"
+
+namespace Database::TransactionProfiler
+{
+    namespace
+    {
+        struct Entry
+        {
+            SiteStats stats;
+            Metrics::Histogram* waitDurations{};
+            Metrics::Histogram* holdDurations{};
+        };
+
+        using EntryKey = std::tuple<TransactionType, const char*, unsigned>;
+
+        std::atomic<bool> enabled{ false };
+        std::atomic<std::chrono::milliseconds::rep> longWaitThreshold{};
+        std::atomic<std::chrono::milliseconds::rep> longHoldThreshold{};
+
+        std::mutex entriesMutex;
+        std::map<EntryKey, Entry> entries;
+
+        const char* getTypeName(TransactionType type)
+        {
+            switch (type)
+            {
+            case TransactionType::Unique: return "unique";
+            case TransactionType::Shared: return "shared";
+            }
+
+            return "";
+        }
+
+        std::string formatSite(const CallSite& site)
+        {
+            // keep the path relative to the source directory
+            std::string_view file{ site.file };
+            if (const auto pos{ file.rfind("src/") }; pos != std::string_view::npos)
+                file.remove_prefix(pos + 4);
+
+            return std::string{ file } + ":" + std::to_string(site.line);
+        }
+
+        Entry createEntry(TransactionType type, const CallSite& site)
+        {
+            Entry entry;
+            entry.stats.type = type;
+            entry.stats.site = formatSite(site);
+
+            if (Metrics::Registry* registry{ Service<Metrics::Registry>::get() })
+            {
+                const Metrics::Registry::Labels labels{ {"type", getTypeName(type)}, {"site", entry.stats.site} };
+                entry.waitDurations = &registry->getHistogram("lms_db_transaction_wait_seconds", "Time spent waiting to start a database transaction", { 0.0001, 0.001, 0.01, 0.1, 1, 10 }, labels);
+                entry.holdDurations = &registry->getHistogram("lms_db_transaction_hold_seconds", "Time database transactions are held, commit included", { 0.0001, 0.001, 0.01, 0.1, 1, 10 }, labels);
+            }
+
+            return entry;
+        }
+
+        bool exceedsThreshold(std::chrono::microseconds duration, const std::atomic<std::chrono::milliseconds::rep>& threshold)
+        {
+            const std::chrono::milliseconds thresholdMs{ threshold.load(std::memory_order_relaxed) };
+            return thresholdMs.count() > 0 && duration >= thresholdMs;
+        }
+    }
+
+    void setParameters(const Parameters& parameters)
+    {
+        longWaitThreshold = parameters.longWaitThreshold.count();
+        longHoldThreshold = parameters.longHoldThreshold.count();
+        enabled = parameters.enabled;
+    }
+
+    bool isEnabled()
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    void record(TransactionType type, const CallSite& site, std::chrono::steady_clock::duration wait, std::chrono::steady_clock::duration hold)
+    {
+        const auto waitUs{ std::chrono::duration_cast<std::chrono::microseconds>(wait) };
+        const auto holdUs{ std::chrono::duration_cast<std::chrono::microseconds>(hold) };
+
+        Metrics::Histogram* waitDurations{};
+        Metrics::Histogram* holdDurations{};
+        {
+            std::scoped_lock lock{ entriesMutex };
+
+            auto itEntry{ entries.find(EntryKey{ type, site.file, site.line }) };
+            if (itEntry == std::end(entries))
+                itEntry = entries.emplace(EntryKey{ type, site.file, site.line }, createEntry(type, site)).first;
+
+            Entry& entry{ itEntry->second };
+            entry.stats.count++;
+            entry.stats.totalWait += waitUs;
+            entry.stats.maxWait = std::max(entry.stats.maxWait, waitUs);
+            entry.stats.totalHold += holdUs;
+            entry.stats.maxHold = std::max(entry.stats.maxHold, holdUs);
+
+            waitDurations = entry.waitDurations;
+            holdDurations = entry.holdDurations;
+        }
+
+        if (waitDurations)
+            waitDurations->observe(std::chrono::duration<double>{ wait }.count());
+        if (holdDurations)
+            holdDurations->observe(std::chrono::duration<double>{ hold }.count());
+
+        if (exceedsThreshold(waitUs, longWaitThreshold) || exceedsThreshold(holdUs, longHoldThreshold))
+        {
+            LMS_LOG(DB, WARNING) << "Long " << getTypeName(type) << " transaction from " << formatSite(site)
+                << ": waited " << std::chrono::duration_cast<std::chrono::milliseconds>(waitUs).count() << " ms"
+                << ", held " << std::chrono::duration_cast<std::chrono::milliseconds>(holdUs).count() << " ms";
+        }
+    }
+
+    void reset()
+    {
+        // the histograms are kept, as they live as long as the registry
+        std::scoped_lock lock{ entriesMutex };
+        for (auto& [key, entry] : entries)
+        {
+            const SiteStats resetStats{ entry.stats.type, entry.stats.site };
+            entry.stats = resetStats;
+        }
+    }
+
+    std::vector<SiteStats> getStats()
+    {
+        std::vector<SiteStats> res;
+        {
+            std::scoped_lock lock{ entriesMutex };
+
+            res.reserve(entries.size());
+            for (const auto& [key, entry] : entries)
+            {
+                if (entry.stats.count > 0)
+                    res.push_back(entry.stats);
+            }
+        }
+
+        std::sort(std::begin(res), std::end(res), [](const SiteStats& lhs, const SiteStats& rhs) { return lhs.totalHold > rhs.totalHold; });
+
+        return res;
+    }
+
+    void dump(std::ostream& os)
+    {
+        const std::vector<SiteStats> stats{ getStats() };
+
+        os << "Transaction stats (" << stats.size() << " call sites):\n";
+        for (const SiteStats& siteStats : stats)
+        {
+            const auto count{ static_cast<std::chrono::microseconds::rep>(siteStats.count) };
+
+            os << getTypeName(siteStats.type)
+                << ", count = " << siteStats.count
+                << ", total hold = " << std::chrono::duration_cast<std::chrono::milliseconds>(siteStats.totalHold).count() << " ms"
+                << ", mean hold = " << (siteStats.totalHold.count() / count) << " us"
+                << ", max hold = " << siteStats.maxHold.count() << " us"
+                << ", mean wait = " << (siteStats.totalWait.count() / count) << " us"
+                << ", max wait = " << siteStats.maxWait.count() << " us"
+                << ": " << siteStats.site << "\n";
+        }
+    }
+
+    Timer::Timer(TransactionType type, const CallSite& site, bool outermost)
+        : _type{ type }
+        , _site{ site }
+        , _enabled{ outermost && isEnabled() }
+    {
+        if (_enabled)
+            _waitStart = std::chrono::steady_clock::now();
+    }
+
+    Timer::~Timer()
+    {
+        if (_enabled)
+        {
+            const auto now{ std::chrono::steady_clock::now() };
+            record(_type, _site, _holdStart - _waitStart, now - _holdStart);
+        }
+    }
+
+    void Timer::onStarted()
+    {
+        if (_enabled)
+            _holdStart = std::chrono::steady_clock::now();
+    }
+} // namespace Database::TransactionProfiler
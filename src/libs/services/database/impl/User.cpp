@@ -19,6 +19,8 @@
 
 #include "services/database/User.hpp"
 
+#include <atomic>
+
 #include "services/database/Artist.hpp"
 #include "services/database/Release.hpp"
 #include "services/database/Session.hpp"
@@ -30,6 +32,11 @@
 
 namespace Database {
 
+    namespace
+    {
+        std::atomic<std::uint64_t> settingsGeneration{};
+    }
+
     User::User(std::string_view loginName)
         : _loginName{ loginName }
     {
@@ -80,10 +87,33 @@ namespace Database {
             .resultValue();
     }
 
+    std::uint64_t User::getSettingsGeneration()
+    {
+        return settingsGeneration.load();
+    }
+
+    void User::onSettingsChanged()
+    {
+        // done before the changes are committed: snapshots read in the meantime are taken with the previous generation
+        settingsGeneration++;
+    }
+
     void User::setSubsonicDefaultTranscodingOutputBitrate(Bitrate bitrate)
     {
         assert(isAudioBitrateAllowed(bitrate));
         _subsonicDefaultTranscodingOutputBitrate = bitrate;
+        onSettingsChanged();
+    }
+
+    void User::setListenBrainzToken(const std::optional<UUID>& MBID)
+    {
+        std::string token{ MBID ? MBID->getAsString() : "" };
+        if (token == _listenbrainzToken)
+            return;
+
+        // may be another account, listens have to be imported again
+        _listenbrainzToken = std::move(token);
+        _listenbrainzListensSyncedUntil = {};
     }
 
     void User::clearAuthTokens()
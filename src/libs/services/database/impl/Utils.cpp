@@ -19,6 +19,9 @@
 
 #include "Utils.hpp"
 
+#include <algorithm>
+#include <cctype>
+
 #include "utils/String.hpp"
 
 namespace Database::Utils
@@ -29,6 +32,58 @@ namespace Database::Utils
 		return StringUtils::escapeString(keyword, "%_", escapeChar);
 	}
 
+	std::string
+	makePlaceholders(std::size_t count)
+	{
+		std::string placeholders;
+		placeholders.reserve(count * 2);
+
+		for (std::size_t i{}; i < count; ++i)
+			placeholders += (i == 0 ? "?" : ",?");
+
+		return placeholders;
+	}
+
+	std::string
+	makeIdList(const RoaringBitmap& ids)
+	{
+		std::string list;
+		list.reserve(ids.size() * 7);
+
+		ids.visit([&](RoaringBitmap::value_type id)
+		{
+			if (!list.empty())
+				list += ',';
+			list += std::to_string(id);
+		});
+
+		return list;
+	}
+
+	std::string
+	buildFullTextSearchQuery(const std::vector<std::string_view>& keywords, std::string_view column)
+	{
+		std::vector<std::string> phrases;
+		phrases.reserve(keywords.size());
+
+		for (std::string_view keyword : keywords)
+		{
+			// keywords made only of separators produce no token and cannot be searched in the index
+			const bool hasTokenChar{ std::any_of(std::cbegin(keyword), std::cend(keyword), [](unsigned char c) { return c >= 0x80 || std::isalnum(c); }) };
+			if (!hasTokenChar)
+				return {};
+
+			std::string phrase;
+			if (!column.empty())
+				phrase += std::string{ column } + " : ";
+			phrase += "\"" + StringUtils::replaceInString(keyword, "\"", "\"\"") + "\"*";
+
+			phrases.push_back(std::move(phrase));
+		}
+
+		return StringUtils::joinStrings(phrases, " AND ");
+	}
+
 	Wt::WDateTime
 	normalizeDateTime(const Wt::WDateTime& dateTime)
 	{
@@ -19,14 +19,26 @@
 
 #pragma once
 
+#include <algorithm>
+#include <chrono>
 #include <functional>
+#include <optional>
+#include <random>
 #include <string>
 #include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <Wt/Dbo/Dbo.h>
 #include <Wt/WDateTime.h>
 
+#include "services/database/QueryProfiler.hpp"
 #include "services/database/Types.hpp"
+#include "services/database/UserId.hpp"
+#include "utils/Random.hpp"
+#include "utils/RoaringBitmap.hpp"
 
 namespace Database::Utils
 {
@@ -34,6 +46,41 @@ namespace Database::Utils
     static inline constexpr char escapeChar{ '\\' };
     std::string escapeLikeKeyword(std::string_view keywords);
 
+    // "?,?,?" for count values, to be used in IN clauses
+    std::string makePlaceholders(std::size_t count);
+    // "1,2,3": literal ids, to be used in IN clauses too large for bound parameters
+    std::string makeIdList(const RoaringBitmap& ids);
+
+    template <typename IdType>
+    std::string makeIdList(typename std::vector<IdType>::const_iterator begin, typename std::vector<IdType>::const_iterator end)
+    {
+        std::string list;
+        for (auto it{ begin }; it != end; ++it)
+        {
+            if (!list.empty())
+                list += ',';
+            list += std::to_string(it->getValue());
+        }
+
+        return list;
+    }
+
+    // Calls func with literal id lists of at most batchSize ids, to keep the statements reasonably small
+    template <typename IdType, typename Func>
+    void visitIdListBatches(const std::vector<IdType>& ids, std::size_t batchSize, Func func)
+    {
+        for (std::size_t offset{}; offset < ids.size(); offset += batchSize)
+        {
+            const auto begin{ std::cbegin(ids) + offset };
+            const auto end{ std::cbegin(ids) + std::min(ids.size(), offset + batchSize) };
+            func(makeIdList<IdType>(begin, end));
+        }
+    }
+
+    // Prefix match on all the keywords, optionally restricted to a column of the full text search table
+    // Returns an empty string if some keywords cannot be handled by the full text search index
+    std::string buildFullTextSearchQuery(const std::vector<std::string_view>& keywords, std::string_view column = {});
+
     template <typename Query>
     void applyRange(Query& query, std::optional<Range> range)
     {
@@ -52,8 +99,14 @@ namespace Database::Utils
         if (range)
             applyRange(query, Range{ range->offset, range->size + 1 });
 
+        const bool profile{ QueryProfiler::isEnabled() };
+        const auto start{ profile ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{} };
+
         auto collection{ query.resultList() };
         res.results.assign(collection.begin(), collection.end());
+
+        if (profile)
+            QueryProfiler::record(query.asString(), std::chrono::steady_clock::now() - start, res.results.size());
         if (range && res.results.size() == static_cast<std::size_t>(range->size) + 1)
         {
             // TODO may optim by not actually requesting the last one
@@ -63,7 +116,7 @@ namespace Database::Utils
         else
             res.moreResults = false;
 
-        res.range.offset = range->offset;
+        res.range.offset = range ? range->offset : 0;
         res.range.size = res.results.size();
 
         return res;
@@ -75,8 +128,143 @@ namespace Database::Utils
         if (range)
             applyRange(query, range);
 
+        const bool profile{ QueryProfiler::isEnabled() };
+        const auto start{ profile ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{} };
+        std::size_t rowCount{};
+
         for (const auto& res : query.resultList())
+        {
             func(res);
+            rowCount++;
+        }
+
+        // includes the time spent in the callbacks
+        if (profile)
+            QueryProfiler::record(query.asString(), std::chrono::steady_clock::now() - start, rowCount);
+    }
+
+    // Starred date times of a set of objects, using one query per batch of ids
+    // Objects that are not starred by the user (or pending removal) are not reported
+    template <typename IdType>
+    std::unordered_map<IdType, Wt::WDateTime> findStarredDateTimes(Wt::Dbo::Session& session, std::string_view starredTable, std::string_view objectColumn, UserId userId, FeedbackBackend backend, const std::vector<IdType>& ids)
+    {
+        std::unordered_map<IdType, Wt::WDateTime> res;
+
+        // keep the bound parameter count well below the SQLite limits
+        constexpr std::size_t batchSize{ 500 };
+        for (std::size_t offset{}; offset < ids.size(); offset += batchSize)
+        {
+            const std::size_t count{ std::min(batchSize, ids.size() - offset) };
+
+            auto query{ session.query<std::tuple<IdType, Wt::WDateTime>>("SELECT " + std::string{ objectColumn } + ", date_time FROM " + std::string{ starredTable })
+                .where("user_id = ?").bind(userId)
+                .where("backend = ?").bind(backend)
+                .where("sync_state <> ?").bind(SyncState::PendingRemove)
+                .where(std::string{ objectColumn } + " IN (" + makePlaceholders(count) + ")") };
+            for (std::size_t i{}; i < count; ++i)
+                query.bind(ids[offset + i]);
+
+            for (const auto& [id, dateTime] : query.resultList())
+                res.emplace(id, dateTime);
+        }
+
+        return res;
+    }
+
+    // Objects of a set of ids, using one query per batch of ids
+    // Unknown ids are not reported, results are not in any particular order
+    template <typename Object, typename IdType>
+    std::vector<Wt::Dbo::ptr<Object>> findByIds(Wt::Dbo::Session& session, const std::vector<IdType>& ids)
+    {
+        std::vector<Wt::Dbo::ptr<Object>> res;
+        res.reserve(ids.size());
+
+        // keep the bound parameter count well below the SQLite limits
+        constexpr std::size_t batchSize{ 500 };
+        for (std::size_t offset{}; offset < ids.size(); offset += batchSize)
+        {
+            const std::size_t count{ std::min(batchSize, ids.size() - offset) };
+
+            auto query{ session.find<Object>().where("id IN (" + makePlaceholders(count) + ")") };
+            for (std::size_t i{}; i < count; ++i)
+                query.bind(ids[offset + i]);
+
+            for (const Wt::Dbo::ptr<Object>& object : query.resultList())
+                res.push_back(object);
+        }
+
+        return res;
+    }
+
+    // Uniform random sample of at most count ids, without "ORDER BY RANDOM()" that reads and sorts the whole filtered table
+    // Candidate ids are drawn in [MIN(id), MAX(id)] of the table and kept if filterIds (that applies the search filters) returns them
+    // Returns std::nullopt if the matching ids are too sparse to be sampled this way: the caller should then fall back to "ORDER BY RANDOM()"
+    template <typename IdType>
+    std::optional<std::vector<IdType>> sampleRandomIds(Wt::Dbo::Session& session, std::string_view table, std::size_t count, std::function<std::vector<IdType>(const std::vector<IdType>&)> filterIds)
+    {
+        using ValueType = typename IdType::ValueType;
+
+        constexpr std::size_t maxRoundCount{ 8 };
+        constexpr std::size_t maxCandidateCountPerRound{ 500 }; // keep the bound parameter count well below the SQLite limits
+
+        std::vector<IdType> res;
+
+        const auto [minId, maxId]{ session.query<std::tuple<ValueType, ValueType>>("SELECT IFNULL(MIN(id), 0), IFNULL(MAX(id), 0) FROM " + std::string{ table }).resultValue() };
+        if (maxId == 0 || count == 0)
+            return res;
+
+        const std::size_t idSpan{ static_cast<std::size_t>(maxId - minId + 1) };
+        std::uniform_int_distribution<ValueType> dist{ minId, maxId };
+        std::unordered_set<ValueType> drawnIds;
+        std::size_t matchCount{};
+
+        for (std::size_t round{}; round < maxRoundCount && res.size() < count && drawnIds.size() < idSpan; ++round)
+        {
+            const std::size_t missingCount{ count - res.size() };
+
+            // first round: assume half of the ids match, then use the observed ratio
+            std::size_t candidateCount{ 2 * missingCount + 8 };
+            if (round > 0)
+            {
+                if (matchCount == 0)
+                    return std::nullopt;
+
+                const double wantedCandidateCount{ static_cast<double>(missingCount) * drawnIds.size() / matchCount * 1.25 };
+                if (wantedCandidateCount > static_cast<double>((maxRoundCount - round) * maxCandidateCountPerRound))
+                    return std::nullopt;
+
+                candidateCount = static_cast<std::size_t>(wantedCandidateCount) + 8;
+            }
+            candidateCount = std::min({ candidateCount, maxCandidateCountPerRound, idSpan - drawnIds.size() });
+
+            std::vector<IdType> candidates;
+            candidates.reserve(candidateCount);
+            while (candidates.size() < candidateCount)
+            {
+                const ValueType id{ dist(Random::getRandGenerator()) };
+                if (drawnIds.insert(id).second)
+                    candidates.emplace_back(id);
+            }
+
+            const std::vector<IdType> matchingIds{ filterIds(candidates) };
+            const std::unordered_set<IdType> matchingIdSet(std::cbegin(matchingIds), std::cend(matchingIds));
+
+            // keep the drawing order, the filtered ids may come back sorted
+            for (const IdType candidate : candidates)
+            {
+                if (matchingIdSet.find(candidate) == std::cend(matchingIdSet))
+                    continue;
+
+                matchCount++;
+                if (res.size() < count)
+                    res.push_back(candidate);
+            }
+        }
+
+        if (res.size() < count && drawnIds.size() < idSpan)
+            return std::nullopt;
+
+        return res;
     }
 
     Wt::WDateTime normalizeDateTime(const Wt::WDateTime& dateTime);
@@ -0,0 +1,291 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "services/database/Warmup.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "services/database/Db.hpp"
+#include "services/database/QueryProfiler.hpp"
+#include "services/database/Session.hpp"
+#include "utils/Exception.hpp"
+#include "utils/Logger.hpp"
+#include "SqliteStatement.hpp"
+
+namespace Database::Warmup
+{
+    namespace
+    {
+        // budgets are checked every few rows
+        constexpr std::size_t rowsPerCheck{ 256 };
+
+        struct SchemaObject
+        {
+            std::string name;
+            std::string tableName;
+        };
+
+        struct Schema
+        {
+            std::vector<SchemaObject> tables; // in schema order
+            std::vector<SchemaObject> indexes;
+        };
+
+        class WarmupConnection
+        {
+        public:
+            WarmupConnection(const std::filesystem::path& path)
+                : _connection{ path }
+            {
+                // the pages only need to go through the OS page cache, see getReadSize
+                sqlite3_exec(get(), "PRAGMA cache_size=256", nullptr, nullptr, nullptr);
+            }
+
+            sqlite3* get() const { return _connection.get(); }
+
+            // bytes read from the database file so far
+            std::size_t getReadSize() const
+            {
+                int current{};
+                int highWater{};
+                sqlite3_db_status(get(), SQLITE_DBSTATUS_CACHE_MISS, &current, &highWater, 0);
+                return static_cast<std::size_t>(current) * _pageSize;
+            }
+
+            void setPageSize(std::size_t pageSize) { _pageSize = pageSize; }
+
+        private:
+            const SqliteConnection _connection;
+            std::size_t _pageSize{ 4096 };
+        };
+
+        std::string quote(std::string_view name)
+        {
+            std::string res{ "\"" };
+            for (char c : name)
+            {
+                if (c == '"')
+                    res += '"';
+                res += c;
+            }
+            res += '"';
+            return res;
+        }
+
+        Schema getSchema(sqlite3* db)
+        {
+            Schema schema;
+
+            // virtual tables (full text search) cannot be scanned this way, their shadow tables are regular ones
+            SqliteStatement statement{ db, "SELECT type, name, tbl_name FROM sqlite_master WHERE type IN ('table', 'index') AND tbl_name NOT LIKE 'sqlite_%' AND (sql IS NULL OR sql NOT LIKE 'CREATE VIRTUAL%')" };
+            while (statement.step())
+            {
+                SchemaObject object{ statement.getText(1), statement.getText(2) };
+                if (statement.getText(0) == "table")
+                    schema.tables.push_back(std::move(object));
+                else
+                    schema.indexes.push_back(std::move(object));
+            }
+
+            return schema;
+        }
+
+        std::vector<std::string> readHotTables(const std::filesystem::path& hotTablesFile)
+        {
+            std::vector<std::string> tables;
+            if (hotTablesFile.empty())
+                return tables;
+
+            std::ifstream file{ hotTablesFile };
+            std::string line;
+            while (std::getline(file, line))
+            {
+                if (!line.empty())
+                    tables.push_back(line);
+            }
+
+            return tables;
+        }
+
+        // indexes first: they are smaller, and used by most lookups
+        std::vector<std::string> getWarmupQueries(const Schema& schema, const std::vector<std::string>& hotTables)
+        {
+            std::vector<std::string> orderedTables;
+            std::unordered_set<std::string> knownTables;
+            for (const SchemaObject& table : schema.tables)
+                knownTables.insert(table.name);
+
+            std::unordered_set<std::string> addedTables;
+            for (const std::string& table : hotTables)
+            {
+                if (knownTables.count(table) && addedTables.insert(table).second)
+                    orderedTables.push_back(table);
+            }
+            for (const SchemaObject& table : schema.tables)
+            {
+                if (addedTables.insert(table.name).second)
+                    orderedTables.push_back(table.name);
+            }
+
+            std::vector<std::string> queries;
+            for (const std::string& table : orderedTables)
+            {
+                for (const SchemaObject& index : schema.indexes)
+                {
+                    if (index.tableName == table)
+                        queries.push_back("SELECT 1 FROM " + quote(table) + " INDEXED BY " + quote(index.name));
+                }
+                queries.push_back("SELECT 1 FROM " + quote(table) + " NOT INDEXED");
+            }
+
+            return queries;
+        }
+
+        bool containsWord(std::string_view text, std::string_view word)
+        {
+            auto isWordChar{ [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; } };
+
+            for (std::size_t pos{ text.find(word) }; pos != std::string_view::npos; pos = text.find(word, pos + 1))
+            {
+                const bool startsWord{ pos == 0 || !isWordChar(text[pos - 1]) };
+                const bool endsWord{ pos + word.size() == text.size() || !isWordChar(text[pos + word.size()]) };
+                if (startsWord && endsWord)
+                    return true;
+            }
+
+            return false;
+        }
+    }
+
+    void run(const Db& db, const Parameters& parameters, const std::atomic<bool>& abort)
+    {
+        const auto startTime{ std::chrono::steady_clock::now() };
+
+        WarmupConnection connection{ db.getPath() };
+        {
+            SqliteStatement statement{ connection.get(), "PRAGMA page_size" };
+            if (statement.step())
+                connection.setPageSize(static_cast<std::size_t>(statement.getInt(0)));
+        }
+
+        const std::vector<std::string> hotTables{ readHotTables(parameters.hotTablesFile) };
+        const std::vector<std::string> queries{ getWarmupQueries(getSchema(connection.get()), hotTables) };
+
+        LMS_LOG(DB, INFO) << "Warming up database: " << queries.size() << " tables and indexes (" << hotTables.size() << " hot tables)";
+
+        bool budgetReached{};
+        for (const std::string& query : queries)
+        {
+            try
+            {
+                SqliteStatement statement{ connection.get(), query }; // partial indexes cannot be used that way
+                for (std::size_t rowCount{ 1 }; statement.step(); ++rowCount)
+                {
+                    if (rowCount % rowsPerCheck != 0)
+                        continue;
+
+                    if (abort)
+                        return;
+
+                    const std::size_t readSize{ connection.getReadSize() };
+                    if (parameters.maxSize > 0 && readSize >= parameters.maxSize)
+                    {
+                        budgetReached = true;
+                        break;
+                    }
+
+                    if (parameters.maxThroughput > 0)
+                        std::this_thread::sleep_until(startTime + std::chrono::microseconds{ readSize * 1'000'000 / parameters.maxThroughput });
+                }
+            }
+            catch (const LmsException& e)
+            {
+                LMS_LOG(DB, DEBUG) << "Skipping warmup query: " << e.what();
+            }
+
+            if (budgetReached)
+                break;
+        }
+
+        const auto duration{ std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime) };
+        LMS_LOG(DB, INFO) << "Database warmup " << (budgetReached ? "stopped at its size budget" : "complete") << ": read " << connection.getReadSize() / 1024 << " KiB in " << duration.count() << "ms";
+    }
+
+    std::vector<std::string> getHotTables(Session& session)
+    {
+        std::vector<std::string> tables;
+        {
+            auto transaction{ session.createSharedTransaction() };
+
+            const auto collection{ session.getDboSession().query<std::string>("SELECT name FROM sqlite_master WHERE type = 'table' AND name NOT LIKE 'sqlite_%'").resultList() };
+            tables.assign(std::cbegin(collection), std::cend(collection));
+        }
+
+        std::unordered_map<std::string, std::size_t> callCounts;
+        for (const QueryProfiler::QueryStats& stats : QueryProfiler::getStats())
+        {
+            std::string query{ stats.query };
+            std::transform(std::begin(query), std::end(query), std::begin(query), [](unsigned char c) { return std::tolower(c); });
+
+            for (const std::string& table : tables)
+            {
+                if (containsWord(query, table))
+                    callCounts[table] += stats.callCount;
+            }
+        }
+
+        tables.erase(std::remove_if(std::begin(tables), std::end(tables), [&](const std::string& table) { return callCounts.find(table) == std::cend(callCounts); }), std::end(tables));
+        std::stable_sort(std::begin(tables), std::end(tables), [&](const std::string& lhs, const std::string& rhs) { return callCounts[lhs] > callCounts[rhs]; });
+
+        return tables;
+    }
+
+    void saveHotTables(Session& session, const std::filesystem::path& hotTablesFile)
+    {
+        const std::vector<std::string> tables{ getHotTables(session) };
+        if (tables.empty())
+            return;
+
+        const std::filesystem::path tmpFile{ hotTablesFile.string() + ".tmp" };
+        {
+            std::ofstream file{ tmpFile, std::ios::out | std::ios::trunc };
+            for (const std::string& table : tables)
+                file << table << '\n';
+
+            if (!file)
+            {
+                LMS_LOG(DB, ERROR) << "Cannot write hot tables in '" << tmpFile.string() << "'";
+                return;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tmpFile, hotTablesFile, ec);
+        if (ec)
+            LMS_LOG(DB, ERROR) << "Cannot save hot tables in '" << hotTablesFile.string() << "': " << ec.message();
+        else
+            LMS_LOG(DB, DEBUG) << "Saved " << tables.size() << " hot tables";
+    }
+} // namespace Database::Warmup
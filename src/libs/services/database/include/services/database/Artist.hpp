@@ -56,10 +56,13 @@ namespace Database
         {
             std::vector<ClusterId>				clusters;	// if non empty, at least one artist that belongs to these clusters
             std::vector<std::string_view>		keywords;	// if non empty, name must match all of these keywords (on either name field OR sort name field)
+            std::vector<ArtistId>				ids;		// if non empty, only artists among these ones
             std::optional<TrackArtistLinkType>	linkType;	// if set, only artists that have produced at least one track with this link type
             ArtistSortMethod					sortMethod{ ArtistSortMethod::None };
             std::optional<Range>				range;
+            ArtistId							afterId;	// keyset pagination: only artists after this one (needs ArtistSortMethod::Id)
             Wt::WDateTime						writtenAfter;
+            Wt::WDateTime						addedAfter;	// only artists involved in tracks (re)scanned after this time
             UserId								starringUser;	// only artists starred by this user
             std::optional<FeedbackBackend>		feedbackBackend; // and for this feedback backend
             TrackId								track;		// artists involved in this track
@@ -67,10 +70,13 @@ namespace Database
 
             FindParameters& setClusters(const std::vector<ClusterId>& _clusters) { clusters = _clusters; return *this; }
             FindParameters& setKeywords(const std::vector<std::string_view>& _keywords) { keywords = _keywords; return *this; }
+            FindParameters& setIds(const std::vector<ArtistId>& _ids) { ids = _ids; return *this; }
             FindParameters& setLinkType(std::optional<TrackArtistLinkType> _linkType) { linkType = _linkType; return *this; }
             FindParameters& setSortMethod(ArtistSortMethod _sortMethod) { sortMethod = _sortMethod; return *this; }
             FindParameters& setRange(std::optional<Range> _range) { range = _range; return *this; }
+            FindParameters& setAfterId(ArtistId _afterId) { afterId = _afterId; return *this; }
             FindParameters& setWrittenAfter(const Wt::WDateTime& _after) { writtenAfter = _after; return *this; }
+            FindParameters& setAddedAfter(const Wt::WDateTime& _after) { addedAfter = _after; return *this; }
             FindParameters& setStarringUser(UserId _user, FeedbackBackend _feedbackBackend) { starringUser = _user; feedbackBackend = _feedbackBackend; return *this; }
             FindParameters& setTrack(TrackId _track) { track = _track; return *this; }
             FindParameters& setRelease(ReleaseId _release) { release = _release; return *this; }
@@ -82,11 +88,14 @@ namespace Database
         static std::size_t				getCount(Session& session);
         static pointer					find(Session& session, const UUID& MBID);
         static pointer					find(Session& session, ArtistId id);
+        static std::vector<pointer>		find(Session& session, const std::vector<ArtistId>& ids); // unknown ids are not reported, not in any particular order
         static std::vector<pointer>		find(Session& session, const std::string& name);		// exact match on name field
         static RangeResults<pointer>	find(Session& session, const FindParameters& parameters);
         static void					    find(Session& session, const FindParameters& parameters, std::function<void(const pointer&)> func);
         static RangeResults<ArtistId>	findIds(Session& session, const FindParameters& parameters);
         static RangeResults<ArtistId>	findOrphanIds(Session& session, std::optional<Range> range = std::nullopt); // No track related
+        // Bulk removal, relies on database cascades for the linked entities
+        static void						remove(Session& session, const std::vector<ArtistId>& artistIds);
         static bool						exists(Session& session, ArtistId id);
 
         // Accessors
@@ -111,6 +120,7 @@ namespace Database
         {
             Wt::Dbo::field(a, _name, "name");
             Wt::Dbo::field(a, _sortName, "sort_name");
+            Wt::Dbo::field(a, _sortKey, "sort_key"); // computed from the sort name, see StringUtils::computeSortKey
             Wt::Dbo::field(a, _MBID, "mbid");
 
             Wt::Dbo::hasMany(a, _trackArtistLinks, Wt::Dbo::ManyToOne, "artist");
@@ -127,6 +137,7 @@ namespace Database
 
         std::string _name;
         std::string _sortName;
+        std::string _sortKey;
         std::string _MBID;	// Musicbrainz Identifier
 
         Wt::Dbo::collection<Wt::Dbo::ptr<TrackArtistLink>>	_trackArtistLinks;	// Tracks involving this artist
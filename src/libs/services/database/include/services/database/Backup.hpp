@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Database
+{
+    class Db;
+    class Session;
+
+    // Online backups of the database, using the SQLite backup API
+    // Pages are copied by small batches from a read snapshot, on a dedicated thread: readers and writers are never blocked
+    class BackupService
+    {
+    public:
+        struct Parameters
+        {
+            std::filesystem::path directory;
+            std::chrono::minutes period{}; // 0 means only on demand
+            std::size_t keepCount{ 3 }; // older backups are removed, 0 means keep them all
+            std::size_t maxThroughput{}; // bytes per second, 0 means unlimited
+        };
+
+        struct Status
+        {
+            bool inProgress{};
+            std::size_t copiedPageCount{};
+            std::size_t totalPageCount{};
+
+            std::optional<std::chrono::system_clock::time_point> lastBackupTime; // since startup
+            std::chrono::milliseconds lastBackupDuration{};
+            std::filesystem::path lastBackupPath;
+            std::string lastError; // empty if the last backup succeeded
+        };
+
+        BackupService(Db& db, const Parameters& parameters);
+        ~BackupService(); // aborts the backup in progress, if any
+
+        void requestBackup(); // run as soon as possible
+        Status getStatus() const;
+
+        // complete backups found in directory, oldest first
+        static std::vector<std::filesystem::path> findBackups(const std::filesystem::path& directory);
+
+        // Replaces the whole database content by the backup content, in a single write transaction: readers are not blocked
+        // Throws if the backup was made using another database version
+        static void restoreBackup(Session& session, const std::filesystem::path& backup);
+
+    private:
+        BackupService(const BackupService&) = delete;
+        BackupService& operator=(const BackupService&) = delete;
+
+        void threadLoop();
+        void runBackup();
+        void copyDatabase(const std::filesystem::path& destination);
+        void removeOldBackups();
+
+        Db& _db;
+        const Parameters _parameters;
+
+        mutable std::mutex _mutex;
+        std::condition_variable _condVar;
+        bool _backupRequested{};
+        bool _stop{};
+        Status _status;
+
+        std::thread _thread; // last, uses the other members
+    };
+}
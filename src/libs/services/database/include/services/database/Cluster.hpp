@@ -66,10 +66,15 @@ namespace Database {
         static void                             find(Session& session, const FindParameters& params, std::function<void(const pointer& cluster)> _func);
         static pointer                          find(Session& session, ClusterId id);
         static RangeResults<ClusterId>          findOrphans(Session& session, std::optional<Range> range = std::nullopt);
+        // Bulk removal, relies on database cascades for the linked entities
+        static void                             remove(Session& session, const std::vector<ClusterId>& clusterIds);
 
         // May be very slow
         static std::size_t                      computeTrackCount(Session& session, ClusterId id);
         static std::size_t                      computeReleaseCount(Session& session, ClusterId id);
+        // Recompute the track and release counts of all the clusters at once
+        static void                             updateCounts(Session& session);
+        static void                             updateCounts(Session& session, const std::vector<ClusterId>& clusterIds);
 
         // Accessors
         std::string_view                getName() const { return _name; }
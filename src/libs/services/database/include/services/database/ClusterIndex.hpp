@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "services/database/ClusterId.hpp"
+#include "utils/RoaringBitmap.hpp"
+
+namespace Database
+{
+    class Session;
+
+    // In-memory index of the tracks of each cluster, as compressed bitmaps
+    // Multi cluster filters intersect these bitmaps instead of running GROUP BY/HAVING queries on track_cluster
+    // Immutable: rebuilt after each scan and swapped as a whole, see Db::setClusterIndex
+    class ClusterIndex
+    {
+    public:
+        // Needs a transaction. Returns nullptr if some ids do not fit in the bitmaps
+        static std::shared_ptr<const ClusterIndex> build(Session& session);
+
+        // Tracks that belong to all the given clusters
+        RoaringBitmap getTracks(const std::vector<ClusterId>& clusters) const;
+        // Releases that have at least one track that belongs to all the given clusters
+        RoaringBitmap getReleases(const std::vector<ClusterId>& clusters) const;
+
+        std::size_t getClusterCount() const { return _tracksByCluster.size(); }
+        std::size_t getMemoryUsage() const; // approximate, in bytes
+
+    private:
+        std::unordered_map<ClusterId, RoaringBitmap> _tracksByCluster;
+        std::vector<std::uint32_t> _releaseByTrack; // indexed by track id, 0 if none
+    };
+} // namespace Database
@@ -19,32 +19,72 @@
 
 #pragma once
 
+#include <atomic>
 #include <filesystem>
+#include <memory>
+#include <mutex>
 
 #include <Wt/Dbo/SqlConnectionPool.h>
 
-#include "utils/RecursiveSharedMutex.hpp"
-
 namespace Database {
 
+    class ClusterIndex;
+    class LibraryCatalog;
     class Session;
+
+    // Interactive work (web UI, API) and background work (scanner, synchronizers, trainings...) use separate connection pools:
+    // background work cannot make the requests wait for a connection
+    enum class ConnectionPriority
+    {
+        Interactive,
+        Background,
+    };
+
     class Db
     {
     public:
-        Db(const std::filesystem::path& dbPath, std::size_t connectionCount = 10);
+        // mmapSize is the max size of the database mapped in memory by each connection (0 means no mapping)
+        Db(const std::filesystem::path& dbPath, std::size_t connectionCount = 10, std::size_t backgroundConnectionCount = 2, std::size_t mmapSize = 0);
 
+        // sessions returned by getTLSSession use the pool of the calling thread priority (interactive by default)
+        // must be set before the first getTLSSession call on the thread
+        static void setThreadPriority(ConnectionPriority priority);
         Session& getTLSSession();
 
+        const std::filesystem::path& getPath() const { return _dbPath; }
+
         void executeSql(const std::string& sql);
 
+        // keyword searches use the full text search index when available, LIKE patterns otherwise
+        bool isFullTextSearchEnabled() const { return _fullTextSearchEnabled; }
+        void setFullTextSearchEnabled(bool enabled) { _fullTextSearchEnabled = enabled; }
+
+        // incremented on each write transaction, used to detect quiet periods
+        std::size_t getWriteTransactionCount() const { return _writeTransactionCount; }
+
+        // multi cluster filters use this index when set, SQL queries otherwise
+        std::shared_ptr<const ClusterIndex> getClusterIndex() const { return std::atomic_load(&_clusterIndex); }
+        void setClusterIndex(std::shared_ptr<const ClusterIndex> index) { std::atomic_store(&_clusterIndex, std::move(index)); }
+
+        // the library catalog is only built when enabled (it is rebuilt after each scan)
+        bool isLibraryCatalogEnabled() const { return _libraryCatalogEnabled; }
+        void setLibraryCatalogEnabled(bool enabled) { _libraryCatalogEnabled = enabled; }
+
+        // common browse queries are served by this catalog when set, SQL queries otherwise
+        std::shared_ptr<const LibraryCatalog> getLibraryCatalog() const { return std::atomic_load(&_libraryCatalog); }
+        void setLibraryCatalog(std::shared_ptr<const LibraryCatalog> catalog) { std::atomic_store(&_libraryCatalog, std::move(catalog)); }
+
+        // statement caches of the connections are cleared once they exceed this count, when the connection is released (0 means unbounded)
+        void setMaxCachedStatementCount(std::size_t count) { _maxCachedStatementCount = count; }
+
     private:
         Db(const Db&) = delete;
         Db& operator=(const Db&) = delete;
 
         friend class Session;
 
-        RecursiveSharedMutex& getMutex() { return _sharedMutex; }
-        Wt::Dbo::SqlConnectionPool& getConnectionPool() { return *_connectionPool; }
+        std::recursive_mutex& getWriteMutex() { return _writeMutex; }
+        Wt::Dbo::SqlConnectionPool& getConnectionPool(ConnectionPriority priority) { return priority == ConnectionPriority::Interactive ? *_connectionPool : *_backgroundConnectionPool; }
 
         class ScopedConnection
         {
@@ -62,8 +102,18 @@ namespace Database {
             std::unique_ptr<Wt::Dbo::SqlConnection> _connection;
         };
 
-        RecursiveSharedMutex				_sharedMutex;
+        // SQLite in WAL mode handles concurrent readers along with a single writer:
+        // only writers are serialized, readers never wait for them
+        const std::filesystem::path _dbPath;
+        std::atomic<std::size_t> _maxCachedStatementCount{ 500 }; // before the pools, that reference it
+        std::recursive_mutex _writeMutex;
         std::unique_ptr<Wt::Dbo::SqlConnectionPool>	_connectionPool;
+        std::unique_ptr<Wt::Dbo::SqlConnectionPool>	_backgroundConnectionPool;
+        std::atomic<bool> _fullTextSearchEnabled{ false };
+        std::atomic<std::size_t> _writeTransactionCount{};
+        std::shared_ptr<const ClusterIndex> _clusterIndex; // only accessed using atomic shared_ptr operations
+        std::atomic<bool> _libraryCatalogEnabled{ false };
+        std::shared_ptr<const LibraryCatalog> _libraryCatalog; // only accessed using atomic shared_ptr operations
 
         std::mutex _tlsSessionsMutex;
         std::vector<std::unique_ptr<Session>> _tlsSessions;
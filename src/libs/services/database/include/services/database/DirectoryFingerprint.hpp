@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <string>
+
+#include <Wt/Dbo/Dbo.h>
+#include <Wt/WDateTime.h>
+
+#include "services/database/IdType.hpp"
+#include "services/database/Object.hpp"
+
+LMS_DECLARE_IDTYPE(DirectoryFingerprintId)
+
+namespace Database
+{
+    class Session;
+
+    // Describes the state of a media directory at the time it was last scanned
+    class DirectoryFingerprint final : public Object<DirectoryFingerprint, DirectoryFingerprintId>
+    {
+    public:
+        DirectoryFingerprint() = default;
+
+        // Find utility functions
+        static std::size_t	getCount(Session& session);
+        static pointer		find(Session& session, DirectoryFingerprintId id);
+        static pointer		find(Session& session, const std::filesystem::path& directory);
+
+        struct FindResult
+        {
+            std::filesystem::path	directory;
+            Wt::WDateTime			lastWriteTime;
+            std::size_t				entryCount;
+            std::size_t				scanVersion;
+        };
+        static void			find(Session& session, std::function<void(const FindResult&)> func);
+
+        // Getters
+        std::filesystem::path	getDirectory() const { return _directory; }
+        const Wt::WDateTime&	getLastWriteTime() const { return _lastWriteTime; }
+        std::size_t				getEntryCount() const { return _entryCount; }
+        std::size_t				getScanVersion() const { return _scanVersion; }
+
+        // Setters
+        void setLastWriteTime(const Wt::WDateTime& lastWriteTime) { _lastWriteTime = lastWriteTime; }
+        void setEntryCount(std::size_t entryCount) { _entryCount = static_cast<int>(entryCount); }
+        void setScanVersion(std::size_t scanVersion) { _scanVersion = static_cast<int>(scanVersion); }
+
+        template<class Action>
+        void persist(Action& a)
+        {
+            Wt::Dbo::field(a, _directory, "directory");
+            Wt::Dbo::field(a, _lastWriteTime, "last_write");
+            Wt::Dbo::field(a, _entryCount, "entry_count");
+            Wt::Dbo::field(a, _scanVersion, "scan_version");
+        }
+
+    private:
+        friend class Session;
+        DirectoryFingerprint(const std::filesystem::path& directory);
+        static pointer create(Session& session, const std::filesystem::path& directory);
+
+        std::string		_directory;
+        Wt::WDateTime	_lastWriteTime;
+        int				_entryCount{};
+        int				_scanVersion{};
+    };
+} // namespace Database
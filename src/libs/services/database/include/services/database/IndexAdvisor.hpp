@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Database
+{
+    class Db;
+    class Session;
+
+    // Reviews the plans of the profiled query shapes (see QueryProfiler) to find the missing indexes
+    // Only the plans are computed: the queries are not executed
+    namespace IndexAdvisor
+    {
+        struct QueryReport
+        {
+            std::string query;
+            std::size_t callCount{};
+            std::chrono::microseconds totalDuration{};
+            std::vector<std::string> plan;              // EXPLAIN QUERY PLAN details
+            std::vector<std::string> fullScans;         // tables (or aliases) read without using an index
+            bool usesTempBTree{};                       // rows sorted or grouped at run time
+            std::vector<std::string> proposedIndexes;   // CREATE INDEX statements
+        };
+
+        struct Report
+        {
+            std::size_t analyzedQueryCount{};
+            std::vector<QueryReport> queries;           // only the ones with issues, most expensive first
+            std::vector<std::string> proposedIndexes;   // of all the queries, without duplicates
+        };
+
+        Report analyze(const Db& db);
+        void dump(const Report& report, std::ostream& os);
+
+        // Proposed indexes are named "advised_*", returns the number of created indexes
+        std::size_t createIndexes(Session& session, const std::vector<std::string>& createIndexStatements);
+    } // namespace IndexAdvisor
+} // namespace Database
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "services/database/Artist.hpp"
+#include "services/database/Release.hpp"
+#include "services/database/Track.hpp"
+#include "services/database/Types.hpp"
+
+namespace Database
+{
+    class ClusterIndex;
+    class Session;
+
+    // Immutable in-memory copy of the columns used by the common browse queries (ids, name orders, types, dates)
+    // and of the browse hierarchy (artist => releases => tracks)
+    // Rebuilt after each scan and swapped as a whole, see Db::setLibraryCatalog
+    // Only the random track pools change afterwards, they are internally synchronized
+    // The find functions return std::nullopt when some parameters cannot be handled: the caller must then use SQL
+    class LibraryCatalog
+    {
+    public:
+        // Needs a transaction. Multi cluster filters are served using clusterIndex, if any
+        static std::shared_ptr<const LibraryCatalog> build(Session& session, std::shared_ptr<const ClusterIndex> clusterIndex);
+
+        std::optional<RangeResults<ArtistId>>   findArtistIds(const Artist::FindParameters& params) const;
+        std::optional<RangeResults<ReleaseId>>  findReleaseIds(const Release::FindParameters& params) const;
+        std::optional<RangeResults<TrackId>>    findTrackIds(const Track::FindParameters& params) const;
+
+        std::size_t getArtistCount() const { return _artists.ids.size(); }
+        std::size_t getReleaseCount() const { return _releases.ids.size(); }
+        std::size_t getTrackCount() const { return _tracks.ids.size(); }
+        std::size_t getMemoryUsage() const; // approximate, in bytes
+
+    private:
+        // all the columns are indexed by row, rows are sorted by id
+        struct ArtistColumns
+        {
+            std::vector<ArtistId>                       ids;
+            std::vector<std::uint32_t>                  nameRanks;      // position when sorted by name
+            std::vector<std::uint32_t>                  sortNameRanks;  // position when sorted by sort name
+            std::vector<EnumSet<TrackArtistLinkType>>   linkTypes;      // link types of the tracks the artist is involved in
+        };
+
+        struct ReleaseColumns
+        {
+            std::vector<ReleaseId>                          ids;
+            std::vector<std::uint32_t>                      nameRanks;
+            std::vector<std::optional<ReleaseTypePrimary>>  primaryTypes;
+        };
+
+        struct TrackColumns
+        {
+            std::vector<TrackId>        ids;
+            std::vector<std::uint32_t>  nameRanks;
+            std::vector<std::time_t>    lastWrittens;
+        };
+
+        // children of each parent row, given as rows of the child columns
+        struct ChildRows
+        {
+            std::vector<std::uint32_t>  offsets;    // children of parent row i are in [offsets[i], offsets[i + 1])
+            std::vector<std::uint32_t>  rows;
+
+            void add(std::size_t parentRow, std::uint32_t childRow); // parent rows must be added in increasing order
+            void finalize(std::size_t parentCount);
+        };
+
+        ArtistColumns                               _artists;
+        ReleaseColumns                              _releases;
+        TrackColumns                                _tracks;
+        ChildRows                                   _artistReleases;            // in id order
+        std::vector<EnumSet<TrackArtistLinkType>>   _artistReleaseLinkTypes;    // indexed as _artistReleases.rows
+        ChildRows                                   _releaseTracks;             // in disc and track number order
+        std::shared_ptr<const ClusterIndex>         _clusterIndex;
+
+        // Random first pages of tracks are consumed from a pre-shuffled permutation per cluster filter,
+        // so that they do not have to visit all the matching rows. Reshuffled once consumed
+        struct RandomTrackPool
+        {
+            std::vector<std::uint32_t>  rows;
+            std::size_t                 cursor{};
+        };
+        RangeResults<TrackId> findRandomTrackIds(const std::vector<ClusterId>& clusters, std::size_t size) const;
+
+        static constexpr std::size_t                                maxRandomTrackPoolCount{ 32 };
+        mutable std::mutex                                          _randomTrackPoolsMutex;
+        mutable std::map<std::vector<ClusterId>, RandomTrackPool>   _randomTrackPools;
+    };
+} // namespace Database
@@ -20,6 +20,8 @@
 #pragma once
 
 #include <optional>
+#include <unordered_map>
+#include <vector>
 
 #include <Wt/Dbo/Dbo.h>
 #include <Wt/WDateTime.h>
@@ -63,25 +65,34 @@ namespace Database
         static pointer                  find(Session& session, ListenId id);
         static pointer                  find(Session& session, UserId userId, TrackId trackId, ScrobblingBackend backend, const Wt::WDateTime& dateTime);
         static RangeResults<ListenId>   find(Session& session, const FindParameters& parameters);
+        static std::vector<pointer>     find(Session& session, UserId userId, ScrobblingBackend backend, const Wt::WDateTime& from, const Wt::WDateTime& to); // both bounds included
 
         // Stats
         static RangeResults<ArtistId>   getTopArtists(Session& session, UserId userId, ScrobblingBackend backend, const std::vector<ClusterId>& clusterIds, std::optional<TrackArtistLinkType> linkType, std::optional<Range> range = std::nullopt);
         static RangeResults<ReleaseId>  getTopReleases(Session& session, UserId userId, ScrobblingBackend backend, const std::vector<ClusterId>& clusterIds, std::optional<Range> range = std::nullopt);
         static RangeResults<TrackId>    getTopTracks(Session& session, UserId userId, ScrobblingBackend backend, const std::vector<ClusterId>& clusterIds, std::optional<Range> range = std::nullopt);
+        static RangeResults<TrackId>    getTopTracks(Session& session, std::optional<Range> range = std::nullopt); // listens of all the users, on all the backends
 
         static RangeResults<ArtistId>   getRecentArtists(Session& session, UserId userId, ScrobblingBackend backend, const std::vector<ClusterId>& clusterIds, std::optional<TrackArtistLinkType> linkType, std::optional<Range> range = std::nullopt);
         static RangeResults<ReleaseId>  getRecentReleases(Session& session, UserId userId, ScrobblingBackend backend, const std::vector<ClusterId>& clusterIds, std::optional<Range> range = std::nullopt);
         static RangeResults<TrackId>    getRecentTracks(Session& session, UserId userId, ScrobblingBackend backend, const std::vector<ClusterId>& clusterIds, std::optional<Range> range = std::nullopt);
 
         static std::size_t              getCount(Session& session, UserId userId, ScrobblingBackend backend, TrackId trackId);
+        static std::unordered_map<TrackId, std::size_t> getCounts(Session& session, UserId userId, ScrobblingBackend backend, const std::vector<TrackId>& trackIds); // tracks with no listen are not reported
         static std::size_t              getCount(Session& session, UserId userId, ScrobblingBackend backend, ReleaseId trackId);
 
         static pointer          getMostRecentListen(Session& session, UserId userId, ScrobblingBackend backend, ReleaseId releaseId);
         static pointer          getMostRecentListen(Session& session, UserId userId, ScrobblingBackend backend, TrackId releaseId);
 
+        // Archival: the synchronized listens older than dateTime are replaced by per user/track/month counts
+        // Archived listens are still reported by the stats and counts above, but can no longer be found individually
+        static std::size_t      archive(Session& session, ScrobblingBackend backend, const Wt::WDateTime& dateTime); // returns the number of archived listens
+        static std::size_t      getArchivedCount(Session& session);
+
         SyncState               getSyncState() const { return _syncState; }
         ObjectPtr<User>         getUser() const { return _user; }
         ObjectPtr<Track>        getTrack() const { return _track; }
+        TrackId                 getTrackId() const; // does not load the track
         const Wt::WDateTime& getDateTime() const { return _dateTime; }
 
         void			setSyncState(SyncState state) { _syncState = state; }
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/io_context_strand.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+namespace Database
+{
+    class Db;
+
+    // Runs the database maintenance (WAL checkpoint, optimize, analyze and incremental vacuum) at quiet times:
+    // checked periodically, it runs once no write transaction happened during a whole check period
+    class MaintenanceScheduler
+    {
+    public:
+        MaintenanceScheduler(boost::asio::io_context& ioContext, Db& db, std::chrono::seconds checkPeriod, std::chrono::seconds timeBudget);
+        ~MaintenanceScheduler();
+
+    private:
+        MaintenanceScheduler(const MaintenanceScheduler&) = delete;
+        MaintenanceScheduler& operator=(const MaintenanceScheduler&) = delete;
+
+        void scheduleCheck();
+        void check();
+        void runMaintenance();
+
+        boost::asio::io_context::strand _strand;
+        boost::asio::steady_timer _timer;
+        Db& _db;
+        const std::chrono::seconds _checkPeriod;
+        const std::chrono::seconds _timeBudget;
+
+        std::size_t _lastWriteTransactionCount{};
+        bool _maintenanceNeeded{ true }; // writes happened since the last maintenance
+    };
+}
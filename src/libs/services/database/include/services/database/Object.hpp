@@ -19,6 +19,9 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+
 #include <Wt/WSignal.h>
 #include <Wt/Dbo/ptr.h>
 #include "services/database/IdType.hpp"
@@ -51,6 +54,15 @@ namespace Database
 			Wt::Dbo::ptr<T> _obj;
 	};
 
+	// Objects of this class currently loaded, in all the sessions
+	// Sessions only keep the objects that are still referenced by pointers or by an ongoing transaction
+	template <typename T>
+	std::atomic<std::int64_t>& getLoadedObjectCounter()
+	{
+		static std::atomic<std::int64_t> counter;
+		return counter;
+	}
+
 	template <typename T, typename ObjectIdType>
 	class Object : public Wt::Dbo::Dbo<T>
 	{
@@ -61,6 +73,11 @@ namespace Database
 			using pointer = ObjectPtr<T>;
 			using IdType = ObjectIdType;
 
+			Object() { getLoadedObjectCounter<T>().fetch_add(1, std::memory_order_relaxed); }
+			Object(const Object&) : Object{} {}
+			~Object() { getLoadedObjectCounter<T>().fetch_sub(1, std::memory_order_relaxed); }
+			Object& operator=(const Object&) = default;
+
 			IdType getId() const { return Wt::Dbo::Dbo<T>::self()->Wt::Dbo::template Dbo<T>::id(); }
 
 			// catch some misuses
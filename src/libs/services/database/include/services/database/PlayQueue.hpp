@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <Wt/Dbo/Dbo.h>
+#include <Wt/WDateTime.h>
+
+#include "services/database/IdType.hpp"
+#include "services/database/Object.hpp"
+#include "services/database/TrackId.hpp"
+#include "services/database/UserId.hpp"
+
+LMS_DECLARE_IDTYPE(PlayQueueId)
+
+namespace Database
+{
+    class Session;
+    class User;
+
+    // Play queue saved by the clients of a user, a single one per user
+    // Clients save it very often: the track ids are stored as a single compact value rather than one row per entry
+    class PlayQueue final : public Object<PlayQueue, PlayQueueId>
+    {
+    public:
+        PlayQueue() = default;
+
+        // Find utility functions
+        static std::size_t	getCount(Session& session);
+        static pointer		find(Session& session, PlayQueueId id);
+        static pointer		find(Session& session, UserId userId);
+
+        // Getters
+        std::vector<TrackId>		getTrackIds() const; // empty if the stored value is malformed
+        std::size_t					getCurrentIndex() const { return static_cast<std::size_t>(_currentIndex); }
+        std::chrono::milliseconds	getCurrentPosition() const { return std::chrono::milliseconds{ _currentPosition }; } // in the current track
+        const Wt::WDateTime&		getLastModifiedDateTime() const { return _lastModifiedDateTime; }
+        std::string_view			getChangedBy() const { return _changedBy; } // client name
+        ObjectPtr<User>				getUser() const { return _user; }
+
+        // Setters
+        void setTrackIds(const std::vector<TrackId>& trackIds);
+        void setCurrentIndex(std::size_t index) { _currentIndex = static_cast<long long>(index); }
+        void setCurrentPosition(std::chrono::milliseconds position) { _currentPosition = position.count(); }
+        void setLastModifiedDateTime(const Wt::WDateTime& dateTime) { _lastModifiedDateTime = dateTime; }
+        void setChangedBy(std::string_view changedBy) { _changedBy = changedBy; }
+
+        template<class Action>
+        void persist(Action& a)
+        {
+            Wt::Dbo::field(a, _trackIds, "track_ids");
+            Wt::Dbo::field(a, _currentIndex, "current_index");
+            Wt::Dbo::field(a, _currentPosition, "current_position");
+            Wt::Dbo::field(a, _lastModifiedDateTime, "last_modified_date_time");
+            Wt::Dbo::field(a, _changedBy, "changed_by");
+            Wt::Dbo::belongsTo(a, _user, "user", Wt::Dbo::OnDeleteCascade);
+        }
+
+    private:
+        friend class Session;
+        PlayQueue(ObjectPtr<User> user);
+        static pointer create(Session& session, ObjectPtr<User> user);
+
+        std::vector<unsigned char>	_trackIds; // deltas between successive ids, as zigzag varints
+        long long					_currentIndex{};
+        long long					_currentPosition{}; // ms
+        Wt::WDateTime				_lastModifiedDateTime;
+        std::string					_changedBy;
+        Wt::Dbo::ptr<User>			_user;
+    };
+} // namespace Database
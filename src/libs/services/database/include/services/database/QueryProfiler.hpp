@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Optional per query shape statistics, to spot the queries that need indexes
+// Prepared statements are already cached per connection by Wt::Dbo, keyed by the query string
+namespace Database::QueryProfiler
+{
+    struct QueryStats
+    {
+        std::string query;
+        std::size_t callCount{};
+        std::size_t rowCount{};
+        std::chrono::microseconds totalDuration{};
+        std::chrono::microseconds maxDuration{};
+    };
+
+    void setEnabled(bool enabled);
+    bool isEnabled();
+
+    void record(std::string_view query, std::chrono::steady_clock::duration duration, std::size_t rowCount);
+    void reset();
+
+    // Sorted by total duration, most expensive first
+    std::vector<QueryStats> getStats();
+    void dump(std::ostream& os);
+} // namespace Database::QueryProfiler
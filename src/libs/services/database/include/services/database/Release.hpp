@@ -52,9 +52,12 @@ namespace Database
         {
             std::vector<ClusterId>              clusters; // if non empty, releases that belong to these clusters
             std::vector<std::string_view>       keywords; // if non empty, name must match all of these keywords
+            std::vector<ReleaseId>              ids; // if non empty, only releases among these ones
             ReleaseSortMethod                   sortMethod{ ReleaseSortMethod::None };
             std::optional<Range>                range;
+            ReleaseId                           afterId;                    // keyset pagination: only releases after this one (needs ReleaseSortMethod::Id)
             Wt::WDateTime                       writtenAfter;
+            Wt::WDateTime                       addedAfter;                 // only releases having tracks (re)scanned after this time
             std::optional<DateRange>            dateRange;
             UserId                              starringUser;				// only releases starred by this user
             std::optional<FeedbackBackend>      feedbackBackend;		    //    and for this backend
@@ -66,9 +69,12 @@ namespace Database
 
             FindParameters& setClusters(const std::vector<ClusterId>& _clusters) { clusters = _clusters; return *this; }
             FindParameters& setKeywords(const std::vector<std::string_view>& _keywords) { keywords = _keywords; return *this; }
+            FindParameters& setIds(const std::vector<ReleaseId>& _ids) { ids = _ids; return *this; }
             FindParameters& setSortMethod(ReleaseSortMethod _sortMethod) { sortMethod = _sortMethod; return *this; }
             FindParameters& setRange(std::optional<Range> _range) { range = _range; return *this; }
+            FindParameters& setAfterId(ReleaseId _afterId) { afterId = _afterId; return *this; }
             FindParameters& setWrittenAfter(const Wt::WDateTime& _after) { writtenAfter = _after; return *this; }
+            FindParameters& setAddedAfter(const Wt::WDateTime& _after) { addedAfter = _after; return *this; }
             FindParameters& setDateRange(const std::optional<DateRange>& _dateRange) { dateRange = _dateRange; return *this; }
             FindParameters& setStarringUser(UserId _user, FeedbackBackend _feedbackBackend) { starringUser = _user; feedbackBackend = _feedbackBackend; return *this; }
             FindParameters& setArtist(ArtistId _artist, EnumSet<TrackArtistLinkType> _trackArtistLinkTypes = {}, EnumSet<TrackArtistLinkType> _excludedTrackArtistLinkTypes = {})
@@ -88,12 +94,19 @@ namespace Database
         static pointer                  find(Session& session, const UUID& MBID);
         static std::vector<pointer>     find(Session& session, const std::string& name);
         static pointer                  find(Session& session, ReleaseId id);
+        static std::vector<pointer>     find(Session& session, const std::vector<ReleaseId>& ids); // unknown ids are not reported, not in any particular order
         static RangeResults<pointer>    find(Session& session, const FindParameters& parameters);
         static void                     find(Session& session, const FindParameters& parameters, std::function<void(const pointer&)> func);
         static RangeResults<ReleaseId>  findIds(Session& session, const FindParameters& parameters);
         static RangeResults<ReleaseId>  findOrphanIds(Session& session, std::optional<Range> range = std::nullopt); // not track related
+        // Bulk removal, relies on database cascades for the linked entities
+        static void                     remove(Session& session, const std::vector<ReleaseId>& releaseIds);
         static RangeResults<ReleaseId>  findIdsOrderedByArtist(Session& session, std::optional<Range> range = std::nullopt);
 
+        // Recompute the cached track aggregates (duration, counts, years, ...) of all the releases at once
+        static void                     updateAggregates(Session& session);
+        static void                     updateAggregates(Session& session, const std::vector<ReleaseId>& releaseIds);
+
         // Get the cluster of the tracks that belong to this release
         // Each clusters are grouped by cluster type, sorted by the number of occurence (max to min)
         // size is the max number of cluster per cluster type
@@ -110,17 +123,20 @@ namespace Database
         const std::string& getName() const { return _name; }
         std::optional<UUID>                 getMBID() const { return UUID::fromString(_MBID); }
         std::optional<std::size_t>          getTotalDisc() const { return _totalDisc; }
-        std::size_t                         getDiscCount() const; // may not be total disc (if incomplete for example)
+        std::size_t                         getDiscCount() const { return _discCount; } // may not be total disc (if incomplete for example)
         std::vector<DiscInfo>               getDiscs() const;
-        std::chrono::milliseconds           getDuration() const;
+        std::chrono::milliseconds           getDuration() const { return _duration; }
         Wt::WDateTime                       getLastWritten() const;
         std::optional<ReleaseTypePrimary>   getPrimaryType() const { return _primaryType; }
         EnumSet<ReleaseTypeSecondary>       getSecondaryTypes() const { return _secondaryTypes; }
         std::string_view                    getArtistDisplayName() const { return _artistDisplayName; }
-        std::size_t                         getTracksCount() const;
+        std::size_t                         getTracksCount() const { return _trackCount; }
+        std::optional<int>                  getMinYear() const { return _minYear; }
+        std::optional<int>                  getMaxYear() const { return _maxYear; }
+        bool                                hasEmbeddedCover() const { return _hasEmbeddedCover; } // at least one track has an embedded cover
 
         // Setters
-        void setName(std::string_view name) { _name = name; }
+        void setName(std::string_view name);
         void setMBID(const std::optional<UUID>& mbid) { _MBID = mbid ? mbid->getAsString() : ""; }
         void setTotalDisc(std::optional<int> totalDisc) { _totalDisc = totalDisc; }
         void setPrimaryType(std::optional<ReleaseTypePrimary> type) { _primaryType = type; }
@@ -138,11 +154,20 @@ namespace Database
         void persist(Action& a)
         {
             Wt::Dbo::field(a, _name, "name");
+            Wt::Dbo::field(a, _sortKey, "sort_key"); // computed from the name, see StringUtils::computeSortKey
             Wt::Dbo::field(a, _MBID, "mbid");
             Wt::Dbo::field(a, _totalDisc, "total_disc");
             Wt::Dbo::field(a, _primaryType, "primary_type");
             Wt::Dbo::field(a, _secondaryTypes, "secondary_types");
             Wt::Dbo::field(a, _artistDisplayName, "artist_display_name");
+            // cached fields since computing them for each release is too long, see updateAggregates
+            Wt::Dbo::field(a, _duration, "duration");
+            Wt::Dbo::field(a, _trackCount, "track_count");
+            Wt::Dbo::field(a, _discCount, "disc_count");
+            Wt::Dbo::field(a, _minYear, "min_year");
+            Wt::Dbo::field(a, _maxYear, "max_year");
+            Wt::Dbo::field(a, _hasEmbeddedCover, "has_embedded_cover");
+            Wt::Dbo::field(a, _artistSortKey, "artist_sort_key"); // smallest sort key of the release artists (or of the artists if none), empty if no artist
             Wt::Dbo::hasMany(a, _tracks, Wt::Dbo::ManyToOne, "release");
         }
 
@@ -156,11 +181,19 @@ namespace Database
         static constexpr std::size_t _maxNameLength{ 128 };
 
         std::string                         _name;
+        std::string                         _sortKey;
         std::string                         _MBID;
         std::optional<int>                  _totalDisc{};
         std::optional<ReleaseTypePrimary>   _primaryType;
         EnumSet<ReleaseTypeSecondary>       _secondaryTypes;
         std::string                         _artistDisplayName;
+        std::chrono::duration<int, std::milli>  _duration{};
+        int                                 _trackCount{};
+        int                                 _discCount{};
+        std::optional<int>                  _minYear;
+        std::optional<int>                  _maxYear;
+        bool                                _hasEmbeddedCover{};
+        std::string                         _artistSortKey;
 
         Wt::Dbo::collection<Wt::Dbo::ptr<Track>>    _tracks; // Tracks in the release
     };
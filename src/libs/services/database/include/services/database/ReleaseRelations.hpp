@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "services/database/Artist.hpp"
+#include "services/database/Object.hpp"
+#include "services/database/Release.hpp"
+#include "services/database/ReleaseId.hpp"
+#include "services/database/Types.hpp"
+
+namespace Database
+{
+    class Session;
+
+    // Releases and the artists of their tracks, bulk loaded using a few queries
+    // Meant to be used by list builders instead of querying these relations for each release
+    // Only valid during the transaction used to load it
+    class ReleaseRelations
+    {
+    public:
+        ReleaseRelations() = default;
+        ReleaseRelations(Session& session, const std::vector<ReleaseId>& releaseIds);
+
+        ObjectPtr<Release>              getRelease(ReleaseId releaseId) const; // null if not found
+        std::vector<ObjectPtr<Artist>>  getArtists(ReleaseId releaseId, TrackArtistLinkType linkType) const;
+
+    private:
+        struct ReleaseArtist
+        {
+            TrackArtistLinkType linkType;
+            ObjectPtr<Artist> artist;
+        };
+
+        std::unordered_map<ReleaseId, ObjectPtr<Release>> _releases;
+        std::unordered_map<ReleaseId, std::vector<ReleaseArtist>> _releaseArtists;
+    };
+} // namespace Database
@@ -19,51 +19,73 @@
 
 #pragma once
 
+#include <mutex>
+
 #include <Wt/Dbo/Dbo.h>
 #include <Wt/Dbo/SqlConnectionPool.h>
 
-#include "utils/RecursiveSharedMutex.hpp"
 #include "services/database/Object.hpp"
+#include "services/database/TransactionProfiler.hpp"
+#include "utils/Tracing.hpp"
 
 
 namespace Database
 {
+    // Write transaction, serialized with the other write transactions
     class UniqueTransaction
     {
+    public:
+        ~UniqueTransaction();
+
     private:
         friend class Session;
-        UniqueTransaction(RecursiveSharedMutex& mutex, Wt::Dbo::Session& session);
+        UniqueTransaction(std::recursive_mutex& mutex, Wt::Dbo::Session& session, std::size_t& transactionCount, const TransactionProfiler::CallSite& site);
 
-        std::unique_lock<RecursiveSharedMutex> _lock;
+        Tracing::ScopedSpan _span; // first, so that the time spent waiting for the lock is included
+        TransactionProfiler::Timer _profilerTimer; // destroyed once the transaction is committed and the lock released
+        std::unique_lock<std::recursive_mutex> _lock;
         Wt::Dbo::Transaction _transaction;
+        std::size_t& _transactionCount;
     };
 
+    // Read transaction, works on its own snapshot and does not wait for write transactions
     class SharedTransaction
     {
+    public:
+        ~SharedTransaction();
+
     private:
         friend class Session;
-        SharedTransaction(RecursiveSharedMutex& mutex, Wt::Dbo::Session& session);
+        SharedTransaction(Wt::Dbo::Session& session, std::size_t& transactionCount, const TransactionProfiler::CallSite& site);
 
-        std::shared_lock<RecursiveSharedMutex> _lock;
+        Tracing::ScopedSpan _span;
+        TransactionProfiler::Timer _profilerTimer;
         Wt::Dbo::Transaction _transaction;
+        std::size_t& _transactionCount;
     };
 
     class Db;
+    enum class ConnectionPriority;
     class Session
     {
     public:
-        Session(Db& database);
+        Session(Db& database); // interactive priority
+        Session(Db& database, ConnectionPriority priority);
 
-        [[nodiscard]] UniqueTransaction createUniqueTransaction();
-        [[nodiscard]] SharedTransaction createSharedTransaction();
+        // site is only used by the transaction profiler
+        [[nodiscard]] UniqueTransaction createUniqueTransaction(const TransactionProfiler::CallSite& site = TransactionProfiler::CallSite::current());
+        [[nodiscard]] SharedTransaction createSharedTransaction(const TransactionProfiler::CallSite& site = TransactionProfiler::CallSite::current());
 
         void checkUniqueLocked();
         void checkSharedLocked();
 
         void analyze();
         void optimize();
+        void checkpointWal();
+        void incrementalVacuum(std::size_t maxPageCount);
 
         void prepareTables(); // need to run only once at startup
+        void runBackgroundMigrationTasks(); // once prepareTables is done, can be run while the server is running
 
         Wt::Dbo::Session& getDboSession() { return _session; }
         Db& getDb() { return _db; }
@@ -88,6 +110,8 @@ namespace Database
 
         Db& _db;
         Wt::Dbo::Session	_session;
+        std::size_t _uniqueTransactionCount{};
+        std::size_t _sharedTransactionCount{};
     };
 } // namespace Database
 
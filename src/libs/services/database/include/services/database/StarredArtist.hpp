@@ -19,6 +19,9 @@
 
 #pragma once
 
+#include <unordered_map>
+#include <vector>
+
 #include <Wt/WDateTime.h>
 #include <Wt/Dbo/Dbo.h>
 
@@ -43,6 +46,7 @@ namespace Database
         static std::size_t	getCount(Session& session);
         static pointer		find(Session& session, StarredArtistId id);
         static pointer		find(Session& session, ArtistId artistId, UserId userId, FeedbackBackend backend);
+        static std::unordered_map<ArtistId, Wt::WDateTime> getStarredDateTimes(Session& session, UserId userId, FeedbackBackend backend, const std::vector<ArtistId>& artistIds); // not starred objects are not reported
 
         // Accessors
         ObjectPtr<Artist>	getArtist() const { return _artist; }
@@ -19,6 +19,9 @@
 
 #pragma once
 
+#include <unordered_map>
+#include <vector>
+
 #include <Wt/WDateTime.h>
 #include <Wt/Dbo/Dbo.h>
 
@@ -43,6 +46,7 @@ namespace Database
         static std::size_t getCount(Session& session);
         static pointer find(Session& session, StarredReleaseId id);
         static pointer find(Session& session, ReleaseId releaseId, UserId userId, FeedbackBackend backend);
+        static std::unordered_map<ReleaseId, Wt::WDateTime> getStarredDateTimes(Session& session, UserId userId, FeedbackBackend backend, const std::vector<ReleaseId>& releaseIds); // not starred objects are not reported
 
         // Accessors
         ObjectPtr<Release> getRelease() const { return _release; }
@@ -19,6 +19,10 @@
 
 #pragma once
 
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
 #include <Wt/WDateTime.h>
 #include <Wt/Dbo/Dbo.h>
 
@@ -56,6 +60,8 @@ namespace Database
         static std::size_t  getCount(Session& session);
         static pointer      find(Session& session, StarredTrackId id);
         static pointer      find(Session& session, TrackId trackId, UserId userId, FeedbackBackend backend);
+        static std::unordered_map<TrackId, Wt::WDateTime> getStarredDateTimes(Session& session, UserId userId, FeedbackBackend backend, const std::vector<TrackId>& trackIds); // not starred objects are not reported
+        static std::unordered_set<TrackId> findStarredTrackIds(Session& session, UserId userId, FeedbackBackend backend, const std::vector<TrackId>& trackIds); // whatever the sync state
         static RangeResults<StarredTrackId>	find(Session& session, const FindParameters& findParams);
 
         // Accessors
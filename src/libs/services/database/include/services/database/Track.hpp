@@ -20,11 +20,14 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
 #include <ostream>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -62,10 +65,13 @@ namespace Database {
         {
             std::vector<ClusterId>				clusters;		// if non empty, tracks that belong to these clusters
             std::vector<std::string_view>		keywords;		// if non empty, name must match all of these keywords
+            std::vector<TrackId>				ids;			// if non empty, only tracks among these ones
             std::string							name;			// if non empty, must match this name
             TrackSortMethod						sortMethod{ TrackSortMethod::None };
             std::optional<Range>    			range;
+            TrackId								afterId;		// keyset pagination: only tracks after this one (needs TrackSortMethod::Id)
             Wt::WDateTime						writtenAfter;
+            Wt::WDateTime						addedAfter;		// only tracks (re)scanned after this time
             UserId								starringUser;	// only tracks starred by this user
             std::optional<FeedbackBackend>		feedbackBackend;	// and for this feedback backend
             ArtistId							artist;			// only tracks that involve this artist
@@ -80,10 +86,13 @@ namespace Database {
 
             FindParameters& setClusters(const std::vector<ClusterId>& _clusters) { clusters = _clusters; return *this; }
             FindParameters& setKeywords(const std::vector<std::string_view>& _keywords) { keywords = _keywords; return *this; }
+            FindParameters& setIds(const std::vector<TrackId>& _ids) { ids = _ids; return *this; }
             FindParameters& setName(std::string_view _name) { name = _name; return *this; }
             FindParameters& setSortMethod(TrackSortMethod _method) { sortMethod = _method; return *this; }
             FindParameters& setRange(std::optional<Range> _range) { range = _range; return *this; }
+            FindParameters& setAfterId(TrackId _afterId) { afterId = _afterId; return *this; }
             FindParameters& setWrittenAfter(const Wt::WDateTime& _after) { writtenAfter = _after; return *this; }
+            FindParameters& setAddedAfter(const Wt::WDateTime& _after) { addedAfter = _after; return *this; }
             FindParameters& setStarringUser(UserId _user, FeedbackBackend _feedbackBackend) { starringUser = _user; feedbackBackend = _feedbackBackend; return *this; }
             FindParameters& setArtist(ArtistId _artist, EnumSet<TrackArtistLinkType> _trackArtistLinkTypes = {}) { artist = _artist; trackArtistLinkTypes = _trackArtistLinkTypes; return *this; }
             FindParameters& setArtistName(std::string_view _artistName, EnumSet<TrackArtistLinkType> _trackArtistLinkTypes = {}) { artistName = _artistName; trackArtistLinkTypes = _trackArtistLinkTypes; return *this; }
@@ -101,14 +110,35 @@ namespace Database {
             std::filesystem::path	path;
         };
 
+        struct TrackMBIDDuplicateResult
+        {
+            TrackId					trackId;
+            std::string				trackMBID;
+            std::filesystem::path	path;
+            std::string				name;
+        };
+
+        struct FileInfoResult
+        {
+            TrackId					trackId;
+            std::filesystem::path	path;
+            Wt::WDateTime			lastWriteTime;
+            std::size_t				scanVersion;
+            std::size_t				fileSize;
+            std::uint64_t			contentFingerprint;
+            Wt::WDateTime			addedTime; // last (re)scan
+        };
+
         Track() = default;
 
         // Find utility functions
         static std::size_t				getCount(Session& session);
         static pointer					findByPath(Session& session, const std::filesystem::path& p);
         static pointer 					find(Session& session, TrackId id);
+        static std::vector<pointer>		find(Session& session, const std::vector<TrackId>& ids); // unknown ids are not reported, not in any particular order
         static bool						exists(Session& session, TrackId id);
         static std::vector<pointer>		findByRecordingMBID(Session& session, const UUID& MBID);
+        static std::unordered_map<std::string, std::vector<TrackId>> findIdsByRecordingMBIDs(Session& session, const std::vector<UUID>& MBIDs); // keyed by MBID, unknown MBIDs are not reported
         static std::vector<pointer>		findByMBID(Session& session, const UUID& MBID);
         static RangeResults<TrackId>	findSimilarTrackIds(Session& session, const std::vector<TrackId>& trackIds, std::optional<Range> range = std::nullopt);
 
@@ -116,8 +146,18 @@ namespace Database {
         static RangeResults<pointer>	find(Session& session, const FindParameters& parameters);
         static void						find(Session& session, const FindParameters& parameters, std::function<void(const Track::pointer&)> func);
         static RangeResults<PathResult>	findPaths(Session& session, std::optional<Range> range = std::nullopt);
-        static RangeResults<TrackId>	findIdsTrackMBIDDuplicates(Session& session, std::optional<Range> range = std::nullopt);
+        // scope is either a track file or a directory: only the tracks within it are reported, sorted by path
+        static RangeResults<PathResult>	findPaths(Session& session, const std::filesystem::path& scope, std::optional<Range> range = std::nullopt);
+        static RangeResults<ReleaseId>	findReleaseIds(Session& session, const std::filesystem::path& scope, std::optional<Range> range = std::nullopt);
+        static RangeResults<ClusterId>	findClusterIds(Session& session, const std::filesystem::path& scope, std::optional<Range> range = std::nullopt);
+        static void						findFileInfos(Session& session, std::function<void(const FileInfoResult&)> func);
+        // Bulk removal, relies on database cascades for the linked entities
+        static void						remove(Session& session, const std::vector<TrackId>& trackIds);
+        static RangeResults<TrackMBIDDuplicateResult> findTrackMBIDDuplicates(Session& session, std::optional<Range> range = std::nullopt);
         static RangeResults<TrackId>	findIdsWithRecordingMBIDAndMissingFeatures(Session& session, std::optional<Range> range = std::nullopt);
+        static RangeResults<TrackId>	findIdsWithMissingFeatures(Session& session, std::optional<Range> range = std::nullopt);
+        static RangeResults<TrackId>	findIdsWithPendingAudioProperties(Session& session, std::optional<Range> range = std::nullopt);
+        static RangeResults<TrackId>	findIdsWithMinDuration(Session& session, std::chrono::milliseconds minDuration, std::optional<Range> range = std::nullopt);
 
         // Accessors
         void setScanVersion(std::size_t version) { _scanVersion = version; }
@@ -129,7 +169,13 @@ namespace Database {
         void setPath(const std::filesystem::path& filePath) { _filePath = filePath; }
         void setDuration(std::chrono::milliseconds duration) { _duration = duration; }
         void setBitrate(std::size_t bitrate) { _bitrate = bitrate; }
+        void setAudioPropertiesPending(bool pending) { _audioPropertiesPending = pending; }
         void setLastWriteTime(Wt::WDateTime time) { _fileLastWrite = time; }
+        void setFileSize(std::size_t fileSize) { _fileSize = fileSize; }
+        void setContentFingerprint(std::uint64_t fingerprint) { _contentFingerprint = static_cast<long long>(fingerprint); }
+        void setAudioCodec(std::string_view codec) { _audioCodec = codec; }
+        void setSampleRate(std::size_t sampleRate) { _sampleRate = sampleRate; }
+        void setChannelCount(std::size_t channelCount) { _channelCount = channelCount; }
         void setAddedTime(Wt::WDateTime time) { _fileAdded = time; }
         void setDate(const Wt::WDate& date) { _date = date; }
         void setOriginalDate(const Wt::WDate& date) { _originalDate = date; }
@@ -155,10 +201,16 @@ namespace Database {
         std::filesystem::path		getPath() const { return _filePath; }
         std::chrono::milliseconds	getDuration() const { return _duration; }
         std::size_t                 getBitrate() const { return _bitrate; }
+        bool						hasPendingAudioProperties() const { return _audioPropertiesPending; } // duration and bitrate are estimations yet to be refined
         const Wt::WDateTime& getLastWritten() const { return _fileLastWrite; }
         std::optional<int>			getYear() const;
         std::optional<int>			getOriginalYear() const;
         Wt::WDateTime				getLastWriteTime() const { return _fileLastWrite; }
+        std::size_t					getFileSize() const { return _fileSize; } // 0 if unknown
+        std::uint64_t				getContentFingerprint() const { return static_cast<std::uint64_t>(_contentFingerprint); } // 0 if unknown
+        const std::string&			getAudioCodec() const { return _audioCodec; } // ffmpeg codec name, empty if unknown
+        std::size_t					getSampleRate() const { return _sampleRate; } // 0 if unknown
+        std::size_t					getChannelCount() const { return _channelCount; } // 0 if unknown
         Wt::WDateTime				getAddedTime() const { return _fileAdded; }
         bool						hasCover() const { return _hasCover; }
         std::optional<UUID>			getTrackMBID() const { return UUID::fromString(_trackMBID); }
@@ -189,10 +241,16 @@ namespace Database {
             Wt::Dbo::field(a, _name, "name");
             Wt::Dbo::field(a, _duration, "duration");
             Wt::Dbo::field(a, _bitrate, "bitrate");
+            Wt::Dbo::field(a, _audioPropertiesPending, "audio_properties_pending");
             Wt::Dbo::field(a, _date, "date");
             Wt::Dbo::field(a, _originalDate, "original_date");
             Wt::Dbo::field(a, _filePath, "file_path");
             Wt::Dbo::field(a, _fileLastWrite, "file_last_write");
+            Wt::Dbo::field(a, _fileSize, "file_size");
+            Wt::Dbo::field(a, _contentFingerprint, "content_fingerprint");
+            Wt::Dbo::field(a, _audioCodec, "audio_codec");
+            Wt::Dbo::field(a, _sampleRate, "sample_rate");
+            Wt::Dbo::field(a, _channelCount, "channel_count");
             Wt::Dbo::field(a, _fileAdded, "file_added");
             Wt::Dbo::field(a, _hasCover, "has_cover");
             Wt::Dbo::field(a, _trackMBID, "mbid");
@@ -224,10 +282,16 @@ namespace Database {
         std::string				_name;
         std::chrono::duration<int, std::milli>	_duration{};
         int                     _bitrate; // in bps
+        bool					_audioPropertiesPending{};
         Wt::WDate				_date;
         Wt::WDate				_originalDate;
         std::string				_filePath;
         Wt::WDateTime			_fileLastWrite;
+        long long				_fileSize{};
+        long long				_contentFingerprint{};
+        std::string				_audioCodec;
+        int						_sampleRate{};
+        int						_channelCount{};
         Wt::WDateTime			_fileAdded;
         bool					_hasCover{};
         std::string				_trackMBID;
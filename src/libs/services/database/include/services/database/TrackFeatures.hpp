@@ -21,6 +21,7 @@
 
 #include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -53,6 +54,10 @@ class TrackFeatures final : public Object<TrackFeatures, TrackFeaturesId>
 		static pointer							find(Session& session, TrackFeaturesId id);
 		static pointer							find(Session& session, TrackId trackId);
 		static RangeResults<TrackFeaturesId>	find(Session& session, std::optional<Range> range = std::nullopt);
+		static RangeResults<TrackId>			findTrackIds(Session& session, std::optional<Range> range = std::nullopt); // tracks that have features
+
+		// Low level document, as output by the Essentia music extractors (AcousticBrainz format)
+		static std::optional<FeatureValuesMap>	parseJson(std::string_view json);
 
 		FeatureValues		getFeatureValues(const FeatureName& feature) const;
 		FeatureValuesMap	getFeatureValuesMap(const std::unordered_set<FeatureName>& featureNames) const;
@@ -69,10 +74,10 @@ class TrackFeatures final : public Object<TrackFeatures, TrackFeaturesId>
 
 	private:
 		friend class Session;
-		TrackFeatures(ObjectPtr<Track> track, const std::string& jsonEncodedFeatures);
-		static pointer create(Session& session, ObjectPtr<Track> track, const std::string& jsonEncodedFeatures);
+		TrackFeatures(ObjectPtr<Track> track, const FeatureValuesMap& featureValuesMap);
+		static pointer create(Session& session, ObjectPtr<Track> track, const FeatureValuesMap& featureValuesMap);
 
-		std::string _data;
+		std::vector<unsigned char> _data; // see TrackFeaturesEncoding
 		Wt::Dbo::ptr<Track> _track;
 };
 
@@ -19,9 +19,12 @@
 
 #pragma once
 
+#include <chrono>
+#include <functional>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 #include <Wt/Dbo/Dbo.h>
@@ -66,6 +69,15 @@ namespace Database {
             FindParameters& setSortMethod(TrackListSortMethod _sortMethod) { sortMethod = _sortMethod; return *this; }
         };
         static std::size_t					getCount(Session& session);
+
+        // maintained by the database, see Session
+        struct Stats
+        {
+            std::size_t					entryCount{};
+            std::chrono::milliseconds	duration{};
+        };
+        // tracklists along with their stats, loaded using a single query
+        static void							find(Session& session, const FindParameters& params, std::function<void(const pointer&, const Stats&)> func);
         static pointer						find(Session& session, std::string_view name, TrackListType type, UserId userId);
         static pointer						find(Session& session, TrackListId tracklistId);
         static RangeResults<TrackListId>	find(Session& session, const FindParameters& params);
@@ -80,12 +92,23 @@ namespace Database {
         void		setName(const std::string& name) { _name = name; }
         void		setIsPublic(bool isPublic) { _isPublic = isPublic; }
         void		clear() { _entries.clear(); }
+        // Bulk append, in order, using a few statements. Unknown tracks are skipped
+        void		addTracks(const std::vector<TrackId>& trackIds);
+        // Bulk removal of the entries at the given positions (taken before any removal), using a few statements. Out of range positions are ignored
+        void		removeEntries(const std::vector<std::size_t>& positions);
 
         // Get tracks, ordered by position
         bool										isEmpty() const;
         std::size_t									getCount() const;
+        Stats										getStats() const;
         ObjectPtr<TrackListEntry>					getEntry(std::size_t pos) const;
         std::vector<ObjectPtr<TrackListEntry>>		getEntries(std::optional<Range> range = {}) const;
+        // entries along with their tracks, loaded using a single query
+        std::vector<std::pair<ObjectPtr<TrackListEntry>, ObjectPtr<Track>>>	getEntriesWithTracks(std::optional<Range> range = {}) const;
+        // entries along with their tracks, visited in order by pages of at most pageSize entries
+        // each page is a single indexed query that resumes after the last visited entry (no offset)
+        using EntriesWithTracksPage = std::vector<std::pair<ObjectPtr<TrackListEntry>, ObjectPtr<Track>>>;
+        void										visitEntriesWithTracks(std::size_t pageSize, const std::function<void(const EntriesWithTracksPage&)>& func) const;
         ObjectPtr<TrackListEntry>					getEntryByTrackAndDateTime(ObjectPtr<Track> track, const Wt::WDateTime& dateTime) const;
 
         RangeResults<ObjectPtr<Artist>>			    getArtists(const std::vector<ClusterId>& clusters, std::optional<TrackArtistLinkType> linkType, ArtistSortMethod sortMethod, std::optional<Range> range, bool& moreResults) const;
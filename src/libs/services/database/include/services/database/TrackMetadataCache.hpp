@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <Wt/Dbo/Dbo.h>
+#include <Wt/WDateTime.h>
+
+#include "services/database/IdType.hpp"
+#include "services/database/Object.hpp"
+#include "services/database/TrackId.hpp"
+
+LMS_DECLARE_IDTYPE(TrackMetadataCacheId)
+
+namespace Database
+{
+    class Session;
+    class Track;
+
+    // Raw metadata extracted by the parser from a track file, valid as long as the file does not change
+    // Lets a rescan map the metadata again without reading the file
+    class TrackMetadataCache final : public Object<TrackMetadataCache, TrackMetadataCacheId>
+    {
+    public:
+        TrackMetadataCache() = default;
+
+        // Find utility functions
+        static std::size_t	getCount(Session& session);
+        static pointer		find(Session& session, TrackMetadataCacheId id);
+        static pointer		find(Session& session, TrackId trackId);
+
+        // Getters
+        const Wt::WDateTime&				getFileLastWriteTime() const { return _fileLastWrite; }
+        std::size_t							getFileSize() const { return static_cast<std::size_t>(_fileSize); }
+        const std::vector<unsigned char>&	getData() const { return _data; } // opaque, parser specific
+
+        // Setters
+        void setFileLastWriteTime(const Wt::WDateTime& lastWriteTime) { _fileLastWrite = lastWriteTime; }
+        void setFileSize(std::size_t fileSize) { _fileSize = static_cast<long long>(fileSize); }
+        void setData(std::vector<unsigned char> data) { _data = std::move(data); }
+
+        template<class Action>
+        void persist(Action& a)
+        {
+            Wt::Dbo::field(a, _fileLastWrite, "file_last_write");
+            Wt::Dbo::field(a, _fileSize, "file_size");
+            Wt::Dbo::field(a, _data, "data");
+            Wt::Dbo::belongsTo(a, _track, "track", Wt::Dbo::OnDeleteCascade);
+        }
+
+    private:
+        friend class Session;
+        TrackMetadataCache(ObjectPtr<Track> track);
+        static pointer create(Session& session, ObjectPtr<Track> track);
+
+        Wt::WDateTime				_fileLastWrite;
+        long long					_fileSize{};
+        std::vector<unsigned char>	_data;
+        Wt::Dbo::ptr<Track>			_track;
+    };
+} // namespace Database
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "services/database/Artist.hpp"
+#include "services/database/Object.hpp"
+#include "services/database/Release.hpp"
+#include "services/database/ReleaseId.hpp"
+#include "services/database/TrackArtistLink.hpp"
+#include "services/database/TrackId.hpp"
+#include "services/database/Types.hpp"
+#include "utils/EnumSet.hpp"
+
+namespace Database
+{
+    class Session;
+    class Track;
+
+    // Releases, artist links and release artists of a set of tracks, bulk loaded using a few queries
+    // Meant to be used by list builders instead of querying these relations for each track
+    // Only valid during the transaction used to load it
+    class TrackRelations
+    {
+    public:
+        TrackRelations() = default;
+        TrackRelations(Session& session, const std::vector<TrackId>& trackIds);
+        TrackRelations(Session& session, const std::vector<ObjectPtr<Track>>& tracks);
+
+        bool contains(TrackId trackId) const { return _loadedTracks.find(trackId) != std::cend(_loadedTracks); }
+
+        ObjectPtr<Release>                      getRelease(TrackId trackId) const;
+        std::vector<ObjectPtr<TrackArtistLink>> getArtistLinks(TrackId trackId, std::optional<TrackArtistLinkType> linkType = std::nullopt) const;
+        std::vector<ObjectPtr<Artist>>          getArtists(TrackId trackId, EnumSet<TrackArtistLinkType> linkTypes) const; // no type means all
+        // artists for this type in all the tracks of the release (not only the loaded tracks)
+        std::vector<ObjectPtr<Artist>>          getReleaseArtists(ReleaseId releaseId, TrackArtistLinkType linkType) const;
+
+    private:
+        struct ArtistLink
+        {
+            ObjectPtr<TrackArtistLink> link;
+            ObjectPtr<Artist> artist;
+        };
+
+        struct ReleaseArtist
+        {
+            TrackArtistLinkType linkType;
+            ObjectPtr<Artist> artist;
+        };
+
+        std::unordered_set<TrackId> _loadedTracks;
+        std::unordered_map<TrackId, ObjectPtr<Release>> _releases;
+        std::unordered_map<TrackId, std::vector<ArtistLink>> _artistLinks;
+        std::unordered_map<ReleaseId, std::vector<ReleaseArtist>> _releaseArtists;
+    };
+} // namespace Database
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Optional per call site transaction statistics, to find the code paths that hold the write lock for long
+// Only the outermost transaction of a session is recorded
+namespace Database::TransactionProfiler
+{
+    enum class TransactionType
+    {
+        Unique,
+        Shared,
+    };
+
+    // Filled in at the caller site when used as a default argument
+    struct CallSite
+    {
+        static constexpr CallSite current(const char* file = __builtin_FILE(), unsigned line = __builtin_LINE()) { return CallSite{ file, line }; }
+
+        const char* file{};
+        unsigned line{};
+    };
+
+    struct Parameters
+    {
+        bool enabled{};
+        std::chrono::milliseconds longWaitThreshold{ 100 }; // transactions that waited longer are logged, 0 to disable
+        std::chrono::milliseconds longHoldThreshold{ 500 }; // transactions held longer are logged, 0 to disable
+    };
+    void setParameters(const Parameters& parameters);
+    bool isEnabled();
+
+    // wait: time to acquire the write lock (unique transactions) and to start the transaction
+    // hold: time from then to the end of the commit
+    void record(TransactionType type, const CallSite& site, std::chrono::steady_clock::duration wait, std::chrono::steady_clock::duration hold);
+
+    struct SiteStats
+    {
+        TransactionType type;
+        std::string site; // file:line, relative to the source directory
+        std::size_t count{};
+        std::chrono::microseconds totalWait{};
+        std::chrono::microseconds maxWait{};
+        std::chrono::microseconds totalHold{};
+        std::chrono::microseconds maxHold{};
+    };
+
+    void reset();
+
+    // Sorted by total hold duration, longest first
+    std::vector<SiteStats> getStats();
+    void dump(std::ostream& os);
+
+    // Measures the transaction it is a member of: must be constructed before the lock is acquired
+    class Timer
+    {
+    public:
+        Timer(TransactionType type, const CallSite& site, bool outermost);
+        ~Timer();
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+        void onStarted(); // once the lock and the transaction are acquired
+
+    private:
+        const TransactionType _type;
+        const CallSite _site;
+        const bool _enabled;
+        std::chrono::steady_clock::time_point _waitStart;
+        std::chrono::steady_clock::time_point _holdStart;
+    };
+} // namespace Database::TransactionProfiler
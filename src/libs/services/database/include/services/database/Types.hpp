@@ -108,6 +108,7 @@ namespace Database
     enum class ArtistSortMethod
     {
         None,
+        Id,
         ByName,
         BySortName,
         Random,
@@ -118,6 +119,7 @@ namespace Database
     enum class ReleaseSortMethod
     {
         None,
+        Id,
         Name,
         Date,
         OriginalDate,
@@ -137,6 +139,7 @@ namespace Database
     enum class TrackSortMethod
     {
         None,
+        Id,
         Random,
         LastWritten,
         StarredDateDesc,
@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <optional>
 #include <string_view>
 #include <vector>
@@ -68,12 +69,19 @@ namespace Database {
 
         User() = default;
 
+        bool hasOnPreRemove() const override { return true; }
+        void onPreRemove() override { onSettingsChanged(); }
+
         static std::size_t          getCount(Session& session);
         static pointer              find(Session& session, UserId id);
         static pointer              find(Session& session, std::string_view loginName);
         static RangeResults<UserId> find(Session& session, const FindParameters& params);
         static pointer              findDemoUser(Session& session);
 
+        // Incremented when the type, the backends or the Subsonic settings of any user are set, or when a user is removed
+        // Lets in-memory snapshots of these settings be checked without any query
+        static std::uint64_t        getSettingsGeneration();
+
         // accessors
         const std::string& getLoginName() const { return _loginName; }
         PasswordHash            getPasswordHash() const { return PasswordHash{ _passwordSalt, _passwordHash }; }
@@ -83,19 +91,20 @@ namespace Database {
         // write
         void setLastLogin(const Wt::WDateTime& dateTime) { _lastLogin = dateTime; }
         void setPasswordHash(const PasswordHash& passwordHash) { _passwordSalt = passwordHash.salt; _passwordHash = passwordHash.hash; }
-        void setType(UserType type) { _type = type; }
-        void setSubsonicEnableTranscodingByDefault(bool value) { _subsonicEnableTranscodingByDefault = value; }
-        void setSubsonicDefaultTranscodintOutputFormat(TranscodingOutputFormat encoding) { _subsonicDefaultTranscodingOutputFormat = encoding; }
+        void setType(UserType type) { _type = type; onSettingsChanged(); }
+        void setSubsonicEnableTranscodingByDefault(bool value) { _subsonicEnableTranscodingByDefault = value; onSettingsChanged(); }
+        void setSubsonicDefaultTranscodintOutputFormat(TranscodingOutputFormat encoding) { _subsonicDefaultTranscodingOutputFormat = encoding; onSettingsChanged(); }
         void setSubsonicDefaultTranscodingOutputBitrate(Bitrate bitrate);
         void setCurPlayingTrackPos(std::size_t pos) { _curPlayingTrackPos = pos; }
         void setRadio(bool val) { _radio = val; }
         void setRepeatAll(bool val) { _repeatAll = val; }
         void setUITheme(UITheme uiTheme) { _uiTheme = uiTheme; }
         void clearAuthTokens();
-        void setSubsonicArtistListMode(SubsonicArtistListMode mode) { _subsonicArtistListMode = mode; }
-        void setFeedbackBackend(FeedbackBackend feedbackBackend) { _feedbackBackend = feedbackBackend; }
-        void setScrobblingBackend(ScrobblingBackend scrobblingBackend) { _scrobblingBackend = scrobblingBackend; }
-        void setListenBrainzToken(const std::optional<UUID>& MBID) { _listenbrainzToken = MBID ? MBID->getAsString() : ""; }
+        void setSubsonicArtistListMode(SubsonicArtistListMode mode) { _subsonicArtistListMode = mode; onSettingsChanged(); }
+        void setFeedbackBackend(FeedbackBackend feedbackBackend) { _feedbackBackend = feedbackBackend; onSettingsChanged(); }
+        void setScrobblingBackend(ScrobblingBackend scrobblingBackend) { _scrobblingBackend = scrobblingBackend; onSettingsChanged(); }
+        void setListenBrainzToken(const std::optional<UUID>& MBID); // resets the listens high-water mark if changed
+        void setListenBrainzListensSyncedUntil(const Wt::WDateTime& dateTime) { _listenbrainzListensSyncedUntil = dateTime; }
 
         // read
         bool                    isAdmin() const { return _type == UserType::ADMIN; }
@@ -112,6 +121,7 @@ namespace Database {
         FeedbackBackend         getFeedbackBackend() const { return _feedbackBackend; }
         ScrobblingBackend       getScrobblingBackend() const { return _scrobblingBackend; }
         std::optional<UUID>     getListenBrainzToken() const { return UUID::fromString(_listenbrainzToken); }
+        const Wt::WDateTime&    getListenBrainzListensSyncedUntil() const { return _listenbrainzListensSyncedUntil; }
 
         template<class Action>
         void persist(Action& a)
@@ -129,6 +139,7 @@ namespace Database {
             Wt::Dbo::field(a, _feedbackBackend, "feedback_backend");
             Wt::Dbo::field(a, _scrobblingBackend, "scrobbling_backend");
             Wt::Dbo::field(a, _listenbrainzToken, "listenbrainz_token");
+            Wt::Dbo::field(a, _listenbrainzListensSyncedUntil, "listenbrainz_listens_synced_until");
 
             // UI player settings
             Wt::Dbo::field(a, _curPlayingTrackPos, "cur_playing_track_pos");
@@ -143,6 +154,8 @@ namespace Database {
         User(std::string_view loginName);
         static pointer create(Session& session, std::string_view loginName);
 
+        static void onSettingsChanged();
+
         std::string     _loginName;
         std::string     _passwordSalt;
         std::string     _passwordHash;
@@ -151,6 +164,7 @@ namespace Database {
         FeedbackBackend _feedbackBackend{ defaultFeedbackBackend };
         ScrobblingBackend _scrobblingBackend{ defaultScrobblingBackend };
         std::string     _listenbrainzToken; // Musicbrainz Identifier
+        Wt::WDateTime   _listenbrainzListensSyncedUntil; // most recent imported listen
 
         // Admin defined settings
         UserType        _type{ UserType::REGULAR };
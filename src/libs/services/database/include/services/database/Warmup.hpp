@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace Database
+{
+    class Db;
+    class Session;
+
+    // Reads the tables and indexes ahead at startup, so that the first requests do not have to wait for the disk
+    // The pages end up in the OS page cache, shared by all the connections (and directly used when the database is memory mapped)
+    namespace Warmup
+    {
+        struct Parameters
+        {
+            std::filesystem::path hotTablesFile; // tables used by the profiled queries, most used first: read before the other ones
+            std::size_t maxSize{}; // bytes, 0 means the whole database
+            std::size_t maxThroughput{}; // bytes per second, 0 means unlimited
+        };
+
+        // Blocking, returns early if abort is set
+        void run(const Db& db, const Parameters& parameters, const std::atomic<bool>& abort);
+
+        // Ranks the tables by the call count of the profiled queries using them
+        std::vector<std::string> getHotTables(Session& session);
+        void saveHotTables(Session& session, const std::filesystem::path& hotTablesFile);
+    } // namespace Warmup
+} // namespace Database
@@ -332,6 +332,8 @@ TEST_F(DatabaseFixture, Artist_findByNameEscaped)
     }
 
     {
+        ScopedNoFullTextSearch noFullTextSearch{ session.getDb() };
+
         auto transaction{ session.createSharedTransaction() };
         {
             const auto artists{ Artist::findIds(session, Artist::FindParameters {}.setKeywords({"MyArtist"})) };
@@ -360,6 +362,41 @@ TEST_F(DatabaseFixture, Artist_findByNameEscaped)
     }
 }
 
+TEST_F(DatabaseFixture, Artist_findByKeywordsFullTextSearch)
+{
+    if (!session.getDb().isFullTextSearchEnabled())
+        GTEST_SKIP() << "Full text search not available";
+
+    ScopedArtist artist1{ session, "The Beatles" };
+    ScopedArtist artist2{ session, "Beyoncé" };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        artist1.get().modify()->setSortName("Beatles, The");
+        artist2.get().modify()->setSortName("Knowles, Beyoncé");
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        EXPECT_TRUE(Artist::findIds(session, Artist::FindParameters{}.setKeywords({ "eat" })).results.empty());
+        EXPECT_TRUE(Artist::findIds(session, Artist::FindParameters{}.setKeywords({ "beatles", "knowles" })).results.empty());
+
+        const auto artistsByPrefix{ Artist::findIds(session, Artist::FindParameters{}.setKeywords({ "be" }).setSortMethod(ArtistSortMethod::ByName)) };
+        ASSERT_EQ(artistsByPrefix.results.size(), 2);
+        EXPECT_EQ(artistsByPrefix.results[0], artist1.getId());
+        EXPECT_EQ(artistsByPrefix.results[1], artist2.getId());
+
+        const auto artistsByDiacritics{ Artist::findIds(session, Artist::FindParameters{}.setKeywords({ "beyonce" })) };
+        ASSERT_EQ(artistsByDiacritics.results.size(), 1);
+        EXPECT_EQ(artistsByDiacritics.results.front(), artist2.getId());
+
+        const auto artistsBySortName{ Artist::findIds(session, Artist::FindParameters{}.setKeywords({ "know" })) };
+        ASSERT_EQ(artistsBySortName.results.size(), 1);
+        EXPECT_EQ(artistsBySortName.results.front(), artist2.getId());
+    }
+}
+
 TEST_F(DatabaseFixture, Artist_sortMethod)
 {
     ScopedArtist artistA{ session, "artistA" };
@@ -455,3 +492,37 @@ TEST_F(DatabaseFixture, Artist_findByRelease)
         EXPECT_EQ(artists.results.front(), artist.getId());
     }
 }
+
+TEST_F(DatabaseFixture, Artist_remove)
+{
+    ScopedTrack track{ session, "MyTrack" };
+    ScopedArtist artist1{ session, "MyArtist1" };
+    ScopedArtist artist2{ session, "MyArtist2" };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        TrackArtistLink::create(session, track.get(), artist1.get(), TrackArtistLinkType::Artist);
+        TrackArtistLink::create(session, track.get(), artist2.get(), TrackArtistLinkType::Artist);
+    }
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        Artist::remove(session, {});
+        EXPECT_EQ(Artist::getCount(session), 2);
+
+        Artist::remove(session, { artist1.getId() });
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        EXPECT_EQ(Artist::getCount(session), 1);
+        EXPECT_FALSE(Artist::exists(session, artist1.getId()));
+        EXPECT_TRUE(Track::exists(session, track.getId()));
+
+        // the links are removed along with the artist
+        const auto artists{ Artist::findIds(session, Artist::FindParameters{}.setTrack(track.getId())) };
+        ASSERT_EQ(artists.results.size(), 1);
+        EXPECT_EQ(artists.results.front(), artist2.getId());
+    }
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Common.hpp"
+
+#include <thread>
+
+#include "services/database/Backup.hpp"
+
+using namespace Database;
+
+TEST_F(DatabaseFixture, Backup)
+{
+    ScopedTrack track{ session, "MyTrack" };
+
+    BackupService::Parameters parameters;
+    parameters.directory = std::filesystem::path{ std::tmpnam(nullptr) };
+    parameters.keepCount = 1;
+
+    auto waitForBackup{ [&](BackupService& backup)
+    {
+        backup.requestBackup();
+        while (true)
+        {
+            const BackupService::Status status{ backup.getStatus() };
+            if (!status.inProgress && status.lastBackupTime)
+                return status;
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 10 });
+        }
+    } };
+
+    std::filesystem::path backupPath;
+    {
+        BackupService backup{ session.getDb(), parameters };
+        const BackupService::Status status{ waitForBackup(backup) };
+        EXPECT_EQ(status.lastError, "");
+        ASSERT_TRUE(std::filesystem::exists(status.lastBackupPath));
+        backupPath = status.lastBackupPath;
+    }
+
+    {
+        Db backupDb{ backupPath };
+        Session backupSession{ backupDb };
+        auto transaction{ backupSession.createSharedTransaction() };
+
+        EXPECT_EQ(Track::getCount(backupSession), 1);
+        EXPECT_EQ(Track::find(backupSession, track.getId())->getName(), "MyTrack");
+    }
+
+    std::filesystem::remove_all(parameters.directory);
+}
+
+TEST_F(DatabaseFixture, Backup_restore)
+{
+    ScopedTrack track{ session, "MyTrack" };
+
+    BackupService::Parameters parameters;
+    parameters.directory = std::filesystem::path{ std::tmpnam(nullptr) };
+
+    {
+        BackupService backup{ session.getDb(), parameters };
+        backup.requestBackup();
+        while (BackupService::findBackups(parameters.directory).empty())
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 10 });
+    }
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        session.getDboSession().execute("UPDATE track SET name = 'MyOtherTrack'");
+    }
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        BackupService::restoreBackup(session, BackupService::findBackups(parameters.directory).back());
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+        EXPECT_EQ(session.getDboSession().query<std::string>("SELECT name FROM track").resultValue(), "MyTrack");
+    }
+
+    std::filesystem::remove_all(parameters.directory);
+}
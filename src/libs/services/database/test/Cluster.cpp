@@ -207,6 +207,76 @@ TEST_F(DatabaseFixture, Cluster_singleTrackWithSeveralClusters)
     }
 }
 
+TEST_F(DatabaseFixture, Cluster_index)
+{
+    ScopedRelease release1{ session, "MyRelease1" };
+    ScopedRelease release2{ session, "MyRelease2" };
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+    ScopedTrack track3{ session, "MyTrack3" };
+    ScopedClusterType clusterType{ session, "MyClusterType" };
+    ScopedCluster cluster1{ session, clusterType.lockAndGet(), "MyCluster1" };
+    ScopedCluster cluster2{ session, clusterType.lockAndGet(), "MyCluster2" };
+    ScopedCluster unusedCluster{ session, clusterType.lockAndGet(), "MyUnusedCluster" };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+
+        // release1: one track with both clusters
+        track1.get().modify()->setRelease(release1.get());
+        cluster1.get().modify()->addTrack(track1.get());
+        cluster2.get().modify()->addTrack(track1.get());
+
+        // release2: both clusters, but not on the same track
+        track2.get().modify()->setRelease(release2.get());
+        cluster1.get().modify()->addTrack(track2.get());
+        track3.get().modify()->setRelease(release2.get());
+        cluster2.get().modify()->addTrack(track3.get());
+    }
+
+    const std::vector<ClusterId> clusterIds{ cluster1.getId(), cluster2.getId() };
+    const std::vector<ClusterId> clusterIdsWithUnused{ cluster1.getId(), unusedCluster.getId() };
+
+    auto checkFindResults{ [&]
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        const auto tracks{ Track::findIds(session, Track::FindParameters{}.setClusters(clusterIds)) };
+        ASSERT_EQ(tracks.results.size(), 1);
+        EXPECT_EQ(tracks.results.front(), track1.getId());
+
+        const auto releases{ Release::findIds(session, Release::FindParameters{}.setClusters(clusterIds)) };
+        ASSERT_EQ(releases.results.size(), 1);
+        EXPECT_EQ(releases.results.front(), release1.getId());
+
+        EXPECT_TRUE(Track::findIds(session, Track::FindParameters{}.setClusters(clusterIdsWithUnused)).results.empty());
+        EXPECT_TRUE(Release::findIds(session, Release::FindParameters{}.setClusters(clusterIdsWithUnused)).results.empty());
+    } };
+
+    // SQL queries
+    checkFindResults();
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        const std::shared_ptr<const ClusterIndex> index{ ClusterIndex::build(session) };
+        ASSERT_TRUE(index);
+        EXPECT_EQ(index->getTracks(clusterIds).toVector(), std::vector<RoaringBitmap::value_type>{ static_cast<RoaringBitmap::value_type>(track1.getId().getValue()) });
+        EXPECT_EQ(index->getReleases(clusterIds).toVector(), std::vector<RoaringBitmap::value_type>{ static_cast<RoaringBitmap::value_type>(release1.getId().getValue()) });
+        EXPECT_EQ(index->getTracks({ cluster1.getId() }).size(), 2);
+        EXPECT_EQ(index->getReleases({ cluster1.getId() }).size(), 2);
+        EXPECT_TRUE(index->getTracks(clusterIdsWithUnused).empty());
+
+        session.getDb().setClusterIndex(index);
+    }
+
+    // same results using the index
+    checkFindResults();
+
+    // the database is shared by all the tests
+    session.getDb().setClusterIndex(nullptr);
+}
+
 TEST_F(DatabaseFixture, Cluster_multiTracks)
 {
     std::list<ScopedTrack> tracks;
@@ -310,6 +380,20 @@ TEST_F(DatabaseFixture, Cluster_singleTrackSingleReleaseSingleCluster)
         EXPECT_EQ(Cluster::computeReleaseCount(session, unusedCluster.getId()), 0);
         EXPECT_EQ(Cluster::computeTrackCount(session, unusedCluster.getId()), 0);
     }
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        Cluster::updateCounts(session);
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        EXPECT_EQ(cluster->getReleasesCount(), 1);
+        EXPECT_EQ(cluster->getTracksCount(), 1);
+        EXPECT_EQ(unusedCluster->getReleasesCount(), 0);
+        EXPECT_EQ(unusedCluster->getTracksCount(), 0);
+    }
 }
 
 TEST_F(DatabaseFixture, SingleTrackSingleArtistMultiClusters)
@@ -818,3 +902,76 @@ TEST_F(DatabaseFixture, MultipleTracksMultipleReleasesMultiClusters)
         }
     }
 }
+
+TEST_F(DatabaseFixture, Cluster_updateCountsScoped)
+{
+    ScopedTrack track{ session, "MyTrackFile" };
+    ScopedClusterType clusterType{ session, "MyType" };
+    ScopedCluster cluster1{ session, clusterType.lockAndGet(), "Cluster1" };
+    ScopedCluster cluster2{ session, clusterType.lockAndGet(), "Cluster2" };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+
+        cluster1.get().modify()->addTrack(track.get());
+        cluster2.get().modify()->addTrack(track.get());
+    }
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        Cluster::updateCounts(session, { cluster1.getId() });
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        EXPECT_EQ(cluster1->getTracksCount(), 1);
+        EXPECT_EQ(cluster2->getTracksCount(), 0);
+    }
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        Cluster::updateCounts(session, {});
+        Cluster::updateCounts(session, { cluster2.getId() });
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+        EXPECT_EQ(cluster2->getTracksCount(), 1);
+    }
+}
+
+TEST_F(DatabaseFixture, Cluster_remove)
+{
+    ScopedTrack track{ session, "MyTrack" };
+    ScopedClusterType clusterType{ session, "MyType" };
+    ScopedCluster cluster1{ session, clusterType.lockAndGet(), "MyCluster1" };
+    ScopedCluster cluster2{ session, clusterType.lockAndGet(), "MyCluster2" };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        cluster1.get().modify()->addTrack(track.get());
+        cluster2.get().modify()->addTrack(track.get());
+    }
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        Cluster::remove(session, {});
+        EXPECT_EQ(Cluster::getCount(session), 2);
+
+        Cluster::remove(session, { cluster1.getId() });
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        EXPECT_EQ(Cluster::getCount(session), 1);
+        EXPECT_FALSE(Cluster::find(session, cluster1.getId()));
+        EXPECT_TRUE(Track::exists(session, track.getId()));
+
+        // the track links are removed along with the cluster
+        const auto clusters{ Cluster::findIds(session, Cluster::FindParameters{}.setTrack(track.getId())) };
+        ASSERT_EQ(clusters.results.size(), 1);
+        EXPECT_EQ(clusters.results.front(), cluster2.getId());
+    }
+}
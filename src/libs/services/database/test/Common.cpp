@@ -87,7 +87,9 @@ void DatabaseFixture::testDatabaseEmpty()
     EXPECT_EQ(Artist::getCount(session), 0);
     EXPECT_EQ(Cluster::getCount(session), 0);
     EXPECT_EQ(ClusterType::getCount(session), 0);
+    EXPECT_EQ(DirectoryFingerprint::getCount(session), 0);
     EXPECT_EQ(Listen::getCount(session), 0);
+    EXPECT_EQ(Listen::getArchivedCount(session), 0);
     EXPECT_EQ(Release::getCount(session), 0);
     EXPECT_EQ(StarredArtist::getCount(session), 0);
     EXPECT_EQ(StarredRelease::getCount(session), 0);
@@ -26,7 +26,10 @@
 
 #include "services/database/Artist.hpp"
 #include "services/database/Cluster.hpp"
+#include "services/database/ClusterIndex.hpp"
 #include "services/database/Db.hpp"
+#include "services/database/DirectoryFingerprint.hpp"
+#include "services/database/LibraryCatalog.hpp"
 #include "services/database/Listen.hpp"
 #include "services/database/Release.hpp"
 #include "services/database/ScanSettings.hpp"
@@ -121,6 +124,23 @@ class ScopedFileDeleter final
 		const std::filesystem::path _path;
 };
 
+// Forces keyword searches to use LIKE patterns instead of the full text search index
+class ScopedNoFullTextSearch final
+{
+	public:
+		ScopedNoFullTextSearch(Database::Db& db) : _db {db}, _wasEnabled {db.isFullTextSearchEnabled()} { _db.setFullTextSearchEnabled(false); }
+		~ScopedNoFullTextSearch() { _db.setFullTextSearchEnabled(_wasEnabled); }
+
+		ScopedNoFullTextSearch(const ScopedNoFullTextSearch&) = delete;
+		ScopedNoFullTextSearch(ScopedNoFullTextSearch&&) = delete;
+		ScopedNoFullTextSearch operator=(const ScopedNoFullTextSearch&) = delete;
+		ScopedNoFullTextSearch operator=(ScopedNoFullTextSearch&&) = delete;
+
+	private:
+		Database::Db& _db;
+		const bool _wasEnabled;
+};
+
 class TmpDatabase final
 {
 	public:
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Common.hpp"
+
+using namespace Database;
+
+using ScopedDirectoryFingerprint = ScopedEntity<Database::DirectoryFingerprint>;
+
+TEST_F(DatabaseFixture, DirectoryFingerprint)
+{
+	{
+		auto transaction {session.createSharedTransaction()};
+		EXPECT_EQ(DirectoryFingerprint::getCount(session), 0);
+	}
+
+	const std::filesystem::path directory {"/root/artist/release"};
+	const Wt::WDateTime lastWriteTime {Wt::WDate {2023, 1, 2}, Wt::WTime {3, 4, 5}};
+	ScopedDirectoryFingerprint fingerprint {session, directory};
+
+	{
+		auto transaction {session.createUniqueTransaction()};
+
+		fingerprint.get().modify()->setLastWriteTime(lastWriteTime);
+		fingerprint.get().modify()->setEntryCount(12);
+		fingerprint.get().modify()->setScanVersion(3);
+	}
+
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		EXPECT_EQ(DirectoryFingerprint::getCount(session), 1);
+		EXPECT_EQ(DirectoryFingerprint::find(session, directory), fingerprint.get());
+		EXPECT_FALSE(DirectoryFingerprint::find(session, directory.parent_path()));
+
+		std::vector<DirectoryFingerprint::FindResult> results;
+		DirectoryFingerprint::find(session, [&](const DirectoryFingerprint::FindResult& result) { results.push_back(result); });
+
+		ASSERT_EQ(results.size(), 1);
+		EXPECT_EQ(results.front().directory, directory);
+		EXPECT_EQ(results.front().lastWriteTime, lastWriteTime);
+		EXPECT_EQ(results.front().entryCount, 12);
+		EXPECT_EQ(results.front().scanVersion, 3);
+	}
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+#include "Common.hpp"
+
+#include "services/database/IndexAdvisor.hpp"
+#include "services/database/QueryProfiler.hpp"
+
+using namespace Database;
+
+namespace
+{
+    const IndexAdvisor::QueryReport* findQueryReport(const IndexAdvisor::Report& report, std::string_view query)
+    {
+        auto it{ std::find_if(std::cbegin(report.queries), std::cend(report.queries), [&](const IndexAdvisor::QueryReport& queryReport) { return queryReport.query == query; }) };
+        return it != std::cend(report.queries) ? &(*it) : nullptr;
+    }
+}
+
+TEST_F(DatabaseFixture, IndexAdvisor_analyze)
+{
+    constexpr std::string_view fullScanQuery{ "SELECT t.id from track t WHERE (t.copyright = ?) ORDER BY t.copyright_url" };
+    constexpr std::string_view indexedQuery{ "SELECT t.id from track t WHERE (t.name = ?)" };
+
+    QueryProfiler::reset();
+    QueryProfiler::record(fullScanQuery, std::chrono::milliseconds{ 2 }, 1);
+    QueryProfiler::record(indexedQuery, std::chrono::milliseconds{ 1 }, 1);
+    QueryProfiler::record("SELECT nothing FROM unknown_table", std::chrono::milliseconds{ 1 }, 0);
+
+    const IndexAdvisor::Report report{ IndexAdvisor::analyze(session.getDb()) };
+    EXPECT_EQ(report.analyzedQueryCount, 2);
+    EXPECT_EQ(findQueryReport(report, indexedQuery), nullptr);
+
+    const IndexAdvisor::QueryReport* queryReport{ findQueryReport(report, fullScanQuery) };
+    ASSERT_NE(queryReport, nullptr);
+    EXPECT_FALSE(queryReport->plan.empty());
+    EXPECT_EQ(queryReport->fullScans, std::vector<std::string>{ "t" });
+    EXPECT_TRUE(queryReport->usesTempBTree);
+    ASSERT_EQ(queryReport->proposedIndexes.size(), 1);
+    EXPECT_EQ(queryReport->proposedIndexes.front(), "CREATE INDEX IF NOT EXISTS advised_track_copyright_copyright_url_idx ON track(copyright,copyright_url)");
+    EXPECT_EQ(report.proposedIndexes, queryReport->proposedIndexes);
+
+    std::ostringstream oss;
+    IndexAdvisor::dump(report, oss);
+    EXPECT_NE(oss.str().find(report.proposedIndexes.front()), std::string::npos);
+
+    QueryProfiler::reset();
+}
+
+TEST_F(DatabaseFixture, IndexAdvisor_createIndexes)
+{
+    constexpr std::string_view query{ "SELECT t.id from track t WHERE (t.copyright = ?)" };
+
+    QueryProfiler::reset();
+    QueryProfiler::record(query, std::chrono::milliseconds{ 1 }, 1);
+
+    const IndexAdvisor::Report report{ IndexAdvisor::analyze(session.getDb()) };
+    ASSERT_EQ(report.proposedIndexes.size(), 1);
+
+    // only the advised indexes can be created
+    EXPECT_EQ(IndexAdvisor::createIndexes(session, { "DROP TABLE track" }), 0);
+    EXPECT_EQ(IndexAdvisor::createIndexes(session, report.proposedIndexes), 1);
+
+    // the query now uses the new index
+    EXPECT_EQ(findQueryReport(IndexAdvisor::analyze(session.getDb()), query), nullptr);
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        session.getDboSession().execute("DROP INDEX advised_track_copyright_idx");
+    }
+
+    QueryProfiler::reset();
+}
@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <list>
+#include <set>
+
+#include "Common.hpp"
+
+using namespace Database;
+
+TEST_F(DatabaseFixture, LibraryCatalog)
+{
+    ScopedArtist artistB{ session, "b-artist" };
+    ScopedArtist artistA{ session, "A-artist" };
+    ScopedArtist orphanArtist{ session, "c-artist" };
+    ScopedRelease releaseB{ session, "b-release" };
+    ScopedRelease releaseA{ session, "A-release" };
+    ScopedTrack track1{ session, "b-track" };
+    ScopedTrack track2{ session, "A-track" };
+    ScopedClusterType clusterType{ session, "MyClusterType" };
+    ScopedCluster cluster1{ session, clusterType.lockAndGet(), "MyCluster1" };
+    ScopedCluster cluster2{ session, clusterType.lockAndGet(), "MyCluster2" };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+
+        artistA.get().modify()->setSortName("z-artist");
+        releaseA.get().modify()->setPrimaryType(ReleaseTypePrimary::Album);
+        track1.get().modify()->setRelease(releaseB.get());
+        track1.get().modify()->setLastWriteTime(Wt::WDateTime::fromTime_t(1000));
+        track2.get().modify()->setRelease(releaseA.get());
+        track2.get().modify()->setLastWriteTime(Wt::WDateTime::fromTime_t(2000));
+        TrackArtistLink::create(session, track1.get(), artistB.get(), TrackArtistLinkType::Artist);
+        TrackArtistLink::create(session, track2.get(), artistA.get(), TrackArtistLinkType::ReleaseArtist);
+        cluster1.get().modify()->addTrack(track1.get());
+        cluster1.get().modify()->addTrack(track2.get());
+        cluster2.get().modify()->addTrack(track2.get());
+    }
+
+    auto checkFindResults{ [&]
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        EXPECT_EQ(Artist::findIds(session, Artist::FindParameters{}.setSortMethod(ArtistSortMethod::ByName)).results, (std::vector<ArtistId>{ artistA.getId(), artistB.getId(), orphanArtist.getId() }));
+        EXPECT_EQ(Artist::findIds(session, Artist::FindParameters{}.setSortMethod(ArtistSortMethod::BySortName)).results, (std::vector<ArtistId>{ artistB.getId(), orphanArtist.getId(), artistA.getId() }));
+        EXPECT_EQ(Artist::findIds(session, Artist::FindParameters{}.setLinkType(TrackArtistLinkType::ReleaseArtist)).results, std::vector<ArtistId>{ artistA.getId() });
+
+        {
+            const auto artists{ Artist::find(session, Artist::FindParameters{}.setSortMethod(ArtistSortMethod::ByName).setRange(Range{ 1, 1 })) };
+            ASSERT_EQ(artists.results.size(), 1);
+            EXPECT_EQ(artists.results.front()->getId(), artistB.getId());
+            EXPECT_EQ(artists.range.offset, 1);
+            EXPECT_TRUE(artists.moreResults);
+        }
+
+        EXPECT_EQ(Release::findIds(session, Release::FindParameters{}.setSortMethod(ReleaseSortMethod::Name)).results, (std::vector<ReleaseId>{ releaseA.getId(), releaseB.getId() }));
+        EXPECT_EQ(Release::findIds(session, Release::FindParameters{}.setClusters({ cluster1.getId() }).setSortMethod(ReleaseSortMethod::Name)).results, (std::vector<ReleaseId>{ releaseA.getId(), releaseB.getId() }));
+        EXPECT_EQ(Release::findIds(session, Release::FindParameters{}.setClusters({ cluster1.getId(), cluster2.getId() })).results, std::vector<ReleaseId>{ releaseA.getId() });
+        {
+            Release::FindParameters params;
+            params.primaryType = ReleaseTypePrimary::Album;
+            EXPECT_EQ(Release::findIds(session, params).results, std::vector<ReleaseId>{ releaseA.getId() });
+        }
+
+        EXPECT_EQ(Track::findIds(session, Track::FindParameters{}.setSortMethod(TrackSortMethod::Name)).results, (std::vector<TrackId>{ track2.getId(), track1.getId() }));
+        EXPECT_EQ(Track::findIds(session, Track::FindParameters{}.setSortMethod(TrackSortMethod::LastWritten)).results, (std::vector<TrackId>{ track2.getId(), track1.getId() }));
+        EXPECT_EQ(Track::findIds(session, Track::FindParameters{}.setSortMethod(TrackSortMethod::Id).setAfterId(track1.getId())).results, std::vector<TrackId>{ track2.getId() });
+        EXPECT_EQ(Track::findIds(session, Track::FindParameters{}.setClusters({ cluster2.getId() })).results, std::vector<TrackId>{ track2.getId() });
+        EXPECT_EQ(Track::findIds(session, Track::FindParameters{}.setSortMethod(TrackSortMethod::Random).setRange(Range{ 0, 5 })).results.size(), 2);
+    } };
+
+    // SQL queries
+    checkFindResults();
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        const std::shared_ptr<const LibraryCatalog> catalog{ LibraryCatalog::build(session, ClusterIndex::build(session)) };
+        ASSERT_TRUE(catalog);
+        EXPECT_EQ(catalog->getArtistCount(), 3);
+        EXPECT_EQ(catalog->getReleaseCount(), 2);
+        EXPECT_EQ(catalog->getTrackCount(), 2);
+
+        // not handled by the catalog
+        EXPECT_FALSE(catalog->findTrackIds(Track::FindParameters{}.setKeywords({ "track" })));
+        EXPECT_FALSE(catalog->findReleaseIds(Release::FindParameters{}.setSortMethod(ReleaseSortMethod::Date)));
+        EXPECT_FALSE(catalog->findArtistIds(Artist::FindParameters{}.setClusters({ cluster1.getId() })));
+        EXPECT_TRUE(catalog->findTrackIds(Track::FindParameters{}));
+
+        session.getDb().setLibraryCatalog(catalog);
+    }
+
+    // same results using the catalog
+    checkFindResults();
+
+    // the database is shared by all the tests
+    session.getDb().setLibraryCatalog(nullptr);
+}
+
+TEST_F(DatabaseFixture, LibraryCatalog_randomTracks)
+{
+    std::list<ScopedTrack> tracks;
+    for (std::size_t i{}; i < 5; ++i)
+        tracks.emplace_back(session, "MyTrack" + std::to_string(i));
+    ScopedClusterType clusterType{ session, "MyClusterType" };
+    ScopedCluster cluster{ session, clusterType.lockAndGet(), "MyCluster" };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        cluster.get().modify()->addTrack(tracks.front().get());
+        cluster.get().modify()->addTrack(tracks.back().get());
+    }
+
+    auto transaction{ session.createSharedTransaction() };
+
+    const std::shared_ptr<const LibraryCatalog> catalog{ LibraryCatalog::build(session, ClusterIndex::build(session)) };
+    ASSERT_TRUE(catalog);
+
+    const Track::FindParameters params{ Track::FindParameters{}.setSortMethod(TrackSortMethod::Random).setRange(Range{ 0, 2 }) };
+
+    // consecutive pages do not repeat tracks until the whole permutation is consumed
+    std::set<TrackId> visitedTrackIds;
+    for (std::size_t i{}; i < 2; ++i)
+    {
+        const auto page{ catalog->findTrackIds(params) };
+        ASSERT_TRUE(page);
+        EXPECT_EQ(page->results.size(), 2);
+        EXPECT_TRUE(page->moreResults);
+        visitedTrackIds.insert(std::cbegin(page->results), std::cend(page->results));
+    }
+    EXPECT_EQ(visitedTrackIds.size(), 4);
+
+    // reshuffled, no duplicates in a page
+    {
+        const auto page{ catalog->findTrackIds(params) };
+        ASSERT_TRUE(page);
+        ASSERT_EQ(page->results.size(), 2);
+        EXPECT_NE(page->results[0], page->results[1]);
+    }
+
+    // per filter pools
+    {
+        const auto page{ catalog->findTrackIds(Track::FindParameters{ params }.setClusters({ cluster.getId() }).setRange(Range{ 0, 5 })) };
+        ASSERT_TRUE(page);
+        const std::set<TrackId> trackIds(std::cbegin(page->results), std::cend(page->results));
+        EXPECT_EQ(trackIds, (std::set<TrackId>{ tracks.front().getId(), tracks.back().getId() }));
+        EXPECT_FALSE(page->moreResults);
+    }
+}
+
+TEST_F(DatabaseFixture, LibraryCatalog_browse)
+{
+    ScopedArtist artist{ session, "MyArtist" };
+    ScopedArtist otherArtist{ session, "MyOtherArtist" };
+    ScopedRelease release{ session, "MyRelease" };
+    ScopedRelease otherRelease{ session, "MyOtherRelease" };
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+    ScopedTrack track3{ session, "MyTrack3" };
+    ScopedTrack otherTrack{ session, "MyOtherTrack" };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+
+        // tracks are not created in disc and track number order
+        track1.get().modify()->setRelease(release.get());
+        track1.get().modify()->setDiscNumber(2);
+        track1.get().modify()->setTrackNumber(1);
+        track2.get().modify()->setRelease(release.get());
+        track2.get().modify()->setDiscNumber(1);
+        track2.get().modify()->setTrackNumber(2);
+        track3.get().modify()->setRelease(release.get());
+        track3.get().modify()->setDiscNumber(1);
+        track3.get().modify()->setTrackNumber(1);
+        otherTrack.get().modify()->setRelease(otherRelease.get());
+
+        TrackArtistLink::create(session, track1.get(), artist.get(), TrackArtistLinkType::Artist);
+        TrackArtistLink::create(session, track2.get(), artist.get(), TrackArtistLinkType::ReleaseArtist);
+        TrackArtistLink::create(session, otherTrack.get(), artist.get(), TrackArtistLinkType::Composer);
+        TrackArtistLink::create(session, otherTrack.get(), otherArtist.get(), TrackArtistLinkType::Artist);
+    }
+
+    auto checkFindResults{ [&]
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        EXPECT_EQ(Release::findIds(session, Release::FindParameters{}.setArtist(artist.getId()).setSortMethod(ReleaseSortMethod::Name)).results, (std::vector<ReleaseId>{ otherRelease.getId(), release.getId() }));
+        EXPECT_EQ(Release::findIds(session, Release::FindParameters{}.setArtist(otherArtist.getId())).results, std::vector<ReleaseId>{ otherRelease.getId() });
+        EXPECT_EQ(Release::findIds(session, Release::FindParameters{}.setArtist(artist.getId(), { TrackArtistLinkType::ReleaseArtist })).results, std::vector<ReleaseId>{ release.getId() });
+        EXPECT_EQ(Release::findIds(session, Release::FindParameters{}.setArtist(artist.getId(), {}, { TrackArtistLinkType::ReleaseArtist })).results, std::vector<ReleaseId>{ otherRelease.getId() });
+        EXPECT_TRUE(Release::findIds(session, Release::FindParameters{}.setArtist(otherArtist.getId(), { TrackArtistLinkType::Composer })).results.empty());
+
+        EXPECT_EQ(Track::findIds(session, Track::FindParameters{}.setRelease(release.getId()).setSortMethod(TrackSortMethod::Release)).results, (std::vector<TrackId>{ track3.getId(), track2.getId(), track1.getId() }));
+        EXPECT_EQ(Track::findIds(session, Track::FindParameters{}.setRelease(release.getId()).setSortMethod(TrackSortMethod::Id)).results, (std::vector<TrackId>{ track1.getId(), track2.getId(), track3.getId() }));
+        EXPECT_EQ(Track::findIds(session, Track::FindParameters{}.setRelease(otherRelease.getId())).results, std::vector<TrackId>{ otherTrack.getId() });
+        {
+            const auto tracks{ Track::find(session, Track::FindParameters{}.setRelease(release.getId()).setSortMethod(TrackSortMethod::Release).setRange(Range{ 1, 1 })) };
+            ASSERT_EQ(tracks.results.size(), 1);
+            EXPECT_EQ(tracks.results.front()->getId(), track2.getId());
+            EXPECT_TRUE(tracks.moreResults);
+        }
+    } };
+
+    // SQL queries
+    checkFindResults();
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        const std::shared_ptr<const LibraryCatalog> catalog{ LibraryCatalog::build(session, ClusterIndex::build(session)) };
+        ASSERT_TRUE(catalog);
+        EXPECT_TRUE(catalog->findReleaseIds(Release::FindParameters{}.setArtist(artist.getId())));
+        EXPECT_TRUE(catalog->findTrackIds(Track::FindParameters{}.setRelease(release.getId()).setSortMethod(TrackSortMethod::Release)));
+        EXPECT_FALSE(catalog->findTrackIds(Track::FindParameters{}.setSortMethod(TrackSortMethod::Release)));
+
+        session.getDb().setLibraryCatalog(catalog);
+    }
+
+    // same results using the catalog
+    checkFindResults();
+
+    session.getDb().setLibraryCatalog(nullptr);
+}
@@ -143,6 +143,40 @@ TEST_F(DatabaseFixture, Listen_get_byDateTime)
     }
 }
 
+TEST_F(DatabaseFixture, Listen_get_byDateTimeRange)
+{
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+    ScopedUser user{ session, "MyUser" };
+    const Wt::WDateTime dateTime1{ Wt::WDate{2000, 1, 2}, Wt::WTime{12,0, 1} };
+    const Wt::WDateTime dateTime2{ Wt::WDate{2000, 1, 2}, Wt::WTime{12,0, 2} };
+    const Wt::WDateTime dateTime3{ Wt::WDate{2000, 1, 2}, Wt::WTime{12,0, 3} };
+
+    ScopedListen listen1{ session, user.lockAndGet(), track1.lockAndGet(), ScrobblingBackend::ListenBrainz, dateTime1 };
+    ScopedListen listen2{ session, user.lockAndGet(), track2.lockAndGet(), ScrobblingBackend::ListenBrainz, dateTime2 };
+    ScopedListen listen3{ session, user.lockAndGet(), track1.lockAndGet(), ScrobblingBackend::ListenBrainz, dateTime3 };
+    ScopedListen listen4{ session, user.lockAndGet(), track1.lockAndGet(), ScrobblingBackend::Internal, dateTime2 };
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        const auto listens{ Listen::find(session, user.getId(), ScrobblingBackend::ListenBrainz, dateTime1, dateTime2) };
+        ASSERT_EQ(listens.size(), 2);
+        EXPECT_EQ(listens[0]->getId(), listen1.getId());
+        EXPECT_EQ(listens[0]->getTrackId(), track1.getId());
+        EXPECT_EQ(listens[1]->getId(), listen2.getId());
+        EXPECT_EQ(listens[1]->getTrackId(), track2.getId());
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        EXPECT_EQ(Listen::find(session, user.getId(), ScrobblingBackend::ListenBrainz, dateTime3.addSecs(1), dateTime3.addSecs(10)).size(), 0);
+        EXPECT_EQ(Listen::find(session, user.getId(), ScrobblingBackend::Internal, dateTime1, dateTime3).size(), 1);
+    }
+}
+
+
 TEST_F(DatabaseFixture, Listen_getTopArtists)
 {
     ScopedTrack track1{ session, "MyTrack" };
@@ -478,6 +512,45 @@ TEST_F(DatabaseFixture, Listen_getTopTrack_multi)
     }
 }
 
+TEST_F(DatabaseFixture, Listen_getTopTracks_allUsers)
+{
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+    ScopedTrack track3{ session, "MyTrack3" };
+    ScopedUser user1{ session, "MyUser1" };
+    ScopedUser user2{ session, "MyUser2" };
+    const Wt::WDateTime dateTime{ Wt::WDate{2000, 1, 2}, Wt::WTime{12,0, 1} };
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        auto tracks{ Listen::getTopTracks(session) };
+        EXPECT_EQ(tracks.moreResults, false);
+        EXPECT_EQ(tracks.results.size(), 0);
+    }
+
+    ScopedListen listen1{ session, user1.lockAndGet(), track1.lockAndGet(), ScrobblingBackend::Internal, dateTime };
+    ScopedListen listen2{ session, user1.lockAndGet(), track2.lockAndGet(), ScrobblingBackend::Internal, dateTime };
+    ScopedListen listen3{ session, user2.lockAndGet(), track2.lockAndGet(), ScrobblingBackend::ListenBrainz, dateTime };
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        auto tracks{ Listen::getTopTracks(session) };
+        EXPECT_EQ(tracks.moreResults, false);
+        ASSERT_EQ(tracks.results.size(), 2);
+        EXPECT_EQ(tracks.results[0], track2.getId());
+        EXPECT_EQ(tracks.results[1], track1.getId());
+    }
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        auto tracks{ Listen::getTopTracks(session, Range{ 0, 1 }) };
+        EXPECT_EQ(tracks.moreResults, true);
+        ASSERT_EQ(tracks.results.size(), 1);
+        EXPECT_EQ(tracks.results[0], track2.getId());
+    }
+}
+
 TEST_F(DatabaseFixture, Listen_getTopTracks_cluster)
 {
     ScopedTrack track{ session, "MyTrack" };
@@ -873,6 +946,43 @@ TEST_F(DatabaseFixture, Listen_getRecentTracks)
     }
 }
 
+TEST_F(DatabaseFixture, Listen_getRecentTracks_remove)
+{
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+    ScopedUser user{ session, "MyUser" };
+
+    auto getRecentTracks{ [&]
+    {
+        auto transaction{ session.createSharedTransaction() };
+        return Listen::getRecentTracks(session, user->getId(), ScrobblingBackend::Internal, {}).results;
+    } };
+
+    const Wt::WDateTime dateTime{ Wt::WDate {2000, 1, 2}, Wt::WTime {12,0, 1} };
+    ScopedListen listen1{ session, user.lockAndGet(), track1.lockAndGet(), ScrobblingBackend::Internal, dateTime };
+    ScopedListen listen2{ session, user.lockAndGet(), track2.lockAndGet(), ScrobblingBackend::Internal, dateTime.addSecs(1) };
+    ScopedListen listen3{ session, user.lockAndGet(), track1.lockAndGet(), ScrobblingBackend::Internal, dateTime.addSecs(2) };
+
+    {
+        const auto tracks{ getRecentTracks() };
+        ASSERT_EQ(tracks.size(), 2);
+        EXPECT_EQ(tracks[0], track1.getId());
+        EXPECT_EQ(tracks[1], track2.getId());
+    }
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        listen3.get().remove();
+    }
+
+    {
+        const auto tracks{ getRecentTracks() };
+        ASSERT_EQ(tracks.size(), 2);
+        EXPECT_EQ(tracks[0], track2.getId());
+        EXPECT_EQ(tracks[1], track1.getId());
+    }
+}
+
 TEST_F(DatabaseFixture, Listen_getCount_track)
 {
     ScopedTrack track{ session, "MyTrack" };
@@ -938,6 +1048,54 @@ TEST_F(DatabaseFixture, Listen_getCount_release)
     EXPECT_EQ(getReleaseListenCount(), 2);
 }
 
+TEST_F(DatabaseFixture, Listen_getCounts)
+{
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+    ScopedTrack track3{ session, "MyTrack3" };
+    ScopedUser user{ session, "MyUser" };
+
+    auto getCounts{ [&]
+    {
+        auto transaction{ session.createSharedTransaction() };
+        return Listen::getCounts(session, user->getId(), ScrobblingBackend::Internal, { track1.getId(), track2.getId(), track3.getId() });
+    } };
+
+    EXPECT_TRUE(getCounts().empty());
+
+    const Wt::WDateTime dateTime1{ Wt::WDate {2000, 1, 2}, Wt::WTime {12,0, 1} };
+    ScopedListen listen1{ session, user.lockAndGet(), track1.lockAndGet(), ScrobblingBackend::Internal, dateTime1 };
+    ScopedListen listen2{ session, user.lockAndGet(), track1.lockAndGet(), ScrobblingBackend::Internal, dateTime1 };
+    ScopedListen listen3{ session, user.lockAndGet(), track2.lockAndGet(), ScrobblingBackend::Internal, dateTime1 };
+    ScopedListen listen4{ session, user.lockAndGet(), track3.lockAndGet(), ScrobblingBackend::ListenBrainz, dateTime1 };
+
+    {
+        const auto counts{ getCounts() };
+        ASSERT_EQ(counts.size(), 2);
+        EXPECT_EQ(counts.at(track1.getId()), 2);
+        EXPECT_EQ(counts.at(track2.getId()), 1);
+    }
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        listen2.get().remove();
+        listen3.get().remove();
+    }
+
+    {
+        const auto counts{ getCounts() };
+        ASSERT_EQ(counts.size(), 1);
+        EXPECT_EQ(counts.at(track1.getId()), 1);
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+        EXPECT_EQ(Listen::getCount(session, user->getId(), ScrobblingBackend::Internal, track1.getId()), 1);
+        EXPECT_EQ(Listen::getCount(session, user->getId(), ScrobblingBackend::Internal, track2.getId()), 0);
+        EXPECT_EQ(Listen::getCount(session, user->getId(), ScrobblingBackend::ListenBrainz, track3.getId()), 1);
+    }
+}
+
 TEST_F(DatabaseFixture, Listen_getMostRecentTrack)
 {
     ScopedTrack track{ session, "MyTrack" };
@@ -1065,3 +1223,83 @@ TEST_F(DatabaseFixture, Listen_getRecentTracks_cluster)
     }
 }
 
+
+TEST_F(DatabaseFixture, Listen_archive)
+{
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+    ScopedUser user{ session, "MyUser" };
+
+    const Wt::WDateTime oldDateTime1{ Wt::WDate {2000, 1, 2}, Wt::WTime {12, 0, 1} };
+    const Wt::WDateTime oldDateTime2{ Wt::WDate {2000, 1, 3}, Wt::WTime {12, 0, 1} };
+    const Wt::WDateTime oldDateTime3{ Wt::WDate {2000, 2, 3}, Wt::WTime {12, 0, 1} };
+    const Wt::WDateTime pendingDateTime{ Wt::WDate {2000, 3, 1}, Wt::WTime {12, 0, 1} };
+    const Wt::WDateTime recentDateTime{ Wt::WDate {2020, 1, 1}, Wt::WTime {12, 0, 1} };
+    const Wt::WDateTime archiveDateTime{ Wt::WDate {2010, 1, 1}, Wt::WTime {0, 0, 0} };
+
+    ScopedListen listen1{ session, user.lockAndGet(), track1.lockAndGet(), ScrobblingBackend::Internal, oldDateTime1 };
+    ScopedListen listen2{ session, user.lockAndGet(), track1.lockAndGet(), ScrobblingBackend::Internal, oldDateTime2 };
+    ScopedListen listen3{ session, user.lockAndGet(), track2.lockAndGet(), ScrobblingBackend::Internal, oldDateTime3 };
+    ScopedListen listen4{ session, user.lockAndGet(), track2.lockAndGet(), ScrobblingBackend::Internal, pendingDateTime };
+    ScopedListen listen5{ session, user.lockAndGet(), track1.lockAndGet(), ScrobblingBackend::Internal, recentDateTime };
+    ScopedListen listen6{ session, user.lockAndGet(), track1.lockAndGet(), ScrobblingBackend::ListenBrainz, oldDateTime1 };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        for (ScopedListen* listen : { &listen1, &listen2, &listen3, &listen5, &listen6 })
+            listen->get().modify()->setSyncState(SyncState::Synchronized);
+    }
+
+    auto getCount{ [&](TrackId trackId, ScrobblingBackend backend)
+    {
+        auto transaction{ session.createSharedTransaction() };
+        return Listen::getCount(session, user->getId(), backend, trackId);
+    } };
+
+    auto getRecentTracks{ [&]
+    {
+        auto transaction{ session.createSharedTransaction() };
+        return Listen::getRecentTracks(session, user->getId(), ScrobblingBackend::Internal, {}).results;
+    } };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+
+        // pending listens are not archived
+        EXPECT_EQ(Listen::archive(session, ScrobblingBackend::Internal, archiveDateTime), 3);
+        EXPECT_EQ(Listen::archive(session, ScrobblingBackend::Internal, archiveDateTime), 0);
+
+        EXPECT_EQ(Listen::getCount(session), 3);
+        EXPECT_EQ(Listen::getArchivedCount(session), 3);
+        EXPECT_FALSE(Listen::find(session, user->getId(), track1.getId(), ScrobblingBackend::Internal, oldDateTime1));
+        EXPECT_TRUE(Listen::find(session, user->getId(), track1.getId(), ScrobblingBackend::ListenBrainz, oldDateTime1));
+    }
+
+    // archived listens are still counted
+    EXPECT_EQ(getCount(track1.getId(), ScrobblingBackend::Internal), 3);
+    EXPECT_EQ(getCount(track2.getId(), ScrobblingBackend::Internal), 2);
+    EXPECT_EQ(getCount(track1.getId(), ScrobblingBackend::ListenBrainz), 1);
+    {
+        auto transaction{ session.createSharedTransaction() };
+        EXPECT_EQ(Listen::getTopTracks(session, user->getId(), ScrobblingBackend::Internal, {}).results, (std::vector<TrackId>{ track1.getId(), track2.getId() }));
+    }
+    EXPECT_EQ(getRecentTracks(), (std::vector<TrackId>{ track1.getId(), track2.getId() }));
+
+    // the last listen date falls back to the archived listens
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        listen5.get().remove();
+    }
+    EXPECT_EQ(getCount(track1.getId(), ScrobblingBackend::Internal), 2);
+    EXPECT_EQ(getRecentTracks(), (std::vector<TrackId>{ track2.getId(), track1.getId() }));
+
+    // archived after the other month
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        listen4.get().modify()->setSyncState(SyncState::Synchronized);
+        EXPECT_EQ(Listen::archive(session, ScrobblingBackend::Internal, archiveDateTime), 1);
+        EXPECT_EQ(Listen::getArchivedCount(session), 4);
+    }
+    EXPECT_EQ(getCount(track2.getId(), ScrobblingBackend::Internal), 2);
+    EXPECT_EQ(getRecentTracks(), (std::vector<TrackId>{ track2.getId(), track1.getId() }));
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Common.hpp"
+
+#include "services/database/PlayQueue.hpp"
+
+using ScopedPlayQueue = ScopedEntity<Database::PlayQueue>;
+
+using namespace Database;
+
+TEST_F(DatabaseFixture, PlayQueue)
+{
+	ScopedUser user {session, "MyUser"};
+
+	{
+		auto transaction {session.createSharedTransaction()};
+		EXPECT_EQ(PlayQueue::getCount(session), 0);
+		EXPECT_FALSE(PlayQueue::find(session, user.getId()));
+	}
+
+	ScopedPlayQueue playQueue {session, user.lockAndGet()};
+	const Wt::WDateTime dateTime {Wt::WDate {2020, 1, 1}, Wt::WTime {12, 30, 20}};
+	const std::vector<TrackId> trackIds {TrackId {5}, TrackId {6}, TrackId {1}, TrackId {100000}, TrackId {5}};
+
+	{
+		auto transaction {session.createSharedTransaction()};
+		EXPECT_EQ(PlayQueue::getCount(session), 1);
+		EXPECT_TRUE(playQueue.get()->getTrackIds().empty());
+	}
+
+	{
+		auto transaction {session.createUniqueTransaction()};
+		playQueue.get().modify()->setTrackIds(trackIds);
+		playQueue.get().modify()->setCurrentIndex(3);
+		playQueue.get().modify()->setCurrentPosition(std::chrono::milliseconds {1234});
+		playQueue.get().modify()->setLastModifiedDateTime(dateTime);
+		playQueue.get().modify()->setChangedBy("MyClient");
+	}
+
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		const PlayQueue::pointer res {PlayQueue::find(session, user.getId())};
+		ASSERT_TRUE(res);
+		EXPECT_EQ(res->getId(), playQueue.getId());
+		EXPECT_EQ(res->getTrackIds(), trackIds);
+		EXPECT_EQ(res->getCurrentIndex(), 3);
+		EXPECT_EQ(res->getCurrentPosition(), std::chrono::milliseconds {1234});
+		EXPECT_EQ(res->getLastModifiedDateTime(), dateTime);
+		EXPECT_EQ(res->getChangedBy(), "MyClient");
+		EXPECT_EQ(res->getUser()->getId(), user.getId());
+	}
+}
+
+TEST_F(DatabaseFixture, PlayQueue_userRemoved)
+{
+	auto user {std::make_unique<ScopedUser>(session, "MyUser")};
+
+	{
+		auto transaction {session.createUniqueTransaction()};
+		session.create<PlayQueue>(user->get());
+		EXPECT_EQ(PlayQueue::getCount(session), 1);
+	}
+
+	user.reset();
+
+	{
+		auto transaction {session.createSharedTransaction()};
+		EXPECT_EQ(PlayQueue::getCount(session), 0);
+	}
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Common.hpp"
+
+#include "services/database/QueryProfiler.hpp"
+
+using namespace Database;
+
+TEST_F(DatabaseFixture, QueryProfiler)
+{
+    ScopedTrack track1{ session, "MyTrackFile1" };
+    ScopedTrack track2{ session, "MyTrackFile2" };
+
+    QueryProfiler::reset();
+    QueryProfiler::setEnabled(true);
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        EXPECT_EQ(Track::findIds(session, Track::FindParameters{}).results.size(), 2);
+        EXPECT_EQ(Track::findIds(session, Track::FindParameters{}).results.size(), 2);
+    }
+
+    QueryProfiler::setEnabled(false);
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+        EXPECT_EQ(Track::findIds(session, Track::FindParameters{}).results.size(), 2);
+    }
+
+    const std::vector<QueryProfiler::QueryStats> stats{ QueryProfiler::getStats() };
+    ASSERT_EQ(stats.size(), 1);
+    EXPECT_EQ(stats.front().callCount, 2);
+    EXPECT_EQ(stats.front().rowCount, 4);
+    EXPECT_GE(stats.front().totalDuration, stats.front().maxDuration);
+
+    QueryProfiler::reset();
+    EXPECT_TRUE(QueryProfiler::getStats().empty());
+}
@@ -132,6 +132,8 @@ TEST_F(DatabaseFixture, Release_singleTrack)
 
 TEST_F(DatabaseFixture, MulitpleReleaseSearchByName)
 {
+    ScopedNoFullTextSearch noFullTextSearch{ session.getDb() };
+
     ScopedRelease release1{ session, "MyRelease" };
     ScopedRelease release2{ session, "MyRelease%" };
     ScopedRelease release3{ session, "%MyRelease" };
@@ -418,6 +420,38 @@ TEST_F(DatabaseFixture, Release_writtenAfter)
     }
 }
 
+TEST_F(DatabaseFixture, Release_ids)
+{
+    ScopedRelease release1{ session, "MyRelease1" };
+    ScopedRelease release2{ session, "MyRelease2" };
+    ScopedRelease release3{ session, "OtherRelease" };
+    ScopedTrack track1{ session, "MyTrack" };
+    ScopedTrack track2{ session, "MyTrack" };
+    ScopedTrack track3{ session, "MyTrack" };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        track1.get().modify()->setRelease(release1.get());
+        track2.get().modify()->setRelease(release2.get());
+        track3.get().modify()->setRelease(release3.get());
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+        const auto releases{ Release::findIds(session, Release::FindParameters {}.setIds({ release1.getId(), release3.getId() }).setSortMethod(ReleaseSortMethod::Name)) };
+        ASSERT_EQ(releases.results.size(), 2);
+        EXPECT_EQ(releases.results[0], release1.getId());
+        EXPECT_EQ(releases.results[1], release3.getId());
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+        const auto releases{ Release::findIds(session, Release::FindParameters {}.setIds({ release1.getId(), release3.getId() }).setKeywords({ "MyRelease" })) };
+        ASSERT_EQ(releases.results.size(), 1);
+        EXPECT_EQ(releases.results[0], release1.getId());
+    }
+}
+
 TEST_F(DatabaseFixture, Release_artist)
 {
     ScopedRelease release{ session, "MyRelease" };
@@ -493,6 +527,10 @@ TEST_F(DatabaseFixture, Release_getDiscCount)
         auto transaction{ session.createUniqueTransaction() };
         track.get().modify()->setRelease(release.get());
     }
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        Release::updateAggregates(session);
+    }
     {
         auto transaction{ session.createSharedTransaction() };
         EXPECT_EQ(release.get()->getDiscCount(), 0);
@@ -501,6 +539,10 @@ TEST_F(DatabaseFixture, Release_getDiscCount)
         auto transaction{ session.createUniqueTransaction() };
         track.get().modify()->setDiscNumber(5);
     }
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        Release::updateAggregates(session);
+    }
     {
         auto transaction{ session.createSharedTransaction() };
         EXPECT_EQ(release.get()->getDiscCount(), 1);
@@ -510,6 +552,10 @@ TEST_F(DatabaseFixture, Release_getDiscCount)
         track2.get().modify()->setRelease(release.get());
         track2.get().modify()->setDiscNumber(5);
     }
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        Release::updateAggregates(session);
+    }
     {
         auto transaction{ session.createSharedTransaction() };
         EXPECT_EQ(release.get()->getDiscCount(), 1);
@@ -518,12 +564,81 @@ TEST_F(DatabaseFixture, Release_getDiscCount)
         auto transaction{ session.createUniqueTransaction() };
         track2.get().modify()->setDiscNumber(6);
     }
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        Release::updateAggregates(session);
+    }
     {
         auto transaction{ session.createSharedTransaction() };
         EXPECT_EQ(release.get()->getDiscCount(), 2);
     }
 }
 
+TEST_F(DatabaseFixture, Release_aggregates)
+{
+    ScopedRelease release{ session, "MyRelease" };
+    ScopedRelease emptyRelease{ session, "MyEmptyRelease" };
+    ScopedTrack track{ session, "MyTrack" };
+    ScopedTrack track2{ session, "MyTrack2" };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        Release::updateAggregates(session);
+    }
+    {
+        auto transaction{ session.createSharedTransaction() };
+        EXPECT_EQ(release->getDuration(), std::chrono::milliseconds{ 0 });
+        EXPECT_EQ(release->getTracksCount(), 0);
+        EXPECT_FALSE(release->getMinYear());
+        EXPECT_FALSE(release->getMaxYear());
+        EXPECT_FALSE(release->hasEmbeddedCover());
+    }
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        track.get().modify()->setRelease(release.get());
+        track.get().modify()->setDuration(std::chrono::seconds{ 10 });
+        track.get().modify()->setDate(Wt::WDate{ 1994, 2, 3 });
+        track2.get().modify()->setRelease(release.get());
+        track2.get().modify()->setDuration(std::chrono::seconds{ 5 });
+        track2.get().modify()->setDate(Wt::WDate{ 1992, 5, 6 });
+        track2.get().modify()->setHasCover(true);
+    }
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        Release::updateAggregates(session);
+    }
+    {
+        auto transaction{ session.createSharedTransaction() };
+        EXPECT_EQ(release->getDuration(), std::chrono::seconds{ 15 });
+        EXPECT_EQ(release->getTracksCount(), 2);
+        EXPECT_EQ(release->getMinYear(), 1992);
+        EXPECT_EQ(release->getMaxYear(), 1994);
+        EXPECT_TRUE(release->hasEmbeddedCover());
+
+        EXPECT_EQ(emptyRelease->getDuration(), std::chrono::milliseconds{ 0 });
+        EXPECT_EQ(emptyRelease->getTracksCount(), 0);
+        EXPECT_FALSE(emptyRelease->hasEmbeddedCover());
+    }
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        track2.get().modify()->setRelease({});
+    }
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        Release::updateAggregates(session);
+    }
+    {
+        auto transaction{ session.createSharedTransaction() };
+        EXPECT_EQ(release->getDuration(), std::chrono::seconds{ 10 });
+        EXPECT_EQ(release->getTracksCount(), 1);
+        EXPECT_EQ(release->getMinYear(), 1994);
+        EXPECT_EQ(release->getMaxYear(), 1994);
+        EXPECT_FALSE(release->hasEmbeddedCover());
+    }
+}
+
 TEST_F(DatabaseFixture, Release_releaseType)
 {
     ScopedRelease release{ session, "MyRelease" };
@@ -653,4 +768,96 @@ TEST_F(DatabaseFixture, Release_meanBitrate)
         track3.get().modify()->setRelease(release1.get());
     }
     checkExpectedBitrate(192); // 0 should not be taken into account
-}
\ No newline at end of file
+}
+TEST_F(DatabaseFixture, Release_sortKeys)
+{
+    ScopedRelease releaseWall{ session, "The Wall" };
+    ScopedRelease releaseElan{ session, "Élan" };
+    ScopedRelease releaseAbbey{ session, "abbey road" };
+    ScopedArtist artistB{ session, "The Beatles" };
+    ScopedArtist artistP{ session, "Pink Floyd" };
+    ScopedArtist artistA{ session, "ABBA" };
+    ScopedTrack trackWall{ session, "MyTrack1" };
+    ScopedTrack trackAbbey{ session, "MyTrack2" };
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        const auto releases{ Release::findIds(session, Release::FindParameters{}.setSortMethod(ReleaseSortMethod::Name)) };
+        EXPECT_EQ(releases.results, (std::vector<ReleaseId>{ releaseAbbey.getId(), releaseElan.getId(), releaseWall.getId() }));
+
+        // no artist yet
+        EXPECT_TRUE(Release::findIdsOrderedByArtist(session).results.empty());
+    }
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        trackWall.get().modify()->setRelease(releaseWall.get());
+        trackAbbey.get().modify()->setRelease(releaseAbbey.get());
+        TrackArtistLink::create(session, trackWall.get(), artistP.get(), TrackArtistLinkType::ReleaseArtist);
+        TrackArtistLink::create(session, trackWall.get(), artistA.get(), TrackArtistLinkType::Artist);
+        TrackArtistLink::create(session, trackAbbey.get(), artistB.get(), TrackArtistLinkType::Artist);
+    }
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        Release::updateAggregates(session);
+    }
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        // "beatles" < "pink floyd": the release artist is used rather than "abba"
+        const auto releases{ Release::findIdsOrderedByArtist(session) };
+        EXPECT_EQ(releases.results, (std::vector<ReleaseId>{ releaseAbbey.getId(), releaseWall.getId() }));
+    }
+}
+
+TEST_F(DatabaseFixture, Release_updateAggregatesScoped)
+{
+    ScopedRelease release1{ session, "MyRelease1" };
+    ScopedRelease release2{ session, "MyRelease2" };
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+
+        track1.get().modify()->setRelease(release1.get());
+        track2.get().modify()->setRelease(release2.get());
+    }
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        Release::updateAggregates(session, { release2.getId() });
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        EXPECT_EQ(release1->getTracksCount(), 0);
+        EXPECT_EQ(release2->getTracksCount(), 1);
+    }
+}
+
+TEST_F(DatabaseFixture, Release_remove)
+{
+    ScopedRelease release1{ session, "MyRelease1" };
+    ScopedRelease release2{ session, "MyRelease2" };
+    ScopedRelease release3{ session, "MyRelease3" };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        Release::remove(session, {});
+        EXPECT_EQ(Release::getCount(session), 3);
+
+        Release::remove(session, { release1.getId(), release3.getId() });
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        EXPECT_EQ(Release::getCount(session), 1);
+        EXPECT_FALSE(Release::exists(session, release1.getId()));
+        EXPECT_TRUE(Release::exists(session, release2.getId()));
+        EXPECT_FALSE(Release::exists(session, release3.getId()));
+    }
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "Common.hpp"
+
+#include "services/database/ReleaseRelations.hpp"
+
+using namespace Database;
+
+TEST_F(DatabaseFixture, ReleaseRelations)
+{
+    ScopedRelease release1{ session, "MyRelease1" };
+    ScopedRelease release2{ session, "MyRelease2" };
+    ScopedTrack track1{ session, "MyTrackFile1" };
+    ScopedTrack track2{ session, "MyTrackFile2" };
+    ScopedArtist artist1{ session, "MyArtist1" };
+    ScopedArtist artist2{ session, "MyArtist2" };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+
+        track1.get().modify()->setRelease(release1.get());
+        track2.get().modify()->setRelease(release1.get());
+        TrackArtistLink::create(session, track1.get(), artist1.get(), TrackArtistLinkType::Artist);
+        TrackArtistLink::create(session, track2.get(), artist1.get(), TrackArtistLinkType::Artist);
+        TrackArtistLink::create(session, track2.get(), artist2.get(), TrackArtistLinkType::ReleaseArtist);
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        const ReleaseRelations relations{ session, { release1.getId(), release2.getId(), ReleaseId{ 4242 } } };
+
+        ASSERT_TRUE(relations.getRelease(release1.getId()));
+        EXPECT_EQ(relations.getRelease(release1.getId())->getId(), release1.getId());
+        ASSERT_TRUE(relations.getRelease(release2.getId()));
+        EXPECT_FALSE(relations.getRelease(ReleaseId{ 4242 }));
+
+        {
+            const auto artists{ relations.getArtists(release1.getId(), TrackArtistLinkType::Artist) };
+            ASSERT_EQ(artists.size(), 1);
+            EXPECT_EQ(artists.front()->getId(), artist1.getId());
+        }
+        {
+            const auto artists{ relations.getArtists(release1.getId(), TrackArtistLinkType::ReleaseArtist) };
+            ASSERT_EQ(artists.size(), 1);
+            EXPECT_EQ(artists.front()->getId(), artist2.getId());
+        }
+        EXPECT_TRUE(relations.getArtists(release2.getId(), TrackArtistLinkType::Artist).empty());
+    }
+}
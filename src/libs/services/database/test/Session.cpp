@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Common.hpp"
+
+#include <thread>
+
+using namespace Database;
+
+TEST_F(DatabaseFixture, Session_readDuringWrite)
+{
+    ScopedTrack track{ session, "MyTrackFile" };
+
+    auto readTrackName{ [&]
+    {
+        std::string name;
+        std::thread reader{ [&]
+        {
+            // readers must not wait for the pending write transaction
+            Session readerSession{ session.getDb() };
+            auto transaction{ readerSession.createSharedTransaction() };
+
+            const Track::pointer readerTrack{ Track::find(readerSession, track.getId()) };
+            ASSERT_TRUE(readerTrack);
+            name = readerTrack->getName();
+        } };
+        reader.join();
+
+        return name;
+    } };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+
+        track.get().modify()->setName("MyTrack");
+        session.getDboSession().flush();
+
+        // not committed yet
+        EXPECT_EQ(readTrackName(), "");
+    }
+
+    EXPECT_EQ(readTrackName(), "MyTrack");
+}
+
+TEST_F(DatabaseFixture, Session_backgroundMigrationTasks)
+{
+    ScopedRelease release{ session, "The Wall" };
+    ScopedArtist artist{ session, "Pink Floyd" };
+    ScopedTrack track{ session, "MyTrack" };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        track.get().modify()->setRelease(release.get());
+        TrackArtistLink::create(session, track.get(), artist.get(), TrackArtistLinkType::ReleaseArtist);
+    }
+
+    // as left by a migration step
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        session.getDboSession().execute("UPDATE artist SET sort_key = ''");
+        session.getDboSession().execute("UPDATE release SET sort_key = '', artist_sort_key = '', track_count = 0");
+        session.getDboSession().execute("INSERT INTO migration_background_task (name) VALUES ('release_aggregates'), ('sort_keys')");
+    }
+
+    session.runBackgroundMigrationTasks();
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        EXPECT_EQ(session.getDboSession().query<std::string>("SELECT sort_key FROM release").resultValue(), "wall");
+        EXPECT_EQ(session.getDboSession().query<int>("SELECT track_count FROM release").resultValue(), 1);
+        EXPECT_EQ(Release::findIdsOrderedByArtist(session).results, (std::vector<ReleaseId>{ release.getId() }));
+        EXPECT_EQ(session.getDboSession().query<int>("SELECT COUNT(*) FROM migration_background_task").resultValue(), 0);
+    }
+}
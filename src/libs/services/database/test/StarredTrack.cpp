@@ -123,3 +123,80 @@ TEST_F(DatabaseFixture, StarredTrack_dateTime)
         EXPECT_EQ(tracks.results[1], starredTrack1->getTrack()->getId());
     }
 }
+
+TEST_F(DatabaseFixture, StarredTrack_getStarredDateTimes)
+{
+    ScopedTrack track1 {session, "MyTrack1"};
+    ScopedTrack track2 {session, "MyTrack2"};
+    ScopedTrack track3 {session, "MyTrack3"};
+    ScopedUser user {session, "MyUser"};
+    ScopedUser user2 {session, "MyUser2"};
+
+    ScopedStarredTrack starredTrack1 {session, track1.lockAndGet(), user.lockAndGet(), FeedbackBackend::Internal};
+    ScopedStarredTrack starredTrack2 {session, track2.lockAndGet(), user.lockAndGet(), FeedbackBackend::Internal};
+    ScopedStarredTrack starredTrack3 {session, track3.lockAndGet(), user2.lockAndGet(), FeedbackBackend::Internal};
+
+    const Wt::WDateTime dateTime {Wt::WDate {1950, 1, 2}, Wt::WTime {12, 30, 1}};
+
+    {
+        auto transaction {session.createUniqueTransaction()};
+
+        starredTrack1.get().modify()->setDateTime(dateTime);
+        starredTrack2.get().modify()->setDateTime(dateTime.addSecs(1));
+    }
+
+    {
+        auto transaction {session.createSharedTransaction()};
+
+        const auto dateTimes {StarredTrack::getStarredDateTimes(session, user.getId(), FeedbackBackend::Internal, {track1.getId(), track2.getId(), track3.getId()})};
+        ASSERT_EQ(dateTimes.size(), 2);
+        EXPECT_EQ(dateTimes.at(track1.getId()), dateTime);
+        EXPECT_EQ(dateTimes.at(track2.getId()), dateTime.addSecs(1));
+
+        EXPECT_TRUE(StarredTrack::getStarredDateTimes(session, user.getId(), FeedbackBackend::ListenBrainz, {track1.getId()}).empty());
+        EXPECT_TRUE(StarredTrack::getStarredDateTimes(session, user.getId(), FeedbackBackend::Internal, {}).empty());
+    }
+
+    {
+        auto transaction {session.createUniqueTransaction()};
+
+        starredTrack1.get().modify()->setSyncState(SyncState::PendingRemove);
+    }
+
+    {
+        auto transaction {session.createSharedTransaction()};
+
+        const auto dateTimes {StarredTrack::getStarredDateTimes(session, user.getId(), FeedbackBackend::Internal, {track1.getId(), track2.getId()})};
+        ASSERT_EQ(dateTimes.size(), 1);
+        EXPECT_EQ(dateTimes.count(track2.getId()), 1);
+    }
+}
+
+TEST_F(DatabaseFixture, StarredTrack_findStarredTrackIds)
+{
+    ScopedTrack track1 {session, "MyTrack1"};
+    ScopedTrack track2 {session, "MyTrack2"};
+    ScopedTrack track3 {session, "MyTrack3"};
+    ScopedUser user {session, "MyUser"};
+
+    ScopedStarredTrack starredTrack1 {session, track1.lockAndGet(), user.lockAndGet(), FeedbackBackend::ListenBrainz};
+    ScopedStarredTrack starredTrack2 {session, track2.lockAndGet(), user.lockAndGet(), FeedbackBackend::ListenBrainz};
+
+    {
+        auto transaction {session.createUniqueTransaction()};
+
+        starredTrack2.get().modify()->setSyncState(SyncState::PendingRemove);
+    }
+
+    {
+        auto transaction {session.createSharedTransaction()};
+
+        const auto trackIds {StarredTrack::findStarredTrackIds(session, user.getId(), FeedbackBackend::ListenBrainz, {track1.getId(), track2.getId(), track3.getId()})};
+        ASSERT_EQ(trackIds.size(), 2);
+        EXPECT_EQ(trackIds.count(track1.getId()), 1);
+        EXPECT_EQ(trackIds.count(track2.getId()), 1);
+
+        EXPECT_TRUE(StarredTrack::findStarredTrackIds(session, user.getId(), FeedbackBackend::Internal, {track1.getId()}).empty());
+        EXPECT_TRUE(StarredTrack::findStarredTrackIds(session, user.getId(), FeedbackBackend::ListenBrainz, {}).empty());
+    }
+}
@@ -20,6 +20,8 @@
 #include "Common.hpp"
 
 #include <algorithm>
+#include <list>
+#include <set>
 
 using namespace Database;
 
@@ -79,6 +81,8 @@ TEST_F(DatabaseFixture, MultipleTracks)
 
 TEST_F(DatabaseFixture, MultipleTracksSearchByFilter)
 {
+    ScopedNoFullTextSearch noFullTextSearch{ session.getDb() };
+
     ScopedTrack track1{ session, "" };
     ScopedTrack track2{ session, "" };
     ScopedTrack track3{ session, "" };
@@ -123,6 +127,53 @@ TEST_F(DatabaseFixture, MultipleTracksSearchByFilter)
     }
 }
 
+TEST_F(DatabaseFixture, MultipleTracksSearchByKeywordsFullTextSearch)
+{
+    if (!session.getDb().isFullTextSearchEnabled())
+        GTEST_SKIP() << "Full text search not available";
+
+    ScopedTrack track1{ session, "" };
+    ScopedTrack track2{ session, "" };
+    ScopedTrack track3{ session, "" };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        track1.get().modify()->setName("Café del Mar");
+        track2.get().modify()->setName("Cafeteria");
+        track3.get().modify()->setName("Other");
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        {
+            const auto tracks{ Track::findIds(session, Track::FindParameters {}.setKeywords({"cafe"})) };
+            ASSERT_EQ(tracks.results.size(), 2);
+            EXPECT_EQ(tracks.results[0], track1.getId());
+            EXPECT_EQ(tracks.results[1], track2.getId());
+        }
+        {
+            const auto tracks{ Track::findIds(session, Track::FindParameters {}.setKeywords({"mar", "CAF"})) };
+            ASSERT_EQ(tracks.results.size(), 1);
+            EXPECT_EQ(tracks.results[0], track1.getId());
+        }
+        EXPECT_TRUE(Track::findIds(session, Track::FindParameters {}.setKeywords({"ther"})).results.empty());
+    }
+
+    // index follows renames
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        track3.get().modify()->setName("Cafe Racer");
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        EXPECT_EQ(Track::findIds(session, Track::FindParameters {}.setKeywords({"cafe"})).results.size(), 3);
+        EXPECT_TRUE(Track::findIds(session, Track::FindParameters {}.setKeywords({"other"})).results.empty());
+    }
+}
+
 TEST_F(DatabaseFixture, Track_date)
 {
     ScopedTrack track{ session, "MyTrack" };
@@ -146,6 +197,113 @@ TEST_F(DatabaseFixture, Track_date)
     }
 }
 
+TEST_F(DatabaseFixture, Track_fileSize)
+{
+    ScopedTrack track{ session, "MyTrack" };
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+        EXPECT_EQ(track->getFileSize(), 0);
+    }
+
+    // larger than 32 bits
+    constexpr std::size_t fileSize{ 5'000'000'000 };
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        track.get().modify()->setFileSize(fileSize);
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+        EXPECT_EQ(track->getFileSize(), fileSize);
+    }
+}
+
+TEST_F(DatabaseFixture, Track_audioStream)
+{
+    ScopedTrack track{ session, "MyTrack" };
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+        EXPECT_EQ(track->getAudioCodec(), "");
+        EXPECT_EQ(track->getSampleRate(), 0);
+        EXPECT_EQ(track->getChannelCount(), 0);
+    }
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        track.get().modify()->setAudioCodec("flac");
+        track.get().modify()->setSampleRate(44100);
+        track.get().modify()->setChannelCount(2);
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+        EXPECT_EQ(track->getAudioCodec(), "flac");
+        EXPECT_EQ(track->getSampleRate(), 44100);
+        EXPECT_EQ(track->getChannelCount(), 2);
+    }
+}
+
+TEST_F(DatabaseFixture, Track_pendingAudioProperties)
+{
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+        EXPECT_FALSE(track1->hasPendingAudioProperties());
+        EXPECT_TRUE(Track::findIdsWithPendingAudioProperties(session).results.empty());
+    }
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        track2.get().modify()->setAudioPropertiesPending(true);
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+        EXPECT_TRUE(track2->hasPendingAudioProperties());
+
+        const auto trackIds{ Track::findIdsWithPendingAudioProperties(session) };
+        ASSERT_EQ(trackIds.results.size(), 1);
+        EXPECT_EQ(trackIds.results.front(), track2.getId());
+    }
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        track2.get().modify()->setAudioPropertiesPending(false);
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+        EXPECT_TRUE(Track::findIdsWithPendingAudioProperties(session).results.empty());
+    }
+}
+
+TEST_F(DatabaseFixture, Track_minDuration)
+{
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        track1.get().modify()->setDuration(std::chrono::minutes{ 5 });
+        track2.get().modify()->setDuration(std::chrono::minutes{ 45 });
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        const auto trackIds{ Track::findIdsWithMinDuration(session, std::chrono::minutes{ 20 }) };
+        ASSERT_EQ(trackIds.results.size(), 1);
+        EXPECT_EQ(trackIds.results.front(), track2.getId());
+
+        EXPECT_EQ(Track::findIdsWithMinDuration(session, std::chrono::minutes{ 5 }).results.size(), 2);
+        EXPECT_TRUE(Track::findIdsWithMinDuration(session, std::chrono::hours{ 1 }).results.empty());
+    }
+}
+
 TEST_F(DatabaseFixture, Track_writtenAfter)
 {
     ScopedTrack track{ session, "MyTrack" };
@@ -176,3 +334,265 @@ TEST_F(DatabaseFixture, Track_writtenAfter)
     }
 }
 
+TEST_F(DatabaseFixture, Track_addedAfter)
+{
+    ScopedTrack track{ session, "MyTrack" };
+    ScopedRelease release{ session, "MyRelease" };
+    ScopedArtist artist{ session, "MyArtist" };
+
+    const Wt::WDateTime dateTime{ Wt::WDate {1950, 1, 1}, Wt::WTime {12, 30, 20} };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        track.get().modify()->setAddedTime(dateTime);
+        track.get().modify()->setRelease(release.get());
+        TrackArtistLink::create(session, track.get(), artist.get(), TrackArtistLinkType::Artist);
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+        EXPECT_EQ(Track::findIds(session, Track::FindParameters {}.setAddedAfter(dateTime.addSecs(-1))).results.size(), 1);
+        EXPECT_EQ(Release::findIds(session, Release::FindParameters {}.setAddedAfter(dateTime.addSecs(-1))).results.size(), 1);
+        EXPECT_EQ(Artist::findIds(session, Artist::FindParameters {}.setAddedAfter(dateTime.addSecs(-1))).results.size(), 1);
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+        EXPECT_EQ(Track::findIds(session, Track::FindParameters {}.setAddedAfter(dateTime.addSecs(+1))).results.size(), 0);
+        EXPECT_EQ(Release::findIds(session, Release::FindParameters {}.setAddedAfter(dateTime.addSecs(+1))).results.size(), 0);
+        EXPECT_EQ(Artist::findIds(session, Artist::FindParameters {}.setAddedAfter(dateTime.addSecs(+1))).results.size(), 0);
+    }
+}
+
+
+TEST_F(DatabaseFixture, Track_fileInfos)
+{
+    ScopedTrack track{ session, "MyTrackFile" };
+    const Wt::WDateTime dateTime{ Wt::WDate{ 1950, 1, 1 }, Wt::WTime{ 12, 30, 20 } };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        track.get().modify()->setLastWriteTime(dateTime);
+        track.get().modify()->setScanVersion(42);
+        track.get().modify()->setFileSize(1234);
+        track.get().modify()->setContentFingerprint(0xFEDCBA9876543210);
+        track.get().modify()->setAddedTime(dateTime.addSecs(60));
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        std::size_t visitCount{};
+        Track::findFileInfos(session, [&](const Track::FileInfoResult& fileInfo)
+            {
+                visitCount++;
+                EXPECT_EQ(fileInfo.trackId, track.getId());
+                EXPECT_EQ(fileInfo.path, "MyTrackFile");
+                EXPECT_EQ(fileInfo.lastWriteTime, dateTime);
+                EXPECT_EQ(fileInfo.scanVersion, 42);
+                EXPECT_EQ(fileInfo.fileSize, 1234);
+                EXPECT_EQ(fileInfo.contentFingerprint, 0xFEDCBA9876543210);
+                EXPECT_EQ(fileInfo.addedTime, dateTime.addSecs(60));
+            });
+        EXPECT_EQ(visitCount, 1);
+    }
+}
+
+TEST_F(DatabaseFixture, Track_remove)
+{
+    ScopedTrack track1{ session, "MyTrackFile1" };
+    ScopedTrack track2{ session, "MyTrackFile2" };
+    ScopedTrack track3{ session, "MyTrackFile3" };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        Track::remove(session, {});
+        EXPECT_EQ(Track::getCount(session), 3);
+
+        Track::remove(session, { track1.getId(), track3.getId() });
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        EXPECT_EQ(Track::getCount(session), 1);
+        EXPECT_FALSE(Track::exists(session, track1.getId()));
+        EXPECT_TRUE(Track::exists(session, track2.getId()));
+        EXPECT_FALSE(Track::exists(session, track3.getId()));
+    }
+}
+
+TEST_F(DatabaseFixture, Track_afterId)
+{
+    ScopedTrack track1{ session, "MyTrackFile1" };
+    ScopedTrack track2{ session, "MyTrackFile2" };
+    ScopedTrack track3{ session, "MyTrackFile3" };
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        const auto firstPage{ Track::findIds(session, Track::FindParameters{}.setSortMethod(TrackSortMethod::Id).setRange(Range{ 0, 2 })) };
+        ASSERT_EQ(firstPage.results.size(), 2);
+        EXPECT_TRUE(firstPage.moreResults);
+        EXPECT_EQ(firstPage.results[0], track1.getId());
+        EXPECT_EQ(firstPage.results[1], track2.getId());
+
+        const auto nextPage{ Track::findIds(session, Track::FindParameters{}.setSortMethod(TrackSortMethod::Id).setAfterId(firstPage.results.back()).setRange(Range{ 0, 2 })) };
+        ASSERT_EQ(nextPage.results.size(), 1);
+        EXPECT_FALSE(nextPage.moreResults);
+        EXPECT_EQ(nextPage.results[0], track3.getId());
+
+        EXPECT_TRUE(Track::findIds(session, Track::FindParameters{}.setSortMethod(TrackSortMethod::Id).setAfterId(track3.getId())).results.empty());
+    }
+}
+
+TEST_F(DatabaseFixture, Track_random)
+{
+    std::list<ScopedTrack> tracks;
+    for (std::size_t i{}; i < 20; ++i)
+        tracks.emplace_back(session, "MyTrackFile" + std::to_string(i));
+
+    ScopedClusterType clusterType{ session, "MyClusterType" };
+    ScopedCluster cluster{ session, clusterType.lockAndGet(), "MyCluster" };
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        cluster.get().modify()->addTrack(tracks.back().get());
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        const auto sample{ Track::findIds(session, Track::FindParameters{}.setSortMethod(TrackSortMethod::Random).setRange(Range{ 0, 5 })) };
+        ASSERT_EQ(sample.results.size(), 5);
+        EXPECT_EQ(std::set<TrackId>(std::cbegin(sample.results), std::cend(sample.results)).size(), 5);
+
+        const auto allTracks{ Track::findIds(session, Track::FindParameters{}.setSortMethod(TrackSortMethod::Random).setRange(Range{ 0, 50 })) };
+        EXPECT_EQ(allTracks.results.size(), 20);
+        EXPECT_EQ(std::set<TrackId>(std::cbegin(allTracks.results), std::cend(allTracks.results)).size(), 20);
+
+        const auto clusterTracks{ Track::find(session, Track::FindParameters{}.setClusters({ cluster.getId() }).setSortMethod(TrackSortMethod::Random).setRange(Range{ 0, 5 })) };
+        ASSERT_EQ(clusterTracks.results.size(), 1);
+        EXPECT_EQ(clusterTracks.results.front()->getId(), tracks.back().getId());
+    }
+}
+
+TEST_F(DatabaseFixture, Track_findIdsByRecordingMBIDs)
+{
+    ScopedTrack track1{ session, "MyTrack1" };
+    ScopedTrack track2{ session, "MyTrack2" };
+    ScopedTrack track3{ session, "MyTrack3" };
+
+    const std::optional<UUID> MBID1{ UUID::fromString("3f8bd3d2-3f4d-4e5e-8d8a-5b3c2a2f1e01") };
+    const std::optional<UUID> MBID2{ UUID::fromString("3f8bd3d2-3f4d-4e5e-8d8a-5b3c2a2f1e02") };
+    const std::optional<UUID> unknownMBID{ UUID::fromString("3f8bd3d2-3f4d-4e5e-8d8a-5b3c2a2f1e03") };
+    ASSERT_TRUE(MBID1 && MBID2 && unknownMBID);
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+
+        track1.get().modify()->setRecordingMBID(MBID1);
+        track2.get().modify()->setRecordingMBID(MBID2);
+        track3.get().modify()->setRecordingMBID(MBID2);
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        const auto trackIds{ Track::findIdsByRecordingMBIDs(session, { *MBID1, *MBID2, *unknownMBID }) };
+        ASSERT_EQ(trackIds.size(), 2);
+
+        ASSERT_EQ(trackIds.at(std::string{ MBID1->getAsString() }).size(), 1);
+        EXPECT_EQ(trackIds.at(std::string{ MBID1->getAsString() }).front(), track1.getId());
+
+        std::vector<TrackId> MBID2TrackIds{ trackIds.at(std::string{ MBID2->getAsString() }) };
+        std::sort(std::begin(MBID2TrackIds), std::end(MBID2TrackIds));
+        EXPECT_EQ(MBID2TrackIds, (std::vector<TrackId>{ std::min(track2.getId(), track3.getId()), std::max(track2.getId(), track3.getId()) }));
+
+        EXPECT_TRUE(Track::findIdsByRecordingMBIDs(session, {}).empty());
+    }
+}
+
+TEST_F(DatabaseFixture, Track_findPathsInScope)
+{
+    ScopedTrack track1{ session, "/music/incoming/album/track1.mp3" };
+    ScopedTrack track2{ session, "/music/incoming/album/sub/track2.mp3" };
+    ScopedTrack track3{ session, "/music/incoming/album2/track3.mp3" };
+    ScopedTrack track4{ session, "/music/incoming/album.mp3" };
+    ScopedRelease release{ session, "MyRelease" };
+    ScopedClusterType clusterType{ session, "MyType" };
+    ScopedCluster cluster{ session, clusterType.lockAndGet(), "MyCluster" };
+    ScopedCluster otherCluster{ session, clusterType.lockAndGet(), "MyOtherCluster" };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+
+        track1.get().modify()->setRelease(release.get());
+        cluster.get().modify()->addTrack(track2.get());
+        otherCluster.get().modify()->addTrack(track3.get());
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        const auto paths{ Track::findPaths(session, "/music/incoming/album") };
+        ASSERT_EQ(paths.results.size(), 2);
+        EXPECT_EQ(paths.results[0].trackId, track2.getId());
+        EXPECT_EQ(paths.results[1].trackId, track1.getId());
+
+        const auto filePaths{ Track::findPaths(session, "/music/incoming/album.mp3") };
+        ASSERT_EQ(filePaths.results.size(), 1);
+        EXPECT_EQ(filePaths.results[0].trackId, track4.getId());
+
+        EXPECT_EQ(Track::findPaths(session, "/music/incoming").results.size(), 4);
+        EXPECT_TRUE(Track::findPaths(session, "/music/incoming/alb").results.empty());
+
+        const auto releaseIds{ Track::findReleaseIds(session, "/music/incoming/album") };
+        ASSERT_EQ(releaseIds.results.size(), 1);
+        EXPECT_EQ(releaseIds.results.front(), release.getId());
+        EXPECT_TRUE(Track::findReleaseIds(session, "/music/incoming/album2").results.empty());
+
+        const auto clusterIds{ Track::findClusterIds(session, "/music/incoming/album") };
+        ASSERT_EQ(clusterIds.results.size(), 1);
+        EXPECT_EQ(clusterIds.results.front(), cluster.getId());
+    }
+}
+
+TEST_F(DatabaseFixture, Track_findTrackMBIDDuplicates)
+{
+    ScopedTrack track1{ session, "MyTrackFile1" };
+    ScopedTrack track2{ session, "MyTrackFile2" };
+    ScopedTrack track3{ session, "MyTrackFile3" };
+
+    const std::optional<UUID> MBID1{ UUID::fromString("3f8bd3d2-3f4d-4e5e-8d8a-5b3c2a2f1e01") };
+    const std::optional<UUID> MBID2{ UUID::fromString("3f8bd3d2-3f4d-4e5e-8d8a-5b3c2a2f1e02") };
+    ASSERT_TRUE(MBID1 && MBID2);
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+        EXPECT_TRUE(Track::findTrackMBIDDuplicates(session).results.empty());
+    }
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+
+        track1.get().modify()->setTrackMBID(MBID1);
+        track1.get().modify()->setName("MyTrack1");
+        track2.get().modify()->setTrackMBID(MBID2);
+        track3.get().modify()->setTrackMBID(MBID1);
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        auto duplicates{ Track::findTrackMBIDDuplicates(session) };
+        ASSERT_EQ(duplicates.results.size(), 2);
+        std::sort(std::begin(duplicates.results), std::end(duplicates.results), [](const Track::TrackMBIDDuplicateResult& lhs, const Track::TrackMBIDDuplicateResult& rhs) { return lhs.trackId < rhs.trackId; });
+
+        EXPECT_EQ(duplicates.results[0].trackId, track1.getId());
+        EXPECT_EQ(duplicates.results[0].trackMBID, MBID1->getAsString());
+        EXPECT_EQ(duplicates.results[0].path, "MyTrackFile1");
+        EXPECT_EQ(duplicates.results[0].name, "MyTrack1");
+        EXPECT_EQ(duplicates.results[1].trackId, track3.getId());
+        EXPECT_EQ(duplicates.results[1].trackMBID, MBID1->getAsString());
+    }
+}
@@ -35,7 +35,7 @@ TEST_F(DatabaseFixture, TrackFeatures)
 		EXPECT_EQ(TrackFeatures::getCount(session), 0);
 	}
 
-	ScopedTrackFeatures trackFeatures {session, track.lockAndGet(), ""};
+	ScopedTrackFeatures trackFeatures {session, track.lockAndGet(), FeatureValuesMap {}};
 
 	{
 		auto transaction {session.createUniqueTransaction()};
@@ -44,5 +44,55 @@ TEST_F(DatabaseFixture, TrackFeatures)
 		auto allTrackFeatures {TrackFeatures::find(session)};
 		ASSERT_EQ(allTrackFeatures.results.size(), 1);
 		EXPECT_EQ(allTrackFeatures.results.front(), trackFeatures.getId());
+
+		auto trackIds {TrackFeatures::findTrackIds(session)};
+		ASSERT_EQ(trackIds.results.size(), 1);
+		EXPECT_EQ(trackIds.results.front(), track.getId());
 	}
 }
+
+TEST_F(DatabaseFixture, TrackFeatures_values)
+{
+	ScopedTrack track {session, "MyTrack"};
+
+	const FeatureValuesMap featureValuesMap {{"lowlevel.average_loudness", {0.5}}, {"lowlevel.barkbands.mean", {1, 2, 3}}};
+	ScopedTrackFeatures trackFeatures {session, track.lockAndGet(), featureValuesMap};
+
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		const FeatureValuesMap values {trackFeatures->getFeatureValuesMap({"lowlevel.barkbands.mean"})};
+		ASSERT_EQ(values.size(), 1);
+		EXPECT_EQ(values.at("lowlevel.barkbands.mean"), (FeatureValues {1, 2, 3}));
+
+		EXPECT_EQ(trackFeatures->getFeatureValues("lowlevel.average_loudness"), FeatureValues {0.5});
+		EXPECT_TRUE(trackFeatures->getFeatureValuesMap({"lowlevel.barkbands.mean", "lowlevel.unknown"}).empty());
+	}
+}
+
+TEST_F(DatabaseFixture, TrackFeatures_missing)
+{
+	ScopedTrack track1 {session, "MyTrack1"};
+	ScopedTrack track2 {session, "MyTrack2"};
+
+	ScopedTrackFeatures trackFeatures {session, track1.lockAndGet(), FeatureValuesMap {}};
+
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		const auto trackIds {Track::findIdsWithMissingFeatures(session)};
+		ASSERT_EQ(trackIds.results.size(), 1);
+		EXPECT_EQ(trackIds.results.front(), track2.getId());
+	}
+}
+
+TEST_F(DatabaseFixture, TrackFeatures_parseJson)
+{
+	const std::optional<FeatureValuesMap> values {TrackFeatures::parseJson(R"({"lowlevel": {"average_loudness": 0.5, "barkbands": {"mean": [1, 2, 3]}}, "metadata": {"version": {"essentia": "2.1"}}})")};
+	ASSERT_TRUE(values);
+	EXPECT_EQ(values->size(), 2);
+	EXPECT_EQ(values->at("lowlevel.average_loudness"), FeatureValues {0.5});
+	EXPECT_EQ(values->at("lowlevel.barkbands.mean"), (FeatureValues {1, 2, 3}));
+
+	EXPECT_FALSE(TrackFeatures::parseJson("{ not json"));
+}
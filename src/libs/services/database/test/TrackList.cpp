@@ -18,6 +18,7 @@
  */
 
 #include <list>
+#include <optional>
 
 #include "Common.hpp"
 
@@ -222,3 +223,203 @@ TEST_F(DatabaseFixture, SingleTrackList_getEntries)
         EXPECT_EQ(entries[0]->getTrack()->getId(), track2.getId());
     }
 }
+
+TEST_F(DatabaseFixture, SingleTrackList_addTracks)
+{
+    ScopedUser user{ session, "MyUser" };
+    ScopedTrackList trackList{ session, "MyTrackList", TrackListType::Playlist, false, user.lockAndGet() };
+    std::list<ScopedTrack> tracks;
+    for (std::size_t i{}; i < 5; ++i)
+        tracks.emplace_back(session, "MyTrack" + std::to_string(i));
+
+    // reversed order, with duplicates and an unknown track
+    std::vector<TrackId> trackIds;
+    for (auto it{ std::crbegin(tracks) }; it != std::crend(tracks); ++it)
+        trackIds.push_back(it->getId());
+    trackIds.push_back(tracks.front().getId());
+    trackIds.push_back(TrackId{ 4242 });
+    trackIds.push_back(tracks.front().getId());
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        trackList.get().modify()->addTracks(trackIds);
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        EXPECT_EQ(trackList->getCount(), 7);
+        const std::vector<TrackId> expectedTrackIds{ trackIds[0], trackIds[1], trackIds[2], trackIds[3], trackIds[4], trackIds[5], trackIds[7] };
+        EXPECT_EQ(trackList->getTrackIds(), expectedTrackIds);
+
+        const auto entries{ trackList->getEntriesWithTracks(Range{ 1, 2 }) };
+        ASSERT_EQ(entries.size(), 2);
+        EXPECT_EQ(entries[0].second->getId(), trackIds[1]);
+        EXPECT_EQ(entries[0].first->getTrack()->getId(), trackIds[1]);
+        EXPECT_EQ(entries[1].second->getId(), trackIds[2]);
+    }
+}
+
+TEST_F(DatabaseFixture, SingleTrackList_removeEntries)
+{
+    ScopedUser user{ session, "MyUser" };
+    ScopedTrackList trackList{ session, "MyTrackList", TrackListType::Playlist, false, user.lockAndGet() };
+    std::list<ScopedTrack> tracks;
+    for (std::size_t i{}; i < 5; ++i)
+        tracks.emplace_back(session, "MyTrack" + std::to_string(i));
+
+    std::vector<TrackId> trackIds;
+    for (const ScopedTrack& track : tracks)
+        trackIds.push_back(track.getId());
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        trackList.get().modify()->addTracks(trackIds);
+    }
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        // unordered, with duplicates and an out of range position
+        trackList.get().modify()->removeEntries({ 3, 0, 42, 3 });
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        EXPECT_EQ(trackList->getCount(), 3);
+        const std::vector<TrackId> expectedTrackIds{ trackIds[1], trackIds[2], trackIds[4] };
+        EXPECT_EQ(trackList->getTrackIds(), expectedTrackIds);
+    }
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        trackList.get().modify()->removeEntries({ 2 });
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        const std::vector<TrackId> expectedTrackIds{ trackIds[1], trackIds[2] };
+        EXPECT_EQ(trackList->getTrackIds(), expectedTrackIds);
+    }
+}
+
+TEST_F(DatabaseFixture, SingleTrackList_visitEntriesWithTracks)
+{
+    ScopedUser user{ session, "MyUser" };
+    ScopedTrackList trackList{ session, "MyTrackList", TrackListType::Playlist, false, user.lockAndGet() };
+    std::list<ScopedTrack> tracks;
+    for (std::size_t i{}; i < 5; ++i)
+        tracks.emplace_back(session, "MyTrack" + std::to_string(i));
+
+    std::vector<TrackId> trackIds;
+    for (auto it{ std::crbegin(tracks) }; it != std::crend(tracks); ++it)
+        trackIds.push_back(it->getId());
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        trackList.get().modify()->addTracks(trackIds);
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        std::vector<std::size_t> pageSizes;
+        std::vector<TrackId> visitedTrackIds;
+        trackList->visitEntriesWithTracks(2, [&](const TrackList::EntriesWithTracksPage& page)
+            {
+                pageSizes.push_back(page.size());
+                for (const auto& [entry, track] : page)
+                {
+                    EXPECT_EQ(entry->getTrack()->getId(), track->getId());
+                    visitedTrackIds.push_back(track->getId());
+                }
+            });
+
+        EXPECT_EQ(pageSizes, (std::vector<std::size_t>{ 2, 2, 1 }));
+        EXPECT_EQ(visitedTrackIds, trackIds);
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        std::size_t pageCount{};
+        trackList->visitEntriesWithTracks(5, [&](const TrackList::EntriesWithTracksPage& page)
+            {
+                EXPECT_EQ(page.size(), 5);
+                pageCount++;
+            });
+        EXPECT_EQ(pageCount, 1);
+    }
+}
+
+TEST_F(DatabaseFixture, SingleTrackList_stats)
+{
+    using namespace std::chrono_literals;
+
+    ScopedUser user{ session, "MyUser" };
+    ScopedTrackList trackList{ session, "MyTrackList", TrackListType::Playlist, false, user.lockAndGet() };
+    ScopedTrack track1{ session, "MyTrack1" };
+    std::optional<ScopedTrack> track2{ std::in_place, session, "MyTrack2" };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+
+        EXPECT_TRUE(trackList->isEmpty());
+        EXPECT_EQ(trackList->getDuration(), 0ms);
+
+        track1.get().modify()->setDuration(1000ms);
+        track2->get().modify()->setDuration(2000ms);
+        trackList.get().modify()->addTracks({ track1.getId(), track2->getId(), track2->getId() });
+        session.create<TrackListEntry>(track1.get(), trackList.get());
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        EXPECT_FALSE(trackList->isEmpty());
+        EXPECT_EQ(trackList->getCount(), 4);
+        EXPECT_EQ(trackList->getDuration(), 6000ms);
+    }
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        track2->get().modify()->setDuration(3000ms);
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        std::size_t visitedCount{};
+        TrackList::find(session, TrackList::FindParameters{}.setUser(user.getId()), [&](const TrackList::pointer& t, const TrackList::Stats& stats)
+            {
+                visitedCount++;
+                EXPECT_EQ(t->getId(), trackList.getId());
+                EXPECT_EQ(stats.entryCount, 4);
+                EXPECT_EQ(stats.duration, 8000ms);
+            });
+        EXPECT_EQ(visitedCount, 1);
+    }
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        trackList.get().modify()->removeEntries({ 0 });
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        EXPECT_EQ(trackList->getCount(), 3);
+        EXPECT_EQ(trackList->getDuration(), 7000ms);
+    }
+
+    // entries removed by cascade
+    track2.reset();
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        EXPECT_EQ(trackList->getCount(), 1);
+        EXPECT_EQ(trackList->getDuration(), 1000ms);
+    }
+}
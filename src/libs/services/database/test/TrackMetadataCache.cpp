@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Common.hpp"
+
+#include "services/database/TrackMetadataCache.hpp"
+
+using ScopedTrackMetadataCache = ScopedEntity<Database::TrackMetadataCache>;
+
+using namespace Database;
+
+TEST_F(DatabaseFixture, TrackMetadataCache)
+{
+	ScopedTrack track {session, "MyTrack"};
+
+	{
+		auto transaction {session.createSharedTransaction()};
+		EXPECT_EQ(TrackMetadataCache::getCount(session), 0);
+		EXPECT_FALSE(TrackMetadataCache::find(session, track.getId()));
+	}
+
+	ScopedTrackMetadataCache cache {session, track.lockAndGet()};
+	const Wt::WDateTime dateTime {Wt::WDate {1950, 1, 1}, Wt::WTime {12, 30, 20}};
+
+	{
+		auto transaction {session.createUniqueTransaction()};
+		cache.get().modify()->setFileLastWriteTime(dateTime);
+		cache.get().modify()->setFileSize(1234);
+		cache.get().modify()->setData({1, 2, 3});
+	}
+
+	{
+		auto transaction {session.createSharedTransaction()};
+		EXPECT_EQ(TrackMetadataCache::getCount(session), 1);
+
+		const TrackMetadataCache::pointer res {TrackMetadataCache::find(session, track.getId())};
+		ASSERT_TRUE(res);
+		EXPECT_EQ(res->getId(), cache.getId());
+		EXPECT_EQ(res->getFileLastWriteTime(), dateTime);
+		EXPECT_EQ(res->getFileSize(), 1234);
+		EXPECT_EQ(res->getData(), (std::vector<unsigned char> {1, 2, 3}));
+	}
+}
+
+TEST_F(DatabaseFixture, TrackMetadataCache_trackRemoved)
+{
+	auto track {std::make_unique<ScopedTrack>(session, "MyTrack")};
+
+	{
+		auto transaction {session.createUniqueTransaction()};
+		session.create<TrackMetadataCache>(track->get());
+		EXPECT_EQ(TrackMetadataCache::getCount(session), 1);
+	}
+
+	track.reset();
+
+	{
+		auto transaction {session.createSharedTransaction()};
+		EXPECT_EQ(TrackMetadataCache::getCount(session), 0);
+	}
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Common.hpp"
+
+#include "services/database/TrackRelations.hpp"
+
+using namespace Database;
+
+TEST_F(DatabaseFixture, TrackRelations)
+{
+    ScopedRelease release{ session, "MyRelease" };
+    ScopedTrack track1{ session, "MyTrackFile1" };
+    ScopedTrack track2{ session, "MyTrackFile2" };
+    ScopedTrack track3{ session, "MyTrackFile3" }; // not loaded
+    ScopedArtist artist1{ session, "MyArtist1" };
+    ScopedArtist artist2{ session, "MyArtist2" };
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+
+        track1.get().modify()->setRelease(release.get());
+        track3.get().modify()->setRelease(release.get());
+        TrackArtistLink::create(session, track1.get(), artist1.get(), TrackArtistLinkType::Artist);
+        TrackArtistLink::create(session, track1.get(), artist2.get(), TrackArtistLinkType::Composer);
+        TrackArtistLink::create(session, track3.get(), artist2.get(), TrackArtistLinkType::ReleaseArtist);
+    }
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        const TrackRelations relations{ session, { track1.getId(), track2.getId() } };
+        EXPECT_TRUE(relations.contains(track1.getId()));
+        EXPECT_TRUE(relations.contains(track2.getId()));
+        EXPECT_FALSE(relations.contains(track3.getId()));
+
+        ASSERT_TRUE(relations.getRelease(track1.getId()));
+        EXPECT_EQ(relations.getRelease(track1.getId())->getId(), release.getId());
+        EXPECT_FALSE(relations.getRelease(track2.getId()));
+
+        EXPECT_EQ(relations.getArtistLinks(track1.getId()).size(), 2);
+        EXPECT_TRUE(relations.getArtistLinks(track2.getId()).empty());
+        {
+            const auto links{ relations.getArtistLinks(track1.getId(), TrackArtistLinkType::Composer) };
+            ASSERT_EQ(links.size(), 1);
+            EXPECT_EQ(links.front()->getArtist()->getId(), artist2.getId());
+        }
+        {
+            const auto artists{ relations.getArtists(track1.getId(), { TrackArtistLinkType::Artist }) };
+            ASSERT_EQ(artists.size(), 1);
+            EXPECT_EQ(artists.front()->getId(), artist1.getId());
+        }
+        EXPECT_EQ(relations.getArtists(track1.getId(), {}).size(), 2);
+
+        // release artists come from all the tracks of the release
+        {
+            const auto artists{ relations.getReleaseArtists(release.getId(), TrackArtistLinkType::ReleaseArtist) };
+            ASSERT_EQ(artists.size(), 1);
+            EXPECT_EQ(artists.front()->getId(), artist2.getId());
+        }
+        EXPECT_EQ(relations.getReleaseArtists(release.getId(), TrackArtistLinkType::Artist).size(), 1);
+    }
+}
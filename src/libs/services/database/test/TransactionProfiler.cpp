@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Common.hpp"
+
+#include "services/database/TransactionProfiler.hpp"
+
+using namespace Database;
+
+TEST_F(DatabaseFixture, TransactionProfiler)
+{
+    TransactionProfiler::reset();
+
+    TransactionProfiler::Parameters parameters;
+    parameters.enabled = true;
+    TransactionProfiler::setParameters(parameters);
+
+    {
+        auto transaction{ session.createUniqueTransaction() };
+        {
+            // nested: not recorded
+            auto nestedTransaction{ session.createUniqueTransaction() };
+        }
+    }
+
+    for (std::size_t i{}; i < 2; ++i)
+    {
+        auto transaction{ session.createSharedTransaction() };
+    }
+
+    TransactionProfiler::setParameters(TransactionProfiler::Parameters{});
+
+    {
+        auto transaction{ session.createSharedTransaction() };
+    }
+
+    const std::vector<TransactionProfiler::SiteStats> stats{ TransactionProfiler::getStats() };
+    ASSERT_EQ(stats.size(), 2);
+    for (const TransactionProfiler::SiteStats& siteStats : stats)
+    {
+        EXPECT_NE(siteStats.site.find("TransactionProfiler.cpp:"), std::string::npos);
+        EXPECT_EQ(siteStats.count, siteStats.type == TransactionProfiler::TransactionType::Unique ? 1 : 2);
+        EXPECT_GE(siteStats.totalHold, siteStats.maxHold);
+        EXPECT_GE(siteStats.totalWait, siteStats.maxWait);
+    }
+
+    TransactionProfiler::reset();
+    EXPECT_TRUE(TransactionProfiler::getStats().empty());
+}
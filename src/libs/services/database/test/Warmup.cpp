@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <unistd.h>
+
+#include "Common.hpp"
+
+#include "services/database/QueryProfiler.hpp"
+#include "services/database/Warmup.hpp"
+
+using namespace Database;
+
+TEST_F(DatabaseFixture, Warmup_hotTables)
+{
+    ScopedTrack track{ session, "MyTrackFile" };
+
+    QueryProfiler::reset();
+    QueryProfiler::setEnabled(true);
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        EXPECT_EQ(Track::findIds(session, Track::FindParameters{}).results.size(), 1);
+        EXPECT_EQ(Track::findIds(session, Track::FindParameters{}).results.size(), 1);
+        EXPECT_EQ(Release::findIds(session, Release::FindParameters{}).results.size(), 0);
+    }
+    QueryProfiler::setEnabled(false);
+
+    const std::vector<std::string> hotTables{ Warmup::getHotTables(session) };
+    ASSERT_GE(hotTables.size(), 2);
+    EXPECT_EQ(hotTables.front(), "track");
+    EXPECT_NE(std::find(std::cbegin(hotTables), std::cend(hotTables), "release"), std::cend(hotTables));
+    EXPECT_EQ(std::find(std::cbegin(hotTables), std::cend(hotTables), "user"), std::cend(hotTables));
+
+    QueryProfiler::reset();
+}
+
+TEST_F(DatabaseFixture, Warmup_run)
+{
+    ScopedTrack track{ session, "MyTrackFile" };
+
+    const std::filesystem::path hotTablesFile{ std::filesystem::temp_directory_path() / ("lms-test-hot-tables-" + std::to_string(::getpid())) };
+    {
+        std::ofstream file{ hotTablesFile };
+        file << "track\nunknown_table\n";
+    }
+
+    Warmup::Parameters parameters;
+    parameters.hotTablesFile = hotTablesFile;
+
+    std::atomic<bool> abort{};
+    EXPECT_NO_THROW(Warmup::run(session.getDb(), parameters, abort));
+
+    parameters.maxSize = 1;
+    parameters.maxThroughput = 1024 * 1024;
+    EXPECT_NO_THROW(Warmup::run(session.getDb(), parameters, abort));
+
+    abort = true;
+    EXPECT_NO_THROW(Warmup::run(session.getDb(), parameters, abort));
+
+    std::filesystem::remove(hotTablesFile);
+}
@@ -29,13 +29,66 @@
 #include "services/database/StarredTrack.hpp"
 #include "services/database/Track.hpp"
 #include "services/database/User.hpp"
+#include "utils/IConfig.hpp"
 #include "utils/Logger.hpp"
+#include "utils/Service.hpp"
+#include "utils/String.hpp"
 
-#include "internal/InternalBackend.hpp"
 #include "listenbrainz/ListenBrainzBackend.hpp"
 
 namespace Feedback
 {
+    namespace
+    {
+        using StarEventQueue = WriteBehindQueue<FeedbackService::StarEvent>;
+
+        StarEventQueue::Parameters getStarEventQueueParameters()
+        {
+            StarEventQueue::Parameters params;
+            params.maxDelay = std::chrono::milliseconds{ Service<IConfig>::get()->getULong("internal-write-behind-delay", 1000) };
+            if (Service<IConfig>::get()->getBool("internal-write-behind-journal", true))
+                params.journalFile = Service<IConfig>::get()->getPath("working-dir") / "journal" / "stars";
+
+            return params;
+        }
+
+        std::string serializeStarEvent(const FeedbackService::StarEvent& event)
+        {
+            return std::to_string(static_cast<int>(event.objectType))
+                + " " + (event.star ? "1" : "0")
+                + " " + std::to_string(event.userId.getValue())
+                + " " + std::to_string(event.objectId)
+                + " " + std::to_string(event.dateTime.isValid() ? event.dateTime.toTime_t() : 0);
+        }
+
+        std::optional<FeedbackService::StarEvent> deserializeStarEvent(std::string_view str)
+        {
+            const std::vector<std::string_view> values{ StringUtils::splitString(str, " ") };
+            if (values.size() != 5)
+                return std::nullopt;
+
+            const auto objectType{ StringUtils::readAs<int>(values[0]) };
+            const auto star{ StringUtils::readAs<int>(values[1]) };
+            const auto userId{ StringUtils::readAs<UserId::ValueType>(values[2]) };
+            const auto objectId{ StringUtils::readAs<IdType::ValueType>(values[3]) };
+            const auto dateTime{ StringUtils::readAs<std::time_t>(values[4]) };
+            if (!objectType || !star || !userId || !objectId || !dateTime)
+                return std::nullopt;
+
+            if (*objectType < static_cast<int>(FeedbackService::StarEvent::ObjectType::Artist) || *objectType > static_cast<int>(FeedbackService::StarEvent::ObjectType::Track))
+                return std::nullopt;
+
+            FeedbackService::StarEvent event;
+            event.objectType = static_cast<FeedbackService::StarEvent::ObjectType>(*objectType);
+            event.star = *star != 0;
+            event.userId = *userId;
+            event.objectId = *objectId;
+            if (*dateTime != 0)
+                event.dateTime = Wt::WDateTime::fromTime_t(*dateTime);
+            return event;
+        }
+    }
+
     std::unique_ptr<IFeedbackService> createFeedbackService(boost::asio::io_context& ioContext, Db& db)
     {
         return std::make_unique<FeedbackService>(ioContext, db);
@@ -43,9 +96,9 @@ namespace Feedback
 
     FeedbackService::FeedbackService(boost::asio::io_context& ioContext, Db& db)
         : _db{ db }
+        , _starEventQueue{ ioContext, getStarEventQueueParameters(), [this](const std::vector<StarEvent>& events) { saveStarEvents(events); }, serializeStarEvent, deserializeStarEvent }
     {
         LMS_LOG(SCROBBLING, INFO) << "Starting service...";
-        _backends.emplace(Database::FeedbackBackend::Internal, std::make_unique<InternalBackend>(_db));
         _backends.emplace(Database::FeedbackBackend::ListenBrainz, std::make_unique<ListenBrainz::ListenBrainzBackend>(ioContext, _db));
         LMS_LOG(SCROBBLING, INFO) << "Service started!";
     }
@@ -67,6 +120,99 @@ namespace Feedback
         return feedbackBackend;
     }
 
+    void FeedbackService::saveStarEvents(const std::vector<StarEvent>& events)
+    {
+        Session& session{ _db.getTLSSession() };
+        auto transaction{ session.createUniqueTransaction() };
+
+        // events are applied in order, so that the last one wins
+        for (const StarEvent& event : events)
+        {
+            switch (event.objectType)
+            {
+            case StarEvent::ObjectType::Artist:
+                saveStarEvent<Artist, StarredArtist>(session, event);
+                break;
+            case StarEvent::ObjectType::Release:
+                saveStarEvent<Release, StarredRelease>(session, event);
+                break;
+            case StarEvent::ObjectType::Track:
+                saveStarEvent<Track, StarredTrack>(session, event);
+                break;
+            }
+        }
+
+        LMS_LOG(SCROBBLING, DEBUG) << "Saved " << events.size() << " star events";
+    }
+
+    void FeedbackService::flushPendingStarEvents()
+    {
+        if (_starEventQueue.hasPendingEvents())
+            _starEventQueue.flush();
+    }
+
+    void FeedbackService::star(UserId userId, const ObjectIds& objectIds)
+    {
+        const auto backend{ getUserFeedbackBackend(userId) };
+        if (!backend)
+            return;
+
+        const Wt::WDateTime now{ Wt::WDateTime::currentDateTime() };
+
+        if (*backend == FeedbackBackend::Internal)
+        {
+            std::vector<StarEvent> events;
+            appendStarEvents(userId, true, objectIds.artistIds, now, events);
+            appendStarEvents(userId, true, objectIds.releaseIds, now, events);
+            appendStarEvents(userId, true, objectIds.trackIds, now, events);
+            _starEventQueue.push(std::move(events));
+            return;
+        }
+
+        IFeedbackBackend::StarredObjectIds starredObjectIds;
+        {
+            Session& session{ _db.getTLSSession() };
+            auto transaction{ session.createUniqueTransaction() };
+
+            const User::pointer user{ User::find(session, userId) };
+            if (!user)
+                return;
+
+            starredObjectIds.starredArtistIds = starObjects<Artist, StarredArtist>(session, user, *backend, objectIds.artistIds, now);
+            starredObjectIds.starredReleaseIds = starObjects<Release, StarredRelease>(session, user, *backend, objectIds.releaseIds, now);
+            starredObjectIds.starredTrackIds = starObjects<Track, StarredTrack>(session, user, *backend, objectIds.trackIds, now);
+        }
+        _backends[*backend]->onStarred(starredObjectIds);
+    }
+
+    void FeedbackService::unstar(UserId userId, const ObjectIds& objectIds)
+    {
+        const auto backend{ getUserFeedbackBackend(userId) };
+        if (!backend)
+            return;
+
+        if (*backend == FeedbackBackend::Internal)
+        {
+            std::vector<StarEvent> events;
+            appendStarEvents(userId, false, objectIds.artistIds, {}, events);
+            appendStarEvents(userId, false, objectIds.releaseIds, {}, events);
+            appendStarEvents(userId, false, objectIds.trackIds, {}, events);
+            _starEventQueue.push(std::move(events));
+            return;
+        }
+
+        IFeedbackBackend::StarredObjectIds starredObjectIds;
+        {
+            Session& session{ _db.getTLSSession() };
+            auto transaction{ session.createSharedTransaction() };
+
+            starredObjectIds.starredArtistIds = findStarredObjects<StarredArtist>(session, userId, *backend, objectIds.artistIds);
+            starredObjectIds.starredReleaseIds = findStarredObjects<StarredRelease>(session, userId, *backend, objectIds.releaseIds);
+            starredObjectIds.starredTrackIds = findStarredObjects<StarredTrack>(session, userId, *backend, objectIds.trackIds);
+        }
+        _backends[*backend]->onUnstarred(starredObjectIds);
+    }
+
     void FeedbackService::star(UserId userId, ArtistId artistId)
     {
         star<Artist, ArtistId, StarredArtist>(userId, artistId);
@@ -87,8 +233,15 @@ namespace Feedback
         return getStarredDateTime<Artist, ArtistId, StarredArtist>(userId, artistId);
     }
 
+    std::unordered_map<ArtistId, Wt::WDateTime> FeedbackService::getStarredDateTimes(UserId userId, const std::vector<ArtistId>& artistIds)
+    {
+        return getStarredDateTimes<ArtistId, StarredArtist>(userId, artistIds);
+    }
+
     FeedbackService::ArtistContainer FeedbackService::findStarredArtists(const ArtistFindParameters& params)
     {
+        flushPendingStarEvents();
+
         auto backend{ getUserFeedbackBackend(params.user) };
         if (!backend)
             return {};
@@ -126,8 +279,15 @@ namespace Feedback
         return getStarredDateTime<Release, ReleaseId, StarredRelease>(userId, releaseId);
     }
 
+    std::unordered_map<ReleaseId, Wt::WDateTime> FeedbackService::getStarredDateTimes(UserId userId, const std::vector<ReleaseId>& releaseIds)
+    {
+        return getStarredDateTimes<ReleaseId, StarredRelease>(userId, releaseIds);
+    }
+
     FeedbackService::ReleaseContainer FeedbackService::findStarredReleases(const FindParameters& params)
     {
+        flushPendingStarEvents();
+
         auto backend{ getUserFeedbackBackend(params.user) };
         if (!backend)
             return {};
@@ -164,8 +324,15 @@ namespace Feedback
         return getStarredDateTime<Track, TrackId, StarredTrack>(userId, trackId);
     }
 
+    std::unordered_map<TrackId, Wt::WDateTime> FeedbackService::getStarredDateTimes(UserId userId, const std::vector<TrackId>& trackIds)
+    {
+        return getStarredDateTimes<TrackId, StarredTrack>(userId, trackIds);
+    }
+
     FeedbackService::TrackContainer FeedbackService::findStarredTracks(const FindParameters& params)
     {
+        flushPendingStarEvents();
+
         auto backend{ getUserFeedbackBackend(params.user) };
         if (!backend)
             return {};
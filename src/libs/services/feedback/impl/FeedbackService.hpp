@@ -21,13 +21,18 @@
 
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
+#include "services/database/Object.hpp"
 #include "services/feedback/IFeedbackService.hpp"
+#include "utils/WriteBehindQueue.hpp"
 #include "IFeedbackBackend.hpp"
 
 namespace Database
 {
     class Db;
+    class Session;
+    class User;
 }
 
 namespace Feedback
@@ -42,37 +47,73 @@ namespace Feedback
         FeedbackService(const FeedbackService&) = delete;
         FeedbackService& operator=(const FeedbackService&) = delete;
 
+        void star(Database::UserId userId, const ObjectIds& objectIds) override;
+        void unstar(Database::UserId userId, const ObjectIds& objectIds) override;
+
         void star(Database::UserId userId, Database::ArtistId artistId) override;
         void unstar(Database::UserId userId, Database::ArtistId artistId) override;
         bool isStarred(Database::UserId userId, Database::ArtistId artistId) override;
         Wt::WDateTime getStarredDateTime(Database::UserId userId, Database::ArtistId artistId) override;
+        std::unordered_map<Database::ArtistId, Wt::WDateTime> getStarredDateTimes(Database::UserId userId, const std::vector<Database::ArtistId>& artistIds) override;
         ArtistContainer	findStarredArtists(const ArtistFindParameters& params) override;
 
         void star(Database::UserId userId, Database::ReleaseId releaseId) override;
         void unstar(Database::UserId userId, Database::ReleaseId releaseId) override;
         bool isStarred(Database::UserId userId, Database::ReleaseId releasedId) override;
         Wt::WDateTime getStarredDateTime(Database::UserId userId, Database::ReleaseId releasedId) override;
+        std::unordered_map<Database::ReleaseId, Wt::WDateTime> getStarredDateTimes(Database::UserId userId, const std::vector<Database::ReleaseId>& releaseIds) override;
         ReleaseContainer findStarredReleases(const FindParameters& params) override;
 
         void star(Database::UserId userId, Database::TrackId trackId) override;
         void unstar(Database::UserId userId, Database::TrackId trackId) override;
         bool isStarred(Database::UserId userId, Database::TrackId trackId) override;
         Wt::WDateTime getStarredDateTime(Database::UserId userId, Database::TrackId trackId) override;
+        std::unordered_map<Database::TrackId, Wt::WDateTime> getStarredDateTimes(Database::UserId userId, const std::vector<Database::TrackId>& trackIds) override;
         TrackContainer findStarredTracks(const FindParameters& params) override;
 
         std::optional<Database::FeedbackBackend> getUserFeedbackBackend(Database::UserId userId);
 
+        // Stars of the internal backend are written behind
+        struct StarEvent
+        {
+            enum class ObjectType
+            {
+                Artist,
+                Release,
+                Track,
+            };
+
+            ObjectType                      objectType;
+            bool                            star; // false means unstar
+            Database::UserId                userId;
+            Database::IdType::ValueType     objectId;
+            Wt::WDateTime                   dateTime;
+        };
+        void saveStarEvents(const std::vector<StarEvent>& events);
+        void flushPendingStarEvents(); // to read consistent values
+
         template <typename ObjType, typename ObjIdType, typename StarredObjType>
         void star(Database::UserId userId, ObjIdType id);
         template <typename ObjType, typename ObjIdType, typename StarredObjType>
         void unstar(Database::UserId userId, ObjIdType id);
+        template <typename ObjType, typename StarredObjType>
+        std::vector<typename StarredObjType::IdType> starObjects(Database::Session& session, const Database::ObjectPtr<Database::User>& user, Database::FeedbackBackend backend, const std::vector<typename ObjType::IdType>& ids, const Wt::WDateTime& dateTime);
+        template <typename StarredObjType, typename ObjIdType>
+        std::vector<typename StarredObjType::IdType> findStarredObjects(Database::Session& session, Database::UserId userId, Database::FeedbackBackend backend, const std::vector<ObjIdType>& ids);
+        template <typename ObjIdType>
+        void appendStarEvents(Database::UserId userId, bool star, const std::vector<ObjIdType>& ids, const Wt::WDateTime& dateTime, std::vector<StarEvent>& events);
         template <typename ObjType, typename ObjIdType, typename StarredObjType>
         bool isStarred(Database::UserId userId, ObjIdType id);
         template <typename ObjType, typename ObjIdType, typename StarredObjType>
         Wt::WDateTime getStarredDateTime(Database::UserId userId, ObjIdType id);
+        template <typename ObjIdType, typename StarredObjType>
+        std::unordered_map<ObjIdType, Wt::WDateTime> getStarredDateTimes(Database::UserId userId, const std::vector<ObjIdType>& ids);
+        template <typename ObjType, typename StarredObjType>
+        void saveStarEvent(Database::Session& session, const StarEvent& event);
 
         Database::Db& _db;
         std::unordered_map<Database::FeedbackBackend, std::unique_ptr<IFeedbackBackend>> _backends;
+        WriteBehindQueue<StarEvent> _starEventQueue;
     };
 
 } // ns Feedback
@@ -19,6 +19,8 @@
 
 #pragma once
 
+#include <type_traits>
+
 #include "services/database/Db.hpp"
 #include "services/database/Session.hpp"
 #include "services/database/User.hpp"
@@ -27,6 +29,23 @@ namespace Feedback
 {
     using namespace Database;
 
+    namespace details
+    {
+        template <typename ObjIdType>
+        constexpr auto getStarEventObjectType()
+        {
+            if constexpr (std::is_same_v<ObjIdType, ArtistId>)
+                return FeedbackService::StarEvent::ObjectType::Artist;
+            else if constexpr (std::is_same_v<ObjIdType, ReleaseId>)
+                return FeedbackService::StarEvent::ObjectType::Release;
+            else
+            {
+                static_assert(std::is_same_v<ObjIdType, TrackId>);
+                return FeedbackService::StarEvent::ObjectType::Track;
+            }
+        }
+    }
+
     template <typename ObjType, typename ObjIdType, typename StarredObjType>
     void FeedbackService::star(UserId userId, ObjIdType objId)
     {
@@ -34,6 +53,12 @@ namespace Feedback
         if (!backend)
             return;
 
+        if (*backend == FeedbackBackend::Internal)
+        {
+            _starEventQueue.push(StarEvent{ details::getStarEventObjectType<ObjIdType>(), true, userId, objId.getValue(), Wt::WDateTime::currentDateTime() });
+            return;
+        }
+
         typename StarredObjType::IdType starredObjId;
         {
             Session& session{ _db.getTLSSession() };
@@ -65,6 +90,12 @@ namespace Feedback
         if (!backend)
             return;
 
+        if (*backend == FeedbackBackend::Internal)
+        {
+            _starEventQueue.push(StarEvent{ details::getStarEventObjectType<ObjIdType>(), false, userId, objId.getValue(), {} });
+            return;
+        }
+
         typename StarredObjType::IdType starredObjId;
         {
             Session& session{ _db.getTLSSession() };
@@ -79,9 +110,57 @@ namespace Feedback
         _backends[*backend]->onUnstarred(starredObjId);
     }
 
+    template <typename ObjType, typename StarredObjType>
+    std::vector<typename StarredObjType::IdType> FeedbackService::starObjects(Session& session, const User::pointer& user, FeedbackBackend backend, const std::vector<typename ObjType::IdType>& ids, const Wt::WDateTime& dateTime)
+    {
+        std::vector<typename StarredObjType::IdType> starredObjIds;
+        starredObjIds.reserve(ids.size());
+
+        for (const typename ObjType::IdType objId : ids)
+        {
+            typename StarredObjType::pointer starredObj{ StarredObjType::find(session, objId, user->getId(), backend) };
+            if (!starredObj)
+            {
+                const typename ObjType::pointer obj{ ObjType::find(session, objId) };
+                if (!obj)
+                    continue;
+
+                starredObj = session.create<StarredObjType>(obj, user, backend);
+            }
+            starredObj.modify()->setDateTime(dateTime);
+            starredObjIds.push_back(starredObj->getId());
+        }
+
+        return starredObjIds;
+    }
+
+    template <typename StarredObjType, typename ObjIdType>
+    std::vector<typename StarredObjType::IdType> FeedbackService::findStarredObjects(Session& session, UserId userId, FeedbackBackend backend, const std::vector<ObjIdType>& ids)
+    {
+        std::vector<typename StarredObjType::IdType> starredObjIds;
+        starredObjIds.reserve(ids.size());
+
+        for (const ObjIdType objId : ids)
+        {
+            if (const typename StarredObjType::pointer starredObj{ StarredObjType::find(session, objId, userId, backend) })
+                starredObjIds.push_back(starredObj->getId());
+        }
+
+        return starredObjIds;
+    }
+
+    template <typename ObjIdType>
+    void FeedbackService::appendStarEvents(UserId userId, bool star, const std::vector<ObjIdType>& ids, const Wt::WDateTime& dateTime, std::vector<StarEvent>& events)
+    {
+        for (const ObjIdType objId : ids)
+            events.push_back(StarEvent{ details::getStarEventObjectType<ObjIdType>(), star, userId, objId.getValue(), dateTime });
+    }
+
     template <typename ObjType, typename ObjIdType, typename StarredObjType>
     bool FeedbackService::isStarred(UserId userId, ObjIdType objId)
     {
+        flushPendingStarEvents();
+
         const auto backend{ getUserFeedbackBackend(userId) };
         if (!backend)
             return false;
@@ -96,6 +175,8 @@ namespace Feedback
     template <typename ObjType, typename ObjIdType, typename StarredObjType>
     Wt::WDateTime FeedbackService::getStarredDateTime(UserId userId, ObjIdType objId)
     {
+        flushPendingStarEvents();
+
         const auto backend{ getUserFeedbackBackend(userId) };
         if (!backend)
             return {};
@@ -110,4 +191,50 @@ namespace Feedback
         return {};
     }
 
-} // ns Feedback
\ No newline at end of file
+    template <typename ObjIdType, typename StarredObjType>
+    std::unordered_map<ObjIdType, Wt::WDateTime> FeedbackService::getStarredDateTimes(UserId userId, const std::vector<ObjIdType>& objIds)
+    {
+        if (objIds.empty())
+            return {};
+
+        flushPendingStarEvents();
+
+        const auto backend{ getUserFeedbackBackend(userId) };
+        if (!backend)
+            return {};
+
+        Session& session{ _db.getTLSSession() };
+        auto transaction{ session.createSharedTransaction() };
+
+        return StarredObjType::getStarredDateTimes(session, userId, *backend, objIds);
+    }
+
+    template <typename ObjType, typename StarredObjType>
+    void FeedbackService::saveStarEvent(Session& session, const StarEvent& event)
+    {
+        const typename ObjType::IdType objId{ event.objectId };
+
+        typename StarredObjType::pointer starredObj{ StarredObjType::find(session, objId, event.userId, FeedbackBackend::Internal) };
+        if (!event.star)
+        {
+            if (starredObj)
+                starredObj.remove();
+            return;
+        }
+
+        if (!starredObj)
+        {
+            const typename ObjType::pointer obj{ ObjType::find(session, objId) };
+            if (!obj)
+                return;
+
+            const User::pointer user{ User::find(session, event.userId) };
+            if (!user)
+                return;
+
+            starredObj = session.create<StarredObjType>(obj, user, FeedbackBackend::Internal);
+        }
+        starredObj.modify()->setDateTime(event.dateTime);
+        starredObj.modify()->setSyncState(SyncState::Synchronized);
+    }
+} // ns Feedback
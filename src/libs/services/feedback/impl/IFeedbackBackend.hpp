@@ -19,6 +19,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include "services/database/StarredArtistId.hpp"
 #include "services/database/StarredReleaseId.hpp"
 #include "services/database/StarredTrackId.hpp"
@@ -36,6 +38,15 @@ namespace Feedback
         virtual void onUnstarred(Database::StarredReleaseId) = 0;
         virtual void onStarred(Database::StarredTrackId) = 0;
         virtual void onUnstarred(Database::StarredTrackId) = 0;
+
+        struct StarredObjectIds
+        {
+            std::vector<Database::StarredArtistId>  starredArtistIds;
+            std::vector<Database::StarredReleaseId> starredReleaseIds;
+            std::vector<Database::StarredTrackId>   starredTrackIds;
+        };
+        virtual void onStarred(const StarredObjectIds&) = 0;
+        virtual void onUnstarred(const StarredObjectIds&) = 0;
     };
 
     std::unique_ptr<IFeedbackBackend> createFeedbackBackend(std::string_view backendName);
@@ -19,7 +19,9 @@
 
 #include "FeedbacksSynchronizer.hpp"
 
-#include <boost/asio/bind_executor.hpp>
+#include <unordered_set>
+#include <utility>
+
 #include <Wt/Json/Array.h>
 #include <Wt/Json/Object.h>
 #include <Wt/Json/Value.h>
@@ -57,6 +59,15 @@ namespace Feedback::ListenBrainz
                 return std::nullopt;
             }
         }
+
+        StaggeredScheduler<Database::UserId>::Parameters createSyncSchedulerParameters(std::chrono::hours period)
+        {
+            StaggeredScheduler<Database::UserId>::Parameters params;
+            params.period = period;
+            params.maxSkippedPeriodCount = Service<IConfig>::get()->getULong("listenbrainz-sync-max-skipped-periods", 4);
+
+            return params;
+        }
     }
 
     FeedbacksSynchronizer::FeedbacksSynchronizer(boost::asio::io_context& ioContext, Database::Db& db, Http::IClient& client)
@@ -65,85 +76,111 @@ namespace Feedback::ListenBrainz
         , _client{ client }
         , _maxSyncFeedbackCount{ Service<IConfig>::get()->getULong("listenbrainz-max-sync-feedback-count", 1000) }
         , _syncFeedbacksPeriod{ Service<IConfig>::get()->getULong("listenbrainz-sync-feedbacks-period-hours", 1) }
+        , _syncScheduler{ _strand, createSyncSchedulerParameters(_syncFeedbacksPeriod), [this] { return startSyncPeriod(); }, [this](Database::UserId userId) { startSync(getUserContext(userId)); } }
     {
         LOG(INFO) << "Starting Feedbacks synchronizer, maxSyncFeedbackCount = " << _maxSyncFeedbackCount << ", _syncFeedbacksPeriod = " << _syncFeedbacksPeriod.count() << " hours";
 
-        scheduleSync(std::chrono::seconds{ 30 });
+        if (_syncFeedbacksPeriod.count() > 0 && _maxSyncFeedbackCount > 0)
+            _syncScheduler.start();
     }
 
     void FeedbacksSynchronizer::enqueFeedback(FeedbackType type, Database::StarredTrackId starredTrackId)
     {
-        try
+        enqueFeedbacks(type, { starredTrackId });
+    }
+
+    void FeedbacksSynchronizer::enqueFeedbacks(FeedbackType type, const std::vector<Database::StarredTrackId>& starredTrackIds)
+    {
+        // sync states are all updated in a single transaction, the requests are sent once it is done
+        std::vector<Http::ClientPOSTRequestParameters> requests;
         {
             Database::Session& session{ _db.getTLSSession() };
-
             auto transaction{ session.createUniqueTransaction() };
 
-            Database::StarredTrack::pointer starredTrack{ Database::StarredTrack::find(session, starredTrackId) };
-            if (!starredTrack)
-                return;
-
-            std::optional<UUID> recordingMBID{ starredTrack->getTrack()->getRecordingMBID() };
-
-            switch (type)
+            for (const Database::StarredTrackId starredTrackId : starredTrackIds)
             {
-            case FeedbackType::Love:
-                if (starredTrack->getSyncState() != Database::SyncState::PendingAdd)
-                    starredTrack.modify()->setSyncState(Database::SyncState::PendingAdd);
-                break;
-
-            case FeedbackType::Erase:
-                if (!recordingMBID)
+                try
                 {
-                    LOG(DEBUG) << "Track has no recording MBID: erasing star";
-                    starredTrack.remove();
+                    if (std::optional<Http::ClientPOSTRequestParameters> request{ createFeedbackRequest(session, type, starredTrackId) })
+                        requests.push_back(std::move(*request));
                 }
-                else
+                catch (Exception& e)
                 {
-                    // Send the erase order even if it is not on the remote LB server (it may be
-                    // queued for add, or not)
-                    starredTrack.modify()->setSyncState(Database::SyncState::PendingRemove);
+                    LOG(DEBUG) << "Cannot send feedback: " << e.what();
                 }
-                break;
-
-            default:
-                throw Exception{ "Unhandled feedback type" };
             }
+        }
 
-            if (!recordingMBID)
-            {
-                LOG(DEBUG) << "Track has no recording MBID: skipping";
-                return;
-            }
+        for (Http::ClientPOSTRequestParameters& request : requests)
+            _client.sendPOSTRequest(std::move(request));
+    }
 
-            const std::optional<UUID> listenBrainzToken{ starredTrack->getUser()->getListenBrainzToken() };
-            if (!listenBrainzToken)
-                return;
+    std::optional<Http::ClientPOSTRequestParameters> FeedbacksSynchronizer::createFeedbackRequest(Database::Session& session, FeedbackType type, Database::StarredTrackId starredTrackId)
+    {
+        Database::StarredTrack::pointer starredTrack{ Database::StarredTrack::find(session, starredTrackId) };
+        if (!starredTrack)
+            return std::nullopt;
 
-            Http::ClientPOSTRequestParameters request;
-            request.relativeUrl = "/1/feedback/recording-feedback";
-            request.message.addHeader("Authorization", "Token " + std::string{ listenBrainzToken->getAsString() });
+        std::optional<UUID> recordingMBID{ starredTrack->getTrack()->getRecordingMBID() };
 
-            Wt::Json::Object root;
-            root["recording_mbid"] = Wt::Json::Value{ std::string {recordingMBID->getAsString()} };
-            root["score"] = Wt::Json::Value{ static_cast<int>(type) };
+        switch (type)
+        {
+        case FeedbackType::Love:
+            if (starredTrack->getSyncState() != Database::SyncState::PendingAdd)
+                starredTrack.modify()->setSyncState(Database::SyncState::PendingAdd);
+            break;
 
-            request.message.addBodyText(Wt::Json::serialize(root));
-            request.message.addHeader("Content-Type", "application/json");
+        case FeedbackType::Erase:
+            if (!recordingMBID)
+            {
+                LOG(DEBUG) << "Track has no recording MBID: erasing star";
+                starredTrack.remove();
+            }
+            else
+            {
+                // Send the erase order even if it is not on the remote LB server (it may be
+                // queued for add, or not)
+                starredTrack.modify()->setSyncState(Database::SyncState::PendingRemove);
+            }
+            break;
 
-            request.onSuccessFunc = [=](std::string_view /*msgBody*/)
-                {
-                    _strand.dispatch([=]
-                        {
-                            onFeedbackSent(type, starredTrackId);
-                        });
-                };
-            _client.sendPOSTRequest(std::move(request));
+        default:
+            throw Exception{ "Unhandled feedback type" };
         }
-        catch (Exception& e)
+
+        if (!recordingMBID)
         {
-            LOG(DEBUG) << "Cannot send feedback: " << e.what();
+            LOG(DEBUG) << "Track has no recording MBID: skipping";
+            return std::nullopt;
         }
+
+        const std::optional<UUID> listenBrainzToken{ starredTrack->getUser()->getListenBrainzToken() };
+        if (!listenBrainzToken)
+            return std::nullopt;
+
+        Http::ClientPOSTRequestParameters request;
+        request.relativeUrl = "/1/feedback/recording-feedback";
+        request.onRateLimitFunc = [this](std::size_t remainingCount, std::chrono::seconds resetIn) { onRateLimit(remainingCount, resetIn); };
+        request.message.addHeader("Authorization", "Token " + std::string{ listenBrainzToken->getAsString() });
+
+        Wt::Json::Object root;
+        root["recording_mbid"] = Wt::Json::Value{ std::string {recordingMBID->getAsString()} };
+        root["score"] = Wt::Json::Value{ static_cast<int>(type) };
+
+        request.message.addBodyText(Wt::Json::serialize(root));
+        request.message.addHeader("Content-Type", "application/json");
+
+        request.onSuccessFunc = [=](std::string_view /*msgBody*/)
+            {
+                _strand.dispatch([=]
+                    {
+                        onFeedbackSent(type, starredTrackId);
+                    });
+            };
+
+        _strand.dispatch([this, userId = starredTrack->getUser()->getId()] { _syncScheduler.onLocalChange(userId); });
+
+        return request;
     }
 
     void FeedbacksSynchronizer::onFeedbackSent(FeedbackType type, Database::StarredTrackId starredTrackId)
@@ -213,8 +250,7 @@ namespace Feedback::ListenBrainz
 
             LOG(DEBUG) << "Queing " << pendingFeedbacks.results.size() << " pending '" << (feedbackType == FeedbackType::Love ? "love" : "erase") << "' feedbacks";
 
-            for (const StarredTrackId starredTrackId : pendingFeedbacks.results)
-                enqueFeedback(feedbackType, starredTrackId);
+            enqueFeedbacks(feedbackType, pendingFeedbacks.results);
         } };
 
         processPendingFeedbacks(SyncState::PendingAdd, FeedbackType::Love);
@@ -234,42 +270,10 @@ namespace Feedback::ListenBrainz
         return itContext->second;
     }
 
-    bool FeedbacksSynchronizer::isSyncing() const
+    std::vector<Database::UserId> FeedbacksSynchronizer::startSyncPeriod()
     {
-        return std::any_of(std::cbegin(_userContexts), std::cend(_userContexts), [](const auto& contextEntry)
-            {
-                return contextEntry.second.syncing;
-            });
-    }
+        LOG(DEBUG) << "Starting sync period!";
 
-    void FeedbacksSynchronizer::scheduleSync(std::chrono::seconds fromNow)
-    {
-        if (_syncFeedbacksPeriod.count() == 0 || _maxSyncFeedbackCount == 0)
-            return;
-
-        LOG(DEBUG) << "Scheduled sync in " << fromNow.count() << " seconds...";
-        _syncTimer.expires_after(fromNow);
-        _syncTimer.async_wait(boost::asio::bind_executor(_strand, [this](const boost::system::error_code& ec)
-            {
-                if (ec == boost::asio::error::operation_aborted)
-                {
-                    LOG(DEBUG) << "getFeedbacks aborted";
-                    return;
-                }
-                else if (ec)
-                {
-                    throw Exception{ "GetFeedbacks timer failure: " + std::string {ec.message()} };
-                }
-
-                startSync();
-            }));
-    }
-
-    void FeedbacksSynchronizer::startSync()
-    {
-        LOG(DEBUG) << "Starting sync!";
-
-        assert(!isSyncing());
         assert(_strand.running_in_this_thread());
 
         enquePendingFeedbacks();
@@ -281,17 +285,13 @@ namespace Feedback::ListenBrainz
             userIds = Database::User::find(_db.getTLSSession(), Database::User::FindParameters{}.setFeedbackBackend(Database::FeedbackBackend::ListenBrainz));
         }
 
-        for (const Database::UserId userId : userIds.results)
-            startSync(getUserContext(userId));
-
-        if (!isSyncing())
-            scheduleSync(_syncFeedbacksPeriod);
+        // user syncs are spread over the period
+        return userIds.results;
     }
 
     void FeedbacksSynchronizer::startSync(UserContext& context)
     {
-        context.syncing = true;
-        context.listenBrainzUserName = "";
+        context.foundChanges.reset();
         context.fetchedFeedbackCount = 0;
         context.matchedFeedbackCount = 0;
         context.importedFeedbackCount = 0;
@@ -304,27 +304,42 @@ namespace Feedback::ListenBrainz
         _strand.dispatch([this, &context]
             {
                 LOG(INFO) << "Feedback sync done for user '" << context.listenBrainzUserName << "', fetched: " << context.fetchedFeedbackCount << ", matched: " << context.matchedFeedbackCount << ", imported: " << context.importedFeedbackCount;
-                context.syncing = false;
+                _syncScheduler.onSyncEnded(context.userId, context.foundChanges);
+            });
+    }
 
-                if (!isSyncing())
-                    scheduleSync(_syncFeedbacksPeriod);
+    void FeedbacksSynchronizer::onRateLimit(std::size_t remainingCount, std::chrono::seconds resetIn)
+    {
+        _strand.dispatch([this, remainingCount, resetIn]
+            {
+                _syncScheduler.onRateLimit(remainingCount, resetIn);
             });
     }
 
     void FeedbacksSynchronizer::enqueValidateToken(UserContext& context)
     {
-        assert(context.listenBrainzUserName.empty());
-
         const std::optional<UUID> listenBrainzToken{ ListenBrainz::Utils::getListenBrainzToken(_db.getTLSSession(), context.userId) };
         if (!listenBrainzToken)
         {
+            context.listenBrainzUserName.clear();
             onSyncEnded(context);
             return;
         }
 
+        // the token has already been validated
+        if (!context.listenBrainzUserName.empty() && context.listenBrainzToken == listenBrainzToken->getAsString())
+        {
+            enqueGetFeedbackCount(context);
+            return;
+        }
+
+        context.listenBrainzUserName.clear();
+        context.listenBrainzToken = listenBrainzToken->getAsString();
+
         Http::ClientGETRequestParameters request;
         request.priority = Http::ClientRequestParameters::Priority::Low;
         request.relativeUrl = "/1/validate-token";
+        request.onRateLimitFunc = [this](std::size_t remainingCount, std::chrono::seconds resetIn) { onRateLimit(remainingCount, resetIn); };
         request.headers = { {"Authorization",  "Token " + std::string {listenBrainzToken->getAsString()}} };
         request.onSuccessFunc = [this, &context](std::string_view msgBody)
             {
@@ -351,6 +366,7 @@ namespace Feedback::ListenBrainz
         Http::ClientGETRequestParameters request;
         request.relativeUrl = "/1/feedback/user/" + std::string{ context.listenBrainzUserName } + "/get-feedback?score=1&count=0";
         request.priority = Http::ClientRequestParameters::Priority::Low;
+        request.onRateLimitFunc = [this](std::size_t remainingCount, std::chrono::seconds resetIn) { onRateLimit(remainingCount, resetIn); };
         request.onSuccessFunc = [this, &context](std::string_view msgBody)
             {
                 std::string msgBodyCopy{ msgBody };
@@ -363,6 +379,8 @@ namespace Feedback::ListenBrainz
                             LOG(DEBUG) << "Feedback count for listenbrainz user '" << context.listenBrainzUserName << "' = " << *totalFeedbackCount;
 
                         bool needSync{ totalFeedbackCount && (!context.feedbackCount || *context.feedbackCount != *totalFeedbackCount) };
+                        if (totalFeedbackCount)
+                            context.foundChanges = needSync;
                         context.feedbackCount = totalFeedbackCount;
 
                         if (needSync)
@@ -386,6 +404,7 @@ namespace Feedback::ListenBrainz
         Http::ClientGETRequestParameters request;
         request.relativeUrl = "/1/feedback/user/" + context.listenBrainzUserName + "/get-feedback?offset=" + std::to_string(context.fetchedFeedbackCount);
         request.priority = Http::ClientRequestParameters::Priority::Low;
+        request.onRateLimitFunc = [this](std::size_t remainingCount, std::chrono::seconds resetIn) { onRateLimit(remainingCount, resetIn); };
         request.onSuccessFunc = [this, &context](std::string_view msgBody)
             {
                 std::string msgBodyCopy{ msgBody };
@@ -419,72 +438,89 @@ namespace Feedback::ListenBrainz
         LOG(DEBUG) << "Parsed " << parseResult.feedbackCount << " feedbacks, found " << parseResult.feedbacks.size() << " usable entries";
         context.fetchedFeedbackCount += parseResult.feedbackCount;
 
-        for (const Feedback& feedback : parseResult.feedbacks)
-        {
-            tryImportFeedback(feedback, context);
-        }
+        importFeedbacks(parseResult.feedbacks, context);
 
         return parseResult.feedbackCount;
     }
 
-    void FeedbacksSynchronizer::tryImportFeedback(const Feedback& feedback, UserContext& context)
+    void FeedbacksSynchronizer::importFeedbacks(const std::vector<Feedback>& feedbacks, UserContext& context)
     {
         using namespace Database;
 
-        Session& session{ _db.getTLSSession() };
+        if (feedbacks.empty())
+            return;
 
-        bool needImport{};
-        TrackId trackId;
+        Session& session{ _db.getTLSSession() };
 
+        std::vector<std::pair<const Feedback*, TrackId>> matchedFeedbacks;
         {
             auto transaction{ session.createSharedTransaction() };
-            const std::vector<Track::pointer> tracks{ Track::findByRecordingMBID(session, feedback.recordingMBID) };
-            if (tracks.size() > 1)
-            {
-                LOG(DEBUG) << "Too many matches for feedback '" << feedback << "': duplicate recording MBIDs found";
-                return;
-            }
-            else if (tracks.empty())
+
+            std::vector<UUID> recordingMBIDs;
+            recordingMBIDs.reserve(feedbacks.size());
+            for (const Feedback& feedback : feedbacks)
+                recordingMBIDs.push_back(feedback.recordingMBID);
+
+            const auto trackIdsByRecordingMBID{ Track::findIdsByRecordingMBIDs(session, recordingMBIDs) };
+            for (const Feedback& feedback : feedbacks)
             {
-                LOG(DEBUG) << "Cannot match feedback '" << feedback << "': no track found for this recording MBID";
-                return;
+                const auto itTrackIds{ trackIdsByRecordingMBID.find(std::string{ feedback.recordingMBID.getAsString() }) };
+                if (itTrackIds == std::cend(trackIdsByRecordingMBID))
+                {
+                    LOG(DEBUG) << "Cannot match feedback '" << feedback << "': no track found for this recording MBID";
+                    continue;
+                }
+                else if (itTrackIds->second.size() > 1)
+                {
+                    LOG(DEBUG) << "Too many matches for feedback '" << feedback << "': duplicate recording MBIDs found";
+                    continue;
+                }
+
+                matchedFeedbacks.emplace_back(&feedback, itTrackIds->second.front());
             }
+        }
 
-            trackId = tracks.front()->getId();
+        if (matchedFeedbacks.empty())
+            return;
 
-            const StarredTrack::pointer starredTrack{ StarredTrack::find(session, trackId, context.userId, Database::FeedbackBackend::ListenBrainz) };
-            needImport = !starredTrack;
+        auto transaction{ session.createUniqueTransaction() };
 
-            // don't update starred date time
-            // no need to update state if it was found as not synchronized
-            // pending remove => will be removed later
-            // pending add => will be resent later
-        }
+        const User::pointer user{ User::find(session, context.userId) };
+        if (!user)
+            return;
 
-        if (needImport)
-        {
-            LOG(DEBUG) << "Importing feedback '" << feedback << "'";
+        std::vector<TrackId> trackIds;
+        trackIds.reserve(matchedFeedbacks.size());
+        for (const auto& [feedback, trackId] : matchedFeedbacks)
+            trackIds.push_back(trackId);
 
-            auto transaction{ session.createUniqueTransaction() };
+        // don't update starred date time
+        // no need to update state if it was found as not synchronized
+        // pending remove => will be removed later
+        // pending add => will be resent later
+        std::unordered_set<TrackId> starredTrackIds{ StarredTrack::findStarredTrackIds(session, context.userId, Database::FeedbackBackend::ListenBrainz, trackIds) };
+
+        for (const auto& [feedback, trackId] : matchedFeedbacks)
+        {
+            if (starredTrackIds.find(trackId) != std::cend(starredTrackIds))
+            {
+                LOG(DEBUG) << "No need to import feedback '" << *feedback << "', already imported";
+                context.matchedFeedbackCount++;
+                continue;
+            }
 
             const Track::pointer track{ Track::find(session, trackId) };
             if (!track)
-                return;
+                continue;
 
-            const User::pointer user{ User::find(session, context.userId) };
-            if (!user)
-                return;
+            LOG(DEBUG) << "Importing feedback '" << *feedback << "'";
 
             StarredTrack::pointer starredTrack{ session.create<StarredTrack>(track, user, Database::FeedbackBackend::ListenBrainz) };
             starredTrack.modify()->setSyncState(SyncState::Synchronized);
-            starredTrack.modify()->setDateTime(feedback.created);
+            starredTrack.modify()->setDateTime(feedback->created);
+            starredTrackIds.insert(trackId);
 
             context.importedFeedbackCount++;
         }
-        else
-        {
-            LOG(DEBUG) << "No need to import feedback '" << feedback << "', already imported";
-            context.matchedFeedbackCount++;
-        }
     }
 } // namespace Feedback::ListenBrainz
@@ -21,19 +21,22 @@
 
 #include <optional>
 #include <unordered_map>
+#include <vector>
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/io_context_strand.hpp>
-#include <boost/asio/steady_timer.hpp>
 
 #include "services/database/Types.hpp"
 #include "services/database/StarredTrackId.hpp"
 #include "services/database/UserId.hpp"
+#include "utils/http/ClientRequestParameters.hpp"
+#include "utils/StaggeredScheduler.hpp"
 
 #include "FeedbackTypes.hpp"
 
 namespace Database
 {
     class Db;
+    class Session;
 }
 
 namespace Http
@@ -49,8 +52,10 @@ namespace Feedback::ListenBrainz
         FeedbacksSynchronizer(boost::asio::io_context& ioContext, Database::Db& db, Http::IClient& client);
 
         void enqueFeedback(FeedbackType type, Database::StarredTrackId starredTrackId);
+        void enqueFeedbacks(FeedbackType type, const std::vector<Database::StarredTrackId>& starredTrackIds);
 
     private:
+        std::optional<Http::ClientPOSTRequestParameters> createFeedbackRequest(Database::Session& session, FeedbackType type, Database::StarredTrackId starredTrackId);
         void onFeedbackSent(FeedbackType type, Database::StarredTrackId starredTrackId);
 
         void enquePendingFeedbacks();
@@ -63,12 +68,12 @@ namespace Feedback::ListenBrainz
             UserContext& operator=(const UserContext&) = delete;
             
             const Database::UserId		userId;
-            bool						syncing{};
             std::optional<std::size_t>	feedbackCount{};
+            std::string					listenBrainzUserName; // need to be resolved first
+            std::string					listenBrainzToken; // the user name is resolved again when the token changes
 
             // resetted at each sync
-            std::string		listenBrainzUserName; // need to be resolved first
-
+            std::optional<bool>	foundChanges; // empty until the feedback count is checked
             std::size_t		currentOffset{};
             std::size_t		fetchedFeedbackCount{};
             std::size_t		matchedFeedbackCount{};
@@ -76,27 +81,26 @@ namespace Feedback::ListenBrainz
         };
 
         UserContext& getUserContext(Database::UserId userId);
-        bool isSyncing() const;
-        void scheduleSync(std::chrono::seconds fromNow);
-        void startSync();
+        std::vector<Database::UserId> startSyncPeriod();
         void startSync(UserContext& context);
+        void onRateLimit(std::size_t remainingCount, std::chrono::seconds resetIn);
         void onSyncEnded(UserContext& context);
         void enqueValidateToken(UserContext& context);
         void enqueGetFeedbackCount(UserContext& context);
         void enqueGetFeedbacks(UserContext& context);
         std::size_t processGetFeedbacks(std::string_view body, UserContext& context);
-        void tryImportFeedback(const Feedback& feedback, UserContext& context);
+        void importFeedbacks(const std::vector<Feedback>& feedbacks, UserContext& context);
 
         boost::asio::io_context& _ioContext;
         boost::asio::io_context::strand	_strand{ _ioContext };
         Database::Db& _db;
-        boost::asio::steady_timer		_syncTimer{ _ioContext };
         Http::IClient& _client;
 
         std::unordered_map<Database::UserId, UserContext> _userContexts;
 
         const std::size_t			_maxSyncFeedbackCount;
         const std::chrono::hours	_syncFeedbacksPeriod;
+        StaggeredScheduler<Database::UserId>	_syncScheduler;
     };
 } // Feedback::ListenBrainz
 
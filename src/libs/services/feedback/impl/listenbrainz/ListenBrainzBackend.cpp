@@ -37,7 +37,7 @@ namespace Feedback::ListenBrainz
         template <typename StarredObjType>
         void onStarred(Database::Session& session, typename StarredObjType::IdType id)
         {
-            auto transaction{ session.createUniqueTransaction() };
+            session.checkUniqueLocked();
 
             if (auto starredObj{ StarredObjType::find(session, id) })
             {
@@ -49,7 +49,7 @@ namespace Feedback::ListenBrainz
         template <typename StarredObjType>
         void onUnstarred(Database::Session& session, typename StarredObjType::IdType id)
         {
-            auto transaction{ session.createUniqueTransaction() };
+            session.checkUniqueLocked();
 
             if (auto starredObj{ StarredObjType::find(session, id) })
                 starredObj.remove();
@@ -60,7 +60,7 @@ namespace Feedback::ListenBrainz
         : _ioContext{ ioContext }
         , _db{ db }
         , _baseAPIUrl{ Service<IConfig>::get()->getString("listenbrainz-api-base-url", "https://api.listenbrainz.org") }
-        , _client{ Http::createClient(_ioContext, _baseAPIUrl) }
+        , _client{ Http::createClient(_ioContext, _baseAPIUrl, Service<IConfig>::get()->getULong("listenbrainz-max-inflight-requests", 2)) }
         , _feedbacksSynchronizer{ _ioContext, db, *_client }
     {
         LOG(INFO) << "Starting ListenBrainz feedback backend... API endpoint = '" << _baseAPIUrl << "'";
@@ -73,22 +73,22 @@ namespace Feedback::ListenBrainz
 
     void ListenBrainzBackend::onStarred(Database::StarredArtistId starredArtistId)
     {
-        details::onStarred<Database::StarredArtist>(_db.getTLSSession(), starredArtistId);
+        onStarred(StarredObjectIds{ { starredArtistId }, {}, {} });
     }
 
     void ListenBrainzBackend::onUnstarred(Database::StarredArtistId starredArtistId)
     {
-        details::onUnstarred<Database::StarredArtist>(_db.getTLSSession(), starredArtistId);
+        onUnstarred(StarredObjectIds{ { starredArtistId }, {}, {} });
     }
 
     void ListenBrainzBackend::onStarred(Database::StarredReleaseId starredReleaseId)
     {
-        details::onStarred<Database::StarredRelease>(_db.getTLSSession(), starredReleaseId);
+        onStarred(StarredObjectIds{ {}, { starredReleaseId }, {} });
     }
 
     void ListenBrainzBackend::onUnstarred(Database::StarredReleaseId starredReleaseId)
     {
-        details::onUnstarred<Database::StarredRelease>(_db.getTLSSession(), starredReleaseId);
+        onUnstarred(StarredObjectIds{ {}, { starredReleaseId }, {} });
     }
 
     void ListenBrainzBackend::onStarred(Database::StarredTrackId starredTrackId)
@@ -100,4 +100,38 @@ namespace Feedback::ListenBrainz
     {
         _feedbacksSynchronizer.enqueFeedback(FeedbackType::Erase, starredtrackId);
     }
+
+    void ListenBrainzBackend::onStarred(const StarredObjectIds& starredObjectIds)
+    {
+        if (!starredObjectIds.starredArtistIds.empty() || !starredObjectIds.starredReleaseIds.empty())
+        {
+            Database::Session& session{ _db.getTLSSession() };
+            auto transaction{ session.createUniqueTransaction() };
+
+            for (const Database::StarredArtistId starredArtistId : starredObjectIds.starredArtistIds)
+                details::onStarred<Database::StarredArtist>(session, starredArtistId);
+            for (const Database::StarredReleaseId starredReleaseId : starredObjectIds.starredReleaseIds)
+                details::onStarred<Database::StarredRelease>(session, starredReleaseId);
+        }
+
+        if (!starredObjectIds.starredTrackIds.empty())
+            _feedbacksSynchronizer.enqueFeedbacks(FeedbackType::Love, starredObjectIds.starredTrackIds);
+    }
+
+    void ListenBrainzBackend::onUnstarred(const StarredObjectIds& starredObjectIds)
+    {
+        if (!starredObjectIds.starredArtistIds.empty() || !starredObjectIds.starredReleaseIds.empty())
+        {
+            Database::Session& session{ _db.getTLSSession() };
+            auto transaction{ session.createUniqueTransaction() };
+
+            for (const Database::StarredArtistId starredArtistId : starredObjectIds.starredArtistIds)
+                details::onUnstarred<Database::StarredArtist>(session, starredArtistId);
+            for (const Database::StarredReleaseId starredReleaseId : starredObjectIds.starredReleaseIds)
+                details::onUnstarred<Database::StarredRelease>(session, starredReleaseId);
+        }
+
+        if (!starredObjectIds.starredTrackIds.empty())
+            _feedbacksSynchronizer.enqueFeedbacks(FeedbackType::Erase, starredObjectIds.starredTrackIds);
+    }
 } // namespace Scrobbling::ListenBrainz
@@ -49,6 +49,8 @@ namespace Feedback::ListenBrainz
         void onUnstarred(Database::StarredReleaseId starredReleaseId) override;
         void onStarred(Database::StarredTrackId starredTrackId) override;
         void onUnstarred(Database::StarredTrackId starredTrackId) override;
+        void onStarred(const StarredObjectIds& starredObjectIds) override;
+        void onUnstarred(const StarredObjectIds& starredObjectIds) override;
 
         boost::asio::io_context& _ioContext;
         Database::Db& _db;
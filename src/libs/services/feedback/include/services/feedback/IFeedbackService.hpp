@@ -21,6 +21,8 @@
 
 #include <memory>
 #include <optional>
+#include <unordered_map>
+#include <vector>
 #include <boost/asio/io_service.hpp>
 #include <Wt/WDateTime.h>
 
@@ -59,6 +61,16 @@ namespace Feedback
             FindParameters& setRange(std::optional<Database::Range> _range) { range = _range; return *this; }
         };
 
+        // Batch operations: a single write transaction, and the backend is notified once
+        struct ObjectIds
+        {
+            std::vector<Database::ArtistId>     artistIds;
+            std::vector<Database::ReleaseId>    releaseIds;
+            std::vector<Database::TrackId>      trackIds;
+        };
+        virtual void                star(Database::UserId userId, const ObjectIds& objectIds) = 0;
+        virtual void                unstar(Database::UserId userId, const ObjectIds& objectIds) = 0;
+
         // Artists
         struct ArtistFindParameters : public FindParameters
         {
@@ -73,6 +85,7 @@ namespace Feedback
         virtual void                unstar(Database::UserId userId, Database::ArtistId artistId) = 0;
         virtual bool                isStarred(Database::UserId userId, Database::ArtistId artistId) = 0;
         virtual Wt::WDateTime       getStarredDateTime(Database::UserId userId, Database::ArtistId artistId) = 0;
+        virtual std::unordered_map<Database::ArtistId, Wt::WDateTime> getStarredDateTimes(Database::UserId userId, const std::vector<Database::ArtistId>& artistIds) = 0; // not starred artists are not reported
         virtual ArtistContainer	    findStarredArtists(const ArtistFindParameters& params) = 0;
 
         // Releases
@@ -80,6 +93,7 @@ namespace Feedback
         virtual void                unstar(Database::UserId userId, Database::ReleaseId releaseId) = 0;
         virtual bool                isStarred(Database::UserId userId, Database::ReleaseId artistId) = 0;
         virtual Wt::WDateTime       getStarredDateTime(Database::UserId userId, Database::ReleaseId artistId) = 0;
+        virtual std::unordered_map<Database::ReleaseId, Wt::WDateTime> getStarredDateTimes(Database::UserId userId, const std::vector<Database::ReleaseId>& releaseIds) = 0; // not starred releases are not reported
         virtual ReleaseContainer    findStarredReleases(const FindParameters& params) = 0;
 
         // Tracks
@@ -87,6 +101,7 @@ namespace Feedback
         virtual void                unstar(Database::UserId userId, Database::TrackId trackId) = 0;
         virtual bool                isStarred(Database::UserId userId, Database::TrackId artistId) = 0;
         virtual Wt::WDateTime       getStarredDateTime(Database::UserId userId, Database::TrackId artistId) = 0;
+        virtual std::unordered_map<Database::TrackId, Wt::WDateTime> getStarredDateTimes(Database::UserId userId, const std::vector<Database::TrackId>& trackIds) = 0; // not starred tracks are not reported
         virtual TrackContainer      findStarredTracks(const FindParameters& params) = 0;
     };
 
@@ -19,9 +19,13 @@
 
 #include "PlaylistGeneratorService.hpp"
 
+#include <algorithm>
+#include <mutex>
+
 #include "services/database/Db.hpp"
 #include "services/database/Session.hpp"
 #include "services/database/Track.hpp"
+#include "services/database/TrackRelations.hpp"
 #include "services/recommendation/IRecommendationService.hpp"
 #include "playlist-constraints/ConsecutiveArtists.hpp"
 #include "playlist-constraints/ConsecutiveReleases.hpp"
@@ -41,8 +45,8 @@ namespace Recommendation
         : _db{ db }
         , _recommendationService{ recommendationService }
     {
-        _constraints.push_back(std::make_unique<PlaylistGeneratorConstraint::ConsecutiveArtists>(_db));
-        _constraints.push_back(std::make_unique<PlaylistGeneratorConstraint::ConsecutiveReleases>(_db));
+        _constraints.push_back(std::make_unique<PlaylistGeneratorConstraint::ConsecutiveArtists>());
+        _constraints.push_back(std::make_unique<PlaylistGeneratorConstraint::ConsecutiveReleases>());
         _constraints.push_back(std::make_unique<PlaylistGeneratorConstraint::DuplicateTracks>());
     }
 
@@ -50,51 +54,99 @@ namespace Recommendation
     {
         LMS_LOG(RECOMMENDATION, DEBUG) << "Requested to extend playlist by " << maxCount << " similar tracks";
 
-        // supposed to be ordered from most similar to least similar
-        std::vector<TrackId> similarTracks{ _recommendationService.findSimilarTracks(tracklistId, maxCount * 2) }; // ask for more tracks than we need as it will be easier to respect constraints
-
         const std::vector<TrackId> startingTracks{ getTracksFromTrackList(tracklistId) };
 
-        std::vector<TrackId> finalResult = startingTracks;
+        const std::shared_ptr<RadioSession> radioSession{ getRadioSession(tracklistId, startingTracks) };
+        const std::scoped_lock lock{ radioSession->getMutex() };
+
+        // candidates are ordered from most similar to least similar
+        // consider more tracks than we need as it will be easier to respect constraints
+        const std::size_t candidateCount{ maxCount * 2 };
+        radioSession->topUp(candidateCount, [this](const TrackContainer& seedTrackIds, std::size_t count)
+            {
+                return _recommendationService.findSimilarTracks(seedTrackIds, count);
+            });
+
+        // constraints are evaluated in memory, using the infos of all the involved tracks
+        PlaylistGeneratorConstraint::TrackInfos trackInfos{ getTrackInfos([&]
+            {
+                const std::deque<TrackId>& candidates{ radioSession->getCandidates() };
+
+                std::vector<TrackId> trackIds{ startingTracks };
+                trackIds.insert(std::end(trackIds), std::cbegin(candidates), std::cbegin(candidates) + std::min(candidateCount, candidates.size()));
+                return trackIds;
+            }()) };
+
+        std::vector<TrackId> finalResult;
         finalResult.reserve(startingTracks.size() + maxCount);
 
-        std::vector<float> scores;
+        auto appendTrack{ [&](TrackId trackId)
+        {
+            finalResult.push_back(trackId);
+            trackInfos[trackId].playlistCount++;
+        } };
+
+        for (const TrackId trackId : startingTracks)
+            appendTrack(trackId);
+
         for (std::size_t i{}; i < maxCount; ++i)
         {
-            if (similarTracks.empty())
+            // only the candidates whose infos were fetched are considered
+            const std::deque<TrackId>& candidates{ radioSession->getCandidates() };
+            const std::size_t similarTrackCount{ std::min(candidateCount - i, candidates.size()) };
+            if (similarTrackCount == 0)
                 break;
 
-            scores.resize(similarTracks.size(), {});
-
             // select the similar track that has the best score
-            for (std::size_t trackIndex{}; trackIndex < similarTracks.size(); ++trackIndex)
+            std::size_t bestScoreIndex{};
+            float bestScore{};
+            for (std::size_t trackIndex{}; trackIndex < similarTrackCount; ++trackIndex)
             {
-                using namespace Database::Debug;
-
-                finalResult.push_back(similarTracks[trackIndex]);
-
-                scores[trackIndex] = 0;
+                float score{};
                 for (const auto& constraint : _constraints)
-                    scores[trackIndex] += constraint->computeScore(finalResult, finalResult.size() - 1);
+                    score += constraint->computeScore(finalResult, candidates[trackIndex], trackInfos);
 
-                finalResult.pop_back();
+                if (trackIndex == 0 || score < bestScore)
+                {
+                    bestScoreIndex = trackIndex;
+                    bestScore = score;
+                }
 
                 // early exit if we consider we found a track with no constraint violation (since similarTracks sorted from most to least similar)
-                if (scores[trackIndex] < 0.01)
+                if (score < 0.01)
                     break;
             }
 
-            // get the best score
-            const std::size_t bestScoreIndex{ static_cast<std::size_t>(std::distance(std::cbegin(scores), std::min_element(std::cbegin(scores), std::cend(scores)))) };
-
-            finalResult.push_back(similarTracks[bestScoreIndex]);
-            similarTracks.erase(std::begin(similarTracks) + bestScoreIndex);
+            appendTrack(radioSession->chooseCandidate(bestScoreIndex));
         }
 
         // for now, just get some more similar tracks
         return std::vector(std::cbegin(finalResult) + startingTracks.size(), std::cend(finalResult));
     }
 
+    std::shared_ptr<RadioSession> PlaylistGeneratorService::getRadioSession(TrackListId tracklistId, const TrackContainer& tracks) const
+    {
+        if (std::optional<std::shared_ptr<RadioSession>> radioSession{ _radioSessions.get(tracklistId) })
+        {
+            const std::scoped_lock lock{ (*radioSession)->getMutex() };
+
+            // restart from the current tracks if the user added other tracks, or if all the candidates have been used
+            if (std::chrono::steady_clock::now() - (*radioSession)->getCreationTime() < maxRadioSessionDuration
+                && !(*radioSession)->getCandidates().empty()
+                && (*radioSession)->isContinuationOf(tracks))
+            {
+                return *radioSession;
+            }
+        }
+
+        LMS_LOG(RECOMMENDATION, DEBUG) << "Starting radio session using " << tracks.size() << " tracks";
+
+        auto radioSession{ std::make_shared<RadioSession>(tracks) };
+        _radioSessions.put(tracklistId, radioSession);
+
+        return radioSession;
+    }
+
     TrackContainer PlaylistGeneratorService::getTracksFromTrackList(Database::TrackListId tracklistId) const
     {
         TrackContainer tracks;
@@ -112,4 +164,33 @@ namespace Recommendation
 
         return tracks;
     }
+
+    PlaylistGeneratorConstraint::TrackInfos PlaylistGeneratorService::getTrackInfos(const TrackContainer& trackIds) const
+    {
+        PlaylistGeneratorConstraint::TrackInfos trackInfos;
+
+        Session& dbSession{ _db.getTLSSession() };
+        auto transaction{ dbSession.createSharedTransaction() };
+
+        std::vector<TrackId> uniqueTrackIds{ trackIds };
+        std::sort(std::begin(uniqueTrackIds), std::end(uniqueTrackIds));
+        uniqueTrackIds.erase(std::unique(std::begin(uniqueTrackIds), std::end(uniqueTrackIds)), std::end(uniqueTrackIds));
+
+        const TrackRelations trackRelations{ dbSession, uniqueTrackIds };
+        for (const TrackId trackId : uniqueTrackIds)
+        {
+            PlaylistGeneratorConstraint::TrackInfo& trackInfo{ trackInfos[trackId] };
+
+            if (const Release::pointer release{ trackRelations.getRelease(trackId) })
+                trackInfo.releaseId = release->getId();
+
+            for (const Artist::pointer& artist : trackRelations.getArtists(trackId, {}))
+                trackInfo.artistIds.push_back(artist->getId());
+
+            std::sort(std::begin(trackInfo.artistIds), std::end(trackInfo.artistIds));
+            trackInfo.artistIds.erase(std::unique(std::begin(trackInfo.artistIds), std::end(trackInfo.artistIds)), std::end(trackInfo.artistIds));
+        }
+
+        return trackInfos;
+    }
 }
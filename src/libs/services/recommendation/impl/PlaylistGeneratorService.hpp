@@ -19,9 +19,14 @@
 
 #pragma once
 
+#include <chrono>
+#include <memory>
+
 #include "services/recommendation/IPlaylistGeneratorService.hpp"
 #include "services/recommendation/IRecommendationService.hpp"
+#include "clusters/SimilarityCache.hpp"
 #include "playlist-constraints/IConstraint.hpp"
+#include "RadioSession.hpp"
 
 namespace Recommendation
 {
@@ -34,9 +39,16 @@ namespace Recommendation
 			TrackContainer extendPlaylist(Database::TrackListId tracklistId, std::size_t maxCount) const override;
 
 			TrackContainer getTracksFromTrackList(Database::TrackListId tracklistId) const;
+			PlaylistGeneratorConstraint::TrackInfos getTrackInfos(const TrackContainer& trackIds) const;
+			std::shared_ptr<RadioSession> getRadioSession(Database::TrackListId tracklistId, const TrackContainer& tracks) const;
 
 			Database::Db& _db;
 			Recommendation::IRecommendationService& _recommendationService;
 			std::vector<std::unique_ptr<PlaylistGeneratorConstraint::IConstraint>> _constraints;
+
+			// Successive extensions of a playlist reuse the similar tracks computed the first time
+			static constexpr std::size_t maxRadioSessionCount{ 64 };
+			static constexpr std::chrono::minutes maxRadioSessionDuration{ 60 }; // the engine may have been reloaded meanwhile
+			mutable SimilarityCache<Database::TrackListId, std::shared_ptr<RadioSession>> _radioSessions{ maxRadioSessionCount };
 	};
 } // namespace Radio
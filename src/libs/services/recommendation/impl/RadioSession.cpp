@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RadioSession.hpp"
+
+#include <algorithm>
+
+#include "utils/Logger.hpp"
+
+namespace Recommendation
+{
+    RadioSession::RadioSession(const TrackContainer& seedTrackIds)
+        : _seedTrackIds{ seedTrackIds }
+        , _excludedTrackIds{ std::cbegin(seedTrackIds), std::cend(seedTrackIds) }
+        , _playlistTrackIds{ std::cbegin(seedTrackIds), std::cend(seedTrackIds) }
+    {
+    }
+
+    bool RadioSession::isContinuationOf(const TrackContainer& playlist) const
+    {
+        return std::all_of(std::cbegin(playlist), std::cend(playlist), [this](Database::TrackId trackId)
+            {
+                return _playlistTrackIds.count(trackId) > 0;
+            });
+    }
+
+    void RadioSession::topUp(std::size_t minCount, const FindSimilarTracksFunc& findSimilarTracks)
+    {
+        while (_candidates.size() < minCount && !_exhausted)
+        {
+            // the engine only returns the best tracks: ask for more tracks than before, and just keep the new ones
+            _requestedCount = std::max(_requestedCount * 2, _chosenCount + minCount * 2);
+
+            const TrackContainer similarTrackIds{ findSimilarTracks(_seedTrackIds, _requestedCount) };
+
+            std::size_t addedCount{};
+            for (const Database::TrackId trackId : similarTrackIds)
+            {
+                if (!_excludedTrackIds.insert(trackId).second)
+                    continue;
+
+                _candidates.push_back(trackId);
+                addedCount++;
+            }
+
+            if (addedCount == 0 || similarTrackIds.size() < _requestedCount)
+                _exhausted = true;
+
+            LMS_LOG(RECOMMENDATION, DEBUG) << "Radio session topped up with " << addedCount << " tracks, " << _candidates.size() << " candidates";
+        }
+    }
+
+    Database::TrackId RadioSession::chooseCandidate(std::size_t index)
+    {
+        const Database::TrackId trackId{ _candidates[index] };
+        _candidates.erase(std::begin(_candidates) + index);
+        _playlistTrackIds.insert(trackId);
+        _chosenCount++;
+
+        return trackId;
+    }
+} // namespace Recommendation
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <unordered_set>
+
+#include "services/database/TrackId.hpp"
+#include "services/recommendation/Types.hpp"
+
+namespace Recommendation
+{
+    // State of a radio between its refills: the seed tracks, the similar tracks ranked from most to least similar,
+    // and the tracks already chosen, so that refills just pop the next candidates
+    class RadioSession
+    {
+    public:
+        using FindSimilarTracksFunc = std::function<TrackContainer(const TrackContainer& seedTrackIds, std::size_t maxCount)>;
+
+        RadioSession(const TrackContainer& seedTrackIds);
+
+        RadioSession(const RadioSession&) = delete;
+        RadioSession& operator=(const RadioSession&) = delete;
+
+        std::mutex& getMutex() { return _mutex; }
+
+        std::chrono::steady_clock::time_point getCreationTime() const { return _creationTime; }
+
+        // true if the playlist only contains seeds and chosen tracks (the user did not add other tracks meanwhile)
+        bool isContinuationOf(const TrackContainer& playlist) const;
+
+        // Makes sure at least minCount candidates are available, unless the similar tracks are exhausted
+        void topUp(std::size_t minCount, const FindSimilarTracksFunc& findSimilarTracks);
+
+        const std::deque<Database::TrackId>& getCandidates() const { return _candidates; }
+        Database::TrackId chooseCandidate(std::size_t index); // removes it from the candidates
+
+    private:
+        const std::chrono::steady_clock::time_point _creationTime{ std::chrono::steady_clock::now() };
+        const TrackContainer _seedTrackIds;
+
+        std::mutex _mutex;
+        std::deque<Database::TrackId> _candidates;
+        std::unordered_set<Database::TrackId> _excludedTrackIds; // seeds, candidates and chosen tracks
+        std::unordered_set<Database::TrackId> _playlistTrackIds; // seeds and chosen tracks
+        std::size_t _chosenCount{};
+        std::size_t _requestedCount{};
+        bool _exhausted{};
+    };
+} // namespace Recommendation
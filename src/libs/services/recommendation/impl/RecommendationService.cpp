@@ -48,76 +48,110 @@ namespace Recommendation
         return std::make_unique<RecommendationService>(db);
     }
 
-    RecommendationService::RecommendationService(Database::Db& db)
+    std::unique_ptr<IRecommendationService> createRecommendationService(Database::Db& db, EngineType engineType)
+    {
+        return std::make_unique<RecommendationService>(db, engineType);
+    }
+
+    RecommendationService::RecommendationService(Database::Db& db, std::optional<EngineType> engineType)
         : _db{ db }
+        , _forcedEngineType{ engineType }
     {
-        load();
     }
 
     TrackContainer RecommendationService::findSimilarTracks(Database::TrackListId trackListId, std::size_t maxCount) const
     {
         TrackContainer res;
 
-        if (!_engine)
+        const std::shared_ptr<IEngine> engine{ getEngine() };
+        if (!engine)
             return res;
 
-        return _engine->findSimilarTracksFromTrackList(trackListId, maxCount);
+        return engine->findSimilarTracksFromTrackList(trackListId, maxCount);
     }
 
     TrackContainer RecommendationService::findSimilarTracks(const std::vector<Database::TrackId>& trackIds, std::size_t maxCount) const
     {
         TrackContainer res;
 
-        if (!_engine)
+        const std::shared_ptr<IEngine> engine{ getEngine() };
+        if (!engine)
             return res;
 
-        return _engine->findSimilarTracks(trackIds, maxCount);
+        return engine->findSimilarTracks(trackIds, maxCount);
     }
 
     ReleaseContainer RecommendationService::getSimilarReleases(Database::ReleaseId releaseId, std::size_t maxCount) const
     {
         ReleaseContainer res;
 
-        if (!_engine)
+        const std::shared_ptr<IEngine> engine{ getEngine() };
+        if (!engine)
             return res;
 
-        return _engine->getSimilarReleases(releaseId, maxCount);;
+        return engine->getSimilarReleases(releaseId, maxCount);
     }
 
     ArtistContainer RecommendationService::getSimilarArtists(Database::ArtistId artistId, EnumSet<Database::TrackArtistLinkType> linkTypes, std::size_t maxCount) const
     {
         ArtistContainer res;
 
-        if (!_engine)
+        const std::shared_ptr<IEngine> engine{ getEngine() };
+        if (!engine)
             return res;
 
-        return _engine->getSimilarArtists(artistId, linkTypes, maxCount);
+        return engine->getSimilarArtists(artistId, linkTypes, maxCount);
+    }
 
-        return res;
+    std::shared_ptr<IEngine> RecommendationService::getEngine() const
+    {
+        return std::atomic_load(&_engine);
     }
 
-    void RecommendationService::load()
+    std::optional<EngineType> RecommendationService::getEngineType()
     {
         using namespace Database;
 
+        if (_forcedEngineType)
+            return _forcedEngineType;
+
         switch (getSimilarityEngineType(_db.getTLSSession()))
         {
         case ScanSettings::SimilarityEngineType::Clusters:
-            if (_engineType != EngineType::Clusters)
-            {
-                _engineType = EngineType::Clusters;
-                _engine = createClustersEngine(_db);
-            }
-            break;
+            return EngineType::Clusters;
 
         case ScanSettings::SimilarityEngineType::Features:
         case ScanSettings::SimilarityEngineType::None:
-            _engineType.reset();
-            _engine.reset();
             break;
         }
 
-        if (_engine)
-            _engine->load(false);
+        return std::nullopt;
+    }
+
+    void RecommendationService::load()
+    {
+        const std::scoped_lock lock{ _loadMutex };
+
+        // Build and load the new engine before publishing it, so that queries never see a partially loaded engine
+        std::shared_ptr<IEngine> engine;
+        if (const std::optional<EngineType> engineType{ getEngineType() })
+        {
+            switch (*engineType)
+            {
+            case EngineType::Clusters:
+                engine = createClustersEngine(_db);
+                break;
+
+            case EngineType::Features:
+                engine = createFeaturesEngine(_db);
+                break;
+            }
+        }
+
+        if (engine)
+            engine->load(false);
+
+        // the previous engine is destroyed once the last query using it is done
+        std::atomic_store(&_engine, std::move(engine));
     }
 } // ns Similarity
@@ -19,6 +19,8 @@
 
 #pragma once
 
+#include <memory>
+#include <mutex>
 #include <optional>
 
 #include "services/recommendation/IRecommendationService.hpp"
@@ -31,16 +33,10 @@ namespace Database
 
 namespace Recommendation
 {
-    enum class EngineType
-    {
-        Clusters,
-        Features,
-    };
-
     class RecommendationService : public IRecommendationService
     {
     public:
-        RecommendationService(Database::Db& db);
+        RecommendationService(Database::Db& db, std::optional<EngineType> engineType = std::nullopt);
         ~RecommendationService() = default;
 
         RecommendationService(const RecommendationService&) = delete;
@@ -54,13 +50,14 @@ namespace Recommendation
         ReleaseContainer getSimilarReleases(Database::ReleaseId releaseId, std::size_t maxCount) const override;
         ArtistContainer getSimilarArtists(Database::ArtistId artistId, EnumSet<Database::TrackArtistLinkType> linkTypes, std::size_t maxCount) const override;
 
-        void setEnginePriorities(const std::vector<EngineType>& engineTypes);
-        void clearEngines();
-        void loadPendingEngine(EngineType engineType, std::unique_ptr<IEngine> engine, bool forceReload, const ProgressCallback& progressCallback);
+        std::optional<EngineType> getEngineType();
+        std::shared_ptr<IEngine> getEngine() const;
 
         Database::Db& _db;
-        std::optional<EngineType> _engineType;
-        std::unique_ptr<IEngine> _engine;
+        const std::optional<EngineType> _forcedEngineType;
+        std::mutex _loadMutex; // serializes reloads
+        // Reloads build a new engine and then publish it: queries in progress keep using the previous instance
+        std::shared_ptr<IEngine> _engine; // only accessed using atomic shared_ptr operations
     };
 
 } // ns Recommendation
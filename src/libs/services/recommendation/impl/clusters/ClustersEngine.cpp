@@ -41,11 +41,20 @@ namespace Recommendation {
         if (maxCount == 0)
             return {};
 
-        Session& dbSession{ _db.getTLSSession() };
-        auto transaction{ dbSession.createSharedTransaction() };
+        const auto cacheKey{ std::make_pair(trackIds, maxCount) };
+        if (std::optional<TrackContainer> cachedTrackIds{ _similarTracksCache.get(cacheKey) })
+            return std::move(*cachedTrackIds);
 
-        const auto similarTrackIds{ Track::findSimilarTrackIds(dbSession, trackIds, Range {0, maxCount}) };
-        return std::move(similarTrackIds.results);
+        TrackContainer res;
+        {
+            Session& dbSession{ _db.getTLSSession() };
+            auto transaction{ dbSession.createSharedTransaction() };
+
+            res = std::move(Track::findSimilarTrackIds(dbSession, trackIds, Range {0, maxCount}).results);
+        }
+
+        _similarTracksCache.put(cacheKey, res);
+        return res;
     }
 
     TrackContainer ClusterEngine::findSimilarTracksFromTrackList(TrackListId tracklistId, std::size_t maxCount) const
@@ -76,6 +85,10 @@ namespace Recommendation {
         if (maxCount == 0)
             return res;
 
+        const auto cacheKey{ std::make_pair(releaseId, maxCount) };
+        if (std::optional<ReleaseContainer> cachedReleaseIds{ _similarReleasesCache.get(cacheKey) })
+            return std::move(*cachedReleaseIds);
+
         {
             Session& dbSession{ _db.getTLSSession() };
             auto transaction{ dbSession.createSharedTransaction() };
@@ -89,6 +102,7 @@ namespace Recommendation {
             std::transform(std::cbegin(releases), std::cend(releases), std::back_inserter(res), [](const auto& release) { return release->getId(); });
         }
 
+        _similarReleasesCache.put(cacheKey, res);
         return res;
     }
 
@@ -97,15 +111,24 @@ namespace Recommendation {
         if (maxCount == 0)
             return {};
 
-        Session& dbSession{ _db.getTLSSession() };
-        auto transaction{ dbSession.createSharedTransaction() };
+        const auto cacheKey{ std::make_tuple(artistId, artistLinkTypes.getBitfield(), maxCount) };
+        if (std::optional<ArtistContainer> cachedArtistIds{ _similarArtistsCache.get(cacheKey) })
+            return std::move(*cachedArtistIds);
 
-        auto artist{ Artist::find(dbSession, artistId) };
-        if (!artist)
-            return {};
+        ArtistContainer res;
+        {
+            Session& dbSession{ _db.getTLSSession() };
+            auto transaction{ dbSession.createSharedTransaction() };
 
-        const auto similarArtistIds{ artist->findSimilarArtistIds(artistLinkTypes, Range {0, maxCount}) };
-        return std::move(similarArtistIds.results);
+            auto artist{ Artist::find(dbSession, artistId) };
+            if (!artist)
+                return {};
+
+            res = std::move(artist->findSimilarArtistIds(artistLinkTypes, Range {0, maxCount}).results);
+        }
+
+        _similarArtistsCache.put(cacheKey, res);
+        return res;
     }
 
 } // namespace Recommendation
@@ -19,7 +19,11 @@
 
 #pragma once
 
+#include <tuple>
+#include <vector>
+
 #include "IEngine.hpp"
+#include "SimilarityCache.hpp"
 
 namespace Recommendation
 {
@@ -44,6 +48,12 @@ namespace Recommendation
 			ArtistContainer		getSimilarArtists(Database::ArtistId artistId, EnumSet<Database::TrackArtistLinkType> linkTypes, std::size_t maxCount) const override;
 
 			Database::Db& _db;
+
+			// Results are computed using costly queries: cache them for the engine lifetime (the engine is reloaded after each scan)
+			static constexpr std::size_t maxCacheEntryCount {1000};
+			mutable SimilarityCache<std::pair<std::vector<Database::TrackId>, std::size_t>, TrackContainer> _similarTracksCache {maxCacheEntryCount};
+			mutable SimilarityCache<std::pair<Database::ReleaseId, std::size_t>, ReleaseContainer> _similarReleasesCache {maxCacheEntryCount};
+			mutable SimilarityCache<std::tuple<Database::ArtistId, EnumSet<Database::TrackArtistLinkType>::ValueType, std::size_t>, ArtistContainer> _similarArtistsCache {maxCacheEntryCount};
 	};
 
 } // namespace Recommendation
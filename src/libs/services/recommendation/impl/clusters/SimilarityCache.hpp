@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace Recommendation
+{
+    // Thread safe LRU cache of similarity results, bounded by its entry count
+    template <typename Key, typename Value>
+    class SimilarityCache
+    {
+    public:
+        SimilarityCache(std::size_t maxEntryCount)
+            : _maxEntryCount{ maxEntryCount }
+        {
+        }
+
+        SimilarityCache(const SimilarityCache&) = delete;
+        SimilarityCache& operator=(const SimilarityCache&) = delete;
+
+        std::optional<Value> get(const Key& key)
+        {
+            std::scoped_lock lock{ _mutex };
+
+            auto it{ _entriesByKey.find(key) };
+            if (it == std::cend(_entriesByKey))
+                return std::nullopt;
+
+            _entries.splice(std::begin(_entries), _entries, it->second);
+            return it->second->second;
+        }
+
+        void put(const Key& key, Value value)
+        {
+            std::scoped_lock lock{ _mutex };
+
+            if (auto it{ _entriesByKey.find(key) }; it != std::cend(_entriesByKey))
+            {
+                _entries.erase(it->second);
+                _entriesByKey.erase(it);
+            }
+
+            while (!_entries.empty() && _entries.size() >= _maxEntryCount)
+            {
+                _entriesByKey.erase(_entries.back().first);
+                _entries.pop_back();
+            }
+
+            _entries.emplace_front(key, std::move(value));
+            _entriesByKey.emplace(key, std::begin(_entries));
+        }
+
+        void clear()
+        {
+            std::scoped_lock lock{ _mutex };
+
+            _entries.clear();
+            _entriesByKey.clear();
+        }
+
+    private:
+        const std::size_t _maxEntryCount;
+
+        std::mutex _mutex;
+        using EntryList = std::list<std::pair<Key, Value>>; // most recently used first
+        EntryList _entries;
+        std::map<Key, typename EntryList::iterator> _entriesByKey;
+    };
+} // namespace Recommendation
@@ -19,7 +19,9 @@
 
 #include "FeaturesEngine.hpp"
 
+#include <atomic>
 #include <numeric>
+#include <thread>
 
 #include "services/database/Artist.hpp"
 #include "services/database/Db.hpp"
@@ -30,14 +32,38 @@
 #include "services/database/TrackFeatures.hpp"
 #include "services/database/TrackList.hpp"
 #include "som/DataNormalizer.hpp"
+#include "som/DistanceKernels.hpp"
+#include "utils/IConfig.hpp"
 #include "utils/Logger.hpp"
 #include "utils/Random.hpp"
+#include "utils/Service.hpp"
 
 
 namespace Recommendation {
 
 using namespace Database;
 
+static
+std::size_t
+getTrainingThreadCount()
+{
+	const std::size_t configThreadCount {Service<IConfig>::get()->getULong("features-training-thread-count", 0)};
+
+	return configThreadCount ? configThreadCount : std::max<std::size_t>(1, std::thread::hardware_concurrency() / 2);
+}
+
+static
+std::vector<float>
+toFloatValues(const SOM::InputVector& inputVector)
+{
+	std::vector<float> values;
+	values.reserve(inputVector.getNbDimensions());
+	for (double value : inputVector)
+		values.push_back(static_cast<float>(value));
+
+	return values;
+}
+
 std::unique_ptr<IEngine> createFeaturesEngine(Db& db)
 {
 	return std::make_unique<FeaturesEngine>(db);
@@ -58,26 +84,32 @@ FeaturesEngine::getDefaultTrainFeatureSettings()
 	return defaultTrainFeatureSettings;
 }
 
+// Values are laid out in the feature settings order, as the weights
+template <typename T>
 static
-std::optional<SOM::InputVector>
-convertFeatureValuesMapToInputVector(const FeatureValuesMap& featureValuesMap, std::size_t nbDimensions)
+bool
+convertFeatureValuesMap(const FeatureValuesMap& featureValuesMap, const FeatureSettingsMap& featureSettingsMap, T* values)
 {
-	std::size_t i {};
-	std::optional<SOM::InputVector> res {SOM::InputVector {nbDimensions}};
-	for (const auto& [featureName, values] : featureValuesMap)
+	for (const auto& [featureName, featureSettings] : featureSettingsMap)
 	{
-		if (values.size() != getFeatureDef(featureName).nbDimensions)
+		const auto itValues {featureValuesMap.find(featureName)};
+		if (itValues == std::cend(featureValuesMap))
 		{
-			LMS_LOG(RECOMMENDATION, WARNING) << "Dimension mismatch for feature '" << featureName << "'. Expected " << getFeatureDef(featureName).nbDimensions << ", got " << values.size();
-			res.reset();
-			break;
+			LMS_LOG(RECOMMENDATION, WARNING) << "Missing feature '" << featureName << "'";
+			return false;
 		}
 
-		for (double val : values)
-			(*res)[i++] = val;
+		if (itValues->second.size() != getFeatureDef(featureName).nbDimensions)
+		{
+			LMS_LOG(RECOMMENDATION, WARNING) << "Dimension mismatch for feature '" << featureName << "'. Expected " << getFeatureDef(featureName).nbDimensions << ", got " << itValues->second.size();
+			return false;
+		}
+
+		for (double value : itValues->second)
+			*values++ = static_cast<T>(value);
 	}
 
-	return res;
+	return true;
 }
 
 static
@@ -99,64 +131,137 @@ getInputVectorWeights(const FeatureSettingsMap& featureSettingsMap, std::size_t
 	return weights;
 }
 
-void
-FeaturesEngine::loadFromTraining(const TrainSettings& trainSettings, const ProgressCallback& progressCallback)
+static
+std::unordered_set<FeatureName>
+getFeatureNames(const FeatureSettingsMap& featureSettingsMap)
 {
-	LMS_LOG(RECOMMENDATION, INFO) << "Constructing features classifier...";
-
 	std::unordered_set<FeatureName> featureNames;
-	std::transform(std::cbegin(trainSettings.featureSettingsMap), std::cend(trainSettings.featureSettingsMap), std::inserter(featureNames, std::begin(featureNames)),
+	std::transform(std::cbegin(featureSettingsMap), std::cend(featureSettingsMap), std::inserter(featureNames, std::begin(featureNames)),
 		[](const auto& itFeatureSetting) { return itFeatureSetting.first; });
 
-	const std::size_t nbDimensions {std::accumulate(std::cbegin(featureNames), std::cend(featureNames), std::size_t {0},
-			[](std::size_t sum, const FeatureName& featureName) { return sum + getFeatureDef(featureName).nbDimensions; })};
+	return featureNames;
+}
 
-	LMS_LOG(RECOMMENDATION, DEBUG) << "Features dimension = " << nbDimensions;
+static
+std::size_t
+getDimensionCount(const std::unordered_set<FeatureName>& featureNames)
+{
+	return std::accumulate(std::cbegin(featureNames), std::cend(featureNames), std::size_t {0},
+			[](std::size_t sum, const FeatureName& featureName) { return sum + getFeatureDef(featureName).nbDimensions; });
+}
 
-	Session& session {_db.getTLSSession()};
+static
+std::optional<SOM::InputVector>
+extractInputVector(const TrackFeatures::pointer& trackFeatures, const FeatureSettingsMap& featureSettingsMap, const std::unordered_set<FeatureName>& featureNames, std::size_t nbDimensions)
+{
+	const FeatureValuesMap featureValuesMap {trackFeatures->getFeatureValuesMap(featureNames)};
+	if (featureValuesMap.empty())
+		return std::nullopt;
 
-	RangeResults<TrackFeaturesId> trackFeaturesIds;
-	{
-		auto transaction {session.createSharedTransaction()};
+	SOM::InputVector res {nbDimensions};
+	if (!convertFeatureValuesMap(featureValuesMap, featureSettingsMap, res.data()))
+		return std::nullopt;
 
-		LMS_LOG(RECOMMENDATION, DEBUG) << "Getting Track features...";
-		trackFeaturesIds = TrackFeatures::find(session);
-		LMS_LOG(RECOMMENDATION, DEBUG) << "Getting Track features DONE (found " << trackFeaturesIds.results.size() << " track features)";
-	}
+	return res;
+}
 
-	std::vector<SOM::InputVector> samples;
-	std::vector<TrackId> samplesTrackIds;
+FeaturesEngine::PackedSamples
+FeaturesEngine::extractSamples(const std::vector<TrackId>& trackIds, const FeatureSettingsMap& featureSettingsMap, std::size_t threadCount) const
+{
+	const std::unordered_set<FeatureName> featureNames {getFeatureNames(featureSettingsMap)};
+	const std::size_t nbDimensions {getDimensionCount(featureNames)};
 
-	samples.reserve(trackFeaturesIds.results.size());
-	samplesTrackIds.reserve(trackFeaturesIds.results.size());
+	PackedSamples samples;
+	samples.packedDimCount = SOM::Kernels::getPaddedDimCount(nbDimensions);
 
-	LMS_LOG(RECOMMENDATION, DEBUG) << "Extracting features...";
-	// TODO handle errors using exceptions
-	for (const TrackFeaturesId trackFeaturesId : trackFeaturesIds.results)
+	// Each track has its own slot, so that threads can fill them concurrently: only the selected dimensions are decoded and kept, as floats
+	samples.values.resize(trackIds.size() * samples.packedDimCount);
+	std::vector<char> extracted(trackIds.size());
+
+	static constexpr std::size_t chunkSize {256};
+	const std::size_t chunkCount {(trackIds.size() + chunkSize - 1) / chunkSize};
+	std::atomic<std::size_t> nextChunk {};
+
+	auto extractChunks {[&]
 	{
-		if (_loadCancelled)
-			return;
+		Session session {_db};
 
-		auto transaction {session.createSharedTransaction()};
+		for (std::size_t chunk {nextChunk++}; chunk < chunkCount && !_loadCancelled; chunk = nextChunk++)
+		{
+			auto transaction {session.createSharedTransaction()};
 
-		TrackFeatures::pointer trackFeatures {TrackFeatures::find(session, trackFeaturesId)};
-		if (!trackFeatures)
-			continue;
+			for (std::size_t i {chunk * chunkSize}; i < std::min(trackIds.size(), (chunk + 1) * chunkSize); ++i)
+			{
+				const TrackFeatures::pointer trackFeatures {TrackFeatures::find(session, trackIds[i])};
+				if (!trackFeatures)
+					continue;
 
-		FeatureValuesMap featureValuesMap {trackFeatures->getFeatureValuesMap(featureNames)};
-		if (featureValuesMap.empty())
-			continue;
+				const FeatureValuesMap featureValuesMap {trackFeatures->getFeatureValuesMap(featureNames)};
+				if (featureValuesMap.empty())
+					continue;
 
-		std::optional<SOM::InputVector> inputVector {convertFeatureValuesMapToInputVector(featureValuesMap, nbDimensions)};
-		if (!inputVector)
+				extracted[i] = convertFeatureValuesMap(featureValuesMap, featureSettingsMap, samples.values.data() + i * samples.packedDimCount);
+			}
+		}
+	}};
+
+	threadCount = std::clamp<std::size_t>(threadCount, 1, std::max<std::size_t>(chunkCount, 1));
+	std::vector<std::thread> threads;
+	for (std::size_t i {1}; i < threadCount; ++i)
+		threads.emplace_back(extractChunks);
+	extractChunks();
+	for (std::thread& thread : threads)
+		thread.join();
+
+	// Compact the samples, in place
+	for (std::size_t i {}; i < trackIds.size(); ++i)
+	{
+		if (!extracted[i])
 			continue;
 
-		samples.emplace_back(std::move(*inputVector));
-		samplesTrackIds.emplace_back(trackFeatures->getTrack()->getId());
+		const std::size_t sampleIndex {samples.trackIds.size()};
+		if (sampleIndex != i)
+		{
+			auto itValues {std::cbegin(samples.values) + i * samples.packedDimCount};
+			std::copy(itValues, itValues + samples.packedDimCount, std::begin(samples.values) + sampleIndex * samples.packedDimCount);
+		}
+		samples.trackIds.push_back(trackIds[i]);
 	}
+	samples.values.resize(samples.trackIds.size() * samples.packedDimCount);
+	samples.values.shrink_to_fit();
+
+	return samples;
+}
+
+void
+FeaturesEngine::loadFromTraining(const TrainSettings& trainSettings, const ProgressCallback& progressCallback)
+{
+	LMS_LOG(RECOMMENDATION, INFO) << "Constructing features classifier...";
+
+	const std::unordered_set<FeatureName> featureNames {getFeatureNames(trainSettings.featureSettingsMap)};
+	const std::size_t nbDimensions {getDimensionCount(featureNames)};
+
+	LMS_LOG(RECOMMENDATION, DEBUG) << "Features dimension = " << nbDimensions;
+
+	Session& session {_db.getTLSSession()};
+
+	RangeResults<TrackId> trackIds;
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		LMS_LOG(RECOMMENDATION, DEBUG) << "Getting tracks with features...";
+		trackIds = TrackFeatures::findTrackIds(session);
+		LMS_LOG(RECOMMENDATION, DEBUG) << "Getting tracks with features DONE (found " << trackIds.results.size() << " tracks)";
+	}
+
+	LMS_LOG(RECOMMENDATION, DEBUG) << "Extracting features...";
+	PackedSamples samples {extractSamples(trackIds.results, trainSettings.featureSettingsMap, trainSettings.threadCount)};
+	if (_loadCancelled)
+		return;
 	LMS_LOG(RECOMMENDATION, DEBUG) << "Extracting features DONE";
 
-	if (samples.empty())
+	const std::size_t sampleCount {samples.trackIds.size()};
+	if (sampleCount == 0)
 	{
 		LMS_LOG(RECOMMENDATION, INFO) << "Nothing to classify!";
 		return;
@@ -165,17 +270,17 @@ FeaturesEngine::loadFromTraining(const TrainSettings& trainSettings, const Progr
 	LMS_LOG(RECOMMENDATION, DEBUG) << "Normalizing data...";
 	SOM::DataNormalizer dataNormalizer {nbDimensions};
 
-	dataNormalizer.computeNormalizationFactors(samples);
-	for (auto& sample : samples)
-		dataNormalizer.normalizeData(sample);
+	dataNormalizer.computeNormalizationFactors(samples.values, samples.packedDimCount);
+	for (std::size_t i {}; i < sampleCount; ++i)
+		dataNormalizer.normalizeData(samples.getValues(i));
 
-	SOM::Coordinate size {static_cast<SOM::Coordinate>(std::sqrt(samples.size() / trainSettings.sampleCountPerNeuron))};
+	SOM::Coordinate size {static_cast<SOM::Coordinate>(std::sqrt(sampleCount / trainSettings.sampleCountPerNeuron))};
 	if (size < 2)
 	{
-		LMS_LOG(RECOMMENDATION, WARNING) << "Very few tracks (" << samples.size() << ") are being used by the features engine, expect bad behaviors";
+		LMS_LOG(RECOMMENDATION, WARNING) << "Very few tracks (" << sampleCount << ") are being used by the features engine, expect bad behaviors";
 		size = 2;
 	}
-	LMS_LOG(RECOMMENDATION, INFO) << "Found " << samples.size() << " tracks, constructing a " << size << "*" << size << " network";
+	LMS_LOG(RECOMMENDATION, INFO) << "Found " << sampleCount << " tracks, constructing a " << size << "*" << size << " network";
 
 	SOM::Network network {size, size, nbDimensions};
 
@@ -189,26 +294,32 @@ FeaturesEngine::loadFromTraining(const TrainSettings& trainSettings, const Progr
 	}};
 
 	LMS_LOG(RECOMMENDATION, DEBUG) << "Training network...";
-	network.train(samples, trainSettings.iterationCount,
+	network.trainBatch(samples.values, trainSettings.iterationCount, trainSettings.threadCount,
 			progressCallback ? somProgressCallback : SOM::Network::ProgressCallback {},
 			[this] { return _loadCancelled; });
 	LMS_LOG(RECOMMENDATION, DEBUG) << "Training network DONE";
 
 	LMS_LOG(RECOMMENDATION, DEBUG) << "Classifying tracks...";
-	TrackPositions trackPositions;
-	for (std::size_t i {}; i < samples.size(); ++i)
+	ObjectPositionContainer<TrackId> trackPositions;
+	trackPositions.reserve(sampleCount);
+	for (std::size_t i {}; i < sampleCount; ++i)
 	{
 		if (_loadCancelled)
 			return;
 
-		const SOM::Position position {network.getClosestRefVectorPosition(samples[i])};
+		const SOM::Position position {network.getClosestRefVectorPosition(samples.getValues(i))};
 
-		trackPositions[samplesTrackIds[i]].push_back(position);
+		trackPositions.push_back({samples.trackIds[i], position});
 	}
 
 	LMS_LOG(RECOMMENDATION, DEBUG) << "Classifying tracks DONE";
 
-	load(std::move(network), std::move(trackPositions));
+	load(network, dataNormalizer, TrackPositions {std::move(trackPositions)});
+	_trainedTrackCount = sampleCount;
+	_changedTrackCount = 0;
+
+	if (isKnnIndexEnabled())
+		buildKnnIndex(samples);
 }
 
 void
@@ -216,7 +327,98 @@ FeaturesEngine::loadFromCache(FeaturesEngineCache&& cache)
 {
 	LMS_LOG(RECOMMENDATION, INFO) << "Constructing features classifier from cache...";
 
-	load(std::move(cache._network), cache._trackPositions);
+	load(cache._network, cache._dataNormalizer, cache._trackPositions);
+	_trainedTrackCount = cache._trainedTrackCount;
+	_changedTrackCount = cache._changedTrackCount;
+}
+
+FeaturesEngine::UpdateResult
+FeaturesEngine::update(const FeatureSettingsMap& featureSettingsMap)
+{
+	Session& session {_db.getTLSSession()};
+
+	std::unordered_set<TrackId> trackIds;
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		const RangeResults<TrackId> trackIdsWithFeatures {TrackFeatures::findTrackIds(session)};
+		trackIds.insert(std::cbegin(trackIdsWithFeatures.results), std::cend(trackIdsWithFeatures.results));
+	}
+
+	std::unordered_set<TrackId> removedTrackIds;
+	_trackPositions.visit([&](TrackId trackId, ObjectRange<SOM::Position>)
+	{
+		if (trackIds.erase(trackId) == 0)
+			removedTrackIds.insert(trackId);
+	});
+	// trackIds now only contains the added tracks
+
+	if (removedTrackIds.empty() && trackIds.empty())
+		return UpdateResult::UpToDate;
+
+	const std::size_t changedTrackCount {_changedTrackCount + removedTrackIds.size() + trackIds.size()};
+	if (changedTrackCount > _trainedTrackCount * maxChangedTrackRatio)
+	{
+		LMS_LOG(RECOMMENDATION, INFO) << "Too many tracks changed since last training (" << changedTrackCount << " for " << _trainedTrackCount << " trained tracks)";
+		return UpdateResult::RetrainNeeded;
+	}
+
+	const std::unordered_set<FeatureName> featureNames {getFeatureNames(featureSettingsMap)};
+	const std::size_t nbDimensions {getDimensionCount(featureNames)};
+	if (nbDimensions != _network->getInputDimCount())
+		return UpdateResult::RetrainNeeded;
+
+	LMS_LOG(RECOMMENDATION, INFO) << "Updating features classifier: " << trackIds.size() << " added tracks, " << removedTrackIds.size() << " removed tracks";
+
+	// the flat positions and matrices are rebuilt once all the changes are made
+	ObjectEntries entries {getObjectEntries()};
+
+	eraseObjects(entries.tracks, removedTrackIds);
+	for (const TrackId trackId : removedTrackIds)
+		removeKnnIndexTrack(trackId);
+	_changedTrackCount += removedTrackIds.size();
+
+	for (const TrackId trackId : trackIds)
+	{
+		if (_loadCancelled)
+		{
+			setObjects(std::move(entries));
+			return UpdateResult::Updated;
+		}
+
+		auto transaction {session.createSharedTransaction()};
+
+		const TrackFeatures::pointer trackFeatures {TrackFeatures::find(session, trackId)};
+		if (!trackFeatures)
+			continue;
+
+		std::optional<SOM::InputVector> inputVector {extractInputVector(trackFeatures, featureSettingsMap, featureNames, nbDimensions)};
+		if (!inputVector)
+			continue;
+
+		_dataNormalizer->normalizeData(*inputVector);
+		const SOM::Position position {_network->getClosestRefVectorPosition(*inputVector)};
+		addTrack(session, entries, trackId, {&position, &position + 1});
+		if (_knnIndex)
+			addKnnIndexTrack(trackId, toFloatValues(*inputVector).data());
+		_changedTrackCount++;
+	}
+
+	// Releases and artists are not tracked per track: just prune the ones that no longer exist
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		pruneObjects(_releasePositions, {&entries.releases}, [&](ReleaseId releaseId) { return Release::exists(session, releaseId); });
+
+		std::vector<ObjectPositionContainer<ArtistId>*> artistEntries;
+		for (auto& [linkType, artists] : entries.artists)
+			artistEntries.push_back(&artists);
+		pruneObjects(_artistPositions, artistEntries, [&](ArtistId artistId) { return Artist::exists(session, artistId); });
+	}
+
+	setObjects(std::move(entries));
+
+	return UpdateResult::Updated;
 }
 
 TrackContainer
@@ -243,7 +445,12 @@ FeaturesEngine::findSimilarTracksFromTrackList(TrackListId trackListId, std::siz
 TrackContainer
 FeaturesEngine::findSimilarTracks(const std::vector<TrackId>& tracksIds, std::size_t maxCount) const
 {
-	auto similarTrackIds {getSimilarObjects(tracksIds, _trackMatrix, _trackPositions, maxCount)};
+	TrackContainer similarTrackIds;
+	if (_knnIndex)
+		similarTrackIds = findKnnSimilarTracks(tracksIds, maxCount);
+	// tracks that are not indexed yet only have a position in the network
+	if (similarTrackIds.empty())
+		similarTrackIds = getSimilarObjects(tracksIds, _trackMatrix, _trackPositions, maxCount);
 
 	Session& session {_db.getTLSSession()};
 
@@ -330,7 +537,15 @@ FeaturesEngine::getSimilarArtists(ArtistId artistId, EnumSet<TrackArtistLinkType
 FeaturesEngineCache
 FeaturesEngine::toCache() const
 {
-	return FeaturesEngineCache {*_network, _trackPositions};
+	return FeaturesEngineCache {*_network, *_dataNormalizer, _trackPositions, _trainedTrackCount, _changedTrackCount};
+}
+
+void
+FeaturesEngine::writeCache() const
+{
+	toCache().write();
+	if (_knnIndex)
+		FeaturesEngineCache::writeKnnIndex(*_knnIndex, _knnIndexTrackIds);
 }
 
 void
@@ -340,18 +555,187 @@ FeaturesEngine::load(bool forceReload, const ProgressCallback& progressCallback)
 	{
 		FeaturesEngineCache::invalidate();
 	}
-	else if (std::optional<FeaturesEngineCache> cache {FeaturesEngineCache::read()})
+	else
 	{
-		loadFromCache(std::move(*cache));
-		return;
+		if (!_network)
+		{
+			if (std::optional<FeaturesEngineCache> cache {FeaturesEngineCache::read()})
+				loadFromCache(std::move(*cache));
+
+			if (_network && isKnnIndexEnabled())
+			{
+				std::optional<FeaturesEngineCache::KnnIndex> knnIndex {FeaturesEngineCache::readKnnIndex()};
+				if (knnIndex && knnIndex->index.getDimCount() == _network->getInputDimCount())
+				{
+					loadKnnIndex(std::move(*knnIndex));
+				}
+				else
+				{
+					buildKnnIndex(getDefaultTrainFeatureSettings());
+					if (!_loadCancelled && _knnIndex)
+						FeaturesEngineCache::writeKnnIndex(*_knnIndex, _knnIndexTrackIds);
+				}
+			}
+		}
+
+		// Only project the added tracks on the current network, unless too many tracks changed since its training
+		if (_network)
+		{
+			switch (update(getDefaultTrainFeatureSettings()))
+			{
+				case UpdateResult::UpToDate:
+					return;
+
+				case UpdateResult::Updated:
+					if (!_loadCancelled)
+						writeCache();
+					return;
+
+				case UpdateResult::RetrainNeeded:
+					break;
+			}
+		}
 	}
 
 	TrainSettings trainSettings;
 	trainSettings.featureSettingsMap = getDefaultTrainFeatureSettings();
+	trainSettings.threadCount = getTrainingThreadCount();
 
 	loadFromTraining(trainSettings, progressCallback);
 	if (!_loadCancelled && _network)
-		toCache().write();
+		writeCache();
+}
+
+bool
+FeaturesEngine::isKnnIndexEnabled()
+{
+	return Service<IConfig>::get()->getBool("features-knn-index", false);
+}
+
+void
+FeaturesEngine::loadKnnIndex(FeaturesEngineCache::KnnIndex&& knnIndex)
+{
+	_knnIndex = std::make_unique<HnswIndex>(std::move(knnIndex.index));
+	_knnIndexTrackIds = std::move(knnIndex.trackIds);
+	_knnIndexNodes.clear();
+
+	for (std::size_t node {}; node < _knnIndexTrackIds.size(); ++node)
+	{
+		if (_knnIndexTrackIds[node].isValid())
+			_knnIndexNodes[_knnIndexTrackIds[node]] = static_cast<HnswIndex::NodeId>(node);
+	}
+}
+
+void
+FeaturesEngine::buildKnnIndex(PackedSamples& normalizedSamples)
+{
+	LMS_LOG(RECOMMENDATION, DEBUG) << "Building nearest neighbour index...";
+
+	_knnIndex = std::make_unique<HnswIndex>(_network->getInputDimCount(), toFloatValues(_network->getDataWeights()));
+	_knnIndexTrackIds.clear();
+	_knnIndexNodes.clear();
+
+	for (std::size_t i {}; i < normalizedSamples.trackIds.size(); ++i)
+	{
+		if (_loadCancelled)
+		{
+			_knnIndex.reset();
+			return;
+		}
+
+		addKnnIndexTrack(normalizedSamples.trackIds[i], normalizedSamples.getValues(i));
+	}
+
+	LMS_LOG(RECOMMENDATION, DEBUG) << "Building nearest neighbour index DONE";
+}
+
+void
+FeaturesEngine::buildKnnIndex(const FeatureSettingsMap& featureSettingsMap)
+{
+	if (getDimensionCount(getFeatureNames(featureSettingsMap)) != _network->getInputDimCount())
+		return;
+
+	std::vector<TrackId> trackIds;
+	trackIds.reserve(_trackPositions.getObjectCount());
+	_trackPositions.visit([&](TrackId trackId, ObjectRange<SOM::Position>) { trackIds.push_back(trackId); });
+
+	LMS_LOG(RECOMMENDATION, DEBUG) << "Extracting features for the nearest neighbour index...";
+	PackedSamples samples {extractSamples(trackIds, featureSettingsMap, getTrainingThreadCount())};
+	if (_loadCancelled)
+		return;
+
+	for (std::size_t i {}; i < samples.trackIds.size(); ++i)
+		_dataNormalizer->normalizeData(samples.getValues(i));
+
+	buildKnnIndex(samples);
+}
+
+void
+FeaturesEngine::addKnnIndexTrack(TrackId trackId, const float* normalizedValues)
+{
+	removeKnnIndexTrack(trackId);
+
+	const HnswIndex::NodeId node {_knnIndex->add(normalizedValues)};
+	assert(node == _knnIndexTrackIds.size());
+
+	_knnIndexTrackIds.push_back(trackId);
+	_knnIndexNodes[trackId] = node;
+}
+
+void
+FeaturesEngine::removeKnnIndexTrack(TrackId trackId)
+{
+	// nodes cannot be removed from the index, just make sure they are no longer reported
+	auto itNode {_knnIndexNodes.find(trackId)};
+	if (itNode == std::end(_knnIndexNodes))
+		return;
+
+	_knnIndexTrackIds[itNode->second] = TrackId {};
+	_knnIndexNodes.erase(itNode);
+}
+
+TrackContainer
+FeaturesEngine::findKnnSimilarTracks(const std::vector<TrackId>& tracksIds, std::size_t maxCount) const
+{
+	TrackContainer res;
+	if (maxCount == 0)
+		return res;
+
+	const std::unordered_set<TrackId> inputIds {std::cbegin(tracksIds), std::cend(tracksIds)};
+	const std::size_t neighbourCount {maxCount + inputIds.size()};
+	const std::size_t ef {std::max<std::size_t>(neighbourCount, 64)};
+
+	// keep the distance to the closest input track
+	std::unordered_map<TrackId, HnswIndex::Distance> distances;
+	for (const TrackId trackId : inputIds)
+	{
+		const auto itNode {_knnIndexNodes.find(trackId)};
+		if (itNode == std::cend(_knnIndexNodes))
+			continue;
+
+		for (const HnswIndex::Neighbour& neighbour : _knnIndex->searchNode(itNode->second, neighbourCount, ef))
+		{
+			const TrackId similarTrackId {_knnIndexTrackIds[neighbour.node]};
+			if (!similarTrackId.isValid() || inputIds.count(similarTrackId))
+				continue;
+
+			auto [itDistance, inserted] {distances.try_emplace(similarTrackId, neighbour.distance)};
+			if (!inserted)
+				itDistance->second = std::min(itDistance->second, neighbour.distance);
+		}
+	}
+
+	std::vector<std::pair<TrackId, HnswIndex::Distance>> sortedTracks(std::cbegin(distances), std::cend(distances));
+	std::sort(std::begin(sortedTracks), std::end(sortedTracks), [](const auto& a, const auto& b) { return a.second < b.second; });
+
+	for (const auto& [trackId, distance] : sortedTracks)
+	{
+		if (res.size() == maxCount)
+			break;
+		res.push_back(trackId);
+	}
+
+	return res;
 }
 
 void
@@ -362,65 +746,144 @@ FeaturesEngine::requestCancelLoad()
 }
 
 void
-FeaturesEngine::load(const SOM::Network& network, const TrackPositions& trackPositions)
+FeaturesEngine::computeRefVectorNeighbours(const SOM::Network& network)
+{
+	const SOM::Coordinate width {network.getWidth()};
+	const SOM::Coordinate height {network.getHeight()};
+
+	_refVectorNeighbours = SOM::Matrix<std::vector<RefVectorNeighbour>> {width, height};
+	for (SOM::Coordinate y {}; y < height; ++y)
+	{
+		for (SOM::Coordinate x {}; x < width; ++x)
+		{
+			const SOM::Position position {x, y};
+			std::vector<RefVectorNeighbour>& neighbours {_refVectorNeighbours[position]};
+
+			auto addNeighbour {[&](const SOM::Position& neighbourPosition)
+			{
+				neighbours.push_back(RefVectorNeighbour {neighbourPosition, network.getRefVectorsDistance(position, neighbourPosition)});
+			}};
+
+			if (y > 0)
+				addNeighbour({x, y - 1});
+			if (y < height - 1)
+				addNeighbour({x, y + 1});
+			if (x > 0)
+				addNeighbour({x - 1, y});
+			if (x < width - 1)
+				addNeighbour({x + 1, y});
+
+			std::sort(std::begin(neighbours), std::end(neighbours), [](const RefVectorNeighbour& a, const RefVectorNeighbour& b) { return a.distance < b.distance; });
+		}
+	}
+}
+
+void
+FeaturesEngine::load(const SOM::Network& network, const SOM::DataNormalizer& dataNormalizer, const TrackPositions& trackPositions)
 {
 	using namespace Database;
 
 	_networkRefVectorsDistanceMedian = network.computeRefVectorsDistanceMedian();
 	LMS_LOG(RECOMMENDATION, DEBUG) << "Median distance betweend ref vectors = " << _networkRefVectorsDistanceMedian;
 
-	const SOM::Coordinate width {network.getWidth()};
-	const SOM::Coordinate height {network.getHeight()};
+	computeRefVectorNeighbours(network);
 
-	_releaseMatrix = ReleaseMatrix {width, height};
-	_trackMatrix = TrackMatrix {width, height};
+	_network = std::make_unique<SOM::Network>(network);
+	_dataNormalizer = std::make_unique<SOM::DataNormalizer>(dataNormalizer);
+	setObjects(ObjectEntries {});
+	_knnIndex.reset();
+	_knnIndexTrackIds.clear();
+	_knnIndexNodes.clear();
 
 	LMS_LOG(RECOMMENDATION, DEBUG) << "Constructing maps...";
 
 	Session& session {_db.getTLSSession()};
 
-	for (const auto& [trackId, positions] : trackPositions)
+	ObjectEntries entries;
+	entries.tracks.reserve(trackPositions.getPositionCount());
+	bool cancelled {};
+	trackPositions.visit([&](TrackId trackId, ObjectRange<SOM::Position> positions)
 	{
 		if (_loadCancelled)
+		{
+			cancelled = true;
 			return;
+		}
 
 		auto transaction {session.createSharedTransaction()};
 
-		const Track::pointer track {Track::find(session, trackId)};
-		if (!track)
-			continue;
+		addTrack(session, entries, trackId, positions);
+	});
 
-		for (const SOM::Position& position : positions)
-		{
-			Utils::push_back_if_not_present(_trackPositions[trackId], position);
-			Utils::push_back_if_not_present(_trackMatrix[position], trackId);
+	if (cancelled)
+		return;
 
-			if (Release::pointer release {track->getRelease()})
-			{
-				const ReleaseId releaseId {release->getId()};
-				Utils::push_back_if_not_present(_releasePositions[releaseId], position);
-				Utils::push_back_if_not_present(_releaseMatrix[position], releaseId);
-			}
-			for (const TrackArtistLink::pointer& artistLink : track->getArtistLinks())
-			{
-				const ArtistId artistId {artistLink->getArtist()->getId()};
+	setObjects(std::move(entries));
 
-				Utils::push_back_if_not_present(_artistPositions[artistId], position);
-				auto itArtists {_artistMatrix.find(artistLink->getType())};
-				if (itArtists == std::cend(_artistMatrix))
-				{
-					[[maybe_unused]] auto [it, inserted] = _artistMatrix.try_emplace(artistLink->getType(), ArtistMatrix {width, height});
-					assert(inserted);
-					itArtists = it;
-				}
-				Utils::push_back_if_not_present(itArtists->second[position], artistId);
-			}
-		}
+	LMS_LOG(RECOMMENDATION, INFO) << "Classifier successfully loaded!";
+}
+
+FeaturesEngine::ObjectEntries
+FeaturesEngine::getObjectEntries() const
+{
+	ObjectEntries entries;
+
+	entries.tracks = _trackMatrix.getObjectPositions();
+	entries.releases = _releaseMatrix.getObjectPositions();
+	for (const auto& [linkType, artistMatrix] : _artistMatrix)
+		entries.artists.emplace(linkType, artistMatrix.getObjectPositions());
+
+	return entries;
+}
+
+void
+FeaturesEngine::setObjects(ObjectEntries&& entries)
+{
+	const SOM::Coordinate width {_network->getWidth()};
+	const SOM::Coordinate height {_network->getHeight()};
+
+	_trackMatrix = TrackMatrix {width, height, entries.tracks};
+	_trackPositions = TrackPositions {std::move(entries.tracks)};
+
+	_releaseMatrix = ReleaseMatrix {width, height, entries.releases};
+	_releasePositions = ReleasePositions {std::move(entries.releases)};
+
+	// artist positions are shared by all the link types
+	ObjectPositionContainer<ArtistId> artistPositions;
+	_artistMatrix.clear();
+	for (const auto& [linkType, artists] : entries.artists)
+	{
+		_artistMatrix.emplace(linkType, ArtistMatrix {width, height, artists});
+		artistPositions.insert(std::end(artistPositions), std::cbegin(artists), std::cend(artists));
 	}
+	entries.artists.clear();
+	_artistPositions = ArtistPositions {std::move(artistPositions)};
 
-	_network = std::make_unique<SOM::Network>(network);
+	std::size_t memoryUsage {_trackMatrix.getMemoryUsage() + _trackPositions.getMemoryUsage() + _releaseMatrix.getMemoryUsage() + _releasePositions.getMemoryUsage() + _artistPositions.getMemoryUsage()};
+	for (const auto& [linkType, artistMatrix] : _artistMatrix)
+		memoryUsage += artistMatrix.getMemoryUsage();
 
-	LMS_LOG(RECOMMENDATION, INFO) << "Classifier successfully loaded!";
+	LMS_LOG(RECOMMENDATION, DEBUG) << "Maps: " << _trackPositions.getObjectCount() << " tracks, " << _releasePositions.getObjectCount() << " releases, " << _artistPositions.getObjectCount() << " artists, using " << memoryUsage / 1024 << " KiB";
+}
+
+void
+FeaturesEngine::addTrack(Session& session, ObjectEntries& entries, TrackId trackId, ObjectRange<SOM::Position> positions)
+{
+	const Track::pointer track {Track::find(session, trackId)};
+	if (!track)
+		return;
+
+	// duplicates are removed when the positions are built
+	for (const SOM::Position& position : positions)
+	{
+		entries.tracks.push_back({trackId, position});
+
+		if (Release::pointer release {track->getRelease()})
+			entries.releases.push_back({release->getId(), position});
+
+		for (const TrackArtistLink::pointer& artistLink : track->getArtistLinks())
+			entries.artists[artistLink->getType()].push_back({artistLink->getArtist()->getId(), position});
+	}
 }
 
 } // ns Recommendation
@@ -22,6 +22,7 @@
 #include <algorithm>
 #include <functional>
 #include <unordered_map>
+#include <unordered_set>
 #include <optional>
 #include <string>
 #include <vector>
@@ -32,6 +33,8 @@
 #include "IEngine.hpp"
 #include "FeaturesEngineCache.hpp"
 #include "FeaturesDefs.hpp"
+#include "HnswIndex.hpp"
+#include "ObjectPositions.hpp"
 
 namespace Database
 {
@@ -70,32 +73,79 @@ class FeaturesEngine : public IEngine
 		{
 			std::size_t iterationCount {10};
 			float sampleCountPerNeuron {4};
+			std::size_t threadCount {1};
 			FeatureSettingsMap featureSettingsMap;
 		};
 		void loadFromTraining(const TrainSettings& trainSettings, const ProgressCallback& progressCallback);
 
-		template <typename IdType>
-		using ObjectPositions = std::unordered_map<IdType, std::vector<SOM::Position>>;
+		// Feature vectors of tracks, packed as contiguous floats
+		struct PackedSamples
+		{
+			std::size_t packedDimCount {};
+			std::vector<float> values;			// packedDimCount values per track, padded with zeros
+			std::vector<Database::TrackId> trackIds;
+
+			float* getValues(std::size_t index) { return values.data() + index * packedDimCount; }
+		};
+		// Tracks without valid features are skipped
+		PackedSamples extractSamples(const std::vector<Database::TrackId>& trackIds, const FeatureSettingsMap& featureSettingsMap, std::size_t threadCount) const;
+
+		// Incremental update: project the added tracks on the current network and remove the deleted ones
+		enum class UpdateResult
+		{
+			UpToDate,
+			Updated,
+			RetrainNeeded,	// too many tracks changed since the training
+		};
+		static constexpr double maxChangedTrackRatio {0.2};
+		UpdateResult update(const FeatureSettingsMap& featureSettingsMap);
 
 		using ArtistPositions = ObjectPositions<Database::ArtistId>;
 		using ReleasePositions = ObjectPositions<Database::ReleaseId>;
 		using TrackPositions = ObjectPositions<Database::TrackId>;
 
-		template <typename IdType>
-		using ObjectMatrix = SOM::Matrix<std::vector<IdType>>;
 		using ArtistMatrix = ObjectMatrix<Database::ArtistId>;
 		using ReleaseMatrix = ObjectMatrix<Database::ReleaseId>;
 		using TrackMatrix = ObjectMatrix<Database::TrackId>;
 
-		void load(const SOM::Network& network, const TrackPositions& tracksPosition);
+		// Object positions are collected here before the flat positions and matrices are built at once
+		struct ObjectEntries
+		{
+			ObjectPositionContainer<Database::TrackId> tracks;
+			ObjectPositionContainer<Database::ReleaseId> releases;
+			std::unordered_map<Database::TrackArtistLinkType, ObjectPositionContainer<Database::ArtistId>> artists;
+		};
+		ObjectEntries getObjectEntries() const;
+		void setObjects(ObjectEntries&& entries);
+
+		void load(const SOM::Network& network, const SOM::DataNormalizer& dataNormalizer, const TrackPositions& tracksPosition);
+		static void addTrack(Database::Session& session, ObjectEntries& entries, Database::TrackId trackId, ObjectRange<SOM::Position> positions);
+
+		template <typename IdType, typename ExistsFunc>
+		static void pruneObjects(const ObjectPositions<IdType>& objectPositions, const std::vector<ObjectPositionContainer<IdType>*>& objectEntries, ExistsFunc existsFunc);
+
+		using InputVectorDistance = SOM::InputVector::Distance;
+		struct RefVectorNeighbour
+		{
+			SOM::Position position;
+			InputVectorDistance distance;
+		};
+		void computeRefVectorNeighbours(const SOM::Network& network);
 
 		FeaturesEngineCache toCache() const;
+		void writeCache() const;
 
-		template <typename IdType>
-		static std::vector<SOM::Position> getMatchingRefVectorsPosition(const std::vector<IdType>& ids, const ObjectPositions<IdType>& objectPositions);
+		// Optional nearest neighbour index over the normalized feature vectors, to rank similar tracks individually
+		static bool isKnnIndexEnabled();
+		void loadKnnIndex(FeaturesEngineCache::KnnIndex&& knnIndex);
+		void buildKnnIndex(PackedSamples& normalizedSamples);
+		void buildKnnIndex(const FeatureSettingsMap& featureSettingsMap);
+		void addKnnIndexTrack(Database::TrackId trackId, const float* normalizedValues);
+		void removeKnnIndexTrack(Database::TrackId trackId);
+		TrackContainer findKnnSimilarTracks(const std::vector<Database::TrackId>& tracksIds, std::size_t maxCount) const;
 
 		template <typename IdType>
-		static std::vector<IdType> getObjectsIds(const std::vector<SOM::Position>& positions, const ObjectMatrix<IdType>& objectsMatrix);
+		static std::vector<SOM::Position> getMatchingRefVectorsPosition(const std::vector<IdType>& ids, const ObjectPositions<IdType>& objectPositions);
 
 		template <typename IdType>
 		std::vector<IdType> getSimilarObjects(const std::vector<IdType>& ids,
@@ -106,7 +156,11 @@ class FeaturesEngine : public IEngine
 		Database::Db&		_db;
 		bool				_loadCancelled {};
 		std::unique_ptr<SOM::Network>	_network;
+		std::unique_ptr<SOM::DataNormalizer>	_dataNormalizer;
+		std::size_t			_trainedTrackCount {};
+		std::size_t			_changedTrackCount {};
 		double				_networkRefVectorsDistanceMedian {};
+		SOM::Matrix<std::vector<RefVectorNeighbour>> _refVectorNeighbours; // sorted by distance
 
 		ArtistPositions     _artistPositions;
 		std::unordered_map<Database::TrackArtistLinkType, ArtistMatrix> _artistMatrix;
@@ -116,6 +170,10 @@ class FeaturesEngine : public IEngine
 
 		TrackPositions		_trackPositions;
 		TrackMatrix			_trackMatrix;
+
+		std::unique_ptr<HnswIndex>	_knnIndex;
+		std::vector<Database::TrackId>	_knnIndexTrackIds; // per node, invalid for removed tracks
+		std::unordered_map<Database::TrackId, HnswIndex::NodeId> _knnIndexNodes;
 };
 
 template <typename IdType>
@@ -123,36 +181,33 @@ std::vector<SOM::Position>
 FeaturesEngine::getMatchingRefVectorsPosition(const std::vector<IdType>& ids, const ObjectPositions<IdType>& objectPositions)
 {
 	std::vector<SOM::Position> res;
-
-	if (ids.empty())
-		return res;
+	std::unordered_set<SOM::Position> addedPositions;
 
 	for (const IdType id : ids)
 	{
-		auto it = objectPositions.find(id);
-		if (it == objectPositions.end())
-			continue;
-
-		for (const SOM::Position& position : it->second)
-			Utils::push_back_if_not_present(res, position);
+		for (const SOM::Position& position : objectPositions.getPositions(id))
+		{
+			if (addedPositions.insert(position).second)
+				res.push_back(position);
+		}
 	}
 
 	return res;
 }
 
-template <typename IdType>
-std::vector<IdType>
-FeaturesEngine::getObjectsIds(const std::vector<SOM::Position>& positions, const ObjectMatrix<IdType>& objectMatrix)
+template <typename IdType, typename ExistsFunc>
+void
+FeaturesEngine::pruneObjects(const ObjectPositions<IdType>& objectPositions, const std::vector<ObjectPositionContainer<IdType>*>& objectEntries, ExistsFunc existsFunc)
 {
-	std::vector<IdType> res;
-
-	for (const SOM::Position& position : positions)
+	std::unordered_set<IdType> removedIds;
+	objectPositions.visit([&](IdType id, ObjectRange<SOM::Position>)
 	{
-		for (const IdType id : objectMatrix.get(position))
-			Utils::push_back_if_not_present(res, id);
-	}
+		if (!existsFunc(id))
+			removedIds.insert(id);
+	});
 
-	return res;
+	for (ObjectPositionContainer<IdType>* entries : objectEntries)
+		eraseObjects(*entries, removedIds);
 }
 
 template <typename IdType>
@@ -163,40 +218,66 @@ FeaturesEngine::getSimilarObjects(const std::vector<IdType>& ids,
 		std::size_t maxCount) const
 {
 	std::vector<IdType> res;
+	if (maxCount == 0)
+		return res;
 
-	std::vector<SOM::Position> searchedRefVectorsPosition {getMatchingRefVectorsPosition(ids, objectPositions)};
-	if (searchedRefVectorsPosition.empty())
+	const std::vector<SOM::Position> matchingRefVectorsPosition {getMatchingRefVectorsPosition(ids, objectPositions)};
+	if (matchingRefVectorsPosition.empty())
 		return res;
 
-	while (1)
+	const std::unordered_set<IdType> inputIds {std::cbegin(ids), std::cend(ids)};
+	std::unordered_set<IdType> reportedIds;
+
+	std::unordered_set<SOM::Position> searchedRefVectorsPosition;
+	// neighbours of the searched area, with their distance to the closest ref vector of the area
+	std::unordered_map<SOM::Position, InputVectorDistance> candidateRefVectorsPosition;
+
+	auto addToSearchedArea {[&](const SOM::Position& position)
 	{
-		std::vector<IdType> closestObjectIds {getObjectsIds(searchedRefVectorsPosition, objectMatrix)};
+		searchedRefVectorsPosition.insert(position);
+		candidateRefVectorsPosition.erase(position);
+
+		for (auto& [candidatePosition, distance] : candidateRefVectorsPosition)
+			distance = std::min(distance, _network->getRefVectorsDistance(candidatePosition, position));
+
+		for (const RefVectorNeighbour& neighbour : _refVectorNeighbours.get(position))
+		{
+			if (searchedRefVectorsPosition.count(neighbour.position) || candidateRefVectorsPosition.count(neighbour.position))
+				continue;
+
+			InputVectorDistance distance {neighbour.distance};
+			for (const SOM::Position& searchedPosition : searchedRefVectorsPosition)
+				distance = std::min(distance, _network->getRefVectorsDistance(neighbour.position, searchedPosition));
 
-		// Remove objects that are already in input or already reported
-		closestObjectIds.erase(std::remove_if(std::begin(closestObjectIds), std::end(closestObjectIds),
-					[&](IdType id)
-					{
-						return std::find(std::cbegin(ids), std::cend(ids), id) != std::cend(ids);
-					})
-				, std::end(closestObjectIds));
+			candidateRefVectorsPosition.emplace(neighbour.position, distance);
+		}
 
-		for (IdType id : closestObjectIds)
+		// Report objects that are not in input or already reported
+		for (const IdType id : objectMatrix.get(position))
 		{
 			if (res.size() == maxCount)
 				break;
 
-			Utils::push_back_if_not_present(res, id);
+			if (inputIds.count(id) || !reportedIds.insert(id).second)
+				continue;
+
+			res.push_back(id);
 		}
+	}};
 
-		if (res.size() == maxCount)
-			break;
+	for (const SOM::Position& position : matchingRefVectorsPosition)
+		addToSearchedArea(position);
 
-		// If there is not enough objects, try again with closest neighbour until there is too much distance
-		const std::optional<SOM::Position> closestRefVectorPosition {_network->getClosestRefVectorPosition(searchedRefVectorsPosition, _networkRefVectorsDistanceMedian * 0.75)};
-		if (!closestRefVectorPosition)
+	// If there is not enough objects, try again with closest neighbour until there is too much distance
+	const InputVectorDistance maxDistance {_networkRefVectorsDistanceMedian * 0.75};
+	while (res.size() < maxCount && !candidateRefVectorsPosition.empty())
+	{
+		auto itClosest {std::min_element(std::cbegin(candidateRefVectorsPosition), std::cend(candidateRefVectorsPosition),
+				[](const auto& a, const auto& b) { return a.second < b.second; })};
+		if (itClosest->second > maxDistance)
 			break;
 
-		Utils::push_back_if_not_present(searchedRefVectorsPosition, closestRefVectorPosition.value());
+		addToSearchedArea(itClosest->first);
 	}
 
 	return res;
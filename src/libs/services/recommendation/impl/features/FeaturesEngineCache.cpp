@@ -19,15 +19,133 @@
 
 #include "FeaturesEngineCache.hpp"
 
-#include <boost/property_tree/ptree.hpp>
-#include <boost/property_tree/xml_parser.hpp>
-
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils/Crc32Calculator.hpp"
 #include "utils/IConfig.hpp"
 #include "utils/Logger.hpp"
 #include "utils/Service.hpp"
 
 namespace Recommendation {
 
+// Cache file layout (native byte order, checked using the magic value):
+//  Header
+//  data weights:	double[dimCount]
+//  data normalizer:	double[dimCount * 2], min / max pairs
+//  ref vectors:	double[width * height * dimCount], row by row
+//  track positions:	TrackPositionRecord[positionCount]
+// The crc covers everything after the header
+namespace
+{
+	constexpr char cacheMagic[8] {'L', 'M', 'S', 'F', 'E', 'A', 'T', '\0'};
+	constexpr std::uint32_t cacheVersion {3};
+
+	struct Header
+	{
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t headerSize;
+		std::uint32_t width;
+		std::uint32_t height;
+		std::uint64_t dimCount;
+		std::uint64_t positionCount;
+		std::uint64_t trainedTrackCount;
+		std::uint64_t changedTrackCount;
+		std::uint64_t payloadSize;
+		std::uint32_t payloadCrc;
+		std::uint32_t reserved;
+	};
+	static_assert(sizeof(Header) % alignof(double) == 0);
+
+	struct TrackPositionRecord
+	{
+		Database::IdType::ValueType trackId;
+		std::uint32_t x;
+		std::uint32_t y;
+	};
+	static_assert(sizeof(TrackPositionRecord) % alignof(double) == 0);
+
+	// Knn index file layout:
+	//  KnnIndexHeader
+	//  track ids:	IdType::ValueType[nodeCount]
+	//  index:		HnswIndex serialized form
+	// The crc covers everything after the header
+	constexpr char knnIndexMagic[8] {'L', 'M', 'S', 'K', 'N', 'N', '\0', '\0'};
+	constexpr std::uint32_t knnIndexVersion {1};
+
+	struct KnnIndexHeader
+	{
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t headerSize;
+		std::uint64_t nodeCount;
+		std::uint64_t payloadSize;
+		std::uint32_t payloadCrc;
+		std::uint32_t reserved;
+	};
+
+	std::uint64_t computePayloadSize(const Header& header)
+	{
+		return (header.dimCount * 3 + static_cast<std::uint64_t>(header.width) * header.height * header.dimCount) * sizeof(double)
+			+ header.positionCount * sizeof(TrackPositionRecord);
+	}
+
+	// Read only mapping of a whole file
+	class MappedFile
+	{
+		public:
+			MappedFile(const std::filesystem::path& path)
+			{
+				_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+				if (_fd < 0)
+					return;
+
+				struct stat fileStat;
+				if (::fstat(_fd, &fileStat) != 0 || fileStat.st_size <= 0)
+					return;
+
+				void* data {::mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, _fd, 0)};
+				if (data == MAP_FAILED)
+					return;
+
+				_data = static_cast<const std::byte*>(data);
+				_size = static_cast<std::size_t>(fileStat.st_size);
+			}
+
+			~MappedFile()
+			{
+				if (_data)
+					::munmap(const_cast<std::byte*>(_data), _size);
+				if (_fd >= 0)
+					::close(_fd);
+			}
+
+			MappedFile(const MappedFile&) = delete;
+			MappedFile& operator=(const MappedFile&) = delete;
+
+			const std::byte* getData() const { return _data; }
+			std::size_t getSize() const { return _size; }
+
+		private:
+			int _fd {-1};
+			const std::byte* _data {};
+			std::size_t _size {};
+	};
+
+	template <typename T>
+	void writeValue(std::ostream& os, Utils::Crc32Calculator& crc, const T& value)
+	{
+		const std::byte* bytes {reinterpret_cast<const std::byte*>(&value)};
+		crc.processBytes(bytes, sizeof(value));
+		os.write(reinterpret_cast<const char*>(bytes), sizeof(value));
+	}
+}
 
 static
 std::filesystem::path getCacheDirectory()
@@ -35,220 +153,372 @@ std::filesystem::path getCacheDirectory()
 	return Service<IConfig>::get()->getPath("working-dir") / "cache" / "features";
 }
 
-static std::filesystem::path getCacheNetworkFilePath()
+static std::filesystem::path getCacheFilePath()
 {
-	return getCacheDirectory() / "network";
+	return getCacheDirectory() / "features.bin";
 }
 
-static std::filesystem::path getCacheTrackPositionsFilePath()
+static std::filesystem::path getKnnIndexFilePath()
 {
-	return getCacheDirectory() / "track_positions";
+	return getCacheDirectory() / "knn_index.bin";
 }
 
 static
 bool
-networkToCacheFile(const SOM::Network& network, std::filesystem::path path)
+renameCacheFile(const std::filesystem::path& tmpPath, const std::filesystem::path& path)
 {
-	try
-	{
-		boost::property_tree::ptree root;
-
-		root.put("width", network.getWidth());
-		root.put("height", network.getHeight());
-		root.put("dim_count", network.getInputDimCount());
-
-		for (SOM::InputVector::value_type weight : network.getDataWeights())
-			root.add("weights.weight", weight);
-
-		for (SOM::Coordinate x = 0; x < network.getWidth(); ++x)
-		{
-			for (SOM::Coordinate y = 0; y < network.getWidth(); ++y)
-			{
-				const auto& refVector = network.getRefVector({x, y});
-
-				boost::property_tree::ptree node;
-				for (auto value : refVector)
-					node.add("values.value", value);
-
-				node.put("coord_x", x);
-				node.put("coord_y", y);
-
-				root.add_child("ref_vectors.ref_vector", node);
-			}
-		}
-
-		boost::property_tree::write_xml(path.string(), root);
-
-		LMS_LOG(RECOMMENDATION, DEBUG) << "Created network cache";
-		return true;
-	}
-	catch (boost::property_tree::ptree_error& error)
+	std::error_code ec;
+	std::filesystem::rename(tmpPath, path, ec);
+	if (ec)
 	{
-		LMS_LOG(RECOMMENDATION, ERROR) << "Cannot create network cache: " << error.what();
+		LMS_LOG(RECOMMENDATION, ERROR) << "Cannot rename features cache file '" << tmpPath.string() << "': " << ec.message();
+		std::filesystem::remove(tmpPath, ec);
 		return false;
 	}
+
+	return true;
 }
 
-std::optional<SOM::Network>
-FeaturesEngineCache::createNetworkFromCacheFile(const std::filesystem::path& path)
+std::optional<FeaturesEngineCache>
+FeaturesEngineCache::readFromCacheFile(const std::filesystem::path& path)
 {
 	if (!std::filesystem::exists(path))
 		return std::nullopt;
 
-	try
-	{
-		LMS_LOG(RECOMMENDATION, INFO) << "Reading network from cache...";
+	LMS_LOG(RECOMMENDATION, INFO) << "Reading features cache...";
 
-		boost::property_tree::ptree root;
+	const MappedFile file {path};
+	if (!file.getData())
+	{
+		LMS_LOG(RECOMMENDATION, ERROR) << "Cannot map features cache file '" << path.string() << "'";
+		return std::nullopt;
+	}
 
-		boost::property_tree::read_xml(path.string(), root);
+	Header header;
+	if (file.getSize() < sizeof(header))
+	{
+		LMS_LOG(RECOMMENDATION, ERROR) << "Features cache file is truncated";
+		return std::nullopt;
+	}
+	std::memcpy(&header, file.getData(), sizeof(header));
 
-		SOM::Coordinate width {root.get<SOM::Coordinate>("width")};
-		SOM::Coordinate height {root.get<SOM::Coordinate>("height")};
-		std::size_t dimCount {root.get<std::size_t>("dim_count")};
+	if (std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0
+		|| header.version != cacheVersion
+		|| header.headerSize != sizeof(Header))
+	{
+		LMS_LOG(RECOMMENDATION, INFO) << "Features cache file has an unsupported format";
+		return std::nullopt;
+	}
 
-		SOM::Network res {width, height, dimCount};
+	if (header.width == 0 || header.height == 0 || header.dimCount == 0
+		|| header.payloadSize != computePayloadSize(header)
+		|| file.getSize() != sizeof(Header) + header.payloadSize)
+	{
+		LMS_LOG(RECOMMENDATION, ERROR) << "Features cache file has inconsistent sizes";
+		return std::nullopt;
+	}
 
+	const std::byte* payload {file.getData() + sizeof(Header)};
+	{
+		Utils::Crc32Calculator crc;
+		crc.processBytes(payload, header.payloadSize);
+		if (crc.getResult() != header.payloadCrc)
 		{
-			SOM::InputVector weights {dimCount};
-			std::size_t i {};
-			for (const auto& val : root.get_child("weights"))
-				weights[i++] = val.second.get_value<double>();
-
-			res.setDataWeights(weights);
+			LMS_LOG(RECOMMENDATION, ERROR) << "Features cache file checksum mismatch";
+			return std::nullopt;
 		}
+	}
 
-		for (const auto& node : root.get_child("ref_vectors"))
+	const std::size_t dimCount {static_cast<std::size_t>(header.dimCount)};
+	auto readVector {[&](SOM::InputVector& vector)
+	{
+		std::size_t i {};
+		for (auto& value : vector)
 		{
-			SOM::Coordinate x {node.second.get<SOM::Coordinate>("coord_x")};
-			SOM::Coordinate y {node.second.get<SOM::Coordinate>("coord_y")};
-
-			SOM::InputVector refVector {dimCount};
-			std::size_t i {};
-			for (const auto& val : node.second.get_child("values"))
-				refVector[i++] = val.second.get_value<SOM::InputVector::value_type>();
-
-			res.setRefVector({x, y}, refVector);
+			double readValue;
+			std::memcpy(&readValue, payload + i++ * sizeof(double), sizeof(double));
+			value = readValue;
 		}
+		payload += dimCount * sizeof(double);
+	}};
 
-		LMS_LOG(RECOMMENDATION, INFO) << "Successfully read network from cache";
-
-		return res;
-	}
-	catch (boost::property_tree::ptree_error& error)
+	SOM::Network network {header.width, header.height, dimCount};
 	{
-		LMS_LOG(RECOMMENDATION, ERROR) << "Cannot read network cache: " << error.what();
-		return std::nullopt;
+		SOM::InputVector weights {dimCount};
+		readVector(weights);
+		network.setDataWeights(weights);
 	}
-}
 
-bool
-FeaturesEngineCache::objectPositionToCacheFile(const TrackPositions& trackPositions, const std::filesystem::path& path)
-{
-	try
+	SOM::DataNormalizer dataNormalizer {dimCount};
+	for (std::size_t i {}; i < dimCount; ++i)
 	{
-		boost::property_tree::ptree root;
+		SOM::DataNormalizer::MinMax minMax;
+		std::memcpy(&minMax.min, payload, sizeof(double));
+		std::memcpy(&minMax.max, payload + sizeof(double), sizeof(double));
+		payload += 2 * sizeof(double);
 
-		for (const auto& [id, positions] : trackPositions)
-		{
-			boost::property_tree::ptree node;
-
-			node.put("id", id.getValue());
+		dataNormalizer.setValue(i, minMax);
+	}
 
-			for (const SOM::Position& position : positions)
-			{
-				boost::property_tree::ptree positionNode;
-				positionNode.put("x", position.x);
-				positionNode.put("y", position.y);
+	for (SOM::Coordinate y {}; y < header.height; ++y)
+	{
+		for (SOM::Coordinate x {}; x < header.width; ++x)
+		{
+			SOM::InputVector refVector {dimCount};
+			readVector(refVector);
+			network.setRefVector({x, y}, refVector);
+		}
+	}
 
-				node.add_child("position.position", positionNode);
-			}
+	ObjectPositionContainer<Database::TrackId> trackPositions;
+	trackPositions.reserve(header.positionCount);
+	for (std::uint64_t i {}; i < header.positionCount; ++i)
+	{
+		TrackPositionRecord record;
+		std::memcpy(&record, payload, sizeof(record));
+		payload += sizeof(record);
 
-			root.add_child("objects.object", node);
+		if (record.x >= header.width || record.y >= header.height)
+		{
+			LMS_LOG(RECOMMENDATION, ERROR) << "Features cache file has an out of range track position";
+			return std::nullopt;
 		}
 
-		boost::property_tree::write_xml(path.string(), root);
-		return true;
-	}
-	catch (boost::property_tree::ptree_error& error)
-	{
-		LMS_LOG(RECOMMENDATION, ERROR) << "Cannot cache object position: " << error.what();
-		return false;
+		trackPositions.push_back({Database::TrackId {record.trackId}, {record.x, record.y}});
 	}
+
+	LMS_LOG(RECOMMENDATION, INFO) << "Successfully read features cache";
+
+	return FeaturesEngineCache {std::move(network), std::move(dataNormalizer), TrackPositions {std::move(trackPositions)}, static_cast<std::size_t>(header.trainedTrackCount), static_cast<std::size_t>(header.changedTrackCount)};
 }
 
-std::optional<FeaturesEngineCache::TrackPositions>
-FeaturesEngineCache::createObjectPositionsFromCacheFile(const std::filesystem::path& path)
+bool
+FeaturesEngineCache::writeToCacheFile(const std::filesystem::path& path) const
 {
-	try
+	// write in a temporary file first, so that a partial write never replaces a valid cache
+	std::filesystem::path tmpPath {path};
+	tmpPath += ".tmp";
+
+	Header header {};
+	std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+	header.version = cacheVersion;
+	header.headerSize = sizeof(Header);
+	header.width = _network.getWidth();
+	header.height = _network.getHeight();
+	header.dimCount = _network.getInputDimCount();
+	header.trainedTrackCount = _trainedTrackCount;
+	header.changedTrackCount = _changedTrackCount;
+	header.positionCount = _trackPositions.getPositionCount();
+	header.payloadSize = computePayloadSize(header);
+
 	{
-		LMS_LOG(RECOMMENDATION, INFO) << "Reading object position from cache...";
+		std::ofstream os {tmpPath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc};
+		if (!os)
+		{
+			LMS_LOG(RECOMMENDATION, ERROR) << "Cannot create features cache file '" << tmpPath.string() << "'";
+			return false;
+		}
 
-		boost::property_tree::ptree root;
+		// header is rewritten at the end, once the crc is known
+		os.write(reinterpret_cast<const char*>(&header), sizeof(header));
 
-		boost::property_tree::read_xml(path.string(), root);
+		Utils::Crc32Calculator crc;
+		for (double weight : _network.getDataWeights())
+			writeValue(os, crc, weight);
 
-		TrackPositions res;
+		for (std::size_t i {}; i < _dataNormalizer.getInputDimCount(); ++i)
+		{
+			writeValue(os, crc, static_cast<double>(_dataNormalizer.getValue(i).min));
+			writeValue(os, crc, static_cast<double>(_dataNormalizer.getValue(i).max));
+		}
 
-		for (const auto& object : root.get_child("objects"))
+		for (SOM::Coordinate y {}; y < _network.getHeight(); ++y)
 		{
-			const Database::TrackId id {object.second.get<Database::IdType::ValueType>("id")};
-			for (const auto& position : object.second.get_child("position"))
+			for (SOM::Coordinate x {}; x < _network.getWidth(); ++x)
 			{
-				auto x = position.second.get<SOM::Coordinate>("x");
-				auto y = position.second.get<SOM::Coordinate>("y");
-
-				res[id].push_back({x, y});
+				for (double value : _network.getRefVector({x, y}))
+					writeValue(os, crc, value);
 			}
 		}
 
-		LMS_LOG(RECOMMENDATION, INFO) << "Successfully read object position from cache";
+		_trackPositions.visit([&](Database::TrackId trackId, ObjectRange<SOM::Position> positions)
+		{
+			for (const SOM::Position& position : positions)
+				writeValue(os, crc, TrackPositionRecord {trackId.getValue(), position.x, position.y});
+		});
 
-		return res;
-	}
-	catch (boost::property_tree::ptree_error& error)
-	{
-		LMS_LOG(RECOMMENDATION, ERROR) << "Cannot create object position from cache file: " << error.what();
-		return std::nullopt;
+		header.payloadCrc = crc.getResult();
+		os.seekp(0);
+		os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		os.flush();
+
+		if (!os)
+		{
+			LMS_LOG(RECOMMENDATION, ERROR) << "Cannot write features cache file '" << tmpPath.string() << "'";
+			std::error_code ec;
+			std::filesystem::remove(tmpPath, ec);
+			return false;
+		}
 	}
+
+	if (!renameCacheFile(tmpPath, path))
+		return false;
+
+	LMS_LOG(RECOMMENDATION, DEBUG) << "Created features cache";
+	return true;
 }
 
 void
 FeaturesEngineCache::invalidate()
 {
-	std::filesystem::remove(getCacheNetworkFilePath());
-	std::filesystem::remove(getCacheTrackPositionsFilePath());
+	std::error_code ec;
+	std::filesystem::remove(getCacheFilePath(), ec);
+	std::filesystem::remove(getKnnIndexFilePath(), ec);
+
+	// legacy XML cache files
+	std::filesystem::remove(getCacheDirectory() / "network", ec);
+	std::filesystem::remove(getCacheDirectory() / "track_positions", ec);
 }
 
 std::optional<FeaturesEngineCache>
 FeaturesEngineCache::read()
 {
-	auto network{createNetworkFromCacheFile(getCacheNetworkFilePath())};
-	if (!network)
+	return readFromCacheFile(getCacheFilePath());
+}
+
+void
+FeaturesEngineCache::write() const
+{
+	std::filesystem::create_directories(getCacheDirectory());
+
+	if (!writeToCacheFile(getCacheFilePath()))
+		invalidate();
+}
+
+std::optional<FeaturesEngineCache::KnnIndex>
+FeaturesEngineCache::readKnnIndex()
+{
+	const std::filesystem::path path {getKnnIndexFilePath()};
+	if (!std::filesystem::exists(path))
+		return std::nullopt;
+
+	LMS_LOG(RECOMMENDATION, INFO) << "Reading nearest neighbour index cache...";
+
+	const MappedFile file {path};
+	KnnIndexHeader header;
+	if (!file.getData() || file.getSize() < sizeof(header))
+	{
+		LMS_LOG(RECOMMENDATION, ERROR) << "Cannot read nearest neighbour index cache file '" << path.string() << "'";
 		return std::nullopt;
+	}
+	std::memcpy(&header, file.getData(), sizeof(header));
+
+	if (std::memcmp(header.magic, knnIndexMagic, sizeof(knnIndexMagic)) != 0
+		|| header.version != knnIndexVersion
+		|| header.headerSize != sizeof(KnnIndexHeader)
+		|| header.payloadSize != file.getSize() - sizeof(KnnIndexHeader)
+		|| header.nodeCount > header.payloadSize / sizeof(Database::IdType::ValueType))
+	{
+		LMS_LOG(RECOMMENDATION, INFO) << "Nearest neighbour index cache file has an unsupported format";
+		return std::nullopt;
+	}
+
+	const std::byte* payload {file.getData() + sizeof(KnnIndexHeader)};
+	{
+		Utils::Crc32Calculator crc;
+		crc.processBytes(payload, header.payloadSize);
+		if (crc.getResult() != header.payloadCrc)
+		{
+			LMS_LOG(RECOMMENDATION, ERROR) << "Nearest neighbour index cache file checksum mismatch";
+			return std::nullopt;
+		}
+	}
+
+	std::vector<Database::TrackId> trackIds;
+	trackIds.reserve(header.nodeCount);
+	for (std::uint64_t i {}; i < header.nodeCount; ++i)
+	{
+		Database::IdType::ValueType trackId;
+		std::memcpy(&trackId, payload, sizeof(trackId));
+		payload += sizeof(trackId);
+
+		trackIds.push_back(trackId == Database::TrackId {}.getValue() ? Database::TrackId {} : Database::TrackId {trackId});
+	}
 
-	auto trackPositions{createObjectPositionsFromCacheFile(getCacheTrackPositionsFilePath())};
-	if (!trackPositions)
+	const std::size_t indexSize {static_cast<std::size_t>(header.payloadSize - header.nodeCount * sizeof(Database::IdType::ValueType))};
+	std::optional<HnswIndex> index {HnswIndex::deserialize(payload, indexSize)};
+	if (!index || index->getNodeCount() != trackIds.size())
+	{
+		LMS_LOG(RECOMMENDATION, ERROR) << "Nearest neighbour index cache file is corrupted";
 		return std::nullopt;
+	}
+
+	LMS_LOG(RECOMMENDATION, INFO) << "Successfully read nearest neighbour index cache";
 
-	return FeaturesEngineCache {std::move(*network), std::move(*trackPositions)};
+	return KnnIndex {std::move(*index), std::move(trackIds)};
 }
 
 void
-FeaturesEngineCache::write() const
+FeaturesEngineCache::writeKnnIndex(const HnswIndex& index, const std::vector<Database::TrackId>& trackIds)
 {
-	std::filesystem::create_directories(Service<IConfig>::get()->getPath("working-dir") / "cache" / "features");
+	assert(index.getNodeCount() == trackIds.size());
+
+	std::filesystem::create_directories(getCacheDirectory());
+
+	const std::filesystem::path path {getKnnIndexFilePath()};
+	std::filesystem::path tmpPath {path};
+	tmpPath += ".tmp";
+
+	const std::vector<std::byte> serializedIndex {index.serialize()};
+
+	KnnIndexHeader header {};
+	std::memcpy(header.magic, knnIndexMagic, sizeof(knnIndexMagic));
+	header.version = knnIndexVersion;
+	header.headerSize = sizeof(KnnIndexHeader);
+	header.nodeCount = trackIds.size();
+	header.payloadSize = trackIds.size() * sizeof(Database::IdType::ValueType) + serializedIndex.size();
 
-	if (!networkToCacheFile(_network, getCacheNetworkFilePath())
-		|| !objectPositionToCacheFile(_trackPositions, getCacheTrackPositionsFilePath()))
 	{
-		invalidate();
+		std::ofstream os {tmpPath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc};
+		if (!os)
+		{
+			LMS_LOG(RECOMMENDATION, ERROR) << "Cannot create nearest neighbour index cache file '" << tmpPath.string() << "'";
+			return;
+		}
+
+		os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		Utils::Crc32Calculator crc;
+		for (const Database::TrackId trackId : trackIds)
+			writeValue(os, crc, trackId.getValue());
+
+		crc.processBytes(serializedIndex.data(), serializedIndex.size());
+		os.write(reinterpret_cast<const char*>(serializedIndex.data()), serializedIndex.size());
+
+		header.payloadCrc = crc.getResult();
+		os.seekp(0);
+		os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		os.flush();
+
+		if (!os)
+		{
+			LMS_LOG(RECOMMENDATION, ERROR) << "Cannot write nearest neighbour index cache file '" << tmpPath.string() << "'";
+			std::error_code ec;
+			std::filesystem::remove(tmpPath, ec);
+			return;
+		}
 	}
+
+	if (renameCacheFile(tmpPath, path))
+		LMS_LOG(RECOMMENDATION, DEBUG) << "Created nearest neighbour index cache";
 }
 
-FeaturesEngineCache::FeaturesEngineCache(SOM::Network network, TrackPositions trackPositions)
+FeaturesEngineCache::FeaturesEngineCache(SOM::Network network, SOM::DataNormalizer dataNormalizer, TrackPositions trackPositions, std::size_t trainedTrackCount, std::size_t changedTrackCount)
 : _network {std::move(network)},
-_trackPositions {std::move(trackPositions)}
+_dataNormalizer {std::move(dataNormalizer)},
+_trackPositions {std::move(trackPositions)},
+_trainedTrackCount {trainedTrackCount},
+_changedTrackCount {changedTrackCount}
 {
 }
 
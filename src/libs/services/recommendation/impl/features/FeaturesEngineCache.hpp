@@ -20,9 +20,13 @@
 #pragma once
 
 #include <filesystem>
+#include <optional>
 #include <unordered_map>
 
 #include "services/database/TrackId.hpp"
+#include "HnswIndex.hpp"
+#include "ObjectPositions.hpp"
+#include "som/DataNormalizer.hpp"
 #include "som/Network.hpp"
 
 namespace Recommendation {
@@ -35,19 +39,30 @@ class FeaturesEngineCache
 		static std::optional<FeaturesEngineCache> read();
 		void write() const;
 
+		// Nearest neighbour index, stored in its own file as it is optional
+		struct KnnIndex
+		{
+			HnswIndex index;
+			std::vector<Database::TrackId> trackIds; // per node, invalid for removed tracks
+		};
+		static std::optional<KnnIndex> readKnnIndex();
+		static void writeKnnIndex(const HnswIndex& index, const std::vector<Database::TrackId>& trackIds);
+
 	private:
-		using TrackPositions = std::unordered_map<Database::TrackId, std::vector<SOM::Position>>;
+		using TrackPositions = ObjectPositions<Database::TrackId>;
 
-		FeaturesEngineCache(SOM::Network network, TrackPositions trackPositions);
+		FeaturesEngineCache(SOM::Network network, SOM::DataNormalizer dataNormalizer, TrackPositions trackPositions, std::size_t trainedTrackCount, std::size_t changedTrackCount);
 
-		static std::optional<SOM::Network> createNetworkFromCacheFile(const std::filesystem::path& path);
-		static std::optional<TrackPositions> createObjectPositionsFromCacheFile(const std::filesystem::path& path);
-		static bool objectPositionToCacheFile(const TrackPositions& trackPositions, const std::filesystem::path& path);
+		static std::optional<FeaturesEngineCache> readFromCacheFile(const std::filesystem::path& path);
+		bool writeToCacheFile(const std::filesystem::path& path) const;
 
 		friend class FeaturesEngine;
 
 		SOM::Network		_network;
+		SOM::DataNormalizer	_dataNormalizer;
 		TrackPositions		_trackPositions;
+		std::size_t			_trainedTrackCount {};	// track count used for the training
+		std::size_t			_changedTrackCount {};	// tracks added or removed since the training
 };
 
 } // namespace Recommendation
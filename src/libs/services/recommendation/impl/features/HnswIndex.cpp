@@ -0,0 +1,440 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "HnswIndex.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <queue>
+
+#include "som/DistanceKernels.hpp"
+
+namespace Recommendation {
+
+namespace
+{
+	struct CloserFirst
+	{
+		bool operator()(const HnswIndex::Neighbour& a, const HnswIndex::Neighbour& b) const { return a.distance > b.distance; }
+	};
+
+	struct FurtherFirst
+	{
+		bool operator()(const HnswIndex::Neighbour& a, const HnswIndex::Neighbour& b) const { return a.distance < b.distance; }
+	};
+
+	class Writer
+	{
+		public:
+			template <typename T>
+			void write(const T& value)
+			{
+				const std::size_t offset {_data.size()};
+				_data.resize(offset + sizeof(T));
+				std::memcpy(_data.data() + offset, &value, sizeof(T));
+			}
+
+			template <typename T>
+			void write(const T* values, std::size_t count)
+			{
+				const std::size_t offset {_data.size()};
+				_data.resize(offset + sizeof(T) * count);
+				std::memcpy(_data.data() + offset, values, sizeof(T) * count);
+			}
+
+			std::vector<std::byte> release() { return std::move(_data); }
+
+		private:
+			std::vector<std::byte> _data;
+	};
+
+	class Reader
+	{
+		public:
+			Reader(const std::byte* data, std::size_t size) : _data {data}, _size {size} {}
+
+			template <typename T>
+			bool read(T& value)
+			{
+				return read(&value, 1);
+			}
+
+			template <typename T>
+			bool read(T* values, std::size_t count)
+			{
+				if (count > (_size - _offset) / sizeof(T))
+					return false;
+
+				std::memcpy(values, _data + _offset, sizeof(T) * count);
+				_offset += sizeof(T) * count;
+				return true;
+			}
+
+			bool isAtEnd() const { return _offset == _size; }
+
+		private:
+			const std::byte* _data;
+			std::size_t _size;
+			std::size_t _offset {};
+	};
+
+	// Marks visited nodes using a generation counter, to avoid clearing or hashing for each search
+	class VisitedNodes
+	{
+		public:
+			void reset(std::size_t nodeCount)
+			{
+				if (_marks.size() < nodeCount)
+					_marks.resize(nodeCount, 0);
+
+				if (++_generation == 0)
+				{
+					std::fill(std::begin(_marks), std::end(_marks), 0);
+					_generation = 1;
+				}
+			}
+
+			// returns false if already visited
+			bool visit(HnswIndex::NodeId node)
+			{
+				if (_marks[node] == _generation)
+					return false;
+
+				_marks[node] = _generation;
+				return true;
+			}
+
+		private:
+			std::vector<std::uint16_t> _marks;
+			std::uint16_t _generation {};
+	};
+
+	constexpr std::uint32_t noEntryPoint {std::numeric_limits<std::uint32_t>::max()};
+}
+
+HnswIndex::HnswIndex(std::size_t dimCount, const std::vector<float>& weights, Params params)
+: _dimCount {dimCount},
+_paddedDimCount {SOM::Kernels::getPaddedDimCount(dimCount)},
+_params {params},
+_weights(_paddedDimCount, 0.f)
+{
+	assert(weights.size() == dimCount);
+	assert(_params.maxLinkCount >= 2);
+	std::copy(std::cbegin(weights), std::cend(weights), std::begin(_weights));
+}
+
+HnswIndex::Distance
+HnswIndex::computeDistance(const float* a, const float* b) const
+{
+	return SOM::Kernels::computeWeightedSquareDistance(a, b, _weights.data(), _paddedDimCount);
+}
+
+HnswIndex::Level
+HnswIndex::pickLevel()
+{
+	// exponentially decaying probability, ~1/M nodes go up one level
+	const double levelMultiplier {1. / std::log(static_cast<double>(_params.maxLinkCount))};
+	std::uniform_real_distribution<double> distribution {std::numeric_limits<double>::min(), 1.};
+
+	const double level {std::floor(-std::log(distribution(_levelGenerator)) * levelMultiplier)};
+	return static_cast<Level>(std::min(level, static_cast<double>(maxLevel)));
+}
+
+HnswIndex::NodeId
+HnswIndex::add(const float* values)
+{
+	assert(_levels.size() < noEntryPoint);
+	const NodeId node {static_cast<NodeId>(_levels.size())};
+
+	_vectors.resize(_vectors.size() + _paddedDimCount, 0.f);
+	std::copy(values, values + _dimCount, std::end(_vectors) - _paddedDimCount);
+
+	const Level level {pickLevel()};
+	_levels.push_back(level);
+	_links.emplace_back(static_cast<std::size_t>(level) + 1);
+
+	if (!_entryPoint)
+	{
+		_entryPoint = node;
+		return node;
+	}
+
+	const float* nodeVector {getVector(node)};
+	const Level entryPointLevel {_levels[*_entryPoint]};
+
+	std::vector<Neighbour> entryPoints {Neighbour {*_entryPoint, computeDistance(nodeVector, getVector(*_entryPoint))}};
+	for (Level currentLevel {entryPointLevel}; currentLevel > level; --currentLevel)
+		entryPoints = searchLevel(nodeVector, entryPoints, 1, currentLevel);
+
+	for (int currentLevel {std::min(level, entryPointLevel)}; currentLevel >= 0; --currentLevel)
+	{
+		const Level linkLevel {static_cast<Level>(currentLevel)};
+
+		std::vector<Neighbour> candidates {searchLevel(nodeVector, entryPoints, _params.efConstruction, linkLevel)};
+
+		_links[node][linkLevel] = selectNeighbours(candidates, _params.maxLinkCount);
+		for (const NodeId neighbour : _links[node][linkLevel])
+		{
+			std::vector<NodeId>& neighbourLinks {_links[neighbour][linkLevel]};
+			neighbourLinks.push_back(node);
+			if (neighbourLinks.size() > getMaxLinkCount(linkLevel))
+				shrinkLinks(neighbour, linkLevel);
+		}
+
+		entryPoints = std::move(candidates);
+	}
+
+	if (level > entryPointLevel)
+		_entryPoint = node;
+
+	return node;
+}
+
+std::vector<HnswIndex::Neighbour>
+HnswIndex::search(const float* values, std::size_t count, std::size_t ef) const
+{
+	std::vector<float> paddedValues(_paddedDimCount, 0.f);
+	std::copy(values, values + _dimCount, std::begin(paddedValues));
+
+	return searchPadded(paddedValues.data(), count, ef);
+}
+
+std::vector<HnswIndex::Neighbour>
+HnswIndex::searchNode(NodeId node, std::size_t count, std::size_t ef) const
+{
+	assert(node < getNodeCount());
+	return searchPadded(getVector(node), count, ef);
+}
+
+std::vector<HnswIndex::Neighbour>
+HnswIndex::searchPadded(const float* paddedValues, std::size_t count, std::size_t ef) const
+{
+	if (!_entryPoint || count == 0)
+		return {};
+
+	std::vector<Neighbour> entryPoints {Neighbour {*_entryPoint, computeDistance(paddedValues, getVector(*_entryPoint))}};
+	for (Level currentLevel {_levels[*_entryPoint]}; currentLevel > 0; --currentLevel)
+		entryPoints = searchLevel(paddedValues, entryPoints, 1, currentLevel);
+
+	std::vector<Neighbour> res {searchLevel(paddedValues, entryPoints, std::max(ef, count), 0)};
+	if (res.size() > count)
+		res.resize(count);
+
+	return res;
+}
+
+std::vector<HnswIndex::Neighbour>
+HnswIndex::searchLevel(const float* values, const std::vector<Neighbour>& entryPoints, std::size_t ef, Level level) const
+{
+	// searches may run concurrently
+	thread_local VisitedNodes visitedNodes;
+	visitedNodes.reset(getNodeCount());
+
+	std::priority_queue<Neighbour, std::vector<Neighbour>, CloserFirst> candidates;
+	std::priority_queue<Neighbour, std::vector<Neighbour>, FurtherFirst> results;
+
+	for (const Neighbour& entryPoint : entryPoints)
+	{
+		visitedNodes.visit(entryPoint.node);
+		candidates.push(entryPoint);
+		results.push(entryPoint);
+		if (results.size() > ef)
+			results.pop();
+	}
+
+	while (!candidates.empty())
+	{
+		const Neighbour candidate {candidates.top()};
+		if (results.size() >= ef && candidate.distance > results.top().distance)
+			break;
+		candidates.pop();
+
+		for (const NodeId neighbour : _links[candidate.node][level])
+		{
+			if (!visitedNodes.visit(neighbour))
+				continue;
+
+			const Distance distance {computeDistance(values, getVector(neighbour))};
+			if (results.size() < ef || distance < results.top().distance)
+			{
+				candidates.push(Neighbour {neighbour, distance});
+				results.push(Neighbour {neighbour, distance});
+				if (results.size() > ef)
+					results.pop();
+			}
+		}
+	}
+
+	std::vector<Neighbour> res(results.size());
+	for (auto it {std::rbegin(res)}; it != std::rend(res); ++it)
+	{
+		*it = results.top();
+		results.pop();
+	}
+
+	return res;
+}
+
+std::vector<HnswIndex::NodeId>
+HnswIndex::selectNeighbours(const std::vector<Neighbour>& candidates, std::size_t count) const
+{
+	// Keep the candidates that are closer to the base than to any already selected neighbour,
+	// so that links go in various directions (candidates are sorted by distance)
+	std::vector<NodeId> res;
+	for (const Neighbour& candidate : candidates)
+	{
+		if (res.size() == count)
+			break;
+
+		const float* candidateVector {getVector(candidate.node)};
+		const bool isDiverse {std::none_of(std::cbegin(res), std::cend(res), [&](NodeId selected)
+		{
+			return computeDistance(candidateVector, getVector(selected)) < candidate.distance;
+		})};
+
+		if (isDiverse)
+			res.push_back(candidate.node);
+	}
+
+	return res;
+}
+
+void
+HnswIndex::shrinkLinks(NodeId node, Level level)
+{
+	std::vector<NodeId>& links {_links[node][level]};
+	const float* nodeVector {getVector(node)};
+
+	std::vector<Neighbour> candidates;
+	candidates.reserve(links.size());
+	for (const NodeId link : links)
+		candidates.push_back(Neighbour {link, computeDistance(nodeVector, getVector(link))});
+
+	std::sort(std::begin(candidates), std::end(candidates), FurtherFirst {});
+	links = selectNeighbours(candidates, getMaxLinkCount(level));
+}
+
+// Layout:
+//  dimCount, maxLinkCount, efConstruction, nodeCount: uint64
+//  entry point: uint32 (noEntryPoint if empty)
+//  weights: float[dimCount]
+//  vectors: float[nodeCount * dimCount]
+//  levels: uint8[nodeCount]
+//  links: for each node, for each level: uint32 count, uint32[count]
+std::vector<std::byte>
+HnswIndex::serialize() const
+{
+	Writer writer;
+
+	writer.write(static_cast<std::uint64_t>(_dimCount));
+	writer.write(static_cast<std::uint64_t>(_params.maxLinkCount));
+	writer.write(static_cast<std::uint64_t>(_params.efConstruction));
+	writer.write(static_cast<std::uint64_t>(getNodeCount()));
+	writer.write(static_cast<std::uint32_t>(_entryPoint ? *_entryPoint : noEntryPoint));
+	writer.write(_weights.data(), _dimCount);
+	for (NodeId node {}; node < getNodeCount(); ++node)
+		writer.write(getVector(node), _dimCount);
+	writer.write(_levels.data(), _levels.size());
+
+	for (const std::vector<std::vector<NodeId>>& nodeLinks : _links)
+	{
+		for (const std::vector<NodeId>& levelLinks : nodeLinks)
+		{
+			writer.write(static_cast<std::uint32_t>(levelLinks.size()));
+			writer.write(levelLinks.data(), levelLinks.size());
+		}
+	}
+
+	return writer.release();
+}
+
+std::optional<HnswIndex>
+HnswIndex::deserialize(const std::byte* data, std::size_t size)
+{
+	Reader reader {data, size};
+
+	std::uint64_t dimCount;
+	std::uint64_t maxLinkCount;
+	std::uint64_t efConstruction;
+	std::uint64_t nodeCount;
+	std::uint32_t entryPoint;
+	if (!reader.read(dimCount) || !reader.read(maxLinkCount) || !reader.read(efConstruction) || !reader.read(nodeCount) || !reader.read(entryPoint))
+		return std::nullopt;
+
+	if (dimCount == 0 || maxLinkCount < 2 || nodeCount >= noEntryPoint
+		|| dimCount > size / sizeof(float)
+		|| (nodeCount > 0 && dimCount > size / sizeof(float) / nodeCount) // would not fit anyway
+		|| (nodeCount == 0) != (entryPoint == noEntryPoint)
+		|| (nodeCount > 0 && entryPoint >= nodeCount))
+		return std::nullopt;
+
+	std::vector<float> weights(dimCount);
+	if (!reader.read(weights.data(), weights.size()))
+		return std::nullopt;
+
+	HnswIndex index {dimCount, weights, Params {maxLinkCount, efConstruction}};
+
+	index._vectors.resize(nodeCount * index._paddedDimCount, 0.f);
+	for (std::size_t node {}; node < nodeCount; ++node)
+	{
+		if (!reader.read(index._vectors.data() + node * index._paddedDimCount, dimCount))
+			return std::nullopt;
+	}
+
+	index._levels.resize(nodeCount);
+	if (!reader.read(index._levels.data(), index._levels.size()))
+		return std::nullopt;
+
+	index._links.resize(nodeCount);
+	for (std::size_t node {}; node < nodeCount; ++node)
+	{
+		if (index._levels[node] > maxLevel)
+			return std::nullopt;
+
+		index._links[node].resize(static_cast<std::size_t>(index._levels[node]) + 1);
+		for (std::size_t level {}; level < index._links[node].size(); ++level)
+		{
+			std::uint32_t linkCount;
+			if (!reader.read(linkCount) || linkCount > index.getMaxLinkCount(static_cast<Level>(level)))
+				return std::nullopt;
+
+			std::vector<NodeId>& links {index._links[node][level]};
+			links.resize(linkCount);
+			if (!reader.read(links.data(), links.size()))
+				return std::nullopt;
+
+			// links must target existing nodes that are present on this level
+			if (std::any_of(std::cbegin(links), std::cend(links), [&](NodeId link) { return link >= nodeCount || index._levels[link] < level; }))
+				return std::nullopt;
+		}
+	}
+
+	if (!reader.isAtEnd())
+		return std::nullopt;
+
+	if (nodeCount > 0)
+		index._entryPoint = entryPoint;
+
+	return index;
+}
+
+} // namespace Recommendation
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace Recommendation {
+
+struct HnswIndexParams
+{
+	std::size_t maxLinkCount {16};		// per node and per level, twice more on level 0
+	std::size_t efConstruction {100};	// candidate list size used to link new nodes
+};
+
+// Approximate nearest neighbour index (Hierarchical Navigable Small World graph)
+// Distance is the weighted square euclidean distance, same as the SOM
+// Nodes cannot be removed: callers have to filter out the nodes they no longer want to be reported
+class HnswIndex
+{
+	public:
+		using NodeId = std::uint32_t;
+		using Distance = float;
+
+		using Params = HnswIndexParams;
+
+		struct Neighbour
+		{
+			NodeId node;
+			Distance distance;
+		};
+
+		HnswIndex(std::size_t dimCount, const std::vector<float>& weights, Params params = {});
+
+		std::size_t getDimCount() const { return _dimCount; }
+		std::size_t getNodeCount() const { return _levels.size(); }
+
+		// 'values' must contain getDimCount() values
+		NodeId add(const float* values);
+
+		// sorted by distance, at most 'count' neighbours
+		std::vector<Neighbour> search(const float* values, std::size_t count, std::size_t ef) const;
+		// the node itself is reported too
+		std::vector<Neighbour> searchNode(NodeId node, std::size_t count, std::size_t ef) const;
+
+		// Serialized form (native byte order)
+		std::vector<std::byte> serialize() const;
+		static std::optional<HnswIndex> deserialize(const std::byte* data, std::size_t size);
+
+	private:
+		using Level = std::uint8_t;
+		static constexpr Level maxLevel {16};
+
+		const float* getVector(NodeId node) const { return &_vectors[static_cast<std::size_t>(node) * _paddedDimCount]; }
+		Distance computeDistance(const float* a, const float* b) const;
+		std::size_t getMaxLinkCount(Level level) const { return level == 0 ? _params.maxLinkCount * 2 : _params.maxLinkCount; }
+		Level pickLevel();
+
+		std::vector<Neighbour> searchPadded(const float* paddedValues, std::size_t count, std::size_t ef) const;
+		std::vector<Neighbour> searchLevel(const float* values, const std::vector<Neighbour>& entryPoints, std::size_t ef, Level level) const;
+		std::vector<NodeId> selectNeighbours(const std::vector<Neighbour>& candidates, std::size_t count) const;
+		void shrinkLinks(NodeId node, Level level);
+
+		std::size_t					_dimCount;
+		std::size_t					_paddedDimCount;
+		Params						_params;
+		std::vector<float>			_weights;	// padded
+		std::vector<float>			_vectors;	// padded, node after node
+		std::vector<Level>			_levels;
+		std::vector<std::vector<std::vector<NodeId>>> _links; // node, level
+		std::optional<NodeId>		_entryPoint;
+		std::mt19937				_levelGenerator {0};
+};
+
+} // namespace Recommendation
@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <unordered_set>
+#include <vector>
+
+#include "som/Network.hpp"
+
+namespace Recommendation {
+
+template <typename IdType>
+struct ObjectPosition
+{
+	IdType id;
+	SOM::Position position;
+
+	bool operator==(const ObjectPosition& other) const { return id == other.id && position == other.position; }
+};
+
+template <typename IdType>
+using ObjectPositionContainer = std::vector<ObjectPosition<IdType>>;
+
+template <typename IdType>
+void
+eraseObjects(ObjectPositionContainer<IdType>& objectPositions, const std::unordered_set<IdType>& ids)
+{
+	if (ids.empty())
+		return;
+
+	objectPositions.erase(std::remove_if(std::begin(objectPositions), std::end(objectPositions), [&](const ObjectPosition<IdType>& objectPosition) { return ids.count(objectPosition.id) > 0; }), std::end(objectPositions));
+}
+
+// Contiguous values owned by an ObjectPositions or an ObjectMatrix
+template <typename T>
+class ObjectRange
+{
+	public:
+		ObjectRange(const T* begin, const T* end) : _begin {begin}, _end {end} {}
+
+		const T* begin() const { return _begin; }
+		const T* end() const { return _end; }
+		std::size_t size() const { return static_cast<std::size_t>(_end - _begin); }
+		bool empty() const { return _begin == _end; }
+
+	private:
+		const T* _begin;
+		const T* _end;
+};
+
+// Positions of each object: sorted ids and the offsets of their positions in a single array
+// Immutable: changes are made on the object positions and the whole index is rebuilt
+template <typename IdType>
+class ObjectPositions
+{
+	public:
+		ObjectPositions() = default;
+		explicit ObjectPositions(ObjectPositionContainer<IdType> objectPositions) // duplicates are ignored
+		{
+			std::sort(std::begin(objectPositions), std::end(objectPositions), [](const ObjectPosition<IdType>& a, const ObjectPosition<IdType>& b)
+			{
+				if (a.id == b.id)
+					return a.position < b.position;
+				return a.id < b.id;
+			});
+			objectPositions.erase(std::unique(std::begin(objectPositions), std::end(objectPositions)), std::end(objectPositions));
+
+			_positions.reserve(objectPositions.size());
+			for (const ObjectPosition<IdType>& objectPosition : objectPositions)
+			{
+				if (_ids.empty() || !(_ids.back() == objectPosition.id))
+				{
+					_ids.push_back(objectPosition.id);
+					_offsets.push_back(static_cast<std::uint32_t>(_positions.size()));
+				}
+				_positions.push_back(objectPosition.position);
+			}
+			_offsets.push_back(static_cast<std::uint32_t>(_positions.size()));
+
+			_ids.shrink_to_fit();
+			_offsets.shrink_to_fit();
+		}
+
+		std::size_t getObjectCount() const { return _ids.size(); }
+		std::size_t getPositionCount() const { return _positions.size(); }
+		std::size_t getMemoryUsage() const { return _ids.capacity() * sizeof(IdType) + _offsets.capacity() * sizeof(std::uint32_t) + _positions.capacity() * sizeof(SOM::Position); }
+
+		// empty if the object is not known
+		ObjectRange<SOM::Position> getPositions(IdType id) const
+		{
+			const auto it {std::lower_bound(std::cbegin(_ids), std::cend(_ids), id)};
+			if (it == std::cend(_ids) || !(*it == id))
+				return {nullptr, nullptr};
+
+			return getPositionsAt(static_cast<std::size_t>(std::distance(std::cbegin(_ids), it)));
+		}
+
+		// func(IdType id, ObjectRange<SOM::Position> positions), by increasing id
+		template <typename Func>
+		void visit(Func func) const
+		{
+			for (std::size_t i {}; i < _ids.size(); ++i)
+				func(_ids[i], getPositionsAt(i));
+		}
+
+	private:
+		ObjectRange<SOM::Position> getPositionsAt(std::size_t index) const
+		{
+			return {_positions.data() + _offsets[index], _positions.data() + _offsets[index + 1]};
+		}
+
+		std::vector<IdType>			_ids;
+		std::vector<std::uint32_t>	_offsets; // _ids.size() + 1 offsets in _positions
+		std::vector<SOM::Position>	_positions;
+};
+
+// Objects at each position of the network: the offsets of each cell in a single array of ids
+// Immutable as well, ids are sorted within each cell
+template <typename IdType>
+class ObjectMatrix
+{
+	public:
+		ObjectMatrix() = default;
+		ObjectMatrix(SOM::Coordinate width, SOM::Coordinate height, const ObjectPositionContainer<IdType>& objectPositions) // duplicates are ignored
+		: _width {width}
+		, _height {height}
+		, _offsets(static_cast<std::size_t>(width) * height + 1)
+		{
+			// count then place the ids of each cell
+			for (const ObjectPosition<IdType>& objectPosition : objectPositions)
+				_offsets[getCellIndex(objectPosition.position) + 1]++;
+			for (std::size_t i {1}; i < _offsets.size(); ++i)
+				_offsets[i] += _offsets[i - 1];
+
+			_ids.resize(objectPositions.size());
+			std::vector<std::uint32_t> cellSizes(_offsets.size() - 1);
+			for (const ObjectPosition<IdType>& objectPosition : objectPositions)
+			{
+				const std::size_t cellIndex {getCellIndex(objectPosition.position)};
+				_ids[_offsets[cellIndex] + cellSizes[cellIndex]++] = objectPosition.id;
+			}
+
+			// sort and remove duplicates in each cell, then compact
+			std::size_t writeOffset {};
+			for (std::size_t cellIndex {}; cellIndex + 1 < _offsets.size(); ++cellIndex)
+			{
+				const auto itBegin {std::begin(_ids) + _offsets[cellIndex]};
+				const auto itEnd {std::begin(_ids) + _offsets[cellIndex + 1]};
+				std::sort(itBegin, itEnd);
+				const auto itUniqueEnd {std::unique(itBegin, itEnd)};
+
+				const auto uniqueCount {static_cast<std::size_t>(std::distance(itBegin, itUniqueEnd))};
+				if (writeOffset != _offsets[cellIndex])
+					std::move(itBegin, itUniqueEnd, std::begin(_ids) + writeOffset);
+
+				_offsets[cellIndex] = static_cast<std::uint32_t>(writeOffset);
+				writeOffset += uniqueCount;
+			}
+			_offsets.back() = static_cast<std::uint32_t>(writeOffset);
+			_ids.resize(writeOffset);
+			_ids.shrink_to_fit();
+		}
+
+		SOM::Coordinate getWidth() const { return _width; }
+		SOM::Coordinate getHeight() const { return _height; }
+		std::size_t getMemoryUsage() const { return _ids.capacity() * sizeof(IdType) + _offsets.capacity() * sizeof(std::uint32_t); }
+
+		ObjectRange<IdType> get(const SOM::Position& position) const
+		{
+			const std::size_t cellIndex {getCellIndex(position)};
+			return {_ids.data() + _offsets[cellIndex], _ids.data() + _offsets[cellIndex + 1]};
+		}
+
+		ObjectPositionContainer<IdType> getObjectPositions() const
+		{
+			ObjectPositionContainer<IdType> res;
+			res.reserve(_ids.size());
+
+			for (SOM::Coordinate y {}; y < _height; ++y)
+			{
+				for (SOM::Coordinate x {}; x < _width; ++x)
+				{
+					for (const IdType id : get({x, y}))
+						res.push_back({id, {x, y}});
+				}
+			}
+
+			return res;
+		}
+
+	private:
+		std::size_t getCellIndex(const SOM::Position& position) const
+		{
+			assert(position.x < _width);
+			assert(position.y < _height);
+			return position.x + static_cast<std::size_t>(_width) * position.y;
+		}
+
+		SOM::Coordinate				_width {};
+		SOM::Coordinate				_height {};
+		std::vector<std::uint32_t>	_offsets {0}; // width * height + 1 offsets in _ids
+		std::vector<IdType>			_ids;
+};
+
+} // ns Recommendation
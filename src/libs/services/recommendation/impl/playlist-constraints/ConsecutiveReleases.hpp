@@ -1,46 +1,12 @@
-/*
- * Copyright (C) 2022 Emeric Poupon
- *
- * This file is part of LMS.
- *
- * LMS is free software: you can redistribute it and/or modify
- * it under the terms of the GNU General Public License as published by
- * the Free Software Foundation, either version 3 of the License, or
- * (at your option) any later version.
- *
- * LMS is distributed in the hope that it will be useful,
- * but WITHOUT ANY WARRANTY; without even the implied warranty of
- * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
- * GNU General Public License for more details.
- *
- * You should have received a copy of the GNU General Public License
- * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
- */
-
 #pragma once
 
 #include "IConstraint.hpp"
 
-#include "services/database/ReleaseId.hpp"
-
-namespace Database
-{
-	class Db;
-}
-
 namespace Recommendation::PlaylistGeneratorConstraint
 {
 	class ConsecutiveReleases : public IConstraint
 	{
-		public:
-			ConsecutiveReleases(Database::Db& db);
-
 		private:
-			 float computeScore(const std::vector<Database::TrackId>& trackIds, std::size_t trackIndex) override;
-
-			 Database::ReleaseId getReleaseId(Database::TrackId trackId);
-
-			 Database::Db& _db;
+			 float computeScore(const TrackContainer& playlist, Database::TrackId trackId, const TrackInfos& trackInfos) const override;
 	};
 } // namespace Recommendation
-
@@ -19,21 +19,33 @@
 
 #pragma once
 
+#include <unordered_map>
 #include <vector>
 
+#include "services/database/ReleaseId.hpp"
+#include "services/database/TrackId.hpp"
 #include "services/recommendation/Types.hpp"
 
 namespace Recommendation::PlaylistGeneratorConstraint
 {
+	// Compact infos about the tracks involved in a playlist generation, fetched in bulk beforehand
+	struct TrackInfo
+	{
+		Database::ReleaseId releaseId;	// invalid if no release
+		ArtistContainer artistIds;		// sorted
+		std::size_t playlistCount {};	// occurrences in the playlist, updated as tracks are appended
+	};
+	using TrackInfos = std::unordered_map<Database::TrackId, TrackInfo>;
+
 	class IConstraint
 	{
 		public:
 			virtual ~IConstraint() = default;
 
-			// compute the score of the track at index trackIndex
+			// compute the score of appending trackId to the playlist
 			// 0: best
 			// 1: worst
 			// > 1 : violation
-			virtual float computeScore(const TrackContainer& trackIds, std::size_t trackIndex) = 0;
+			virtual float computeScore(const TrackContainer& playlist, Database::TrackId trackId, const TrackInfos& trackInfos) const = 0;
 	};
 } // namespace Recommendation
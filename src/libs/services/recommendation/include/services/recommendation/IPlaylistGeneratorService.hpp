@@ -38,6 +38,7 @@ namespace Recommendation
 			virtual ~IPlaylistGeneratorService() = default;
 
 			// extend an existing playlist with similar tracks (but use playlist contraints)
+			// successive extensions of the same playlist reuse the similar tracks computed the first time, and never return the same track twice
 			virtual TrackContainer extendPlaylist(Database::TrackListId tracklistId, std::size_t maxCount) const = 0;
 	};
 
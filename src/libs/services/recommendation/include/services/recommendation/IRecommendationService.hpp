@@ -20,6 +20,7 @@
 #pragma once
 
 #include <memory>
+#include <optional>
 #include <vector>
 #include "utils/EnumSet.hpp"
 #include "services/database/TrackListId.hpp"
@@ -38,6 +39,7 @@ namespace Recommendation
 		public:
 			virtual ~IRecommendationService() = default;
 
+			// Queries return empty results until the first load is done
 			virtual void load() = 0;
 
 			virtual TrackContainer findSimilarTracks(Database::TrackListId tracklistId, std::size_t maxCount) const = 0;
@@ -46,6 +48,15 @@ namespace Recommendation
 			virtual ArtistContainer getSimilarArtists(Database::ArtistId artistId, EnumSet<Database::TrackArtistLinkType> linkTypes, std::size_t maxCount) const = 0;
 	};
 
+	enum class EngineType
+	{
+		Clusters,
+		Features,
+	};
+
+	// The returned service is not loaded
 	std::unique_ptr<IRecommendationService> createRecommendationService(Database::Db& db);
+	// Always use the given engine, whatever the similarity engine set in the scan settings (for tooling)
+	std::unique_ptr<IRecommendationService> createRecommendationService(Database::Db& db, EngineType engineType);
 } // ns Recommendation
 
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ContentFingerprint.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+
+namespace Scanner
+{
+    namespace
+    {
+        constexpr std::size_t regionSize{ 16 * 1024 };
+
+        // FNV-1a
+        class Hasher
+        {
+        public:
+            void update(const char* data, std::size_t size)
+            {
+                for (std::size_t i{}; i < size; ++i)
+                {
+                    _hash ^= static_cast<unsigned char>(data[i]);
+                    _hash *= 0x100000001B3;
+                }
+            }
+
+            void update(std::uint64_t value)
+            {
+                for (std::size_t i{}; i < sizeof(value); ++i)
+                {
+                    const char byte{ static_cast<char>((value >> (i * 8)) & 0xFF) };
+                    update(&byte, 1);
+                }
+            }
+
+            std::uint64_t getHash() const { return _hash; }
+
+        private:
+            std::uint64_t _hash{ 0xCBF29CE484222325 };
+        };
+    }
+
+    std::uint64_t computeContentFingerprint(const std::filesystem::path& file, std::uintmax_t fileSize)
+    {
+        std::ifstream ifs{ file, std::ios_base::binary };
+        if (!ifs)
+            return 0;
+
+        Hasher hasher;
+        hasher.update(static_cast<std::uint64_t>(fileSize));
+
+        // small files are entirely hashed
+        const std::array<std::uintmax_t, 3> regionOffsets{ 0, fileSize / 2 - std::min<std::uintmax_t>(fileSize / 2, regionSize / 2), fileSize - std::min<std::uintmax_t>(fileSize, regionSize) };
+
+        std::array<char, regionSize> buffer;
+        std::uintmax_t hashedEnd{};
+        for (std::uintmax_t offset : regionOffsets)
+        {
+            // do not hash the same bytes twice
+            offset = std::max(offset, hashedEnd);
+            const std::uintmax_t size{ std::min<std::uintmax_t>(regionSize, fileSize - offset) };
+            if (size == 0)
+                continue;
+
+            ifs.seekg(static_cast<std::streamoff>(offset));
+            ifs.read(buffer.data(), static_cast<std::streamsize>(size));
+            if (static_cast<std::uintmax_t>(ifs.gcount()) != size)
+                return 0;
+
+            hasher.update(buffer.data(), size);
+            hashedEnd = offset + size;
+        }
+
+        // 0 is reserved for unknown fingerprints
+        return hasher.getHash() ? hasher.getHash() : 1;
+    }
+} // namespace Scanner
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+namespace Scanner
+{
+    // Cheap fingerprint of a file content: size along with a hash of regions sampled at the head, in the middle and at the tail
+    // Identifies a file that has been moved or renamed without having to parse it
+    // Returns 0 if the file cannot be read
+    std::uint64_t computeContentFingerprint(const std::filesystem::path& file, std::uintmax_t fileSize);
+} // namespace Scanner
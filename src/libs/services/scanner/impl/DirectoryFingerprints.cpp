@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DirectoryFingerprints.hpp"
+
+#include <Wt/WDateTime.h>
+
+#include "services/database/DirectoryFingerprint.hpp"
+#include "services/database/Session.hpp"
+#include "utils/Logger.hpp"
+
+namespace Scanner
+{
+    void DirectoryFingerprints::load(Database::Session& session)
+    {
+        clear();
+
+        auto transaction{ session.createSharedTransaction() };
+
+        Database::DirectoryFingerprint::find(session, [&](const Database::DirectoryFingerprint::FindResult& result)
+            {
+                _previousFingerprints.emplace(result.directory.string(), Fingerprint{ result.lastWriteTime.toTime_t(), result.entryCount, result.scanVersion });
+            });
+
+        LMS_LOG(DBUPDATER, DEBUG) << "Loaded " << _previousFingerprints.size() << " directory fingerprints";
+    }
+
+    void DirectoryFingerprints::clear()
+    {
+        _previousFingerprints.clear();
+        _currentFingerprints.clear();
+    }
+
+    bool DirectoryFingerprints::update(const std::filesystem::path& directory, const Fingerprint& fingerprint)
+    {
+        _currentFingerprints[directory.string()] = fingerprint;
+
+        const auto itPrevious{ _previousFingerprints.find(directory.string()) };
+        return itPrevious != std::cend(_previousFingerprints) && itPrevious->second == fingerprint;
+    }
+
+    void DirectoryFingerprints::save(Database::Session& session, bool removeUnseenDirectories)
+    {
+        std::size_t updateCount{};
+        std::size_t removeCount{};
+
+        auto transaction{ session.createUniqueTransaction() };
+
+        for (const auto& [directory, fingerprint] : _currentFingerprints)
+        {
+            const auto itPrevious{ _previousFingerprints.find(directory) };
+            if (itPrevious != std::cend(_previousFingerprints) && itPrevious->second == fingerprint)
+                continue;
+
+            Database::DirectoryFingerprint::pointer dbFingerprint;
+            if (itPrevious != std::cend(_previousFingerprints))
+                dbFingerprint = Database::DirectoryFingerprint::find(session, directory);
+            if (!dbFingerprint)
+                dbFingerprint = session.create<Database::DirectoryFingerprint>(directory);
+
+            dbFingerprint.modify()->setLastWriteTime(Wt::WDateTime::fromTime_t(fingerprint.lastWriteTime));
+            dbFingerprint.modify()->setEntryCount(fingerprint.entryCount);
+            dbFingerprint.modify()->setScanVersion(fingerprint.scanVersion);
+            updateCount++;
+        }
+
+        if (removeUnseenDirectories)
+        {
+            for (const auto& [directory, fingerprint] : _previousFingerprints)
+            {
+                if (_currentFingerprints.find(directory) != std::cend(_currentFingerprints))
+                    continue;
+
+                if (Database::DirectoryFingerprint::pointer dbFingerprint{ Database::DirectoryFingerprint::find(session, directory) })
+                {
+                    dbFingerprint.remove();
+                    removeCount++;
+                }
+            }
+        }
+
+        LMS_LOG(DBUPDATER, DEBUG) << "Directory fingerprints: " << updateCount << " updated, " << removeCount << " removed";
+    }
+} // namespace Scanner
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <ctime>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+
+namespace Database
+{
+    class Session;
+}
+
+namespace Scanner
+{
+    // Tracks the state of the scanned directories, in order to detect the ones that did not change since the last scan
+    class DirectoryFingerprints
+    {
+    public:
+        struct Fingerprint
+        {
+            std::time_t		lastWriteTime;
+            std::size_t		entryCount;
+            std::size_t		scanVersion;
+
+            bool operator==(const Fingerprint& other) const { return lastWriteTime == other.lastWriteTime && entryCount == other.entryCount && scanVersion == other.scanVersion; }
+            bool operator!=(const Fingerprint& other) const { return !(*this == other); }
+        };
+
+        void load(Database::Session& session);
+        void clear();
+
+        // Records the current fingerprint of the directory, returns true if it did not change since the last scan
+        bool update(const std::filesystem::path& directory, const Fingerprint& fingerprint);
+
+        // Persists the recorded fingerprints, and removes the ones of the directories that were not seen if requested
+        void save(Database::Session& session, bool removeUnseenDirectories);
+
+    private:
+        std::unordered_map<std::string, Fingerprint>	_previousFingerprints;
+        std::unordered_map<std::string, Fingerprint>	_currentFingerprints;
+    };
+} // namespace Scanner
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DiscoveredFiles.hpp"
+
+#include <algorithm>
+
+namespace Scanner
+{
+    namespace
+    {
+        bool compareFiles(const DiscoveredFiles::File& lhs, const DiscoveredFiles::File& rhs)
+        {
+            if (lhs.directoryIndex != rhs.directoryIndex)
+                return lhs.directoryIndex < rhs.directoryIndex;
+
+            return lhs.fileName < rhs.fileName;
+        }
+    }
+
+    void DiscoveredFiles::clear()
+    {
+        _directories.clear();
+        _directoryIndexes.clear();
+        _files.clear();
+        _unexploredPaths.clear();
+    }
+
+    void DiscoveredFiles::add(const std::filesystem::path& file, std::time_t lastWriteTime, std::uintmax_t size, std::uint64_t device, std::uint64_t inode)
+    {
+        std::filesystem::path directory{ file.parent_path() };
+
+        std::size_t directoryIndex;
+        if (!_directories.empty() && _directories.back() == directory)
+        {
+            directoryIndex = _directories.size() - 1;
+        }
+        else
+        {
+            auto [it, inserted]{ _directoryIndexes.emplace(directory.string(), _directories.size()) };
+            if (inserted)
+                _directories.emplace_back(std::move(directory));
+
+            directoryIndex = it->second;
+        }
+
+        _files.emplace_back(File{ directoryIndex, file.filename().string(), lastWriteTime, size, device, inode });
+    }
+
+    void DiscoveredFiles::addUnexploredPath(const std::filesystem::path& path)
+    {
+        _unexploredPaths.push_back(path);
+    }
+
+    bool DiscoveredFiles::isInUnexploredPath(const std::filesystem::path& file) const
+    {
+        return std::any_of(std::cbegin(_unexploredPaths), std::cend(_unexploredPaths), [&](const std::filesystem::path& unexploredPath)
+            {
+                return std::mismatch(std::cbegin(unexploredPath), std::cend(unexploredPath), std::cbegin(file), std::cend(file)).first == std::cend(unexploredPath);
+            });
+    }
+
+    void DiscoveredFiles::finalize()
+    {
+        // directories are indexed in exploration order: keep all the files of a same directory together
+        std::sort(std::begin(_files), std::end(_files), compareFiles);
+
+        _files.shrink_to_fit();
+    }
+
+    bool DiscoveredFiles::contains(const std::filesystem::path& file) const
+    {
+        const auto itDirectory{ _directoryIndexes.find(file.parent_path().string()) };
+        if (itDirectory == std::cend(_directoryIndexes))
+            return false;
+
+        const File key{ itDirectory->second, file.filename().string(), 0, 0, 0, 0 };
+        return std::binary_search(std::cbegin(_files), std::cend(_files), key, compareFiles);
+    }
+} // namespace Scanner
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Scanner
+{
+    // Compact list of the files found in the media directory
+    // Files are stored by directory in order to favor locality when processing them
+    class DiscoveredFiles
+    {
+    public:
+        struct File
+        {
+            std::size_t		directoryIndex;
+            std::string		fileName;
+            std::time_t		lastWriteTime;
+            std::uintmax_t	size; // 0 if not known (directory unchanged since last scan)
+            std::uint64_t	device;
+            std::uint64_t	inode; // 0 if not known, like size
+        };
+
+        void clear();
+        void add(const std::filesystem::path& file, std::time_t lastWriteTime, std::uintmax_t size, std::uint64_t device, std::uint64_t inode);
+
+        // Paths that could not be explored entirely: they may contain existing files that were not discovered
+        void addUnexploredPath(const std::filesystem::path& path);
+        bool isInUnexploredPath(const std::filesystem::path& file) const;
+
+        // Must be called once all the files are added
+        void finalize();
+
+        // Only valid once finalized
+        bool contains(const std::filesystem::path& file) const;
+
+        std::size_t size() const { return _files.size(); }
+        bool empty() const { return _files.empty(); }
+
+        const std::vector<File>& getFiles() const { return _files; }
+        std::filesystem::path getPath(const File& file) const { return _directories[file.directoryIndex] / file.fileName; }
+
+    private:
+        std::vector<std::filesystem::path>			_directories;
+        std::unordered_map<std::string, std::size_t>	_directoryIndexes;
+        std::vector<File>							_files;
+        std::vector<std::filesystem::path>			_unexploredPaths;
+    };
+} // namespace Scanner
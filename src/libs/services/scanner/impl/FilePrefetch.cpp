@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FilePrefetch.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Scanner
+{
+    namespace
+    {
+        // tags are at the beginning (ID3v2, Vorbis comments, MP4 atoms) or at the end of the files (ID3v1, APE)
+        constexpr off_t prefetchSize{ 256 * 1024 };
+    }
+
+    void prefetchFile(const std::filesystem::path& file)
+    {
+#if defined(POSIX_FADV_WILLNEED)
+        const int fd{ ::open(file.c_str(), O_RDONLY | O_CLOEXEC) };
+        if (fd < 0)
+            return;
+
+        struct stat sb {};
+        if (::fstat(fd, &sb) == 0)
+        {
+            if (sb.st_size <= 2 * prefetchSize)
+            {
+                ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+            }
+            else
+            {
+                ::posix_fadvise(fd, 0, prefetchSize, POSIX_FADV_WILLNEED);
+                ::posix_fadvise(fd, sb.st_size - prefetchSize, prefetchSize, POSIX_FADV_WILLNEED);
+            }
+        }
+
+        // the readahead goes on once the file is closed
+        ::close(fd);
+#else
+        (void)file;
+#endif
+    }
+} // namespace Scanner
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FileScanQueue.hpp"
+
+#include <boost/asio/post.hpp>
+
+#include "utils/Exception.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Path.hpp"
+#include "ContentFingerprint.hpp"
+#include "FilePrefetch.hpp"
+
+namespace Scanner
+{
+    FileScanQueue::FileScanQueue(MetaData::IParser& parser, std::size_t threadCount, bool useMetadataCache, const ReadParameters& readParameters, ScanThrottle& throttle, bool& abort, std::function<void()> threadInit)
+        : _parser{ parser }
+        , _useMetadataCache{ useMetadataCache }
+        , _readParameters{ readParameters }
+        , _throttle{ throttle }
+        , _abort{ abort }
+        , _ioContextRunner{ _ioContext, threadCount, std::move(threadInit) }
+    {
+        LMS_LOG(DBUPDATER, DEBUG) << "Using " << threadCount << " threads to parse files";
+        if (_readParameters.maxReadsPerDevice > 0)
+            LMS_LOG(DBUPDATER, DEBUG) << "Parsing at most " << _readParameters.maxReadsPerDevice << " files per device at the same time";
+    }
+
+    FileScanQueue::~FileScanQueue()
+    {
+        wait();
+    }
+
+    void FileScanQueue::pushScanRequest(const std::filesystem::path& file, const Wt::WDateTime& lastWriteTime, std::uintmax_t fileSize, std::optional<std::uint64_t> device)
+    {
+        {
+            std::scoped_lock lock{ _mutex };
+            _ongoingScanCount++;
+        }
+
+        // read while the previous requests are being parsed
+        if (_readParameters.prefetch)
+            prefetchFile(file);
+
+        if (_readParameters.maxReadsPerDevice > 0 && !device)
+        {
+            try
+            {
+                device = PathUtils::getFileInfo(file).device;
+            }
+            catch (const LmsException&)
+            {
+                // will fail to parse anyway
+            }
+        }
+
+        boost::asio::post(_ioContext, [this, file, lastWriteTime, fileSize, device]
+            {
+                std::optional<MetaData::Track> trackMetaData;
+                std::uintmax_t actualFileSize{ fileSize };
+                std::uint64_t contentFingerprint{};
+                std::vector<unsigned char> metadataCacheData;
+                std::chrono::microseconds parseDuration{};
+
+                _throttle.throttle(_abort);
+
+                const bool limitDeviceReads{ _readParameters.maxReadsPerDevice > 0 && device };
+                if (limitDeviceReads)
+                    acquireDeviceRead(*device);
+
+                if (!_abort)
+                {
+                    const auto parseStartTime{ std::chrono::steady_clock::now() };
+                    trackMetaData = _useMetadataCache ? _parser.parseAndCache(file, metadataCacheData) : _parser.parse(file);
+
+                    if (actualFileSize == 0)
+                    {
+                        std::error_code ec;
+                        actualFileSize = std::filesystem::file_size(file, ec);
+                        if (ec)
+                            actualFileSize = 0;
+                    }
+                    if (trackMetaData && actualFileSize != 0)
+                        contentFingerprint = computeContentFingerprint(file, actualFileSize); // head and tail are usually still cached by the parse
+                    parseDuration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - parseStartTime);
+                }
+
+                if (limitDeviceReads)
+                    releaseDeviceRead(*device);
+
+                {
+                    std::scoped_lock lock{ _mutex };
+
+                    if (!_abort)
+                        _scanResults.emplace_back(ScanResult{ file, lastWriteTime, actualFileSize, contentFingerprint, std::move(trackMetaData), parseDuration, std::move(metadataCacheData), false });
+                    _ongoingScanCount--;
+                }
+                _condVar.notify_all();
+            });
+    }
+
+    void FileScanQueue::pushScanResult(ScanResult&& result)
+    {
+        std::scoped_lock lock{ _mutex };
+        _scanResults.emplace_back(std::move(result));
+    }
+
+    std::size_t FileScanQueue::getResultsCount() const
+    {
+        std::scoped_lock lock{ _mutex };
+        return _scanResults.size();
+    }
+
+    std::optional<FileScanQueue::ScanResult> FileScanQueue::popResult()
+    {
+        std::optional<ScanResult> res;
+
+        std::scoped_lock lock{ _mutex };
+        if (!_scanResults.empty())
+        {
+            res = std::move(_scanResults.front());
+            _scanResults.pop_front();
+        }
+
+        return res;
+    }
+
+    void FileScanQueue::wait(std::size_t maxOngoingScanCount)
+    {
+        std::unique_lock lock{ _mutex };
+        _condVar.wait(lock, [=] { return _ongoingScanCount <= maxOngoingScanCount; });
+    }
+
+    void FileScanQueue::acquireDeviceRead(std::uint64_t device)
+    {
+        std::unique_lock lock{ _deviceReadMutex };
+        _deviceReadCondVar.wait(lock, [&] { return _deviceReadCounts[device] < _readParameters.maxReadsPerDevice; });
+        _deviceReadCounts[device]++;
+    }
+
+    void FileScanQueue::releaseDeviceRead(std::uint64_t device)
+    {
+        {
+            std::scoped_lock lock{ _deviceReadMutex };
+            _deviceReadCounts[device]--;
+        }
+        _deviceReadCondVar.notify_all();
+    }
+} // namespace Scanner
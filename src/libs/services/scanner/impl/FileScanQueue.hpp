@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <Wt/WDateTime.h>
+
+#include "metadata/IParser.hpp"
+#include "utils/IOContextRunner.hpp"
+#include "ScanThrottle.hpp"
+
+namespace Scanner
+{
+    // Parses files using a pool of worker threads
+    // Results are meant to be consumed by a single thread (the one that writes into the database)
+    class FileScanQueue
+    {
+    public:
+        // Meant for rotational disks, where concurrent reads make the heads seek
+        struct ReadParameters
+        {
+            bool		prefetch{};				// start reading the files as soon as they are queued
+            std::size_t	maxReadsPerDevice{};	// files of a same device parsed at the same time, 0 means unlimited
+        };
+
+        // parser must be reentrant
+        // if useMetadataCache is set, results come with the data to be stored in the metadata cache
+        // threadInit is run first on each worker thread
+        FileScanQueue(MetaData::IParser& parser, std::size_t threadCount, bool useMetadataCache, const ReadParameters& readParameters, ScanThrottle& throttle, bool& abort, std::function<void()> threadInit = {});
+        ~FileScanQueue();
+
+        FileScanQueue(const FileScanQueue&) = delete;
+        FileScanQueue& operator=(const FileScanQueue&) = delete;
+
+        struct ScanResult
+        {
+            std::filesystem::path			file;
+            Wt::WDateTime					lastWriteTime;
+            std::uintmax_t					fileSize{}; // 0 if unknown
+            std::uint64_t					contentFingerprint{}; // 0 if unknown
+            std::optional<MetaData::Track>	trackMetaData; // empty if parse failed
+            std::chrono::microseconds		parseDuration{};
+            std::vector<unsigned char>		metadataCacheData; // empty if none
+            bool							fromMetadataCache{};
+        };
+
+        // fileSize may be 0 if not known yet
+        void pushScanRequest(const std::filesystem::path& file, const Wt::WDateTime& lastWriteTime, std::uintmax_t fileSize, std::optional<std::uint64_t> device);
+        // for files that do not need to be parsed
+        void pushScanResult(ScanResult&& result);
+
+        std::size_t getResultsCount() const;
+        std::optional<ScanResult> popResult();
+
+        // Wait until no more than maxOngoingScanCount requests are being parsed
+        void wait(std::size_t maxOngoingScanCount = 0);
+
+    private:
+        void acquireDeviceRead(std::uint64_t device);
+        void releaseDeviceRead(std::uint64_t device);
+
+        MetaData::IParser&			_parser;
+        const bool					_useMetadataCache;
+        const ReadParameters		_readParameters;
+        ScanThrottle&				_throttle;
+        bool&						_abort;
+
+        std::mutex									_deviceReadMutex;
+        std::condition_variable						_deviceReadCondVar;
+        std::unordered_map<std::uint64_t, std::size_t>	_deviceReadCounts; // ongoing reads per device
+
+        mutable std::mutex			_mutex;
+        std::condition_variable		_condVar;
+        std::size_t					_ongoingScanCount{};
+        std::deque<ScanResult>		_scanResults;
+
+        // must be last to make sure worker threads are joined first
+        boost::asio::io_context		_ioContext;
+        IOContextRunner				_ioContextRunner;
+    };
+} // namespace Scanner
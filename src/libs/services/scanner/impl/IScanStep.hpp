@@ -19,9 +19,20 @@
 
 #pragma once
 
+#include <algorithm>
+#include <filesystem>
+#include <optional>
 #include <string_view>
+#include <unordered_set>
+#include <vector>
 
+#include "services/database/ClusterId.hpp"
+#include "services/database/ReleaseId.hpp"
 #include "services/scanner/ScannerStats.hpp"
+#include "DirectoryFingerprints.hpp"
+#include "DiscoveredFiles.hpp"
+#include "ScanCheckpoint.hpp"
+#include "TrackFileInfos.hpp"
 
 namespace Scanner
 {
@@ -37,8 +48,30 @@ namespace Scanner
 			{
 				const std::filesystem::path directory;
 				const bool forceScan;
+				const std::vector<std::filesystem::path> scopedPaths; // if not empty, only files within these paths are processed
 				ScanStats stats;
 				ScanStepStats currentStepStats;
+				DiscoveredFiles discoveredFiles; // filled by the discovery step
+				TrackFileInfos trackFileInfos; // loaded by the discovery step, unless scan is forced
+				DirectoryFingerprints directoryFingerprints; // filled by the discovery step, if unchanged directories are skipped
+				// partial scans: entities of the tracks in scope, before and after the scan, so that only their stats are computed again
+				std::unordered_set<Database::ReleaseId> scopedReleaseIds;
+				std::unordered_set<Database::ClusterId> scopedClusterIds;
+				// full scans: progress saved in checkpointFile, so that the scan can be resumed if interrupted
+				std::optional<ScanCheckpoint> checkpoint;
+				std::filesystem::path checkpointFile;
+
+				bool isPartialScan() const { return !scopedPaths.empty(); }
+				bool isPathInScope(const std::filesystem::path& path) const
+				{
+					if (scopedPaths.empty())
+						return true;
+
+					return std::any_of(std::cbegin(scopedPaths), std::cend(scopedPaths), [&](const std::filesystem::path& scopedPath)
+					{
+						return std::mismatch(std::cbegin(scopedPath), std::cend(scopedPath), std::cbegin(path), std::cend(path)).first == std::cend(scopedPath);
+					});
+				}
 			};
 			virtual void process(ScanContext& context) = 0;
 	};
@@ -0,0 +1,321 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MediaDirectoryWatcher.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+
+#include "utils/Logger.hpp"
+
+namespace Scanner
+{
+    namespace
+    {
+        constexpr std::uint32_t watchMask{ IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR };
+
+        // Network and userspace filesystems do not report changes made by other hosts or processes
+        bool isFileSystemWatchable(const std::filesystem::path& directory)
+        {
+            struct statfs sb {};
+            if (::statfs(directory.c_str(), &sb) == -1)
+                return false;
+
+            switch (static_cast<unsigned long>(sb.f_type))
+            {
+            case 0x6969:		// NFS
+            case 0x517B:		// SMB
+            case 0xFF534D42:	// CIFS
+            case 0xFE534D42:	// SMB2
+            case 0x65735546:	// FUSE
+            case 0x01021997:	// 9P
+                return false;
+            default:
+                return true;
+            }
+        }
+
+        bool isPathInDirectory(const std::filesystem::path& path, const std::filesystem::path& directory)
+        {
+            return std::mismatch(std::cbegin(directory), std::cend(directory), std::cbegin(path), std::cend(path)).first == std::cend(directory);
+        }
+    }
+
+    MediaDirectoryWatcher::MediaDirectoryWatcher(ChangesCallback callback, std::chrono::seconds debounceDelay)
+        : _callback{ std::move(callback) }
+        , _debounceDelay{ debounceDelay }
+    {
+    }
+
+    MediaDirectoryWatcher::~MediaDirectoryWatcher()
+    {
+        stop();
+    }
+
+    bool MediaDirectoryWatcher::start(const std::filesystem::path& directory, const std::filesystem::path& excludeDirFileName)
+    {
+        stop();
+
+        if (!isFileSystemWatchable(directory))
+        {
+            LMS_LOG(DBUPDATER, WARNING) << "Filesystem of '" << directory.string() << "' does not report changes: relying on scheduled scans only";
+            return false;
+        }
+
+        _inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (_inotifyFd == -1)
+        {
+            LMS_LOG(DBUPDATER, ERROR) << "Cannot init inotify: " << ::strerror(errno);
+            return false;
+        }
+
+        _stopFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (_stopFd == -1)
+        {
+            LMS_LOG(DBUPDATER, ERROR) << "Cannot create eventfd: " << ::strerror(errno);
+            closeFds();
+            return false;
+        }
+
+        _directory = directory;
+        _excludeDirFileName = excludeDirFileName;
+        _watchLimitReached = false;
+
+        if (!addWatches(_directory) || _watchLimitReached)
+        {
+            LMS_LOG(DBUPDATER, WARNING) << "Cannot watch all the directories in '" << _directory.string() << "' (see fs.inotify.max_user_watches): relying on scheduled scans only";
+            closeFds();
+            _watches.clear();
+            return false;
+        }
+
+        LMS_LOG(DBUPDATER, INFO) << "Watching " << _watches.size() << " directories in '" << _directory.string() << "'";
+        _thread = std::thread{ [this] { run(); } };
+
+        return true;
+    }
+
+    void MediaDirectoryWatcher::stop()
+    {
+        if (_thread.joinable())
+        {
+            const std::uint64_t value{ 1 };
+            if (::write(_stopFd, &value, sizeof(value)) != sizeof(value))
+                LMS_LOG(DBUPDATER, ERROR) << "Cannot notify watcher thread: " << ::strerror(errno);
+
+            _thread.join();
+        }
+
+        closeFds();
+        _watches.clear();
+        _pendingChanges.clear();
+    }
+
+    void MediaDirectoryWatcher::closeFds()
+    {
+        if (_inotifyFd != -1)
+        {
+            ::close(_inotifyFd);
+            _inotifyFd = -1;
+        }
+
+        if (_stopFd != -1)
+        {
+            ::close(_stopFd);
+            _stopFd = -1;
+        }
+    }
+
+    void MediaDirectoryWatcher::run()
+    {
+        std::array<pollfd, 2> fds{ { { _inotifyFd, POLLIN, 0 }, { _stopFd, POLLIN, 0 } } };
+
+        while (true)
+        {
+            int timeout{ -1 };
+            if (!_pendingChanges.empty())
+            {
+                const auto elapsed{ std::chrono::steady_clock::now() - _lastChangeTime };
+                timeout = elapsed >= _debounceDelay ? 0 : std::chrono::duration_cast<std::chrono::milliseconds>(_debounceDelay - elapsed).count() + 1;
+            }
+
+            if (::poll(fds.data(), fds.size(), timeout) == -1)
+            {
+                if (errno == EINTR)
+                    continue;
+
+                LMS_LOG(DBUPDATER, ERROR) << "Cannot poll inotify events: " << ::strerror(errno);
+                break;
+            }
+
+            if (fds[1].revents & POLLIN)
+                break;
+
+            if (fds[0].revents & POLLIN)
+                processEvents();
+
+            if (!_pendingChanges.empty() && (std::chrono::steady_clock::now() - _lastChangeTime) >= _debounceDelay)
+                flushChanges();
+        }
+    }
+
+    void MediaDirectoryWatcher::processEvents()
+    {
+        alignas(inotify_event) std::array<char, 64 * 1024> buffer;
+
+        while (true)
+        {
+            const ssize_t length{ ::read(_inotifyFd, buffer.data(), buffer.size()) };
+            if (length <= 0)
+                break; // EAGAIN: no more events to read
+
+            for (const char* ptr{ buffer.data() }; ptr < buffer.data() + length; )
+            {
+                const inotify_event* event{ reinterpret_cast<const inotify_event*>(ptr) };
+                ptr += sizeof(inotify_event) + event->len;
+
+                if (event->mask & IN_Q_OVERFLOW)
+                {
+                    LMS_LOG(DBUPDATER, WARNING) << "Too many changes to track, rescanning the whole media directory";
+                    addChange(_directory);
+                    continue;
+                }
+
+                auto itWatch{ _watches.find(event->wd) };
+                if (itWatch == std::cend(_watches))
+                    continue;
+
+                if (event->mask & IN_IGNORED)
+                {
+                    _watches.erase(itWatch);
+                    continue;
+                }
+
+                const std::filesystem::path directory{ itWatch->second };
+                if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+                {
+                    if (directory == _directory)
+                    {
+                        LMS_LOG(DBUPDATER, WARNING) << "Media directory '" << _directory.string() << "' moved or removed!";
+                        addChange(_directory);
+                    }
+                    continue;
+                }
+
+                const std::filesystem::path path{ event->len > 0 ? directory / event->name : directory };
+                if (event->mask & IN_ISDIR)
+                {
+                    if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+                        removeWatches(path);
+
+                    if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                    {
+                        if (!addWatches(path) && _watchLimitReached)
+                            LMS_LOG(DBUPDATER, WARNING) << "Watch limit reached: some changes will only be detected by scheduled scans";
+                    }
+
+                    addChange(path);
+                }
+                else if (path.filename() == _excludeDirFileName)
+                {
+                    // the whole directory may now be excluded or included
+                    addChange(directory);
+                }
+                else if (event->mask & (IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO))
+                {
+                    // newly created files are reported once they are closed
+                    addChange(path);
+                }
+            }
+        }
+    }
+
+    void MediaDirectoryWatcher::flushChanges()
+    {
+        const std::vector<std::filesystem::path> changedPaths(std::cbegin(_pendingChanges), std::cend(_pendingChanges));
+        _pendingChanges.clear();
+
+        LMS_LOG(DBUPDATER, DEBUG) << "Reporting " << changedPaths.size() << " changed paths";
+        _callback(changedPaths);
+    }
+
+    bool MediaDirectoryWatcher::addWatches(const std::filesystem::path& directory)
+    {
+        if (!_excludeDirFileName.empty())
+        {
+            std::error_code ec;
+            if (std::filesystem::exists(directory / _excludeDirFileName, ec))
+                return true;
+        }
+
+        const int wd{ ::inotify_add_watch(_inotifyFd, directory.c_str(), watchMask) };
+        if (wd == -1)
+        {
+            if (errno == ENOSPC)
+                _watchLimitReached = true;
+
+            LMS_LOG(DBUPDATER, ERROR) << "Cannot watch directory '" << directory.string() << "': " << ::strerror(errno);
+            return false;
+        }
+        _watches[wd] = directory;
+
+        std::error_code ec;
+        std::filesystem::directory_iterator itPath{ directory, std::filesystem::directory_options::follow_directory_symlink, ec };
+        for (std::filesystem::directory_iterator itEnd; !ec && itPath != itEnd; itPath.increment(ec))
+        {
+            std::error_code isDirectoryEc;
+            if (!itPath->is_directory(isDirectoryEc) || isDirectoryEc)
+                continue;
+
+            if (!addWatches(itPath->path()) && _watchLimitReached)
+                return false;
+        }
+
+        return true;
+    }
+
+    void MediaDirectoryWatcher::removeWatches(const std::filesystem::path& directory)
+    {
+        for (auto itWatch{ std::begin(_watches) }; itWatch != std::end(_watches);)
+        {
+            if (isPathInDirectory(itWatch->second, directory))
+            {
+                ::inotify_rm_watch(_inotifyFd, itWatch->first);
+                itWatch = _watches.erase(itWatch);
+            }
+            else
+                ++itWatch;
+        }
+    }
+
+    void MediaDirectoryWatcher::addChange(const std::filesystem::path& path)
+    {
+        _pendingChanges.insert(path);
+        _lastChangeTime = std::chrono::steady_clock::now();
+    }
+} // namespace Scanner
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Scanner
+{
+    // Watches a directory and all its subdirectories for changes (inotify based)
+    // Changes are reported in batches, once no new change has been seen during the debounce delay
+    class MediaDirectoryWatcher
+    {
+    public:
+        using ChangesCallback = std::function<void(const std::vector<std::filesystem::path>& changedPaths)>;
+
+        MediaDirectoryWatcher(ChangesCallback callback, std::chrono::seconds debounceDelay);
+        ~MediaDirectoryWatcher();
+
+        MediaDirectoryWatcher(const MediaDirectoryWatcher&) = delete;
+        MediaDirectoryWatcher& operator=(const MediaDirectoryWatcher&) = delete;
+
+        // Returns false if the directory cannot be watched (unsupported filesystem, too many directories, etc.)
+        // In that case, only periodic scans can detect changes
+        bool start(const std::filesystem::path& directory, const std::filesystem::path& excludeDirFileName);
+        void stop();
+
+        bool isRunning() const { return _thread.joinable(); }
+
+    private:
+        void run();
+        void processEvents();
+        void flushChanges();
+
+        bool addWatches(const std::filesystem::path& directory);
+        void removeWatches(const std::filesystem::path& directory);
+        void addChange(const std::filesystem::path& path);
+        void closeFds();
+
+        const ChangesCallback				_callback;
+        const std::chrono::seconds			_debounceDelay;
+
+        std::filesystem::path				_directory;
+        std::filesystem::path				_excludeDirFileName;
+        int									_inotifyFd{ -1 };
+        int									_stopFd{ -1 };
+        std::thread							_thread;
+
+        // only accessed by the watcher thread once started
+        std::unordered_map<int /* watch descriptor */, std::filesystem::path>	_watches;
+        std::set<std::filesystem::path>		_pendingChanges;
+        std::chrono::steady_clock::time_point	_lastChangeTime;
+        bool								_watchLimitReached{};
+    };
+} // namespace Scanner
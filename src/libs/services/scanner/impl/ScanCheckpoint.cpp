@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ScanCheckpoint.hpp"
+
+#include <fstream>
+#include <string>
+#include <string_view>
+
+#include "utils/Logger.hpp"
+#include "utils/String.hpp"
+
+namespace Scanner
+{
+    std::optional<ScanCheckpoint> ScanCheckpoint::read(const std::filesystem::path& file)
+    {
+        std::ifstream ifs{ file };
+        if (!ifs)
+            return std::nullopt;
+
+        ScanCheckpoint checkpoint;
+        bool hasScanVersion{};
+
+        std::string line;
+        while (std::getline(ifs, line))
+        {
+            const std::size_t separatorPos{ line.find('=') };
+            if (separatorPos == std::string::npos)
+                continue;
+
+            const std::string_view key{ std::string_view{ line }.substr(0, separatorPos) };
+            const std::string_view value{ std::string_view{ line }.substr(separatorPos + 1) };
+
+            if (key == "scan-version")
+            {
+                const std::optional<std::size_t> scanVersion{ StringUtils::readAs<std::size_t>(value) };
+                if (!scanVersion)
+                    break;
+                checkpoint.scanVersion = *scanVersion;
+                hasScanVersion = true;
+            }
+            else if (key == "media-directory")
+                checkpoint.mediaDirectory = std::string{ value };
+            else if (key == "force-scan")
+                checkpoint.forceScan = (value == "1");
+            else if (key == "start-time")
+                checkpoint.startTime = StringUtils::readAs<std::time_t>(value).value_or(0);
+            else if (key == "step")
+                checkpoint.step = static_cast<ScanStep>(StringUtils::readAs<unsigned>(value).value_or(0));
+            else if (key == "last-scanned-directory")
+                checkpoint.lastScannedDirectory = std::string{ value };
+        }
+
+        if (!hasScanVersion || checkpoint.mediaDirectory.empty() || checkpoint.startTime == 0)
+        {
+            LMS_LOG(DBUPDATER, ERROR) << "Ignoring bad scan checkpoint '" << file.string() << "'";
+            return std::nullopt;
+        }
+
+        return checkpoint;
+    }
+
+    void ScanCheckpoint::write(const std::filesystem::path& file) const
+    {
+        const std::filesystem::path tmpFile{ std::filesystem::path{ file }.concat(".tmp") };
+
+        std::error_code ec;
+        std::filesystem::create_directories(file.parent_path(), ec);
+
+        {
+            std::ofstream ofs{ tmpFile, std::ios::out | std::ios::trunc };
+            ofs << "scan-version=" << scanVersion << '\n'
+                << "media-directory=" << mediaDirectory.string() << '\n'
+                << "force-scan=" << (forceScan ? 1 : 0) << '\n'
+                << "start-time=" << startTime << '\n'
+                << "step=" << static_cast<unsigned>(step) << '\n'
+                << "last-scanned-directory=" << lastScannedDirectory.string() << '\n';
+
+            if (!ofs.flush())
+            {
+                LMS_LOG(DBUPDATER, ERROR) << "Cannot write scan checkpoint '" << tmpFile.string() << "'";
+                return;
+            }
+        }
+
+        std::filesystem::rename(tmpFile, file, ec);
+        if (ec)
+            LMS_LOG(DBUPDATER, ERROR) << "Cannot write scan checkpoint '" << file.string() << "': " << ec.message();
+    }
+
+    void ScanCheckpoint::remove(const std::filesystem::path& file)
+    {
+        std::error_code ec;
+        std::filesystem::remove(file, ec);
+    }
+} // namespace Scanner
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <ctime>
+#include <filesystem>
+#include <optional>
+
+#include "services/scanner/ScannerStats.hpp"
+
+namespace Scanner
+{
+    // Progress of the full scan in progress, saved so that it can be resumed if LMS is restarted or the scan is aborted
+    // Files are not scanned again if they were rescanned after the interrupted scan started and did not change since
+    struct ScanCheckpoint
+    {
+        std::size_t scanVersion{};
+        std::filesystem::path mediaDirectory;
+        bool forceScan{};
+        std::time_t startTime{}; // of the first scan attempt
+        ScanStep step{ ScanStep::DiscoveringFiles };
+        std::filesystem::path lastScannedDirectory; // directory of the last committed file
+
+        // null if missing or unreadable
+        static std::optional<ScanCheckpoint> read(const std::filesystem::path& file);
+        void write(const std::filesystem::path& file) const; // atomically replaces the file
+        static void remove(const std::filesystem::path& file);
+    };
+} // namespace Scanner
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "services/database/Artist.hpp"
+#include "services/database/Cluster.hpp"
+#include "services/database/Release.hpp"
+
+namespace Scanner
+{
+    // Scan-scoped cache used to resolve metadata into database objects
+    // Objects are held so that cache hits do not need any database query
+    // Only valid during a scan step: artists, releases and clusters are not removed while files are being scanned
+    struct ScanEntityCache
+    {
+        using ArtistNameKey = std::pair<std::string /* name */, bool /* allowFallbackOnMBIDEntries */>;
+        using ClusterKey = std::pair<std::string /* cluster type */, std::string /* cluster name */>;
+
+        std::unordered_map<std::string /* mbid */, Database::Artist::pointer>		artistsByMBID;
+        std::map<ArtistNameKey, Database::Artist::pointer>							artistsByName;
+        std::unordered_map<std::string /* mbid */, Database::Release::pointer>		releasesByMBID;
+        std::unordered_map<std::string /* name */, Database::Release::pointer>		releasesByName;
+        std::unordered_map<std::string /* name */, Database::ClusterType::pointer>	clusterTypes; // null if cluster type does not exist
+        std::map<ClusterKey, Database::Cluster::pointer>							clusters;
+
+        void invalidateArtistName(const std::string& name)
+        {
+            artistsByName.erase(ArtistNameKey{ name, true });
+            artistsByName.erase(ArtistNameKey{ name, false });
+        }
+
+        void invalidateReleaseName(const std::string& name)
+        {
+            releasesByName.erase(name);
+        }
+
+        void clear()
+        {
+            artistsByMBID.clear();
+            artistsByName.clear();
+            releasesByMBID.clear();
+            releasesByName.clear();
+            clusterTypes.clear();
+            clusters.clear();
+        }
+    };
+} // namespace Scanner
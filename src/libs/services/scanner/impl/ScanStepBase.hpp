@@ -24,6 +24,7 @@
 #include "services/scanner/ScannerStats.hpp"
 #include "IScanStep.hpp"
 #include "ScannerSettings.hpp"
+#include "ScanThrottle.hpp"
 
 namespace Database
 {
@@ -44,12 +45,14 @@ namespace Scanner
 				ProgressCallback progressCallback;
 				bool& abortScan;
 				Database::Db& db;
+				ScanThrottle& throttle;
 			};
 			ScanStepBase(InitParams& initParams)
 				: _settings {initParams.settings}
 			, _progressCallback {initParams.progressCallback}
 			, _abortScan {initParams.abortScan}
 			, _db {initParams.db}
+			, _throttle {initParams.throttle}
 			{}
 
 		protected:
@@ -57,5 +60,6 @@ namespace Scanner
 			ProgressCallback		_progressCallback;
 			bool&					_abortScan;
 			Database::Db&			_db;
+			ScanThrottle&			_throttle;
 	};
 }
@@ -35,21 +35,24 @@ namespace Scanner
 			return;
 
 		Session& session {_db.getTLSSession()};
-		auto transaction {session.createSharedTransaction()};
 
-		const RangeResults<TrackId> tracks = Track::findIdsTrackMBIDDuplicates(session);
-		for (const TrackId trackId : tracks.results)
+		// a single query, instead of loading each duplicated track
+		RangeResults<Track::TrackMBIDDuplicateResult> duplicates;
 		{
-			const Track::pointer track {Track::find(session, trackId)};
-			if (auto trackMBID {track->getTrackMBID()})
-			{
-				LMS_LOG(DBUPDATER, INFO) << "Found duplicated track MBID [" << trackMBID->getAsString() << "], file: " << track->getPath().string() << " - " << track->getName();
-				context.stats.duplicates.emplace_back(ScanDuplicate {track->getId(), DuplicateReason::SameTrackMBID});
-				context.currentStepStats.processedElems++;
-				_progressCallback(context.currentStepStats);
-			}
+			auto transaction {session.createSharedTransaction()};
+			duplicates = Track::findTrackMBIDDuplicates(session);
 		}
 
+		context.stats.duplicates.reserve(context.stats.duplicates.size() + duplicates.results.size());
+		for (const Track::TrackMBIDDuplicateResult& duplicate : duplicates.results)
+		{
+			LMS_LOG(DBUPDATER, INFO) << "Found duplicated track MBID [" << duplicate.trackMBID << "], file: " << duplicate.path.string() << " - " << duplicate.name;
+			context.stats.duplicates.emplace_back(ScanDuplicate {duplicate.trackId, DuplicateReason::SameTrackMBID});
+		}
+
+		context.currentStepStats.processedElems += duplicates.results.size();
+		_progressCallback(context.currentStepStats);
+
 		LMS_LOG(DBUPDATER, DEBUG) << "Found " << context.currentStepStats.processedElems << " duplicated audio files";
 	}
 }
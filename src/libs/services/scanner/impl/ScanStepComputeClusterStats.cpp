@@ -20,12 +20,29 @@
 #include "ScanStepComputeClusterStats.hpp"
 #include "services/database/Db.hpp"
 #include "services/database/Cluster.hpp"
+#include "services/database/ClusterIndex.hpp"
+#include "services/database/Release.hpp"
 #include "services/database/Session.hpp"
+#include "services/database/Track.hpp"
 #include "utils/Logger.hpp"
-#include "utils/Path.hpp"
 
 namespace Scanner
 {
+    void collectScopedEntities(Database::Session& session, IScanStep::ScanContext& context)
+    {
+        using namespace Database;
+
+        auto transaction{ session.createSharedTransaction() };
+
+        for (const std::filesystem::path& scopedPath : context.scopedPaths)
+        {
+            for (const ReleaseId releaseId : Track::findReleaseIds(session, scopedPath).results)
+                context.scopedReleaseIds.insert(releaseId);
+            for (const ClusterId clusterId : Track::findClusterIds(session, scopedPath).results)
+                context.scopedClusterIds.insert(clusterId);
+        }
+    }
+
     void ScanStepComputeClusterStats::process(ScanContext& context)
     {
         using namespace Database;
@@ -35,52 +52,38 @@ namespace Scanner
 
         Session& dbSession{ _db.getTLSSession() };
 
-        const std::size_t clusterCount{ [&] {
-            auto transaction{ dbSession.createSharedTransaction() };
-            return Cluster::getCount(dbSession);
-            }() };
-
-        context.currentStepStats.totalElems = clusterCount;
+        if (context.isPartialScan())
+        {
+            collectScopedEntities(dbSession, context);
 
-        foreachSubRange(Range{ 0, clusterCount }, 100, [&](Range range)
-            {
-                const std::vector<ClusterId> clusterIds{ [&]
-                {
-                    Cluster::FindParameters params;
-                    params.setRange(range);
+            const std::vector<ClusterId> clusterIds(std::cbegin(context.scopedClusterIds), std::cend(context.scopedClusterIds));
+            const std::vector<ReleaseId> releaseIds(std::cbegin(context.scopedReleaseIds), std::cend(context.scopedReleaseIds));
+            context.currentStepStats.totalElems = clusterIds.size();
 
-                    {
-                        auto transaction{ dbSession.createSharedTransaction() };
-                        return std::move(Cluster::findIds(dbSession, params).results);
-                    }
-                }() };
+            auto transaction{ dbSession.createUniqueTransaction() };
 
-                for (const ClusterId clusterId : clusterIds)
-                {
-                    std::size_t trackCount;
-                    std::size_t releaseCount;
+            Cluster::updateCounts(dbSession, clusterIds);
+            Release::updateAggregates(dbSession, releaseIds);
+            _db.setClusterIndex(ClusterIndex::build(dbSession));
 
-                    {
-                        auto transaction{ dbSession.createSharedTransaction() };
+            context.currentStepStats.processedElems = clusterIds.size();
 
-                        trackCount = Cluster::computeTrackCount(dbSession, clusterId);
-                        releaseCount = Cluster::computeReleaseCount(dbSession, clusterId);
-                    }
+            LMS_LOG(DBUPDATER, DEBUG) << "Recomputed stats for " << clusterIds.size() << " clusters and " << releaseIds.size() << " releases in scope!";
+            return;
+        }
 
-                    {
-                        auto transaction{ dbSession.createUniqueTransaction() };
+        auto transaction{ dbSession.createUniqueTransaction() };
 
-                        auto cluster{ Cluster::find(dbSession, clusterId) };
-                        cluster.modify()->setTrackCount(trackCount);
-                        cluster.modify()->setReleaseCount(releaseCount);
-                    }
+        const std::size_t clusterCount{ Cluster::getCount(dbSession) };
+        context.currentStepStats.totalElems = clusterCount;
 
-                    context.currentStepStats.processedElems++;
-                }
+        // single aggregate passes instead of several queries per cluster and per release
+        Cluster::updateCounts(dbSession);
+        Release::updateAggregates(dbSession);
+        _db.setClusterIndex(ClusterIndex::build(dbSession));
 
-                return true;
-            });
+        context.currentStepStats.processedElems = clusterCount;
 
-        LMS_LOG(DBUPDATER, DEBUG) << "Recomputed stats for " << clusterCount << " clusters!";
+        LMS_LOG(DBUPDATER, DEBUG) << "Recomputed stats for " << clusterCount << " clusters and the release aggregates!";
     }
 }
@@ -21,8 +21,16 @@
 
 #include "ScanStepBase.hpp"
 
+namespace Database
+{
+    class Session;
+}
+
 namespace Scanner
 {
+    // Partial scans: adds the releases and clusters of the tracks currently in scope to the context
+    void collectScopedEntities(Database::Session& session, IScanStep::ScanContext& context);
+
     class ScanStepComputeClusterStats : public ScanStepBase
     {
     public:
@@ -30,7 +38,7 @@ namespace Scanner
 
     private:
         ScanStep getStep() const override { return ScanStep::ComputeClusterStats; }
-        std::string_view getStepName() const override { return "Compute cluster stats"; }
+        std::string_view getStepName() const override { return "Compute cluster and release stats"; }
         void process(ScanContext& context) override;
     };
 }
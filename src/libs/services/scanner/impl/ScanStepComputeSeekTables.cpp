@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ScanStepComputeSeekTables.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+#include "av/SeekTable.hpp"
+#include "services/database/Db.hpp"
+#include "services/database/Session.hpp"
+#include "services/database/Track.hpp"
+#include "utils/Exception.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Service.hpp"
+#include "utils/TaskExecutor.hpp"
+
+namespace Scanner
+{
+    void ScanStepComputeSeekTables::process(ScanContext& context)
+    {
+        using namespace Database;
+
+        Session& dbSession{ _db.getTLSSession() };
+
+        std::vector<TrackId> trackIds;
+        {
+            auto transaction{ dbSession.createSharedTransaction() };
+            trackIds = Track::findIdsWithMinDuration(dbSession, _settings.seekTableMinDuration).results;
+        }
+
+        if (trackIds.empty())
+            return;
+
+        context.currentStepStats.totalElems = trackIds.size();
+        _progressCallback(context.currentStepStats);
+
+        std::atomic<std::size_t> computedCount{};
+        for (std::size_t batchBegin{}; batchBegin < trackIds.size() && !_abortScan; batchBegin += _settings.writeBatchSize)
+        {
+            const std::size_t batchEnd{ std::min(batchBegin + _settings.writeBatchSize, trackIds.size()) };
+
+            std::vector<std::filesystem::path> trackPaths;
+            {
+                auto transaction{ dbSession.createSharedTransaction() };
+
+                for (std::size_t i{ batchBegin }; i < batchEnd; ++i)
+                {
+                    const Track::pointer track{ Track::find(dbSession, trackIds[i]) };
+                    if (track && Av::isSeekTableSupported(track->getAudioCodec()))
+                        trackPaths.push_back(track->getPath());
+                }
+            }
+
+            // up to date tables are kept, unless a full scan is requested
+            if (!context.forceScan)
+                trackPaths.erase(std::remove_if(std::begin(trackPaths), std::end(trackPaths), [](const std::filesystem::path& trackPath) { return Av::hasSeekTable(trackPath); }), std::end(trackPaths));
+
+            // background priority: must not slow down the requests served meanwhile
+            parallelFor(*Service<TaskExecutor>::get(), TaskExecutor::Priority::Background, trackPaths.size(), _settings.parserThreadCount,
+                [&](std::size_t index)
+                {
+                    _throttle.throttle(_abortScan);
+                    if (_abortScan)
+                        return;
+
+                    const std::filesystem::path& trackPath{ trackPaths[index] };
+                    try
+                    {
+                        Av::storeSeekTable(trackPath, Av::computeSeekTable(trackPath, _settings.seekTableInterval));
+                        computedCount++;
+                    }
+                    catch (const LmsException& e)
+                    {
+                        LMS_LOG(DBUPDATER, ERROR) << "Cannot compute seek table of '" << trackPath.string() << "': " << e.what();
+                    }
+                });
+
+            context.currentStepStats.processedElems = batchEnd;
+            _progressCallback(context.currentStepStats);
+        }
+
+        LMS_LOG(DBUPDATER, DEBUG) << "Computed " << computedCount.load() << " seek tables";
+    }
+}
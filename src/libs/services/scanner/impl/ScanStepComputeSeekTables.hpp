@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2021 Emeric Poupon
+ * Copyright (C) 2023 Emeric Poupon
  *
  * This file is part of LMS.
  *
@@ -19,29 +19,20 @@
 
 #pragma once
 
-#include "IFeedbackBackend.hpp"
+#include "ScanStepBase.hpp"
 
-namespace Database
+namespace Scanner
 {
-    class Db;
-}
-
-namespace Feedback
-{
-    class InternalBackend final : public IFeedbackBackend
+    // Computes the seek tables of the long tracks (DJ mixes, audiobooks, etc.) that do not have an up to date one,
+    // so that transcodes started at an offset do not have to look for the position in the file
+    class ScanStepComputeSeekTables : public ScanStepBase
     {
     public:
-        InternalBackend(Database::Db& db);
+        using ScanStepBase::ScanStepBase;
 
     private:
-        void onStarred(Database::StarredArtistId) override;
-        void onUnstarred(Database::StarredArtistId) override;
-        void onStarred(Database::StarredReleaseId) override;
-        void onUnstarred(Database::StarredReleaseId) override;
-        void onStarred(Database::StarredTrackId) override;
-        void onUnstarred(Database::StarredTrackId) override;
-
-        Database::Db& _db;
+        ScanStep getStep() const override { return ScanStep::ComputingSeekTables; }
+        std::string_view getStepName() const override { return "Compute seek tables"; }
+        void process(ScanContext& context) override;
     };
-} // Feedback
-
+}
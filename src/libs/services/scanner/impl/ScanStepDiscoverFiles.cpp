@@ -18,31 +18,175 @@
  */
 
 #include "ScanStepDiscoverFiles.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "utils/Exception.hpp"
 #include "utils/Logger.hpp"
 #include "utils/Path.hpp"
 
 namespace Scanner
 {
+	namespace
+	{
+		// remove paths that are already covered by another one, or that are not in the media directory
+		std::vector<std::filesystem::path>
+		getEffectiveScopedPaths(const ScanStepBase::ScanContext& context)
+		{
+			std::vector<std::filesystem::path> res;
+
+			std::vector<std::filesystem::path> scopedPaths {context.scopedPaths};
+			std::sort(std::begin(scopedPaths), std::end(scopedPaths));
+
+			for (const std::filesystem::path& scopedPath : scopedPaths)
+			{
+				if (scopedPath != context.directory && !PathUtils::isPathInRootPath(scopedPath, context.directory, &ScanStepBase::excludeDirFileName))
+					continue;
+
+				const auto isCovered {[&](const std::filesystem::path& other)
+				{
+					return std::mismatch(std::cbegin(other), std::cend(other), std::cbegin(scopedPath), std::cend(scopedPath)).first == std::cend(other);
+				}};
+
+				if (!res.empty() && isCovered(res.back()))
+					continue;
+
+				res.push_back(scopedPath);
+			}
+
+			return res;
+		}
+	}
+
 	void
 	ScanStepDiscoverFiles::process(ScanContext& context)
 	{
 		context.stats.filesScanned = 0;
-		PathUtils::exploreFilesRecursive(context.directory, [&](std::error_code ec, const std::filesystem::path& path)
+		context.discoveredFiles.clear();
+		context.trackFileInfos.clear();
+		context.directoryFingerprints.clear();
+
+		if (!context.forceScan)
+			context.trackFileInfos.load(_db.getTLSSession());
+		if (_settings.skipUnchangedDirectories && !context.forceScan)
+			context.directoryFingerprints.load(_db.getTLSSession());
+
+		if (!context.isPartialScan())
+		{
+			exploreDirectory(context.directory, context);
+		}
+		else
 		{
-			if (_abortScan)
-				return false;
+			for (const std::filesystem::path& scopedPath : getEffectiveScopedPaths(context))
+			{
+				if (_abortScan)
+					break;
 
-			if (!ec && PathUtils::hasFileAnyExtension(path, _settings.supportedExtensions))
+				std::error_code ec;
+				if (std::filesystem::is_directory(scopedPath, ec))
+				{
+					if (!exploreDirectory(scopedPath, context))
+						break;
+				}
+				else if (std::filesystem::is_regular_file(scopedPath, ec))
+				{
+					if (PathUtils::hasFileAnyExtension(scopedPath, _settings.supportedExtensions))
+						processFile(scopedPath, context);
+				}
+				// otherwise the path was removed: orphan step will take care of it
+			}
+		}
+
+		context.discoveredFiles.finalize();
+		context.stats.filesScanned = context.discoveredFiles.size();
+
+		LMS_LOG(DBUPDATER, DEBUG) << "Discovered " << context.stats.filesScanned << " files in '" << context.directory.string() << "'" << (context.isPartialScan() ? " (partial scan)" : "");
+	}
+
+	bool
+	ScanStepDiscoverFiles::exploreDirectory(const std::filesystem::path& directory, ScanContext& context)
+	{
+		if (_abortScan)
+			return false;
+
+		PathUtils::ExploreParameters params;
+		params.readConcurrency = _settings.directoryReadConcurrency;
+		params.excludeDirFileName = &excludeDirFileName;
+		params.fileFilter = [this](const std::filesystem::path& file) { return PathUtils::hasFileAnyExtension(file, _settings.supportedExtensions); };
+		// file info is needed anyway unless unchanged directories are skipped
+		params.getFileInfo = !_settings.skipUnchangedDirectories || context.forceScan;
+
+		return PathUtils::exploreDirectoriesRecursive(directory, [&](const PathUtils::DirectoryListing& listing)
+		{
+			processDirectoryListing(listing, context);
+			return !_abortScan;
+		}, params);
+	}
+
+	void
+	ScanStepDiscoverFiles::processDirectoryListing(const PathUtils::DirectoryListing& listing, ScanContext& context)
+	{
+		if (listing.ec)
+			addError(listing.directory, listing.ec.message(), context);
+
+		bool directoryUnchanged {};
+		// partial listings must not be trusted
+		if (_settings.skipUnchangedDirectories && !listing.ec && listing.lastWriteTime.isValid())
+			directoryUnchanged = context.directoryFingerprints.update(listing.directory, DirectoryFingerprints::Fingerprint {listing.lastWriteTime.toTime_t(), listing.entryCount, _settings.scanVersion});
+
+		for (const PathUtils::DirectoryEntry& entry : listing.entries)
+		{
+			if (entry.ec)
 			{
-				context.currentStepStats.processedElems++;
-				_progressCallback(context.currentStepStats);
+				addError(entry.path, entry.ec.message(), context);
+				continue;
 			}
 
-			return true;
-		}, &excludeDirFileName);
+			if (entry.type != PathUtils::DirectoryEntry::Type::Regular)
+				continue;
 
-		context.stats.filesScanned = context.currentStepStats.processedElems;
+			// no file added, removed or renamed in this directory: files already in database are assumed to be unchanged
+			const TrackFileInfos::FileInfo* fileInfo {directoryUnchanged ? context.trackFileInfos.find(entry.path) : nullptr};
+			if (fileInfo)
+				context.discoveredFiles.add(entry.path, fileInfo->lastWriteTime, 0, 0, 0);
+			else if (entry.fileInfo)
+				context.discoveredFiles.add(entry.path, entry.fileInfo->lastWriteTime.toTime_t(), entry.fileInfo->size, entry.fileInfo->device, entry.fileInfo->inode);
+			else
+			{
+				processFile(entry.path, context);
+				continue;
+			}
 
-		LMS_LOG(DBUPDATER, DEBUG) << "Discovered " << context.stats.filesScanned << " files in '" << context.directory << "'";
+			context.currentStepStats.processedElems++;
+			_progressCallback(context.currentStepStats);
+		}
+	}
+
+	void
+	ScanStepDiscoverFiles::processFile(const std::filesystem::path& file, ScanContext& context)
+	{
+		try
+		{
+			const PathUtils::FileInfo fileInfo {PathUtils::getFileInfo(file)};
+			context.discoveredFiles.add(file, fileInfo.lastWriteTime.toTime_t(), fileInfo.size, fileInfo.device, fileInfo.inode);
+		}
+		catch (LmsException& e)
+		{
+			LMS_LOG(DBUPDATER, ERROR) << e.what();
+			context.stats.errors.add(ScanError {file, ScanErrorType::CannotReadFile, e.what()});
+			context.discoveredFiles.addUnexploredPath(file);
+		}
+
+		context.currentStepStats.processedElems++;
+		_progressCallback(context.currentStepStats);
+	}
+
+	void
+	ScanStepDiscoverFiles::addError(const std::filesystem::path& path, const std::string& message, ScanContext& context)
+	{
+		LMS_LOG(DBUPDATER, ERROR) << "Cannot process entry '" << path.string() << "': " << message;
+		context.stats.errors.add(ScanError {path, ScanErrorType::CannotReadFile, message});
+		context.discoveredFiles.addUnexploredPath(path);
 	}
 }
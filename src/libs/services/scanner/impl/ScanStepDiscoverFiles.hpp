@@ -19,6 +19,10 @@
 
 #pragma once
 
+#include <filesystem>
+#include <string>
+
+#include "utils/Path.hpp"
 #include "ScanStepBase.hpp"
 
 namespace Scanner
@@ -32,5 +36,11 @@ namespace Scanner
 			ScanStep getStep() const override { return ScanStep::DiscoveringFiles; }
 			std::string_view getStepName() const override { return "DiscoveringFiles"; }
 			void process(ScanContext& context) override;
+
+			// return false if the exploration is aborted
+			bool exploreDirectory(const std::filesystem::path& directory, ScanContext& context);
+			void processDirectoryListing(const PathUtils::DirectoryListing& listing, ScanContext& context);
+			void processFile(const std::filesystem::path& file, ScanContext& context);
+			void addError(const std::filesystem::path& path, const std::string& message, ScanContext& context);
 	};
 }
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ScanStepExtractTrackFeatures.hpp"
+
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <unistd.h>
+
+#include "services/database/Db.hpp"
+#include "services/database/Session.hpp"
+#include "services/database/Track.hpp"
+#include "utils/IChildProcessManager.hpp"
+#include "utils/IConfig.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Service.hpp"
+#include "utils/TaskExecutor.hpp"
+
+namespace Scanner
+{
+    namespace
+    {
+        struct TrackToExtract
+        {
+            Database::TrackId trackId;
+            std::filesystem::path path;
+        };
+
+        struct ExtractionResult
+        {
+            Database::TrackId trackId;
+            std::optional<Database::FeatureValuesMap> featureValuesMap;
+        };
+    }
+
+    ScanStepExtractTrackFeatures::ScanStepExtractTrackFeatures(InitParams& initParams)
+        : ScanStepBase{ initParams }
+        , _outputDirectory{ Service<IConfig>::get()->getPath("working-dir") / "features" }
+    {
+    }
+
+    void ScanStepExtractTrackFeatures::process(ScanContext& context)
+    {
+        using namespace Database;
+
+        Session& dbSession{ _db.getTLSSession() };
+
+        std::vector<TrackToExtract> tracks;
+        {
+            auto transaction{ dbSession.createSharedTransaction() };
+
+            for (const TrackId trackId : Track::findIdsWithMissingFeatures(dbSession).results)
+            {
+                if (_failedTrackIds.find(trackId) != std::cend(_failedTrackIds))
+                    continue;
+
+                if (const Track::pointer track{ Track::find(dbSession, trackId) })
+                    tracks.push_back(TrackToExtract{ trackId, track->getPath() });
+            }
+        }
+
+        if (tracks.empty())
+            return;
+
+        std::error_code ec;
+        std::filesystem::create_directories(_outputDirectory, ec);
+        if (ec)
+        {
+            LMS_LOG(DBUPDATER, ERROR) << "Cannot create directory '" << _outputDirectory.string() << "': " << ec.message();
+            return;
+        }
+
+        context.currentStepStats.totalElems = tracks.size();
+        _progressCallback(context.currentStepStats);
+
+        std::mutex resultsMutex;
+        std::vector<ExtractionResult> results;
+
+        // one extractor process per task: the process count is the CPU budget
+        TaskGroup group{ *Service<TaskExecutor>::get(), TaskExecutor::Priority::Background };
+        group.runForEachIndex(tracks.size(), _settings.featuresExtractionProcessCount, [&](std::size_t index)
+            {
+                _throttle.throttle(_abortScan);
+                if (_abortScan)
+                    return;
+
+                ExtractionResult result{ tracks[index].trackId, extractFeatures(tracks[index].path) };
+
+                std::scoped_lock lock{ resultsMutex };
+                results.push_back(std::move(result));
+            });
+
+        std::size_t extractedCount{};
+        bool done{};
+        while (!done)
+        {
+            done = group.waitFor(std::chrono::seconds{ 1 });
+
+            std::vector<ExtractionResult> resultsToWrite;
+            {
+                std::scoped_lock lock{ resultsMutex };
+                resultsToWrite.swap(results);
+            }
+
+            if (resultsToWrite.empty())
+                continue;
+
+            {
+                auto transaction{ dbSession.createUniqueTransaction() };
+
+                for (ExtractionResult& result : resultsToWrite)
+                {
+                    if (!result.featureValuesMap)
+                    {
+                        if (!_abortScan)
+                            _failedTrackIds.insert(result.trackId);
+                        continue;
+                    }
+
+                    // the track may have been removed or already processed meanwhile
+                    const Track::pointer track{ Track::find(dbSession, result.trackId) };
+                    if (!track || TrackFeatures::find(dbSession, result.trackId))
+                        continue;
+
+                    dbSession.create<TrackFeatures>(track, *result.featureValuesMap);
+                    extractedCount++;
+                    context.stats.featuresFetched++;
+                }
+            }
+
+            context.currentStepStats.processedElems += resultsToWrite.size();
+            _progressCallback(context.currentStepStats);
+        }
+
+        LMS_LOG(DBUPDATER, INFO) << "Extracted features of " << extractedCount << " tracks";
+    }
+
+    std::optional<Database::FeatureValuesMap> ScanStepExtractTrackFeatures::extractFeatures(const std::filesystem::path& file)
+    {
+        const std::filesystem::path outputFile{ _outputDirectory / ("features-" + std::to_string(::getpid()) + "-" + std::to_string(_outputFileCounter++) + ".json") };
+
+        IChildProcess::Args args{ _settings.featuresExtractor.string(), file.string(), outputFile.string() };
+        if (!_settings.featuresExtractorProfile.empty())
+            args.push_back(_settings.featuresExtractorProfile.string());
+
+        try
+        {
+            std::unique_ptr<IChildProcess> childProcess{ Service<IChildProcessManager>::get()->spawnChildProcess(_settings.featuresExtractor, args) };
+
+            // the extractor logs its progress on its output: drain it until it exits
+            std::array<std::byte, 4096> buffer;
+            while (childProcess->readSome(buffer.data(), buffer.size()) > 0)
+            {
+                if (_abortScan)
+                {
+                    childProcess->kill();
+                    break;
+                }
+            }
+        }
+        catch (const ChildProcessException& e)
+        {
+            LMS_LOG(DBUPDATER, ERROR) << "Cannot run features extractor: " << e.what();
+            return std::nullopt;
+        }
+
+        std::optional<Database::FeatureValuesMap> res;
+        {
+            std::ifstream ifs{ outputFile };
+            if (ifs)
+            {
+                std::ostringstream oss;
+                oss << ifs.rdbuf();
+                res = Database::TrackFeatures::parseJson(oss.str());
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::remove(outputFile, ec);
+
+        if (!res && !_abortScan)
+            LMS_LOG(DBUPDATER, ERROR) << "Cannot extract features from '" << file.string() << "'";
+
+        return res;
+    }
+}
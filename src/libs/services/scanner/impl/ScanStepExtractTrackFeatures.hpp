@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <optional>
+#include <set>
+
+#include "services/database/TrackFeatures.hpp"
+#include "services/database/TrackId.hpp"
+#include "ScanStepBase.hpp"
+
+namespace Scanner
+{
+    // Computes the low level features of the tracks that have none, using an external extractor
+    // (Essentia music extractor, whose output has the AcousticBrainz format), run as child processes
+    class ScanStepExtractTrackFeatures : public ScanStepBase
+    {
+    public:
+        ScanStepExtractTrackFeatures(InitParams& initParams);
+
+    private:
+        ScanStep getStep() const override { return ScanStep::ExtractingTrackFeatures; }
+        std::string_view getStepName() const override { return "Extract track features"; }
+        void process(ScanContext& context) override;
+
+        std::optional<Database::FeatureValuesMap> extractFeatures(const std::filesystem::path& file);
+
+        const std::filesystem::path		_outputDirectory;
+        std::atomic<std::size_t>		_outputFileCounter{};
+        std::set<Database::TrackId>		_failedTrackIds; // not retried until the server is restarted or the settings are changed
+    };
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ScanStepGenerateCovers.hpp"
+
+#include <atomic>
+#include <chrono>
+
+#include "image/IRawImage.hpp"
+#include "services/cover/ICoverService.hpp"
+#include "services/database/Db.hpp"
+#include "services/database/Release.hpp"
+#include "services/database/Session.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Service.hpp"
+#include "utils/TaskExecutor.hpp"
+
+namespace Scanner
+{
+    void ScanStepGenerateCovers::process(ScanContext& context)
+    {
+        using namespace Database;
+
+        if (context.stats.additions == 0 && context.stats.updates == 0)
+            return;
+
+        Cover::ICoverService* coverService{ Service<Cover::ICoverService>::get() };
+        if (!coverService)
+            return;
+
+        // covers are pre-generated in all the formats that can be served
+        std::vector<Image::EncodingFormat> formats{ Image::EncodingFormat::JPEG };
+        if (Image::isEncodingFormatSupported(Image::EncodingFormat::WebP))
+            formats.push_back(Image::EncodingFormat::WebP);
+
+        std::vector<ReleaseId> releaseIds;
+        {
+            Session& dbSession{ _db.getTLSSession() };
+
+            auto transaction{ dbSession.createSharedTransaction() };
+            releaseIds = Release::findIds(dbSession, Release::FindParameters{}.setAddedAfter(context.stats.startTime)).results;
+        }
+
+        context.currentStepStats.totalElems = releaseIds.size();
+        _progressCallback(context.currentStepStats);
+
+        std::atomic<std::size_t> processedCount{};
+
+        // background priority: must not slow down the requests served meanwhile
+        TaskGroup group{ *Service<TaskExecutor>::get(), TaskExecutor::Priority::Background };
+        group.runForEachIndex(releaseIds.size(), _settings.coverPregenerationThreadCount, [&](std::size_t index)
+            {
+                _throttle.throttle(_abortScan);
+
+                const ReleaseId releaseId{ releaseIds[index] };
+
+                for (const std::size_t width : _settings.coverPregenerationWidths)
+                {
+                    for (const Image::EncodingFormat format : formats)
+                    {
+                        if (_abortScan)
+                            break;
+
+                        try
+                        {
+                            coverService->getFromRelease(releaseId, width, format);
+                        }
+                        catch (const std::exception& e)
+                        {
+                            LMS_LOG(DBUPDATER, ERROR) << "Cannot generate cover for release " << releaseId.toString() << ": " << e.what();
+                        }
+                    }
+                }
+
+                processedCount++;
+            });
+
+        bool done{};
+        while (!done)
+        {
+            done = group.waitFor(std::chrono::seconds{ 1 });
+
+            context.currentStepStats.processedElems = processedCount;
+            _progressCallback(context.currentStepStats);
+        }
+
+        LMS_LOG(DBUPDATER, DEBUG) << "Generated covers for " << releaseIds.size() << " releases";
+    }
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ScanStepRefineAudioProperties.hpp"
+
+#include <algorithm>
+#include <optional>
+
+#include "metadata/IParser.hpp"
+#include "services/database/Db.hpp"
+#include "services/database/Release.hpp"
+#include "services/database/Session.hpp"
+#include "services/database/Track.hpp"
+#include "utils/Exception.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Path.hpp"
+#include "utils/Service.hpp"
+#include "utils/TaskExecutor.hpp"
+
+namespace Scanner
+{
+    namespace
+    {
+        struct FileToRefine
+        {
+            Database::TrackId trackId;
+            std::filesystem::path path;
+            Wt::WDateTime lastWriteTime;
+        };
+
+        struct AudioProperties
+        {
+            std::chrono::milliseconds duration;
+            std::size_t bitrate;
+        };
+
+        std::optional<AudioProperties> readAudioProperties(MetaData::IParser& parser, const FileToRefine& file)
+        {
+            try
+            {
+                // the file will be scanned again anyway
+                if (PathUtils::getLastWriteTime(file.path) != file.lastWriteTime)
+                    return std::nullopt;
+
+                const std::optional<MetaData::Track> track{ parser.parse(file.path) };
+                if (!track || track->duration == std::chrono::milliseconds::zero())
+                    return std::nullopt;
+
+                return AudioProperties{ track->duration, track->bitrate };
+            }
+            catch (const LmsException& e)
+            {
+                LMS_LOG(DBUPDATER, ERROR) << "Cannot read audio properties of '" << file.path.string() << "': " << e.what();
+            }
+
+            return std::nullopt;
+        }
+    }
+
+    void ScanStepRefineAudioProperties::process(ScanContext& context)
+    {
+        using namespace Database;
+
+        Session& dbSession{ _db.getTLSSession() };
+
+        std::vector<TrackId> trackIds;
+        {
+            auto transaction{ dbSession.createSharedTransaction() };
+            trackIds = Track::findIdsWithPendingAudioProperties(dbSession).results;
+        }
+
+        if (trackIds.empty())
+            return;
+
+        context.currentStepStats.totalElems = trackIds.size();
+        _progressCallback(context.currentStepStats);
+
+        const std::unique_ptr<MetaData::IParser> parser{ MetaData::createParser(MetaData::ParserType::TagLib, MetaData::ParserReadStyle::Accurate) };
+
+        std::size_t refinedCount{};
+        for (std::size_t batchBegin{}; batchBegin < trackIds.size() && !_abortScan; batchBegin += _settings.writeBatchSize)
+        {
+            const std::size_t batchEnd{ std::min(batchBegin + _settings.writeBatchSize, trackIds.size()) };
+
+            std::vector<FileToRefine> files;
+            {
+                auto transaction{ dbSession.createSharedTransaction() };
+
+                for (std::size_t i{ batchBegin }; i < batchEnd; ++i)
+                {
+                    if (const Track::pointer track{ Track::find(dbSession, trackIds[i]) })
+                        files.push_back(FileToRefine{ track->getId(), track->getPath(), track->getLastWriteTime() });
+                }
+            }
+
+            // background priority: must not slow down the requests served meanwhile
+            const std::vector<std::optional<AudioProperties>> audioProperties{ parallelMap(*Service<TaskExecutor>::get(), TaskExecutor::Priority::Background, files, _settings.parserThreadCount,
+                [&](const FileToRefine& file)
+                {
+                    _throttle.throttle(_abortScan);
+                    return _abortScan ? std::nullopt : readAudioProperties(*parser, file);
+                }) };
+
+            {
+                auto transaction{ dbSession.createUniqueTransaction() };
+
+                for (std::size_t i{}; i < files.size(); ++i)
+                {
+                    if (_abortScan && !audioProperties[i])
+                        continue; // keep it pending for the next scan
+
+                    Track::pointer track{ Track::find(dbSession, files[i].trackId) };
+                    if (!track)
+                        continue;
+
+                    // failures are not retried: the estimated values are kept until the file changes
+                    track.modify()->setAudioPropertiesPending(false);
+                    if (audioProperties[i])
+                    {
+                        track.modify()->setDuration(audioProperties[i]->duration);
+                        track.modify()->setBitrate(audioProperties[i]->bitrate);
+                        refinedCount++;
+                    }
+                }
+            }
+
+            context.currentStepStats.processedElems = batchEnd;
+            _progressCallback(context.currentStepStats);
+        }
+
+        // release durations are aggregated from the track ones
+        if (refinedCount > 0)
+        {
+            auto transaction{ dbSession.createUniqueTransaction() };
+            Release::updateAggregates(dbSession);
+        }
+
+        LMS_LOG(DBUPDATER, DEBUG) << "Refined audio properties of " << refinedCount << " tracks";
+    }
+}
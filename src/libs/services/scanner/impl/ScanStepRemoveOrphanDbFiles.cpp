@@ -19,6 +19,10 @@
 
 #include "ScanStepRemoveOrphanDbFiles.hpp"
 
+#include <algorithm>
+#include <optional>
+#include <vector>
+
 #include "services/database/Artist.hpp"
 #include "services/database/Cluster.hpp"
 #include "services/database/Db.hpp"
@@ -27,12 +31,44 @@
 #include "services/database/Track.hpp"
 #include "utils/Logger.hpp"
 #include "utils/Path.hpp"
+#include "utils/Service.hpp"
+#include "utils/TaskExecutor.hpp"
 
 namespace Scanner
 {
+    namespace
+    {
+        constexpr std::size_t batchSize{ 500 };
+
+        // Orphans are removed by batch, each one in its own transaction so that the other users of the database are not blocked for too long
+        template <typename IdType>
+        std::size_t removeOrphans(Database::Session& session, const bool& abortScan, Database::RangeResults<IdType>(*findOrphans)(Database::Session&, std::optional<Database::Range>), void(*remove)(Database::Session&, const std::vector<IdType>&))
+        {
+            std::size_t removedCount{};
+
+            bool moreResults{ true };
+            while (moreResults && !abortScan)
+            {
+                auto transaction{ session.createUniqueTransaction() };
+
+                // removed entries are no longer orphans: always fetch the first batch
+                const Database::RangeResults<IdType> orphanIds{ findOrphans(session, Database::Range{ 0, batchSize }) };
+                remove(session, orphanIds.results);
+
+                removedCount += orphanIds.results.size();
+                moreResults = orphanIds.moreResults;
+            }
+
+            return removedCount;
+        }
+    }
+
     void ScanStepRemoveOrphanDbFiles::process(ScanContext& context)
     {
-        removeOrphanTracks(context);
+        if (context.isPartialScan())
+            removeOrphanTracksInScope(context);
+        else
+            removeOrphanTracks(context);
         removeOrphanClusters();
         removeOrphanArtists();
         removeOrphanReleases();
@@ -45,7 +81,6 @@ namespace Scanner
         if (_abortScan)
             return;
 
-        static constexpr std::size_t batchSize{ 50 };
         Session& session{ _db.getTLSSession() };
 
         LMS_LOG(DBUPDATER, DEBUG) << "Checking tracks to be removed...";
@@ -62,40 +97,30 @@ namespace Scanner
         RangeResults<Track::PathResult> trackPaths;
         std::vector<TrackId> tracksToRemove;
 
-        // TODO handle only files in context.directory
         for (std::size_t i{ trackCount < batchSize ? 0 : trackCount - batchSize }; ; i -= (i > batchSize ? batchSize : i))
         {
-            tracksToRemove.clear();
-
             {
                 auto transaction{ session.createSharedTransaction() };
                 trackPaths = Track::findPaths(session, Range{ i, batchSize });
             }
 
-            for (const Track::PathResult& trackPath : trackPaths.results)
-            {
-                if (_abortScan)
-                    return;
+            const std::size_t batchTrackCount{ trackPaths.results.size() };
 
-                if (!checkFile(trackPath.path))
-                    tracksToRemove.push_back(trackPath.trackId);
+            // partial scan: do not bother checking files that are out of scope
+            trackPaths.results.erase(std::remove_if(std::begin(trackPaths.results), std::end(trackPaths.results), [&](const Track::PathResult& trackPath) { return !context.isPathInScope(trackPath.path); }), std::end(trackPaths.results));
 
-                context.currentStepStats.processedElems++;
-            }
+            tracksToRemove = checkFiles(trackPaths.results, context);
+            if (_abortScan)
+                return;
+
+            context.currentStepStats.processedElems += batchTrackCount;
 
             if (!tracksToRemove.empty())
             {
-                auto transaction{ session.createSharedTransaction() };
+                auto transaction{ session.createUniqueTransaction() };
 
-                for (const TrackId trackId : tracksToRemove)
-                {
-                    Track::pointer track{ Track::find(session, trackId) };
-                    if (track)
-                    {
-                        track.remove();
-                        context.stats.deletions++;
-                    }
-                }
+                Track::remove(session, tracksToRemove);
+                context.stats.deletions += tracksToRemove.size();
             }
 
             _progressCallback(context.currentStepStats);
@@ -107,22 +132,63 @@ namespace Scanner
         LMS_LOG(DBUPDATER, DEBUG) << trackCount << " tracks checked!";
     }
 
-    void ScanStepRemoveOrphanDbFiles::removeOrphanClusters()
+    // Only the tracks within the scoped paths, found using the path index
+    void ScanStepRemoveOrphanDbFiles::removeOrphanTracksInScope(ScanContext& context)
     {
         using namespace Database;
 
-        LMS_LOG(DBUPDATER, DEBUG) << "Checking orphan clusters...";
         Session& session{ _db.getTLSSession() };
-        auto transaction{ session.createUniqueTransaction() };
 
-        // Now process orphan Cluster (no track)
-        auto clusterIds{ Cluster::findOrphans(session) };
-        for (ClusterId clusterId : clusterIds.results)
+        std::vector<TrackId> tracksToRemove;
+        for (const std::filesystem::path& scopedPath : context.scopedPaths)
+        {
+            RangeResults<Track::PathResult> trackPaths;
+            for (std::size_t offset{}; offset == 0 || trackPaths.moreResults; offset += batchSize)
+            {
+                {
+                    auto transaction{ session.createSharedTransaction() };
+                    trackPaths = Track::findPaths(session, scopedPath, Range{ offset, batchSize });
+                }
+
+                context.currentStepStats.totalElems += trackPaths.results.size();
+
+                const std::vector<TrackId> scopedTracksToRemove{ checkFiles(trackPaths.results, context) };
+                if (_abortScan)
+                    return;
+
+                tracksToRemove.insert(std::end(tracksToRemove), std::cbegin(scopedTracksToRemove), std::cend(scopedTracksToRemove));
+                context.currentStepStats.processedElems += trackPaths.results.size();
+
+                _progressCallback(context.currentStepStats);
+            }
+        }
+
+        // scoped paths may overlap
+        std::sort(std::begin(tracksToRemove), std::end(tracksToRemove));
+        tracksToRemove.erase(std::unique(std::begin(tracksToRemove), std::end(tracksToRemove)), std::end(tracksToRemove));
+
+        // removed at the end, so that the paged results are not shifted
+        for (std::size_t offset{}; offset < tracksToRemove.size(); offset += batchSize)
         {
-            Cluster::pointer cluster{ Cluster::find(session, clusterId) };
-            LMS_LOG(DBUPDATER, DEBUG) << "Removing orphan cluster '" << cluster->getName() << "'";
-            cluster.remove();
+            auto transaction{ session.createUniqueTransaction() };
+
+            const auto begin{ std::cbegin(tracksToRemove) + offset };
+            Track::remove(session, std::vector<TrackId>(begin, begin + std::min(batchSize, tracksToRemove.size() - offset)));
         }
+        context.stats.deletions += tracksToRemove.size();
+
+        LMS_LOG(DBUPDATER, DEBUG) << context.currentStepStats.processedElems << " tracks in scope checked!";
+    }
+
+    void ScanStepRemoveOrphanDbFiles::removeOrphanClusters()
+    {
+        using namespace Database;
+
+        LMS_LOG(DBUPDATER, DEBUG) << "Checking orphan clusters...";
+
+        // Now process orphan Cluster (no track)
+        const std::size_t removedCount{ removeOrphans<ClusterId>(_db.getTLSSession(), _abortScan, &Cluster::findOrphans, &Cluster::remove) };
+        LMS_LOG(DBUPDATER, DEBUG) << "Removed " << removedCount << " orphan clusters";
     }
 
     void ScanStepRemoveOrphanDbFiles::removeOrphanArtists()
@@ -131,16 +197,8 @@ namespace Scanner
 
         LMS_LOG(DBUPDATER, DEBUG) << "Checking orphan artists...";
 
-        Session& session{ _db.getTLSSession() };
-        auto transaction{ session.createUniqueTransaction() };
-
-        auto artistIds{ Artist::findOrphanIds(session) };
-        for (const ArtistId artistId : artistIds.results)
-        {
-            Artist::pointer artist{ Artist::find(session, artistId) };
-            LMS_LOG(DBUPDATER, DEBUG) << "Removing orphan artist '" << artist->getName() << "'";
-            artist.remove();
-        }
+        const std::size_t removedCount{ removeOrphans<ArtistId>(_db.getTLSSession(), _abortScan, &Artist::findOrphanIds, &Artist::remove) };
+        LMS_LOG(DBUPDATER, DEBUG) << "Removed " << removedCount << " orphan artists";
     }
 
     void ScanStepRemoveOrphanDbFiles::removeOrphanReleases()
@@ -149,20 +207,53 @@ namespace Scanner
 
         LMS_LOG(DBUPDATER, DEBUG) << "Checking orphan releases...";
 
-        // TODO, by batch
-        Session& session{ _db.getTLSSession() };
-        auto transaction{ session.createUniqueTransaction() };
+        const std::size_t removedCount{ removeOrphans<ReleaseId>(_db.getTLSSession(), _abortScan, &Release::findOrphanIds, &Release::remove) };
+        LMS_LOG(DBUPDATER, DEBUG) << "Removed " << removedCount << " orphan releases";
+    }
+
+    // The checks only read the discovered files and the file system: they are run in parallel, and the results are kept in order
+    std::vector<Database::TrackId> ScanStepRemoveOrphanDbFiles::checkFiles(const std::vector<Database::Track::PathResult>& trackPaths, const ScanContext& context)
+    {
+        std::vector<char> isFileValid(trackPaths.size(), true);
+
+        // background priority: must not slow down the requests served meanwhile
+        parallelFor(*Service<TaskExecutor>::get(), TaskExecutor::Priority::Background, trackPaths.size(), _settings.parserThreadCount,
+            [&](std::size_t index)
+            {
+                _throttle.throttle(_abortScan);
+                if (_abortScan)
+                    return;
+
+                isFileValid[index] = checkFile(trackPaths[index].path, context);
+            });
+
+        std::vector<Database::TrackId> tracksToRemove;
+        for (std::size_t i{}; i < trackPaths.size(); ++i)
+        {
+            if (!isFileValid[i])
+                tracksToRemove.push_back(trackPaths[i].trackId);
+        }
 
-        auto releases{ Release::findOrphanIds(session) };
-        for (const ReleaseId releaseId : releases.results)
+        return tracksToRemove;
+    }
+
+    bool ScanStepRemoveOrphanDbFiles::checkFile(const std::filesystem::path& p, const ScanContext& context)
+    {
+        // The discovery step already found all the supported files that belong to the media directory
+        if (context.discoveredFiles.contains(p))
+            return true;
+
+        if (!context.discoveredFiles.isInUnexploredPath(p))
         {
-            Release::pointer release{ Release::find(session, releaseId) };
-            LMS_LOG(DBUPDATER, DEBUG) << "Removing orphan release '" << release->getName() << "'";
-            release.remove();
+            LMS_LOG(DBUPDATER, INFO) << "Removing '" << p.string() << "': not found in media directory";
+            return false;
         }
+
+        // Could not be discovered: check the file itself
+        return checkFileOnDisk(p);
     }
 
-    bool ScanStepRemoveOrphanDbFiles::checkFile(const std::filesystem::path& p)
+    bool ScanStepRemoveOrphanDbFiles::checkFileOnDisk(const std::filesystem::path& p)
     {
         try
         {
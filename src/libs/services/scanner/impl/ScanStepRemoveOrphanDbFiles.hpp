@@ -20,7 +20,9 @@
 #pragma once
 
 #include <filesystem>
+#include <vector>
 
+#include "services/database/Track.hpp"
 #include "ScanStepBase.hpp"
 
 namespace Scanner
@@ -36,9 +38,12 @@ namespace Scanner
 			void process(ScanContext& context) override;
 
 			void removeOrphanTracks(ScanContext& context);
+			void removeOrphanTracksInScope(ScanContext& context);
 			void removeOrphanClusters();
 			void removeOrphanArtists();
 			void removeOrphanReleases();
-			bool checkFile(const std::filesystem::path& p);
+			std::vector<Database::TrackId> checkFiles(const std::vector<Database::Track::PathResult>& trackPaths, const ScanContext& context);
+			bool checkFile(const std::filesystem::path& p, const ScanContext& context);
+			bool checkFileOnDisk(const std::filesystem::path& p);
 	};
 }
@@ -19,6 +19,9 @@
 
 #include "ScanStepScanFiles.hpp"
 
+#include <algorithm>
+#include <tuple>
+
 #include "metadata/IParser.hpp"
 #include "services/database/Artist.hpp"
 #include "services/database/Cluster.hpp"
@@ -27,12 +30,16 @@
 #include "services/database/Session.hpp"
 #include "services/database/Track.hpp"
 #include "services/database/TrackFeatures.hpp"
+#include "services/database/TrackMetadataCache.hpp"
 #include "services/database/TrackArtistLink.hpp"
 #include "utils/Exception.hpp"
 #include "utils/IConfig.hpp"
 #include "utils/Logger.hpp"
 #include "utils/Path.hpp"
 
+#include "ContentFingerprint.hpp"
+#include "ScanEntityCache.hpp"
+
 using namespace Database;
 
 namespace
@@ -51,11 +58,12 @@ namespace
     }
 
     void
-        updateArtistIfNeeded(Artist::pointer artist, const MetaData::Artist& artistInfo)
+        updateArtistIfNeeded(Scanner::ScanEntityCache& cache, Artist::pointer artist, const MetaData::Artist& artistInfo)
     {
         // Name may have been updated
         if (artist->getName() != artistInfo.name)
         {
+            cache.invalidateArtistName(artist->getName());
             artist.modify()->setName(artistInfo.name);
         }
 
@@ -67,7 +75,7 @@ namespace
     }
 
     std::vector<Artist::pointer>
-        getOrCreateArtists(Session& session, const std::vector<MetaData::Artist>& artistsInfo, bool allowFallbackOnMBIDEntries)
+        getOrCreateArtists(Session& session, Scanner::ScanEntityCache& cache, const std::vector<MetaData::Artist>& artistsInfo, bool allowFallbackOnMBIDEntries)
     {
         std::vector<Artist::pointer> artists;
 
@@ -78,35 +86,48 @@ namespace
             // First try to get by MBID
             if (artistInfo.mbid)
             {
-                artist = Artist::find(session, *artistInfo.mbid);
-                if (!artist)
-                    artist = createArtist(session, artistInfo);
+                Artist::pointer& cachedArtist{ cache.artistsByMBID[std::string{ artistInfo.mbid->getAsString() }] };
+                if (!cachedArtist)
+                    cachedArtist = Artist::find(session, *artistInfo.mbid);
+
+                if (!cachedArtist)
+                    cachedArtist = createArtist(session, artistInfo);
                 else
-                    updateArtistIfNeeded(artist, artistInfo);
+                    updateArtistIfNeeded(cache, cachedArtist, artistInfo);
 
-                artists.emplace_back(std::move(artist));
+                artists.push_back(cachedArtist);
                 continue;
             }
 
             // Fall back on artist name (collisions may occur)
             if (!artistInfo.name.empty())
             {
-                for (const Artist::pointer& sameNamedArtist : Artist::find(session, artistInfo.name))
+                const Scanner::ScanEntityCache::ArtistNameKey cacheKey{ artistInfo.name, allowFallbackOnMBIDEntries };
+
+                if (auto itCachedArtist{ cache.artistsByName.find(cacheKey) }; itCachedArtist != std::cend(cache.artistsByName))
                 {
-                    // Do not fallback on artist that is correctly tagged
-                    if (!allowFallbackOnMBIDEntries && sameNamedArtist->getMBID())
-                        continue;
+                    artist = itCachedArtist->second;
+                }
+                else
+                {
+                    for (const Artist::pointer& sameNamedArtist : Artist::find(session, artistInfo.name))
+                    {
+                        // Do not fallback on artist that is correctly tagged
+                        if (!allowFallbackOnMBIDEntries && sameNamedArtist->getMBID())
+                            continue;
 
-                    artist = sameNamedArtist;
-                    break;
+                        artist = sameNamedArtist;
+                        break;
+                    }
                 }
 
                 // No Artist found with the same name and without MBID -> creating
                 if (!artist)
                     artist = createArtist(session, artistInfo);
                 else
-                    updateArtistIfNeeded(artist, artistInfo);
+                    updateArtistIfNeeded(cache, artist, artistInfo);
 
+                cache.artistsByName[cacheKey] = artist;
                 artists.emplace_back(std::move(artist));
                 continue;
             }
@@ -177,10 +198,13 @@ namespace
     }
 
     void
-        updateReleaseIfNeeded(Release::pointer release, const MetaData::Release& releaseInfo)
+        updateReleaseIfNeeded(Scanner::ScanEntityCache& cache, Release::pointer release, const MetaData::Release& releaseInfo)
     {
         if (release->getName() != releaseInfo.name)
+        {
+            cache.invalidateReleaseName(release->getName());
             release.modify()->setName(releaseInfo.name);
+        }
         if (release->getTotalDisc() != releaseInfo.mediumCount)
             release.modify()->setTotalDisc(releaseInfo.mediumCount);
         if (releaseInfo.primaryType)
@@ -197,39 +221,49 @@ namespace
     }
 
     Release::pointer
-        getOrCreateRelease(Session& session, const MetaData::Release& releaseInfo)
+        getOrCreateRelease(Session& session, Scanner::ScanEntityCache& cache, const MetaData::Release& releaseInfo)
     {
         Release::pointer release;
 
         // First try to get by MBID
         if (releaseInfo.mbid)
         {
-            release = Release::find(session, *releaseInfo.mbid);
-            if (!release)
-                release = session.create<Release>(releaseInfo.name, releaseInfo.mbid);
-
-            updateReleaseIfNeeded(release, releaseInfo);
-            return release;
+            Release::pointer& cachedRelease{ cache.releasesByMBID[std::string{ releaseInfo.mbid->getAsString() }] };
+            if (!cachedRelease)
+                cachedRelease = Release::find(session, *releaseInfo.mbid);
+            if (!cachedRelease)
+                cachedRelease = session.create<Release>(releaseInfo.name, releaseInfo.mbid);
+
+            updateReleaseIfNeeded(cache, cachedRelease, releaseInfo);
+            return cachedRelease;
         }
 
         // Fall back on release name (collisions may occur)
         if (!releaseInfo.name.empty())
         {
-            for (const Release::pointer& sameNamedRelease : Release::find(session, releaseInfo.name))
+            if (auto itCachedRelease{ cache.releasesByName.find(releaseInfo.name) }; itCachedRelease != std::cend(cache.releasesByName))
             {
-                // do not fallback on properly tagged releases
-                if (sameNamedRelease->getMBID())
-                    continue;
+                release = itCachedRelease->second;
+            }
+            else
+            {
+                for (const Release::pointer& sameNamedRelease : Release::find(session, releaseInfo.name))
+                {
+                    // do not fallback on properly tagged releases
+                    if (sameNamedRelease->getMBID())
+                        continue;
 
-                release = sameNamedRelease;
-                break;
+                    release = sameNamedRelease;
+                    break;
+                }
             }
 
             // No release found with the same name and without MBID -> creating
             if (!release)
                 release = session.create<Release>(releaseInfo.name);
 
-            updateReleaseIfNeeded(release, releaseInfo);
+            updateReleaseIfNeeded(cache, release, releaseInfo);
+            cache.releasesByName[releaseInfo.name] = release;
             return release;
         }
 
@@ -237,19 +271,25 @@ namespace
     }
 
     std::vector<Cluster::pointer>
-        getOrCreateClusters(Session& session, const MetaData::Tags& tags)
+        getOrCreateClusters(Session& session, Scanner::ScanEntityCache& cache, const MetaData::Tags& tags)
     {
         std::vector<Cluster::pointer> clusters;
 
         for (const auto& [tag, values] : tags)
         {
-            auto clusterType = ClusterType::find(session, tag);
+            auto itClusterType{ cache.clusterTypes.find(tag) };
+            if (itClusterType == std::cend(cache.clusterTypes))
+                itClusterType = cache.clusterTypes.emplace(tag, ClusterType::find(session, tag)).first;
+
+            const ClusterType::pointer clusterType{ itClusterType->second };
             if (!clusterType)
                 continue;
 
-            for (auto clusterName : values)
+            for (const std::string& clusterName : values)
             {
-                auto cluster = clusterType->getCluster(clusterName);
+                Cluster::pointer& cluster{ cache.clusters[Scanner::ScanEntityCache::ClusterKey{ tag, clusterName }] };
+                if (!cluster)
+                    cluster = clusterType->getCluster(clusterName);
                 if (!cluster)
                     cluster = session.create<Cluster>(clusterType, clusterName);
 
@@ -274,13 +314,40 @@ namespace
 
         throw LmsException{ "Invalid value for 'scanner-parser-read-style'" };
     }
+
+    MetaData::ParserType
+        getParserType()
+    {
+        return Service<IConfig>::get()->getBool("scanner-parser-avformat-fallback", false) ? MetaData::ParserType::TagLibWithAvFormatFallback : MetaData::ParserType::TagLib;
+    }
+
+    std::vector<const Scanner::DiscoveredFiles::File*>
+        getFilesInScanOrder(const Scanner::DiscoveredFiles& discoveredFiles, bool diskOrder)
+    {
+        std::vector<const Scanner::DiscoveredFiles::File*> files;
+        files.reserve(discoveredFiles.size());
+        for (const Scanner::DiscoveredFiles::File& file : discoveredFiles.getFiles())
+            files.push_back(&file);
+
+        // inode order usually follows the on-disk layout, files whose inode is unknown are kept last, in directory order
+        if (diskOrder)
+        {
+            std::stable_sort(std::begin(files), std::end(files), [](const Scanner::DiscoveredFiles::File* lhs, const Scanner::DiscoveredFiles::File* rhs)
+                {
+                    return std::make_tuple(lhs->inode == 0, lhs->device, lhs->inode) < std::make_tuple(rhs->inode == 0, rhs->device, rhs->inode);
+                });
+        }
+
+        return files;
+    }
 } // namespace
 
 namespace Scanner
 {
     ScanStepScanFiles::ScanStepScanFiles(InitParams& initParams)
         : ScanStepBase{ initParams }
-        , _metadataParser{ MetaData::createParser(MetaData::ParserType::TagLib, getParserReadStyle()) } // For now, always use TagLib
+        // audio properties read fast, they are refined by a later step
+        , _metadataParser{ MetaData::createParser(getParserType(), initParams.settings.refineAudioProperties ? MetaData::ParserReadStyle::Fast : getParserReadStyle()) }
     {
     }
 
@@ -291,75 +358,309 @@ namespace Scanner
 
         context.currentStepStats.totalElems = context.stats.filesScanned;
 
-        PathUtils::exploreFilesRecursive(context.directory, [&](std::error_code ec, const std::filesystem::path& path)
+        _entityCache.clear();
+
+        const FileScanQueue::ReadParameters readParameters{ _settings.diskOrderScan && _settings.prefetchFileCount > 0, _settings.maxReadsPerDevice };
+        FileScanQueue fileScanQueue{ *_metadataParser, _settings.parserThreadCount, _settings.metadataCache, readParameters, _throttle, _abortScan, [this] { applyScanThreadPriority(_settings); } };
+        _metadataCacheHitCount = 0;
+        _lastWriteBatchTime = std::chrono::steady_clock::now();
+        _lastCheckpointTime = _lastWriteBatchTime;
+
+        // bound the memory used by pending parse requests
+        // when prefetching, the requests that are not being parsed yet are the prefetched files
+        const std::size_t maxOngoingScanCount{ readParameters.prefetch ? _settings.parserThreadCount + _settings.prefetchFileCount : _settings.parserThreadCount * 4 };
+
+        for (const DiscoveredFiles::File* discoveredFile : getFilesInScanOrder(context.discoveredFiles, _settings.diskOrderScan))
+        {
+            if (_abortScan)
+                break;
+
+            const std::filesystem::path path{ context.discoveredFiles.getPath(*discoveredFile) };
+            const Wt::WDateTime lastWriteTime{ Wt::WDateTime::fromTime_t(discoveredFile->lastWriteTime) };
+
+            if (checkFileNeedScan(path, lastWriteTime, discoveredFile->size, context))
+            {
+                if (!scanFromMetadataCache(path, lastWriteTime, discoveredFile->size, context, fileScanQueue))
+                    fileScanQueue.pushScanRequest(path, lastWriteTime, discoveredFile->size, discoveredFile->inode != 0 ? std::make_optional(discoveredFile->device) : std::nullopt);
+            }
+            else
             {
-                if (_abortScan)
-                    return false;
+                context.currentStepStats.processedElems++;
+                _progressCallback(context.currentStepStats);
+            }
 
-                if (ec)
-                {
-                    LMS_LOG(DBUPDATER, ERROR) << "Cannot process entry '" << path.string() << "': " << ec.message();
-                    context.stats.errors.emplace_back(ScanError{ path, ScanErrorType::CannotReadFile, ec.message() });
-                }
-                else if (PathUtils::hasFileAnyExtension(path, _settings.supportedExtensions))
-                {
-                    scanAudioFile(path, context);
+            processFileScanResults(fileScanQueue, context, false);
+            fileScanQueue.wait(maxOngoingScanCount);
+        }
 
-                    context.currentStepStats.processedElems++;
-                    _progressCallback(context.currentStepStats);
+        fileScanQueue.wait();
+        processFileScanResults(fileScanQueue, context, true);
+        _pendingMoves.clear(); // in case of abort
 
-                    // optimize the database during scan (if we import a very large database, it may be too late to do it once at end)
-                    if ((context.currentStepStats.processedElems % 1'000) == 0)
-                        _db.getTLSSession().optimize();
-                }
+        if (_metadataCacheHitCount > 0)
+            LMS_LOG(DBUPDATER, INFO) << "Updated " << _metadataCacheHitCount << " files using the metadata cache";
+
+        _entityCache.clear();
+        context.trackFileInfos.clear();
 
-                return true;
-            }, &excludeDirFileName);
+        // fingerprints are only valid once all the files of the directories have been processed
+        if (!_abortScan && _settings.skipUnchangedDirectories)
+            context.directoryFingerprints.save(_db.getTLSSession(), !context.isPartialScan());
+        context.directoryFingerprints.clear();
     }
 
-    void
-        ScanStepScanFiles::scanAudioFile(const std::filesystem::path& file, ScanContext& context)
+    bool
+        ScanStepScanFiles::checkFileNeedScan(const std::filesystem::path& file, const Wt::WDateTime& lastWriteTime, std::uintmax_t fileSize, ScanContext& context)
     {
         ScanStats& stats{ context.stats };
-        Wt::WDateTime lastWriteTime;
-        try
+
+        const TrackFileInfos::FileInfo* fileInfo{ context.trackFileInfos.find(file) };
+        // Skip file if last write is the same
+        // Forced scans resumed from a checkpoint also skip the files rescanned before the interruption
+        if (fileInfo
+            && fileInfo->lastWriteTime == lastWriteTime.toTime_t()
+            && fileInfo->scanVersion == _settings.scanVersion
+            && (!context.forceScan || (context.checkpoint && fileInfo->scanTime > context.checkpoint->startTime)))
         {
-            lastWriteTime = PathUtils::getLastWriteTime(file);
+            stats.skips++;
+            return false;
         }
-        catch (LmsException& e)
+
+        // Unknown file: may be a known track that has been moved or renamed
+        if (!fileInfo)
         {
-            LMS_LOG(DBUPDATER, ERROR) << e.what();
-            stats.skips++;
-            return;
+            bool needScan{ true };
+            if (checkFileMoved(file, lastWriteTime, fileSize, context, needScan) && !needScan)
+            {
+                stats.skips++;
+                return false;
+            }
         }
 
-        if (!context.forceScan)
+        return true;
+    }
+
+    bool
+        ScanStepScanFiles::scanFromMetadataCache(const std::filesystem::path& file, const Wt::WDateTime& lastWriteTime, std::uintmax_t fileSize, ScanContext& context, FileScanQueue& fileScanQueue)
+    {
+        // a forced scan means files have to be read again
+        if (!_settings.metadataCache || context.forceScan)
+            return false;
+
+        const TrackFileInfos::FileInfo* fileInfo{ context.trackFileInfos.find(file) };
+        if (!fileInfo || fileInfo->lastWriteTime != lastWriteTime.toTime_t())
+            return false;
+
+        const auto startTime{ std::chrono::steady_clock::now() };
+
+        std::vector<unsigned char> cacheData;
+        std::size_t cachedFileSize{};
         {
-            // Skip file if last write is the same
             Database::Session& dbSession{ _db.getTLSSession() };
-            auto transaction{ _db.getTLSSession().createSharedTransaction() };
+            auto transaction{ dbSession.createSharedTransaction() };
 
-            const Track::pointer track{ Track::findByPath(dbSession, file) };
+            const TrackMetadataCache::pointer cache{ TrackMetadataCache::find(dbSession, fileInfo->trackId) };
+            if (!cache
+                || cache->getFileLastWriteTime() != lastWriteTime
+                || (fileSize != 0 && cache->getFileSize() != fileSize))
+            {
+                return false;
+            }
+
+            cacheData = cache->getData();
+            cachedFileSize = cache->getFileSize();
+        }
 
-            if (track && track->getLastWriteTime().toTime_t() == lastWriteTime.toTime_t()
-                && track->getScanVersion() == _settings.scanVersion)
+        // mapped again using the current settings
+        std::optional<MetaData::Track> trackMetaData{ _metadataParser->parseFromCache(cacheData) };
+        if (!trackMetaData)
+            return false;
+
+        FileScanQueue::ScanResult result;
+        result.file = file;
+        result.lastWriteTime = lastWriteTime;
+        result.fileSize = cachedFileSize;
+        result.trackMetaData = std::move(trackMetaData);
+        result.parseDuration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime);
+        result.fromMetadataCache = true;
+        fileScanQueue.pushScanResult(std::move(result));
+
+        _metadataCacheHitCount++;
+        return true;
+    }
+
+    bool
+        ScanStepScanFiles::checkFileMoved(const std::filesystem::path& file, const Wt::WDateTime& lastWriteTime, std::uintmax_t fileSize, ScanContext& context, bool& needScan)
+    {
+        if (fileSize == 0 || !context.trackFileInfos.hasFileSize(fileSize))
+            return false;
+
+        const std::uint64_t contentFingerprint{ computeContentFingerprint(file, fileSize) };
+        if (contentFingerprint == 0)
+            return false;
+
+        const std::optional<TrackFileInfos::ContentInfo> contentInfo{ context.trackFileInfos.popByContentFingerprint(contentFingerprint) };
+        if (!contentInfo)
+            return false;
+
+        {
+            Database::Session& dbSession{ _db.getTLSSession() };
+            auto transaction{ dbSession.createSharedTransaction() };
+
+            const Track::pointer track{ Track::find(dbSession, contentInfo->trackId) };
+            if (!track)
+                return false;
+
+            // the original file is still there: this is a copy
+            std::error_code ec;
+            if (std::filesystem::exists(track->getPath(), ec))
+                return false;
+
+            LMS_LOG(DBUPDATER, DEBUG) << "Considering track '" << file.string() << "' moved from '" << track->getPath().string() << "' (same content)";
+        }
+
+        // applied before the next scan results are written, so that a rescan updates the moved track
+        _pendingMoves.push_back(PendingMove{ contentInfo->trackId, file, lastWriteTime });
+        needScan = context.forceScan || contentInfo->scanVersion != _settings.scanVersion;
+
+        return true;
+    }
+
+    void
+        ScanStepScanFiles::applyPendingMoves(ScanContext& context)
+    {
+        Database::Session& dbSession{ _db.getTLSSession() };
+        dbSession.checkUniqueLocked();
+
+        for (const PendingMove& pendingMove : _pendingMoves)
+        {
+            Track::pointer track{ Track::find(dbSession, pendingMove.trackId) };
+            if (!track)
+                continue;
+
+            track.modify()->setPath(pendingMove.file);
+            track.modify()->setLastWriteTime(pendingMove.lastWriteTime);
+            context.stats.updates++;
+        }
+
+        _pendingMoves.clear();
+    }
+
+    void
+        ScanStepScanFiles::processFileScanResults(FileScanQueue& fileScanQueue, ScanContext& context, bool flush)
+    {
+        // Group writes in order to limit the number of commits and database lock acquisitions
+        if (!flush
+            && fileScanQueue.getResultsCount() < _settings.writeBatchSize
+            && _pendingMoves.size() < _settings.writeBatchSize
+            && (std::chrono::steady_clock::now() - _lastWriteBatchTime) < _settings.writeBatchMaxDuration)
+        {
+            return;
+        }
+
+        while (!_abortScan)
+        {
+            const std::size_t processedElemsBefore{ context.currentStepStats.processedElems };
+            const std::size_t processedCount{ processFileScanResultBatch(fileScanQueue, context) };
+            if (processedCount == 0)
+                break;
+
+            // optimize the database during scan (if we import a very large database, it may be too late to do it once at end)
+            if ((processedElemsBefore / 1'000) != (context.currentStepStats.processedElems / 1'000))
+                _db.getTLSSession().optimize();
+
+            if (!flush && fileScanQueue.getResultsCount() < _settings.writeBatchSize)
+                break;
+        }
+
+        _lastWriteBatchTime = std::chrono::steady_clock::now();
+    }
+
+    std::size_t
+        ScanStepScanFiles::processFileScanResultBatch(FileScanQueue& fileScanQueue, ScanContext& context)
+    {
+        if (fileScanQueue.getResultsCount() == 0 && _pendingMoves.empty())
+            return 0;
+
+        std::size_t processedCount{};
+        std::filesystem::path lastScannedFile;
+
+        Database::Session& dbSession{ _db.getTLSSession() };
+        std::chrono::steady_clock::time_point commitStartTime;
+
+        {
+            auto uniqueTransaction{ dbSession.createUniqueTransaction() };
+
+            // the moved files already count as processed
+            processedCount += _pendingMoves.size();
+            applyPendingMoves(context);
+
+            const auto batchStartTime{ std::chrono::steady_clock::now() };
+            while (!_abortScan
+                && processedCount < _settings.writeBatchSize
+                && (std::chrono::steady_clock::now() - batchStartTime) < _settings.writeBatchMaxDuration)
             {
-                stats.skips++;
-                return;
+                std::optional<FileScanQueue::ScanResult> scanResult{ fileScanQueue.popResult() };
+                if (!scanResult)
+                    break;
+
+                const auto writeStartTime{ std::chrono::steady_clock::now() };
+                processFileScanResult(*scanResult, context);
+                context.stats.writeDurations.add(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - writeStartTime));
+                if (scanResult->trackMetaData)
+                    context.stats.parseDurations.add(scanResult->parseDuration);
+
+                processedCount++;
+                lastScannedFile = scanResult->file;
+
+                context.currentStepStats.processedElems++;
+                _progressCallback(context.currentStepStats);
             }
+
+            commitStartTime = std::chrono::steady_clock::now();
         }
+        context.stats.commitDurations.add(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - commitStartTime));
+
+        if (!lastScannedFile.empty())
+            saveCheckpoint(context, lastScannedFile);
 
-        std::optional<MetaData::Track> trackInfo{ _metadataParser->parse(file) };
+        return processedCount;
+    }
+
+    void
+        ScanStepScanFiles::saveCheckpoint(ScanContext& context, const std::filesystem::path& lastScannedFile)
+    {
+        if (!context.checkpoint)
+            return;
+
+        // the committed files are detected using their scan time anyway: the checkpoint content is only informative here
+        const auto now{ std::chrono::steady_clock::now() };
+        if (now - _lastCheckpointTime < std::chrono::seconds{ 10 })
+            return;
+
+        _lastCheckpointTime = now;
+        context.checkpoint->lastScannedDirectory = lastScannedFile.parent_path();
+        context.checkpoint->write(context.checkpointFile);
+    }
+
+    void
+        ScanStepScanFiles::processFileScanResult(const FileScanQueue::ScanResult& scanResult, ScanContext& context)
+    {
+        ScanStats& stats{ context.stats };
+        const std::filesystem::path& file{ scanResult.file };
+        const Wt::WDateTime& lastWriteTime{ scanResult.lastWriteTime };
+
+        const std::optional<MetaData::Track>& trackInfo{ scanResult.trackMetaData };
         if (!trackInfo)
         {
-            context.stats.errors.emplace_back(file, ScanErrorType::CannotParseFile);
+            context.stats.errors.add(ScanError{ file, ScanErrorType::CannotParseFile });
             return;
         }
 
         stats.scans++;
 
         Database::Session& dbSession{ _db.getTLSSession() };
-        auto uniqueTransaction{ dbSession.createUniqueTransaction() };
+        dbSession.checkUniqueLocked();
 
         Track::pointer track{ Track::findByPath(dbSession, file) };
 
@@ -416,7 +717,7 @@ namespace Scanner
                 track.remove();
                 stats.deletions++;
             }
-            stats.errors.emplace_back(ScanError{ file, ScanErrorType::BadDuration });
+            stats.errors.add(ScanError{ file, ScanErrorType::BadDuration });
             return;
         }
 
@@ -451,54 +752,61 @@ namespace Scanner
 
         track.modify()->clearArtistLinks();
         // Do not fallback on artists with the same name but having a MBID for artist and releaseArtists, as it may be corrected by properly tagging files
-        for (const Artist::pointer& artist : getOrCreateArtists(dbSession, trackInfo->artists, false))
+        for (const Artist::pointer& artist : getOrCreateArtists(dbSession, _entityCache, trackInfo->artists, false))
             track.modify()->addArtistLink(TrackArtistLink::create(dbSession, track, artist, TrackArtistLinkType::Artist));
 
         if (trackInfo->medium && trackInfo->medium->release)
         {
-            for (const Artist::pointer& releaseArtist : getOrCreateArtists(dbSession, trackInfo->medium->release->artists, false))
+            for (const Artist::pointer& releaseArtist : getOrCreateArtists(dbSession, _entityCache, trackInfo->medium->release->artists, false))
                 track.modify()->addArtistLink(TrackArtistLink::create(dbSession, track, releaseArtist, TrackArtistLinkType::ReleaseArtist));
         }
 
         // Allow fallbacks on artists with the same name even if they have MBID, since there is no tag to indicate the MBID of these artists
         // We could ask MusicBrainz to get all the information, but that would heavily slow down the import process
-        for (const Artist::pointer& conductor : getOrCreateArtists(dbSession, trackInfo->conductorArtists, true))
+        for (const Artist::pointer& conductor : getOrCreateArtists(dbSession, _entityCache, trackInfo->conductorArtists, true))
             track.modify()->addArtistLink(TrackArtistLink::create(dbSession, track, conductor, TrackArtistLinkType::Conductor));
 
-        for (const Artist::pointer& composer : getOrCreateArtists(dbSession, trackInfo->composerArtists, true))
+        for (const Artist::pointer& composer : getOrCreateArtists(dbSession, _entityCache, trackInfo->composerArtists, true))
             track.modify()->addArtistLink(TrackArtistLink::create(dbSession, track, composer, TrackArtistLinkType::Composer));
 
-        for (const Artist::pointer& lyricist : getOrCreateArtists(dbSession, trackInfo->lyricistArtists, true))
+        for (const Artist::pointer& lyricist : getOrCreateArtists(dbSession, _entityCache, trackInfo->lyricistArtists, true))
             track.modify()->addArtistLink(TrackArtistLink::create(dbSession, track, lyricist, TrackArtistLinkType::Lyricist));
 
-        for (const Artist::pointer& mixer : getOrCreateArtists(dbSession, trackInfo->mixerArtists, true))
+        for (const Artist::pointer& mixer : getOrCreateArtists(dbSession, _entityCache, trackInfo->mixerArtists, true))
             track.modify()->addArtistLink(TrackArtistLink::create(dbSession, track, mixer, TrackArtistLinkType::Mixer));
 
         for (const auto& [role, performers] : trackInfo->performerArtists)
         {
-            for (const Artist::pointer& performer : getOrCreateArtists(dbSession, performers, true))
+            for (const Artist::pointer& performer : getOrCreateArtists(dbSession, _entityCache, performers, true))
                 track.modify()->addArtistLink(TrackArtistLink::create(dbSession, track, performer, TrackArtistLinkType::Performer, role));
         }
 
-        for (const Artist::pointer& producer : getOrCreateArtists(dbSession, trackInfo->producerArtists, true))
+        for (const Artist::pointer& producer : getOrCreateArtists(dbSession, _entityCache, trackInfo->producerArtists, true))
             track.modify()->addArtistLink(TrackArtistLink::create(dbSession, track, producer, TrackArtistLinkType::Producer));
 
-        for (const Artist::pointer& remixer : getOrCreateArtists(dbSession, trackInfo->remixerArtists, true))
+        for (const Artist::pointer& remixer : getOrCreateArtists(dbSession, _entityCache, trackInfo->remixerArtists, true))
             track.modify()->addArtistLink(TrackArtistLink::create(dbSession, track, remixer, TrackArtistLinkType::Remixer));
 
         track.modify()->setScanVersion(_settings.scanVersion);
         if (trackInfo->medium && trackInfo->medium->release)
-            track.modify()->setRelease(getOrCreateRelease(dbSession, *trackInfo->medium->release));
+            track.modify()->setRelease(getOrCreateRelease(dbSession, _entityCache, *trackInfo->medium->release));
         else
             track.modify()->setRelease({});
         track.modify()->setTotalTrack(trackInfo->medium ? trackInfo->medium->trackCount : std::nullopt);
         track.modify()->setReleaseReplayGain(trackInfo->medium ? trackInfo->medium->replayGain : std::nullopt);
         track.modify()->setDiscSubtitle(trackInfo->medium ? trackInfo->medium->name : "");
-        track.modify()->setClusters(getOrCreateClusters(dbSession, trackInfo->tags));
+        track.modify()->setClusters(getOrCreateClusters(dbSession, _entityCache, trackInfo->tags));
         track.modify()->setLastWriteTime(lastWriteTime);
+        track.modify()->setFileSize(scanResult.fileSize);
+        if (!scanResult.fromMetadataCache) // the file did not change
+            track.modify()->setContentFingerprint(scanResult.contentFingerprint);
         track.modify()->setName(title);
         track.modify()->setDuration(trackInfo->duration);
         track.modify()->setBitrate(trackInfo->bitrate);
+        track.modify()->setAudioPropertiesPending(_settings.refineAudioProperties);
+        track.modify()->setAudioCodec(trackInfo->audioCodec);
+        track.modify()->setSampleRate(trackInfo->sampleRate);
+        track.modify()->setChannelCount(trackInfo->channelCount);
         track.modify()->setAddedTime(Wt::WDateTime::currentDateTime());
         track.modify()->setTrackNumber(trackInfo->position);
         track.modify()->setDiscNumber(trackInfo->medium ? trackInfo->medium->position : std::nullopt);
@@ -518,5 +826,16 @@ namespace Scanner
         track.modify()->setCopyrightURL(trackInfo->copyrightURL);
         track.modify()->setTrackReplayGain(trackInfo->replayGain);
         track.modify()->setArtistDisplayName(trackInfo->artistDisplayName);
+
+        if (!scanResult.metadataCacheData.empty())
+        {
+            TrackMetadataCache::pointer cache{ TrackMetadataCache::find(dbSession, track->getId()) };
+            if (!cache)
+                cache = dbSession.create<TrackMetadataCache>(track);
+
+            cache.modify()->setFileLastWriteTime(lastWriteTime);
+            cache.modify()->setFileSize(scanResult.fileSize);
+            cache.modify()->setData(scanResult.metadataCacheData);
+        }
     }
 }
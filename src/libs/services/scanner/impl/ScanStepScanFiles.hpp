@@ -19,9 +19,16 @@
 
 #pragma once
 
+#include <chrono>
 #include <filesystem>
+#include <vector>
+
+#include <Wt/WDateTime.h>
 
 #include "metadata/IParser.hpp"
+#include "services/database/TrackId.hpp"
+#include "FileScanQueue.hpp"
+#include "ScanEntityCache.hpp"
 #include "ScanStepBase.hpp"
 
 namespace Scanner
@@ -36,8 +43,28 @@ namespace Scanner
 			std::string_view getStepName() const override { return "Scanning files"; }
 			void process(ScanContext& context) override;
 
-			void scanAudioFile(const std::filesystem::path& file, ScanContext& context);
+			bool checkFileNeedScan(const std::filesystem::path& file, const Wt::WDateTime& lastWriteTime, std::uintmax_t fileSize, ScanContext& context);
+			bool scanFromMetadataCache(const std::filesystem::path& file, const Wt::WDateTime& lastWriteTime, std::uintmax_t fileSize, ScanContext& context, FileScanQueue& fileScanQueue);
+			bool checkFileMoved(const std::filesystem::path& file, const Wt::WDateTime& lastWriteTime, std::uintmax_t fileSize, ScanContext& context, bool& needScan);
+			void processFileScanResults(FileScanQueue& fileScanQueue, ScanContext& context, bool flush);
+			void applyPendingMoves(ScanContext& context);
+			std::size_t processFileScanResultBatch(FileScanQueue& fileScanQueue, ScanContext& context);
+			void saveCheckpoint(ScanContext& context, const std::filesystem::path& lastScannedFile);
+			void processFileScanResult(const FileScanQueue::ScanResult& scanResult, ScanContext& context);
 
 			std::unique_ptr<MetaData::IParser>			_metadataParser;
+			std::chrono::steady_clock::time_point		_lastWriteBatchTime;
+			std::chrono::steady_clock::time_point		_lastCheckpointTime;
+			ScanEntityCache								_entityCache;
+			std::size_t									_metadataCacheHitCount{};
+
+			// tracks whose file has been found elsewhere, with the same content
+			struct PendingMove
+			{
+				Database::TrackId		trackId;
+				std::filesystem::path	file;
+				Wt::WDateTime			lastWriteTime;
+			};
+			std::vector<PendingMove>					_pendingMoves;
 	};
 }
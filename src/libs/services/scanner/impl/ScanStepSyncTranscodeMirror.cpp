@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ScanStepSyncTranscodeMirror.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "av/TranscodeMirror.hpp"
+#include "services/database/Db.hpp"
+#include "services/database/Listen.hpp"
+#include "services/database/Session.hpp"
+#include "services/database/Track.hpp"
+#include "utils/Logger.hpp"
+
+namespace Scanner
+{
+    void ScanStepSyncTranscodeMirror::process(ScanContext& context)
+    {
+        using namespace Database;
+
+        // the mirror is synced on the next full scan
+        if (context.isPartialScan() || _abortScan)
+            return;
+
+        Session& dbSession{ _db.getTLSSession() };
+
+        // most played first, so that they are the ones kept when the quota is reached
+        std::vector<TrackId> trackIds;
+        {
+            auto transaction{ dbSession.createSharedTransaction() };
+
+            trackIds = Listen::getTopTracks(dbSession, _settings.transcodeMirrorTrackCount > 0 ? std::make_optional(Range{ 0, _settings.transcodeMirrorTrackCount }) : std::nullopt).results;
+            if (_settings.transcodeMirrorTrackCount == 0)
+            {
+                const std::unordered_set<TrackId> playedTrackIds(std::cbegin(trackIds), std::cend(trackIds));
+                for (const TrackId trackId : Track::findIds(dbSession, Track::FindParameters{}).results)
+                {
+                    if (playedTrackIds.find(trackId) == std::cend(playedTrackIds))
+                        trackIds.push_back(trackId);
+                }
+            }
+        }
+
+        std::vector<Av::Transcoding::InputParameters> tracks;
+        tracks.reserve(trackIds.size());
+        for (std::size_t batchBegin{}; batchBegin < trackIds.size() && !_abortScan; batchBegin += _settings.writeBatchSize)
+        {
+            const std::size_t batchEnd{ std::min(batchBegin + _settings.writeBatchSize, trackIds.size()) };
+
+            auto transaction{ dbSession.createSharedTransaction() };
+
+            for (std::size_t i{ batchBegin }; i < batchEnd; ++i)
+            {
+                const Track::pointer track{ Track::find(dbSession, trackIds[i]) };
+                if (!track)
+                    continue;
+
+                Av::Transcoding::InputParameters& inputParameters{ tracks.emplace_back() };
+                inputParameters.trackPath = track->getPath();
+                inputParameters.duration = track->getDuration();
+                inputParameters.codec = Av::getDecodingCodec(track->getAudioCodec());
+                inputParameters.bitrate = track->getBitrate();
+            }
+        }
+
+        if (_abortScan)
+            return;
+
+        context.currentStepStats.totalElems = tracks.size();
+        _progressCallback(context.currentStepStats);
+
+        // transcoded on the scanner thread, using its priority (see scanner-thread-niceness and scanner-idle-io-priority)
+        const Av::Transcoding::Mirror::SyncStats stats{ Av::Transcoding::Mirror::sync(tracks, _abortScan, [&](std::size_t processedTrackCount)
+            {
+                context.currentStepStats.processedElems = processedTrackCount;
+                _progressCallback(context.currentStepStats);
+
+                _throttle.throttle(_abortScan);
+            }) };
+
+        if (!_abortScan)
+        {
+            context.currentStepStats.processedElems = tracks.size();
+            _progressCallback(context.currentStepStats);
+        }
+
+        LMS_LOG(DBUPDATER, DEBUG) << "Transcode mirror: " << stats.mirroredCount << " entries, added = " << stats.addedCount << ", removed = " << stats.removedCount << ", skipped = " << stats.skippedCount << ", failed = " << stats.failedCount;
+    }
+}
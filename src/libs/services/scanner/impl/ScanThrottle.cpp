@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ScanThrottle.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "utils/Logger.hpp"
+#include "utils/UserActivity.hpp"
+
+namespace Scanner
+{
+    namespace
+    {
+        id_t getCurrentThreadId()
+        {
+#if defined(__linux__)
+            // on Linux, the niceness of a thread id only applies to that thread
+            return static_cast<id_t>(::syscall(SYS_gettid));
+#else
+            return 0; // whole process
+#endif
+        }
+
+#if defined(__linux__) && defined(SYS_ioprio_set)
+        // from linux/ioprio.h, not always installed
+        constexpr int ioprioWhoProcess{ 1 };
+        constexpr int ioprioClassIdle{ 3 };
+        constexpr int ioprioClassShift{ 13 };
+#endif
+    }
+
+    ScanThrottle::ScanThrottle(const ScannerSettings& settings)
+        : _settings{ settings }
+    {
+    }
+
+    void ScanThrottle::throttle(const bool& abort)
+    {
+        if (!_settings.throttle)
+            return;
+
+        const std::int64_t now{ std::chrono::steady_clock::now().time_since_epoch().count() };
+        std::int64_t lastUpdateTime{ _lastUpdateTime.load(std::memory_order_relaxed) };
+        // only one of the scan threads updates the delay for each period
+        if (std::chrono::steady_clock::duration{ now - lastUpdateTime } >= _updatePeriod
+            && _lastUpdateTime.compare_exchange_strong(lastUpdateTime, now, std::memory_order_relaxed))
+        {
+            updateDelay();
+        }
+
+        const std::chrono::milliseconds delay{ _delayMs.load(std::memory_order_relaxed) };
+        if (delay.count() == 0)
+            return;
+
+        // sleep by small slices to abort quickly
+        const auto start{ std::chrono::steady_clock::now() };
+        const auto end{ start + delay };
+        for (auto current{ start }; current < end && !abort; current = std::chrono::steady_clock::now())
+            std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(end - current, _updatePeriod));
+
+        _throttledDurationMs.fetch_add(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+    }
+
+    void ScanThrottle::reset()
+    {
+        _delayMs.store(0, std::memory_order_relaxed);
+        _throttledDurationMs.store(0, std::memory_order_relaxed);
+    }
+
+    std::chrono::milliseconds ScanThrottle::getThrottledDuration() const
+    {
+        return std::chrono::milliseconds{ _throttledDurationMs.load(std::memory_order_relaxed) };
+    }
+
+    void ScanThrottle::updateDelay()
+    {
+        const std::int64_t delayMs{ _delayMs.load(std::memory_order_relaxed) };
+        std::int64_t newDelayMs;
+
+        if (!isInMaintenanceWindow() && isUserActive())
+            newDelayMs = std::clamp<std::int64_t>(delayMs * 2, _minDelay.count(), std::max(_minDelay, _settings.throttleMaxDelay).count());
+        else
+            newDelayMs = delayMs / 2 < _minDelay.count() ? 0 : delayMs / 2;
+
+        if ((newDelayMs == 0) != (delayMs == 0))
+            LMS_LOG(DBUPDATER, DEBUG) << (newDelayMs ? "Throttling scan: users are active" : "Scan no longer throttled");
+
+        _delayMs.store(newDelayMs, std::memory_order_relaxed);
+    }
+
+    bool ScanThrottle::isUserActive() const
+    {
+        const UserActivity::Stats stats{ UserActivity::getStats() };
+
+        if (_settings.throttleStreamCount > 0 && stats.ongoingStreamCount >= _settings.throttleStreamCount)
+            return true;
+
+        if (_settings.throttleRequestLatency.count() > 0 && stats.requestLatency >= _settings.throttleRequestLatency)
+            return true;
+
+        return false;
+    }
+
+    bool ScanThrottle::isInMaintenanceWindow() const
+    {
+        const Wt::WTime& start{ _settings.maintenanceWindowStart };
+        const Wt::WTime& end{ _settings.maintenanceWindowEnd };
+        if (!start.isValid() || !end.isValid() || start == end)
+            return false;
+
+        const Wt::WTime now{ Wt::WDateTime::currentDateTime().time() };
+        if (start < end)
+            return now >= start && now < end;
+
+        // across midnight
+        return now >= start || now < end;
+    }
+
+    void applyScanThreadPriority(const ScannerSettings& settings)
+    {
+        if (settings.threadNiceness != 0)
+        {
+            if (::setpriority(PRIO_PROCESS, getCurrentThreadId(), settings.threadNiceness) != 0)
+                LMS_LOG(DBUPDATER, ERROR) << "Cannot set scan thread niceness to " << settings.threadNiceness << ": " << ::strerror(errno);
+        }
+
+        if (settings.idleIoPriority)
+        {
+#if defined(__linux__) && defined(SYS_ioprio_set)
+            if (::syscall(SYS_ioprio_set, ioprioWhoProcess, 0, ioprioClassIdle << ioprioClassShift) != 0)
+                LMS_LOG(DBUPDATER, ERROR) << "Cannot set scan thread I/O priority: " << ::strerror(errno);
+#else
+            LMS_LOG(DBUPDATER, WARNING) << "I/O priorities not supported on this platform";
+#endif
+        }
+    }
+} // namespace Scanner
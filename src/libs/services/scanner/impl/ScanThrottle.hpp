@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "ScannerSettings.hpp"
+
+namespace Scanner
+{
+    // Slows the scan down while users are active (slow requests, ongoing streams)
+    // The delay doubles while the activity stays above the thresholds, and halves back once it is below
+    // Nothing is throttled in the maintenance window
+    class ScanThrottle
+    {
+    public:
+        ScanThrottle(const ScannerSettings& settings);
+
+        ScanThrottle(const ScanThrottle&) = delete;
+        ScanThrottle& operator=(const ScanThrottle&) = delete;
+
+        // Called by the scan threads before each unit of work (file parse, ...), may sleep
+        void throttle(const bool& abort);
+
+        void reset();
+        std::chrono::milliseconds getThrottledDuration() const; // since last reset, summed over all the threads
+
+    private:
+        void updateDelay();
+        bool isUserActive() const;
+        bool isInMaintenanceWindow() const;
+
+        static constexpr std::chrono::milliseconds _updatePeriod{ 100 };
+        static constexpr std::chrono::milliseconds _minDelay{ 10 };
+
+        const ScannerSettings& _settings;
+        std::atomic<std::int64_t> _lastUpdateTime{}; // steady clock ticks
+        std::atomic<std::int64_t> _delayMs{};
+        std::atomic<std::int64_t> _throttledDurationMs{};
+    };
+
+    // Lowers the CPU and I/O priorities of the calling thread, as set in the settings
+    void applyScanThreadPriority(const ScannerSettings& settings);
+} // namespace Scanner
@@ -20,22 +20,34 @@
 #include "ScannerService.hpp"
 
 #include <ctime>
+#include <fstream>
+#include <thread>
 #include <boost/asio/placeholders.hpp>
 
+#include "av/TranscodeMirror.hpp"
+#include "services/database/Backup.hpp"
 #include "services/database/Cluster.hpp"
+#include "services/database/ClusterIndex.hpp"
+#include "services/database/LibraryCatalog.hpp"
 #include "services/database/TrackFeatures.hpp"
 #include "services/database/ScanSettings.hpp"
 #include "utils/Exception.hpp"
 #include "utils/IConfig.hpp"
 #include "utils/Logger.hpp"
 #include "utils/Path.hpp"
+#include "utils/String.hpp"
 #include "utils/Tuple.hpp"
 
 #include "ScanStepCheckDuplicatedDbFiles.hpp"
 #include "ScanStepDiscoverFiles.hpp"
+#include "ScanStepExtractTrackFeatures.hpp"
+#include "ScanStepGenerateCovers.hpp"
+#include "ScanStepRefineAudioProperties.hpp"
 #include "ScanStepRemoveOrphanDbFiles.hpp"
 #include "ScanStepScanFiles.hpp"
 #include "ScanStepComputeClusterStats.hpp"
+#include "ScanStepComputeSeekTables.hpp"
+#include "ScanStepSyncTranscodeMirror.hpp"
 
 namespace Scanner
 {
@@ -62,6 +74,57 @@ namespace Scanner
 
             return current;
         }
+
+        std::size_t getParserThreadCount()
+        {
+            const std::size_t configThreadCount{ Service<IConfig>::get()->getULong("scanner-parser-thread-count", 0) };
+
+            return configThreadCount ? configThreadCount : std::max<std::size_t>(1, std::thread::hardware_concurrency() / 2);
+        }
+
+        std::vector<std::size_t> getCoverPregenerationWidths()
+        {
+            std::vector<std::size_t> res;
+
+            Service<IConfig>::get()->visitStrings("scanner-cover-pregeneration-widths", [&](std::string_view width)
+                {
+                    if (const std::optional<std::size_t> value{ StringUtils::readAs<std::size_t>(width) }; value && *value > 0)
+                        res.push_back(*value);
+                    else
+                        LMS_LOG(DBUPDATER, ERROR) << "Invalid cover pre-generation width '" << width << "'";
+                });
+
+            return res;
+        }
+
+        // "hh:mm", null time if not set or invalid
+        Wt::WTime getTimeSetting(std::string_view setting)
+        {
+            const std::string value{ Service<IConfig>::get()->getString(setting, "") };
+            if (value.empty())
+                return {};
+
+            const std::vector<std::string_view> values{ StringUtils::splitString(value, ":") };
+            const std::optional<int> hours{ values.size() == 2 ? StringUtils::readAs<int>(values[0]) : std::nullopt };
+            const std::optional<int> minutes{ values.size() == 2 ? StringUtils::readAs<int>(values[1]) : std::nullopt };
+            if (hours && minutes && *hours >= 0 && *hours < 24 && *minutes >= 0 && *minutes < 60)
+                return Wt::WTime{ *hours, *minutes };
+
+            LMS_LOG(DBUPDATER, ERROR) << "Invalid time '" << value << "' for setting '" << setting << "'";
+            return {};
+        }
+
+        std::string_view scanErrorTypeToString(ScanErrorType errorType)
+        {
+            switch (errorType)
+            {
+            case ScanErrorType::CannotReadFile: return "cannot read file";
+            case ScanErrorType::CannotParseFile: return "cannot parse file";
+            case ScanErrorType::NoAudioTrack: return "no audio track";
+            case ScanErrorType::BadDuration: return "bad duration";
+            }
+            return "?";
+        }
     } // namespace
 
     std::unique_ptr<IScannerService> createScannerService(Db& db)
@@ -71,10 +134,16 @@ namespace Scanner
 
     ScannerService::ScannerService(Db& db)
         : _db{ db }
-        , _dbSession{ db }
+        , _dbSession{ db, ConnectionPriority::Background }
+        , _replicaSnapshotDirectory{ Service<IConfig>::get()->getPath("db-replica-snapshot-dir") }
+        , _replicaRefreshPeriod{ std::max<unsigned long>(1, Service<IConfig>::get()->getULong("db-replica-refresh-period", 60)) }
+        , _checkpointFile{ Service<IConfig>::get()->getPath("working-dir") / "scan-checkpoint" }
     {
         _ioService.setThreadCount(1);
 
+        if (isReplica())
+            LMS_LOG(DBUPDATER, INFO) << "Read-only replica: database refreshed from the snapshots in '" << _replicaSnapshotDirectory.string() << "'";
+
         refreshScanSettings();
 
         start();
@@ -93,10 +162,20 @@ namespace Scanner
 
         _ioService.post([this]
             {
+                // the scan steps use the sessions of the scanner thread
+                Db::setThreadPriority(ConnectionPriority::Background);
+
                 if (_abortScan)
                     return;
 
-                scheduleNextScan();
+                // run on the scanner thread, so that the indexes cannot be built while a scan is in progress
+                buildInMemoryIndexes();
+
+                // resume the full scan interrupted by a restart or an abort
+                if (!isReplica() && getResumableCheckpoint())
+                    scheduleScan(false);
+                else
+                    scheduleNextScan();
             });
 
         _ioService.start();
@@ -109,6 +188,8 @@ namespace Scanner
         _abortScan = true;
         _scheduleTimer.cancel();
         _ioService.stop();
+
+        _mediaDirectoryWatcher.reset();
     }
 
     void ScannerService::abortScan()
@@ -139,6 +220,32 @@ namespace Scanner
             });
     }
 
+    void ScannerService::requestImmediatePartialScan(const std::vector<std::filesystem::path>& paths, bool force)
+    {
+        if (paths.empty())
+            return;
+
+        _ioService.post([=]()
+            {
+                if (_abortScan)
+                    return;
+
+                // the media directory is only read from the scanner thread
+                std::vector<std::filesystem::path> scopedPaths;
+                for (const std::filesystem::path& path : paths)
+                {
+                    std::filesystem::path scopedPath{ (path.is_absolute() ? path : _settings.mediaDirectory / path).lexically_normal() };
+                    if (!scopedPath.has_filename())
+                        scopedPath = scopedPath.parent_path(); // trailing separator
+
+                    LMS_LOG(DBUPDATER, INFO) << "Partial scan requested for '" << scopedPath.string() << "'";
+                    scopedPaths.push_back(std::move(scopedPath));
+                }
+
+                scan(force, scopedPaths);
+            });
+    }
+
     void ScannerService::requestReload()
     {
         abortScan();
@@ -165,6 +272,31 @@ namespace Scanner
         return res;
     }
 
+    void ScannerService::buildInMemoryIndexes()
+    {
+        {
+            auto transaction{ _dbSession.createSharedTransaction() };
+            _db.setClusterIndex(ClusterIndex::build(_dbSession));
+        }
+
+        refreshLibraryCatalog();
+    }
+
+    void ScannerService::refreshLibraryCatalog()
+    {
+        if (!_db.isLibraryCatalogEnabled())
+            return;
+
+        const auto startTime{ std::chrono::steady_clock::now() };
+        {
+            auto transaction{ _dbSession.createSharedTransaction() };
+            _db.setLibraryCatalog(LibraryCatalog::build(_dbSession, _db.getClusterIndex()));
+        }
+        const auto duration{ std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime) };
+
+        LMS_LOG(DBUPDATER, DEBUG) << "Library catalog built in " << duration.count() << "ms";
+    }
+
     void ScannerService::scheduleNextScan()
     {
         LMS_LOG(DBUPDATER, DEBUG) << "Scheduling next scan";
@@ -174,36 +306,43 @@ namespace Scanner
         const Wt::WDateTime now{ Wt::WDateTime::currentDateTime() };
 
         Wt::WDateTime nextScanDateTime;
-        switch (_settings.updatePeriod)
+        if (isReplica())
         {
-        case ScanSettings::UpdatePeriod::Daily:
-            if (now.time() < _settings.startTime)
-                nextScanDateTime = { now.date(), _settings.startTime };
-            else
-                nextScanDateTime = { now.date().addDays(1), _settings.startTime };
-            break;
-
-        case ScanSettings::UpdatePeriod::Weekly:
-            if (now.time() < _settings.startTime && now.date().dayOfWeek() == 1)
-                nextScanDateTime = { now.date(), _settings.startTime };
-            else
-                nextScanDateTime = { getNextMonday(now.date()), _settings.startTime };
-            break;
-
-        case ScanSettings::UpdatePeriod::Monthly:
-            if (now.time() < _settings.startTime && now.date().day() == 1)
-                nextScanDateTime = { now.date(), _settings.startTime };
-            else
-                nextScanDateTime = { getNextFirstOfMonth(now.date()), _settings.startTime };
-            break;
-
-        case ScanSettings::UpdatePeriod::Hourly:
-            nextScanDateTime = { now.date(), now.time().addSecs(3600) };
-            break;
-
-        case ScanSettings::UpdatePeriod::Never:
-            LMS_LOG(DBUPDATER, INFO) << "Auto scan disabled!";
-            break;
+            nextScanDateTime = now.addSecs(static_cast<int>(_replicaRefreshPeriod.count()));
+        }
+        else
+        {
+            switch (_settings.updatePeriod)
+            {
+            case ScanSettings::UpdatePeriod::Daily:
+                if (now.time() < _settings.startTime)
+                    nextScanDateTime = { now.date(), _settings.startTime };
+                else
+                    nextScanDateTime = { now.date().addDays(1), _settings.startTime };
+                break;
+
+            case ScanSettings::UpdatePeriod::Weekly:
+                if (now.time() < _settings.startTime && now.date().dayOfWeek() == 1)
+                    nextScanDateTime = { now.date(), _settings.startTime };
+                else
+                    nextScanDateTime = { getNextMonday(now.date()), _settings.startTime };
+                break;
+
+            case ScanSettings::UpdatePeriod::Monthly:
+                if (now.time() < _settings.startTime && now.date().day() == 1)
+                    nextScanDateTime = { now.date(), _settings.startTime };
+                else
+                    nextScanDateTime = { getNextFirstOfMonth(now.date()), _settings.startTime };
+                break;
+
+            case ScanSettings::UpdatePeriod::Hourly:
+                nextScanDateTime = { now.date(), now.time().addSecs(3600) };
+                break;
+
+            case ScanSettings::UpdatePeriod::Never:
+                LMS_LOG(DBUPDATER, INFO) << "Auto scan disabled!";
+                break;
+            }
         }
 
         if (nextScanDateTime.isValid())
@@ -246,42 +385,122 @@ namespace Scanner
         }
     }
 
-    void ScannerService::scan(bool forceScan)
+    void ScannerService::scan(bool forceScan, const std::vector<std::filesystem::path>& scopedPaths)
     {
+        if (isReplica())
+        {
+            refreshReplica();
+            return;
+        }
+
+        const bool partialScan{ !scopedPaths.empty() };
+
         _events.scanStarted.emit();
 
+        // the catalog would not reflect the changes made by this scan
+        _db.setLibraryCatalog(nullptr);
+
         {
             std::unique_lock lock{ _statusMutex };
             _curState = State::InProgress;
-            _nextScheduledScan = {};
+            if (!partialScan)
+                _nextScheduledScan = {};
         }
 
 
-        LMS_LOG(UI, INFO) << "New scan started!";
+        LMS_LOG(UI, INFO) << "New " << (partialScan ? "partial " : "") << "scan started!";
 
         refreshScanSettings();
+        applyScanThreadPriority(_settings); // the scan steps mostly run on the scanner thread
 
-        IScanStep::ScanContext scanContext{ _settings.mediaDirectory, forceScan, ScanStats {}, ScanStepStats {} };
+        // partial scans are short, they just run again
+        std::optional<ScanCheckpoint> checkpoint;
+        if (!partialScan)
+        {
+            checkpoint = getResumableCheckpoint();
+            if (checkpoint && forceScan && !checkpoint->forceScan)
+                checkpoint.reset(); // a new forced scan must not skip the files rescanned by the interrupted one
+
+            if (checkpoint)
+            {
+                LMS_LOG(DBUPDATER, INFO) << "Resuming " << (checkpoint->forceScan ? "forced " : "") << "scan interrupted in step " << static_cast<unsigned>(checkpoint->step)
+                    << (checkpoint->lastScannedDirectory.empty() ? "" : ", after directory '" + checkpoint->lastScannedDirectory.string() + "'");
+
+                // files rescanned before the interruption are skipped, the other ones are forced again
+                forceScan = checkpoint->forceScan;
+            }
+            else
+            {
+                checkpoint = ScanCheckpoint{ _settings.scanVersion, _settings.mediaDirectory, forceScan, std::time(nullptr) };
+            }
+        }
+
+        IScanStep::ScanContext scanContext{ _settings.mediaDirectory, forceScan, scopedPaths, ScanStats {}, ScanStepStats {}, DiscoveredFiles {}, TrackFileInfos {}, DirectoryFingerprints {} };
+        scanContext.checkpoint = checkpoint;
+        scanContext.checkpointFile = _checkpointFile;
         ScanStats& stats{ scanContext.stats };
+        if (partialScan)
+            collectScopedEntities(_dbSession, scanContext); // entities the scan may detach tracks from
         stats.startTime = Wt::WDateTime::currentDateTime();
+        stats.errors.setMaxSampleCount(_settings.maxErrorSampleCount);
+        _throttle.reset();
+
+        // all the errors, whereas the stats only keep the first ones
+        std::ofstream errorLog;
+        if (!_settings.errorLogFile.empty())
+        {
+            errorLog.open(_settings.errorLogFile, std::ios_base::out | std::ios_base::trunc);
+            if (errorLog)
+            {
+                stats.errors.setSink([&](const ScanError& error)
+                    {
+                        errorLog << error.file.string() << " - " << scanErrorTypeToString(error.error);
+                        if (!error.systemError.empty())
+                            errorLog << ": " << error.systemError;
+                        errorLog << '\n';
+                    });
+            }
+            else
+                LMS_LOG(DBUPDATER, ERROR) << "Cannot open scan error log file '" << _settings.errorLogFile.string() << "'";
+        }
 
         for (auto& scanStep : _scanSteps)
         {
             LMS_LOG(DBUPDATER, DEBUG) << "Starting scan step '" << scanStep->getStepName() << "'";
             scanContext.currentStepStats = ScanStepStats{ Wt::WDateTime::currentDateTime(), scanStep->getStep() };
+            if (scanContext.checkpoint)
+            {
+                scanContext.checkpoint->step = scanStep->getStep();
+                scanContext.checkpoint->write(_checkpointFile);
+            }
 
             notifyInProgress(scanContext.currentStepStats);
+            const auto stepStartTime{ std::chrono::steady_clock::now() };
             scanStep->process(scanContext);
+            const auto stepDuration{ std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - stepStartTime) };
             notifyInProgress(scanContext.currentStepStats);
-            LMS_LOG(DBUPDATER, DEBUG) << "Completed scan step '" << scanStep->getStepName() << "'";
+
+            stats.stepPerfs.push_back(ScanStepPerf{ scanStep->getStep(), stepDuration, scanContext.currentStepStats.processedElems });
+            LMS_LOG(DBUPDATER, DEBUG) << "Completed scan step '" << scanStep->getStepName() << "' in " << stepDuration.count() << "ms (" << scanContext.currentStepStats.processedElems << " elements)";
         }
+        stats.errors.setSink({}); // the stats outlive the error log
+
+        LMS_LOG(DBUPDATER, INFO) << "Scan " << (_abortScan ? "aborted" : "complete") << ". Changes = " << stats.nbChanges() << " (added = " << stats.additions << ", removed = " << stats.deletions << ", updated = " << stats.updates << "), Not changed = " << stats.skips << ", Scanned = " << stats.scans << " (errors = " << stats.errors.getCount() << "), features fetched = " << stats.featuresFetched << ",  duplicates = " << stats.duplicates.size();
 
-        LMS_LOG(DBUPDATER, INFO) << "Scan " << (_abortScan ? "aborted" : "complete") << ". Changes = " << stats.nbChanges() << " (added = " << stats.additions << ", removed = " << stats.deletions << ", updated = " << stats.updates << "), Not changed = " << stats.skips << ", Scanned = " << stats.scans << " (errors = " << stats.errors.size() << "), features fetched = " << stats.featuresFetched << ",  duplicates = " << stats.duplicates.size();
+        LMS_LOG(DBUPDATER, INFO) << "Scan perf: " << stats.getScannedFilesPerSecond() << " scanned files/s"
+            << ", parse mean = " << stats.parseDurations.getMean().count() << "us (p95 = " << stats.parseDurations.getPercentile(95).count() << "us)"
+            << ", write mean = " << stats.writeDurations.getMean().count() << "us (p95 = " << stats.writeDurations.getPercentile(95).count() << "us)"
+            << ", commit mean = " << stats.commitDurations.getMean().count() << "us (p95 = " << stats.commitDurations.getPercentile(95).count() << "us)"
+            << ", throttled = " << _throttle.getThrottledDuration().count() << "ms";
 
         _dbSession.analyze();
+        refreshLibraryCatalog();
 
         if (!_abortScan)
         {
+            if (scanContext.checkpoint)
+                ScanCheckpoint::remove(_checkpointFile);
+
             stats.stopTime = Wt::WDateTime::currentDateTime();
             {
                 std::unique_lock lock{ _statusMutex };
@@ -290,8 +509,17 @@ namespace Scanner
                 _currentScanStepStats.reset();
             }
 
-            LMS_LOG(DBUPDATER, DEBUG) << "Scan not aborted, scheduling next scan!";
-            scheduleNextScan();
+            if (partialScan)
+            {
+                // the next scheduled scan is still pending
+                std::unique_lock lock{ _statusMutex };
+                _curState = _nextScheduledScan.isValid() ? State::Scheduled : State::NotScheduled;
+            }
+            else
+            {
+                LMS_LOG(DBUPDATER, DEBUG) << "Scan not aborted, scheduling next scan!";
+                scheduleNextScan();
+            }
 
             _events.scanComplete.emit(stats);
         }
@@ -306,6 +534,77 @@ namespace Scanner
         }
     }
 
+    std::optional<ScanCheckpoint> ScannerService::getResumableCheckpoint() const
+    {
+        std::optional<ScanCheckpoint> checkpoint{ ScanCheckpoint::read(_checkpointFile) };
+        if (!checkpoint)
+            return checkpoint;
+
+        // a new scan version or media directory means every file is scanned again anyway
+        if (checkpoint->scanVersion != _settings.scanVersion || checkpoint->mediaDirectory != _settings.mediaDirectory)
+        {
+            LMS_LOG(DBUPDATER, DEBUG) << "Scan checkpoint does not match the current scan settings";
+            checkpoint.reset();
+        }
+
+        return checkpoint;
+    }
+
+    void ScannerService::refreshReplica()
+    {
+        const std::vector<std::filesystem::path> snapshots{ BackupService::findBackups(_replicaSnapshotDirectory) };
+        if (snapshots.empty() || snapshots.back() == _lastReplicaSnapshot)
+        {
+            LMS_LOG(DBUPDATER, DEBUG) << "No new database snapshot";
+            scheduleNextScan();
+            return;
+        }
+
+        _events.scanStarted.emit();
+        {
+            std::unique_lock lock{ _statusMutex };
+            _curState = State::InProgress;
+            _nextScheduledScan = {};
+        }
+
+        LMS_LOG(DBUPDATER, INFO) << "Refreshing replica using '" << snapshots.back().string() << "'...";
+
+        ScanStats stats;
+        stats.startTime = Wt::WDateTime::currentDateTime();
+
+        // the in-memory indexes would not match the new content
+        _db.setLibraryCatalog(nullptr);
+        _db.setClusterIndex(nullptr);
+        try
+        {
+            {
+                auto uniqueTransaction{ _dbSession.createUniqueTransaction() };
+                BackupService::restoreBackup(_dbSession, snapshots.back());
+            }
+            _lastReplicaSnapshot = snapshots.back();
+
+            // the whole database may have changed: reported as a change so that all the caches are invalidated
+            stats.updates = 1;
+        }
+        catch (const std::exception& e)
+        {
+            LMS_LOG(DBUPDATER, ERROR) << "Cannot refresh replica: " << e.what();
+        }
+        buildInMemoryIndexes();
+
+        stats.stopTime = Wt::WDateTime::currentDateTime();
+        LMS_LOG(DBUPDATER, INFO) << "Replica refresh complete in " << std::chrono::duration_cast<std::chrono::milliseconds>(stats.stopTime.toTimePoint() - stats.startTime.toTimePoint()).count() << " ms";
+
+        {
+            std::unique_lock lock{ _statusMutex };
+            _lastCompleteScanStats = stats;
+            _currentScanStepStats.reset();
+        }
+
+        scheduleNextScan();
+        _events.scanComplete.emit(stats);
+    }
+
     void ScannerService::refreshScanSettings()
     {
         ScannerSettings newSettings{ readSettings() };
@@ -314,10 +613,31 @@ namespace Scanner
 
         LMS_LOG(DBUPDATER, DEBUG) << "Scanner settings updated";
         LMS_LOG(DBUPDATER, DEBUG) << "skipDuplicateMBID = " << newSettings.skipDuplicateMBID;
+        LMS_LOG(DBUPDATER, DEBUG) << "parserThreadCount = " << newSettings.parserThreadCount;
+        LMS_LOG(DBUPDATER, DEBUG) << "writeBatchSize = " << newSettings.writeBatchSize << ", writeBatchMaxDuration = " << newSettings.writeBatchMaxDuration.count() << "ms";
+        LMS_LOG(DBUPDATER, DEBUG) << "skipUnchangedDirectories = " << newSettings.skipUnchangedDirectories;
+        LMS_LOG(DBUPDATER, DEBUG) << "metadataCache = " << newSettings.metadataCache;
+        LMS_LOG(DBUPDATER, DEBUG) << "refineAudioProperties = " << newSettings.refineAudioProperties;
+        LMS_LOG(DBUPDATER, DEBUG) << "diskOrderScan = " << newSettings.diskOrderScan << ", prefetchFileCount = " << newSettings.prefetchFileCount << ", maxReadsPerDevice = " << newSettings.maxReadsPerDevice;
+        LMS_LOG(DBUPDATER, DEBUG) << "watchMediaDirectory = " << newSettings.watchMediaDirectory << ", watchDebounceDelay = " << newSettings.watchDebounceDelay.count() << "s";
+        LMS_LOG(DBUPDATER, DEBUG) << "coverPregenerationWidthCount = " << newSettings.coverPregenerationWidths.size() << ", coverPregenerationThreadCount = " << newSettings.coverPregenerationThreadCount;
+        LMS_LOG(DBUPDATER, DEBUG) << "seekTableMinDuration = " << newSettings.seekTableMinDuration.count() << "min, seekTableInterval = " << newSettings.seekTableInterval.count() << "s";
+        LMS_LOG(DBUPDATER, DEBUG) << "transcodeMirrorTrackCount = " << newSettings.transcodeMirrorTrackCount;
+        LMS_LOG(DBUPDATER, DEBUG) << "featuresExtractor = '" << newSettings.featuresExtractor.string() << "', featuresExtractionProcessCount = " << newSettings.featuresExtractionProcessCount;
+        LMS_LOG(DBUPDATER, DEBUG) << "throttle = " << newSettings.throttle << ", throttleRequestLatency = " << newSettings.throttleRequestLatency.count() << "ms, throttleStreamCount = " << newSettings.throttleStreamCount << ", throttleMaxDelay = " << newSettings.throttleMaxDelay.count() << "ms";
+        LMS_LOG(DBUPDATER, DEBUG) << "maintenanceWindow = " << newSettings.maintenanceWindowStart.toString("hh:mm").toUTF8() << " - " << newSettings.maintenanceWindowEnd.toString("hh:mm").toUTF8();
+        LMS_LOG(DBUPDATER, DEBUG) << "threadNiceness = " << newSettings.threadNiceness << ", idleIoPriority = " << newSettings.idleIoPriority;
         LMS_LOG(DBUPDATER, DEBUG) << "Using scan settings version " << newSettings.scanVersion;
 
+        const bool watcherSettingsChanged{ _settings.mediaDirectory != newSettings.mediaDirectory
+            || _settings.watchMediaDirectory != newSettings.watchMediaDirectory
+            || _settings.watchDebounceDelay != newSettings.watchDebounceDelay };
+
         _settings = std::move(newSettings);
 
+        if (watcherSettingsChanged && !isReplica())
+            refreshMediaDirectoryWatcher();
+
         auto cbFunc{ [this](const ScanStepStats& stats)
             {
                 notifyInProgressIfNeeded(stats);
@@ -328,7 +648,8 @@ namespace Scanner
             _settings,
             cbFunc,
             _abortScan,
-            _db
+            _db,
+            _throttle
         };
 
         _scanSteps.clear();
@@ -337,6 +658,42 @@ namespace Scanner
         _scanSteps.push_back(std::make_unique<ScanStepRemoveOrphanDbFiles>(params));
         _scanSteps.push_back(std::make_unique<ScanStepComputeClusterStats>(params));
         _scanSteps.push_back(std::make_unique<ScanStepCheckDuplicatedDbFiles>(params));
+        if (!_settings.coverPregenerationWidths.empty())
+            _scanSteps.push_back(std::make_unique<ScanStepGenerateCovers>(params));
+        // always added: tracks may still be pending after the option has been disabled
+        _scanSteps.push_back(std::make_unique<ScanStepRefineAudioProperties>(params));
+        // after the refinement: seek tables are selected using the track durations
+        if (_settings.seekTableMinDuration.count() > 0)
+            _scanSteps.push_back(std::make_unique<ScanStepComputeSeekTables>(params));
+        if (!_settings.featuresExtractor.empty())
+            _scanSteps.push_back(std::make_unique<ScanStepExtractTrackFeatures>(params));
+        // last: the longest step, the library is already up to date when it runs
+        if (Av::Transcoding::Mirror::isEnabled())
+            _scanSteps.push_back(std::make_unique<ScanStepSyncTranscodeMirror>(params));
+    }
+
+    void ScannerService::refreshMediaDirectoryWatcher()
+    {
+        _mediaDirectoryWatcher.reset();
+
+        if (!_settings.watchMediaDirectory || _settings.mediaDirectory.empty())
+            return;
+
+        auto onChanges{ [this](const std::vector<std::filesystem::path>& changedPaths)
+            {
+                // called from the watcher thread
+                _ioService.post([this, changedPaths]
+                    {
+                        if (_abortScan)
+                            return;
+
+                        scan(false, changedPaths);
+                    });
+            } };
+
+        auto watcher{ std::make_unique<MediaDirectoryWatcher>(std::move(onChanges), _settings.watchDebounceDelay) };
+        if (watcher->start(_settings.mediaDirectory, ScanStepBase::excludeDirFileName))
+            _mediaDirectoryWatcher = std::move(watcher);
     }
 
     ScannerSettings ScannerService::readSettings()
@@ -344,6 +701,36 @@ namespace Scanner
         ScannerSettings newSettings;
 
         newSettings.skipDuplicateMBID = Service<IConfig>::get()->getBool("scanner-skip-duplicate-mbid", false);
+        newSettings.parserThreadCount = getParserThreadCount();
+        newSettings.writeBatchSize = std::max<std::size_t>(1, Service<IConfig>::get()->getULong("scanner-write-batch-size", 100));
+        newSettings.writeBatchMaxDuration = std::chrono::milliseconds{ Service<IConfig>::get()->getULong("scanner-write-batch-max-duration", 500) };
+        newSettings.skipUnchangedDirectories = Service<IConfig>::get()->getBool("scanner-skip-unchanged-directories", false);
+        newSettings.metadataCache = Service<IConfig>::get()->getBool("scanner-metadata-cache", false);
+        newSettings.maxErrorSampleCount = Service<IConfig>::get()->getULong("scanner-max-reported-error-count", 1000);
+        newSettings.errorLogFile = Service<IConfig>::get()->getPath("scanner-error-log-file");
+        newSettings.refineAudioProperties = Service<IConfig>::get()->getBool("scanner-refine-audio-properties", false);
+        newSettings.directoryReadConcurrency = std::max<std::size_t>(1, Service<IConfig>::get()->getULong("scanner-directory-read-concurrency", 8));
+        newSettings.diskOrderScan = Service<IConfig>::get()->getBool("scanner-disk-order-scan", false);
+        newSettings.prefetchFileCount = Service<IConfig>::get()->getULong("scanner-prefetch-file-count", 16);
+        newSettings.maxReadsPerDevice = Service<IConfig>::get()->getULong("scanner-max-reads-per-device", 0);
+        newSettings.watchMediaDirectory = Service<IConfig>::get()->getBool("scanner-watch-media-directory", false);
+        newSettings.watchDebounceDelay = std::chrono::seconds{ Service<IConfig>::get()->getULong("scanner-watch-debounce-delay", 10) };
+        newSettings.coverPregenerationWidths = getCoverPregenerationWidths();
+        newSettings.coverPregenerationThreadCount = std::max<std::size_t>(1, Service<IConfig>::get()->getULong("scanner-cover-pregeneration-thread-count", 1));
+        newSettings.seekTableMinDuration = std::chrono::minutes{ Service<IConfig>::get()->getULong("scanner-seek-table-min-duration", 0) };
+        newSettings.seekTableInterval = std::chrono::seconds{ std::max<unsigned long>(1, Service<IConfig>::get()->getULong("scanner-seek-table-interval", 10)) };
+        newSettings.transcodeMirrorTrackCount = Service<IConfig>::get()->getULong("transcode-mirror-track-count", 0);
+        newSettings.featuresExtractor = Service<IConfig>::get()->getPath("scanner-features-extractor");
+        newSettings.featuresExtractorProfile = Service<IConfig>::get()->getPath("scanner-features-extractor-profile");
+        newSettings.featuresExtractionProcessCount = std::max<std::size_t>(1, Service<IConfig>::get()->getULong("scanner-features-extraction-process-count", 1));
+        newSettings.throttle = Service<IConfig>::get()->getBool("scanner-throttle", false);
+        newSettings.throttleRequestLatency = std::chrono::milliseconds{ Service<IConfig>::get()->getULong("scanner-throttle-request-latency", 200) };
+        newSettings.throttleStreamCount = Service<IConfig>::get()->getULong("scanner-throttle-stream-count", 1);
+        newSettings.throttleMaxDelay = std::chrono::milliseconds{ Service<IConfig>::get()->getULong("scanner-throttle-max-delay", 1000) };
+        newSettings.maintenanceWindowStart = getTimeSetting("scanner-maintenance-window-start");
+        newSettings.maintenanceWindowEnd = getTimeSetting("scanner-maintenance-window-end");
+        newSettings.threadNiceness = std::clamp<int>(Service<IConfig>::get()->getLong("scanner-thread-niceness", 0), -20, 19);
+        newSettings.idleIoPriority = Service<IConfig>::get()->getBool("scanner-idle-io-priority", false);
         {
             auto transaction{ _dbSession.createSharedTransaction() };
 
@@ -20,6 +20,7 @@
 #pragma once
 
 #include <chrono>
+#include <memory>
 #include <shared_mutex>
 #include <optional>
 #include <vector>
@@ -36,7 +37,10 @@
 #include "services/scanner/IScannerService.hpp"
 #include "utils/Path.hpp"
 #include "IScanStep.hpp"
+#include "MediaDirectoryWatcher.hpp"
+#include "ScanCheckpoint.hpp"
 #include "ScannerSettings.hpp"
+#include "ScanThrottle.hpp"
 
 namespace Scanner
 {
@@ -51,6 +55,7 @@ namespace Scanner
 
         void requestReload() override;
         void requestImmediateScan(bool force) override;
+        void requestImmediatePartialScan(const std::vector<std::filesystem::path>& paths, bool force) override;
 
         Status	getStatus() const override;
         Events& getEvents() override { return _events; }
@@ -66,14 +71,25 @@ namespace Scanner
         void abortScan();
 
         // Update database (scheduled callback)
-        void scan(bool force);
+        // Partial scans only process the given paths and leave the schedule untouched
+        void scan(bool force, const std::vector<std::filesystem::path>& scopedPaths = {});
 
         void scanMediaDirectory(const std::filesystem::path& mediaDirectory, bool forceScan, ScanStats& stats);
 
+        // checkpoint of an interrupted full scan that can be resumed with the current settings
+        std::optional<ScanCheckpoint> getResumableCheckpoint() const;
+
         // Helpers
         void refreshScanSettings();
+        void refreshMediaDirectoryWatcher();
         ScannerSettings readSettings();
         void reloadRecommendationService();
+        void buildInMemoryIndexes();
+        void refreshLibraryCatalog();
+
+        // Read-only replicas get their database from the snapshots made by the primary node, instead of scanning
+        bool isReplica() const { return !_replicaSnapshotDirectory.empty(); }
+        void refreshReplica();
 
         void notifyInProgressIfNeeded(const ScanStepStats& stats);
         void notifyInProgress(const ScanStepStats& stats);
@@ -97,6 +113,12 @@ namespace Scanner
         Wt::WDateTime						_nextScheduledScan;
 
         ScannerSettings						_settings;
+        ScanThrottle						_throttle{ _settings };
+        const std::filesystem::path				_replicaSnapshotDirectory;
+        const std::chrono::seconds				_replicaRefreshPeriod;
+        std::filesystem::path					_lastReplicaSnapshot;
+        std::unique_ptr<MediaDirectoryWatcher>	_mediaDirectoryWatcher;
+        const std::filesystem::path				_checkpointFile;
     };
 } // Scanner
 
@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <filesystem>
 #include <set>
 #include <string>
@@ -36,7 +37,37 @@ namespace Scanner
 		std::vector<std::filesystem::path>					supportedExtensions;
 		std::filesystem::path								mediaDirectory;
 		bool												skipDuplicateMBID {};
+		std::size_t											parserThreadCount {1};
+		std::size_t											writeBatchSize {100};				// max parsed files written in a single transaction
+		std::chrono::milliseconds							writeBatchMaxDuration {500};		// max time spent in a single write transaction
+		bool												skipUnchangedDirectories {};		// trust database info for files in directories whose fingerprint did not change
+		std::size_t											directoryReadConcurrency {8};		// max directories read at the same time
+		bool												diskOrderScan {};					// parse files in inode order, prefetching the next ones
+		std::size_t											prefetchFileCount {16};				// files prefetched ahead of the parsers, if diskOrderScan
+		std::size_t											maxReadsPerDevice {};				// 0 means unlimited
+		bool												metadataCache {};					// store the parser results, so that unchanged files do not have to be read again when the scan version changes
+		std::size_t											maxErrorSampleCount {1000};			// errors kept in the scan stats, the other ones are only counted
+		std::filesystem::path								errorLogFile;						// all the errors of the last scan, empty if not written
+		bool												refineAudioProperties {};			// fast parse first, then read duration and bitrate again accurately in a last step
+		bool												watchMediaDirectory {};
+		std::chrono::seconds								watchDebounceDelay {10};			// quiet time before changes are scanned
 		std::set<std::string>								clusterTypeNames;
+		std::vector<std::size_t>							coverPregenerationWidths;			// empty if covers are not pre-generated
+		std::size_t											coverPregenerationThreadCount {1};
+		std::chrono::minutes								seekTableMinDuration {};			// seek tables are computed for the tracks at least this long, 0 to disable
+		std::chrono::seconds								seekTableInterval {10};				// between two seek points
+		std::size_t											transcodeMirrorTrackCount {};		// most played tracks mirrored, 0 means the whole library
+		std::filesystem::path								featuresExtractor;					// empty if features are not extracted
+		std::filesystem::path								featuresExtractorProfile;			// optional
+		std::size_t											featuresExtractionProcessCount {1};
+		bool												throttle {};						// slow down while users are active
+		std::chrono::milliseconds							throttleRequestLatency {200};		// users are active above this request latency, 0 to ignore
+		std::size_t											throttleStreamCount {1};			// users are active from this ongoing stream count, 0 to ignore
+		std::chrono::milliseconds							throttleMaxDelay {1000};			// max sleep before each unit of work
+		Wt::WTime											maintenanceWindowStart;				// not throttled between start and end
+		Wt::WTime											maintenanceWindowEnd;
+		int													threadNiceness {};					// 0 means unchanged
+		bool												idleIoPriority {};
 
 		bool operator==(const ScannerSettings& rhs) const
 		{
@@ -46,7 +77,37 @@ namespace Scanner
 				&& supportedExtensions == rhs.supportedExtensions
 				&& mediaDirectory == rhs.mediaDirectory
 				&& skipDuplicateMBID == rhs.skipDuplicateMBID
-				&& clusterTypeNames == rhs.clusterTypeNames;
+				&& parserThreadCount == rhs.parserThreadCount
+				&& writeBatchSize == rhs.writeBatchSize
+				&& writeBatchMaxDuration == rhs.writeBatchMaxDuration
+				&& skipUnchangedDirectories == rhs.skipUnchangedDirectories
+				&& directoryReadConcurrency == rhs.directoryReadConcurrency
+				&& diskOrderScan == rhs.diskOrderScan
+				&& prefetchFileCount == rhs.prefetchFileCount
+				&& maxReadsPerDevice == rhs.maxReadsPerDevice
+				&& metadataCache == rhs.metadataCache
+				&& maxErrorSampleCount == rhs.maxErrorSampleCount
+				&& errorLogFile == rhs.errorLogFile
+				&& refineAudioProperties == rhs.refineAudioProperties
+				&& watchMediaDirectory == rhs.watchMediaDirectory
+				&& watchDebounceDelay == rhs.watchDebounceDelay
+				&& clusterTypeNames == rhs.clusterTypeNames
+				&& coverPregenerationWidths == rhs.coverPregenerationWidths
+				&& coverPregenerationThreadCount == rhs.coverPregenerationThreadCount
+				&& seekTableMinDuration == rhs.seekTableMinDuration
+				&& seekTableInterval == rhs.seekTableInterval
+				&& transcodeMirrorTrackCount == rhs.transcodeMirrorTrackCount
+				&& featuresExtractor == rhs.featuresExtractor
+				&& featuresExtractorProfile == rhs.featuresExtractorProfile
+				&& featuresExtractionProcessCount == rhs.featuresExtractionProcessCount
+				&& throttle == rhs.throttle
+				&& throttleRequestLatency == rhs.throttleRequestLatency
+				&& throttleStreamCount == rhs.throttleStreamCount
+				&& throttleMaxDelay == rhs.throttleMaxDelay
+				&& maintenanceWindowStart == rhs.maintenanceWindowStart
+				&& maintenanceWindowEnd == rhs.maintenanceWindowEnd
+				&& threadNiceness == rhs.threadNiceness
+				&& idleIoPriority == rhs.idleIoPriority;
 		}
 	};
 }
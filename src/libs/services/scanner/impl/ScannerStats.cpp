@@ -19,6 +19,8 @@
 
 #include "services/scanner/ScannerStats.hpp"
 
+#include <algorithm>
+
 namespace Scanner {
 
 ScanError::ScanError(const std::filesystem::path& _file, ScanErrorType _error, const std::string& _systemError)
@@ -28,6 +30,19 @@ systemError {_systemError}
 {
 }
 
+void
+ScanErrors::add(ScanError&& error)
+{
+	_count++;
+	_countByType[static_cast<std::size_t>(error.error)]++;
+
+	if (_sink)
+		_sink(error);
+
+	if (_samples.size() < _maxSampleCount)
+		_samples.push_back(std::move(error));
+}
+
 std::size_t
 ScanStats::nbFiles() const
 {
@@ -40,6 +55,63 @@ ScanStats::nbChanges() const
 	return additions + deletions + updates;
 }
 
+float
+ScanStats::getScannedFilesPerSecond() const
+{
+	auto itStepPerf {std::find_if(std::cbegin(stepPerfs), std::cend(stepPerfs), [](const ScanStepPerf& stepPerf) { return stepPerf.step == ScanStep::ScanningFiles; })};
+	if (itStepPerf == std::cend(stepPerfs) || itStepPerf->duration.count() == 0)
+		return 0;
+
+	return scans / (itStepPerf->duration.count() / 1000.f);
+}
+
+void
+DurationHistogram::add(std::chrono::microseconds duration)
+{
+	std::size_t bucket {};
+	while (bucket < bucketCount - 1 && duration.count() >= (static_cast<std::chrono::microseconds::rep>(1) << bucket))
+		bucket++;
+
+	buckets[bucket]++;
+	count++;
+	total += duration;
+	max = std::max(max, duration);
+}
+
+std::chrono::microseconds
+DurationHistogram::getMean() const
+{
+	if (count == 0)
+		return {};
+
+	return total / static_cast<std::chrono::microseconds::rep>(count);
+}
+
+std::chrono::microseconds
+DurationHistogram::getPercentile(unsigned percentile) const
+{
+	if (count == 0)
+		return {};
+
+	const std::size_t threshold {std::max<std::size_t>(1, (count * std::min(percentile, 100u) + 99) / 100)};
+
+	std::size_t cumulatedCount {};
+	for (std::size_t bucket {}; bucket < bucketCount; ++bucket)
+	{
+		cumulatedCount += buckets[bucket];
+		if (cumulatedCount >= threshold)
+			return bucket == bucketCount - 1 ? max : std::min(max, std::chrono::microseconds {static_cast<std::chrono::microseconds::rep>(1) << bucket});
+	}
+
+	return max;
+}
+
+float
+ScanStepPerf::getElemsPerSecond() const
+{
+	return duration.count() ? processedElems / (duration.count() / 1000.f) : 0;
+}
+
 unsigned
 ScanStepStats::progress() const
 {
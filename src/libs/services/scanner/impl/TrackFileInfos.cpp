@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TrackFileInfos.hpp"
+
+#include <string>
+
+#include "services/database/Session.hpp"
+#include "services/database/Track.hpp"
+#include "utils/Logger.hpp"
+
+namespace Scanner
+{
+    namespace
+    {
+        std::size_t getPathHash(const std::filesystem::path& file)
+        {
+            return std::hash<std::string>{}(file.string());
+        }
+    }
+
+    void TrackFileInfos::load(Database::Session& dbSession)
+    {
+        clear();
+
+        auto transaction{ dbSession.createSharedTransaction() };
+
+        _fileInfos.reserve(Database::Track::getCount(dbSession));
+        Database::Track::findFileInfos(dbSession, [&](const Database::Track::FileInfoResult& fileInfo)
+            {
+                const Entry entry{ FileInfo{ fileInfo.trackId, fileInfo.lastWriteTime.toTime_t(), static_cast<std::uint32_t>(fileInfo.scanVersion), fileInfo.addedTime.toTime_t() }, false };
+
+                auto [it, inserted]{ _fileInfos.emplace(getPathHash(fileInfo.path), entry) };
+                if (!inserted)
+                    it->second.hashCollision = true;
+
+                // tracks scanned before the fingerprints were introduced just have no content info
+                if (fileInfo.contentFingerprint != 0 && fileInfo.fileSize != 0)
+                {
+                    _fileSizes.insert(fileInfo.fileSize);
+
+                    const ContentEntry contentEntry{ ContentInfo{ fileInfo.trackId, static_cast<std::uint32_t>(fileInfo.scanVersion) }, false };
+                    auto [itContent, contentInserted]{ _contentInfos.emplace(fileInfo.contentFingerprint, contentEntry) };
+                    if (!contentInserted)
+                        itContent->second.duplicate = true;
+                }
+            });
+
+        LMS_LOG(DBUPDATER, DEBUG) << "Loaded file info of " << _fileInfos.size() << " tracks";
+    }
+
+    void TrackFileInfos::clear()
+    {
+        _fileInfos.clear();
+        _fileSizes.clear();
+        _contentInfos.clear();
+    }
+
+    const TrackFileInfos::FileInfo* TrackFileInfos::find(const std::filesystem::path& file) const
+    {
+        const auto it{ _fileInfos.find(getPathHash(file)) };
+        if (it == std::cend(_fileInfos) || it->second.hashCollision)
+            return nullptr;
+
+        return &it->second.fileInfo;
+    }
+
+    std::optional<TrackFileInfos::ContentInfo> TrackFileInfos::popByContentFingerprint(std::uint64_t contentFingerprint)
+    {
+        std::optional<ContentInfo> res;
+
+        const auto it{ _contentInfos.find(contentFingerprint) };
+        if (it == std::cend(_contentInfos))
+            return res;
+
+        // the same content may show up in several new places, only the first one gets the track
+        if (!it->second.duplicate)
+            res = it->second.contentInfo;
+        _contentInfos.erase(it);
+
+        return res;
+    }
+} // namespace Scanner
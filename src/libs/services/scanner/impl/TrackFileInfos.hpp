@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "services/database/TrackId.hpp"
+
+namespace Database
+{
+    class Session;
+}
+
+namespace Scanner
+{
+    // Compact snapshot of the tracks in database, used to quickly skip unchanged files
+    class TrackFileInfos
+    {
+    public:
+        struct FileInfo
+        {
+            Database::TrackId	trackId;
+            std::time_t			lastWriteTime;
+            std::uint32_t		scanVersion;
+            std::time_t			scanTime; // last (re)scan
+        };
+
+        struct ContentInfo
+        {
+            Database::TrackId	trackId;
+            std::uint32_t		scanVersion;
+        };
+
+        void load(Database::Session& session);
+        void clear();
+        std::size_t size() const { return _fileInfos.size(); }
+
+        // nullptr if the file is unknown or cannot be identified for sure
+        const FileInfo* find(const std::filesystem::path& file) const;
+
+        // Cheap check to avoid computing the content fingerprint of files that cannot match any track
+        bool hasFileSize(std::uintmax_t fileSize) const { return _fileSizes.find(fileSize) != std::cend(_fileSizes); }
+
+        // Unique track having this content, if any. Once matched, a content is not reported again
+        std::optional<ContentInfo> popByContentFingerprint(std::uint64_t contentFingerprint);
+
+    private:
+        struct Entry
+        {
+            FileInfo	fileInfo;
+            bool		hashCollision; // several tracks share the same path hash, cannot be used to skip files
+        };
+        std::unordered_map<std::size_t /* path hash */, Entry>	_fileInfos;
+
+        struct ContentEntry
+        {
+            ContentInfo	contentInfo;
+            bool		duplicate; // several tracks share the same content
+        };
+        std::unordered_set<std::uintmax_t>							_fileSizes;
+        std::unordered_map<std::uint64_t /* fingerprint */, ContentEntry>	_contentInfos;
+    };
+} // namespace Scanner
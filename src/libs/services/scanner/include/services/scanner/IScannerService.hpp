@@ -19,7 +19,9 @@
 
 #pragma once
 
+#include <filesystem>
 #include <optional>
+#include <vector>
 
 #include "ScannerEvents.hpp"
 #include "ScannerStats.hpp"
@@ -40,6 +42,9 @@ namespace Scanner
 			// Async requests
 			virtual void requestReload() = 0;
 			virtual void requestImmediateScan(bool force) = 0;
+			// Only scans the given files or directories (absolute, or relative to the media directory), leaving the schedule untouched
+			// Queued after the scan in progress, if any
+			virtual void requestImmediatePartialScan(const std::vector<std::filesystem::path>& paths, bool force) = 0;
 
 			enum class State
 			{
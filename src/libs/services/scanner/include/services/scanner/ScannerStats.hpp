@@ -21,7 +21,11 @@
 
 #include <Wt/WDateTime.h>
 
+#include <array>
+#include <chrono>
 #include <filesystem>
+#include <functional>
+#include <string>
 #include <vector>
 
 #include "services/database/TrackId.hpp"
@@ -35,6 +39,7 @@ namespace Scanner
         NoAudioTrack,			// no audio track found
         BadDuration,			// bad duration
     };
+    static inline constexpr std::size_t ScanErrorTypeCount{ 4 };
 
     enum class DuplicateReason
     {
@@ -51,6 +56,29 @@ namespace Scanner
         ScanError(const std::filesystem::path& file, ScanErrorType error, const std::string& systemError = "");
     };
 
+    // All the errors are counted, but only the first ones are kept: some libraries have a lot of unreadable files
+    class ScanErrors
+    {
+    public:
+        using Sink = std::function<void(const ScanError&)>;
+
+        void setMaxSampleCount(std::size_t maxSampleCount) { _maxSampleCount = maxSampleCount; }
+        void setSink(Sink sink) { _sink = std::move(sink); } // called on each error, including the ones that are not kept
+
+        void add(ScanError&& error);
+
+        std::size_t getCount() const { return _count; }
+        std::size_t getCount(ScanErrorType type) const { return _countByType[static_cast<std::size_t>(type)]; }
+        const std::vector<ScanError>& getSamples() const { return _samples; } // in order of occurrence
+
+    private:
+        std::size_t									_maxSampleCount{ 1000 };
+        std::size_t									_count{};
+        std::array<std::size_t, ScanErrorTypeCount>	_countByType{};
+        std::vector<ScanError>						_samples;
+        Sink										_sink;
+    };
+
     struct ScanDuplicate
     {
         Database::TrackId	trackId;
@@ -66,8 +94,13 @@ namespace Scanner
         FetchingTrackFeatures,
         ReloadingSimilarityEngine,
         ComputeClusterStats,
+        GeneratingCovers,
+        RefiningAudioProperties,
+        ExtractingTrackFeatures,
+        ComputingSeekTables,
+        SyncingTranscodeMirror,
     };
-    static inline constexpr unsigned ScanProgressStepCount{ 6 };
+    static inline constexpr unsigned ScanProgressStepCount{ 12 };
 
     // reduced scan stats
     struct ScanStepStats
@@ -82,6 +115,30 @@ namespace Scanner
         unsigned		progress() const;
     };
 
+    // Distribution of durations, using power of 2 buckets (bucket i holds durations < 2^i us)
+    struct DurationHistogram
+    {
+        static inline constexpr std::size_t bucketCount{ 25 }; // last bucket holds everything above ~8s
+
+        std::array<std::size_t, bucketCount>	buckets{};
+        std::size_t								count{};
+        std::chrono::microseconds				total{};
+        std::chrono::microseconds				max{};
+
+        void						add(std::chrono::microseconds duration);
+        std::chrono::microseconds	getMean() const;
+        std::chrono::microseconds	getPercentile(unsigned percentile) const; // upper bound of the bucket, in [0, 100]
+    };
+
+    struct ScanStepPerf
+    {
+        ScanStep					step;
+        std::chrono::milliseconds	duration;
+        std::size_t					processedElems{};
+
+        float						getElemsPerSecond() const;
+    };
+
     struct ScanStats
     {
         Wt::WDateTime	startTime;
@@ -98,11 +155,18 @@ namespace Scanner
 
         std::size_t	featuresFetched{};	// features fetched in DB
 
-        std::vector<ScanError>		errors;
+        ScanErrors					errors;
         std::vector<ScanDuplicate>	duplicates;
 
+        // Performance
+        std::vector<ScanStepPerf>	stepPerfs;			// completed steps, in execution order
+        DurationHistogram			parseDurations;		// metadata parsing, per scanned file
+        DurationHistogram			writeDurations;		// database update, per scanned file
+        DurationHistogram			commitDurations;	// database commit, per write batch
+
         std::size_t	nbFiles() const;
         std::size_t	nbChanges() const;
+        float		getScannedFilesPerSecond() const;
     };
 } // namespace Scanner
 
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "NowPlayingRegistry.hpp"
+
+#include <algorithm>
+
+namespace Scrobbling
+{
+    void NowPlayingRegistry::set(const Listen& listen, std::string_view playerName)
+    {
+        const Wt::WDateTime now{ Wt::WDateTime::currentDateTime() };
+
+        const std::scoped_lock lock{ _writeMutex };
+
+        auto entries{ std::make_shared<Entries>() };
+        NowPlaying current;
+        current.userId = listen.userId;
+        current.trackId = listen.trackId;
+        current.startedAt = now;
+        current.playerName = playerName;
+
+        for (const NowPlaying& entry : *std::atomic_load(&_entries))
+        {
+            if (isExpired(entry, now))
+                continue;
+
+            if (entry.userId != listen.userId)
+            {
+                entries->push_back(entry);
+                continue;
+            }
+
+            if (entry.trackId == listen.trackId)
+            {
+                current.startedAt = entry.startedAt;
+                if (playerName.empty())
+                    current.playerName = entry.playerName;
+            }
+        }
+
+        entries->push_back(std::move(current));
+        std::atomic_store(&_entries, std::shared_ptr<const Entries>{ std::move(entries) });
+    }
+
+    void NowPlayingRegistry::clear(const Listen& listen)
+    {
+        const std::scoped_lock lock{ _writeMutex };
+
+        const std::shared_ptr<const Entries> currentEntries{ std::atomic_load(&_entries) };
+        const auto it{ std::find_if(std::cbegin(*currentEntries), std::cend(*currentEntries), [&](const NowPlaying& entry) { return entry.userId == listen.userId && entry.trackId == listen.trackId; }) };
+        if (it == std::cend(*currentEntries))
+            return;
+
+        auto entries{ std::make_shared<Entries>(*currentEntries) };
+        entries->erase(std::begin(*entries) + std::distance(std::cbegin(*currentEntries), it));
+        std::atomic_store(&_entries, std::shared_ptr<const Entries>{ std::move(entries) });
+    }
+
+    std::vector<NowPlaying> NowPlayingRegistry::get() const
+    {
+        const Wt::WDateTime now{ Wt::WDateTime::currentDateTime() };
+
+        std::vector<NowPlaying> res;
+        for (const NowPlaying& entry : *std::atomic_load(&_entries))
+        {
+            if (!isExpired(entry, now))
+                res.push_back(entry);
+        }
+
+        std::sort(std::begin(res), std::end(res), [](const NowPlaying& a, const NowPlaying& b) { return a.startedAt > b.startedAt; });
+
+        return res;
+    }
+
+    bool NowPlayingRegistry::isExpired(const NowPlaying& entry, const Wt::WDateTime& now)
+    {
+        return entry.startedAt.addSecs(std::chrono::duration_cast<std::chrono::seconds>(entryTimeout).count()) < now;
+    }
+} // ns Scrobbling
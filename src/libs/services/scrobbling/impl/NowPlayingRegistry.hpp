@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "services/scrobbling/Listen.hpp"
+
+namespace Scrobbling
+{
+    // Current plays, at most one per user
+    // Readers do not lock: writers publish a new copy of the entries, which are only a few
+    class NowPlayingRegistry
+    {
+    public:
+        NowPlayingRegistry() = default;
+
+        NowPlayingRegistry(const NowPlayingRegistry&) = delete;
+        NowPlayingRegistry& operator=(const NowPlayingRegistry&) = delete;
+
+        // same user and track: this is the same play, only refreshes the player name if set
+        void set(const Listen& listen, std::string_view playerName);
+        void clear(const Listen& listen);
+
+        std::vector<NowPlaying> get() const; // most recent first, expired entries are not reported
+
+    private:
+        using Entries = std::vector<NowPlaying>;
+
+        // plays that are never reported as finished
+        static constexpr std::chrono::hours entryTimeout{ 1 };
+        static bool isExpired(const NowPlaying& entry, const Wt::WDateTime& now);
+
+        std::mutex _writeMutex;
+        std::shared_ptr<const Entries> _entries{ std::make_shared<const Entries>() }; // only accessed using atomic shared_ptr operations
+    };
+} // ns Scrobbling
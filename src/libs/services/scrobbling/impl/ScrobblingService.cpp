@@ -44,7 +44,7 @@ namespace Scrobbling
         : _db{ db }
     {
         LMS_LOG(SCROBBLING, INFO) << "Starting service...";
-        _scrobblingBackends.emplace(ScrobblingBackend::Internal, std::make_unique<InternalBackend>(_db));
+        _scrobblingBackends.emplace(ScrobblingBackend::Internal, std::make_unique<InternalBackend>(ioContext, _db));
         _scrobblingBackends.emplace(ScrobblingBackend::ListenBrainz, std::make_unique<ListenBrainz::ListenBrainzBackend>(ioContext, _db));
         LMS_LOG(SCROBBLING, INFO) << "Service started!";
     }
@@ -56,12 +56,16 @@ namespace Scrobbling
 
     void ScrobblingService::listenStarted(const Listen& listen)
     {
+        _nowPlayingRegistry.set(listen, {});
+
         if (std::optional<ScrobblingBackend> backend{ getUserBackend(listen.userId) })
             _scrobblingBackends[*backend]->listenStarted(listen);
     }
 
     void ScrobblingService::listenFinished(const Listen& listen, std::optional<std::chrono::seconds> duration)
     {
+        _nowPlayingRegistry.clear(listen);
+
         if (std::optional<ScrobblingBackend> backend{ getUserBackend(listen.userId) })
             _scrobblingBackends[*backend]->listenFinished(listen, duration);
     }
@@ -72,6 +76,16 @@ namespace Scrobbling
             _scrobblingBackends[*backend]->addTimedListen(listen);
     }
 
+    void ScrobblingService::setNowPlaying(const Listen& listen, std::string_view playerName)
+    {
+        _nowPlayingRegistry.set(listen, playerName);
+    }
+
+    std::vector<NowPlaying> ScrobblingService::getNowPlaying()
+    {
+        return _nowPlayingRegistry.get();
+    }
+
     std::optional<ScrobblingBackend> ScrobblingService::getUserBackend(UserId userId)
     {
         std::optional<ScrobblingBackend> backend;
@@ -25,6 +25,7 @@
 
 #include "services/scrobbling/IScrobblingService.hpp"
 #include "IScrobblingBackend.hpp"
+#include "NowPlayingRegistry.hpp"
 
 namespace Scrobbling
 {
@@ -39,6 +40,9 @@ namespace Scrobbling
         void listenFinished(const Listen& listen, std::optional<std::chrono::seconds> duration) override;
         void addTimedListen(const TimedListen& listen) override;
 
+        void setNowPlaying(const Listen& listen, std::string_view playerName) override;
+        std::vector<NowPlaying> getNowPlaying() override;
+
         ArtistContainer getRecentArtists(Database::UserId userId, const std::vector<Database::ClusterId>& clusterIds, std::optional<Database::TrackArtistLinkType> linkType,Database::Range range) override;
         ReleaseContainer getRecentReleases(Database::UserId userId, const std::vector<Database::ClusterId>& clusterIds,Database::Range range) override;
         TrackContainer getRecentTracks(Database::UserId userId, const std::vector<Database::ClusterId>& clusterIds, Database::Range range) override;
@@ -54,6 +58,7 @@ namespace Scrobbling
 
         Database::Db& _db;
         std::unordered_map<Database::ScrobblingBackend, std::unique_ptr<IScrobblingBackend>> _scrobblingBackends;
+        NowPlayingRegistry _nowPlayingRegistry;
     };
 
 } // ns Scrobbling
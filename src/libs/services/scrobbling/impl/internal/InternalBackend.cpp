@@ -24,12 +24,59 @@
 #include "services/database/Session.hpp"
 #include "services/database/Track.hpp"
 #include "services/database/User.hpp"
+#include "utils/IConfig.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Service.hpp"
+#include "utils/String.hpp"
 
 namespace Scrobbling
 {
-    InternalBackend::InternalBackend(Database::Db& db)
+    namespace
+    {
+        WriteBehindQueue<TimedListen>::Parameters getListenQueueParameters()
+        {
+            WriteBehindQueue<TimedListen>::Parameters params;
+            params.maxDelay = std::chrono::milliseconds{ Service<IConfig>::get()->getULong("internal-write-behind-delay", 1000) };
+            if (Service<IConfig>::get()->getBool("internal-write-behind-journal", true))
+                params.journalFile = Service<IConfig>::get()->getPath("working-dir") / "journal" / "listens";
+
+            return params;
+        }
+
+        std::string serializeListen(const TimedListen& listen)
+        {
+            return std::to_string(listen.userId.getValue()) + " " + std::to_string(listen.trackId.getValue()) + " " + std::to_string(listen.listenedAt.toTime_t());
+        }
+
+        std::optional<TimedListen> deserializeListen(std::string_view str)
+        {
+            const std::vector<std::string_view> values{ StringUtils::splitString(str, " ") };
+            if (values.size() != 3)
+                return std::nullopt;
+
+            const auto userId{ StringUtils::readAs<Database::UserId::ValueType>(values[0]) };
+            const auto trackId{ StringUtils::readAs<Database::TrackId::ValueType>(values[1]) };
+            const auto listenedAt{ StringUtils::readAs<std::time_t>(values[2]) };
+            if (!userId || !trackId || !listenedAt)
+                return std::nullopt;
+
+            TimedListen listen;
+            listen.userId = *userId;
+            listen.trackId = *trackId;
+            listen.listenedAt = Wt::WDateTime::fromTime_t(*listenedAt);
+            return listen;
+        }
+    }
+
+    InternalBackend::InternalBackend(boost::asio::io_context& ioContext, Database::Db& db)
         : _db{ db }
-    {}
+        , _listenQueue{ ioContext, getListenQueueParameters(), [this](const std::vector<TimedListen>& listens) { saveListens(listens); }, serializeListen, deserializeListen }
+        , _listenArchiveAge{ std::chrono::hours{ 24 } * Service<IConfig>::get()->getULong("internal-listen-archive-age-days", 365) }
+        , _listenArchiveTimer{ ioContext }
+    {
+        if (_listenArchiveAge.count() > 0)
+            scheduleListenArchival(std::chrono::seconds{ 0 });
+    }
 
     void InternalBackend::listenStarted(const Listen&)
     {
@@ -46,23 +93,66 @@ namespace Scrobbling
     }
 
     void InternalBackend::addTimedListen(const TimedListen& listen)
+    {
+        _listenQueue.push(listen);
+    }
+
+    void InternalBackend::saveListens(const std::vector<TimedListen>& listens)
     {
         Database::Session& session{ _db.getTLSSession() };
         auto transaction{ session.createUniqueTransaction() };
 
-        if (Database::Listen::find(session, listen.userId, listen.trackId, Database::ScrobblingBackend::Internal, listen.listenedAt))
-            return;
+        for (const TimedListen& listen : listens)
+        {
+            if (Database::Listen::find(session, listen.userId, listen.trackId, Database::ScrobblingBackend::Internal, listen.listenedAt))
+                continue;
 
-        const Database::User::pointer user{ Database::User::find(session, listen.userId) };
-        if (!user)
-            return;
+            const Database::User::pointer user{ Database::User::find(session, listen.userId) };
+            if (!user)
+                continue;
 
-        const Database::Track::pointer track{ Database::Track::find(session, listen.trackId) };
-        if (!track)
-            return;
+            const Database::Track::pointer track{ Database::Track::find(session, listen.trackId) };
+            if (!track)
+                continue;
+
+            auto dbListen{ session.create<Database::Listen>(user, track, Database::ScrobblingBackend::Internal, listen.listenedAt) };
+            dbListen.modify()->setSyncState(Database::SyncState::Synchronized);
+        }
+
+        LMS_LOG(SCROBBLING, DEBUG) << "Saved " << listens.size() << " listens";
+    }
+
+    void InternalBackend::scheduleListenArchival(std::chrono::seconds fromNow)
+    {
+        _listenArchiveTimer.expires_after(fromNow);
+        _listenArchiveTimer.async_wait([this](const boost::system::error_code& ec)
+            {
+                if (ec == boost::asio::error::operation_aborted)
+                    return;
+
+                archiveListens();
+                scheduleListenArchival(std::chrono::hours{ 24 });
+            });
+    }
+
+    void InternalBackend::archiveListens()
+    {
+        // old listens are only used through their counts, see Database::Listen::archive
+        const Wt::WDateTime dateTime{ Wt::WDateTime::currentDateTime().addSecs(-static_cast<int>(std::chrono::duration_cast<std::chrono::seconds>(_listenArchiveAge).count())) };
+
+        try
+        {
+            Database::Session& session{ _db.getTLSSession() };
+            auto transaction{ session.createUniqueTransaction() };
 
-        auto dbListen{ session.create<Database::Listen>(user, track, Database::ScrobblingBackend::Internal, listen.listenedAt) };
-        dbListen.modify()->setSyncState(Database::SyncState::Synchronized);
+            const std::size_t count{ Database::Listen::archive(session, Database::ScrobblingBackend::Internal, dateTime) };
+            if (count > 0)
+                LMS_LOG(SCROBBLING, INFO) << "Archived " << count << " listens older than " << dateTime.toString().toUTF8();
+        }
+        catch (const std::exception& e)
+        {
+            LMS_LOG(SCROBBLING, ERROR) << "Cannot archive listens: " << e.what();
+        }
     }
 } // Scrobbling
 
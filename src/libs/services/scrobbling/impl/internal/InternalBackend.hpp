@@ -19,6 +19,12 @@
 
 #pragma once
 
+#include <chrono>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include "utils/WriteBehindQueue.hpp"
 #include "IScrobblingBackend.hpp"
 
 namespace Database
@@ -31,14 +37,21 @@ namespace Scrobbling
     class InternalBackend final : public IScrobblingBackend
     {
     public:
-        InternalBackend(Database::Db& db);
+        InternalBackend(boost::asio::io_context& ioContext, Database::Db& db);
 
     private:
         void listenStarted(const Listen& listen) override;
         void listenFinished(const Listen& listen, std::optional<std::chrono::seconds> duration) override;
         void addTimedListen(const TimedListen& listen) override;
 
+        void saveListens(const std::vector<TimedListen>& listens);
+        void scheduleListenArchival(std::chrono::seconds fromNow);
+        void archiveListens();
+
         Database::Db& _db;
+        WriteBehindQueue<TimedListen> _listenQueue;
+        const std::chrono::hours _listenArchiveAge; // 0 means listens are never archived
+        boost::asio::steady_timer _listenArchiveTimer;
     };
 } // Scrobbling
 
@@ -54,7 +54,7 @@ namespace Scrobbling::ListenBrainz
         : _ioContext{ ioContext }
         , _db{ db }
         , _baseAPIUrl{ Service<IConfig>::get()->getString("listenbrainz-api-base-url", "https://api.listenbrainz.org") }
-        , _client{ Http::createClient(_ioContext, _baseAPIUrl) }
+        , _client{ Http::createClient(_ioContext, _baseAPIUrl, Service<IConfig>::get()->getULong("listenbrainz-max-inflight-requests", 2)) }
         , _listensSynchronizer{ _ioContext, db, *_client }
     {
         LOG(INFO) << "Starting ListenBrainz backend... API endpoint = '" << _baseAPIUrl << "'";
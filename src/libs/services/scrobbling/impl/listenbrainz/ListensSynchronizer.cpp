@@ -19,7 +19,10 @@
 
 #include "ListensSynchronizer.hpp"
 
-#include <boost/asio/bind_executor.hpp>
+#include <algorithm>
+#include <ctime>
+#include <map>
+
 #include <Wt/Json/Array.h>
 #include <Wt/Json/Object.h>
 #include <Wt/Json/Value.h>
@@ -32,7 +35,6 @@
 #include "services/database/Session.hpp"
 #include "services/database/Track.hpp"
 #include "services/database/User.hpp"
-#include "services/scrobbling/Exception.hpp"
 #include "utils/IConfig.hpp"
 #include "utils/http/IClient.hpp"
 #include "utils/Service.hpp"
@@ -44,6 +46,21 @@ namespace
 {
     using namespace Scrobbling::ListenBrainz;
 
+    // ListenBrainz accepts at most 1000 listens per submission
+    constexpr std::size_t maxBatchListenCount{ 1000 };
+    constexpr std::size_t maxBatchPayloadSize{ 1024 * 1024 };
+    constexpr std::size_t maxPendingListenCount{ 10000 };
+    constexpr std::size_t getListensPageSize{ 100 };
+
+    StaggeredScheduler<Database::UserId>::Parameters createSyncSchedulerParameters(std::chrono::hours period)
+    {
+        StaggeredScheduler<Database::UserId>::Parameters params;
+        params.period = period;
+        params.maxSkippedPeriodCount = Service<IConfig>::get()->getULong("listenbrainz-sync-max-skipped-periods", 4);
+
+        return params;
+    }
+
     std::optional<Wt::Json::Object> listenToJsonPayload(Database::Session& session, const Scrobbling::Listen& listen, const Wt::WDateTime& timePoint)
     {
         auto transaction{ session.createSharedTransaction() };
@@ -122,6 +139,36 @@ namespace
         return res;
     }
 
+    bool createOrUpdateListen(Database::Session& session, const Scrobbling::TimedListen& listen, Database::SyncState scrobblingState)
+    {
+        using namespace Database;
+
+        Database::Listen::pointer dbListen{ Database::Listen::find(session, listen.userId, listen.trackId, Database::ScrobblingBackend::ListenBrainz, listen.listenedAt) };
+        if (!dbListen)
+        {
+            const User::pointer user{ User::find(session, listen.userId) };
+            if (!user)
+                return false;
+
+            const Track::pointer track{ Track::find(session, listen.trackId) };
+            if (!track)
+                return false;
+
+            dbListen = session.create<Database::Listen>(user, track, Database::ScrobblingBackend::ListenBrainz, listen.listenedAt);
+            dbListen.modify()->setSyncState(scrobblingState);
+
+            LOG(DEBUG) << "LISTEN CREATED for user " << user->getLoginName() << ", track '" << track->getName() << "' AT " << listen.listenedAt.toString();
+
+            return true;
+        }
+
+        if (dbListen->getSyncState() == scrobblingState)
+            return false;
+
+        dbListen.modify()->setSyncState(scrobblingState);
+        return true;
+    }
+
     std::optional<std::size_t> parseListenCount(std::string_view msgBody)
     {
         try
@@ -214,10 +261,12 @@ namespace Scrobbling::ListenBrainz
         , _client{ client }
         , _maxSyncListenCount{ Service<IConfig>::get()->getULong("listenbrainz-max-sync-listen-count", 1000) }
         , _syncListensPeriod{ Service<IConfig>::get()->getULong("listenbrainz-sync-listens-period-hours", 1) }
+        , _syncScheduler{ _strand, createSyncSchedulerParameters(_syncListensPeriod), [this] { return startSyncPeriod(); }, [this](Database::UserId userId) { startSync(getUserContext(userId)); } }
     {
         LOG(INFO) << "Starting Listens synchronizer, maxSyncListenCount = " << _maxSyncListenCount << ", _syncListensPeriod = " << _syncListensPeriod.count() << " hours";
 
-        scheduleSync(std::chrono::seconds{ 30 });
+        if (_syncListensPeriod.count() > 0 && _maxSyncListenCount > 0)
+            _syncScheduler.start();
     }
 
     void ListensSynchronizer::enqueListen(const TimedListen& listen)
@@ -233,8 +282,11 @@ namespace Scrobbling::ListenBrainz
 
     void ListensSynchronizer::enqueListen(const Scrobbling::Listen& listen, const Wt::WDateTime& timePoint)
     {
+        _strand.dispatch([this, userId = listen.userId] { _syncScheduler.onLocalChange(userId); });
+
         Http::ClientPOSTRequestParameters request;
         request.relativeUrl = "/1/submit-listens";
+        request.onRateLimitFunc = [this](std::size_t remainingCount, std::chrono::seconds resetIn) { onRateLimit(remainingCount, resetIn); };
 
         if (timePoint.isValid())
         {
@@ -286,35 +338,26 @@ namespace Scrobbling::ListenBrainz
 
     bool ListensSynchronizer::saveListen(const TimedListen& listen, Database::SyncState scrobblingState)
     {
-        using namespace Database;
-
-        Session& session{ _db.getTLSSession() };
+        Database::Session& session{ _db.getTLSSession() };
         auto transaction{ session.createUniqueTransaction() }; // TODO: unique only if needed
 
-        Database::Listen::pointer dbListen{ Database::Listen::find(session, listen.userId, listen.trackId, Database::ScrobblingBackend::ListenBrainz, listen.listenedAt) };
-        if (!dbListen)
-        {
-            const User::pointer user{ User::find(session, listen.userId) };
-            if (!user)
-                return false;
-
-            const Track::pointer track{ Track::find(session, listen.trackId) };
-            if (!track)
-                return false;
+        return createOrUpdateListen(session, listen, scrobblingState);
+    }
 
-            dbListen = session.create<Database::Listen>(user, track, Database::ScrobblingBackend::ListenBrainz, listen.listenedAt);
-            dbListen.modify()->setSyncState(scrobblingState);
+    std::size_t ListensSynchronizer::saveListens(const std::vector<TimedListen>& listens, Database::SyncState scrobblingState)
+    {
+        std::size_t savedCount{};
 
-            LOG(DEBUG) << "LISTEN CREATED for user " << user->getLoginName() << ", track '" << track->getName() << "' AT " << listen.listenedAt.toString();
+        Database::Session& session{ _db.getTLSSession() };
+        auto transaction{ session.createUniqueTransaction() };
 
-            return true;
+        for (const TimedListen& listen : listens)
+        {
+            if (createOrUpdateListen(session, listen, scrobblingState))
+                savedCount++;
         }
 
-        if (dbListen->getSyncState() == scrobblingState)
-            return false;
-
-        dbListen.modify()->setSyncState(scrobblingState);
-        return true;
+        return savedCount;
     }
 
     void ListensSynchronizer::enquePendingListens()
@@ -329,7 +372,7 @@ namespace Scrobbling::ListenBrainz
             Database::Listen::FindParameters params;
             params.setScrobblingBackend(Database::ScrobblingBackend::ListenBrainz)
                 .setSyncState(Database::SyncState::PendingAdd)
-                .setRange(Database::Range{ 0, 100 }); // don't flood too much?
+                .setRange(Database::Range{ 0, maxPendingListenCount }); // sent using batches
 
             const Database::RangeResults results{ Database::Listen::find(session, params) };
             pendingListens.reserve(results.results.size());
@@ -349,59 +392,113 @@ namespace Scrobbling::ListenBrainz
 
         LOG(DEBUG) << "Queing " << pendingListens.size() << " pending listen";
 
+        std::unordered_map<Database::UserId, std::vector<TimedListen>> pendingListensByUser;
         for (const TimedListen& pendingListen : pendingListens)
-            enqueListen(pendingListen);
+            pendingListensByUser[pendingListen.userId].push_back(pendingListen);
+
+        for (const auto& [userId, userPendingListens] : pendingListensByUser)
+            enqueListens(userId, userPendingListens);
     }
 
-    ListensSynchronizer::UserContext& ListensSynchronizer::getUserContext(Database::UserId userId)
+    void ListensSynchronizer::enqueListens(Database::UserId userId, const std::vector<TimedListen>& listens)
     {
-        assert(_strand.running_in_this_thread());
-
-        auto itContext{ _userContexts.find(userId) };
-        if (itContext == std::cend(_userContexts))
+        const std::optional<UUID> listenBrainzToken{ Utils::getListenBrainzToken(_db.getTLSSession(), userId) };
+        if (!listenBrainzToken)
         {
-            std::tie(itContext, std::ignore) = _userContexts.emplace(userId, userId);
+            LOG(DEBUG) << "No listenbrainz token found: skipping";
+            return;
         }
 
-        return itContext->second;
-    }
+        // payloads are serialized one by one to cap the size of each batch
+        std::vector<TimedListen> batchListens;
+        std::string batchPayloads;
 
-    bool ListensSynchronizer::isSyncing() const
-    {
-        return std::any_of(std::cbegin(_userContexts), std::cend(_userContexts), [](const auto& contextEntry)
+        for (const TimedListen& listen : listens)
+        {
+            const std::optional<Wt::Json::Object> payload{ listenToJsonPayload(_db.getTLSSession(), listen, listen.listenedAt) };
+            if (!payload)
             {
-                return contextEntry.second.syncing;
-            });
+                LOG(DEBUG) << "Cannot convert listen to json: skipping";
+                continue;
+            }
+
+            const std::string payloadText{ Wt::Json::serialize(*payload) };
+            if (!batchListens.empty() && (batchListens.size() == maxBatchListenCount || batchPayloads.size() + payloadText.size() + 1 > maxBatchPayloadSize))
+            {
+                enqueListensBatch(*listenBrainzToken, std::move(batchListens), batchPayloads);
+                batchListens.clear();
+                batchPayloads.clear();
+            }
+
+            if (!batchPayloads.empty())
+                batchPayloads += ',';
+            batchPayloads += payloadText;
+            batchListens.push_back(listen);
+        }
+
+        if (!batchListens.empty())
+            enqueListensBatch(*listenBrainzToken, std::move(batchListens), batchPayloads);
     }
 
-    void ListensSynchronizer::scheduleSync(std::chrono::seconds fromNow)
+    void ListensSynchronizer::enqueListensBatch(const UUID& listenBrainzToken, std::vector<TimedListen> listens, std::string_view payloads)
     {
-        if (_syncListensPeriod.count() == 0 || _maxSyncListenCount == 0)
+        if (listens.size() == 1)
+        {
+            enqueListen(listens.front());
             return;
+        }
+
+        LOG(DEBUG) << "Queing batch of " << listens.size() << " listens";
 
-        LOG(DEBUG) << "Scheduled sync in " << fromNow.count() << " seconds...";
-        _syncTimer.expires_after(fromNow);
-        _syncTimer.async_wait(boost::asio::bind_executor(_strand, [this](const boost::system::error_code& ec)
+        Http::ClientPOSTRequestParameters request;
+        request.relativeUrl = "/1/submit-listens";
+        request.priority = Http::ClientRequestParameters::Priority::Normal;
+        request.onRateLimitFunc = [this](std::size_t remainingCount, std::chrono::seconds resetIn) { onRateLimit(remainingCount, resetIn); };
+        request.onSuccessFunc = [this, listens](std::string_view)
             {
-                if (ec == boost::asio::error::operation_aborted)
-                {
-                    LOG(DEBUG) << "getListens aborted";
-                    return;
-                }
-                else if (ec)
-                {
-                    throw Exception{ "GetListens timer failure: " + std::string {ec.message()} };
-                }
+                _strand.dispatch([this, listens]
+                    {
+                        if (const std::size_t savedCount{ saveListens(listens, Database::SyncState::Synchronized) }; savedCount > 0)
+                        {
+                            UserContext& context{ getUserContext(listens.front().userId) };
+                            if (context.listenCount)
+                                *context.listenCount += savedCount;
+                        }
+                    });
+            };
+        request.onFailureFunc = [this, listens]
+            {
+                // the whole batch may be rejected because of a single listen: fallback on individual submissions
+                _strand.dispatch([this, listens]
+                    {
+                        LOG(DEBUG) << "Batch submission failed, sending " << listens.size() << " listens one by one";
+                        for (const TimedListen& listen : listens)
+                            enqueListen(listen);
+                    });
+            };
 
-                startSync();
-            }));
+        request.message.addBodyText("{\"listen_type\":\"import\",\"payload\":[" + std::string{ payloads } + "]}");
+        request.message.addHeader("Authorization", "Token " + std::string{ listenBrainzToken.getAsString() });
+        request.message.addHeader("Content-Type", "application/json");
+        _client.sendPOSTRequest(std::move(request));
     }
 
-    void ListensSynchronizer::startSync()
+    ListensSynchronizer::UserContext& ListensSynchronizer::getUserContext(Database::UserId userId)
     {
-        LOG(DEBUG) << "Starting sync!";
+        assert(_strand.running_in_this_thread());
+
+        auto itContext{ _userContexts.find(userId) };
+        if (itContext == std::cend(_userContexts))
+        {
+            std::tie(itContext, std::ignore) = _userContexts.emplace(userId, userId);
+        }
 
-        assert(!isSyncing());
+        return itContext->second;
+    }
+
+    std::vector<Database::UserId> ListensSynchronizer::startSyncPeriod()
+    {
+        LOG(DEBUG) << "Starting sync period!";
 
         enquePendingListens();
 
@@ -412,18 +509,16 @@ namespace Scrobbling::ListenBrainz
             userIds = Database::User::find(_db.getTLSSession(), Database::User::FindParameters{}.setScrobblingBackend(Database::ScrobblingBackend::ListenBrainz));
         }
 
-        for (const Database::UserId userId : userIds.results)
-            startSync(getUserContext(userId));
-
-        if (!isSyncing())
-            scheduleSync(_syncListensPeriod);
+        // user syncs are spread over the period
+        return userIds.results;
     }
 
     void ListensSynchronizer::startSync(UserContext& context)
     {
-        context.syncing = true;
-        context.listenBrainzUserName = "";
+        context.foundChanges.reset();
         context.maxDateTime = {};
+        context.listensSyncedUntil = {};
+        context.newestListenDateTime = {};
         context.fetchedListenCount = 0;
         context.matchedListenCount = 0;
         context.importedListenCount = 0;
@@ -436,27 +531,42 @@ namespace Scrobbling::ListenBrainz
         _strand.dispatch([this, &context]
             {
                 LOG(INFO) << "Sync done for user '" << context.listenBrainzUserName << "', fetched: " << context.fetchedListenCount << ", matched: " << context.matchedListenCount << ", imported: " << context.importedListenCount;
-                context.syncing = false;
+                _syncScheduler.onSyncEnded(context.userId, context.foundChanges);
+            });
+    }
 
-                if (!isSyncing())
-                    scheduleSync(_syncListensPeriod);
+    void ListensSynchronizer::onRateLimit(std::size_t remainingCount, std::chrono::seconds resetIn)
+    {
+        _strand.dispatch([this, remainingCount, resetIn]
+            {
+                _syncScheduler.onRateLimit(remainingCount, resetIn);
             });
     }
 
     void ListensSynchronizer::enqueValidateToken(UserContext& context)
     {
-        assert(context.listenBrainzUserName.empty());
-
         const std::optional<UUID> listenBrainzToken{ Utils::getListenBrainzToken(_db.getTLSSession(), context.userId) };
         if (!listenBrainzToken)
         {
+            context.listenBrainzUserName.clear();
             onSyncEnded(context);
             return;
         }
 
+        // the token has already been validated
+        if (!context.listenBrainzUserName.empty() && context.listenBrainzToken == listenBrainzToken->getAsString())
+        {
+            enqueGetListenCount(context);
+            return;
+        }
+
+        context.listenBrainzUserName.clear();
+        context.listenBrainzToken = listenBrainzToken->getAsString();
+
         Http::ClientGETRequestParameters request;
         request.priority = Http::ClientRequestParameters::Priority::Low;
         request.relativeUrl = "/1/validate-token";
+        request.onRateLimitFunc = [this](std::size_t remainingCount, std::chrono::seconds resetIn) { onRateLimit(remainingCount, resetIn); };
         request.headers = { {"Authorization",  "Token " + std::string {listenBrainzToken->getAsString()}} };
         request.onSuccessFunc = [this, &context](std::string_view msgBody)
             {
@@ -483,6 +593,7 @@ namespace Scrobbling::ListenBrainz
         Http::ClientGETRequestParameters request;
         request.relativeUrl = "/1/user/" + std::string{ context.listenBrainzUserName } + "/listen-count";
         request.priority = Http::ClientRequestParameters::Priority::Low;
+        request.onRateLimitFunc = [this](std::size_t remainingCount, std::chrono::seconds resetIn) { onRateLimit(remainingCount, resetIn); };
         request.onSuccessFunc = [=, &context](std::string_view msgBody)
             {
                 _strand.dispatch([=, &context]
@@ -492,6 +603,8 @@ namespace Scrobbling::ListenBrainz
                             LOG(DEBUG) << "Listen count for listenbrainz user '" << context.listenBrainzUserName << "' = " << *listenCount;
 
                         bool needSync{ listenCount && (!context.listenCount || *context.listenCount != *listenCount) };
+                        if (listenCount)
+                            context.foundChanges = needSync;
                         context.listenCount = listenCount;
 
                         if (!needSync)
@@ -500,6 +613,14 @@ namespace Scrobbling::ListenBrainz
                             return;
                         }
 
+                        {
+                            Database::Session& session{ _db.getTLSSession() };
+                            auto transaction{ session.createSharedTransaction() };
+
+                            if (const Database::User::pointer user{ Database::User::find(session, context.userId) })
+                                context.listensSyncedUntil = user->getListenBrainzListensSyncedUntil();
+                        }
+
                         context.maxDateTime = Wt::WDateTime::currentDateTime();
                         enqueGetListens(context);
                     });
@@ -517,13 +638,15 @@ namespace Scrobbling::ListenBrainz
         assert(!context.listenBrainzUserName.empty());
 
         Http::ClientGETRequestParameters request;
-        request.relativeUrl = "/1/user/" + context.listenBrainzUserName + "/listens?max_ts=" + std::to_string(context.maxDateTime.toTime_t());
+        request.relativeUrl = "/1/user/" + context.listenBrainzUserName + "/listens?max_ts=" + std::to_string(context.maxDateTime.toTime_t()) + "&count=" + std::to_string(getListensPageSize);
         request.priority = Http::ClientRequestParameters::Priority::Low;
+        request.onRateLimitFunc = [this](std::size_t remainingCount, std::chrono::seconds resetIn) { onRateLimit(remainingCount, resetIn); };
         request.onSuccessFunc = [=, &context](std::string_view msgBody)
             {
                 processGetListensResponse(msgBody, context);
                 if (context.fetchedListenCount >= _maxSyncListenCount || !context.maxDateTime.isValid())
                 {
+                    saveListensSyncedUntil(context);
                     onSyncEnded(context);
                     return;
                 }
@@ -540,32 +663,113 @@ namespace Scrobbling::ListenBrainz
 
     void ListensSynchronizer::processGetListensResponse(std::string_view msgBody, UserContext& context)
     {
-        Database::Session& session{ _db.getTLSSession() };
-
         context.maxDateTime = {}; // invalidate to break in case no more listens are fetched
         ListensParser::Result result{ ListensParser::parse(msgBody) };
         context.fetchedListenCount += result.listenCount;
 
-        for (const Listen& parsedListen : result.listens)
+        std::vector<Scrobbling::TimedListen> matchedListens;
+        bool reachedSyncedListens{};
         {
-            // update oldest listen for the next query
-            if (!parsedListen.listenedAt.isValid())
+            Database::Session& session{ _db.getTLSSession() };
+            auto transaction{ session.createSharedTransaction() };
+
+            for (const Listen& parsedListen : result.listens)
             {
-                LOG(DEBUG) << "Skipping entry due to invalid listenedAt";
-                continue;
+                if (!parsedListen.listenedAt.isValid())
+                {
+                    LOG(DEBUG) << "Skipping entry due to invalid listenedAt";
+                    continue;
+                }
+
+                // listens are fetched from the most recent ones: older ones are already imported
+                if (context.listensSyncedUntil.isValid() && parsedListen.listenedAt <= context.listensSyncedUntil)
+                {
+                    reachedSyncedListens = true;
+                    continue;
+                }
+
+                if (!context.newestListenDateTime.isValid() || context.newestListenDateTime < parsedListen.listenedAt)
+                    context.newestListenDateTime = parsedListen.listenedAt;
+
+                // update oldest listen for the next query
+                if (!context.maxDateTime.isValid() || context.maxDateTime > parsedListen.listenedAt)
+                    context.maxDateTime = parsedListen.listenedAt;
+
+                if (const Database::TrackId trackId{ tryGetMatchingTrack(session, parsedListen) }; trackId.isValid())
+                {
+                    context.matchedListenCount++;
+                    matchedListens.push_back(Scrobbling::TimedListen{ {context.userId, trackId}, parsedListen.listenedAt });
+                }
             }
+        }
 
-            if (!context.maxDateTime.isValid() || context.maxDateTime > parsedListen.listenedAt)
-                context.maxDateTime = parsedListen.listenedAt;
+        context.importedListenCount += importListens(context.userId, matchedListens);
 
-            if (const Database::TrackId trackId{ tryGetMatchingTrack(session, parsedListen) }; trackId.isValid())
-            {
-                context.matchedListenCount++;
+        if (reachedSyncedListens)
+            context.maxDateTime = {};
+    }
+
+    std::size_t ListensSynchronizer::importListens(Database::UserId userId, const std::vector<TimedListen>& listens)
+    {
+        using namespace Database;
+
+        if (listens.empty())
+            return 0;
+
+        const auto [oldestListen, newestListen]{ std::minmax_element(std::cbegin(listens), std::cend(listens), [](const TimedListen& lhs, const TimedListen& rhs) { return lhs.listenedAt < rhs.listenedAt; }) };
+
+        Session& session{ _db.getTLSSession() };
+        auto transaction{ session.createUniqueTransaction() };
 
-                const Scrobbling::TimedListen listen{ {context.userId, trackId}, parsedListen.listenedAt };
-                if (saveListen(listen, Database::SyncState::Synchronized))
-                    context.importedListenCount++;
+        const User::pointer user{ User::find(session, userId) };
+        if (!user)
+            return 0;
+
+        // fetch the already known listens in one go, dates are stored with a second precision
+        using ListenKey = std::pair<TrackId, std::time_t>;
+        std::map<ListenKey, Database::Listen::pointer> existingListens;
+        for (const Database::Listen::pointer& listen : Database::Listen::find(session, userId, ScrobblingBackend::ListenBrainz, oldestListen->listenedAt, newestListen->listenedAt))
+            existingListens.emplace(ListenKey{ listen->getTrackId(), listen->getDateTime().toTime_t() }, listen);
+
+        std::size_t importedCount{};
+        for (const TimedListen& listen : listens)
+        {
+            const ListenKey key{ listen.trackId, listen.listenedAt.toTime_t() };
+
+            if (auto itListen{ existingListens.find(key) }; itListen != std::cend(existingListens))
+            {
+                if (itListen->second->getSyncState() != SyncState::Synchronized)
+                {
+                    itListen->second.modify()->setSyncState(SyncState::Synchronized);
+                    importedCount++;
+                }
+                continue;
             }
+
+            const Track::pointer track{ Track::find(session, listen.trackId) };
+            if (!track)
+                continue;
+
+            Database::Listen::pointer dbListen{ session.create<Database::Listen>(user, track, ScrobblingBackend::ListenBrainz, listen.listenedAt) };
+            dbListen.modify()->setSyncState(SyncState::Synchronized);
+            existingListens.emplace(key, dbListen);
+            importedCount++;
         }
+
+        LOG(DEBUG) << "Imported " << importedCount << " listens out of " << listens.size();
+
+        return importedCount;
+    }
+
+    void ListensSynchronizer::saveListensSyncedUntil(const UserContext& context)
+    {
+        if (!context.newestListenDateTime.isValid())
+            return;
+
+        Database::Session& session{ _db.getTLSSession() };
+        auto transaction{ session.createUniqueTransaction() };
+
+        if (const Database::User::pointer user{ Database::User::find(session, context.userId) })
+            user.modify()->setListenBrainzListensSyncedUntil(context.newestListenDateTime);
     }
 } // namespace Scrobbling::ListenBrainz
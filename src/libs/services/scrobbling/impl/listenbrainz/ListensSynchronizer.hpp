@@ -21,14 +21,16 @@
 
 #include <optional>
 #include <unordered_map>
+#include <vector>
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/io_context_strand.hpp>
-#include <boost/asio/steady_timer.hpp>
 
 #include "services/database/Types.hpp"
 #include "services/database/UserId.hpp"
 
 #include "services/scrobbling/Listen.hpp"
+#include "utils/StaggeredScheduler.hpp"
+#include "utils/UUID.hpp"
 
 namespace Database
 {
@@ -53,8 +55,11 @@ namespace Scrobbling::ListenBrainz
 		private:
 			void enqueListen(const Listen& listen, const Wt::WDateTime& timePoint);
 			bool saveListen(const TimedListen& listen, Database::SyncState scrobblinState);
+			std::size_t saveListens(const std::vector<TimedListen>& listens, Database::SyncState scrobblinState);
 
 			void enquePendingListens();
+			void enqueListens(Database::UserId userId, const std::vector<TimedListen>& listens);
+			void enqueListensBatch(const UUID& listenBrainzToken, std::vector<TimedListen> listens, std::string_view payloads);
 
 			struct UserContext
 			{
@@ -66,38 +71,42 @@ namespace Scrobbling::ListenBrainz
 				UserContext& operator=(UserContext&&) = delete;
 
 				const Database::UserId		userId;
-				bool						syncing {};
 				std::optional<std::size_t>	listenCount {};
+				std::string					listenBrainzUserName; // need to be resolved first
+				std::string					listenBrainzToken; // the user name is resolved again when the token changes
 
 				// resetted at each sync
-				std::string		listenBrainzUserName; // need to be resolved first
+				std::optional<bool>	foundChanges; // empty until the listen count is checked
 				Wt::WDateTime	maxDateTime;
+				Wt::WDateTime	listensSyncedUntil; // high-water mark of the previous syncs
+				Wt::WDateTime	newestListenDateTime;
 				std::size_t		fetchedListenCount{};
 				std::size_t		matchedListenCount{};
 				std::size_t		importedListenCount{};
 			};
 
 			UserContext& getUserContext(Database::UserId userId);
-			bool isSyncing() const;
-			void scheduleSync(std::chrono::seconds fromNow);
-			void startSync();
+			std::vector<Database::UserId> startSyncPeriod();
 			void startSync(UserContext& context);
+			void onRateLimit(std::size_t remainingCount, std::chrono::seconds resetIn);
 			void onSyncEnded(UserContext& context);
 			void enqueValidateToken(UserContext& context);
 			void enqueGetListenCount(UserContext& context);
 			void enqueGetListens(UserContext& context);
 			void processGetListensResponse(std::string_view body, UserContext& context);
+			std::size_t importListens(Database::UserId userId, const std::vector<TimedListen>& listens);
+			void saveListensSyncedUntil(const UserContext& context);
 
 			boost::asio::io_context&		_ioContext;
 			boost::asio::io_context::strand	_strand {_ioContext};
 			Database::Db&					_db;
-			boost::asio::steady_timer		_syncTimer {_ioContext};
 			Http::IClient&					_client;
 
 			std::unordered_map<Database::UserId, UserContext> _userContexts;
 
 			const std::size_t			_maxSyncListenCount;
 			const std::chrono::hours	_syncListensPeriod;
+			StaggeredScheduler<Database::UserId>	_syncScheduler;
 	};
 } // Scrobbling::ListenBrainz
 
@@ -22,6 +22,8 @@
 #include <chrono>
 #include <memory>
 #include <optional>
+#include <string_view>
+#include <vector>
 #include <boost/asio/io_service.hpp>
 #include <Wt/WDateTime.h>
 
@@ -51,6 +53,10 @@ namespace Scrobbling
 
         virtual void addTimedListen(const TimedListen& listen) = 0;
 
+        // Now playing, only kept in memory. Also set by listenStarted and cleared by listenFinished
+        virtual void setNowPlaying(const Listen& listen, std::string_view playerName) = 0; // not reported to the backends
+        virtual std::vector<NowPlaying> getNowPlaying() = 0; // at most one per user, most recent first
+
         // Stats
         using ArtistContainer = Database::RangeResults<Database::ArtistId>;
         using ReleaseContainer = Database::RangeResults<Database::ReleaseId>;
@@ -19,6 +19,8 @@
 
 #pragma once
 
+#include <string>
+
 #include <Wt/WDateTime.h>
 
 #include "services/database/TrackId.hpp"
@@ -36,5 +38,11 @@ namespace Scrobbling
     {
         Wt::WDateTime listenedAt;
     };
+
+    struct NowPlaying : public Listen
+    {
+        Wt::WDateTime startedAt;
+        std::string playerName; // may be empty
+    };
 } // ns Scrobbling
 
@@ -47,6 +47,7 @@ variance(const std::vector<T>& vec)
 
 DataNormalizer::DataNormalizer(std::size_t inputDimCount)
 : _inputDimCount{inputDimCount}
+, _minmax(inputDimCount)
 {
 }
 
@@ -87,6 +88,30 @@ DataNormalizer::computeNormalizationFactors(const std::vector<InputVector>& inpu
 	}
 }
 
+void
+DataNormalizer::computeNormalizationFactors(const std::vector<float>& packedDataSamples, std::size_t packedDimCount)
+{
+	if (packedDimCount < _inputDimCount || packedDataSamples.size() % packedDimCount != 0)
+		throw Exception("Bad packed input vectors size");
+
+	if (packedDataSamples.empty())
+		throw Exception("Empty input vectors");
+
+	_minmax.resize(_inputDimCount);
+	for (std::size_t dimId {}; dimId < _inputDimCount; ++dimId)
+		_minmax[dimId] = {packedDataSamples[dimId], packedDataSamples[dimId]};
+
+	for (std::size_t offset {packedDimCount}; offset < packedDataSamples.size(); offset += packedDimCount)
+	{
+		for (std::size_t dimId {}; dimId < _inputDimCount; ++dimId)
+		{
+			const InputVector::value_type value {packedDataSamples[offset + dimId]};
+			_minmax[dimId].min = std::min(_minmax[dimId].min, value);
+			_minmax[dimId].max = std::max(_minmax[dimId].max, value);
+		}
+	}
+}
+
 InputVector::value_type
 DataNormalizer::normalizeValue(InputVector::value_type value, std::size_t dimId) const
 {
@@ -110,6 +135,13 @@ DataNormalizer::normalizeData(InputVector& a) const
 	}
 }
 
+void
+DataNormalizer::normalizeData(float* data) const
+{
+	for (std::size_t dimId {}; dimId < _inputDimCount; ++dimId)
+		data[dimId] = static_cast<float>(normalizeValue(data[dimId], dimId));
+}
+
 void
 DataNormalizer::dump(std::ostream& os) const
 {
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "som/DistanceKernels.hpp"
+
+#include <limits>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+	#define LMS_SOM_HAS_AVX2_KERNEL
+	#include <immintrin.h>
+#elif defined(__aarch64__)
+	#define LMS_SOM_HAS_NEON_KERNEL
+	#include <arm_neon.h>
+#endif
+
+namespace SOM::Kernels
+{
+	namespace
+	{
+		using DistanceFunc = float(*)(const float*, const float*, const float*, std::size_t);
+
+		float computeWeightedSquareDistanceScalar(const float* a, const float* b, const float* weights, std::size_t paddedDimCount)
+		{
+			// independent accumulators, so that the compiler can pipeline / vectorize the loop
+			float acc[laneCount] {};
+			for (std::size_t i {}; i < paddedDimCount; i += laneCount)
+			{
+				for (std::size_t lane {}; lane < laneCount; ++lane)
+				{
+					const float diff {a[i + lane] - b[i + lane]};
+					acc[lane] += diff * diff * weights[i + lane];
+				}
+			}
+
+			float res {};
+			for (float value : acc)
+				res += value;
+
+			return res;
+		}
+
+#if defined(LMS_SOM_HAS_AVX2_KERNEL)
+		__attribute__((target("avx2,fma")))
+		float computeWeightedSquareDistanceAvx2(const float* a, const float* b, const float* weights, std::size_t paddedDimCount)
+		{
+			static_assert(laneCount == 8);
+
+			__m256 acc {_mm256_setzero_ps()};
+			for (std::size_t i {}; i < paddedDimCount; i += laneCount)
+			{
+				const __m256 diff {_mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i))};
+				acc = _mm256_fmadd_ps(_mm256_mul_ps(diff, diff), _mm256_loadu_ps(weights + i), acc);
+			}
+
+			__m128 sum {_mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1))};
+			sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+			sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+
+			return _mm_cvtss_f32(sum);
+		}
+#elif defined(LMS_SOM_HAS_NEON_KERNEL)
+		float computeWeightedSquareDistanceNeon(const float* a, const float* b, const float* weights, std::size_t paddedDimCount)
+		{
+			static_assert(laneCount % 4 == 0);
+
+			float32x4_t acc1 {vdupq_n_f32(0)};
+			float32x4_t acc2 {vdupq_n_f32(0)};
+			for (std::size_t i {}; i < paddedDimCount; i += 8)
+			{
+				const float32x4_t diff1 {vsubq_f32(vld1q_f32(a + i), vld1q_f32(b + i))};
+				const float32x4_t diff2 {vsubq_f32(vld1q_f32(a + i + 4), vld1q_f32(b + i + 4))};
+				acc1 = vfmaq_f32(acc1, vmulq_f32(diff1, diff1), vld1q_f32(weights + i));
+				acc2 = vfmaq_f32(acc2, vmulq_f32(diff2, diff2), vld1q_f32(weights + i + 4));
+			}
+
+			return vaddvq_f32(vaddq_f32(acc1, acc2));
+		}
+#endif
+
+		DistanceFunc selectDistanceFunc()
+		{
+#if defined(LMS_SOM_HAS_AVX2_KERNEL)
+			if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+				return computeWeightedSquareDistanceAvx2;
+#elif defined(LMS_SOM_HAS_NEON_KERNEL)
+			return computeWeightedSquareDistanceNeon;
+#endif
+			return computeWeightedSquareDistanceScalar;
+		}
+
+		DistanceFunc getDistanceFunc()
+		{
+			static const DistanceFunc distanceFunc {selectDistanceFunc()};
+			return distanceFunc;
+		}
+	}
+
+	float computeWeightedSquareDistance(const float* a, const float* b, const float* weights, std::size_t paddedDimCount)
+	{
+		return getDistanceFunc()(a, b, weights, paddedDimCount);
+	}
+
+	std::size_t findClosestVector(const float* vectors, std::size_t vectorCount, const float* data, const float* weights, std::size_t paddedDimCount)
+	{
+		const DistanceFunc distanceFunc {getDistanceFunc()};
+
+		std::size_t closestIndex {};
+		float closestDistance {std::numeric_limits<float>::max()};
+
+		for (std::size_t i {}; i < vectorCount; ++i)
+		{
+			const float distance {distanceFunc(vectors + i * paddedDimCount, data, weights, paddedDimCount)};
+			if (distance < closestDistance)
+			{
+				closestDistance = distance;
+				closestIndex = i;
+			}
+		}
+
+		return closestIndex;
+	}
+} // namespace SOM::Kernels
@@ -22,12 +22,16 @@
 #include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <optional>
 #include <random>
 #include <sstream>
 #include <unordered_set>
 
 #include "utils/Logger.hpp"
 #include "utils/Random.hpp"
+#include "utils/Service.hpp"
+#include "utils/TaskExecutor.hpp"
+#include "som/DistanceKernels.hpp"
 
 namespace SOM
 {
@@ -85,7 +89,10 @@ _weights {inputDimCount, static_cast<InputVector::value_type>(1)},
 _refVectors {width, height, _inputDimCount},
 _distanceFunc {euclidianSquareDistance},
 _learningFactorFunc {defaultLearningFactor},
-_neighbourhoodFunc {defaultNeighbourhoodFunc}
+_neighbourhoodFunc {defaultNeighbourhoodFunc},
+_paddedDimCount {Kernels::getPaddedDimCount(inputDimCount)},
+_packedWeights {packValues(_weights)},
+_packedRefVectors(static_cast<std::size_t>(width) * height * _paddedDimCount)
 {
 	// init each vector with a random normalized value
 	for (Coordinate y {}; y < _refVectors.getHeight(); ++y)
@@ -94,6 +101,8 @@ _neighbourhoodFunc {defaultNeighbourhoodFunc}
 		{
 			for (InputVector::value_type& val : _refVectors.get({x,y}))
 				val = Random::getRealRandom<InputVector::value_type>(0, 1);
+
+			updatePackedRefVector({x, y});
 		}
 	}
 }
@@ -104,6 +113,7 @@ Network::setDataWeights(const InputVector& weights)
 	checkSameDimensions(weights, _inputDimCount);
 
 	_weights = weights;
+	_packedWeights = packValues(_weights);
 }
 
 void
@@ -112,6 +122,51 @@ Network::setRefVector(const Position& position, const InputVector& data)
 	checkSameDimensions(data, _inputDimCount);
 
 	_refVectors[position] = data;
+	updatePackedRefVector(position);
+}
+
+void
+Network::setDistanceFunc(DistanceFunc distanceFunc)
+{
+	_distanceFunc = std::move(distanceFunc);
+	_usePackedSearch = false;
+}
+
+std::vector<float>
+Network::packValues(const InputVector& data) const
+{
+	std::vector<float> res(_paddedDimCount);
+	std::copy(std::cbegin(data), std::cend(data), std::begin(res));
+
+	return res;
+}
+
+std::vector<float>
+Network::packValues(const std::vector<InputVector>& data) const
+{
+	std::vector<float> res(data.size() * _paddedDimCount);
+	for (std::size_t i {}; i < data.size(); ++i)
+		std::copy(std::cbegin(data[i]), std::cend(data[i]), std::begin(res) + i * _paddedDimCount);
+
+	return res;
+}
+
+void
+Network::updatePackedRefVector(const Position& position)
+{
+	const std::size_t index {position.x + static_cast<std::size_t>(_refVectors.getWidth()) * position.y};
+	const InputVector& refVector {_refVectors.get(position)};
+
+	std::copy(std::cbegin(refVector), std::cend(refVector), std::begin(_packedRefVectors) + index * _paddedDimCount);
+}
+
+Position
+Network::getClosestRefVectorPosition(const float* packedData) const
+{
+	const Coordinate width {_refVectors.getWidth()};
+	const std::size_t index {Kernels::findClosestVector(_packedRefVectors.data(), static_cast<std::size_t>(width) * _refVectors.getHeight(), packedData, _packedWeights.data(), _paddedDimCount)};
+
+	return {static_cast<Coordinate>(index % width), static_cast<Coordinate>(index / width)};
 }
 
 InputVector::Distance
@@ -180,6 +235,12 @@ Network::dump(std::ostream& os) const
 Position
 Network::getClosestRefVectorPosition(const InputVector& data) const
 {
+	if (_usePackedSearch)
+	{
+		checkSameDimensions(data, _inputDimCount);
+		return getClosestRefVectorPosition(packValues(data).data());
+	}
+
 	return _refVectors.getPositionMinElement([&](const auto& a, const auto& b)
 			{
 				return (_distanceFunc(a, data, _weights) < _distanceFunc(b, data, _weights));
@@ -277,6 +338,7 @@ Network::updateRefVectors(const Position& closestRefVectorPosition, const InputV
 			delta *= (learningFactor * _neighbourhoodFunc(norm, iteration));
 
 			refVector += delta;
+			updatePackedRefVector({x, y});
 		}
 	}
 }
@@ -289,7 +351,11 @@ Network::train(const std::vector<InputVector>& inputData, std::size_t nbIteratio
 
 	inputDataShuffled.reserve(inputData.size());
 	for (const auto& input : inputData)
+	{
+		checkSameDimensions(input, _inputDimCount);
 		inputDataShuffled.push_back(&input);
+	}
+	const std::vector<float> packedInputData {_usePackedSearch ? packValues(inputData) : std::vector<float> {}};
 
 	for (std::size_t i {}; i < nbIterations; ++i)
 	{
@@ -310,7 +376,8 @@ Network::train(const std::vector<InputVector>& inputData, std::size_t nbIteratio
 			if (stopRequested)
 				return;
 
-			updateRefVectors(getClosestRefVectorPosition(*input), *input, learningFactor, curIter);
+			const Position closestRefVectorPosition {_usePackedSearch ? getClosestRefVectorPosition(packedInputData.data() + (input - inputData.data()) * _paddedDimCount) : getClosestRefVectorPosition(*input)};
+			updateRefVectors(closestRefVectorPosition, *input, learningFactor, curIter);
 		}
 
 		if (stopRequested)
@@ -318,6 +385,148 @@ Network::train(const std::vector<InputVector>& inputData, std::size_t nbIteratio
 	}
 }
 
+// Calls func(begin, end) on contiguous sub ranges of [0, count), using up to threadCount threads of the executor
+template <typename Func>
+static void
+parallelFor(TaskExecutor& executor, std::size_t threadCount, std::size_t count, Func func)
+{
+	threadCount = std::clamp<std::size_t>(threadCount, 1, std::max<std::size_t>(count, 1));
+	const std::size_t chunkSize {(count + threadCount - 1) / threadCount};
+	const std::size_t chunkCount {(count + chunkSize - 1) / chunkSize};
+
+	parallelFor(executor, TaskExecutor::Priority::Background, chunkCount, threadCount, [&](std::size_t chunkIndex)
+	{
+		const std::size_t begin {chunkIndex * chunkSize};
+		func(begin, std::min(count, begin + chunkSize));
+	});
+}
+
+void
+Network::trainBatch(const std::vector<InputVector>& inputData, std::size_t nbIterations, std::size_t threadCount, ProgressCallback progressCallback, RequestStopCallback requestStopCallback)
+{
+	for (const InputVector& input : inputData)
+		checkSameDimensions(input, _inputDimCount);
+
+	if (inputData.empty())
+		return;
+
+	if (_usePackedSearch)
+	{
+		trainBatch(packValues(inputData), nbIterations, threadCount, std::move(progressCallback), std::move(requestStopCallback));
+		return;
+	}
+
+	trainBatch(inputData.size(), nbIterations, threadCount,
+			[&](std::size_t sampleIndex) { return getClosestRefVectorPosition(inputData[sampleIndex]); },
+			[&](InputVector& sum, std::size_t sampleIndex) { sum += inputData[sampleIndex]; },
+			std::move(progressCallback), std::move(requestStopCallback));
+}
+
+void
+Network::trainBatch(const std::vector<float>& packedInputData, std::size_t nbIterations, std::size_t threadCount, ProgressCallback progressCallback, RequestStopCallback requestStopCallback)
+{
+	if (!_usePackedSearch)
+		throw Exception {"Packed samples require the default distance function"};
+
+	if (packedInputData.size() % _paddedDimCount != 0)
+		throw Exception {"Bad packed samples size"};
+
+	trainBatch(packedInputData.size() / _paddedDimCount, nbIterations, threadCount,
+			[&](std::size_t sampleIndex) { return getClosestRefVectorPosition(packedInputData.data() + sampleIndex * _paddedDimCount); },
+			[&](InputVector& sum, std::size_t sampleIndex)
+			{
+				const float* sample {packedInputData.data() + sampleIndex * _paddedDimCount};
+				InputVector::value_type* sumValues {sum.data()};
+				for (std::size_t i {}; i < _inputDimCount; ++i)
+					sumValues[i] += sample[i];
+			},
+			std::move(progressCallback), std::move(requestStopCallback));
+}
+
+template <typename ClosestRefVectorPositionFunc, typename AccumulateFunc>
+void
+Network::trainBatch(std::size_t sampleCount, std::size_t nbIterations, std::size_t threadCount, ClosestRefVectorPositionFunc closestRefVectorPositionFunc, AccumulateFunc accumulateFunc, ProgressCallback progressCallback, RequestStopCallback requestStopCallback)
+{
+	if (sampleCount == 0)
+		return;
+
+	const Coordinate width {_refVectors.getWidth()};
+	const std::size_t refVectorCount {static_cast<std::size_t>(width) * _refVectors.getHeight()};
+	auto indexToPosition {[=](std::size_t index) { return Position {static_cast<Coordinate>(index % width), static_cast<Coordinate>(index / width)}; }};
+
+	// training is background work: use the shared executor if any, so that it competes with other background tasks only
+	std::optional<TaskExecutor> localExecutor;
+	TaskExecutor* executor {Service<TaskExecutor>::get()};
+	if (!executor)
+		executor = &localExecutor.emplace(std::max<std::size_t>(threadCount, 1));
+
+	std::vector<std::size_t> closestRefVectorIndexes(sampleCount);
+	std::vector<InputVector> sums(refVectorCount, InputVector {_inputDimCount});
+	std::vector<std::size_t> counts(refVectorCount);
+
+	for (std::size_t i {}; i < nbIterations; ++i)
+	{
+		CurrentIteration curIter {i, nbIterations};
+
+		if (progressCallback)
+			progressCallback(curIter);
+
+		if (requestStopCallback && requestStopCallback())
+			return;
+
+		parallelFor(*executor, threadCount, sampleCount, [&](std::size_t begin, std::size_t end)
+		{
+			for (std::size_t sampleIndex {begin}; sampleIndex < end; ++sampleIndex)
+			{
+				const Position position {closestRefVectorPositionFunc(sampleIndex)};
+				closestRefVectorIndexes[sampleIndex] = position.x + static_cast<std::size_t>(width) * position.y;
+			}
+		});
+
+		if (requestStopCallback && requestStopCallback())
+			return;
+
+		std::fill(std::begin(sums), std::end(sums), InputVector {_inputDimCount});
+		std::fill(std::begin(counts), std::end(counts), 0);
+		for (std::size_t sampleIndex {}; sampleIndex < sampleCount; ++sampleIndex)
+		{
+			accumulateFunc(sums[closestRefVectorIndexes[sampleIndex]], sampleIndex);
+			counts[closestRefVectorIndexes[sampleIndex]]++;
+		}
+
+		// ref vectors are only read through sums from now on, they can be updated concurrently
+		parallelFor(*executor, threadCount, refVectorCount, [&](std::size_t begin, std::size_t end)
+		{
+			for (std::size_t refVectorIndex {begin}; refVectorIndex < end; ++refVectorIndex)
+			{
+				const Position position {indexToPosition(refVectorIndex)};
+
+				InputVector numerator {_inputDimCount};
+				InputVector::value_type denominator {};
+				for (std::size_t matchingIndex {}; matchingIndex < refVectorCount; ++matchingIndex)
+				{
+					if (counts[matchingIndex] == 0)
+						continue;
+
+					const InputVector::value_type neighbourhood {_neighbourhoodFunc(computePositionNorm(position, indexToPosition(matchingIndex)), curIter)};
+
+					InputVector contribution {sums[matchingIndex]};
+					contribution *= neighbourhood;
+					numerator += contribution;
+					denominator += neighbourhood * counts[matchingIndex];
+				}
+
+				if (denominator <= 0)
+					continue;
+
+				numerator *= 1 / denominator;
+				_refVectors.get(position) = std::move(numerator);
+				updatePackedRefVector(position);
+			}
+		});
+	}
+}
+
 const InputVector&
 Network::getRefVector(const Position& position) const
 {
@@ -44,8 +44,11 @@ class DataNormalizer
 		void setValue(std::size_t index, const MinMax& minMax);
 
 		void computeNormalizationFactors(const std::vector<InputVector>& dataSamples);
+		// samples packed as contiguous floats, packedDimCount values per sample
+		void computeNormalizationFactors(const std::vector<float>& packedDataSamples, std::size_t packedDimCount);
 
 		void normalizeData(InputVector& data) const;
+		void normalizeData(float* data) const; // getInputDimCount() values
 
 		void dump(std::ostream& os) const;
 
@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace SOM::Kernels
+{
+	// Vectors are stored as contiguous floats, padded with zeros up to a multiple of laneCount values
+	// <!> padded weights must be zero
+	static constexpr std::size_t laneCount {8};
+
+	constexpr std::size_t getPaddedDimCount(std::size_t dimCount)
+	{
+		return (dimCount + laneCount - 1) / laneCount * laneCount;
+	}
+
+	// sum(weights[i] * (a[i] - b[i])^2)
+	float computeWeightedSquareDistance(const float* a, const float* b, const float* weights, std::size_t paddedDimCount);
+
+	// index of the vector of 'vectors' (vectorCount contiguous vectors) that is the closest to 'data'
+	std::size_t findClosestVector(const float* vectors, std::size_t vectorCount, const float* data, const float* weights, std::size_t paddedDimCount);
+} // namespace SOM::Kernels
@@ -71,7 +71,7 @@ class InputVector
 
 		InputVector& operator+=(const InputVector& other)
 		{
-			if (!hasSameDimension(other.getNbDimensions()))
+			if (!hasSameDimension(other))
 				throw Exception {"Not the same dimension count"};
 
 			for (std::size_t i {}; i < _values.size(); ++i)
@@ -84,7 +84,7 @@ class InputVector
 
 		InputVector& operator-=(const InputVector& other)
 		{
-			if (!hasSameDimension(other.getNbDimensions()))
+			if (!hasSameDimension(other))
 				throw Exception {"Not the same dimension count"};
 
 			for (std::size_t i {}; i < _values.size(); ++i)
@@ -115,8 +115,8 @@ class InputVector
 
 		Distance computeEuclidianSquareDistance(const InputVector& other, const InputVector& weights) const
 		{
-			if (!hasSameDimension(other.getNbDimensions())
-				|| !hasSameDimension(weights.getNbDimensions()))
+			if (!hasSameDimension(other)
+				|| !hasSameDimension(weights))
 			{
 				throw Exception {"Not the same dimension count"};
 			}
@@ -132,6 +132,16 @@ class InputVector
 			return res;
 		}
 
+		const value_type* data() const
+		{
+			return _values.data();
+		}
+
+		value_type* data()
+		{
+			return _values.data();
+		}
+
 		std::vector<value_type>::iterator begin()
 		{
 			return _values.begin();
@@ -165,7 +175,7 @@ class InputVector
 	private:
 		friend class InputVector operator-(const InputVector& a, const InputVector& b)
 		{
-			if (!a.hasSameDimension(b.getNbDimensions()))
+			if (!a.hasSameDimension(b))
 				throw Exception {"Not the same dimension count"};
 
 			InputVector res {a.getNbDimensions()};
@@ -64,8 +64,19 @@ class Network
 		using RequestStopCallback = std::function<bool()>;
 		void train(const std::vector<InputVector>& dataSamples, std::size_t nbIterations, ProgressCallback = ProgressCallback{}, RequestStopCallback = RequestStopCallback{});
 
+		// Batch training: at each iteration, the closest ref vector of all the samples is searched using threadCount threads,
+		// then each ref vector is replaced by the mean of the samples weighted by the neighbourhood function (learning factor is not used)
+		// <!> distance and neighbourhood functions must be thread safe
+		void trainBatch(const std::vector<InputVector>& dataSamples, std::size_t nbIterations, std::size_t threadCount, ProgressCallback = ProgressCallback{}, RequestStopCallback = RequestStopCallback{});
+
+		// Same using samples packed as contiguous floats, getPackedDimCount() values per sample (padding values must be zero)
+		// <!> only supported using the default distance function
+		std::size_t getPackedDimCount() const { return _paddedDimCount; }
+		void trainBatch(const std::vector<float>& packedDataSamples, std::size_t nbIterations, std::size_t threadCount, ProgressCallback = ProgressCallback{}, RequestStopCallback = RequestStopCallback{});
+
 		const InputVector& getRefVector(const Position& position) const;
 		Position getClosestRefVectorPosition(const InputVector& data) const;
+		Position getClosestRefVectorPosition(const float* packedData) const; // getPackedDimCount() values
 		std::optional<Position> getClosestRefVectorPosition(const InputVector& data, InputVector::Distance maxDistance) const;
 
 		std::optional<Position> getClosestRefVectorPosition(const std::vector<Position>& refVectorsPosition, InputVector::Distance maxDistance) const;
@@ -95,6 +106,14 @@ class Network
 
 		void updateRefVectors(const Position& closestRefVectorPosition, const InputVector& input, LearningFactor learningFactor, const CurrentIteration& iteration);
 
+		// Packed float copies of the weights and ref vectors, used by the closest ref vector searches (default distance function only)
+		std::vector<float> packValues(const InputVector& data) const;
+		std::vector<float> packValues(const std::vector<InputVector>& data) const;
+		void updatePackedRefVector(const Position& position);
+
+		template <typename ClosestRefVectorPositionFunc, typename AccumulateFunc>
+		void trainBatch(std::size_t sampleCount, std::size_t nbIterations, std::size_t threadCount, ClosestRefVectorPositionFunc closestRefVectorPositionFunc, AccumulateFunc accumulateFunc, ProgressCallback progressCallback, RequestStopCallback requestStopCallback);
+
 		std::size_t _inputDimCount {};
 		InputVector _weights;	// weight for each dimension
 		Matrix<InputVector> _refVectors;
@@ -102,6 +121,11 @@ class Network
 		DistanceFunc _distanceFunc;
 		LearningFactorFunc _learningFactorFunc;
 		NeighbourhoodFunc _neighbourhoodFunc;
+
+		std::size_t _paddedDimCount {};
+		bool _usePackedSearch {true};
+		std::vector<float> _packedWeights;
+		std::vector<float> _packedRefVectors; // width * height * _paddedDimCount, same order as _refVectors
 };
 
 } // namespace SOM
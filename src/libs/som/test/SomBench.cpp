@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "som/DataNormalizer.hpp"
+#include "som/Network.hpp"
+
+using namespace SOM;
+
+namespace
+{
+	// Dimension counts: a single 13 dimensions feature (mfcc), the default features engine set, and a large feature set
+	constexpr std::int64_t dimCounts[] {13, 61, 160};
+	constexpr std::int64_t mapSizes[] {20, 50, 100};
+
+	// Same ratio as the default features engine training settings
+	constexpr double sampleCountPerNeuron {4};
+
+	std::vector<InputVector> generateSamples(std::size_t sampleCount, std::size_t dimCount)
+	{
+		std::mt19937 generator {42};
+		std::uniform_real_distribution<InputVector::value_type> distribution {0, 1};
+
+		std::vector<InputVector> samples;
+		samples.reserve(sampleCount);
+		for (std::size_t i {}; i < sampleCount; ++i)
+		{
+			InputVector sample {dimCount};
+			for (std::size_t dim {}; dim < dimCount; ++dim)
+				sample[dim] = distribution(generator);
+			samples.push_back(std::move(sample));
+		}
+
+		return samples;
+	}
+
+	std::vector<float> packSamples(const std::vector<InputVector>& samples, std::size_t packedDimCount)
+	{
+		std::vector<float> packedSamples(samples.size() * packedDimCount);
+		for (std::size_t i {}; i < samples.size(); ++i)
+		{
+			for (std::size_t dim {}; dim < samples[i].getNbDimensions(); ++dim)
+				packedSamples[i * packedDimCount + dim] = static_cast<float>(samples[i][dim]);
+		}
+
+		return packedSamples;
+	}
+
+	std::size_t getSampleCount(Coordinate mapSize)
+	{
+		return static_cast<std::size_t>(mapSize * mapSize * sampleCountPerNeuron);
+	}
+
+	void mapArgs(benchmark::internal::Benchmark* bench)
+	{
+		for (const std::int64_t mapSize : mapSizes)
+		{
+			for (const std::int64_t dimCount : dimCounts)
+				bench->Args({mapSize, dimCount});
+		}
+	}
+
+	void mapAndThreadArgs(benchmark::internal::Benchmark* bench)
+	{
+		const std::int64_t threadCount {std::max<std::int64_t>(1, std::thread::hardware_concurrency())};
+		for (const std::int64_t mapSize : mapSizes)
+		{
+			for (const std::int64_t dimCount : dimCounts)
+			{
+				bench->Args({mapSize, dimCount, 1});
+				if (threadCount > 1)
+					bench->Args({mapSize, dimCount, threadCount});
+			}
+		}
+	}
+}
+
+// One iteration over all the samples, items are samples
+static void BM_Network_train(benchmark::State& state)
+{
+	const Coordinate mapSize {static_cast<Coordinate>(state.range(0))};
+	const std::size_t dimCount {static_cast<std::size_t>(state.range(1))};
+	const std::vector<InputVector> samples {generateSamples(getSampleCount(mapSize), dimCount)};
+
+	for (auto _ : state)
+	{
+		Network network {mapSize, mapSize, dimCount};
+		network.train(samples, 1);
+		benchmark::ClobberMemory();
+	}
+
+	state.SetItemsProcessed(state.iterations() * samples.size());
+}
+BENCHMARK(BM_Network_train)->Apply(mapArgs)->Unit(benchmark::kMillisecond);
+
+static void BM_Network_trainBatch(benchmark::State& state)
+{
+	const Coordinate mapSize {static_cast<Coordinate>(state.range(0))};
+	const std::size_t dimCount {static_cast<std::size_t>(state.range(1))};
+	const std::size_t threadCount {static_cast<std::size_t>(state.range(2))};
+	const std::vector<InputVector> samples {generateSamples(getSampleCount(mapSize), dimCount)};
+
+	for (auto _ : state)
+	{
+		Network network {mapSize, mapSize, dimCount};
+		network.trainBatch(samples, 1, threadCount);
+		benchmark::ClobberMemory();
+	}
+
+	state.SetItemsProcessed(state.iterations() * samples.size());
+}
+BENCHMARK(BM_Network_trainBatch)->Apply(mapAndThreadArgs)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_Network_trainBatchPacked(benchmark::State& state)
+{
+	const Coordinate mapSize {static_cast<Coordinate>(state.range(0))};
+	const std::size_t dimCount {static_cast<std::size_t>(state.range(1))};
+	const std::size_t threadCount {static_cast<std::size_t>(state.range(2))};
+	const std::vector<InputVector> samples {generateSamples(getSampleCount(mapSize), dimCount)};
+	const std::vector<float> packedSamples {packSamples(samples, Network {mapSize, mapSize, dimCount}.getPackedDimCount())};
+
+	for (auto _ : state)
+	{
+		Network network {mapSize, mapSize, dimCount};
+		network.trainBatch(packedSamples, 1, threadCount);
+		benchmark::ClobberMemory();
+	}
+
+	state.SetItemsProcessed(state.iterations() * samples.size());
+}
+BENCHMARK(BM_Network_trainBatchPacked)->Apply(mapAndThreadArgs)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Best matching unit search, items are searches
+static void BM_Network_getClosestRefVectorPosition(benchmark::State& state)
+{
+	const Coordinate mapSize {static_cast<Coordinate>(state.range(0))};
+	const std::size_t dimCount {static_cast<std::size_t>(state.range(1))};
+	const Network network {mapSize, mapSize, dimCount};
+	const std::vector<InputVector> samples {generateSamples(256, dimCount)};
+
+	std::size_t index {};
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(network.getClosestRefVectorPosition(samples[index]));
+		index = (index + 1) % samples.size();
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Network_getClosestRefVectorPosition)->Apply(mapArgs)->Unit(benchmark::kMicrosecond);
+
+static void BM_Network_getClosestRefVectorPositionPacked(benchmark::State& state)
+{
+	const Coordinate mapSize {static_cast<Coordinate>(state.range(0))};
+	const std::size_t dimCount {static_cast<std::size_t>(state.range(1))};
+	const Network network {mapSize, mapSize, dimCount};
+	const std::size_t packedDimCount {network.getPackedDimCount()};
+	const std::vector<float> packedSamples {packSamples(generateSamples(256, dimCount), packedDimCount)};
+
+	std::size_t index {};
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(network.getClosestRefVectorPosition(packedSamples.data() + index * packedDimCount));
+		index = (index + 1) % 256;
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Network_getClosestRefVectorPositionPacked)->Apply(mapArgs)->Unit(benchmark::kMicrosecond);
+
+// Normalization of the samples of a map, items are samples
+static void BM_DataNormalizer_computeNormalizationFactors(benchmark::State& state)
+{
+	const std::size_t dimCount {static_cast<std::size_t>(state.range(1))};
+	const std::vector<InputVector> samples {generateSamples(getSampleCount(static_cast<Coordinate>(state.range(0))), dimCount)};
+
+	for (auto _ : state)
+	{
+		DataNormalizer normalizer {dimCount};
+		normalizer.computeNormalizationFactors(samples);
+		benchmark::DoNotOptimize(normalizer.getValue(0));
+	}
+
+	state.SetItemsProcessed(state.iterations() * samples.size());
+}
+BENCHMARK(BM_DataNormalizer_computeNormalizationFactors)->Apply(mapArgs)->Unit(benchmark::kMicrosecond);
+
+static void BM_DataNormalizer_normalizeData(benchmark::State& state)
+{
+	const std::size_t dimCount {static_cast<std::size_t>(state.range(1))};
+	const std::vector<InputVector> samples {generateSamples(getSampleCount(static_cast<Coordinate>(state.range(0))), dimCount)};
+
+	DataNormalizer normalizer {dimCount};
+	normalizer.computeNormalizationFactors(samples);
+
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		std::vector<InputVector> data {samples};
+		state.ResumeTiming();
+
+		for (InputVector& sample : data)
+			normalizer.normalizeData(sample);
+		benchmark::ClobberMemory();
+	}
+
+	state.SetItemsProcessed(state.iterations() * samples.size());
+}
+BENCHMARK(BM_DataNormalizer_normalizeData)->Apply(mapArgs)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -126,6 +126,152 @@ TEST(som, Network)
 	}
 }
 
+TEST(som, NetworkBatch)
+{
+	Network network {3, 3, 2};
+
+	// two well separated clusters
+	std::vector<InputVector> trainData;
+	for (std::size_t i {}; i < 50; ++i)
+	{
+		InputVector input {2};
+		input[0] = 0.1 + (i % 5) * 0.01;
+		input[1] = 0.1 + (i % 7) * 0.01;
+		trainData.push_back(input);
+
+		input[0] = 0.9 - (i % 5) * 0.01;
+		input[1] = 0.9 - (i % 7) * 0.01;
+		trainData.push_back(input);
+	}
+
+	std::size_t progressCount {};
+	network.trainBatch(trainData, 10, 4, [&](const Network::CurrentIteration&) { progressCount++; });
+	EXPECT_EQ(progressCount, 10);
+
+	// samples of different clusters must not share the same ref vector
+	std::unordered_set<Position> positions1;
+	std::unordered_set<Position> positions2;
+	for (std::size_t i {}; i < trainData.size(); ++i)
+	{
+		const Position position {network.getClosestRefVectorPosition(trainData[i])};
+		((i % 2 == 0) ? positions1 : positions2).insert(position);
+
+		// trained ref vectors must be close to the samples
+		EXPECT_LT(network.getRefVector(position).computeEuclidianSquareDistance(trainData[i], network.getDataWeights()), 0.01);
+	}
+
+	for (const Position& position : positions1)
+		EXPECT_EQ(positions2.count(position), 0);
+}
+
+TEST(som, NetworkBatchStop)
+{
+	Network network {2, 2, 1};
+	const std::vector<InputVector> trainData {{1, 0.}, {1, 1.}};
+
+	std::size_t progressCount {};
+	network.trainBatch(trainData, 10, 2, [&](const Network::CurrentIteration&) { progressCount++; }, [&] { return progressCount == 3; });
+	EXPECT_EQ(progressCount, 3);
+}
+
+TEST(som, NetworkBatchPacked)
+{
+	Network network {4, 3, 5};
+	Network packedNetwork {4, 3, 5};
+	for (Coordinate y {}; y < network.getHeight(); ++y)
+	{
+		for (Coordinate x {}; x < network.getWidth(); ++x)
+			packedNetwork.setRefVector({x, y}, network.getRefVector({x, y}));
+	}
+
+	std::vector<InputVector> trainData;
+	std::vector<float> packedTrainData;
+	for (std::size_t i {}; i < 40; ++i)
+	{
+		InputVector input {5};
+		for (std::size_t j {}; j < input.getNbDimensions(); ++j)
+			input[j] = static_cast<float>((i * 3 + j * 11) % 19) / 19;
+		trainData.push_back(input);
+
+		packedTrainData.insert(std::end(packedTrainData), std::cbegin(input), std::cend(input));
+		packedTrainData.resize(packedTrainData.size() + packedNetwork.getPackedDimCount() - input.getNbDimensions(), 0);
+	}
+
+	network.trainBatch(trainData, 5, 2);
+	packedNetwork.trainBatch(packedTrainData, 5, 2);
+
+	for (Coordinate y {}; y < network.getHeight(); ++y)
+	{
+		for (Coordinate x {}; x < network.getWidth(); ++x)
+		{
+			for (std::size_t i {}; i < network.getInputDimCount(); ++i)
+				EXPECT_NEAR(network.getRefVector({x, y})[i], packedNetwork.getRefVector({x, y})[i], 1e-4);
+		}
+	}
+
+	EXPECT_THROW(packedNetwork.trainBatch(std::vector<float>(packedNetwork.getPackedDimCount() + 1), 1, 1), SOM::Exception);
+}
+
+TEST(som, DataNormalizerPacked)
+{
+	const std::vector<InputVector> samples {{2, 1.}, {2, 3.}, {2, -1.}};
+	const std::vector<float> packedSamples {1, 1, 0, 3, 3, 0, -1, -1, 0};
+
+	DataNormalizer normalizer {2};
+	normalizer.computeNormalizationFactors(samples);
+
+	DataNormalizer packedNormalizer {2};
+	packedNormalizer.computeNormalizationFactors(packedSamples, 3);
+
+	for (std::size_t i {}; i < 2; ++i)
+	{
+		EXPECT_EQ(packedNormalizer.getValue(i).min, normalizer.getValue(i).min);
+		EXPECT_EQ(packedNormalizer.getValue(i).max, normalizer.getValue(i).max);
+	}
+
+	float values[2] {2, 3};
+	packedNormalizer.normalizeData(values);
+	EXPECT_FLOAT_EQ(values[0], 0.75);
+	EXPECT_FLOAT_EQ(values[1], 1);
+}
+
+TEST(som, NetworkClosestRefVector)
+{
+	// non square network, dimension count not multiple of the vector size
+	Network network {7, 5, 13};
+
+	InputVector weights {13};
+	for (std::size_t i {}; i < weights.getNbDimensions(); ++i)
+		weights[i] = 0.5 + static_cast<InputVector::value_type>(i) / 10;
+	network.setDataWeights(weights);
+
+	for (std::size_t i {}; i < 100; ++i)
+	{
+		InputVector input {13};
+		for (std::size_t j {}; j < input.getNbDimensions(); ++j)
+			input[j] = static_cast<InputVector::value_type>((i * 7 + j * 13) % 17) / 17;
+
+		std::optional<Position> expectedPosition;
+		InputVector::Distance expectedDistance {};
+		for (Coordinate y {}; y < network.getHeight(); ++y)
+		{
+			for (Coordinate x {}; x < network.getWidth(); ++x)
+			{
+				const InputVector::Distance distance {network.getRefVector({x, y}).computeEuclidianSquareDistance(input, weights)};
+				if (!expectedPosition || distance < expectedDistance)
+				{
+					expectedPosition = Position {x, y};
+					expectedDistance = distance;
+				}
+			}
+		}
+
+		const Position position {network.getClosestRefVectorPosition(input)};
+		// float precision: may only pick another ref vector at the same distance
+		EXPECT_NEAR(network.getRefVector(position).computeEuclidianSquareDistance(input, weights), expectedDistance, 1e-4);
+	}
+}
+
 int main(int argc, char **argv)
 {
 	::testing::InitGoogleTest(&argc, argv);
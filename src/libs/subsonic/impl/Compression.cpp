@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Compression.hpp"
+
+#include <zlib.h>
+
+#include "utils/Exception.hpp"
+#include "utils/String.hpp"
+
+namespace API::Subsonic::Compression
+{
+    bool acceptsGzip(std::string_view acceptEncoding)
+    {
+        for (std::string_view coding : StringUtils::tokenizeString(acceptEncoding, ","))
+        {
+            // coding may have a weight (ex: "gzip;q=0.5")
+            const std::vector<std::string_view> codingParams{ StringUtils::splitString(coding, ";") };
+            if (codingParams.empty())
+                continue;
+
+            const std::string_view name{ StringUtils::stringTrim(codingParams.front()) };
+            if (name != "gzip" && name != "*")
+                continue;
+
+            bool acceptable{ true };
+            for (std::size_t i{ 1 }; i < codingParams.size(); ++i)
+            {
+                const std::string_view param{ StringUtils::stringTrim(codingParams[i]) };
+                if (param.substr(0, 2) == "q=")
+                {
+                    const std::optional<float> weight{ StringUtils::readAs<float>(param.substr(2)) };
+                    acceptable = weight && *weight > 0;
+                }
+            }
+
+            return acceptable;
+        }
+
+        return false;
+    }
+
+    std::string gzip(std::string_view data, int level)
+    {
+        z_stream stream{};
+
+        // 15 + 16: max window size with a gzip header
+        if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            throw LmsException{ "Cannot init gzip stream" };
+
+        std::string res;
+        res.resize(deflateBound(&stream, static_cast<uLong>(data.size())));
+
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+        stream.avail_in = static_cast<uInt>(data.size());
+        stream.next_out = reinterpret_cast<Bytef*>(res.data());
+        stream.avail_out = static_cast<uInt>(res.size());
+
+        const int err{ deflate(&stream, Z_FINISH) };
+        const std::size_t compressedSize{ stream.total_out };
+        deflateEnd(&stream);
+
+        if (err != Z_STREAM_END)
+            throw LmsException{ "Cannot gzip data" };
+
+        res.resize(compressedSize);
+        return res;
+    }
+}
+
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "FragmentCache.hpp"
+
+#include <functional>
+
+namespace API::Subsonic
+{
+    namespace
+    {
+        void hashCombine(std::size_t& seed, std::size_t value)
+        {
+            seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        }
+    }
+
+    bool FragmentCache::Key::operator==(const Key& other) const
+    {
+        return type == other.type
+            && id == other.id
+            && libraryGeneration == other.libraryGeneration
+            && format == other.format
+            && id3 == other.id3
+            && openSubsonic == other.openSubsonic;
+    }
+
+    std::size_t FragmentCache::KeyHash::operator()(const Key& key) const
+    {
+        std::size_t hash{ std::hash<Database::IdType::ValueType>{}(key.id) };
+        hashCombine(hash, std::hash<std::uint64_t>{}(key.libraryGeneration));
+        hashCombine(hash, static_cast<std::size_t>(key.type));
+        hashCombine(hash, static_cast<std::size_t>(key.format));
+        hashCombine(hash, (key.id3 ? 1 : 0) | (key.openSubsonic ? 2 : 0));
+
+        return hash;
+    }
+
+    FragmentCache::FragmentCache(std::size_t maxSize)
+        : _maxSize{ maxSize }
+    {
+    }
+
+    FragmentCache::Entry FragmentCache::get(const Key& key)
+    {
+        if (_maxSize == 0)
+            return {};
+
+        std::scoped_lock lock{ _mutex };
+
+        auto it{ _entriesByKey.find(key) };
+        if (it == std::cend(_entriesByKey))
+        {
+            _missCount++;
+            return {};
+        }
+
+        _hitCount++;
+        _entries.splice(std::begin(_entries), _entries, it->second);
+        return it->second->second;
+    }
+
+    void FragmentCache::put(const Key& key, Entry entry)
+    {
+        const std::size_t entrySize{ getEntrySize(entry) };
+        if (entrySize > _maxSize)
+            return;
+
+        std::scoped_lock lock{ _mutex };
+
+        if (auto it{ _entriesByKey.find(key) }; it != std::cend(_entriesByKey))
+        {
+            _currentSize -= getEntrySize(it->second->second);
+            _entries.erase(it->second);
+            _entriesByKey.erase(it);
+        }
+
+        while (!_entries.empty() && _currentSize + entrySize > _maxSize)
+        {
+            const auto& [oldestKey, oldestEntry] { _entries.back() };
+            _currentSize -= getEntrySize(oldestEntry);
+            _entriesByKey.erase(oldestKey);
+            _entries.pop_back();
+        }
+
+        _entries.emplace_front(key, std::move(entry));
+        _entriesByKey.emplace(key, std::begin(_entries));
+        _currentSize += entrySize;
+    }
+
+    void FragmentCache::clear()
+    {
+        std::scoped_lock lock{ _mutex };
+
+        _entries.clear();
+        _entriesByKey.clear();
+        _currentSize = 0;
+    }
+
+    std::size_t FragmentCache::getEntrySize(const Entry& entry)
+    {
+        // keys are stored twice
+        return 2 * sizeof(Key) + entry->getSize();
+    }
+}
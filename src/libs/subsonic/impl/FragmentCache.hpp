@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "services/database/IdType.hpp"
+#include "SubsonicResponse.hpp"
+
+namespace API::Subsonic
+{
+    // LRU cache of the serialized user independent part of the entity nodes, bounded by its total size
+    // Entries are built for a given library generation, older entries just age out
+    class FragmentCache
+    {
+    public:
+        FragmentCache(std::size_t maxSize);
+
+        FragmentCache(const FragmentCache&) = delete;
+        FragmentCache& operator=(const FragmentCache&) = delete;
+
+        enum class EntityType
+        {
+            Song,
+            Album,
+            Artist,
+        };
+
+        struct Key
+        {
+            EntityType type;
+            Database::IdType::ValueType id;
+            std::uint64_t libraryGeneration;
+            ResponseFormat format;
+            bool id3;
+            bool openSubsonic;
+
+            bool operator==(const Key& other) const;
+        };
+
+        using Entry = std::shared_ptr<const Response::Fragment>;
+
+        Entry get(const Key& key);
+        void put(const Key& key, Entry entry);
+        void clear();
+
+        template <typename CreateNodeFunc>
+        Entry getOrCreate(const Key& key, CreateNodeFunc createNode)
+        {
+            Entry entry{ get(key) };
+            if (!entry)
+            {
+                entry = std::make_shared<const Response::Fragment>(createNode(), key.format);
+                put(key, entry);
+            }
+
+            return entry;
+        }
+
+        std::size_t getHitCount() const { return _hitCount; }
+        std::size_t getMissCount() const { return _missCount; }
+
+    private:
+        struct KeyHash
+        {
+            std::size_t operator()(const Key& key) const;
+        };
+
+        static std::size_t getEntrySize(const Entry& entry);
+
+        const std::size_t _maxSize;
+
+        std::mutex _mutex;
+        using EntryList = std::list<std::pair<Key, Entry>>; // most recently used first
+        EntryList _entries;
+        std::unordered_map<Key, EntryList::iterator, KeyHash> _entriesByKey;
+        std::size_t _currentSize{};
+
+        std::atomic<std::size_t> _hitCount{};
+        std::atomic<std::size_t> _missCount{};
+    };
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LibraryGeneration.hpp"
+
+#include <algorithm>
+#include <ctime>
+#include <functional>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+namespace API::Subsonic
+{
+    namespace
+    {
+        // Parameters that do not have any effect on the response content
+        bool isParameterIgnored(const std::string& name)
+        {
+            return name == "u" || name == "p" || name == "t" || name == "s" || name == "_";
+        }
+
+        void hashCombine(std::size_t& seed, std::size_t value)
+        {
+            seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        }
+    }
+
+    LibraryGeneration::LibraryGeneration(std::chrono::seconds maxValidatorAge)
+        : _maxValidatorAge{ maxValidatorAge }
+        , _startTime{ Wt::WDateTime::currentDateTime() }
+        , _libraryGeneration{ 0, _startTime }
+    {
+    }
+
+    LibraryGeneration::Validator LibraryGeneration::getValidator(Database::UserId userId, std::string_view requestPath, const Wt::Http::ParameterMap& parameters) const
+    {
+        const Wt::WDateTime now{ Wt::WDateTime::currentDateTime() };
+        const std::uint64_t period{ getPeriod(now) };
+
+        Generation libraryGeneration;
+        {
+            std::shared_lock lock{ _mutex };
+            libraryGeneration = _libraryGeneration;
+        }
+        const Generation userGeneration{ getUserGeneration(userId) };
+
+        std::size_t hash{ std::hash<std::string_view>{}(requestPath) };
+        // parameter map is sorted
+        for (const auto& [name, values] : parameters)
+        {
+            if (isParameterIgnored(name))
+                continue;
+
+            hashCombine(hash, std::hash<std::string>{}(name));
+            for (const std::string& value : values)
+                hashCombine(hash, std::hash<std::string>{}(value));
+        }
+
+        hashCombine(hash, std::hash<std::time_t>{}(_startTime.toTime_t()));
+        hashCombine(hash, std::hash<Database::UserId>{}(userId));
+        hashCombine(hash, std::hash<std::uint64_t>{}(libraryGeneration.value));
+        hashCombine(hash, std::hash<std::uint64_t>{}(userGeneration.value));
+        hashCombine(hash, std::hash<std::uint64_t>{}(period));
+
+        std::ostringstream oss;
+        oss << '"' << std::hex << std::setw(sizeof(std::size_t) * 2) << std::setfill('0') << hash << '"';
+
+        Wt::WDateTime lastModified{ std::max(libraryGeneration.lastModified, userGeneration.lastModified) };
+        if (_maxValidatorAge.count() > 0)
+            lastModified = std::max(lastModified, _startTime.addSecs(static_cast<int>(period * _maxValidatorAge.count())));
+
+        return Validator{ oss.str(), lastModified };
+    }
+
+    Wt::WDateTime LibraryGeneration::getLastModified(Database::UserId userId) const
+    {
+        Wt::WDateTime lastModified;
+        {
+            std::shared_lock lock{ _mutex };
+            lastModified = _libraryGeneration.lastModified;
+        }
+
+        return std::max(lastModified, getUserGeneration(userId).lastModified);
+    }
+
+    std::uint64_t LibraryGeneration::getLibraryGeneration() const
+    {
+        std::shared_lock lock{ _mutex };
+
+        return _libraryGeneration.value;
+    }
+
+    std::uint64_t LibraryGeneration::getUserDataGeneration(Database::UserId userId) const
+    {
+        return getUserGeneration(userId).value;
+    }
+
+    void LibraryGeneration::onLibraryChanged()
+    {
+        std::unique_lock lock{ _mutex };
+
+        _libraryGeneration.value++;
+        _libraryGeneration.lastModified = Wt::WDateTime::currentDateTime();
+    }
+
+    void LibraryGeneration::onUserDataChanged(Database::UserId userId)
+    {
+        std::unique_lock lock{ _mutex };
+
+        Generation& generation{ _userGenerations[userId] };
+        generation.value++;
+        generation.lastModified = Wt::WDateTime::currentDateTime();
+    }
+
+    LibraryGeneration::Generation LibraryGeneration::getUserGeneration(Database::UserId userId) const
+    {
+        std::shared_lock lock{ _mutex };
+
+        auto it{ _userGenerations.find(userId) };
+        if (it == std::cend(_userGenerations))
+            return Generation{ 0, _startTime };
+
+        return it->second;
+    }
+
+    std::uint64_t LibraryGeneration::getPeriod(const Wt::WDateTime& now) const
+    {
+        if (_maxValidatorAge.count() <= 0)
+            return 0;
+
+        return static_cast<std::uint64_t>(_startTime.secsTo(now)) / static_cast<std::uint64_t>(_maxValidatorAge.count());
+    }
+}
+
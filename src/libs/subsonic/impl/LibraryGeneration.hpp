@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <Wt/WDateTime.h>
+#include <Wt/Http/Request.h>
+
+#include "services/database/UserId.hpp"
+
+namespace API::Subsonic
+{
+    // Cheap in-process change counters, used to answer conditional requests
+    // without querying the database
+    // Changes made outside of the API (web UI, ...) are only caught by
+    // expiring validators after maxValidatorAge
+    class LibraryGeneration
+    {
+    public:
+        LibraryGeneration(std::chrono::seconds maxValidatorAge);
+
+        LibraryGeneration(const LibraryGeneration&) = delete;
+        LibraryGeneration& operator=(const LibraryGeneration&) = delete;
+
+        struct Validator
+        {
+            std::string etag;
+            Wt::WDateTime lastModified;
+        };
+        Validator getValidator(Database::UserId userId, std::string_view requestPath, const Wt::Http::ParameterMap& parameters) const;
+        Wt::WDateTime getLastModified(Database::UserId userId) const;
+        std::uint64_t getLibraryGeneration() const;
+        std::uint64_t getUserDataGeneration(Database::UserId userId) const;
+
+        void onLibraryChanged();
+        void onUserDataChanged(Database::UserId userId);
+
+    private:
+        struct Generation
+        {
+            std::uint64_t value{};
+            Wt::WDateTime lastModified;
+        };
+        Generation getUserGeneration(Database::UserId userId) const;
+        std::uint64_t getPeriod(const Wt::WDateTime& now) const;
+
+        const std::chrono::seconds _maxValidatorAge;
+        const Wt::WDateTime _startTime;
+
+        mutable std::shared_mutex _mutex;
+        Generation _libraryGeneration;
+        std::unordered_map<Database::UserId, Generation> _userGenerations;
+    };
+}
+
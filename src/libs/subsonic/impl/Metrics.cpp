@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Metrics.hpp"
+
+#include <algorithm>
+
+namespace API::Subsonic
+{
+    namespace
+    {
+        std::string escapeLabelValue(std::string_view value)
+        {
+            std::string res;
+            res.reserve(value.size());
+
+            for (char c : value)
+            {
+                switch (c)
+                {
+                case '\\': res += "\\\\"; break;
+                case '"': res += "\\\""; break;
+                case '\n': res += "\\n"; break;
+                default: res += c;
+                }
+            }
+
+            return res;
+        }
+
+        std::string makeLabels(const std::string& endpoint, const std::string& type, const std::string& client)
+        {
+            std::string res{ "endpoint=\"" + escapeLabelValue(endpoint) + "\"" };
+            if (!type.empty())
+                res += ",type=\"" + escapeLabelValue(type) + "\"";
+            res += ",client=\"" + escapeLabelValue(client) + "\"";
+
+            return res;
+        }
+
+        std::string_view priorityToString(Http::ClientRequestParameters::Priority priority)
+        {
+            switch (priority)
+            {
+            case Http::ClientRequestParameters::Priority::High: return "high";
+            case Http::ClientRequestParameters::Priority::Normal: return "normal";
+            case Http::ClientRequestParameters::Priority::Low: return "low";
+            }
+
+            return "unknown";
+        }
+    }
+
+    Metrics::Metrics(std::size_t maxClientCount)
+        : _maxClientCount{ maxClientCount }
+    {
+    }
+
+    void Metrics::Histogram::add(std::chrono::steady_clock::duration duration)
+    {
+        const double seconds{ std::chrono::duration<double>(duration).count() };
+
+        // values above the last bound only count in +Inf
+        auto it{ std::lower_bound(std::cbegin(bucketBounds), std::cend(bucketBounds), seconds) };
+        if (it != std::cend(bucketBounds))
+            bucketCounts[std::distance(std::cbegin(bucketBounds), it)]++;
+
+        sum += seconds;
+        count++;
+    }
+
+    void Metrics::record(const RequestStats& stats)
+    {
+        std::scoped_lock lock{ _mutex };
+
+        // client names are chosen by the clients: bound the number of series
+        std::string client{ stats.client };
+        if (_clients.find(client) == std::cend(_clients))
+        {
+            if (_clients.size() < _maxClientCount)
+                _clients.emplace(client);
+            else
+                client = "other";
+        }
+
+        Series& series{ _series[SeriesKey{ std::string{ stats.endpoint }, std::string{ stats.type }, client }] };
+        series.requestCountByStatus[std::string{ stats.status }]++;
+        if (stats.handlerDuration)
+            series.handlerDurations.add(*stats.handlerDuration);
+        if (stats.serializationDuration)
+            series.serializationDurations.add(*stats.serializationDuration);
+        series.responseBytes += stats.responseSize;
+        if (stats.allocations)
+        {
+            series.allocationCount += stats.allocations->allocationCount;
+            series.allocatedBytes += stats.allocations->allocatedBytes;
+        }
+    }
+
+    void Metrics::write(std::ostream& os) const
+    {
+        std::scoped_lock lock{ _mutex };
+
+        os << "# HELP lms_subsonic_requests_total Subsonic API requests\n";
+        os << "# TYPE lms_subsonic_requests_total counter\n";
+        for (const auto& [key, series] : _series)
+        {
+            const std::string labels{ makeLabels(std::get<0>(key), std::get<1>(key), std::get<2>(key)) };
+            for (const auto& [status, count] : series.requestCountByStatus)
+                os << "lms_subsonic_requests_total{" << labels << ",status=\"" << escapeLabelValue(status) << "\"} " << count << "\n";
+        }
+
+        os << "# HELP lms_subsonic_response_bytes_total Subsonic API response bytes, before compression\n";
+        os << "# TYPE lms_subsonic_response_bytes_total counter\n";
+        for (const auto& [key, series] : _series)
+            os << "lms_subsonic_response_bytes_total{" << makeLabels(std::get<0>(key), std::get<1>(key), std::get<2>(key)) << "} " << series.responseBytes << "\n";
+
+        os << "# HELP lms_subsonic_handler_duration_seconds Time spent querying the database and building Subsonic API responses\n";
+        os << "# TYPE lms_subsonic_handler_duration_seconds histogram\n";
+        for (const auto& [key, series] : _series)
+            writeHistogram(os, "lms_subsonic_handler_duration_seconds", makeLabels(std::get<0>(key), std::get<1>(key), std::get<2>(key)), series.handlerDurations);
+
+        os << "# HELP lms_subsonic_serialization_duration_seconds Time spent serializing Subsonic API responses\n";
+        os << "# TYPE lms_subsonic_serialization_duration_seconds histogram\n";
+        for (const auto& [key, series] : _series)
+            writeHistogram(os, "lms_subsonic_serialization_duration_seconds", makeLabels(std::get<0>(key), std::get<1>(key), std::get<2>(key)), series.serializationDurations);
+
+        if (!AllocationCounters::isEnabled())
+            return;
+
+        os << "# HELP lms_subsonic_request_allocations_total Allocations made while handling Subsonic API requests\n";
+        os << "# TYPE lms_subsonic_request_allocations_total counter\n";
+        for (const auto& [key, series] : _series)
+            os << "lms_subsonic_request_allocations_total{" << makeLabels(std::get<0>(key), std::get<1>(key), std::get<2>(key)) << "} " << series.allocationCount << "\n";
+
+        os << "# HELP lms_subsonic_request_allocated_bytes_total Bytes allocated while handling Subsonic API requests\n";
+        os << "# TYPE lms_subsonic_request_allocated_bytes_total counter\n";
+        for (const auto& [key, series] : _series)
+            os << "lms_subsonic_request_allocated_bytes_total{" << makeLabels(std::get<0>(key), std::get<1>(key), std::get<2>(key)) << "} " << series.allocatedBytes << "\n";
+    }
+
+    void Metrics::writeHistogram(std::ostream& os, std::string_view name, std::string_view labels, const Histogram& histogram)
+    {
+        if (histogram.count == 0)
+            return;
+
+        std::uint64_t cumulativeCount{};
+        for (std::size_t i{}; i < bucketBounds.size(); ++i)
+        {
+            cumulativeCount += histogram.bucketCounts[i];
+            os << name << "_bucket{" << labels << ",le=\"" << bucketBounds[i] << "\"} " << cumulativeCount << "\n";
+        }
+        os << name << "_bucket{" << labels << ",le=\"+Inf\"} " << histogram.count << "\n";
+        os << name << "_sum{" << labels << "} " << histogram.sum << "\n";
+        os << name << "_count{" << labels << "} " << histogram.count << "\n";
+    }
+
+    void writeHttpClientMetrics(std::ostream& os, const std::vector<Http::ClientStats>& stats)
+    {
+        os << "# HELP lms_http_client_queued_requests Outgoing HTTP requests waiting to be sent\n";
+        os << "# TYPE lms_http_client_queued_requests gauge\n";
+        for (const Http::ClientStats& clientStats : stats)
+        {
+            for (const auto& [priority, count] : clientStats.queuedRequestCounts)
+                os << "lms_http_client_queued_requests{base_url=\"" << escapeLabelValue(clientStats.baseUrl) << "\",priority=\"" << priorityToString(priority) << "\"} " << count << "\n";
+        }
+
+        os << "# HELP lms_http_client_inflight_requests Outgoing HTTP requests waiting for a response\n";
+        os << "# TYPE lms_http_client_inflight_requests gauge\n";
+        for (const Http::ClientStats& clientStats : stats)
+            os << "lms_http_client_inflight_requests{base_url=\"" << escapeLabelValue(clientStats.baseUrl) << "\"} " << clientStats.inFlightRequestCount << "\n";
+
+        os << "# HELP lms_http_client_retries_total Outgoing HTTP requests sent again after a network error or a rate limit\n";
+        os << "# TYPE lms_http_client_retries_total counter\n";
+        for (const Http::ClientStats& clientStats : stats)
+            os << "lms_http_client_retries_total{base_url=\"" << escapeLabelValue(clientStats.baseUrl) << "\"} " << clientStats.retryCount << "\n";
+
+        os << "# HELP lms_http_client_failures_total Outgoing HTTP requests given up\n";
+        os << "# TYPE lms_http_client_failures_total counter\n";
+        for (const Http::ClientStats& clientStats : stats)
+            os << "lms_http_client_failures_total{base_url=\"" << escapeLabelValue(clientStats.baseUrl) << "\"} " << clientStats.failureCount << "\n";
+
+        os << "# HELP lms_http_client_throttled_seconds_total Time spent waiting before sending requests again, due to errors or rate limits\n";
+        os << "# TYPE lms_http_client_throttled_seconds_total counter\n";
+        for (const Http::ClientStats& clientStats : stats)
+            os << "lms_http_client_throttled_seconds_total{base_url=\"" << escapeLabelValue(clientStats.baseUrl) << "\"} " << std::chrono::duration<double>(clientStats.throttledDuration).count() << "\n";
+
+        os << "# HELP lms_http_client_request_duration_seconds Time between sending outgoing HTTP requests and getting their response\n";
+        os << "# TYPE lms_http_client_request_duration_seconds summary\n";
+        for (const Http::ClientStats& clientStats : stats)
+        {
+            const std::string labels{ "base_url=\"" + escapeLabelValue(clientStats.baseUrl) + "\"" };
+            os << "lms_http_client_request_duration_seconds_sum{" << labels << "} " << std::chrono::duration<double>(clientStats.latencySum).count() << "\n";
+            os << "lms_http_client_request_duration_seconds_count{" << labels << "} " << clientStats.completedRequestCount << "\n";
+        }
+    }
+}
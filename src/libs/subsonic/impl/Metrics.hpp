@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+
+#include "utils/AllocationCounters.hpp"
+#include "utils/http/IClient.hpp"
+
+namespace API::Subsonic
+{
+    // In-process request statistics, per entry point and per client
+    // Exported using the Prometheus text exposition format
+    class Metrics
+    {
+    public:
+        Metrics(std::size_t maxClientCount);
+
+        Metrics(const Metrics&) = delete;
+        Metrics& operator=(const Metrics&) = delete;
+
+        struct RequestStats
+        {
+            std::string_view endpoint;
+            std::string_view type;      // sub type of the request (album list type, ...), may be empty
+            std::string_view client;
+            std::string_view status;    // "ok", "cached", "coalesced", "notModified" or the Subsonic error code
+            std::optional<std::chrono::steady_clock::duration> handlerDuration;         // database queries and response building
+            std::optional<std::chrono::steady_clock::duration> serializationDuration;
+            std::size_t responseSize{};     // before compression
+            std::optional<AllocationCounters::Counters> allocations;   // only when built with allocation profiling
+        };
+        void record(const RequestStats& stats);
+
+        void write(std::ostream& os) const;
+
+    private:
+        static constexpr std::array<double, 12> bucketBounds{ 0.001, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10 }; // seconds
+
+        struct Histogram
+        {
+            std::array<std::uint64_t, bucketBounds.size()> bucketCounts{}; // not cumulative
+            double sum{};
+            std::uint64_t count{};
+
+            void add(std::chrono::steady_clock::duration duration);
+        };
+
+        struct Series
+        {
+            std::map<std::string, std::uint64_t> requestCountByStatus;
+            Histogram handlerDurations;
+            Histogram serializationDurations;
+            std::uint64_t responseBytes{};
+            std::uint64_t allocationCount{};
+            std::uint64_t allocatedBytes{};
+        };
+
+        using SeriesKey = std::tuple<std::string, std::string, std::string>; // endpoint, type, client
+
+        static void writeHistogram(std::ostream& os, std::string_view name, std::string_view labels, const Histogram& histogram);
+
+        const std::size_t _maxClientCount;
+
+        mutable std::mutex _mutex;
+        std::unordered_set<std::string> _clients;
+        std::map<SeriesKey, Series> _series;
+    };
+
+    // Outgoing requests made by the other services (ListenBrainz, ...)
+    void writeHttpClientMetrics(std::ostream& os, const std::vector<Http::ClientStats>& stats);
+}
+
@@ -41,6 +41,7 @@ namespace API::Subsonic
         if (it == parameterMap.end())
             return res;
 
+        res.reserve(it->second.size());
         for (const std::string& param : it->second)
         {
             auto value{ StringUtils::readAs<T>(param) };
@@ -64,12 +65,11 @@ namespace API::Subsonic
     template<typename T>
     std::optional<T> getParameterAs(const Wt::Http::ParameterMap& parameterMap, const std::string& param)
     {
-        std::vector<T> params{ getMultiParametersAs<T>(parameterMap, param) };
-
-        if (params.size() != 1)
+        auto it = parameterMap.find(param);
+        if (it == parameterMap.end() || it->second.size() != 1)
             return std::nullopt;
 
-        return T{ std::move(params.front()) };
+        return StringUtils::readAs<T>(it->second.front());
     }
 
     template<typename T>
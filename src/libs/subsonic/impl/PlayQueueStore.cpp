@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PlayQueueStore.hpp"
+
+#include <algorithm>
+
+#include "services/database/Db.hpp"
+#include "services/database/PlayQueue.hpp"
+#include "services/database/Session.hpp"
+#include "services/database/User.hpp"
+#include "utils/Logger.hpp"
+
+namespace API::Subsonic
+{
+    namespace
+    {
+        WriteBehindQueue<Database::UserId>::Parameters getWriteQueueParameters(std::chrono::milliseconds writeDelay)
+        {
+            WriteBehindQueue<Database::UserId>::Parameters params;
+            params.maxDelay = writeDelay;
+            params.maxPendingEventCount = 256; // saves of the same users are merged anyway
+
+            return params;
+        }
+    }
+
+    PlayQueueStore::PlayQueueStore(Database::Db& db, std::chrono::milliseconds writeDelay)
+        : _db{ db }
+        , _writeQueue{ _ioContext, getWriteQueueParameters(writeDelay), [this](const std::vector<Database::UserId>& userIds) { write(userIds); } }
+        , _ioContextRunner{ _ioContext, 1 }
+    {
+    }
+
+    // the runner is stopped first, then the write queue writes the pending saves
+    PlayQueueStore::~PlayQueueStore() = default;
+
+    std::shared_ptr<const PlayQueueStore::PlayQueue> PlayQueueStore::get(Database::Session& session, Database::UserId userId)
+    {
+        {
+            const std::scoped_lock lock{ _mutex };
+
+            if (auto it{ _playQueues.find(userId) }; it != std::cend(_playQueues))
+                return it->second;
+        }
+
+        std::shared_ptr<PlayQueue> playQueue;
+        {
+            auto transaction{ session.createSharedTransaction() };
+
+            if (const Database::PlayQueue::pointer dbPlayQueue{ Database::PlayQueue::find(session, userId) })
+            {
+                playQueue = std::make_shared<PlayQueue>();
+                playQueue->trackIds = dbPlayQueue->getTrackIds();
+                playQueue->currentIndex = dbPlayQueue->getCurrentIndex();
+                playQueue->currentPosition = dbPlayQueue->getCurrentPosition();
+                playQueue->lastModifiedDateTime = dbPlayQueue->getLastModifiedDateTime();
+                playQueue->changedBy = dbPlayQueue->getChangedBy();
+            }
+        }
+
+        const std::scoped_lock lock{ _mutex };
+        // a save may have been made meanwhile
+        auto [it, inserted]{ _playQueues.try_emplace(userId, std::move(playQueue)) };
+        return it->second;
+    }
+
+    void PlayQueueStore::save(Database::UserId userId, PlayQueue playQueue)
+    {
+        {
+            const std::scoped_lock lock{ _mutex };
+            _playQueues[userId] = std::make_shared<const PlayQueue>(std::move(playQueue));
+        }
+
+        _writeQueue.push(userId);
+    }
+
+    void PlayQueueStore::write(const std::vector<Database::UserId>& userIds)
+    {
+        std::vector<Database::UserId> uniqueUserIds{ userIds };
+        std::sort(std::begin(uniqueUserIds), std::end(uniqueUserIds));
+        uniqueUserIds.erase(std::unique(std::begin(uniqueUserIds), std::end(uniqueUserIds)), std::end(uniqueUserIds));
+
+        // only the latest play queues are written
+        std::vector<std::pair<Database::UserId, std::shared_ptr<const PlayQueue>>> playQueues;
+        {
+            const std::scoped_lock lock{ _mutex };
+
+            for (const Database::UserId userId : uniqueUserIds)
+            {
+                if (auto it{ _playQueues.find(userId) }; it != std::cend(_playQueues) && it->second)
+                    playQueues.emplace_back(userId, it->second);
+            }
+        }
+
+        LMS_LOG(API_SUBSONIC, DEBUG) << "Writing " << playQueues.size() << " play queues (" << userIds.size() << " saves)";
+
+        Database::Session& session{ _db.getTLSSession() };
+        auto transaction{ session.createUniqueTransaction() };
+
+        for (const auto& [userId, playQueue] : playQueues)
+        {
+            const Database::User::pointer user{ Database::User::find(session, userId) };
+            if (!user)
+                continue;
+
+            Database::PlayQueue::pointer dbPlayQueue{ Database::PlayQueue::find(session, userId) };
+            if (!dbPlayQueue)
+                dbPlayQueue = session.create<Database::PlayQueue>(user);
+
+            dbPlayQueue.modify()->setTrackIds(playQueue->trackIds);
+            dbPlayQueue.modify()->setCurrentIndex(playQueue->currentIndex);
+            dbPlayQueue.modify()->setCurrentPosition(playQueue->currentPosition);
+            dbPlayQueue.modify()->setLastModifiedDateTime(playQueue->lastModifiedDateTime);
+            dbPlayQueue.modify()->setChangedBy(playQueue->changedBy);
+        }
+    }
+}
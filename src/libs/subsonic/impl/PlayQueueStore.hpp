@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <Wt/WDateTime.h>
+
+#include "services/database/TrackId.hpp"
+#include "services/database/UserId.hpp"
+#include "utils/IOContextRunner.hpp"
+#include "utils/WriteBehindQueue.hpp"
+
+namespace Database
+{
+    class Db;
+    class Session;
+}
+
+namespace API::Subsonic
+{
+    // Latest play queue of each user, read from memory
+    // Clients save their play queue very often (track changes, pauses...): saves are written to the database
+    // after a delay, and only the latest play queue of each user is written (last write wins)
+    class PlayQueueStore
+    {
+    public:
+        struct PlayQueue
+        {
+            std::vector<Database::TrackId> trackIds;
+            std::size_t currentIndex{};
+            std::chrono::milliseconds currentPosition{}; // in the current track
+            Wt::WDateTime lastModifiedDateTime;
+            std::string changedBy; // client name
+        };
+
+        PlayQueueStore(Database::Db& db, std::chrono::milliseconds writeDelay);
+        ~PlayQueueStore(); // pending saves are written
+
+        PlayQueueStore(const PlayQueueStore&) = delete;
+        PlayQueueStore& operator=(const PlayQueueStore&) = delete;
+
+        // null if the user never saved a play queue, read from the database on first use
+        std::shared_ptr<const PlayQueue> get(Database::Session& session, Database::UserId userId);
+        void save(Database::UserId userId, PlayQueue playQueue);
+
+    private:
+        void write(const std::vector<Database::UserId>& userIds);
+
+        Database::Db& _db;
+
+        std::mutex _mutex;
+        std::unordered_map<Database::UserId, std::shared_ptr<const PlayQueue>> _playQueues; // null values for users without play queue
+
+        boost::asio::io_context _ioContext;
+        WriteBehindQueue<Database::UserId> _writeQueue;
+        IOContextRunner _ioContextRunner;
+    };
+}
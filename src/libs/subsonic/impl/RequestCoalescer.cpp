@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RequestCoalescer.hpp"
+
+#include <exception>
+#include <optional>
+
+namespace API::Subsonic
+{
+    RequestCoalescer::Entry RequestCoalescer::run(const std::string& key, const std::function<Entry()>& func, bool& coalesced)
+    {
+        std::promise<Entry> promise;
+        std::optional<std::shared_future<Entry>> inFlightRequest;
+        {
+            std::scoped_lock lock{ _mutex };
+
+            auto it{ _inFlightRequests.find(key) };
+            if (it != std::cend(_inFlightRequests))
+                inFlightRequest = it->second;
+            else
+                _inFlightRequests.emplace(key, promise.get_future().share());
+        }
+
+        coalesced = inFlightRequest.has_value();
+        if (inFlightRequest)
+        {
+            _coalescedCount++;
+            return inFlightRequest->get(); // rethrows the error of the first request, if any
+        }
+
+        // removed before the result is set, so that requests received after the end of the handling are handled again
+        const auto removeInFlightRequest{ [&]
+            {
+                std::scoped_lock lock{ _mutex };
+                _inFlightRequests.erase(key);
+            } };
+
+        try
+        {
+            Entry entry{ func() };
+            removeInFlightRequest();
+            promise.set_value(entry);
+            return entry;
+        }
+        catch (...)
+        {
+            removeInFlightRequest();
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+    }
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "ResponseCache.hpp"
+
+namespace API::Subsonic
+{
+    // Identical requests received while a first one is being handled wait for its serialized response instead of being handled again
+    class RequestCoalescer
+    {
+    public:
+        RequestCoalescer() = default;
+
+        RequestCoalescer(const RequestCoalescer&) = delete;
+        RequestCoalescer& operator=(const RequestCoalescer&) = delete;
+
+        using Entry = ResponseCache::Entry;
+
+        // Runs func, unless a request with the same key is in flight: its result (or exception) is shared
+        Entry run(const std::string& key, const std::function<Entry()>& func, bool& coalesced);
+
+        std::size_t getCoalescedCount() const { return _coalescedCount; }
+
+    private:
+        std::mutex _mutex;
+        std::unordered_map<std::string, std::shared_future<Entry>> _inFlightRequests;
+
+        std::atomic<std::size_t> _coalescedCount{};
+    };
+}
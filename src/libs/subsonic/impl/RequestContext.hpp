@@ -19,13 +19,18 @@
 
 #pragma once
 
+#include <memory>
 #include <string>
 
 #include <Wt/Http/Request.h>
 
 #include "services/database/UserId.hpp"
 #include "ClientInfo.hpp"
+#include "LibraryGeneration.hpp"
 #include "ProtocolVersion.hpp"
+#include "ResponseFormat.hpp"
+#include "StarredDateTimes.hpp"
+#include "UserSettingsCache.hpp"
 
 namespace Database
 {
@@ -34,15 +39,26 @@ namespace Database
 
 namespace API::Subsonic
 {
+    class FragmentCache;
+    class PlayQueueStore;
+
     struct RequestContext
     {
         const Wt::Http::ParameterMap& parameters;
         Database::Session& dbSession;
         Database::UserId userId;
+        std::shared_ptr<const UserSettings> userSettings; // never null
         ClientInfo clientInfo;
         ProtocolVersion serverProtocolVersion;
+        const LibraryGeneration& libraryGeneration;
+        FragmentCache& fragmentCache;
+        PlayQueueStore& playQueueStore;
+        ResponseFormat responseFormat;
         bool enableOpenSubsonic{ true };
         bool enableDefaultCover{ };
+        bool enableWebPCover{ };
+        bool requireContentLength{ }; // for transcoded streams, even if not requested
+        StarredDateTimes starredDateTimes;
     };
 }
 
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ResponseCache.hpp"
+
+namespace API::Subsonic
+{
+    ResponseCache::ResponseCache(std::size_t maxSize)
+        : _maxSize{ maxSize }
+    {
+    }
+
+    ResponseCache::Entry ResponseCache::get(const std::string& key)
+    {
+        std::scoped_lock lock{ _mutex };
+
+        auto it{ _entriesByKey.find(key) };
+        if (it == std::cend(_entriesByKey))
+        {
+            _missCount++;
+            return {};
+        }
+
+        _hitCount++;
+        _entries.splice(std::begin(_entries), _entries, it->second);
+        return it->second->second;
+    }
+
+    void ResponseCache::put(const std::string& key, Entry entry)
+    {
+        const std::size_t entrySize{ getEntrySize(key, entry) };
+        if (entrySize > _maxSize)
+            return;
+
+        std::scoped_lock lock{ _mutex };
+
+        if (auto it{ _entriesByKey.find(key) }; it != std::cend(_entriesByKey))
+        {
+            _currentSize -= getEntrySize(key, it->second->second);
+            _entries.erase(it->second);
+            _entriesByKey.erase(it);
+        }
+
+        while (!_entries.empty() && _currentSize + entrySize > _maxSize)
+        {
+            const auto& [oldestKey, oldestEntry] { _entries.back() };
+            _currentSize -= getEntrySize(oldestKey, oldestEntry);
+            _entriesByKey.erase(oldestKey);
+            _entries.pop_back();
+        }
+
+        _entries.emplace_front(key, std::move(entry));
+        _entriesByKey.emplace(key, std::begin(_entries));
+        _currentSize += entrySize;
+    }
+
+    void ResponseCache::clear()
+    {
+        std::scoped_lock lock{ _mutex };
+
+        _entries.clear();
+        _entriesByKey.clear();
+        _currentSize = 0;
+    }
+
+    std::size_t ResponseCache::getEntrySize(const std::string& key, const Entry& entry)
+    {
+        // keys are stored twice
+        return 2 * key.size() + entry->size();
+    }
+}
+
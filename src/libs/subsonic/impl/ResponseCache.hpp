@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace API::Subsonic
+{
+    // LRU cache of serialized responses, bounded by its total size
+    class ResponseCache
+    {
+    public:
+        ResponseCache(std::size_t maxSize);
+
+        ResponseCache(const ResponseCache&) = delete;
+        ResponseCache& operator=(const ResponseCache&) = delete;
+
+        using Entry = std::shared_ptr<const std::string>;
+
+        Entry get(const std::string& key);
+        void put(const std::string& key, Entry entry);
+        void clear();
+
+        std::size_t getHitCount() const { return _hitCount; }
+        std::size_t getMissCount() const { return _missCount; }
+
+    private:
+        static std::size_t getEntrySize(const std::string& key, const Entry& entry);
+
+        const std::size_t _maxSize;
+
+        std::mutex _mutex;
+        using EntryList = std::list<std::pair<std::string, Entry>>; // most recently used first
+        EntryList _entries;
+        std::unordered_map<std::string, EntryList::iterator> _entriesByKey;
+        std::size_t _currentSize{};
+
+        std::atomic<std::size_t> _hitCount{};
+        std::atomic<std::size_t> _missCount{};
+    };
+}
+
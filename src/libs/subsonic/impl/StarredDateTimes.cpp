@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "StarredDateTimes.hpp"
+
+#include "services/feedback/IFeedbackService.hpp"
+#include "utils/Service.hpp"
+
+namespace API::Subsonic
+{
+    void StarredDateTimes::load(Database::UserId userId, const std::vector<Database::ArtistId>& artistIds)
+    {
+        load(_artists, userId, artistIds);
+    }
+
+    void StarredDateTimes::load(Database::UserId userId, const std::vector<Database::ReleaseId>& releaseIds)
+    {
+        load(_releases, userId, releaseIds);
+    }
+
+    void StarredDateTimes::load(Database::UserId userId, const std::vector<Database::TrackId>& trackIds)
+    {
+        load(_tracks, userId, trackIds);
+    }
+
+    Wt::WDateTime StarredDateTimes::get(Database::UserId userId, Database::ArtistId artistId) const
+    {
+        return get(_artists, userId, artistId);
+    }
+
+    Wt::WDateTime StarredDateTimes::get(Database::UserId userId, Database::ReleaseId releaseId) const
+    {
+        return get(_releases, userId, releaseId);
+    }
+
+    Wt::WDateTime StarredDateTimes::get(Database::UserId userId, Database::TrackId trackId) const
+    {
+        return get(_tracks, userId, trackId);
+    }
+
+    template <typename IdType>
+    void StarredDateTimes::load(Entries<IdType>& entries, Database::UserId userId, const std::vector<IdType>& ids)
+    {
+        // only keep data of a single user
+        if (_userId != userId)
+        {
+            _artists = {};
+            _releases = {};
+            _tracks = {};
+            _userId = userId;
+        }
+
+        std::vector<IdType> idsToLoad;
+        idsToLoad.reserve(ids.size());
+        for (const IdType id : ids)
+        {
+            if (entries.loadedIds.insert(id).second)
+                idsToLoad.push_back(id);
+        }
+
+        for (const auto& [id, dateTime] : Service<Feedback::IFeedbackService>::get()->getStarredDateTimes(userId, idsToLoad))
+            entries.dateTimes.emplace(id, dateTime);
+    }
+
+    template <typename IdType>
+    Wt::WDateTime StarredDateTimes::get(const Entries<IdType>& entries, Database::UserId userId, IdType id) const
+    {
+        if (userId == _userId && entries.loadedIds.find(id) != std::cend(entries.loadedIds))
+        {
+            auto it{ entries.dateTimes.find(id) };
+            return it != std::cend(entries.dateTimes) ? it->second : Wt::WDateTime{};
+        }
+
+        return Service<Feedback::IFeedbackService>::get()->getStarredDateTime(userId, id);
+    }
+}
+
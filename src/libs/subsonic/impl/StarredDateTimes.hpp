@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <Wt/WDateTime.h>
+
+#include "services/database/ArtistId.hpp"
+#include "services/database/Object.hpp"
+#include "services/database/ReleaseId.hpp"
+#include "services/database/TrackId.hpp"
+#include "services/database/UserId.hpp"
+
+namespace API::Subsonic
+{
+    // Starred date times of the objects of a response, bulk loaded for the requesting user
+    // Meant to be loaded by list builders instead of querying them for each object
+    class StarredDateTimes
+    {
+    public:
+        void load(Database::UserId userId, const std::vector<Database::ArtistId>& artistIds);
+        void load(Database::UserId userId, const std::vector<Database::ReleaseId>& releaseIds);
+        void load(Database::UserId userId, const std::vector<Database::TrackId>& trackIds);
+
+        template <typename ObjType>
+        void load(Database::UserId userId, const std::vector<Database::ObjectPtr<ObjType>>& objects)
+        {
+            std::vector<typename ObjType::IdType> ids;
+            ids.reserve(objects.size());
+            for (const Database::ObjectPtr<ObjType>& object : objects)
+                ids.push_back(object->getId());
+
+            load(userId, ids);
+        }
+
+        // Falls back to a single query if the object has not been loaded
+        // Invalid if not starred
+        Wt::WDateTime get(Database::UserId userId, Database::ArtistId artistId) const;
+        Wt::WDateTime get(Database::UserId userId, Database::ReleaseId releaseId) const;
+        Wt::WDateTime get(Database::UserId userId, Database::TrackId trackId) const;
+
+    private:
+        template <typename IdType>
+        struct Entries
+        {
+            // date times are only reported for starred objects
+            std::unordered_set<IdType> loadedIds;
+            std::unordered_map<IdType, Wt::WDateTime> dateTimes;
+        };
+
+        template <typename IdType>
+        void load(Entries<IdType>& entries, Database::UserId userId, const std::vector<IdType>& ids);
+        template <typename IdType>
+        Wt::WDateTime get(const Entries<IdType>& entries, Database::UserId userId, IdType id) const;
+
+        Database::UserId _userId;
+        Entries<Database::ArtistId> _artists;
+        Entries<Database::ReleaseId> _releases;
+        Entries<Database::TrackId> _tracks;
+    };
+}
+
@@ -19,6 +19,9 @@
 
 #include "SubsonicId.hpp"
 
+#include <charconv>
+#include <system_error>
+
 #include "SubsonicResponse.hpp"
 
 #include "utils/Logger.hpp"
@@ -52,38 +55,39 @@ namespace API::Subsonic
     }
 } // namespace API::Subsonic
 
-namespace StringUtils
+namespace
 {
-    template<>
-    std::optional<Database::ArtistId> readAs(std::string_view str)
+    // "<prefix>-<value>", parsed without allocation: large multi id requests (star, updatePlaylist, ...) parse hundreds of them
+    template<typename IdType>
+    std::optional<IdType> readIdAs(std::string_view str, std::string_view prefix)
     {
-        std::vector<std::string_view> values{ StringUtils::splitString(str, "-") };
-        if (values.size() != 2)
+        if (str.size() <= prefix.size() + 1 || str.compare(0, prefix.size(), prefix) != 0 || str[prefix.size()] != '-')
             return std::nullopt;
 
-        if (values[0] != "ar")
+        const char* const begin{ str.data() + prefix.size() + 1 };
+        const char* const end{ str.data() + str.size() };
+
+        typename IdType::ValueType value;
+        const auto [ptr, ec]{ std::from_chars(begin, end, value) };
+        if (ec != std::errc{} || ptr != end || value < 0)
             return std::nullopt;
 
-        if (const auto value{ StringUtils::readAs<Database::ArtistId::ValueType>(values[1]) })
-            return Database::ArtistId{ *value };
+        return IdType{ value };
+    }
+}
 
-        return std::nullopt;
+namespace StringUtils
+{
+    template<>
+    std::optional<Database::ArtistId> readAs(std::string_view str)
+    {
+        return readIdAs<Database::ArtistId>(str, "ar");
     }
 
     template<>
     std::optional<Database::ReleaseId> readAs(std::string_view str)
     {
-        std::vector<std::string_view> values{ StringUtils::splitString(str, "-") };
-        if (values.size() != 2)
-            return std::nullopt;
-
-        if (values[0] != "al")
-            return std::nullopt;
-
-        if (const auto value{ StringUtils::readAs<Database::ReleaseId::ValueType>(values[1]) })
-            return Database::ReleaseId{ *value };
-
-        return std::nullopt;
+        return readIdAs<Database::ReleaseId>(str, "al");
     }
 
     template<>
@@ -98,32 +102,12 @@ namespace StringUtils
     template<>
     std::optional<Database::TrackId> readAs(std::string_view str)
     {
-        std::vector<std::string_view> values{ StringUtils::splitString(str, "-") };
-        if (values.size() != 2)
-            return std::nullopt;
-
-        if (values[0] != "tr")
-            return std::nullopt;
-
-        if (const auto value{ StringUtils::readAs<Database::TrackId::ValueType>(values[1]) })
-            return Database::TrackId{ *value };
-
-        return std::nullopt;
+        return readIdAs<Database::TrackId>(str, "tr");
     }
 
     template<>
     std::optional<Database::TrackListId> readAs(std::string_view str)
     {
-        std::vector<std::string_view> values{ StringUtils::splitString(str, "-") };
-        if (values.size() != 2)
-            return std::nullopt;
-
-        if (values[0] != "pl")
-            return std::nullopt;
-
-        if (const auto value{ StringUtils::readAs<Database::TrackListId::ValueType>(values[1]) })
-            return Database::TrackListId{ *value };
-
-        return std::nullopt;
+        return readIdAs<Database::TrackListId>(str, "pl");
     }
 }
@@ -19,24 +19,43 @@
 
 #include "SubsonicResource.hpp"
 
+#include <algorithm>
 #include <atomic>
+#include <cassert>
+#include <chrono>
+#include <optional>
+#include <string>
 #include <unordered_map>
+#include <unordered_set>
 
+#include <boost/asio/post.hpp>
+#include <Wt/Http/ResponseContinuation.h>
+
+#include "av/TranscodingResourceHandlerCreator.hpp"
+#include "image/IRawImage.hpp"
 #include "services/auth/IPasswordService.hpp"
 #include "services/auth/IEnvService.hpp"
+#include "services/cover/ICoverService.hpp"
 #include "services/database/Db.hpp"
 #include "services/database/Session.hpp"
 #include "services/database/User.hpp"
+#include "services/feedback/IFeedbackService.hpp"
+#include "services/scanner/IScannerService.hpp"
+#include "utils/AllocationCounters.hpp"
 #include "utils/EnumSet.hpp"
 #include "utils/IConfig.hpp"
+#include "utils/IOContextRunner.hpp"
 #include "utils/Logger.hpp"
 #include "utils/Service.hpp"
 #include "utils/String.hpp"
+#include "utils/Tracing.hpp"
+#include "utils/UserActivity.hpp"
 #include "utils/Utils.hpp"
 
 #include "entrypoints/AlbumSongLists.hpp"
 #include "entrypoints/Browsing.hpp"
 #include "entrypoints/Bookmarks.hpp"
+#include "entrypoints/LibrarySync.hpp"
 #include "entrypoints/MediaAnnotation.hpp"
 #include "entrypoints/MediaLibraryScanning.hpp"
 #include "entrypoints/MediaRetrieval.hpp"
@@ -44,6 +63,8 @@
 #include "entrypoints/Searching.hpp"
 #include "entrypoints/System.hpp"
 #include "entrypoints/UserManagement.hpp"
+#include "Compression.hpp"
+#include "Metrics.hpp"
 #include "ParameterParsing.hpp"
 #include "ProtocolVersion.hpp"
 #include "RequestContext.hpp"
@@ -101,6 +122,32 @@ namespace API::Subsonic
             return res;
         }
 
+        std::unordered_set<std::string> readWebPCoverClients()
+        {
+            std::unordered_set<std::string> res;
+
+            Service<IConfig>::get()->visitStrings("api-subsonic-webp-cover-clients",
+                [&](std::string_view client)
+                {
+                    res.emplace(std::string{ client });
+                }, {});
+
+            return res;
+        }
+
+        std::unordered_set<std::string> readContentLengthClients()
+        {
+            std::unordered_set<std::string> res;
+
+            Service<IConfig>::get()->visitStrings("api-subsonic-content-length-clients",
+                [&](std::string_view client)
+                {
+                    res.emplace(std::string{ client });
+                }, {});
+
+            return res;
+        }
+
         std::string parameterMapToDebugString(const Wt::Http::ParameterMap& parameterMap)
         {
             auto censorValue = [](const std::string& type, const std::string& value) -> std::string
@@ -133,15 +180,209 @@ namespace API::Subsonic
             return res;
         }
 
-        void checkUserTypeIsAllowed(RequestContext& context, EnumSet<Database::UserType> allowedUserTypes)
+        // Endpoints whose responses only depend on the library and on the user's own data
+        bool isConditionalEntryPoint(std::string_view requestPath, const Wt::Http::ParameterMap& parameters)
         {
-            auto transaction{ context.dbSession.createSharedTransaction() };
+            if (requestPath == "/getArtists" || requestPath == "/getIndexes" || requestPath == "/getPlaylists")
+                return true;
+
+            if (requestPath == "/getAlbumList2")
+            {
+                // random, frequent and recent lists change without any library or user data change
+                const std::string type{ getParameterAs<std::string>(parameters, "type").value_or("") };
+                return type == "alphabeticalByName"
+                    || type == "alphabeticalByArtist"
+                    || type == "byGenre"
+                    || type == "byYear"
+                    || type == "newest"
+                    || type == "starred";
+            }
 
-            User::pointer currentUser{ User::find(context.dbSession, context.userId) };
-            if (!currentUser)
-                throw RequestedDataNotFoundError{};
+            return false;
+        }
 
-            if (!allowedUserTypes.contains(currentUser->getType()))
+        // Endpoints that modify the user's own data
+        bool isUserDataChangingEntryPoint(std::string_view requestPath)
+        {
+            return requestPath == "/star"
+                || requestPath == "/unstar"
+                || requestPath == "/createPlaylist"
+                || requestPath == "/updatePlaylist"
+                || requestPath == "/deletePlaylist";
+        }
+
+        // Endpoints that may modify any user's data
+        bool isUsersDataChangingEntryPoint(std::string_view requestPath)
+        {
+            return requestPath == "/updateUser"
+                || requestPath == "/deleteUser";
+        }
+
+        // Read only endpoints that may run slow database queries: handled by the database executor
+        // so that they cannot use all the HTTP threads
+        bool isDeferrableEntryPoint(std::string_view requestPath)
+        {
+            return requestPath == "/getArtists"
+                || requestPath == "/getIndexes"
+                || requestPath == "/getMusicDirectory"
+                || requestPath == "/getAlbumList"
+                || requestPath == "/getAlbumList2"
+                || requestPath == "/getRandomSongs"
+                || requestPath == "/getSongsByGenre"
+                || requestPath == "/getStarred"
+                || requestPath == "/getStarred2"
+                || requestPath == "/getSimilarSongs"
+                || requestPath == "/getSimilarSongs2"
+                || requestPath == "/search2"
+                || requestPath == "/search3"
+                || requestPath == "/getLibraryChanges";
+        }
+
+        ResponseFormat getResponseFormat(const Wt::Http::ParameterMap& parameters)
+        {
+            return getParameterAs<std::string>(parameters, "f").value_or("xml") == "json" ? ResponseFormat::json : ResponseFormat::xml;
+        }
+
+        // Read only endpoints whose responses only depend on the request and on the library and user data generations
+        // (no randomness, no time dependent lists), so that identical concurrent requests can share a single response
+        bool isCoalescableEntryPoint(std::string_view requestPath, const Wt::Http::ParameterMap& parameters)
+        {
+            if (requestPath == "/getAlbumList" || requestPath == "/getAlbumList2")
+            {
+                const std::string type{ getParameterAs<std::string>(parameters, "type").value_or("") };
+                return type != "random";
+            }
+
+            return requestPath == "/getArtists"
+                || requestPath == "/getIndexes"
+                || requestPath == "/getGenres"
+                || requestPath == "/getMusicDirectory"
+                || requestPath == "/getArtist"
+                || requestPath == "/getAlbum"
+                || requestPath == "/getSong"
+                || requestPath == "/getSongsByGenre"
+                || requestPath == "/getStarred"
+                || requestPath == "/getStarred2"
+                || requestPath == "/search2"
+                || requestPath == "/search3"
+                || requestPath == "/getPlaylists"
+                || requestPath == "/getPlaylist";
+        }
+
+        // Endpoints whose responses are costly to build and mostly shared between users
+        bool isCacheableEntryPoint(std::string_view requestPath)
+        {
+            return requestPath == "/getArtists"
+                || requestPath == "/getIndexes"
+                || requestPath == "/getGenres";
+        }
+
+        // Sub type of the request reported in the metrics, only when it is a fixed set of values
+        std::string_view getMetricsRequestType(std::string_view requestPath, const Wt::Http::ParameterMap& parameters)
+        {
+            if (requestPath != "/getAlbumList" && requestPath != "/getAlbumList2")
+                return {};
+
+            static const std::unordered_set<std::string_view> albumListTypes{ "random", "newest", "highest", "frequent", "recent", "alphabeticalByName", "alphabeticalByArtist", "starred", "byYear", "byGenre" };
+
+            const auto type{ getParameterAs<std::string>(parameters, "type") };
+            if (!type)
+                return {};
+
+            auto it{ albumListTypes.find(*type) };
+            return it != std::cend(albumListTypes) ? *it : "other";
+        }
+
+        void writeCoverCacheMetrics(std::ostream& os, const Cover::ICoverService::CacheStats& stats)
+        {
+            os << "# HELP lms_cover_cache_requests_total Cover cache lookups\n";
+            os << "# TYPE lms_cover_cache_requests_total counter\n";
+            os << "lms_cover_cache_requests_total{result=\"hit\"} " << stats.hits << "\n";
+            os << "lms_cover_cache_requests_total{result=\"miss\"} " << stats.misses << "\n";
+            os << "# HELP lms_cover_cache_evictions_total Covers evicted from the cache\n";
+            os << "# TYPE lms_cover_cache_evictions_total counter\n";
+            os << "lms_cover_cache_evictions_total " << stats.evictions << "\n";
+            os << "# HELP lms_cover_cache_entries Covers in the cache\n";
+            os << "# TYPE lms_cover_cache_entries gauge\n";
+            os << "lms_cover_cache_entries " << stats.entryCount << "\n";
+            os << "# HELP lms_cover_cache_size_bytes Size of the covers in the cache\n";
+            os << "# TYPE lms_cover_cache_size_bytes gauge\n";
+            os << "lms_cover_cache_size_bytes " << stats.size << "\n";
+        }
+
+        void writeTranscodingMetrics(std::ostream& os, const Av::Transcoding::TranscodingStats& stats)
+        {
+            os << "# HELP lms_transcoding_streams Transcoded streams in progress\n";
+            os << "# TYPE lms_transcoding_streams gauge\n";
+            os << "lms_transcoding_streams " << stats.streamCount << "\n";
+            os << "# HELP lms_transcoding_buffered_bytes Transcoded bytes read ahead, not sent yet\n";
+            os << "# TYPE lms_transcoding_buffered_bytes gauge\n";
+            os << "lms_transcoding_buffered_bytes " << stats.bufferedBytes << "\n";
+            os << "# HELP lms_transcoding_pooled_buffers Transcoding read buffers available for reuse\n";
+            os << "# TYPE lms_transcoding_pooled_buffers gauge\n";
+            os << "lms_transcoding_pooled_buffers " << stats.pooledBufferCount << "\n";
+            os << "# HELP lms_transcoding_preempted_streams_total Transcoded streams stopped to make room for a newer stream\n";
+            os << "# TYPE lms_transcoding_preempted_streams_total counter\n";
+            os << "lms_transcoding_preempted_streams_total " << stats.preemptedStreamCount << "\n";
+            os << "# HELP lms_transcoding_rejected_streams_total Transcoded streams rejected as all the slots were taken\n";
+            os << "# TYPE lms_transcoding_rejected_streams_total counter\n";
+            os << "lms_transcoding_rejected_streams_total " << stats.rejectedStreamCount << "\n";
+        }
+
+        // Parameters that do not have any effect on the response content, or that are taken into account by other means
+        bool isCacheKeyIgnoredParameter(const std::string& name)
+        {
+            return name == "u" || name == "p" || name == "t" || name == "s" || name == "c" || name == "v" || name == "f" || name == "_";
+        }
+
+        bool etagMatches(std::string_view ifNoneMatch, std::string_view etag)
+        {
+            for (std::string_view value : StringUtils::tokenizeString(ifNoneMatch, ","))
+            {
+                value = StringUtils::stringTrim(value);
+                if (value == "*")
+                    return true;
+
+                // weak comparison
+                if (value.substr(0, 2) == "W/")
+                    value.remove_prefix(2);
+
+                if (value == etag)
+                    return true;
+            }
+
+            return false;
+        }
+
+        constexpr const char* httpDateFormat{ "ddd, dd MMM yyyy hh:mm:ss 'GMT'" };
+
+        bool isNotModified(const std::string& ifNoneMatch, const std::string& ifModifiedSince, const LibraryGeneration::Validator& validator)
+        {
+            if (!ifNoneMatch.empty())
+                return etagMatches(ifNoneMatch, validator.etag);
+
+            if (!ifModifiedSince.empty())
+            {
+                const Wt::WDateTime dateTime{ Wt::WDateTime::fromString(ifModifiedSince, httpDateFormat) };
+                // HTTP dates have a one second precision
+                return dateTime.isValid() && dateTime.toTime_t() >= validator.lastModified.toTime_t();
+            }
+
+            return false;
+        }
+
+        void addValidatorHeaders(Wt::Http::Response& response, const LibraryGeneration::Validator& validator)
+        {
+            // Responses depend on the authenticated user: do not let shared caches store them
+            response.addHeader("Cache-Control", "private, no-cache");
+            // weak: the same validator is used for compressed and uncompressed content
+            response.addHeader("ETag", "W/" + validator.etag);
+            response.addHeader("Last-Modified", validator.lastModified.toString(httpDateFormat).toUTF8());
+        }
+
+        void checkUserTypeIsAllowed(const RequestContext& context, EnumSet<Database::UserType> allowedUserTypes)
+        {
+            if (!allowedUserTypes.contains(context.userSettings->type))
                 throw UserNotAuthorizedError{};
         }
 
@@ -189,7 +430,7 @@ namespace API::Subsonic
             {"/getAlbumList2",          {handleGetAlbumList2Request}},
             {"/getRandomSongs",         {handleGetRandomSongsRequest}},
             {"/getSongsByGenre",        {handleGetSongsByGenreRequest}},
-            {"/getNowPlaying",          {handleNotImplemented}},
+            {"/getNowPlaying",          {handleGetNowPlayingRequest}},
             {"/getStarred",             {handleGetStarredRequest}},
             {"/getStarred2",            {handleGetStarred2Request}},
 
@@ -206,7 +447,6 @@ namespace API::Subsonic
             {"/deletePlaylist",         {handleDeletePlaylistRequest}},
 
             // Media retrieval
-            {"/hls",                    {handleNotImplemented}},
             {"/getCaptions",            {handleNotImplemented}},
             {"/getLyrics",              {handleNotImplemented}},
             {"/getAvatar",              {handleNotImplemented}},
@@ -257,12 +497,15 @@ namespace API::Subsonic
             {"/getBookmarks",       {handleGetBookmarks}},
             {"/createBookmark",     {handleCreateBookmark}},
             {"/deleteBookmark",     {handleDeleteBookmark}},
-            {"/getPlayQueue",       {handleNotImplemented}},
-            {"/savePlayQueue",      {handleNotImplemented}},
+            {"/getPlayQueue",       {handleGetPlayQueue}},
+            {"/savePlayQueue",      {handleSavePlayQueue}},
 
             // Media library scanning
             {"/getScanStatus",      {Scan::handleGetScanStatus, {UserType::ADMIN}}},
             {"/startScan",          {Scan::handleStartScan,     {UserType::ADMIN}}},
+
+            // OpenSubsonic library sync
+            {"/getLibraryChanges",  {handleGetLibraryChangesRequest}},
         };
 
         using MediaRetrievalHandlerFunc = std::function<void(RequestContext&, const Wt::Http::Request&, Wt::Http::Response&)>;
@@ -271,6 +514,9 @@ namespace API::Subsonic
             // Media retrieval
             {"/download",       handleDownload},
             {"/stream",         handleStream},
+            {"/hls",            handleHls},
+            {"/hls.m3u8",       handleHls},
+            {"/hlsSegment",     handleHlsSegment},
             {"/getCoverArt",    handleGetCoverArt},
         };
     }
@@ -280,8 +526,43 @@ namespace API::Subsonic
         : _serverProtocolVersionsByClient{ readConfigProtocolVersions() }
         , _openSubsonicDisabledClients{ readOpenSubsonicDisabledClients() }
         , _defaultCoverClients{ readDefaultCoverClients() }
+        , _webpCoverClients{ readWebPCoverClients() }
+        , _contentLengthClients{ readContentLengthClients() }
+        , _compressionLevel{ std::clamp(static_cast<int>(Service<IConfig>::get()->getULong("api-subsonic-compression-level", 6)), 0, 9) }
+        , _compressionMinSize{ Service<IConfig>::get()->getULong("api-subsonic-compression-min-size", 1024) }
         , _db{ db }
+        , _libraryGeneration{ std::chrono::minutes{ Service<IConfig>::get()->getULong("api-subsonic-validator-max-age", 60) } }
+        , _responseCache{ Service<IConfig>::get()->getULong("api-subsonic-response-cache-max-size", 32) * 1024 * 1024 }
+        , _fragmentCache{ Service<IConfig>::get()->getULong("api-subsonic-fragment-cache-max-size", 64) * 1024 * 1024 }
+        , _playQueueStore{ db, std::chrono::milliseconds{ Service<IConfig>::get()->getULong("api-subsonic-play-queue-write-delay", 10000) } }
+        , _metricsEnabled{ Service<IConfig>::get()->getBool("api-subsonic-metrics", false) }
+        , _metrics{ Service<IConfig>::get()->getULong("api-subsonic-metrics-max-clients", 32) }
+        , _maxPendingRequestCount{ Service<IConfig>::get()->getULong("api-subsonic-db-max-pending-requests", 256) }
+        , _maxPendingRequestCountPerUser{ Service<IConfig>::get()->getULong("api-subsonic-db-max-pending-requests-per-user", 16) }
     {
+        if (const std::size_t dbThreadCount{ Service<IConfig>::get()->getULong("api-subsonic-db-thread-count", 4) }; dbThreadCount > 0)
+            _dbIoContextRunner = std::make_unique<IOContextRunner>(_dbIoContext, dbThreadCount);
+
+        if (auto* scannerService{ Service<Scanner::IScannerService>::get() })
+        {
+            _scanCompleteConnection = scannerService->getEvents().scanComplete.connect([this](const Scanner::ScanStats& stats)
+                {
+                    if (stats.nbChanges() > 0)
+                    {
+                        _libraryGeneration.onLibraryChanged();
+                        _responseCache.clear();
+                        _fragmentCache.clear();
+                    }
+                });
+        }
+    }
+
+    SubsonicResource::~SubsonicResource()
+    {
+        _scanCompleteConnection.disconnect();
+
+        // pending deferred requests use the other members
+        _dbIoContextRunner.reset();
     }
 
     void SubsonicResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
@@ -297,7 +578,44 @@ namespace API::Subsonic
             requestPath.resize(requestPath.length() - 5);
 
         // Optional parameters
-        const ResponseFormat format{ getParameterAs<std::string>(request.getParameterMap(), "f").value_or("xml") == "json" ? ResponseFormat::json : ResponseFormat::xml };
+        const ResponseFormat format{ getResponseFormat(request.getParameterMap()) };
+
+        Tracing::ScopedSpan span{ "subsonic.request" };
+        span.setAttribute("path", requestPath);
+
+        if (_metricsEnabled && requestPath == "/metrics")
+        {
+            response.setMimeType("text/plain; version=0.0.4");
+            _metrics.write(response.out());
+            if (const Cover::ICoverService* coverService{ Service<Cover::ICoverService>::get() })
+                writeCoverCacheMetrics(response.out(), coverService->getCacheStats());
+            writeTranscodingMetrics(response.out(), Av::Transcoding::getTranscodingStats());
+            writeHttpClientMetrics(response.out(), Http::getClientStats());
+            return;
+        }
+
+        // deferred requests are only counted until they are handed to the database executor
+        const UserActivity::RequestScope activityScope;
+
+        auto itEntryPoint{ requestEntryPoints.find(requestPath) };
+
+        // Response built by the database executor
+        if (request.continuation() && itEntryPoint != std::cend(requestEntryPoints))
+        {
+            const auto deferredResponse{ Wt::cpp17::any_cast<std::shared_ptr<EntryPointResponse>>(request.continuation()->data()) };
+            writeEntryPointResponse(request, response, format, *deferredResponse);
+            LMS_LOG(API_SUBSONIC, DEBUG) << "Deferred request " << requestId << " '" << requestPath << "' handled!";
+            return;
+        }
+
+        // unknown paths are not reported individually
+        const bool isKnownEntryPoint{ itEntryPoint != std::cend(requestEntryPoints) || mediaRetrievalHandlers.find(requestPath) != std::cend(mediaRetrievalHandlers) };
+        const std::string clientName{ getParameterAs<std::string>(request.getParameterMap(), "c").value_or("") };
+        Metrics::RequestStats requestStats;
+        requestStats.endpoint = isKnownEntryPoint ? std::string_view{ requestPath }.substr(1) : "unknown";
+        requestStats.type = getMetricsRequestType(requestPath, request.getParameterMap());
+        requestStats.client = clientName;
+        requestStats.status = "ok";
 
         ProtocolVersion protocolVersion{ defaultServerProtocolVersion };
 
@@ -307,7 +625,6 @@ namespace API::Subsonic
             protocolVersion = getServerProtocolVersion(getMandatoryParameterAs<std::string>(request.getParameterMap(), "c"));
             RequestContext requestContext{ buildRequestContext(request) };
 
-            auto itEntryPoint{ requestEntryPoints.find(requestPath) };
             if (itEntryPoint != requestEntryPoints.end())
             {
                 if (itEntryPoint->second.checkFunc)
@@ -315,11 +632,19 @@ namespace API::Subsonic
 
                 checkUserTypeIsAllowed(requestContext, itEntryPoint->second.allowedUserTypes);
 
-                const Response resp{ (itEntryPoint->second.func)(requestContext) };
+                const RequestHeaders requestHeaders{ request.headerValue("If-None-Match"), request.headerValue("If-Modified-Since") };
+
+                if (_dbIoContextRunner && isDeferrableEntryPoint(requestPath))
+                {
+                    deferEntryPointRequest(response, requestContext, requestPath, format, itEntryPoint->second.func, requestHeaders, requestStats);
+                    LMS_LOG(API_SUBSONIC, DEBUG) << "Request " << requestId << " '" << requestPath << "' deferred";
+                    return;
+                }
 
-                resp.write(response.out(), format);
-                response.setMimeType(std::string{ ResponseFormatToMimeType(format) });
+                const EntryPointResponse entryPointResponse{ processEntryPointRequest(requestContext, requestPath, format, itEntryPoint->second.func, requestHeaders, requestStats) };
+                writeEntryPointResponse(request, response, format, entryPointResponse);
                 LMS_LOG(API_SUBSONIC, DEBUG) << "Request " << requestId << " '" << requestPath << "' handled!";
+                recordRequestMetrics(requestStats);
 
                 return;
             }
@@ -327,8 +652,16 @@ namespace API::Subsonic
             auto itStreamHandler{ mediaRetrievalHandlers.find(requestPath) };
             if (itStreamHandler != mediaRetrievalHandlers.end())
             {
+                const AllocationCounters::ScopedCounter allocationCounter;
+                const auto handlerStart{ std::chrono::steady_clock::now() };
                 itStreamHandler->second(requestContext, request, response);
+                requestStats.handlerDuration = std::chrono::steady_clock::now() - handlerStart;
+                if (AllocationCounters::isEnabled())
+                    requestStats.allocations = allocationCounter.get();
                 LMS_LOG(API_SUBSONIC, DEBUG) << "Request " << requestId << " '" << requestPath << "' handled!";
+                // only count the request once, not each of its continuations
+                if (!request.continuation())
+                    recordRequestMetrics(requestStats);
                 return;
             }
 
@@ -343,7 +676,232 @@ namespace API::Subsonic
             Response resp{ Response::createFailedResponse(protocolVersion, e) };
             resp.write(response.out(), format);
             response.setMimeType(std::string{ ResponseFormatToMimeType(format) });
+
+            const std::string errorCode{ std::to_string(static_cast<int>(e.getCode())) };
+            requestStats.status = errorCode;
+            recordRequestMetrics(requestStats);
+        }
+    }
+
+    SubsonicResource::EntryPointResponse SubsonicResource::processEntryPointRequest(RequestContext& context, std::string_view requestPath, ResponseFormat format, const std::function<Response(RequestContext&)>& handler, const RequestHeaders& requestHeaders, Metrics::RequestStats& requestStats)
+    {
+        EntryPointResponse res;
+
+        // Computed before handling the request so that concurrent changes cannot be hidden
+        std::optional<LibraryGeneration::Validator> validator;
+        if (isConditionalEntryPoint(requestPath, context.parameters))
+            validator = _libraryGeneration.getValidator(context.userId, requestPath, context.parameters);
+
+        if (validator && isNotModified(requestHeaders.ifNoneMatch, requestHeaders.ifModifiedSince, *validator))
+        {
+            res.validator = validator;
+            res.notModified = true;
+            requestStats.status = "notModified";
+            return res;
+        }
+
+        std::string cacheKey;
+        ResponseCache::Entry cachedResponse;
+        if (isCacheableEntryPoint(requestPath))
+        {
+            cacheKey = computeResponseCacheKey(context, requestPath, format);
+            cachedResponse = _responseCache.get(cacheKey);
+            LMS_LOG(API_SUBSONIC, DEBUG) << "Response cache " << (cachedResponse ? "hit" : "miss") << " for '" << requestPath << "' (hits = " << _responseCache.getHitCount() << ", misses = " << _responseCache.getMissCount() << ")";
         }
+
+        if (!cachedResponse)
+        {
+            const auto handleRequest{ [&]
+                {
+                    const AllocationCounters::ScopedCounter allocationCounter;
+                    const Response::ScopedArena arena; // the response must be destroyed first
+                    const auto handlerStart{ std::chrono::steady_clock::now() };
+                    const Response resp{ [&]
+                        {
+                            Tracing::ScopedSpan span{ "subsonic.handle" };
+                            return handler(context);
+                        }() };
+                    const auto serializationStart{ std::chrono::steady_clock::now() };
+                    ResponseCache::Entry content;
+                    {
+                        Tracing::ScopedSpan span{ "subsonic.serialize" };
+                        content = std::make_shared<const std::string>(resp.serialize(format));
+                    }
+                    requestStats.handlerDuration = serializationStart - handlerStart;
+                    requestStats.serializationDuration = std::chrono::steady_clock::now() - serializationStart;
+                    if (AllocationCounters::isEnabled())
+                        requestStats.allocations = allocationCounter.get();
+
+                    if (!cacheKey.empty())
+                        _responseCache.put(cacheKey, content);
+
+                    return content;
+                } };
+
+            if (isCoalescableEntryPoint(requestPath, context.parameters))
+            {
+                bool coalesced{};
+                cachedResponse = _requestCoalescer.run(computeCoalescingKey(context, requestPath, format), handleRequest, coalesced);
+                if (coalesced)
+                {
+                    requestStats.status = "coalesced";
+                    LMS_LOG(API_SUBSONIC, DEBUG) << "Request '" << requestPath << "' coalesced with an identical in flight request (coalesced = " << _requestCoalescer.getCoalescedCount() << ")";
+                }
+            }
+            else
+                cachedResponse = handleRequest();
+        }
+        else
+            requestStats.status = "cached";
+
+        // Only successful responses get validators
+        res.validator = validator;
+        res.content = cachedResponse;
+        requestStats.responseSize = cachedResponse->size();
+
+        if (isUserDataChangingEntryPoint(requestPath))
+            _libraryGeneration.onUserDataChanged(context.userId);
+        else if (isUsersDataChangingEntryPoint(requestPath))
+            _libraryGeneration.onLibraryChanged();
+
+        return res;
+    }
+
+    void SubsonicResource::writeEntryPointResponse(const Wt::Http::Request& request, Wt::Http::Response& response, ResponseFormat format, const EntryPointResponse& entryPointResponse) const
+    {
+        if (entryPointResponse.validator)
+            addValidatorHeaders(response, *entryPointResponse.validator);
+
+        if (entryPointResponse.notModified)
+        {
+            response.setStatus(304);
+            return;
+        }
+
+        response.setMimeType(std::string{ ResponseFormatToMimeType(format) });
+        writeResponseContent(request, response, *entryPointResponse.content);
+    }
+
+    void SubsonicResource::deferEntryPointRequest(Wt::Http::Response& response, const RequestContext& context, std::string_view requestPath, ResponseFormat format, const std::function<Response(RequestContext&)>& handler, const RequestHeaders& requestHeaders, const Metrics::RequestStats& requestStats)
+    {
+        if (!acquirePendingRequestSlot(context.userId))
+            throw TooManyPendingRequestsGenericError{};
+
+        // The request, its parameters and the thread local session cannot be used by the executor: copy what is needed
+        struct DeferredRequest
+        {
+            Wt::Http::ParameterMap parameters;
+            Database::UserId userId;
+            std::shared_ptr<const UserSettings> userSettings;
+            ClientInfo clientInfo;
+            ProtocolVersion serverProtocolVersion;
+            bool enableOpenSubsonic;
+            bool enableDefaultCover;
+            bool enableWebPCover;
+            bool requireContentLength;
+            std::string requestPath;
+            ResponseFormat format;
+            std::function<Response(RequestContext&)> handler;
+            RequestHeaders requestHeaders;
+            std::string endpoint;
+            std::string_view type;
+            std::string client;
+        };
+        auto deferredRequest{ std::make_shared<const DeferredRequest>(DeferredRequest{ context.parameters, context.userId, context.userSettings, context.clientInfo, context.serverProtocolVersion, context.enableOpenSubsonic, context.enableDefaultCover, context.enableWebPCover, context.requireContentLength,
+            std::string{ requestPath }, format, handler, requestHeaders, std::string{ requestStats.endpoint }, requestStats.type, std::string{ requestStats.client } }) };
+
+        // Filled by the executor before resuming the continuation
+        auto deferredResponse{ std::make_shared<EntryPointResponse>() };
+
+        Wt::Http::ResponseContinuation* continuation{ response.createContinuation() };
+        continuation->setData(deferredResponse);
+        continuation->waitForMoreData();
+
+        boost::asio::post(_dbIoContext, [this, deferredRequest, deferredResponse, continuation, spanContext = Tracing::getCurrentSpanContext()]
+            {
+                Tracing::ScopedSpan span{ "subsonic.deferredRequest", spanContext };
+
+                Metrics::RequestStats stats;
+                stats.endpoint = deferredRequest->endpoint;
+                stats.type = deferredRequest->type;
+                stats.client = deferredRequest->client;
+                stats.status = "ok";
+
+                std::string errorCode;
+                try
+                {
+                    try
+                    {
+                        RequestContext context{ deferredRequest->parameters, _db.getTLSSession(), deferredRequest->userId, deferredRequest->userSettings, deferredRequest->clientInfo, deferredRequest->serverProtocolVersion, _libraryGeneration, _fragmentCache, _playQueueStore, deferredRequest->format, deferredRequest->enableOpenSubsonic, deferredRequest->enableDefaultCover, deferredRequest->enableWebPCover, deferredRequest->requireContentLength };
+                        *deferredResponse = processEntryPointRequest(context, deferredRequest->requestPath, deferredRequest->format, deferredRequest->handler, deferredRequest->requestHeaders, stats);
+                    }
+                    catch (const Error&)
+                    {
+                        throw;
+                    }
+                    catch (const std::exception& e)
+                    {
+                        // must not escape the executor thread
+                        throw InternalErrorGenericError{ e.what() };
+                    }
+                }
+                catch (const Error& e)
+                {
+                    LMS_LOG(API_SUBSONIC, ERROR) << "Error while processing deferred request '" << deferredRequest->requestPath << "'"
+                        << ", params = [" << parameterMapToDebugString(deferredRequest->parameters) << "]"
+                        << ", code = " << static_cast<int>(e.getCode()) << ", msg = '" << e.getMessage() << "'";
+
+                    *deferredResponse = EntryPointResponse{};
+                    deferredResponse->content = std::make_shared<const std::string>(Response::createFailedResponse(deferredRequest->serverProtocolVersion, e).serialize(deferredRequest->format));
+
+                    errorCode = std::to_string(static_cast<int>(e.getCode()));
+                    stats.status = errorCode;
+                }
+
+                recordRequestMetrics(stats);
+                releasePendingRequestSlot(deferredRequest->userId);
+
+                continuation->haveMoreData();
+            });
+    }
+
+    bool SubsonicResource::acquirePendingRequestSlot(Database::UserId userId)
+    {
+        std::scoped_lock lock{ _pendingRequestsMutex };
+
+        if (_pendingRequestCount >= _maxPendingRequestCount)
+            return false;
+
+        std::size_t& userPendingRequestCount{ _pendingRequestCountByUser[userId] };
+        if (userPendingRequestCount >= _maxPendingRequestCountPerUser)
+            return false;
+
+        userPendingRequestCount++;
+        _pendingRequestCount++;
+        return true;
+    }
+
+    void SubsonicResource::releasePendingRequestSlot(Database::UserId userId)
+    {
+        std::scoped_lock lock{ _pendingRequestsMutex };
+
+        auto it{ _pendingRequestCountByUser.find(userId) };
+        assert(it != std::cend(_pendingRequestCountByUser) && it->second > 0);
+        if (--it->second == 0)
+            _pendingRequestCountByUser.erase(it);
+        _pendingRequestCount--;
+    }
+
+    void SubsonicResource::recordRequestMetrics(const Metrics::RequestStats& requestStats)
+    {
+        if (requestStats.allocations)
+            LMS_LOG(API_SUBSONIC, DEBUG) << "Request '" << requestStats.endpoint << "': " << requestStats.allocations->allocationCount << " allocations, " << requestStats.allocations->allocatedBytes << " bytes";
+
+        if (requestStats.handlerDuration)
+            UserActivity::recordRequestLatency(*requestStats.handlerDuration + requestStats.serializationDuration.value_or(std::chrono::steady_clock::duration::zero()));
+
+        if (_metricsEnabled)
+            _metrics.record(requestStats);
     }
 
     ProtocolVersion SubsonicResource::getServerProtocolVersion(const std::string& clientName) const
@@ -390,11 +948,118 @@ namespace API::Subsonic
     {
         const Wt::Http::ParameterMap& parameters{ request.getParameterMap() };
         const ClientInfo clientInfo{ getClientInfo(parameters) };
-        const Database::UserId userId{ authenticateUser(request, clientInfo) };
+        const Database::UserId userId{ [&]
+            {
+                Tracing::ScopedSpan span{ "subsonic.authenticate" };
+                return authenticateUser(request, clientInfo);
+            }() };
         bool enableOpenSubsonic{ _openSubsonicDisabledClients.find(clientInfo.name) == std::cend(_openSubsonicDisabledClients) };
-        bool enableDefaultCover{ _defaultCoverClients.find(clientInfo.name) != std::cend(_openSubsonicDisabledClients) };
+        bool enableDefaultCover{ _defaultCoverClients.find(clientInfo.name) != std::cend(_defaultCoverClients) };
+        bool enableWebPCover{ _webpCoverClients.find(clientInfo.name) != std::cend(_webpCoverClients) && Image::isEncodingFormatSupported(Image::EncodingFormat::WebP) };
+        bool requireContentLength{ _contentLengthClients.find(clientInfo.name) != std::cend(_contentLengthClients) };
+
+        // cached, no query unless a user has been changed
+        std::shared_ptr<const UserSettings> userSettings{ _userSettingsCache.get(_db.getTLSSession(), userId) };
+        if (!userSettings)
+            throw RequestedDataNotFoundError{};
+
+        return { parameters, _db.getTLSSession(), userId, std::move(userSettings), clientInfo, getServerProtocolVersion(clientInfo.name), _libraryGeneration, _fragmentCache, _playQueueStore, getResponseFormat(parameters), enableOpenSubsonic, enableDefaultCover, enableWebPCover, requireContentLength };
+    }
+
+    void SubsonicResource::writeResponseContent(const Wt::Http::Request& request, Wt::Http::Response& response, std::string_view content) const
+    {
+        // Media retrieval handlers do not get here: their content is already compressed
+        if (_compressionLevel > 0 && content.size() >= _compressionMinSize)
+        {
+            response.addHeader("Vary", "Accept-Encoding");
+
+            if (Compression::acceptsGzip(request.headerValue("Accept-Encoding")))
+            {
+                const std::string compressedContent{ Compression::gzip(content, _compressionLevel) };
+
+                response.addHeader("Content-Encoding", "gzip");
+                response.out().write(compressedContent.data(), compressedContent.size());
+                return;
+            }
+        }
+
+        response.out().write(content.data(), content.size());
+    }
+
+    std::string SubsonicResource::computeCoalescingKey(const RequestContext& context, std::string_view requestPath, ResponseFormat format) const
+    {
+        // Generations included so that a request received after a change cannot get the response of a request started before it
+        std::string key{ context.userId.toString() };
+
+        key += '|';
+        key += std::to_string(_libraryGeneration.getLibraryGeneration());
+        key += '|';
+        key += std::to_string(_libraryGeneration.getUserDataGeneration(context.userId));
+        key += '|';
+        key += requestPath;
+        key += '|';
+        key += std::string{ ResponseFormatToMimeType(format) };
+        key += '|';
+        key += std::to_string(context.serverProtocolVersion.major) + "." + std::to_string(context.serverProtocolVersion.minor) + "." + std::to_string(context.serverProtocolVersion.patch);
+        key += context.enableOpenSubsonic ? "|os" : "|";
+        key += context.enableDefaultCover ? "|dc" : "|";
+        key += context.enableWebPCover ? "|webp" : "|";
+
+        // parameter map is sorted
+        for (const auto& [name, values] : context.parameters)
+        {
+            if (isCacheKeyIgnoredParameter(name))
+                continue;
+
+            for (const std::string& value : values)
+                key += "|" + name + "=" + value;
+        }
+
+        return key;
+    }
+
+    std::string SubsonicResource::computeResponseCacheKey(RequestContext& context, std::string_view requestPath, ResponseFormat format) const
+    {
+        // Generation first, so that a concurrent library change cannot make a stale response reachable
+        std::string key{ std::to_string(_libraryGeneration.getLibraryGeneration()) };
+
+        key += '|';
+        key += requestPath;
+        key += '|';
+        key += std::string{ ResponseFormatToMimeType(format) };
+        key += '|';
+        key += std::to_string(context.serverProtocolVersion.major) + "." + std::to_string(context.serverProtocolVersion.minor) + "." + std::to_string(context.serverProtocolVersion.patch);
+        key += context.enableOpenSubsonic ? "|os" : "|";
+        key += context.enableDefaultCover ? "|dc" : "|";
+
+        for (const auto& [name, values] : context.parameters)
+        {
+            if (isCacheKeyIgnoredParameter(name))
+                continue;
+
+            for (const std::string& value : values)
+                key += "|" + name + "=" + value;
+        }
+
+        // Per user parts: the artist list mode, the starred artists and the reported last modification date
+        if (requestPath == "/getArtists" || requestPath == "/getIndexes")
+        {
+            key += "|mode=" + std::to_string(static_cast<int>(context.userSettings->artistListMode));
+
+            Feedback::IFeedbackService::ArtistFindParameters params;
+            params.setUser(context.userId);
+            std::vector<ArtistId> starredArtistIds{ Service<Feedback::IFeedbackService>::get()->findStarredArtists(params).results };
+            std::sort(std::begin(starredArtistIds), std::end(starredArtistIds));
+
+            std::size_t starredHash{ starredArtistIds.size() };
+            for (const ArtistId artistId : starredArtistIds)
+                starredHash ^= std::hash<ArtistId>{}(artistId) + 0x9e3779b9 + (starredHash << 6) + (starredHash >> 2);
+            key += "|starred=" + std::to_string(starredHash);
+
+            key += "|lastModified=" + std::to_string(_libraryGeneration.getLastModified(context.userId).toTime_t());
+        }
 
-        return { parameters, _db.getTLSSession(), userId, clientInfo, getServerProtocolVersion(clientInfo.name), enableOpenSubsonic, enableDefaultCover };
+        return key;
     }
 
     Database::UserId SubsonicResource::authenticateUser(const Wt::Http::Request& request, const ClientInfo& clientInfo)
@@ -18,16 +18,34 @@
  */
 #pragma once
 
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <unordered_set>
 #include <unordered_map>
 
+#include <boost/asio/io_context.hpp>
+
 #include <Wt/WResource.h>
+#include <Wt/WSignal.h>
 #include <Wt/Http/Response.h>
 
 #include "services/database/Types.hpp"
+#include "services/database/UserId.hpp"
+#include "utils/IOContextRunner.hpp"
 #include "ClientInfo.hpp"
+#include "FragmentCache.hpp"
+#include "LibraryGeneration.hpp"
+#include "Metrics.hpp"
+#include "PlayQueueStore.hpp"
+#include "RequestCoalescer.hpp"
 #include "RequestContext.hpp"
+#include "ResponseCache.hpp"
+#include "SubsonicResponse.hpp"
+#include "UserSettingsCache.hpp"
 
 namespace Database
 {
@@ -41,6 +59,7 @@ namespace API::Subsonic
     {
         public:
             SubsonicResource(Database::Db& db);
+            ~SubsonicResource();
 
         private:
             void handleRequest(const Wt::Http::Request &request, Wt::Http::Response &response) override;
@@ -50,12 +69,59 @@ namespace API::Subsonic
             ClientInfo getClientInfo(const Wt::Http::ParameterMap& parameters);
             RequestContext buildRequestContext(const Wt::Http::Request& request);
             Database::UserId authenticateUser(const Wt::Http::Request& request, const ClientInfo& clientInfo);
+            void writeResponseContent(const Wt::Http::Request& request, Wt::Http::Response& response, std::string_view content) const;
+            std::string computeResponseCacheKey(RequestContext& context, std::string_view requestPath, ResponseFormat format) const;
+            std::string computeCoalescingKey(const RequestContext& context, std::string_view requestPath, ResponseFormat format) const;
+            void recordRequestMetrics(const Metrics::RequestStats& requestStats);
+
+            struct RequestHeaders
+            {
+                std::string ifNoneMatch;
+                std::string ifModifiedSince;
+            };
+
+            // May be built by another thread than the one that writes it back
+            struct EntryPointResponse
+            {
+                std::optional<LibraryGeneration::Validator> validator;
+                bool notModified{};
+                ResponseCache::Entry content;
+            };
+            EntryPointResponse processEntryPointRequest(RequestContext& context, std::string_view requestPath, ResponseFormat format, const std::function<Response(RequestContext&)>& handler, const RequestHeaders& requestHeaders, Metrics::RequestStats& requestStats);
+            void writeEntryPointResponse(const Wt::Http::Request& request, Wt::Http::Response& response, ResponseFormat format, const EntryPointResponse& entryPointResponse) const;
+            void deferEntryPointRequest(Wt::Http::Response& response, const RequestContext& context, std::string_view requestPath, ResponseFormat format, const std::function<Response(RequestContext&)>& handler, const RequestHeaders& requestHeaders, const Metrics::RequestStats& requestStats);
+            bool acquirePendingRequestSlot(Database::UserId userId);
+            void releasePendingRequestSlot(Database::UserId userId);
 
             const std::unordered_map<std::string, ProtocolVersion> _serverProtocolVersionsByClient;
             const std::unordered_set<std::string> _openSubsonicDisabledClients;
             const std::unordered_set<std::string> _defaultCoverClients;
+            const std::unordered_set<std::string> _webpCoverClients;
+            const std::unordered_set<std::string> _contentLengthClients;
+            const int _compressionLevel;
+            const std::size_t _compressionMinSize;
 
             Database::Db& _db;
+            LibraryGeneration _libraryGeneration;
+            ResponseCache _responseCache;
+            FragmentCache _fragmentCache;
+            PlayQueueStore _playQueueStore;
+            RequestCoalescer _requestCoalescer;
+            UserSettingsCache _userSettingsCache;
+            const bool _metricsEnabled;
+            Metrics _metrics;
+
+            // Deferred requests, bounded globally and per user
+            const std::size_t _maxPendingRequestCount;
+            const std::size_t _maxPendingRequestCountPerUser;
+            std::mutex _pendingRequestsMutex;
+            std::size_t _pendingRequestCount{};
+            std::unordered_map<Database::UserId, std::size_t> _pendingRequestCountByUser;
+
+            boost::asio::io_context _dbIoContext;
+            std::unique_ptr<IOContextRunner> _dbIoContextRunner; // null if requests are handled by the HTTP threads
+
+            Wt::Signals::connection _scanCompleteConnection;
     };
 
 } // namespace
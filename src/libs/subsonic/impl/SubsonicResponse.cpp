@@ -19,17 +19,116 @@
 
 #include "SubsonicResponse.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
-#include <climits>
-#include <boost/property_tree/xml_parser.hpp>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <ostream>
 
 #include "utils/Exception.hpp"
-#include "utils/String.hpp"
 #include "ProtocolVersion.hpp"
 
 namespace API::Subsonic
 {
+    namespace
+    {
+        // Reused by all the requests handled by the thread: the initial buffer is enough for most responses
+        class ThreadArena
+        {
+        public:
+            void acquire() { ++_depth; }
+            void release()
+            {
+                assert(_depth > 0);
+                if (--_depth == 0)
+                    _resource.release();
+            }
+
+            std::pmr::memory_resource* getMemoryResource()
+            {
+                return _depth > 0 ? &_resource : std::pmr::get_default_resource();
+            }
+
+        private:
+            static constexpr std::size_t initialBufferSize{ 64 * 1024 };
+
+            std::size_t _depth{};
+            std::unique_ptr<std::byte[]> _initialBuffer{ std::make_unique<std::byte[]>(initialBufferSize) };
+            std::pmr::monotonic_buffer_resource _resource{ _initialBuffer.get(), initialBufferSize };
+        };
+
+        ThreadArena& getThreadArena()
+        {
+            thread_local ThreadArena threadArena;
+            return threadArena;
+        }
+
+        template <typename Entries>
+        auto findEntry(Entries& entries, Response::Node::Key key)
+        {
+            return std::find_if(std::begin(entries), std::end(entries), [&](const auto& entry) { return entry.first == key; });
+        }
+
+        template <typename Entries>
+        bool hasEntry(const Entries& entries, Response::Node::Key key)
+        {
+            return std::any_of(std::cbegin(entries), std::cend(entries), [&](const auto& entry) { return entry.first == key; });
+        }
+
+        // new entries use the allocator of the container
+        template <typename Entries>
+        auto& getOrCreateEntry(Entries& entries, Response::Node::Key key)
+        {
+            auto it{ findEntry(entries, key) };
+            if (it != std::end(entries))
+                return it->second;
+
+            return entries.emplace_back(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple()).second;
+        }
+
+        template <std::size_t N>
+        void appendEscapedString(std::string& out, std::string_view str, const std::pair<char, std::string_view>(&charsToEscape)[N])
+        {
+            for (const char c : str)
+            {
+                auto itEntry{ std::find_if(std::cbegin(charsToEscape), std::cend(charsToEscape), [=](const auto& entry) { return entry.first == c; }) };
+                if (itEntry != std::cend(charsToEscape))
+                    out += itEntry->second;
+                else
+                    out += c;
+            }
+        }
+
+        constexpr std::pair<char, std::string_view> jsonEscapeChars[]
+        {
+            { '\\', "\\\\" },
+            { '\n', "\\n" },
+            { '\r', "\\r" },
+            { '\t', "\\t" },
+            { '"', "\\\"" },
+        };
+
+        constexpr std::pair<char, std::string_view> xmlEscapeChars[]
+        {
+            { '&', "&amp;" },
+            { '<', "&lt;" },
+            { '>', "&gt;" },
+            { '"', "&quot;" },
+            { '\'', "&apos;" },
+        };
+
+        void appendFloat(std::string& out, float value)
+        {
+            // same output as the default ostream formatting
+            char buffer[32];
+            const int size{ std::snprintf(buffer, sizeof(buffer), "%g", static_cast<double>(value)) };
+            if (size > 0)
+                out.append(buffer, std::min(static_cast<std::size_t>(size), sizeof(buffer) - 1));
+        }
+    }
+
     std::string_view ResponseFormatToMimeType(ResponseFormat format)
     {
         switch (format)
@@ -41,10 +140,33 @@ namespace API::Subsonic
         return "";
     }
 
+    Response::ScopedArena::ScopedArena()
+    {
+        getThreadArena().acquire();
+    }
+
+    Response::ScopedArena::~ScopedArena()
+    {
+        getThreadArena().release();
+    }
+
+    Response::Node::Node()
+        : _attributes{ getThreadArena().getMemoryResource() }
+        , _children{ _attributes.get_allocator() }
+        , _childrenArrays{ _attributes.get_allocator() }
+        , _childrenValues{ _attributes.get_allocator() }
+    {
+    }
+
+    Response::Node::ValueType Response::Node::makeStringValue(std::string_view value) const
+    {
+        return ValueType{ std::in_place_type<std::pmr::string>, value, _attributes.get_allocator() };
+    }
+
     void Response::Node::setValue(std::string_view value)
     {
         assert(_children.empty() && _childrenArrays.empty() && _childrenValues.empty());
-        _value = std::string{ value };
+        _value = makeStringValue(value);
     }
 
     void Response::Node::setValue(long long value)
@@ -55,66 +177,80 @@ namespace API::Subsonic
 
     void Response::Node::setAttribute(Key key, std::string_view value)
     {
-        _attributes[key] = std::string{ value };
+        setAttributeValue(key, makeStringValue(value));
+    }
+
+    void Response::Node::setAttributeValue(Key key, ValueType&& value)
+    {
+        // moved in place, to keep the allocator of the value
+        auto it{ findEntry(_attributes, key) };
+        if (it != std::end(_attributes))
+            it->second = std::move(value);
+        else
+            _attributes.emplace_back(key, std::move(value));
     }
 
     void Response::Node::addChild(Key key, Node&& node)
     {
         assert(!_value);
-        assert(_children.find(key) == std::cend(_children));
-        _children[key] = std::move(node);
+        assert(!hasEntry(_children, key));
+        _children.emplace_back(key, std::move(node));
     }
 
     void Response::Node::createEmptyArrayChild(Key key)
     {
         assert(!_value);
-        assert(_children.find(key) == std::cend(_children));
-        _childrenArrays.emplace(key, std::vector<Node>{});
+        assert(!hasEntry(_children, key));
+        getOrCreateEntry(_childrenArrays, key);
     }
 
     void Response::Node::addArrayChild(Key key, Node&& node)
     {
         assert(!_value);
-        assert(_children.find(key) == std::cend(_children));
-        _childrenArrays[key].emplace_back(std::move(node));
+        assert(!hasEntry(_children, key));
+        getOrCreateEntry(_childrenArrays, key).emplace_back(std::move(node));
     }
 
     void Response::Node::createEmptyArrayValue(Key key)
     {
         assert(!_value);
-        assert(_children.find(key) == std::cend(_children));
-        _childrenValues.emplace(key, ValuesType{});
+        assert(!hasEntry(_children, key));
+        getOrCreateEntry(_childrenValues, key);
     }
 
     void Response::Node::addArrayValue(Key key, std::string_view value)
     {
         assert(!_value);
-        assert(_children.find(key) == std::cend(_children));
-        auto& values{ _childrenValues[key] };
-        values.push_back(std::string{ value });
+        assert(!hasEntry(_children, key));
+        auto& values{ getOrCreateEntry(_childrenValues, key) };
+        values.push_back(makeStringValue(value));
         assert(std::all_of(std::cbegin(values) + 1, std::cend(values), [&](const ValueType& value) {return value.index() == values.front().index();}));
     }
 
     void Response::Node::addArrayValue(Key key, long long value)
     {
         assert(!_value);
-        auto& values{ _childrenValues[key] };
+        auto& values{ getOrCreateEntry(_childrenValues, key) };
         values.push_back(value);
         assert(std::all_of(std::cbegin(values) + 1, std::cend(values), [&](const ValueType& value) {return value.index() == values.front().index();}));
     }
 
+    void Response::Node::setFragment(std::shared_ptr<const Fragment> fragment)
+    {
+        _fragment = std::move(fragment);
+    }
+
     Response::Node& Response::Node::createChild(Key key)
     {
         assert(!_value);
-        return _children[key];
+        return getOrCreateEntry(_children, key);
     }
 
     Response::Node& Response::Node::createArrayChild(Key key)
     {
         assert(!_value);
-        assert(_children.find(key) == std::cend(_children));
-        _childrenArrays[key].emplace_back();
-        return _childrenArrays[key].back();
+        assert(!hasEntry(_children, key));
+        return getOrCreateEntry(_childrenArrays, key).emplace_back();
     }
 
     void Response::Node::setVersionAttribute(ProtocolVersion protocolVersion)
@@ -122,6 +258,29 @@ namespace API::Subsonic
         setAttribute("version", std::to_string(protocolVersion.major) + "." + std::to_string(protocolVersion.minor) + "." + std::to_string(protocolVersion.patch));
     }
 
+    Response::Fragment::Fragment(const Node& node, ResponseFormat format)
+        : _format{ format }
+    {
+        assert(!node._fragment);
+
+        switch (format)
+        {
+        case ResponseFormat::xml:
+            XmlSerializer::serializeAttributes(_attributes, node);
+            XmlSerializer::serializeContent(_content, node);
+            break;
+
+        case ResponseFormat::json:
+        {
+            bool first{ true };
+            JsonSerializer::serializeAttributes(_attributes, node, first);
+            first = true;
+            JsonSerializer::serializeContent(_content, node, first);
+            break;
+        }
+        }
+    }
+
     Response Response::createOkResponse(ProtocolVersion protocolVersion)
     {
         return createResponseCommon(protocolVersion);
@@ -158,117 +317,216 @@ namespace API::Subsonic
 
     void Response::addNode(Node::Key key, Node&& node)
     {
-        return _root._children["subsonic-response"].addChild(key, std::move(node));
+        return _root.createChild("subsonic-response").addChild(key, std::move(node));
     }
 
     Response::Node& Response::createNode(Node::Key key)
     {
-        return _root._children["subsonic-response"].createChild(key);
+        return _root.createChild("subsonic-response").createChild(key);
     }
 
     Response::Node& Response::createArrayNode(Node::Key key)
     {
-        return _root._children["subsonic-response"].createArrayChild(key);
+        return _root.createChild("subsonic-response").createArrayChild(key);
     }
 
     void Response::write(std::ostream& os, ResponseFormat format) const
     {
+        const std::string out{ serialize(format) };
+        os.write(out.data(), out.size());
+    }
+
+    std::string Response::serialize(ResponseFormat format) const
+    {
+        std::string out;
+        out.reserve(estimateSerializedSize(_root));
+
         switch (format)
         {
         case ResponseFormat::xml:
-            writeXML(os);
+            out += R"(<?xml version="1.0" encoding="utf-8"?>)";
+            out += '\n';
+            for (const auto& [key, childNode] : _root._children)
+                XmlSerializer::serializeNode(out, key.get(), childNode);
             break;
         case ResponseFormat::json:
-            writeJSON(os);
+            JsonSerializer::serializeNode(out, _root);
             break;
         }
+
+        return out;
     }
 
-    void Response::writeXML(std::ostream& os) const
+    std::size_t Response::estimateSerializedSize(const Node& node)
     {
-        std::function<boost::property_tree::ptree(const Node&)> nodeToPropertyTree = [&](const Node& node)
-            {
-                boost::property_tree::ptree res;
+        // rough average size of a serialized attribute or value, including its key
+        constexpr std::size_t entrySize{ 24 };
+
+        std::size_t size{ (node._attributes.size() + 1) * entrySize };
+        if (node._fragment)
+            size += node._fragment->getSize();
+        for (const auto& [key, childNode] : node._children)
+            size += estimateSerializedSize(childNode);
+        for (const auto& [key, childArrayNodes] : node._childrenArrays)
+        {
+            for (const Node& childNode : childArrayNodes)
+                size += estimateSerializedSize(childNode);
+        }
+        for (const auto& [key, childValues] : node._childrenValues)
+            size += childValues.size() * entrySize;
 
-                for (const auto& [key, value] : node._attributes)
-                {
-                    if (std::holds_alternative<std::string>(value))
-                        res.put("<xmlattr>." + std::string{ key.get() }, std::get<std::string>(value));
-                    else if (std::holds_alternative<bool>(value))
-                        res.put("<xmlattr>." + std::string{ key.get() }, std::get<bool>(value));
-                    else if (std::holds_alternative<float>(value))
-                        res.put("<xmlattr>." + std::string{ key.get() }, std::get<float>(value));
-                    else if (std::holds_alternative<long long>(value))
-                        res.put("<xmlattr>." + std::string{ key.get() }, std::get<long long>(value));
-                }
+        return size;
+    }
+
+    void Response::XmlSerializer::serializeNode(std::string& out, std::string_view name, const Node& node)
+    {
+        assert(!node._fragment || node._fragment->getFormat() == ResponseFormat::xml);
 
-                auto valueToPropertyTree = [](const Node::ValueType& value)
-                    {
-                        boost::property_tree::ptree res;
-                        std::visit([&](const auto& rawValue)
-                            {
-                                res.put_value(rawValue);
-                            }, value);
+        out += '<';
+        out += name;
 
-                        return res;
-                    };
+        if (node._fragment)
+            out += node._fragment->_attributes;
+        serializeAttributes(out, node);
 
-                if (node._value)
-                {
-                    res = valueToPropertyTree(*node._value);
-                }
-                else
-                {
-                    for (const auto& [key, childNode] : node._children)
-                    {
-                        res.add_child(std::string{ key.get() }, nodeToPropertyTree(childNode));
-                    }
-
-                    for (const auto& [key, childArrayNodes] : node._childrenArrays)
-                    {
-                        for (const Node& childNode : childArrayNodes)
-                            res.add_child(std::string{ key.get() }, nodeToPropertyTree(childNode));
-                    }
-
-                    for (const auto& [key, childArrayValues] : node._childrenValues)
-                    {
-                        for (const Response::Node::ValueType& value : childArrayValues)
-                            res.add_child(std::string{ key.get() }, valueToPropertyTree(value));
-                    }
-                }
+        const bool hasContent{ node._value || !node._children.empty() || !node._childrenArrays.empty() || !node._childrenValues.empty() || (node._fragment && !node._fragment->_content.empty()) };
+        if (!hasContent)
+        {
+            out += "/>";
+            return;
+        }
+        out += '>';
+
+        if (node._fragment)
+            out += node._fragment->_content;
+        serializeContent(out, node);
+
+        out += "</";
+        out += name;
+        out += '>';
+    }
+
+    void Response::XmlSerializer::serializeAttributes(std::string& out, const Node& node)
+    {
+        for (const auto& [key, value] : node._attributes)
+        {
+            out += ' ';
+            out += key.get();
+            out += "=\"";
+            serializeValue(out, value);
+            out += '"';
+        }
+    }
+
+    void Response::XmlSerializer::serializeContent(std::string& out, const Node& node)
+    {
+        auto serializeValueNode{ [&](std::string_view key, const Node::ValueType& value)
+        {
+            out += '<';
+            out += key;
+            out += '>';
+            serializeValue(out, value);
+            out += "</";
+            out += key;
+            out += '>';
+        } };
+
+        if (node._value)
+        {
+            serializeValue(out, *node._value);
+        }
+        else
+        {
+            for (const auto& [key, childNode] : node._children)
+                serializeNode(out, key.get(), childNode);
+
+            for (const auto& [key, childArrayNodes] : node._childrenArrays)
+            {
+                for (const Node& childNode : childArrayNodes)
+                    serializeNode(out, key.get(), childNode);
+            }
+
+            for (const auto& [key, childArrayValues] : node._childrenValues)
+            {
+                for (const Node::ValueType& value : childArrayValues)
+                    serializeValueNode(key.get(), value);
+            }
+        }
+    }
 
-                return res;
-            };
+    void Response::XmlSerializer::serializeValue(std::string& out, const Node::ValueType& value)
+    {
+        if (std::holds_alternative<std::pmr::string>(value))
+            serializeEscapedString(out, std::get<std::pmr::string>(value));
+        else if (std::holds_alternative<bool>(value))
+            out += (std::get<bool>(value) ? "true" : "false");
+        else if (std::holds_alternative<float>(value))
+            appendFloat(out, std::get<float>(value));
+        else if (std::holds_alternative<long long>(value))
+            out += std::to_string(std::get<long long>(value));
+        else
+            assert(false);
+    }
 
-        boost::property_tree::ptree root{ nodeToPropertyTree(_root) };
-        boost::property_tree::write_xml(os, root);
+    void Response::XmlSerializer::serializeEscapedString(std::string& out, std::string_view str)
+    {
+        appendEscapedString(out, str, xmlEscapeChars);
     }
 
-    void Response::JsonSerializer::serializeNode(std::ostream& os, const Response::Node& node)
+    void Response::JsonSerializer::serializeNode(std::string& out, const Response::Node& node)
     {
-        os << '{';
+        assert(!node._fragment || node._fragment->getFormat() == ResponseFormat::json);
+
+        out += '{';
 
         bool first{ true };
+        auto serializeFragmentPart{ [&](const std::string& part)
+        {
+            if (part.empty())
+                return;
 
+            if (!first)
+                out += ',';
+            out += part;
+
+            first = false;
+        } };
+
+        if (node._fragment)
+            serializeFragmentPart(node._fragment->_attributes);
+        serializeAttributes(out, node, first);
+
+        if (node._fragment)
+            serializeFragmentPart(node._fragment->_content);
+        serializeContent(out, node, first);
+
+        out += '}';
+    }
+
+    void Response::JsonSerializer::serializeAttributes(std::string& out, const Node& node, bool& first)
+    {
         for (const auto& [key, value] : node._attributes)
         {
             if (!first)
-                os << ',';
+                out += ',';
 
-            serializeEscapedString(os, key.get());
-            os << ':';
-            serializeValue(os, value);
+            serializeEscapedString(out, key.get());
+            out += ':';
+            serializeValue(out, value);
 
             first = false;
         }
+    }
 
+    void Response::JsonSerializer::serializeContent(std::string& out, const Node& node, bool& first)
+    {
         if (node._value)
         {
             if (!first)
-                os << ',';
+                out += ',';
 
-            os << "\"value\":";
-            serializeValue(os, *node._value);
+            out += "\"value\":";
+            serializeValue(out, *node._value);
 
             first = false;
         }
@@ -277,11 +535,11 @@ namespace API::Subsonic
             for (const auto& [key, childNode] : node._children)
             {
                 if (!first)
-                    os << ',';
+                    out += ',';
 
-                serializeEscapedString(os, key.get());
-                os << ':';
-                serializeNode(os, childNode);
+                serializeEscapedString(out, key.get());
+                out += ':';
+                serializeNode(out, childNode);
 
                 first = false;
             }
@@ -289,21 +547,21 @@ namespace API::Subsonic
             for (const auto& [key, childArrayNodes] : node._childrenArrays)
             {
                 if (!first)
-                    os << ',';
+                    out += ',';
 
-                serializeEscapedString(os, key.get());
-                os << ":[";
+                serializeEscapedString(out, key.get());
+                out += ":[";
 
                 bool firstChild{ true };
                 for (const Response::Node& childNode : childArrayNodes)
                 {
                     if (!firstChild)
-                        os << ",";
+                        out += ',';
 
-                    serializeNode(os, childNode);
+                    serializeNode(out, childNode);
                     firstChild = false;
                 }
-                os << ']';
+                out += ']';
 
                 first = false;
             }
@@ -311,51 +569,49 @@ namespace API::Subsonic
             for (const auto& [key, childValues] : node._childrenValues)
             {
                 if (!first)
-                    os << ',';
+                    out += ',';
 
-                serializeEscapedString(os, key.get());
-                os << ":[";
+                serializeEscapedString(out, key.get());
+                out += ":[";
 
                 bool firstChild{ true };
                 for (const Node::ValueType& childValue : childValues)
                 {
                     if (!firstChild)
-                        os << ",";
+                        out += ',';
 
-                    serializeValue(os, childValue);
+                    serializeValue(out, childValue);
 
                     firstChild = false;
                 }
-                os << ']';
+                out += ']';
 
                 first = false;
             }
         }
-
-        os << '}';
     }
 
-    void Response::JsonSerializer::serializeValue(std::ostream& os, const Node::ValueType& value)
+    void Response::JsonSerializer::serializeValue(std::string& out, const Node::ValueType& value)
     {
-        if (std::holds_alternative<std::string>(value))
+        if (std::holds_alternative<std::pmr::string>(value))
         {
-            serializeEscapedString(os, std::get<std::string>(value));
+            serializeEscapedString(out, std::get<std::pmr::string>(value));
         }
         else if (std::holds_alternative<bool>(value))
         {
-            os << (std::get<bool>(value) ? "true" : "false");
+            out += (std::get<bool>(value) ? "true" : "false");
         }
         else if (std::holds_alternative<float>(value))
         {
             const float d{ std::get<float>(value) };
             if (std::isnan(d) || std::fabs(d) == std::numeric_limits<float>::infinity())
-                os << "null";
+                out += "null";
             else
-                os << d;
+                appendFloat(out, d);
         }
         else if (std::holds_alternative<long long>(value))
         {
-            os << std::get<long long>(value);
+            out += std::to_string(std::get<long long>(value));
         }
         else
         {
@@ -363,17 +619,11 @@ namespace API::Subsonic
         }
     }
 
-    void Response::JsonSerializer::serializeEscapedString(std::ostream& os, std::string_view str)
-    {
-        os << '\"';
-        StringUtils::writeJsonEscapedString(os, str);
-        os << '\"';
-    }
-
-    void Response::writeJSON(std::ostream& os) const
+    void Response::JsonSerializer::serializeEscapedString(std::string& out, std::string_view str)
     {
-        JsonSerializer serializer;
-        serializer.serializeNode(os, _root);
+        out += '\"';
+        appendEscapedString(out, str, jsonEscapeChars);
+        out += '\"';
     }
 
 } // namespace
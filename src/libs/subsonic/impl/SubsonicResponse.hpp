@@ -18,26 +18,23 @@
  */
 #pragma once
 
-#include <map>
+#include <memory>
+#include <memory_resource>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <variant>
 #include <vector>
 
 #include "RequestContext.hpp"
+#include "ResponseFormat.hpp"
 
 namespace API::Subsonic
 {
     // Max count expected from all API methods that expose a count
     static inline constexpr std::size_t defaultMaxCountSize{ 1000 };
 
-    enum class ResponseFormat
-    {
-        xml,
-        json,
-    };
-
     std::string_view ResponseFormatToMimeType(ResponseFormat format);
 
     class Error
@@ -146,6 +143,11 @@ namespace API::Subsonic
         std::string getMessage() const override { return "Login throttled, too many attempts"; }
     };
 
+    class TooManyPendingRequestsGenericError : public GenericError
+    {
+        std::string getMessage() const override { return "Too many pending requests, try again later"; }
+    };
+
     class NotImplementedGenericError : public GenericError
     {
         std::string getMessage() const override { return "Not implemented"; }
@@ -202,6 +204,8 @@ namespace API::Subsonic
     class Response
     {
     public:
+        class Fragment;
+
         class Node
         {
         public:
@@ -212,23 +216,25 @@ namespace API::Subsonic
                 constexpr Key(const char (&str)[N]) : _str{ str } {}
                 constexpr std::string_view get() const { return _str; }
 
-                bool constexpr operator<(const Key& other) const { return _str < other._str; }
+                bool constexpr operator==(const Key& other) const { return _str.data() == other._str.data() || _str == other._str; }
 
             private:
-                const std::string_view _str;
+                std::string_view _str;
             };
 
+            Node(); // allocates from the arena of the current ScopedArena, if any
+
             void setAttribute(Key key, std::string_view value);
 
             template <typename T, std::enable_if_t<std::is_arithmetic<T>::value>* = nullptr>
             void setAttribute(Key key, T value)
             {
                 if constexpr (std::is_same<bool, T>::value)
-                    _attributes[key] = value;
+                    setAttributeValue(key, value);
                 else if constexpr (std::is_floating_point<T>::value)
-                    _attributes[key] = static_cast<float>(value);
+                    setAttributeValue(key, static_cast<float>(value));
                 else if constexpr (std::is_integral<T>::value)
-                    _attributes[key] = static_cast<long long>(value);
+                    setAttributeValue(key, static_cast<long long>(value));
                 else
                     static_assert("Unhandled type");
             }
@@ -246,18 +252,59 @@ namespace API::Subsonic
             void addArrayValue(Key key, std::string_view value);
             void addArrayValue(Key key, long long value);
 
+            // Prepends a pre-serialized content, that must have been serialized using the response format
+            void setFragment(std::shared_ptr<const Fragment> fragment);
+
         private:
             void setVersionAttribute(ProtocolVersion version);
 
             friend class Response;
-            using ValueType = std::variant<std::string, bool, float, long long>;
-            std::map<Key, ValueType> _attributes;
+            using ValueType = std::variant<std::pmr::string, bool, float, long long>;
+            void setAttributeValue(Key key, ValueType&& value);
+            ValueType makeStringValue(std::string_view value) const;
+
+            // Few entries per node: flat vectors, in insertion order, are much cheaper than maps
+            template <typename T>
+            using Entries = std::pmr::vector<std::pair<Key, T>>;
+
+            Entries<ValueType> _attributes;
             std::optional<ValueType> _value;
-            std::map<Key, Node> _children;
-            std::map<Key, std::vector<Node>> _childrenArrays;
+            Entries<Node> _children;
+            Entries<std::pmr::vector<Node>> _childrenArrays;
+
+            using ValuesType = std::pmr::vector<ValueType>;
+            Entries<ValuesType> _childrenValues;
 
-            using ValuesType = std::vector<ValueType>;
-            std::map<Key, ValuesType> _childrenValues;
+            std::shared_ptr<const Fragment> _fragment;
+        };
+
+        // Serialized attributes and children of a node, to be shared between responses
+        class Fragment
+        {
+        public:
+            Fragment(const Node& node, ResponseFormat format);
+
+            ResponseFormat getFormat() const { return _format; }
+            std::size_t getSize() const { return _attributes.size() + _content.size(); }
+
+        private:
+            friend class Response;
+
+            const ResponseFormat _format;
+            std::string _attributes;
+            std::string _content;
+        };
+
+        // While alive, nodes and their values created on this thread allocate from a per thread monotonic arena
+        // The arena is reset when the outermost scope ends: responses and nodes must not outlive it
+        // Without scope, the default allocator is used
+        class ScopedArena
+        {
+        public:
+            ScopedArena();
+            ~ScopedArena();
+            ScopedArena(const ScopedArena&) = delete;
+            ScopedArena& operator=(const ScopedArena&) = delete;
         };
 
         static Response createOkResponse(ProtocolVersion protocolVersion);
@@ -274,20 +321,33 @@ namespace API::Subsonic
         Node& createArrayNode(Node::Key key);
 
         void write(std::ostream& os, ResponseFormat format) const;
+        std::string serialize(ResponseFormat format) const;
 
     private:
         static Response createResponseCommon(ProtocolVersion protocolVersion, const Error* error = nullptr);
 
+        // Serializers directly append to a single pre-sized buffer
         class JsonSerializer
         {
             public:
-            void serializeNode(std::ostream& os, const Node& node);
-            void serializeValue(std::ostream& os, const Node::ValueType& node);
-            void serializeEscapedString(std::ostream&, std::string_view str);
+            static void serializeNode(std::string& out, const Node& node);
+            static void serializeAttributes(std::string& out, const Node& node, bool& first);
+            static void serializeContent(std::string& out, const Node& node, bool& first);
+            static void serializeValue(std::string& out, const Node::ValueType& value);
+            static void serializeEscapedString(std::string& out, std::string_view str);
+        };
+
+        class XmlSerializer
+        {
+            public:
+            static void serializeNode(std::string& out, std::string_view name, const Node& node);
+            static void serializeAttributes(std::string& out, const Node& node);
+            static void serializeContent(std::string& out, const Node& node);
+            static void serializeValue(std::string& out, const Node::ValueType& value);
+            static void serializeEscapedString(std::string& out, std::string_view str);
         };
 
-        void writeJSON(std::ostream& os) const;
-        void writeXML(std::ostream& os) const;
+        static std::size_t estimateSerializedSize(const Node& node);
 
         Response() = default;
         Node _root;
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "UserSettingsCache.hpp"
+
+#include <mutex>
+
+#include "services/database/Session.hpp"
+#include "services/database/User.hpp"
+
+namespace API::Subsonic
+{
+    std::shared_ptr<const UserSettings> UserSettingsCache::get(Database::Session& session, Database::UserId userId)
+    {
+        // taken before reading the user, so that concurrent changes make the read snapshot outdated
+        const std::uint64_t settingsGeneration{ Database::User::getSettingsGeneration() };
+
+        {
+            std::shared_lock lock{ _mutex };
+
+            auto it{ _entries.find(userId) };
+            if (it != std::cend(_entries) && it->second.settingsGeneration == settingsGeneration)
+                return it->second.settings;
+        }
+
+        std::shared_ptr<const UserSettings> settings;
+        {
+            auto transaction{ session.createSharedTransaction() };
+
+            const Database::User::pointer user{ Database::User::find(session, userId) };
+            if (!user)
+            {
+                std::unique_lock lock{ _mutex };
+                _entries.erase(userId);
+                return {};
+            }
+
+            settings = std::make_shared<const UserSettings>(UserSettings{ user->getType(),
+                user->getScrobblingBackend(),
+                user->getFeedbackBackend(),
+                user->getSubsonicArtistListMode(),
+                user->getSubsonicEnableTranscodingByDefault(),
+                user->getSubsonicDefaultTranscodingOutputFormat(),
+                user->getSubsonicDefaultTranscodingOutputBitrate() });
+        }
+
+        {
+            std::unique_lock lock{ _mutex };
+
+            // outdated entries of the other users are replaced when they are requested again
+            Entry& entry{ _entries[userId] };
+            if (!entry.settings || entry.settingsGeneration <= settingsGeneration)
+                entry = Entry{ settingsGeneration, settings };
+        }
+
+        return settings;
+    }
+}
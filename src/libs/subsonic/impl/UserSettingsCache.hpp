@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "services/database/Types.hpp"
+#include "services/database/UserId.hpp"
+
+namespace Database
+{
+    class Session;
+}
+
+namespace API::Subsonic
+{
+    // Immutable snapshot of the user settings used by most of the requests
+    struct UserSettings
+    {
+        Database::UserType                  type;
+        Database::ScrobblingBackend         scrobblingBackend;
+        Database::FeedbackBackend           feedbackBackend;
+        Database::SubsonicArtistListMode    artistListMode;
+        bool                                enableTranscodingByDefault;
+        Database::TranscodingOutputFormat   defaultTranscodingOutputFormat;
+        Database::Bitrate                   defaultTranscodingOutputBitrate;
+    };
+
+    // Snapshots are read again once any user has been changed, see Database::User::getSettingsGeneration
+    class UserSettingsCache
+    {
+    public:
+        UserSettingsCache() = default;
+
+        UserSettingsCache(const UserSettingsCache&) = delete;
+        UserSettingsCache& operator=(const UserSettingsCache&) = delete;
+
+        // null if the user does not exist
+        std::shared_ptr<const UserSettings> get(Database::Session& session, Database::UserId userId);
+
+    private:
+        struct Entry
+        {
+            std::uint64_t settingsGeneration;
+            std::shared_ptr<const UserSettings> settings;
+        };
+
+        std::shared_mutex _mutex;
+        std::unordered_map<Database::UserId, Entry> _entries;
+    };
+}
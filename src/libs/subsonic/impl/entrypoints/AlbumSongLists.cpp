@@ -19,11 +19,14 @@
 
 #include "AlbumSongLists.hpp"
 
+#include <chrono>
+
 #include "services/database/Artist.hpp"
 #include "services/database/Cluster.hpp"
 #include "services/database/Release.hpp"
 #include "services/database/Session.hpp"
 #include "services/database/Track.hpp"
+#include "services/database/TrackRelations.hpp"
 #include "services/database/User.hpp"
 #include "services/feedback/IFeedbackService.hpp"
 #include "services/scrobbling/IScrobblingService.hpp"
@@ -145,6 +148,7 @@ namespace API::Subsonic
             Response response{ Response::createOkResponse(context.serverProtocolVersion) };
             Response::Node& albumListNode{ response.createNode(id3 ? Response::Node::Key{ "albumList2" } : Response::Node::Key{ "albumList" }) };
 
+            context.starredDateTimes.load(context.userId, releases.results);
             for (const ReleaseId releaseId : releases.results)
             {
                 const Release::pointer release{ Release::find(context.dbSession, releaseId) };
@@ -174,23 +178,30 @@ namespace API::Subsonic
                 Feedback::IFeedbackService::ArtistFindParameters artistFindParams;
                 artistFindParams.setUser(context.userId);
                 artistFindParams.setSortMethod(ArtistSortMethod::BySortName);
-                for (const ArtistId artistId : feedbackService.findStarredArtists(artistFindParams).results)
+                const std::vector<ArtistId> artistIds{ feedbackService.findStarredArtists(artistFindParams).results };
+                context.starredDateTimes.load(context.userId, artistIds);
+                for (const ArtistId artistId : artistIds)
                 {
                     if (auto artist{ Artist::find(context.dbSession, artistId) })
                         starredNode.addArrayChild("artist", createArtistNode(context, artist, user, id3));
                 }
             }
 
-            for (const ReleaseId releaseId : feedbackService.findStarredReleases(findParameters).results)
+            const std::vector<ReleaseId> releaseIds{ feedbackService.findStarredReleases(findParameters).results };
+            context.starredDateTimes.load(context.userId, releaseIds);
+            for (const ReleaseId releaseId : releaseIds)
             {
                 if (auto release{ Release::find(context.dbSession, releaseId) })
                     starredNode.addArrayChild("album", createAlbumNode(context, release, user, id3));
             }
 
-            for (const TrackId trackId : feedbackService.findStarredTracks(findParameters).results)
+            const std::vector<TrackId> trackIds{ feedbackService.findStarredTracks(findParameters).results };
+            const TrackRelations trackRelations{ context.dbSession, trackIds };
+            context.starredDateTimes.load(context.userId, trackIds);
+            for (const TrackId trackId : trackIds)
             {
                 if (auto track{ Track::find(context.dbSession, trackId) })
-                    starredNode.addArrayChild("song", createSongNode(context, track, user));
+                    starredNode.addArrayChild("song", createSongNode(context, track, user, &trackRelations));
             }
 
             return response;
@@ -223,14 +234,26 @@ namespace API::Subsonic
         Response response{ Response::createOkResponse(context.serverProtocolVersion) };
         Response::Node& randomSongsNode{ response.createNode("randomSongs") };
 
+        // Served from the pre-shuffled pools of the library catalog, if any: only the picked tracks are read
         Track::FindParameters params;
         params.setSortMethod(TrackSortMethod::Random);
         params.setRange(Range{ 0, size });
 
-        Track::find(context.dbSession, params, [&](const Track::pointer& track)
-            {
-                randomSongsNode.addArrayChild("song", createSongNode(context, track, user));
-            });
+        if (const std::optional<std::string> genre{ getParameterAs<std::string>(context.parameters, "genre") })
+        {
+            const ClusterType::pointer clusterType{ ClusterType::find(context.dbSession, "GENRE") };
+            const Cluster::pointer cluster{ clusterType ? clusterType->getCluster(*genre) : Cluster::pointer{} };
+            if (!cluster)
+                return response;
+
+            params.setClusters({ cluster->getId() });
+        }
+
+        const std::vector<Track::pointer> tracks{ Track::find(context.dbSession, params).results };
+        const TrackRelations trackRelations{ context.dbSession, tracks };
+        context.starredDateTimes.load(context.userId, tracks);
+        for (const Track::pointer& track : tracks)
+            randomSongsNode.addArrayChild("song", createSongNode(context, track, user, &trackRelations));
 
         return response;
     }
@@ -268,10 +291,11 @@ namespace API::Subsonic
         params.setClusters({ cluster->getId() });
         params.setRange(Range{ offset, count });
 
-        Track::find(context.dbSession, params, [&](const Track::pointer& track)
-            {
-                songsByGenreNode.addArrayChild("song", createSongNode(context, track, user));
-            });
+        const std::vector<Track::pointer> tracks{ Track::find(context.dbSession, params).results };
+        const TrackRelations trackRelations{ context.dbSession, tracks };
+        context.starredDateTimes.load(context.userId, tracks);
+        for (const Track::pointer& track : tracks)
+            songsByGenreNode.addArrayChild("song", createSongNode(context, track, user, &trackRelations));
 
         return response;
     }
@@ -286,4 +310,44 @@ namespace API::Subsonic
         return handleGetStarredRequestCommon(context, true /* id3 */);
     }
 
+    Response handleGetNowPlayingRequest(RequestContext& context)
+    {
+        // in memory, no listen is read
+        const std::vector<Scrobbling::NowPlaying> nowPlayings{ Service<Scrobbling::IScrobblingService>::get()->getNowPlaying() };
+
+        Response response{ Response::createOkResponse(context.serverProtocolVersion) };
+        Response::Node& nowPlayingNode{ response.createNode("nowPlaying") };
+
+        auto transaction{ context.dbSession.createSharedTransaction() };
+
+        const User::pointer user{ User::find(context.dbSession, context.userId) };
+        if (!user)
+            throw UserNotAuthorizedError{};
+
+        const Wt::WDateTime now{ Wt::WDateTime::currentDateTime() };
+        for (const Scrobbling::NowPlaying& nowPlaying : nowPlayings)
+        {
+            const Track::pointer track{ Track::find(context.dbSession, nowPlaying.trackId) };
+            const User::pointer listener{ User::find(context.dbSession, nowPlaying.userId) };
+            if (!track || !listener)
+                continue;
+
+            // already over, with some margin for the pauses
+            const int elapsedSecs{ nowPlaying.startedAt.secsTo(now) };
+            if (elapsedSecs > std::chrono::duration_cast<std::chrono::seconds>(track->getDuration()).count() + 60)
+                continue;
+
+            Response::Node entryNode{ createSongNode(context, track, user) };
+            entryNode.setAttribute("username", listener->getLoginName());
+            entryNode.setAttribute("minutesAgo", elapsedSecs / 60);
+            entryNode.setAttribute("playerId", 0);
+            if (!nowPlaying.playerName.empty())
+                entryNode.setAttribute("playerName", nowPlaying.playerName);
+
+            nowPlayingNode.addArrayChild("entry", std::move(entryNode));
+        }
+
+        return response;
+    }
+
 }
\ No newline at end of file
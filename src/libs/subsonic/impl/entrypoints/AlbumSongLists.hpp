@@ -30,4 +30,5 @@ namespace API::Subsonic
     Response handleGetSongsByGenreRequest(RequestContext& context);
     Response handleGetStarredRequest(RequestContext& context);
     Response handleGetStarred2Request(RequestContext& context);
+    Response handleGetNowPlayingRequest(RequestContext& context);
 }
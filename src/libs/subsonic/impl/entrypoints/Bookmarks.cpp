@@ -23,9 +23,12 @@
 #include "services/database/User.hpp"
 #include "services/database/Track.hpp"
 #include "services/database/TrackBookmark.hpp"
+#include "services/database/TrackRelations.hpp"
+#include "utils/String.hpp"
 #include "responses/Bookmark.hpp"
 #include "responses/Song.hpp"
 #include "ParameterParsing.hpp"
+#include "PlayQueueStore.hpp"
 #include "SubsonicId.hpp"
 
 namespace API::Subsonic
@@ -101,4 +104,64 @@ namespace API::Subsonic
 
         return Response::createOkResponse(context.serverProtocolVersion);
     }
-}
\ No newline at end of file
+
+    Response handleGetPlayQueue(RequestContext& context)
+    {
+        // served from memory, the database is only read on first use
+        const std::shared_ptr<const PlayQueueStore::PlayQueue> playQueue{ context.playQueueStore.get(context.dbSession, context.userId) };
+
+        auto transaction{ context.dbSession.createSharedTransaction() };
+
+        const User::pointer user{ User::find(context.dbSession, context.userId) };
+        if (!user)
+            throw UserNotAuthorizedError{};
+
+        Response response{ Response::createOkResponse(context.serverProtocolVersion) };
+        if (!playQueue)
+            return response;
+
+        Response::Node& playQueueNode{ response.createNode("playQueue") };
+        if (playQueue->currentIndex < playQueue->trackIds.size())
+        {
+            playQueueNode.setAttribute("current", idToString(playQueue->trackIds[playQueue->currentIndex]));
+            playQueueNode.setAttribute("position", playQueue->currentPosition.count());
+        }
+        playQueueNode.setAttribute("username", user->getLoginName());
+        playQueueNode.setAttribute("changed", StringUtils::toISO8601String(playQueue->lastModifiedDateTime));
+        playQueueNode.setAttribute("changedBy", playQueue->changedBy);
+
+        const TrackRelations trackRelations{ context.dbSession, playQueue->trackIds };
+        for (const TrackId trackId : playQueue->trackIds)
+        {
+            // tracks may have been removed since the save
+            if (const Track::pointer track{ Track::find(context.dbSession, trackId) })
+                playQueueNode.addArrayChild("entry", createSongNode(context, track, user, &trackRelations));
+        }
+
+        return response;
+    }
+
+    Response handleSavePlayQueue(RequestContext& context)
+    {
+        // an empty id list clears the play queue
+        PlayQueueStore::PlayQueue playQueue;
+        playQueue.trackIds = getMultiParametersAs<TrackId>(context.parameters, "id");
+
+        if (const std::optional<TrackId> currentTrackId{ getParameterAs<TrackId>(context.parameters, "current") })
+        {
+            const auto itCurrent{ std::find(std::cbegin(playQueue.trackIds), std::cend(playQueue.trackIds), *currentTrackId) };
+            if (itCurrent == std::cend(playQueue.trackIds))
+                throw BadParameterGenericError{ "current" };
+
+            playQueue.currentIndex = std::distance(std::cbegin(playQueue.trackIds), itCurrent);
+        }
+        playQueue.currentPosition = std::chrono::milliseconds{ getParameterAs<unsigned long long>(context.parameters, "position").value_or(0) };
+        playQueue.lastModifiedDateTime = Wt::WDateTime::currentDateTime();
+        playQueue.changedBy = context.clientInfo.name;
+
+        // written to the database later, only the latest save of each user is kept
+        context.playQueueStore.save(context.userId, std::move(playQueue));
+
+        return Response::createOkResponse(context.serverProtocolVersion);
+    }
+}
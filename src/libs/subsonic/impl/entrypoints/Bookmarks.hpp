@@ -27,4 +27,6 @@ namespace API::Subsonic
     Response handleGetBookmarks(RequestContext& context);
     Response handleCreateBookmark(RequestContext& context);
     Response handleDeleteBookmark(RequestContext& context);
+    Response handleGetPlayQueue(RequestContext& context);
+    Response handleSavePlayQueue(RequestContext& context);
 }
@@ -24,6 +24,7 @@
 #include "services/database/Session.hpp"
 #include "services/database/Release.hpp"
 #include "services/database/Track.hpp"
+#include "services/database/TrackRelations.hpp"
 #include "services/database/User.hpp"
 #include "services/recommendation/IRecommendationService.hpp"
 #include "utils/Logger.hpp"
@@ -42,7 +43,6 @@ namespace API::Subsonic
     using namespace Database;
 
     static const std::string_view	reportedDummyDate{ "2000-01-01T00:00:00" };
-    static const unsigned long long	reportedDummyDateULong{ 946684800000ULL }; // 2000-01-01T00:00:00 UTC
 
     namespace
     {
@@ -91,32 +91,34 @@ namespace API::Subsonic
 
         Response handleGetArtistsRequestCommon(RequestContext& context, bool id3)
         {
+            const unsigned long long lastModified{ static_cast<unsigned long long>(context.libraryGeneration.getLastModified(context.userId).toTime_t()) * 1000 };
+
             Response response{ Response::createOkResponse(context.serverProtocolVersion) };
 
             Response::Node& artistsNode{ response.createNode(id3 ? "artists" : "indexes") };
             artistsNode.setAttribute("ignoredArticles", "");
-            artistsNode.setAttribute("lastModified", reportedDummyDateULong); // TODO report last file write?
+            artistsNode.setAttribute("lastModified", lastModified);
 
-            Artist::FindParameters parameters;
+            // API says: "If specified, only return a result if the artist collection has changed since the given time"
+            if (!id3)
             {
-                auto transaction{ context.dbSession.createSharedTransaction() };
-
-                User::pointer user{ User::find(context.dbSession, context.userId) };
-                if (!user)
-                    throw UserNotAuthorizedError{};
+                const std::optional<unsigned long long> ifModifiedSince{ getParameterAs<unsigned long long>(context.parameters, "ifModifiedSince") };
+                if (ifModifiedSince && *ifModifiedSince >= lastModified)
+                    return response;
+            }
 
-                parameters.setSortMethod(ArtistSortMethod::BySortName);
-                switch (user->getSubsonicArtistListMode())
-                {
-                case SubsonicArtistListMode::AllArtists:
-                    break;
-                case SubsonicArtistListMode::ReleaseArtists:
-                    parameters.setLinkType(TrackArtistLinkType::ReleaseArtist);
-                    break;
-                case SubsonicArtistListMode::TrackArtists:
-                    parameters.setLinkType(TrackArtistLinkType::Artist);
-                    break;
-                }
+            Artist::FindParameters parameters;
+            parameters.setSortMethod(ArtistSortMethod::BySortName);
+            switch (context.userSettings->artistListMode)
+            {
+            case SubsonicArtistListMode::AllArtists:
+                break;
+            case SubsonicArtistListMode::ReleaseArtists:
+                parameters.setLinkType(TrackArtistLinkType::ReleaseArtist);
+                break;
+            case SubsonicArtistListMode::TrackArtists:
+                parameters.setLinkType(TrackArtistLinkType::Artist);
+                break;
             }
 
             // This endpoint does not scale: make sort lived transactions in order not to block the whole application
@@ -152,6 +154,15 @@ namespace API::Subsonic
 
             // second pass: add each artist
             LMS_LOG(API_SUBSONIC, DEBUG) << "GetArtists: constructing response...";
+            {
+                std::vector<ArtistId> allArtistIds;
+                for (const auto& [sortChar, artistIds] : artistsSortedByFirstChar)
+                    allArtistIds.insert(std::end(allArtistIds), std::cbegin(artistIds), std::cend(artistIds));
+
+                auto transaction{ context.dbSession.createSharedTransaction() };
+                context.starredDateTimes.load(context.userId, allArtistIds);
+            }
+
             for (const auto& [sortChar, artistIds] : artistsSortedByFirstChar)
             {
                 Response::Node& indexNode{ artistsNode.createArrayChild("index") };
@@ -318,11 +329,11 @@ namespace API::Subsonic
             directoryNode.setAttribute("id", idToString(RootId{}));
             directoryNode.setAttribute("name", "Music");
 
-            // TODO: this does not scale when a lot of artists are present
-            Artist::find(context.dbSession, Artist::FindParameters{}.setSortMethod(ArtistSortMethod::BySortName), [&](const Artist::pointer& artist)
-                {
-                    directoryNode.addArrayChild("child", createArtistNode(context, artist, user, false /* no id3 */));
-                });
+            // the browse hierarchy is served by the library catalog, if any
+            const auto artists{ Artist::find(context.dbSession, Artist::FindParameters{}.setSortMethod(ArtistSortMethod::BySortName)) };
+            context.starredDateTimes.load(context.userId, artists.results);
+            for (const Artist::pointer& artist : artists.results)
+                directoryNode.addArrayChild("child", createArtistNode(context, artist, user, false /* no id3 */));
         }
         else if (artistId)
         {
@@ -334,10 +345,10 @@ namespace API::Subsonic
 
             directoryNode.setAttribute("name", Utils::makeNameFilesystemCompatible(artist->getName()));
 
-            Release::find(context.dbSession, Release::FindParameters{}.setArtist(*artistId), [&](const Release::pointer& release)
-                {
-                    directoryNode.addArrayChild("child", createAlbumNode(context, release, user, false /* no id3 */));
-                });
+            const auto releases{ Release::find(context.dbSession, Release::FindParameters{}.setArtist(*artistId).setSortMethod(ReleaseSortMethod::Name)) };
+            context.starredDateTimes.load(context.userId, releases.results);
+            for (const Release::pointer& release : releases.results)
+                directoryNode.addArrayChild("child", createAlbumNode(context, release, user, false /* no id3 */));
         }
         else if (releaseId)
         {
@@ -349,10 +360,11 @@ namespace API::Subsonic
 
             directoryNode.setAttribute("name", Utils::makeNameFilesystemCompatible(release->getName()));
 
-            Track::find(context.dbSession, Track::FindParameters{}.setRelease(*releaseId).setSortMethod(TrackSortMethod::Release), [&](const Track::pointer& track)
-                {
-                    directoryNode.addArrayChild("child", createSongNode(context, track, user));
-                });
+            const auto tracks{ Track::find(context.dbSession, Track::FindParameters{}.setRelease(*releaseId).setSortMethod(TrackSortMethod::Release)) };
+            const TrackRelations trackRelations{ context.dbSession, tracks.results };
+            context.starredDateTimes.load(context.userId, tracks.results);
+            for (const Track::pointer& track : tracks.results)
+                directoryNode.addArrayChild("child", createSongNode(context, track, user, &trackRelations));
         }
         else
             throw BadParameterGenericError{ "id" };
@@ -404,6 +416,7 @@ namespace API::Subsonic
         Response::Node artistNode{ createArtistNode(context, artist, user, true /* id3 */) };
 
         const auto releases{ Release::find(context.dbSession, Release::FindParameters {}.setArtist(artist->getId())) };
+        context.starredDateTimes.load(context.userId, releases.results);
         for (const Release::pointer& release : releases.results)
             artistNode.addArrayChild("album", createAlbumNode(context, release, user, true /* id3 */));
 
@@ -431,8 +444,10 @@ namespace API::Subsonic
         Response::Node albumNode{ createAlbumNode(context, release, user, true /* id3 */) };
 
         const auto tracks{ Track::find(context.dbSession, Track::FindParameters {}.setRelease(id).setSortMethod(TrackSortMethod::Release)) };
+        const TrackRelations trackRelations{ context.dbSession, tracks.results };
+        context.starredDateTimes.load(context.userId, tracks.results);
         for (const Track::pointer& track : tracks.results)
-            albumNode.addArrayChild("song", createSongNode(context, track, user));
+            albumNode.addArrayChild("song", createSongNode(context, track, user, &trackRelations));
 
         response.addNode("album", std::move(albumNode));
 
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LibrarySync.hpp"
+
+#include <ctime>
+
+#include <Wt/WDateTime.h>
+
+#include "services/database/Artist.hpp"
+#include "services/database/Release.hpp"
+#include "services/database/Session.hpp"
+#include "services/database/Track.hpp"
+#include "services/database/TrackRelations.hpp"
+#include "services/database/User.hpp"
+#include "responses/Album.hpp"
+#include "responses/Artist.hpp"
+#include "responses/Song.hpp"
+#include "ParameterParsing.hpp"
+#include "SubsonicId.hpp"
+
+namespace API::Subsonic
+{
+    using namespace Database;
+
+    namespace
+    {
+        constexpr std::size_t defaultSyncCount{ 500 };
+
+        // Objects are iterated by id: a page resumes right after the last returned object, whatever the library size
+        // Changes are detected using the time the tracks were last (re)scanned
+        template <typename FindParameters, typename IdType>
+        FindParameters createSyncFindParameters(const Wt::WDateTime& since, IdType cursor, std::size_t count)
+        {
+            FindParameters params;
+            params.setRange(Range{ 0, count });
+            if (since.isValid())
+                params.setAddedAfter(since);
+            if (cursor.isValid())
+                params.setAfterId(cursor);
+
+            return params;
+        }
+
+        template <typename IdType>
+        void setNextCursor(Response::Node& node, std::size_t resultCount, std::size_t count, IdType lastId)
+        {
+            // a partial page means there is nothing left
+            if (resultCount == count)
+                node.setAttribute("nextCursor", idToString(lastId));
+        }
+    }
+
+    Response handleGetLibraryChangesRequest(RequestContext& context)
+    {
+        // Mandatory params
+        const std::string type{ getMandatoryParameterAs<std::string>(context.parameters, "type") };
+
+        // Optional params
+        const std::optional<unsigned long long> since{ getParameterAs<unsigned long long>(context.parameters, "since") }; // ms since epoch
+        const std::size_t count{ getParameterAs<std::size_t>(context.parameters, "count").value_or(defaultSyncCount) };
+        if (count == 0)
+            throw BadParameterGenericError{ "count" };
+        if (count > defaultMaxCountSize)
+            throw ParameterValueTooHighGenericError{ "count", defaultMaxCountSize };
+
+        // one second overlap: better report an object twice than miss one scanned during the same second
+        const Wt::WDateTime sinceDateTime{ since ? Wt::WDateTime::fromTime_t(static_cast<std::time_t>(*since / 1000)).addSecs(-1) : Wt::WDateTime{} };
+
+        // To be used as the "since" parameter of the next sync, taken from the first page
+        const Wt::WDateTime syncDateTime{ Wt::WDateTime::currentDateTime() };
+
+        Response response{ Response::createOkResponse(context.serverProtocolVersion) };
+        Response::Node& changesNode{ response.createNode("libraryChanges") };
+        changesNode.setAttribute("syncTime", static_cast<unsigned long long>(syncDateTime.toTime_t()) * 1000);
+
+        auto transaction{ context.dbSession.createSharedTransaction() };
+
+        User::pointer user{ User::find(context.dbSession, context.userId) };
+        if (!user)
+            throw UserNotAuthorizedError{};
+
+        if (type == "artist")
+        {
+            const ArtistId cursor{ getParameterAs<ArtistId>(context.parameters, "cursor").value_or(ArtistId{}) };
+            Artist::FindParameters params{ createSyncFindParameters<Artist::FindParameters>(sinceDateTime, cursor, count) };
+            params.setSortMethod(ArtistSortMethod::Id);
+
+            const std::vector<Artist::pointer> artists{ Artist::find(context.dbSession, params).results };
+            context.starredDateTimes.load(context.userId, artists);
+            for (const Artist::pointer& artist : artists)
+                changesNode.addArrayChild("artist", createArtistNode(context, artist, user, true /* id3 */));
+
+            if (!artists.empty())
+                setNextCursor(changesNode, artists.size(), count, artists.back()->getId());
+        }
+        else if (type == "album")
+        {
+            const ReleaseId cursor{ getParameterAs<ReleaseId>(context.parameters, "cursor").value_or(ReleaseId{}) };
+            Release::FindParameters params{ createSyncFindParameters<Release::FindParameters>(sinceDateTime, cursor, count) };
+            params.setSortMethod(ReleaseSortMethod::Id);
+
+            const std::vector<Release::pointer> releases{ Release::find(context.dbSession, params).results };
+            context.starredDateTimes.load(context.userId, releases);
+            for (const Release::pointer& release : releases)
+                changesNode.addArrayChild("album", createAlbumNode(context, release, user, true /* id3 */));
+
+            if (!releases.empty())
+                setNextCursor(changesNode, releases.size(), count, releases.back()->getId());
+        }
+        else if (type == "song")
+        {
+            const TrackId cursor{ getParameterAs<TrackId>(context.parameters, "cursor").value_or(TrackId{}) };
+            Track::FindParameters params{ createSyncFindParameters<Track::FindParameters>(sinceDateTime, cursor, count) };
+            params.setSortMethod(TrackSortMethod::Id);
+
+            const std::vector<Track::pointer> tracks{ Track::find(context.dbSession, params).results };
+            const TrackRelations trackRelations{ context.dbSession, tracks };
+            context.starredDateTimes.load(context.userId, tracks);
+            for (const Track::pointer& track : tracks)
+                changesNode.addArrayChild("song", createSongNode(context, track, user, &trackRelations));
+
+            if (!tracks.empty())
+                setNextCursor(changesNode, tracks.size(), count, tracks.back()->getId());
+        }
+        else
+            throw BadParameterGenericError{ "type" };
+
+        return response;
+    }
+}
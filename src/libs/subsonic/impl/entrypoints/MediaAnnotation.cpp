@@ -36,16 +36,9 @@ namespace API::Subsonic
 
     namespace
     {
-        struct StarParameters
+        Feedback::IFeedbackService::ObjectIds getStarParameters(const Wt::Http::ParameterMap& parameters)
         {
-            std::vector<ArtistId> artistIds;
-            std::vector<ReleaseId> releaseIds;
-            std::vector<TrackId> trackIds;
-        };
-
-        StarParameters getStarParameters(const Wt::Http::ParameterMap& parameters)
-        {
-            StarParameters res;
+            Feedback::IFeedbackService::ObjectIds res;
 
             // TODO handle parameters for legacy file browsing
             res.trackIds = getMultiParametersAs<TrackId>(parameters, "id");
@@ -58,32 +51,18 @@ namespace API::Subsonic
 
     Response handleStarRequest(RequestContext& context)
     {
-        StarParameters params{ getStarParameters(context.parameters) };
-
-        for (const ArtistId id : params.artistIds)
-            Service<Feedback::IFeedbackService>::get()->star(context.userId, id);
+        const Feedback::IFeedbackService::ObjectIds params{ getStarParameters(context.parameters) };
 
-        for (const ReleaseId id : params.releaseIds)
-            Service<Feedback::IFeedbackService>::get()->star(context.userId, id);
-
-        for (const TrackId id : params.trackIds)
-            Service<Feedback::IFeedbackService>::get()->star(context.userId, id);
+        Service<Feedback::IFeedbackService>::get()->star(context.userId, params);
 
         return Response::createOkResponse(context.serverProtocolVersion);
     }
 
     Response handleUnstarRequest(RequestContext& context)
     {
-        StarParameters params{ getStarParameters(context.parameters) };
-
-        for (const ArtistId id : params.artistIds)
-            Service<Feedback::IFeedbackService>::get()->unstar(context.userId, id);
-
-        for (const ReleaseId id : params.releaseIds)
-            Service<Feedback::IFeedbackService>::get()->unstar(context.userId, id);
+        const Feedback::IFeedbackService::ObjectIds params{ getStarParameters(context.parameters) };
 
-        for (const TrackId id : params.trackIds)
-            Service<Feedback::IFeedbackService>::get()->unstar(context.userId, id);
+        Service<Feedback::IFeedbackService>::get()->unstar(context.userId, params);
 
         return Response::createOkResponse(context.serverProtocolVersion);
     }
@@ -108,6 +87,7 @@ namespace API::Subsonic
 
         if (!submission)
         {
+            Service<Scrobbling::IScrobblingService>::get()->setNowPlaying({ context.userId, ids.front() }, context.clientInfo.name);
             Service<Scrobbling::IScrobblingService>::get()->listenStarted({ context.userId, ids.front() });
         }
         else
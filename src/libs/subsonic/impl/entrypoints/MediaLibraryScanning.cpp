@@ -21,6 +21,7 @@
 
 #include "services/scanner/IScannerService.hpp"
 #include "utils/Service.hpp"
+#include "ParameterParsing.hpp"
 
 namespace API::Subsonic::Scan
 {
@@ -45,6 +46,21 @@ namespace API::Subsonic::Scan
                 statusResponse.setAttribute("count", count);
             }
 
+            // LMS specific: throughput of the last complete scan, durations in microseconds
+            if (scanStatus.lastCompleteScanStats)
+            {
+                const ScanStats& stats{ *scanStatus.lastCompleteScanStats };
+                Response::Node& perfNode{ statusResponse.createChild("lmsLastScanPerf") };
+
+                perfNode.setAttribute("filesPerSecond", stats.getScannedFilesPerSecond());
+                perfNode.setAttribute("parseMean", stats.parseDurations.getMean().count());
+                perfNode.setAttribute("parseP95", stats.parseDurations.getPercentile(95).count());
+                perfNode.setAttribute("writeMean", stats.writeDurations.getMean().count());
+                perfNode.setAttribute("writeP95", stats.writeDurations.getPercentile(95).count());
+                perfNode.setAttribute("commitMean", stats.commitDurations.getMean().count());
+                perfNode.setAttribute("commitP95", stats.commitDurations.getPercentile(95).count());
+            }
+
             return statusResponse;
         }
     }
@@ -59,7 +75,12 @@ namespace API::Subsonic::Scan
 
     Response handleStartScan(RequestContext& context)
     {
-        Service<IScannerService>::get()->requestImmediateScan(false);
+        // LMS specific: "path" parameters (absolute, or relative to the media directory) only scan the given files or directories
+        const std::vector<std::string> paths{ getMultiParametersAs<std::string>(context.parameters, "path") };
+        if (paths.empty())
+            Service<IScannerService>::get()->requestImmediateScan(false);
+        else
+            Service<IScannerService>::get()->requestImmediatePartialScan(std::vector<std::filesystem::path>(std::cbegin(paths), std::cend(paths)), false);
 
         Response response{ Response::createOkResponse(context.serverProtocolVersion) };
         response.addNode("scanStatus", createStatusResponseNode());
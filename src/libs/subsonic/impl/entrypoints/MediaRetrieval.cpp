@@ -19,6 +19,12 @@
 
 #include "MediaRetrieval.hpp"
 
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <Wt/Utils.h>
+
 #include "av/IAudioFile.hpp"
 #include "av/RawResourceHandlerCreator.hpp"
 #include "av/TranscodingParameters.hpp"
@@ -28,9 +34,12 @@
 #include "services/database/Session.hpp"
 #include "services/database/Track.hpp"
 #include "services/database/User.hpp"
+#include "services/scrobbling/IScrobblingService.hpp"
+#include "utils/IConfig.hpp"
 #include "utils/IResourceHandler.hpp"
 #include "utils/Logger.hpp"
 #include "utils/FileResourceHandlerCreator.hpp"
+#include "utils/Service.hpp"
 #include "utils/Utils.hpp"
 #include "utils/String.hpp"
 #include "ParameterParsing.hpp"
@@ -88,6 +97,49 @@ namespace API::Subsonic
             return true;
         }
 
+        // measured per user and per client, as users often have several devices
+        std::string getThroughputKey(const RequestContext& context)
+        {
+            return context.userId.toString() + "/" + context.clientInfo.name;
+        }
+
+        bool isAdaptiveBitrateEnabled()
+        {
+            static const bool enabled{ Service<IConfig>::get()->getBool("api-subsonic-adaptive-bitrate", false) };
+            return enabled;
+        }
+
+        // Highest allowed bitrate the client can sustain, given the throughput of its last transcoded stream
+        // 0 if unknown, or if the client can receive the file as is
+        std::size_t getAdaptiveBitrate(const RequestContext& context, std::size_t fileBitrate)
+        {
+            const std::optional<Av::Transcoding::ClientThroughput> clientThroughput{ Av::Transcoding::getClientThroughput(getThroughputKey(context)) };
+            if (!clientThroughput)
+                return 0;
+
+            if (clientThroughput->keptUp && clientThroughput->throughput >= fileBitrate)
+                return 0;
+
+            // keep some margin for the container overhead and the throughput variations
+            const std::size_t sustainableBitrate{ clientThroughput->throughput * 8 / 10 };
+
+            std::vector<Bitrate> allowedBitrates;
+            visitAllowedAudioBitrates([&](Bitrate bitrate) { allowedBitrates.push_back(bitrate); });
+            if (allowedBitrates.empty())
+                return 0;
+
+            std::sort(std::begin(allowedBitrates), std::end(allowedBitrates));
+            auto itBitrate{ std::upper_bound(std::cbegin(allowedBitrates), std::cend(allowedBitrates), sustainableBitrate) };
+            if (itBitrate != std::cbegin(allowedBitrates))
+                --itBitrate;
+
+            // the client received its last stream fast enough, its actual throughput may be higher: try the next bitrate up
+            if (clientThroughput->keptUp && *itBitrate < clientThroughput->throughput && std::next(itBitrate) != std::cend(allowedBitrates))
+                ++itBitrate;
+
+            return *itBitrate;
+        }
+
         struct StreamParameters
         {
             Av::Transcoding::InputParameters inputParameters;
@@ -95,11 +147,16 @@ namespace API::Subsonic
             bool estimateContentLength{};
         };
 
-        bool isOutputFormatCompatible(const std::filesystem::path& trackPath, Av::Transcoding::OutputFormat outputFormat)
+        bool isOutputFormatCompatible(const Track::pointer& track, Av::Transcoding::OutputFormat outputFormat)
         {
+            // recorded during the scan
+            if (!track->getAudioCodec().empty())
+                return isCodecCompatibleWithOutputFormat(Av::getDecodingCodec(track->getAudioCodec()), outputFormat);
+
+            // not scanned since, or codec unknown by the parser: probe the file
             try
             {
-                const auto audioFile{ Av::parseAudioFile(trackPath) };
+                const auto audioFile{ Av::parseAudioFile(track->getPath()) };
 
                 const auto streamInfo{ audioFile->getBestStreamInfo() };
                 if (!streamInfo)
@@ -123,22 +180,29 @@ namespace API::Subsonic
             std::size_t maxBitRate{ getParameterAs<std::size_t>(context.parameters, "maxBitRate").value_or(0) * 1000 }; // "If set to zero, no limit is imposed", given in kpbs
             const std::string format{ getParameterAs<std::string>(context.parameters, "format").value_or("") };
             std::size_t timeOffset{ getParameterAs<std::size_t>(context.parameters, "timeOffset").value_or(0) };
-            bool estimateContentLength{ getParameterAs<bool>(context.parameters, "estimateContentLength").value_or(false) };
+            // otherwise the transcoded stream is sent using chunked transfer encoding
+            bool estimateContentLength{ context.requireContentLength || getParameterAs<bool>(context.parameters, "estimateContentLength").value_or(false) };
 
             StreamParameters parameters;
 
             auto transaction{ context.dbSession.createSharedTransaction() };
 
-            const User::pointer user{ User::find(context.dbSession, context.userId) };
-            if (!user)
-                throw UserNotAuthorizedError{};
-
             const auto track{ Track::find(context.dbSession, id) };
             if (!track)
                 throw RequestedDataNotFoundError{};
 
+            // the client lets the server choose
+            if (maxBitRate == 0 && isAdaptiveBitrateEnabled())
+            {
+                maxBitRate = getAdaptiveBitrate(context, track->getBitrate());
+                if (maxBitRate)
+                    LMS_LOG(API_SUBSONIC, DEBUG) << "Using adaptive max bitrate = " << maxBitRate;
+            }
+
             parameters.inputParameters.trackPath = track->getPath();
             parameters.inputParameters.duration = track->getDuration();
+            parameters.inputParameters.codec = Av::getDecodingCodec(track->getAudioCodec());
+            parameters.inputParameters.bitrate = track->getBitrate();
             parameters.estimateContentLength = estimateContentLength;
 
             if (format == "raw") // raw => no transcoding
@@ -147,8 +211,8 @@ namespace API::Subsonic
             std::optional<Av::Transcoding::OutputFormat> requestedFormat{ subsonicStreamFormatToAvOutputFormat(format) };
             if (!requestedFormat)
             {
-                if (user->getSubsonicEnableTranscodingByDefault())
-                    requestedFormat = userTranscodeFormatToAvFormat(user->getSubsonicDefaultTranscodingOutputFormat());
+                if (context.userSettings->enableTranscodingByDefault)
+                    requestedFormat = userTranscodeFormatToAvFormat(context.userSettings->defaultTranscodingOutputFormat);
             }
 
             if (!requestedFormat && (maxBitRate == 0 || track->getBitrate() <= maxBitRate ))
@@ -157,24 +221,33 @@ namespace API::Subsonic
                 return parameters; // no transcoding needed
             }
 
-            // scan the file to check if its format is compatible with the actual requested format
+            // check if the file format is compatible with the actual requested format
             //  same codec => apply max bitrate
             //  otherwise => apply default bitrate (because we can't really compare bitrates between formats) + max bitrate)
             std::size_t bitrate{};
-            if (requestedFormat && isOutputFormatCompatible(track->getPath(), *requestedFormat))
+            if (requestedFormat && isOutputFormatCompatible(track, *requestedFormat))
             {
                 if (maxBitRate == 0 || track->getBitrate() <= maxBitRate)
                 {
-                    LMS_LOG(API_SUBSONIC, DEBUG) << "File's bitrate and format are compatible with parameters => no transcoding";
-                    return parameters; // no transcoding needed
+                    if (timeOffset == 0)
+                    {
+                        LMS_LOG(API_SUBSONIC, DEBUG) << "File's bitrate and format are compatible with parameters => no transcoding";
+                        return parameters; // no transcoding needed
+                    }
+
+                    // the transcoder only remuxes the audio stream from the requested offset
+                    bitrate = track->getBitrate();
+                }
+                else
+                {
+                    bitrate = maxBitRate;
                 }
-                bitrate = maxBitRate;
             }
             
             if (!requestedFormat)
-                requestedFormat = userTranscodeFormatToAvFormat(user->getSubsonicDefaultTranscodingOutputFormat());
+                requestedFormat = userTranscodeFormatToAvFormat(context.userSettings->defaultTranscodingOutputFormat);
             if (!bitrate)
-                bitrate = std::min<std::size_t>(user->getSubsonicDefaultTranscodingOutputBitrate(), maxBitRate);
+                bitrate = std::min<std::size_t>(context.userSettings->defaultTranscodingOutputBitrate, maxBitRate);
 
             Av::Transcoding::OutputParameters& outputParameters{ parameters.outputParameters.emplace() };
 
@@ -220,6 +293,15 @@ namespace API::Subsonic
             continuation->setData(resourceHandler);
     }
 
+    namespace
+    {
+        bool isStartOfFileRequested(const Wt::Http::Request& request)
+        {
+            const std::string range{ request.headerValue("Range") };
+            return range.empty() || range.rfind("bytes=0-", 0) == 0;
+        }
+    }
+
     void handleStream(RequestContext& context, const Wt::Http::Request& request, Wt::Http::Response& response)
     {
         std::shared_ptr<IResourceHandler> resourceHandler;
@@ -230,8 +312,13 @@ namespace API::Subsonic
             if (!continuation)
             {
                 StreamParameters streamParameters{ getStreamParameters(context) };
+
+                // clients that do not report the plays they start
+                if (!getParameterAs<std::size_t>(context.parameters, "timeOffset").value_or(0) && isStartOfFileRequested(request))
+                    Service<Scrobbling::IScrobblingService>::get()->setNowPlaying({ context.userId, getMandatoryParameterAs<TrackId>(context.parameters, "id") }, context.clientInfo.name);
+
                 if (streamParameters.outputParameters)
-                    resourceHandler = Av::Transcoding::createResourceHandler(streamParameters.inputParameters, *streamParameters.outputParameters, streamParameters.estimateContentLength);
+                    resourceHandler = Av::Transcoding::createResourceHandler(streamParameters.inputParameters, *streamParameters.outputParameters, streamParameters.estimateContentLength, context.userId.toString(), getThroughputKey(context));
                 else
                     resourceHandler = Av::createRawResourceHandler(streamParameters.inputParameters.trackPath);
             }
@@ -244,6 +331,144 @@ namespace API::Subsonic
             if (continuation)
                 continuation->setData(resourceHandler);
         }
+        catch (const Av::TooManyTranscodingsException& e)
+        {
+            LMS_LOG(API_SUBSONIC, WARNING) << "Cannot transcode: " << e.what();
+            throw TooManyPendingRequestsGenericError{};
+        }
+        catch (const Av::Exception& e)
+        {
+            LMS_LOG(API_SUBSONIC, ERROR) << "Caught Av exception: " << e.what();
+        }
+    }
+
+    namespace
+    {
+        std::chrono::seconds getHlsSegmentDuration()
+        {
+            static const std::chrono::seconds segmentDuration{ std::max<unsigned long>(1, Service<IConfig>::get()->getULong("api-subsonic-hls-segment-duration", 10)) };
+            return segmentDuration;
+        }
+
+        // "bitRate" may list several bitrates (in kbps) to produce a variant playlist: only the first one is used
+        std::size_t getHlsBitrate(const RequestContext& context)
+        {
+            const std::string bitrates{ getParameterAs<std::string>(context.parameters, "bitRate").value_or("") };
+            const std::vector<std::string_view> values{ StringUtils::splitString(bitrates, ",") };
+            if (values.empty() || values.front().empty())
+                return context.userSettings->defaultTranscodingOutputBitrate;
+
+            const std::optional<std::size_t> bitrate{ StringUtils::readAs<std::size_t>(values.front()) };
+            if (!bitrate || !isAudioBitrateAllowed(static_cast<Bitrate>(*bitrate * 1000)))
+                throw BadParameterGenericError{ "bitRate" };
+
+            return *bitrate * 1000;
+        }
+    }
+
+    void handleHls(RequestContext& context, const Wt::Http::Request& request, Wt::Http::Response& response)
+    {
+        // Mandatory params
+        const TrackId id{ getMandatoryParameterAs<TrackId>(context.parameters, "id") };
+
+        std::size_t bitrate;
+        std::chrono::milliseconds trackDuration;
+        {
+            auto transaction{ context.dbSession.createSharedTransaction() };
+
+            const auto track{ Track::find(context.dbSession, id) };
+            if (!track)
+                throw RequestedDataNotFoundError{};
+
+            bitrate = getHlsBitrate(context);
+            trackDuration = track->getDuration();
+        }
+
+        // segments are requested with the same authentication parameters and bitrate as the playlist
+        std::string segmentQuery;
+        for (const auto& [name, values] : request.getParameterMap())
+        {
+            if (values.empty() || name == "bitRate" || name == "index")
+                continue;
+
+            segmentQuery += Wt::Utils::urlEncode(name) + "=" + Wt::Utils::urlEncode(values.front()) + "&";
+        }
+        segmentQuery += "bitRate=" + std::to_string(bitrate / 1000);
+
+        const std::chrono::milliseconds segmentDuration{ getHlsSegmentDuration() };
+
+        std::ostringstream playlist;
+        playlist << "#EXTM3U\n";
+        playlist << "#EXT-X-VERSION:3\n";
+        playlist << "#EXT-X-TARGETDURATION:" << std::chrono::duration_cast<std::chrono::seconds>(segmentDuration).count() << "\n";
+        playlist << "#EXT-X-MEDIA-SEQUENCE:0\n";
+        playlist << "#EXT-X-PLAYLIST-TYPE:VOD\n";
+
+        std::size_t index{};
+        for (std::chrono::milliseconds offset{ 0 }; offset < trackDuration; offset += segmentDuration, ++index)
+        {
+            const std::chrono::milliseconds duration{ std::min(segmentDuration, trackDuration - offset) };
+
+            playlist << "#EXTINF:" << std::fixed << std::setprecision(3) << (duration.count() / 1000.) << ",\n";
+            playlist << "hlsSegment.view?" << segmentQuery << "&index=" << index << "\n";
+        }
+        playlist << "#EXT-X-ENDLIST\n";
+
+        response.setMimeType("application/vnd.apple.mpegurl");
+        response.out() << playlist.str();
+    }
+
+    void handleHlsSegment(RequestContext& context, const Wt::Http::Request& request, Wt::Http::Response& response)
+    {
+        std::shared_ptr<IResourceHandler> resourceHandler;
+
+        try
+        {
+            Wt::Http::ResponseContinuation* continuation = request.continuation();
+            if (!continuation)
+            {
+                // Mandatory params
+                const TrackId id{ getMandatoryParameterAs<TrackId>(context.parameters, "id") };
+                const std::size_t index{ getMandatoryParameterAs<std::size_t>(context.parameters, "index") };
+
+                Av::Transcoding::InputParameters inputParameters;
+                Av::Transcoding::OutputParameters outputParameters;
+                {
+                    auto transaction{ context.dbSession.createSharedTransaction() };
+
+                    const auto track{ Track::find(context.dbSession, id) };
+                    if (!track)
+                        throw RequestedDataNotFoundError{};
+
+                    inputParameters.trackPath = track->getPath();
+                    inputParameters.duration = track->getDuration();
+
+                    outputParameters.format = Av::Transcoding::OutputFormat::MP3; // HLS packed audio
+                    outputParameters.bitrate = getHlsBitrate(context);
+                }
+
+                outputParameters.offset = index * std::chrono::milliseconds{ getHlsSegmentDuration() };
+                outputParameters.duration = getHlsSegmentDuration();
+                if (outputParameters.offset >= inputParameters.duration)
+                    throw RequestedDataNotFoundError{};
+
+                // segments are cached (if enabled) and shared between listeners
+                resourceHandler = Av::Transcoding::createResourceHandler(inputParameters, outputParameters, false /* estimate content length */, context.userId.toString());
+            }
+            else
+            {
+                resourceHandler = Wt::cpp17::any_cast<std::shared_ptr<IResourceHandler>>(continuation->data());
+            }
+
+            continuation = resourceHandler->processRequest(request, response);
+            if (continuation)
+                continuation->setData(resourceHandler);
+        }
+        catch (const Av::TooManyTranscodingsException& e)
+        {
+            LMS_LOG(API_SUBSONIC, WARNING) << "Cannot transcode: " << e.what();
+            throw TooManyPendingRequestsGenericError{};
+        }
         catch (const Av::Exception& e)
         {
             LMS_LOG(API_SUBSONIC, ERROR) << "Caught Av exception: " << e.what();
@@ -263,11 +488,13 @@ namespace API::Subsonic
         std::size_t size{ getParameterAs<std::size_t>(context.parameters, "size").value_or(1024) };
         size = ::Utils::clamp(size, std::size_t{ 32 }, std::size_t{ 2048 });
 
+        const Image::EncodingFormat format{ context.enableWebPCover ? Image::EncodingFormat::WebP : Image::EncodingFormat::JPEG };
+
         std::shared_ptr<Image::IEncodedImage> cover;
         if (trackId)
-            cover = Service<Cover::ICoverService>::get()->getFromTrack(*trackId, size);
+            cover = Service<Cover::ICoverService>::get()->getFromTrack(*trackId, size, format);
         else if (releaseId)
-            cover = Service<Cover::ICoverService>::get()->getFromRelease(*releaseId, size);
+            cover = Service<Cover::ICoverService>::get()->getFromRelease(*releaseId, size, format);
         else if (artistId)
         {
             // TODO handle a placeholder for artists
@@ -276,7 +503,7 @@ namespace API::Subsonic
         }
 
         if (!cover && context.enableDefaultCover)
-            cover = Service<Cover::ICoverService>::get()->getDefault(size);
+            cover = Service<Cover::ICoverService>::get()->getDefault(size, format);
 
         if (!cover)
         {
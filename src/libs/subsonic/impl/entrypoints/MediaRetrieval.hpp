@@ -28,6 +28,8 @@ namespace API::Subsonic
 {
     void handleDownload(RequestContext& context, const Wt::Http::Request& request, Wt::Http::Response& response);
     void handleStream(RequestContext& context, const Wt::Http::Request& request, Wt::Http::Response& response);
+    void handleHls(RequestContext& context, const Wt::Http::Request& request, Wt::Http::Response& response);
+    void handleHlsSegment(RequestContext& context, const Wt::Http::Request& request, Wt::Http::Response& response); // not part of the API, referenced by the HLS playlists
     void handleGetCoverArt(RequestContext& context, const Wt::Http::Request& request, Wt::Http::Response& response);
 }
 
@@ -22,6 +22,7 @@
 #include "services/database/Session.hpp"
 #include "services/database/Track.hpp"
 #include "services/database/TrackList.hpp"
+#include "services/database/TrackRelations.hpp"
 #include "services/database/User.hpp"
 #include "responses/Playlist.hpp"
 #include "responses/Song.hpp"
@@ -43,12 +44,10 @@ namespace API::Subsonic
         params.setUser(context.userId);
         params.setType(TrackListType::Playlist);
 
-        auto tracklistIds{ TrackList::find(context.dbSession, params) };
-        for (const TrackListId trackListId : tracklistIds.results)
-        {
-            const TrackList::pointer trackList{ TrackList::find(context.dbSession, trackListId) };
-            playlistsNode.addArrayChild("playlist", createPlaylistNode(trackList, context.dbSession));
-        }
+        TrackList::find(context.dbSession, params, [&](const TrackList::pointer& trackList, const TrackList::Stats& stats)
+            {
+                playlistsNode.addArrayChild("playlist", createPlaylistNode(trackList, stats, context.dbSession));
+            });
 
         return response;
     }
@@ -71,9 +70,20 @@ namespace API::Subsonic
         Response response{ Response::createOkResponse(context.serverProtocolVersion) };
         Response::Node playlistNode{ createPlaylistNode(tracklist, context.dbSession) };
 
-        auto entries{ tracklist->getEntries() };
-        for (const TrackListEntry::pointer& entry : entries)
-            playlistNode.addArrayChild("entry", createSongNode(context, entry->getTrack(), user));
+        // Entries are loaded by pages, along with their tracks and relations, so that the database objects of only one page are kept at once
+        constexpr std::size_t entryPageSize{ 500 };
+        tracklist->visitEntriesWithTracks(entryPageSize, [&](const TrackList::EntriesWithTracksPage& entries)
+            {
+                std::vector<Track::pointer> tracks;
+                tracks.reserve(entries.size());
+                for (const auto& [entry, track] : entries)
+                    tracks.push_back(track);
+
+                const TrackRelations trackRelations{ context.dbSession, tracks };
+                context.starredDateTimes.load(context.userId, tracks);
+                for (const Track::pointer& track : tracks)
+                    playlistNode.addArrayChild("entry", createSongNode(context, track, user, &trackRelations));
+            });
 
         response.addNode("playlist", std::move(playlistNode));
 
@@ -86,7 +96,7 @@ namespace API::Subsonic
         const auto id{ getParameterAs<TrackListId>(context.parameters, "playlistId") };
         auto name{ getParameterAs<std::string>(context.parameters, "name") };
 
-        std::vector<TrackId> trackIds{ getMultiParametersAs<TrackId>(context.parameters, "songId") };
+        const std::vector<TrackId> trackIds{ getMultiParametersAs<TrackId>(context.parameters, "songId") };
 
         if (!name && !id)
             throw RequiredParameterMissingError{ "name or id" };
@@ -116,14 +126,9 @@ namespace API::Subsonic
             tracklist = context.dbSession.create<TrackList>(*name, TrackListType::Playlist, false, user);
         }
 
-        for (const TrackId trackId : trackIds)
-        {
-            Track::pointer track{ Track::find(context.dbSession, trackId) };
-            if (!track)
-                continue;
-
-            context.dbSession.create<TrackListEntry>(track, tracklist);
-        }
+        // unknown tracks are skipped
+        if (!trackIds.empty())
+            tracklist.modify()->addTracks(trackIds);
 
         return Response::createOkResponse(context.serverProtocolVersion);
     }
@@ -137,8 +142,8 @@ namespace API::Subsonic
         auto name{ getParameterAs<std::string>(context.parameters, "name") };
         auto isPublic{ getParameterAs<bool>(context.parameters, "public") };
 
-        std::vector<TrackId> trackIdsToAdd{ getMultiParametersAs<TrackId>(context.parameters, "songIdToAdd") };
-        std::vector<std::size_t> trackPositionsToRemove{ getMultiParametersAs<std::size_t>(context.parameters, "songIndexToRemove") };
+        const std::vector<TrackId> trackIdsToAdd{ getMultiParametersAs<TrackId>(context.parameters, "songIdToAdd") };
+        const std::vector<std::size_t> trackPositionsToRemove{ getMultiParametersAs<std::size_t>(context.parameters, "songIndexToRemove") };
 
         auto transaction{ context.dbSession.createUniqueTransaction() };
 
@@ -160,27 +165,13 @@ namespace API::Subsonic
         if (isPublic)
             tracklist.modify()->setIsPublic(*isPublic);
 
-        {
-            // Remove from end to make indexes stable
-            std::sort(std::begin(trackPositionsToRemove), std::end(trackPositionsToRemove), std::greater<std::size_t>());
-
-            for (std::size_t trackPositionToRemove : trackPositionsToRemove)
-            {
-                auto entry{ tracklist->getEntry(trackPositionToRemove) };
-                if (entry)
-                    entry.remove();
-            }
-        }
-
-        // Add tracks
-        for (const TrackId trackIdToAdd : trackIdsToAdd)
-        {
-            Track::pointer track{ Track::find(context.dbSession, trackIdToAdd) };
-            if (!track)
-                continue;
+        // Indexes refer to the playlist before any removal
+        if (!trackPositionsToRemove.empty())
+            tracklist.modify()->removeEntries(trackPositionsToRemove);
 
-            context.dbSession.create<TrackListEntry>(track, tracklist);
-        }
+        // Add tracks, unknown tracks are skipped
+        if (!trackIdsToAdd.empty())
+            tracklist.modify()->addTracks(trackIdsToAdd);
 
         return Response::createOkResponse(context.serverProtocolVersion);
     }
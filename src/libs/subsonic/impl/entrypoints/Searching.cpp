@@ -19,10 +19,16 @@
 
 #include "Searching.hpp"
 
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <optional>
+
 #include "services/database/Artist.hpp"
 #include "services/database/Release.hpp"
 #include "services/database/Session.hpp"
 #include "services/database/Track.hpp"
+#include "services/database/TrackRelations.hpp"
 #include "services/database/User.hpp"
 #include "responses/Album.hpp"
 #include "responses/Artist.hpp"
@@ -37,6 +43,67 @@ namespace API::Subsonic
 
     namespace
     {
+        // Clients syncing the whole library page through the search results using increasing offsets
+        // Remember where the last returned page ended, to seek (on id) to the next page instead of skipping all the previous ones
+        template <typename IdType>
+        class SearchCursorCache
+        {
+        public:
+            std::optional<IdType> find(UserId userId, std::string_view query, std::size_t offset)
+            {
+                std::scoped_lock lock{ _mutex };
+
+                for (const Cursor& cursor : _cursors)
+                {
+                    if (cursor.userId == userId && cursor.query == query && cursor.nextOffset == offset)
+                        return cursor.lastId;
+                }
+
+                return std::nullopt;
+            }
+
+            void set(UserId userId, std::string_view query, std::size_t nextOffset, IdType lastId)
+            {
+                std::scoped_lock lock{ _mutex };
+
+                auto itCursor{ std::find_if(std::begin(_cursors), std::end(_cursors), [&](const Cursor& cursor) { return cursor.userId == userId && cursor.query == query; }) };
+                if (itCursor != std::end(_cursors))
+                    _cursors.erase(itCursor);
+
+                _cursors.push_front(Cursor{ userId, std::string{ query }, nextOffset, lastId });
+                if (_cursors.size() > maxCursorCount)
+                    _cursors.pop_back();
+            }
+
+        private:
+            static constexpr std::size_t maxCursorCount{ 32 };
+
+            struct Cursor
+            {
+                UserId userId;
+                std::string query;
+                std::size_t nextOffset;
+                IdType lastId;
+            };
+
+            std::mutex _mutex;
+            std::deque<Cursor> _cursors; // most recent first
+        };
+
+        SearchCursorCache<ArtistId> artistCursors;
+        SearchCursorCache<ReleaseId> releaseCursors;
+        SearchCursorCache<TrackId> trackCursors;
+
+        // Results are sorted by id so that pages can be resumed using the last returned id
+        template <typename FindParameters, typename IdType>
+        void applySearchRange(FindParameters& params, SearchCursorCache<IdType>& cursors, UserId userId, std::string_view query, std::size_t offset, std::size_t count)
+        {
+            if (const std::optional<IdType> lastId{ cursors.find(userId, query, offset) })
+                params.setAfterId(*lastId).setRange(Range{ 0, count });
+            else
+                params.setRange(Range{ offset, count });
+        }
+
         Response handleSearchRequestCommon(RequestContext& context, bool id3)
         {
             // Mandatory params
@@ -77,36 +144,57 @@ namespace API::Subsonic
             {
                 Artist::FindParameters params;
                 params.setKeywords(keywords);
-                params.setRange(Range{ artistOffset, artistCount });
+                params.setSortMethod(ArtistSortMethod::Id);
+                applySearchRange(params, artistCursors, context.userId, query, artistOffset, artistCount);
 
+                ArtistId lastArtistId;
+                std::size_t artistResultCount{};
                 Artist::find(context.dbSession, params, [&](const Artist::pointer& artist)
                     {
                         searchResult2Node.addArrayChild("artist", createArtistNode(context, artist, user, id3));
+                        lastArtistId = artist->getId();
+                        artistResultCount++;
                     });
+
+                if (artistResultCount == artistCount)
+                    artistCursors.set(context.userId, query, artistOffset + artistResultCount, lastArtistId);
             }
 
             if (albumCount > 0)
             {
                 Release::FindParameters params;
                 params.setKeywords(keywords);
-                params.setRange(Range{ albumOffset, albumCount });
+                params.setSortMethod(ReleaseSortMethod::Id);
+                applySearchRange(params, releaseCursors, context.userId, query, albumOffset, albumCount);
 
+                ReleaseId lastReleaseId;
+                std::size_t releaseResultCount{};
                 Release::find(context.dbSession, params, [&](const Release::pointer& release)
                     {
                         searchResult2Node.addArrayChild("album", createAlbumNode(context, release, user, id3));
+                        lastReleaseId = release->getId();
+                        releaseResultCount++;
                     });
+
+                if (releaseResultCount == albumCount)
+                    releaseCursors.set(context.userId, query, albumOffset + releaseResultCount, lastReleaseId);
             }
 
             if (songCount > 0)
             {
                 Track::FindParameters params;
                 params.setKeywords(keywords);
-                params.setRange(Range{ songOffset, songCount });
+                params.setSortMethod(TrackSortMethod::Id);
+                applySearchRange(params, trackCursors, context.userId, query, songOffset, songCount);
 
-                Track::find(context.dbSession, params, [&](const Track::pointer& track)
-                    {
-                        searchResult2Node.addArrayChild("song", createSongNode(context, track, user));
-                    });
+                const std::vector<Track::pointer> tracks{ Track::find(context.dbSession, params).results };
+                const TrackRelations trackRelations{ context.dbSession, tracks };
+                context.starredDateTimes.load(context.userId, tracks);
+                for (const Track::pointer& track : tracks)
+                    searchResult2Node.addArrayChild("song", createSongNode(context, track, user, &trackRelations));
+
+                if (!tracks.empty() && tracks.size() == songCount)
+                    trackCursors.set(context.userId, query, songOffset + tracks.size(), tracks.back()->getId());
             }
 
             return response;
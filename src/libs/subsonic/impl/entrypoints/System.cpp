@@ -29,6 +29,12 @@ namespace API::Subsonic
             transcodeOffsetNode.addArrayValue("versions", 1);
         }
 
+        {
+            Response::Node& librarySyncNode{ response.createArrayNode("openSubsonicExtensions") };
+            librarySyncNode.setAttribute("name", "librarySync");
+            librarySyncNode.addArrayValue("versions", 1);
+        }
+
         return response;
     };
 }
@@ -24,7 +24,6 @@
 #include "services/database/Listen.hpp"
 #include "services/database/Release.hpp"
 #include "services/database/User.hpp"
-#include "services/feedback/IFeedbackService.hpp"
 #include "services/scrobbling/IScrobblingService.hpp"
 #include "utils/Service.hpp"
 #include "utils/String.hpp"
@@ -32,6 +31,7 @@
 #include "responses/Artist.hpp"
 #include "responses/DiscTitle.hpp"
 #include "responses/ItemGenre.hpp"
+#include "FragmentCache.hpp"
 #include "SubsonicId.hpp"
 
 namespace API::Subsonic
@@ -73,143 +73,156 @@ namespace API::Subsonic
 
             return "unknown";
         }
-    }
 
-    Response::Node createAlbumNode(RequestContext& context, const Release::pointer& release, const User::pointer& user, bool id3)
-    {
-        Response::Node albumNode;
-
-        if (id3) {
-            albumNode.setAttribute("name", release->getName());
-            albumNode.setAttribute("songCount", release->getTracksCount());
-            albumNode.setAttribute(
-                "duration", std::chrono::duration_cast<std::chrono::seconds>(
-                    release->getDuration())
-                .count());
-        }
-        else
+        // Everything but the user specific fields
+        Response::Node createAlbumFragmentNode(RequestContext& context, const Release::pointer& release, bool id3)
         {
-            albumNode.setAttribute("title", release->getName());
-            albumNode.setAttribute("isDir", true);
-        }
+            Response::Node albumNode;
+
+            if (id3) {
+                albumNode.setAttribute("name", release->getName());
+                albumNode.setAttribute("songCount", release->getTracksCount());
+                albumNode.setAttribute(
+                    "duration", std::chrono::duration_cast<std::chrono::seconds>(
+                        release->getDuration())
+                    .count());
+            }
+            else
+            {
+                albumNode.setAttribute("title", release->getName());
+                albumNode.setAttribute("isDir", true);
+            }
 
-        albumNode.setAttribute("created", StringUtils::toISO8601String(release->getLastWritten()));
-        albumNode.setAttribute("id", idToString(release->getId()));
-        albumNode.setAttribute("coverArt", idToString(release->getId()));
-        if (const Wt::WDate releaseDate{ release->getReleaseDate() }; releaseDate.isValid())
-            albumNode.setAttribute("year", releaseDate.year());
+            albumNode.setAttribute("created", StringUtils::toISO8601String(release->getLastWritten()));
+            albumNode.setAttribute("id", idToString(release->getId()));
+            albumNode.setAttribute("coverArt", idToString(release->getId()));
+            if (const std::optional<int> year{ release->getMinYear() }; year && year == release->getMaxYear())
+                albumNode.setAttribute("year", *year);
 
-        auto artists{ release->getReleaseArtists() };
-        if (artists.empty())
-            artists = release->getArtists();
+            auto artists{ release->getReleaseArtists() };
+            if (artists.empty())
+                artists = release->getArtists();
 
-        if (artists.empty() && !id3)
-        {
-            albumNode.setAttribute("parent", idToString(RootId{}));
-        }
-        else if (!artists.empty())
-        {
-            if (!release->getArtistDisplayName().empty())
-                albumNode.setAttribute("artist", release->getArtistDisplayName());
-            else
-                albumNode.setAttribute("artist", Utils::joinArtistNames(artists));
-
-            if (artists.size() == 1)
+            if (artists.empty() && !id3)
             {
-                albumNode.setAttribute(id3 ? Response::Node::Key{ "artistId" } : Response::Node::Key{ "parent" }, idToString(artists.front()->getId()));
+                albumNode.setAttribute("parent", idToString(RootId{}));
             }
-            else
+            else if (!artists.empty())
             {
-                if (!id3)
-                    albumNode.setAttribute("parent", idToString(RootId{}));
+                if (!release->getArtistDisplayName().empty())
+                    albumNode.setAttribute("artist", release->getArtistDisplayName());
+                else
+                    albumNode.setAttribute("artist", Utils::joinArtistNames(artists));
+
+                if (artists.size() == 1)
+                {
+                    albumNode.setAttribute(id3 ? Response::Node::Key{ "artistId" } : Response::Node::Key{ "parent" }, idToString(artists.front()->getId()));
+                }
+                else
+                {
+                    if (!id3)
+                        albumNode.setAttribute("parent", idToString(RootId{}));
+                }
             }
-        }
 
-        albumNode.setAttribute("playCount", Listen::getCount(context.dbSession, user->getId(), user->getScrobblingBackend(), release->getId()));
+            // Report the first GENRE for this track
+            const ClusterType::pointer genreClusterType{ ClusterType::find(context.dbSession, "GENRE") };
+            if (genreClusterType)
+            {
+                auto clusters{ release->getClusterGroups({genreClusterType}, 1) };
+                if (!clusters.empty() && !clusters.front().empty())
+                    albumNode.setAttribute("genre", clusters.front().front()->getName());
+            }
 
-        // Report the first GENRE for this track
-        const ClusterType::pointer genreClusterType{ ClusterType::find(context.dbSession, "GENRE") };
-        if (genreClusterType)
-        {
-            auto clusters{ release->getClusterGroups({genreClusterType}, 1) };
-            if (!clusters.empty() && !clusters.front().empty())
-                albumNode.setAttribute("genre", clusters.front().front()->getName());
-        }
+            if (!context.enableOpenSubsonic)
+                return albumNode;
 
-        if (const Wt::WDateTime dateTime{ Service<Feedback::IFeedbackService>::get()->getStarredDateTime(user->getId(), release->getId()) }; dateTime.isValid())
-            albumNode.setAttribute("starred", StringUtils::toISO8601String(dateTime));
+            // OpenSubsonic specific fields (must always be set)
+            if (!id3)
+                albumNode.setAttribute("mediaType", "album");
 
-        if (!context.enableOpenSubsonic)
-            return albumNode;
+            {
+                std::optional<UUID> mbid{ release->getMBID() };
+                albumNode.setAttribute("musicBrainzId", mbid ? mbid->getAsString() : "");
+            }
 
-        // OpenSubsonic specific fields (must always be set)
-        if (!id3)
-            albumNode.setAttribute("mediaType", "album");
+            auto addClusters{ [&](Response::Node::Key field, std::string_view clusterTypeName)
+            {
+                albumNode.createEmptyArrayValue(field);
 
-        {
-            const Wt::WDateTime dateTime{ Service<Scrobbling::IScrobblingService>::get()->getLastListenDateTime(user->getId(), release->getId()) };
-            albumNode.setAttribute("played", dateTime.isValid() ? StringUtils::toISO8601String(dateTime) : std::string{ "" });
-        }
+                ClusterType::pointer clusterType{ ClusterType::find(context.dbSession, clusterTypeName) };
+                if (clusterType)
+                {
+                    Cluster::FindParameters params;
+                    params.setRelease(release->getId());
+                    params.setClusterType(clusterType->getId());
 
-        {
-            std::optional<UUID> mbid{ release->getMBID() };
-            albumNode.setAttribute("musicBrainzId", mbid ? mbid->getAsString() : "");
-        }
+                    for (const auto& cluster : Cluster::find(context.dbSession, params).results)
+                        albumNode.addArrayValue(field, cluster->getName());
+                }
+            } };
 
-        auto addClusters{ [&](Response::Node::Key field, std::string_view clusterTypeName)
-        {
-            albumNode.createEmptyArrayValue(field);
+            addClusters("moods", "MOOD");
 
-            ClusterType::pointer clusterType{ ClusterType::find(context.dbSession, clusterTypeName) };
-            if (clusterType)
+            // Genres
+            albumNode.createEmptyArrayChild("genres");
+            if (genreClusterType)
             {
                 Cluster::FindParameters params;
                 params.setRelease(release->getId());
-                params.setClusterType(clusterType->getId());
+                params.setClusterType(genreClusterType->getId());
 
                 for (const auto& cluster : Cluster::find(context.dbSession, params).results)
-                    albumNode.addArrayValue(field, cluster->getName());
+                    albumNode.addArrayChild("genres", createItemGenreNode(cluster->getName()));
             }
-        } };
 
-        addClusters("moods", "MOOD");
+            albumNode.createEmptyArrayChild("artists");
+            for (const Artist::pointer& artist : release->getReleaseArtists())
+                albumNode.addArrayChild("artists", createArtistNode(artist));
 
-        // Genres
-        albumNode.createEmptyArrayChild("genres");
-        if (genreClusterType)
-        {
-            Cluster::FindParameters params;
-            params.setRelease(release->getId());
-            params.setClusterType(genreClusterType->getId());
+            albumNode.setAttribute("displayArtist", release->getArtistDisplayName());
 
-            for (const auto& cluster : Cluster::find(context.dbSession, params).results)
-                albumNode.addArrayChild("genres", createItemGenreNode(cluster->getName()));
-        }
+            {
+                const Wt::WDate originalReleaseDate{ release->getOriginalReleaseDate() };
+                albumNode.setAttribute("originalReleaseDate", originalReleaseDate.isValid() ? StringUtils::toISO8601String(originalReleaseDate) : "");
+            }
 
-        albumNode.createEmptyArrayChild("artists");
-        for (const Artist::pointer& artist : release->getReleaseArtists())
-            albumNode.addArrayChild("artists", createArtistNode(artist));
+            albumNode.setAttribute("isCompilation", release->getSecondaryTypes().contains(ReleaseTypeSecondary::Compilation));
+            albumNode.createEmptyArrayValue("releaseTypes");
+            if (auto releaseType{ release->getPrimaryType() })
+                albumNode.addArrayValue("releaseTypes", toString(*releaseType));
+            for (const ReleaseTypeSecondary releaseType : release->getSecondaryTypes())
+                albumNode.addArrayValue("releaseTypes", toString(releaseType));
 
-        albumNode.setAttribute("displayArtist", release->getArtistDisplayName());
+            // disc titles
+            albumNode.createEmptyArrayChild("discTitles");
+            for (const DiscInfo& discInfo : release->getDiscs())
+            {
+                if (!discInfo.name.empty())
+                    albumNode.addArrayChild("discTitles", createDiscTitle(discInfo));
+            }
 
-        {
-            const Wt::WDate originalReleaseDate{ release->getOriginalReleaseDate() };
-            albumNode.setAttribute("originalReleaseDate", originalReleaseDate.isValid() ? StringUtils::toISO8601String(originalReleaseDate) : "");
+            return albumNode;
         }
+    }
+
+    Response::Node createAlbumNode(RequestContext& context, const Release::pointer& release, const User::pointer& user, bool id3)
+    {
+        Response::Node albumNode;
 
-        albumNode.setAttribute("isCompilation", release->getSecondaryTypes().contains(ReleaseTypeSecondary::Compilation));
-        albumNode.createEmptyArrayValue("releaseTypes");
-        if (auto releaseType{ release->getPrimaryType() })
-            albumNode.addArrayValue("releaseTypes", toString(*releaseType));
-        for (const ReleaseTypeSecondary releaseType : release->getSecondaryTypes())
-            albumNode.addArrayValue("releaseTypes", toString(releaseType));
+        const FragmentCache::Key fragmentKey{ FragmentCache::EntityType::Album, release->getId().getValue(), context.libraryGeneration.getLibraryGeneration(), context.responseFormat, id3, context.enableOpenSubsonic };
+        albumNode.setFragment(context.fragmentCache.getOrCreate(fragmentKey, [&] { return createAlbumFragmentNode(context, release, id3); }));
 
-        // disc titles
-        albumNode.createEmptyArrayChild("discTitles");
-        for (const DiscInfo& discInfo : release->getDiscs())
+        albumNode.setAttribute("playCount", Listen::getCount(context.dbSession, user->getId(), context.userSettings->scrobblingBackend, release->getId()));
+
+        if (const Wt::WDateTime dateTime{ context.starredDateTimes.get(user->getId(), release->getId()) }; dateTime.isValid())
+            albumNode.setAttribute("starred", StringUtils::toISO8601String(dateTime));
+
+        // OpenSubsonic specific fields (must always be set)
+        if (context.enableOpenSubsonic)
         {
-            if (!discInfo.name.empty())
-                albumNode.addArrayChild("discTitles", createDiscTitle(discInfo));
+            const Wt::WDateTime dateTime{ Service<Scrobbling::IScrobblingService>::get()->getLastListenDateTime(user->getId(), release->getId()) };
+            albumNode.setAttribute("played", dateTime.isValid() ? StringUtils::toISO8601String(dateTime) : std::string{ "" });
         }
 
         return albumNode;
@@ -23,10 +23,9 @@
 #include "services/database/Release.hpp"
 #include "services/database/TrackArtistLink.hpp"
 #include "services/database/User.hpp"
-#include "services/feedback/IFeedbackService.hpp"
-#include "utils/Service.hpp"
 #include "utils/String.hpp"
 
+#include "FragmentCache.hpp"
 #include "SubsonicId.hpp"
 
 namespace API::Subsonic
@@ -73,41 +72,55 @@ namespace API::Subsonic
         }
     }
 
-    Response::Node createArtistNode(RequestContext& context, const Artist::pointer& artist, const User::pointer& user, bool id3)
+    namespace
     {
-        Response::Node artistNode{ createArtistNode(artist) };
-
-        artistNode.setAttribute("id", idToString(artist->getId()));
-        artistNode.setAttribute("name", artist->getName());
-
-        if (id3)
+        // Everything but the user specific fields
+        Response::Node createArtistFragmentNode(RequestContext& context, const Artist::pointer& artist, bool id3)
         {
-            const auto releases{ Release::find(context.dbSession, Release::FindParameters {}.setArtist(artist->getId())) };
-            artistNode.setAttribute("albumCount", releases.results.size());
-        }
+            Response::Node artistNode{ createArtistNode(artist) };
 
-        if (const Wt::WDateTime dateTime{ Service<Feedback::IFeedbackService>::get()->getStarredDateTime(user->getId(), artist->getId()) }; dateTime.isValid())
-            artistNode.setAttribute("starred", StringUtils::toISO8601String(dateTime));
-
-        // OpenSubsonic specific fields (must always be set)
-        if (context.enableOpenSubsonic)
-        {
-            if (!id3)
-                artistNode.setAttribute("mediaType", "artist");
+            artistNode.setAttribute("id", idToString(artist->getId()));
+            artistNode.setAttribute("name", artist->getName());
 
+            if (id3)
             {
-                std::optional<UUID> mbid{ artist->getMBID() };
-                artistNode.setAttribute("musicBrainzId", mbid ? mbid->getAsString() : "");
+                const auto releases{ Release::find(context.dbSession, Release::FindParameters {}.setArtist(artist->getId())) };
+                artistNode.setAttribute("albumCount", releases.results.size());
             }
 
-            artistNode.setAttribute("sortName", artist->getSortName());
+            // OpenSubsonic specific fields (must always be set)
+            if (context.enableOpenSubsonic)
+            {
+                if (!id3)
+                    artistNode.setAttribute("mediaType", "artist");
+
+                {
+                    std::optional<UUID> mbid{ artist->getMBID() };
+                    artistNode.setAttribute("musicBrainzId", mbid ? mbid->getAsString() : "");
+                }
 
-            // roles
-            Response::Node roles;
-            artistNode.createEmptyArrayValue("roles");
-            for (const TrackArtistLinkType linkType : TrackArtistLink::findUsedTypes(context.dbSession, artist->getId()))
-                artistNode.addArrayValue("roles", Utils::toString(linkType));
+                artistNode.setAttribute("sortName", artist->getSortName());
+
+                // roles
+                Response::Node roles;
+                artistNode.createEmptyArrayValue("roles");
+                for (const TrackArtistLinkType linkType : TrackArtistLink::findUsedTypes(context.dbSession, artist->getId()))
+                    artistNode.addArrayValue("roles", Utils::toString(linkType));
+            }
+
+            return artistNode;
         }
+    }
+
+    Response::Node createArtistNode(RequestContext& context, const Artist::pointer& artist, const User::pointer& user, bool id3)
+    {
+        Response::Node artistNode;
+
+        const FragmentCache::Key fragmentKey{ FragmentCache::EntityType::Artist, artist->getId().getValue(), context.libraryGeneration.getLibraryGeneration(), context.responseFormat, id3, context.enableOpenSubsonic };
+        artistNode.setFragment(context.fragmentCache.getOrCreate(fragmentKey, [&] { return createArtistFragmentNode(context, artist, id3); }));
+
+        if (const Wt::WDateTime dateTime{ context.starredDateTimes.get(user->getId(), artist->getId()) }; dateTime.isValid())
+            artistNode.setAttribute("starred", StringUtils::toISO8601String(dateTime));
 
         return artistNode;
     }
@@ -29,14 +29,19 @@ namespace API::Subsonic
 
     static const std::string_view reportedDummyDate{ "2000-01-01T00:00:00" };
 
-    Response::Node createPlaylistNode(const TrackList::pointer& tracklist, Session&)
+    Response::Node createPlaylistNode(const TrackList::pointer& tracklist, Session& session)
+    {
+        return createPlaylistNode(tracklist, tracklist->getStats(), session);
+    }
+
+    Response::Node createPlaylistNode(const TrackList::pointer& tracklist, const TrackList::Stats& stats, Session&)
     {
         Response::Node playlistNode;
 
         playlistNode.setAttribute("id", idToString(tracklist->getId()));
         playlistNode.setAttribute("name", tracklist->getName());
-        playlistNode.setAttribute("songCount", tracklist->getCount());
-        playlistNode.setAttribute("duration", std::chrono::duration_cast<std::chrono::seconds>(tracklist->getDuration()).count());
+        playlistNode.setAttribute("songCount", stats.entryCount);
+        playlistNode.setAttribute("duration", std::chrono::duration_cast<std::chrono::seconds>(stats.duration).count());
         playlistNode.setAttribute("public", tracklist->isPublic());
         playlistNode.setAttribute("created", reportedDummyDate);
         playlistNode.setAttribute("owner", tracklist->getUser()->getLoginName());
@@ -20,15 +20,17 @@
 #pragma once
 
 #include "services/database/Object.hpp"
+#include "services/database/TrackList.hpp"
 #include "SubsonicResponse.hpp"
 
 namespace Database
 {
-    class TrackList;
     class Session;
 }
 
 namespace API::Subsonic
 {
     Response::Node createPlaylistNode(const Database::ObjectPtr<Database::TrackList>& tracklist, Database::Session& session);
+    // stats already loaded along with the tracklist
+    Response::Node createPlaylistNode(const Database::ObjectPtr<Database::TrackList>& tracklist, const Database::TrackList::Stats& stats, Database::Session& session);
 }
\ No newline at end of file
@@ -19,7 +19,10 @@
 
 #include "responses/Song.hpp"
 
+#include <cassert>
+#include <optional>
 #include <string_view>
+#include <vector>
 
 #include "av/IAudioFile.hpp"
 #include "services/database/Artist.hpp"
@@ -28,8 +31,8 @@
 #include "services/database/Release.hpp"
 #include "services/database/Track.hpp"
 #include "services/database/TrackArtistLink.hpp"
+#include "services/database/TrackRelations.hpp"
 #include "services/database/User.hpp"
-#include "services/feedback/IFeedbackService.hpp"
 #include "services/scrobbling/IScrobblingService.hpp"
 #include "utils/Service.hpp"
 #include "utils/String.hpp"
@@ -37,6 +40,7 @@
 #include "responses/Contributor.hpp"
 #include "responses/ItemGenre.hpp"
 #include "responses/ReplayGain.hpp"
+#include "FragmentCache.hpp"
 #include "SubsonicId.hpp"
 #include "Utils.hpp"
 
@@ -60,25 +64,24 @@ namespace API::Subsonic
             return "";
         }
 
-        std::string getTrackPath(const Track::pointer& track)
+        std::string getTrackPath(const Track::pointer& track, const Release::pointer& release, const TrackRelations* relations)
         {
             std::string path;
 
             // The track path has to be relative from the root
 
-            const auto release{ track->getRelease() };
             if (release)
             {
-                auto artists{ release->getReleaseArtists() };
+                auto artists{ relations ? relations->getReleaseArtists(release->getId(), TrackArtistLinkType::ReleaseArtist) : release->getReleaseArtists() };
                 if (artists.empty())
-                    artists = release->getArtists();
+                    artists = relations ? relations->getReleaseArtists(release->getId(), TrackArtistLinkType::Artist) : release->getArtists();
 
                 if (artists.size() > 1)
                     path = "Various Artists/";
                 else if (artists.size() == 1)
                     path = Utils::makeNameFilesystemCompatible(artists.front()->getName()) + "/";
 
-                path += Utils::makeNameFilesystemCompatible(track->getRelease()->getName()) + "/";
+                path += Utils::makeNameFilesystemCompatible(release->getName()) + "/";
             }
 
             if (track->getDiscNumber())
@@ -93,167 +96,187 @@ namespace API::Subsonic
 
             return path;
         }
-    }
-
-    Response::Node createSongNode(RequestContext& context, const Track::pointer& track, const User::pointer& user)
-    {
-        Response::Node trackResponse;
-
-        trackResponse.setAttribute("id", idToString(track->getId()));
-        trackResponse.setAttribute("isDir", false);
-        trackResponse.setAttribute("title", track->getName());
-        if (track->getTrackNumber())
-            trackResponse.setAttribute("track", *track->getTrackNumber());
-        if (track->getDiscNumber())
-            trackResponse.setAttribute("discNumber", *track->getDiscNumber());
-        if (track->getYear())
-            trackResponse.setAttribute("year", *track->getYear());
-        trackResponse.setAttribute("playCount", Listen::getCount(context.dbSession, user->getId(), user->getScrobblingBackend(), track->getId()));
-        trackResponse.setAttribute("path", getTrackPath(track));
-        {
-            // TODO, store this in DB
-            std::error_code ec;
-            const auto fileSize{ std::filesystem::file_size(track->getPath(), ec) };
-            if (!ec)
-                trackResponse.setAttribute("size", fileSize);
-        }
 
-        if (track->getPath().has_extension())
+        // Everything but the user specific fields
+        Response::Node createSongFragmentNode(RequestContext& context, const Track::pointer& track, const TrackRelations* relations)
         {
-            auto extension{ track->getPath().extension() };
-            trackResponse.setAttribute("suffix", extension.string().substr(1));
-        }
+            Response::Node trackResponse;
 
-        {
-            const std::string fileSuffix{ formatToSuffix(user->getSubsonicDefaultTranscodingOutputFormat()) };
-            trackResponse.setAttribute("transcodedSuffix", fileSuffix);
-            trackResponse.setAttribute("transcodedContentType", Av::getMimeType(std::filesystem::path{ "." + fileSuffix }));
-        }
+            const Release::pointer release{ relations ? relations->getRelease(track->getId()) : track->getRelease() };
+            auto getArtistLinks{ [&](std::optional<TrackArtistLinkType> linkType)
+            {
+                if (relations)
+                    return relations->getArtistLinks(track->getId(), linkType);
 
-        trackResponse.setAttribute("coverArt", idToString(track->getId()));
+                TrackArtistLink::FindParameters params;
+                params.setTrack(track->getId());
+                params.setLinkType(linkType);
+
+                std::vector<TrackArtistLink::pointer> links;
+                for (const TrackArtistLinkId linkId : TrackArtistLink::find(context.dbSession, params).results)
+                {
+                    if (TrackArtistLink::pointer link{ TrackArtistLink::find(context.dbSession, linkId) })
+                        links.push_back(link);
+                }
+                return links;
+            } };
+
+            trackResponse.setAttribute("id", idToString(track->getId()));
+            trackResponse.setAttribute("isDir", false);
+            trackResponse.setAttribute("title", track->getName());
+            if (track->getTrackNumber())
+                trackResponse.setAttribute("track", *track->getTrackNumber());
+            if (track->getDiscNumber())
+                trackResponse.setAttribute("discNumber", *track->getDiscNumber());
+            if (track->getYear())
+                trackResponse.setAttribute("year", *track->getYear());
+            trackResponse.setAttribute("path", getTrackPath(track, release, relations));
+            if (const std::size_t fileSize{ track->getFileSize() }; fileSize > 0)
+                trackResponse.setAttribute("size", fileSize);
 
-        const std::vector<Artist::pointer>& artists{ track->getArtists({TrackArtistLinkType::Artist}) };
-        if (!artists.empty())
-        {
-            if (!track->getArtistDisplayName().empty())
-                trackResponse.setAttribute("artist", track->getArtistDisplayName());
-            else
-                trackResponse.setAttribute("artist", Utils::joinArtistNames(artists));
+            if (track->getPath().has_extension())
+            {
+                auto extension{ track->getPath().extension() };
+                trackResponse.setAttribute("suffix", extension.string().substr(1));
+            }
 
-            if (artists.size() == 1)
-                trackResponse.setAttribute("artistId", idToString(artists.front()->getId()));
-        }
+            trackResponse.setAttribute("coverArt", idToString(track->getId()));
 
-        Release::pointer release{ track->getRelease() };
-        if (release)
-        {
-            trackResponse.setAttribute("album", release->getName());
-            trackResponse.setAttribute("albumId", idToString(release->getId()));
-            trackResponse.setAttribute("parent", idToString(release->getId()));
-        }
+            const std::vector<Artist::pointer> artists{ relations ? relations->getArtists(track->getId(), { TrackArtistLinkType::Artist }) : track->getArtists({ TrackArtistLinkType::Artist }) };
+            if (!artists.empty())
+            {
+                if (!track->getArtistDisplayName().empty())
+                    trackResponse.setAttribute("artist", track->getArtistDisplayName());
+                else
+                    trackResponse.setAttribute("artist", Utils::joinArtistNames(artists));
 
-        trackResponse.setAttribute("duration", std::chrono::duration_cast<std::chrono::seconds>(track->getDuration()).count());
-        trackResponse.setAttribute("bitRate", (track->getBitrate() / 1000));
-        trackResponse.setAttribute("type", "music");
-        trackResponse.setAttribute("created", StringUtils::toISO8601String(track->getLastWritten()));
-        trackResponse.setAttribute("contentType", Av::getMimeType(track->getPath().extension()));
+                if (artists.size() == 1)
+                    trackResponse.setAttribute("artistId", idToString(artists.front()->getId()));
+            }
 
-        if (const Wt::WDateTime dateTime{ Service<Feedback::IFeedbackService>::get()->getStarredDateTime(user->getId(), track->getId()) }; dateTime.isValid())
-            trackResponse.setAttribute("starred", StringUtils::toISO8601String(dateTime));
+            if (release)
+            {
+                trackResponse.setAttribute("album", release->getName());
+                trackResponse.setAttribute("albumId", idToString(release->getId()));
+                trackResponse.setAttribute("parent", idToString(release->getId()));
+            }
 
-        // Report the first GENRE for this track
-        const ClusterType::pointer genreClusterType{ ClusterType::find(context.dbSession, "GENRE") };
-        if (genreClusterType)
-        {
-            auto clusters{ track->getClusterGroups({genreClusterType}, 1) };
-            if (!clusters.empty() && !clusters.front().empty())
-                trackResponse.setAttribute("genre", clusters.front().front()->getName());
-        }
+            trackResponse.setAttribute("duration", std::chrono::duration_cast<std::chrono::seconds>(track->getDuration()).count());
+            trackResponse.setAttribute("bitRate", (track->getBitrate() / 1000));
+            trackResponse.setAttribute("type", "music");
+            trackResponse.setAttribute("created", StringUtils::toISO8601String(track->getLastWritten()));
+            trackResponse.setAttribute("contentType", Av::getMimeType(track->getPath().extension()));
 
-        // OpenSubsonic specific fields (must always be set)
-        if (!context.enableOpenSubsonic)
-            return trackResponse;
+            // Report the first GENRE for this track
+            const ClusterType::pointer genreClusterType{ ClusterType::find(context.dbSession, "GENRE") };
+            if (genreClusterType)
+            {
+                auto clusters{ track->getClusterGroups({genreClusterType}, 1) };
+                if (!clusters.empty() && !clusters.front().empty())
+                    trackResponse.setAttribute("genre", clusters.front().front()->getName());
+            }
 
-        trackResponse.setAttribute("mediaType", "song");
+            // OpenSubsonic specific fields (must always be set)
+            if (!context.enableOpenSubsonic)
+                return trackResponse;
 
-        {
-            const Wt::WDateTime dateTime{ Service<Scrobbling::IScrobblingService>::get()->getLastListenDateTime(user->getId(), track->getId()) };
-            trackResponse.setAttribute("played", dateTime.isValid() ? StringUtils::toISO8601String(dateTime) : "");
-        }
+            trackResponse.setAttribute("mediaType", "song");
 
-        {
-            std::optional<UUID> mbid{ track->getRecordingMBID() };
-            trackResponse.setAttribute("musicBrainzId", mbid ? mbid->getAsString() : "");
-        }
+            {
+                std::optional<UUID> mbid{ track->getRecordingMBID() };
+                trackResponse.setAttribute("musicBrainzId", mbid ? mbid->getAsString() : "");
+            }
 
-        trackResponse.createEmptyArrayChild("contributors");
-        {
-            TrackArtistLink::FindParameters params;
-            params.setTrack(track->getId());
+            if (const std::size_t sampleRate{ track->getSampleRate() }; sampleRate > 0)
+                trackResponse.setAttribute("samplingRate", sampleRate);
+            if (const std::size_t channelCount{ track->getChannelCount() }; channelCount > 0)
+                trackResponse.setAttribute("channelCount", channelCount);
 
-            for (const TrackArtistLinkId linkId : TrackArtistLink::find(context.dbSession, params).results)
+            trackResponse.createEmptyArrayChild("contributors");
+            for (const TrackArtistLink::pointer& link : getArtistLinks(std::nullopt))
             {
-                TrackArtistLink::pointer link{ TrackArtistLink::find(context.dbSession, linkId) };
                 // Don't report artists nor release artists as they are set in dedicated fields
-                if (link && link->getType() != TrackArtistLinkType::Artist && link->getType() != TrackArtistLinkType::ReleaseArtist)
+                if (link->getType() != TrackArtistLinkType::Artist && link->getType() != TrackArtistLinkType::ReleaseArtist)
                     trackResponse.addArrayChild("contributors", createContributorNode(link));
             }
-        }
 
-        auto addArtistLinks{ [&](Response::Node::Key nodeName, TrackArtistLinkType type)
-        {
-            trackResponse.createEmptyArrayChild(nodeName);
+            auto addArtistLinks{ [&](Response::Node::Key nodeName, TrackArtistLinkType type)
+            {
+                trackResponse.createEmptyArrayChild(nodeName);
+
+                for (const TrackArtistLink::pointer& link : getArtistLinks(type))
+                    trackResponse.addArrayChild(nodeName, createArtistNode(link->getArtist()));
+            } };
 
-            TrackArtistLink::FindParameters params;
-            params.setTrack(track->getId());
-            params.setLinkType(type);
+            addArtistLinks("artists", TrackArtistLinkType::Artist);
+            trackResponse.setAttribute("displayArtist", track->getArtistDisplayName());
+
+            addArtistLinks("albumartists", TrackArtistLinkType::ReleaseArtist);
+            if (release)
+                trackResponse.setAttribute("displayAlbumArtist", release->getArtistDisplayName());
 
-            for (const TrackArtistLinkId linkId : TrackArtistLink::find(context.dbSession, params).results)
+            auto addClusters{ [&](Response::Node::Key field, std::string_view clusterTypeName)
             {
-                TrackArtistLink::pointer link{ TrackArtistLink::find(context.dbSession, linkId) };
-                if (link)
-                    trackResponse.addArrayChild(nodeName, createArtistNode(link->getArtist()));
-            }
-        } };
+                trackResponse.createEmptyArrayValue(field);
 
-        addArtistLinks("artists", TrackArtistLinkType::Artist);
-        trackResponse.setAttribute("displayArtist", track->getArtistDisplayName());
+                ClusterType::pointer clusterType{ ClusterType::find(context.dbSession, clusterTypeName) };
+                if (clusterType)
+                {
+                    Cluster::FindParameters params;
+                    params.setTrack(track->getId());
+                    params.setClusterType(clusterType->getId());
 
-        addArtistLinks("albumartists", TrackArtistLinkType::ReleaseArtist);
-        if (release)
-            trackResponse.setAttribute("displayAlbumArtist", release->getArtistDisplayName());
+                    for (const auto& cluster : Cluster::find(context.dbSession, params).results)
+                        trackResponse.addArrayValue(field, cluster->getName());
+                }
+            } };
 
-        auto addClusters{ [&](Response::Node::Key field, std::string_view clusterTypeName)
-        {
-            trackResponse.createEmptyArrayValue(field);
+            addClusters("moods", "MOOD");
 
-            ClusterType::pointer clusterType{ ClusterType::find(context.dbSession, clusterTypeName) };
-            if (clusterType)
+            // Genres
+            trackResponse.createEmptyArrayChild("genres");
+            if (genreClusterType)
             {
                 Cluster::FindParameters params;
                 params.setTrack(track->getId());
-                params.setClusterType(clusterType->getId());
+                params.setClusterType(genreClusterType->getId());
 
                 for (const auto& cluster : Cluster::find(context.dbSession, params).results)
-                    trackResponse.addArrayValue(field, cluster->getName());
+                    trackResponse.addArrayChild("genres", createItemGenreNode(cluster->getName()));
             }
-        } };
 
-        addClusters("moods", "MOOD");
+            trackResponse.addChild("replayGain", createReplayGainNode(track));
 
-        // Genres
-        trackResponse.createEmptyArrayChild("genres");
-        if (genreClusterType)
-        {
-            Cluster::FindParameters params;
-            params.setTrack(track->getId());
-            params.setClusterType(genreClusterType->getId());
+            return trackResponse;
+        }
+    }
+
+    Response::Node createSongNode(RequestContext& context, const Track::pointer& track, const User::pointer& user, const TrackRelations* relations)
+    {
+        assert(!relations || relations->contains(track->getId()));
 
-            for (const auto& cluster : Cluster::find(context.dbSession, params).results)
-                trackResponse.addArrayChild("genres", createItemGenreNode(cluster->getName()));
+        Response::Node trackResponse;
+
+        const FragmentCache::Key fragmentKey{ FragmentCache::EntityType::Song, track->getId().getValue(), context.libraryGeneration.getLibraryGeneration(), context.responseFormat, false, context.enableOpenSubsonic };
+        trackResponse.setFragment(context.fragmentCache.getOrCreate(fragmentKey, [&] { return createSongFragmentNode(context, track, relations); }));
+
+        trackResponse.setAttribute("playCount", Listen::getCount(context.dbSession, user->getId(), context.userSettings->scrobblingBackend, track->getId()));
+
+        {
+            const std::string fileSuffix{ formatToSuffix(context.userSettings->defaultTranscodingOutputFormat) };
+            trackResponse.setAttribute("transcodedSuffix", fileSuffix);
+            trackResponse.setAttribute("transcodedContentType", Av::getMimeType(std::filesystem::path{ "." + fileSuffix }));
         }
 
-        trackResponse.addChild("replayGain", createReplayGainNode(track));
+        if (const Wt::WDateTime dateTime{ context.starredDateTimes.get(user->getId(), track->getId()) }; dateTime.isValid())
+            trackResponse.setAttribute("starred", StringUtils::toISO8601String(dateTime));
+
+        // OpenSubsonic specific fields (must always be set)
+        if (context.enableOpenSubsonic)
+        {
+            const Wt::WDateTime dateTime{ Service<Scrobbling::IScrobblingService>::get()->getLastListenDateTime(user->getId(), track->getId()) };
+            trackResponse.setAttribute("played", dateTime.isValid() ? StringUtils::toISO8601String(dateTime) : "");
+        }
 
         return trackResponse;
     }
@@ -25,11 +25,13 @@
 namespace Database
 {
     class Track;
+    class TrackRelations;
     class User;
     class Session;
 }
 
 namespace API::Subsonic
 {
-    Response::Node createSongNode(RequestContext& context, const Database::ObjectPtr<Database::Track>& track, const Database::ObjectPtr<Database::User>& user);
+    // relations: if set, prefetched relations of the track, to save per song queries when building lists
+    Response::Node createSongNode(RequestContext& context, const Database::ObjectPtr<Database::Track>& track, const Database::ObjectPtr<Database::User>& user, const Database::TrackRelations* relations = nullptr);
 }
\ No newline at end of file
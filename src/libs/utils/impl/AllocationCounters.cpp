@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/AllocationCounters.hpp"
+
+#ifdef LMS_SUPPORT_ALLOCATION_COUNTERS
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#endif
+
+namespace AllocationCounters
+{
+#ifdef LMS_SUPPORT_ALLOCATION_COUNTERS
+	namespace
+	{
+		// trivial type: no dynamic initialization, safe to use from the allocation hooks
+		thread_local Counters threadCounters;
+
+		void
+		onAllocation(std::size_t size)
+		{
+			threadCounters.allocationCount++;
+			threadCounters.allocatedBytes += size;
+		}
+	}
+
+	bool
+	isEnabled()
+	{
+		return true;
+	}
+
+	Counters
+	getThreadCounters()
+	{
+		return threadCounters;
+	}
+#else
+	bool
+	isEnabled()
+	{
+		return false;
+	}
+
+	Counters
+	getThreadCounters()
+	{
+		return {};
+	}
+#endif
+}
+
+#ifdef LMS_SUPPORT_ALLOCATION_COUNTERS
+// Replacements of the global allocation functions, all the forms are replaced so that allocations and deallocations match
+// malloc is not hooked, only the allocations made by the C++ code (containers, strings, ...) are counted
+namespace
+{
+	void*
+	allocate(std::size_t size)
+	{
+		AllocationCounters::onAllocation(size);
+
+		if (size == 0)
+			size = 1;
+
+		while (true)
+		{
+			if (void* ptr {std::malloc(size)})
+				return ptr;
+
+			std::new_handler handler {std::get_new_handler()};
+			if (!handler)
+				throw std::bad_alloc {};
+			handler();
+		}
+	}
+
+	void*
+	allocateAligned(std::size_t size, std::align_val_t alignment)
+	{
+		AllocationCounters::onAllocation(size);
+
+		const std::size_t align {static_cast<std::size_t>(alignment)};
+		// aligned_alloc requires a size multiple of the alignment
+		size = size == 0 ? align : (size + align - 1) / align * align;
+
+		while (true)
+		{
+			if (void* ptr {std::aligned_alloc(align, size)})
+				return ptr;
+
+			std::new_handler handler {std::get_new_handler()};
+			if (!handler)
+				throw std::bad_alloc {};
+			handler();
+		}
+	}
+}
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	try { return allocate(size); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	try { return allocate(size); } catch (...) { return nullptr; }
+}
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	try { return allocateAligned(size, alignment); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	try { return allocateAligned(size, alignment); } catch (...) { return nullptr; }
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { std::free(ptr); }
+#endif
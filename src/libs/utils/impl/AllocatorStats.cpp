@@ -0,0 +1,287 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/AllocatorStats.hpp"
+
+#include <fstream>
+#include <ostream>
+#include <string>
+
+#if defined(LMS_ALLOCATOR_JEMALLOC)
+#include <cstdint>
+#include <jemalloc/jemalloc.h>
+#elif defined(LMS_ALLOCATOR_MIMALLOC)
+#include <mimalloc.h>
+#elif defined(__GLIBC__)
+#include <cstdio>
+#include <cstdlib>
+#include <malloc.h>
+#endif
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#include "utils/Metrics.hpp"
+#include "utils/String.hpp"
+
+namespace AllocatorStats
+{
+	namespace
+	{
+#if defined(LMS_ALLOCATOR_JEMALLOC)
+		template <typename T>
+		std::optional<T>
+		readMallctl(const std::string& name)
+		{
+			T value;
+			std::size_t size {sizeof(value)};
+			if (mallctl(name.c_str(), &value, &size, nullptr, 0) != 0)
+				return std::nullopt;
+
+			return value;
+		}
+
+		void
+		fillStats(Stats& stats)
+		{
+			// the statistics are only refreshed when the epoch is updated
+			std::uint64_t epoch {1};
+			std::size_t epochSize {sizeof(epoch)};
+			mallctl("epoch", &epoch, &epochSize, &epoch, epochSize);
+
+			stats.allocated = readMallctl<std::size_t>("stats.allocated");
+			stats.active = readMallctl<std::size_t>("stats.active");
+			stats.mapped = readMallctl<std::size_t>("stats.mapped");
+			stats.resident = readMallctl<std::size_t>("stats.resident");
+
+			const std::optional<unsigned> arenaCount {readMallctl<unsigned>("arenas.narenas")};
+			const std::optional<std::size_t> pageSize {readMallctl<std::size_t>("arenas.page")};
+			if (!arenaCount || !pageSize)
+				return;
+
+			for (unsigned i {}; i < *arenaCount; ++i)
+			{
+				const std::string prefix {"stats.arenas." + std::to_string(i) + "."};
+
+				const std::optional<std::size_t> activePageCount {readMallctl<std::size_t>(prefix + "pactive")};
+				const std::optional<std::size_t> smallAllocated {readMallctl<std::size_t>(prefix + "small.allocated")};
+				const std::optional<std::size_t> largeAllocated {readMallctl<std::size_t>(prefix + "large.allocated")};
+				if (!activePageCount || !smallAllocated || !largeAllocated) // uninitialized arena
+					continue;
+
+				stats.arenas.push_back({i, *smallAllocated + *largeAllocated, *activePageCount * *pageSize});
+			}
+		}
+#elif defined(LMS_ALLOCATOR_MIMALLOC)
+		void
+		fillStats(Stats& stats)
+		{
+			// mimalloc does not expose its allocated size without printing its statistics
+			std::size_t elapsed, user, system, currentRss, peakRss, currentCommit, peakCommit, pageFaults;
+			mi_process_info(&elapsed, &user, &system, &currentRss, &peakRss, &currentCommit, &peakCommit, &pageFaults);
+
+			stats.mapped = currentCommit;
+			stats.resident = currentRss;
+		}
+#elif defined(__GLIBC__)
+		bool
+		startsWith(std::string_view str, std::string_view prefix)
+		{
+			return str.substr(0, prefix.size()) == prefix;
+		}
+
+		std::optional<std::size_t>
+		readSizeAttribute(std::string_view line)
+		{
+			constexpr std::string_view sizeAttribute {"size=\""};
+
+			const std::size_t begin {line.find(sizeAttribute)};
+			if (begin == std::string_view::npos)
+				return std::nullopt;
+
+			const std::string_view value {line.substr(begin + sizeAttribute.size())};
+			return StringUtils::readAs<std::size_t>(value.substr(0, value.find('"')));
+		}
+
+		// malloc_info only exists as an XML report, one heap per arena
+		std::vector<ArenaStats>
+		readArenaStats()
+		{
+			std::vector<ArenaStats> arenas;
+
+			char* buffer {};
+			std::size_t bufferSize {};
+			std::FILE* stream {::open_memstream(&buffer, &bufferSize)};
+			if (!stream)
+				return arenas;
+
+			const bool success {::malloc_info(0, stream) == 0};
+			std::fclose(stream);
+			const std::string report {success && buffer ? std::string {buffer, bufferSize} : std::string {}};
+			std::free(buffer);
+
+			std::optional<ArenaStats> arena;
+			std::size_t freeSize {};
+			for (std::string_view line : StringUtils::splitString(report, "\n"))
+			{
+				line = StringUtils::stringTrim(line);
+
+				if (startsWith(line, "<heap nr=\""))
+				{
+					arena.emplace();
+					arena->index = StringUtils::readAs<std::size_t>(line.substr(10, line.find('"', 10) - 10)).value_or(arenas.size());
+					freeSize = 0;
+				}
+				else if (!arena)
+					continue;
+				else if (line == "</heap>")
+				{
+					arena->allocated = arena->active > freeSize ? arena->active - freeSize : 0;
+					arenas.push_back(*arena);
+					arena.reset();
+				}
+				else if (startsWith(line, "<total type=\"fast\"") || startsWith(line, "<total type=\"rest\""))
+					freeSize += readSizeAttribute(line).value_or(0);
+				else if (startsWith(line, "<system type=\"current\""))
+					arena->active = readSizeAttribute(line).value_or(0);
+			}
+
+			return arenas;
+		}
+
+		void
+		fillStats(Stats& stats)
+		{
+#if __GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33)
+			const struct mallinfo2 info {::mallinfo2()};
+
+			// large blocks are directly mapped
+			stats.allocated = info.uordblks + info.hblkhd;
+			stats.active = info.arena + info.hblkhd;
+			stats.mapped = info.arena + info.hblkhd;
+#endif
+			stats.arenas = readArenaStats();
+		}
+#else
+		void
+		fillStats(Stats&)
+		{
+		}
+#endif
+
+		template <typename T>
+		void
+		writeGauge(std::ostream& os, std::string_view name, std::string_view help, std::optional<T> value)
+		{
+			if (!value)
+				return;
+
+			os << "# HELP " << name << " " << help << "\n";
+			os << "# TYPE " << name << " gauge\n";
+			os << name << " " << *value << "\n";
+		}
+
+		template <typename Getter>
+		void
+		writeArenaGauge(std::ostream& os, std::string_view name, std::string_view help, const std::vector<ArenaStats>& arenas, Getter getter)
+		{
+			if (arenas.empty())
+				return;
+
+			os << "# HELP " << name << " " << help << "\n";
+			os << "# TYPE " << name << " gauge\n";
+			for (const ArenaStats& arena : arenas)
+				os << name << "{arena=\"" << arena.index << "\"} " << getter(arena) << "\n";
+		}
+	}
+
+	std::string_view
+	getAllocatorName()
+	{
+#if defined(LMS_ALLOCATOR_JEMALLOC)
+		return "jemalloc";
+#elif defined(LMS_ALLOCATOR_MIMALLOC)
+		return "mimalloc";
+#elif defined(__GLIBC__)
+		return "glibc";
+#else
+		return "system";
+#endif
+	}
+
+	Stats
+	getStats()
+	{
+		Stats stats;
+		fillStats(stats);
+
+		if (!stats.resident)
+			stats.resident = getProcessResidentSize();
+
+		return stats;
+	}
+
+	std::optional<double>
+	getFragmentation(const Stats& stats)
+	{
+		if (!stats.allocated || !stats.active || *stats.active == 0 || *stats.allocated > *stats.active)
+			return std::nullopt;
+
+		return 1. - static_cast<double>(*stats.allocated) / *stats.active;
+	}
+
+	std::optional<std::size_t>
+	getProcessResidentSize()
+	{
+#if defined(__linux__)
+		// second field, in pages
+		std::ifstream statm {"/proc/self/statm"};
+		std::size_t totalPageCount {};
+		std::size_t residentPageCount {};
+		if (!(statm >> totalPageCount >> residentPageCount))
+			return std::nullopt;
+
+		return residentPageCount * static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+#else
+		return std::nullopt;
+#endif
+	}
+
+	void
+	registerMetrics(Metrics::Registry& registry)
+	{
+		registry.getGauge("lms_allocator_info", "Memory allocator LMS has been built with", {{"allocator", std::string {getAllocatorName()}}}).set(1);
+
+		registry.addCollector([](std::ostream& os)
+		{
+			const Stats stats {getStats()};
+			const std::optional<std::size_t> processResidentSize {getProcessResidentSize()};
+
+			writeGauge(os, "lms_allocator_allocated_bytes", "Memory allocated by the application", stats.allocated);
+			writeGauge(os, "lms_allocator_active_bytes", "Memory in the allocator pages that hold allocations", stats.active);
+			writeGauge(os, "lms_allocator_mapped_bytes", "Memory obtained by the allocator from the system", stats.mapped);
+			writeGauge(os, "lms_allocator_resident_bytes", "Memory of the allocator that is physically resident", stats.resident);
+			writeGauge(os, "lms_allocator_fragmentation_ratio", "Share of the active memory that is not allocated", getFragmentation(stats));
+			writeArenaGauge(os, "lms_allocator_arena_allocated_bytes", "Memory allocated by the application, per allocator arena", stats.arenas, [](const ArenaStats& arena) { return arena.allocated; });
+			writeArenaGauge(os, "lms_allocator_arena_active_bytes", "Memory in the allocator pages that hold allocations, per allocator arena", stats.arenas, [](const ArenaStats& arena) { return arena.active; });
+			writeGauge(os, "lms_process_resident_memory_bytes", "Resident memory size of the process", processResidentSize);
+		});
+	}
+}
@@ -184,6 +184,12 @@ namespace Zip
 		}
 	}
 
+	void
+	ArchiveZipper::setRange(std::uint64_t, std::uint64_t)
+	{
+		throw Exception {"Ranges not supported"};
+	}
+
 	static
 	::mode_t
 	permsToMode(const std::filesystem::perms p)
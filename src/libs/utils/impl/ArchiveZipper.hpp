@@ -42,6 +42,8 @@ namespace Zip
 			std::uint64_t writeSome(std::ostream& output) override;
 			bool isComplete() const override;
 			void abort() override;
+			std::optional<std::uint64_t> getTotalSize() const override { return std::nullopt; }
+			void setRange(std::uint64_t offset, std::uint64_t size) override;
 
 			class ArchiveDeleter
 			{
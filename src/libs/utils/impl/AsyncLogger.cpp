@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/AsyncLogger.hpp"
+
+#include <cassert>
+
+namespace
+{
+	std::size_t getRingSize(std::size_t queueSize)
+	{
+		std::size_t size {2};
+		while (size < queueSize)
+			size *= 2;
+
+		return size;
+	}
+}
+
+AsyncLogger::AsyncLogger(std::unique_ptr<Logger> logger, const Parameters& params)
+: _logger {std::move(logger)}
+, _overflowPolicy {params.overflowPolicy}
+, _cells(getRingSize(params.queueSize))
+, _mask {_cells.size() - 1}
+{
+	for (std::size_t i {}; i < _cells.size(); ++i)
+		_cells[i].sequence.store(i, std::memory_order_relaxed);
+
+	// do not queue what the wrapped logger would drop anyway
+	for (std::size_t i {}; i < moduleCount; ++i)
+		setMinSeverity(static_cast<Module>(i), _logger->getMinSeverity(static_cast<Module>(i)));
+
+	_writerThread = std::thread {[this] { writeLoop(); }};
+}
+
+AsyncLogger::~AsyncLogger()
+{
+	_stopping = true;
+	wakeUpWriter();
+	_writerThread.join();
+}
+
+void
+AsyncLogger::processLog(const Log& log)
+{
+	Record record {log.getModule(), log.getSeverity(), log.getThreadId(), log.getMessage()};
+
+	while (!tryPush(record))
+	{
+		if (_overflowPolicy == OverflowPolicy::Drop)
+		{
+			_droppedLogCount.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		wakeUpWriter();
+		std::this_thread::yield();
+	}
+
+	if (_writerSleeping.load())
+		wakeUpWriter();
+}
+
+bool
+AsyncLogger::tryPush(Record& record)
+{
+	std::size_t pos {_enqueuePos.load(std::memory_order_relaxed)};
+	Cell* cell;
+
+	while (true)
+	{
+		cell = &_cells[pos & _mask];
+		const std::size_t sequence {cell->sequence.load(std::memory_order_acquire)};
+		const std::ptrdiff_t diff {static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos)};
+
+		if (diff == 0)
+		{
+			if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (diff < 0)
+		{
+			return false; // full
+		}
+		else
+		{
+			pos = _enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	cell->record = std::move(record);
+	cell->sequence.store(pos + 1, std::memory_order_release);
+
+	return true;
+}
+
+bool
+AsyncLogger::tryPop(Record& record)
+{
+	Cell& cell {_cells[_dequeuePos & _mask]};
+	if (cell.sequence.load(std::memory_order_acquire) != _dequeuePos + 1)
+		return false;
+
+	record = std::move(cell.record);
+	cell.sequence.store(_dequeuePos + _mask + 1, std::memory_order_release);
+	++_dequeuePos;
+
+	return true;
+}
+
+bool
+AsyncLogger::isEmpty() const
+{
+	return _cells[_dequeuePos & _mask].sequence.load(std::memory_order_acquire) != _dequeuePos + 1;
+}
+
+void
+AsyncLogger::wakeUpWriter()
+{
+	// lock to make sure the writer is either not sleeping yet or already waiting
+	std::scoped_lock lock {_writerMutex};
+	_writerCondition.notify_one();
+}
+
+void
+AsyncLogger::writeLoop()
+{
+	while (true)
+	{
+		if (writePendingLogs() > 0)
+			continue;
+
+		if (_stopping)
+		{
+			// logs pushed while stopping
+			writePendingLogs();
+			break;
+		}
+
+		std::unique_lock lock {_writerMutex};
+		_writerSleeping = true;
+		if (isEmpty() && !_stopping)
+			_writerCondition.wait_for(lock, std::chrono::milliseconds {100}); // timeout as a safety net only
+		_writerSleeping = false;
+	}
+}
+
+std::size_t
+AsyncLogger::writePendingLogs()
+{
+	std::size_t count {};
+
+	// write in batches, the ring buffer size at most
+	Record record;
+	while (count <= _mask && tryPop(record))
+	{
+		Log log {nullptr, record.module, record.severity, record.threadId};
+		log.getOstream() << record.message;
+		_logger->processLog(log);
+
+		count++;
+	}
+
+	// the logs were dropped after the ones that could be queued
+	const std::size_t droppedLogCount {_droppedLogCount.load(std::memory_order_relaxed)};
+	if (droppedLogCount != _reportedDroppedLogCount)
+	{
+		Log log {nullptr, Module::UTILS, Severity::WARNING};
+		log.getOstream() << "Log queue full, dropped " << droppedLogCount - _reportedDroppedLogCount << " logs";
+		_logger->processLog(log);
+		_reportedDroppedLogCount = droppedLogCount;
+	}
+
+	return count;
+}
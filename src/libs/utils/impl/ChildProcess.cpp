@@ -26,17 +26,21 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <signal.h>
+#include <spawn.h>
 #include <unistd.h>
 
 #include <algorithm>
-#include <iostream>
-#include <mutex>
+#include <chrono>
 
 #include <boost/asio/read.hpp>
 #include <boost/asio/buffer.hpp>
 
 #include "utils/Exception.hpp"
 #include "utils/Logger.hpp"
+#include "utils/Metrics.hpp"
+#include "utils/Service.hpp"
+
+extern char** environ;
 
 namespace
 {
@@ -51,6 +55,48 @@ namespace
 				: ChildProcessException {errMsg + ": " + ec.message()}
 			{}
 	};
+
+	class FdGuard
+	{
+		public:
+			FdGuard(int fd) : _fd {fd} {}
+			~FdGuard() { reset(); }
+			FdGuard(const FdGuard&) = delete;
+			FdGuard& operator=(const FdGuard&) = delete;
+
+			void reset()
+			{
+				if (_fd != -1)
+					::close(_fd);
+				_fd = -1;
+			}
+
+			int release()
+			{
+				const int fd {_fd};
+				_fd = -1;
+				return fd;
+			}
+
+		private:
+			int _fd;
+	};
+
+	struct SpawnFileActions
+	{
+		SpawnFileActions() { ::posix_spawn_file_actions_init(&actions); }
+		~SpawnFileActions() { ::posix_spawn_file_actions_destroy(&actions); }
+
+		posix_spawn_file_actions_t actions;
+	};
+
+	struct SpawnAttributes
+	{
+		SpawnAttributes() { ::posix_spawnattr_init(&attributes); }
+		~SpawnAttributes() { ::posix_spawnattr_destroy(&attributes); }
+
+		posix_spawnattr_t attributes;
+	};
 }
 
 ChildProcess::ChildProcess(boost::asio::io_context& ioContext, const std::filesystem::path& path, const Args& args)
@@ -58,16 +104,18 @@ ChildProcess::ChildProcess(boost::asio::io_context& ioContext, const std::filesy
 , _childStdout {_ioContext}
 
 {
-	// make sure only one thread is executing this part of code
-	static std::mutex mutex;
-	std::unique_lock<std::mutex> lock {mutex};
+	const auto spawnStart {std::chrono::steady_clock::now()};
 
 	int pipe[2];
 
+	// close on exec: other children spawned concurrently must not inherit the pipe
 	int res {pipe2(pipe, O_NONBLOCK | O_CLOEXEC)};
 	if (res < 0)
 		throw SystemException {errno, "pipe2 failed!"};
 
+	FdGuard pipeReadGuard {pipe[0]};
+	FdGuard pipeWriteGuard {pipe[1]};
+
 	{
 #if defined(__linux__) && defined(F_SETPIPE_SZ)
 		// Just a hint here to prevent the writer from writing too many bytes ahead of the reader
@@ -80,38 +128,62 @@ ChildProcess::ChildProcess(boost::asio::io_context& ioContext, const std::filesy
 #endif
 	}
 
-	res = fork();
-	if (res == -1)
-		throw SystemException {errno, "fork failed!"};
+	std::vector<char*> execArgs;
+	std::transform(std::cbegin(args), std::cend(args), std::back_inserter(execArgs), [](const std::string& arg) { return const_cast<char*>(arg.c_str()); });
+	execArgs.push_back(nullptr);
+
+	// posix_spawn does not duplicate the address space (vfork semantics on Linux): much cheaper than fork for a large process
+	SpawnFileActions fileActions;
+	if ((res = posix_spawn_file_actions_addopen(&fileActions.actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0)) != 0
+			|| (res = posix_spawn_file_actions_adddup2(&fileActions.actions, pipe[1], STDOUT_FILENO)) != 0 // dup2 clears close on exec
+			|| (res = posix_spawn_file_actions_addopen(&fileActions.actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0)) != 0)
+		throw SystemException {res, "posix_spawn_file_actions failed!"};
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 34))
+	// do not rely on every descriptor of the process being close on exec
+	if ((res = posix_spawn_file_actions_addclosefrom_np(&fileActions.actions, STDERR_FILENO + 1)) != 0)
+		throw SystemException {res, "posix_spawn_file_actions_addclosefrom_np failed!"};
+#endif
 
-	if (res == 0) // CHILD
+	// the child must not inherit the signal mask and dispositions of the calling thread
+	SpawnAttributes attributes;
+	sigset_t emptySignals;
+	sigset_t allSignals;
+	sigemptyset(&emptySignals);
+	sigfillset(&allSignals);
+	if ((res = posix_spawnattr_setsigmask(&attributes.attributes, &emptySignals)) != 0
+			|| (res = posix_spawnattr_setsigdefault(&attributes.attributes, &allSignals)) != 0
+			|| (res = posix_spawnattr_setflags(&attributes.attributes, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF)) != 0)
+		throw SystemException {res, "posix_spawnattr failed!"};
+
+	pid_t pid;
+	res = posix_spawn(&pid, path.c_str(), &fileActions.actions, &attributes.attributes, execArgs.data(), environ);
+	if (res != 0)
 	{
-		close(pipe[0]);
-		close(STDIN_FILENO);
-		close(STDERR_FILENO);
+		if (Metrics::Registry* registry {Service<Metrics::Registry>::get()})
+			registry->getCounter("lms_child_process_spawn_failures_total", "Child processes that could not be spawned").increment();
 
-		// Replace stdout with pipe write
-		if (dup2(pipe[1], STDOUT_FILENO) == -1)
-			exit(-1);
+		throw SystemException {res, "posix_spawn failed!"};
+	}
 
-		std::vector<const char*> execArgs;
-		std::transform(std::cbegin(args), std::cend(args), std::back_inserter(execArgs), [](const std::string& arg) { return arg.c_str(); });
-		execArgs.push_back(nullptr);
+	_childPID = pid;
 
-		res = execv(path.string().c_str(), (char *const*)&execArgs[0]);
-		if (res == -1)
-			exit(-1);
-	}
-	else // PARENT
+	pipeWriteGuard.reset();
 	{
-		close(pipe[1]);
+		boost::system::error_code assignError;
+		_childStdout.assign(pipeReadGuard.release(), assignError);
+		if (assignError)
 		{
-			boost::system::error_code assignError;
-			_childStdout.assign(pipe[0], assignError);
-			if (assignError)
-				throw SystemException {assignError, "fork failed!"};
+			// no destructor call: do not leave a zombie
+			::kill(_childPID, SIGKILL);
+			::waitpid(_childPID, nullptr, 0);
+			throw SystemException {assignError, "assign failed!"};
 		}
-		_childPID = res;
+	}
+
+	if (Metrics::Registry* registry {Service<Metrics::Registry>::get()})
+	{
+		registry->getHistogram("lms_child_process_spawn_duration_seconds", "Time spent spawning child processes (transcoders, ...)", {0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1})
+			.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - spawnStart).count());
 	}
 }
 
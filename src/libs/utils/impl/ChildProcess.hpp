@@ -42,8 +42,8 @@ class ChildProcess : public IChildProcess
 		void		asyncRead(std::byte* data, std::size_t bufferSize, ReadCallback callback) override;
 		std::size_t	readSome(std::byte* data, std::size_t bufferSize) override;
 		bool		finished() const override;
+		void		kill() override;
 
-		void	kill();
 		bool	wait(bool block); // return true if waited
 
 		using FileDescriptor = boost::asio::posix::stream_descriptor;
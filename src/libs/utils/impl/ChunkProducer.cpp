@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ChunkProducer.hpp"
+
+#include <streambuf>
+#include <utility>
+
+#include <boost/asio/post.hpp>
+
+#include "utils/Logger.hpp"
+
+namespace
+{
+    class ChunkStreamBuf final : public std::streambuf
+    {
+    public:
+        ChunkStreamBuf(std::vector<char>& buffer)
+            : _buffer{ buffer }
+        {
+        }
+
+    private:
+        int_type overflow(int_type c) override
+        {
+            if (!traits_type::eq_int_type(c, traits_type::eof()))
+                _buffer.push_back(traits_type::to_char_type(c));
+            return traits_type::not_eof(c);
+        }
+
+        std::streamsize xsputn(const char* data, std::streamsize size) override
+        {
+            _buffer.insert(std::end(_buffer), data, data + size);
+            return size;
+        }
+
+        std::vector<char>& _buffer;
+    };
+}
+
+struct ChunkProducer::State
+{
+    State(boost::asio::io_context& ioContext, std::size_t maxReadyChunkCount, ProduceFunction produceFunc)
+        : ioContext{ ioContext }
+        , maxReadyChunkCount{ maxReadyChunkCount }
+        , produceFunc{ std::move(produceFunc) }
+    {
+    }
+
+    boost::asio::io_context& ioContext;
+    const std::size_t maxReadyChunkCount;
+    const ProduceFunction produceFunc;
+
+    std::mutex mutex;
+    std::condition_variable producingCondVar;
+    std::deque<std::vector<char>> readyChunks;
+    std::vector<std::vector<char>> freeBuffers;
+    Wt::Http::ResponseContinuation* waitingContinuation{};
+    bool scheduled{};
+    bool producing{};
+    bool complete{};
+    bool stopped{};
+};
+
+ChunkProducer::ChunkProducer(boost::asio::io_context& ioContext, std::size_t maxReadyChunkCount, ProduceFunction produceFunc)
+    : _state{ std::make_shared<State>(ioContext, maxReadyChunkCount, std::move(produceFunc)) }
+{
+    const std::scoped_lock lock{ _state->mutex };
+    scheduleProduction(_state);
+}
+
+ChunkProducer::~ChunkProducer()
+{
+    stop();
+}
+
+Wt::Http::ResponseContinuation*
+ChunkProducer::writeReadyChunks(Wt::Http::Response& response)
+{
+    const std::scoped_lock lock{ _state->mutex };
+
+    bool written{};
+    while (!_state->readyChunks.empty())
+    {
+        std::vector<char> chunk{ std::move(_state->readyChunks.front()) };
+        _state->readyChunks.pop_front();
+
+        response.out().write(chunk.data(), chunk.size());
+        written = true;
+
+        chunk.clear();
+        _state->freeBuffers.push_back(std::move(chunk));
+    }
+
+    if (_state->complete)
+        return nullptr;
+
+    scheduleProduction(_state);
+
+    // resumed by Wt once the chunks are sent, or by the production task
+    Wt::Http::ResponseContinuation* continuation{ response.createContinuation() };
+    if (!written)
+    {
+        continuation->waitForMoreData();
+        _state->waitingContinuation = continuation;
+    }
+
+    return continuation;
+}
+
+void
+ChunkProducer::stop()
+{
+    std::unique_lock lock{ _state->mutex };
+
+    _state->stopped = true;
+    _state->waitingContinuation = nullptr;
+    _state->producingCondVar.wait(lock, [&] { return !_state->producing; });
+}
+
+void
+ChunkProducer::scheduleProduction(const std::shared_ptr<State>& state)
+{
+    if (state->scheduled || state->complete || state->stopped || state->readyChunks.size() >= state->maxReadyChunkCount)
+        return;
+
+    // queued behind the chunks of the other streams
+    state->scheduled = true;
+    boost::asio::post(state->ioContext, [state] { produce(state); });
+}
+
+void
+ChunkProducer::produce(const std::shared_ptr<State>& state)
+{
+    std::vector<char> buffer;
+    {
+        const std::scoped_lock lock{ state->mutex };
+
+        state->scheduled = false;
+        if (state->stopped)
+            return;
+
+        state->producing = true;
+        if (!state->freeBuffers.empty())
+        {
+            buffer = std::move(state->freeBuffers.back());
+            state->freeBuffers.pop_back();
+        }
+    }
+
+    bool more{};
+    try
+    {
+        ChunkStreamBuf streamBuf{ buffer };
+        std::ostream output{ &streamBuf };
+        more = state->produceFunc(output);
+    }
+    catch (const std::exception& e)
+    {
+        LMS_LOG(UTILS, ERROR) << "Cannot produce response chunk: " << e.what();
+    }
+
+    Wt::Http::ResponseContinuation* continuation{};
+    {
+        const std::scoped_lock lock{ state->mutex };
+
+        if (!buffer.empty())
+            state->readyChunks.push_back(std::move(buffer));
+        if (!more)
+            state->complete = true;
+
+        scheduleProduction(state);
+
+        // the continuation must stay valid until resumed: stop waits for this
+        continuation = std::exchange(state->waitingContinuation, nullptr);
+        if (!continuation)
+            state->producing = false;
+    }
+
+    if (continuation)
+    {
+        continuation->haveMoreData();
+
+        const std::scoped_lock lock{ state->mutex };
+        state->producing = false;
+    }
+    state->producingCondVar.notify_all();
+}
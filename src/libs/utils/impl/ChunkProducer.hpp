@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <Wt/Http/Response.h>
+
+// Produces the chunks of a response on the delivery reactor, so that the Wt threads only have to copy them to the response
+// Each stream has at most one production task queued at a time: the reactor threads serve the active streams in turn
+class ChunkProducer
+{
+public:
+    // Writes the next chunk, returns false once there is nothing more to produce
+    using ProduceFunction = std::function<bool(std::ostream& output)>;
+
+    ChunkProducer(boost::asio::io_context& ioContext, std::size_t maxReadyChunkCount, ProduceFunction produceFunc);
+    ~ChunkProducer(); // see stop
+
+    ChunkProducer(const ChunkProducer&) = delete;
+    ChunkProducer& operator=(const ChunkProducer&) = delete;
+
+    // Writes the chunks produced so far. Returns null once everything has been written
+    // If nothing was ready, the returned continuation is resumed as soon as the next chunk is produced
+    Wt::Http::ResponseContinuation* writeReadyChunks(Wt::Http::Response& response);
+
+    // Waits for the chunk in production, if any: the produce function is not called anymore once this returns
+    void stop();
+
+private:
+    struct State;
+    static void scheduleProduction(const std::shared_ptr<State>& state);
+    static void produce(const std::shared_ptr<State>& state);
+
+    std::shared_ptr<State> _state; // shared with the queued production task
+};
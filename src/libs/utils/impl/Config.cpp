@@ -19,19 +19,85 @@
 
 #include "Config.hpp"
 
+#include <libconfig.h++>
+
 #include "utils/Exception.hpp"
 #include "utils/Logger.hpp"
 
+namespace
+{
+	template <typename Values>
+	void flattenSettings(const libconfig::Setting& group, Values& values)
+	{
+		for (int i {}; i < group.getLength(); ++i)
+		{
+			const libconfig::Setting& setting {group[i]};
+			const std::string path {setting.getPath()};
+
+			switch (setting.getType())
+			{
+				case libconfig::Setting::TypeGroup:
+					flattenSettings(setting, values);
+					break;
+
+				case libconfig::Setting::TypeInt:
+				case libconfig::Setting::TypeInt64:
+					values.emplace(path, static_cast<long long>(setting));
+					break;
+
+				case libconfig::Setting::TypeFloat:
+					values.emplace(path, static_cast<double>(setting));
+					break;
+
+				case libconfig::Setting::TypeString:
+					values.emplace(path, std::string {static_cast<const char*>(setting)});
+					break;
+
+				case libconfig::Setting::TypeBoolean:
+					values.emplace(path, static_cast<bool>(setting));
+					break;
+
+				case libconfig::Setting::TypeArray:
+				case libconfig::Setting::TypeList:
+				{
+					// only lists of strings are supported
+					std::vector<std::string> strings;
+					for (int j {}; j < setting.getLength(); ++j)
+					{
+						if (setting[j].getType() == libconfig::Setting::TypeString)
+							strings.emplace_back(static_cast<const char*>(setting[j]));
+					}
+					values.emplace(path, std::move(strings));
+					break;
+				}
+
+				case libconfig::Setting::TypeNone:
+					break;
+			}
+		}
+	}
+}
+
 std::unique_ptr<IConfig> createConfig(const std::filesystem::path& p)
 {
 	return std::make_unique<Config>(p);
 }
 
 Config::Config(const std::filesystem::path& p)
+: _path {p}
+{
+	_snapshots.emplace_back(parse(_path));
+	_currentSnapshot.store(_snapshots.back().get());
+}
+
+std::unique_ptr<const Config::Snapshot>
+Config::parse(const std::filesystem::path& p)
 {
+	libconfig::Config config;
+
 	try
 	{
-		_config.readFile(p.string().c_str());
+		config.readFile(p.string().c_str());
 	}
 	catch( libconfig::FileIOException& e)
 	{
@@ -45,90 +111,138 @@ Config::Config(const std::filesystem::path& p)
 	{
 		throw LmsException {"Cannot open config file '" + p.string() + "': " + e.what()};
 	}
+
+	auto snapshot {std::make_unique<Snapshot>()};
+	flattenSettings(config.getRoot(), snapshot->values);
+
+	return snapshot;
 }
 
-std::string_view
-Config::getString(std::string_view setting, std::string_view def)
+void
+Config::reload()
 {
-	try
 	{
-		return static_cast<const char*>(_config.lookup(std::string {setting}));
-	}
-	catch (libconfig::ConfigException&)
-	{
-		return def;
+		const std::scoped_lock lock {_reloadMutex};
+
+		std::unique_ptr<const Snapshot> snapshot {parse(_path)};
+
+		const Snapshot& currentSnapshot {*_currentSnapshot.load()};
+		for (const auto& [setting, value] : snapshot->values)
+		{
+			auto it {currentSnapshot.values.find(setting)};
+			if (it == std::cend(currentSnapshot.values) || it->second != value)
+				LMS_LOG(MAIN, INFO) << "Setting '" << setting << "' changed";
+		}
+		for (const auto& [setting, value] : currentSnapshot.values)
+		{
+			if (snapshot->values.find(setting) == std::cend(snapshot->values))
+				LMS_LOG(MAIN, INFO) << "Setting '" << setting << "' removed";
+		}
+
+		_snapshots.emplace_back(std::move(snapshot));
+		_currentSnapshot.store(_snapshots.back().get());
 	}
+
+	LMS_LOG(MAIN, INFO) << "Configuration file '" << _path.string() << "' reloaded";
+
+	const std::scoped_lock lock {_callbacksMutex};
+	for (const auto& [callbackId, callback] : _callbacks)
+		callback();
+}
+
+IConfig::ReloadCallbackId
+Config::addReloadCallback(ReloadCallback callback)
+{
+	const std::scoped_lock lock {_callbacksMutex};
+
+	const ReloadCallbackId callbackId {_nextCallbackId++};
+	_callbacks.emplace(callbackId, std::move(callback));
+
+	return callbackId;
+}
+
+void
+Config::removeReloadCallback(ReloadCallbackId callbackId)
+{
+	const std::scoped_lock lock {_callbacksMutex};
+	_callbacks.erase(callbackId);
+}
+
+template <typename T>
+const T*
+Config::lookup(std::string_view setting) const
+{
+	const Snapshot& snapshot {*_currentSnapshot.load()};
+
+	auto it {snapshot.values.find(std::string {setting})};
+	if (it == std::cend(snapshot.values))
+		return nullptr;
+
+	return std::get_if<T>(&it->second);
+}
+
+std::string_view
+Config::getString(std::string_view setting, std::string_view def)
+{
+	if (const std::string* value {lookup<std::string>(setting)})
+		return *value;
+
+	return def;
 }
 
 void
 Config::visitStrings(std::string_view setting, std::function<void(std::string_view)> _func, std::initializer_list<std::string_view> defs)
 {
-	try
-	{
-		const libconfig::Setting& values {_config.lookup(std::string {setting})};
-		for (int i {}; i < values.getLength(); ++i)
-			_func(static_cast<const char*>(values[i]));
-	}
-	catch (const libconfig::SettingNotFoundException&)
+	const Snapshot& snapshot {*_currentSnapshot.load()};
+
+	auto it {snapshot.values.find(std::string {setting})};
+	if (it == std::cend(snapshot.values))
 	{
 		for (std::string_view def : defs)
 			_func(def);
+
+		return;
 	}
-	catch (libconfig::ConfigException&)
+
+	if (const auto* values {std::get_if<std::vector<std::string>>(&it->second)})
 	{
+		for (const std::string& value : *values)
+			_func(value);
 	}
 }
 
 std::filesystem::path
 Config::getPath(std::string_view setting, const std::filesystem::path& path)
 {
-	try
-	{
-		const char* res {_config.lookup(std::string {setting})};
-		return std::filesystem::path {std::string(res)};
-	}
-	catch (libconfig::ConfigException&)
-	{
-		return path;
-	}
+	if (const std::string* value {lookup<std::string>(setting)})
+		return std::filesystem::path {*value};
+
+	return path;
 }
 
 unsigned long
 Config::getULong(std::string_view setting, unsigned long def)
 {
-	try
-	{
-		return static_cast<unsigned int>(_config.lookup(std::string {setting}));
-	}
-	catch (libconfig::ConfigException&)
-	{
-		return def;
-	}
+	if (const long long* value {lookup<long long>(setting)})
+		return static_cast<unsigned long>(*value);
+
+	return def;
 }
 
 long
 Config::getLong(std::string_view setting, long def)
 {
-	try
-	{
-		return _config.lookup(std::string {setting});
-	}
-	catch (libconfig::ConfigException&)
-	{
-		return def;
-	}
+	if (const long long* value {lookup<long long>(setting)})
+		return static_cast<long>(*value);
+
+	return def;
 }
 
 bool
 Config::getBool(std::string_view setting, bool def)
 {
-	try
-	{
-		return _config.lookup(std::string {setting});
-	}
-	catch (libconfig::ConfigException&)
-	{
-		return def;
-	}
-}
+	if (const bool* value {lookup<bool>(setting)})
+		return *value;
 
+	return def;
+}
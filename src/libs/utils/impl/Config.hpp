@@ -20,7 +20,14 @@
 
 #include "utils/IConfig.hpp"
 
-#include <libconfig.h++>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
 
 // Used to get config values from configuration files
 class Config final : public IConfig
@@ -34,6 +41,10 @@ class Config final : public IConfig
 		Config(Config&&) = delete;
 		Config& operator=(Config&&) = delete;
 
+		void					reload() override;
+		ReloadCallbackId		addReloadCallback(ReloadCallback callback) override;
+		void					removeReloadCallback(ReloadCallbackId callbackId) override;
+
 		// Default values are returned in case of setting not found
 		std::string_view		getString(std::string_view setting, std::string_view def = "") override;
 		void 					visitStrings(std::string_view setting, std::function<void(std::string_view)> _func, std::initializer_list<std::string_view> defs) override;
@@ -43,7 +54,26 @@ class Config final : public IConfig
 		bool		getBool(std::string_view setting, bool def = false) override;
 
 	private:
+		using Value = std::variant<std::string, long long, double, bool, std::vector<std::string>>;
 
-		libconfig::Config _config;
-};
+		// Settings indexed by their full path ("group.setting")
+		struct Snapshot
+		{
+			std::unordered_map<std::string, Value> values;
+		};
+
+		static std::unique_ptr<const Snapshot>	parse(const std::filesystem::path& p);
+
+		template <typename T>
+		const T*								lookup(std::string_view setting) const;
 
+		const std::filesystem::path				_path;
+
+		std::mutex								_reloadMutex;
+		std::vector<std::unique_ptr<const Snapshot>>	_snapshots; // never freed, so that returned views remain valid
+		std::atomic<const Snapshot*>			_currentSnapshot {};
+
+		std::mutex								_callbacksMutex;
+		std::map<ReloadCallbackId, ReloadCallback>	_callbacks;
+		ReloadCallbackId						_nextCallbackId {};
+};
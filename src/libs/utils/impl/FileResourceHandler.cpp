@@ -19,9 +19,19 @@
 
 #include "FileResourceHandler.hpp"
 
-#include <fstream>
-
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils/DeliveryReactor.hpp"
 #include "utils/Logger.hpp"
+#include "utils/Service.hpp"
 
 std::unique_ptr<IResourceHandler>
 createFileResourceHandler(const std::filesystem::path& path, std::string_view mimeType)
@@ -35,29 +45,43 @@ FileResourceHandler::FileResourceHandler(const std::filesystem::path& path, std:
 {
 }
 
+FileResourceHandler::~FileResourceHandler()
+{
+    _chunkProducer.reset();
+
+    if (_mapping)
+        ::munmap(_mapping, _mappingSize);
+    if (_fd != -1)
+        ::close(_fd);
+}
+
 Wt::Http::ResponseContinuation*
 FileResourceHandler::processRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
 {
-    ::uint64_t startByte{ _offset };
-    std::ifstream ifs{ _path.string().c_str(), std::ios::in | std::ios::binary };
-
-    if (startByte == 0)
+    if (_fd == -1)
     {
-        if (!ifs)
+        // the file stays open (and mapped) for all the continuations
+        _fd = ::open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (_fd == -1)
         {
-            LMS_LOG(UTILS, ERROR) << "Cannot open file stream for '" << _path.string() << "'";
+            LMS_LOG(UTILS, ERROR) << "Cannot open file '" << _path.string() << "': " << ::strerror(errno);
             response.setStatus(404);
             return {};
         }
 
-        ifs.seekg(0, std::ios::end);
-        const ::uint64_t fileSize{ static_cast<::uint64_t>(ifs.tellg()) };
-        ifs.seekg(0, std::ios::beg);
+        struct stat fileStat;
+        if (::fstat(_fd, &fileStat) == -1)
+        {
+            LMS_LOG(UTILS, ERROR) << "Cannot stat file '" << _path.string() << "': " << ::strerror(errno);
+            response.setStatus(404);
+            return {};
+        }
+        const ::uint64_t fileSize{ static_cast<::uint64_t>(fileStat.st_size) };
 
         LMS_LOG(UTILS, DEBUG) << "File '" << _path.string() << "', fileSize = " << fileSize;
 
         response.addHeader("Accept-Ranges", "bytes");
-        
+
         const Wt::Http::Request::ByteRangeSpecifier ranges{ request.getRanges(fileSize) };
         if (!ranges.isSatisfiable())
         {
@@ -75,15 +99,15 @@ FileResourceHandler::processRequest(const Wt::Http::Request& request, Wt::Http::
             LMS_LOG(UTILS, DEBUG) << "Range requested = " << ranges[0].firstByte() << "/" << ranges[0].lastByte();
 
             response.setStatus(206);
-            startByte = ranges[0].firstByte();
+            _offset = ranges[0].firstByte();
             _beyondLastByte = ranges[0].lastByte() + 1;
 
             std::ostringstream contentRange;
-            contentRange << "bytes " << startByte << "-"
+            contentRange << "bytes " << _offset << "-"
                 << _beyondLastByte - 1 << "/" << fileSize;
 
             response.addHeader("Content-Range", contentRange.str());
-            response.setContentLength(_beyondLastByte - startByte);
+            response.setContentLength(_beyondLastByte - _offset);
         }
         else
         {
@@ -96,36 +120,106 @@ FileResourceHandler::processRequest(const Wt::Http::Request& request, Wt::Http::
 
         LMS_LOG(UTILS, DEBUG) << "Mimetype set to '" << _mimeType << "'";
         response.setMimeType(_mimeType);
+
+        mapFile(fileSize);
+
+        if (DeliveryReactor* deliveryReactor{ Service<DeliveryReactor>::get() }; deliveryReactor && _offset < _beyondLastByte)
+            _chunkProducer = std::make_unique<ChunkProducer>(deliveryReactor->getIoContext(), _maxReadyChunkCount, [this](std::ostream& output) { return writeNextChunk(output); });
     }
-    else if (!ifs)
+
+    if (_chunkProducer)
+        return _chunkProducer->writeReadyChunks(response);
+
+    if (writeNextChunk(response.out()))
     {
-        LMS_LOG(UTILS, ERROR) << "Cannot reopen file stream for '" << _path.string() << "'";
-        return {};
+        LMS_LOG(UTILS, DEBUG) << "Job not complete! Next chunk offset = " << _offset;
+
+        return response.createContinuation();
     }
 
-    ifs.seekg(static_cast<std::istream::pos_type>(startByte));
+    LMS_LOG(UTILS, DEBUG) << "Job complete!";
+    return nullptr;
+}
 
-    std::vector<char> buf;
-    buf.resize(_chunkSize);
+bool
+FileResourceHandler::writeNextChunk(std::ostream& output)
+{
+    const ::uint64_t restSize{ _beyondLastByte - _offset };
+    const std::size_t pieceSize{ static_cast<std::size_t>(std::min<::uint64_t>(_chunkSize, restSize)) };
 
-    ::uint64_t restSize = _beyondLastByte - startByte;
-    ::uint64_t pieceSize = buf.size() > restSize ? restSize : buf.size();
+    const std::size_t actualPieceSize{ _mapping ? writeMappedChunk(output, pieceSize) : writeReadChunk(output, pieceSize) };
+    _offset += actualPieceSize;
 
-    ifs.read(&buf[0], pieceSize);
-    const ::uint64_t actualPieceSize{ static_cast<::uint64_t>(ifs.gcount()) };
-    response.out().write(&buf[0], actualPieceSize);
+    LMS_LOG(UTILS, DEBUG) << "Progress: " << actualPieceSize << "/" << restSize;
+    return actualPieceSize == pieceSize && actualPieceSize < restSize;
+}
 
-    LMS_LOG(UTILS, DEBUG) << "Written " << actualPieceSize << " bytes";
+void
+FileResourceHandler::mapFile(::uint64_t fileSize)
+{
+    // empty files cannot be mapped, and huge files may not fit in the address space
+    if (fileSize == 0 || fileSize > std::numeric_limits<std::size_t>::max())
+        return;
 
-    LMS_LOG(UTILS, DEBUG) << "Progress: " << actualPieceSize << "/" << restSize;
-    if (ifs.good() && actualPieceSize < restSize)
+    void* mapping{ ::mmap(nullptr, static_cast<std::size_t>(fileSize), PROT_READ, MAP_SHARED, _fd, 0) };
+    if (mapping == MAP_FAILED)
     {
-        _offset = startByte + actualPieceSize;
-        LMS_LOG(UTILS, DEBUG) << "Job not complete! Next chunk offset = " << _offset;
+        LMS_LOG(UTILS, DEBUG) << "Cannot map file '" << _path.string() << "', using regular reads: " << ::strerror(errno);
+        return;
+    }
 
-        return response.createContinuation();
+    _mapping = mapping;
+    _mappingSize = static_cast<std::size_t>(fileSize);
+    ::madvise(_mapping, _mappingSize, MADV_SEQUENTIAL);
+}
+
+std::size_t
+FileResourceHandler::writeMappedChunk(std::ostream& output, std::size_t size)
+{
+    // accessing pages beyond the end of a file truncated meanwhile would raise SIGBUS
+    struct stat fileStat;
+    if (::fstat(_fd, &fileStat) == -1 || static_cast<::uint64_t>(fileStat.st_size) < _offset + size)
+    {
+        LMS_LOG(UTILS, ERROR) << "File '" << _path.string() << "' has been truncated while being served";
+        return 0;
     }
 
-    LMS_LOG(UTILS, DEBUG) << "Job complete!";
-    return nullptr;
+    const char* data{ static_cast<const char*>(_mapping) + _offset };
+
+    // the pages of the next chunk are read by the kernel while this one is sent
+    const ::uint64_t nextOffset{ _offset + size };
+    if (nextOffset < _beyondLastByte)
+    {
+        const std::size_t pageSize{ static_cast<std::size_t>(::sysconf(_SC_PAGESIZE)) };
+        const ::uint64_t nextPageOffset{ nextOffset / pageSize * pageSize };
+        ::madvise(static_cast<char*>(_mapping) + nextPageOffset, static_cast<std::size_t>(std::min<::uint64_t>(_chunkSize, _mappingSize - nextPageOffset)), MADV_WILLNEED);
+    }
+
+    output.write(data, size);
+    return size;
+}
+
+std::size_t
+FileResourceHandler::writeReadChunk(std::ostream& output, std::size_t size)
+{
+    _buffer.resize(_chunkSize);
+
+    std::size_t readSize{};
+    while (readSize < size)
+    {
+        const ::ssize_t res{ ::pread(_fd, _buffer.data() + readSize, size - readSize, static_cast<::off_t>(_offset + readSize)) };
+        if (res == -1 && errno == EINTR)
+            continue;
+        if (res <= 0)
+        {
+            if (res == -1)
+                LMS_LOG(UTILS, ERROR) << "Cannot read file '" << _path.string() << "': " << ::strerror(errno);
+            break;
+        }
+
+        readSize += static_cast<std::size_t>(res);
+    }
+
+    output.write(_buffer.data(), readSize);
+    return readSize;
 }
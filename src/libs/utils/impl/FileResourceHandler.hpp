@@ -20,24 +20,49 @@
 #pragma once
 
 #include <filesystem>
+#include <memory>
+#include <ostream>
 #include <string>
 #include <string_view>
+#include <vector>
 #include "utils/IResourceHandler.hpp"
+#include "utils/UserActivity.hpp"
+#include "ChunkProducer.hpp"
 
+// Sends the file straight from a read-only mapping, or using regular reads if it cannot be mapped
+// The chunks are read ahead on the delivery reactor if there is one
 class FileResourceHandler final : public IResourceHandler
 {
 public:
     FileResourceHandler(const std::filesystem::path& filePath, std::string_view mimeType);
+    ~FileResourceHandler() override;
+
+    FileResourceHandler(const FileResourceHandler&) = delete;
+    FileResourceHandler& operator=(const FileResourceHandler&) = delete;
 
 private:
     Wt::Http::ResponseContinuation* processRequest(const Wt::Http::Request& request, Wt::Http::Response& response) override;
     void abort() override {};
 
+    void mapFile(::uint64_t fileSize);
+    bool writeNextChunk(std::ostream& output);
+    std::size_t writeMappedChunk(std::ostream& output, std::size_t size);
+    std::size_t writeReadChunk(std::ostream& output, std::size_t size);
+
     static constexpr std::size_t _chunkSize{ 262'144 };
+    static constexpr std::size_t _maxReadyChunkCount{ 4 };
 
     std::filesystem::path   _path;
     std::string             _mimeType;
     ::uint64_t              _beyondLastByte{};
     ::uint64_t              _offset{};
+
+    int                     _fd{ -1 };
+    void*                   _mapping{};
+    std::size_t             _mappingSize{};
+    std::vector<char>       _buffer; // regular reads only
+    std::unique_ptr<ChunkProducer> _chunkProducer; // touches the file until stopped
+
+    const UserActivity::StreamScope _streamScope;
 };
 
@@ -23,17 +23,19 @@
 
 #include "utils/Logger.hpp"
 
-IOContextRunner::IOContextRunner(boost::asio::io_service& ioService, std::size_t threadCount)
+IOContextRunner::IOContextRunner(boost::asio::io_service& ioService, std::size_t threadCount, std::function<void()> threadInit)
 : _ioService {ioService}
 , _work {ioService}
 {
 	LMS_LOG(UTILS, INFO) << "Starting IO context with " << threadCount << " threads...";
 	for (std::size_t i {}; i < threadCount; ++i)
 	{
-		_threads.emplace_back([&]
+		_threads.emplace_back([this, threadInit]
 		{
 			try
 			{
+				if (threadInit)
+					threadInit();
 				_ioService.run();
 			}
 			catch (const std::exception& e)
@@ -59,9 +59,48 @@ const char* getSeverityName(Severity sev)
     return "";
 }
 
-Log::Log(Logger* logger, Module module, Severity severity)
+std::optional<Module> getModuleByName(std::string_view name)
+{
+    for (std::size_t i{}; i < moduleCount; ++i)
+    {
+        const Module module{ static_cast<Module>(i) };
+        if (name == getModuleName(module))
+            return module;
+    }
+    return std::nullopt;
+}
+
+std::optional<Severity> getSeverityByName(std::string_view name)
+{
+    for (Severity severity : { Severity::FATAL, Severity::ERROR, Severity::WARNING, Severity::INFO, Severity::DEBUG })
+    {
+        if (name == getSeverityName(severity))
+            return severity;
+    }
+    return std::nullopt;
+}
+
+Logger::Logger()
+{
+    // everything is sent to the sink by default
+    setMinSeverity(Severity::DEBUG);
+}
+
+void Logger::setMinSeverity(Module module, Severity severity)
+{
+    _minSeverities[static_cast<std::size_t>(module)].store(severity, std::memory_order_relaxed);
+}
+
+void Logger::setMinSeverity(Severity severity)
+{
+    for (std::atomic<Severity>& minSeverity : _minSeverities)
+        minSeverity.store(severity, std::memory_order_relaxed);
+}
+
+Log::Log(Logger* logger, Module module, Severity severity, std::thread::id threadId)
     : _module{ module },
     _severity{ severity },
+    _threadId{ threadId },
     _logger{ logger }
 {}
 
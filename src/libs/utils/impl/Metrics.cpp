@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/Metrics.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+#include "utils/Exception.hpp"
+
+namespace Metrics
+{
+	namespace
+	{
+		std::string withLabel(const std::string& labels, std::string_view name, std::string_view value)
+		{
+			std::string res {labels};
+			if (!res.empty())
+				res += ",";
+			res += std::string {name} + "=\"" + escapeLabelValue(value) + "\"";
+
+			return res;
+		}
+
+		template <typename T>
+		void writeSample(std::ostream& os, std::string_view name, const std::string& labels, T value)
+		{
+			os << name;
+			if (!labels.empty())
+				os << "{" << labels << "}";
+			os << " " << value << "\n";
+		}
+	}
+
+	std::string
+	escapeLabelValue(std::string_view value)
+	{
+		std::string res;
+		res.reserve(value.size());
+
+		for (char c : value)
+		{
+			switch (c)
+			{
+				case '\\': res += "\\\\"; break;
+				case '"': res += "\\\""; break;
+				case '\n': res += "\\n"; break;
+				default: res += c;
+			}
+		}
+
+		return res;
+	}
+
+	std::string
+	formatLabels(const Registry::Labels& labels)
+	{
+		std::string res;
+		for (const auto& [name, value] : labels)
+			res = withLabel(res, name, value);
+
+		return res;
+	}
+
+	Histogram::Histogram(std::vector<double> bucketBounds)
+	: _bucketBounds {std::move(bucketBounds)}
+	, _bucketCounts {std::make_unique<std::atomic<std::uint64_t>[]>(_bucketBounds.size())}
+	{
+		if (!std::is_sorted(std::cbegin(_bucketBounds), std::cend(_bucketBounds)))
+			throw LmsException {"Histogram bucket bounds must be sorted"};
+	}
+
+	void
+	Histogram::observe(double value)
+	{
+		auto it {std::lower_bound(std::cbegin(_bucketBounds), std::cend(_bucketBounds), value)};
+		if (it != std::cend(_bucketBounds))
+			_bucketCounts[std::distance(std::cbegin(_bucketBounds), it)].fetch_add(1, std::memory_order_relaxed);
+
+		double sum {_sum.load(std::memory_order_relaxed)};
+		while (!_sum.compare_exchange_weak(sum, sum + value, std::memory_order_relaxed))
+			;
+
+		_count.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	std::vector<std::uint64_t>
+	Histogram::getCumulativeBucketCounts() const
+	{
+		std::vector<std::uint64_t> res(_bucketBounds.size());
+
+		std::uint64_t cumulativeCount {};
+		for (std::size_t i {}; i < _bucketBounds.size(); ++i)
+		{
+			cumulativeCount += _bucketCounts[i].load(std::memory_order_relaxed);
+			res[i] = cumulativeCount;
+		}
+
+		return res;
+	}
+
+	const char*
+	Registry::getTypeName(Type type)
+	{
+		switch (type)
+		{
+			case Type::Counter: return "counter";
+			case Type::Gauge: return "gauge";
+			case Type::Histogram: return "histogram";
+		}
+
+		return "untyped";
+	}
+
+	Registry::Family&
+	Registry::getFamily(std::string_view name, std::string_view help, Type type)
+	{
+		auto [it, inserted] {_families.try_emplace(std::string {name})};
+		Family& family {it->second};
+		if (inserted)
+		{
+			family.type = type;
+			family.help = help;
+		}
+		else if (family.type != type)
+			throw LmsException {"Metric '" + std::string {name} + "' already registered with another type"};
+
+		return family;
+	}
+
+	Counter&
+	Registry::getCounter(std::string_view name, std::string_view help, const Labels& labels)
+	{
+		const std::scoped_lock lock {_mutex};
+
+		std::unique_ptr<Counter>& counter {getFamily(name, help, Type::Counter).counters[formatLabels(labels)]};
+		if (!counter)
+			counter = std::make_unique<Counter>();
+
+		return *counter;
+	}
+
+	Gauge&
+	Registry::getGauge(std::string_view name, std::string_view help, const Labels& labels)
+	{
+		const std::scoped_lock lock {_mutex};
+
+		std::unique_ptr<Gauge>& gauge {getFamily(name, help, Type::Gauge).gauges[formatLabels(labels)]};
+		if (!gauge)
+			gauge = std::make_unique<Gauge>();
+
+		return *gauge;
+	}
+
+	Histogram&
+	Registry::getHistogram(std::string_view name, std::string_view help, const std::vector<double>& bucketBounds, const Labels& labels)
+	{
+		const std::scoped_lock lock {_mutex};
+
+		std::unique_ptr<Histogram>& histogram {getFamily(name, help, Type::Histogram).histograms[formatLabels(labels)]};
+		if (!histogram)
+			histogram = std::make_unique<Histogram>(bucketBounds);
+
+		return *histogram;
+	}
+
+	void
+	Registry::addCollector(Collector collector)
+	{
+		const std::scoped_lock lock {_mutex};
+
+		_collectors.emplace_back(std::move(collector));
+	}
+
+	void
+	Registry::write(std::ostream& os) const
+	{
+		const std::scoped_lock lock {_mutex};
+
+		for (const auto& [name, family] : _families)
+		{
+			os << "# HELP " << name << " " << family.help << "\n";
+			os << "# TYPE " << name << " " << getTypeName(family.type) << "\n";
+
+			for (const auto& [labels, counter] : family.counters)
+				writeSample(os, name, labels, counter->getValue());
+
+			for (const auto& [labels, gauge] : family.gauges)
+				writeSample(os, name, labels, gauge->getValue());
+
+			for (const auto& [labels, histogram] : family.histograms)
+			{
+				const std::vector<std::uint64_t> bucketCounts {histogram->getCumulativeBucketCounts()};
+				for (std::size_t i {}; i < bucketCounts.size(); ++i)
+				{
+					std::ostringstream bound;
+					bound << histogram->getBucketBounds()[i];
+					writeSample(os, name + "_bucket", withLabel(labels, "le", bound.str()), bucketCounts[i]);
+				}
+				writeSample(os, name + "_bucket", withLabel(labels, "le", "+Inf"), histogram->getCount());
+				writeSample(os, name + "_sum", labels, histogram->getSum());
+				writeSample(os, name + "_count", labels, histogram->getCount());
+			}
+		}
+
+		for (const Collector& collector : _collectors)
+			collector(os);
+	}
+} // namespace Metrics
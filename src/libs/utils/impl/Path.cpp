@@ -21,10 +21,24 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
+#if defined(__linux__)
+#include <dirent.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#endif
 
+#include <algorithm>
 #include <array>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 #include <boost/tokenizer.hpp>
 
@@ -35,6 +49,354 @@
 
 namespace PathUtils
 {
+	namespace
+	{
+		std::optional<DirectoryEntry::Type>
+		getEntryType(mode_t mode)
+		{
+			if (S_ISREG(mode))
+				return DirectoryEntry::Type::Regular;
+			if (S_ISDIR(mode))
+				return DirectoryEntry::Type::Directory;
+
+			return std::nullopt;
+		}
+
+		// Errors are always reported
+		bool
+		acceptEntry(const DirectoryEntry& entry, const ExploreParameters& params)
+		{
+			return entry.ec || entry.type == DirectoryEntry::Type::Directory || !params.fileFilter || params.fileFilter(entry.path);
+		}
+
+#if defined(__linux__)
+		class FdGuard
+		{
+			public:
+				FdGuard(int fd) : _fd {fd} {}
+				~FdGuard() { if (_fd >= 0) ::close(_fd); }
+
+				FdGuard(const FdGuard&) = delete;
+				FdGuard& operator=(const FdGuard&) = delete;
+
+				int get() const { return _fd; }
+
+			private:
+				const int _fd;
+		};
+
+		// symlinks are followed
+		std::error_code
+		statEntry(int dirFd, const char* name, bool withFileInfo, std::optional<DirectoryEntry::Type>& type, FileInfo& fileInfo)
+		{
+#if defined(STATX_TYPE)
+			// only ask for what is needed: network filesystems may then answer from their attribute cache
+			struct statx stx {};
+			if (::statx(dirFd, name, AT_STATX_SYNC_AS_STAT, STATX_TYPE | (withFileInfo ? STATX_MTIME | STATX_SIZE | STATX_INO : 0), &stx) == 0)
+			{
+				type = getEntryType(stx.stx_mode);
+				fileInfo = FileInfo {Wt::WDateTime::fromTime_t(stx.stx_mtime.tv_sec), static_cast<std::uintmax_t>(stx.stx_size)};
+				if (stx.stx_mask & STATX_INO)
+				{
+					fileInfo.device = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+					fileInfo.inode = stx.stx_ino;
+				}
+				return {};
+			}
+			if (errno != ENOSYS)
+				return std::error_code {errno, std::generic_category()};
+#endif
+			struct stat sb {};
+			if (::fstatat(dirFd, name, &sb, 0) != 0)
+				return std::error_code {errno, std::generic_category()};
+
+			type = getEntryType(sb.st_mode);
+			fileInfo = FileInfo {Wt::WDateTime::fromTime_t(sb.st_mtime), static_cast<std::uintmax_t>(sb.st_size), static_cast<std::uint64_t>(sb.st_dev), static_cast<std::uint64_t>(sb.st_ino)};
+			return {};
+		}
+
+		// nullopt if the directory is excluded
+		// Uses large getdents64 reads, and the entry types they provide to avoid most stat calls
+		std::optional<DirectoryListing>
+		readDirectory(const std::filesystem::path& directory, const ExploreParameters& params)
+		{
+			DirectoryListing listing;
+			listing.directory = directory;
+
+			const FdGuard dirFd {::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+			if (dirFd.get() < 0)
+			{
+				listing.ec = std::error_code {errno, std::generic_category()};
+				return listing;
+			}
+
+			{
+				struct stat sb {};
+				if (::fstat(dirFd.get(), &sb) == 0)
+					listing.lastWriteTime = Wt::WDateTime::fromTime_t(sb.st_mtime);
+			}
+
+			const std::string excludeDirFileName {params.excludeDirFileName ? params.excludeDirFileName->string() : ""};
+
+			std::vector<std::uint64_t> buffer(64 * 1024 / sizeof(std::uint64_t)); // aligned for dirent64
+			while (true)
+			{
+				const long readSize {::syscall(SYS_getdents64, dirFd.get(), buffer.data(), buffer.size() * sizeof(std::uint64_t))};
+				if (readSize == 0)
+					break;
+				if (readSize < 0)
+				{
+					if (errno == EINTR)
+						continue;
+
+					listing.ec = std::error_code {errno, std::generic_category()};
+					break;
+				}
+
+				const char* data {reinterpret_cast<const char*>(buffer.data())};
+				for (long offset {}; offset < readSize;)
+				{
+					const struct dirent64* dirEntry {reinterpret_cast<const struct dirent64*>(data + offset)};
+					offset += dirEntry->d_reclen;
+
+					const char* name {dirEntry->d_name};
+					if (std::strcmp(name, ".") == 0 || std::strcmp(name, "..") == 0)
+						continue;
+
+					listing.entryCount++;
+
+					if (!excludeDirFileName.empty() && excludeDirFileName == name)
+						return std::nullopt;
+
+					DirectoryEntry entry;
+					entry.path = directory / name;
+
+					std::optional<DirectoryEntry::Type> type;
+					if (dirEntry->d_type == DT_REG)
+						type = DirectoryEntry::Type::Regular;
+					else if (dirEntry->d_type == DT_DIR)
+						type = DirectoryEntry::Type::Directory;
+					else if (dirEntry->d_type == DT_LNK || dirEntry->d_type == DT_UNKNOWN)
+					{
+						FileInfo fileInfo;
+						entry.ec = statEntry(dirFd.get(), name, params.getFileInfo, type, fileInfo);
+						if (entry.ec)
+							type = DirectoryEntry::Type::Regular; // report the error
+						else if (type == DirectoryEntry::Type::Regular && params.getFileInfo)
+							entry.fileInfo = fileInfo;
+					}
+
+					if (!type)
+						continue;
+
+					entry.type = *type;
+					if (!acceptEntry(entry, params))
+						continue;
+
+					if (entry.type == DirectoryEntry::Type::Regular && params.getFileInfo && !entry.fileInfo && !entry.ec)
+					{
+						FileInfo fileInfo;
+						entry.ec = statEntry(dirFd.get(), name, true, type, fileInfo);
+						if (!entry.ec)
+							entry.fileInfo = fileInfo;
+					}
+
+					listing.entries.push_back(std::move(entry));
+				}
+			}
+
+			return listing;
+		}
+#else
+		std::optional<DirectoryListing>
+		readDirectory(const std::filesystem::path& directory, const ExploreParameters& params)
+		{
+			DirectoryListing listing;
+			listing.directory = directory;
+
+			std::error_code ec;
+			std::filesystem::directory_iterator itPath {directory, std::filesystem::directory_options::follow_directory_symlink, ec};
+			if (ec)
+			{
+				listing.ec = ec;
+				return listing;
+			}
+
+			try
+			{
+				listing.lastWriteTime = getLastWriteTime(directory);
+			}
+			catch (const LmsException&)
+			{
+			}
+
+			for (std::filesystem::directory_iterator itEnd; itPath != itEnd; itPath.increment(ec))
+			{
+				if (ec)
+				{
+					listing.ec = ec;
+					break;
+				}
+
+				listing.entryCount++;
+
+				if (params.excludeDirFileName && !params.excludeDirFileName->empty() && itPath->path().filename() == *params.excludeDirFileName)
+					return std::nullopt;
+
+				DirectoryEntry entry;
+				entry.path = itPath->path();
+
+				if (itPath->is_regular_file(entry.ec))
+					entry.type = DirectoryEntry::Type::Regular;
+				else if (!entry.ec && itPath->is_directory(entry.ec))
+					entry.type = DirectoryEntry::Type::Directory;
+				else if (!entry.ec)
+					continue;
+
+				if (!acceptEntry(entry, params))
+					continue;
+
+				if (entry.type == DirectoryEntry::Type::Regular && params.getFileInfo && !entry.ec)
+				{
+					try
+					{
+						entry.fileInfo = getFileInfo(entry.path);
+					}
+					catch (const LmsException&)
+					{
+						entry.ec = std::make_error_code(std::errc::io_error);
+					}
+				}
+
+				listing.entries.push_back(std::move(entry));
+			}
+
+			return listing;
+		}
+#endif
+
+		std::optional<DirectoryListing>
+		listDirectory(const std::filesystem::path& directory, const ExploreParameters& params)
+		{
+			std::optional<DirectoryListing> listing {readDirectory(directory, params)};
+			if (listing)
+			{
+				std::sort(std::begin(listing->entries), std::end(listing->entries),
+						[](const DirectoryEntry& lhs, const DirectoryEntry& rhs) { return lhs.path < rhs.path; });
+			}
+
+			return listing;
+		}
+
+		// Reads directories on its own threads, results are kept until waited for
+		class DirectoryReader
+		{
+			public:
+				struct PendingRead
+				{
+					std::filesystem::path			directory;
+					bool							started {};
+					bool							done {};
+					std::optional<DirectoryListing>	listing;
+				};
+
+				DirectoryReader(const ExploreParameters& params)
+				: _params {params}
+				{
+					for (std::size_t i {}; i < std::max<std::size_t>(1, _params.readConcurrency); ++i)
+						_threads.emplace_back([this] { run(); });
+				}
+
+				~DirectoryReader()
+				{
+					{
+						const std::scoped_lock lock {_mutex};
+						_stop = true;
+					}
+					_requestCv.notify_all();
+
+					for (std::thread& thread : _threads)
+						thread.join();
+				}
+
+				DirectoryReader(const DirectoryReader&) = delete;
+				DirectoryReader& operator=(const DirectoryReader&) = delete;
+
+				std::shared_ptr<PendingRead>
+				read(const std::filesystem::path& directory)
+				{
+					auto pendingRead {std::make_shared<PendingRead>()};
+					pendingRead->directory = directory;
+
+					{
+						const std::scoped_lock lock {_mutex};
+						_requests.push_back(pendingRead);
+					}
+					_requestCv.notify_one();
+
+					return pendingRead;
+				}
+
+				std::optional<DirectoryListing>
+				wait(PendingRead& pendingRead)
+				{
+					std::unique_lock lock {_mutex};
+
+					// not started yet: better read it now than wait for the reads queued before it
+					if (!pendingRead.started)
+					{
+						pendingRead.started = true;
+						lock.unlock();
+
+						return listDirectory(pendingRead.directory, _params);
+					}
+
+					_resultCv.wait(lock, [&] { return pendingRead.done; });
+					return std::move(pendingRead.listing);
+				}
+
+			private:
+				void
+				run()
+				{
+					while (true)
+					{
+						std::shared_ptr<PendingRead> pendingRead;
+						{
+							std::unique_lock lock {_mutex};
+							_requestCv.wait(lock, [&] { return _stop || !_requests.empty(); });
+							if (_stop)
+								return;
+
+							pendingRead = std::move(_requests.front());
+							_requests.pop_front();
+							if (pendingRead->started)
+								continue;
+
+							pendingRead->started = true;
+						}
+
+						std::optional<DirectoryListing> listing {listDirectory(pendingRead->directory, _params)};
+
+						{
+							const std::scoped_lock lock {_mutex};
+							pendingRead->listing = std::move(listing);
+							pendingRead->done = true;
+						}
+						_resultCv.notify_all();
+					}
+				}
+
+				const ExploreParameters& _params;
+
+				std::mutex									_mutex;
+				std::condition_variable						_requestCv;
+				std::condition_variable						_resultCv;
+				std::deque<std::shared_ptr<PendingRead>>	_requests;
+				bool										_stop {};
+				std::vector<std::thread>					_threads;
+		};
+	}
 
 	std::uint32_t
 	computeCrc32(const std::filesystem::path& p)
@@ -82,62 +444,98 @@ namespace PathUtils
 		return Wt::WDateTime::fromTime_t(sb.st_mtime);
 	}
 
+	FileInfo
+	getFileInfo(const std::filesystem::path& file)
+	{
+		struct stat sb {};
+
+		if (stat(file.string().c_str(), &sb) == -1)
+			throw LmsException("Failed to get stats on file '" + file.string() + "'" );
+
+		return FileInfo {Wt::WDateTime::fromTime_t(sb.st_mtime), static_cast<std::uintmax_t>(sb.st_size), static_cast<std::uint64_t>(sb.st_dev), static_cast<std::uint64_t>(sb.st_ino)};
+	}
+
 	bool
-	exploreFilesRecursive(const std::filesystem::path& directory, std::function<bool(std::error_code, const std::filesystem::path&)> cb, const std::filesystem::path* excludeDirFileName)
+	exploreDirectoriesRecursive(const std::filesystem::path& directory, std::function<bool(const DirectoryListing&)> cb, const ExploreParameters& params)
 	{
-		std::error_code ec;
-		std::filesystem::directory_iterator itPath {directory, std::filesystem::directory_options::follow_directory_symlink, ec};
+		// Listings ready or being read ahead, not yet reported
+		const std::size_t maxPendingReadCount {2 * std::max<std::size_t>(1, params.readConcurrency)};
 
-		if (ec)
+		struct StackEntry
 		{
-			cb(ec, directory);
-			return true; // try to continue exploring anyway
-		}
+			std::filesystem::path							directory;
+			std::shared_ptr<DirectoryReader::PendingRead>	pendingRead; // null if not read ahead
+		};
 
-		if (excludeDirFileName && !excludeDirFileName->empty())
-		{
-			const std::filesystem::path excludePath {directory / *excludeDirFileName};
+		DirectoryReader reader {params};
+		std::vector<StackEntry> stack {StackEntry {directory, {}}}; // next directory to report at the back
+		std::size_t pendingReadCount {};
 
-			if (std::filesystem::exists(excludePath, ec))
+		while (!stack.empty())
+		{
+			// read ahead the next directories to be reported
+			for (std::size_t i {stack.size()}; i > 0 && i + maxPendingReadCount > stack.size() && pendingReadCount < maxPendingReadCount; --i)
 			{
-				LMS_LOG(DBUPDATER, DEBUG) << "Found '" << excludePath.string() << "': skipping directory";
-				return true;
+				StackEntry& entry {stack[i - 1]};
+				if (!entry.pendingRead)
+				{
+					entry.pendingRead = reader.read(entry.directory);
+					pendingReadCount++;
+				}
 			}
-		}
 
-		std::filesystem::directory_iterator itEnd;
-		while (itPath != itEnd)
-		{
-			bool continueExploring {true};
+			StackEntry entry {std::move(stack.back())};
+			stack.pop_back();
 
-			if (ec)
+			std::optional<DirectoryListing> listing;
+			if (entry.pendingRead)
 			{
-				continueExploring = cb(ec, *itPath);
+				listing = reader.wait(*entry.pendingRead);
+				pendingReadCount--;
 			}
 			else
+				listing = listDirectory(entry.directory, params);
+
+			if (!listing)
 			{
-				if (std::filesystem::is_regular_file(*itPath, ec))
-				{
-					continueExploring = cb(ec, *itPath);
-				}
-				else if (std::filesystem::is_directory(*itPath, ec))
-				{
-					if (!ec)
-						continueExploring = exploreFilesRecursive(*itPath, cb, excludeDirFileName);
-					else
-						continueExploring = cb(ec, *itPath);
-				}
+				LMS_LOG(DBUPDATER, DEBUG) << "Found '" << (entry.directory / *params.excludeDirFileName).string() << "': skipping directory";
+				continue;
 			}
 
-			if (!continueExploring)
+			if (!cb(*listing))
 				return false;
 
-			itPath.increment(ec);
+			for (auto itEntry {std::crbegin(listing->entries)}; itEntry != std::crend(listing->entries); ++itEntry)
+			{
+				if (itEntry->type == DirectoryEntry::Type::Directory && !itEntry->ec)
+					stack.push_back(StackEntry {itEntry->path, {}});
+			}
 		}
 
 		return true;
 	}
 
+	bool
+	exploreFilesRecursive(const std::filesystem::path& directory, std::function<bool(std::error_code, const std::filesystem::path&)> cb, const std::filesystem::path* excludeDirFileName)
+	{
+		ExploreParameters params;
+		params.excludeDirFileName = excludeDirFileName;
+
+		return exploreDirectoriesRecursive(directory, [&](const DirectoryListing& listing)
+		{
+			if (listing.ec && !cb(listing.ec, listing.directory))
+				return false;
+
+			for (const DirectoryEntry& entry : listing.entries)
+			{
+				if ((entry.type == DirectoryEntry::Type::Regular || entry.ec) && !cb(entry.ec, entry.path))
+					return false;
+			}
+
+			return true;
+		}, params);
+	}
+
 	bool
 	hasFileAnyExtension(const std::filesystem::path& file, const std::vector<std::filesystem::path>& supportedExtensions)
 	{
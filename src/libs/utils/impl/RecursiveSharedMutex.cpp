@@ -19,22 +19,57 @@
 
 #include "utils/RecursiveSharedMutex.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <vector>
+
+namespace
+{
+	// A thread rarely holds more than a couple of these mutexes at the same time
+	struct SharedCount
+	{
+		const RecursiveSharedMutex* mutex;
+		std::size_t count;
+	};
+	thread_local std::vector<SharedCount> sharedCounts;
+
+	std::size_t&
+	getSharedCount(const RecursiveSharedMutex* mutex)
+	{
+		auto it {std::find_if(std::begin(sharedCounts), std::end(sharedCounts), [=](const SharedCount& sharedCount) { return sharedCount.mutex == mutex; })};
+		if (it == std::end(sharedCounts))
+			return sharedCounts.emplace_back(SharedCount {mutex, 0}).count;
+
+		return it->count;
+	}
+
+	std::size_t
+	findSharedCount(const RecursiveSharedMutex* mutex)
+	{
+		auto it {std::find_if(std::cbegin(sharedCounts), std::cend(sharedCounts), [=](const SharedCount& sharedCount) { return sharedCount.mutex == mutex; })};
+		return it == std::cend(sharedCounts) ? 0 : it->count;
+	}
+
+	void
+	removeSharedCount(const RecursiveSharedMutex* mutex)
+	{
+		sharedCounts.erase(std::remove_if(std::begin(sharedCounts), std::end(sharedCounts), [=](const SharedCount& sharedCount) { return sharedCount.mutex == mutex; }), std::end(sharedCounts));
+	}
+}
 
 void
 RecursiveSharedMutex::lock()
 {
-	const auto thisThreadId {std::this_thread::get_id()};
-
-	if (_uniqueOwner == thisThreadId)
+	if (isUniqueOwner())
 	{
 		// already locked
 		_uniqueCount++;
 	}
 	else
 	{
+		assert(findSharedCount(this) == 0); // cannot upgrade a shared lock
 		_mutex.lock();
-		_uniqueOwner = thisThreadId;
+		_uniqueOwner.store(std::this_thread::get_id(), std::memory_order_relaxed);
 		assert(_uniqueCount == 0);
 		_uniqueCount = 1;
 	}
@@ -47,91 +82,51 @@ RecursiveSharedMutex::unlock()
 
 	if (--_uniqueCount == 0)
 	{
-		_uniqueOwner = {};
+		_uniqueOwner.store(std::thread::id {}, std::memory_order_relaxed);
 		_mutex.unlock();
+
+		// shared locks acquired in the meantime are still held
+		if (findSharedCount(this) > 0)
+			_mutex.lock_shared();
 	}
 }
 
 void
 RecursiveSharedMutex::lock_shared()
 {
-	const auto thisThreadId {std::this_thread::get_id()};
-
-	if (_uniqueOwner == thisThreadId )
-	{
-		// alone here, no need to lock
-		_sharedCounts[thisThreadId]++;
-
-		return;
-	}
-
-	bool needLock {};
-
-	{
-		std::scoped_lock lock {_sharedCountMutex};
+	std::size_t& sharedCount {getSharedCount(this)};
 
-		auto& sharedCount {_sharedCounts[thisThreadId]};
-		if (sharedCount == 0)
-			needLock = true;
-		else
-			++sharedCount;
-	}
-
-	if (needLock)
-	{
+	// alone here if unique owner, no need to lock
+	if (sharedCount == 0 && !isUniqueOwner())
 		_mutex.lock_shared();
 
-		assert(_uniqueOwner == std::thread::id {});
-
-		std::scoped_lock lock {_sharedCountMutex};
-		_sharedCounts[thisThreadId]++;
-	}
+	sharedCount++;
 }
 
 void
 RecursiveSharedMutex::unlock_shared()
 {
-	const auto thisThreadId {std::this_thread::get_id()};
-
-	if (_uniqueOwner == thisThreadId )
-	{
-		// alone here, no need to lock
-		auto& sharedCount {_sharedCounts[thisThreadId ]};
-		assert(sharedCount > 0);
-		--sharedCount;
+	std::size_t& sharedCount {getSharedCount(this)};
+	assert(sharedCount > 0);
 
+	if (--sharedCount > 0)
 		return;
-	}
 
-	bool needUnlock {};
-
-	{
-		std::scoped_lock lock {_sharedCountMutex};
-
-		auto& sharedCount {_sharedCounts[thisThreadId]};
-		assert(sharedCount > 0);
-		needUnlock = (--sharedCount == 0);
-	}
-
-	if (needUnlock)
+	removeSharedCount(this);
+	if (!isUniqueOwner())
 		_mutex.unlock_shared();
 }
 
 #ifndef NDEBUG
 bool
-RecursiveSharedMutex::isUniqueLocked()
+RecursiveSharedMutex::isUniqueLocked() const
 {
-	return _uniqueOwner == std::this_thread::get_id();
+	return isUniqueOwner();
 }
 
 bool
-RecursiveSharedMutex::isSharedLocked()
+RecursiveSharedMutex::isSharedLocked() const
 {
-	const auto thisThreadId {std::this_thread::get_id()};
-	if (_uniqueOwner == thisThreadId )
-		return true;
-
-	std::scoped_lock lock {_sharedCountMutex};
-	return _sharedCounts[thisThreadId] > 0;
+	return isUniqueOwner() || findSharedCount(this) > 0;
 }
 #endif
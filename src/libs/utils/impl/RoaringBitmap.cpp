@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/RoaringBitmap.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+void
+RoaringBitmap::Container::add(std::uint16_t value)
+{
+	if (isBitset())
+	{
+		std::uint64_t& word {bitset[value / 64]};
+		const std::uint64_t mask {std::uint64_t {1} << (value % 64)};
+		if (!(word & mask))
+		{
+			word |= mask;
+			cardinality++;
+		}
+		return;
+	}
+
+	if (array.empty() || array.back() < value)
+		array.push_back(value);
+	else
+	{
+		auto it {std::lower_bound(std::begin(array), std::end(array), value)};
+		if (*it == value)
+			return;
+		array.insert(it, value);
+	}
+
+	cardinality++;
+	if (array.size() > maxArraySize)
+		convertToBitset();
+}
+
+bool
+RoaringBitmap::Container::contains(std::uint16_t value) const
+{
+	if (isBitset())
+		return bitset[value / 64] & (std::uint64_t {1} << (value % 64));
+
+	return std::binary_search(std::cbegin(array), std::cend(array), value);
+}
+
+void
+RoaringBitmap::Container::convertToBitset()
+{
+	bitset.assign(bitsetWordCount, 0);
+	for (const std::uint16_t value : array)
+		bitset[value / 64] |= std::uint64_t {1} << (value % 64);
+
+	array.clear();
+	array.shrink_to_fit();
+}
+
+void
+RoaringBitmap::Container::convertToArray()
+{
+	array.clear();
+	array.reserve(cardinality);
+	for (std::size_t wordIndex {}; wordIndex < bitsetWordCount; ++wordIndex)
+	{
+		std::uint64_t word {bitset[wordIndex]};
+		while (word)
+		{
+			array.push_back(static_cast<std::uint16_t>(wordIndex * 64 + __builtin_ctzll(word)));
+			word &= word - 1;
+		}
+	}
+
+	bitset.clear();
+	bitset.shrink_to_fit();
+}
+
+RoaringBitmap::Container*
+RoaringBitmap::findContainer(std::uint16_t key)
+{
+	return const_cast<Container*>(static_cast<const RoaringBitmap&>(*this).findContainer(key));
+}
+
+const RoaringBitmap::Container*
+RoaringBitmap::findContainer(std::uint16_t key) const
+{
+	auto it {std::lower_bound(std::cbegin(_containers), std::cend(_containers), key, [](const Container& container, std::uint16_t key) { return container.key < key; })};
+	if (it == std::cend(_containers) || it->key != key)
+		return nullptr;
+
+	return &(*it);
+}
+
+void
+RoaringBitmap::add(value_type value)
+{
+	const std::uint16_t key {static_cast<std::uint16_t>(value >> 16)};
+	const std::uint16_t low {static_cast<std::uint16_t>(value & 0xFFFF)};
+
+	if (_containers.empty() || _containers.back().key < key)
+	{
+		Container& container {_containers.emplace_back()};
+		container.key = key;
+		container.add(low);
+		return;
+	}
+
+	if (Container* container {findContainer(key)})
+	{
+		container->add(low);
+		return;
+	}
+
+	auto it {std::lower_bound(std::begin(_containers), std::end(_containers), key, [](const Container& container, std::uint16_t key) { return container.key < key; })};
+	it = _containers.insert(it, Container {});
+	it->key = key;
+	it->add(low);
+}
+
+bool
+RoaringBitmap::contains(value_type value) const
+{
+	const Container* container {findContainer(static_cast<std::uint16_t>(value >> 16))};
+	return container && container->contains(static_cast<std::uint16_t>(value & 0xFFFF));
+}
+
+std::size_t
+RoaringBitmap::size() const
+{
+	std::size_t res {};
+	for (const Container& container : _containers)
+		res += container.cardinality;
+
+	return res;
+}
+
+std::vector<RoaringBitmap::value_type>
+RoaringBitmap::toVector() const
+{
+	std::vector<value_type> res;
+	res.reserve(size());
+	visit([&](value_type value) { res.push_back(value); });
+
+	return res;
+}
+
+std::size_t
+RoaringBitmap::getMemoryUsage() const
+{
+	std::size_t res {sizeof(*this) + _containers.capacity() * sizeof(Container)};
+	for (const Container& container : _containers)
+		res += container.array.capacity() * sizeof(std::uint16_t) + container.bitset.capacity() * sizeof(std::uint64_t);
+
+	return res;
+}
+
+RoaringBitmap::Container
+RoaringBitmap::intersect(const Container& a, const Container& b)
+{
+	assert(a.key == b.key);
+
+	Container res;
+	res.key = a.key;
+
+	if (a.isBitset() && b.isBitset())
+	{
+		res.bitset.resize(bitsetWordCount);
+		for (std::size_t wordIndex {}; wordIndex < bitsetWordCount; ++wordIndex)
+		{
+			res.bitset[wordIndex] = a.bitset[wordIndex] & b.bitset[wordIndex];
+			res.cardinality += __builtin_popcountll(res.bitset[wordIndex]);
+		}
+
+		if (res.cardinality <= maxArraySize)
+			res.convertToArray();
+	}
+	else if (a.isBitset() || b.isBitset())
+	{
+		const Container& arrayContainer {a.isBitset() ? b : a};
+		const Container& bitsetContainer {a.isBitset() ? a : b};
+
+		for (const std::uint16_t value : arrayContainer.array)
+		{
+			if (bitsetContainer.contains(value))
+				res.array.push_back(value);
+		}
+		res.cardinality = res.array.size();
+	}
+	else
+	{
+		std::set_intersection(std::cbegin(a.array), std::cend(a.array), std::cbegin(b.array), std::cend(b.array), std::back_inserter(res.array));
+		res.cardinality = res.array.size();
+	}
+
+	return res;
+}
+
+RoaringBitmap
+RoaringBitmap::intersect(const RoaringBitmap& a, const RoaringBitmap& b)
+{
+	RoaringBitmap res;
+
+	auto itA {std::cbegin(a._containers)};
+	auto itB {std::cbegin(b._containers)};
+	while (itA != std::cend(a._containers) && itB != std::cend(b._containers))
+	{
+		if (itA->key < itB->key)
+			++itA;
+		else if (itB->key < itA->key)
+			++itB;
+		else
+		{
+			Container container {intersect(*itA, *itB)};
+			if (container.cardinality > 0)
+				res._containers.push_back(std::move(container));
+			++itA;
+			++itB;
+		}
+	}
+
+	return res;
+}
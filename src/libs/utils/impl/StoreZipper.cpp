@@ -0,0 +1,549 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "StoreZipper.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring> // strerror
+#include <ctime>
+#include <ostream>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils/Logger.hpp"
+
+namespace Zip
+{
+	namespace
+	{
+		class FileException : public Exception
+		{
+			public:
+				FileException(const std::filesystem::path& p, std::string_view message)
+					: Exception {"File '" + p.string() + "': " + std::string {message}}
+				{}
+
+				FileException(const std::filesystem::path& p, std::string_view message, int err)
+					: Exception {"File '" + p.string() + "': " + std::string {message} + ": " + ::strerror(err)}
+				{}
+		};
+
+		constexpr std::uint32_t localHeaderSignature {0x04034b50};
+		constexpr std::uint32_t dataDescriptorSignature {0x08074b50};
+		constexpr std::uint32_t centralHeaderSignature {0x02014b50};
+		constexpr std::uint32_t zip64EndOfCentralDirectorySignature {0x06064b50};
+		constexpr std::uint32_t zip64EndOfCentralDirectoryLocatorSignature {0x07064b50};
+		constexpr std::uint32_t endOfCentralDirectorySignature {0x06054b50};
+
+		constexpr std::uint16_t zip64ExtraFieldId {0x0001};
+		constexpr std::uint16_t flags {0x0008 /* data descriptor */ | 0x0800 /* UTF-8 names */};
+		constexpr std::uint16_t versionNeeded {20};
+		constexpr std::uint16_t versionNeededZip64 {45};
+		constexpr std::uint16_t versionMadeBy {(3 << 8) /* unix */ | versionNeededZip64};
+		constexpr std::uint32_t max32 {0xFFFFFFFF};
+		constexpr std::uint16_t max16 {0xFFFF};
+
+		// fixed parts of the records, see APPNOTE.TXT
+		constexpr std::size_t localHeaderSize {30};
+		constexpr std::size_t centralHeaderSize {46};
+		constexpr std::size_t zip64EndOfCentralDirectorySize {56};
+		constexpr std::size_t zip64EndOfCentralDirectoryLocatorSize {20};
+		constexpr std::size_t endOfCentralDirectorySize {22};
+
+		template <typename T>
+		void writeLE(std::string& output, T value)
+		{
+			for (std::size_t i {}; i < sizeof(T); ++i)
+				output.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+		}
+
+		std::size_t getLocalHeaderSize(const std::string& name, bool zip64)
+		{
+			return localHeaderSize + name.size() + (zip64 ? 20 : 0);
+		}
+
+		std::size_t getDataDescriptorSize(bool zip64)
+		{
+			return zip64 ? 24 : 16;
+		}
+
+		std::size_t getCentralHeaderExtraFieldCount(bool zip64, std::uint64_t localHeaderOffset)
+		{
+			return (zip64 ? 2 : 0) + (localHeaderOffset >= max32 ? 1 : 0);
+		}
+
+		std::size_t getCentralHeaderSize(const std::string& name, bool zip64, std::uint64_t localHeaderOffset)
+		{
+			const std::size_t extraFieldCount {getCentralHeaderExtraFieldCount(zip64, localHeaderOffset)};
+			return centralHeaderSize + name.size() + (extraFieldCount > 0 ? 4 + 8 * extraFieldCount : 0);
+		}
+
+		bool needsZip64EndOfCentralDirectory(std::size_t entryCount, std::uint64_t centralDirectoryOffset, std::uint64_t centralDirectorySize)
+		{
+			return entryCount >= max16 || centralDirectoryOffset >= max32 || centralDirectorySize >= max32;
+		}
+
+		void toDosDateTime(std::time_t time, std::uint16_t& dosDate, std::uint16_t& dosTime)
+		{
+			std::tm tm {};
+			if (!::localtime_r(&time, &tm) || tm.tm_year < 80)
+			{
+				// DOS dates start in 1980
+				dosDate = (1 << 5) | 1;
+				dosTime = 0;
+				return;
+			}
+
+			dosDate = static_cast<std::uint16_t>(((tm.tm_year - 80) << 9) | ((tm.tm_mon + 1) << 5) | tm.tm_mday);
+			dosTime = static_cast<std::uint16_t>((tm.tm_hour << 11) | (tm.tm_min << 5) | (tm.tm_sec / 2));
+		}
+	}
+
+	std::unique_ptr<IZipper>
+	createStoreZipper(const EntryContainer& entries)
+	{
+		return std::make_unique<StoreZipper>(entries);
+	}
+
+	StoreZipper::StoreZipper(const EntryContainer& entries)
+		: _readBuffer(_readBufferSize)
+	{
+		_files.reserve(entries.size());
+		for (const Entry& entry : entries)
+		{
+			struct ::stat fileStat;
+			if (::stat(entry.filePath.c_str(), &fileStat) == -1)
+				throw FileException {entry.filePath, "cannot stat file", errno};
+			if (!S_ISREG(fileStat.st_mode))
+				throw FileException {entry.filePath, "not a regular file"};
+			if (entry.fileName.size() > max16)
+				throw FileException {entry.filePath, "name too long"};
+
+			FileInfo& file {_files.emplace_back()};
+			file.path = entry.filePath;
+			file.name = entry.fileName;
+			file.size = static_cast<std::uint64_t>(fileStat.st_size);
+			file.mode = S_IFREG | (fileStat.st_mode & 0777);
+			file.zip64 = file.size >= max32;
+			toDosDateTime(fileStat.st_mtime, file.dosDate, file.dosTime);
+		}
+
+		computeLayout();
+		_end = _totalSize;
+
+		LMS_LOG(UTILS, DEBUG) << "Zip archive of " << _files.size() << " files, total size = " << _totalSize;
+	}
+
+	StoreZipper::~StoreZipper()
+	{
+		closeFiles();
+	}
+
+	void
+	StoreZipper::computeLayout()
+	{
+		std::uint64_t offset {};
+		auto addSegment {[&](SegmentType type, std::size_t fileIndex, std::uint64_t size)
+		{
+			if (size == 0)
+				return;
+
+			_segments.push_back(Segment {type, fileIndex, offset, size});
+			offset += size;
+		}};
+
+		for (std::size_t fileIndex {}; fileIndex < _files.size(); ++fileIndex)
+		{
+			FileInfo& file {_files[fileIndex]};
+
+			file.localHeaderOffset = offset;
+			addSegment(SegmentType::LocalHeader, fileIndex, getLocalHeaderSize(file.name, file.zip64));
+			addSegment(SegmentType::FileData, fileIndex, file.size);
+			addSegment(SegmentType::DataDescriptor, fileIndex, getDataDescriptorSize(file.zip64));
+		}
+
+		const std::uint64_t centralDirectoryOffset {offset};
+		std::uint64_t centralDirectorySize {};
+		for (const FileInfo& file : _files)
+			centralDirectorySize += getCentralHeaderSize(file.name, file.zip64, file.localHeaderOffset);
+
+		std::uint64_t endRecordsSize {endOfCentralDirectorySize};
+		if (needsZip64EndOfCentralDirectory(_files.size(), centralDirectoryOffset, centralDirectorySize))
+			endRecordsSize += zip64EndOfCentralDirectorySize + zip64EndOfCentralDirectoryLocatorSize;
+
+		addSegment(SegmentType::CentralDirectory, 0, centralDirectorySize + endRecordsSize);
+		_totalSize = offset;
+	}
+
+	std::string
+	StoreZipper::createLocalHeader(const FileInfo& file) const
+	{
+		std::string header;
+		header.reserve(getLocalHeaderSize(file.name, file.zip64));
+
+		writeLE<std::uint32_t>(header, localHeaderSignature);
+		writeLE<std::uint16_t>(header, file.zip64 ? versionNeededZip64 : versionNeeded);
+		writeLE<std::uint16_t>(header, flags);
+		writeLE<std::uint16_t>(header, 0); // stored
+		writeLE<std::uint16_t>(header, file.dosTime);
+		writeLE<std::uint16_t>(header, file.dosDate);
+		writeLE<std::uint32_t>(header, 0); // crc, in the data descriptor
+		// sizes are already known, so that readers can skip the data without the central directory
+		writeLE<std::uint32_t>(header, file.zip64 ? max32 : static_cast<std::uint32_t>(file.size));
+		writeLE<std::uint32_t>(header, file.zip64 ? max32 : static_cast<std::uint32_t>(file.size));
+		writeLE<std::uint16_t>(header, static_cast<std::uint16_t>(file.name.size()));
+		writeLE<std::uint16_t>(header, file.zip64 ? 20 : 0);
+		header += file.name;
+		if (file.zip64)
+		{
+			writeLE<std::uint16_t>(header, zip64ExtraFieldId);
+			writeLE<std::uint16_t>(header, 16);
+			writeLE<std::uint64_t>(header, file.size);
+			writeLE<std::uint64_t>(header, file.size);
+		}
+
+		assert(header.size() == getLocalHeaderSize(file.name, file.zip64));
+		return header;
+	}
+
+	std::string
+	StoreZipper::createDataDescriptor(FileInfo& file)
+	{
+		std::string descriptor;
+		descriptor.reserve(getDataDescriptorSize(file.zip64));
+
+		writeLE<std::uint32_t>(descriptor, dataDescriptorSignature);
+		writeLE<std::uint32_t>(descriptor, getCrc(file));
+		if (file.zip64)
+		{
+			writeLE<std::uint64_t>(descriptor, file.size);
+			writeLE<std::uint64_t>(descriptor, file.size);
+		}
+		else
+		{
+			writeLE<std::uint32_t>(descriptor, static_cast<std::uint32_t>(file.size));
+			writeLE<std::uint32_t>(descriptor, static_cast<std::uint32_t>(file.size));
+		}
+
+		assert(descriptor.size() == getDataDescriptorSize(file.zip64));
+		return descriptor;
+	}
+
+	std::string
+	StoreZipper::createCentralDirectory()
+	{
+		const Segment& segment {_segments.back()};
+		assert(segment.type == SegmentType::CentralDirectory);
+
+		std::string centralDirectory;
+		centralDirectory.reserve(segment.size);
+
+		for (FileInfo& file : _files)
+		{
+			const std::size_t extraFieldCount {getCentralHeaderExtraFieldCount(file.zip64, file.localHeaderOffset)};
+
+			writeLE<std::uint32_t>(centralDirectory, centralHeaderSignature);
+			writeLE<std::uint16_t>(centralDirectory, versionMadeBy);
+			writeLE<std::uint16_t>(centralDirectory, extraFieldCount > 0 ? versionNeededZip64 : versionNeeded);
+			writeLE<std::uint16_t>(centralDirectory, flags);
+			writeLE<std::uint16_t>(centralDirectory, 0); // stored
+			writeLE<std::uint16_t>(centralDirectory, file.dosTime);
+			writeLE<std::uint16_t>(centralDirectory, file.dosDate);
+			writeLE<std::uint32_t>(centralDirectory, getCrc(file));
+			writeLE<std::uint32_t>(centralDirectory, file.zip64 ? max32 : static_cast<std::uint32_t>(file.size));
+			writeLE<std::uint32_t>(centralDirectory, file.zip64 ? max32 : static_cast<std::uint32_t>(file.size));
+			writeLE<std::uint16_t>(centralDirectory, static_cast<std::uint16_t>(file.name.size()));
+			writeLE<std::uint16_t>(centralDirectory, static_cast<std::uint16_t>(extraFieldCount > 0 ? 4 + 8 * extraFieldCount : 0));
+			writeLE<std::uint16_t>(centralDirectory, 0); // comment length
+			writeLE<std::uint16_t>(centralDirectory, 0); // disk number
+			writeLE<std::uint16_t>(centralDirectory, 0); // internal attributes
+			writeLE<std::uint32_t>(centralDirectory, file.mode << 16); // external attributes
+			writeLE<std::uint32_t>(centralDirectory, file.localHeaderOffset >= max32 ? max32 : static_cast<std::uint32_t>(file.localHeaderOffset));
+			centralDirectory += file.name;
+			if (extraFieldCount > 0)
+			{
+				writeLE<std::uint16_t>(centralDirectory, zip64ExtraFieldId);
+				writeLE<std::uint16_t>(centralDirectory, static_cast<std::uint16_t>(8 * extraFieldCount));
+				if (file.zip64)
+				{
+					writeLE<std::uint64_t>(centralDirectory, file.size);
+					writeLE<std::uint64_t>(centralDirectory, file.size);
+				}
+				if (file.localHeaderOffset >= max32)
+					writeLE<std::uint64_t>(centralDirectory, file.localHeaderOffset);
+			}
+		}
+
+		const std::uint64_t centralDirectoryOffset {segment.offset};
+		const std::uint64_t centralDirectorySize {centralDirectory.size()};
+		const std::uint64_t entryCount {_files.size()};
+		const bool zip64 {needsZip64EndOfCentralDirectory(_files.size(), centralDirectoryOffset, centralDirectorySize)};
+
+		if (zip64)
+		{
+			writeLE<std::uint32_t>(centralDirectory, zip64EndOfCentralDirectorySignature);
+			writeLE<std::uint64_t>(centralDirectory, zip64EndOfCentralDirectorySize - 12); // size of the remaining record
+			writeLE<std::uint16_t>(centralDirectory, versionMadeBy);
+			writeLE<std::uint16_t>(centralDirectory, versionNeededZip64);
+			writeLE<std::uint32_t>(centralDirectory, 0); // disk number
+			writeLE<std::uint32_t>(centralDirectory, 0); // disk with the central directory
+			writeLE<std::uint64_t>(centralDirectory, entryCount);
+			writeLE<std::uint64_t>(centralDirectory, entryCount);
+			writeLE<std::uint64_t>(centralDirectory, centralDirectorySize);
+			writeLE<std::uint64_t>(centralDirectory, centralDirectoryOffset);
+
+			writeLE<std::uint32_t>(centralDirectory, zip64EndOfCentralDirectoryLocatorSignature);
+			writeLE<std::uint32_t>(centralDirectory, 0); // disk with the zip64 end of central directory
+			writeLE<std::uint64_t>(centralDirectory, centralDirectoryOffset + centralDirectorySize);
+			writeLE<std::uint32_t>(centralDirectory, 1); // total number of disks
+		}
+
+		writeLE<std::uint32_t>(centralDirectory, endOfCentralDirectorySignature);
+		writeLE<std::uint16_t>(centralDirectory, 0); // disk number
+		writeLE<std::uint16_t>(centralDirectory, 0); // disk with the central directory
+		writeLE<std::uint16_t>(centralDirectory, static_cast<std::uint16_t>(std::min<std::uint64_t>(entryCount, max16)));
+		writeLE<std::uint16_t>(centralDirectory, static_cast<std::uint16_t>(std::min<std::uint64_t>(entryCount, max16)));
+		writeLE<std::uint32_t>(centralDirectory, static_cast<std::uint32_t>(std::min<std::uint64_t>(centralDirectorySize, max32)));
+		writeLE<std::uint32_t>(centralDirectory, static_cast<std::uint32_t>(std::min<std::uint64_t>(centralDirectoryOffset, max32)));
+		writeLE<std::uint16_t>(centralDirectory, 0); // comment length
+
+		assert(centralDirectory.size() == segment.size);
+		return centralDirectory;
+	}
+
+	std::uint64_t
+	StoreZipper::writeSome(std::ostream& output)
+	{
+		std::uint64_t totalWrittenBytes {};
+
+		while (totalWrittenBytes < _writeSize && _offset < _end)
+		{
+			while (_segments[_currentSegment].offset + _segments[_currentSegment].size <= _offset)
+				_currentSegment++;
+
+			const Segment& segment {_segments[_currentSegment]};
+			const std::uint64_t segmentOffset {_offset - segment.offset};
+			const std::uint64_t bytesToWrite {std::min({segment.size - segmentOffset, _end - _offset, _writeSize - totalWrittenBytes})};
+
+			auto writeString {[&](const std::string& str)
+			{
+				output.write(str.data() + segmentOffset, bytesToWrite);
+				return bytesToWrite;
+			}};
+
+			std::uint64_t writtenBytes {};
+			switch (segment.type)
+			{
+				case SegmentType::LocalHeader:
+					writtenBytes = writeString(createLocalHeader(_files[segment.fileIndex]));
+					break;
+
+				case SegmentType::FileData:
+					writtenBytes = writeFileData(output, segment.fileIndex, segmentOffset, bytesToWrite);
+					break;
+
+				case SegmentType::DataDescriptor:
+					writtenBytes = writeString(createDataDescriptor(_files[segment.fileIndex]));
+					break;
+
+				case SegmentType::CentralDirectory:
+					closeFiles();
+					if (_centralDirectory.empty())
+						_centralDirectory = createCentralDirectory();
+					writtenBytes = writeString(_centralDirectory);
+					break;
+			}
+
+			if (!output)
+				throw Exception {"Failed to write " + std::to_string(writtenBytes) + " bytes in final archive output!"};
+
+			_offset += writtenBytes;
+			totalWrittenBytes += writtenBytes;
+		}
+
+		if (isComplete())
+			closeFiles();
+
+		return totalWrittenBytes;
+	}
+
+	bool
+	StoreZipper::isComplete() const
+	{
+		return _offset >= _end;
+	}
+
+	void
+	StoreZipper::abort()
+	{
+		LMS_LOG(UTILS, DEBUG) << "Aborting zip creation";
+		closeFiles();
+		_offset = _end;
+	}
+
+	void
+	StoreZipper::setRange(std::uint64_t offset, std::uint64_t size)
+	{
+		assert(offset + size <= _totalSize);
+
+		_offset = offset;
+		_end = offset + size;
+
+		auto itSegment {std::upper_bound(std::cbegin(_segments), std::cend(_segments), offset, [](std::uint64_t offset, const Segment& segment) { return offset < segment.offset; })};
+		_currentSegment = itSegment == std::cbegin(_segments) ? 0 : std::distance(std::cbegin(_segments), itSegment) - 1;
+	}
+
+	std::uint64_t
+	StoreZipper::writeFileData(std::ostream& output, std::size_t fileIndex, std::uint64_t fileOffset, std::uint64_t size)
+	{
+		FileInfo& file {_files[fileIndex]};
+
+		openFile(fileIndex);
+
+		const std::size_t bytesToRead {static_cast<std::size_t>(std::min<std::uint64_t>(size, _readBuffer.size()))};
+		readFile(_currentFd, file.path, fileOffset, bytesToRead);
+
+		// sequential access: compute the crc on the fly
+		if (file.crcOffset == fileOffset)
+		{
+			file.crc.processBytes(_readBuffer.data(), bytesToRead);
+			file.crcOffset += bytesToRead;
+		}
+
+		output.write(reinterpret_cast<const char*>(_readBuffer.data()), bytesToRead);
+		return bytesToRead;
+	}
+
+	void
+	StoreZipper::openFile(std::size_t fileIndex)
+	{
+		if (_currentFd != -1 && _currentFileIndex == fileIndex)
+			return;
+
+		const std::size_t nextFileIndex {_currentFileIndex + 1};
+		if (_currentFd != -1)
+		{
+			::close(_currentFd);
+			_currentFd = -1;
+		}
+
+		const FileInfo& file {_files[fileIndex]};
+		if (_nextFd != -1 && nextFileIndex == fileIndex)
+		{
+			_currentFd = _nextFd;
+			_nextFd = -1;
+		}
+		else
+		{
+			closeFiles();
+			_currentFd = ::open(file.path.c_str(), O_RDONLY | O_CLOEXEC);
+			if (_currentFd == -1)
+				throw FileException {file.path, "cannot open file", errno};
+		}
+		_currentFileIndex = fileIndex;
+
+		// the layout relies on the size
+		struct ::stat fileStat;
+		if (::fstat(_currentFd, &fileStat) == -1)
+			throw FileException {file.path, "cannot stat file", errno};
+		if (static_cast<std::uint64_t>(fileStat.st_size) != file.size)
+			throw FileException {file.path, "size changed"};
+
+		::posix_fadvise(_currentFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+		// let the kernel read the beginning of the next file while this one is being sent
+		if (fileIndex + 1 < _files.size())
+		{
+			const FileInfo& nextFile {_files[fileIndex + 1]};
+			_nextFd = ::open(nextFile.path.c_str(), O_RDONLY | O_CLOEXEC);
+			if (_nextFd != -1)
+				::posix_fadvise(_nextFd, 0, static_cast<::off_t>(std::min<std::uint64_t>(nextFile.size, _nextFileReadAheadSize)), POSIX_FADV_WILLNEED);
+		}
+	}
+
+	void
+	StoreZipper::closeFiles()
+	{
+		if (_currentFd != -1)
+		{
+			::close(_currentFd);
+			_currentFd = -1;
+		}
+		if (_nextFd != -1)
+		{
+			::close(_nextFd);
+			_nextFd = -1;
+		}
+	}
+
+	std::uint32_t
+	StoreZipper::getCrc(FileInfo& file)
+	{
+		// not (fully) sent sequentially, ranges requested
+		if (file.crcOffset < file.size)
+		{
+			LMS_LOG(UTILS, DEBUG) << "Computing crc of file '" << file.path.string() << "' from offset " << file.crcOffset;
+
+			const int fd {::open(file.path.c_str(), O_RDONLY | O_CLOEXEC)};
+			if (fd == -1)
+				throw FileException {file.path, "cannot open file", errno};
+
+			try
+			{
+				while (file.crcOffset < file.size)
+				{
+					const std::size_t bytesToRead {static_cast<std::size_t>(std::min<std::uint64_t>(file.size - file.crcOffset, _readBuffer.size()))};
+					readFile(fd, file.path, file.crcOffset, bytesToRead);
+					file.crc.processBytes(_readBuffer.data(), bytesToRead);
+					file.crcOffset += bytesToRead;
+				}
+			}
+			catch (const Exception&)
+			{
+				::close(fd);
+				throw;
+			}
+			::close(fd);
+		}
+
+		return file.crc.getResult();
+	}
+
+	void
+	StoreZipper::readFile(int fd, const std::filesystem::path& path, std::uint64_t offset, std::size_t size)
+	{
+		std::size_t readBytes {};
+		while (readBytes < size)
+		{
+			const ::ssize_t res {::pread(fd, _readBuffer.data() + readBytes, size - readBytes, static_cast<::off_t>(offset + readBytes))};
+			if (res == -1 && errno == EINTR)
+				continue;
+			if (res == -1)
+				throw FileException {path, "read failed", errno};
+			if (res == 0)
+				throw FileException {path, "size changed"};
+
+			readBytes += static_cast<std::size_t>(res);
+		}
+	}
+} // namespace Zip
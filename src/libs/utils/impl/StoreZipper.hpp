@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "utils/Crc32Calculator.hpp"
+#include "utils/IZipper.hpp"
+
+namespace Zip
+{
+	// Writes a ZIP archive without compression (audio files are already compressed)
+	// The layout is computed upfront, so that the exact size is known and any range can be served
+	// CRCs are written in data descriptors and are computed while the data is sent
+	class StoreZipper : public IZipper
+	{
+		public:
+			StoreZipper(const EntryContainer& entries);
+			~StoreZipper() override;
+			StoreZipper(const StoreZipper&) = delete;
+			StoreZipper& operator=(const StoreZipper&) = delete;
+
+		private:
+			std::uint64_t writeSome(std::ostream& output) override;
+			bool isComplete() const override;
+			void abort() override;
+			std::optional<std::uint64_t> getTotalSize() const override { return _totalSize; }
+			void setRange(std::uint64_t offset, std::uint64_t size) override;
+
+			struct FileInfo
+			{
+				std::filesystem::path path;
+				std::string name;
+				std::uint64_t size {};
+				std::uint16_t dosTime {};
+				std::uint16_t dosDate {};
+				std::uint32_t mode {};
+				std::uint64_t localHeaderOffset {};
+				bool zip64 {};
+
+				Utils::Crc32Calculator crc;
+				std::uint64_t crcOffset {}; // bytes already processed in crc
+			};
+
+			enum class SegmentType
+			{
+				LocalHeader,
+				FileData,
+				DataDescriptor,
+				CentralDirectory,
+			};
+
+			struct Segment
+			{
+				SegmentType type;
+				std::size_t fileIndex {};
+				std::uint64_t offset {}; // in the archive
+				std::uint64_t size {};
+			};
+
+			void computeLayout();
+			std::string createLocalHeader(const FileInfo& file) const;
+			std::string createDataDescriptor(FileInfo& file);
+			std::string createCentralDirectory();
+
+			std::uint64_t writeFileData(std::ostream& output, std::size_t fileIndex, std::uint64_t fileOffset, std::uint64_t size);
+			void openFile(std::size_t fileIndex);
+			void closeFiles();
+			std::uint32_t getCrc(FileInfo& file);
+			void readFile(int fd, const std::filesystem::path& path, std::uint64_t offset, std::size_t size);
+
+			static inline constexpr std::size_t _writeSize {262144};       // per call to writeSome
+			static inline constexpr std::size_t _readBufferSize {262144};
+			static inline constexpr std::size_t _nextFileReadAheadSize {4194304};
+
+			std::vector<FileInfo> _files;
+			std::vector<Segment> _segments;
+			std::uint64_t _totalSize {};
+			std::string _centralDirectory; // generated once all the CRCs are known
+
+			std::vector<std::byte> _readBuffer;
+
+			// current file kept open, next file opened ahead so that the kernel reads it meanwhile
+			std::size_t _currentFileIndex {};
+			int _currentFd {-1};
+			int _nextFd {-1};
+
+			std::size_t _currentSegment {};
+			std::uint64_t _offset {};
+			std::uint64_t _end {};
+	};
+
+} // namespace Zip
@@ -25,11 +25,20 @@ StreamLogger::StreamLogger(std::ostream& os, EnumSet<Severity> severities)
     : _os{ os }
     , _severities{ severities }
 {
+    // do not even build the messages that would be dropped
+    for (Severity severity : { Severity::DEBUG, Severity::INFO, Severity::WARNING, Severity::ERROR, Severity::FATAL })
+    {
+        if (_severities.contains(severity))
+        {
+            setMinSeverity(severity);
+            break;
+        }
+    }
 }
 
 void StreamLogger::processLog(const Log& log)
 {
     if (_severities.contains(log.getSeverity()))
-        _os << std::this_thread::get_id() << " [" << getSeverityName(log.getSeverity()) << "] [" << getModuleName(log.getModule()) << "] " << log.getMessage() << std::endl;
+        _os << log.getThreadId() << " [" << getSeverityName(log.getSeverity()) << "] [" << getModuleName(log.getModule()) << "] " << log.getMessage() << std::endl;
 }
 
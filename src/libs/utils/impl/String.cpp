@@ -23,7 +23,6 @@
 #include <iomanip>
 #include <utility>
 
-#include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/join.hpp>
 #include <boost/algorithm/string.hpp>
 
@@ -75,6 +74,163 @@ namespace StringUtils
             return escaped;
         }
 
+        constexpr char asciiToLower(char c)
+        {
+            return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+
+        constexpr char asciiToUpper(char c)
+        {
+            return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+        }
+
+        bool isAscii(std::string_view str)
+        {
+            return std::all_of(std::cbegin(str), std::cend(str), [](char c) { return static_cast<unsigned char>(c) < 0x80; });
+        }
+
+        // Invalid bytes are returned as themselves, offset past the valid code points so that they never match one
+        constexpr char32_t invalidByteOffset{ 0x110000 };
+
+        char32_t decodeUtf8(std::string_view str, std::size_t& pos)
+        {
+            const unsigned char first{ static_cast<unsigned char>(str[pos++]) };
+            if (first < 0x80)
+                return first;
+
+            std::size_t extraByteCount;
+            char32_t codePoint;
+            if ((first & 0xE0) == 0xC0)
+            {
+                extraByteCount = 1;
+                codePoint = first & 0x1F;
+            }
+            else if ((first & 0xF0) == 0xE0)
+            {
+                extraByteCount = 2;
+                codePoint = first & 0x0F;
+            }
+            else if ((first & 0xF8) == 0xF0)
+            {
+                extraByteCount = 3;
+                codePoint = first & 0x07;
+            }
+            else
+                return invalidByteOffset + first;
+
+            if (pos + extraByteCount > str.size())
+                return invalidByteOffset + first;
+
+            for (std::size_t i{}; i < extraByteCount; ++i)
+            {
+                const unsigned char c{ static_cast<unsigned char>(str[pos + i]) };
+                if ((c & 0xC0) != 0x80)
+                    return invalidByteOffset + first;
+
+                codePoint = (codePoint << 6) | (c & 0x3F);
+            }
+
+            pos += extraByteCount;
+            return codePoint;
+        }
+
+        void encodeUtf8(char32_t codePoint, std::string& output)
+        {
+            if (codePoint >= invalidByteOffset)
+                output += static_cast<char>(codePoint - invalidByteOffset);
+            else if (codePoint < 0x80)
+                output += static_cast<char>(codePoint);
+            else if (codePoint < 0x800)
+            {
+                output += static_cast<char>(0xC0 | (codePoint >> 6));
+                output += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+            else if (codePoint < 0x10000)
+            {
+                output += static_cast<char>(0xE0 | (codePoint >> 12));
+                output += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                output += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+            else
+            {
+                output += static_cast<char>(0xF0 | (codePoint >> 18));
+                output += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+                output += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+                output += static_cast<char>(0x80 | (codePoint & 0x3F));
+            }
+        }
+
+        // Subset of the Unicode simple case folding (CaseFolding.txt, status C and S)
+        constexpr char32_t foldCodePoint(char32_t c)
+        {
+            if (c < 0x80)
+                return (c >= 'A' && c <= 'Z') ? c + 0x20 : c;
+
+            // Latin-1 supplement
+            if (c >= 0xC0 && c <= 0xDE && c != 0xD7)
+                return c + 0x20;
+            if (c == 0xB5)
+                return 0x3BC;
+
+            // Latin extended-A: alternating upper/lower pairs
+            if ((c >= 0x100 && c <= 0x12F) || (c >= 0x132 && c <= 0x137) || (c >= 0x14A && c <= 0x177))
+                return (c % 2 == 0) ? c + 1 : c;
+            if ((c >= 0x139 && c <= 0x148) || (c >= 0x179 && c <= 0x17E))
+                return (c % 2 == 1) ? c + 1 : c;
+            if (c == 0x178)
+                return 0xFF;
+            if (c == 0x17F)
+                return 's';
+
+            // Greek
+            if ((c >= 0x391 && c <= 0x3A1) || (c >= 0x3A3 && c <= 0x3AB))
+                return c + 0x20;
+            if (c == 0x386)
+                return 0x3AC;
+            if (c >= 0x388 && c <= 0x38A)
+                return c + 0x25;
+            if (c == 0x38C)
+                return 0x3CC;
+            if (c == 0x38E || c == 0x38F)
+                return c + 0x3F;
+            if (c == 0x3C2)
+                return 0x3C3;
+
+            // Cyrillic
+            if (c >= 0x400 && c <= 0x40F)
+                return c + 0x50;
+            if (c >= 0x410 && c <= 0x42F)
+                return c + 0x20;
+
+            // Latin extended additional
+            if ((c >= 0x1E00 && c <= 0x1E95) || (c >= 0x1EA0 && c <= 0x1EFF))
+                return (c % 2 == 0) ? c + 1 : c;
+            if (c == 0x1E9E)
+                return 0xDF;
+
+            return c;
+        }
+
+        // ASCII base letters of the U+00C0 - U+017F code points, '.' when there is none
+        constexpr std::string_view latinBaseLetters
+        {
+            "aaaaaa.ceeeeiiii.nooooo..uuuuy.."
+            "aaaaaa.ceeeeiiiidnooooo.ouuuuy.y"
+            "aaaaaaccccccccdd.deeeeeeeeeegggg"
+            "gggghh.hiiiiiiiiii..jjkk.llllll."
+            "l.lnnnnnn...oooooo..rrrrrrssssss"
+            "sstttt.tuuuuuuuuuuuuwwyyyzzzzzz."
+        };
+
+        constexpr char32_t removeDiacritic(char32_t c)
+        {
+            if (c < 0xC0 || c >= 0xC0 + latinBaseLetters.size())
+                return c;
+
+            const char baseLetter{ latinBaseLetters[c - 0xC0] };
+            return baseLetter == '.' ? c : static_cast<char32_t>(baseLetter);
+        }
+
         template <std::size_t N>
         void writeEscapedString(std::ostream& os, std::string_view str, const std::pair<char, std::string_view>(&charsToEscape)[N])
         {
@@ -138,12 +294,15 @@ namespace StringUtils
         return std::nullopt;
     }
 
-    std::vector<std::string> splitStringCopy(std::string_view string, std::string_view separators)
+    std::vector<std::string> splitStringCopy(std::string_view str, std::string_view separators)
     {
-        std::string str{ stringTrim(string, separators) };
-
         std::vector<std::string> res;
-        boost::algorithm::split(res, str, boost::is_any_of(separators), boost::token_compress_on);
+        for (std::string_view token : tokenizeString(str, separators))
+            res.emplace_back(token);
+
+        // an empty string is reported as a single empty token
+        if (res.empty())
+            res.emplace_back();
 
         return res;
     }
@@ -151,21 +310,8 @@ namespace StringUtils
     std::vector<std::string_view> splitString(std::string_view str, std::string_view separators)
     {
         std::vector<std::string_view> res;
-
-        std::string_view::size_type strBegin{};
-
-        while ((strBegin = str.find_first_not_of(separators, strBegin)) != std::string_view::npos)
-        {
-            auto strEnd{ str.find_first_of(separators, strBegin + 1) };
-            if (strEnd == std::string_view::npos)
-            {
-                res.push_back(str.substr(strBegin, str.size() - strBegin));
-                break;
-            }
-
-            res.push_back(str.substr(strBegin, strEnd - strBegin));
-            strBegin = strEnd + 1;
-        }
+        for (std::string_view token : tokenizeString(str, separators))
+            res.push_back(token);
 
         return res;
     }
@@ -201,14 +347,14 @@ namespace StringUtils
         std::string res;
         res.reserve(str.size());
 
-        std::transform(std::cbegin(str), std::cend(str), std::back_inserter(res), [](unsigned char c) { return std::tolower(c);});
+        std::transform(std::cbegin(str), std::cend(str), std::back_inserter(res), asciiToLower);
 
         return res;
     }
 
     void stringToLower(std::string& str)
     {
-        std::transform(std::cbegin(str), std::cend(str), std::begin(str), [](unsigned char c) { return std::tolower(c);});
+        std::transform(std::cbegin(str), std::cend(str), std::begin(str), asciiToLower);
     }
 
     std::string stringToUpper(const std::string& str)
@@ -216,7 +362,7 @@ namespace StringUtils
         std::string res;
         res.reserve(str.size());
 
-        std::transform(std::cbegin(str), std::cend(str), std::back_inserter(res), [](char c) { return std::toupper(c);});
+        std::transform(std::cbegin(str), std::cend(str), std::back_inserter(res), asciiToUpper);
 
         return res;
     }
@@ -233,18 +379,91 @@ namespace StringUtils
         return oss.str();
     }
 
+    std::string foldCase(std::string_view str)
+    {
+        std::string res;
+        res.reserve(str.size());
+
+        if (isAscii(str))
+        {
+            std::transform(std::cbegin(str), std::cend(str), std::back_inserter(res), asciiToLower);
+            return res;
+        }
+
+        for (std::size_t pos{}; pos < str.size();)
+            encodeUtf8(foldCodePoint(decodeUtf8(str, pos)), res);
+
+        return res;
+    }
+
+    int stringCaseInsensitiveCompare(std::string_view strA, std::string_view strB)
+    {
+        std::size_t posA{};
+        std::size_t posB{};
+        while (posA < strA.size() && posB < strB.size())
+        {
+            char32_t codePointA;
+            char32_t codePointB;
+
+            // ASCII fast path
+            const unsigned char a{ static_cast<unsigned char>(strA[posA]) };
+            const unsigned char b{ static_cast<unsigned char>(strB[posB]) };
+            if (a < 0x80 && b < 0x80)
+            {
+                codePointA = static_cast<unsigned char>(asciiToLower(a));
+                codePointB = static_cast<unsigned char>(asciiToLower(b));
+                ++posA;
+                ++posB;
+            }
+            else
+            {
+                codePointA = foldCodePoint(decodeUtf8(strA, posA));
+                codePointB = foldCodePoint(decodeUtf8(strB, posB));
+            }
+
+            if (codePointA != codePointB)
+                return codePointA < codePointB ? -1 : 1;
+        }
+
+        if (posA < strA.size())
+            return 1;
+        if (posB < strB.size())
+            return -1;
+
+        return 0;
+    }
+
     bool stringCaseInsensitiveEqual(std::string_view strA, std::string_view strB)
     {
-        if (strA.size() != strB.size())
-            return false;
-        
-        for (std::size_t i{}; i < strA.size(); ++i)
+        return stringCaseInsensitiveCompare(strA, strB) == 0;
+    }
+
+    std::string computeSortKey(std::string_view str)
+    {
+        str = stringTrim(str);
+
+        std::string res;
+        res.reserve(str.size());
+
+        if (isAscii(str))
+            std::transform(std::cbegin(str), std::cend(str), std::back_inserter(res), asciiToLower);
+        else
         {
-            if (std::tolower(strA[i]) != std::tolower(strB[i]))
-                return false;
+            for (std::size_t pos{}; pos < str.size();)
+                encodeUtf8(removeDiacritic(foldCodePoint(decodeUtf8(str, pos))), res);
         }
 
-        return true;
+        for (const std::string_view article : { "the ", "a ", "an " })
+        {
+            if (res.size() > article.size() && std::string_view{ res }.substr(0, article.size()) == article)
+            {
+                res.erase(0, article.size());
+                res.erase(0, res.find_first_not_of(' '));
+                break;
+            }
+        }
+
+        return res;
     }
 
     void capitalize(std::string& str)
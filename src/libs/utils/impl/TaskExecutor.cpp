@@ -0,0 +1,307 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/TaskExecutor.hpp"
+
+#include "utils/Exception.hpp"
+#include "utils/Logger.hpp"
+
+namespace
+{
+	struct CurrentWorker
+	{
+		const TaskExecutor*	executor {};
+		std::size_t			index {};
+	};
+
+	thread_local CurrentWorker currentWorker;
+
+	std::size_t
+	toIndex(TaskExecutor::Priority priority)
+	{
+		return static_cast<std::size_t>(priority);
+	}
+}
+
+TaskExecutor::TaskExecutor(std::size_t threadCount, Task workerInit)
+{
+	if (threadCount == 0)
+		throw LmsException {"Task executor needs at least one thread"};
+
+	for (std::size_t i {}; i < threadCount; ++i)
+		_workers.emplace_back(std::make_unique<Worker>());
+
+	// workers must all exist before the first one may steal
+	for (std::size_t i {}; i < threadCount; ++i)
+	{
+		_workers[i]->thread = std::thread {[this, i, workerInit]
+		{
+			if (workerInit)
+				workerInit();
+			workerLoop(i);
+		}};
+	}
+
+	LMS_LOG(UTILS, INFO) << "Started task executor using " << threadCount << " thread" << (threadCount == 1 ? "" : "s");
+}
+
+TaskExecutor::~TaskExecutor()
+{
+	{
+		const std::scoped_lock lock {_sleepMutex};
+		_stop = true;
+	}
+	_sleepCondVar.notify_all();
+
+	for (std::unique_ptr<Worker>& worker : _workers)
+		worker->thread.join();
+}
+
+void
+TaskExecutor::post(Task task, Priority priority)
+{
+	Queue& queue {isWorkerThread() ? _workers[currentWorker.index]->queues[toIndex(priority)] : _sharedQueues[toIndex(priority)]};
+
+	// counted first so that the count never goes below zero when a worker picks the task
+	_pendingCount.fetch_add(1);
+	{
+		const std::scoped_lock lock {queue.mutex};
+		queue.tasks.emplace_back(std::move(task));
+	}
+
+	{
+		const std::scoped_lock lock {_sleepMutex};
+	}
+	_sleepCondVar.notify_one();
+}
+
+bool
+TaskExecutor::isWorkerThread() const
+{
+	return currentWorker.executor == this;
+}
+
+bool
+TaskExecutor::runPendingTask()
+{
+	if (!isWorkerThread())
+		throw LmsException {"Pending tasks can only be run from a worker thread"};
+
+	Task task;
+	if (!popTask(currentWorker.index, task))
+		return false;
+
+	runTask(task);
+	return true;
+}
+
+void
+TaskExecutor::workerLoop(std::size_t workerIndex)
+{
+	currentWorker = CurrentWorker {this, workerIndex};
+
+	while (true)
+	{
+		Task task;
+		if (popTask(workerIndex, task))
+		{
+			runTask(task);
+			continue;
+		}
+
+		std::unique_lock lock {_sleepMutex};
+		_sleepCondVar.wait(lock, [this] { return _stop || _pendingCount.load() > 0; });
+		if (_stop && _pendingCount.load() == 0)
+			break;
+	}
+}
+
+bool
+TaskExecutor::popTask(std::size_t workerIndex, Task& task)
+{
+	for (std::size_t priorityIndex {}; priorityIndex < priorityCount; ++priorityIndex)
+	{
+		{
+			Queue& queue {_workers[workerIndex]->queues[priorityIndex]};
+			const std::scoped_lock lock {queue.mutex};
+			if (!queue.tasks.empty())
+			{
+				task = std::move(queue.tasks.back());
+				queue.tasks.pop_back();
+				_pendingCount.fetch_sub(1);
+				return true;
+			}
+		}
+
+		{
+			Queue& queue {_sharedQueues[priorityIndex]};
+			const std::scoped_lock lock {queue.mutex};
+			if (!queue.tasks.empty())
+			{
+				task = std::move(queue.tasks.front());
+				queue.tasks.pop_front();
+				_pendingCount.fetch_sub(1);
+				return true;
+			}
+		}
+
+		if (stealTask(workerIndex, priorityIndex, task))
+			return true;
+	}
+
+	return false;
+}
+
+bool
+TaskExecutor::stealTask(std::size_t workerIndex, std::size_t priorityIndex, Task& task)
+{
+	for (std::size_t i {1}; i < _workers.size(); ++i)
+	{
+		Queue& queue {_workers[(workerIndex + i) % _workers.size()]->queues[priorityIndex]};
+		const std::scoped_lock lock {queue.mutex};
+		if (!queue.tasks.empty())
+		{
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+			_pendingCount.fetch_sub(1);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void
+TaskExecutor::runTask(Task& task)
+{
+	try
+	{
+		task();
+	}
+	catch (const std::exception& e)
+	{
+		LMS_LOG(UTILS, ERROR) << "Caught exception in task: " << e.what();
+	}
+}
+
+TaskGroup::TaskGroup(TaskExecutor& executor, TaskExecutor::Priority priority)
+: _executor {executor}
+, _priority {priority}
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+	try
+	{
+		wait();
+	}
+	catch (const std::exception& e)
+	{
+		LMS_LOG(UTILS, ERROR) << "Caught exception in task group: " << e.what();
+	}
+}
+
+void
+TaskGroup::run(TaskExecutor::Task task)
+{
+	{
+		const std::scoped_lock lock {_mutex};
+		_pendingCount++;
+	}
+
+	_executor.post([this, task = std::move(task)]
+	{
+		std::exception_ptr exception;
+		try
+		{
+			task();
+		}
+		catch (...)
+		{
+			exception = std::current_exception();
+		}
+
+		onTaskDone(exception);
+	}, _priority);
+}
+
+void
+TaskGroup::wait()
+{
+	if (_executor.isWorkerThread())
+	{
+		// help instead of blocking a worker, otherwise nested groups could wait forever
+		std::unique_lock lock {_mutex};
+		while (_pendingCount > 0)
+		{
+			lock.unlock();
+			const bool hasRunTask {_executor.runPendingTask()};
+			lock.lock();
+
+			if (!hasRunTask)
+				_condVar.wait_for(lock, std::chrono::milliseconds {1}, [this] { return _pendingCount == 0; });
+		}
+	}
+	else
+	{
+		std::unique_lock lock {_mutex};
+		_condVar.wait(lock, [this] { return _pendingCount == 0; });
+	}
+
+	rethrowException();
+}
+
+bool
+TaskGroup::waitFor(std::chrono::milliseconds duration)
+{
+	{
+		std::unique_lock lock {_mutex};
+		if (!_condVar.wait_for(lock, duration, [this] { return _pendingCount == 0; }))
+			return false;
+	}
+
+	rethrowException();
+	return true;
+}
+
+void
+TaskGroup::onTaskDone(std::exception_ptr exception)
+{
+	// notified with the lock held, as the group may be destroyed as soon as the waiter sees no more pending task
+	const std::scoped_lock lock {_mutex};
+	if (exception && !_exception)
+		_exception = exception;
+
+	_pendingCount--;
+	_condVar.notify_all();
+}
+
+void
+TaskGroup::rethrowException()
+{
+	std::exception_ptr exception;
+	{
+		const std::scoped_lock lock {_mutex};
+		std::swap(exception, _exception);
+	}
+
+	if (exception)
+		std::rethrow_exception(exception);
+}
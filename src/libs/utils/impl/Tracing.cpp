@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/Tracing.hpp"
+
+#include <iomanip>
+#include <random>
+#include <sstream>
+
+#include "utils/Exception.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Service.hpp"
+
+namespace Tracing
+{
+	namespace
+	{
+		// Spans of the current thread, until the outermost one ends
+		struct ThreadTrace
+		{
+			std::size_t					depth {};		// all spans, including the ones that are not sampled
+			bool						sampled {};
+			TraceId						traceId;
+			std::vector<SpanData>		spans;
+			std::vector<std::size_t>	openSpanIndexes;
+		};
+
+		thread_local ThreadTrace threadTrace;
+
+		std::uint64_t
+		generateId()
+		{
+			thread_local std::mt19937_64 generator {std::random_device {}()};
+
+			std::uint64_t id;
+			do
+			{
+				id = generator();
+			}
+			while (id == 0); // zero means invalid
+
+			return id;
+		}
+
+		std::string
+		toHex(std::uint64_t value)
+		{
+			std::ostringstream oss;
+			oss << std::hex << std::setfill('0') << std::setw(16) << value;
+			return oss.str();
+		}
+
+		std::string
+		toUnixNanoString(std::chrono::system_clock::time_point time)
+		{
+			return std::to_string(std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count());
+		}
+
+		void
+		writeJsonString(std::ostream& os, std::string_view str)
+		{
+			os << '"';
+			for (char c : str)
+			{
+				switch (c)
+				{
+					case '"': os << "\\\""; break;
+					case '\\': os << "\\\\"; break;
+					case '\n': os << "\\n"; break;
+					case '\r': os << "\\r"; break;
+					case '\t': os << "\\t"; break;
+					default:
+						if (static_cast<unsigned char>(c) < 0x20)
+							os << "\\u" << std::hex << std::setfill('0') << std::setw(4) << static_cast<int>(c) << std::dec;
+						else
+							os << c;
+				}
+			}
+			os << '"';
+		}
+	}
+
+	Tracer::Tracer(const Parameters& params)
+	: _sampleRatio {params.sampleRatio}
+	, _output {params.outputFile, std::ios::app}
+	{
+		if (!_output)
+			throw LmsException {"Cannot open trace file '" + params.outputFile.string() + "'"};
+
+		LMS_LOG(UTILS, INFO) << "Writing traces in '" << params.outputFile.string() << "', sample ratio = " << _sampleRatio;
+	}
+
+	Tracer::~Tracer() = default;
+
+	bool
+	Tracer::shouldSample() const
+	{
+		if (_sampleRatio >= 1)
+			return true;
+		if (_sampleRatio <= 0)
+			return false;
+
+		thread_local std::mt19937 generator {std::random_device {}()};
+		return std::uniform_real_distribution<double> {0, 1}(generator) < _sampleRatio;
+	}
+
+	void
+	Tracer::write(const TraceId& traceId, const std::vector<SpanData>& spans)
+	{
+		// serialized before locking, only the write itself is serialized
+		std::ostringstream oss;
+		oss << R"({"resourceSpans":[{"resource":{"attributes":[{"key":"service.name","value":{"stringValue":"lms"}}]},"scopeSpans":[{"scope":{"name":"lms"},"spans":[)";
+
+		const std::string traceIdHex {toHex(traceId.high) + toHex(traceId.low)};
+		bool first {true};
+		for (const SpanData& span : spans)
+		{
+			if (!first)
+				oss << ",";
+			first = false;
+
+			oss << R"({"traceId":")" << traceIdHex << R"(","spanId":")" << toHex(span.spanId) << '"';
+			if (span.parentSpanId)
+				oss << R"(,"parentSpanId":")" << toHex(span.parentSpanId) << '"';
+			oss << R"(,"name":)";
+			writeJsonString(oss, span.name);
+			oss << R"(,"kind":1,"startTimeUnixNano":")" << toUnixNanoString(span.startTime) << R"(","endTimeUnixNano":")" << toUnixNanoString(span.endTime) << R"(","attributes":[)";
+			for (std::size_t i {}; i < span.attributes.size(); ++i)
+			{
+				if (i > 0)
+					oss << ",";
+				oss << R"({"key":)";
+				writeJsonString(oss, span.attributes[i].first);
+				oss << R"(,"value":{"stringValue":)";
+				writeJsonString(oss, span.attributes[i].second);
+				oss << "}}";
+			}
+			oss << "]}";
+		}
+		oss << "]}]}]}\n";
+
+		const std::scoped_lock lock {_mutex};
+		_output << oss.str();
+		_output.flush();
+	}
+
+	ScopedSpan::ScopedSpan(std::string_view name)
+	{
+		start(name, nullptr);
+	}
+
+	ScopedSpan::ScopedSpan(std::string_view name, const SpanContext& parent)
+	{
+		start(name, &parent);
+	}
+
+	void
+	ScopedSpan::start(std::string_view name, const SpanContext* parent)
+	{
+		_tracer = Service<Tracer>::get();
+		if (!_tracer)
+			return;
+
+		ThreadTrace& trace {threadTrace};
+		if (trace.depth++ == 0)
+		{
+			if (parent)
+			{
+				trace.sampled = parent->sampled;
+				trace.traceId = parent->traceId;
+			}
+			else
+			{
+				trace.sampled = _tracer->shouldSample();
+				if (trace.sampled)
+					trace.traceId = TraceId {generateId(), generateId()};
+			}
+		}
+
+		_recording = trace.sampled;
+		if (!_recording)
+			return;
+
+		std::uint64_t parentSpanId {};
+		if (!trace.openSpanIndexes.empty())
+			parentSpanId = trace.spans[trace.openSpanIndexes.back()].spanId;
+		else if (parent)
+			parentSpanId = parent->spanId;
+
+		_spanIndex = trace.spans.size();
+		SpanData& span {trace.spans.emplace_back()};
+		span.name = name;
+		span.spanId = generateId();
+		span.parentSpanId = parentSpanId;
+		span.startTime = std::chrono::system_clock::now();
+		trace.openSpanIndexes.push_back(_spanIndex);
+	}
+
+	ScopedSpan::~ScopedSpan()
+	{
+		if (!_tracer)
+			return;
+
+		ThreadTrace& trace {threadTrace};
+		if (_recording)
+		{
+			trace.spans[_spanIndex].endTime = std::chrono::system_clock::now();
+			trace.openSpanIndexes.pop_back();
+		}
+
+		if (--trace.depth == 0 && trace.sampled)
+		{
+			try
+			{
+				_tracer->write(trace.traceId, trace.spans);
+			}
+			catch (const std::exception& e)
+			{
+				LMS_LOG(UTILS, ERROR) << "Cannot write trace: " << e.what();
+			}
+			trace.spans.clear();
+		}
+	}
+
+	void
+	ScopedSpan::setAttribute(std::string_view key, std::string_view value)
+	{
+		if (!_recording)
+			return;
+
+		threadTrace.spans[_spanIndex].attributes.emplace_back(key, value);
+	}
+
+	SpanContext
+	getCurrentSpanContext()
+	{
+		const ThreadTrace& trace {threadTrace};
+		if (trace.depth == 0 || !trace.sampled || trace.openSpanIndexes.empty())
+			return SpanContext {};
+
+		return SpanContext {trace.traceId, trace.spans[trace.openSpanIndexes.back()].spanId, true};
+	}
+} // namespace Tracing
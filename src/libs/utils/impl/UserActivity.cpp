@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/UserActivity.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+namespace UserActivity
+{
+	namespace
+	{
+		// past this delay without request, the latency average is considered outdated
+		constexpr std::chrono::seconds latencyExpiry {10};
+		constexpr std::int64_t latencyAverageWeight {8}; // each new sample counts for 1/latencyAverageWeight
+
+		std::atomic<std::size_t>	ongoingRequestCount {};
+		std::atomic<std::size_t>	ongoingStreamCount {};
+		std::atomic<std::int64_t>	averageLatencyUs {};
+		std::atomic<std::int64_t>	lastRequestTime {}; // steady clock ticks, 0 if none yet
+	}
+
+	RequestScope::RequestScope()
+	{
+		ongoingRequestCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	RequestScope::~RequestScope()
+	{
+		ongoingRequestCount.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	StreamScope::StreamScope()
+	{
+		ongoingStreamCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	StreamScope::~StreamScope()
+	{
+		ongoingStreamCount.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	void
+	recordRequestLatency(std::chrono::steady_clock::duration latency)
+	{
+		const std::int64_t latencyUs {std::chrono::duration_cast<std::chrono::microseconds>(latency).count()};
+		const std::int64_t now {std::chrono::steady_clock::now().time_since_epoch().count()};
+		const bool expired {std::chrono::steady_clock::duration {now - lastRequestTime.load(std::memory_order_relaxed)} > latencyExpiry};
+
+		std::int64_t average {averageLatencyUs.load(std::memory_order_relaxed)};
+		while (!averageLatencyUs.compare_exchange_weak(average, expired ? latencyUs : average + (latencyUs - average) / latencyAverageWeight, std::memory_order_relaxed))
+			;
+
+		lastRequestTime.store(now, std::memory_order_relaxed);
+	}
+
+	Stats
+	getStats()
+	{
+		Stats stats;
+		stats.ongoingRequestCount = ongoingRequestCount.load(std::memory_order_relaxed);
+		stats.ongoingStreamCount = ongoingStreamCount.load(std::memory_order_relaxed);
+
+		const std::int64_t now {std::chrono::steady_clock::now().time_since_epoch().count()};
+		if (std::chrono::steady_clock::duration {now - lastRequestTime.load(std::memory_order_relaxed)} <= latencyExpiry)
+			stats.requestLatency = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::microseconds {averageLatencyUs.load(std::memory_order_relaxed)});
+
+		return stats;
+	}
+} // namespace UserActivity
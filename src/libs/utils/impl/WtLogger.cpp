@@ -38,6 +38,6 @@ namespace
 
 void WtLogger::processLog(const Log& log)
 {
-    Wt::log(getSeverityName(log.getSeverity())) << Wt::WLogger::sep << to_string(std::this_thread::get_id()) << Wt::WLogger::sep << "[" << getModuleName(log.getModule()) << "]" << Wt::WLogger::sep << log.getMessage();
+    Wt::log(getSeverityName(log.getSeverity())) << Wt::WLogger::sep << to_string(log.getThreadId()) << Wt::WLogger::sep << "[" << getModuleName(log.getModule()) << "]" << Wt::WLogger::sep << log.getMessage();
 }
 
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "ZipperResourceHandler.hpp"
+
+#include <sstream>
+
+#include "utils/DeliveryReactor.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Service.hpp"
+#include "utils/ZipperResourceHandlerCreator.hpp"
+
+std::unique_ptr<IResourceHandler>
+createZipperResourceHandler(std::unique_ptr<Zip::IZipper> zipper)
+{
+    return std::make_unique<ZipperResourceHandler>(std::move(zipper));
+}
+
+ZipperResourceHandler::ZipperResourceHandler(std::unique_ptr<Zip::IZipper> zipper)
+    : _zipper{ std::move(zipper) }
+{
+}
+
+ZipperResourceHandler::~ZipperResourceHandler()
+{
+    _chunkProducer.reset();
+}
+
+Wt::Http::ResponseContinuation*
+ZipperResourceHandler::processRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
+{
+    if (!_started)
+    {
+        _started = true;
+
+        response.setMimeType("application/zip");
+
+        if (const std::optional<std::uint64_t> totalSize{ _zipper->getTotalSize() })
+        {
+            response.addHeader("Accept-Ranges", "bytes");
+
+            const Wt::Http::Request::ByteRangeSpecifier ranges{ request.getRanges(*totalSize) };
+            if (!ranges.isSatisfiable())
+            {
+                std::ostringstream contentRange;
+                contentRange << "bytes */" << *totalSize;
+                response.setStatus(416); // Requested range not satisfiable
+                response.addHeader("Content-Range", contentRange.str());
+
+                LMS_LOG(UTILS, DEBUG) << "Range not satisfiable";
+                return {};
+            }
+
+            if (ranges.size() == 1)
+            {
+                LMS_LOG(UTILS, DEBUG) << "Range requested = " << ranges[0].firstByte() << "/" << ranges[0].lastByte();
+
+                const std::uint64_t size{ ranges[0].lastByte() + 1 - ranges[0].firstByte() };
+                _zipper->setRange(ranges[0].firstByte(), size);
+
+                std::ostringstream contentRange;
+                contentRange << "bytes " << ranges[0].firstByte() << "-" << ranges[0].lastByte() << "/" << *totalSize;
+
+                response.setStatus(206);
+                response.addHeader("Content-Range", contentRange.str());
+                response.setContentLength(size);
+            }
+            else
+            {
+                response.setStatus(200);
+                response.setContentLength(*totalSize);
+            }
+        }
+
+        if (DeliveryReactor* deliveryReactor{ Service<DeliveryReactor>::get() })
+        {
+            _chunkProducer = std::make_unique<ChunkProducer>(deliveryReactor->getIoContext(), _maxReadyChunkCount, [this](std::ostream& output)
+                {
+                    _zipper->writeSome(output);
+                    return !_zipper->isComplete();
+                });
+        }
+    }
+
+    if (_chunkProducer)
+        return _chunkProducer->writeReadyChunks(response);
+
+    const std::uint64_t writtenBytes{ _zipper->writeSome(response.out()) };
+    LMS_LOG(UTILS, DEBUG) << "Written " << writtenBytes << " bytes";
+
+    if (!_zipper->isComplete())
+        return response.createContinuation();
+
+    LMS_LOG(UTILS, DEBUG) << "Job complete!";
+    return nullptr;
+}
+
+void
+ZipperResourceHandler::abort()
+{
+    if (_chunkProducer)
+        _chunkProducer->stop();
+    _zipper->abort();
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <memory>
+
+#include "utils/IResourceHandler.hpp"
+#include "utils/IZipper.hpp"
+#include "ChunkProducer.hpp"
+
+// Supports Content-Length and ranges if the zipper knows the total size in advance
+// The archive is written ahead on the delivery reactor if there is one
+class ZipperResourceHandler final : public IResourceHandler
+{
+public:
+    ZipperResourceHandler(std::unique_ptr<Zip::IZipper> zipper);
+    ~ZipperResourceHandler() override;
+
+    ZipperResourceHandler(const ZipperResourceHandler&) = delete;
+    ZipperResourceHandler& operator=(const ZipperResourceHandler&) = delete;
+
+private:
+    Wt::Http::ResponseContinuation* processRequest(const Wt::Http::Request& request, Wt::Http::Response& response) override;
+    void abort() override;
+
+    static constexpr std::size_t _maxReadyChunkCount{ 4 };
+
+    std::unique_ptr<Zip::IZipper> _zipper;
+    bool _started{};
+    std::unique_ptr<ChunkProducer> _chunkProducer; // uses the zipper until stopped
+};
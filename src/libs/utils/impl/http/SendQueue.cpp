@@ -19,6 +19,8 @@
 
 #include "SendQueue.hpp"
 
+#include <algorithm>
+
 #include <boost/asio/dispatch.hpp>
 #include <boost/asio/bind_executor.hpp>
 
@@ -60,22 +62,78 @@ namespace
 
 namespace Http
 {
-	SendQueue::SendQueue(boost::asio::io_context& ioContext, std::string_view baseUrl)
+	namespace
+	{
+		std::mutex sendQueuesMutex;
+		std::vector<const SendQueue*> sendQueues;
+	}
+
+	std::vector<ClientStats>
+	getClientStats()
+	{
+		std::vector<ClientStats> res;
+
+		const std::scoped_lock lock {sendQueuesMutex};
+		for (const SendQueue* sendQueue : sendQueues)
+		{
+			const ClientStats stats {sendQueue->getStats()};
+
+			// several clients may target the same base url
+			auto it {std::find_if(std::begin(res), std::end(res), [&](const ClientStats& other) { return other.baseUrl == stats.baseUrl; })};
+			if (it == std::end(res))
+			{
+				res.push_back(stats);
+				continue;
+			}
+
+			for (const auto& [prio, count] : stats.queuedRequestCounts)
+				it->queuedRequestCounts[prio] += count;
+			it->inFlightRequestCount += stats.inFlightRequestCount;
+			it->completedRequestCount += stats.completedRequestCount;
+			it->retryCount += stats.retryCount;
+			it->failureCount += stats.failureCount;
+			it->throttledDuration += stats.throttledDuration;
+			it->latencySum += stats.latencySum;
+		}
+
+		return res;
+	}
+
+	SendQueue::SendQueue(boost::asio::io_context& ioContext, std::string_view baseUrl, std::size_t maxInFlightRequestCount)
 	: _ioContext {ioContext}
 	, _baseUrl {baseUrl}
 	{
-		_client.done().connect([this](Wt::AsioWrapper::error_code ec, const Wt::Http::Message& msg)
+		_stats.baseUrl = _baseUrl;
+
+		const std::size_t slotCount {std::max<std::size_t>(maxInFlightRequestCount, 1)};
+		LOG(DEBUG) << "Using " << slotCount << " client(s) for '" << _baseUrl << "'";
+
+		for (std::size_t i {}; i < slotCount; ++i)
 		{
-			_strand.dispatch([=, msg = std::move(msg)]
+			Slot& slot {*_slots.emplace_back(std::make_unique<Slot>(_ioContext))};
+
+			slot.client.done().connect([this, &slot](Wt::AsioWrapper::error_code ec, const Wt::Http::Message& msg)
 			{
-				onClientDone(ec, msg);
+				_strand.dispatch([=, &slot, msg = std::move(msg)]
+				{
+					onClientDone(slot, ec, msg);
+				});
 			});
-		});
+		}
+
+		const std::scoped_lock lock {sendQueuesMutex};
+		sendQueues.push_back(this);
 	}
 
 	SendQueue::~SendQueue()
 	{
-		_client.abort();
+		{
+			const std::scoped_lock lock {sendQueuesMutex};
+			sendQueues.erase(std::remove(std::begin(sendQueues), std::end(sendQueues), this), std::end(sendQueues));
+		}
+
+		for (const std::unique_ptr<Slot>& slot : _slots)
+			slot->client.abort();
 	}
 
 	void
@@ -85,37 +143,70 @@ namespace Http
 		{
 			_sendQueue[request->getParameters().priority].emplace_back(std::move(request));
 
-			if (_state == State::Idle)
-				sendNextQueuedRequest();
+			if (!_throttled)
+				sendNextQueuedRequests();
+
+			updateStats();
 		});
 	}
 
+	ClientStats
+	SendQueue::getStats() const
+	{
+		const std::scoped_lock lock {_statsMutex};
+
+		ClientStats stats {_stats};
+		if (_throttled)
+			stats.throttledDuration += std::chrono::steady_clock::now() - _throttleStartTime;
+
+		return stats;
+	}
+
+	void
+	SendQueue::updateStats()
+	{
+		const std::scoped_lock lock {_statsMutex};
+
+		for (const auto& [prio, requests] : _sendQueue)
+			_stats.queuedRequestCounts[prio] = requests.size();
+		_stats.inFlightRequestCount = std::count_if(std::cbegin(_slots), std::cend(_slots), [](const std::unique_ptr<Slot>& slot) { return slot->request != nullptr; });
+	}
+
+	SendQueue::Slot*
+	SendQueue::findIdleSlot()
+	{
+		auto it {std::find_if(std::begin(_slots), std::end(_slots), [](const std::unique_ptr<Slot>& slot) { return !slot->request; })};
+		return it != std::end(_slots) ? it->get() : nullptr;
+	}
+
 	void
-	SendQueue::sendNextQueuedRequest()
+	SendQueue::sendNextQueuedRequests()
 	{
-		assert(_state == State::Idle);
-		assert(!_currentRequest);
+		assert(!_throttled);
 
 		for (auto& [prio, requests] : _sendQueue)
 		{
 			LOG(DEBUG) << "Processing prio " << static_cast<int>(prio) << ", request count = " << requests.size();
 			while (!requests.empty())
 			{
+				Slot* slot {findIdleSlot()};
+				if (!slot)
+					return;
+
 				std::unique_ptr<ClientRequest> request {std::move(requests.front())};
 				requests.pop_front();
 
-				if (!sendRequest(*request))
+				if (!sendRequest(*slot, *request))
 					continue;
 
-				_state = State::Sending;
-				_currentRequest = std::move(request);
-				return;
+				slot->request = std::move(request);
+				slot->sendTime = std::chrono::steady_clock::now();
 			}
 		}
 	}
 
 	bool
-	SendQueue::sendRequest(const ClientRequest& request)
+	SendQueue::sendRequest(Slot& slot, const ClientRequest& request)
 	{
 		std::string url {_baseUrl + request.getParameters().relativeUrl};
 		LOG(DEBUG) << "Sending request to url '" << url << "'";
@@ -124,11 +215,11 @@ namespace Http
 		switch (request.getType())
 		{
 			case ClientRequest::Type::GET:
-				res = _client.get(url, request.getGETParameters().headers);
+				res = slot.client.get(url, request.getGETParameters().headers);
 				break;
 
 			case ClientRequest::Type::POST:
-				res = _client.post(url, request.getPOSTParameters().message);
+				res = slot.client.post(url, request.getPOSTParameters().message);
 				break;
 		}
 
@@ -139,7 +230,7 @@ namespace Http
 	}
 
 	void
-	SendQueue::onClientDone(Wt::AsioWrapper::error_code ec, const Wt::Http::Message& msg)
+	SendQueue::onClientDone(Slot& slot, Wt::AsioWrapper::error_code ec, const Wt::Http::Message& msg)
 	{
 		if (ec == boost::asio::error::operation_aborted)
 		{
@@ -147,14 +238,24 @@ namespace Http
 			return;
 		}
 
-		assert(_currentRequest);
-		_state = State::Idle;
+		assert(slot.request);
+
+		{
+			const std::scoped_lock lock {_statsMutex};
+			_stats.completedRequestCount++;
+			_stats.latencySum += std::chrono::steady_clock::now() - slot.sendTime;
+		}
 
 		LOG(DEBUG) << "Client done. status = " << msg.status();
 		if (ec)
-			onClientDoneError(std::move(_currentRequest), ec);
+			onClientDoneError(std::move(slot.request), ec);
 		else
-			onClientDoneSuccess(std::move(_currentRequest), msg);
+			onClientDoneSuccess(std::move(slot.request), msg);
+
+		if (!_throttled)
+			sendNextQueuedRequests();
+
+		updateStats();
 	}
 
 	void
@@ -167,11 +268,19 @@ namespace Http
 
 		if (request->retryCount++ < _maxRetryCount)
 		{
+			{
+				const std::scoped_lock lock {_statsMutex};
+				_stats.retryCount++;
+			}
 			_sendQueue[request->getParameters().priority].emplace_front(std::move(request));
 		}
 		else
 		{
 			LOG(ERROR) << "Too many retries, giving up operation and throttle";
+			{
+				const std::scoped_lock lock {_statsMutex};
+				_stats.failureCount++;
+			}
 			if (request->getParameters().onFailureFunc)
 				request->getParameters().onFailureFunc();
 		}
@@ -184,17 +293,22 @@ namespace Http
 		bool mustThrottle{};
 		if (msg.status() == 429)
 		{
+			{
+				const std::scoped_lock lock {_statsMutex};
+				_stats.retryCount++;
+			}
 			_sendQueue[requestParameters.priority].emplace_front(std::move(request));
 			mustThrottle = true;
 		}
 
 		const auto remainingCount {headerReadAs<std::size_t>(msg, "X-RateLimit-Remaining")};
+		const auto waitDuration {headerReadAs<std::chrono::seconds>(msg, "X-RateLimit-Reset-In")};
 		LOG(DEBUG) << "Remaining messages = " << (remainingCount ? *remainingCount : 0);
 		if (mustThrottle || (remainingCount && *remainingCount == 0))
-		{
-			const auto waitDuration {headerReadAs<std::chrono::seconds>(msg, "X-RateLimit-Reset-In")};
 			throttle(waitDuration.value_or(_defaultRetryWaitDuration));
-		}
+
+		if (requestParameters.onRateLimitFunc && (mustThrottle || remainingCount))
+			requestParameters.onRateLimitFunc(mustThrottle ? 0 : *remainingCount, waitDuration.value_or(_defaultRetryWaitDuration));
 
 		if (!mustThrottle)
 		{
@@ -206,25 +320,29 @@ namespace Http
 			else
 			{
 				LOG(ERROR) << "Send error: '" << msg.body() << "'";
+				{
+					const std::scoped_lock lock {_statsMutex};
+					_stats.failureCount++;
+				}
 				if (requestParameters.onFailureFunc)
 					requestParameters.onFailureFunc();
 			}
 		}
-
-		if (_state == State::Idle)
-			sendNextQueuedRequest();
 	}
 
 	void
 	SendQueue::throttle(std::chrono::seconds requestedDuration)
 	{
-		assert(_state == State::Idle);
-
 		const std::chrono::seconds duration {clamp(requestedDuration, _minRetryWaitDuration, _maxRetryWaitDuration)};
+
+		// other in-flight requests may ask for throttling too: keep the latest deadline
+		if (_throttled && _throttleTimer.expiry() >= boost::asio::steady_timer::clock_type::now() + duration)
+			return;
+
 		LOG(DEBUG) << "Throttling for " << duration.count() << " seconds";
 
 		_throttleTimer.expires_after(duration);
-		_throttleTimer.async_wait([this](const boost::system::error_code& ec)
+		_throttleTimer.async_wait(boost::asio::bind_executor(_strand, [this](const boost::system::error_code& ec)
 		{
 			if (ec == boost::asio::error::operation_aborted)
 			{
@@ -236,9 +354,20 @@ namespace Http
 				throw LmsException {"Throttle timer failure: " + std::string {ec.message()} };
 			}
 
-			_state = State::Idle;
-			sendNextQueuedRequest();
-		});
-		_state = State::Throttled;
+			{
+				const std::scoped_lock lock {_statsMutex};
+				_throttled = false;
+				_stats.throttledDuration += std::chrono::steady_clock::now() - _throttleStartTime;
+			}
+			sendNextQueuedRequests();
+			updateStats();
+		}));
+
+		if (!_throttled)
+		{
+			const std::scoped_lock lock {_statsMutex};
+			_throttled = true;
+			_throttleStartTime = std::chrono::steady_clock::now();
+		}
 	}
 } // namespace Scrobbling::ListenBrainz
@@ -20,6 +20,9 @@
 #pragma once
 
 #include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <string_view>
 
@@ -28,6 +31,7 @@
 #include <boost/asio/steady_timer.hpp>
 
 #include <Wt/Http/Client.h>
+#include "utils/http/IClient.hpp"
 #include "ClientRequest.hpp"
 
 namespace Http
@@ -35,7 +39,7 @@ namespace Http
 	class SendQueue
 	{
 		public:
-			SendQueue(boost::asio::io_context& ioContext, std::string_view baseUrl);
+			SendQueue(boost::asio::io_context& ioContext, std::string_view baseUrl, std::size_t maxInFlightRequestCount);
 			~SendQueue();
 
 			SendQueue(const SendQueue&) = delete;
@@ -45,13 +49,28 @@ namespace Http
 
 			void sendRequest(std::unique_ptr<ClientRequest> request);
 
+			// can be called from any thread
+			ClientStats getStats() const;
+
 		private:
-			void sendNextQueuedRequest();
-			bool sendRequest(const ClientRequest& request);
-			void onClientDone(Wt::AsioWrapper::error_code ec, const Wt::Http::Message& msg);
+			// Each slot owns a client, reused from one request to another
+			struct Slot
+			{
+				Slot(boost::asio::io_context& ioContext) : client {ioContext} {}
+
+				Wt::Http::Client						client;
+				std::unique_ptr<ClientRequest>			request;
+				std::chrono::steady_clock::time_point	sendTime;
+			};
+
+			void sendNextQueuedRequests();
+			Slot* findIdleSlot();
+			bool sendRequest(Slot& slot, const ClientRequest& request);
+			void onClientDone(Slot& slot, Wt::AsioWrapper::error_code ec, const Wt::Http::Message& msg);
 			void onClientDoneError(std::unique_ptr<ClientRequest> request, Wt::AsioWrapper::error_code ec);
 			void onClientDoneSuccess(std::unique_ptr<ClientRequest> request, const Wt::Http::Message& msg);
 			void throttle(std::chrono::seconds duration);
+			void updateStats();
 
 			const std::size_t			_maxRetryCount {2};
 			const std::chrono::seconds	_defaultRetryWaitDuration {30};
@@ -63,16 +82,14 @@ namespace Http
 			boost::asio::steady_timer		_throttleTimer {_ioContext};
 			std::string						_baseUrl;
 
-			enum class State
-			{
-				Idle,
-				Throttled,
-				Sending,
-			};
-			State								_state {State::Idle};
-			Wt::Http::Client					_client {_ioContext};
+			bool									_throttled {};
+			std::chrono::steady_clock::time_point	_throttleStartTime;
+			std::vector<std::unique_ptr<Slot>>	_slots;
 			std::map<ClientRequestParameters::Priority, std::deque<std::unique_ptr<ClientRequest>>> _sendQueue;
-			std::unique_ptr<ClientRequest>		_currentRequest;
+
+			// copy of the strand state, for the readers
+			mutable std::mutex	_statsMutex;
+			ClientStats			_stats;
 	};
 
 } // namespace Scrobbling::ListenBrainz
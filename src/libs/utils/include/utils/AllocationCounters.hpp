@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+// Per thread counters of the allocations made using operator new
+// Only available when LMS is built with LMS_ALLOCATION_PROFILING, the counters stay at zero otherwise
+namespace AllocationCounters
+{
+	struct Counters
+	{
+		std::uint64_t	allocationCount {};
+		std::uint64_t	allocatedBytes {};
+	};
+
+	bool		isEnabled();
+	Counters	getThreadCounters(); // since the thread has started
+
+	// Allocations made by the current thread since construction
+	class ScopedCounter
+	{
+		public:
+			ScopedCounter() : _start {getThreadCounters()} {}
+
+			ScopedCounter(const ScopedCounter&) = delete;
+			ScopedCounter& operator=(const ScopedCounter&) = delete;
+
+			Counters get() const
+			{
+				const Counters current {getThreadCounters()};
+				return {current.allocationCount - _start.allocationCount, current.allocatedBytes - _start.allocatedBytes};
+			}
+
+		private:
+			const Counters _start;
+	};
+}
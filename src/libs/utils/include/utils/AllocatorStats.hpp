@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace Metrics
+{
+	class Registry;
+}
+
+// Statistics of the memory allocator LMS has been built with (see LMS_ALLOCATOR)
+// Values the allocator does not report are left empty
+namespace AllocatorStats
+{
+	struct ArenaStats
+	{
+		std::size_t	index {};
+		std::size_t	allocated {};	// in use by the application
+		std::size_t	active {};		// in the pages that hold allocations
+	};
+
+	struct Stats
+	{
+		std::optional<std::size_t>	allocated;
+		std::optional<std::size_t>	active;
+		std::optional<std::size_t>	mapped;		// obtained from the system
+		std::optional<std::size_t>	resident;	// physically resident, falls back on the process resident size
+		std::vector<ArenaStats>		arenas;
+	};
+
+	std::string_view			getAllocatorName(); // "glibc", "jemalloc", "mimalloc" or "system"
+	Stats						getStats(); // may be costly, not to be called on each allocation-heavy operation
+	std::optional<double>		getFragmentation(const Stats& stats); // share of the active memory not allocated, in [0, 1]
+	std::optional<std::size_t>	getProcessResidentSize();
+
+	// Exports the statistics, computed each time the metrics are collected
+	void						registerMetrics(Metrics::Registry& registry);
+}
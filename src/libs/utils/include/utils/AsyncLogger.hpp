@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils/Logger.hpp"
+
+// Hands the logs over to a dedicated thread, that writes them using the wrapped logger
+// Producers push into a bounded lock-free ring buffer, so that they never wait for the writes
+class AsyncLogger final : public Logger
+{
+	public:
+		enum class OverflowPolicy
+		{
+			Drop,	// dropped logs are counted and reported
+			Block,	// wait for the writer thread to make some room
+		};
+
+		struct Parameters
+		{
+			std::size_t		queueSize {8192}; // rounded up to a power of two
+			OverflowPolicy	overflowPolicy {OverflowPolicy::Drop};
+		};
+
+		AsyncLogger(std::unique_ptr<Logger> logger, const Parameters& params);
+		~AsyncLogger(); // writes the pending logs
+
+		AsyncLogger(const AsyncLogger&) = delete;
+		AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+		void processLog(const Log& log) override;
+
+		std::size_t getDroppedLogCount() const { return _droppedLogCount; }
+
+	private:
+		struct Record
+		{
+			Module			module;
+			Severity		severity;
+			std::thread::id	threadId;
+			std::string		message;
+		};
+
+		// See Dmitry Vyukov's bounded MPMC queue: only one consumer here
+		struct Cell
+		{
+			std::atomic<std::size_t>	sequence;
+			Record						record;
+		};
+
+		bool tryPush(Record& record);
+		bool tryPop(Record& record);
+		bool isEmpty() const;
+		void wakeUpWriter();
+		void writeLoop();
+		std::size_t writePendingLogs();
+
+		const std::unique_ptr<Logger>	_logger;
+		const OverflowPolicy			_overflowPolicy;
+
+		std::vector<Cell>			_cells;
+		const std::size_t			_mask;
+		std::atomic<std::size_t>	_enqueuePos {};
+		std::size_t					_dequeuePos {}; // writer thread only
+
+		std::atomic<std::size_t>	_droppedLogCount {};
+		std::size_t					_reportedDroppedLogCount {}; // writer thread only
+
+		std::mutex					_writerMutex;
+		std::condition_variable		_writerCondition;
+		std::atomic<bool>			_writerSleeping {};
+		std::atomic<bool>			_stopping {};
+		std::thread					_writerThread;
+};
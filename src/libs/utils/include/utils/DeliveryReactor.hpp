@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include <boost/asio/io_context.hpp>
+
+#include "utils/IOContextRunner.hpp"
+
+// Dedicated threads producing the media content (file chunks, zip archives, transcoder output) ahead of the Wt continuations
+// Keeps playback isolated from the UI and API load on the Wt threads
+class DeliveryReactor
+{
+	public:
+		DeliveryReactor(std::size_t threadCount)
+		: _ioContextRunner {_ioContext, threadCount}
+		{}
+
+		DeliveryReactor(const DeliveryReactor&) = delete;
+		DeliveryReactor(DeliveryReactor&&) = delete;
+		DeliveryReactor& operator=(const DeliveryReactor&) = delete;
+		DeliveryReactor& operator=(DeliveryReactor&&) = delete;
+
+		boost::asio::io_context& getIoContext() { return _ioContext; }
+
+	private:
+		boost::asio::io_context	_ioContext;
+		IOContextRunner			_ioContextRunner;
+};
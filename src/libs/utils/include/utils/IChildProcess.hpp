@@ -50,5 +50,8 @@ class IChildProcess
 
 		virtual std::size_t	readSome(std::byte* data, std::size_t bufferSize) = 0;
 		virtual bool		finished() const = 0;
+
+		// the pending read then completes with EndOfFile
+		virtual void		kill() = 0;
 };
 
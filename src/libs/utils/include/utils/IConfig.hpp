@@ -18,16 +18,29 @@
  */
 #pragma once
 
+#include <cstddef>
 #include <filesystem>
 #include <functional>
+#include <memory>
 #include <string_view>
 
 // Used to get config values from configuration files
+// Values are parsed once, and then again only on reload
 class IConfig
 {
 	public:
 		virtual ~IConfig() = default;
 
+		// Reread the configuration file, throws and keeps the current values on error
+		// Returned string views remain valid across reloads
+		virtual void					reload() = 0;
+
+		// Called from the reloading thread, once the new values are visible
+		using ReloadCallback = std::function<void()>;
+		using ReloadCallbackId = std::size_t;
+		virtual ReloadCallbackId		addReloadCallback(ReloadCallback callback) = 0;
+		virtual void					removeReloadCallback(ReloadCallbackId callbackId) = 0;
+
 		// Default values are returned in case of setting not found
 		virtual std::string_view		getString(std::string_view setting, std::string_view def = "") = 0;
 		virtual void					visitStrings(std::string_view setting, std::function<void(std::string_view)> _func, std::initializer_list<std::string_view> def = {}) = 0;
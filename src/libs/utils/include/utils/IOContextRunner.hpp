@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <functional>
 #include <optional>
 #include <thread>
 #include <boost/asio/io_service.hpp>
@@ -26,7 +27,7 @@
 class IOContextRunner
 {
 	public:
-		IOContextRunner(boost::asio::io_service& ioService, std::size_t threadCount);
+		IOContextRunner(boost::asio::io_service& ioService, std::size_t threadCount, std::function<void()> threadInit = {}); // threadInit is run first on each thread
 		~IOContextRunner();
 
 		IOContextRunner(const IOContextRunner&) = delete;
@@ -21,6 +21,7 @@
 
 #include <filesystem>
 #include <memory>
+#include <optional>
 #include <vector>
 
 #include "Exception.hpp"
@@ -47,8 +48,16 @@ namespace Zip
 			virtual std::uint64_t writeSome(std::ostream& output) = 0;
 			virtual bool isComplete() const = 0;
 			virtual void abort() = 0;
+
+			// Exact size of the archive, if known before it is written
+			virtual std::optional<std::uint64_t> getTotalSize() const = 0;
+			// Only if the total size is known: restricts the output to the given range
+			virtual void setRange(std::uint64_t offset, std::uint64_t size) = 0;
 	};
 
+	// Deflate compression, total size unknown
 	std::unique_ptr<IZipper> createArchiveZipper(const EntryContainer& entries);
+	// No compression, exact total size and range support
+	std::unique_ptr<IZipper> createStoreZipper(const EntryContainer& entries);
 } // namespace Zip
 
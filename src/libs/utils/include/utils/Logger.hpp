@@ -19,8 +19,13 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <sstream>
+#include <thread>
 
 #include "Service.hpp"
 
@@ -53,21 +58,25 @@ enum class Module
     RECOMMENDATION,
     TRANSCODING,
     UI,
-    UTILS,
+    UTILS, // must be the last one
 };
+constexpr std::size_t moduleCount{ static_cast<std::size_t>(Module::UTILS) + 1 };
 
 const char* getModuleName(Module mod);
 const char* getSeverityName(Severity sev);
+std::optional<Module> getModuleByName(std::string_view name);
+std::optional<Severity> getSeverityByName(std::string_view name);
 
 class Logger;
 class Log
 {
 public:
-    Log(Logger* logger, Module module, Severity severity);
+    Log(Logger* logger, Module module, Severity severity, std::thread::id threadId = std::this_thread::get_id());
     ~Log();
 
     Module getModule() const { return _module; }
     Severity getSeverity() const { return _severity; }
+    std::thread::id getThreadId() const { return _threadId; } // thread that emitted the log
     std::string getMessage() const;
 
     std::ostringstream& getOstream() { return _oss; }
@@ -78,6 +87,7 @@ private:
 
     Module _module;
     Severity _severity;
+    std::thread::id _threadId;
     std::ostringstream _oss;
     Logger* _logger{};
 };
@@ -85,9 +95,26 @@ private:
 class Logger
 {
 public:
+    Logger();
     virtual ~Logger() = default;
     virtual void processLog(const Log& log) = 0;
+
+    // Checked before building the log messages: can be changed at any time
+    bool isLogged(Module module, Severity severity) const { return severity <= getMinSeverity(module); }
+    Severity getMinSeverity(Module module) const { return _minSeverities[static_cast<std::size_t>(module)].load(std::memory_order_relaxed); }
+    void setMinSeverity(Module module, Severity severity);
+    void setMinSeverity(Severity severity); // all modules
+
+private:
+    std::array<std::atomic<Severity>, moduleCount> _minSeverities;
+};
+
+// Turns log statements into void expressions, so that they can be skipped using the conditional operator
+struct LogVoidify
+{
+    void operator&(std::ostream&) {}
 };
 
-#define LMS_LOG(module, severity)		Log{Service<Logger>::get(), Module::module, Severity::severity}.getOstream()
-#define LMS_LOG_EX(module, severity)	Log{Service<Logger>::get(), module, severity}.getOstream()
+// Disabled log statements only cost a branch: the operands are not evaluated
+#define LMS_LOG(module, severity)		LMS_LOG_EX(Module::module, Severity::severity)
+#define LMS_LOG_EX(module, severity)	!(Service<Logger>::get() && Service<Logger>::get()->isLogged(module, severity)) ? (void)0 : LogVoidify{} & Log{ Service<Logger>::get(), module, severity }.getOstream()
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// In-process metrics, exported using the Prometheus text exposition format
+// Updates are lock-free, only the registration takes a lock
+namespace Metrics
+{
+	class Counter
+	{
+		public:
+			void			increment(std::uint64_t value = 1) { _value.fetch_add(value, std::memory_order_relaxed); }
+			std::uint64_t	getValue() const { return _value.load(std::memory_order_relaxed); }
+
+		private:
+			std::atomic<std::uint64_t> _value {};
+	};
+
+	class Gauge
+	{
+		public:
+			void			set(std::int64_t value) { _value.store(value, std::memory_order_relaxed); }
+			void			increment(std::int64_t value = 1) { _value.fetch_add(value, std::memory_order_relaxed); }
+			void			decrement(std::int64_t value = 1) { _value.fetch_sub(value, std::memory_order_relaxed); }
+			std::int64_t	getValue() const { return _value.load(std::memory_order_relaxed); }
+
+		private:
+			std::atomic<std::int64_t> _value {};
+	};
+
+	class Histogram
+	{
+		public:
+			Histogram(std::vector<double> bucketBounds); // upper bounds, must be sorted
+
+			void observe(double value);
+
+			const std::vector<double>&	getBucketBounds() const { return _bucketBounds; }
+			std::vector<std::uint64_t>	getCumulativeBucketCounts() const;
+			std::uint64_t				getCount() const { return _count.load(std::memory_order_relaxed); }
+			double						getSum() const { return _sum.load(std::memory_order_relaxed); }
+
+		private:
+			const std::vector<double>						_bucketBounds;
+			std::unique_ptr<std::atomic<std::uint64_t>[]>	_bucketCounts; // not cumulative, values above the last bound only count in +Inf
+			std::atomic<std::uint64_t>						_count {};
+			std::atomic<double>								_sum {};
+	};
+
+	class Registry
+	{
+		public:
+			Registry() = default;
+			Registry(const Registry&) = delete;
+			Registry& operator=(const Registry&) = delete;
+
+			using Labels = std::vector<std::pair<std::string, std::string>>;
+
+			// Returned metrics live as long as the registry: callers are expected to keep them, not to look them up on each update
+			// Getting an existing metric returns it, throws if it has been registered with another type
+			Counter&	getCounter(std::string_view name, std::string_view help, const Labels& labels = {});
+			Gauge&		getGauge(std::string_view name, std::string_view help, const Labels& labels = {});
+			Histogram&	getHistogram(std::string_view name, std::string_view help, const std::vector<double>& bucketBounds, const Labels& labels = {});
+
+			// For values that are computed when exported: must write complete metric families
+			// Called with the registry locked, must not use the registry
+			using Collector = std::function<void(std::ostream&)>;
+			void		addCollector(Collector collector);
+
+			void		write(std::ostream& os) const;
+
+		private:
+			enum class Type
+			{
+				Counter,
+				Gauge,
+				Histogram,
+			};
+
+			struct Family
+			{
+				Type		type;
+				std::string	help;
+				std::map<std::string, std::unique_ptr<Counter>>		counters;	// by formatted labels
+				std::map<std::string, std::unique_ptr<Gauge>>		gauges;
+				std::map<std::string, std::unique_ptr<Histogram>>	histograms;
+			};
+
+			static const char*	getTypeName(Type type);
+			Family&	getFamily(std::string_view name, std::string_view help, Type type);
+
+			mutable std::mutex				_mutex;
+			std::map<std::string, Family>	_families;
+			std::vector<Collector>			_collectors;
+	};
+
+	std::string	escapeLabelValue(std::string_view value);
+	std::string	formatLabels(const Registry::Labels& labels); // without braces
+} // namespace Metrics
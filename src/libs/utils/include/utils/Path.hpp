@@ -19,9 +19,12 @@
 
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
 #include <functional>
+#include <optional>
 #include <string>
+#include <system_error>
 #include <vector>
 
 #include <Wt/WDateTime.h>
@@ -37,6 +40,52 @@ namespace PathUtils
 	// Get the last write time since Epoch
 	Wt::WDateTime getLastWriteTime(const std::filesystem::path& dir);
 
+	struct FileInfo
+	{
+		Wt::WDateTime	lastWriteTime;
+		std::uintmax_t	size {};
+		std::uint64_t	device {};
+		std::uint64_t	inode {};	// 0 if unknown (device is then unknown too)
+	};
+	// Get the last write time, the size and the location of a file using a single stat call
+	FileInfo getFileInfo(const std::filesystem::path& file);
+
+	struct DirectoryEntry
+	{
+		enum class Type
+		{
+			Regular,
+			Directory,
+		};
+
+		std::filesystem::path	path;
+		Type					type {Type::Regular};
+		std::error_code			ec;			// set if the entry could not be stat'ed
+		std::optional<FileInfo>	fileInfo;	// regular files only, if requested
+	};
+
+	struct DirectoryListing
+	{
+		std::filesystem::path		directory;
+		std::error_code				ec;				// set if the directory could not be read entirely
+		Wt::WDateTime				lastWriteTime;	// of the directory itself, invalid if unknown
+		std::size_t					entryCount {};	// all the entries, including the ones that are not reported
+		std::vector<DirectoryEntry>	entries;		// regular files and directories (symlinks followed), sorted by path
+	};
+
+	struct ExploreParameters
+	{
+		std::size_t										readConcurrency {8};	// max directories read at the same time
+		const std::filesystem::path*					excludeDirFileName {};	// skip directories that contain this file (and their subdirectories)
+		std::function<bool(const std::filesystem::path&)>	fileFilter;			// regular files to report, called from reading threads
+		bool											getFileInfo {};			// also get the info of the reported regular files
+	};
+
+	// Directories are read ahead by several threads, up to a bounded number of listings
+	// Listings are reported from the calling thread, in depth first order
+	// returns false if aborted by user
+	bool exploreDirectoriesRecursive(const std::filesystem::path& directory, std::function<bool(const DirectoryListing&)> cb, const ExploreParameters& params = {});
+
 	// returns false if aborted by user
 	bool exploreFilesRecursive(const std::filesystem::path& directory, std::function<bool(std::error_code, const std::filesystem::path&)> cb, const std::filesystem::path* excludeDirFileName = {});
 
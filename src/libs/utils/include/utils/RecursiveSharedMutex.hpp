@@ -19,12 +19,12 @@
 
 #pragma once
 
-#include <mutex>
+#include <atomic>
 #include <shared_mutex>
 #include <thread>
-#include <unordered_map>
 
 // API compatible with shared_mutex
+// Shared recursion depths are kept in thread local storage: readers only contend on the underlying shared_mutex
 class RecursiveSharedMutex
 {
 	public:
@@ -35,15 +35,13 @@ class RecursiveSharedMutex
 		void unlock_shared();
 
 #ifndef NDEBUG
-		bool isSharedLocked();
-		bool isUniqueLocked();
+		bool isSharedLocked() const;
+		bool isUniqueLocked() const;
 #endif // NDEBUG
 	private:
-		std::shared_mutex _mutex;
-		std::thread::id _uniqueOwner;
-		std::size_t _uniqueCount{};
+		bool isUniqueOwner() const { return _uniqueOwner.load(std::memory_order_relaxed) == std::this_thread::get_id(); }
 
-		std::mutex _sharedCountMutex;
-		std::unordered_map<std::thread::id, std::size_t> _sharedCounts;
+		std::shared_mutex _mutex;
+		std::atomic<std::thread::id> _uniqueOwner;
+		std::size_t _uniqueCount{}; // only accessed by the unique owner
 };
-
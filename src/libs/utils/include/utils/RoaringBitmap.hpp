@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compressed set of 32 bit values, using the roaring bitmap layout:
+// values are grouped by their 16 high bits, each group is stored as a sorted array when sparse, as a bitset when dense
+class RoaringBitmap
+{
+	public:
+		using value_type = std::uint32_t;
+
+		RoaringBitmap() = default;
+
+		// Faster when values are added in increasing order
+		void		add(value_type value);
+		bool		contains(value_type value) const;
+
+		bool		empty() const { return _containers.empty(); }
+		std::size_t	size() const;
+		void		clear() { _containers.clear(); }
+
+		// func(value) is called in increasing order
+		template <typename Func>
+		void		visit(Func&& func) const;
+		std::vector<value_type> toVector() const;
+
+		static RoaringBitmap	intersect(const RoaringBitmap& a, const RoaringBitmap& b);
+
+		std::size_t	getMemoryUsage() const; // approximate, in bytes
+
+	private:
+		static constexpr std::size_t maxArraySize {4096}; // bigger arrays take more memory than bitsets
+		static constexpr std::size_t bitsetWordCount {65536 / 64};
+
+		struct Container
+		{
+			std::uint16_t							key {}; // 16 high bits
+			std::uint32_t							cardinality {};
+			std::vector<std::uint16_t>				array;	// sorted, if sparse
+			std::vector<std::uint64_t>				bitset;	// bitsetWordCount words, if dense
+
+			bool	isBitset() const { return !bitset.empty(); }
+			void	add(std::uint16_t value);
+			bool	contains(std::uint16_t value) const;
+			void	convertToBitset();
+			void	convertToArray();
+		};
+
+		static Container	intersect(const Container& a, const Container& b);
+
+		Container*			findContainer(std::uint16_t key);
+		const Container*	findContainer(std::uint16_t key) const;
+
+		std::vector<Container>	_containers; // sorted by key
+};
+
+template <typename Func>
+void
+RoaringBitmap::visit(Func&& func) const
+{
+	for (const Container& container : _containers)
+	{
+		const value_type high {static_cast<value_type>(container.key) << 16};
+
+		if (container.isBitset())
+		{
+			for (std::size_t wordIndex {}; wordIndex < bitsetWordCount; ++wordIndex)
+			{
+				std::uint64_t word {container.bitset[wordIndex]};
+				while (word)
+				{
+					const unsigned bitIndex {static_cast<unsigned>(__builtin_ctzll(word))};
+					func(high | static_cast<value_type>(wordIndex * 64 + bitIndex));
+					word &= word - 1;
+				}
+			}
+		}
+		else
+		{
+			for (const std::uint16_t low : container.array)
+				func(high | low);
+		}
+	}
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/io_context_strand.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+// Periodic syncs of a set of entries (typically users), spread evenly over the period instead of being started all at once
+// Entries whose last syncs found nothing new are skipped for more and more periods, until something changes locally
+// No sync is started while the remote server reports it is running out of requests
+// All the calls must be made from the strand
+template <typename Key>
+class StaggeredScheduler
+{
+	public:
+		struct Parameters
+		{
+			std::chrono::milliseconds	period;
+			std::chrono::milliseconds	firstPeriodDelay {std::chrono::seconds {30}};
+			std::size_t					maxSkippedPeriodCount {}; // 0 means entries are synced at each period
+			std::size_t					minRemainingRequestCount {2}; // below this, wait for the rate limit to be reset
+		};
+
+		using ListKeysFunction = std::function<std::vector<Key>()>; // called at the start of each period
+		using SyncFunction = std::function<void(Key)>; // onSyncEnded must be called once the sync is done
+
+		StaggeredScheduler(boost::asio::io_context::strand& strand, const Parameters& params, ListKeysFunction listKeysFunc, SyncFunction syncFunc)
+		: _strand {strand}
+		, _params {params}
+		, _listKeysFunc {std::move(listKeysFunc)}
+		, _syncFunc {std::move(syncFunc)}
+		, _timer {strand.context()}
+		{}
+
+		StaggeredScheduler(const StaggeredScheduler&) = delete;
+		StaggeredScheduler& operator=(const StaggeredScheduler&) = delete;
+
+		void start()
+		{
+			schedule(_params.firstPeriodDelay, [this] { startPeriod(); });
+		}
+
+		// forces the next sync of the entry
+		void onLocalChange(Key key)
+		{
+			_entries[key].localChange = true;
+		}
+
+		// foundChanges is empty when the sync could not tell (failure, etc.)
+		void onSyncEnded(Key key, std::optional<bool> foundChanges)
+		{
+			Entry& entry {_entries[key]};
+			entry.syncing = false;
+			if (foundChanges)
+				entry.idleSyncCount = *foundChanges ? 0 : entry.idleSyncCount + 1;
+		}
+
+		void onRateLimit(std::size_t remainingRequestCount, std::chrono::seconds resetIn)
+		{
+			if (remainingRequestCount < _params.minRemainingRequestCount)
+				_rateLimitedUntil = std::max(_rateLimitedUntil, Clock::now() + resetIn);
+		}
+
+		bool isSyncing(Key key) const
+		{
+			auto itEntry {_entries.find(key)};
+			return itEntry != std::cend(_entries) && itEntry->second.syncing;
+		}
+
+		std::chrono::milliseconds getSyncInterval() const { return _syncInterval; }
+
+	private:
+		using Clock = boost::asio::steady_timer::clock_type;
+
+		struct Entry
+		{
+			bool			syncing {};
+			bool			localChange {};
+			std::size_t		idleSyncCount {}; // consecutive syncs that found nothing new
+			std::size_t		skippedPeriodCount {};
+		};
+
+		template <typename Func>
+		void schedule(Clock::duration fromNow, Func func)
+		{
+			_timer.expires_after(fromNow);
+			_timer.async_wait(boost::asio::bind_executor(_strand, [this, func](const boost::system::error_code& ec)
+			{
+				if (ec == boost::asio::error::operation_aborted)
+					return;
+
+				func();
+			}));
+		}
+
+		void startPeriod()
+		{
+			_periodEnd = Clock::now() + _params.period;
+
+			const std::vector<Key> keys {_listKeysFunc()};
+			_pendingKeys.assign(std::cbegin(keys), std::cend(keys));
+			_syncInterval = keys.empty() ? std::chrono::milliseconds {} : _params.period / static_cast<std::chrono::milliseconds::rep>(keys.size());
+
+			// forget the entries that are no longer listed
+			const std::unordered_set<Key> listedKeys {std::cbegin(keys), std::cend(keys)};
+			for (auto itEntry {std::begin(_entries)}; itEntry != std::end(_entries);)
+			{
+				if (!itEntry->second.syncing && listedKeys.find(itEntry->first) == std::cend(listedKeys))
+					itEntry = _entries.erase(itEntry);
+				else
+					++itEntry;
+			}
+
+			startNextSync();
+		}
+
+		void startNextSync()
+		{
+			if (_pendingKeys.empty())
+			{
+				schedule(std::max(_periodEnd - Clock::now(), Clock::duration::zero()), [this] { startPeriod(); });
+				return;
+			}
+
+			if (const Clock::time_point now {Clock::now()}; now < _rateLimitedUntil)
+			{
+				schedule(_rateLimitedUntil - now, [this] { startNextSync(); });
+				return;
+			}
+
+			const Key key {_pendingKeys.front()};
+			_pendingKeys.pop_front();
+
+			Entry& entry {_entries[key]};
+			if (mustSync(entry))
+			{
+				entry.syncing = true;
+				entry.localChange = false;
+				entry.skippedPeriodCount = 0;
+				_syncFunc(key);
+			}
+
+			// skipped entries keep their slot, so that the other syncs stay evenly spread
+			schedule(_syncInterval, [this] { startNextSync(); });
+		}
+
+		bool mustSync(Entry& entry) const
+		{
+			if (entry.syncing)
+				return false;
+
+			if (entry.localChange)
+				return true;
+
+			if (entry.skippedPeriodCount < std::min(entry.idleSyncCount, _params.maxSkippedPeriodCount))
+			{
+				entry.skippedPeriodCount++;
+				return false;
+			}
+
+			return true;
+		}
+
+		boost::asio::io_context::strand&	_strand;
+		const Parameters					_params;
+		const ListKeysFunction				_listKeysFunc;
+		const SyncFunction					_syncFunc;
+		boost::asio::steady_timer			_timer;
+
+		std::unordered_map<Key, Entry>		_entries;
+		std::deque<Key>						_pendingKeys; // not yet synced during the current period
+		std::chrono::milliseconds			_syncInterval {};
+		Clock::time_point					_periodEnd;
+		Clock::time_point					_rateLimitedUntil;
+};
@@ -19,11 +19,17 @@
 
 #pragma once
 
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
 #include <initializer_list>
+#include <iterator>
 #include <optional>
 #include <string>
 #include <string_view>
 #include <sstream>
+#include <system_error>
+#include <type_traits>
 #include <vector>
 
 #define QUOTEME(x) QUOTEME_1(x)
@@ -37,6 +43,64 @@ namespace Wt
 
 namespace StringUtils {
 
+    // Iterates over the non empty tokens of a string, without allocating
+    class StringTokenizer
+    {
+    public:
+        class Iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::string_view;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const std::string_view*;
+            using reference = const std::string_view&;
+
+            Iterator() = default;
+
+            reference operator*() const { return _token; }
+            pointer operator->() const { return &_token; }
+            Iterator& operator++() { next(_token.data() + _token.size() - _str.data()); return *this; }
+            Iterator operator++(int) { Iterator res{ *this }; ++(*this); return res; }
+
+            bool operator==(const Iterator& other) const { return _token.data() == other._token.data(); }
+            bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+        private:
+            friend class StringTokenizer;
+            Iterator(std::string_view str, std::string_view separators) : _str{ str }, _separators{ separators } { next(0); }
+
+            void next(std::size_t pos)
+            {
+                const std::size_t tokenBegin{ _str.find_first_not_of(_separators, pos) };
+                if (tokenBegin == std::string_view::npos)
+                {
+                    _token = {};
+                    return;
+                }
+
+                const std::size_t tokenEnd{ std::min(_str.find_first_of(_separators, tokenBegin), _str.size()) };
+                _token = _str.substr(tokenBegin, tokenEnd - tokenBegin);
+            }
+
+            std::string_view _str;
+            std::string_view _separators;
+            std::string_view _token; // null data once past the end
+        };
+
+        StringTokenizer(std::string_view str, std::string_view separators) : _str{ str }, _separators{ separators } {}
+
+        Iterator begin() const { return Iterator{ _str, _separators }; }
+        Iterator end() const { return Iterator{}; }
+
+    private:
+        std::string_view _str;
+        std::string_view _separators;
+    };
+
+    // Separators and str must outlive the returned tokenizer
+    [[nodiscard]] inline StringTokenizer tokenizeString(std::string_view str, std::string_view separators) { return StringTokenizer{ str, separators }; }
+
     [[nodiscard]] std::vector<std::string> splitStringCopy(std::string_view string, std::string_view separators);
 
     [[nodiscard]] std::vector<std::string_view> splitString(std::string_view string, std::string_view separators);
@@ -55,19 +119,44 @@ namespace StringUtils {
 
     [[nodiscard]] std::string bufferToString(const std::vector<unsigned char>& data);
 
+    // Unicode simple case folding, for Latin, Greek and Cyrillic scripts (other characters are left untouched)
+    // ASCII only strings do not go through UTF-8 decoding. Invalid UTF-8 sequences are compared byte by byte
+    [[nodiscard]] std::string foldCase(std::string_view str);
+    [[nodiscard]] int stringCaseInsensitiveCompare(std::string_view strA, std::string_view strB); // <0, 0 or >0, using folded code points
     [[nodiscard]] bool stringCaseInsensitiveEqual(std::string_view strA, std::string_view strB);
 
+    // Key to sort names using a plain byte comparison: trimmed, case folded, diacritics removed (Latin letters)
+    // and without leading English article ("the", "a", "an")
+    [[nodiscard]] std::string computeSortKey(std::string_view str);
+
     void capitalize(std::string& str);
 
+    // Integers are parsed without allocation, with the same leniency as streams (leading spaces and sign, trailing characters ignored)
     template<typename T>
     [[nodiscard]] std::optional<T> readAs(std::string_view str)
     {
         T res;
 
-        std::istringstream iss{ std::string {str} };
-        iss >> res;
-        if (iss.fail())
-            return std::nullopt;
+        if constexpr (std::is_integral_v<T>)
+        {
+            const std::size_t start{ str.find_first_not_of(" \t\n\v\f\r") };
+            if (start == std::string_view::npos)
+                return std::nullopt;
+            str.remove_prefix(start);
+            if (str.size() > 1 && str.front() == '+' && str[1] != '-')
+                str.remove_prefix(1);
+
+            const auto [ptr, ec]{ std::from_chars(str.data(), str.data() + str.size(), res) };
+            if (ec != std::errc{})
+                return std::nullopt;
+        }
+        else
+        {
+            std::istringstream iss{ std::string {str} };
+            iss >> res;
+            if (iss.fail())
+                return std::nullopt;
+        }
 
         return res;
     }
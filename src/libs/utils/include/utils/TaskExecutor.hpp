@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Shared pool of worker threads: each worker has its own task queues, and steals from the other ones when idle
+// Interactive tasks are always picked before background ones
+class TaskExecutor
+{
+	public:
+		enum class Priority
+		{
+			Interactive,
+			Background,
+		};
+
+		using Task = std::function<void()>;
+
+		TaskExecutor(std::size_t threadCount, Task workerInit = {}); // workerInit is run first on each worker thread
+		~TaskExecutor(); // runs the pending tasks before returning
+
+		TaskExecutor(const TaskExecutor&) = delete;
+		TaskExecutor(TaskExecutor&&) = delete;
+		TaskExecutor& operator=(const TaskExecutor&) = delete;
+		TaskExecutor& operator=(TaskExecutor&&) = delete;
+
+		std::size_t	getThreadCount() const { return _workers.size(); }
+
+		// Tasks posted from a worker go to its own queue (run last in, first out, other workers steal the oldest ones)
+		void		post(Task task, Priority priority = Priority::Background);
+
+		bool		isWorkerThread() const;
+
+		// Must be called from a worker thread, runs one pending task if any
+		bool		runPendingTask();
+
+	private:
+		static constexpr std::size_t priorityCount {2};
+
+		struct Queue
+		{
+			std::mutex			mutex;
+			std::deque<Task>	tasks;
+		};
+		using Queues = std::array<Queue, priorityCount>;
+
+		struct Worker
+		{
+			Queues		queues;
+			std::thread	thread;
+		};
+
+		void	workerLoop(std::size_t workerIndex);
+		bool	popTask(std::size_t workerIndex, Task& task);
+		bool	stealTask(std::size_t workerIndex, std::size_t priorityIndex, Task& task);
+		void	runTask(Task& task);
+
+		std::vector<std::unique_ptr<Worker>>	_workers;
+		Queues									_sharedQueues; // for the tasks posted from outside the workers
+		std::atomic<std::size_t>				_pendingCount {};
+
+		std::mutex								_sleepMutex;
+		std::condition_variable					_sleepCondVar;
+		bool									_stop {};
+};
+
+// Set of tasks that can be waited for
+class TaskGroup
+{
+	public:
+		TaskGroup(TaskExecutor& executor, TaskExecutor::Priority priority = TaskExecutor::Priority::Background);
+		~TaskGroup(); // waits for the tasks
+
+		TaskGroup(const TaskGroup&) = delete;
+		TaskGroup(TaskGroup&&) = delete;
+		TaskGroup& operator=(const TaskGroup&) = delete;
+		TaskGroup& operator=(TaskGroup&&) = delete;
+
+		void	run(TaskExecutor::Task task);
+
+		// Calls func(index) for each index in [0, count), using up to maxParallelism tasks (0 means the executor thread count)
+		// Indexes are handed out one by one so that slow elements do not hold back the other tasks
+		template <typename Func>
+		void	runForEachIndex(std::size_t count, std::size_t maxParallelism, Func func);
+
+		// Rethrow the first exception thrown by a task, once all the tasks are done
+		// When called from a worker thread, pending tasks are run while waiting
+		void	wait();
+		bool	waitFor(std::chrono::milliseconds duration); // returns true if all the tasks are done
+
+	private:
+		void	onTaskDone(std::exception_ptr exception);
+		void	rethrowException();
+
+		TaskExecutor&					_executor;
+		const TaskExecutor::Priority	_priority;
+
+		std::mutex						_mutex;
+		std::condition_variable			_condVar;
+		std::size_t						_pendingCount {};
+		std::exception_ptr				_exception;
+};
+
+template <typename Func>
+void
+TaskGroup::runForEachIndex(std::size_t count, std::size_t maxParallelism, Func func)
+{
+	if (maxParallelism == 0)
+		maxParallelism = _executor.getThreadCount();
+
+	auto nextIndex {std::make_shared<std::atomic<std::size_t>>(0)};
+	const std::size_t taskCount {std::min(count, maxParallelism)};
+	for (std::size_t i {}; i < taskCount; ++i)
+	{
+		run([=]
+		{
+			for (std::size_t index {nextIndex->fetch_add(1, std::memory_order_relaxed)}; index < count; index = nextIndex->fetch_add(1, std::memory_order_relaxed))
+				func(index);
+		});
+	}
+}
+
+// Calls func(index) for each index in [0, count) and waits for completion
+template <typename Func>
+void
+parallelFor(TaskExecutor& executor, TaskExecutor::Priority priority, std::size_t count, std::size_t maxParallelism, Func&& func)
+{
+	TaskGroup group {executor, priority};
+	group.runForEachIndex(count, maxParallelism, std::ref(func));
+	group.wait();
+}
+
+// Returns func(input) for each input, in order. Results must be default constructible
+template <typename Input, typename Func>
+auto
+parallelMap(TaskExecutor& executor, TaskExecutor::Priority priority, const std::vector<Input>& inputs, std::size_t maxParallelism, Func&& func)
+{
+	std::vector<std::decay_t<std::invoke_result_t<Func&, const Input&>>> results(inputs.size());
+
+	parallelFor(executor, priority, inputs.size(), maxParallelism, [&](std::size_t index)
+	{
+		results[index] = func(inputs[index]);
+	});
+
+	return results;
+}
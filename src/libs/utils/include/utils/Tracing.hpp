@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Lightweight scoped spans, exported as OTLP/JSON lines (one ExportTraceServiceRequest per line)
+// Each thread has its own span stack: the spans of a thread are exported once its outermost span ends
+// Spans do nothing until a Tracer service exists, and almost nothing for the traces that are not sampled
+namespace Tracing
+{
+	struct TraceId
+	{
+		std::uint64_t high {};
+		std::uint64_t low {};
+	};
+
+	// To continue a trace on another thread
+	struct SpanContext
+	{
+		TraceId			traceId;
+		std::uint64_t	spanId {};
+		bool			sampled {};
+	};
+
+	struct SpanData
+	{
+		std::string_view								name;
+		std::uint64_t									spanId {};
+		std::uint64_t									parentSpanId {}; // 0 if none
+		std::chrono::system_clock::time_point			startTime;
+		std::chrono::system_clock::time_point			endTime;
+		std::vector<std::pair<std::string, std::string>>	attributes;
+	};
+
+	class Tracer
+	{
+		public:
+			struct Parameters
+			{
+				double					sampleRatio {1}; // ratio of the traces that are recorded, in [0, 1]
+				std::filesystem::path	outputFile;
+			};
+
+			Tracer(const Parameters& params);
+			~Tracer();
+
+			Tracer(const Tracer&) = delete;
+			Tracer& operator=(const Tracer&) = delete;
+
+			bool	shouldSample() const;
+			void	write(const TraceId& traceId, const std::vector<SpanData>& spans);
+
+		private:
+			const double	_sampleRatio;
+			std::mutex		_mutex;
+			std::ofstream	_output;
+	};
+
+	class ScopedSpan
+	{
+		public:
+			// name must outlive the span (string literals are expected)
+			ScopedSpan(std::string_view name);
+			ScopedSpan(std::string_view name, const SpanContext& parent);
+			~ScopedSpan();
+
+			ScopedSpan(const ScopedSpan&) = delete;
+			ScopedSpan& operator=(const ScopedSpan&) = delete;
+
+			bool	isRecording() const { return _recording; }
+			void	setAttribute(std::string_view key, std::string_view value); // no op if not recording
+
+		private:
+			void	start(std::string_view name, const SpanContext* parent);
+
+			Tracer*		_tracer {};
+			bool		_recording {};
+			std::size_t	_spanIndex {};
+	};
+
+	// Context of the innermost span of the current thread (not sampled if none)
+	SpanContext	getCurrentSpanContext();
+} // namespace Tracing
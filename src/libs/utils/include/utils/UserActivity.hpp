@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+// Interactive traffic (API requests, audio streams), so that background work can slow down while users are active
+// Updates are lock-free
+namespace UserActivity
+{
+	// Counts as an ongoing request while alive
+	class RequestScope
+	{
+		public:
+			RequestScope();
+			~RequestScope();
+
+			RequestScope(const RequestScope&) = delete;
+			RequestScope& operator=(const RequestScope&) = delete;
+	};
+
+	// Counts as an ongoing stream while alive
+	class StreamScope
+	{
+		public:
+			StreamScope();
+			~StreamScope();
+
+			StreamScope(const StreamScope&) = delete;
+			StreamScope& operator=(const StreamScope&) = delete;
+	};
+
+	// Time spent to build the response of a request
+	void	recordRequestLatency(std::chrono::steady_clock::duration latency);
+
+	struct Stats
+	{
+		std::size_t					ongoingRequestCount {};
+		std::size_t					ongoingStreamCount {};
+		std::chrono::milliseconds	requestLatency {};	// moving average, 0 if no request has been recorded recently
+	};
+	Stats	getStats();
+} // namespace UserActivity
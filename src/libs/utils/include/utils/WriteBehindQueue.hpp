@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include "utils/Logger.hpp"
+
+// Events are acknowledged as soon as they are pushed, and written later in batches using the flush function
+// Batches are flushed when enough events are pending, or after a delay
+// If a journal file is set, pending events are appended to it so that they can be replayed at startup after a crash
+template <typename Event>
+class WriteBehindQueue
+{
+	public:
+		struct Parameters
+		{
+			std::size_t					maxPendingEventCount {64};
+			std::chrono::milliseconds	maxDelay {1000}; // 0 means events are flushed synchronously
+			std::filesystem::path		journalFile; // optional
+		};
+
+		using FlushFunction = std::function<void(const std::vector<Event>&)>; // may throw: the events are kept for the next flush
+		using SerializeFunction = std::function<std::string(const Event&)>; // single line
+		using DeserializeFunction = std::function<std::optional<Event>(std::string_view)>;
+
+		WriteBehindQueue(boost::asio::io_context& ioContext, const Parameters& params, FlushFunction flushFunc, SerializeFunction serializeFunc = {}, DeserializeFunction deserializeFunc = {})
+		: _params {params}
+		, _flushFunc {std::move(flushFunc)}
+		, _serializeFunc {std::move(serializeFunc)}
+		, _deserializeFunc {std::move(deserializeFunc)}
+		, _timer {ioContext}
+		{
+			if (!_params.journalFile.empty())
+				openJournal();
+
+			flush();
+		}
+
+		~WriteBehindQueue()
+		{
+			{
+				const std::scoped_lock lock {_mutex};
+				_stopping = true;
+				_timer.cancel();
+			}
+			flush();
+		}
+
+		WriteBehindQueue(const WriteBehindQueue&) = delete;
+		WriteBehindQueue& operator=(const WriteBehindQueue&) = delete;
+
+		void push(Event event)
+		{
+			std::vector<Event> events;
+			events.push_back(std::move(event));
+			push(std::move(events));
+		}
+
+		// the events are journaled at once, and flushed together when there is no delay
+		void push(std::vector<Event> events)
+		{
+			if (events.empty())
+				return;
+
+			{
+				const std::scoped_lock lock {_mutex};
+
+				if (_journal.is_open())
+				{
+					for (const Event& event : events)
+						_journal << _serializeFunc(event) << '\n';
+					_journal.flush();
+				}
+				_pendingEvents.insert(std::end(_pendingEvents), std::make_move_iterator(std::begin(events)), std::make_move_iterator(std::end(events)));
+
+				if (_params.maxDelay.count() > 0)
+				{
+					if (_pendingEvents.size() >= _params.maxPendingEventCount)
+						scheduleFlush(std::chrono::milliseconds {0});
+					else if (!_flushScheduled)
+						scheduleFlush(_params.maxDelay);
+
+					return;
+				}
+			}
+
+			flush();
+		}
+
+		// synchronously writes all the pending events
+		void flush()
+		{
+			const std::scoped_lock flushLock {_flushMutex};
+
+			std::vector<Event> events;
+			{
+				const std::scoped_lock lock {_mutex};
+				events.swap(_pendingEvents);
+			}
+
+			if (events.empty())
+				return;
+
+			try
+			{
+				_flushFunc(events);
+			}
+			catch (const std::exception& e)
+			{
+				LMS_LOG(UTILS, ERROR) << "Cannot flush " << events.size() << " pending events: " << e.what();
+
+				const std::scoped_lock lock {_mutex};
+				_pendingEvents.insert(std::begin(_pendingEvents), std::make_move_iterator(std::begin(events)), std::make_move_iterator(std::end(events)));
+
+				// retry later
+				if (!_stopping && !_flushScheduled)
+					scheduleFlush(std::max(_params.maxDelay, std::chrono::milliseconds {1000}));
+				return;
+			}
+
+			const std::scoped_lock lock {_mutex};
+			if (_journal.is_open())
+				rewriteJournal();
+		}
+
+		bool hasPendingEvents() const
+		{
+			const std::scoped_lock lock {_mutex};
+			return !_pendingEvents.empty();
+		}
+
+	private:
+		void scheduleFlush(std::chrono::milliseconds delay)
+		{
+			_flushScheduled = true;
+			_timer.expires_after(delay);
+			_timer.async_wait([this](const boost::system::error_code& ec)
+			{
+				if (ec == boost::asio::error::operation_aborted)
+					return;
+
+				{
+					const std::scoped_lock lock {_mutex};
+					_flushScheduled = false;
+				}
+				flush();
+			});
+		}
+
+		void openJournal()
+		{
+			std::error_code ec;
+			std::filesystem::create_directories(_params.journalFile.parent_path(), ec);
+
+			// replay the events that were not flushed before the last exit
+			{
+				std::ifstream previousJournal {_params.journalFile};
+				std::string line;
+				while (std::getline(previousJournal, line))
+				{
+					if (std::optional<Event> event {_deserializeFunc(line)})
+						_pendingEvents.push_back(std::move(*event));
+					else
+						LMS_LOG(UTILS, ERROR) << "Skipping bad journal entry in '" << _params.journalFile.string() << "'";
+				}
+			}
+
+			if (!_pendingEvents.empty())
+				LMS_LOG(UTILS, INFO) << "Replaying " << _pendingEvents.size() << " events from '" << _params.journalFile.string() << "'";
+
+			_journal.open(_params.journalFile, std::ios::out | std::ios::app);
+			if (!_journal.is_open())
+				LMS_LOG(UTILS, ERROR) << "Cannot open journal file '" << _params.journalFile.string() << "', events will not survive a crash";
+		}
+
+		void rewriteJournal()
+		{
+			// only keep the events pushed or kept since the last flush
+			_journal.close();
+			_journal.open(_params.journalFile, std::ios::out | std::ios::trunc);
+			for (const Event& event : _pendingEvents)
+				_journal << _serializeFunc(event) << '\n';
+			_journal.flush();
+		}
+
+		const Parameters			_params;
+		const FlushFunction			_flushFunc;
+		const SerializeFunction		_serializeFunc;
+		const DeserializeFunction	_deserializeFunc;
+
+		std::mutex					_flushMutex;
+		mutable std::mutex			_mutex;
+		boost::asio::steady_timer	_timer;
+		bool						_flushScheduled {};
+		bool						_stopping {};
+		std::vector<Event>			_pendingEvents;
+		std::ofstream				_journal;
+};
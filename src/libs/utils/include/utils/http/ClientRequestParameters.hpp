@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <functional>
 #include <string_view>
 #include <vector>
@@ -44,6 +45,10 @@ namespace Http
 
 		using OnFailureFunc = std::function<void()>;
 		OnFailureFunc onFailureFunc;
+
+		// Called when the server reports how many requests can still be sent before its rate limit is reset
+		using OnRateLimitFunc = std::function<void(std::size_t remainingCount, std::chrono::seconds resetIn)>;
+		OnRateLimitFunc onRateLimitFunc;
 	};
 
 	struct ClientGETRequestParameters final : public ClientRequestParameters
@@ -19,7 +19,12 @@
 
 #pragma once
 
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
 #include <string_view>
+#include <vector>
 #include <boost/asio/io_context.hpp>
 
 #include "utils/http/ClientRequestParameters.hpp"
@@ -35,6 +40,21 @@ namespace Http
 			virtual void sendPOSTRequest(ClientPOSTRequestParameters&& request) = 0;
 	};
 
-	std::unique_ptr<IClient> createClient(boost::asio::io_context& ioContext, std::string_view baseUrl);
+	// At most maxInFlightRequestCount requests are sent concurrently to baseUrl
+	std::unique_ptr<IClient> createClient(boost::asio::io_context& ioContext, std::string_view baseUrl, std::size_t maxInFlightRequestCount = 1);
+
+	struct ClientStats
+	{
+		std::string baseUrl;
+		std::map<ClientRequestParameters::Priority, std::size_t> queuedRequestCounts;
+		std::size_t inFlightRequestCount {};
+		std::size_t completedRequestCount {};	// since startup, including failures
+		std::size_t retryCount {};				// since startup, including rate limited requests
+		std::size_t failureCount {};			// since startup
+		std::chrono::steady_clock::duration throttledDuration {};	// since startup
+		std::chrono::steady_clock::duration latencySum {};			// of the completed requests
+	};
+	// One entry per base url, aggregated over all the live clients
+	std::vector<ClientStats> getClientStats();
 } // namespace Http
 
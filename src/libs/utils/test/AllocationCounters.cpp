@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "utils/AllocationCounters.hpp"
+
+TEST(AllocationCounters, scopedCounter)
+{
+	AllocationCounters::ScopedCounter counter;
+
+	auto value {std::make_unique<std::vector<int>>(256)};
+	const AllocationCounters::Counters counters {counter.get()};
+
+	if (!AllocationCounters::isEnabled())
+	{
+		EXPECT_EQ(counters.allocationCount, 0);
+		EXPECT_EQ(counters.allocatedBytes, 0);
+		return;
+	}
+
+	EXPECT_EQ(counters.allocationCount, 2);
+	EXPECT_GE(counters.allocatedBytes, sizeof(std::vector<int>) + 256 * sizeof(int));
+}
+
+TEST(AllocationCounters, perThread)
+{
+	AllocationCounters::ScopedCounter counter;
+
+	std::thread thread {[]
+	{
+		std::vector<std::unique_ptr<int>> values;
+		for (int i {}; i < 100; ++i)
+			values.push_back(std::make_unique<int>(i));
+	}};
+	thread.join();
+
+	// the thread itself may be allocated by the current thread
+	EXPECT_LT(counter.get().allocationCount, 100);
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include "utils/AllocatorStats.hpp"
+
+TEST(AllocatorStats, allocatorName)
+{
+	EXPECT_FALSE(AllocatorStats::getAllocatorName().empty());
+}
+
+TEST(AllocatorStats, allocatedSize)
+{
+	constexpr std::size_t size {16 * 1024 * 1024};
+
+	const AllocatorStats::Stats before {AllocatorStats::getStats()};
+	if (!before.allocated)
+		GTEST_SKIP() << "Allocator does not report its allocated size";
+
+	auto buffer {std::make_unique<unsigned char[]>(size)};
+	volatile unsigned char* data {buffer.get()};
+	data[0] = 1;
+
+	const AllocatorStats::Stats after {AllocatorStats::getStats()};
+	ASSERT_TRUE(after.allocated);
+	EXPECT_GE(*after.allocated, *before.allocated + size);
+}
+
+TEST(AllocatorStats, fragmentation)
+{
+	AllocatorStats::Stats stats;
+	stats.allocated = 25;
+	stats.active = 100;
+	EXPECT_DOUBLE_EQ(*AllocatorStats::getFragmentation(stats), 0.75);
+
+	stats.active = 0;
+	EXPECT_FALSE(AllocatorStats::getFragmentation(stats));
+
+	const std::optional<double> fragmentation {AllocatorStats::getFragmentation(AllocatorStats::getStats())};
+	if (!fragmentation)
+		GTEST_SKIP() << "Allocator does not report its fragmentation";
+
+	EXPECT_GE(*fragmentation, 0.);
+	EXPECT_LE(*fragmentation, 1.);
+}
+
+#if defined(__linux__)
+TEST(AllocatorStats, processResidentSize)
+{
+	const std::optional<std::size_t> residentSize {AllocatorStats::getProcessResidentSize()};
+	ASSERT_TRUE(residentSize);
+	EXPECT_GT(*residentSize, 0);
+}
+#endif
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "utils/AsyncLogger.hpp"
+
+namespace
+{
+	// outlives the loggers
+	struct Sink
+	{
+		std::mutex mutex;
+		std::vector<std::string> messages;
+		std::shared_future<void>* unblock {};
+	};
+
+	class TestLogger final : public Logger
+	{
+		public:
+			TestLogger(Sink& sink) : _sink {sink} {}
+
+			void processLog(const Log& log) override
+			{
+				std::scoped_lock lock {_sink.mutex};
+				_sink.messages.push_back(log.getMessage());
+				if (_sink.unblock)
+					_sink.unblock->wait(); // simulates a slow sink
+			}
+
+		private:
+			Sink& _sink;
+	};
+}
+
+TEST(AsyncLogger, writesInOrder)
+{
+	Sink sink;
+	auto testLogger {std::make_unique<TestLogger>(sink)};
+	{
+		AsyncLogger logger {std::move(testLogger), AsyncLogger::Parameters {}};
+
+		for (std::size_t i {}; i < 100; ++i)
+		{
+			Log log {&logger, Module::UTILS, Severity::INFO};
+			log.getOstream() << i;
+		}
+	}
+
+	ASSERT_EQ(sink.messages.size(), 100);
+	for (std::size_t i {}; i < 100; ++i)
+		EXPECT_EQ(sink.messages[i], std::to_string(i));
+}
+
+TEST(AsyncLogger, multipleProducers)
+{
+	constexpr std::size_t threadCount {4};
+	constexpr std::size_t logCountPerThread {1000};
+
+	Sink sink;
+	auto testLogger {std::make_unique<TestLogger>(sink)};
+	{
+		AsyncLogger::Parameters params;
+		params.queueSize = 16;
+		params.overflowPolicy = AsyncLogger::OverflowPolicy::Block;
+		AsyncLogger logger {std::move(testLogger), params};
+
+		std::vector<std::thread> threads;
+		for (std::size_t i {}; i < threadCount; ++i)
+		{
+			threads.emplace_back([&]
+			{
+				for (std::size_t j {}; j < logCountPerThread; ++j)
+					Log {&logger, Module::UTILS, Severity::INFO}.getOstream() << j;
+			});
+		}
+
+		for (std::thread& t : threads)
+			t.join();
+
+		EXPECT_EQ(logger.getDroppedLogCount(), 0);
+	}
+
+	EXPECT_EQ(sink.messages.size(), threadCount * logCountPerThread);
+}
+
+TEST(AsyncLogger, dropsOnOverflow)
+{
+	std::promise<void> unblockPromise;
+	std::shared_future<void> unblock {unblockPromise.get_future()};
+
+	Sink sink;
+	auto testLogger {std::make_unique<TestLogger>(sink)};
+	sink.unblock = &unblock;
+	{
+		AsyncLogger::Parameters params;
+		params.queueSize = 4;
+		params.overflowPolicy = AsyncLogger::OverflowPolicy::Drop;
+		AsyncLogger logger {std::move(testLogger), params};
+
+		// the writer is stuck on the first log at most
+		for (std::size_t i {}; i < 100; ++i)
+			Log {&logger, Module::UTILS, Severity::INFO}.getOstream() << i;
+
+		EXPECT_GE(logger.getDroppedLogCount(), 100 - 4 - 1);
+		unblockPromise.set_value();
+	}
+
+	// kept logs and the drop report
+	EXPECT_LE(sink.messages.size(), 4 + 1 + 1);
+	EXPECT_TRUE(std::any_of(std::cbegin(sink.messages), std::cend(sink.messages), [](const std::string& message) { return message.find("dropped") != std::string::npos; }));
+}
+
+TEST(AsyncLogger, minSeverities)
+{
+	Sink sink;
+	auto testLogger {std::make_unique<TestLogger>(sink)};
+	testLogger->setMinSeverity(Severity::INFO);
+	testLogger->setMinSeverity(Module::DB, Severity::ERROR);
+
+	AsyncLogger logger {std::move(testLogger), AsyncLogger::Parameters {}};
+	EXPECT_TRUE(logger.isLogged(Module::UTILS, Severity::INFO));
+	EXPECT_FALSE(logger.isLogged(Module::UTILS, Severity::DEBUG));
+	EXPECT_FALSE(logger.isLogged(Module::DB, Severity::WARNING));
+}
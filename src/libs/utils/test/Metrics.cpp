@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "utils/Exception.hpp"
+#include "utils/Metrics.hpp"
+
+TEST(Metrics, counter)
+{
+	Metrics::Registry registry;
+
+	Metrics::Counter& counter {registry.getCounter("lms_test_total", "Test counter", {{"kind", "a"}})};
+	counter.increment();
+	counter.increment(2);
+	EXPECT_EQ(counter.getValue(), 3);
+
+	EXPECT_EQ(&registry.getCounter("lms_test_total", "Test counter", {{"kind", "a"}}), &counter);
+	EXPECT_NE(&registry.getCounter("lms_test_total", "Test counter", {{"kind", "b"}}), &counter);
+
+	std::ostringstream oss;
+	registry.write(oss);
+	EXPECT_EQ(oss.str(),
+			"# HELP lms_test_total Test counter\n"
+			"# TYPE lms_test_total counter\n"
+			"lms_test_total{kind=\"a\"} 3\n"
+			"lms_test_total{kind=\"b\"} 0\n");
+}
+
+TEST(Metrics, typeMismatch)
+{
+	Metrics::Registry registry;
+
+	registry.getCounter("lms_test", "Test");
+	EXPECT_THROW(registry.getGauge("lms_test", "Test"), LmsException);
+}
+
+TEST(Metrics, gauge)
+{
+	Metrics::Registry registry;
+
+	Metrics::Gauge& gauge {registry.getGauge("lms_test", "Test gauge")};
+	gauge.set(5);
+	gauge.decrement(7);
+	gauge.increment();
+	EXPECT_EQ(gauge.getValue(), -1);
+
+	std::ostringstream oss;
+	registry.write(oss);
+	EXPECT_EQ(oss.str(),
+			"# HELP lms_test Test gauge\n"
+			"# TYPE lms_test gauge\n"
+			"lms_test -1\n");
+}
+
+TEST(Metrics, histogram)
+{
+	Metrics::Registry registry;
+
+	Metrics::Histogram& histogram {registry.getHistogram("lms_test_seconds", "Test histogram", {0.5, 1})};
+	histogram.observe(0.25);
+	histogram.observe(0.5);
+	histogram.observe(0.75);
+	histogram.observe(5);
+
+	std::ostringstream oss;
+	registry.write(oss);
+	EXPECT_EQ(oss.str(),
+			"# HELP lms_test_seconds Test histogram\n"
+			"# TYPE lms_test_seconds histogram\n"
+			"lms_test_seconds_bucket{le=\"0.5\"} 2\n"
+			"lms_test_seconds_bucket{le=\"1\"} 3\n"
+			"lms_test_seconds_bucket{le=\"+Inf\"} 4\n"
+			"lms_test_seconds_sum 6.5\n"
+			"lms_test_seconds_count 4\n");
+
+	EXPECT_THROW(Metrics::Histogram({1, 0.5}), LmsException);
+}
+
+TEST(Metrics, escapeLabelValue)
+{
+	EXPECT_EQ(Metrics::escapeLabelValue("a\"b\\c\nd"), "a\\\"b\\\\c\\nd");
+}
+
+TEST(Metrics, collector)
+{
+	Metrics::Registry registry;
+	registry.addCollector([](std::ostream& os) { os << "lms_collected 1\n"; });
+
+	std::ostringstream oss;
+	registry.write(oss);
+	EXPECT_EQ(oss.str(), "lms_collected 1\n");
+}
+
+TEST(Metrics, concurrentUpdates)
+{
+	Metrics::Registry registry;
+	Metrics::Counter& counter {registry.getCounter("lms_test_total", "Test")};
+	Metrics::Histogram& histogram {registry.getHistogram("lms_test", "Test", {1})};
+
+	constexpr std::size_t threadCount {4};
+	constexpr std::size_t updateCount {10'000};
+
+	std::vector<std::thread> threads;
+	for (std::size_t i {}; i < threadCount; ++i)
+	{
+		threads.emplace_back([&]
+		{
+			for (std::size_t j {}; j < updateCount; ++j)
+			{
+				counter.increment();
+				histogram.observe(1);
+			}
+		});
+	}
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	EXPECT_EQ(counter.getValue(), threadCount * updateCount);
+	EXPECT_EQ(histogram.getCount(), threadCount * updateCount);
+	EXPECT_EQ(histogram.getCumulativeBucketCounts().front(), threadCount * updateCount);
+	EXPECT_EQ(histogram.getSum(), static_cast<double>(threadCount * updateCount));
+}
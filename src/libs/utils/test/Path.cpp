@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "utils/Path.hpp"
+
+namespace
+{
+	class TemporaryDirectory
+	{
+		public:
+			TemporaryDirectory()
+			: _path {std::filesystem::temp_directory_path() / ("lms-test-path-" + std::to_string(::getpid()))}
+			{
+				std::filesystem::remove_all(_path);
+				std::filesystem::create_directories(_path);
+			}
+
+			~TemporaryDirectory()
+			{
+				std::error_code ec;
+				std::filesystem::remove_all(_path, ec);
+			}
+
+			const std::filesystem::path& getPath() const { return _path; }
+
+			void createFile(const std::filesystem::path& relativePath, std::string_view content = "")
+			{
+				std::filesystem::create_directories((_path / relativePath).parent_path());
+				std::ofstream ofs {(_path / relativePath).string()};
+				ofs << content;
+			}
+
+		private:
+			const std::filesystem::path _path;
+	};
+
+	std::vector<std::filesystem::path>
+	exploreFiles(const std::filesystem::path& directory, const PathUtils::ExploreParameters& params)
+	{
+		std::vector<std::filesystem::path> files;
+
+		PathUtils::exploreDirectoriesRecursive(directory, [&](const PathUtils::DirectoryListing& listing)
+		{
+			EXPECT_FALSE(listing.ec);
+			for (const PathUtils::DirectoryEntry& entry : listing.entries)
+			{
+				if (entry.type == PathUtils::DirectoryEntry::Type::Regular)
+					files.push_back(entry.path.lexically_relative(directory));
+			}
+
+			return true;
+		}, params);
+
+		return files;
+	}
+}
+
+TEST(Path, exploreDirectoriesRecursive)
+{
+	TemporaryDirectory tmpDir;
+	tmpDir.createFile("b/2.mp3");
+	tmpDir.createFile("b/1.mp3");
+	tmpDir.createFile("a/c/3.mp3");
+	tmpDir.createFile("a/4.mp3");
+	tmpDir.createFile("5.mp3");
+	tmpDir.createFile("6.txt");
+
+	for (std::size_t readConcurrency : {1, 2, 8})
+	{
+		PathUtils::ExploreParameters params;
+		params.readConcurrency = readConcurrency;
+
+		const std::vector<std::filesystem::path> files {exploreFiles(tmpDir.getPath(), params)};
+		const std::vector<std::filesystem::path> expectedFiles {"5.mp3", "6.txt", "a/4.mp3", "a/c/3.mp3", "b/1.mp3", "b/2.mp3"};
+		EXPECT_EQ(files, expectedFiles);
+	}
+}
+
+TEST(Path, exploreDirectoriesRecursiveFilter)
+{
+	TemporaryDirectory tmpDir;
+	tmpDir.createFile("a/1.mp3", "12345");
+	tmpDir.createFile("a/2.txt");
+	tmpDir.createFile("b/3.mp3");
+	tmpDir.createFile("b/.lmsignore");
+	tmpDir.createFile("b/c/4.mp3");
+
+	const std::filesystem::path excludeDirFileName {".lmsignore"};
+
+	PathUtils::ExploreParameters params;
+	params.excludeDirFileName = &excludeDirFileName;
+	params.fileFilter = [](const std::filesystem::path& file) { return file.extension() == ".mp3"; };
+	params.getFileInfo = true;
+
+	std::size_t listingCount {};
+	PathUtils::exploreDirectoriesRecursive(tmpDir.getPath(), [&](const PathUtils::DirectoryListing& listing)
+	{
+		listingCount++;
+		EXPECT_TRUE(listing.lastWriteTime.isValid());
+
+		if (listing.directory == tmpDir.getPath() / "a")
+		{
+			EXPECT_EQ(listing.entryCount, 2);
+			EXPECT_EQ(listing.entries.size(), 1);
+			if (!listing.entries.empty())
+			{
+				EXPECT_EQ(listing.entries.front().path, tmpDir.getPath() / "a" / "1.mp3");
+				EXPECT_TRUE(listing.entries.front().fileInfo);
+				EXPECT_EQ(listing.entries.front().fileInfo.value_or(PathUtils::FileInfo {}).size, 5);
+			}
+		}
+
+		return true;
+	}, params);
+
+	EXPECT_EQ(listingCount, 2); // root and "a"
+}
+
+TEST(Path, fileInfoLocation)
+{
+	TemporaryDirectory tmpDir;
+	tmpDir.createFile("a/1.mp3");
+	tmpDir.createFile("a/2.mp3");
+
+	const PathUtils::FileInfo fileInfo1 {PathUtils::getFileInfo(tmpDir.getPath() / "a" / "1.mp3")};
+	const PathUtils::FileInfo fileInfo2 {PathUtils::getFileInfo(tmpDir.getPath() / "a" / "2.mp3")};
+	EXPECT_NE(fileInfo1.inode, 0);
+	EXPECT_NE(fileInfo1.inode, fileInfo2.inode);
+	EXPECT_EQ(fileInfo1.device, fileInfo2.device);
+
+	PathUtils::ExploreParameters params;
+	params.getFileInfo = true;
+
+	PathUtils::exploreDirectoriesRecursive(tmpDir.getPath(), [&](const PathUtils::DirectoryListing& listing)
+	{
+		for (const PathUtils::DirectoryEntry& entry : listing.entries)
+		{
+			if (entry.path == tmpDir.getPath() / "a" / "1.mp3")
+			{
+				EXPECT_EQ(entry.fileInfo.value_or(PathUtils::FileInfo {}).inode, fileInfo1.inode);
+				EXPECT_EQ(entry.fileInfo.value_or(PathUtils::FileInfo {}).device, fileInfo1.device);
+			}
+		}
+
+		return true;
+	}, params);
+}
+
+TEST(Path, exploreDirectoriesRecursiveAbort)
+{
+	TemporaryDirectory tmpDir;
+	for (std::size_t i {}; i < 20; ++i)
+		tmpDir.createFile(std::to_string(i) + "/file");
+
+	std::size_t listingCount {};
+	const bool res {PathUtils::exploreDirectoriesRecursive(tmpDir.getPath(), [&](const PathUtils::DirectoryListing&)
+	{
+		return ++listingCount < 5;
+	})};
+
+	EXPECT_FALSE(res);
+	EXPECT_EQ(listingCount, 5);
+}
+
+TEST(Path, exploreFilesRecursive)
+{
+	TemporaryDirectory tmpDir;
+	tmpDir.createFile("a/1.mp3");
+	tmpDir.createFile("a/b/2.mp3");
+
+	std::vector<std::filesystem::path> files;
+	EXPECT_TRUE(PathUtils::exploreFilesRecursive(tmpDir.getPath(), [&](std::error_code ec, const std::filesystem::path& file)
+	{
+		EXPECT_FALSE(ec);
+		files.push_back(file);
+		return true;
+	}));
+
+	const std::vector<std::filesystem::path> expectedFiles {tmpDir.getPath() / "a" / "1.mp3", tmpDir.getPath() / "a" / "b" / "2.mp3"};
+	EXPECT_EQ(files, expectedFiles);
+}
+
+TEST(Path, exploreDirectoriesRecursiveMissing)
+{
+	bool error {};
+	PathUtils::exploreDirectoriesRecursive("/this/path/does/not/exist", [&](const PathUtils::DirectoryListing& listing)
+	{
+		error = static_cast<bool>(listing.ec);
+		return true;
+	});
+
+	EXPECT_TRUE(error);
+}
+
+TEST(Path, exploreDirectoriesRecursiveSymlinks)
+{
+	TemporaryDirectory tmpDir;
+	tmpDir.createFile("a/1.mp3", "123");
+	std::filesystem::create_symlink(tmpDir.getPath() / "a" / "1.mp3", tmpDir.getPath() / "2.mp3");
+	std::filesystem::create_directory_symlink(tmpDir.getPath() / "a", tmpDir.getPath() / "b");
+
+	PathUtils::ExploreParameters params;
+	params.getFileInfo = true;
+
+	std::vector<std::filesystem::path> files;
+	PathUtils::exploreDirectoriesRecursive(tmpDir.getPath(), [&](const PathUtils::DirectoryListing& listing)
+	{
+		for (const PathUtils::DirectoryEntry& entry : listing.entries)
+		{
+			if (entry.type != PathUtils::DirectoryEntry::Type::Regular)
+				continue;
+
+			EXPECT_EQ(entry.fileInfo.value_or(PathUtils::FileInfo {}).size, 3);
+			files.push_back(entry.path.lexically_relative(tmpDir.getPath()));
+		}
+
+		return true;
+	}, params);
+
+	const std::vector<std::filesystem::path> expectedFiles {"2.mp3", "a/1.mp3", "b/1.mp3"};
+	EXPECT_EQ(files, expectedFiles);
+}
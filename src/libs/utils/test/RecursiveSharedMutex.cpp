@@ -56,6 +56,55 @@ TEST(RecursiveSharedMutex, SingleThreaded)
 	}
 }
 
+TEST(RecursiveSharedMutex, SharedLockedAfterUnique)
+{
+	RecursiveSharedMutex mutex;
+
+	std::unique_lock uniqueLock {mutex};
+	std::shared_lock sharedLock {mutex};
+	uniqueLock.unlock();
+
+	// still shared locked: writers must wait, readers can come in
+	std::atomic<bool> writerDone {};
+	std::thread writer {[&]
+	{
+		std::unique_lock lock {mutex};
+		writerDone = true;
+	}};
+
+	std::thread reader {[&]
+	{
+		std::shared_lock lock {mutex};
+	}};
+	reader.join();
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	EXPECT_FALSE(writerDone);
+
+	sharedLock.unlock();
+	writer.join();
+	EXPECT_TRUE(writerDone);
+}
+
+TEST(RecursiveSharedMutex, SeveralMutexes)
+{
+	RecursiveSharedMutex mutex1;
+	RecursiveSharedMutex mutex2;
+
+	std::shared_lock lock1 {mutex1};
+	{
+		std::shared_lock lock2 {mutex2};
+		std::shared_lock lock3 {mutex1};
+	}
+
+	// mutex2 must be free
+	std::thread writer {[&]
+	{
+		std::unique_lock lock {mutex2};
+	}};
+	writer.join();
+}
+
 TEST(RecursiveSharedMutex, MultiThreaded)
 {
 	{
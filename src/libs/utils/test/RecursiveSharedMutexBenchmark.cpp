@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "utils/RecursiveSharedMutex.hpp"
+
+// Contention micro-benchmarks, not run by default
+// Run using test-utils --gtest_also_run_disabled_tests --gtest_filter='RecursiveSharedMutexBenchmark.*'
+namespace
+{
+	template <typename Mutex>
+	void benchmarkLocks(std::string_view name, std::size_t threadCount, std::size_t writerPeriod)
+	{
+		using Clock = std::chrono::steady_clock;
+		constexpr std::size_t lockCountPerThread {200'000};
+
+		Mutex mutex;
+		std::size_t value {};
+		std::atomic<std::size_t> readValueSum {};
+
+		const Clock::time_point start {Clock::now()};
+
+		std::vector<std::thread> threads;
+		for (std::size_t i {}; i < threadCount; ++i)
+		{
+			threads.emplace_back([&]
+			{
+				std::size_t localSum {};
+				for (std::size_t j {}; j < lockCountPerThread; ++j)
+				{
+					if (writerPeriod && j % writerPeriod == 0)
+					{
+						std::unique_lock lock {mutex};
+						value++;
+					}
+					else
+					{
+						// nested, as done by transactions
+						std::shared_lock lock {mutex};
+						std::shared_lock lock2 {mutex};
+						localSum += value;
+					}
+				}
+				readValueSum += localSum;
+			});
+		}
+
+		for (std::thread& t : threads)
+			t.join();
+
+		const auto duration {std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start)};
+		std::cout << name << ": " << threadCount << " thread(s), 1 write every " << writerPeriod << " locks: "
+			<< (threadCount * lockCountPerThread * 1000) / std::max<std::chrono::microseconds::rep>(duration.count(), 1) << " locks/ms" << std::endl;
+	}
+
+	// single level std::shared_mutex, for reference
+	class NonRecursiveSharedMutex
+	{
+		public:
+			void lock() { _mutex.lock(); }
+			void unlock() { _mutex.unlock(); }
+			void lock_shared()
+			{
+				if (_depth++ == 0)
+					_mutex.lock_shared();
+			}
+			void unlock_shared()
+			{
+				if (--_depth == 0)
+					_mutex.unlock_shared();
+			}
+
+		private:
+			static thread_local std::size_t _depth;
+			std::shared_mutex _mutex;
+	};
+	thread_local std::size_t NonRecursiveSharedMutex::_depth {};
+}
+
+TEST(RecursiveSharedMutexBenchmark, DISABLED_SharedOnly)
+{
+	const std::size_t maxThreadCount {std::max<std::size_t>(std::thread::hardware_concurrency(), 1)};
+	for (std::size_t threadCount {1}; threadCount <= maxThreadCount; threadCount *= 2)
+	{
+		benchmarkLocks<NonRecursiveSharedMutex>("std::shared_mutex", threadCount, 0);
+		benchmarkLocks<RecursiveSharedMutex>("RecursiveSharedMutex", threadCount, 0);
+	}
+}
+
+TEST(RecursiveSharedMutexBenchmark, DISABLED_FewWriters)
+{
+	const std::size_t maxThreadCount {std::max<std::size_t>(std::thread::hardware_concurrency(), 1)};
+	for (std::size_t threadCount {1}; threadCount <= maxThreadCount; threadCount *= 2)
+	{
+		benchmarkLocks<NonRecursiveSharedMutex>("std::shared_mutex", threadCount, 1000);
+		benchmarkLocks<RecursiveSharedMutex>("RecursiveSharedMutex", threadCount, 1000);
+	}
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "utils/RoaringBitmap.hpp"
+
+TEST(RoaringBitmap, empty)
+{
+	RoaringBitmap bitmap;
+
+	EXPECT_TRUE(bitmap.empty());
+	EXPECT_EQ(bitmap.size(), 0);
+	EXPECT_FALSE(bitmap.contains(0));
+	EXPECT_TRUE(bitmap.toVector().empty());
+	EXPECT_TRUE(RoaringBitmap::intersect(bitmap, bitmap).empty());
+}
+
+TEST(RoaringBitmap, add)
+{
+	RoaringBitmap bitmap;
+
+	bitmap.add(5);
+	bitmap.add(70000);
+	bitmap.add(3);
+	bitmap.add(5);
+	bitmap.add(0xFFFFFFFF);
+	bitmap.add(65536);
+
+	EXPECT_FALSE(bitmap.empty());
+	EXPECT_EQ(bitmap.size(), 5);
+	EXPECT_TRUE(bitmap.contains(3));
+	EXPECT_TRUE(bitmap.contains(5));
+	EXPECT_TRUE(bitmap.contains(65536));
+	EXPECT_TRUE(bitmap.contains(70000));
+	EXPECT_TRUE(bitmap.contains(0xFFFFFFFF));
+	EXPECT_FALSE(bitmap.contains(4));
+	EXPECT_FALSE(bitmap.contains(65537));
+
+	EXPECT_EQ(bitmap.toVector(), (std::vector<RoaringBitmap::value_type> {3, 5, 65536, 70000, 0xFFFFFFFF}));
+}
+
+TEST(RoaringBitmap, dense)
+{
+	RoaringBitmap bitmap;
+
+	// enough values to use bitsets
+	std::vector<RoaringBitmap::value_type> expected;
+	for (RoaringBitmap::value_type value {}; value < 3 * 65536; value += 3)
+	{
+		bitmap.add(value);
+		expected.push_back(value);
+	}
+
+	EXPECT_EQ(bitmap.size(), expected.size());
+	EXPECT_EQ(bitmap.toVector(), expected);
+	EXPECT_TRUE(bitmap.contains(3));
+	EXPECT_FALSE(bitmap.contains(4));
+	EXPECT_LT(bitmap.getMemoryUsage(), expected.size() * sizeof(RoaringBitmap::value_type));
+}
+
+TEST(RoaringBitmap, intersect)
+{
+	std::mt19937 generator {42};
+
+	for (const std::uint32_t range : {1000u, 100'000u, 1'000'000u})
+	{
+		for (const std::size_t count : {10u, 5000u, 50'000u})
+		{
+			std::uniform_int_distribution<std::uint32_t> distribution {0, range};
+
+			RoaringBitmap a;
+			RoaringBitmap b;
+			std::set<std::uint32_t> setA;
+			std::set<std::uint32_t> setB;
+			for (std::size_t i {}; i < count; ++i)
+			{
+				const std::uint32_t valueA {distribution(generator)};
+				const std::uint32_t valueB {distribution(generator)};
+				a.add(valueA);
+				b.add(valueB);
+				setA.insert(valueA);
+				setB.insert(valueB);
+			}
+			ASSERT_EQ(a.size(), setA.size());
+			ASSERT_EQ(b.size(), setB.size());
+
+			std::vector<std::uint32_t> expected;
+			std::set_intersection(std::cbegin(setA), std::cend(setA), std::cbegin(setB), std::cend(setB), std::back_inserter(expected));
+
+			const RoaringBitmap intersection {RoaringBitmap::intersect(a, b)};
+			EXPECT_EQ(intersection.size(), expected.size()) << "range = " << range << ", count = " << count;
+			EXPECT_EQ(intersection.toVector(), expected) << "range = " << range << ", count = " << count;
+		}
+	}
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "utils/StaggeredScheduler.hpp"
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	template <typename Predicate>
+	void runUntil(boost::asio::io_context& ioContext, Predicate predicate)
+	{
+		while (!predicate() && ioContext.run_one_for(std::chrono::seconds {5}))
+			;
+	}
+}
+
+TEST(StaggeredScheduler, spreadsSyncs)
+{
+	boost::asio::io_context ioContext;
+	boost::asio::io_context::strand strand {ioContext};
+
+	std::vector<std::pair<int, Clock::time_point>> syncs;
+	StaggeredScheduler<int>* schedulerPtr {};
+
+	StaggeredScheduler<int>::Parameters params;
+	params.period = std::chrono::milliseconds {300};
+	params.firstPeriodDelay = std::chrono::milliseconds {0};
+
+	StaggeredScheduler<int> scheduler {strand, params,
+		[] { return std::vector<int> {1, 2, 3}; },
+		[&](int key)
+		{
+			syncs.emplace_back(key, Clock::now());
+			schedulerPtr->onSyncEnded(key, true);
+		}};
+	schedulerPtr = &scheduler;
+	scheduler.start();
+
+	runUntil(ioContext, [&] { return syncs.size() == 4; });
+	ASSERT_EQ(syncs.size(), 4);
+	EXPECT_EQ(scheduler.getSyncInterval(), std::chrono::milliseconds {100});
+
+	EXPECT_EQ(syncs[0].first, 1);
+	EXPECT_EQ(syncs[1].first, 2);
+	EXPECT_EQ(syncs[2].first, 3);
+	EXPECT_EQ(syncs[3].first, 1);
+
+	// timers never expire early
+	EXPECT_GE(syncs[1].second - syncs[0].second, std::chrono::milliseconds {100});
+	EXPECT_GE(syncs[2].second - syncs[1].second, std::chrono::milliseconds {100});
+	EXPECT_GE(syncs[3].second - syncs[0].second, std::chrono::milliseconds {300});
+}
+
+TEST(StaggeredScheduler, skipsIdleEntries)
+{
+	boost::asio::io_context ioContext;
+	boost::asio::io_context::strand strand {ioContext};
+
+	std::size_t periodCount {};
+	std::vector<std::size_t> syncPeriods;
+	StaggeredScheduler<int>* schedulerPtr {};
+
+	StaggeredScheduler<int>::Parameters params;
+	params.period = std::chrono::milliseconds {5};
+	params.firstPeriodDelay = std::chrono::milliseconds {0};
+	params.maxSkippedPeriodCount = 2;
+
+	StaggeredScheduler<int> scheduler {strand, params,
+		[&]
+		{
+			periodCount++;
+			if (periodCount == 10)
+				schedulerPtr->onLocalChange(1);
+			return std::vector<int> {1};
+		},
+		[&](int key)
+		{
+			syncPeriods.push_back(periodCount);
+			schedulerPtr->onSyncEnded(key, false);
+		}};
+	schedulerPtr = &scheduler;
+	scheduler.start();
+
+	runUntil(ioContext, [&] { return periodCount == 13; });
+	ASSERT_EQ(periodCount, 13);
+
+	// skipped periods grow with the number of idle syncs, up to the max, local changes force a sync
+	EXPECT_EQ(syncPeriods, (std::vector<std::size_t> {1, 3, 6, 9, 10, 13}));
+}
+
+TEST(StaggeredScheduler, failedSyncsDoNotBackOff)
+{
+	boost::asio::io_context ioContext;
+	boost::asio::io_context::strand strand {ioContext};
+
+	std::size_t periodCount {};
+	std::vector<std::size_t> syncPeriods;
+	StaggeredScheduler<int>* schedulerPtr {};
+
+	StaggeredScheduler<int>::Parameters params;
+	params.period = std::chrono::milliseconds {5};
+	params.firstPeriodDelay = std::chrono::milliseconds {0};
+	params.maxSkippedPeriodCount = 2;
+
+	StaggeredScheduler<int> scheduler {strand, params,
+		[&] { periodCount++; return std::vector<int> {1}; },
+		[&](int key)
+		{
+			syncPeriods.push_back(periodCount);
+			schedulerPtr->onSyncEnded(key, std::nullopt);
+		}};
+	schedulerPtr = &scheduler;
+	scheduler.start();
+
+	runUntil(ioContext, [&] { return periodCount == 3; });
+	EXPECT_EQ(syncPeriods, (std::vector<std::size_t> {1, 2, 3}));
+}
+
+TEST(StaggeredScheduler, waitsForRateLimitReset)
+{
+	boost::asio::io_context ioContext;
+	boost::asio::io_context::strand strand {ioContext};
+
+	std::vector<Clock::time_point> syncs;
+	StaggeredScheduler<int>* schedulerPtr {};
+
+	StaggeredScheduler<int>::Parameters params;
+	params.period = std::chrono::milliseconds {20};
+	params.firstPeriodDelay = std::chrono::milliseconds {0};
+
+	StaggeredScheduler<int> scheduler {strand, params,
+		[] { return std::vector<int> {1, 2}; },
+		[&](int key)
+		{
+			syncs.push_back(Clock::now());
+			schedulerPtr->onRateLimit(syncs.size() == 1 ? 0 : 10, std::chrono::seconds {1});
+			schedulerPtr->onSyncEnded(key, true);
+		}};
+	schedulerPtr = &scheduler;
+	scheduler.start();
+
+	runUntil(ioContext, [&] { return syncs.size() == 3; });
+	ASSERT_EQ(syncs.size(), 3);
+	EXPECT_GE(syncs[1] - syncs[0], std::chrono::seconds {1});
+	EXPECT_LT(syncs[2] - syncs[1], std::chrono::seconds {1});
+}
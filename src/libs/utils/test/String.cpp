@@ -17,6 +17,9 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <chrono>
+#include <iostream>
+
 #include <gtest/gtest.h>
 
 #include <Wt/WDateTime.h>
@@ -101,6 +104,138 @@ TEST(StringUtils, splitStringCopy)
 	}
 }
 
+TEST(StringUtils, splitStringCopyEmpty)
+{
+	const std::vector<std::string> strings{ StringUtils::splitStringCopy("==", "=") };
+	ASSERT_EQ(strings.size(), 1);
+	EXPECT_EQ(strings[0], "");
+}
+
+TEST(StringUtils, tokenizeString)
+{
+	{
+		const StringUtils::StringTokenizer tokenizer{ StringUtils::tokenizeString("", " ") };
+		EXPECT_EQ(tokenizer.begin(), tokenizer.end());
+	}
+
+	{
+		const StringUtils::StringTokenizer tokenizer{ StringUtils::tokenizeString(" ,  ", " ,") };
+		EXPECT_EQ(tokenizer.begin(), tokenizer.end());
+	}
+
+	{
+		std::vector<std::string_view> tokens;
+		for (std::string_view token : StringUtils::tokenizeString(",a b,,cd ", " ,"))
+			tokens.push_back(token);
+
+		EXPECT_EQ(tokens, (std::vector<std::string_view>{ "a", "b", "cd" }));
+	}
+}
+
+TEST(StringUtils, foldCase)
+{
+	EXPECT_EQ(StringUtils::foldCase(""), "");
+	EXPECT_EQ(StringUtils::foldCase("AbC 12!"), "abc 12!");
+	EXPECT_EQ(StringUtils::foldCase("ÉLÉPHANT"), "éléphant");
+	EXPECT_EQ(StringUtils::foldCase("ŁÓDŹ"), "łódź");
+	EXPECT_EQ(StringUtils::foldCase("ΣΟΦΟΣ"), "σοφοσ");
+	EXPECT_EQ(StringUtils::foldCase("σοφος"), "σοφοσ");
+	EXPECT_EQ(StringUtils::foldCase("МОСКВА Ёлка"), "москва ёлка");
+	EXPECT_EQ(StringUtils::foldCase("日本"), "日本");
+	EXPECT_EQ(StringUtils::foldCase("\xFF" "A"), "\xFF" "a");
+}
+
+TEST(StringUtils, computeSortKey)
+{
+	EXPECT_EQ(StringUtils::computeSortKey(""), "");
+	EXPECT_EQ(StringUtils::computeSortKey("  Abc "), "abc");
+	EXPECT_EQ(StringUtils::computeSortKey("The Beatles"), "beatles");
+	EXPECT_EQ(StringUtils::computeSortKey("A Perfect Circle"), "perfect circle");
+	EXPECT_EQ(StringUtils::computeSortKey("An  Album"), "album");
+	EXPECT_EQ(StringUtils::computeSortKey("The"), "the");
+	EXPECT_EQ(StringUtils::computeSortKey("Theory"), "theory");
+	EXPECT_EQ(StringUtils::computeSortKey("a-ha"), "a-ha");
+	EXPECT_EQ(StringUtils::computeSortKey("Émile Zoë"), "emile zoe");
+	EXPECT_EQ(StringUtils::computeSortKey("ŁÓDŹ"), "lodz");
+	EXPECT_EQ(StringUtils::computeSortKey("Æther"), "æther");
+	EXPECT_EQ(StringUtils::computeSortKey("МОСКВА"), "москва");
+	EXPECT_LT(StringUtils::computeSortKey("Élan"), StringUtils::computeSortKey("Zebra"));
+}
+
+TEST(StringUtils, caseInsensitiveCompare)
+{
+	EXPECT_EQ(StringUtils::stringCaseInsensitiveCompare("", ""), 0);
+	EXPECT_EQ(StringUtils::stringCaseInsensitiveCompare("abc", "ABC"), 0);
+	EXPECT_LT(StringUtils::stringCaseInsensitiveCompare("abc", "ABD"), 0);
+	EXPECT_GT(StringUtils::stringCaseInsensitiveCompare("abcd", "ABC"), 0);
+	EXPECT_LT(StringUtils::stringCaseInsensitiveCompare("ab", "ABC"), 0);
+	EXPECT_EQ(StringUtils::stringCaseInsensitiveCompare("Émile", "éMILE"), 0);
+	EXPECT_LT(StringUtils::stringCaseInsensitiveCompare("Zoé", "zoë"), 0);
+
+	EXPECT_TRUE(StringUtils::stringCaseInsensitiveEqual("Straße", "STRAẞE"));
+	EXPECT_TRUE(StringUtils::stringCaseInsensitiveEqual("Ελλάδα", "ΕΛΛΆΔΑ"));
+	EXPECT_FALSE(StringUtils::stringCaseInsensitiveEqual("mp3", "mp4"));
+	EXPECT_FALSE(StringUtils::stringCaseInsensitiveEqual("\xC3", "\xC3\xA9"));
+}
+
+TEST(StringUtils, DISABLED_benchmarkSplit)
+{
+	std::string str;
+	for (std::size_t i{}; i < 20; ++i)
+		str += "Artist " + std::to_string(i) + ";";
+
+	constexpr std::size_t iterationCount{ 100'000 };
+	std::size_t tokenCount{};
+
+	const auto start{ std::chrono::steady_clock::now() };
+	for (std::size_t i{}; i < iterationCount; ++i)
+		tokenCount += StringUtils::splitStringCopy(str, ";").size();
+	const auto copyEnd{ std::chrono::steady_clock::now() };
+	for (std::size_t i{}; i < iterationCount; ++i)
+		tokenCount += StringUtils::splitString(str, ";").size();
+	const auto splitEnd{ std::chrono::steady_clock::now() };
+	for (std::size_t i{}; i < iterationCount; ++i)
+	{
+		for ([[maybe_unused]] std::string_view token : StringUtils::tokenizeString(str, ";"))
+			tokenCount++;
+	}
+	const auto tokenizeEnd{ std::chrono::steady_clock::now() };
+
+	EXPECT_EQ(tokenCount, 3 * 20 * iterationCount);
+
+	std::cout << "splitStringCopy: " << std::chrono::duration_cast<std::chrono::milliseconds>(copyEnd - start).count() << " ms" << std::endl;
+	std::cout << "splitString: " << std::chrono::duration_cast<std::chrono::milliseconds>(splitEnd - copyEnd).count() << " ms" << std::endl;
+	std::cout << "tokenizeString: " << std::chrono::duration_cast<std::chrono::milliseconds>(tokenizeEnd - splitEnd).count() << " ms" << std::endl;
+}
+
+TEST(StringUtils, DISABLED_benchmarkCaseInsensitiveCompare)
+{
+	const std::string asciiA{ "The Quick Brown Fox Jumps Over The Lazy Dog" };
+	const std::string asciiB{ "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG" };
+	const std::string unicodeA{ "Ζαφείρι δέξου πάγκαλο, ёлка Łódź" };
+	const std::string unicodeB{ "ΖΑΦΕΊΡΙ ΔΈΞΟΥ ΠΆΓΚΑΛΟ, ЁЛКА ŁÓDŹ" };
+
+	constexpr std::size_t iterationCount{ 1'000'000 };
+	std::size_t equalCount{};
+
+	const auto start{ std::chrono::steady_clock::now() };
+	for (std::size_t i{}; i < iterationCount; ++i)
+		equalCount += StringUtils::stringCaseInsensitiveEqual(asciiA, asciiB);
+	const auto asciiEnd{ std::chrono::steady_clock::now() };
+	for (std::size_t i{}; i < iterationCount; ++i)
+		equalCount += StringUtils::stringCaseInsensitiveEqual(unicodeA, unicodeB);
+	const auto unicodeEnd{ std::chrono::steady_clock::now() };
+	for (std::size_t i{}; i < iterationCount; ++i)
+		equalCount += StringUtils::foldCase(asciiA) == StringUtils::foldCase(asciiB);
+	const auto foldEnd{ std::chrono::steady_clock::now() };
+
+	EXPECT_EQ(equalCount, 3 * iterationCount);
+
+	std::cout << "ASCII compare: " << std::chrono::duration_cast<std::chrono::milliseconds>(asciiEnd - start).count() << " ms" << std::endl;
+	std::cout << "Unicode compare: " << std::chrono::duration_cast<std::chrono::milliseconds>(unicodeEnd - asciiEnd).count() << " ms" << std::endl;
+	std::cout << "ASCII fold and compare: " << std::chrono::duration_cast<std::chrono::milliseconds>(foldEnd - unicodeEnd).count() << " ms" << std::endl;
+}
+
 TEST(StringUtils, escapeJSString)
 {
 	EXPECT_EQ(StringUtils::jsEscape(""), "");
@@ -138,6 +273,22 @@ TEST(StringUtils, readAs)
 	EXPECT_EQ(StringUtils::readAs<bool>(""), std::nullopt);
 }
 
+TEST(StringUtils, readAsInteger)
+{
+	EXPECT_EQ(StringUtils::readAs<int>("42"), 42);
+	EXPECT_EQ(StringUtils::readAs<int>("-42"), -42);
+	EXPECT_EQ(StringUtils::readAs<int>("+42"), 42);
+	EXPECT_EQ(StringUtils::readAs<int>("  42"), 42);
+	EXPECT_EQ(StringUtils::readAs<int>("42abc"), 42);
+	EXPECT_EQ(StringUtils::readAs<long long>("9223372036854775807"), 9223372036854775807LL);
+	EXPECT_EQ(StringUtils::readAs<int>("99999999999"), std::nullopt);
+	EXPECT_EQ(StringUtils::readAs<unsigned>("-1"), std::nullopt);
+	EXPECT_EQ(StringUtils::readAs<int>("+-1"), std::nullopt);
+	EXPECT_EQ(StringUtils::readAs<int>("abc"), std::nullopt);
+	EXPECT_EQ(StringUtils::readAs<int>("  "), std::nullopt);
+	EXPECT_EQ(StringUtils::readAs<int>(""), std::nullopt);
+}
+
 TEST(StringUtils, capitalize)
 {
 	struct TestCase
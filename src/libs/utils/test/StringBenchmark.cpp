@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "utils/String.hpp"
+
+// Parsing micro-benchmarks, not run by default
+// Run using test-utils --gtest_also_run_disabled_tests --gtest_filter='StringBenchmark.*'
+namespace
+{
+	// a large multi id request (star, updatePlaylist, ...)
+	constexpr std::size_t idCountPerRequest {1000};
+	constexpr std::size_t requestCount {1000};
+
+	std::vector<std::string> createIds()
+	{
+		std::vector<std::string> ids;
+		ids.reserve(idCountPerRequest);
+		for (std::size_t i {}; i < idCountPerRequest; ++i)
+			ids.push_back(std::to_string(1'000'000 + i * 7919));
+
+		return ids;
+	}
+
+	template <typename ParseFunc>
+	void benchmarkParse(std::string_view name, ParseFunc parseFunc)
+	{
+		using Clock = std::chrono::steady_clock;
+
+		const std::vector<std::string> ids {createIds()};
+		std::int64_t sum {};
+
+		const Clock::time_point start {Clock::now()};
+		for (std::size_t i {}; i < requestCount; ++i)
+		{
+			std::vector<std::int64_t> values;
+			values.reserve(ids.size());
+			for (const std::string& id : ids)
+			{
+				if (const std::optional<std::int64_t> value {parseFunc(id)})
+					values.push_back(*value);
+			}
+			sum += values.back();
+		}
+
+		const auto duration {std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start)};
+		std::cout << name << ": " << duration.count() / requestCount << " us per " << idCountPerRequest << " id request (" << sum << ")" << std::endl;
+	}
+}
+
+TEST(StringBenchmark, DISABLED_readAsInteger)
+{
+	// stream based, for reference
+	benchmarkParse("std::istringstream", [](std::string_view str) -> std::optional<std::int64_t>
+	{
+		std::int64_t res;
+		std::istringstream iss {std::string {str}};
+		iss >> res;
+		if (iss.fail())
+			return std::nullopt;
+
+		return res;
+	});
+	benchmarkParse("StringUtils::readAs", [](std::string_view str) { return StringUtils::readAs<std::int64_t>(str); });
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "utils/TaskExecutor.hpp"
+
+TEST(TaskExecutor, group)
+{
+	TaskExecutor executor {4};
+
+	std::atomic<std::size_t> count {};
+	{
+		TaskGroup group {executor};
+		for (std::size_t i {}; i < 1000; ++i)
+			group.run([&] { count++; });
+
+		group.wait();
+		EXPECT_EQ(count, 1000);
+	}
+}
+
+TEST(TaskExecutor, exception)
+{
+	TaskExecutor executor {2};
+
+	TaskGroup group {executor};
+	group.run([] { throw std::runtime_error {"test"}; });
+	group.run([] {});
+
+	EXPECT_THROW(group.wait(), std::runtime_error);
+	EXPECT_NO_THROW(group.wait());
+}
+
+TEST(TaskExecutor, destructorRunsPendingTasks)
+{
+	std::atomic<std::size_t> count {};
+	{
+		TaskExecutor executor {1};
+		for (std::size_t i {}; i < 100; ++i)
+			executor.post([&] { count++; });
+	}
+
+	EXPECT_EQ(count, 100);
+}
+
+TEST(TaskExecutor, nestedGroups)
+{
+	// a single worker must not deadlock waiting for the tasks it posted
+	TaskExecutor executor {1};
+
+	std::atomic<std::size_t> count {};
+	parallelFor(executor, TaskExecutor::Priority::Background, 4, 0, [&](std::size_t)
+	{
+		parallelFor(executor, TaskExecutor::Priority::Interactive, 10, 4, [&](std::size_t) { count++; });
+	});
+
+	EXPECT_EQ(count, 40);
+}
+
+TEST(TaskExecutor, parallelFor)
+{
+	TaskExecutor executor {4};
+
+	std::vector<std::size_t> values(10'000);
+	parallelFor(executor, TaskExecutor::Priority::Background, values.size(), 0, [&](std::size_t index) { values[index] = index; });
+
+	std::vector<std::size_t> expectedValues(values.size());
+	std::iota(std::begin(expectedValues), std::end(expectedValues), 0);
+	EXPECT_EQ(values, expectedValues);
+}
+
+TEST(TaskExecutor, maxParallelism)
+{
+	TaskExecutor executor {4};
+
+	std::atomic<std::size_t> runningCount {};
+	std::atomic<std::size_t> maxRunningCount {};
+	parallelFor(executor, TaskExecutor::Priority::Background, 100, 2, [&](std::size_t)
+	{
+		const std::size_t current {++runningCount};
+		std::size_t max {maxRunningCount.load()};
+		while (current > max && !maxRunningCount.compare_exchange_weak(max, current))
+			;
+
+		std::this_thread::sleep_for(std::chrono::microseconds {100});
+		runningCount--;
+	});
+
+	EXPECT_LE(maxRunningCount, 2);
+}
+
+TEST(TaskExecutor, parallelMap)
+{
+	TaskExecutor executor {3};
+
+	const std::vector<int> inputs {1, 2, 3, 4, 5};
+	const std::vector<int> outputs {parallelMap(executor, TaskExecutor::Priority::Interactive, inputs, 0, [](int value) { return value * value; })};
+
+	EXPECT_EQ(outputs, (std::vector<int> {1, 4, 9, 16, 25}));
+}
+
+TEST(TaskExecutor, waitFor)
+{
+	TaskExecutor executor {1};
+
+	std::atomic<bool> release {};
+	TaskGroup group {executor};
+	group.run([&]
+	{
+		while (!release)
+			std::this_thread::yield();
+	});
+
+	EXPECT_FALSE(group.waitFor(std::chrono::milliseconds {10}));
+	release = true;
+	EXPECT_TRUE(group.waitFor(std::chrono::seconds {10}));
+}
+
+TEST(TaskExecutor, interactiveFirst)
+{
+	TaskExecutor executor {1};
+
+	std::vector<TaskExecutor::Priority> order;
+	std::atomic<bool> release {};
+
+	TaskGroup blockingGroup {executor};
+	blockingGroup.run([&]
+	{
+		while (!release)
+			std::this_thread::yield();
+	});
+
+	TaskGroup group {executor};
+	TaskGroup interactiveGroup {executor, TaskExecutor::Priority::Interactive};
+	group.run([&] { order.push_back(TaskExecutor::Priority::Background); });
+	interactiveGroup.run([&] { order.push_back(TaskExecutor::Priority::Interactive); });
+
+	release = true;
+	blockingGroup.wait();
+	group.wait();
+	interactiveGroup.wait();
+
+	EXPECT_EQ(order, (std::vector<TaskExecutor::Priority> {TaskExecutor::Priority::Interactive, TaskExecutor::Priority::Background}));
+}
+
+TEST(TaskExecutor, workerInit)
+{
+	static thread_local bool initialized {};
+
+	TaskExecutor executor {4, [] { initialized = true; }};
+
+	std::atomic<std::size_t> initializedCount {};
+	parallelFor(executor, TaskExecutor::Priority::Background, 100, 0, [&](std::size_t)
+	{
+		if (initialized)
+			initializedCount++;
+	});
+
+	EXPECT_EQ(initializedCount, 100);
+	EXPECT_FALSE(initialized);
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "utils/Service.hpp"
+#include "utils/Tracing.hpp"
+
+namespace
+{
+	std::filesystem::path getTmpTraceFile()
+	{
+		return std::filesystem::temp_directory_path() / ("lms-test-traces-" + std::to_string(::getpid()));
+	}
+
+	std::vector<std::string> readLines(const std::filesystem::path& path)
+	{
+		std::vector<std::string> lines;
+
+		std::ifstream ifs {path};
+		for (std::string line; std::getline(ifs, line);)
+			lines.push_back(line);
+
+		return lines;
+	}
+
+	std::size_t countOccurrences(const std::string& str, std::string_view pattern)
+	{
+		std::size_t count {};
+		for (std::size_t pos {str.find(pattern)}; pos != std::string::npos; pos = str.find(pattern, pos + pattern.size()))
+			count++;
+
+		return count;
+	}
+}
+
+TEST(Tracing, noTracer)
+{
+	Tracing::ScopedSpan span {"test"};
+	EXPECT_FALSE(span.isRecording());
+	EXPECT_FALSE(Tracing::getCurrentSpanContext().sampled);
+}
+
+TEST(Tracing, nestedSpans)
+{
+	const std::filesystem::path traceFile {getTmpTraceFile()};
+	std::filesystem::remove(traceFile);
+	{
+		Service<Tracing::Tracer> tracer {std::make_unique<Tracing::Tracer>(Tracing::Tracer::Parameters {1, traceFile})};
+
+		{
+			Tracing::ScopedSpan root {"root"};
+			EXPECT_TRUE(root.isRecording());
+			root.setAttribute("path", "/rest/\"ping\"");
+			{
+				Tracing::ScopedSpan child {"child"};
+				EXPECT_TRUE(child.isRecording());
+			}
+			EXPECT_TRUE(readLines(traceFile).empty());
+		}
+
+		{
+			Tracing::ScopedSpan other {"other"};
+		}
+	}
+
+	const std::vector<std::string> lines {readLines(traceFile)};
+	std::filesystem::remove(traceFile);
+
+	ASSERT_EQ(lines.size(), 2);
+	EXPECT_EQ(countOccurrences(lines[0], "\"spanId\""), 2);
+	EXPECT_EQ(countOccurrences(lines[0], "\"parentSpanId\""), 1);
+	EXPECT_EQ(countOccurrences(lines[0], "\"name\":\"root\""), 1);
+	EXPECT_EQ(countOccurrences(lines[0], "\"name\":\"child\""), 1);
+	EXPECT_EQ(countOccurrences(lines[0], R"({"key":"path","value":{"stringValue":"/rest/\"ping\""}})"), 1);
+	EXPECT_EQ(countOccurrences(lines[1], "\"name\":\"other\""), 1);
+}
+
+TEST(Tracing, notSampled)
+{
+	const std::filesystem::path traceFile {getTmpTraceFile()};
+	std::filesystem::remove(traceFile);
+	{
+		Service<Tracing::Tracer> tracer {std::make_unique<Tracing::Tracer>(Tracing::Tracer::Parameters {0, traceFile})};
+
+		Tracing::ScopedSpan root {"root"};
+		Tracing::ScopedSpan child {"child"};
+		EXPECT_FALSE(root.isRecording());
+		EXPECT_FALSE(child.isRecording());
+	}
+
+	EXPECT_TRUE(readLines(traceFile).empty());
+	std::filesystem::remove(traceFile);
+}
+
+TEST(Tracing, otherThread)
+{
+	const std::filesystem::path traceFile {getTmpTraceFile()};
+	std::filesystem::remove(traceFile);
+	{
+		Service<Tracing::Tracer> tracer {std::make_unique<Tracing::Tracer>(Tracing::Tracer::Parameters {1, traceFile})};
+
+		Tracing::ScopedSpan root {"root"};
+		const Tracing::SpanContext context {Tracing::getCurrentSpanContext()};
+		EXPECT_TRUE(context.sampled);
+
+		std::thread thread {[&]
+		{
+			Tracing::ScopedSpan span {"deferred", context};
+			EXPECT_TRUE(span.isRecording());
+		}};
+		thread.join();
+
+		const std::vector<std::string> lines {readLines(traceFile)};
+		ASSERT_EQ(lines.size(), 1);
+		EXPECT_EQ(countOccurrences(lines[0], "\"name\":\"deferred\""), 1);
+		EXPECT_EQ(countOccurrences(lines[0], "\"parentSpanId\""), 1);
+	}
+	std::filesystem::remove(traceFile);
+}
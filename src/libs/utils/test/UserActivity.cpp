@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <optional>
+
+#include <gtest/gtest.h>
+
+#include "utils/UserActivity.hpp"
+
+TEST(UserActivity, ongoingCounts)
+{
+	const UserActivity::Stats initialStats {UserActivity::getStats()};
+	{
+		const UserActivity::RequestScope request;
+		const UserActivity::StreamScope stream1;
+		std::optional<UserActivity::StreamScope> stream2 {std::in_place};
+
+		EXPECT_EQ(UserActivity::getStats().ongoingRequestCount, initialStats.ongoingRequestCount + 1);
+		EXPECT_EQ(UserActivity::getStats().ongoingStreamCount, initialStats.ongoingStreamCount + 2);
+
+		stream2.reset();
+		EXPECT_EQ(UserActivity::getStats().ongoingStreamCount, initialStats.ongoingStreamCount + 1);
+	}
+
+	EXPECT_EQ(UserActivity::getStats().ongoingRequestCount, initialStats.ongoingRequestCount);
+	EXPECT_EQ(UserActivity::getStats().ongoingStreamCount, initialStats.ongoingStreamCount);
+}
+
+TEST(UserActivity, requestLatency)
+{
+	for (int i {}; i < 100; ++i)
+		UserActivity::recordRequestLatency(std::chrono::milliseconds {200});
+
+	const std::chrono::milliseconds latency {UserActivity::getStats().requestLatency};
+	EXPECT_GT(latency.count(), 150);
+	EXPECT_LE(latency.count(), 200);
+
+	for (int i {}; i < 100; ++i)
+		UserActivity::recordRequestLatency(std::chrono::milliseconds {0});
+
+	EXPECT_LT(UserActivity::getStats().requestLatency.count(), 10);
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <filesystem>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "utils/String.hpp"
+#include "utils/WriteBehindQueue.hpp"
+
+namespace
+{
+	std::string serialize(const int& value)
+	{
+		return std::to_string(value);
+	}
+
+	std::optional<int> deserialize(std::string_view str)
+	{
+		return StringUtils::readAs<int>(str);
+	}
+
+	std::filesystem::path getTmpJournalFile()
+	{
+		return std::filesystem::temp_directory_path() / ("lms-test-journal-" + std::to_string(::getpid()));
+	}
+}
+
+TEST(WriteBehindQueue, flushOnDemand)
+{
+	boost::asio::io_context ioContext;
+	std::vector<int> flushedEvents;
+
+	WriteBehindQueue<int>::Parameters params;
+	params.maxDelay = std::chrono::hours {1};
+
+	WriteBehindQueue<int> queue {ioContext, params, [&](const std::vector<int>& events) { flushedEvents.insert(std::end(flushedEvents), std::cbegin(events), std::cend(events)); }};
+
+	queue.push(1);
+	queue.push(2);
+	EXPECT_TRUE(queue.hasPendingEvents());
+	EXPECT_TRUE(flushedEvents.empty());
+
+	queue.flush();
+	EXPECT_FALSE(queue.hasPendingEvents());
+	EXPECT_EQ(flushedEvents, (std::vector<int> {1, 2}));
+}
+
+TEST(WriteBehindQueue, flushOnMaxPendingCount)
+{
+	boost::asio::io_context ioContext;
+	std::vector<std::size_t> flushSizes;
+
+	WriteBehindQueue<int>::Parameters params;
+	params.maxDelay = std::chrono::hours {1};
+	params.maxPendingEventCount = 3;
+
+	WriteBehindQueue<int> queue {ioContext, params, [&](const std::vector<int>& events) { flushSizes.push_back(events.size()); }};
+
+	queue.push(1);
+	queue.push(2);
+	ioContext.poll();
+	EXPECT_TRUE(flushSizes.empty());
+
+	queue.push(3);
+	ioContext.poll();
+	EXPECT_EQ(flushSizes, (std::vector<std::size_t> {3}));
+	EXPECT_FALSE(queue.hasPendingEvents());
+}
+
+TEST(WriteBehindQueue, flushOnDelay)
+{
+	boost::asio::io_context ioContext;
+	std::size_t flushedCount {};
+
+	WriteBehindQueue<int>::Parameters params;
+	params.maxDelay = std::chrono::milliseconds {10};
+
+	WriteBehindQueue<int> queue {ioContext, params, [&](const std::vector<int>& events) { flushedCount += events.size(); }};
+
+	queue.push(1);
+	ioContext.run_one_for(std::chrono::seconds {5});
+	EXPECT_EQ(flushedCount, 1);
+}
+
+TEST(WriteBehindQueue, noDelay)
+{
+	boost::asio::io_context ioContext;
+	std::size_t flushedCount {};
+
+	WriteBehindQueue<int>::Parameters params;
+	params.maxDelay = std::chrono::milliseconds {0};
+
+	WriteBehindQueue<int> queue {ioContext, params, [&](const std::vector<int>& events) { flushedCount += events.size(); }};
+
+	queue.push(1);
+	EXPECT_EQ(flushedCount, 1);
+	EXPECT_FALSE(queue.hasPendingEvents());
+}
+
+TEST(WriteBehindQueue, pushBatch)
+{
+	boost::asio::io_context ioContext;
+	std::vector<std::vector<int>> flushedBatches;
+
+	WriteBehindQueue<int>::Parameters params;
+	params.maxDelay = std::chrono::milliseconds {0};
+
+	WriteBehindQueue<int> queue {ioContext, params, [&](const std::vector<int>& events) { flushedBatches.push_back(events); }};
+
+	queue.push(std::vector<int> {});
+	EXPECT_TRUE(flushedBatches.empty());
+
+	queue.push(std::vector<int> {1, 2, 3});
+	ASSERT_EQ(flushedBatches.size(), 1);
+	EXPECT_EQ(flushedBatches.front(), (std::vector<int> {1, 2, 3}));
+	EXPECT_FALSE(queue.hasPendingEvents());
+}
+
+TEST(WriteBehindQueue, flushFailure)
+{
+	boost::asio::io_context ioContext;
+	bool fail {true};
+	std::vector<int> flushedEvents;
+
+	WriteBehindQueue<int>::Parameters params;
+	params.maxDelay = std::chrono::hours {1};
+
+	WriteBehindQueue<int> queue {ioContext, params, [&](const std::vector<int>& events)
+	{
+		if (fail)
+			throw std::runtime_error {"failure"};
+		flushedEvents.insert(std::end(flushedEvents), std::cbegin(events), std::cend(events));
+	}};
+
+	queue.push(1);
+	queue.flush();
+	EXPECT_TRUE(queue.hasPendingEvents());
+
+	queue.push(2);
+	fail = false;
+	queue.flush();
+	EXPECT_FALSE(queue.hasPendingEvents());
+	EXPECT_EQ(flushedEvents, (std::vector<int> {1, 2}));
+}
+
+TEST(WriteBehindQueue, journalReplay)
+{
+	const std::filesystem::path journalFile {getTmpJournalFile()};
+	std::filesystem::remove(journalFile);
+
+	boost::asio::io_context ioContext;
+
+	WriteBehindQueue<int>::Parameters params;
+	params.maxDelay = std::chrono::hours {1};
+	params.journalFile = journalFile;
+
+	{
+		// simulates a crash: the events cannot be written
+		WriteBehindQueue<int> queue {ioContext, params, [&](const std::vector<int>&) { throw std::runtime_error {"failure"}; }, serialize, deserialize};
+		queue.push(1);
+		queue.push(2);
+	}
+
+	std::vector<int> flushedEvents;
+	{
+		WriteBehindQueue<int> queue {ioContext, params, [&](const std::vector<int>& events) { flushedEvents.insert(std::end(flushedEvents), std::cbegin(events), std::cend(events)); }, serialize, deserialize};
+		EXPECT_EQ(flushedEvents, (std::vector<int> {1, 2}));
+		EXPECT_FALSE(queue.hasPendingEvents());
+
+		queue.push(3);
+	}
+	EXPECT_EQ(flushedEvents, (std::vector<int> {1, 2, 3}));
+
+	// everything has been flushed, nothing to replay
+	{
+		std::size_t replayedCount {};
+		WriteBehindQueue<int> queue {ioContext, params, [&](const std::vector<int>& events) { replayedCount += events.size(); }, serialize, deserialize};
+		EXPECT_EQ(replayedCount, 0);
+	}
+
+	std::filesystem::remove(journalFile);
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "utils/IZipper.hpp"
+
+namespace
+{
+	class TemporaryFile
+	{
+		public:
+			TemporaryFile(std::string_view content)
+				: _path {std::filesystem::temp_directory_path() / ("lms-test-zipper-" + std::to_string(reinterpret_cast<std::uintptr_t>(this)))}
+			{
+				std::ofstream ofs {_path, std::ios_base::binary};
+				ofs << content;
+			}
+
+			~TemporaryFile()
+			{
+				std::error_code ec;
+				std::filesystem::remove(_path, ec);
+			}
+
+			const std::filesystem::path& getPath() const { return _path; }
+
+		private:
+			std::filesystem::path _path;
+	};
+
+	std::string writeAll(Zip::IZipper& zipper)
+	{
+		std::ostringstream oss;
+		while (!zipper.isComplete())
+			zipper.writeSome(oss);
+
+		return oss.str();
+	}
+
+	std::uint32_t readLE32(const std::string& data, std::size_t offset)
+	{
+		std::uint32_t value {};
+		for (std::size_t i {}; i < 4; ++i)
+			value |= static_cast<std::uint32_t>(static_cast<unsigned char>(data[offset + i])) << (8 * i);
+
+		return value;
+	}
+}
+
+TEST(StoreZipper, totalSize)
+{
+	const TemporaryFile file1 {"Some content"};
+	const TemporaryFile file2 {std::string(300'000, 'a')};
+	const TemporaryFile file3 {""};
+
+	auto zipper {Zip::createStoreZipper({{"file1.txt", file1.getPath()}, {"dir/file2.txt", file2.getPath()}, {"file3.txt", file3.getPath()}})};
+	const std::optional<std::uint64_t> totalSize {zipper->getTotalSize()};
+	ASSERT_TRUE(totalSize);
+
+	const std::string archive {writeAll(*zipper)};
+	EXPECT_EQ(archive.size(), *totalSize);
+
+	ASSERT_GE(archive.size(), 22);
+	EXPECT_EQ(readLE32(archive, 0), 0x04034b50);                     // local header
+	EXPECT_EQ(readLE32(archive, archive.size() - 22), 0x06054b50);   // end of central directory
+	EXPECT_NE(archive.find("Some content"), std::string::npos);
+}
+
+TEST(StoreZipper, empty)
+{
+	auto zipper {Zip::createStoreZipper({})};
+	ASSERT_TRUE(zipper->getTotalSize());
+	EXPECT_EQ(*zipper->getTotalSize(), 22);
+
+	const std::string archive {writeAll(*zipper)};
+	ASSERT_EQ(archive.size(), 22);
+	EXPECT_EQ(readLE32(archive, 0), 0x06054b50);
+}
+
+TEST(StoreZipper, ranges)
+{
+	const TemporaryFile file1 {std::string(100'000, 'b')};
+	const TemporaryFile file2 {std::string(400'000, 'c')};
+	const Zip::EntryContainer entries {{"file1.txt", file1.getPath()}, {"file2.txt", file2.getPath()}};
+
+	const std::string archive {writeAll(*Zip::createStoreZipper(entries))};
+
+	for (const auto& [offset, size] : std::vector<std::pair<std::uint64_t, std::uint64_t>>{ {0, 1}, {10, 100}, {50'000, 200'000}, {100'050, 10}, {archive.size() - 100, 100}, {0, archive.size()} })
+	{
+		auto zipper {Zip::createStoreZipper(entries)};
+		zipper->setRange(offset, size);
+
+		EXPECT_EQ(writeAll(*zipper), archive.substr(offset, size)) << "offset = " << offset << ", size = " << size;
+	}
+}
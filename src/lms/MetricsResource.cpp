@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MetricsResource.hpp"
+
+#include <optional>
+#include <string>
+
+#include <boost/asio/ip/address.hpp>
+#include <Wt/Http/Request.h>
+#include <Wt/Http/Response.h>
+#include <Wt/Utils.h>
+
+#include "services/auth/IEnvService.hpp"
+#include "services/auth/IPasswordService.hpp"
+#include "services/database/Db.hpp"
+#include "services/database/Session.hpp"
+#include "services/database/User.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Metrics.hpp"
+#include "utils/Service.hpp"
+
+namespace
+{
+    struct Credentials
+    {
+        std::string loginName;
+        std::string password;
+    };
+
+    std::optional<Credentials> getBasicCredentials(const Wt::Http::Request& request)
+    {
+        static constexpr std::string_view prefix{ "Basic " };
+
+        const std::string authorization{ request.headerValue("Authorization") };
+        if (authorization.compare(0, prefix.size(), prefix) != 0)
+            return std::nullopt;
+
+        const std::string decoded{ Wt::Utils::base64Decode(authorization.substr(prefix.size())) };
+        const auto separator{ decoded.find(':') };
+        if (separator == std::string::npos)
+            return std::nullopt;
+
+        return Credentials{ decoded.substr(0, separator), decoded.substr(separator + 1) };
+    }
+}
+
+MetricsResource::MetricsResource(Database::Db& db)
+    : _db{ db }
+{
+}
+
+MetricsResource::~MetricsResource()
+{
+    beingDeleted();
+}
+
+bool MetricsResource::isAdminRequest(const Wt::Http::Request& request)
+{
+    std::optional<Database::UserId> userId;
+
+    if (auto* authEnvService{ Service<Auth::IEnvService>::get() })
+    {
+        const auto checkResult{ authEnvService->processRequest(request) };
+        if (checkResult.state == Auth::IEnvService::CheckResult::State::Granted)
+            userId = checkResult.userId;
+    }
+    else if (auto* authPasswordService{ Service<Auth::IPasswordService>::get() })
+    {
+        const std::optional<Credentials> credentials{ getBasicCredentials(request) };
+        if (!credentials)
+            return false;
+
+        boost::system::error_code ec;
+        const boost::asio::ip::address clientAddress{ boost::asio::ip::make_address(request.clientAddress(), ec) };
+        if (ec)
+            return false;
+
+        const auto checkResult{ authPasswordService->checkUserPassword(clientAddress, credentials->loginName, credentials->password) };
+        if (checkResult.state == Auth::IPasswordService::CheckResult::State::Granted)
+            userId = checkResult.userId;
+    }
+
+    if (!userId)
+        return false;
+
+    Database::Session& session{ _db.getTLSSession() };
+    auto transaction{ session.createSharedTransaction() };
+
+    const Database::User::pointer user{ Database::User::find(session, *userId) };
+    return user && user->isAdmin();
+}
+
+void MetricsResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
+{
+    if (!isAdminRequest(request))
+    {
+        LMS_LOG(MAIN, DEBUG) << "Metrics request denied from " << request.clientAddress();
+
+        response.setStatus(401);
+        response.addHeader("WWW-Authenticate", "Basic realm=\"LMS metrics\"");
+        return;
+    }
+
+    response.setMimeType("text/plain; version=0.0.4");
+    Service<Metrics::Registry>::get()->write(response.out());
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <Wt/WResource.h>
+
+namespace Database
+{
+    class Db;
+}
+
+// Exports the metrics registry using the Prometheus text format
+// Only admin users are allowed (HTTP basic authentication, or the configured env backend)
+class MetricsResource : public Wt::WResource
+{
+public:
+    MetricsResource(Database::Db& db);
+    ~MetricsResource() override;
+
+private:
+    void handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response) override;
+    bool isAdminRequest(const Wt::Http::Request& request);
+
+    Database::Db& _db;
+};
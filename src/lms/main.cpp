@@ -17,21 +17,36 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <sstream>
 #include <thread>
 
 #include <boost/asio/io_context.hpp>
+#include <boost/asio/signal_set.hpp>
 #include <boost/property_tree/xml_parser.hpp>
 
 #include <Wt/WServer.h>
 #include <Wt/WApplication.h>
 
 #include "image/IRawImage.hpp"
+#include "MetricsResource.hpp"
 #include "services/auth/IAuthTokenService.hpp"
 #include "services/auth/IPasswordService.hpp"
 #include "services/auth/IEnvService.hpp"
 #include "services/cover/ICoverService.hpp"
+#include "services/database/Backup.hpp"
 #include "services/database/Db.hpp"
+#include "services/database/IndexAdvisor.hpp"
+#include "services/database/MaintenanceScheduler.hpp"
+#include "services/database/QueryProfiler.hpp"
+#include "services/database/TransactionProfiler.hpp"
 #include "services/database/Session.hpp"
+#include "services/database/Warmup.hpp"
 #include "services/feedback/IFeedbackService.hpp"
 #include "services/recommendation/IPlaylistGeneratorService.hpp"
 #include "services/recommendation/IRecommendationService.hpp"
@@ -40,13 +55,49 @@
 #include "subsonic/SubsonicResource.hpp"
 #include "ui/LmsApplication.hpp"
 #include "ui/LmsApplicationManager.hpp"
+#include "ui/admin/ScannerStatusBroadcaster.hpp"
+#include "ui/explore/CollectorSnapshotCache.hpp"
+#include "ui/explore/ListEntryModelCache.hpp"
+#include "ui/explore/SearchResultCache.hpp"
+#include "utils/AllocatorStats.hpp"
+#include "utils/AsyncLogger.hpp"
+#include "utils/DeliveryReactor.hpp"
 #include "utils/IChildProcessManager.hpp"
 #include "utils/IConfig.hpp"
 #include "utils/IOContextRunner.hpp"
+#include "utils/Metrics.hpp"
 #include "utils/Service.hpp"
 #include "utils/String.hpp"
+#include "utils/TaskExecutor.hpp"
+#include "utils/Tracing.hpp"
 #include "utils/WtLogger.hpp"
 
+// Logs the time spent in a startup phase, also exported as a metric
+class StartupPhase
+{
+public:
+    StartupPhase(std::string_view name)
+        : _name{ name }
+    {
+    }
+
+    ~StartupPhase()
+    {
+        const auto duration{ std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _start) };
+        LMS_LOG(MAIN, INFO) << "Startup phase '" << _name << "' took " << duration.count() << " ms";
+
+        if (Metrics::Registry* registry{ Service<Metrics::Registry>::get() })
+            registry->getGauge("lms_startup_phase_duration_milliseconds", "Time spent in each startup phase", { {"phase", std::string{ _name }} }).set(duration.count());
+    }
+
+    StartupPhase(const StartupPhase&) = delete;
+    StartupPhase& operator=(const StartupPhase&) = delete;
+
+private:
+    const std::string_view _name;
+    const std::chrono::steady_clock::time_point _start{ std::chrono::steady_clock::now() };
+};
+
 static
 std::size_t
 getThreadCount()
@@ -57,6 +108,36 @@ getThreadCount()
     return configHttpServerThreadCount ? configHttpServerThreadCount : std::max<unsigned long>(2, std::thread::hardware_concurrency());
 }
 
+static
+std::size_t
+getTaskExecutorThreadCount()
+{
+    const unsigned long configThreadCount{ Service<IConfig>::get()->getULong("task-executor-thread-count", 0) };
+
+    // Background work (scanner, cover pre-generation, training): leave room for the request threads
+    return configThreadCount ? configThreadCount : std::max<unsigned long>(1, std::thread::hardware_concurrency() / 2);
+}
+
+static
+std::size_t
+getDbConnectionCount()
+{
+    const unsigned long configConnectionCount{ Service<IConfig>::get()->getULong("db-connection-count", 0) };
+
+    // request threads, along with the Subsonic API database threads
+    return configConnectionCount ? configConnectionCount : getThreadCount() + Service<IConfig>::get()->getULong("api-subsonic-db-thread-count", 4);
+}
+
+static
+std::size_t
+getDbBackgroundConnectionCount()
+{
+    const unsigned long configConnectionCount{ Service<IConfig>::get()->getULong("db-background-connection-count", 0) };
+
+    // task executor threads, IO context threads and the scanner thread: background work never waits for a connection
+    return configConnectionCount ? configConnectionCount : getTaskExecutorThreadCount() + getThreadCount() + 1;
+}
+
 static
 std::vector<std::string>
 generateWtConfig(std::string execPath)
@@ -131,6 +212,47 @@ generateWtConfig(std::string execPath)
     return args;
 }
 
+static
+std::unique_ptr<Logger>
+createLogger()
+{
+    auto logger{ std::make_unique<WtLogger>() };
+    if (!Service<IConfig>::get()->getBool("log-async", true))
+        return logger;
+
+    AsyncLogger::Parameters params;
+    params.queueSize = Service<IConfig>::get()->getULong("log-async-queue-size", 8192);
+    params.overflowPolicy = Service<IConfig>::get()->getString("log-async-overflow", "block") == "drop" ? AsyncLogger::OverflowPolicy::Drop : AsyncLogger::OverflowPolicy::Block;
+
+    return std::make_unique<AsyncLogger>(std::move(logger), params);
+}
+
+static
+void
+configureLogSeverities(Logger& logger)
+{
+    const std::string minSeverityName{ Service<IConfig>::get()->getString("log-min-severity", "info") };
+    if (const std::optional<Severity> minSeverity{ getSeverityByName(minSeverityName) })
+        logger.setMinSeverity(*minSeverity);
+    else
+        LMS_LOG(MAIN, ERROR) << "Invalid log severity '" << minSeverityName << "'";
+
+    // "module:severity" entries
+    Service<IConfig>::get()->visitStrings("log-module-min-severities", [&](std::string_view entry)
+        {
+            const std::vector<std::string_view> values{ StringUtils::splitString(entry, ":") };
+            const std::optional<Module> module{ values.size() == 2 ? getModuleByName(values[0]) : std::nullopt };
+            const std::optional<Severity> severity{ values.size() == 2 ? getSeverityByName(values[1]) : std::nullopt };
+            if (!module || !severity)
+            {
+                LMS_LOG(MAIN, ERROR) << "Invalid module log severity '" << entry << "'";
+                return;
+            }
+
+            logger.setMinSeverity(*module, *severity);
+        }, {});
+}
+
 
 static
 void
@@ -164,14 +286,7 @@ proxyScannerEventsToApplication(Scanner::IScannerService& scanner, Wt::WServer&
                 });
         });
 
-    scanner.getEvents().scanInProgress.connect([&](const Scanner::ScanStepStats& stats)
-        {
-            postAll(server, [=]
-                {
-                    LmsApp->getScannerEvents().scanInProgress.emit(stats);
-                    LmsApp->triggerUpdate();
-                });
-        });
+    // scan progress is only sent to the subscribed sessions, see ScannerStatusBroadcaster
 
     scanner.getEvents().scanScheduled.connect([&](const Wt::WDateTime dateTime)
         {
@@ -206,7 +321,12 @@ int main(int argc, char* argv[])
         close(STDIN_FILENO);
 
         Service<IConfig> config{ createConfig(configFilePath) };
-        Service<Logger> logger{ std::make_unique<WtLogger>() };
+        Service<Logger> logger{ createLogger() };
+        configureLogSeverities(*logger);
+        Service<Metrics::Registry> metricsRegistry{ std::make_unique<Metrics::Registry>() };
+        AllocatorStats::registerMetrics(*metricsRegistry);
+        LMS_LOG(MAIN, INFO) << "Using the " << AllocatorStats::getAllocatorName() << " memory allocator";
+        std::optional<StartupPhase> startupPhase{ std::in_place, "total" }; // until the server is started
 
         // use system locale. libarchive relies on this to write filenames
         if (char* locale{ ::setlocale(LC_ALL, "") })
@@ -221,6 +341,15 @@ int main(int argc, char* argv[])
         // Construct WT configuration and get the argc/argv back
         const std::vector<std::string> wtServerArgs{ generateWtConfig(argv[0]) };
 
+        Service<Tracing::Tracer> tracer;
+        if (config->getBool("tracing", false))
+        {
+            Tracing::Tracer::Parameters params;
+            params.sampleRatio = 1. / std::max<unsigned long>(1, config->getULong("tracing-sample-period", 100));
+            params.outputFile = config->getPath("tracing-file", config->getPath("working-dir") / "traces.json");
+            tracer.assign(std::make_unique<Tracing::Tracer>(params));
+        }
+
         std::vector<const char*> wtArgv(wtServerArgs.size());
         for (std::size_t i = 0; i < wtServerArgs.size(); ++i)
         {
@@ -232,10 +361,14 @@ int main(int argc, char* argv[])
         Wt::WServer server{ argv[0] };
         server.setServerConfiguration(wtServerArgs.size(), const_cast<char**>(&wtArgv[0]));
 
-        IOContextRunner ioContextRunner{ ioContext, getThreadCount() };
+        // Services running on these threads (synchronizers, scanner, trainings...) use the background database connections
+        auto setBackgroundThread{ [] { Database::Db::setThreadPriority(Database::ConnectionPriority::Background); } };
+        IOContextRunner ioContextRunner{ ioContext, getThreadCount(), setBackgroundThread };
+        Service<TaskExecutor> taskExecutor{ std::make_unique<TaskExecutor>(getTaskExecutorThreadCount(), setBackgroundThread) };
 
-        // Initializing a connection pool to the database that will be shared along services
-        Database::Db database{ config->getPath("working-dir") / "lms.db", getThreadCount() };
+        // Initializing the connection pools to the database that will be shared along services
+        std::optional<StartupPhase> dbPhase{ std::in_place, "database" };
+        Database::Db database{ config->getPath("working-dir") / "lms.db", getDbConnectionCount(), getDbBackgroundConnectionCount(), config->getULong("db-mmap-size", 0) * 1024 * 1024 };
         {
             Database::Session session{ database };
             session.prepareTables();
@@ -244,11 +377,110 @@ int main(int argc, char* argv[])
             // queries may be too slow to even be able to relaunch a scan sing the web interface
             session.analyze();
         }
+        dbPhase.reset();
+
+        // Background ANALYZE / optimize / checkpoint / vacuum at quiet times
+        std::optional<Database::MaintenanceScheduler> dbMaintenanceScheduler;
+        if (const unsigned long checkPeriod{ config->getULong("db-maintenance-check-period", 10) }; checkPeriod > 0)
+            dbMaintenanceScheduler.emplace(ioContext, database, std::chrono::minutes{ checkPeriod }, std::chrono::seconds{ config->getULong("db-maintenance-time-budget", 30) });
+
+        // Online backups, on schedule and on demand from the admin interface
+        Database::BackupService::Parameters backupParameters;
+        backupParameters.directory = config->getPath("db-backup-dir");
+        if (backupParameters.directory.empty())
+            backupParameters.directory = config->getPath("working-dir") / "backups";
+        backupParameters.period = std::chrono::minutes{ config->getULong("db-backup-period", 0) };
+        backupParameters.keepCount = config->getULong("db-backup-keep-count", 3);
+        backupParameters.maxThroughput = config->getULong("db-backup-max-throughput", 16384) * 1024;
+        Service<Database::BackupService> dbBackupService{ std::make_unique<Database::BackupService>(database, backupParameters) };
+
+        // In-memory indexes are built by the scanner service, at startup and after each scan
+        database.setLibraryCatalogEnabled(config->getBool("db-library-catalog", false));
+        database.setMaxCachedStatementCount(config->getULong("db-max-cached-statements", 500));
+
+        // Query and transaction stats are dumped in the logs on SIGUSR1 and on exit
+        Database::QueryProfiler::setEnabled(config->getBool("db-query-profiling", false));
+        {
+            Database::TransactionProfiler::Parameters transactionProfilerParameters;
+            transactionProfilerParameters.enabled = config->getBool("db-transaction-profiling", false);
+            transactionProfilerParameters.longWaitThreshold = std::chrono::milliseconds{ config->getULong("db-transaction-long-wait-threshold", 100) };
+            transactionProfilerParameters.longHoldThreshold = std::chrono::milliseconds{ config->getULong("db-transaction-long-hold-threshold", 500) };
+            Database::TransactionProfiler::setParameters(transactionProfilerParameters);
+        }
+        const auto dumpDatabaseStats{ [&database]
+            {
+                std::ostringstream oss;
+                if (Database::QueryProfiler::isEnabled())
+                {
+                    Database::QueryProfiler::dump(oss);
+
+                    // plans of the profiled query shapes, see also the admin database page
+                    try
+                    {
+                        Database::IndexAdvisor::dump(Database::IndexAdvisor::analyze(database), oss);
+                    }
+                    catch (const std::exception& e)
+                    {
+                        LMS_LOG(DB, ERROR) << "Cannot analyze the profiled queries: " << e.what();
+                    }
+                }
+                if (Database::TransactionProfiler::isEnabled())
+                    Database::TransactionProfiler::dump(oss);
+                LMS_LOG(DB, INFO) << oss.str();
+            } };
+        std::function<void()> waitForQueryStatsDump;
+        boost::asio::signal_set queryStatsDumpSignals{ ioContext };
+        if (Database::QueryProfiler::isEnabled() || Database::TransactionProfiler::isEnabled())
+        {
+            queryStatsDumpSignals.add(SIGUSR1);
+            waitForQueryStatsDump = [&]
+            {
+                queryStatsDumpSignals.async_wait([&](const boost::system::error_code& ec, int /*signal*/)
+                    {
+                        if (ec)
+                            return;
+
+                        dumpDatabaseStats();
+
+                        waitForQueryStatsDump();
+                    });
+            };
+            waitForQueryStatsDump();
+        }
+
+        // The configuration file is reloaded on SIGHUP, only some settings are applied live
+        std::function<void()> waitForConfigReload;
+        boost::asio::signal_set configReloadSignals{ ioContext, SIGHUP };
+        waitForConfigReload = [&]
+        {
+            configReloadSignals.async_wait([&](const boost::system::error_code& ec, int /*signal*/)
+                {
+                    if (ec)
+                        return;
+
+                    try
+                    {
+                        config->reload();
+                        configureLogSeverities(*logger);
+                    }
+                    catch (const LmsException& e)
+                    {
+                        LMS_LOG(MAIN, ERROR) << "Cannot reload configuration: " << e.what();
+                    }
+
+                    waitForConfigReload();
+                });
+        };
+        waitForConfigReload();
 
-        UserInterface::LmsApplicationManager appManager;
+        UserInterface::LmsApplicationManager appManager{ ioContext };
 
         // Service initialization order is important (reverse-order for deinit)
-        Service<IChildProcessManager> childProcessManagerService{ createChildProcessManager(ioContext) };
+        // Media content is produced on dedicated threads, as well as the reads from the transcoders
+        Service<DeliveryReactor> deliveryReactor;
+        if (const unsigned long deliveryThreadCount{ config->getULong("media-delivery-thread-count", 2) }; deliveryThreadCount > 0)
+            deliveryReactor.assign(std::make_unique<DeliveryReactor>(deliveryThreadCount));
+        Service<IChildProcessManager> childProcessManagerService{ createChildProcessManager(deliveryReactor.exists() ? deliveryReactor->getIoContext() : ioContext) };
         Service<Auth::IAuthTokenService> authTokenService;
         Service<Auth::IPasswordService> authPasswordService;
         Service<Auth::IEnvService> authEnvService;
@@ -266,11 +498,31 @@ int main(int argc, char* argv[])
         else
             throw LmsException{ "Bad value '" + authenticationBackend + "' for 'authentication-backend'" };
 
-        Image::init(argv[0]);
-        Service<Cover::ICoverService> coverService{ Cover::createCoverService(database, argv[0], server.appRoot() + "/images/unknown-cover.jpg") };
+        // These services do not depend on each other: create them concurrently
+        std::unique_ptr<Cover::ICoverService> cover;
+        std::unique_ptr<Scanner::IScannerService> scanner;
+        std::unique_ptr<Feedback::IFeedbackService> feedback;
+        std::unique_ptr<Scrobbling::IScrobblingService> scrobbling;
+        {
+            StartupPhase phase{ "services" };
+
+            TaskGroup group{ *taskExecutor, TaskExecutor::Priority::Interactive };
+            group.run([&]
+                {
+                    Image::init(argv[0]);
+                    cover = Cover::createCoverService(database, argv[0], server.appRoot() + "/images/unknown-cover.jpg");
+                });
+            group.run([&] { scanner = Scanner::createScannerService(database); });
+            group.run([&] { feedback = Feedback::createFeedbackService(ioContext, database); });
+            group.run([&] { scrobbling = Scrobbling::createScrobblingService(ioContext, database); });
+            group.wait();
+        }
+
+        Service<Cover::ICoverService> coverService{ std::move(cover) };
+        // Not loaded yet: the engine is loaded in the background once the server is started, queries get empty results until then
         Service<Recommendation::IRecommendationService> recommendationService{ Recommendation::createRecommendationService(database) };
         Service<Recommendation::IPlaylistGeneratorService> playlistGeneratorService{ Recommendation::createPlaylistGeneratorService(database, *recommendationService.get()) };
-        Service<Scanner::IScannerService> scannerService{ Scanner::createScannerService(database) };
+        Service<Scanner::IScannerService> scannerService{ std::move(scanner) };
 
         scannerService->getEvents().scanComplete.connect([&]
             {
@@ -279,8 +531,29 @@ int main(int argc, char* argv[])
                 coverService->flushCache();
             });
 
-        Service<Feedback::IFeedbackService> feedbackService{ Feedback::createFeedbackService(ioContext, database) };
-        Service<Scrobbling::IScrobblingService> scrobblingService{ Scrobbling::createScrobblingService(ioContext, database) };
+        scannerService->getEvents().scanComplete.connect([&](const Scanner::ScanStats& stats)
+            {
+                // Similarity results are cached by the engines
+                if (stats.nbChanges() > 0)
+                    recommendationService->load();
+            });
+
+        Service<UserInterface::ScannerStatusBroadcaster> scannerStatusBroadcaster{ std::make_unique<UserInterface::ScannerStatusBroadcaster>(*scannerService) };
+        Service<UserInterface::ListEntryModelCache> listEntryModelCache{ std::make_unique<UserInterface::ListEntryModelCache>(config->getULong("ui-list-entry-cache-max-count", 65536)) };
+        Service<UserInterface::CollectorSnapshotCache> collectorSnapshotCache{ std::make_unique<UserInterface::CollectorSnapshotCache>(config->getULong("ui-collector-snapshot-max-count", 64)) };
+        Service<UserInterface::SearchResultCache> searchResultCache{ std::make_unique<UserInterface::SearchResultCache>(config->getULong("ui-search-result-cache-max-count", 256)) };
+        scannerService->getEvents().scanComplete.connect([&](const Scanner::ScanStats& stats)
+            {
+                if (stats.nbChanges() > 0)
+                {
+                    listEntryModelCache->invalidate();
+                    collectorSnapshotCache->invalidate();
+                    searchResultCache->invalidate();
+                }
+            });
+
+        Service<Feedback::IFeedbackService> feedbackService{ std::move(feedback) };
+        Service<Scrobbling::IScrobblingService> scrobblingService{ std::move(scrobbling) };
 
         std::unique_ptr<Wt::WResource> subsonicResource;
 
@@ -291,6 +564,13 @@ int main(int argc, char* argv[])
             server.addResource(subsonicResource.get(), "/rest");
         }
 
+        std::unique_ptr<Wt::WResource> metricsResource;
+        if (config->getBool("metrics", false))
+        {
+            metricsResource = std::make_unique<MetricsResource>(database);
+            server.addResource(metricsResource.get(), "/metrics");
+        }
+
         // bind UI entry point
         server.addEntryPoint(Wt::EntryPointType::Application,
             [&](const Wt::WEnvironment& env)
@@ -300,15 +580,104 @@ int main(int argc, char* argv[])
 
         proxyScannerEventsToApplication(*scannerService, server);
 
+        // The hottest database tables and covers of the last run are read ahead at startup, until exit
+        const std::filesystem::path dbHotTablesFile{ config->getPath("working-dir") / "db-hot-tables" };
+        std::atomic<bool> abortWarmup{};
+
+        // Declared after the services it uses: waits for the pending loads on exit
+        TaskGroup backgroundLoads{ *taskExecutor };
+
         LMS_LOG(MAIN, INFO) << "Starting server...";
-        server.start();
+        {
+            StartupPhase phase{ "server" };
+            server.start();
+        }
+        startupPhase.reset();
+
+        backgroundLoads.run([&]
+            {
+                try
+                {
+                    StartupPhase phase{ "migration" };
+                    Database::Session session{ database, Database::ConnectionPriority::Background };
+                    session.runBackgroundMigrationTasks();
+                }
+                catch (const std::exception& e)
+                {
+                    LMS_LOG(MAIN, ERROR) << "Cannot run database background migration tasks: " << e.what();
+                }
+            });
+
+        if (config->getBool("db-warmup", true))
+        {
+            backgroundLoads.run([&]
+                {
+                    try
+                    {
+                        StartupPhase phase{ "database warmup" };
+
+                        Database::Warmup::Parameters warmupParameters;
+                        warmupParameters.hotTablesFile = dbHotTablesFile;
+                        warmupParameters.maxSize = config->getULong("db-warmup-max-size", 256) * 1024 * 1024;
+                        warmupParameters.maxThroughput = config->getULong("db-warmup-max-throughput", 32768) * 1024;
+                        Database::Warmup::run(database, warmupParameters, abortWarmup);
+                    }
+                    catch (const std::exception& e)
+                    {
+                        LMS_LOG(MAIN, ERROR) << "Cannot warm up database: " << e.what();
+                    }
+                });
+        }
+
+        if (config->getBool("cover-warmup", true))
+        {
+            backgroundLoads.run([&]
+                {
+                    StartupPhase phase{ "cover warmup" };
+                    coverService->warmupCache(abortWarmup);
+                });
+        }
+
+        Metrics::Gauge& recommendationReady{ metricsRegistry->getGauge("lms_recommendation_engine_ready", "Whether the recommendation engine has been loaded since startup") };
+        backgroundLoads.run([&]
+            {
+                try
+                {
+                    StartupPhase phase{ "recommendation" };
+                    recommendationService->load();
+                    recommendationReady.set(1);
+                    LMS_LOG(MAIN, INFO) << "Recommendation engine ready";
+                }
+                catch (const std::exception& e)
+                {
+                    LMS_LOG(MAIN, ERROR) << "Cannot load recommendation engine: " << e.what();
+                }
+            });
 
         LMS_LOG(MAIN, INFO) << "Now running...";
         Wt::WServer::waitForShutdown();
 
         LMS_LOG(MAIN, INFO) << "Stopping server...";
+        abortWarmup = true;
         server.stop();
 
+        if (Database::QueryProfiler::isEnabled() || Database::TransactionProfiler::isEnabled())
+            dumpDatabaseStats();
+
+        // the hot tables of the previous runs are kept if the queries are not profiled
+        if (Database::QueryProfiler::isEnabled())
+        {
+            try
+            {
+                Database::Session session{ database, Database::ConnectionPriority::Background };
+                Database::Warmup::saveHotTables(session, dbHotTablesFile);
+            }
+            catch (const std::exception& e)
+            {
+                LMS_LOG(MAIN, ERROR) << "Cannot save database hot tables: " << e.what();
+            }
+        }
+
         LMS_LOG(MAIN, INFO) << "Quitting...";
         res = EXIT_SUCCESS;
     }
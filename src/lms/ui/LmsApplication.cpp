@@ -37,6 +37,8 @@
 #include "services/database/TrackList.hpp"
 #include "services/database/User.hpp"
 #include "services/scrobbling/IScrobblingService.hpp"
+#include "utils/AllocationCounters.hpp"
+#include "utils/IConfig.hpp"
 #include "utils/Logger.hpp"
 #include "utils/Service.hpp"
 #include "utils/String.hpp"
@@ -61,6 +63,7 @@
 #include "NotificationContainer.hpp"
 #include "PlayQueue.hpp"
 #include "SettingsView.hpp"
+#include "Utils.hpp"
 
 namespace UserInterface {
 
@@ -190,6 +193,7 @@ LmsApplication::LmsApplication(const Wt::WEnvironment& env,
 ,  _db {db}
 ,  _appManager {appManager}
 , _authenticatedUser {userId ? std::make_optional<UserAuthInfo>(UserAuthInfo {*userId, false}) : std::nullopt}
+, _hiddenViewReleaseDelay {Service<IConfig>::get()->getULong("ui-hidden-view-release-delay", 5)}
 {
 	try
 	{
@@ -215,7 +219,7 @@ LmsApplication::init()
 	setTheme(std::make_shared<LmsTheme>());
 
 	useStyleSheet("resources/font-awesome/css/font-awesome.min.css");
-	require("js/mediaplayer.js");
+	require(Utils::getVersionedAssetUrl("js/mediaplayer.js"));
 
 	setTitle();
 	setLocalizedStrings(getOrCreateMessageBundle());
@@ -456,6 +460,7 @@ R"(function(current) {
 
 	std::unique_ptr<PlayQueue> playQueue {std::make_unique<PlayQueue>()};
 	Explore* explore {mainStack->addNew<Explore>(*filters, *playQueue)};
+	_explore = explore;
 	_playQueue = mainStack->addWidget(std::move(playQueue));
 	mainStack->addNew<SettingsView>();
 
@@ -509,9 +514,14 @@ R"(function(current) {
 		_playQueue->onPlaybackEnded();
 	});
 
-	_playQueue->trackSelected.connect([this] (Database::TrackId trackId, bool play, float replayGain)
+	_playQueue->trackSelected.connect([this] (const MediaPlayer::TrackDescriptor& track, bool play, float replayGain)
 	{
-		_mediaPlayer->loadTrack(trackId, play, replayGain);
+		_mediaPlayer->loadTrack(track, play, replayGain);
+	});
+
+	_playQueue->nextTrackChanged.connect([this] (std::optional<Database::TrackId> trackId)
+	{
+		_mediaPlayer->setNextTrack(trackId);
 	});
 
 	_playQueue->trackUnselected.connect([this]
@@ -537,7 +547,7 @@ R"(function(current) {
 				.arg(static_cast<unsigned>(stats.updates))
 				.arg(static_cast<unsigned>(stats.deletions))
 				.arg(static_cast<unsigned>(stats.duplicates.size()))
-				.arg(static_cast<unsigned>(stats.errors.size())));
+				.arg(static_cast<unsigned>(stats.errors.getCount())));
 		});
 	}
 
@@ -554,7 +564,17 @@ LmsApplication::notify(const Wt::WEvent& event)
 {
 	try
 	{
+		if (event.eventType() == Wt::EventType::User)
+			onUserActivity();
+
+		const AllocationCounters::ScopedCounter allocationCounter;
 		WApplication::notify(event);
+
+		if (AllocationCounters::isEnabled())
+		{
+			const AllocationCounters::Counters counters {allocationCounter.get()};
+			LMS_LOG(UI, DEBUG) << "Event handled: " << counters.allocationCount << " allocations, " << counters.allocatedBytes << " bytes";
+		}
 	}
 	catch (LmsApplicationException& e)
 	{
@@ -568,6 +588,29 @@ LmsApplication::notify(const Wt::WEvent& event)
 	}
 }
 
+void
+LmsApplication::onUserActivity()
+{
+	if (!_explore)
+		return;
+
+	// Lazily release the views the user went away from
+	if (_hiddenViewReleaseDelay.count() > 0)
+		_explore->releaseHiddenViewEntries(_hiddenViewReleaseDelay);
+
+	_appManager.reportActivity(*this, _explore->getLoadedEntryCount());
+}
+
+void
+LmsApplication::suspend()
+{
+	if (!_explore)
+		return;
+
+	LMS_LOG(UI, DEBUG) << "Releasing explore views of inactive session";
+	_explore->releaseViewEntries();
+}
+
 void
 LmsApplication::post(std::function<void()> func)
 {
@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <optional>
 
 #include <Wt/WApplication.h>
@@ -39,6 +40,7 @@ namespace Database
 namespace UserInterface {
 
 class CoverResource;
+class Explore;
 class LmsApplicationException;
 class MediaPlayer;
 class PlayQueue;
@@ -83,6 +85,9 @@ class LmsApplication : public Wt::WApplication
 		// Signal emitted just before the session ends (user may already be logged out)
 		Wt::Signal<>&	preQuit() { return _preQuit; }
 
+		// Release the heavy widgets (explore views), they are recreated on demand
+		void suspend();
+
 	private:
 		void init();
 		void processPasswordAuth();
@@ -94,6 +99,7 @@ class LmsApplication : public Wt::WApplication
 		void onUserLoggedIn();
 
 		void notify(const Wt::WEvent& event) override;
+		void onUserActivity();
 		void finalize() override;
 
 		void createHome();
@@ -109,6 +115,8 @@ class LmsApplication : public Wt::WApplication
 		};
 		std::optional<UserAuthInfo>				_authenticatedUser;
 		std::shared_ptr<CoverResource>			_coverResource;
+		const std::chrono::minutes				_hiddenViewReleaseDelay;
+		Explore*								_explore {};
 		MediaPlayer*							_mediaPlayer {};
 		PlayQueue*								_playQueue {};
 		NotificationContainer*					_notificationContainer {};
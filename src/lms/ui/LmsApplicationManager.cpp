@@ -19,16 +19,42 @@
 
 #include "LmsApplicationManager.hpp"
 
+#include <algorithm>
+#include <vector>
+
+#include <Wt/WServer.h>
+
+#include "utils/IConfig.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Service.hpp"
 #include "LmsApplication.hpp"
 
 namespace UserInterface
 {
+	namespace
+	{
+		constexpr std::chrono::minutes usageCheckPeriod {1};
+	}
+
+	LmsApplicationManager::LmsApplicationManager(boost::asio::io_context& ioContext)
+		: _idleSuspendDelay {Service<IConfig>::get()->getULong("ui-session-idle-suspend-delay", 30)}
+		, _maxLoadedEntryCountPerUser {Service<IConfig>::get()->getULong("ui-user-max-loaded-entries", 20000)}
+		, _usageCheckTimer {ioContext}
+	{
+		scheduleUsageCheck();
+	}
+
+	LmsApplicationManager::~LmsApplicationManager()
+	{
+		_usageCheckTimer.cancel();
+	}
+
 	void
 	LmsApplicationManager::registerApplication(LmsApplication& application)
 	{
 		{
 			std::scoped_lock lock {_mutex};
-			m_applications[application.getUserId()].insert(&application);
+			m_applications[application.getUserId()].emplace(&application, ApplicationUsage {application.sessionId(), std::chrono::steady_clock::now()});
 		}
 
 		applicationRegistered.emit(application);
@@ -39,10 +65,114 @@ namespace UserInterface
 	{
 		{
 			std::scoped_lock lock {_mutex};
-			m_applications[application.getUserId()].erase(&application);
+
+			auto itApplications {m_applications.find(application.getUserId())};
+			if (itApplications != std::end(m_applications))
+			{
+				itApplications->second.erase(&application);
+				if (itApplications->second.empty())
+					m_applications.erase(itApplications);
+			}
 		}
 
 		applicationUnregistered.emit(application);
 	}
 
+	void
+	LmsApplicationManager::reportActivity(LmsApplication& application, std::size_t loadedEntryCount)
+	{
+		std::scoped_lock lock {_mutex};
+
+		auto itApplications {m_applications.find(application.getUserId())};
+		if (itApplications == std::end(m_applications))
+			return;
+
+		auto itUsage {itApplications->second.find(&application)};
+		if (itUsage == std::end(itApplications->second))
+			return;
+
+		ApplicationUsage& usage {itUsage->second};
+		usage.lastActivity = std::chrono::steady_clock::now();
+		usage.loadedEntryCount = loadedEntryCount;
+		usage.suspended = false;
+	}
+
+	void
+	LmsApplicationManager::scheduleUsageCheck()
+	{
+		_usageCheckTimer.expires_after(usageCheckPeriod);
+		_usageCheckTimer.async_wait([this](const boost::system::error_code& ec)
+		{
+			if (ec == boost::asio::error::operation_aborted)
+				return;
+
+			checkUsage();
+			scheduleUsageCheck();
+		});
+	}
+
+	void
+	LmsApplicationManager::checkUsage()
+	{
+		const auto now {std::chrono::steady_clock::now()};
+		std::vector<std::string> sessionIdsToSuspend;
+
+		{
+			std::scoped_lock lock {_mutex};
+
+			for (auto& [userId, applications] : m_applications)
+			{
+				auto suspend {[&](ApplicationUsage& usage)
+				{
+					usage.suspended = true;
+					usage.loadedEntryCount = 0;
+					sessionIdsToSuspend.push_back(usage.sessionId);
+				}};
+
+				std::vector<ApplicationUsage*> activeApplications;
+				std::size_t loadedEntryCount {};
+
+				for (auto& [application, usage] : applications)
+				{
+					if (usage.suspended)
+						continue;
+
+					if (_idleSuspendDelay.count() > 0 && now - usage.lastActivity >= _idleSuspendDelay)
+					{
+						suspend(usage);
+						continue;
+					}
+
+					activeApplications.push_back(&usage);
+					loadedEntryCount += usage.loadedEntryCount;
+				}
+
+				if (_maxLoadedEntryCountPerUser == 0 || loadedEntryCount <= _maxLoadedEntryCountPerUser)
+					continue;
+
+				// Least recently active sessions first, the most recently active one is always kept
+				std::sort(std::begin(activeApplications), std::end(activeApplications), [](const ApplicationUsage* lhs, const ApplicationUsage* rhs) { return lhs->lastActivity < rhs->lastActivity; });
+				for (std::size_t i {}; i + 1 < activeApplications.size() && loadedEntryCount > _maxLoadedEntryCountPerUser; ++i)
+				{
+					loadedEntryCount -= activeApplications[i]->loadedEntryCount;
+					suspend(*activeApplications[i]);
+				}
+			}
+		}
+
+		for (const std::string& sessionId : sessionIdsToSuspend)
+		{
+			LMS_LOG(UI, DEBUG) << "Suspending session " << sessionId;
+
+			Wt::WServer::instance()->post(sessionId, []
+			{
+				// may be nullptr, see https://redmine.webtoolkit.eu/issues/8202
+				if (LmsApp)
+				{
+					LmsApp->suspend();
+					LmsApp->triggerUpdate();
+				}
+			});
+		}
+	}
 } // UserInterface
@@ -19,10 +19,13 @@
 
 #pragma once
 
+#include <chrono>
 #include <mutex>
-#include <unordered_set>
+#include <string>
 #include <unordered_map>
 
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <Wt/WSignal.h>
 
 #include "services/database/UserId.hpp"
@@ -30,19 +33,45 @@
 namespace UserInterface
 {
 	class LmsApplication;
+
+	// Keeps track of the sessions of each user and bounds their memory usage:
+	// idle sessions, and the least recently active sessions of the users that exceed their budget, get their explore views released
 	class LmsApplicationManager
 	{
 		public:
+			LmsApplicationManager(boost::asio::io_context& ioContext);
+			~LmsApplicationManager();
+
 			Wt::Signal<LmsApplication&> applicationRegistered;
 			Wt::Signal<LmsApplication&> applicationUnregistered;
 
 		private:
+			LmsApplicationManager(const LmsApplicationManager&) = delete;
+			LmsApplicationManager& operator=(const LmsApplicationManager&) = delete;
+
 			friend class LmsApplication;
 
 			void registerApplication(LmsApplication& application);
 			void unregisterApplication(LmsApplication& application);
+			// To be called by the application on user activity, from its own session
+			void reportActivity(LmsApplication& application, std::size_t loadedEntryCount);
+
+			void scheduleUsageCheck();
+			void checkUsage();
+
+			struct ApplicationUsage
+			{
+				std::string								sessionId;
+				std::chrono::steady_clock::time_point	lastActivity;
+				std::size_t								loadedEntryCount {}; // list entries currently held by the session
+				bool									suspended {};
+			};
+
+			const std::chrono::minutes	_idleSuspendDelay;
+			const std::size_t			_maxLoadedEntryCountPerUser;
+			boost::asio::steady_timer	_usageCheckTimer;
 
 			std::mutex _mutex;
-			std::unordered_map<Database::UserId, std::unordered_set<LmsApplication*>>  m_applications;
+			std::unordered_map<Database::UserId, std::unordered_map<LmsApplication*, ApplicationUsage>>  m_applications;
 	};
 } // UserInterface
@@ -9,13 +9,15 @@
 #include <Wt/WApplication.h>
 #include <Wt/WLinkedCssStyleSheet.h>
 
+#include "Utils.hpp"
+
 namespace UserInterface
 {
 
 	void
 	LmsTheme::init(Wt::WApplication* app) const
 	{
-		app->require("js/bootstrap.bundle.min.js");
+		app->require(Utils::getVersionedAssetUrl("js/bootstrap.bundle.min.js"));
 	}
 
 	std::string
@@ -35,8 +37,8 @@ namespace UserInterface
 	{
 		static const std::vector<Wt::WLinkedCssStyleSheet> files
 		{
-			{"css/bootstrap.solar.min.css"}, // TODO parametrize this
-			{"css/lms.css"},
+			{Utils::getVersionedAssetUrl("css/bootstrap.solar.min.css")}, // TODO parametrize this
+			{Utils::getVersionedAssetUrl("css/lms.css")},
 		};
 
 		return files;
@@ -26,10 +26,6 @@
 
 #include "utils/Logger.hpp"
 
-#include "services/database/Artist.hpp"
-#include "services/database/Release.hpp"
-#include "services/database/Session.hpp"
-#include "services/database/Track.hpp"
 #include "services/database/TrackList.hpp"
 #include "services/database/Types.hpp"
 #include "services/database/User.hpp"
@@ -231,33 +227,26 @@ namespace UserInterface
         }
     }
 
-    void MediaPlayer::loadTrack(Database::TrackId trackId, bool play, float replayGain)
+    void MediaPlayer::loadTrack(const TrackDescriptor& track, bool play, float replayGain)
     {
+        const Database::TrackId trackId{ track.trackId };
         LMS_LOG(UI, DEBUG) << "Playing track ID = " << trackId.toString();
 
         std::ostringstream oss;
         {
-            auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
-
-            const auto track{ Database::Track::find(LmsApp->getDbSession(), trackId) };
-            if (!track)
-                return;
-
             const std::string transcodingResource{ _audioTranscodingResource->getUrl(trackId) };
             const std::string nativeResource{ _audioFileResource->getUrl(trackId) };
 
-            const auto artists{ track->getArtists({Database::TrackArtistLinkType::Artist}) };
-
             oss
                 << "var params = {"
                 << " trackId :\"" << trackId.toString() << "\","
                 << " nativeResource: \"" << nativeResource << "\","
                 << " transcodingResource: \"" << transcodingResource << "\","
-                << " duration: " << std::chrono::duration_cast<std::chrono::seconds>(track->getDuration()).count() << ","
+                << " duration: " << std::chrono::duration_cast<std::chrono::seconds>(track.duration).count() << ","
                 << " replayGain: " << replayGain << ","
-                << " title: \"" << StringUtils::jsEscape(track->getName()) << "\","
-                << " artist: \"" << (!artists.empty() ? StringUtils::jsEscape(artists.front()->getName()) : "") << "\","
-                << " release: \"" << (track->getRelease() ? StringUtils::jsEscape(track->getRelease()->getName()) : "") << "\","
+                << " title: \"" << StringUtils::jsEscape(track.title) << "\","
+                << " artist: \"" << StringUtils::jsEscape(track.artistName) << "\","
+                << " release: \"" << StringUtils::jsEscape(track.releaseName) << "\","
                 << " artwork: ["
                 << "   { src: \"" << LmsApp->getCoverResource()->getTrackUrl(trackId, CoverResource::Size::Small) << "\", sizes: \"128x128\",	type: \"image/jpeg\" },"
                 << "   { src: \"" << LmsApp->getCoverResource()->getTrackUrl(trackId, CoverResource::Size::Large) << "\", sizes: \"512x512\",	type: \"image/jpeg\" },"
@@ -269,15 +258,15 @@ namespace UserInterface
             oss << "LMS.mediaplayer.loadTrack(params, " << (play ? "true" : "false") << ")"; // true to autoplay
 
             _title->setTextFormat(Wt::TextFormat::Plain);
-            _title->setText(Wt::WString::fromUTF8(track->getName()));
+            _title->setText(Wt::WString::fromUTF8(track.title));
 
             bool needSeparator{ true };
 
-            if (!artists.empty())
+            if (!track.artistLinkPath.empty())
             {
                 _artist->setTextFormat(Wt::TextFormat::Plain);
-                _artist->setText(Wt::WString::fromUTF8(artists.front()->getName()));
-                _artist->setLink(Utils::createArtistLink(artists.front()));
+                _artist->setText(Wt::WString::fromUTF8(track.artistName));
+                _artist->setLink(Wt::WLink{ Wt::LinkType::InternalPath, track.artistLinkPath });
             }
             else
             {
@@ -286,11 +275,11 @@ namespace UserInterface
                 needSeparator = false;
             }
 
-            if (track->getRelease())
+            if (!track.releaseLinkPath.empty())
             {
                 _release->setTextFormat(Wt::TextFormat::Plain);
-                _release->setText(Wt::WString::fromUTF8(track->getRelease()->getName()));
-                _release->setLink(Utils::createReleaseLink(track->getRelease()));
+                _release->setText(Wt::WString::fromUTF8(track.releaseName));
+                _release->setLink(Wt::WLink{ Wt::LinkType::InternalPath, track.releaseLinkPath });
             }
             else
             {
@@ -317,6 +306,18 @@ namespace UserInterface
         doJavaScript("LMS.mediaplayer.stop()");
     }
 
+    void MediaPlayer::setNextTrack(std::optional<Database::TrackId> trackId)
+    {
+        std::ostringstream oss;
+        if (trackId)
+            oss << "LMS.mediaplayer.setNextTrack({ transcodingResource: \"" << _audioTranscodingResource->getUrl(*trackId) << "\" })";
+        else
+            oss << "LMS.mediaplayer.setNextTrack(null)";
+
+        LMS_LOG(UI, DEBUG) << "Running js = '" << oss.str() << "'";
+        doJavaScript(oss.str());
+    }
+
     void MediaPlayer::setSettings(const Settings& settings)
     {
         _settings = settings;
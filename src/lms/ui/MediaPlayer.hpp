@@ -19,7 +19,9 @@
 
 #pragma once
 
+#include <chrono>
 #include <optional>
+#include <string>
 
 #include <Wt/WAnchor.h>
 #include <Wt/WJavaScript.h>
@@ -88,6 +90,18 @@ namespace UserInterface
             ReplayGain replayGain;
         };
 
+        // Everything needed to load a track, gathered ahead so that changing track does not need any database access
+        struct TrackDescriptor
+        {
+            Database::TrackId trackId;
+            std::chrono::milliseconds duration{};
+            std::string title;
+            std::string artistName;
+            std::string artistLinkPath; // empty if no artist
+            std::string releaseName;
+            std::string releaseLinkPath; // empty if no release
+        };
+
         MediaPlayer();
         ~MediaPlayer() = default;
         MediaPlayer(const MediaPlayer&) = delete;
@@ -95,9 +109,12 @@ namespace UserInterface
 
         std::optional<Database::TrackId> getTrackLoaded() const { return _trackIdLoaded; }
 
-        void loadTrack(Database::TrackId trackId, bool play, float replayGain);
+        void loadTrack(const TrackDescriptor& track, bool play, float replayGain);
         void stop();
 
+        // hint about the track that will likely be played after the current one
+        void setNextTrack(std::optional<Database::TrackId> trackId);
+
         std::optional<Settings>	getSettings() const { return _settings; }
         void					setSettings(const Settings& settings);
 
@@ -33,6 +33,7 @@
 #include "services/database/Session.hpp"
 #include "services/database/Track.hpp"
 #include "services/database/TrackList.hpp"
+#include "services/database/TrackRelations.hpp"
 #include "services/database/User.hpp"
 #include "services/feedback/IFeedbackService.hpp"
 #include "services/recommendation/IPlaylistGeneratorService.hpp"
@@ -143,6 +144,10 @@ namespace UserInterface
                 addSome();
                 updateCurrentTrack(true);
             });
+        _entriesContainer->setVirtualized(_maxLiveCount, [this](std::size_t first, std::size_t count)
+            {
+                return createEntries(Database::Range{ first, count });
+            });
 
         Wt::WPushButton* shuffleBtn{ bindNew<Wt::WPushButton>("shuffle-btn", Wt::WString::tr("Lms.PlayQueue.template.shuffle-btn"), Wt::TextFormat::XHTML) };
         shuffleBtn->clicked().connect([=]
@@ -158,6 +163,7 @@ namespace UserInterface
                     for (const Database::TrackListEntry::pointer& entry : entries)
                         LmsApp->getDbSession().create<Database::TrackListEntry>(entry->getTrack(), queue);
                 }
+                invalidatePrefetch();
                 _entriesContainer->reset();
                 addSome();
             });
@@ -232,6 +238,13 @@ namespace UserInterface
                 }
             });
 
+        // prefetched tracks may have been changed or removed
+        LmsApp->getScannerEvents().scanComplete.connect(this, [this](const Scanner::ScanStats& stats)
+            {
+                if (stats.nbChanges())
+                    invalidatePrefetch();
+            });
+
         updateInfo();
     }
 
@@ -262,6 +275,7 @@ namespace UserInterface
             auto transaction{ LmsApp->getDbSession().createUniqueTransaction() };
             getQueue().modify()->clear();
         }
+        invalidatePrefetch();
 
         _entriesContainer->reset();
         _trackPos.reset();
@@ -280,40 +294,144 @@ namespace UserInterface
     {
         updateCurrentTrack(false);
 
-        Database::TrackId trackId{};
-        std::optional<float> replayGain{};
+        // Only needed if the track has not been prefetched by a previous transition
+        if (!isPrefetched(pos))
+            prefetch(pos);
+
+        // If out of range, stop playing
+        if (pos >= _prefetch->queueCount)
         {
-            auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
+            if (!isRepeatAllSet() || _prefetch->queueCount == 0)
+            {
+                stop();
+                return;
+            }
 
-            const Database::TrackList::pointer queue{ getQueue() };
+            pos = 0;
+            if (!isPrefetched(pos))
+                prefetch(pos);
+        }
 
-            // If out of range, stop playing
-            if (pos >= queue->getCount())
+        _trackPos = pos;
+        const PrefetchedEntry& entry{ _prefetch->entries.at(pos) };
+        const std::optional<float> replayGain{ getReplayGain(pos, entry) };
+
+        updateCurrentTrack(true);
+        _isTrackSelected = true;
+        trackSelected.emit(entry.track, play, replayGain ? *replayGain : 0);
+        nextTrackChanged.emit(getNextTrackId());
+
+        // Database work is done once the track is loaded: save the position and prepare the next transitions
+        LmsApp->post([this, pos]
             {
-                if (!isRepeatAllSet() || queue->getCount() == 0)
-                {
-                    stop();
+                if (_trackPos != pos)
                     return;
+
+                {
+                    auto transaction{ LmsApp->getDbSession().createUniqueTransaction() };
+
+                    if (!LmsApp->getUser()->isDemo())
+                        LmsApp->getUser().modify()->setCurPlayingTrackPos(pos);
                 }
 
-                pos = 0;
-            }
+                enqueueRadioTracksIfNeeded();
 
-            _trackPos = pos;
-            const Database::Track::pointer track{ queue->getEntry(*_trackPos)->getTrack() };
+                if (!isPrefetched(pos + 1))
+                {
+                    prefetch(pos);
+                    nextTrackChanged.emit(getNextTrackId());
+                }
 
-            trackId = track->getId();
+                LmsApp->triggerUpdate();
+            });
+    }
 
-            replayGain = getReplayGain(pos, track);
+    std::optional<Database::TrackId> PlayQueue::getNextTrackId() const
+    {
+        if (!_trackPos || !_prefetch)
+            return std::nullopt;
+
+        std::size_t nextPos{ *_trackPos + 1 };
+        if (nextPos >= _prefetch->queueCount)
+        {
+            if (!isRepeatAllSet())
+                return std::nullopt;
 
-            if (!LmsApp->getUser()->isDemo())
-                LmsApp->getUser().modify()->setCurPlayingTrackPos(pos);
+            nextPos = 0;
         }
 
-        enqueueRadioTracksIfNeeded();
-        updateCurrentTrack(true);
-        _isTrackSelected = true;
-        trackSelected.emit(trackId, play, replayGain ? *replayGain : 0);
+        if (nextPos == *_trackPos)
+            return std::nullopt;
+
+        const auto it{ _prefetch->entries.find(nextPos) };
+        if (it == std::cend(_prefetch->entries))
+            return std::nullopt;
+
+        return it->second.track.trackId;
+    }
+
+    bool PlayQueue::isPrefetched(std::size_t pos) const
+    {
+        if (!_prefetch)
+            return false;
+
+        if (pos >= _prefetch->queueCount)
+            return true;
+
+        // neighbours are needed to compute the replay gain in auto mode
+        auto isEntryPrefetched{ [this](std::size_t entryPos) { return _prefetch->entries.find(entryPos) != std::cend(_prefetch->entries); } };
+        return isEntryPrefetched(pos)
+            && (pos == 0 || isEntryPrefetched(pos - 1))
+            && (pos + 1 >= _prefetch->queueCount || isEntryPrefetched(pos + 1));
+    }
+
+    void PlayQueue::prefetch(std::size_t pos)
+    {
+        Prefetch prefetch;
+
+        auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
+
+        const Database::TrackList::pointer queue{ getQueue() };
+        prefetch.queueCount = queue->getCount();
+
+        // previous entry, current entry and the next ones, along with the neighbour of the last one
+        const std::size_t firstPos{ pos > 0 ? pos - 1 : 0 };
+        const auto entries{ queue->getEntriesWithTracks(Database::Range{ firstPos, (pos - firstPos) + 1 + _prefetchCount + 1 }) };
+        for (std::size_t i{}; i < entries.size(); ++i)
+        {
+            const Database::Track::pointer& track{ entries[i].second };
+
+            PrefetchedEntry entry;
+            entry.track.trackId = track->getId();
+            entry.track.duration = track->getDuration();
+            entry.track.title = track->getName();
+
+            const auto artists{ track->getArtists({Database::TrackArtistLinkType::Artist}) };
+            if (!artists.empty())
+            {
+                entry.track.artistName = artists.front()->getName();
+                entry.track.artistLinkPath = Utils::getArtistLinkPath(artists.front());
+            }
+
+            if (const Database::Release::pointer release{ track->getRelease() })
+            {
+                entry.releaseId = release->getId();
+                entry.track.releaseName = release->getName();
+                entry.track.releaseLinkPath = Utils::getReleaseLinkPath(release);
+            }
+
+            entry.trackReplayGain = track->getTrackReplayGain();
+            entry.releaseReplayGain = track->getReleaseReplayGain();
+
+            prefetch.entries.emplace(firstPos + i, std::move(entry));
+        }
+
+        _prefetch = std::move(prefetch);
+    }
+
+    void PlayQueue::invalidatePrefetch()
+    {
+        _prefetch.reset();
     }
 
     void PlayQueue::playPrevious()
@@ -403,20 +521,13 @@ namespace UserInterface
             Database::TrackList::pointer queue{ getQueue() };
             const std::size_t queueSize{ queue->getCount() };
 
-            std::size_t nbTracksToEnqueue{ queueSize + trackIds.size() > getCapacity() ? getCapacity() - queueSize : trackIds.size() };
-            for (const Database::TrackId trackId : trackIds)
-            {
-                if (nbTracksToEnqueue == 0)
-                    break;
-
-                Database::Track::pointer track{ Database::Track::find(LmsApp->getDbSession(), trackId) };
-                if (!track)
-                    continue;
-
-                LmsApp->getDbSession().create<Database::TrackListEntry>(track, queue);
-                nbTracksToEnqueue--;
-            }
+            const std::size_t nbTracksToEnqueue{ queueSize + trackIds.size() > getCapacity() ? getCapacity() - queueSize : trackIds.size() };
+            if (nbTracksToEnqueue == trackIds.size())
+                queue.modify()->addTracks(trackIds);
+            else
+                queue.modify()->addTracks(std::vector<Database::TrackId>(std::cbegin(trackIds), std::cbegin(trackIds) + nbTracksToEnqueue));
         }
+        invalidatePrefetch();
 
         updateInfo();
         addSome();
@@ -437,6 +548,7 @@ namespace UserInterface
             tracks.push_back(entry->getTrack()->getId());
             entry.remove();
         }
+        invalidatePrefetch();
 
         if (_trackPos)
         {
@@ -488,27 +600,55 @@ namespace UserInterface
     }
 
     void PlayQueue::addSome()
+    {
+        for (std::unique_ptr<Wt::WWidget>& entry : createEntries(Database::Range{ _entriesContainer->getCount(), _batchSize }))
+            _entriesContainer->add(std::move(entry));
+    }
+
+    std::vector<std::unique_ptr<Wt::WWidget>> PlayQueue::createEntries(Database::Range range)
     {
         auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
 
         const Database::TrackList::pointer queue{ getQueue() };
-        const auto tracklistEntries{ queue->getEntries(Database::Range {_entriesContainer->getCount(), _batchSize}) };
-        for (const Database::TrackListEntry::pointer& tracklistEntry : tracklistEntries)
-            addEntry(tracklistEntry);
+        const auto tracklistEntries{ queue->getEntriesWithTracks(range) };
+
+        // relations and feedback of the whole batch, using a few queries
+        std::vector<Database::TrackId> trackIds;
+        trackIds.reserve(tracklistEntries.size());
+        for (const auto& [tracklistEntry, track] : tracklistEntries)
+            trackIds.push_back(track->getId());
+
+        const Database::TrackRelations trackRelations{ LmsApp->getDbSession(), trackIds };
+        const auto starredDateTimes{ Service<Feedback::IFeedbackService>::get()->getStarredDateTimes(LmsApp->getUserId(), trackIds) };
+
+        std::vector<std::unique_ptr<Wt::WWidget>> entries;
+        entries.reserve(tracklistEntries.size());
+        for (const auto& [tracklistEntry, track] : tracklistEntries)
+        {
+            entries.push_back(createEntry(tracklistEntry, track, trackRelations, starredDateTimes.find(track->getId()) != std::cend(starredDateTimes)));
+
+            // entries may be recreated after having been released
+            if (_trackPos && *_trackPos == range.offset + entries.size() - 1)
+                entries.back()->addStyleClass("Lms-entry-playing");
+        }
+
+        return entries;
     }
 
-    void PlayQueue::addEntry(const Database::TrackListEntry::pointer& tracklistEntry)
+    std::unique_ptr<Wt::WWidget> PlayQueue::createEntry(const Database::TrackListEntry::pointer& tracklistEntry, const Database::Track::pointer& track, const Database::TrackRelations& trackRelations, bool starred)
     {
         const Database::TrackListEntryId tracklistEntryId{ tracklistEntry->getId() };
-        const auto track{ tracklistEntry->getTrack() };
         const Database::TrackId trackId{ track->getId() };
 
-        Template* entry{ _entriesContainer->addNew<Template>(Wt::WString::tr("Lms.PlayQueue.template.entry")) };
+        auto entryWidget{ std::make_unique<Template>(Wt::WString::tr("Lms.PlayQueue.template.entry")) };
+        Template* entry{ entryWidget.get() };
         entry->addFunction("id", &Wt::WTemplate::Functions::id);
 
         entry->bindString("name", Wt::WString::fromUTF8(track->getName()), Wt::TextFormat::Plain);
 
-        const auto artists{ track->getArtistIds({Database::TrackArtistLinkType::Artist}) };
+        std::vector<Database::ArtistId> artists;
+        for (const Database::Artist::pointer& artist : trackRelations.getArtists(trackId, {Database::TrackArtistLinkType::Artist}))
+            artists.push_back(artist->getId());
         if (!artists.empty())
         {
             entry->setCondition("if-has-artists", true);
@@ -516,7 +656,7 @@ namespace UserInterface
             entry->bindWidget("artists-md", Utils::createArtistAnchorList(artists));
         }
 
-        const auto release{ track->getRelease() };
+        const auto release{ trackRelations.getRelease(trackId) };
         if (release)
         {
             entry->setCondition("if-has-release", true);
@@ -555,6 +695,7 @@ namespace UserInterface
                     Database::TrackListEntry::pointer entryToRemove{ Database::TrackListEntry::getById(LmsApp->getDbSession(), tracklistEntryId) };
                     entryToRemove.remove();
                 }
+                invalidatePrefetch();
 
                 if (_trackPos)
                 {
@@ -581,7 +722,7 @@ namespace UserInterface
 
         auto isStarred{ [=] { return Service<Feedback::IFeedbackService>::get()->isStarred(LmsApp->getUserId(), trackId); } };
 
-        Wt::WPushButton* starBtn{ entry->bindNew<Wt::WPushButton>("star", Wt::WString::tr(isStarred() ? "Lms.Explore.unstar" : "Lms.Explore.star")) };
+        Wt::WPushButton* starBtn{ entry->bindNew<Wt::WPushButton>("star", Wt::WString::tr(starred ? "Lms.Explore.unstar" : "Lms.Explore.star")) };
         starBtn->clicked().connect([=]
             {
                 auto transaction{ LmsApp->getDbSession().createUniqueTransaction() };
@@ -600,6 +741,8 @@ namespace UserInterface
 
         entry->bindNew<Wt::WPushButton>("download", Wt::WString::tr("Lms.Explore.download"))
             ->setLink(Wt::WLink{ std::make_unique<DownloadTrackResource>(trackId) });
+
+        return entryWidget;
     }
 
     void PlayQueue::enqueueRadioTracksIfNeeded()
@@ -628,7 +771,7 @@ namespace UserInterface
         enqueueTracks(trackIds);
     }
 
-    std::optional<float> PlayQueue::getReplayGain(std::size_t pos, const Database::Track::pointer& track) const
+    std::optional<float> PlayQueue::getReplayGain(std::size_t pos, const PrefetchedEntry& entry) const
     {
         const auto& settings{ LmsApp->getMediaPlayer().getSettings() };
         if (!settings)
@@ -642,34 +785,32 @@ namespace UserInterface
             return std::nullopt;
 
         case MediaPlayer::Settings::ReplayGain::Mode::Track:
-            gain = track->getTrackReplayGain();
+            gain = entry.trackReplayGain;
             break;
 
         case MediaPlayer::Settings::ReplayGain::Mode::Release:
-            gain = track->getReleaseReplayGain();
+            gain = entry.releaseReplayGain;
             if (!gain)
-                gain = track->getTrackReplayGain();
+                gain = entry.trackReplayGain;
             break;
 
         case MediaPlayer::Settings::ReplayGain::Mode::Auto:
         {
-            const Database::TrackList::pointer queue{ getQueue() };
-            const Database::TrackListEntry::pointer prevEntry{ pos > 0 ? queue->getEntry(pos - 1) : Database::TrackListEntry::pointer {} };
-            const Database::TrackListEntry::pointer nextEntry{ queue->getEntry(pos + 1) };
-            const Database::Track::pointer prevTrack{ prevEntry ? prevEntry->getTrack() : Database::Track::pointer {} };
-            const Database::Track::pointer nextTrack{ nextEntry ? nextEntry->getTrack() : Database::Track::pointer {} };
-
-            if ((prevTrack && prevTrack->getRelease() && prevTrack->getRelease() == track->getRelease())
-                ||
-                (nextTrack && nextTrack->getRelease() && nextTrack->getRelease() == track->getRelease()))
+            auto isInSameRelease{ [&](std::size_t neighbourPos)
+                {
+                    const auto it{ _prefetch->entries.find(neighbourPos) };
+                    return it != std::cend(_prefetch->entries) && it->second.releaseId.isValid() && it->second.releaseId == entry.releaseId;
+                } };
+
+            if ((pos > 0 && isInSameRelease(pos - 1)) || isInSameRelease(pos + 1))
             {
-                gain = track->getReleaseReplayGain();
+                gain = entry.releaseReplayGain;
                 if (!gain)
-                    gain = track->getTrackReplayGain();
+                    gain = entry.trackReplayGain;
             }
             else
             {
-                gain = track->getTrackReplayGain();
+                gain = entry.trackReplayGain;
             }
             break;
         }
@@ -19,7 +19,10 @@
 
 #pragma once
 
+#include <map>
+#include <memory>
 #include <optional>
+#include <vector>
 
 #include <Wt/WCheckBox.h>
 #include <Wt/WContainerWidget.h>
@@ -27,10 +30,13 @@
 #include <Wt/WText.h>
 
 #include "services/database/Object.hpp"
+#include "services/database/ReleaseId.hpp"
 #include "services/database/TrackId.hpp"
 #include "services/database/TrackListId.hpp"
+#include "services/database/Types.hpp"
 
 #include "common/Template.hpp"
+#include "MediaPlayer.hpp"
 
 
 namespace Database
@@ -38,6 +44,7 @@ namespace Database
 	class Track;
 	class TrackList;
 	class TrackListEntry;
+	class TrackRelations;
 }
 
 namespace UserInterface {
@@ -62,7 +69,10 @@ class PlayQueue : public Template
 		void playPrevious();
 
 		// Signal emitted when a track is to be load(and optionally played)
-		Wt::Signal<Database::TrackId, bool /*play*/, float /* replayGain */> trackSelected;
+		Wt::Signal<MediaPlayer::TrackDescriptor, bool /*play*/, float /* replayGain */> trackSelected;
+
+		// Signal emitted when the track that is expected to be played next changes
+		Wt::Signal<std::optional<Database::TrackId>> nextTrackChanged;
 
 		// Signal emitted when track is unselected (has to be stopped)
 		Wt::Signal<> trackUnselected;
@@ -86,7 +96,8 @@ class PlayQueue : public Template
 		void enqueueTracks(const std::vector<Database::TrackId>& trackIds);
 		std::vector<Database::TrackId> getAndClearNextTracks();
 		void addSome();
-		void addEntry(const Database::ObjectPtr<Database::TrackListEntry>& entry);
+		std::vector<std::unique_ptr<Wt::WWidget>> createEntries(Database::Range range);
+		std::unique_ptr<Wt::WWidget> createEntry(const Database::ObjectPtr<Database::TrackListEntry>& entry, const Database::ObjectPtr<Database::Track>& track, const Database::TrackRelations& trackRelations, bool starred);
 		void enqueueRadioTracksIfNeeded();
 		void enqueueRadioTracks();
 		void updateInfo();
@@ -95,9 +106,27 @@ class PlayQueue : public Template
 		bool isRadioModeSet() const;
 
 		void loadTrack(std::size_t pos, bool play);
+		std::optional<Database::TrackId> getNextTrackId() const;
 		void stop();
 
-		std::optional<float> getReplayGain(std::size_t pos, const Database::ObjectPtr<Database::Track>& track) const;
+		// Playback data of the entries around the current position, so that track transitions do not query the database
+		struct PrefetchedEntry
+		{
+			MediaPlayer::TrackDescriptor track;
+			Database::ReleaseId releaseId;
+			std::optional<float> trackReplayGain;
+			std::optional<float> releaseReplayGain;
+		};
+		struct Prefetch
+		{
+			std::size_t queueCount {};
+			std::map<std::size_t, PrefetchedEntry> entries; // by position in queue
+		};
+		bool isPrefetched(std::size_t pos) const;
+		void prefetch(std::size_t pos);
+		void invalidatePrefetch(); // to be called each time the queue is modified
+
+		std::optional<float> getReplayGain(std::size_t pos, const PrefetchedEntry& entry) const;
 		void saveAsTrackList();
 
 		void exportToNewTrackList(const Wt::WString& name);
@@ -105,6 +134,8 @@ class PlayQueue : public Template
 
 		const std::size_t _capacity;
 		static inline constexpr std::size_t _batchSize {12};
+		static inline constexpr std::size_t _maxLiveCount {240};
+		static inline constexpr std::size_t _prefetchCount {5};
 
 		bool _mediaPlayerSettingsLoaded {};
 		Database::TrackListId _queueId {};
@@ -115,6 +146,7 @@ class PlayQueue : public Template
 		Wt::WCheckBox* _radioBtn {};
 		std::optional<std::size_t> _trackPos;	// current track position, if set
 		bool _isTrackSelected {};
+		std::optional<Prefetch> _prefetch;	// reset each time the queue is modified
 };
 
 } // namespace UserInterface
@@ -19,10 +19,17 @@
 
 #include "Utils.hpp"
 
+#include <array>
+#include <filesystem>
+#include <fstream>
 #include <iomanip>
+#include <mutex>
+#include <optional>
 #include <sstream>
+#include <unordered_map>
 
 #include <Wt/WAnchor.h>
+#include <Wt/WApplication.h>
 #include <Wt/WText.h>
 
 #include "services/database/Artist.hpp"
@@ -32,7 +39,9 @@
 #include "services/database/Session.hpp"
 #include "services/database/Track.hpp"
 #include "services/database/TrackList.hpp"
+#include "utils/Crc32Calculator.hpp"
 #include "explore/Filters.hpp"
+#include "explore/ListEntryModelCache.hpp"
 #include "LmsApplication.hpp"
 
 namespace UserInterface::Utils
@@ -63,6 +72,52 @@ namespace UserInterface::Utils
     }
 
 
+    namespace
+    {
+        std::optional<std::uint32_t> computeFileCrc32(const std::filesystem::path& path)
+        {
+            std::ifstream file{ path, std::ios::binary };
+            if (!file)
+                return std::nullopt;
+
+            ::Utils::Crc32Calculator crc;
+            std::array<char, 4096> buffer;
+            while (file.read(buffer.data(), buffer.size()) || file.gcount() > 0)
+                crc.processBytes(reinterpret_cast<const std::byte*>(buffer.data()), static_cast<std::size_t>(file.gcount()));
+
+            return crc.getResult();
+        }
+    }
+
+    std::string getVersionedAssetUrl(const std::string& assetPath)
+    {
+        // Assets do not change while the server runs: fingerprint each one once per process
+        static std::mutex mutex;
+        static std::unordered_map<std::string, std::string> versionedUrls;
+
+        const std::scoped_lock lock{ mutex };
+
+        auto it{ versionedUrls.find(assetPath) };
+        if (it == std::cend(versionedUrls))
+        {
+            std::string versionedUrl{ assetPath };
+
+            if (const Wt::WApplication* app{ Wt::WApplication::instance() })
+            {
+                if (const std::optional<std::uint32_t> crc{ computeFileCrc32(std::filesystem::path{ app->docRoot() } / assetPath) })
+                {
+                    std::ostringstream oss;
+                    oss << assetPath << "?v=" << std::hex << std::setfill('0') << std::setw(8) << *crc;
+                    versionedUrl = oss.str();
+                }
+            }
+
+            it = versionedUrls.emplace(assetPath, std::move(versionedUrl)).first;
+        }
+
+        return it->second;
+    }
+
     std::unique_ptr<Wt::WImage> createCover(Database::ReleaseId releaseId, CoverResource::Size size)
     {
         auto cover{ std::make_unique<Wt::WImage>() };
@@ -116,21 +171,53 @@ namespace UserInterface::Utils
         return res;
     }
 
+    namespace
+    {
+        std::unique_ptr<Wt::WAnchor> createAnchor(const std::string& linkPath, const std::string& name, bool setText)
+        {
+            auto res = std::make_unique<Wt::WAnchor>(Wt::WLink{ Wt::LinkType::InternalPath, linkPath });
+
+            if (setText)
+            {
+                res->setTextFormat(Wt::TextFormat::Plain);
+                res->setText(Wt::WString::fromUTF8(name));
+                res->setToolTip(Wt::WString::fromUTF8(name), Wt::TextFormat::Plain);
+            }
+
+            return res;
+        }
+
+        std::vector<ArtistAnchorModel> createArtistAnchorModels(const std::vector<Database::ArtistId>& artistIds)
+        {
+            using namespace Database;
+
+            std::vector<ArtistAnchorModel> res;
+            res.reserve(artistIds.size());
+
+            auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
+            for (const ArtistId artistId : artistIds)
+            {
+                if (const Artist::pointer artist{ Artist::find(LmsApp->getDbSession(), artistId) })
+                    res.push_back(createArtistAnchorModel(artist));
+            }
+
+            return res;
+        }
+    }
+
     std::unique_ptr<Wt::WContainerWidget> createArtistAnchorList(const std::vector<Database::ArtistId>& artistIds, std::string_view cssAnchorClass)
     {
-        using namespace Database;
+        return createArtistAnchorList(createArtistAnchorModels(artistIds), cssAnchorClass);
+    }
 
+    std::unique_ptr<Wt::WContainerWidget> createArtistAnchorList(const std::vector<ArtistAnchorModel>& artists, std::string_view cssAnchorClass)
+    {
         std::unique_ptr<Wt::WContainerWidget> artistContainer{ std::make_unique<Wt::WContainerWidget>() };
 
         bool firstArtist{ true };
 
-        auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
-        for (const ArtistId artistId : artistIds)
+        for (const ArtistAnchorModel& artist : artists)
         {
-            const Artist::pointer artist{ Artist::find(LmsApp->getDbSession(), artistId) };
-            if (!artist)
-                continue;
-
             if (!firstArtist)
                 artistContainer->addNew<Wt::WText>(" · ");
 
@@ -146,22 +233,24 @@ namespace UserInterface::Utils
 
     std::unique_ptr<Wt::WContainerWidget> createArtistDisplayNameWithAnchors(std::string_view displayName, const std::vector<Database::ArtistId>& artistIds, std::string_view cssAnchorClass)
     {
-        using namespace Database;
+        const std::vector<ArtistAnchorModel> artists{ createArtistAnchorModels(artistIds) };
+        if (artists.size() != artistIds.size())
+            return createArtistAnchorList(artists, cssAnchorClass);
 
+        return createArtistDisplayNameWithAnchors(displayName, artists, cssAnchorClass);
+    }
+
+    std::unique_ptr<Wt::WContainerWidget> createArtistDisplayNameWithAnchors(std::string_view displayName, const std::vector<ArtistAnchorModel>& artists, std::string_view cssAnchorClass)
+    {
         std::size_t matchCount{};
         std::string_view::size_type currentOffset{};
 
         auto result{ std::make_unique<Wt::WContainerWidget>() };
-        auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
 
         // consider order is guaranteed + we will likely succeed
-        for (const ArtistId artistId : artistIds)
+        for (const ArtistAnchorModel& artist : artists)
         {
-            const Artist::pointer artist{ Artist::find(LmsApp->getDbSession(), artistId) };
-            if (!artist)
-                break;
-
-            const auto pos{ displayName.find(artist->getName(), currentOffset) };
+            const auto pos{ displayName.find(artist.name, currentOffset) };
             if (pos == std::string_view::npos)
                 break;
 
@@ -173,12 +262,12 @@ namespace UserInterface::Utils
             anchor->addStyleClass("text-decoration-none"); // hack
             anchor->addStyleClass(std::string{ cssAnchorClass }); // hack
             result->addWidget(std::move(anchor));
-            currentOffset = pos + artist->getName().size();
+            currentOffset = pos + artist.name.size();
             matchCount += 1;
         }
 
-        if (matchCount != artistIds.size())
-            return createArtistAnchorList(artistIds, cssAnchorClass);
+        if (matchCount != artists.size())
+            return createArtistAnchorList(artists, cssAnchorClass);
 
         return result;
     }
@@ -219,48 +308,68 @@ namespace UserInterface::Utils
         return {};
     }
 
-    Wt::WLink createArtistLink(Database::Artist::pointer artist)
+    std::unique_ptr<Wt::WContainerWidget> createArtistsAnchorsForRelease(const ReleaseListEntryModel& release, Database::ArtistId omitIfMatchThisArtist, std::string_view cssAnchorClass)
+    {
+        if (release.variousArtists)
+        {
+            auto res{ std::make_unique<Wt::WContainerWidget>() };
+            res->addNew<Wt::WText>(Wt::WString::tr("Lms.Explore.various-artists"));
+            return res;
+        }
+
+        if (release.artists.empty() || (release.artists.size() == 1 && release.artists.front().id == omitIfMatchThisArtist))
+            return {};
+
+        if (!release.artistDisplayName.empty())
+            return createArtistDisplayNameWithAnchors(release.artistDisplayName, release.artists, cssAnchorClass);
+
+        return createArtistAnchorList(release.artists, cssAnchorClass);
+    }
+
+    std::string getArtistLinkPath(Database::Artist::pointer artist)
     {
         if (const auto mbid{ artist->getMBID() })
-            return Wt::WLink{ Wt::LinkType::InternalPath, "/artist/mbid/" + std::string {mbid->getAsString()} };
+            return "/artist/mbid/" + std::string{ mbid->getAsString() };
         else
-            return Wt::WLink{ Wt::LinkType::InternalPath, "/artist/" + artist->getId().toString() };
+            return "/artist/" + artist->getId().toString();
     }
 
-    std::unique_ptr<Wt::WAnchor> createArtistAnchor(Database::Artist::pointer artist, bool setText)
+    Wt::WLink createArtistLink(Database::Artist::pointer artist)
     {
-        auto res = std::make_unique<Wt::WAnchor>(createArtistLink(artist));
+        return Wt::WLink{ Wt::LinkType::InternalPath, getArtistLinkPath(artist) };
+    }
 
-        if (setText)
-        {
-            res->setTextFormat(Wt::TextFormat::Plain);
-            res->setText(Wt::WString::fromUTF8(artist->getName()));
-            res->setToolTip(Wt::WString::fromUTF8(artist->getName()), Wt::TextFormat::Plain);
-        }
+    std::unique_ptr<Wt::WAnchor> createArtistAnchor(Database::Artist::pointer artist, bool setText)
+    {
+        return createAnchor(getArtistLinkPath(artist), artist->getName(), setText);
+    }
 
-        return res;
+    std::unique_ptr<Wt::WAnchor> createArtistAnchor(const ArtistAnchorModel& artist, bool setText)
+    {
+        return createAnchor(artist.linkPath, artist.name, setText);
     }
 
-    Wt::WLink createReleaseLink(Database::Release::pointer release)
+    std::string getReleaseLinkPath(Database::Release::pointer release)
     {
         if (const auto mbid{ release->getMBID() })
-            return Wt::WLink{ Wt::LinkType::InternalPath, "/release/mbid/" + std::string {mbid->getAsString()} };
+            return "/release/mbid/" + std::string{ mbid->getAsString() };
         else
-            return Wt::WLink{ Wt::LinkType::InternalPath, "/release/" + release->getId().toString() };
+            return "/release/" + release->getId().toString();
     }
 
-    std::unique_ptr<Wt::WAnchor> createReleaseAnchor(Database::Release::pointer release, bool setText)
+    Wt::WLink createReleaseLink(Database::Release::pointer release)
     {
-        auto res = std::make_unique<Wt::WAnchor>(createReleaseLink(release));
+        return Wt::WLink{ Wt::LinkType::InternalPath, getReleaseLinkPath(release) };
+    }
 
-        if (setText)
-        {
-            res->setTextFormat(Wt::TextFormat::Plain);
-            res->setText(Wt::WString::fromUTF8(release->getName()));
-            res->setToolTip(Wt::WString::fromUTF8(release->getName()), Wt::TextFormat::Plain);
-        }
+    std::unique_ptr<Wt::WAnchor> createReleaseAnchor(Database::Release::pointer release, bool setText)
+    {
+        return createAnchor(getReleaseLinkPath(release), release->getName(), setText);
+    }
 
-        return res;
+    std::unique_ptr<Wt::WAnchor> createReleaseAnchor(const ReleaseAnchorModel& release, bool setText)
+    {
+        return createAnchor(release.linkPath, release.name, setText);
     }
 
     std::unique_ptr<Wt::WAnchor> createTrackListAnchor(Database::TrackList::pointer trackList, bool setText)
@@ -47,12 +47,19 @@ namespace Database
 namespace UserInterface
 {
 	class Filters;
+	struct ArtistAnchorModel;
+	struct ReleaseAnchorModel;
+	struct ReleaseListEntryModel;
 }
 
 namespace UserInterface::Utils
 {
 	std::string durationToString(std::chrono::milliseconds msDuration);
 
+	// Returns the docroot relative path with a query string derived from the file contents,
+	// so that the asset can be cached indefinitely by browsers
+	std::string getVersionedAssetUrl(const std::string& assetPath);
+
 	std::unique_ptr<Wt::WImage> createCover(Database::ReleaseId releaseId, CoverResource::Size size);
 	std::unique_ptr<Wt::WImage> createCover(Database::TrackId trackId, CoverResource::Size size);
 
@@ -61,11 +68,18 @@ namespace UserInterface::Utils
 	std::unique_ptr<Wt::WContainerWidget> createArtistAnchorList(const std::vector<Database::ArtistId>& artistIds, std::string_view cssAnchorClass = "link-success");
 	std::unique_ptr<Wt::WContainerWidget> createArtistDisplayNameWithAnchors(std::string_view displayName, const std::vector<Database::ArtistId>& artistIds, std::string_view cssAnchorClass = "link-success");
 	std::unique_ptr<Wt::WContainerWidget> createArtistsAnchorsForRelease(Database::ObjectPtr<Database::Release> release, Database::ArtistId omitIfMatchThisArtist = {}, std::string_view cssAnchorClass = "link-success");
+	std::unique_ptr<Wt::WContainerWidget> createArtistAnchorList(const std::vector<ArtistAnchorModel>& artists, std::string_view cssAnchorClass = "link-success");
+	std::unique_ptr<Wt::WContainerWidget> createArtistDisplayNameWithAnchors(std::string_view displayName, const std::vector<ArtistAnchorModel>& artists, std::string_view cssAnchorClass = "link-success");
+	std::unique_ptr<Wt::WContainerWidget> createArtistsAnchorsForRelease(const ReleaseListEntryModel& release, Database::ArtistId omitIfMatchThisArtist = {}, std::string_view cssAnchorClass = "link-success");
 
+	std::string getArtistLinkPath(Database::ObjectPtr<Database::Artist> artist);
 	Wt::WLink createArtistLink(Database::ObjectPtr<Database::Artist> artist);
 	std::unique_ptr<Wt::WAnchor> createArtistAnchor(Database::ObjectPtr<Database::Artist> artist, bool setText = true);
+	std::unique_ptr<Wt::WAnchor> createArtistAnchor(const ArtistAnchorModel& artist, bool setText = true);
+	std::string getReleaseLinkPath(Database::ObjectPtr<Database::Release> release);
 	Wt::WLink createReleaseLink(Database::ObjectPtr<Database::Release> release);
 	std::unique_ptr<Wt::WAnchor> createReleaseAnchor(Database::ObjectPtr<Database::Release> release, bool setText = true);
+	std::unique_ptr<Wt::WAnchor> createReleaseAnchor(const ReleaseAnchorModel& release, bool setText = true);
 	std::unique_ptr<Wt::WAnchor> createTrackListAnchor(Database::ObjectPtr<Database::TrackList> trackList, bool setText = true);
 
 	std::unique_ptr<Wt::WContainerWidget> createClustersForTrack(Database::ObjectPtr<Database::Track> track, Filters& filters);
@@ -38,6 +38,8 @@
 #include "common/DirectoryValidator.hpp"
 #include "common/MandatoryValidator.hpp"
 #include "common/ValueStringModel.hpp"
+#include "IndexAdvisorStatus.hpp"
+#include "MemoryStatus.hpp"
 #include "ScannerController.hpp"
 #include "LmsApplication.hpp"
 
@@ -224,6 +226,8 @@ DatabaseSettingsView::refreshView()
 	Wt::WPushButton *immScanBtn = t->bindWidget("immediate-scan-btn", std::make_unique<Wt::WPushButton>(Wt::WString::tr("Lms.Admin.Database.immediate-scan")));
 
 	t->bindNew<ScannerController>("scanner-controller");
+	t->bindNew<MemoryStatus>("memory-status");
+	t->bindNew<IndexAdvisorStatus>("index-advisor-status");
 
 	saveBtn->clicked().connect([=]
 	{
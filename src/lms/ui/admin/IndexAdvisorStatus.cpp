@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "IndexAdvisorStatus.hpp"
+
+#include <sstream>
+
+#include "services/database/IndexAdvisor.hpp"
+#include "services/database/QueryProfiler.hpp"
+#include "utils/Exception.hpp"
+#include "utils/IConfig.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Service.hpp"
+
+#include "LmsApplication.hpp"
+
+namespace UserInterface {
+
+IndexAdvisorStatus::IndexAdvisorStatus()
+: WTemplate {Wt::WString::tr("Lms.Admin.IndexAdvisorStatus.template")}
+{
+	addFunction("tr", &Wt::WTemplate::Functions::tr);
+	addFunction("id", &Wt::WTemplate::Functions::id);
+
+	_summary = bindNew<Wt::WLineEdit>("summary");
+	_summary->setReadOnly(true);
+
+	_report = bindNew<Wt::WTextArea>("report");
+	_report->setReadOnly(true);
+	_report->setRows(12);
+
+	Wt::WPushButton* analyzeBtn {bindNew<Wt::WPushButton>("analyze-btn", Wt::WString::tr("Lms.Admin.IndexAdvisorStatus.analyze"))};
+	analyzeBtn->clicked().connect(this, [this] { analyze(); });
+
+	_createBtn = bindNew<Wt::WPushButton>("create-btn", Wt::WString::tr("Lms.Admin.IndexAdvisorStatus.create-indexes"));
+	_createBtn->clicked().connect(this, [this] { createIndexes(); });
+	_createBtn->setHidden(true);
+
+	if (!Database::QueryProfiler::isEnabled())
+	{
+		_summary->setText(Wt::WString::tr("Lms.Admin.IndexAdvisorStatus.profiling-disabled"));
+		analyzeBtn->setDisabled(true);
+	}
+}
+
+void
+IndexAdvisorStatus::analyze()
+{
+	Database::IndexAdvisor::Report report;
+	try
+	{
+		// only the plans are computed, cheap enough to be done right away
+		report = Database::IndexAdvisor::analyze(LmsApp->getDb());
+	}
+	catch (const LmsException& e)
+	{
+		LMS_LOG(UI, ERROR) << "Cannot analyze queries: " << e.what();
+		_summary->setText(Wt::WString::tr("Lms.Admin.IndexAdvisorStatus.analyze-failed"));
+		return;
+	}
+
+	std::ostringstream oss;
+	Database::IndexAdvisor::dump(report, oss);
+
+	_summary->setText(Wt::WString::tr("Lms.Admin.IndexAdvisorStatus.summary")
+			.arg(report.analyzedQueryCount)
+			.arg(report.queries.size())
+			.arg(report.proposedIndexes.size()));
+	_report->setText(oss.str());
+
+	_proposedIndexes = std::move(report.proposedIndexes);
+	_createBtn->setHidden(_proposedIndexes.empty() || !Service<IConfig>::get()->getBool("db-index-advisor-create-indexes", false));
+}
+
+void
+IndexAdvisorStatus::createIndexes()
+{
+	// may take a while on large tables, the database is locked meanwhile
+	const std::size_t createdCount {Database::IndexAdvisor::createIndexes(LmsApp->getDbSession(), _proposedIndexes)};
+	LmsApp->notifyMsg(Notification::Type::Info, Wt::WString::tr("Lms.Admin.IndexAdvisorStatus.index-advisor"), Wt::WString::tr("Lms.Admin.IndexAdvisorStatus.indexes-created").arg(createdCount));
+
+	analyze();
+}
+
+} // namespace UserInterface
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <Wt/WLineEdit.h>
+#include <Wt/WPushButton.h>
+#include <Wt/WTemplate.h>
+#include <Wt/WTextArea.h>
+
+namespace UserInterface
+{
+	// Plans of the profiled query shapes, and the indexes that would avoid their full scans and sorts
+	// The proposed indexes can only be created if "db-index-advisor-create-indexes" is set
+	class IndexAdvisorStatus : public Wt::WTemplate
+	{
+		public:
+			IndexAdvisorStatus();
+
+		private:
+			void analyze();
+			void createIndexes();
+
+			Wt::WLineEdit*				_summary;
+			Wt::WTextArea*				_report;
+			Wt::WPushButton*			_createBtn;
+			std::vector<std::string>	_proposedIndexes;
+	};
+} // namespace UserInterface
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MemoryStatus.hpp"
+
+#include <iomanip>
+#include <sstream>
+
+#include <Wt/WPushButton.h>
+
+#include "utils/AllocatorStats.hpp"
+
+namespace UserInterface {
+
+static
+std::string
+sizeToString(std::optional<std::size_t> size)
+{
+	if (!size)
+		return "?";
+
+	std::ostringstream oss;
+	oss << std::fixed << std::setprecision(1) << *size / (1024. * 1024.) << " MiB";
+
+	return oss.str();
+}
+
+MemoryStatus::MemoryStatus()
+: WTemplate {Wt::WString::tr("Lms.Admin.MemoryStatus.template")}
+{
+	addFunction("tr", &Wt::WTemplate::Functions::tr);
+	addFunction("id", &Wt::WTemplate::Functions::id);
+
+	_allocator = bindNew<Wt::WLineEdit>("allocator");
+	_allocator->setReadOnly(true);
+
+	_resident = bindNew<Wt::WLineEdit>("resident");
+	_resident->setReadOnly(true);
+
+	_allocated = bindNew<Wt::WLineEdit>("allocated");
+	_allocated->setReadOnly(true);
+
+	_arenas = bindNew<Wt::WLineEdit>("arenas");
+	_arenas->setReadOnly(true);
+
+	Wt::WPushButton* refreshBtn {bindNew<Wt::WPushButton>("refresh-btn", Wt::WString::tr("Lms.Admin.MemoryStatus.refresh"))};
+	refreshBtn->clicked().connect(this, [this] { refreshContents(); });
+
+	refreshContents();
+}
+
+void
+MemoryStatus::refreshContents()
+{
+	const AllocatorStats::Stats stats {AllocatorStats::getStats()};
+
+	_allocator->setText(std::string {AllocatorStats::getAllocatorName()});
+
+	_resident->setText(Wt::WString::tr("Lms.Admin.MemoryStatus.resident-status")
+			.arg(sizeToString(AllocatorStats::getProcessResidentSize()))
+			.arg(sizeToString(stats.resident))
+			.arg(sizeToString(stats.mapped)));
+
+	if (const std::optional<double> fragmentation {AllocatorStats::getFragmentation(stats)})
+		_allocated->setText(Wt::WString::tr("Lms.Admin.MemoryStatus.allocated-status")
+				.arg(sizeToString(stats.allocated))
+				.arg(sizeToString(stats.active))
+				.arg(static_cast<int>(*fragmentation * 100)));
+	else
+		_allocated->setText(Wt::WString::tr("Lms.Admin.ScannerController.last-scan-not-available"));
+
+	if (!stats.arenas.empty())
+	{
+		std::ostringstream oss;
+		bool first {true};
+		for (const AllocatorStats::ArenaStats& arena : stats.arenas)
+		{
+			if (!first)
+				oss << ", ";
+			first = false;
+			oss << "#" << arena.index << ": " << sizeToString(arena.allocated) << " / " << sizeToString(arena.active);
+		}
+		_arenas->setText(Wt::WString::tr("Lms.Admin.MemoryStatus.arenas-status").arg(stats.arenas.size()).arg(oss.str()));
+	}
+	else
+		_arenas->setText(Wt::WString::tr("Lms.Admin.ScannerController.last-scan-not-available"));
+}
+
+} // namespace UserInterface
@@ -26,6 +26,7 @@
 #include <Wt/WPushButton.h>
 #include <Wt/WResource.h>
 
+#include "services/database/Backup.hpp"
 #include "services/database/Session.hpp"
 #include "services/database/Track.hpp"
 #include "services/scanner/IScannerService.hpp"
@@ -51,6 +52,38 @@ durationToString(const Wt::WDateTime& begin, const Wt::WDateTime& end)
 	return oss.str();
 }
 
+static
+std::string
+durationToMsString(std::chrono::microseconds duration)
+{
+	std::ostringstream oss;
+	oss << std::fixed << std::setprecision(1) << duration.count() / 1000.f;
+
+	return oss.str();
+}
+
+static
+std::string
+stepToString(Scanner::ScanStep step)
+{
+	switch (step)
+	{
+		case Scanner::ScanStep::DiscoveringFiles: return "Discovering files";
+		case Scanner::ScanStep::ScanningFiles: return "Scanning files";
+		case Scanner::ScanStep::ChekingForMissingFiles: return "Checking for missing files";
+		case Scanner::ScanStep::CheckingForDuplicateFiles: return "Checking for duplicate files";
+		case Scanner::ScanStep::FetchingTrackFeatures: return "Fetching track features";
+		case Scanner::ScanStep::ReloadingSimilarityEngine: return "Reloading similarity engine";
+		case Scanner::ScanStep::ComputeClusterStats: return "Computing cluster stats";
+		case Scanner::ScanStep::GeneratingCovers: return "Generating covers";
+		case Scanner::ScanStep::RefiningAudioProperties: return "Refining audio properties";
+		case Scanner::ScanStep::ExtractingTrackFeatures: return "Extracting track features";
+		case Scanner::ScanStep::ComputingSeekTables: return "Computing seek tables";
+		case Scanner::ScanStep::SyncingTranscodeMirror: return "Syncing transcode mirror";
+	}
+	return "?";
+}
+
 
 class ReportResource : public Wt::WResource
 {
@@ -78,9 +111,16 @@ class ReportResource : public Wt::WResource
 			if (!_stats)
 				return;
 
-			response.out() << Wt::WString::tr("Lms.Admin.ScannerController.errors-header").arg(_stats->errors.size()).toUTF8() << std::endl;
+			response.out() << Wt::WString::tr("Lms.Admin.ScannerController.errors-header").arg(_stats->errors.getCount()).toUTF8() << std::endl;
 
-			for (const auto& error : _stats->errors)
+			for (std::size_t i {}; i < Scanner::ScanErrorTypeCount; ++i)
+			{
+				const Scanner::ScanErrorType errorType {static_cast<Scanner::ScanErrorType>(i)};
+				if (const std::size_t count {_stats->errors.getCount(errorType)})
+					response.out() << errorTypeToWString(errorType).toUTF8() << ": " << count << std::endl;
+			}
+
+			for (const auto& error : _stats->errors.getSamples())
 			{
 				response.out() << error.file.string() << " - " << errorTypeToWString(error.error).toUTF8();
 				if (!error.systemError.empty())
@@ -88,6 +128,9 @@ class ReportResource : public Wt::WResource
 				response.out() << std::endl;
 			}
 
+			if (_stats->errors.getSamples().size() < _stats->errors.getCount())
+				response.out() << Wt::WString::tr("Lms.Admin.ScannerController.errors-not-listed").arg(_stats->errors.getCount() - _stats->errors.getSamples().size()).toUTF8() << std::endl;
+
 			response.out() << std::endl;
 
 			response.out() << Wt::WString::tr("Lms.Admin.ScannerController.duplicates-header").arg(_stats->duplicates.size()).toUTF8() << std::endl;
@@ -108,10 +151,37 @@ class ReportResource : public Wt::WResource
 					response.out() << " - " << duplicateReasonToWString(duplicate.reason).toUTF8() << '\n';
 				}
 			}
+
+			response.out() << std::endl;
+
+			response.out() << Wt::WString::tr("Lms.Admin.ScannerController.perf-header").toUTF8() << std::endl;
+			for (const Scanner::ScanStepPerf& stepPerf : _stats->stepPerfs)
+				response.out() << stepToString(stepPerf.step) << ": " << stepPerf.duration.count() << " ms, " << stepPerf.processedElems << " elements (" << stepPerf.getElemsPerSecond() << "/s)" << std::endl;
+
+			writeHistogram(response, "Parse", _stats->parseDurations);
+			writeHistogram(response, "Write", _stats->writeDurations);
+			writeHistogram(response, "Commit", _stats->commitDurations);
 		}
 
 	private:
 
+		static void writeHistogram(Wt::Http::Response& response, std::string_view name, const Scanner::DurationHistogram& histogram)
+		{
+			response.out() << std::endl << name << ": " << histogram.count << " samples, mean = " << durationToMsString(histogram.getMean()) << " ms, max = " << durationToMsString(histogram.max) << " ms" << std::endl;
+
+			for (std::size_t bucket {}; bucket < Scanner::DurationHistogram::bucketCount; ++bucket)
+			{
+				if (histogram.buckets[bucket] == 0)
+					continue;
+
+				if (bucket == Scanner::DurationHistogram::bucketCount - 1)
+					response.out() << "  >= ";
+				else
+					response.out() << "  < ";
+				response.out() << durationToMsString(std::chrono::microseconds {1 << (bucket == Scanner::DurationHistogram::bucketCount - 1 ? bucket - 1 : bucket)}) << " ms: " << histogram.buckets[bucket] << std::endl;
+			}
+		}
+
 		static Wt::WString errorTypeToWString(Scanner::ScanErrorType error)
 		{
 			switch (error)
@@ -170,44 +240,117 @@ ScannerController::ScannerController()
 		Service<Scanner::IScannerService>::get()->requestImmediateScan(true);
 	});
 
+	Wt::WLineEdit* scanPath {bindNew<Wt::WLineEdit>("scan-path")};
+	scanPath->setPlaceholderText(Wt::WString::tr("Lms.Admin.ScannerController.scan-path-placeholder"));
+	Wt::WPushButton* scanPathBtn {bindNew<Wt::WPushButton>("scan-path-btn", Wt::WString::tr("Lms.Admin.ScannerController.scan-path-now"))};
+	scanPathBtn->clicked().connect([scanPath]
+	{
+		const std::string path {scanPath->text().toUTF8()};
+		if (path.empty())
+			return;
+
+		Service<Scanner::IScannerService>::get()->requestImmediatePartialScan({path}, false);
+		scanPath->setText("");
+	});
+
 	_lastScanStatus = bindNew<Wt::WLineEdit>("last-scan");
 	_lastScanStatus->setReadOnly(true);
 
+	_lastScanPerf = bindNew<Wt::WLineEdit>("last-scan-perf");
+	_lastScanPerf->setReadOnly(true);
+
 	_status = bindNew<Wt::WLineEdit>("status");
 	_status->setReadOnly(true);
 
 	_stepStatus = bindNew<Wt::WLineEdit>("step-status");
 	_stepStatus->setReadOnly(true);
 
-	auto onDbEvent {[&]() { refreshContents(); }};
+	_backupStatus = bindNew<Wt::WLineEdit>("backup");
+	_backupStatus->setReadOnly(true);
+
+	_backupRefreshTimer = addChild(std::make_unique<Wt::WTimer>());
+	_backupRefreshTimer->setInterval(std::chrono::seconds {2});
+	_backupRefreshTimer->timeout().connect(this, [this] { refreshBackupStatus(); });
+
+	Wt::WPushButton* backupBtn {bindNew<Wt::WPushButton>("backup-btn", Wt::WString::tr("Lms.Admin.ScannerController.backup-now"))};
+	backupBtn->clicked().connect([this]
+	{
+		Service<Database::BackupService>::get()->requestBackup();
+		LmsApp->notifyMsg(Notification::Type::Info, Wt::WString::tr("Lms.Admin.Database.database"), Wt::WString::tr("Lms.Admin.Database.backup-launched"));
+		_backupRefreshTimer->start();
+	});
+	refreshBackupStatus();
 
 	LmsApp->getScannerEvents().scanStarted.connect(this, []
 	{
 		LmsApp->notifyMsg(Notification::Type::Info, Wt::WString::tr("Lms.Admin.Database.database"), Wt::WString::tr("Lms.Admin.Database.scan-launched"));
 	});
-	LmsApp->getScannerEvents().scanComplete.connect(this, onDbEvent);
-	LmsApp->getScannerEvents().scanInProgress.connect(this, onDbEvent);
-	LmsApp->getScannerEvents().scanScheduled.connect(this, onDbEvent);
 
-	refreshContents();
+	// status shared with the other admin sessions, fetched once per scanner event
+	ScannerStatusBroadcaster& statusBroadcaster {*Service<ScannerStatusBroadcaster>::get()};
+	_statusSubscription = statusBroadcaster.subscribe([this](const IScannerService::Status& status) { refreshContents(status); });
+
+	refreshContents(*statusBroadcaster.getStatus());
+}
+
+ScannerController::~ScannerController()
+{
+	Service<ScannerStatusBroadcaster>::get()->unsubscribe(_statusSubscription);
+}
+
+void
+ScannerController::refreshBackupStatus()
+{
+	const Database::BackupService::Status status {Service<Database::BackupService>::get()->getStatus()};
+
+	if (status.inProgress)
+	{
+		_backupStatus->setText(Wt::WString::tr("Lms.Admin.ScannerController.backup-in-progress")
+				.arg(status.totalPageCount ? static_cast<int>(status.copiedPageCount * 100 / status.totalPageCount) : 0));
+		_backupRefreshTimer->start();
+		return;
+	}
+
+	_backupRefreshTimer->stop();
+
+	if (!status.lastBackupTime)
+		_backupStatus->setText(Wt::WString::tr("Lms.Admin.ScannerController.last-scan-not-available"));
+	else if (!status.lastError.empty())
+		_backupStatus->setText(Wt::WString::tr("Lms.Admin.ScannerController.backup-failed")
+				.arg(Wt::WDateTime::fromTime_t(std::chrono::system_clock::to_time_t(*status.lastBackupTime)).toString())
+				.arg(status.lastError));
+	else
+		_backupStatus->setText(Wt::WString::tr("Lms.Admin.ScannerController.backup-status")
+				.arg(durationToMsString(status.lastBackupDuration))
+				.arg(Wt::WDateTime::fromTime_t(std::chrono::system_clock::to_time_t(*status.lastBackupTime)).toString())
+				.arg(status.lastBackupPath.string()));
 }
 
 void
-ScannerController::refreshContents()
+ScannerController::refreshContents(const Scanner::IScannerService::Status& status)
 {
 	using namespace Scanner;
 
-	const IScannerService::Status status {Service<IScannerService>::get()->getStatus()};
 	if (status.lastCompleteScanStats)
 	{
 		_lastScanStatus->setText(Wt::WString::tr("Lms.Admin.ScannerController.last-scan-status")
 				.arg(status.lastCompleteScanStats->nbFiles())
 				.arg(durationToString(status.lastCompleteScanStats->startTime, status.lastCompleteScanStats->stopTime))
 				.arg(status.lastCompleteScanStats->stopTime.toString())
-				.arg(status.lastCompleteScanStats->errors.size())
+				.arg(status.lastCompleteScanStats->errors.getCount())
 				.arg(status.lastCompleteScanStats->duplicates.size())
 			  );
 
+		_lastScanPerf->setText(Wt::WString::tr("Lms.Admin.ScannerController.last-scan-perf-status")
+				.arg(static_cast<int>(status.lastCompleteScanStats->getScannedFilesPerSecond()))
+				.arg(durationToMsString(status.lastCompleteScanStats->parseDurations.getMean()))
+				.arg(durationToMsString(status.lastCompleteScanStats->parseDurations.getPercentile(95)))
+				.arg(durationToMsString(status.lastCompleteScanStats->writeDurations.getMean()))
+				.arg(durationToMsString(status.lastCompleteScanStats->writeDurations.getPercentile(95)))
+				.arg(durationToMsString(status.lastCompleteScanStats->commitDurations.getMean()))
+				.arg(durationToMsString(status.lastCompleteScanStats->commitDurations.getPercentile(95)))
+			  );
+
 		_reportResource->setScanStats(*status.lastCompleteScanStats);
 		_reportBtn->setEnabled(true);
 
@@ -215,6 +358,7 @@ ScannerController::refreshContents()
 	else
 	{
 		_lastScanStatus->setText(Wt::WString::tr("Lms.Admin.ScannerController.last-scan-not-available"));
+		_lastScanPerf->setText(Wt::WString::tr("Lms.Admin.ScannerController.last-scan-not-available"));
 		_reportBtn->setEnabled(false);
 	}
 
@@ -274,6 +418,41 @@ ScannerController::refreshContents()
 					case Scanner::ScanStep::ComputeClusterStats:
 					_stepStatus->setText(Wt::WString::tr("Lms.Admin.ScannerController.step-compute-cluster-stats")
 						.arg(status.currentScanStepStats->progress()));
+					break;
+
+				case Scanner::ScanStep::GeneratingCovers:
+					_stepStatus->setText(Wt::WString::tr("Lms.Admin.ScannerController.step-generating-covers")
+						.arg(status.currentScanStepStats->processedElems)
+						.arg(status.currentScanStepStats->totalElems)
+						.arg(status.currentScanStepStats->progress()));
+					break;
+
+				case Scanner::ScanStep::RefiningAudioProperties:
+					_stepStatus->setText(Wt::WString::tr("Lms.Admin.ScannerController.step-refining-audio-properties")
+						.arg(status.currentScanStepStats->processedElems)
+						.arg(status.currentScanStepStats->totalElems)
+						.arg(status.currentScanStepStats->progress()));
+					break;
+
+				case Scanner::ScanStep::ExtractingTrackFeatures:
+					_stepStatus->setText(Wt::WString::tr("Lms.Admin.ScannerController.step-extracting-track-features")
+						.arg(status.currentScanStepStats->processedElems)
+						.arg(status.currentScanStepStats->totalElems)
+						.arg(status.currentScanStepStats->progress()));
+					break;
+
+				case Scanner::ScanStep::ComputingSeekTables:
+					_stepStatus->setText(Wt::WString::tr("Lms.Admin.ScannerController.step-computing-seek-tables")
+						.arg(status.currentScanStepStats->processedElems)
+						.arg(status.currentScanStepStats->totalElems)
+						.arg(status.currentScanStepStats->progress()));
+					break;
+
+				case Scanner::ScanStep::SyncingTranscodeMirror:
+					_stepStatus->setText(Wt::WString::tr("Lms.Admin.ScannerController.step-syncing-transcode-mirror")
+						.arg(status.currentScanStepStats->processedElems)
+						.arg(status.currentScanStepStats->totalElems)
+						.arg(status.currentScanStepStats->progress()));
 			}
 			break;
 	}
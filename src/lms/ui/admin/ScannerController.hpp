@@ -21,8 +21,12 @@
 
 #include <Wt/WPushButton.h>
 #include <Wt/WTemplate.h>
+#include <Wt/WTimer.h>
 #include <Wt/WLineEdit.h>
 
+#include "services/scanner/IScannerService.hpp"
+#include "ScannerStatusBroadcaster.hpp"
+
 namespace UserInterface
 {
 
@@ -30,15 +34,21 @@ namespace UserInterface
 	{
 		public:
 			ScannerController();
+			~ScannerController();
 
 		private:
-			void refreshContents();
+			void refreshContents(const Scanner::IScannerService::Status& status);
+			void refreshBackupStatus();
 
 			Wt::WPushButton*	_reportBtn;
 			Wt::WLineEdit*		_lastScanStatus;
+			Wt::WLineEdit*		_lastScanPerf;
 			Wt::WLineEdit*		_status;
 			Wt::WLineEdit*		_stepStatus;
+			Wt::WLineEdit*		_backupStatus;
+			Wt::WTimer*			_backupRefreshTimer; // only while a backup is in progress
 			class ReportResource* _reportResource;
+			ScannerStatusBroadcaster::SubscriptionId _statusSubscription;
 	};
 
 } // namespace DatabaseStatus
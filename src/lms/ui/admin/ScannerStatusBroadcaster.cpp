@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ScannerStatusBroadcaster.hpp"
+
+#include <Wt/WApplication.h>
+#include <Wt/WServer.h>
+
+#include "LmsApplication.hpp"
+
+namespace UserInterface
+{
+	ScannerStatusBroadcaster::ScannerStatusBroadcaster(Scanner::IScannerService& scanner)
+		: _scanner {scanner}
+	{
+		Scanner::Events& events {_scanner.getEvents()};
+
+		_scannerConnections.push_back(events.scanStarted.connect([this] { onScannerEvent(); }));
+		_scannerConnections.push_back(events.scanComplete.connect([this](const Scanner::ScanStats&) { onScannerEvent(); }));
+		_scannerConnections.push_back(events.scanInProgress.connect([this](const Scanner::ScanStepStats&) { onScannerEvent(); }));
+		_scannerConnections.push_back(events.scanScheduled.connect([this](const Wt::WDateTime&) { onScannerEvent(); }));
+	}
+
+	ScannerStatusBroadcaster::~ScannerStatusBroadcaster()
+	{
+		for (Wt::Signals::connection& connection : _scannerConnections)
+			connection.disconnect();
+	}
+
+	ScannerStatusBroadcaster::SubscriptionId
+	ScannerStatusBroadcaster::subscribe(Callback callback)
+	{
+		std::scoped_lock lock {_mutex};
+
+		const SubscriptionId subscriptionId {_nextSubscriptionId++};
+		_subscriptions.emplace(subscriptionId, Subscription {Wt::WApplication::instance()->sessionId(), std::move(callback)});
+
+		return subscriptionId;
+	}
+
+	void
+	ScannerStatusBroadcaster::unsubscribe(SubscriptionId subscriptionId)
+	{
+		std::scoped_lock lock {_mutex};
+		_subscriptions.erase(subscriptionId);
+	}
+
+	std::shared_ptr<const ScannerStatusBroadcaster::Status>
+	ScannerStatusBroadcaster::getStatus()
+	{
+		{
+			std::scoped_lock lock {_mutex};
+			if (_status)
+				return _status;
+		}
+
+		auto status {std::make_shared<const Status>(_scanner.getStatus())};
+
+		std::scoped_lock lock {_mutex};
+		if (!_status)
+			_status = status;
+
+		return _status;
+	}
+
+	void
+	ScannerStatusBroadcaster::onScannerEvent()
+	{
+		auto status {std::make_shared<const Status>(_scanner.getStatus())};
+
+		std::vector<std::pair<SubscriptionId, std::string>> updatesToPost;
+		{
+			std::scoped_lock lock {_mutex};
+
+			_status = status;
+			for (auto& [subscriptionId, subscription] : _subscriptions)
+			{
+				// the pending update will pick the latest status
+				if (subscription.updatePending)
+					continue;
+
+				subscription.updatePending = true;
+				updatesToPost.emplace_back(subscriptionId, subscription.sessionId);
+			}
+		}
+
+		for (const auto& [subscriptionId, sessionId] : updatesToPost)
+		{
+			Wt::WServer::instance()->post(sessionId, [this, subscriptionId = subscriptionId]
+			{
+				processUpdate(subscriptionId);
+			});
+		}
+	}
+
+	void
+	ScannerStatusBroadcaster::processUpdate(SubscriptionId subscriptionId)
+	{
+		Callback callback;
+		std::shared_ptr<const Status> status;
+		{
+			std::scoped_lock lock {_mutex};
+
+			auto itSubscription {_subscriptions.find(subscriptionId)};
+			if (itSubscription == std::end(_subscriptions))
+				return;
+
+			itSubscription->second.updatePending = false;
+			callback = itSubscription->second.callback;
+			status = _status;
+		}
+
+		// may be nullptr, see https://redmine.webtoolkit.eu/issues/8202
+		if (!LmsApp)
+			return;
+
+		callback(*status);
+		LmsApp->triggerUpdate();
+	}
+} // namespace UserInterface
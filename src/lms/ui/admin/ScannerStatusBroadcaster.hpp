@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <Wt/WSignal.h>
+
+#include "services/scanner/IScannerService.hpp"
+
+namespace UserInterface
+{
+	// Fans out the scanner status to the subscribed sessions: the status is fetched once per scanner event,
+	// and the events received while a session has not processed its previous update yet are coalesced into it
+	class ScannerStatusBroadcaster
+	{
+		public:
+			using Status = Scanner::IScannerService::Status;
+			using SubscriptionId = std::size_t;
+			using Callback = std::function<void(const Status&)>;
+
+			ScannerStatusBroadcaster(Scanner::IScannerService& scanner);
+			~ScannerStatusBroadcaster();
+			ScannerStatusBroadcaster(const ScannerStatusBroadcaster&) = delete;
+			ScannerStatusBroadcaster& operator=(const ScannerStatusBroadcaster&) = delete;
+
+			// To be called from a session, the callback is then called within this session
+			SubscriptionId	subscribe(Callback callback);
+			void			unsubscribe(SubscriptionId subscriptionId);
+
+			std::shared_ptr<const Status> getStatus();
+
+		private:
+			void onScannerEvent();
+			void processUpdate(SubscriptionId subscriptionId);
+
+			struct Subscription
+			{
+				std::string	sessionId;
+				Callback	callback;
+				bool		updatePending {};
+			};
+
+			Scanner::IScannerService&		_scanner;
+			std::vector<Wt::Signals::connection> _scannerConnections;
+
+			std::mutex						_mutex;
+			std::shared_ptr<const Status>	_status;
+			SubscriptionId					_nextSubscriptionId {};
+			std::unordered_map<SubscriptionId, Subscription> _subscriptions;
+	};
+} // namespace UserInterface
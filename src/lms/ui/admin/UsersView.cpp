@@ -23,6 +23,7 @@
 #include <Wt/WMessageBox.h>
 #include <Wt/WTemplate.h>
 
+#include "services/auth/IEnvService.hpp"
 #include "services/auth/IPasswordService.hpp"
 #include "services/database/User.hpp"
 #include "services/database/Session.hpp"
@@ -119,6 +120,9 @@ UsersView::refreshView()
 						user.remove();
 				}
 
+				if (auto* authEnvService {Service<::Auth::IEnvService>::get()})
+					authEnvService->onUserDeleted(userId);
+
 				_container->removeWidget(entry);
 
 				LmsApp->getModalManager().dispose(modalPtr);
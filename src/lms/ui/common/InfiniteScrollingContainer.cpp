@@ -19,7 +19,12 @@
 
 #include "InfiniteScrollingContainer.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <sstream>
+
+#include <Wt/WApplication.h>
+
 #include "LoadingIndicator.hpp"
 
 namespace UserInterface
@@ -32,6 +37,16 @@ namespace UserInterface
 		reset();
 	}
 
+	void
+	InfiniteScrollingContainer::setVirtualized(std::size_t maxLiveCount, ElementLoader loader)
+	{
+		assert(maxLiveCount > 0);
+
+		_maxLiveCount = maxLiveCount;
+		_loader = std::move(loader);
+		trackFirstElement();
+	}
+
 	void
 	InfiniteScrollingContainer::clear()
 	{
@@ -42,11 +57,22 @@ namespace UserInterface
 	InfiniteScrollingContainer::reset()
 	{
 		_elements->clear();
+		_trackedFirstElement = nullptr;
+		if (_releasedBeforeCount > 0)
+			updatePadding("p=0;", false);
+		_releasedBeforeCount = 0;
+		_releasedAfterCount = 0;
 		setHasMore(true);
 	}
 
 	std::size_t
 	InfiniteScrollingContainer::getCount()
+	{
+		return _releasedBeforeCount + getLiveCount() + _releasedAfterCount;
+	}
+
+	std::size_t
+	InfiniteScrollingContainer::getLiveCount()
 	{
 		return _elements->count();
 	}
@@ -54,7 +80,15 @@ namespace UserInterface
 	void
 	InfiniteScrollingContainer::add(std::unique_ptr<Wt::WWidget> result)
 	{
-		return _elements->addWidget(std::move(result));
+		if (_releasedAfterCount > 0)
+		{
+			// will be loaded along with the released elements preceding it
+			_releasedAfterCount++;
+			return;
+		}
+
+		_elements->addWidget(std::move(result));
+		trackFirstElement();
 	}
 
 	void
@@ -75,37 +109,77 @@ namespace UserInterface
 	void
 	InfiniteScrollingContainer::remove(Wt::WWidget& widget)
 	{
+		if (&widget == _trackedFirstElement)
+			_trackedFirstElement = nullptr;
+
 		_elements->removeWidget(&widget);
+		trackFirstElement();
 	}
 
 	void
 	InfiniteScrollingContainer::remove(std::size_t first, std::size_t last)
 	{
 		assert(last >= first);
-		assert(last < static_cast<std::size_t>(_elements->count()));
+		assert(last < getCount());
+
+		const std::size_t liveEnd {_releasedBeforeCount + getLiveCount()};
+		if (last >= liveEnd)
+		{
+			_releasedAfterCount -= last - std::max(first, liveEnd) + 1;
+			if (first >= liveEnd)
+				return;
+
+			last = liveEnd - 1;
+		}
 
-		// remove from end as API is quite uneffective (minimize moves)
-		std::size_t i {last};
-		while (Wt::WWidget* widget {_elements->widget(i)})
+		if (last >= _releasedBeforeCount)
 		{
-			_elements->removeWidget(widget);
-			if (i-- == first)
-				break;
+			const std::size_t liveFirst {std::max(first, _releasedBeforeCount) - _releasedBeforeCount};
+
+			// remove from end as API is quite uneffective (minimize moves)
+			for (std::size_t i {last - _releasedBeforeCount + 1}; i-- > liveFirst;)
+				_elements->removeWidget(_elements->widget(i));
+
+			if (liveFirst == 0)
+				_trackedFirstElement = nullptr;
+
+			if (first >= _releasedBeforeCount)
+			{
+				trackFirstElement();
+				return;
+			}
+
+			last = _releasedBeforeCount - 1;
 		}
+
+		// the height of the removed released elements is unknown, assume they were all of the same height
+		const std::size_t removedCount {last - first + 1};
+		std::ostringstream oss;
+		oss << "p*=" << static_cast<double>(_releasedBeforeCount - removedCount) / _releasedBeforeCount << ";";
+		updatePadding(oss.str(), false);
+
+		_releasedBeforeCount -= removedCount;
+		trackFirstElement();
 	}
 
 	Wt::WWidget*
 	InfiniteScrollingContainer::getWidget(std::size_t pos) const
 	{
-		return _elements->widget(pos);
+		if (pos < _releasedBeforeCount)
+			return nullptr;
+
+		return _elements->widget(pos - _releasedBeforeCount);
 	}
 
 	std::optional<std::size_t>
 	InfiniteScrollingContainer::getIndexOf(Wt::WWidget& widget) const
 	{
-		return _elements->indexOf(&widget);
-	}
+		const int index {_elements->indexOf(&widget)};
+		if (index < 0)
+			return std::nullopt;
 
+		return _releasedBeforeCount + index;
+	}
 
 	void
 	InfiniteScrollingContainer::displayLoadingIndicator()
@@ -116,9 +190,7 @@ namespace UserInterface
 			if (!visible)
 				return;
 
-			const auto previousCount {_elements->count()};
-			onRequestElements.emit();
-			setHasMore(previousCount != _elements->count());
+			onLoadingIndicatorVisible();
 		});
 	}
 
@@ -129,4 +201,159 @@ namespace UserInterface
 		bindEmpty("loading-indicator");
 	}
 
+	void
+	InfiniteScrollingContainer::onLoadingIndicatorVisible()
+	{
+		bool hasMore {};
+		if (_releasedAfterCount > 0)
+		{
+			loadElementsAfter();
+			hasMore = true;
+		}
+		else
+		{
+			const auto previousCount {getCount()};
+			onRequestElements.emit();
+			hasMore = previousCount != getCount();
+		}
+
+		releaseFirstElements();
+		setHasMore(hasMore);
+	}
+
+	std::size_t
+	InfiniteScrollingContainer::getReleaseCount() const
+	{
+		return std::max<std::size_t>(_maxLiveCount / 4, 1);
+	}
+
+	void
+	InfiniteScrollingContainer::releaseFirstElements()
+	{
+		const std::size_t liveCount {getLiveCount()};
+		if (!_loader || liveCount <= _maxLiveCount)
+			return;
+
+		// release whole chunks, so that elements are displayed at the same place in grids
+		const std::size_t releaseCount {getReleaseCount()};
+		const std::size_t count {std::min(((liveCount - _maxLiveCount + releaseCount - 1) / releaseCount) * releaseCount, liveCount - 1)};
+
+		// keep the remaining elements in place, using the height of the released ones as padding
+		std::ostringstream oss;
+		oss << "if(c.children.length>" << count << ")p+=top(" << count << ")-top(0);";
+		updatePadding(oss.str(), true);
+
+		for (std::size_t i {count}; i-- > 0;)
+			_elements->removeWidget(_elements->widget(i));
+
+		_releasedBeforeCount += count;
+		_trackedFirstElement = nullptr;
+		trackFirstElement();
+	}
+
+	void
+	InfiniteScrollingContainer::releaseLastElements()
+	{
+		const std::size_t liveCount {getLiveCount()};
+		if (liveCount <= _maxLiveCount)
+			return;
+
+		const std::size_t count {liveCount - _maxLiveCount};
+		for (std::size_t i {liveCount}; i-- > liveCount - count;)
+			_elements->removeWidget(_elements->widget(i));
+
+		_releasedAfterCount += count;
+		if (!_loadingIndicator)
+			displayLoadingIndicator();
+	}
+
+	void
+	InfiniteScrollingContainer::loadElementsBefore()
+	{
+		const std::size_t count {std::min(_releasedBeforeCount, getReleaseCount())};
+
+		std::vector<std::unique_ptr<Wt::WWidget>> elements {_loader(_releasedBeforeCount - count, count)};
+		if (elements.size() != count)
+		{
+			// the underlying list has changed, start over
+			reset();
+			return;
+		}
+
+		for (std::size_t i {}; i < count; ++i)
+			_elements->insertWidget(i, std::move(elements[i]));
+		_releasedBeforeCount -= count;
+
+		if (_releasedBeforeCount == 0)
+		{
+			updatePadding("p=0;", false);
+		}
+		else
+		{
+			std::ostringstream oss;
+			oss << "if(c.children.length>" << count << ")p=Math.max(0,p-(top(" << count << ")-top(0)));";
+			updatePadding(oss.str(), false);
+		}
+
+		releaseLastElements();
+		trackFirstElement();
+	}
+
+	void
+	InfiniteScrollingContainer::loadElementsAfter()
+	{
+		const std::size_t count {std::min(_releasedAfterCount, getReleaseCount())};
+
+		std::vector<std::unique_ptr<Wt::WWidget>> elements {_loader(_releasedBeforeCount + getLiveCount(), count)};
+		if (elements.size() != count)
+		{
+			// the underlying list has changed, start over
+			reset();
+			return;
+		}
+
+		for (std::unique_ptr<Wt::WWidget>& element : elements)
+			_elements->addWidget(std::move(element));
+		_releasedAfterCount -= count;
+
+		trackFirstElement();
+	}
+
+	void
+	InfiniteScrollingContainer::trackFirstElement()
+	{
+		if (!_loader || _elements->count() == 0)
+			return;
+
+		Wt::WWidget* firstElement {_elements->widget(0)};
+		if (firstElement == _trackedFirstElement)
+			return;
+
+		// reload the previous elements as soon as the first live one gets close to the viewport
+		_trackedFirstElement = firstElement;
+		firstElement->setScrollVisibilityEnabled(true);
+		firstElement->setScrollVisibilityMargin(200);
+		firstElement->scrollVisibilityChanged().connect([this, firstElement](bool visible)
+		{
+			if (!visible || _releasedBeforeCount == 0 || _elements->widget(0) != firstElement)
+				return;
+
+			loadElementsBefore();
+		});
+	}
+
+	void
+	InfiniteScrollingContainer::updatePadding(const std::string& computeNewPadding, bool beforeLoad)
+	{
+		// released elements are only known by their height on the client side
+		std::ostringstream oss;
+		oss << "(function(){var c=" << _elements->jsRef() << ";if(!c)return;"
+			<< "var p=parseFloat(c.style.paddingTop)||0;"
+			<< "var top=function(i){return c.children[i].getBoundingClientRect().top;};"
+			<< computeNewPadding
+			<< "c.style.paddingTop=p>0?p+'px':'';})();";
+
+		// before load: must be measured before the elements are removed from the DOM
+		Wt::WApplication::instance()->doJavaScript(oss.str(), !beforeLoad);
+	}
 }
@@ -19,9 +19,11 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <optional>
 #include <utility>
+#include <vector>
 
 #include <Wt/WContainerWidget.h>
 #include <Wt/WSignal.h>
@@ -32,16 +34,24 @@ namespace UserInterface
 {
 	// Atomatically raises onRequestElements signal when the sentinel is displayed
 	// can add elements afterwards by calling setHasMoreElements()
+	// Once virtualized, only a window of elements is kept alive: the elements far
+	// from the viewport are released and reloaded on demand using the loader
 	class InfiniteScrollingContainer final : public Wt::WTemplate
 	{
 		public:
 			// "text" must contain loading-indicator and "elements"
 			InfiniteScrollingContainer(const Wt::WString& text = Wt::WString::tr("Lms.infinite-scrolling-container.template"));
 
+			// Must create the elements at positions [first, first + count)
+			using ElementLoader = std::function<std::vector<std::unique_ptr<Wt::WWidget>>(std::size_t first, std::size_t count)>;
+			void setVirtualized(std::size_t maxLiveCount, ElementLoader loader);
+
 			void reset();
-			std::size_t getCount();
+			std::size_t getCount(); // including released elements
+			std::size_t getLiveCount();
 			void add(std::unique_ptr<Wt::WWidget> result);
 
+			// Not to be used on virtualized containers
 			template<typename T, typename... Args>
 			T* addNew(Args&&... args)
 			{
@@ -51,7 +61,7 @@ namespace UserInterface
 			void remove(Wt::WWidget& widget);
 			void remove(std::size_t first, std::size_t last);
 
-			Wt::WWidget*				getWidget(std::size_t pos) const;
+			Wt::WWidget*				getWidget(std::size_t pos) const; // nullptr if released
 			std::optional<std::size_t>	getIndexOf(Wt::WWidget& widget) const;
 			void 						setHasMore(); // can be used to add elements afterwards
 
@@ -62,8 +72,22 @@ namespace UserInterface
 			void displayLoadingIndicator();
 			void hideLoadingIndicator();
 			void setHasMore(bool hasMore); // can be used to add elements afterwards
+			void onLoadingIndicatorVisible();
+
+			std::size_t getReleaseCount() const;
+			void releaseFirstElements();
+			void releaseLastElements();
+			void loadElementsBefore();
+			void loadElementsAfter();
+			void trackFirstElement();
+			void updatePadding(const std::string& computeNewPadding, bool beforeLoad);
 
 			Wt::WContainerWidget*	_elements;
 			Wt::WTemplate*			_loadingIndicator;
+			std::size_t				_maxLiveCount {};
+			ElementLoader			_loader;
+			std::size_t				_releasedBeforeCount {};
+			std::size_t				_releasedAfterCount {};
+			Wt::WWidget*			_trackedFirstElement {};
 	};
 }
@@ -25,6 +25,7 @@
 #include "services/database/User.hpp"
 #include "services/feedback/IFeedbackService.hpp"
 #include "services/scrobbling/IScrobblingService.hpp"
+#include "utils/Random.hpp"
 #include "utils/Service.hpp"
 #include "Filters.hpp"
 #include "LmsApplication.hpp"
@@ -69,50 +70,17 @@ namespace UserInterface
             break;
 
         case Mode::RecentlyAdded:
-        {
-            Artist::FindParameters params;
-            params.setClusters(getFilters().getClusterIds());
-            params.setLinkType(_linkType);
-            params.setSortMethod(ArtistSortMethod::LastWritten);
-            params.setRange(range);
-
-            {
-                auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
-                artists = Artist::findIds(LmsApp->getDbSession(), params);
-            }
+            artists = getSnapshotArtists(ArtistSortMethod::LastWritten, range);
             break;
-        }
 
         case Mode::Search:
-        {
-            Artist::FindParameters params;
-            params.setClusters(getFilters().getClusterIds());
-            params.setKeywords(getSearchKeywords());
-            params.setLinkType(_linkType);
-            params.setRange(range);
-
-            {
-                auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
-                artists = Artist::findIds(LmsApp->getDbSession(), params);
-            }
+            artists = getSearchArtists(range);
             break;
-        }
 
         case Mode::All:
-        {
-            Artist::FindParameters params;
-            params.setClusters(getFilters().getClusterIds());
-            params.setLinkType(_linkType);
-            params.setSortMethod(ArtistSortMethod::BySortName);
-            params.setRange(range);
-
-            {
-                auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
-                artists = Artist::findIds(LmsApp->getDbSession(), params);
-            }
+            artists = getSnapshotArtists(ArtistSortMethod::BySortName, range);
             break;
         }
-        }
 
         if (range.offset + range.size == getMaxCount())
             artists.moreResults = false;
@@ -120,24 +88,66 @@ namespace UserInterface
         return artists;
     }
 
-    RangeResults<Database::ArtistId> ArtistCollector::getRandomArtists(Range range)
+    RangeResults<ArtistId> ArtistCollector::getRandomArtists(Range range)
     {
         assert(getMode() == Mode::Random);
 
         if (!_randomArtists)
         {
-            Artist::FindParameters params;
-            params.setClusters(getFilters().getClusterIds());
-            params.setLinkType(_linkType);
-            params.setSortMethod(ArtistSortMethod::Random);
-            params.setRange(Range{ 0, getMaxCount() });
+            // shuffle the whole shared snapshot once, then page through it
+            const auto snapshot{ getSnapshot(ArtistSortMethod::None, 0) };
+
+            _randomArtists = *snapshot;
+            Random::shuffleContainer(*_randomArtists);
+            if (_randomArtists->size() > getMaxCount())
+                _randomArtists->resize(getMaxCount());
+        }
+
+        return getSubRange(*_randomArtists, range);
+    }
+
+    RangeResults<ArtistId> ArtistCollector::getSnapshotArtists(ArtistSortMethod sortMethod, Range range)
+    {
+        return getSubRange(*getSnapshot(sortMethod, getMaxCount()), range);
+    }
 
+    RangeResults<ArtistId> ArtistCollector::getSearchArtists(Range range)
+    {
+        const SearchResultCache::Key key{ SearchResultCache::createKey(getSearchKeywords(), getFilters().getClusterIds(), _linkType, getMaxCount()) };
+
+        const auto searchResult{ Service<SearchResultCache>::get()->getArtists(key, [&](const std::vector<ArtistId>* candidateIds)
             {
+                Artist::FindParameters params;
+                params.setClusters(getFilters().getClusterIds());
+                params.setKeywords(getSearchKeywords());
+                params.setLinkType(_linkType);
+                if (candidateIds)
+                    params.setIds(*candidateIds);
+                params.setRange(Range{ 0, getMaxCount() });
+
                 auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
-                _randomArtists = Artist::findIds(LmsApp->getDbSession(), params);
-            }
-        }
+                RangeResults<ArtistId> artists{ Artist::findIds(LmsApp->getDbSession(), params) };
+                return SearchResultCache::Result<ArtistId>{ std::move(artists.results), !artists.moreResults };
+            }) };
+
+        return getSubRange(searchResult->ids, range);
+    }
 
-        return _randomArtists->getSubRange(range);
+    CollectorSnapshotCache::Snapshot<ArtistId> ArtistCollector::getSnapshot(ArtistSortMethod sortMethod, std::size_t maxCount)
+    {
+        const CollectorSnapshotCache::Key key{ CollectorSnapshotCache::createKey(getMode(), getFilters().getClusterIds(), _linkType, maxCount) };
+
+        return Service<CollectorSnapshotCache>::get()->getArtists(key, [&]
+            {
+                Artist::FindParameters params;
+                params.setClusters(getFilters().getClusterIds());
+                params.setLinkType(_linkType);
+                params.setSortMethod(sortMethod);
+                if (maxCount)
+                    params.setRange(Range{ 0, maxCount });
+
+                auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
+                return Artist::findIds(LmsApp->getDbSession(), params).results;
+            });
     }
 } // ns UserInterface
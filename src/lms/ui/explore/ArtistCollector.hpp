@@ -20,8 +20,11 @@
 #pragma once
 
 #include <optional>
+#include <vector>
 
+#include "CollectorSnapshotCache.hpp"
 #include "DatabaseCollectorBase.hpp"
+#include "SearchResultCache.hpp"
 #include "services/database/ArtistId.hpp"
 #include "services/database/Types.hpp"
 
@@ -43,7 +46,10 @@ namespace UserInterface
 
 		private:
 			Database::RangeResults<Database::ArtistId>	getRandomArtists(Range range);
-			std::optional<Database::RangeResults<Database::ArtistId>> _randomArtists;
+			Database::RangeResults<Database::ArtistId> getSnapshotArtists(Database::ArtistSortMethod sortMethod, Range range);
+			Database::RangeResults<Database::ArtistId> getSearchArtists(Range range);
+			CollectorSnapshotCache::Snapshot<Database::ArtistId> getSnapshot(Database::ArtistSortMethod sortMethod, std::size_t maxCount);
+			std::optional<std::vector<Database::ArtistId>> _randomArtists;
 			std::optional<Database::TrackArtistLinkType> _linkType;
 	};
 } // ns UserInterface
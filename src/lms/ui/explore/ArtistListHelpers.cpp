@@ -24,6 +24,7 @@
 #include "services/database/Session.hpp"
 #include "services/database/TrackArtistLink.hpp"
 #include "utils/EnumSet.hpp"
+#include "explore/ListEntryModelCache.hpp"
 #include "LmsApplication.hpp"
 #include "Utils.hpp"
 
@@ -38,6 +39,15 @@ namespace UserInterface::ArtistListHelpers
 		return res;
 	}
 
+	std::unique_ptr<Wt::WTemplate>
+	createEntry(const ArtistListEntryModel& artist)
+	{
+		auto res {std::make_unique<Wt::WTemplate>(Wt::WString::tr("Lms.Explore.Artists.template.entry"))};
+		res->bindWidget("name", Utils::createArtistAnchor(artist));
+
+		return res;
+	}
+
 	std::unique_ptr<ArtistLinkTypesModel>
 	createArtistLinkTypesModel()
 	{
@@ -34,11 +34,14 @@ namespace Database
 
 namespace UserInterface
 {
+	struct ArtistAnchorModel;
+	using ArtistListEntryModel = ArtistAnchorModel;
 	using ArtistLinkTypesModel = ValueStringModel<std::optional<Database::TrackArtistLinkType>>;
 
 	namespace ArtistListHelpers
 	{
 		std::unique_ptr<Wt::WTemplate> createEntry(const Database::ObjectPtr<Database::Artist>& artist);
+		std::unique_ptr<Wt::WTemplate> createEntry(const ArtistListEntryModel& artist);
 		std::unique_ptr<ArtistLinkTypesModel> createArtistLinkTypesModel();
 	}
 }
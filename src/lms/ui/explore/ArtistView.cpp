@@ -19,7 +19,9 @@
 
 #include "ArtistView.hpp"
 
+#include <boost/asio/post.hpp>
 #include <Wt/WPushButton.h>
+#include <Wt/WServer.h>
 
 #include "services/database/Artist.hpp"
 #include "services/database/Cluster.hpp"
@@ -122,8 +124,6 @@ namespace UserInterface
         if (!artistId)
             throw ArtistNotFoundException{};
 
-        const auto similarArtistIds{ Service<Recommendation::IRecommendationService>::get()->getSimilarArtists(*artistId, {TrackArtistLinkType::Artist, TrackArtistLinkType::ReleaseArtist}, 5) };
-
         auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
 
         const Database::Artist::pointer artist{ Database::Artist::find(LmsApp->getDbSession(), *artistId) };
@@ -137,7 +137,7 @@ namespace UserInterface
         refreshAppearsOnReleases();
         refreshNonReleaseTracks();
         refreshLinks(artist);
-        refreshSimilarArtists(similarArtistIds);
+        loadSimilarArtists();
 
         Wt::WContainerWidget* clusterContainers{ bindNew<Wt::WContainerWidget>("clusters") };
 
@@ -304,6 +304,33 @@ namespace UserInterface
         setCondition("if-has-non-release-tracks", added);
     }
 
+    void Artist::loadSimilarArtists()
+    {
+        // Similar artists are among the slowest queries of the recommendation engine: compute them
+        // on the server thread pool and render them once available, as they are below the fold anyway
+        const ArtistId artistId{ _artistId };
+        const std::string sessionId{ LmsApp->sessionId() };
+
+        boost::asio::post(Wt::WServer::instance()->ioService(), [this, artistId, sessionId]
+            {
+                auto similarArtistIds{ Service<Recommendation::IRecommendationService>::get()->getSimilarArtists(artistId, {TrackArtistLinkType::Artist, TrackArtistLinkType::ReleaseArtist}, 5) };
+
+                // This view lives as long as the session, and nothing is run if the session is gone meanwhile
+                Wt::WServer::instance()->post(sessionId, [this, artistId, similarArtistIds{ std::move(similarArtistIds) }]
+                    {
+                        if (!LmsApp || artistId != _artistId)
+                            return;
+
+                        {
+                            auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
+                            refreshSimilarArtists(similarArtistIds);
+                        }
+
+                        LmsApp->triggerUpdate();
+                    });
+            });
+    }
+
     void Artist::refreshSimilarArtists(const std::vector<ArtistId>& similarArtistsId)
     {
         if (similarArtistsId.empty())
@@ -50,6 +50,7 @@ namespace UserInterface
 			void refreshReleases();
 			void refreshAppearsOnReleases();
 			void refreshNonReleaseTracks();
+			void loadSimilarArtists();
 			void refreshSimilarArtists(const std::vector<Database::ArtistId>& similarArtistsId);
 			void refreshLinks(const Database::ObjectPtr<Database::Artist>& artist);
 
@@ -25,10 +25,12 @@
 #include "services/database/Session.hpp"
 #include "services/database/TrackArtistLink.hpp"
 #include "utils/Logger.hpp"
+#include "utils/Service.hpp"
 
 #include "common/InfiniteScrollingContainer.hpp"
 #include "ArtistListHelpers.hpp"
 #include "Filters.hpp"
+#include "ListEntryModelCache.hpp"
 #include "LmsApplication.hpp"
 
 using namespace Database;
@@ -85,6 +87,10 @@ Artists::Artists(Filters& filters)
 	{
 		addSome();
 	});
+	_container->setVirtualized(_maxLiveCount, [this](std::size_t first, std::size_t count)
+	{
+		return createEntries(Range {first, count});
+	});
 
 	filters.updated().connect([this]
 	{
@@ -115,20 +121,36 @@ Artists::refreshView(std::optional<TrackArtistLinkType> linkType)
 	refreshView();
 }
 
+void
+Artists::releaseEntries()
+{
+	// keep the collector as is, so that the same entries are reloaded
+	_container->reset();
+}
+
+std::size_t
+Artists::getEntryCount()
+{
+	return _container->getLiveCount();
+}
+
 void
 Artists::addSome()
 {
-	const auto artistIds {_artistCollector.get(Range {static_cast<std::size_t>(_container->getCount()), _batchSize})};
+	for (std::unique_ptr<Wt::WWidget>& entry : createEntries(Range {_container->getCount(), _batchSize}))
+		_container->add(std::move(entry));
+}
 
-	{
-		auto transaction {LmsApp->getDbSession().createSharedTransaction()};
+std::vector<std::unique_ptr<Wt::WWidget>>
+Artists::createEntries(Range range)
+{
+	const auto artistIds {_artistCollector.get(range)};
 
-		for (const ArtistId artistId : artistIds.results)
-		{
-			if (const auto artist {Artist::find(LmsApp->getDbSession(), artistId)})
-				_container->add(ArtistListHelpers::createEntry(artist));
-		}
-	}
+	std::vector<std::unique_ptr<Wt::WWidget>> entries;
+	for (const auto& artist : Service<ListEntryModelCache>::get()->getArtists(LmsApp->getDbSession(), artistIds.results))
+		entries.push_back(ArtistListHelpers::createEntry(*artist));
+
+	return entries;
 }
 
 } // namespace UserInterface
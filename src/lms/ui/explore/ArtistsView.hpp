@@ -19,8 +19,10 @@
 
 #pragma once
 
+#include <memory>
 #include <optional>
 #include <unordered_map>
+#include <vector>
 
 #include <Wt/WComboBox.h>
 #include <Wt/WTemplate.h>
@@ -38,13 +40,19 @@ namespace UserInterface
 		public:
 			Artists(Filters& filters);
 
+			// Loaded entries are recreated on demand
+			void releaseEntries();
+			std::size_t getEntryCount();
+
 		private:
 			void refreshView();
 			void refreshView(ArtistCollector::Mode mode);
 			void refreshView(std::optional<Database::TrackArtistLinkType> linkType);
 			void addSome();
+			std::vector<std::unique_ptr<Wt::WWidget>> createEntries(Database::Range range);
 
 			static constexpr std::size_t _batchSize {30};
+			static constexpr std::size_t _maxLiveCount {480};
 			static constexpr std::size_t _maxCount {8000};
 
 			Wt::WWidget*				_currentActiveItem {};
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CollectorSnapshotCache.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+namespace UserInterface
+{
+    using namespace Database;
+
+    bool CollectorSnapshotCache::Key::operator<(const Key& other) const
+    {
+        return std::tie(mode, clusterIds, linkType, maxCount) < std::tie(other.mode, other.clusterIds, other.linkType, other.maxCount);
+    }
+
+    CollectorSnapshotCache::Key CollectorSnapshotCache::createKey(DatabaseCollectorBase::Mode mode, const std::vector<ClusterId>& clusterIds, std::optional<TrackArtistLinkType> linkType, std::size_t maxCount)
+    {
+        Key key{ mode, clusterIds, linkType, maxCount };
+        std::sort(std::begin(key.clusterIds), std::end(key.clusterIds));
+
+        return key;
+    }
+
+    CollectorSnapshotCache::CollectorSnapshotCache(std::size_t maxSnapshotCount)
+        : _maxSnapshotCount{ maxSnapshotCount }
+    {
+    }
+
+    template <typename IdType>
+    CollectorSnapshotCache::Snapshot<IdType> CollectorSnapshotCache::get(SnapshotMap<IdType>& snapshots, const Key& key, const LoadFunc<IdType>& loadFunc)
+    {
+        std::size_t generation;
+
+        {
+            const std::scoped_lock lock{ _mutex };
+
+            if (const auto it{ snapshots.find(key) }; it != std::cend(snapshots))
+                return it->second;
+
+            generation = _generation;
+        }
+
+        // several sessions may load the same snapshot meanwhile, the last one wins
+        Snapshot<IdType> snapshot{ std::make_shared<const std::vector<IdType>>(loadFunc()) };
+
+        const std::scoped_lock lock{ _mutex };
+
+        if (generation == _generation)
+        {
+            if (snapshots.size() >= _maxSnapshotCount)
+                snapshots.clear();
+
+            snapshots[key] = snapshot;
+        }
+
+        return snapshot;
+    }
+
+    CollectorSnapshotCache::Snapshot<ArtistId> CollectorSnapshotCache::getArtists(const Key& key, const LoadFunc<ArtistId>& loadFunc)
+    {
+        return get(_artists, key, loadFunc);
+    }
+
+    CollectorSnapshotCache::Snapshot<ReleaseId> CollectorSnapshotCache::getReleases(const Key& key, const LoadFunc<ReleaseId>& loadFunc)
+    {
+        return get(_releases, key, loadFunc);
+    }
+
+    CollectorSnapshotCache::Snapshot<TrackId> CollectorSnapshotCache::getTracks(const Key& key, const LoadFunc<TrackId>& loadFunc)
+    {
+        return get(_tracks, key, loadFunc);
+    }
+
+    void CollectorSnapshotCache::invalidate()
+    {
+        const std::scoped_lock lock{ _mutex };
+
+        _generation += 1;
+        _artists.clear();
+        _releases.clear();
+        _tracks.clear();
+    }
+} // namespace UserInterface
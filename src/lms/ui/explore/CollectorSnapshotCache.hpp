@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "services/database/ArtistId.hpp"
+#include "services/database/ClusterId.hpp"
+#include "services/database/ReleaseId.hpp"
+#include "services/database/TrackId.hpp"
+#include "services/database/Types.hpp"
+
+#include "explore/DatabaseCollectorBase.hpp"
+
+namespace UserInterface
+{
+    // Process wide snapshots of the user independent collector results, shared by all the sessions
+    // The whole cache is to be invalidated each time the library changes
+    class CollectorSnapshotCache
+    {
+    public:
+        struct Key
+        {
+            DatabaseCollectorBase::Mode mode;
+            std::vector<Database::ClusterId> clusterIds; // sorted
+            std::optional<Database::TrackArtistLinkType> linkType;
+            std::size_t maxCount{}; // 0 means no limit
+
+            bool operator<(const Key& other) const;
+        };
+
+        static Key createKey(DatabaseCollectorBase::Mode mode, const std::vector<Database::ClusterId>& clusterIds, std::optional<Database::TrackArtistLinkType> linkType, std::size_t maxCount);
+
+        template <typename IdType>
+        using Snapshot = std::shared_ptr<const std::vector<IdType>>;
+
+        template <typename IdType>
+        using LoadFunc = std::function<std::vector<IdType>()>;
+
+        CollectorSnapshotCache(std::size_t maxSnapshotCount);
+        ~CollectorSnapshotCache() = default;
+        CollectorSnapshotCache(const CollectorSnapshotCache&) = delete;
+        CollectorSnapshotCache& operator=(const CollectorSnapshotCache&) = delete;
+
+        // loadFunc is called without any lock held if the snapshot does not exist yet
+        Snapshot<Database::ArtistId> getArtists(const Key& key, const LoadFunc<Database::ArtistId>& loadFunc);
+        Snapshot<Database::ReleaseId> getReleases(const Key& key, const LoadFunc<Database::ReleaseId>& loadFunc);
+        Snapshot<Database::TrackId> getTracks(const Key& key, const LoadFunc<Database::TrackId>& loadFunc);
+
+        void invalidate();
+
+    private:
+        template <typename IdType>
+        using SnapshotMap = std::map<Key, Snapshot<IdType>>;
+
+        template <typename IdType>
+        Snapshot<IdType> get(SnapshotMap<IdType>& snapshots, const Key& key, const LoadFunc<IdType>& loadFunc);
+
+        const std::size_t _maxSnapshotCount;
+
+        std::mutex _mutex;
+        std::size_t _generation{}; // bumped on each invalidation, so that snapshots loaded meanwhile are not inserted
+        SnapshotMap<Database::ArtistId> _artists;
+        SnapshotMap<Database::ReleaseId> _releases;
+        SnapshotMap<Database::TrackId> _tracks;
+    };
+} // namespace UserInterface
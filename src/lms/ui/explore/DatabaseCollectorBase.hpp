@@ -19,6 +19,8 @@
 
 #pragma once
 
+#include <algorithm>
+#include <iterator>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -61,6 +63,22 @@ namespace UserInterface
         Filters&    getFilters() { return _filters; }
         const std::vector<std::string_view>& getSearchKeywords() const { return _searchKeywords; }
 
+        // Page through results held in memory (shared snapshots, random orders)
+        template <typename IdType>
+        static Database::RangeResults<IdType> getSubRange(const std::vector<IdType>& ids, Range range)
+        {
+            Database::RangeResults<IdType> res;
+
+            const std::size_t offset{ std::min(range.offset, ids.size()) };
+            const std::size_t size{ std::min(range.size, ids.size() - offset) };
+
+            res.range = Range{ offset, size };
+            res.results.assign(std::next(std::cbegin(ids), offset), std::next(std::cbegin(ids), offset + size));
+            res.moreResults = offset + size < ids.size();
+
+            return res;
+        }
+
     private:
         Filters& _filters;
         std::string _searchText;
@@ -75,6 +75,13 @@ namespace UserInterface {
 
 	} // namespace
 
+	template <typename View>
+	void
+	Explore::registerListView(View& view)
+	{
+		_listViews.push_back(ListView {&view, [&view] { view.releaseEntries(); }, [&view] { return view.getEntryCount(); }, std::nullopt});
+	}
+
 	Explore::Explore(Filters& filters, PlayQueue& playQueue)
 		: Wt::WTemplate {Wt::WString::tr("Lms.Explore.template")}
 	, _playQueueController {filters, playQueue}
@@ -84,9 +91,11 @@ namespace UserInterface {
 		// Contents
 		Wt::WStackedWidget* contentsStack {bindNew<Wt::WStackedWidget>("contents")};
 		contentsStack->setOverflow(Wt::Overflow::Visible); // wt makes it hidden by default
+		_contentsStack = contentsStack;
 
 		// same order as enum Idx
 		auto artists = std::make_unique<Artists>(filters);
+		registerListView(*artists);
 		contentsStack->addWidget(std::move(artists));
 
 		auto artist = std::make_unique<Artist>(filters, _playQueueController);
@@ -99,6 +108,7 @@ namespace UserInterface {
 		contentsStack->addWidget(std::move(trackList));
 
 		auto releases = std::make_unique<Releases>(filters, _playQueueController);
+		registerListView(*releases);
 		contentsStack->addWidget(std::move(releases));
 
 		auto release = std::make_unique<Release>(filters, _playQueueController);
@@ -106,17 +116,67 @@ namespace UserInterface {
 
 		auto search = std::make_unique<SearchView>(filters, _playQueueController);
 		_search = search.get();
+		registerListView(*search);
 		contentsStack->addWidget(std::move(search));
 
 		auto tracks = std::make_unique<Tracks>(filters, _playQueueController);
+		registerListView(*tracks);
 		contentsStack->addWidget(std::move(tracks));
 
 		wApp->internalPathChanged().connect(this, [=]
 		{
 			handleContentsPathChange(contentsStack);
+			onContentsChanged();
 		});
 
 		handleContentsPathChange(contentsStack);
+		onContentsChanged();
+	}
+
+	void
+	Explore::onContentsChanged()
+	{
+		const auto now {std::chrono::steady_clock::now()};
+
+		for (ListView& listView : _listViews)
+		{
+			if (listView.widget == _contentsStack->currentWidget())
+				listView.hiddenSince.reset();
+			else if (!listView.hiddenSince)
+				listView.hiddenSince = now;
+		}
+	}
+
+	void
+	Explore::releaseHiddenViewEntries(std::chrono::steady_clock::duration minHiddenDuration)
+	{
+		const auto now {std::chrono::steady_clock::now()};
+
+		for (ListView& listView : _listViews)
+		{
+			if (listView.hiddenSince && now - *listView.hiddenSince >= minHiddenDuration && listView.getEntryCount() > 0)
+				listView.releaseEntries();
+		}
+	}
+
+	void
+	Explore::releaseViewEntries()
+	{
+		for (ListView& listView : _listViews)
+		{
+			if (listView.getEntryCount() > 0)
+				listView.releaseEntries();
+		}
+	}
+
+	std::size_t
+	Explore::getLoadedEntryCount()
+	{
+		std::size_t res {};
+		for (const ListView& listView : _listViews)
+			res += listView.getEntryCount();
+
+		return res;
 	}
 
 	void
@@ -19,9 +19,19 @@
 
 #pragma once
 
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <vector>
+
 #include <Wt/WTemplate.h>
 #include "PlayQueueController.hpp"
 
+namespace Wt
+{
+	class WStackedWidget;
+}
+
 namespace UserInterface
 {
 	class Filters;
@@ -36,9 +46,29 @@ namespace UserInterface
 			void search(const Wt::WString& searchText);
 			PlayQueueController& getPlayQueueController() { return _playQueueController; }
 
+			// Release the entries loaded by the list views, they are reloaded on demand
+			void releaseHiddenViewEntries(std::chrono::steady_clock::duration minHiddenDuration);
+			void releaseViewEntries();
+			std::size_t getLoadedEntryCount();
+
 		private:
+			void onContentsChanged();
+
+			struct ListView
+			{
+				Wt::WWidget* widget {};
+				std::function<void()> releaseEntries;
+				std::function<std::size_t()> getEntryCount;
+				std::optional<std::chrono::steady_clock::time_point> hiddenSince;
+			};
+
+			template <typename View>
+			void registerListView(View& view);
+
 			PlayQueueController _playQueueController;
+			Wt::WStackedWidget* _contentsStack {};
 			SearchView* _search {};
+			std::vector<ListView> _listViews;
 	};
 } // namespace UserInterface
 
@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ListEntryModelCache.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <string_view>
+#include <utility>
+
+#include "services/database/Artist.hpp"
+#include "services/database/Release.hpp"
+#include "services/database/ReleaseRelations.hpp"
+#include "services/database/Session.hpp"
+#include "services/database/Track.hpp"
+#include "services/database/TrackRelations.hpp"
+
+#include "explore/ReleaseHelpers.hpp"
+#include "Utils.hpp"
+
+namespace UserInterface
+{
+    using namespace Database;
+
+    namespace
+    {
+        template <typename IdType, typename Model>
+        using LoadedModels = std::vector<std::pair<IdType, std::shared_ptr<const Model>>>;
+
+        std::vector<ArtistAnchorModel> createArtistAnchorModels(const std::vector<Artist::pointer>& artists)
+        {
+            std::vector<ArtistAnchorModel> res;
+            res.reserve(artists.size());
+            std::transform(std::cbegin(artists), std::cend(artists), std::back_inserter(res), [](const Artist::pointer& artist) { return createArtistAnchorModel(artist); });
+
+            return res;
+        }
+
+        // artist anchors are matched in order against the display name, see Utils::createArtistDisplayNameWithAnchors
+        void sortByDisplayNamePosition(std::vector<ArtistAnchorModel>& artists, std::string_view displayName)
+        {
+            std::stable_sort(std::begin(artists), std::end(artists), [&](const ArtistAnchorModel& lhs, const ArtistAnchorModel& rhs)
+                {
+                    return displayName.find(lhs.name) < displayName.find(rhs.name);
+                });
+        }
+
+        LoadedModels<ArtistId, ArtistListEntryModel> loadArtists(Session& session, const std::vector<ArtistId>& artistIds)
+        {
+            LoadedModels<ArtistId, ArtistListEntryModel> res;
+
+            auto transaction{ session.createSharedTransaction() };
+
+            for (const Artist::pointer& artist : Artist::find(session, artistIds))
+                res.emplace_back(artist->getId(), std::make_shared<const ArtistListEntryModel>(createArtistAnchorModel(artist)));
+
+            return res;
+        }
+
+        LoadedModels<ReleaseId, ReleaseListEntryModel> loadReleases(Session& session, const std::vector<ReleaseId>& releaseIds)
+        {
+            LoadedModels<ReleaseId, ReleaseListEntryModel> res;
+
+            auto transaction{ session.createSharedTransaction() };
+
+            const ReleaseRelations relations{ session, releaseIds };
+            for (const ReleaseId releaseId : releaseIds)
+            {
+                const Release::pointer release{ relations.getRelease(releaseId) };
+                if (!release)
+                    continue;
+
+                auto model{ std::make_shared<ReleaseListEntryModel>() };
+                model->release = createReleaseAnchorModel(release);
+                model->year = ReleaseHelpers::buildReleaseYearString(release).toUTF8();
+
+                // same rules as Utils::createArtistsAnchorsForRelease
+                if (const auto releaseArtists{ relations.getArtists(releaseId, TrackArtistLinkType::ReleaseArtist) }; !releaseArtists.empty())
+                {
+                    model->artistDisplayName = release->getArtistDisplayName();
+                    model->artists = createArtistAnchorModels(releaseArtists);
+                    sortByDisplayNamePosition(model->artists, model->artistDisplayName);
+                }
+                else if (const auto artists{ relations.getArtists(releaseId, TrackArtistLinkType::Artist) }; artists.size() == 1)
+                {
+                    model->artists = createArtistAnchorModels(artists);
+                }
+                else
+                {
+                    model->variousArtists = artists.size() > 1;
+                }
+
+                res.emplace_back(releaseId, std::move(model));
+            }
+
+            return res;
+        }
+
+        LoadedModels<TrackId, TrackListEntryModel> loadTracks(Session& session, const std::vector<TrackId>& trackIds)
+        {
+            LoadedModels<TrackId, TrackListEntryModel> res;
+
+            auto transaction{ session.createSharedTransaction() };
+
+            const std::vector<Track::pointer> tracks{ Track::find(session, trackIds) };
+            const TrackRelations relations{ session, tracks };
+            for (const Track::pointer& track : tracks)
+            {
+                const TrackId trackId{ track->getId() };
+
+                auto model{ std::make_shared<TrackListEntryModel>() };
+                model->id = trackId;
+                model->name = track->getName();
+                model->duration = track->getDuration();
+                model->artistDisplayName = track->getArtistDisplayName();
+                model->artists = createArtistAnchorModels(relations.getArtists(trackId, { TrackArtistLinkType::Artist }));
+                if (const Release::pointer release{ relations.getRelease(trackId) })
+                    model->release = createReleaseAnchorModel(release);
+
+                res.emplace_back(trackId, std::move(model));
+            }
+
+            return res;
+        }
+    }
+
+    ArtistAnchorModel createArtistAnchorModel(const Artist::pointer& artist)
+    {
+        return ArtistAnchorModel{ artist->getId(), artist->getName(), Utils::getArtistLinkPath(artist) };
+    }
+
+    ReleaseAnchorModel createReleaseAnchorModel(const Release::pointer& release)
+    {
+        return ReleaseAnchorModel{ release->getId(), release->getName(), Utils::getReleaseLinkPath(release) };
+    }
+
+    ListEntryModelCache::ListEntryModelCache(std::size_t maxEntryCount)
+        : _maxEntryCount{ maxEntryCount }
+    {
+    }
+
+    template <typename IdType, typename Model, typename LoadFunc>
+    std::vector<std::shared_ptr<const Model>> ListEntryModelCache::get(ModelMap<IdType, Model>& models, const std::vector<IdType>& ids, LoadFunc loadFunc)
+    {
+        std::vector<std::shared_ptr<const Model>> res(ids.size());
+        std::vector<IdType> missingIds;
+        std::size_t generation;
+
+        {
+            const std::scoped_lock lock{ _mutex };
+
+            generation = _generation;
+            for (std::size_t i{}; i < ids.size(); ++i)
+            {
+                if (const auto it{ models.find(ids[i]) }; it != std::cend(models))
+                    res[i] = it->second;
+                else
+                    missingIds.push_back(ids[i]);
+            }
+        }
+
+        if (!missingIds.empty())
+        {
+            // load outside the lock, other sessions may load the same models meanwhile
+            const LoadedModels<IdType, Model> loadedModels{ loadFunc(missingIds) };
+
+            ModelMap<IdType, Model> loadedModelsById(std::cbegin(loadedModels), std::cend(loadedModels));
+            for (std::size_t i{}; i < ids.size(); ++i)
+            {
+                if (res[i])
+                    continue;
+
+                if (const auto it{ loadedModelsById.find(ids[i]) }; it != std::cend(loadedModelsById))
+                    res[i] = it->second;
+            }
+
+            const std::scoped_lock lock{ _mutex };
+
+            if (generation == _generation)
+            {
+                if (models.size() + loadedModelsById.size() > _maxEntryCount)
+                    models.clear();
+
+                models.merge(loadedModelsById);
+            }
+        }
+
+        res.erase(std::remove(std::begin(res), std::end(res), nullptr), std::end(res));
+
+        return res;
+    }
+
+    std::vector<std::shared_ptr<const ArtistListEntryModel>> ListEntryModelCache::getArtists(Session& session, const std::vector<ArtistId>& artistIds)
+    {
+        return get(_artists, artistIds, [&](const std::vector<ArtistId>& missingIds) { return loadArtists(session, missingIds); });
+    }
+
+    std::vector<std::shared_ptr<const ReleaseListEntryModel>> ListEntryModelCache::getReleases(Session& session, const std::vector<ReleaseId>& releaseIds)
+    {
+        return get(_releases, releaseIds, [&](const std::vector<ReleaseId>& missingIds) { return loadReleases(session, missingIds); });
+    }
+
+    std::vector<std::shared_ptr<const TrackListEntryModel>> ListEntryModelCache::getTracks(Session& session, const std::vector<TrackId>& trackIds)
+    {
+        return get(_tracks, trackIds, [&](const std::vector<TrackId>& missingIds) { return loadTracks(session, missingIds); });
+    }
+
+    void ListEntryModelCache::invalidate()
+    {
+        const std::scoped_lock lock{ _mutex };
+
+        _generation += 1;
+        _artists.clear();
+        _releases.clear();
+        _tracks.clear();
+    }
+} // namespace UserInterface
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "services/database/ArtistId.hpp"
+#include "services/database/Object.hpp"
+#include "services/database/ReleaseId.hpp"
+#include "services/database/TrackId.hpp"
+
+namespace Database
+{
+    class Artist;
+    class Release;
+    class Session;
+}
+
+namespace UserInterface
+{
+    // Session independent data needed to render the explore list entries
+    // Immutable once built, so that they can be shared by all the sessions
+    struct ArtistAnchorModel
+    {
+        Database::ArtistId id;
+        std::string name;
+        std::string linkPath;
+    };
+
+    struct ReleaseAnchorModel
+    {
+        Database::ReleaseId id;
+        std::string name;
+        std::string linkPath;
+    };
+
+    using ArtistListEntryModel = ArtistAnchorModel;
+
+    struct ReleaseListEntryModel
+    {
+        ReleaseAnchorModel release;
+        std::string year; // empty if unknown
+        std::string artistDisplayName; // only set if the release has release artists
+        std::vector<ArtistAnchorModel> artists; // release artists, or the track artist if there is only one
+        bool variousArtists{}; // no release artist and several track artists
+    };
+
+    struct TrackListEntryModel
+    {
+        Database::TrackId id;
+        std::string name;
+        std::chrono::milliseconds duration{};
+        std::string artistDisplayName;
+        std::vector<ArtistAnchorModel> artists;
+        std::optional<ReleaseAnchorModel> release;
+    };
+
+    ArtistAnchorModel createArtistAnchorModel(const Database::ObjectPtr<Database::Artist>& artist);
+    ReleaseAnchorModel createReleaseAnchorModel(const Database::ObjectPtr<Database::Release>& release);
+
+    // Process wide cache of the list entry models, shared by all the sessions
+    // Missing models are loaded in bulk, the whole cache is to be invalidated each time the library changes
+    class ListEntryModelCache
+    {
+    public:
+        ListEntryModelCache(std::size_t maxEntryCount);
+        ~ListEntryModelCache() = default;
+        ListEntryModelCache(const ListEntryModelCache&) = delete;
+        ListEntryModelCache& operator=(const ListEntryModelCache&) = delete;
+
+        // Results follow the order of the requested ids, unknown ids are skipped
+        // Cache misses are loaded using a shared transaction on the given session
+        std::vector<std::shared_ptr<const ArtistListEntryModel>> getArtists(Database::Session& session, const std::vector<Database::ArtistId>& artistIds);
+        std::vector<std::shared_ptr<const ReleaseListEntryModel>> getReleases(Database::Session& session, const std::vector<Database::ReleaseId>& releaseIds);
+        std::vector<std::shared_ptr<const TrackListEntryModel>> getTracks(Database::Session& session, const std::vector<Database::TrackId>& trackIds);
+
+        void invalidate();
+
+    private:
+        template <typename IdType, typename Model>
+        using ModelMap = std::unordered_map<IdType, std::shared_ptr<const Model>>;
+
+        template <typename IdType, typename Model, typename LoadFunc>
+        std::vector<std::shared_ptr<const Model>> get(ModelMap<IdType, Model>& models, const std::vector<IdType>& ids, LoadFunc loadFunc);
+
+        const std::size_t _maxEntryCount;
+
+        std::mutex _mutex;
+        std::size_t _generation{}; // bumped on each invalidation, so that models loaded meanwhile are not inserted
+        ModelMap<Database::ArtistId, ArtistListEntryModel> _artists;
+        ModelMap<Database::ReleaseId, ReleaseListEntryModel> _releases;
+        ModelMap<Database::TrackId, TrackListEntryModel> _tracks;
+    };
+} // namespace UserInterface
@@ -24,6 +24,7 @@
 #include "services/database/User.hpp"
 #include "services/feedback/IFeedbackService.hpp"
 #include "services/scrobbling/IScrobblingService.hpp"
+#include "utils/Random.hpp"
 #include "utils/Service.hpp"
 #include "Filters.hpp"
 #include "LmsApplication.hpp"
@@ -66,47 +67,17 @@ namespace UserInterface
             break;
 
         case Mode::RecentlyAdded:
-        {
-            Release::FindParameters params;
-            params.setClusters(getFilters().getClusterIds());
-            params.setSortMethod(ReleaseSortMethod::LastWritten);
-            params.setRange(range);
-
-            {
-                auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
-                releases = Release::findIds(LmsApp->getDbSession(), params);
-            }
+            releases = getSnapshotReleases(ReleaseSortMethod::LastWritten, range);
             break;
-        }
 
         case Mode::Search:
-        {
-            Release::FindParameters params;
-            params.setClusters(getFilters().getClusterIds());
-            params.setKeywords(getSearchKeywords());
-            params.setRange(range);
-
-            {
-                auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
-                releases = Release::findIds(LmsApp->getDbSession(), params);
-            }
+            releases = getSearchReleases(range);
             break;
-        }
 
         case Mode::All:
-        {
-            Release::FindParameters params;
-            params.setClusters(getFilters().getClusterIds());
-            params.setSortMethod(ReleaseSortMethod::Name);
-            params.setRange(range);
-
-            {
-                auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
-                releases = Release::findIds(LmsApp->getDbSession(), params);
-            }
+            releases = getSnapshotReleases(ReleaseSortMethod::Name, range);
             break;
         }
-        }
 
         if (range.offset + range.size == getMaxCount())
             releases.moreResults = false;
@@ -120,18 +91,59 @@ namespace UserInterface
 
         if (!_randomReleases)
         {
-            Release::FindParameters params;
-            params.setClusters(getFilters().getClusterIds());
-            params.setSortMethod(ReleaseSortMethod::Random);
-            params.setRange(Range{ 0, getMaxCount() });
+            // shuffle the whole shared snapshot once, then page through it
+            const auto snapshot{ getSnapshot(ReleaseSortMethod::None, 0) };
+
+            _randomReleases = *snapshot;
+            Random::shuffleContainer(*_randomReleases);
+            if (_randomReleases->size() > getMaxCount())
+                _randomReleases->resize(getMaxCount());
+        }
+
+        return getSubRange(*_randomReleases, range);
+    }
+
+    RangeResults<ReleaseId> ReleaseCollector::getSnapshotReleases(ReleaseSortMethod sortMethod, Range range)
+    {
+        return getSubRange(*getSnapshot(sortMethod, getMaxCount()), range);
+    }
+
+    RangeResults<ReleaseId> ReleaseCollector::getSearchReleases(Range range)
+    {
+        const SearchResultCache::Key key{ SearchResultCache::createKey(getSearchKeywords(), getFilters().getClusterIds(), std::nullopt, getMaxCount()) };
 
+        const auto searchResult{ Service<SearchResultCache>::get()->getReleases(key, [&](const std::vector<ReleaseId>* candidateIds)
             {
+                Release::FindParameters params;
+                params.setClusters(getFilters().getClusterIds());
+                params.setKeywords(getSearchKeywords());
+                if (candidateIds)
+                    params.setIds(*candidateIds);
+                params.setRange(Range{ 0, getMaxCount() });
+
                 auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
-                _randomReleases = Release::findIds(LmsApp->getDbSession(), params);
-            }
-        }
+                RangeResults<ReleaseId> releases{ Release::findIds(LmsApp->getDbSession(), params) };
+                return SearchResultCache::Result<ReleaseId>{ std::move(releases.results), !releases.moreResults };
+            }) };
+
+        return getSubRange(searchResult->ids, range);
+    }
 
-        return _randomReleases->getSubRange(range);
+    CollectorSnapshotCache::Snapshot<ReleaseId> ReleaseCollector::getSnapshot(ReleaseSortMethod sortMethod, std::size_t maxCount)
+    {
+        const CollectorSnapshotCache::Key key{ CollectorSnapshotCache::createKey(getMode(), getFilters().getClusterIds(), std::nullopt, maxCount) };
+
+        return Service<CollectorSnapshotCache>::get()->getReleases(key, [&]
+            {
+                Release::FindParameters params;
+                params.setClusters(getFilters().getClusterIds());
+                params.setSortMethod(sortMethod);
+                if (maxCount)
+                    params.setRange(Range{ 0, maxCount });
+
+                auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
+                return Release::findIds(LmsApp->getDbSession(), params).results;
+            });
     }
 
 } // ns UserInterface
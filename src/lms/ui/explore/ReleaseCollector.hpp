@@ -20,8 +20,11 @@
 #pragma once
 
 #include <optional>
+#include <vector>
 
+#include "CollectorSnapshotCache.hpp"
 #include "DatabaseCollectorBase.hpp"
+#include "SearchResultCache.hpp"
 
 #include "services/database/Object.hpp"
 #include "services/database/ReleaseId.hpp"
@@ -44,7 +47,10 @@ namespace UserInterface
 
 		private:
 			Database::RangeResults<Database::ReleaseId> getRandomReleases(Range range);
-			std::optional<Database::RangeResults<Database::ReleaseId>> _randomReleases;
+			Database::RangeResults<Database::ReleaseId> getSnapshotReleases(Database::ReleaseSortMethod sortMethod, Range range);
+			Database::RangeResults<Database::ReleaseId> getSearchReleases(Range range);
+			CollectorSnapshotCache::Snapshot<Database::ReleaseId> getSnapshot(Database::ReleaseSortMethod sortMethod, std::size_t maxCount);
+			std::optional<std::vector<Database::ReleaseId>> _randomReleases;
 	};
 } // ns UserInterface
 
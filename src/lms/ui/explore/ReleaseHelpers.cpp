@@ -26,6 +26,7 @@
 #include "services/database/Artist.hpp"
 #include "services/database/Release.hpp"
 
+#include "explore/ListEntryModelCache.hpp"
 #include "Utils.hpp"
 
 using namespace Database;
@@ -34,7 +35,7 @@ namespace UserInterface::ReleaseListHelpers
 {
     namespace
     {
-        std::unique_ptr<Wt::WTemplate> createEntryInternal(const Release::pointer& release, const std::string& templateKey, const Artist::pointer& artist, const bool showYear)
+        std::unique_ptr<Wt::WTemplate> createEntryInternal(const ReleaseAnchorModel& release, const std::string& templateKey, std::unique_ptr<Wt::WContainerWidget> artistAnchors, const Wt::WString& year)
         {
             auto entry{ std::make_unique<Wt::WTemplate>(Wt::WString::tr(templateKey)) };
 
@@ -43,26 +44,21 @@ namespace UserInterface::ReleaseListHelpers
 
             {
                 Wt::WAnchor* anchor{ entry->bindWidget("cover", Utils::createReleaseAnchor(release, false)) };
-                auto cover{ Utils::createCover(release->getId(), CoverResource::Size::Large) };
+                auto cover{ Utils::createCover(release.id, CoverResource::Size::Large) };
                 cover->addStyleClass("Lms-cover-release Lms-cover-anchor");
                 anchor->setImage(std::move(cover));
             }
 
-            auto artistAnchors{ Utils::createArtistsAnchorsForRelease(release, artist ? artist->getId() : ArtistId{},  "link-secondary") };
             if (artistAnchors)
             {
                 entry->setCondition("if-has-artist", true);
                 entry->bindWidget("artist-name", std::move(artistAnchors));
             }
 
-            if (showYear)
+            if (!year.empty())
             {
-                Wt::WString year{ ReleaseHelpers::buildReleaseYearString(release->getReleaseDate(), release->getOriginalReleaseDate()) };
-                if (!year.empty())
-                {
-                    entry->setCondition("if-has-year", true);
-                    entry->bindString("year", year, Wt::TextFormat::Plain);
-                }
+                entry->setCondition("if-has-year", true);
+                entry->bindString("year", year, Wt::TextFormat::Plain);
             }
 
             return entry;
@@ -71,7 +67,14 @@ namespace UserInterface::ReleaseListHelpers
 
     std::unique_ptr<Wt::WTemplate> createEntry(const Release::pointer& release, const Artist::pointer& artist, bool showYear)
     {
-        return createEntryInternal(release, "Lms.Explore.Releases.template.entry-grid", artist, showYear);
+        Wt::WString year;
+        if (showYear)
+            year = ReleaseHelpers::buildReleaseYearString(release);
+
+        return createEntryInternal(createReleaseAnchorModel(release),
+            "Lms.Explore.Releases.template.entry-grid",
+            Utils::createArtistsAnchorsForRelease(release, artist ? artist->getId() : ArtistId{}, "link-secondary"),
+            year);
     }
 
     std::unique_ptr<Wt::WTemplate> createEntry(const Release::pointer& release)
@@ -79,6 +82,14 @@ namespace UserInterface::ReleaseListHelpers
         return createEntry(release, Artist::pointer{}, false /*year*/);
     }
 
+    std::unique_ptr<Wt::WTemplate> createEntry(const ReleaseListEntryModel& release)
+    {
+        return createEntryInternal(release.release,
+            "Lms.Explore.Releases.template.entry-grid",
+            Utils::createArtistsAnchorsForRelease(release, ArtistId{}, "link-secondary"),
+            Wt::WString{});
+    }
+
     std::unique_ptr<Wt::WTemplate> createEntryForArtist(const Database::Release::pointer& release, const Database::Artist::pointer& artist)
     {
         return createEntry(release, artist, true);
@@ -123,18 +134,21 @@ namespace UserInterface::ReleaseHelpers
         return res;
     }
 
-    Wt::WString buildReleaseYearString(const Wt::WDate& releaseDate, const Wt::WDate& originalReleaseDate)
+    Wt::WString buildReleaseYearString(const Release::pointer& release)
     {
         Wt::WString res;
 
-        // Year can be here, but originalYear can't be here without year (enforced by scanner)
-        if (!releaseDate.isValid())
+        // Use the cached years first: no query for the releases that do not have a single year
+        const std::optional<int> year{ release->getMinYear() };
+        if (!year || year != release->getMaxYear())
             return res;
 
-        if (originalReleaseDate.isValid() && originalReleaseDate.year() != releaseDate.year())
-            res = std::to_string(originalReleaseDate.year()) + " (" + std::to_string(releaseDate.year()) + ")";
+        // originalYear can't be here without year (enforced by scanner)
+        const Wt::WDate originalReleaseDate{ release->getOriginalReleaseDate() };
+        if (originalReleaseDate.isValid() && originalReleaseDate.year() != *year)
+            res = std::to_string(originalReleaseDate.year()) + " (" + std::to_string(*year) + ")";
         else
-            res = std::to_string(releaseDate.year());
+            res = std::to_string(*year);
 
         return res;
     }
@@ -20,9 +20,11 @@
 #include "ReleaseView.hpp"
 
 #include <map>
+#include <boost/asio/post.hpp>
 #include <Wt/WAnchor.h>
 #include <Wt/WImage.h>
 #include <Wt/WPushButton.h>
+#include <Wt/WServer.h>
 
 #include "av/IAudioFile.hpp"
 #include "services/database/Artist.hpp"
@@ -226,8 +228,6 @@ namespace UserInterface
         if (!releaseId)
             throw ReleaseNotFoundException{};
 
-        auto similarReleasesIds{ Service<Recommendation::IRecommendationService>::get()->getSimilarReleases(*releaseId, 6) };
-
         auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
 
         const Database::Release::pointer release{ Database::Release::find(LmsApp->getDbSession(), *releaseId) };
@@ -239,11 +239,11 @@ namespace UserInterface
 
         refreshCopyright(release);
         refreshLinks(release);
-        refreshSimilarReleases(similarReleasesIds);
+        loadSimilarReleases();
 
         bindString("name", Wt::WString::fromUTF8(release->getName()), Wt::TextFormat::Plain);
 
-        Wt::WString year{ ReleaseHelpers::buildReleaseYearString(release->getReleaseDate(), release->getOriginalReleaseDate()) };
+        Wt::WString year{ ReleaseHelpers::buildReleaseYearString(release) };
         if (!year.empty())
         {
             setCondition("if-has-year", true);
@@ -517,6 +517,33 @@ namespace UserInterface
         }
     }
 
+    void Release::loadSimilarReleases()
+    {
+        // The recommendation engine may be slow: compute the similar releases on the server thread pool
+        // and render them once available, so that the rest of the page does not wait for them
+        const ReleaseId releaseId{ _releaseId };
+        const std::string sessionId{ LmsApp->sessionId() };
+
+        boost::asio::post(Wt::WServer::instance()->ioService(), [this, releaseId, sessionId]
+            {
+                auto similarReleaseIds{ Service<Recommendation::IRecommendationService>::get()->getSimilarReleases(releaseId, 6) };
+
+                // This view lives as long as the session, and nothing is run if the session is gone meanwhile
+                Wt::WServer::instance()->post(sessionId, [this, releaseId, similarReleaseIds{ std::move(similarReleaseIds) }]
+                    {
+                        if (!LmsApp || releaseId != _releaseId)
+                            return;
+
+                        {
+                            auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
+                            refreshSimilarReleases(similarReleaseIds);
+                        }
+
+                        LmsApp->triggerUpdate();
+                    });
+            });
+    }
+
     void Release::refreshSimilarReleases(const std::vector<ReleaseId>& similarReleasesId)
     {
         if (similarReleasesId.empty())
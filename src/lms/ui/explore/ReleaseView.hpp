@@ -43,6 +43,7 @@ namespace UserInterface
 			void refreshReleaseArtists(const Database::ObjectPtr<Database::Release>& release);
 			void refreshCopyright(const Database::ObjectPtr<Database::Release>& release);
 			void refreshLinks(const Database::ObjectPtr<Database::Release>& release);
+			void loadSimilarReleases();
 			void refreshSimilarReleases(const std::vector<Database::ReleaseId>& similarReleasesId);
 
 			Filters&				_filters;
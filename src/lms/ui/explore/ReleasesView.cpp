@@ -21,12 +21,13 @@
 
 #include <Wt/WPushButton.h>
 
-#include "services/database/Release.hpp"
 #include "services/database/Session.hpp"
+#include "utils/Service.hpp"
 
 #include "common/InfiniteScrollingContainer.hpp"
 #include "common/Template.hpp"
 #include "explore/Filters.hpp"
+#include "explore/ListEntryModelCache.hpp"
 #include "explore/PlayQueueController.hpp"
 #include "explore/ReleaseHelpers.hpp"
 #include "LmsApplication.hpp"
@@ -96,6 +97,10 @@ namespace UserInterface
             {
                 addSome();
             });
+        _container->setVirtualized(_maxLiveCount, [this](std::size_t first, std::size_t count)
+            {
+                return createEntries(Range{ first, count });
+            });
 
         filters.updated().connect([this]
             {
@@ -117,19 +122,32 @@ namespace UserInterface
         refreshView();
     }
 
+    void Releases::releaseEntries()
+    {
+        // keep the collector as is, so that the same entries are reloaded
+        _container->reset();
+    }
+
+    std::size_t Releases::getEntryCount()
+    {
+        return _container->getLiveCount();
+    }
+
     void Releases::addSome()
     {
-        const auto releaseIds{ _releaseCollector.get(Range {static_cast<std::size_t>(_container->getCount()), _batchSize}) };
+        for (std::unique_ptr<Wt::WWidget>& entry : createEntries(Range{ _container->getCount(), _batchSize }))
+            _container->add(std::move(entry));
+    }
 
-        {
-            auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
+    std::vector<std::unique_ptr<Wt::WWidget>> Releases::createEntries(Range range)
+    {
+        const auto releaseIds{ _releaseCollector.get(range) };
 
-            for (const ReleaseId releaseId : releaseIds.results)
-            {
-                if (const Release::pointer release{ Release::find(LmsApp->getDbSession(), releaseId) })
-                    _container->add(ReleaseListHelpers::createEntry(release));
-            }
-        }
+        std::vector<std::unique_ptr<Wt::WWidget>> entries;
+        for (const auto& release : Service<ListEntryModelCache>::get()->getReleases(LmsApp->getDbSession(), releaseIds.results))
+            entries.push_back(ReleaseListHelpers::createEntry(*release));
+
+        return entries;
     }
 
     std::vector<ReleaseId> Releases::getAllReleases()
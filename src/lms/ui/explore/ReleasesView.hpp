@@ -19,6 +19,9 @@
 
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include "services/database/Types.hpp"
 
 #include "common/Template.hpp"
@@ -35,15 +38,21 @@ namespace UserInterface
 		public:
 			Releases(Filters& filters, PlayQueueController& playQueueController);
 
+			// Loaded entries are recreated on demand
+			void releaseEntries();
+			std::size_t getEntryCount();
+
 		private:
 			void refreshView();
 			void refreshView(ReleaseCollector::Mode mode);
 
 			void addSome();
+			std::vector<std::unique_ptr<Wt::WWidget>> createEntries(Database::Range range);
 			std::vector<Database::ReleaseId> getAllReleases();
 
 			static constexpr std::size_t _maxItemsPerLine {6};
 			static constexpr std::size_t _batchSize {_maxItemsPerLine};
+			static constexpr std::size_t _maxLiveCount {_maxItemsPerLine * 32}; // released by multiples of the possible items per line
 			static constexpr std::size_t _maxCount {_maxItemsPerLine * 500};
 
 			PlayQueueController&		_playQueueController;
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SearchResultCache.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <tuple>
+
+namespace UserInterface
+{
+    using namespace Database;
+
+    namespace
+    {
+        // keywords without any of these characters may not be searched the same way by the
+        // full text search index and by substring matching, their results cannot be narrowed
+        bool isNarrowable(std::string_view keyword)
+        {
+            return std::any_of(std::cbegin(keyword), std::cend(keyword), [](unsigned char c) { return c < 0x80 && std::isalnum(c); });
+        }
+    }
+
+    bool SearchResultCache::Key::operator<(const Key& other) const
+    {
+        return std::tie(keywords, clusterIds, linkType, maxCount) < std::tie(other.keywords, other.clusterIds, other.linkType, other.maxCount);
+    }
+
+    SearchResultCache::Key SearchResultCache::createKey(const std::vector<std::string_view>& keywords, const std::vector<ClusterId>& clusterIds, std::optional<TrackArtistLinkType> linkType, std::size_t maxCount)
+    {
+        Key key{ {}, clusterIds, linkType, maxCount };
+        key.keywords.reserve(keywords.size());
+        for (std::string_view keyword : keywords)
+            key.keywords.emplace_back(keyword);
+        std::sort(std::begin(key.clusterIds), std::end(key.clusterIds));
+
+        return key;
+    }
+
+    SearchResultCache::SearchResultCache(std::size_t maxEntryCount)
+        : _maxEntryCount{ maxEntryCount }
+    {
+    }
+
+    template <typename IdType>
+    void SearchResultCache::Entries<IdType>::clear()
+    {
+        entries.clear();
+        entriesByKey.clear();
+    }
+
+    template <typename IdType>
+    SearchResultCache::ResultPtr<IdType> SearchResultCache::findBroaderResult(const Entries<IdType>& entries, const Key& key) const
+    {
+        if (!std::all_of(std::cbegin(key.keywords), std::cend(key.keywords), [](const std::string& keyword) { return isNarrowable(keyword); }))
+            return {};
+
+        // the searches that match a superset of the results: previous keywords cut down, from the narrowest one
+        Key broaderKey{ key };
+        while (!broaderKey.keywords.empty())
+        {
+            std::string& lastKeyword{ broaderKey.keywords.back() };
+            if (lastKeyword.size() > 1)
+                lastKeyword.pop_back();
+            else
+                broaderKey.keywords.pop_back();
+
+            if (broaderKey.keywords.empty() || !isNarrowable(broaderKey.keywords.back()))
+                break;
+
+            if (const auto it{ entries.entriesByKey.find(broaderKey) }; it != std::cend(entries.entriesByKey) && it->second->second->complete)
+                return it->second->second;
+        }
+
+        return {};
+    }
+
+    template <typename IdType>
+    void SearchResultCache::put(Entries<IdType>& entries, const Key& key, ResultPtr<IdType> result)
+    {
+        if (auto it{ entries.entriesByKey.find(key) }; it != std::cend(entries.entriesByKey))
+        {
+            entries.entries.erase(it->second);
+            entries.entriesByKey.erase(it);
+        }
+
+        while (!entries.entries.empty() && entries.entries.size() >= _maxEntryCount)
+        {
+            entries.entriesByKey.erase(entries.entries.back().first);
+            entries.entries.pop_back();
+        }
+
+        entries.entries.emplace_front(key, std::move(result));
+        entries.entriesByKey.emplace(key, std::begin(entries.entries));
+    }
+
+    template <typename IdType>
+    SearchResultCache::ResultPtr<IdType> SearchResultCache::get(Entries<IdType>& entries, const Key& key, const LoadFunc<IdType>& loadFunc)
+    {
+        std::size_t generation;
+        ResultPtr<IdType> broaderResult;
+
+        {
+            const std::scoped_lock lock{ _mutex };
+
+            if (const auto it{ entries.entriesByKey.find(key) }; it != std::cend(entries.entriesByKey))
+            {
+                entries.entries.splice(std::begin(entries.entries), entries.entries, it->second);
+                return it->second->second;
+            }
+
+            broaderResult = findBroaderResult(entries, key);
+            generation = _generation;
+        }
+
+        ResultPtr<IdType> result;
+        if (broaderResult && broaderResult->ids.empty())
+            result = broaderResult; // no need to search further
+        else if (broaderResult && broaderResult->ids.size() <= _maxCandidateCount)
+            result = std::make_shared<const Result<IdType>>(loadFunc(&broaderResult->ids));
+        else
+            result = std::make_shared<const Result<IdType>>(loadFunc(nullptr));
+
+        const std::scoped_lock lock{ _mutex };
+
+        if (generation == _generation)
+            put(entries, key, result);
+
+        return result;
+    }
+
+    SearchResultCache::ResultPtr<ArtistId> SearchResultCache::getArtists(const Key& key, const LoadFunc<ArtistId>& loadFunc)
+    {
+        return get(_artists, key, loadFunc);
+    }
+
+    SearchResultCache::ResultPtr<ReleaseId> SearchResultCache::getReleases(const Key& key, const LoadFunc<ReleaseId>& loadFunc)
+    {
+        return get(_releases, key, loadFunc);
+    }
+
+    SearchResultCache::ResultPtr<TrackId> SearchResultCache::getTracks(const Key& key, const LoadFunc<TrackId>& loadFunc)
+    {
+        return get(_tracks, key, loadFunc);
+    }
+
+    void SearchResultCache::invalidate()
+    {
+        const std::scoped_lock lock{ _mutex };
+
+        _generation += 1;
+        _artists.clear();
+        _releases.clear();
+        _tracks.clear();
+    }
+} // namespace UserInterface
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "services/database/ArtistId.hpp"
+#include "services/database/ClusterId.hpp"
+#include "services/database/ReleaseId.hpp"
+#include "services/database/TrackId.hpp"
+#include "services/database/Types.hpp"
+
+namespace UserInterface
+{
+    // Process wide LRU cache of the search results, shared by all the sessions
+    // A search that narrows a complete cached one (same keywords, being typed further) is only run on the cached ids
+    // The whole cache is to be invalidated each time the library changes
+    class SearchResultCache
+    {
+    public:
+        struct Key
+        {
+            std::vector<std::string> keywords;
+            std::vector<Database::ClusterId> clusterIds; // sorted
+            std::optional<Database::TrackArtistLinkType> linkType;
+            std::size_t maxCount{};
+
+            bool operator<(const Key& other) const;
+        };
+
+        static Key createKey(const std::vector<std::string_view>& keywords, const std::vector<Database::ClusterId>& clusterIds, std::optional<Database::TrackArtistLinkType> linkType, std::size_t maxCount);
+
+        template <typename IdType>
+        struct Result
+        {
+            std::vector<IdType> ids;
+            bool complete{}; // false if truncated to maxCount
+        };
+
+        template <typename IdType>
+        using ResultPtr = std::shared_ptr<const Result<IdType>>;
+
+        // if set, the matching ids are to be searched among candidateIds only
+        template <typename IdType>
+        using LoadFunc = std::function<Result<IdType>(const std::vector<IdType>* candidateIds)>;
+
+        SearchResultCache(std::size_t maxEntryCount);
+        ~SearchResultCache() = default;
+        SearchResultCache(const SearchResultCache&) = delete;
+        SearchResultCache& operator=(const SearchResultCache&) = delete;
+
+        // loadFunc is called without any lock held if the result is not cached yet
+        ResultPtr<Database::ArtistId> getArtists(const Key& key, const LoadFunc<Database::ArtistId>& loadFunc);
+        ResultPtr<Database::ReleaseId> getReleases(const Key& key, const LoadFunc<Database::ReleaseId>& loadFunc);
+        ResultPtr<Database::TrackId> getTracks(const Key& key, const LoadFunc<Database::TrackId>& loadFunc);
+
+        void invalidate();
+
+    private:
+        template <typename IdType>
+        struct Entries
+        {
+            using EntryList = std::list<std::pair<Key, ResultPtr<IdType>>>; // most recently used first
+            EntryList entries;
+            std::map<Key, typename EntryList::iterator> entriesByKey;
+
+            void clear();
+        };
+
+        template <typename IdType>
+        ResultPtr<IdType> get(Entries<IdType>& entries, const Key& key, const LoadFunc<IdType>& loadFunc);
+
+        template <typename IdType>
+        ResultPtr<IdType> findBroaderResult(const Entries<IdType>& entries, const Key& key) const;
+
+        template <typename IdType>
+        void put(Entries<IdType>& entries, const Key& key, ResultPtr<IdType> result);
+
+        // narrowed searches are bound to these ids, keep them far below the SQLite bound parameter limit
+        static constexpr std::size_t _maxCandidateCount{ 256 };
+        const std::size_t _maxEntryCount;
+
+        std::mutex _mutex;
+        std::size_t _generation{}; // bumped on each invalidation, so that results loaded meanwhile are not inserted
+        Entries<Database::ArtistId> _artists;
+        Entries<Database::ReleaseId> _releases;
+        Entries<Database::TrackId> _tracks;
+    };
+} // namespace UserInterface
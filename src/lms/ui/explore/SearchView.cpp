@@ -20,6 +20,7 @@
 #include "SearchView.hpp"
 
 #include <Wt/WPushButton.h>
+#include <Wt/WServer.h>
 
 #include "services/database/Artist.hpp"
 #include "services/database/Release.hpp"
@@ -130,9 +131,30 @@ namespace UserInterface
 
     void SearchView::refreshView(const Wt::WString& searchText)
     {
-        _releaseCollector.setSearch(searchText.toUTF8());
-        _artistCollector.setSearch(searchText.toUTF8());
-        _trackCollector.setSearch(searchText.toUTF8());
+        const std::size_t searchGeneration{ ++_searchGeneration };
+
+        Wt::WServer::instance()->schedule(_searchDelay, LmsApp->sessionId(), [this, searchText = searchText.toUTF8(), searchGeneration]
+            {
+                // may be nullptr, see https://redmine.webtoolkit.eu/issues/8202
+                if (!LmsApp || searchGeneration != _searchGeneration)
+                    return;
+
+                search(searchText);
+                LmsApp->triggerUpdate();
+            });
+    }
+
+    void SearchView::search(const std::string& searchText)
+    {
+        if (searchText == _searchText)
+            return;
+
+        _searchText = searchText;
+        _releaseCollector.setSearch(_searchText);
+        _artistCollector.setSearch(_searchText);
+        _trackCollector.setSearch(_searchText);
+
+        // also drops the loading requests of the previous search
         refreshView();
     }
 
@@ -143,6 +165,16 @@ namespace UserInterface
         _tracks->reset();
     }
 
+    void SearchView::releaseEntries()
+    {
+        refreshView();
+    }
+
+    std::size_t SearchView::getEntryCount()
+    {
+        return _artists->getLiveCount() + _releases->getLiveCount() + _tracks->getLiveCount();
+    }
+
     void SearchView::addSomeArtists()
     {
         using namespace Database;
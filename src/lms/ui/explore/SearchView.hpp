@@ -19,7 +19,9 @@
 
 #pragma once
 
+#include <chrono>
 #include <optional>
+#include <string>
 #include <unordered_map>
 
 #include <Wt/WComboBox.h>
@@ -44,6 +46,10 @@ namespace UserInterface
 
         void refreshView(const Wt::WString& searchText);
 
+        // Loaded entries are recreated on demand
+        void releaseEntries();
+        std::size_t getEntryCount();
+
     private:
         // same order as in the menu
         enum class Mode
@@ -69,6 +75,10 @@ namespace UserInterface
         std::size_t getBatchSize(Mode mode) const;
         std::size_t getMaxCount(Mode mode) const;
 
+        // searches are only run once the user stops typing for this long
+        static constexpr std::chrono::milliseconds _searchDelay{ 250 };
+
+        void search(const std::string& searchText);
         void refreshView();
         void refreshView(std::optional<Database::TrackArtistLinkType> linkType);
         void addSomeArtists();
@@ -87,6 +97,8 @@ namespace UserInterface
         InfiniteScrollingContainer* _tracks{};
 
         Wt::WComboBox* _artistLinkType{};
+        std::string _searchText;
+        std::size_t _searchGeneration{}; // bumped on each input, so that the superseded searches are not run
     };
 
 } // namespace UserInterface
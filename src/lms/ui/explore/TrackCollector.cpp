@@ -27,6 +27,7 @@
 #include "services/database/User.hpp"
 #include "services/feedback/IFeedbackService.hpp"
 #include "services/scrobbling/IScrobblingService.hpp"
+#include "utils/Random.hpp"
 #include "utils/Service.hpp"
 #include "Filters.hpp"
 #include "LmsApplication.hpp"
@@ -69,46 +70,17 @@ namespace UserInterface
             break;
 
         case Mode::RecentlyAdded:
-        {
-            Track::FindParameters params;
-            params.setClusters(getFilters().getClusterIds());
-            params.setSortMethod(TrackSortMethod::LastWritten);
-            params.setRange(range);
-
-            {
-                auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
-                tracks = Track::findIds(LmsApp->getDbSession(), params);
-            }
+            tracks = getSnapshotTracks(TrackSortMethod::LastWritten, range);
             break;
-        }
 
         case Mode::Search:
-        {
-            Track::FindParameters params;
-            params.setClusters(getFilters().getClusterIds());
-            params.setKeywords(getSearchKeywords());
-            params.setRange(range);
-
-            {
-                auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
-                tracks = Track::findIds(LmsApp->getDbSession(), params);
-            }
+            tracks = getSearchTracks(range);
             break;
-        }
 
         case Mode::All:
-        {
-            Track::FindParameters params;
-            params.setClusters(getFilters().getClusterIds());
-            params.setRange(range);
-
-            {
-                auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
-                tracks = Track::findIds(LmsApp->getDbSession(), params);
-            }
+            tracks = getSnapshotTracks(TrackSortMethod::None, range);
             break;
         }
-        }
 
         if (range.offset + range.size == getMaxCount())
             tracks.moreResults = false;
@@ -122,18 +94,59 @@ namespace UserInterface
 
         if (!_randomTracks)
         {
-            Track::FindParameters params;
-            params.setClusters(getFilters().getClusterIds());
-            params.setSortMethod(TrackSortMethod::Random);
-            params.setRange(Range{ 0, getMaxCount() });
+            // shuffle the whole shared snapshot once, then page through it
+            const auto snapshot{ getSnapshot(TrackSortMethod::None, 0) };
+
+            _randomTracks = *snapshot;
+            Random::shuffleContainer(*_randomTracks);
+            if (_randomTracks->size() > getMaxCount())
+                _randomTracks->resize(getMaxCount());
+        }
+
+        return getSubRange(*_randomTracks, range);
+    }
+
+    RangeResults<TrackId> TrackCollector::getSnapshotTracks(TrackSortMethod sortMethod, Range range)
+    {
+        return getSubRange(*getSnapshot(sortMethod, getMaxCount()), range);
+    }
+
+    RangeResults<TrackId> TrackCollector::getSearchTracks(Range range)
+    {
+        const SearchResultCache::Key key{ SearchResultCache::createKey(getSearchKeywords(), getFilters().getClusterIds(), std::nullopt, getMaxCount()) };
 
+        const auto searchResult{ Service<SearchResultCache>::get()->getTracks(key, [&](const std::vector<TrackId>* candidateIds)
             {
+                Track::FindParameters params;
+                params.setClusters(getFilters().getClusterIds());
+                params.setKeywords(getSearchKeywords());
+                if (candidateIds)
+                    params.setIds(*candidateIds);
+                params.setRange(Range{ 0, getMaxCount() });
+
                 auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
-                _randomTracks = Track::findIds(LmsApp->getDbSession(), params);
-            }
-        }
+                RangeResults<TrackId> tracks{ Track::findIds(LmsApp->getDbSession(), params) };
+                return SearchResultCache::Result<TrackId>{ std::move(tracks.results), !tracks.moreResults };
+            }) };
+
+        return getSubRange(searchResult->ids, range);
+    }
 
-        return _randomTracks->getSubRange(range);
+    CollectorSnapshotCache::Snapshot<TrackId> TrackCollector::getSnapshot(TrackSortMethod sortMethod, std::size_t maxCount)
+    {
+        const CollectorSnapshotCache::Key key{ CollectorSnapshotCache::createKey(getMode(), getFilters().getClusterIds(), std::nullopt, maxCount) };
+
+        return Service<CollectorSnapshotCache>::get()->getTracks(key, [&]
+            {
+                Track::FindParameters params;
+                params.setClusters(getFilters().getClusterIds());
+                params.setSortMethod(sortMethod);
+                if (maxCount)
+                    params.setRange(Range{ 0, maxCount });
+
+                auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
+                return Track::findIds(LmsApp->getDbSession(), params).results;
+            });
     }
 
 } // ns UserInterface
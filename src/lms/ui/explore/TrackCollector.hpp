@@ -20,10 +20,13 @@
 #pragma once
 
 #include <optional>
+#include <vector>
 
 #include "services/database/Object.hpp"
 #include "services/database/TrackId.hpp"
+#include "CollectorSnapshotCache.hpp"
 #include "DatabaseCollectorBase.hpp"
+#include "SearchResultCache.hpp"
 
 namespace Database
 {
@@ -42,7 +45,10 @@ namespace UserInterface
 
 		private:
 			Database::RangeResults<Database::TrackId> getRandomTracks(Range range);
-			std::optional<Database::RangeResults<Database::TrackId>> _randomTracks;
+			Database::RangeResults<Database::TrackId> getSnapshotTracks(Database::TrackSortMethod sortMethod, Range range);
+			Database::RangeResults<Database::TrackId> getSearchTracks(Range range);
+			CollectorSnapshotCache::Snapshot<Database::TrackId> getSnapshot(Database::TrackSortMethod sortMethod, std::size_t maxCount);
+			std::optional<std::vector<Database::TrackId>> _randomTracks;
 	};
 } // ns UserInterface
 
@@ -35,6 +35,7 @@
 #include "utils/Service.hpp"
 
 #include "common/Template.hpp"
+#include "explore/ListEntryModelCache.hpp"
 #include "explore/PlayQueueController.hpp"
 #include "resource/DownloadResource.hpp"
 #include "resource/CoverResource.hpp"
@@ -155,29 +156,42 @@ namespace UserInterface::TrackListHelpers
     }
 
     std::unique_ptr<Wt::WWidget> createEntry(const Database::ObjectPtr<Database::Track>& track, PlayQueueController& playQueueController, Filters& filters)
+    {
+        TrackListEntryModel model;
+        model.id = track->getId();
+        model.name = track->getName();
+        model.duration = track->getDuration();
+        model.artistDisplayName = track->getArtistDisplayName();
+        for (const Artist::pointer& artist : track->getArtists({ TrackArtistLinkType::Artist }))
+            model.artists.push_back(createArtistAnchorModel(artist));
+        if (const Release::pointer release{ track->getRelease() })
+            model.release = createReleaseAnchorModel(release);
+
+        return createEntry(model, playQueueController, filters);
+    }
+
+    std::unique_ptr<Wt::WWidget> createEntry(const TrackListEntryModel& track, PlayQueueController& playQueueController, Filters& filters)
     {
         auto entry{ std::make_unique<Template>(Wt::WString::tr("Lms.Explore.Tracks.template.entry")) };
         auto* entryPtr{ entry.get() };
 
-        entry->bindString("name", Wt::WString::fromUTF8(track->getName()), Wt::TextFormat::Plain);
+        entry->bindString("name", Wt::WString::fromUTF8(track.name), Wt::TextFormat::Plain);
 
-        const Release::pointer release{ track->getRelease() };
-        const TrackId trackId{ track->getId() };
+        const TrackId trackId{ track.id };
 
-        const auto artists{ track->getArtistIds({TrackArtistLinkType::Artist}) };
-        if (!artists.empty())
+        if (!track.artists.empty())
         {
             entry->setCondition("if-has-artists", true);
-            entry->bindWidget("artists", Utils::createArtistDisplayNameWithAnchors(track->getArtistDisplayName(), artists));
-            entry->bindWidget("artists-md", Utils::createArtistDisplayNameWithAnchors(track->getArtistDisplayName(), artists));
+            entry->bindWidget("artists", Utils::createArtistDisplayNameWithAnchors(track.artistDisplayName, track.artists));
+            entry->bindWidget("artists-md", Utils::createArtistDisplayNameWithAnchors(track.artistDisplayName, track.artists));
         }
 
-        if (track->getRelease())
+        if (track.release)
         {
             entry->setCondition("if-has-release", true);
-            entry->bindWidget("release", Utils::createReleaseAnchor(track->getRelease()));
-            Wt::WAnchor* anchor{ entry->bindWidget("cover", Utils::createReleaseAnchor(release, false)) };
-            auto cover{ Utils::createCover(release->getId(), CoverResource::Size::Small) };
+            entry->bindWidget("release", Utils::createReleaseAnchor(*track.release));
+            Wt::WAnchor* anchor{ entry->bindWidget("cover", Utils::createReleaseAnchor(*track.release, false)) };
+            auto cover{ Utils::createCover(track.release->id, CoverResource::Size::Small) };
             cover->addStyleClass("Lms-cover-track Lms-cover-anchor"); // HACK
             anchor->setImage(std::move((cover)));
         }
@@ -188,7 +202,7 @@ namespace UserInterface::TrackListHelpers
             entry->bindWidget<Wt::WImage>("cover", std::move(cover));
         }
 
-        entry->bindString("duration", Utils::durationToString(track->getDuration()), Wt::TextFormat::Plain);
+        entry->bindString("duration", Utils::durationToString(track.duration), Wt::TextFormat::Plain);
 
         Wt::WPushButton* playBtn{ entry->bindNew<Wt::WPushButton>("play-btn", Wt::WString::tr("Lms.template.play-btn"), Wt::TextFormat::XHTML) };
         playBtn->clicked().connect([trackId, &playQueueController]
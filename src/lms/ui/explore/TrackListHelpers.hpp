@@ -34,11 +34,13 @@ namespace UserInterface
 {
 	class PlayQueueController;
 	class Filters;
+	struct TrackListEntryModel;
 }
 
 namespace UserInterface::TrackListHelpers
 {
 	void showTrackInfoModal(Database::TrackId trackId, Filters& filters);
 	std::unique_ptr<Wt::WWidget> createEntry(const Database::ObjectPtr<Database::Track>& track, PlayQueueController& playQueueController, Filters& filters);
+	std::unique_ptr<Wt::WWidget> createEntry(const TrackListEntryModel& track, PlayQueueController& playQueueController, Filters& filters);
 } // namespace UserInterface
 
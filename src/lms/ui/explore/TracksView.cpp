@@ -24,9 +24,11 @@
 #include "services/database/Session.hpp"
 #include "services/database/Track.hpp"
 #include "utils/Logger.hpp"
+#include "utils/Service.hpp"
 
 #include "common/InfiniteScrollingContainer.hpp"
 #include "explore/Filters.hpp"
+#include "explore/ListEntryModelCache.hpp"
 #include "explore/PlayQueueController.hpp"
 #include "explore/TrackListHelpers.hpp"
 #include "LmsApplication.hpp"
@@ -96,6 +98,10 @@ namespace UserInterface
             {
                 addSome();
             });
+        _container->setVirtualized(_maxLiveCount, [this](std::size_t first, std::size_t count)
+            {
+                return createEntries(Range{ first, count });
+            });
 
         filters.updated().connect([this]
             {
@@ -117,17 +123,32 @@ namespace UserInterface
         refreshView();
     }
 
+    void Tracks::releaseEntries()
+    {
+        // keep the collector as is, so that the same entries are reloaded
+        _container->reset();
+    }
+
+    std::size_t Tracks::getEntryCount()
+    {
+        return _container->getLiveCount();
+    }
+
     void Tracks::addSome()
     {
-        auto transaction{ LmsApp->getDbSession().createSharedTransaction() };
+        for (std::unique_ptr<Wt::WWidget>& entry : createEntries(Range{ _container->getCount(), _batchSize }))
+            _container->add(std::move(entry));
+    }
+
+    std::vector<std::unique_ptr<Wt::WWidget>> Tracks::createEntries(Range range)
+    {
+        const auto trackIds{ _trackCollector.get(range) };
 
-        const auto trackIds{ _trackCollector.get(Range {static_cast<std::size_t>(_container->getCount()), _batchSize}) };
+        std::vector<std::unique_ptr<Wt::WWidget>> entries;
+        for (const auto& track : Service<ListEntryModelCache>::get()->getTracks(LmsApp->getDbSession(), trackIds.results))
+            entries.push_back(TrackListHelpers::createEntry(*track, _playQueueController, _filters));
 
-        for (const TrackId trackId : trackIds.results)
-        {
-            if (const Track::pointer track{ Track::find(LmsApp->getDbSession(), trackId) })
-                _container->add(TrackListHelpers::createEntry(track, _playQueueController, _filters));
-        }
+        return entries;
     }
 
     std::vector<Database::TrackId> Tracks::getAllTracks()
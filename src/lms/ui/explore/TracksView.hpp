@@ -19,6 +19,9 @@
 
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include "services/database/Types.hpp"
 
 #include "common/Template.hpp"
@@ -35,15 +38,21 @@ namespace UserInterface
 		public:
 			Tracks(Filters& filters, PlayQueueController& playQueueController);
 
+			// Loaded entries are recreated on demand
+			void releaseEntries();
+			std::size_t getEntryCount();
+
 		private:
 			void refreshView();
 			void refreshView(TrackCollector::Mode mode);
 			void addSome();
+			std::vector<std::unique_ptr<Wt::WWidget>> createEntries(Database::Range range);
 
 			std::vector<Database::TrackId> getAllTracks();
 
 			static constexpr TrackCollector::Mode _defaultMode {TrackCollector::Mode::Random};
 			static constexpr std::size_t _batchSize {6};
+			static constexpr std::size_t _maxLiveCount {240};
 			static constexpr std::size_t _maxCount {8000};
 
 			Filters&					_filters;
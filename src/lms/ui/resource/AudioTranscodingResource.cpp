@@ -148,6 +148,8 @@ namespace UserInterface
 
                 parameters.inputParameters.trackPath = track->getPath();
                 parameters.inputParameters.duration = track->getDuration();
+                parameters.inputParameters.codec = Av::getDecodingCodec(track->getAudioCodec());
+                parameters.inputParameters.bitrate = track->getBitrate();
             }
 
             parameters.outputParameters.stripMetadata = true;
@@ -178,8 +180,17 @@ namespace UserInterface
             Wt::Http::ResponseContinuation* continuation{ request.continuation() };
             if (!continuation)
             {
+                if (request.getParameter("prepare"))
+                {
+                    // hint that this track will be played next: start the transcoding ahead of time
+                    if (const auto& parameters{ readTranscodingParameters(request) })
+                        Av::Transcoding::prepareResourceHandler(parameters->inputParameters, parameters->outputParameters, false /* estimate content length */, LmsApp->getUserId().toString());
+                    response.setStatus(204);
+                    return;
+                }
+
                 if (const auto& parameters{ readTranscodingParameters(request) })
-                    resourceHandler = Av::Transcoding::createResourceHandler(parameters->inputParameters, parameters->outputParameters, false /* estimate content length */);
+                    resourceHandler = Av::Transcoding::createResourceHandler(parameters->inputParameters, parameters->outputParameters, false /* estimate content length */, LmsApp->getUserId().toString());
             }
             else
             {
@@ -193,6 +204,11 @@ namespace UserInterface
                     continuation->setData(resourceHandler);
             }
         }
+        catch (const Av::TooManyTranscodingsException& e)
+        {
+            LOG(WARNING) << "Cannot transcode: " << e.what();
+            response.setStatus(503);
+        }
         catch (const Av::Exception& e)
         {
             LOG(ERROR) << "Caught Av exception: " << e.what();
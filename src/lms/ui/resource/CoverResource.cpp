@@ -19,11 +19,16 @@
 
 #include "CoverResource.hpp"
 
+#include <iomanip>
+#include <sstream>
+
 #include <Wt/WApplication.h>
 #include <Wt/Http/Response.h>
 
+#include "image/IRawImage.hpp"
 #include "services/cover/ICoverService.hpp"
 #include "services/database/Track.hpp"
+#include "utils/Crc32Calculator.hpp"
 #include "utils/Exception.hpp"
 #include "utils/Logger.hpp"
 #include "utils/Service.hpp"
@@ -59,6 +64,31 @@ namespace UserInterface {
         return url() + "&trackid=" + trackId.toString() + "&size=" + std::to_string(static_cast<std::size_t>(size));
     }
 
+    namespace
+    {
+        Image::EncodingFormat getEncodingFormat(const Wt::Http::Request& request)
+        {
+            // browsers advertise WebP support in their Accept header
+            if (request.headerValue("Accept").find("image/webp") != std::string::npos
+                && Image::isEncodingFormatSupported(Image::EncodingFormat::WebP))
+            {
+                return Image::EncodingFormat::WebP;
+            }
+
+            return Image::EncodingFormat::JPEG;
+        }
+
+        std::string computeETag(const Image::IEncodedImage& cover)
+        {
+            ::Utils::Crc32Calculator crc;
+            crc.processBytes(cover.getData(), cover.getDataSize());
+
+            std::ostringstream oss;
+            oss << '"' << std::hex << std::setfill('0') << std::setw(8) << crc.getResult() << '-' << cover.getDataSize() << '"';
+            return oss.str();
+        }
+    }
+
     void CoverResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
     {
         // Retrieve parameters
@@ -80,6 +110,7 @@ namespace UserInterface {
             return;
         }
 
+        const Image::EncodingFormat format{ getEncodingFormat(request) };
         std::shared_ptr<Image::IEncodedImage> cover;
 
         if (trackIdStr)
@@ -93,9 +124,9 @@ namespace UserInterface {
                 return;
             }
 
-            cover = Service<Cover::ICoverService>::get()->getFromTrack(*trackId, *size);
+            cover = Service<Cover::ICoverService>::get()->getFromTrack(*trackId, *size, format);
             if (!cover)
-                cover = Service<Cover::ICoverService>::get()->getDefault(*size);
+                cover = Service<Cover::ICoverService>::get()->getDefault(*size, format);
         }
         else if (releaseIdStr)
         {
@@ -105,9 +136,9 @@ namespace UserInterface {
             if (!releaseId)
                 return;
 
-            cover = Service<Cover::ICoverService>::get()->getFromRelease(*releaseId, *size);
+            cover = Service<Cover::ICoverService>::get()->getFromRelease(*releaseId, *size, format);
             if (!cover)
-                cover = Service<Cover::ICoverService>::get()->getDefault(*size);
+                cover = Service<Cover::ICoverService>::get()->getDefault(*size, format);
         }
         else
         {
@@ -115,6 +146,19 @@ namespace UserInterface {
             return;
         }
 
+        // URLs are versioned by setChanged() on each scan with changes, so a given URL always maps to the same cover
+        // Private: the resource is bound to an authenticated session
+        const std::string etag{ computeETag(*cover) };
+        response.addHeader("Cache-Control", "private, max-age=31536000, immutable");
+        response.addHeader("ETag", etag);
+        response.addHeader("Vary", "Accept");
+
+        if (request.headerValue("If-None-Match") == etag)
+        {
+            response.setStatus(304);
+            return;
+        }
+
         response.setMimeType(std::string{ cover->getMimeType() });
 
         response.out().write(reinterpret_cast<const char*>(cover->getData()), cover->getDataSize());
@@ -46,23 +46,25 @@ namespace UserInterface
     {
         try
         {
-            std::shared_ptr<Zip::IZipper> zipper;
+            std::shared_ptr<IResourceHandler> zipperResourceHandler;
 
             // First, see if this request is for a continuation
             if (Wt::Http::ResponseContinuation * continuation{ request.continuation() })
-                zipper = Wt::cpp17::any_cast<std::shared_ptr<Zip::IZipper>>(continuation->data());
+                zipperResourceHandler = Wt::cpp17::any_cast<std::shared_ptr<IResourceHandler>>(continuation->data());
             else
             {
-                zipper = createZipper();
-                response.setMimeType("application/zip");
-            }
+                std::unique_ptr<Zip::IZipper> zipper{ createZipper() };
+                if (!zipper)
+                {
+                    response.setStatus(404);
+                    return;
+                }
 
-            zipper->writeSome(response.out());
-            if (!zipper->isComplete())
-            {
-                auto* continuation{ response.createContinuation() };
-                continuation->setData(zipper);
+                zipperResourceHandler = createZipperResourceHandler(std::move(zipper));
             }
+
+            if (auto* continuation{ zipperResourceHandler->processRequest(request, response) })
+                continuation->setData(zipperResourceHandler);
         }
         catch (Zip::Exception& exception)
         {
@@ -156,7 +158,8 @@ namespace UserInterface
                 files.emplace_back(Zip::Entry{ fileName, track->getPath() });
             }
 
-            return Zip::createArchiveZipper(files);
+            // audio files are already compressed
+            return Zip::createStoreZipper(files);
         }
     }
 
@@ -17,10 +17,19 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <filesystem>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <stdexcept>
 #include <stdlib.h>
+#include <sys/resource.h>
+#include <thread>
+#include <vector>
 
 #include <boost/program_options.hpp>
 
@@ -29,6 +38,7 @@
 #include "services/database/Session.hpp"
 #include "services/database/Track.hpp"
 #include "services/cover/ICoverService.hpp"
+#include "image/IRawImage.hpp"
 #include "utils/IConfig.hpp"
 #include "utils/Logger.hpp"
 #include "utils/Service.hpp"
@@ -49,10 +59,133 @@ dumpTrackCovers(Database::Session& session, Image::ImageSize width)
 	for (const Database::TrackId trackId : trackIds.results)
 	{
 		std::cout << "Getting cover for track id " << trackId.toString() << std::endl;
-		Service<Cover::ICoverService>::get()->getFromTrack(trackId, width);
+		Service<Cover::ICoverService>::get()->getFromTrack(trackId, width, Image::EncodingFormat::JPEG);
 	}
 }
 
+struct CoverRequest
+{
+	Database::ReleaseId releaseId;
+	Image::ImageSize width;
+};
+
+// One request per line: "<release id> <size>", empty lines and lines starting with '#' are ignored
+static
+std::vector<CoverRequest>
+readCoverRequests(const std::filesystem::path& requestFile)
+{
+	std::ifstream ifs {requestFile};
+	if (!ifs)
+		throw std::runtime_error {"Cannot open request file '" + requestFile.string() + "'"};
+
+	std::vector<CoverRequest> requests;
+
+	std::string line;
+	while (std::getline(ifs, line))
+	{
+		if (line.empty() || line.front() == '#')
+			continue;
+
+		std::istringstream iss {line};
+		Database::ReleaseId::ValueType releaseId;
+		Image::ImageSize width;
+		if (!(iss >> releaseId >> width))
+			throw std::runtime_error {"Invalid request line '" + line + "'"};
+
+		requests.push_back(CoverRequest {releaseId, width});
+	}
+
+	return requests;
+}
+
+static
+std::vector<CoverRequest>
+getAllReleaseCoverRequests(Database::Session& session, Image::ImageSize width)
+{
+	std::vector<CoverRequest> requests;
+
+	auto transaction {session.createSharedTransaction()};
+	for (const Database::ReleaseId releaseId : Database::Release::findIds(session, Database::Release::FindParameters {}).results)
+		requests.push_back(CoverRequest {releaseId, width});
+
+	return requests;
+}
+
+static
+void
+benchmarkCovers(const std::vector<CoverRequest>& requests, std::size_t threadCount, std::size_t repeatCount, Image::EncodingFormat format)
+{
+	using Clock = std::chrono::steady_clock;
+
+	Cover::ICoverService& coverService {*Service<Cover::ICoverService>::get()};
+
+	std::atomic<std::size_t> nextRequestIndex {};
+	const std::size_t totalRequestCount {requests.size() * repeatCount};
+
+	std::vector<std::vector<std::chrono::microseconds>> latenciesPerThread(threadCount);
+	std::atomic<std::size_t> servedBytes {};
+	std::atomic<std::size_t> missingCovers {};
+
+	const Cover::ICoverService::CacheStats statsBefore {coverService.getCacheStats()};
+	const Clock::time_point start {Clock::now()};
+
+	std::vector<std::thread> threads;
+	for (std::size_t threadIndex {}; threadIndex < threadCount; ++threadIndex)
+	{
+		threads.emplace_back([&, threadIndex]
+		{
+			std::vector<std::chrono::microseconds>& latencies {latenciesPerThread[threadIndex]};
+
+			for (std::size_t requestIndex {nextRequestIndex++}; requestIndex < totalRequestCount; requestIndex = nextRequestIndex++)
+			{
+				const CoverRequest& request {requests[requestIndex % requests.size()]};
+
+				const Clock::time_point requestStart {Clock::now()};
+				const std::shared_ptr<Image::IEncodedImage> cover {coverService.getFromRelease(request.releaseId, request.width, format)};
+				latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - requestStart));
+
+				if (cover)
+					servedBytes += cover->getDataSize();
+				else
+					missingCovers++;
+			}
+		});
+	}
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	const std::chrono::milliseconds duration {std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start)};
+	const Cover::ICoverService::CacheStats statsAfter {coverService.getCacheStats()};
+
+	std::vector<std::chrono::microseconds> latencies;
+	for (const auto& threadLatencies : latenciesPerThread)
+		latencies.insert(std::end(latencies), std::cbegin(threadLatencies), std::cend(threadLatencies));
+	std::sort(std::begin(latencies), std::end(latencies));
+
+	auto getPercentile {[&](unsigned percentile)
+	{
+		if (latencies.empty())
+			return std::chrono::microseconds {};
+
+		return latencies[std::min(latencies.size() - 1, latencies.size() * percentile / 100)];
+	}};
+
+	const std::size_t hits {statsAfter.hits - statsBefore.hits};
+	const std::size_t misses {statsAfter.misses - statsBefore.misses};
+
+	struct rusage usage {};
+	getrusage(RUSAGE_SELF, &usage);
+
+	std::cout << "Requests: " << latencies.size() << " (" << missingCovers << " without cover), threads = " << threadCount << std::endl;
+	std::cout << "Duration: " << duration.count() << " ms (" << std::fixed << std::setprecision(1) << (duration.count() ? latencies.size() * 1000.f / duration.count() : 0.f) << " req/s)" << std::endl;
+	std::cout << "Latency: p50 = " << getPercentile(50).count() << " us, p99 = " << getPercentile(99).count() << " us, max = " << (latencies.empty() ? 0 : latencies.back().count()) << " us" << std::endl;
+	std::cout << "Memory cache: hits = " << hits << ", misses = " << misses << ", hit rate = " << std::setprecision(1) << (hits + misses ? hits * 100.f / (hits + misses) : 0.f) << "%, evictions = " << (statsAfter.evictions - statsBefore.evictions) << std::endl;
+	std::cout << "Served bytes: " << servedBytes << std::endl;
+	const Image::BufferPoolStats bufferPoolStats {Image::getBufferPoolStats()};
+	std::cout << "Image buffer pool: high-water mark = " << bufferPoolStats.highWaterMark << " bytes, pooled = " << bufferPoolStats.pooledBytes << " bytes" << std::endl;
+	std::cout << "Peak RSS: " << usage.ru_maxrss << " KiB" << std::endl;
+}
 
 int main(int argc, char *argv[])
 {
@@ -72,6 +205,10 @@ int main(int argc, char *argv[])
         ("tracks,t", "dump covers for tracks")
 		("size,s", po::value<unsigned>()->default_value(512), "Requested cover size")
 		("quality,q", po::value<unsigned>()->default_value(75), "JPEG quality (1-100)")
+		("benchmark,b", po::value<std::string>()->implicit_value(""), "replay cover requests and report latency and cache stats. Optional request file, one '<release id> <size>' per line (defaults to all releases at the requested size)")
+		("threads,j", po::value<unsigned>()->default_value(1), "Number of threads used to replay requests (benchmark)")
+		("repeat,r", po::value<unsigned>()->default_value(1), "Number of times the requests are replayed (benchmark)")
+		("webp", "Request covers in WebP format (benchmark)")
         ;
 
         po::variables_map vm;
@@ -93,6 +230,20 @@ int main(int argc, char *argv[])
 
 		if (vm.count("tracks"))
 			dumpTrackCovers(session, vm["size"].as<unsigned>());
+
+		if (vm.count("benchmark"))
+		{
+			const std::string requestFile {vm["benchmark"].as<std::string>()};
+			const std::vector<CoverRequest> requests {requestFile.empty() ? getAllReleaseCoverRequests(session, vm["size"].as<unsigned>()) : readCoverRequests(requestFile)};
+			if (requests.empty())
+				throw std::runtime_error {"No request to replay"};
+
+			const Image::EncodingFormat format {vm.count("webp") ? Image::EncodingFormat::WebP : Image::EncodingFormat::JPEG};
+			if (!Image::isEncodingFormatSupported(format))
+				throw std::runtime_error {"Requested format is not supported"};
+
+			benchmarkCovers(requests, std::max(1U, vm["threads"].as<unsigned>()), std::max(1U, vm["repeat"].as<unsigned>()), format);
+		}
 	}
 	catch( std::exception& e)
 	{
@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "services/database/Artist.hpp"
+#include "services/database/Cluster.hpp"
+#include "services/database/Db.hpp"
+#include "services/database/Listen.hpp"
+#include "services/database/Release.hpp"
+#include "services/database/Session.hpp"
+#include "services/database/Track.hpp"
+#include "services/database/TrackList.hpp"
+#include "services/database/User.hpp"
+
+#include "utils/Random.hpp"
+#include "utils/Service.hpp"
+#include "utils/StreamLogger.hpp"
+#include "utils/String.hpp"
+
+namespace
+{
+    using namespace Database;
+
+    constexpr Range defaultRange{ 0, 50 };
+
+    // A database to run the queries on, along with values sampled from it to build the queries
+    struct BenchContext
+    {
+        BenchContext(const std::filesystem::path& dbPath)
+            : name{ dbPath.stem().string() }
+            , db{ dbPath }
+            , session{ db }
+        {}
+
+        const std::string name;
+        Db db;
+        Session session;
+        std::vector<ClusterId> clusterIds;
+        std::vector<ArtistId> artistIds;
+        std::vector<std::string> keywords; // words taken from release names
+        std::vector<TrackId> trackIds;
+        UserId userId; // first user having listens
+        TrackListId trackListId;
+        std::size_t trackCount{};
+    };
+
+    void sampleDatabase(BenchContext& context)
+    {
+        auto transaction{ context.session.createSharedTransaction() };
+
+        context.trackCount = Track::getCount(context.session);
+        if (context.trackCount == 0)
+            throw std::runtime_error{ "Database '" + context.name + "' has no track, use lms-db-generator to fill it" };
+
+        context.clusterIds = Cluster::findIds(context.session, Cluster::FindParameters{}.setRange(Range{ 0, 100 })).results;
+        context.artistIds = Artist::findIds(context.session, Artist::FindParameters{}.setSortMethod(ArtistSortMethod::Random).setRange(Range{ 0, 100 })).results;
+        context.trackIds = Track::findIds(context.session, Track::FindParameters{}.setSortMethod(TrackSortMethod::Random).setRange(Range{ 0, 100 })).results;
+
+        for (const Release::pointer& release : Release::find(context.session, Release::FindParameters{}.setSortMethod(ReleaseSortMethod::Random).setRange(Range{ 0, 100 })).results)
+        {
+            for (std::string_view word : StringUtils::splitString(release->getName(), " "))
+            {
+                if (word.size() >= 3)
+                    context.keywords.emplace_back(word);
+            }
+        }
+        if (context.keywords.empty())
+            context.keywords.push_back("the");
+
+        for (const UserId userId : User::find(context.session, User::FindParameters{}.setRange(Range{ 0, 20 })).results)
+        {
+            if (!Listen::getRecentTracks(context.session, userId, ScrobblingBackend::Internal, {}, Range{ 0, 1 }).results.empty())
+            {
+                context.userId = userId;
+                break;
+            }
+        }
+
+        const auto trackListIds{ TrackList::find(context.session, TrackList::FindParameters{}.setType(TrackListType::Playlist).setRange(Range{ 0, 1 })).results };
+        if (!trackListIds.empty())
+            context.trackListId = trackListIds.front();
+    }
+
+    template <typename T>
+    const T& pickRandom(const std::vector<T>& values)
+    {
+        return *Random::pickRandom(values);
+    }
+
+    using BenchFunc = std::function<void(BenchContext&)>;
+
+    void runBench(benchmark::State& state, BenchContext& context, const BenchFunc& func)
+    {
+        auto transaction{ context.session.createSharedTransaction() };
+
+        for (auto _ : state)
+            func(context);
+
+        state.counters["tracks"] = static_cast<double>(context.trackCount);
+    }
+
+    enum class Requirement
+    {
+        None,
+        Artists,
+        Clusters,
+        User,
+        TrackList,
+    };
+
+    struct Bench
+    {
+        const char* name;
+        Requirement requirement;
+        BenchFunc func;
+    };
+
+    bool isRequirementMet(const BenchContext& context, Requirement requirement)
+    {
+        switch (requirement)
+        {
+        case Requirement::None:         return true;
+        case Requirement::Artists:      return !context.artistIds.empty();
+        case Requirement::Clusters:     return !context.clusterIds.empty();
+        case Requirement::User:         return context.userId.isValid();
+        case Requirement::TrackList:    return context.trackListId.isValid();
+        }
+
+        return false;
+    }
+
+    const std::vector<Bench>& getBenches()
+    {
+        static const std::vector<Bench> benches
+        {
+            { "Track::find/clusters", Requirement::Clusters, [](BenchContext& context)
+                {
+                    benchmark::DoNotOptimize(Track::findIds(context.session, Track::FindParameters{}.setClusters({ pickRandom(context.clusterIds) }).setRange(defaultRange)));
+                } },
+            { "Track::find/2clusters", Requirement::Clusters, [](BenchContext& context)
+                {
+                    benchmark::DoNotOptimize(Track::findIds(context.session, Track::FindParameters{}.setClusters({ pickRandom(context.clusterIds), pickRandom(context.clusterIds) }).setRange(defaultRange)));
+                } },
+            { "Track::find/keyword", Requirement::None, [](BenchContext& context)
+                {
+                    benchmark::DoNotOptimize(Track::findIds(context.session, Track::FindParameters{}.setKeywords({ pickRandom(context.keywords) }).setRange(defaultRange)));
+                } },
+            { "Track::find/random", Requirement::None, [](BenchContext& context)
+                {
+                    benchmark::DoNotOptimize(Track::findIds(context.session, Track::FindParameters{}.setSortMethod(TrackSortMethod::Random).setRange(defaultRange)));
+                } },
+            { "Track::find/lastWritten", Requirement::None, [](BenchContext& context)
+                {
+                    benchmark::DoNotOptimize(Track::findIds(context.session, Track::FindParameters{}.setSortMethod(TrackSortMethod::LastWritten).setRange(defaultRange)));
+                } },
+            { "Track::find/deepOffset", Requirement::None, [](BenchContext& context)
+                {
+                    benchmark::DoNotOptimize(Track::findIds(context.session, Track::FindParameters{}.setSortMethod(TrackSortMethod::Id).setRange(Range{ context.trackCount * 9 / 10, defaultRange.size })));
+                } },
+            { "Track::find/artist", Requirement::Artists, [](BenchContext& context)
+                {
+                    benchmark::DoNotOptimize(Track::findIds(context.session, Track::FindParameters{}.setArtist(pickRandom(context.artistIds)).setSortMethod(TrackSortMethod::Name).setRange(defaultRange)));
+                } },
+            { "Track::find/starred", Requirement::User, [](BenchContext& context)
+                {
+                    benchmark::DoNotOptimize(Track::findIds(context.session, Track::FindParameters{}.setStarringUser(context.userId, FeedbackBackend::Internal).setSortMethod(TrackSortMethod::StarredDateDesc).setRange(defaultRange)));
+                } },
+            { "Track::findSimilarTrackIds", Requirement::None, [](BenchContext& context)
+                {
+                    benchmark::DoNotOptimize(Track::findSimilarTrackIds(context.session, { pickRandom(context.trackIds) }, defaultRange));
+                } },
+            { "Release::find/random", Requirement::None, [](BenchContext& context)
+                {
+                    benchmark::DoNotOptimize(Release::findIds(context.session, Release::FindParameters{}.setSortMethod(ReleaseSortMethod::Random).setRange(defaultRange)));
+                } },
+            { "Release::find/date", Requirement::None, [](BenchContext& context)
+                {
+                    benchmark::DoNotOptimize(Release::findIds(context.session, Release::FindParameters{}.setSortMethod(ReleaseSortMethod::Date).setRange(defaultRange)));
+                } },
+            { "Release::find/clusters", Requirement::Clusters, [](BenchContext& context)
+                {
+                    benchmark::DoNotOptimize(Release::findIds(context.session, Release::FindParameters{}.setClusters({ pickRandom(context.clusterIds) }).setSortMethod(ReleaseSortMethod::Name).setRange(defaultRange)));
+                } },
+            { "Artist::find/keyword", Requirement::None, [](BenchContext& context)
+                {
+                    benchmark::DoNotOptimize(Artist::findIds(context.session, Artist::FindParameters{}.setKeywords({ pickRandom(context.keywords) }).setRange(defaultRange)));
+                } },
+            { "Artist::find/byName", Requirement::None, [](BenchContext& context)
+                {
+                    benchmark::DoNotOptimize(Artist::findIds(context.session, Artist::FindParameters{}.setLinkType(TrackArtistLinkType::ReleaseArtist).setSortMethod(ArtistSortMethod::BySortName).setRange(defaultRange)));
+                } },
+            { "Listen::getTopArtists", Requirement::User, [](BenchContext& context)
+                {
+                    benchmark::DoNotOptimize(Listen::getTopArtists(context.session, context.userId, ScrobblingBackend::Internal, {}, TrackArtistLinkType::Artist, defaultRange));
+                } },
+            { "Listen::getTopReleases", Requirement::User, [](BenchContext& context)
+                {
+                    benchmark::DoNotOptimize(Listen::getTopReleases(context.session, context.userId, ScrobblingBackend::Internal, {}, defaultRange));
+                } },
+            { "Listen::getRecentTracks", Requirement::User, [](BenchContext& context)
+                {
+                    benchmark::DoNotOptimize(Listen::getRecentTracks(context.session, context.userId, ScrobblingBackend::Internal, {}, defaultRange));
+                } },
+            { "Cluster::computeTrackCount", Requirement::Clusters, [](BenchContext& context)
+                {
+                    benchmark::DoNotOptimize(Cluster::computeTrackCount(context.session, pickRandom(context.clusterIds)));
+                } },
+            { "TrackList::getSimilarTracks", Requirement::TrackList, [](BenchContext& context)
+                {
+                    const TrackList::pointer trackList{ TrackList::find(context.session, context.trackListId) };
+                    benchmark::DoNotOptimize(trackList->getSimilarTracks(0, defaultRange.size));
+                } },
+        };
+
+        return benches;
+    }
+
+    void registerBenches(BenchContext& context)
+    {
+        for (const Bench& bench : getBenches())
+        {
+            if (!isRequirementMet(context, bench.requirement))
+                continue;
+
+            const std::string name{ std::string{ bench.name } + "/" + context.name };
+            benchmark::RegisterBenchmark(name.c_str(), [&context, &bench](benchmark::State& state) { runBench(state, context, bench.func); })
+                ->Unit(benchmark::kMicrosecond);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        // log to stderr, so that the benchmark output stays parsable
+        Service<Logger> logger{ std::make_unique<StreamLogger>(std::cerr, EnumSet<Severity>{ Severity::FATAL, Severity::ERROR, Severity::WARNING }) };
+
+        benchmark::Initialize(&argc, argv);
+
+        // remaining arguments are the databases to bench, typically generated by lms-db-generator at several sizes
+        if (argc < 2)
+        {
+            std::cerr << "Usage: " << argv[0] << " [benchmark options] <db file>..." << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        std::vector<std::unique_ptr<BenchContext>> contexts;
+        for (int i{ 1 }; i < argc; ++i)
+        {
+            const std::filesystem::path dbPath{ argv[i] };
+            if (!std::filesystem::exists(dbPath))
+                throw std::runtime_error{ "File '" + dbPath.string() + "' does not exist!" };
+
+            auto& context{ contexts.emplace_back(std::make_unique<BenchContext>(dbPath)) };
+            sampleDatabase(*context);
+            registerBenches(*context);
+        }
+
+        benchmark::RunSpecifiedBenchmarks();
+        benchmark::Shutdown();
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -17,24 +17,37 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cmath>
 #include <iostream>
 #include <iomanip>
 #include <filesystem>
+#include <iterator>
 #include <optional>
 #include <stdexcept>
 #include <stdlib.h>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include <boost/program_options.hpp>
 
 #include "services/database/Db.hpp"
 #include "services/database/Artist.hpp"
 #include "services/database/Cluster.hpp"
+#include "services/database/Listen.hpp"
 #include "services/database/Release.hpp"
 #include "services/database/Session.hpp"
+#include "services/database/StarredArtist.hpp"
+#include "services/database/StarredRelease.hpp"
+#include "services/database/StarredTrack.hpp"
 #include "services/database/Track.hpp"
 #include "services/database/TrackArtistLink.hpp"
+#include "services/database/TrackFeatures.hpp"
+#include "services/database/TrackList.hpp"
+#include "services/database/User.hpp"
 
 #include "utils/IConfig.hpp"
 #include "utils/Random.hpp"
@@ -46,82 +59,298 @@ namespace
     struct GeneratorParameters
     {
         std::size_t releaseCount{ 100 };
-        std::size_t trackCountPerRelease{ 10 };
+        std::size_t trackCountPerRelease{ 10 }; // mean value
+        std::size_t artistCount{ 50 };
+        double sizeZipfExponent{ 1 }; // distribution of the releases over the artists, and of the listens over the tracks
         float compilationRatio{ 0.1 };
+        float composerRatio{ 0.3 };
+        float performerRatio{ 0.1 };
         std::size_t genreCountPerTrack{ 3 };
         std::size_t moodCountPerTrack{ 3 };
         std::size_t genreCount{ 50 };
         std::size_t moodCount{ 25 };
+        std::size_t userCount{};
+        std::size_t listenCountPerUser{ 1000 };
+        std::size_t starredCountPerUser{ 50 };
+        std::size_t trackListCountPerUser{ 5 };
+        std::size_t trackCountPerTrackList{ 50 };
+        bool generateFeatures{};
+        std::size_t batchSize{ 1000 }; // number of releases or users generated in a single transaction
         std::filesystem::path trackPath;
     };
 
+    // Samples ranks in [0, count) following a Zipf law: low ranks are far more likely than high ones
+    class ZipfDistribution
+    {
+    public:
+        ZipfDistribution(std::size_t count, double exponent)
+        {
+            _cumulativeWeights.reserve(count);
+
+            double sum{};
+            for (std::size_t rank{ 1 }; rank <= count; ++rank)
+            {
+                sum += 1 / std::pow(static_cast<double>(rank), exponent);
+                _cumulativeWeights.push_back(sum);
+            }
+        }
+
+        std::size_t operator()()
+        {
+            const double value{ Random::getRealRandom(0., _cumulativeWeights.back()) };
+            const auto it{ std::upper_bound(std::cbegin(_cumulativeWeights), std::cend(_cumulativeWeights), value) };
+            return std::min(static_cast<std::size_t>(std::distance(std::cbegin(_cumulativeWeights), it)), _cumulativeWeights.size() - 1);
+        }
+
+    private:
+        std::vector<double> _cumulativeWeights;
+    };
+
+    // Names made of a few common words, so that keyword searches match realistic proportions of the library
+    class NameGenerator
+    {
+    public:
+        std::string generate(std::size_t minWordCount, std::size_t maxWordCount)
+        {
+            std::string name;
+
+            const std::size_t wordCount{ static_cast<std::size_t>(Random::getRandom(static_cast<int>(minWordCount), static_cast<int>(maxWordCount))) };
+            for (std::size_t i{}; i < wordCount; ++i)
+            {
+                if (!name.empty())
+                    name += ' ';
+                name += _words[_wordDistribution()];
+            }
+
+            return name;
+        }
+
+    private:
+        static constexpr std::array _words
+        {
+            "the", "love", "night", "blue", "day", "heart", "time", "world", "dream", "light", "life", "fire", "rain", "sun", "dark", "soul", "home", "road",
+            "song", "girl", "moon", "gold", "black", "summer", "city", "river", "wild", "stone", "star", "eyes", "angel", "ghost", "sky", "ocean", "red", "king",
+            "queen", "shadow", "winter", "street", "electric", "silver", "dance", "paradise", "memory", "storm", "heaven", "lonely", "broken", "golden", "forever",
+            "midnight", "crystal", "velvet", "echo", "thunder", "garden", "desert", "highway", "mirror", "secret", "empire", "kingdom", "machine", "planet", "rebel",
+            "sugar", "tiger", "wolf", "ballad", "blues", "cathedral", "diamond", "envy", "falcon", "helix", "island", "jungle", "lantern", "marble", "nomad", "orchid",
+            "prism", "quartz", "riot", "saffron", "tundra", "utopia", "vortex", "willow", "zenith", "amber", "bliss", "cobalt", "dusk", "ember", "fable", "glacier",
+        };
+        ZipfDistribution _wordDistribution{ _words.size(), 1 };
+    };
+
     struct GenerationContext
     {
         Database::Session& session;
+        NameGenerator nameGenerator;
         std::vector<Database::Cluster::pointer> genres;
         std::vector<Database::Cluster::pointer> moods;
+        std::vector<Database::Artist::pointer> artists; // sorted by popularity
+        Database::Artist::pointer variousArtists; // release artist of the compilations
+        std::vector<Database::TrackId> trackIds; // sorted by popularity
+        std::vector<Database::ReleaseId> releaseIds;
         GenerationContext(Database::Session& _session) : session{ _session } {}
     };
 
+    bool randomBool(float ratio)
+    {
+        return Random::getRealRandom(0.f, 1.f) < ratio;
+    }
+
     Database::Cluster::pointer generateCluster(Database::Session& session, Database::ClusterType::pointer clusterType)
     {
         const std::string clusterName{ clusterType->getName() + "-" + std::string{ UUID::generate().getAsString() } };
         return session.create<Database::Cluster>(clusterType, clusterName);
     }
 
-    Database::Artist::pointer generateArtist(Database::Session& session)
+    Database::Artist::pointer generateArtist(GenerationContext& context)
     {
         const UUID artistMBID{ UUID::generate() };
-        const std::string artistName{ "Artist-" + std::string{ UUID::generate().getAsString() } };
-        return session.create<Database::Artist>(artistName, artistMBID);
+        return context.session.create<Database::Artist>(context.nameGenerator.generate(1, 3), artistMBID);
     }
 
-    void generateRelease(const GeneratorParameters& params, GenerationContext& context)
+    Database::FeatureValuesMap generateFeatures()
+    {
+        // default features used by the features engine, with their dimensions
+        static const std::array<std::pair<const char*, std::size_t>, 5> features
+        {
+            {
+                { "lowlevel.spectral_energyband_high.mean", 1 },
+                { "lowlevel.spectral_rolloff.median", 1 },
+                { "lowlevel.spectral_contrast_valleys.var", 6 },
+                { "lowlevel.erbbands.mean", 40 },
+                { "lowlevel.gfcc.mean", 13 },
+            }
+        };
+
+        Database::FeatureValuesMap res;
+        for (const auto& [name, dimension] : features)
+        {
+            Database::FeatureValues& values{ res[name] };
+            values.reserve(dimension);
+            for (std::size_t i{}; i < dimension; ++i)
+                values.push_back(Random::getRealRandom(-1., 1.));
+        }
+
+        return res;
+    }
+
+    template <typename T>
+    std::vector<T> pickRandomDistinct(const std::vector<T>& values, std::size_t count)
+    {
+        std::vector<T> res;
+        std::sample(std::cbegin(values), std::cend(values), std::back_inserter(res), count, Random::getRandGenerator());
+        return res;
+    }
+
+    void generateRelease(const GeneratorParameters& params, GenerationContext& context, ZipfDistribution& artistDistribution)
     {
         using namespace Database;
 
         const UUID releaseMBID{ UUID::generate() };
-        const std::string releaseName{ "Release-" + std::string{ UUID::generate().getAsString() } };
-        Release::pointer release{ context.session.create<Release>(releaseName, releaseMBID) };
+        Release::pointer release{ context.session.create<Release>(context.nameGenerator.generate(1, 4), releaseMBID) };
+        context.releaseIds.push_back(release->getId());
 
-        Artist::pointer artist{ generateArtist(context.session) };
+        const bool isCompilation{ randomBool(params.compilationRatio) };
+        const Artist::pointer releaseArtist{ context.artists[artistDistribution()] };
 
-        for (std::size_t i{}; i < params.trackCountPerRelease; ++i)
+        const std::size_t minTrackCount{ std::max<std::size_t>(1, params.trackCountPerRelease / 2) };
+        const std::size_t trackCount{ static_cast<std::size_t>(Random::getRandom(static_cast<int>(minTrackCount), static_cast<int>(std::max(minTrackCount, params.trackCountPerRelease * 3 / 2)))) };
+
+        for (std::size_t i{}; i < trackCount; ++i)
         {
             Track::pointer track{ context.session.create<Track>(params.trackPath) };
 
-            track.modify()->setName("Track-" + std::string{ UUID::generate().getAsString() });
+            track.modify()->setName(context.nameGenerator.generate(1, 5));
             track.modify()->setDiscNumber(1);
-            track.modify()->setTrackNumber(i);
-            track.modify()->setDuration(std::chrono::seconds{ Random::getRandom(30, 300) });
+            track.modify()->setTrackNumber(i + 1);
+            track.modify()->setDuration(std::chrono::seconds{ Random::getRandom(30, 600) });
             track.modify()->setRelease(release);
             track.modify()->setTrackMBID(UUID::generate());
             track.modify()->setRecordingMBID(UUID::generate());
-            track.modify()->setTotalTrack(params.trackCountPerRelease);
+            track.modify()->setTotalTrack(trackCount);
+            track.modify()->setTrackReplayGain(Random::getRealRandom(-12.f, 3.f));
+            track.modify()->setReleaseReplayGain(Random::getRealRandom(-12.f, 3.f));
+
+            const Artist::pointer trackArtist{ isCompilation ? context.artists[artistDistribution()] : releaseArtist };
+            TrackArtistLink::create(context.session, track, trackArtist, TrackArtistLinkType::Artist);
+            TrackArtistLink::create(context.session, track, isCompilation ? context.variousArtists : releaseArtist, TrackArtistLinkType::ReleaseArtist);
+
+            if (randomBool(params.composerRatio))
+                TrackArtistLink::create(context.session, track, context.artists[artistDistribution()], TrackArtistLinkType::Composer);
+            if (randomBool(params.performerRatio))
+            {
+                static constexpr std::array<std::string_view, 5> roles{ "vocals", "guitar", "bass", "drums", "piano" };
+                TrackArtistLink::create(context.session, track, context.artists[artistDistribution()], TrackArtistLinkType::Performer, *Random::pickRandom(roles));
+            }
+
+            std::vector<ObjectPtr<Cluster>> clusters{ pickRandomDistinct(context.genres, params.genreCountPerTrack) };
+            for (const ObjectPtr<Cluster>& mood : pickRandomDistinct(context.moods, params.moodCountPerTrack))
+                clusters.push_back(mood);
+            track.modify()->setClusters(clusters);
 
-            TrackArtistLink::create(context.session, track, artist, TrackArtistLinkType::Artist);
-            TrackArtistLink::create(context.session, track, artist, TrackArtistLinkType::ReleaseArtist);
+            if (params.generateFeatures)
+                context.session.create<TrackFeatures>(track, generateFeatures());
 
-            std::vector<ObjectPtr<Cluster>> clusters;
-            clusters.push_back(*Random::pickRandom(context.genres));
-            clusters.push_back(*Random::pickRandom(context.moods));
-            track.modify()->setClusters(clusters);
+            context.trackIds.push_back(track->getId());
+        }
+    }
+
+    void generateUser(const GeneratorParameters& params, GenerationContext& context, ZipfDistribution& trackDistribution, std::size_t userIndex)
+    {
+        using namespace Database;
+
+        User::pointer user{ context.session.create<User>("user-" + std::to_string(userIndex) + "-" + std::string{ UUID::generate().getAsString() }) };
+
+        const Wt::WDateTime now{ Wt::WDateTime::currentDateTime() };
+        auto randomPastDateTime{ [&] { return now.addSecs(-Random::getRandom(0, 365 * 24 * 3600)); } };
+
+        // listens: some tracks are far more listened than others
+        for (std::size_t i{}; i < params.listenCountPerUser; ++i)
+        {
+            const Track::pointer track{ Track::find(context.session, context.trackIds[trackDistribution()]) };
+            Listen::pointer listen{ context.session.create<Listen>(user, track, ScrobblingBackend::Internal, randomPastDateTime()) };
+            listen.modify()->setSyncState(SyncState::Synchronized);
+        }
+
+        for (std::size_t i{}; i < params.starredCountPerUser; ++i)
+        {
+            const Track::pointer track{ Track::find(context.session, context.trackIds[trackDistribution()]) };
+            if (StarredTrack::find(context.session, track->getId(), user->getId(), FeedbackBackend::Internal))
+                continue;
+
+            StarredTrack::pointer starredTrack{ context.session.create<StarredTrack>(track, user, FeedbackBackend::Internal) };
+            starredTrack.modify()->setDateTime(randomPastDateTime());
+        }
+
+        for (const ReleaseId releaseId : pickRandomDistinct(context.releaseIds, params.starredCountPerUser / 2))
+        {
+            StarredRelease::pointer starredRelease{ context.session.create<StarredRelease>(Release::find(context.session, releaseId), user, FeedbackBackend::Internal) };
+            starredRelease.modify()->setDateTime(randomPastDateTime());
+        }
+
+        for (const Artist::pointer& artist : pickRandomDistinct(context.artists, params.starredCountPerUser / 5))
+        {
+            StarredArtist::pointer starredArtist{ context.session.create<StarredArtist>(artist, user, FeedbackBackend::Internal) };
+            starredArtist.modify()->setDateTime(randomPastDateTime());
+        }
+
+        for (std::size_t i{}; i < params.trackListCountPerUser; ++i)
+        {
+            TrackList::pointer trackList{ context.session.create<TrackList>(context.nameGenerator.generate(1, 3), TrackListType::Playlist, randomBool(0.5), user) };
+
+            std::vector<TrackId> trackIds;
+            trackIds.reserve(params.trackCountPerTrackList);
+            for (std::size_t j{}; j < params.trackCountPerTrackList; ++j)
+                trackIds.push_back(context.trackIds[trackDistribution()]);
+
+            trackList.modify()->addTracks(trackIds);
         }
     }
 
     void generate(const GeneratorParameters& params, GenerationContext& context)
     {
-        for (std::size_t i{}; i < params.releaseCount; ++i)
+        // Commit regularly so that the session does not keep too many pending changes
         {
-            if ((i % 1000) == 0)
-                std::cout << "Generating album #" << i << std::endl;
+            ZipfDistribution artistDistribution{ context.artists.size(), params.sizeZipfExponent };
+            for (std::size_t i{}; i < params.releaseCount;)
+            {
+                std::cout << "Generating release #" << i << std::endl;
+
+                auto transaction{ context.session.createUniqueTransaction() };
+                for (std::size_t j{}; j < params.batchSize && i < params.releaseCount; ++j, ++i)
+                    generateRelease(params, context, artistDistribution);
+            }
+        }
 
-            generateRelease(params, context);
+        if (params.userCount && !context.trackIds.empty())
+        {
+            // most popular tracks first
+            Random::shuffleContainer(context.trackIds);
+            ZipfDistribution trackDistribution{ context.trackIds.size(), params.sizeZipfExponent };
+
+            const std::size_t userBatchSize{ std::max<std::size_t>(1, params.batchSize / 100) };
+            for (std::size_t i{}; i < params.userCount;)
+            {
+                std::cout << "Generating user #" << i << std::endl;
+
+                auto transaction{ context.session.createUniqueTransaction() };
+                for (std::size_t j{}; j < userBatchSize && i < params.userCount; ++j, ++i)
+                    generateUser(params, context, trackDistribution, i);
+            }
+        }
+
+        // as done at the end of a scan
+        {
+            auto transaction{ context.session.createUniqueTransaction() };
+            Database::Cluster::updateCounts(context.session);
+            Database::Release::updateAggregates(context.session);
         }
     }
 
     void prepareContext(const GeneratorParameters& params, GenerationContext& context)
     {
+        auto transaction{ context.session.createUniqueTransaction() };
+
         // create some random genres/moods
         {
             Database::ClusterType::pointer genre{ Database::ClusterType::find(context.session, "GENRE") };
@@ -140,6 +369,10 @@ namespace
             for (std::size_t i{}; i < params.moodCount; ++i)
                 context.moods.push_back(generateCluster(context.session, mood));
         }
+
+        for (std::size_t i{}; i < std::max<std::size_t>(1, params.artistCount); ++i)
+            context.artists.push_back(generateArtist(context));
+        context.variousArtists = context.session.create<Database::Artist>("Various Artists");
     }
 }
 
@@ -158,13 +391,25 @@ int main(int argc, char* argv[])
         options.add_options()
             ("conf,c", po::value<std::string>()->default_value("/etc/lms.conf"), "lms config file")
             ("release-count", po::value<unsigned>()->default_value(defaultParams.releaseCount), "Number of releases to generate")
-            ("track-count-per-release", po::value<unsigned>()->default_value(defaultParams.trackCountPerRelease), "Number of tracks per release")
+            ("track-count-per-release", po::value<unsigned>()->default_value(defaultParams.trackCountPerRelease), "Mean number of tracks per release")
+            ("artist-count", po::value<unsigned>()->default_value(defaultParams.artistCount), "Number of artists to generate")
+            ("zipf-exponent", po::value<double>()->default_value(defaultParams.sizeZipfExponent), "Exponent of the Zipf laws used to spread releases over artists and listens over tracks (0 means uniform)")
             ("compilation-ratio", po::value<float>()->default_value(defaultParams.compilationRatio), "Compilation ratio (compilation means all tracks have a different artist)")
+            ("composer-ratio", po::value<float>()->default_value(defaultParams.composerRatio), "Ratio of tracks that have a composer")
+            ("performer-ratio", po::value<float>()->default_value(defaultParams.performerRatio), "Ratio of tracks that have a performer")
             ("track-path", po::value<std::string>()->required(), "Path of a valid track file, that will be used for all generated tracks")
             ("genre-count", po::value<unsigned>()->default_value(defaultParams.genreCount), "Number of genres to generate")
             ("genre-count-per-track", po::value<unsigned>()->default_value(defaultParams.genreCountPerTrack), "Number of genres to assign to each track")
             ("mood-count", po::value<unsigned>()->default_value(defaultParams.moodCount), "Number of moods to generate")
             ("mood-count-per-track", po::value<unsigned>()->default_value(defaultParams.moodCountPerTrack), "Number of moods to assign to each track")
+            ("user-count", po::value<unsigned>()->default_value(defaultParams.userCount), "Number of users to generate")
+            ("listen-count-per-user", po::value<unsigned>()->default_value(defaultParams.listenCountPerUser), "Number of listens to generate for each user")
+            ("starred-count-per-user", po::value<unsigned>()->default_value(defaultParams.starredCountPerUser), "Number of starred tracks to generate for each user (half as many releases and a fifth as many artists)")
+            ("tracklist-count-per-user", po::value<unsigned>()->default_value(defaultParams.trackListCountPerUser), "Number of tracklists to generate for each user")
+            ("track-count-per-tracklist", po::value<unsigned>()->default_value(defaultParams.trackCountPerTrackList), "Number of tracks in each tracklist")
+            ("generate-features", po::bool_switch()->default_value(defaultParams.generateFeatures), "Generate random track features")
+            ("batch-size", po::value<unsigned>()->default_value(defaultParams.batchSize), "Number of releases generated in each transaction")
+            ("seed", po::value<unsigned>()->default_value(0), "Seed of the random generator, to generate reproducible databases (0 means random)")
             ("help,h", "produce help message")
             ;
 
@@ -182,7 +427,22 @@ int main(int argc, char* argv[])
         GeneratorParameters genParams;
         genParams.releaseCount = vm["release-count"].as<unsigned>();
         genParams.trackCountPerRelease = vm["track-count-per-release"].as<unsigned>();
+        genParams.artistCount = vm["artist-count"].as<unsigned>();
+        genParams.sizeZipfExponent = vm["zipf-exponent"].as<double>();
         genParams.compilationRatio = vm["compilation-ratio"].as<float>();
+        genParams.composerRatio = vm["composer-ratio"].as<float>();
+        genParams.performerRatio = vm["performer-ratio"].as<float>();
+        genParams.genreCount = vm["genre-count"].as<unsigned>();
+        genParams.genreCountPerTrack = vm["genre-count-per-track"].as<unsigned>();
+        genParams.moodCount = vm["mood-count"].as<unsigned>();
+        genParams.moodCountPerTrack = vm["mood-count-per-track"].as<unsigned>();
+        genParams.userCount = vm["user-count"].as<unsigned>();
+        genParams.listenCountPerUser = vm["listen-count-per-user"].as<unsigned>();
+        genParams.starredCountPerUser = vm["starred-count-per-user"].as<unsigned>();
+        genParams.trackListCountPerUser = vm["tracklist-count-per-user"].as<unsigned>();
+        genParams.trackCountPerTrackList = vm["track-count-per-tracklist"].as<unsigned>();
+        genParams.generateFeatures = vm["generate-features"].as<bool>();
+        genParams.batchSize = std::max(1U, vm["batch-size"].as<unsigned>());
         genParams.trackPath = std::filesystem::path{ vm["track-path"].as<std::string>() };
 
         if (!std::filesystem::exists(genParams.trackPath))
@@ -191,14 +451,24 @@ int main(int argc, char* argv[])
         Service<IConfig> config{ createConfig(vm["conf"].as<std::string>()) };
         Database::Db db{ config->getPath("working-dir") / "lms.db" };
         Database::Session session{ db };
-        auto transaction{ session.createUniqueTransaction() };
+        session.prepareTables(); // the database may not exist yet
+
+        // all the generation happens in this thread
+        if (const unsigned seed{ vm["seed"].as<unsigned>() })
+            Random::getRandGenerator().seed(seed);
+
         std::cout << "Starting generation..." << std::endl;
 
+        const auto startTime{ std::chrono::steady_clock::now() };
+
         GenerationContext genContext{ session };
         prepareContext(genParams, genContext);
         generate(genParams, genContext);
 
-        std::cout << "Generation complete!" << std::endl;
+        // so that query plans are the ones of a scanned library
+        session.analyze();
+
+        std::cout << "Generation complete in " << std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - startTime).count() << "s!" << std::endl;
     }
     catch (std::exception& e)
     {
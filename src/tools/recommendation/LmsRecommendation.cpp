@@ -17,10 +17,20 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <filesystem>
+#include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <numeric>
+#include <optional>
 #include <stdexcept>
 #include <stdlib.h>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
 
 #include <boost/program_options.hpp>
 
@@ -33,8 +43,10 @@
 #include "services/database/Types.hpp"
 #include "services/recommendation/IRecommendationService.hpp"
 #include "utils/IConfig.hpp"
+#include "utils/Random.hpp"
 #include "utils/Service.hpp"
 #include "utils/StreamLogger.hpp"
+#include "utils/String.hpp"
 
 using namespace Database;
 
@@ -124,6 +136,244 @@ static void dumpArtistsRecommendation(Session session, Recommendation::IRecommen
     }
 }
 
+namespace Bench
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Params
+    {
+        std::vector<Recommendation::EngineType> engineTypes;
+        std::vector<std::size_t> concurrencies;
+        std::size_t seedCount;
+        std::size_t maxSimilarityCount;
+    };
+
+    // Objects to get recommendations for, shared across engines so that results can be compared
+    struct Seeds
+    {
+        std::vector<TrackId> trackIds;
+        std::vector<ReleaseId> releaseIds;
+        std::vector<ArtistId> artistIds;
+    };
+
+    enum class Query
+    {
+        SimilarTracks,
+        SimilarReleases,
+        SimilarArtists,
+    };
+    constexpr std::array<Query, 3> queries{ Query::SimilarTracks, Query::SimilarReleases, Query::SimilarArtists };
+
+    const char* queryToString(Query query)
+    {
+        switch (query)
+        {
+        case Query::SimilarTracks: return "findSimilarTracks";
+        case Query::SimilarReleases: return "getSimilarReleases";
+        case Query::SimilarArtists: return "getSimilarArtists";
+        }
+        return "?";
+    }
+
+    const char* engineTypeToString(Recommendation::EngineType engineType)
+    {
+        switch (engineType)
+        {
+        case Recommendation::EngineType::Clusters: return "clusters";
+        case Recommendation::EngineType::Features: return "features";
+        }
+        return "?";
+    }
+
+    // Results of the queries, by seed index
+    struct QueryResults
+    {
+        std::vector<std::vector<std::size_t>> resultIds;
+    };
+
+    Seeds pickSeeds(Session& session, std::size_t seedCount)
+    {
+        auto transaction{ session.createSharedTransaction() };
+
+        Seeds seeds;
+        seeds.trackIds = Track::findIds(session, Track::FindParameters{}.setSortMethod(TrackSortMethod::Random).setRange(Range{ 0, seedCount })).results;
+        seeds.releaseIds = Release::findIds(session, Release::FindParameters{}.setSortMethod(ReleaseSortMethod::Random).setRange(Range{ 0, seedCount })).results;
+        seeds.artistIds = Artist::findIds(session, Artist::FindParameters{}.setSortMethod(ArtistSortMethod::Random).setRange(Range{ 0, seedCount })).results;
+
+        return seeds;
+    }
+
+    std::size_t getSeedCount(const Seeds& seeds, Query query)
+    {
+        switch (query)
+        {
+        case Query::SimilarTracks: return seeds.trackIds.size();
+        case Query::SimilarReleases: return seeds.releaseIds.size();
+        case Query::SimilarArtists: return seeds.artistIds.size();
+        }
+        return 0;
+    }
+
+    std::vector<std::size_t> runQuery(const Recommendation::IRecommendationService& service, const Seeds& seeds, Query query, std::size_t seedIndex, std::size_t maxCount)
+    {
+        auto toValues{ [](const auto& ids)
+            {
+                std::vector<std::size_t> res;
+                res.reserve(ids.size());
+                for (const auto id : ids)
+                    res.push_back(static_cast<std::size_t>(id.getValue()));
+                return res;
+            } };
+
+        switch (query)
+        {
+        case Query::SimilarTracks: return toValues(service.findSimilarTracks({ seeds.trackIds[seedIndex] }, maxCount));
+        case Query::SimilarReleases: return toValues(service.getSimilarReleases(seeds.releaseIds[seedIndex], maxCount));
+        case Query::SimilarArtists: return toValues(service.getSimilarArtists(seeds.artistIds[seedIndex], { TrackArtistLinkType::Artist, TrackArtistLinkType::ReleaseArtist }, maxCount));
+        }
+        return {};
+    }
+
+    double toMs(Clock::duration duration)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(duration).count() / 1000.;
+    }
+
+    // Each thread queries all the seeds, in a random order
+    QueryResults benchQuery(const Recommendation::IRecommendationService& service, const Seeds& seeds, Query query, std::size_t concurrency, std::size_t maxCount)
+    {
+        const std::size_t seedCount{ getSeedCount(seeds, query) };
+
+        QueryResults results;
+        results.resultIds.resize(seedCount);
+
+        std::mutex mutex;
+        std::vector<Clock::duration> durations;
+
+        const Clock::time_point start{ Clock::now() };
+        std::vector<std::thread> threads;
+        for (std::size_t i{}; i < concurrency; ++i)
+        {
+            threads.emplace_back([&, i]
+                {
+                    std::vector<std::size_t> seedIndexes(seedCount);
+                    std::iota(std::begin(seedIndexes), std::end(seedIndexes), 0);
+                    std::shuffle(std::begin(seedIndexes), std::end(seedIndexes), Random::getRandGenerator());
+
+                    std::vector<Clock::duration> localDurations;
+                    localDurations.reserve(seedCount);
+                    for (const std::size_t seedIndex : seedIndexes)
+                    {
+                        const Clock::time_point queryStart{ Clock::now() };
+                        std::vector<std::size_t> resultIds{ runQuery(service, seeds, query, seedIndex, maxCount) };
+                        localDurations.push_back(Clock::now() - queryStart);
+
+                        if (i == 0)
+                            results.resultIds[seedIndex] = std::move(resultIds);
+                    }
+
+                    std::scoped_lock lock{ mutex };
+                    durations.insert(std::end(durations), std::cbegin(localDurations), std::cend(localDurations));
+                });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+        const Clock::duration elapsed{ Clock::now() - start };
+
+        if (durations.empty())
+            return results;
+
+        std::sort(std::begin(durations), std::end(durations));
+        auto percentile{ [&](std::size_t p) { return toMs(durations[std::min(durations.size() - 1, durations.size() * p / 100)]); } };
+
+        std::size_t resultCount{};
+        std::size_t emptyResultCount{};
+        for (const std::vector<std::size_t>& resultIds : results.resultIds)
+        {
+            resultCount += resultIds.size();
+            if (resultIds.empty())
+                emptyResultCount++;
+        }
+
+        std::cout << "\t" << std::left << std::setw(20) << queryToString(query) << std::right
+            << " concurrency = " << std::setw(3) << concurrency
+            << std::fixed << std::setprecision(2)
+            << ", p50 = " << percentile(50) << "ms"
+            << ", p90 = " << percentile(90) << "ms"
+            << ", p99 = " << percentile(99) << "ms"
+            << ", max = " << toMs(durations.back()) << "ms"
+            << ", " << std::setprecision(0) << (durations.size() / std::chrono::duration<double>{ elapsed }.count()) << " queries/s"
+            << std::setprecision(1) << ", avg results = " << (static_cast<double>(resultCount) / seedCount)
+            << ", empty = " << emptyResultCount << "/" << seedCount << std::endl;
+
+        return results;
+    }
+
+    // Mean Jaccard index of the results of two engines, for seeds that got results from both
+    void printOverlap(const QueryResults& results1, const QueryResults& results2)
+    {
+        double totalIndex{};
+        std::size_t count{};
+        for (std::size_t i{}; i < std::min(results1.resultIds.size(), results2.resultIds.size()); ++i)
+        {
+            const std::vector<std::size_t>& ids1{ results1.resultIds[i] };
+            const std::vector<std::size_t>& ids2{ results2.resultIds[i] };
+            if (ids1.empty() || ids2.empty())
+                continue;
+
+            const std::unordered_set<std::size_t> idSet1(std::cbegin(ids1), std::cend(ids1));
+            const std::size_t intersectionCount{ static_cast<std::size_t>(std::count_if(std::cbegin(ids2), std::cend(ids2), [&](std::size_t id) { return idSet1.find(id) != std::cend(idSet1); })) };
+            totalIndex += static_cast<double>(intersectionCount) / (idSet1.size() + ids2.size() - intersectionCount);
+            count++;
+        }
+
+        std::cout << std::fixed << std::setprecision(3) << "mean overlap = " << (count ? totalIndex / count : 0.) << " (" << count << " seeds)" << std::endl;
+    }
+
+    void run(Db& db, const Params& params)
+    {
+        const Seeds seeds{ pickSeeds(db.getTLSSession(), params.seedCount) };
+        std::cout << "Seeds: " << seeds.trackIds.size() << " tracks, " << seeds.releaseIds.size() << " releases, " << seeds.artistIds.size() << " artists" << std::endl;
+
+        std::vector<std::array<QueryResults, queries.size()>> resultsByEngine;
+        for (const Recommendation::EngineType engineType : params.engineTypes)
+        {
+            std::cout << "*** Engine '" << engineTypeToString(engineType) << "' ***" << std::endl;
+
+            // the first load uses the engine cache if any, or trains the engine. The reload then uses the freshly written cache
+            Clock::time_point start{ Clock::now() };
+            const auto service{ Recommendation::createRecommendationService(db, engineType) };
+            service->load();
+            std::cout << "\tInitial load: " << std::fixed << std::setprecision(0) << toMs(Clock::now() - start) << "ms" << std::endl;
+
+            start = Clock::now();
+            service->load();
+            std::cout << "\tReload: " << std::fixed << std::setprecision(0) << toMs(Clock::now() - start) << "ms" << std::endl;
+
+            auto& results{ resultsByEngine.emplace_back() };
+            for (std::size_t queryIndex{}; queryIndex < queries.size(); ++queryIndex)
+            {
+                for (const std::size_t concurrency : params.concurrencies)
+                {
+                    QueryResults queryResults{ benchQuery(*service, seeds, queries[queryIndex], concurrency, params.maxSimilarityCount) };
+                    if (concurrency == params.concurrencies.front())
+                        results[queryIndex] = std::move(queryResults);
+                }
+            }
+        }
+
+        for (std::size_t i{ 1 }; i < resultsByEngine.size(); ++i)
+        {
+            std::cout << "*** Overlap '" << engineTypeToString(params.engineTypes[0]) << "' / '" << engineTypeToString(params.engineTypes[i]) << "' ***" << std::endl;
+            for (std::size_t queryIndex{}; queryIndex < queries.size(); ++queryIndex)
+            {
+                std::cout << "\t" << std::left << std::setw(20) << queryToString(queries[queryIndex]) << std::right << " ";
+                printOverlap(resultsByEngine[0][queryIndex], resultsByEngine[i][queryIndex]);
+            }
+        }
+    }
+}
+
 int main(int argc, char* argv[])
 {
     try
@@ -141,6 +391,10 @@ int main(int argc, char* argv[])
             ("releases,r", "Display recommendation for releases")
             ("tracks,t", "Display recommendation for tracks")
             ("max,m", po::value<unsigned>()->default_value(3), "Max similarity result count")
+            ("bench,b", "Benchmark the recommendation engines")
+            ("engines", po::value<std::string>()->default_value("clusters,features"), "Engines to benchmark")
+            ("seed-count", po::value<std::size_t>()->default_value(100), "Number of random tracks, releases and artists to get recommendations for")
+            ("concurrency", po::value<std::string>()->default_value("1,4"), "Concurrency levels to benchmark")
             ;
 
         po::variables_map vm;
@@ -157,6 +411,39 @@ int main(int argc, char* argv[])
         Db db{ config->getPath("working-dir") / "lms.db" };
         Session session{ db };
 
+        unsigned maxSimilarityCount{ vm["max"].as<unsigned>() };
+
+        if (vm.count("bench"))
+        {
+            Bench::Params params;
+            params.seedCount = vm["seed-count"].as<std::size_t>();
+            params.maxSimilarityCount = maxSimilarityCount;
+
+            for (std::string_view engine : StringUtils::splitString(vm["engines"].as<std::string>(), ","))
+            {
+                if (engine == "clusters")
+                    params.engineTypes.push_back(Recommendation::EngineType::Clusters);
+                else if (engine == "features")
+                    params.engineTypes.push_back(Recommendation::EngineType::Features);
+                else
+                    throw std::runtime_error{ "Invalid engine '" + std::string{ engine } + "'" };
+            }
+
+            for (std::string_view concurrency : StringUtils::splitString(vm["concurrency"].as<std::string>(), ","))
+            {
+                const std::optional<std::size_t> value{ StringUtils::readAs<std::size_t>(concurrency) };
+                if (!value || *value == 0)
+                    throw std::runtime_error{ "Invalid concurrency '" + std::string{ concurrency } + "'" };
+                params.concurrencies.push_back(*value);
+            }
+
+            if (params.engineTypes.empty() || params.concurrencies.empty())
+                throw std::runtime_error{ "No engine or concurrency to benchmark" };
+
+            Bench::run(db, params);
+            return EXIT_SUCCESS;
+        }
+
         std::cout << "Creating recommendation service..." << std::endl;
         const auto recommendationService{ Recommendation::createRecommendationService(db) };
         std::cout << "Recommendation service created!" << std::endl;
@@ -164,8 +451,6 @@ int main(int argc, char* argv[])
         std::cout << "Loading recommendation service..." << std::endl;
         recommendationService->load();
 
-        unsigned maxSimilarityCount{ vm["max"].as<unsigned>() };
-
         std::cout << "Recommendation service loaded!" << std::endl;
 
         if (vm.count("tracks"))
@@ -0,0 +1,378 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "metadata/IParser.hpp"
+#include "services/database/Db.hpp"
+#include "services/database/ScanSettings.hpp"
+#include "services/database/Session.hpp"
+#include "services/scanner/IScannerService.hpp"
+#include "utils/IConfig.hpp"
+#include "utils/Service.hpp"
+#include "utils/StreamLogger.hpp"
+#include "utils/String.hpp"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct BenchParams
+    {
+        std::filesystem::path directory;
+        MetaData::ParserType parserType;
+        MetaData::ParserReadStyle readStyle;
+        std::size_t threadCount;
+        std::set<std::filesystem::path> extensions;
+    };
+
+    // Global IO counters of the process, as reported by the kernel
+    struct IOCounters
+    {
+        std::size_t readChars{};    // read by syscalls, including page cache hits
+        std::size_t readBytes{};    // actually fetched from the storage layer
+    };
+
+    std::optional<IOCounters> readIOCounters()
+    {
+        std::ifstream ifs{ "/proc/self/io" };
+        if (!ifs)
+            return std::nullopt;
+
+        IOCounters counters;
+        std::string key;
+        std::size_t value;
+        while (ifs >> key >> value)
+        {
+            if (key == "rchar:")
+                counters.readChars = value;
+            else if (key == "read_bytes:")
+                counters.readBytes = value;
+        }
+
+        return counters;
+    }
+
+    struct FormatStats
+    {
+        std::vector<std::chrono::microseconds> durations;
+        std::size_t failures{};
+        std::uintmax_t fileSize{};
+    };
+
+    std::vector<std::filesystem::path> discoverFiles(const BenchParams& params)
+    {
+        std::vector<std::filesystem::path> files;
+
+        std::error_code ec;
+        for (std::filesystem::recursive_directory_iterator itPath{ params.directory, std::filesystem::directory_options::follow_directory_symlink, ec }; !ec && itPath != std::filesystem::recursive_directory_iterator{}; itPath.increment(ec))
+        {
+            const std::filesystem::path& path{ itPath->path() };
+            if (!itPath->is_regular_file(ec))
+                continue;
+
+            if (params.extensions.find(StringUtils::stringToLower(path.extension().string())) != std::cend(params.extensions))
+                files.push_back(path);
+        }
+
+        if (ec)
+            std::cerr << "Cannot iterate over '" << params.directory.string() << "': " << ec.message() << std::endl;
+
+        return files;
+    }
+
+    double toMs(std::chrono::microseconds duration)
+    {
+        return duration.count() / 1000.;
+    }
+
+    std::chrono::microseconds getPercentile(const std::vector<std::chrono::microseconds>& sortedDurations, unsigned percentile)
+    {
+        if (sortedDurations.empty())
+            return {};
+
+        const std::size_t index{ std::min(sortedDurations.size() - 1, sortedDurations.size() * percentile / 100) };
+        return sortedDurations[index];
+    }
+
+    // Parse all the files using several threads, each of them using its own parser
+    void benchParsing(const BenchParams& params, const std::vector<std::filesystem::path>& files)
+    {
+        std::atomic<std::size_t> nextFileIndex{};
+        std::mutex statsMutex;
+        std::map<std::string, FormatStats> statsByFormat;
+
+        const std::optional<IOCounters> ioCountersBefore{ readIOCounters() };
+        const Clock::time_point start{ Clock::now() };
+
+        std::vector<std::thread> threads;
+        for (std::size_t i{}; i < params.threadCount; ++i)
+        {
+            threads.emplace_back([&]
+                {
+                    std::unique_ptr<MetaData::IParser> parser{ MetaData::createParser(params.parserType, params.readStyle) };
+                    parser->setClusterTypeNames({ "GENRE", "MOOD", "ALBUMGROUPING" });
+
+                    std::map<std::string, FormatStats> localStatsByFormat;
+                    for (std::size_t fileIndex{ nextFileIndex++ }; fileIndex < files.size(); fileIndex = nextFileIndex++)
+                    {
+                        const std::filesystem::path& file{ files[fileIndex] };
+
+                        const Clock::time_point parseStart{ Clock::now() };
+                        const bool success{ parser->parse(file).has_value() };
+                        const auto duration{ std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - parseStart) };
+
+                        FormatStats& stats{ localStatsByFormat[StringUtils::stringToLower(file.extension().string())] };
+                        stats.durations.push_back(duration);
+                        if (!success)
+                            stats.failures++;
+
+                        std::error_code ec;
+                        const std::uintmax_t fileSize{ std::filesystem::file_size(file, ec) };
+                        if (!ec)
+                            stats.fileSize += fileSize;
+                    }
+
+                    std::scoped_lock lock{ statsMutex };
+                    for (auto& [format, localStats] : localStatsByFormat)
+                    {
+                        FormatStats& stats{ statsByFormat[format] };
+                        stats.durations.insert(std::end(stats.durations), std::cbegin(localStats.durations), std::cend(localStats.durations));
+                        stats.failures += localStats.failures;
+                        stats.fileSize += localStats.fileSize;
+                    }
+                });
+        }
+
+        for (std::thread& thread : threads)
+            thread.join();
+
+        const auto elapsed{ std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start) };
+        const std::optional<IOCounters> ioCountersAfter{ readIOCounters() };
+
+        std::cout << "Parsed " << files.size() << " files in " << elapsed.count() << "ms using " << params.threadCount << " thread(s): "
+            << std::fixed << std::setprecision(1) << (elapsed.count() ? files.size() * 1000. / elapsed.count() : 0.) << " files/s" << std::endl;
+
+        std::uintmax_t totalFileSize{};
+        std::cout << std::left << std::setw(8) << "format" << std::right << std::setw(8) << "files" << std::setw(10) << "failures"
+            << std::setw(12) << "mean (ms)" << std::setw(12) << "p50 (ms)" << std::setw(12) << "p95 (ms)" << std::setw(12) << "p99 (ms)" << std::setw(12) << "max (ms)" << std::endl;
+        for (auto& [format, stats] : statsByFormat)
+        {
+            std::sort(std::begin(stats.durations), std::end(stats.durations));
+
+            std::chrono::microseconds total{};
+            for (std::chrono::microseconds duration : stats.durations)
+                total += duration;
+
+            std::cout << std::left << std::setw(8) << format << std::right << std::setw(8) << stats.durations.size() << std::setw(10) << stats.failures
+                << std::setprecision(2)
+                << std::setw(12) << toMs(total / stats.durations.size())
+                << std::setw(12) << toMs(getPercentile(stats.durations, 50))
+                << std::setw(12) << toMs(getPercentile(stats.durations, 95))
+                << std::setw(12) << toMs(getPercentile(stats.durations, 99))
+                << std::setw(12) << toMs(stats.durations.back()) << std::endl;
+
+            totalFileSize += stats.fileSize;
+        }
+
+        std::cout << "Total file size: " << totalFileSize / (1024 * 1024) << " MiB" << std::endl;
+        if (ioCountersBefore && ioCountersAfter)
+        {
+            std::cout << "Read by syscalls: " << (ioCountersAfter->readChars - ioCountersBefore->readChars) / (1024 * 1024) << " MiB, "
+                << "read from disk: " << (ioCountersAfter->readBytes - ioCountersBefore->readBytes) / (1024 * 1024) << " MiB" << std::endl;
+        }
+    }
+
+    std::string_view stepToString(Scanner::ScanStep step)
+    {
+        switch (step)
+        {
+        case Scanner::ScanStep::DiscoveringFiles: return "Discovering files";
+        case Scanner::ScanStep::ScanningFiles: return "Scanning files";
+        case Scanner::ScanStep::ChekingForMissingFiles: return "Checking for missing files";
+        case Scanner::ScanStep::CheckingForDuplicateFiles: return "Checking for duplicate files";
+        case Scanner::ScanStep::FetchingTrackFeatures: return "Fetching track features";
+        case Scanner::ScanStep::ReloadingSimilarityEngine: return "Reloading similarity engine";
+        case Scanner::ScanStep::ComputeClusterStats: return "Computing cluster stats";
+        case Scanner::ScanStep::GeneratingCovers: return "Generating covers";
+        case Scanner::ScanStep::RefiningAudioProperties: return "Refining audio properties";
+        case Scanner::ScanStep::ExtractingTrackFeatures: return "Extracting track features";
+        case Scanner::ScanStep::ComputingSeekTables: return "Computing seek tables";
+        case Scanner::ScanStep::SyncingTranscodeMirror: return "Syncing transcode mirror";
+        }
+        return "?";
+    }
+
+    // Run a full scan of the directory against a scratch database, to measure the database side of the scan
+    void benchScan(const BenchParams& params, const std::filesystem::path& dbPath)
+    {
+        if (std::filesystem::exists(dbPath))
+            throw std::runtime_error{ "Database '" + dbPath.string() + "' already exists, a scratch database is required!" };
+
+        Database::Db db{ dbPath };
+        {
+            Database::Session session{ db };
+            session.prepareTables();
+
+            auto transaction{ session.createUniqueTransaction() };
+            Database::ScanSettings::get(session).modify()->setMediaDirectory(params.directory);
+        }
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::optional<Scanner::ScanStats> scanStats;
+
+        std::unique_ptr<Scanner::IScannerService> scanner{ Scanner::createScannerService(db) };
+        scanner->getEvents().scanComplete.connect([&](const Scanner::ScanStats& stats)
+            {
+                std::scoped_lock lock{ mutex };
+                scanStats = stats;
+                cv.notify_all();
+            });
+
+        std::cout << "Scanning into scratch database '" << dbPath.string() << "'..." << std::endl;
+        scanner->requestImmediateScan(true);
+
+        {
+            std::unique_lock lock{ mutex };
+            cv.wait(lock, [&] { return scanStats.has_value(); });
+        }
+        scanner.reset();
+
+        const Scanner::ScanStats& stats{ *scanStats };
+        std::cout << "Scan complete: scanned = " << stats.scans << ", added = " << stats.additions << ", errors = " << stats.errors.getCount()
+            << ", " << std::fixed << std::setprecision(1) << stats.getScannedFilesPerSecond() << " scanned files/s" << std::endl;
+
+        for (const Scanner::ScanStepPerf& stepPerf : stats.stepPerfs)
+            std::cout << "Step '" << stepToString(stepPerf.step) << "': " << stepPerf.duration.count() << "ms (" << stepPerf.processedElems << " elements)" << std::endl;
+
+        auto printHistogram{ [](std::string_view name, const Scanner::DurationHistogram& histogram)
+            {
+                std::cout << name << ": count = " << histogram.count
+                    << ", total = " << toMs(histogram.total) << "ms"
+                    << ", mean = " << toMs(histogram.getMean()) << "ms"
+                    << ", p95 < " << toMs(histogram.getPercentile(95)) << "ms"
+                    << ", max = " << toMs(histogram.max) << "ms" << std::endl;
+            } };
+
+        printHistogram("Parse (per file)", stats.parseDurations);
+        printHistogram("DB write (per file)", stats.writeDurations);
+        printHistogram("DB commit (per batch)", stats.commitDurations);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        namespace po = boost::program_options;
+
+        po::options_description options{ "Options" };
+        options.add_options()
+            ("conf,c", po::value<std::string>()->default_value("/etc/lms.conf"), "LMS config file, used by the scan mode")
+            ("directory,d", po::value<std::string>()->required(), "Directory to parse")
+            ("parser,p", po::value<std::string>()->default_value("taglib"), "Parser to use: 'taglib', 'avformat' or 'taglib-avformat' (TagLib with AvFormat fallback)")
+            ("read-style,r", po::value<std::string>()->default_value("average"), "Parser read style: 'fast', 'average' or 'accurate'")
+            ("threads,t", po::value<std::size_t>()->default_value(std::max<std::size_t>(1, std::thread::hardware_concurrency())), "Number of parser threads")
+            ("extensions,e", po::value<std::string>()->default_value(".alac .mp3 .ogg .oga .aac .m4a .m4b .flac .wav .wma .aif .aiff .ape .mpc .shn .opus .wv"), "Audio file extensions to parse")
+            ("scan-db", po::value<std::string>(), "If set, also run a full scan of the directory into this scratch database (must not exist)")
+            ("help,h", "produce help message");
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, options), vm);
+
+        if (vm.count("help"))
+        {
+            std::cout << options << std::endl;
+            return EXIT_SUCCESS;
+        }
+
+        po::notify(vm);
+
+        // log to stdout
+        Service<Logger> logger{ std::make_unique<StreamLogger>(std::cout, EnumSet<Severity>{ Severity::FATAL, Severity::ERROR }) };
+
+        BenchParams params;
+        params.directory = vm["directory"].as<std::string>();
+        params.threadCount = std::max<std::size_t>(1, vm["threads"].as<std::size_t>());
+
+        const std::string parser{ vm["parser"].as<std::string>() };
+        if (parser == "taglib")
+            params.parserType = MetaData::ParserType::TagLib;
+        else if (parser == "avformat")
+            params.parserType = MetaData::ParserType::AvFormat;
+        else if (parser == "taglib-avformat")
+            params.parserType = MetaData::ParserType::TagLibWithAvFormatFallback;
+        else
+            throw std::runtime_error{ "Invalid value for 'parser'" };
+
+        const std::string readStyle{ vm["read-style"].as<std::string>() };
+        if (readStyle == "fast")
+            params.readStyle = MetaData::ParserReadStyle::Fast;
+        else if (readStyle == "average")
+            params.readStyle = MetaData::ParserReadStyle::Average;
+        else if (readStyle == "accurate")
+            params.readStyle = MetaData::ParserReadStyle::Accurate;
+        else
+            throw std::runtime_error{ "Invalid value for 'read-style'" };
+
+        for (std::string_view extension : StringUtils::splitString(vm["extensions"].as<std::string>(), " "))
+            params.extensions.emplace(StringUtils::stringToLower(extension));
+
+        if (!std::filesystem::is_directory(params.directory))
+            throw std::runtime_error{ "'" + params.directory.string() + "' is not a directory!" };
+
+        const std::vector<std::filesystem::path> files{ discoverFiles(params) };
+        std::cout << "Found " << files.size() << " files" << std::endl;
+
+        benchParsing(params, files);
+
+        if (vm.count("scan-db"))
+        {
+            Service<IConfig> config{ createConfig(vm["conf"].as<std::string>()) };
+            benchScan(params, vm["scan-db"].as<std::string>());
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -17,7 +17,19 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <iostream>
+#include <mutex>
 #include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "utils/Random.hpp"
 
@@ -32,19 +44,24 @@ class GeneticAlgorithm
 		using BreedFunction = std::function<Individual(const Individual&, const Individual&)>;
 		using MutateFunction = std::function<void(Individual&)>;
 		using ScoreFunction = std::function<Score(const Individual&)>;
+		using KeyFunction = std::function<std::string(const Individual&)>;
 
 		struct Params
 		{
-			std::size_t		nbWorkers {1};
+			std::size_t		maxParallelism {};	// 0 means the executor thread count
 			std::size_t		nbGenerations;
 			float			crossoverRatio {0.5};
 			float			mutationProbability {0.05};
 			BreedFunction	breedFunction;
 			MutateFunction		mutateFunction;
 			ScoreFunction		scoreFunction;
+			KeyFunction		keyFunction;	// if set, identical individuals are only scored once
+			std::size_t		maxStaleGenerations {};	// if non zero, stop once the best score did not improve by more than minImprovement for this many generations
+			Score			minImprovement {};
 		};
 
-		GeneticAlgorithm(const Params& params);
+		// Scores are computed in parallel using the executor
+		GeneticAlgorithm(TaskExecutor& executor, const Params& params);
 
 		// Returns the individual that has the maximum score after processing the requested generations
 		Individual simulate(const std::vector<Individual>& initialPopulation);
@@ -59,13 +76,19 @@ class GeneticAlgorithm
 		void scoreAndSortPopulation(std::vector<ScoredIndividual>& population);
 		Score getTotalScore(const std::vector<ScoredIndividual>& population) const;
 		typename std::vector<ScoredIndividual>::const_iterator pickRandomRouletteWheel(const std::vector<ScoredIndividual>& population, Score totalScore);
+		Score computeScore(const Individual& individual);
 
+		TaskExecutor&	_executor;
 		Params _params;
+
+		std::mutex		_scoreCacheMutex;
+		std::unordered_map<std::string, Score> _scoreCache;
 };
 
 template<typename Individual>
-GeneticAlgorithm<Individual>::GeneticAlgorithm(const Params& params)
-: _params {params}
+GeneticAlgorithm<Individual>::GeneticAlgorithm(TaskExecutor& executor, const Params& params)
+: _executor {executor}
+, _params {params}
 {
 }
 
@@ -86,6 +109,9 @@ GeneticAlgorithm<Individual>::simulate(const std::vector<Individual>& initialPop
 
 	scoreAndSortPopulation(scoredPopulation);
 
+	Score bestScore {*scoredPopulation.front().score};
+	std::size_t staleGenerationCount {};
+
 	for (std::size_t currentGeneration {}; currentGeneration  < _params.nbGenerations; ++currentGeneration)
 	{
 		assert(scoredPopulation.size() == initialPopulation.size());
@@ -124,6 +150,17 @@ GeneticAlgorithm<Individual>::simulate(const std::vector<Individual>& initialPop
 
 		std::cout << "Mean score = " << getTotalScore(scoredPopulation) / scoredPopulation.size() << std::endl;
 		std::cout << "Current best score = " << *scoredPopulation.front().score << std::endl;
+
+		if (*scoredPopulation.front().score > bestScore + _params.minImprovement)
+		{
+			bestScore = *scoredPopulation.front().score;
+			staleGenerationCount = 0;
+		}
+		else if (_params.maxStaleGenerations && ++staleGenerationCount >= _params.maxStaleGenerations)
+		{
+			std::cout << "No improvement for " << staleGenerationCount << " generations, stopping" << std::endl;
+			break;
+		}
 	}
 
 	std::cout << "Best score = " << *scoredPopulation.front().score << std::endl;
@@ -135,16 +172,40 @@ template<typename Individual>
 void
 GeneticAlgorithm<Individual>::scoreAndSortPopulation(std::vector<ScoredIndividual>& scoredPopulation)
 {
-	parallel_foreach(_params.nbWorkers, std::begin(scoredPopulation), std::end(scoredPopulation),
+	parallel_foreach(_executor, _params.maxParallelism, std::begin(scoredPopulation), std::end(scoredPopulation),
 			[&](ScoredIndividual& scoredIndividual)
 			{
 				if (!scoredIndividual.score)
-					scoredIndividual.score = _params.scoreFunction(scoredIndividual.individual);
+					scoredIndividual.score = computeScore(scoredIndividual.individual);
 			});
 
 	std::sort(std::begin(scoredPopulation), std::end(scoredPopulation), [](const ScoredIndividual& a, const ScoredIndividual& b) { return a.score > b.score; });
 }
 
+template<typename Individual>
+typename GeneticAlgorithm<Individual>::Score
+GeneticAlgorithm<Individual>::computeScore(const Individual& individual)
+{
+	if (!_params.keyFunction)
+		return _params.scoreFunction(individual);
+
+	const std::string key {_params.keyFunction(individual)};
+	{
+		const std::scoped_lock lock {_scoreCacheMutex};
+		auto it {_scoreCache.find(key)};
+		if (it != std::cend(_scoreCache))
+			return it->second;
+	}
+
+	// identical individuals scored concurrently may be computed twice, this is harmless
+	const Score score {_params.scoreFunction(individual)};
+
+	const std::scoped_lock lock {_scoreCacheMutex};
+	_scoreCache.emplace(key, score);
+
+	return score;
+}
+
 template<typename Individual>
 typename GeneticAlgorithm<Individual>::Score
 GeneticAlgorithm<Individual>::getTotalScore(const std::vector<ScoredIndividual>& scoredPopulation) const
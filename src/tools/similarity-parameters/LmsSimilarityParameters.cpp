@@ -211,6 +211,22 @@ getFeaturesFromCache(const std::unordered_map<Database::IdType, FeatureValuesMap
 	return res;
 }
 
+static
+std::string
+featureSettingsMapToKey(const FeatureSettingsMap& featureSettings)
+{
+	std::vector<FeatureName> names;
+	std::transform(std::cbegin(featureSettings), std::cend(featureSettings), std::back_inserter(names),
+			[](const auto& itFeature) { return itFeature.first; });
+	std::sort(std::begin(names), std::end(names));
+
+	std::string key;
+	for (const FeatureName& name : names)
+		key += name + ";";
+
+	return key;
+}
+
 static
 void
 printFeatureSettingsMap(const FeatureSettingsMap& featureSettings)
@@ -286,10 +302,6 @@ static
 SimilarityScore
 computeSimilarityScore(Database::Session& session, FeaturesSearcher::TrainSettings trainSettings)
 {
-	std::cout << "Compute score of: ";
-	printFeatureSettingsMap(trainSettings.featureSettingsMap);
-	std::cout << std::endl;
-
 	FeaturesSearcher searcher {session, trainSettings};
 
 	const std::vector<Database::IdType> trackIds = std::invoke([&]()
@@ -315,8 +327,6 @@ computeSimilarityScore(Database::Session& session, FeaturesSearcher::TrainSettin
 		}
 	}
 
-	std::cout << "Total score = " << score << std::endl;
-
 	return score;
 }
 
@@ -434,13 +444,18 @@ int main(int argc, char *argv[])
 		trainSettings.iterationCount = 8;
 		trainSettings.sampleCountPerNeuron = 1.5;
 
+		// shared by all the generations
+		TaskExecutor executor {nbWorkers};
+
 		GeneticAlgorithm<FeatureSettingsMap>::Params params;
-		params.nbWorkers = nbWorkers;
-		params.nbGenerations = 1;
+		params.maxParallelism = nbWorkers;
+		params.nbGenerations = 20;
+		params.maxStaleGenerations = 3;
 		params.crossoverRatio = 0.78;
 		params.mutationProbability = 0.2;
 		params.breedFunction = breedFeatureSettingsMap;
 		params.mutateFunction = mutateFeatureSettingsMap;
+		params.keyFunction = featureSettingsMapToKey;
 		params.scoreFunction =
 			[&](const FeatureSettingsMap& featureSettings)
 			{
@@ -451,11 +466,11 @@ int main(int argc, char *argv[])
 				return computeSimilarityScore(scopedSession.get(), settings);
 			};
 
-		GeneticAlgorithm<FeatureSettingsMap> geneticAlgorithm {params};
+		GeneticAlgorithm<FeatureSettingsMap> geneticAlgorithm {executor, params};
 
 		std::cout << "Parameters:\n"
 			<< "\tnb total settings = "<< featuresSettings.size() << "\n"
-			<< "\tnb generations = " << params.nbGenerations << "\n"
+			<< "\tnb generations = " << params.nbGenerations << " (stop after " << params.maxStaleGenerations << " generations without improvement)\n"
 			<< "\tpopulationSize = " << populationSize << "\n"
 			<< "\tnbFeatures = " << nbFeatures << "\n"
 			<< "\tcrossoverRatio = " << params.crossoverRatio << "\n"
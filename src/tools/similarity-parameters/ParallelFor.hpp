@@ -17,31 +17,19 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <functional>
-#include <thread>
-#include <boost/asio/io_context.hpp>
+#pragma once
 
-template <typename It, typename Func>
-void parallel_foreach(std::size_t nbWorkers, It begin, It end, Func&& func)
-{
-	if (nbWorkers == 0)
-		throw std::runtime_error("Invalid worker count");
+#include <iterator>
 
-	boost::asio::io_context ioContext;
+#include "utils/TaskExecutor.hpp"
 
-	for (It it {begin}; it != end; ++it)
+// Calls func on each element using the given executor, that is meant to be shared across calls
+// maxParallelism = 0 means the executor thread count
+template <typename It, typename Func>
+void parallel_foreach(TaskExecutor& executor, std::size_t maxParallelism, It begin, It end, Func&& func)
+{
+	parallelFor(executor, TaskExecutor::Priority::Background, std::distance(begin, end), maxParallelism, [&](std::size_t index)
 	{
-		auto refValue {std::ref<typename It::value_type>(*it)};
-		ioContext.post([refValue, &func]() { std::cout << "EXEC FROM WORKER" << std::endl; func(refValue); std::cout << "END EXEC FROM WORKER" << std::endl; });
-	}
-
-	std::vector<std::thread> threads;
-	for (std::size_t i {}; i < nbWorkers - 1; ++i)
-		threads.emplace_back([&]() { ioContext.run(); });
-
-	ioContext.run();
-
-	for (std::thread& t : threads)
-		t.join();
+		func(*std::next(begin, index));
+	});
 }
-
@@ -0,0 +1,746 @@
+/*
+ * Copyright (C) 2023 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/program_options.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include "utils/Random.hpp"
+#include "utils/String.hpp"
+
+namespace
+{
+    namespace asio = boost::asio;
+    namespace beast = boost::beast;
+    namespace http = boost::beast::http;
+    using Clock = std::chrono::steady_clock;
+
+    enum class Endpoint : std::size_t
+    {
+        GetAlbumList2,
+        GetAlbum,
+        Search3,
+        GetRandomSongs,
+        GetCoverArt,
+        Stream,
+    };
+    constexpr std::size_t endpointCount{ static_cast<std::size_t>(Endpoint::Stream) + 1 };
+    constexpr std::array<const char*, endpointCount> endpointNames{ "getAlbumList2", "getAlbum", "search3", "getRandomSongs", "getCoverArt", "stream" };
+
+    // Media endpoints do not answer with a subsonic-response document
+    bool isMediaEndpoint(Endpoint endpoint)
+    {
+        return endpoint == Endpoint::GetCoverArt || endpoint == Endpoint::Stream;
+    }
+
+    // Cheap check of the status of a JSON subsonic-response document, without fully parsing it
+    bool isSubsonicResponseOk(std::string_view body)
+    {
+        const std::size_t statusPos{ body.find("\"status\"") };
+        if (statusPos == std::string_view::npos)
+            return false;
+
+        std::string_view value{ body.substr(statusPos + std::string_view{ "\"status\"" }.size()) };
+        value = StringUtils::stringTrim(value, " \t\r\n:");
+        return value.substr(0, 4) == "\"ok\"";
+    }
+
+    struct BenchParameters
+    {
+        std::string host;
+        std::string port{ "80" };
+        std::string basePath;
+        std::string user;
+        std::string password;
+        std::size_t concurrency{ 4 };
+        double requestRate{}; // requests per second for all the connections, 0 means as fast as possible
+        std::chrono::seconds duration{ 30 };
+        std::chrono::seconds requestTimeout{ 30 };
+        std::array<unsigned, endpointCount> weights{ 30, 25, 20, 10, 14, 1 };
+        std::string jsonOutputPath;
+    };
+
+    // Ids sampled from the library before the bench, used to build the requests
+    struct LibrarySample
+    {
+        std::size_t albumCount{};
+        std::vector<std::string> albumIds;
+        std::vector<std::string> albumNames;
+        std::vector<std::string> coverArtIds;
+        std::vector<std::string> songIds;
+    };
+
+    struct EndpointStats
+    {
+        std::vector<std::chrono::microseconds> latencies; // successful requests only
+        std::size_t errorCount{};
+        std::size_t byteCount{};
+    };
+
+    std::string urlEncode(std::string_view str)
+    {
+        std::ostringstream oss;
+        oss << std::hex << std::uppercase << std::setfill('0');
+        for (const char c : str)
+        {
+            if (std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_' || c == '.' || c == '~')
+                oss << c;
+            else
+                oss << '%' << std::setw(2) << static_cast<unsigned>(static_cast<unsigned char>(c));
+        }
+        return oss.str();
+    }
+
+    std::string hexEncode(std::string_view str)
+    {
+        std::ostringstream oss;
+        oss << std::hex << std::setfill('0');
+        for (const char c : str)
+            oss << std::setw(2) << static_cast<unsigned>(static_cast<unsigned char>(c));
+        return oss.str();
+    }
+
+    void parseUrl(std::string_view url, BenchParameters& params)
+    {
+        constexpr std::string_view scheme{ "http://" };
+        if (url.substr(0, scheme.size()) != scheme)
+            throw std::runtime_error{ "Only http:// urls are supported" };
+        url.remove_prefix(scheme.size());
+
+        const std::size_t pathPos{ url.find('/') };
+        std::string_view hostPort{ url.substr(0, pathPos) };
+        if (pathPos != std::string_view::npos)
+            params.basePath = StringUtils::stringTrimEnd(url.substr(pathPos), "/");
+
+        const std::size_t portPos{ hostPort.find(':') };
+        params.host = hostPort.substr(0, portPos);
+        if (portPos != std::string_view::npos)
+            params.port = hostPort.substr(portPos + 1);
+
+        if (params.host.empty())
+            throw std::runtime_error{ "No host in url" };
+    }
+
+    void parseWeights(std::string_view mix, BenchParameters& params)
+    {
+        params.weights.fill(0);
+
+        for (std::string_view entry : StringUtils::splitString(mix, ","))
+        {
+            const std::vector<std::string_view> nameAndWeight{ StringUtils::splitString(entry, "=") };
+            if (nameAndWeight.size() != 2)
+                throw std::runtime_error{ "Bad mix entry '" + std::string{ entry } + "', expected <endpoint>=<weight>" };
+
+            const auto it{ std::find(std::cbegin(endpointNames), std::cend(endpointNames), nameAndWeight[0]) };
+            if (it == std::cend(endpointNames))
+                throw std::runtime_error{ "Unknown endpoint '" + std::string{ nameAndWeight[0] } + "'" };
+
+            const auto weight{ StringUtils::readAs<unsigned>(nameAndWeight[1]) };
+            if (!weight)
+                throw std::runtime_error{ "Bad weight for endpoint '" + std::string{ nameAndWeight[0] } + "'" };
+
+            params.weights[std::distance(std::cbegin(endpointNames), it)] = *weight;
+        }
+
+        if (std::accumulate(std::cbegin(params.weights), std::cend(params.weights), 0U) == 0)
+            throw std::runtime_error{ "At least one endpoint must have a positive weight" };
+    }
+
+    class Bench
+    {
+    public:
+        Bench(const BenchParameters& params, const asio::ip::tcp::resolver::results_type& serverEndpoints, LibrarySample sample)
+            : _params{ params }
+            , _serverEndpoints{ serverEndpoints }
+            , _sample{ std::move(sample) }
+            , _weightDistribution{ std::cbegin(params.weights), std::cend(params.weights) }
+        {}
+
+        const BenchParameters& getParameters() const { return _params; }
+        const asio::ip::tcp::resolver::results_type& getServerEndpoints() const { return _serverEndpoints; }
+
+        void start()
+        {
+            _startTime = Clock::now();
+            _endTime = _startTime + _params.duration;
+            _nextRequestTime = _startTime;
+        }
+
+        bool isOver() const { return Clock::now() >= _endTime; }
+        Clock::duration getElapsed() const { return std::min(Clock::now(), _endTime) - _startTime; }
+
+        // Returns the time at which a new request can be sent to honor the request rate
+        Clock::time_point reserveRequestTime()
+        {
+            if (_params.requestRate <= 0)
+                return Clock::now();
+
+            // do not burst to catch up if the server does not keep up
+            const Clock::time_point now{ Clock::now() };
+            if (_nextRequestTime < now)
+                _nextRequestTime = now;
+
+            const Clock::time_point res{ _nextRequestTime };
+            _nextRequestTime += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>{ 1 / _params.requestRate });
+            return res;
+        }
+
+        Endpoint pickEndpoint()
+        {
+            return static_cast<Endpoint>(_weightDistribution(Random::getRandGenerator()));
+        }
+
+        std::string createTarget(Endpoint endpoint) const
+        {
+            std::ostringstream oss;
+            oss << _params.basePath << "/rest/" << endpointNames[static_cast<std::size_t>(endpoint)] << ".view"
+                << "?u=" << urlEncode(_params.user)
+                << "&p=enc:" << hexEncode(_params.password)
+                << "&v=1.16.0&c=lms-subsonic-bench&f=json";
+
+            switch (endpoint)
+            {
+            case Endpoint::GetAlbumList2:
+            {
+                static constexpr std::array<const char*, 4> types{ "random", "newest", "alphabeticalByName", "alphabeticalByArtist" };
+                const std::size_t offset{ _sample.albumCount ? std::uniform_int_distribution<std::size_t>{ 0, _sample.albumCount - 1 }(Random::getRandGenerator()) : 0 };
+                oss << "&type=" << *Random::pickRandom(types) << "&size=50&offset=" << offset;
+                break;
+            }
+
+            case Endpoint::GetAlbum:
+                oss << "&id=" << urlEncode(pickRandom(_sample.albumIds));
+                break;
+
+            case Endpoint::Search3:
+                // keyword taken from an existing album name, so that there are results
+                oss << "&query=" << urlEncode(pickKeyword()) << "&artistCount=20&albumCount=20&songCount=20";
+                break;
+
+            case Endpoint::GetRandomSongs:
+                oss << "&size=20";
+                break;
+
+            case Endpoint::GetCoverArt:
+                oss << "&id=" << urlEncode(pickRandom(_sample.coverArtIds)) << "&size=256";
+                break;
+
+            case Endpoint::Stream:
+                oss << "&id=" << urlEncode(pickRandom(_sample.songIds));
+                break;
+            }
+
+            return oss.str();
+        }
+
+        void addResult(Endpoint endpoint, std::optional<std::chrono::microseconds> latency, std::size_t byteCount)
+        {
+            // results of the requests that end after the bench duration are not accounted
+            if (isOver())
+                return;
+
+            EndpointStats& stats{ _stats[static_cast<std::size_t>(endpoint)] };
+            if (latency)
+                stats.latencies.push_back(*latency);
+            else
+                stats.errorCount++;
+            stats.byteCount += byteCount;
+        }
+
+        const std::array<EndpointStats, endpointCount>& getStats() const { return _stats; }
+
+    private:
+        static const std::string& pickRandom(const std::vector<std::string>& values)
+        {
+            static const std::string empty;
+            const auto it{ Random::pickRandom(values) };
+            return it != std::cend(values) ? *it : empty;
+        }
+
+        std::string pickKeyword() const
+        {
+            const std::string& name{ pickRandom(_sample.albumNames) };
+            const std::vector<std::string_view> words{ StringUtils::splitString(name, " ") };
+            const auto it{ Random::pickRandom(words) };
+            return it != std::cend(words) ? std::string{ *it } : std::string{};
+        }
+
+        const BenchParameters& _params;
+        const asio::ip::tcp::resolver::results_type& _serverEndpoints;
+        const LibrarySample _sample;
+        std::discrete_distribution<std::size_t> _weightDistribution;
+        Clock::time_point _startTime;
+        Clock::time_point _endTime;
+        Clock::time_point _nextRequestTime;
+        std::array<EndpointStats, endpointCount> _stats;
+    };
+
+    // Sends requests one after the other on its own keep-alive connection
+    class Connection : public std::enable_shared_from_this<Connection>
+    {
+    public:
+        Connection(asio::io_context& ioContext, Bench& bench)
+            : _bench{ bench }
+            , _stream{ ioContext }
+            , _timer{ ioContext }
+        {}
+
+        void start()
+        {
+            connect();
+        }
+
+    private:
+        void connect()
+        {
+            _stream.expires_after(_bench.getParameters().requestTimeout);
+            _stream.async_connect(_bench.getServerEndpoints(), [self = shared_from_this()](beast::error_code ec, const asio::ip::tcp::endpoint&)
+                {
+                    if (ec)
+                    {
+                        std::cerr << "Cannot connect: " << ec.message() << std::endl;
+                        return;
+                    }
+
+                    beast::error_code optionEc;
+                    self->_stream.socket().set_option(asio::ip::tcp::no_delay{ true }, optionEc);
+
+                    self->scheduleRequest();
+                });
+        }
+
+        void reconnect()
+        {
+            beast::error_code ec;
+            _stream.socket().shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+            _stream.close();
+            _buffer.clear();
+
+            if (!_bench.isOver())
+                connect();
+        }
+
+        void scheduleRequest()
+        {
+            if (_bench.isOver())
+                return;
+
+            _timer.expires_at(_bench.reserveRequestTime());
+            _timer.async_wait([self = shared_from_this()](beast::error_code ec)
+                {
+                    if (!ec)
+                        self->sendRequest();
+                });
+        }
+
+        void sendRequest()
+        {
+            if (_bench.isOver())
+                return;
+
+            _endpoint = _bench.pickEndpoint();
+
+            _request = {};
+            _request.version(11);
+            _request.method(http::verb::get);
+            _request.target(_bench.createTarget(_endpoint));
+            _request.set(http::field::host, _bench.getParameters().host);
+            _request.set(http::field::user_agent, "lms-subsonic-bench");
+            _request.keep_alive(true);
+
+            _parser.emplace();
+            _parser->body_limit(std::numeric_limits<std::uint64_t>::max()); // streamed files can be big
+
+            _requestStartTime = Clock::now();
+            _stream.expires_after(_bench.getParameters().requestTimeout);
+            http::async_write(_stream, _request, [self = shared_from_this()](beast::error_code ec, std::size_t)
+                {
+                    if (ec)
+                    {
+                        self->onRequestFailed(ec.message());
+                        return;
+                    }
+
+                    http::async_read(self->_stream, self->_buffer, *self->_parser, [self](beast::error_code ec, std::size_t)
+                        {
+                            self->onResponse(ec);
+                        });
+                });
+        }
+
+        void onResponse(beast::error_code ec)
+        {
+            if (ec)
+            {
+                onRequestFailed(ec.message());
+                return;
+            }
+
+            const auto latency{ std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - _requestStartTime) };
+            const http::response<http::string_body>& response{ _parser->get() };
+
+            // API errors are reported with a 200 status code
+            const bool success{ response.result() == http::status::ok
+                && (isMediaEndpoint(_endpoint) || isSubsonicResponseOk(response.body())) };
+
+            _bench.addResult(_endpoint, success ? std::optional{ latency } : std::nullopt, response.body().size());
+
+            if (!response.keep_alive())
+                reconnect();
+            else
+                scheduleRequest();
+        }
+
+        void onRequestFailed(const std::string& error)
+        {
+            if (!_bench.isOver())
+                std::cerr << endpointNames[static_cast<std::size_t>(_endpoint)] << " failed: " << error << std::endl;
+
+            _bench.addResult(_endpoint, std::nullopt, 0);
+            reconnect();
+        }
+
+        Bench& _bench;
+        beast::tcp_stream _stream;
+        asio::steady_timer _timer;
+        beast::flat_buffer _buffer;
+        http::request<http::empty_body> _request;
+        std::optional<http::response_parser<http::string_body>> _parser;
+        Endpoint _endpoint{};
+        Clock::time_point _requestStartTime;
+    };
+
+    boost::property_tree::ptree queryJson(asio::io_context& ioContext, const BenchParameters& params, const asio::ip::tcp::resolver::results_type& serverEndpoints, const std::string& target)
+    {
+        beast::tcp_stream stream{ ioContext };
+        stream.connect(serverEndpoints);
+
+        http::request<http::empty_body> request{ http::verb::get, target, 11 };
+        request.set(http::field::host, params.host);
+        request.set(http::field::user_agent, "lms-subsonic-bench");
+        http::write(stream, request);
+
+        beast::flat_buffer buffer;
+        http::response_parser<http::string_body> parser;
+        parser.body_limit(std::numeric_limits<std::uint64_t>::max());
+        http::read(stream, buffer, parser);
+
+        beast::error_code ec;
+        stream.socket().shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+
+        if (parser.get().result() != http::status::ok)
+            throw std::runtime_error{ "Request failed with status " + std::to_string(parser.get().result_int()) };
+
+        std::istringstream iss{ parser.get().body() };
+        boost::property_tree::ptree root;
+        boost::property_tree::read_json(iss, root);
+
+        const boost::property_tree::ptree& response{ root.get_child("subsonic-response") };
+        if (response.get<std::string>("status", "") != "ok")
+            throw std::runtime_error{ "Request failed: " + response.get<std::string>("error.message", "unknown error") };
+
+        return response;
+    }
+
+    LibrarySample sampleLibrary(asio::io_context& ioContext, const BenchParameters& params, const asio::ip::tcp::resolver::results_type& serverEndpoints)
+    {
+        LibrarySample sample;
+
+        const std::string baseTarget{ params.basePath + "/rest/%s.view?u=" + urlEncode(params.user) + "&p=enc:" + hexEncode(params.password) + "&v=1.16.0&c=lms-subsonic-bench&f=json" };
+        auto createTarget{ [&](std::string_view name, std::string_view args)
+            {
+                std::string target{ baseTarget };
+                target.replace(target.find("%s"), 2, name);
+                return target + std::string{ args };
+            } };
+
+        // full album count, used to spread the album list offsets
+        for (std::size_t offset{};; offset += 500)
+        {
+            const auto response{ queryJson(ioContext, params, serverEndpoints, createTarget("getAlbumList2", "&type=alphabeticalByName&size=500&offset=" + std::to_string(offset))) };
+            const auto albums{ response.get_child_optional("albumList2.album") };
+            if (!albums || albums->empty())
+                break;
+
+            for (const auto& [key, album] : *albums)
+            {
+                sample.albumCount++;
+
+                // keep a bounded sample
+                if (sample.albumIds.size() < 10'000)
+                {
+                    sample.albumIds.push_back(album.get<std::string>("id"));
+                    sample.albumNames.push_back(album.get<std::string>("name", ""));
+                    if (const auto coverArt{ album.get_optional<std::string>("coverArt") })
+                        sample.coverArtIds.push_back(*coverArt);
+                }
+            }
+
+            if (albums->size() < 500)
+                break;
+        }
+
+        {
+            const auto response{ queryJson(ioContext, params, serverEndpoints, createTarget("getRandomSongs", "&size=500")) };
+            if (const auto songs{ response.get_child_optional("randomSongs.song") })
+            {
+                for (const auto& [key, song] : *songs)
+                    sample.songIds.push_back(song.get<std::string>("id"));
+            }
+        }
+
+        if (sample.albumIds.empty() || sample.songIds.empty())
+            throw std::runtime_error{ "The library must contain at least one album and one song" };
+
+        return sample;
+    }
+
+    struct LatencySummary
+    {
+        double meanMs{};
+        double p50Ms{};
+        double p90Ms{};
+        double p99Ms{};
+        double maxMs{};
+    };
+
+    LatencySummary summarizeLatencies(std::vector<std::chrono::microseconds> latencies)
+    {
+        LatencySummary res;
+        if (latencies.empty())
+            return res;
+
+        std::sort(std::begin(latencies), std::end(latencies));
+
+        auto toMs{ [](std::chrono::microseconds duration) { return static_cast<double>(duration.count()) / 1000; } };
+        auto percentile{ [&](double p)
+            {
+                // nearest rank
+                const std::size_t rank{ static_cast<std::size_t>(std::ceil(p / 100 * latencies.size())) };
+                return toMs(latencies[std::clamp<std::size_t>(rank, 1, latencies.size()) - 1]);
+            } };
+
+        const auto total{ std::accumulate(std::cbegin(latencies), std::cend(latencies), std::chrono::microseconds{}) };
+        res.meanMs = toMs(total) / latencies.size();
+        res.p50Ms = percentile(50);
+        res.p90Ms = percentile(90);
+        res.p99Ms = percentile(99);
+        res.maxMs = toMs(latencies.back());
+
+        return res;
+    }
+
+    void printReport(const Bench& bench, std::chrono::duration<double> elapsed)
+    {
+        std::cout << std::fixed << std::setprecision(2)
+            << std::left << std::setw(16) << "endpoint" << std::right
+            << std::setw(10) << "requests" << std::setw(8) << "errors" << std::setw(10) << "req/s"
+            << std::setw(10) << "mean ms" << std::setw(10) << "p50 ms" << std::setw(10) << "p90 ms" << std::setw(10) << "p99 ms" << std::setw(10) << "max ms" << std::endl;
+
+        EndpointStats allStats;
+        auto printLine{ [&](std::string_view name, const EndpointStats& stats)
+            {
+                const LatencySummary summary{ summarizeLatencies(stats.latencies) };
+                std::cout << std::left << std::setw(16) << name << std::right
+                    << std::setw(10) << stats.latencies.size() << std::setw(8) << stats.errorCount << std::setw(10) << stats.latencies.size() / elapsed.count()
+                    << std::setw(10) << summary.meanMs << std::setw(10) << summary.p50Ms << std::setw(10) << summary.p90Ms << std::setw(10) << summary.p99Ms << std::setw(10) << summary.maxMs << std::endl;
+            } };
+
+        for (std::size_t i{}; i < endpointCount; ++i)
+        {
+            const EndpointStats& stats{ bench.getStats()[i] };
+            if (stats.latencies.empty() && !stats.errorCount)
+                continue;
+
+            printLine(endpointNames[i], stats);
+            allStats.latencies.insert(std::end(allStats.latencies), std::cbegin(stats.latencies), std::cend(stats.latencies));
+            allStats.errorCount += stats.errorCount;
+        }
+
+        printLine("total", allStats);
+    }
+
+    void writeJsonReport(const Bench& bench, std::chrono::duration<double> elapsed, std::ostream& os)
+    {
+        const BenchParameters& params{ bench.getParameters() };
+
+        auto writeStats{ [&](const EndpointStats& stats)
+            {
+                const LatencySummary summary{ summarizeLatencies(stats.latencies) };
+                os << "{\"requests\": " << stats.latencies.size()
+                    << ", \"errors\": " << stats.errorCount
+                    << ", \"bytes\": " << stats.byteCount
+                    << ", \"throughput\": " << stats.latencies.size() / elapsed.count()
+                    << ", \"latencyMs\": {\"mean\": " << summary.meanMs << ", \"p50\": " << summary.p50Ms << ", \"p90\": " << summary.p90Ms << ", \"p99\": " << summary.p99Ms << ", \"max\": " << summary.maxMs << "}}";
+            } };
+
+        os << std::fixed << std::setprecision(3);
+        os << "{\n";
+        os << "  \"parameters\": {\"concurrency\": " << params.concurrency << ", \"requestRate\": " << params.requestRate << ", \"duration\": " << params.duration.count() << ", \"weights\": {";
+        for (std::size_t i{}; i < endpointCount; ++i)
+            os << (i ? ", " : "") << "\"" << endpointNames[i] << "\": " << params.weights[i];
+        os << "}},\n";
+        os << "  \"elapsed\": " << elapsed.count() << ",\n";
+        os << "  \"endpoints\": {";
+
+        EndpointStats allStats;
+        bool first{ true };
+        for (std::size_t i{}; i < endpointCount; ++i)
+        {
+            const EndpointStats& stats{ bench.getStats()[i] };
+            if (stats.latencies.empty() && !stats.errorCount)
+                continue;
+
+            os << (first ? "\n" : ",\n") << "    \"" << endpointNames[i] << "\": ";
+            writeStats(stats);
+            first = false;
+
+            allStats.latencies.insert(std::end(allStats.latencies), std::cbegin(stats.latencies), std::cend(stats.latencies));
+            allStats.errorCount += stats.errorCount;
+            allStats.byteCount += stats.byteCount;
+        }
+        os << "\n  },\n";
+        os << "  \"total\": ";
+        writeStats(allStats);
+        os << "\n}\n";
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        namespace po = boost::program_options;
+
+        const BenchParameters defaultParams;
+
+        std::ostringstream defaultMix;
+        for (std::size_t i{}; i < endpointCount; ++i)
+            defaultMix << (i ? "," : "") << endpointNames[i] << "=" << defaultParams.weights[i];
+
+        po::options_description options{ "Options" };
+        options.add_options()
+            ("url", po::value<std::string>()->required(), "LMS base url (ex: http://localhost:5082)")
+            ("user,u", po::value<std::string>()->required(), "user name")
+            ("password,p", po::value<std::string>(), "user password (read from stdin if not set)")
+            ("concurrency", po::value<unsigned>()->default_value(defaultParams.concurrency), "number of concurrent connections")
+            ("rate", po::value<double>()->default_value(defaultParams.requestRate), "max total requests per second (0 means as fast as possible)")
+            ("duration", po::value<unsigned>()->default_value(defaultParams.duration.count()), "bench duration, in seconds")
+            ("timeout", po::value<unsigned>()->default_value(defaultParams.requestTimeout.count()), "request timeout, in seconds")
+            ("mix", po::value<std::string>()->default_value(defaultMix.str()), "weighted mix of endpoints to request")
+            ("json-output", po::value<std::string>(), "write the results as JSON in this file")
+            ("help,h", "produce help message")
+            ;
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, options), vm);
+
+        if (vm.count("help")) {
+            std::cout << options << "\n";
+            return EXIT_SUCCESS;
+        }
+
+        // notify required params
+        po::notify(vm);
+
+        BenchParameters params;
+        parseUrl(vm["url"].as<std::string>(), params);
+        params.user = vm["user"].as<std::string>();
+        if (vm.count("password"))
+        {
+            params.password = vm["password"].as<std::string>();
+        }
+        else
+        {
+            std::cout << "Enter password: " << std::flush;
+            std::getline(std::cin, params.password);
+        }
+        params.concurrency = vm["concurrency"].as<unsigned>();
+        params.requestRate = vm["rate"].as<double>();
+        params.duration = std::chrono::seconds{ vm["duration"].as<unsigned>() };
+        params.requestTimeout = std::chrono::seconds{ vm["timeout"].as<unsigned>() };
+        parseWeights(vm["mix"].as<std::string>(), params);
+        if (vm.count("json-output"))
+            params.jsonOutputPath = vm["json-output"].as<std::string>();
+
+        if (params.concurrency == 0)
+            throw std::runtime_error{ "Concurrency must be at least 1" };
+
+        asio::io_context ioContext;
+        const asio::ip::tcp::resolver::results_type serverEndpoints{ asio::ip::tcp::resolver{ ioContext }.resolve(params.host, params.port) };
+
+        std::cout << "Sampling library..." << std::endl;
+        LibrarySample sample{ sampleLibrary(ioContext, params, serverEndpoints) };
+        std::cout << "Found " << sample.albumCount << " albums, sampled " << sample.songIds.size() << " songs" << std::endl;
+
+        Bench bench{ params, serverEndpoints, std::move(sample) };
+
+        std::cout << "Running bench for " << params.duration.count() << " seconds using " << params.concurrency << " connections..." << std::endl;
+        bench.start();
+        for (std::size_t i{}; i < params.concurrency; ++i)
+            std::make_shared<Connection>(ioContext, bench)->start();
+
+        // stop on time, without waiting for the pending requests
+        asio::steady_timer endTimer{ ioContext, params.duration };
+        endTimer.async_wait([&](beast::error_code) { ioContext.stop(); });
+        ioContext.run();
+
+        const std::chrono::duration<double> elapsed{ bench.getElapsed() };
+        printReport(bench, elapsed);
+
+        if (!params.jsonOutputPath.empty())
+        {
+            std::ofstream ofs{ params.jsonOutputPath };
+            if (!ofs)
+                throw std::runtime_error{ "Cannot open '" + params.jsonOutputPath + "' for writing" };
+
+            writeJsonReport(bench, elapsed, ofs);
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}